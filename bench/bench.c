@@ -0,0 +1,206 @@
+/*
+ * Copyright (c) 2013-2020 Martin Donath <martin.donath@squidfunk.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <protobluff.h>
+
+#include "bench/bench.h"
+#include "core/allocator.h"
+
+/* ----------------------------------------------------------------------------
+ * Constants
+ * ------------------------------------------------------------------------- */
+
+/*! Minimum duration of a measurement in nanoseconds */
+#define BENCH_DURATION 100000000ULL
+
+/*! Number of measurements, of which the median is reported */
+#define BENCH_REPETITIONS 5
+
+/* ----------------------------------------------------------------------------
+ * Internal functions
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Compare two measurements by elapsed time.
+ *
+ * \param[in] x Measurement
+ * \param[in] y Measurement
+ * \return      Comparison result
+ */
+static int
+compare(const void *x, const void *y) {
+  const bench_state_t *a = x, *b = y;
+  return (a->elapsed > b->elapsed) - (a->elapsed < b->elapsed);
+}
+
+/*!
+ * Run a benchmark for the given number of iterations.
+ *
+ * \param[in]     bench      Benchmark
+ * \param[in,out] allocator  Tracing allocator
+ * \param[in]     iterations Iterations
+ * \return                   Measurement
+ */
+static bench_state_t
+measure(const bench_t *bench, pb_allocator_t *allocator, size_t iterations) {
+  bench_state_t state = {
+    .iterations = iterations,
+    .allocator  = allocator,
+    .user       = bench->user
+  };
+  bench->run(&state);
+  return state;
+}
+
+/*!
+ * Run a benchmark and report the median of all measurements.
+ *
+ * The number of iterations is first doubled until a measurement takes at
+ * least a tenth of the minimum duration, and then scaled to the minimum
+ * duration, so that timer resolution and setup costs are negligible.
+ *
+ * \param[in]     bench     Benchmark
+ * \param[in,out] allocator Tracing allocator
+ */
+static void
+run(const bench_t *bench, pb_allocator_t *allocator) {
+  size_t iterations = 1;
+  bench_state_t state = measure(bench, allocator, iterations);
+  while (state.elapsed < BENCH_DURATION / 10)
+    state = measure(bench, allocator, iterations *= 2);
+  iterations = (double)iterations * BENCH_DURATION / state.elapsed + 1;
+
+  /* Take the median of all measurements */
+  bench_state_t states[BENCH_REPETITIONS];
+  for (size_t r = 0; r < BENCH_REPETITIONS; r++)
+    states[r] = measure(bench, allocator, iterations);
+  qsort(states, BENCH_REPETITIONS, sizeof(bench_state_t), compare);
+  state = states[BENCH_REPETITIONS / 2];
+
+  /* Report time and throughput per iteration */
+  double ns = (double)state.elapsed / state.iterations;
+  printf("%-32s %12zu %12.1f ns/op", bench->name, state.iterations, ns);
+  if (state.bytes)
+    printf(" %10.1f MB/s", state.bytes * 1000.0 / ns);
+  else
+    printf(" %10s     ", "-");
+  printf(" %10.2f allocs/op %10zu B peak\n",
+    (double)state.allocations / state.iterations, state.peak);
+  fflush(stdout);
+}
+
+/* ----------------------------------------------------------------------------
+ * Interface
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Retrieve the current time of a monotonic clock in nanoseconds.
+ *
+ * \return Nanoseconds
+ */
+extern uint64_t
+bench_now(void) {
+  struct timespec time;
+  clock_gettime(CLOCK_MONOTONIC, &time);
+  return (uint64_t)time.tv_sec * 1000000000ULL + time.tv_nsec;
+}
+
+/*!
+ * Start the measurement of a benchmark after setting up its corpus.
+ *
+ * \param[in,out] state State
+ */
+extern void
+bench_start(bench_state_t *state) {
+  pb_tracing_allocator_reset(state->allocator);
+  state->peak  = pb_tracing_allocator_stats(state->allocator).live;
+  state->start = bench_now();
+}
+
+/*!
+ * Stop the measurement of a benchmark before tearing down its corpus.
+ *
+ * \param[in,out] state State
+ */
+extern void
+bench_stop(bench_state_t *state) {
+  state->elapsed     = bench_now() - state->start;
+  state->allocations =
+    pb_tracing_allocator_stats(state->allocator).allocations +
+    pb_tracing_allocator_stats(state->allocator).resizes;
+  state->peak        =
+    pb_tracing_allocator_stats(state->allocator).peak - state->peak;
+}
+
+/*!
+ * Generate a pseudo-random number using a xorshift generator.
+ *
+ * Corpora are generated from fixed seeds, so they're identical across runs.
+ *
+ * \param[in,out] seed Seed
+ * \return             Pseudo-random number
+ */
+extern uint32_t
+bench_random(uint64_t *seed) {
+  *seed ^= *seed << 13;
+  *seed ^= *seed >> 7;
+  *seed ^= *seed << 17;
+  return (uint32_t)(*seed >> 32);
+}
+
+/*!
+ * Run all benchmarks whose names contain any of the given arguments.
+ *
+ * \param[in] argc     Argument count
+ * \param[in] argv[]   Arguments
+ * \param[in] groups[] Benchmark groups, each terminated by an empty name
+ * \param[in] size     Benchmark group count
+ * \return             Exit code
+ */
+extern int
+bench_main(
+    int argc, char *argv[], const bench_t *groups[], size_t size) {
+  pb_allocator_t allocator = pb_tracing_allocator_create(&allocator_default);
+
+  /* Print header */
+  printf("%-32s %12s %18s %15s %16s %17s\n",
+    "benchmark", "iterations", "time", "throughput", "allocations", "memory");
+  for (size_t g = 0; g < size; g++) {
+    for (const bench_t *bench = groups[g]; bench->name; bench++) {
+      int wanted = argc < 2;
+      for (int a = 1; !wanted && a < argc; a++)
+        wanted = !!strstr(bench->name, argv[a]);
+      if (wanted)
+        run(bench, &allocator);
+    }
+  }
+  pb_tracing_allocator_destroy(&allocator);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,113 @@
+/*
+ * Copyright (c) 2013-2020 Martin Donath <martin.donath@squidfunk.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef PB_BENCH_BENCH_H
+#define PB_BENCH_BENCH_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <protobluff.h>
+
+/* ----------------------------------------------------------------------------
+ * Type definitions
+ * ------------------------------------------------------------------------- */
+
+typedef struct bench_state_t {
+  size_t iterations;                   /*!< Iterations to run */
+  size_t bytes;                        /*!< Bytes processed per iteration */
+  pb_allocator_t *allocator;           /*!< Allocator counting allocations */
+  uint64_t start;                      /*!< Start of measurement */
+  uint64_t elapsed;                    /*!< Elapsed nanoseconds */
+  size_t allocations;                  /*!< Allocations during measurement */
+  size_t peak;                         /*!< Peak bytes during measurement */
+  const void *user;                    /*!< User data of benchmark */
+} bench_state_t;
+
+typedef void
+(*bench_f)(
+  bench_state_t *state);               /*!< State */
+
+typedef struct bench_t {
+  const char *name;                    /*!< Name */
+  bench_f run;                         /*!< Benchmark */
+  const void *user;                    /*!< User data */
+} bench_t;
+
+/* ----------------------------------------------------------------------------
+ * Interface
+ * ------------------------------------------------------------------------- */
+
+extern uint64_t
+bench_now(void);
+
+extern void
+bench_start(
+  bench_state_t *state);               /* State */
+
+extern void
+bench_stop(
+  bench_state_t *state);               /* State */
+
+extern uint32_t
+bench_random(
+  uint64_t *seed);                     /* Seed */
+
+extern int
+bench_main(
+  int argc,                            /* Argument count */
+  char *argv[],                        /* Arguments */
+  const bench_t *groups[],             /* Benchmark groups */
+  size_t size);                        /* Benchmark group count */
+
+/* ----------------------------------------------------------------------------
+ * Benchmarks
+ * ------------------------------------------------------------------------- */
+
+/*! Benchmarks: core */
+extern const bench_t
+bench_core[];
+
+/*! Benchmarks: message */
+extern const bench_t
+bench_message[];
+
+/* ----------------------------------------------------------------------------
+ * Macros
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Abort the benchmark if an expression fails, also in release builds.
+ *
+ * \param[in] expression Expression
+ */
+#define bench_assert(expression) \
+  do { \
+    if (!(expression)) { \
+      fprintf(stderr, "%s:%d: %s\n", __FILE__, __LINE__, #expression); \
+      abort(); \
+    } \
+  } while (0)
+
+#endif /* PB_BENCH_BENCH_H */
@@ -0,0 +1,62 @@
+/*
+ * Copyright (c) 2013-2020 Martin Donath <martin.donath@squidfunk.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <stddef.h>
+#include <stdlib.h>
+
+#include "bench/bench.h"
+#include "bench/compare.h"
+
+/* ----------------------------------------------------------------------------
+ * Corpora
+ * ------------------------------------------------------------------------- */
+
+/*! Corpora, indexed by shape */
+compare_corpus_t
+compare_corpora[] = {
+  [COMPARE_PERSON] = { COMPARE_PERSON },
+  [COMPARE_RECORD] = { COMPARE_RECORD }
+};
+
+/* ----------------------------------------------------------------------------
+ * Program
+ * ------------------------------------------------------------------------- */
+
+/*! Corpus count */
+#define CORPORA (sizeof(compare_corpora) / sizeof(*compare_corpora))
+
+/*
+ * Run all comparative benchmarks matching the given arguments, for every
+ * combination of corpus, operation and runtime, on identical encoded data.
+ */
+int
+main(int argc, char *argv[]) {
+  for (size_t c = 0; c < CORPORA; c++)
+    compare_generate(&(compare_corpora[c]));
+
+  /* Run benchmarks, e.g. compare/record/decode/protobluff */
+  const bench_t *groups[] = { compare_protobluff, compare_protobuf };
+  int result = bench_main(argc, argv, groups, 2);
+  for (size_t c = 0; c < CORPORA; c++)
+    free(compare_corpora[c].data);
+  return result;
+}
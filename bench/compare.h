@@ -0,0 +1,96 @@
+/*
+ * Copyright (c) 2013-2020 Martin Donath <martin.donath@squidfunk.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef PB_BENCH_COMPARE_H
+#define PB_BENCH_COMPARE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "bench/bench.h"
+
+/* ----------------------------------------------------------------------------
+ * Constants
+ * ------------------------------------------------------------------------- */
+
+/*! Corpus: values of persons */
+#define COMPARE_NAME         "John Doe"
+#define COMPARE_NAME_MUTATED "Jonathan Doe-Smith"
+#define COMPARE_ID           1234
+#define COMPARE_EMAIL        "jdoe@example.com"
+#define COMPARE_NUMBER       "+1 555 0100"
+#define COMPARE_PHONES       2
+
+/*! Corpus: values of records */
+#define COMPARE_RECORD_ID    1099511627776ULL
+#define COMPARE_TIMESTAMP    1500000000000LL
+#define COMPARE_VALUES       64
+#define COMPARE_PEOPLE       16
+#define COMPARE_PAYLOAD      1024
+#define COMPARE_SCORE        0.5
+#define COMPARE_TAG          "label"
+#define COMPARE_TAGS         8
+
+/* ----------------------------------------------------------------------------
+ * Type definitions
+ * ------------------------------------------------------------------------- */
+
+typedef enum compare_shape_t {
+  COMPARE_PERSON,                      /*!< Person */
+  COMPARE_RECORD                       /*!< Record */
+} compare_shape_t;
+
+typedef struct compare_corpus_t {
+  compare_shape_t shape;               /*!< Shape */
+  uint8_t *data;                       /*!< Encoded message */
+  size_t size;                         /*!< Encoded message size */
+} compare_corpus_t;
+
+/* ----------------------------------------------------------------------------
+ * Corpora
+ * ------------------------------------------------------------------------- */
+
+/*! Corpora, indexed by shape */
+extern compare_corpus_t
+compare_corpora[];
+
+/* ----------------------------------------------------------------------------
+ * Interface
+ * ------------------------------------------------------------------------- */
+
+extern void
+compare_generate(
+  compare_corpus_t *corpus);           /* Corpus */
+
+/* ----------------------------------------------------------------------------
+ * Runtimes
+ * ------------------------------------------------------------------------- */
+
+/*! Benchmarks: protobluff */
+extern const bench_t
+compare_protobluff[];
+
+/*! Benchmarks: Google Protocol Buffers */
+extern const bench_t
+compare_protobuf[];
+
+#endif /* PB_BENCH_COMPARE_H */
@@ -0,0 +1,367 @@
+/*
+ * Copyright (c) 2013-2020 Martin Donath <martin.donath@squidfunk.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <protobluff.h>
+#include <protobluff/descriptor.h>
+
+#include "bench/bench.h"
+#include "bench/compare.h"
+
+/* ----------------------------------------------------------------------------
+ * Descriptors
+ * ------------------------------------------------------------------------- */
+
+/* Descriptor of phone types */
+static pb_enum_descriptor_t
+type_descriptor = { {
+  (const pb_enum_value_descriptor_t []){
+    {  0, "MOBILE" },
+    {  1, "HOME" },
+    {  2, "WORK" }
+  }, 3 } };
+
+/* Descriptor of phone numbers */
+static pb_descriptor_t
+phone_descriptor = { {
+  (const pb_field_descriptor_t []){
+    {  1, "number",    STRING,  REQUIRED },
+    {  2, "type",      ENUM,    OPTIONAL, &type_descriptor }
+  }, 2 } };
+
+/* Descriptor of persons */
+static pb_descriptor_t
+person_descriptor = { {
+  (const pb_field_descriptor_t []){
+    {  1, "name",      STRING,  REQUIRED },
+    {  2, "id",        INT32,   REQUIRED },
+    {  3, "email",     STRING,  OPTIONAL },
+    {  4, "phone",     MESSAGE, REPEATED, &phone_descriptor }
+  }, 4 } };
+
+/* Descriptor of records */
+static pb_descriptor_t
+record_descriptor = { {
+  (const pb_field_descriptor_t []){
+    {  1, "id",        UINT64,  REQUIRED },
+    {  2, "name",      STRING,  OPTIONAL },
+    {  3, "timestamp", INT64,   OPTIONAL },
+    {  4, "values",    UINT32,  REPEATED, NULL, NULL, PACKED },
+    {  5, "people",    MESSAGE, REPEATED, &person_descriptor },
+    {  6, "payload",   BYTES,   OPTIONAL },
+    {  7, "score",     DOUBLE,  OPTIONAL },
+    {  8, "tags",      STRING,  REPEATED }
+  }, 8 } };
+
+/*! Descriptors, indexed by shape */
+static const pb_descriptor_t *
+descriptors[] = {
+  [COMPARE_PERSON] = &person_descriptor,
+  [COMPARE_RECORD] = &record_descriptor
+};
+
+/*! Tags of fields read, indexed by shape */
+static const pb_tag_t
+read_tags[] = {
+  [COMPARE_PERSON] = 3,                /* email */
+  [COMPARE_RECORD] = 7                 /* score */
+};
+
+/*! Tags of names altered, indexed by shape */
+static const pb_tag_t
+mutate_tags[] = {
+  [COMPARE_PERSON] = 1,
+  [COMPARE_RECORD] = 2
+};
+
+/* ----------------------------------------------------------------------------
+ * Corpora
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Encode a person.
+ *
+ * \param[in,out] encoder Encoder
+ */
+static void
+encode_person(pb_encoder_t *encoder) {
+  pb_string_t name   = pb_string_init_from_chars(COMPARE_NAME);
+  int32_t     id     = COMPARE_ID;
+  pb_string_t email  = pb_string_init_from_chars(COMPARE_EMAIL);
+  pb_string_t number = pb_string_init_from_chars(COMPARE_NUMBER);
+  bench_assert(!pb_encoder_encode(encoder, 1, &name, 1));
+  bench_assert(!pb_encoder_encode(encoder, 2, &id, 1));
+  bench_assert(!pb_encoder_encode(encoder, 3, &email, 1));
+  for (size_t p = 0; p < COMPARE_PHONES; p++) {
+    pb_encoder_frame_t frame;
+    pb_enum_t type = p % 3;
+    bench_assert(!pb_encoder_begin_nested(encoder, 4, &frame));
+    bench_assert(!pb_encoder_encode(encoder, 1, &number, 1));
+    bench_assert(!pb_encoder_encode(encoder, 2, &type, 1));
+    pb_encoder_end_nested(encoder);
+  }
+}
+
+/*!
+ * Encode a record.
+ *
+ * \param[in,out] encoder Encoder
+ */
+static void
+encode_record(pb_encoder_t *encoder) {
+  static uint32_t values[COMPARE_VALUES];
+  static uint8_t  payload[COMPARE_PAYLOAD];
+  static pb_string_t tags[COMPARE_TAGS];
+  for (size_t v = 0; v < COMPARE_VALUES; v++)
+    values[v] = v << (v % 28);
+  for (size_t p = 0; p < COMPARE_PAYLOAD; p++)
+    payload[p] = p;
+  for (size_t t = 0; t < COMPARE_TAGS; t++)
+    tags[t] = pb_string_init_from_chars(COMPARE_TAG);
+
+  /* Encode fields in order of their tags */
+  uint64_t    id        = COMPARE_RECORD_ID;
+  pb_string_t name      = pb_string_init_from_chars(COMPARE_NAME);
+  int64_t     timestamp = COMPARE_TIMESTAMP;
+  pb_string_t data      = pb_string_init(payload, COMPARE_PAYLOAD);
+  double      score     = COMPARE_SCORE;
+  bench_assert(!pb_encoder_encode(encoder, 1, &id, 1));
+  bench_assert(!pb_encoder_encode(encoder, 2, &name, 1));
+  bench_assert(!pb_encoder_encode(encoder, 3, &timestamp, 1));
+  bench_assert(!pb_encoder_encode(encoder, 4, values, COMPARE_VALUES));
+  for (size_t p = 0; p < COMPARE_PEOPLE; p++) {
+    pb_encoder_frame_t frame;
+    bench_assert(!pb_encoder_begin_nested(encoder, 5, &frame));
+    encode_person(encoder);
+    pb_encoder_end_nested(encoder);
+  }
+  bench_assert(!pb_encoder_encode(encoder, 6, &data, 1));
+  bench_assert(!pb_encoder_encode(encoder, 7, &score, 1));
+  bench_assert(!pb_encoder_encode(encoder, 8, tags, COMPARE_TAGS));
+}
+
+/*!
+ * Encode a message of the given shape.
+ *
+ * \param[in,out] encoder Encoder
+ * \param[in]     shape   Shape
+ */
+static void
+encode(pb_encoder_t *encoder, compare_shape_t shape) {
+  if (shape == COMPARE_PERSON)
+    encode_person(encoder);
+  else
+    encode_record(encoder);
+}
+
+/* ----------------------------------------------------------------------------
+ * Handlers
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Count fields, descending into nested messages.
+ *
+ * \param[in]     descriptor Field descriptor
+ * \param[in]     value      Pointer holding value
+ * \param[in,out] user       User data
+ * \return                   Error code
+ */
+static pb_error_t
+handler(
+    const pb_field_descriptor_t *descriptor, const void *value, void *user) {
+  (*(size_t *)user)++;
+  return pb_field_descriptor_type(descriptor) == PB_TYPE_MESSAGE
+    ? pb_decoder_decode(value, handler, user)
+    : PB_ERROR_NONE;
+}
+
+/*!
+ * Count values of packed fields.
+ *
+ * \param[in]     descriptor Field descriptor
+ * \param[in]     values     Pointer holding values
+ * \param[in]     size       Value count
+ * \param[in,out] user       User data
+ * \return                   Error code
+ */
+static pb_error_t
+handler_packed(
+    const pb_field_descriptor_t *descriptor, const void *values,
+    size_t size, void *user) {
+  *(size_t *)user += size;
+  return PB_ERROR_NONE;
+}
+
+/* ----------------------------------------------------------------------------
+ * Benchmarks
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Benchmark decoding all fields of a message.
+ *
+ * \param[in,out] state State
+ */
+static void
+bench_decode(bench_state_t *state) {
+  const compare_corpus_t *corpus = state->user;
+  pb_buffer_t buffer = pb_buffer_create_zero_copy(corpus->data, corpus->size);
+  state->bytes = corpus->size;
+
+  /* Decode message, visiting nested messages */
+  size_t fields = 0;
+  bench_start(state);
+  for (size_t i = 0; i < state->iterations; i++) {
+    pb_decoder_t decoder =
+      pb_decoder_create(descriptors[corpus->shape], &buffer);
+    bench_assert(!pb_decoder_decode_packed(
+      &decoder, handler, handler_packed, &fields));
+    pb_decoder_destroy(&decoder);
+  }
+  bench_stop(state);
+  bench_assert(fields);
+  pb_buffer_destroy(&buffer);
+}
+
+/*!
+ * Benchmark encoding a message from its values.
+ *
+ * \param[in,out] state State
+ */
+static void
+bench_encode(bench_state_t *state) {
+  const compare_corpus_t *corpus = state->user;
+  state->bytes = corpus->size;
+
+  /* Encode message, creating a new encoder every time */
+  bench_start(state);
+  for (size_t i = 0; i < state->iterations; i++) {
+    pb_encoder_t encoder = pb_encoder_create_with_allocator(
+      state->allocator, descriptors[corpus->shape]);
+    encode(&encoder, corpus->shape);
+    bench_assert(pb_buffer_size(pb_encoder_buffer(&encoder)) == corpus->size);
+    pb_encoder_destroy(&encoder);
+  }
+  bench_stop(state);
+}
+
+/*!
+ * Benchmark reading a single field of a message.
+ *
+ * \param[in,out] state State
+ */
+static void
+bench_read(bench_state_t *state) {
+  const compare_corpus_t *corpus = state->user;
+  state->bytes = corpus->size;
+
+  /* Read field, indexing the message on every iteration */
+  union { pb_string_t string; double number; } value;
+  bench_start(state);
+  for (size_t i = 0; i < state->iterations; i++) {
+    pb_journal_t journal =
+      pb_journal_create_readonly(corpus->data, corpus->size);
+    pb_message_t message =
+      pb_message_create(descriptors[corpus->shape], &journal);
+    bench_assert(!pb_message_get(&message, read_tags[corpus->shape], &value));
+    pb_message_destroy(&message);
+    pb_journal_destroy(&journal);
+  }
+  bench_stop(state);
+}
+
+/*!
+ * Benchmark altering the name of a message and obtaining the result.
+ *
+ * \param[in,out] state State
+ */
+static void
+bench_mutate(bench_state_t *state) {
+  const compare_corpus_t *corpus = state->user;
+  pb_string_t name = pb_string_init_from_chars(COMPARE_NAME_MUTATED);
+  state->bytes = corpus->size;
+
+  /* Copy message and alter name in place */
+  bench_start(state);
+  for (size_t i = 0; i < state->iterations; i++) {
+    pb_journal_t journal = pb_journal_create_with_allocator(
+      state->allocator, corpus->data, corpus->size);
+    pb_message_t message =
+      pb_message_create(descriptors[corpus->shape], &journal);
+    bench_assert(!pb_message_put(&message, mutate_tags[corpus->shape], &name));
+    bench_assert(pb_journal_size(&journal) == corpus->size +
+      strlen(COMPARE_NAME_MUTATED) - strlen(COMPARE_NAME));
+    pb_message_destroy(&message);
+    pb_journal_destroy(&journal);
+  }
+  bench_stop(state);
+}
+
+/* ----------------------------------------------------------------------------
+ * Interface
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Generate the encoded message of a corpus.
+ *
+ * \param[in,out] corpus Corpus
+ */
+extern void
+compare_generate(compare_corpus_t *corpus) {
+  pb_encoder_t encoder = pb_encoder_create(descriptors[corpus->shape]);
+  encode(&encoder, corpus->shape);
+  const pb_buffer_t *buffer = pb_encoder_buffer(&encoder);
+  corpus->size = pb_buffer_size(buffer);
+  corpus->data = malloc(corpus->size);
+  bench_assert(corpus->data);
+  memcpy(corpus->data, pb_buffer_data(buffer), corpus->size);
+  pb_encoder_destroy(&encoder);
+}
+
+/* ----------------------------------------------------------------------------
+ * Registry
+ * ------------------------------------------------------------------------- */
+
+/*! Benchmarks: protobluff */
+const bench_t
+compare_protobluff[] = {
+  { "compare/person/decode/protobluff", bench_decode,
+    &compare_corpora[COMPARE_PERSON] },
+  { "compare/person/encode/protobluff", bench_encode,
+    &compare_corpora[COMPARE_PERSON] },
+  { "compare/person/read/protobluff",   bench_read,
+    &compare_corpora[COMPARE_PERSON] },
+  { "compare/person/mutate/protobluff", bench_mutate,
+    &compare_corpora[COMPARE_PERSON] },
+  { "compare/record/decode/protobluff", bench_decode,
+    &compare_corpora[COMPARE_RECORD] },
+  { "compare/record/encode/protobluff", bench_encode,
+    &compare_corpora[COMPARE_RECORD] },
+  { "compare/record/read/protobluff",   bench_read,
+    &compare_corpora[COMPARE_RECORD] },
+  { "compare/record/mutate/protobluff", bench_mutate,
+    &compare_corpora[COMPARE_RECORD] },
+  { NULL }
+};
@@ -0,0 +1,327 @@
+/*
+ * Copyright (c) 2013-2020 Martin Donath <martin.donath@squidfunk.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <string>
+
+#include "bench/compare.pb.h"
+
+extern "C" {
+#include "bench/bench.h"
+#include "bench/compare.h"
+}
+
+/* ----------------------------------------------------------------------------
+ * Allocator
+ * ------------------------------------------------------------------------- */
+
+/*! Header of allocations, keeping their size and maximum alignment */
+union header {
+  std::size_t size;                    /*!< Allocation size */
+  std::max_align_t align;              /*!< Alignment */
+};
+
+/*! Allocation tracking, only enabled during measurement */
+static struct {
+  bool enabled;                        /*!< Tracking enabled */
+  std::size_t allocations;             /*!< Allocations */
+  std::size_t live;                    /*!< Live bytes */
+  std::size_t peak;                    /*!< Peak bytes */
+} tracking;
+
+/*!
+ * Allocate memory, keeping track of allocations and live bytes.
+ *
+ * The tracing allocator of protobluff can't see allocations of the C++
+ * runtime, so the global allocation functions are replaced instead. As
+ * benchmarks are built without exceptions, failed allocations abort.
+ *
+ * \param[in] size Size
+ * \return         Memory block
+ */
+void *
+operator new(std::size_t size) {
+  header *block = static_cast<header *>(std::malloc(sizeof(header) + size));
+  bench_assert(block);
+  block->size = size;
+  if (tracking.enabled) {
+    tracking.allocations++;
+    if ((tracking.live += size) > tracking.peak)
+      tracking.peak = tracking.live;
+  }
+  return block + 1;
+}
+
+/*!
+ * Free memory, keeping track of live bytes.
+ *
+ * \param[in,out] data Memory block
+ */
+void
+operator delete(void *data) noexcept {
+  if (data) {
+    header *block = static_cast<header *>(data) - 1;
+    if (tracking.enabled)
+      tracking.live -= block->size < tracking.live
+        ? block->size : tracking.live;
+    std::free(block);
+  }
+}
+
+/*!
+ * Free memory of known size, keeping track of live bytes.
+ *
+ * \param[in,out] data Memory block
+ * \param[in]     size Size
+ */
+void
+operator delete(void *data, std::size_t size) noexcept {
+  operator delete(data);
+}
+
+/*!
+ * Start the measurement, tracking allocations of the C++ runtime.
+ *
+ * \param[in,out] state State
+ */
+static void
+start(bench_state_t *state) {
+  tracking.allocations = 0;
+  tracking.live        = 0;
+  tracking.peak        = 0;
+  tracking.enabled     = true;
+  bench_start(state);
+}
+
+/*!
+ * Stop the measurement, reporting allocations of the C++ runtime.
+ *
+ * \param[in,out] state State
+ */
+static void
+stop(bench_state_t *state) {
+  bench_stop(state);
+  tracking.enabled   = false;
+  state->allocations = tracking.allocations;
+  state->peak        = tracking.peak;
+}
+
+/* ----------------------------------------------------------------------------
+ * Corpora
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Encode a person.
+ *
+ * \param[in,out] person Person
+ */
+static void
+encode_person(compare::Person *person) {
+  person->set_name(COMPARE_NAME);
+  person->set_id(COMPARE_ID);
+  person->set_email(COMPARE_EMAIL);
+  for (std::size_t p = 0; p < COMPARE_PHONES; p++) {
+    compare::Person::PhoneNumber *phone = person->add_phone();
+    phone->set_number(COMPARE_NUMBER);
+    phone->set_type(
+      static_cast<compare::Person::PhoneNumber::PhoneType>(p % 3));
+  }
+}
+
+/*!
+ * Encode a record.
+ *
+ * \param[in,out] record Record
+ */
+static void
+encode_record(compare::Record *record) {
+  static std::uint8_t payload[COMPARE_PAYLOAD];
+  for (std::size_t p = 0; p < COMPARE_PAYLOAD; p++)
+    payload[p] = p;
+
+  /* Set fields in order of their tags */
+  record->set_id(COMPARE_RECORD_ID);
+  record->set_name(COMPARE_NAME);
+  record->set_timestamp(COMPARE_TIMESTAMP);
+  for (std::size_t v = 0; v < COMPARE_VALUES; v++)
+    record->add_values(v << (v % 28));
+  for (std::size_t p = 0; p < COMPARE_PEOPLE; p++)
+    encode_person(record->add_people());
+  record->set_payload(payload, COMPARE_PAYLOAD);
+  record->set_score(COMPARE_SCORE);
+  for (std::size_t t = 0; t < COMPARE_TAGS; t++)
+    record->add_tags(COMPARE_TAG);
+}
+
+/* ----------------------------------------------------------------------------
+ * Benchmarks
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Benchmark parsing a message.
+ *
+ * \param[in,out] state State
+ */
+template <typename T>
+static void
+bench_decode(bench_state_t *state) {
+  const compare_corpus_t *corpus =
+    static_cast<const compare_corpus_t *>(state->user);
+  state->bytes = corpus->size;
+
+  /* Parse message into a new instance every time */
+  start(state);
+  for (std::size_t i = 0; i < state->iterations; i++) {
+    T message;
+    bench_assert(message.ParseFromArray(corpus->data, corpus->size));
+  }
+  stop(state);
+}
+
+/*!
+ * Benchmark building and serializing a message from its values.
+ *
+ * \param[in,out] state State
+ */
+template <typename T, void (*encode)(T *)>
+static void
+bench_encode(bench_state_t *state) {
+  const compare_corpus_t *corpus =
+    static_cast<const compare_corpus_t *>(state->user);
+  state->bytes = corpus->size;
+
+  /* Build and serialize message */
+  start(state);
+  for (std::size_t i = 0; i < state->iterations; i++) {
+    T message;
+    std::string data;
+    encode(&message);
+    bench_assert(message.SerializeToString(&data));
+    bench_assert(data.size() == corpus->size);
+  }
+  stop(state);
+}
+
+/*!
+ * Benchmark reading the email of a person, which requires a full parse.
+ *
+ * \param[in,out] state State
+ */
+static void
+bench_read_person(bench_state_t *state) {
+  const compare_corpus_t *corpus =
+    static_cast<const compare_corpus_t *>(state->user);
+  state->bytes = corpus->size;
+
+  /* Parse message and read field */
+  start(state);
+  for (std::size_t i = 0; i < state->iterations; i++) {
+    compare::Person message;
+    bench_assert(message.ParseFromArray(corpus->data, corpus->size));
+    bench_assert(message.has_email());
+  }
+  stop(state);
+}
+
+/*!
+ * Benchmark reading the score of a record, which requires a full parse.
+ *
+ * \param[in,out] state State
+ */
+static void
+bench_read_record(bench_state_t *state) {
+  const compare_corpus_t *corpus =
+    static_cast<const compare_corpus_t *>(state->user);
+  state->bytes = corpus->size;
+
+  /* Parse message and read field */
+  start(state);
+  for (std::size_t i = 0; i < state->iterations; i++) {
+    compare::Record message;
+    bench_assert(message.ParseFromArray(corpus->data, corpus->size));
+    bench_assert(message.score() == COMPARE_SCORE);
+  }
+  stop(state);
+}
+
+/*!
+ * Benchmark altering the name of a message and serializing the result.
+ *
+ * \param[in,out] state State
+ */
+template <typename T>
+static void
+bench_mutate(bench_state_t *state) {
+  const compare_corpus_t *corpus =
+    static_cast<const compare_corpus_t *>(state->user);
+  state->bytes = corpus->size;
+
+  /* Parse message, alter name and serialize message */
+  start(state);
+  for (std::size_t i = 0; i < state->iterations; i++) {
+    T message;
+    std::string data;
+    bench_assert(message.ParseFromArray(corpus->data, corpus->size));
+    message.set_name(COMPARE_NAME_MUTATED);
+    bench_assert(message.SerializeToString(&data));
+    bench_assert(data.size() == corpus->size +
+      sizeof(COMPARE_NAME_MUTATED) - sizeof(COMPARE_NAME));
+  }
+  stop(state);
+}
+
+/* ----------------------------------------------------------------------------
+ * Registry
+ * ------------------------------------------------------------------------- */
+
+/*! Benchmarks: Google Protocol Buffers */
+extern "C" const bench_t
+compare_protobuf[] = {
+  { "compare/person/decode/protobuf",
+    bench_decode<compare::Person>,
+    &compare_corpora[COMPARE_PERSON] },
+  { "compare/person/encode/protobuf",
+    bench_encode<compare::Person, encode_person>,
+    &compare_corpora[COMPARE_PERSON] },
+  { "compare/person/read/protobuf",
+    bench_read_person,
+    &compare_corpora[COMPARE_PERSON] },
+  { "compare/person/mutate/protobuf",
+    bench_mutate<compare::Person>,
+    &compare_corpora[COMPARE_PERSON] },
+  { "compare/record/decode/protobuf",
+    bench_decode<compare::Record>,
+    &compare_corpora[COMPARE_RECORD] },
+  { "compare/record/encode/protobuf",
+    bench_encode<compare::Record, encode_record>,
+    &compare_corpora[COMPARE_RECORD] },
+  { "compare/record/read/protobuf",
+    bench_read_record,
+    &compare_corpora[COMPARE_RECORD] },
+  { "compare/record/mutate/protobuf",
+    bench_mutate<compare::Record>,
+    &compare_corpora[COMPARE_RECORD] },
+  { NULL }
+};
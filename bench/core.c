@@ -0,0 +1,347 @@
+/*
+ * Copyright (c) 2013-2020 Martin Donath <martin.donath@squidfunk.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <protobluff.h>
+#include <protobluff/descriptor.h>
+
+#include "bench/bench.h"
+
+/* ----------------------------------------------------------------------------
+ * Constants
+ * ------------------------------------------------------------------------- */
+
+/*! Nesting depth of deeply nested messages */
+#define BENCH_NESTED_DEPTH 32
+
+/*! Value count of packed arrays */
+#define BENCH_PACKED_SIZE 65536
+
+/*! Size of large strings */
+#define BENCH_STRING_SIZE 1048576
+
+/* ----------------------------------------------------------------------------
+ * Descriptors
+ * ------------------------------------------------------------------------- */
+
+/* Descriptor of small RPC messages */
+static pb_descriptor_t
+rpc_descriptor = { {
+  (const pb_field_descriptor_t []){
+    {  1, "id",       UINT64, REQUIRED },
+    {  2, "method",   STRING, OPTIONAL },
+    {  3, "time",     INT64,  OPTIONAL },
+    {  4, "deadline", UINT32, OPTIONAL },
+    {  5, "payload",  BYTES,  OPTIONAL },
+    {  6, "retry",    BOOL,   OPTIONAL }
+  }, 6 } };
+
+/* Descriptor of deeply nested messages */
+static pb_descriptor_t
+nested_descriptor = { {
+  (const pb_field_descriptor_t []){
+    {  1, "child",    MESSAGE, OPTIONAL, &nested_descriptor },
+    {  2, "value",    UINT32,  OPTIONAL }
+  }, 2 } };
+
+/* Descriptor of big packed arrays */
+static pb_descriptor_t
+packed_descriptor = { {
+  (const pb_field_descriptor_t []){
+    {  1, "values",   UINT32, REPEATED, NULL, NULL, PACKED }
+  }, 1 } };
+
+/* Descriptor of large strings */
+static pb_descriptor_t
+string_descriptor = { {
+  (const pb_field_descriptor_t []){
+    {  1, "data",     BYTES,  OPTIONAL }
+  }, 1 } };
+
+/* ----------------------------------------------------------------------------
+ * Corpora
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Encode a small RPC message.
+ *
+ * \param[in,out] encoder Encoder
+ * \param[in,out] seed    Seed
+ */
+static void
+encode_rpc(pb_encoder_t *encoder, uint64_t *seed) {
+  static uint8_t payload[64];
+  uint64_t id       = bench_random(seed);
+  int64_t  time     = 1500000000000 + bench_random(seed);
+  uint32_t deadline = bench_random(seed) % 10000;
+  uint8_t  retry    = bench_random(seed) & 1;
+  pb_string_t method = pb_string_init_from_chars("service.Method");
+  pb_string_t data   = pb_string_init(payload,
+    bench_random(seed) % sizeof(payload));
+  bench_assert(!pb_encoder_encode(encoder, 1, &id, 1));
+  bench_assert(!pb_encoder_encode(encoder, 2, &method, 1));
+  bench_assert(!pb_encoder_encode(encoder, 3, &time, 1));
+  bench_assert(!pb_encoder_encode(encoder, 4, &deadline, 1));
+  bench_assert(!pb_encoder_encode(encoder, 5, &data, 1));
+  bench_assert(!pb_encoder_encode(encoder, 6, &retry, 1));
+}
+
+/*!
+ * Encode a deeply nested message, with a value on every level.
+ *
+ * \param[in,out] encoder Encoder
+ * \param[in,out] seed    Seed
+ */
+static void
+encode_nested(pb_encoder_t *encoder, uint64_t *seed) {
+  pb_encoder_frame_t frames[BENCH_NESTED_DEPTH];
+  for (size_t d = 0; d < BENCH_NESTED_DEPTH; d++) {
+    uint32_t value = bench_random(seed);
+    bench_assert(!pb_encoder_encode(encoder, 2, &value, 1));
+    bench_assert(!pb_encoder_begin_nested(encoder, 1, &(frames[d])));
+  }
+  for (size_t d = 0; d < BENCH_NESTED_DEPTH; d++)
+    pb_encoder_end_nested(encoder);
+}
+
+/*! Values of big packed arrays */
+static uint32_t
+packed_values[BENCH_PACKED_SIZE];
+
+/*! Data of large strings */
+static uint8_t
+string_data[BENCH_STRING_SIZE];
+
+/*!
+ * Generate the values of big packed arrays and large strings once.
+ */
+static void
+generate(void) {
+  static int generated = 0;
+  if (!generated) {
+    uint64_t seed = 1;
+    for (size_t v = 0; v < BENCH_PACKED_SIZE; v++)
+      packed_values[v] = bench_random(&seed) >> (bench_random(&seed) % 32);
+    for (size_t d = 0; d < BENCH_STRING_SIZE; d++)
+      string_data[d] = bench_random(&seed);
+    generated = 1;
+  }
+}
+
+/*!
+ * Encode a big packed array of values of varying size.
+ *
+ * \param[in,out] encoder Encoder
+ * \param[in,out] seed    Seed
+ */
+static void
+encode_packed(pb_encoder_t *encoder, uint64_t *seed) {
+  bench_assert(!pb_encoder_encode(encoder, 1,
+    packed_values, BENCH_PACKED_SIZE));
+}
+
+/*!
+ * Encode a large string.
+ *
+ * \param[in,out] encoder Encoder
+ * \param[in,out] seed    Seed
+ */
+static void
+encode_string(pb_encoder_t *encoder, uint64_t *seed) {
+  pb_string_t value = pb_string_init(string_data, BENCH_STRING_SIZE);
+  bench_assert(!pb_encoder_encode(encoder, 1, &value, 1));
+}
+
+/* ----------------------------------------------------------------------------
+ * Handlers
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Count fields, descending into nested messages.
+ *
+ * \param[in]     descriptor Field descriptor
+ * \param[in]     value      Pointer holding value
+ * \param[in,out] user       User data
+ * \return                   Error code
+ */
+static pb_error_t
+handler(
+    const pb_field_descriptor_t *descriptor, const void *value, void *user) {
+  (*(size_t *)user)++;
+  return pb_field_descriptor_type(descriptor) == PB_TYPE_MESSAGE
+    ? pb_decoder_decode(value, handler, user)
+    : PB_ERROR_NONE;
+}
+
+/*!
+ * Count values of packed fields.
+ *
+ * \param[in]     descriptor Field descriptor
+ * \param[in]     values     Pointer holding values
+ * \param[in]     size       Value count
+ * \param[in,out] user       User data
+ * \return                   Error code
+ */
+static pb_error_t
+handler_packed(
+    const pb_field_descriptor_t *descriptor, const void *values,
+    size_t size, void *user) {
+  *(size_t *)user += size;
+  return PB_ERROR_NONE;
+}
+
+/* ----------------------------------------------------------------------------
+ * Benchmarks
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Benchmark encoding messages of a corpus.
+ *
+ * \param[in,out] state      State
+ * \param[in]     descriptor Descriptor
+ * \param[in]     encode     Corpus
+ */
+static void
+bench_encode(
+    bench_state_t *state, const pb_descriptor_t *descriptor,
+    void (*encode)(pb_encoder_t *, uint64_t *)) {
+  uint64_t seed = 1;
+  generate();
+  pb_encoder_t encoder =
+    pb_encoder_create_with_allocator(state->allocator, descriptor);
+  encode(&encoder, &seed);
+  state->bytes = pb_buffer_size(pb_encoder_buffer(&encoder));
+  pb_encoder_destroy(&encoder);
+
+  /* Encode messages, creating a new encoder every time */
+  bench_start(state);
+  for (size_t i = 0; i < state->iterations; i++) {
+    seed = 1;
+    encoder = pb_encoder_create_with_allocator(state->allocator, descriptor);
+    encode(&encoder, &seed);
+    pb_encoder_destroy(&encoder);
+  }
+  bench_stop(state);
+}
+
+/*!
+ * Benchmark decoding a message of a corpus.
+ *
+ * \param[in,out] state      State
+ * \param[in]     descriptor Descriptor
+ * \param[in]     encode     Corpus
+ * \param[in]     packed     Use packed handler
+ */
+static void
+bench_decode(
+    bench_state_t *state, const pb_descriptor_t *descriptor,
+    void (*encode)(pb_encoder_t *, uint64_t *), int packed) {
+  uint64_t seed = 1;
+  generate();
+  pb_encoder_t encoder = pb_encoder_create(descriptor);
+  encode(&encoder, &seed);
+  const pb_buffer_t *buffer = pb_encoder_buffer(&encoder);
+  state->bytes = pb_buffer_size(buffer);
+
+  /* Decode message */
+  size_t fields = 0;
+  bench_start(state);
+  for (size_t i = 0; i < state->iterations; i++) {
+    pb_decoder_t decoder = pb_decoder_create(descriptor, buffer);
+    bench_assert(!(packed
+      ? pb_decoder_decode_packed(&decoder, handler, handler_packed, &fields)
+      : pb_decoder_decode(&decoder, handler, &fields)));
+    pb_decoder_destroy(&decoder);
+  }
+  bench_stop(state);
+  bench_assert(fields);
+  pb_encoder_destroy(&encoder);
+}
+
+/* ------------------------------------------------------------------------- */
+
+static void
+bench_encode_rpc(bench_state_t *state) {
+  bench_encode(state, &rpc_descriptor, encode_rpc);
+}
+
+static void
+bench_encode_nested(bench_state_t *state) {
+  bench_encode(state, &nested_descriptor, encode_nested);
+}
+
+static void
+bench_encode_packed(bench_state_t *state) {
+  bench_encode(state, &packed_descriptor, encode_packed);
+}
+
+static void
+bench_encode_string(bench_state_t *state) {
+  bench_encode(state, &string_descriptor, encode_string);
+}
+
+static void
+bench_decode_rpc(bench_state_t *state) {
+  bench_decode(state, &rpc_descriptor, encode_rpc, 0);
+}
+
+static void
+bench_decode_nested(bench_state_t *state) {
+  bench_decode(state, &nested_descriptor, encode_nested, 0);
+}
+
+static void
+bench_decode_packed(bench_state_t *state) {
+  bench_decode(state, &packed_descriptor, encode_packed, 0);
+}
+
+static void
+bench_decode_packed_batch(bench_state_t *state) {
+  bench_decode(state, &packed_descriptor, encode_packed, 1);
+}
+
+static void
+bench_decode_string(bench_state_t *state) {
+  bench_decode(state, &string_descriptor, encode_string, 0);
+}
+
+/* ----------------------------------------------------------------------------
+ * Registry
+ * ------------------------------------------------------------------------- */
+
+/*! Benchmarks: core */
+const bench_t
+bench_core[] = {
+  { "encoder/rpc",          bench_encode_rpc },
+  { "encoder/nested",       bench_encode_nested },
+  { "encoder/packed",       bench_encode_packed },
+  { "encoder/string",       bench_encode_string },
+  { "decoder/rpc",          bench_decode_rpc },
+  { "decoder/nested",       bench_decode_nested },
+  { "decoder/packed",       bench_decode_packed },
+  { "decoder/packed-batch", bench_decode_packed_batch },
+  { "decoder/string",       bench_decode_string },
+  { NULL }
+};
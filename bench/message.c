@@ -0,0 +1,227 @@
+/*
+ * Copyright (c) 2013-2020 Martin Donath <martin.donath@squidfunk.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <protobluff.h>
+#include <protobluff/descriptor.h>
+
+#include "bench/bench.h"
+
+/* ----------------------------------------------------------------------------
+ * Constants
+ * ------------------------------------------------------------------------- */
+
+/*! Number of fields put per iteration */
+#define BENCH_PUT_SIZE 64
+
+/*! Number of records of the archive scanned per iteration */
+#define BENCH_SCAN_SIZE 32768
+
+/*! Size of the payload of every record of the archive */
+#define BENCH_SCAN_PAYLOAD 1024
+
+/* ----------------------------------------------------------------------------
+ * Descriptors
+ * ------------------------------------------------------------------------- */
+
+/* Descriptor of records */
+static pb_descriptor_t
+record_descriptor = { {
+  (const pb_field_descriptor_t []){
+    {  1, "id",       UINT32, OPTIONAL },
+    {  2, "name",     STRING, OPTIONAL }
+  }, 2 } };
+
+/* Descriptor of record pairs */
+static pb_descriptor_t
+pair_descriptor = { {
+  (const pb_field_descriptor_t []){
+    {  1, "first",    MESSAGE, OPTIONAL, &record_descriptor },
+    {  2, "second",   MESSAGE, OPTIONAL, &record_descriptor }
+  }, 2 } };
+
+/* Descriptor of record archives */
+static pb_descriptor_t
+archive_descriptor = { {
+  (const pb_field_descriptor_t []){
+    {  1, "records",  MESSAGE, REPEATED, &record_descriptor }
+  }, 1 } };
+
+/* ----------------------------------------------------------------------------
+ * Benchmarks
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Benchmark putting fields of alternating size into a message.
+ *
+ * \param[in,out] state State
+ */
+static void
+bench_message_put(bench_state_t *state) {
+  static char name[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ";
+  state->bytes = 0;
+
+  /* Put fields, growing and shrinking the message in place */
+  bench_start(state);
+  for (size_t i = 0; i < state->iterations; i++) {
+    uint64_t seed = 1;
+    pb_journal_t journal =
+      pb_journal_create_empty_with_allocator(state->allocator);
+    pb_message_t message = pb_message_create(&record_descriptor, &journal);
+    for (size_t p = 0; p < BENCH_PUT_SIZE; p++) {
+      uint32_t    id    = bench_random(&seed);
+      pb_string_t value = pb_string_init((uint8_t *)name,
+        bench_random(&seed) % (sizeof(name) - 1));
+      bench_assert(!pb_message_put(&message, 1, &id));
+      bench_assert(!pb_message_put(&message, 2, &value));
+    }
+    pb_message_destroy(&message);
+    pb_journal_destroy(&journal);
+  }
+  bench_stop(state);
+}
+
+/*!
+ * Benchmark reading fields from an encoded message.
+ *
+ * \param[in,out] state State
+ */
+static void
+bench_message_get(bench_state_t *state) {
+  pb_encoder_t encoder = pb_encoder_create(&record_descriptor);
+  uint32_t    id    = 127;
+  pb_string_t value = pb_string_init_from_chars("record");
+  bench_assert(!pb_encoder_encode(&encoder, 1, &id, 1));
+  bench_assert(!pb_encoder_encode(&encoder, 2, &value, 1));
+  const pb_buffer_t *buffer = pb_encoder_buffer(&encoder);
+  state->bytes = pb_buffer_size(buffer);
+
+  /* Read fields, indexing the message on every iteration */
+  bench_start(state);
+  for (size_t i = 0; i < state->iterations; i++) {
+    pb_journal_t journal = pb_journal_create_readonly(
+      pb_buffer_data(buffer), pb_buffer_size(buffer));
+    pb_message_t message = pb_message_create(&record_descriptor, &journal);
+    bench_assert(!pb_message_get(&message, 1, &id));
+    bench_assert(!pb_message_get(&message, 2, &value));
+    pb_message_destroy(&message);
+    pb_journal_destroy(&journal);
+  }
+  bench_stop(state);
+  pb_encoder_destroy(&encoder);
+}
+
+/*!
+ * Benchmark aligning a message after a sibling was altered.
+ *
+ * \param[in,out] state State
+ */
+static void
+bench_journal_align(bench_state_t *state) {
+  static char name[] = "abcdefghijklmnopqrstuvwxyz";
+  pb_journal_t journal =
+    pb_journal_create_empty_with_allocator(state->allocator);
+  pb_message_t message = pb_message_create(&pair_descriptor, &journal);
+  pb_message_t first   = pb_message_create_within(&message, 1);
+  pb_message_t second  = pb_message_create_within(&message, 2);
+  uint32_t id = 127;
+  bench_assert(!pb_message_put(&second, 1, &id));
+  state->bytes = 0;
+
+  /* Alter first message, forcing the second to align on every read */
+  bench_start(state);
+  for (size_t i = 0; i < state->iterations; i++) {
+    pb_string_t value = pb_string_init((uint8_t *)name,
+      i % (sizeof(name) - 1));
+    bench_assert(!pb_message_put(&first, 2, &value));
+    bench_assert(!pb_message_get(&second, 1, &id));
+  }
+  bench_stop(state);
+  pb_message_destroy(&second);
+  pb_message_destroy(&first);
+  pb_message_destroy(&message);
+  pb_journal_destroy(&journal);
+}
+
+/*!
+ * Benchmark scanning the records of an archive much larger than the cache.
+ *
+ * Every record carries a large payload, so moving the cursor to the next
+ * record jumps ahead into cold memory, which is the case for prefetching.
+ *
+ * \param[in,out] state State
+ */
+static void
+bench_cursor_scan(bench_state_t *state) {
+  static uint8_t payload[BENCH_SCAN_PAYLOAD];
+  pb_encoder_t encoder = pb_encoder_create(&archive_descriptor);
+  for (size_t r = 0; r < BENCH_SCAN_SIZE; r++) {
+    pb_encoder_frame_t frame;
+    uint32_t    id    = r;
+    pb_string_t value = pb_string_init(payload, sizeof(payload));
+    bench_assert(!pb_encoder_begin_nested(&encoder, 1, &frame));
+    bench_assert(!pb_encoder_encode(&encoder, 1, &id, 1));
+    bench_assert(!pb_encoder_encode(&encoder, 2, &value, 1));
+    pb_encoder_end_nested(&encoder);
+  }
+  const pb_buffer_t *buffer = pb_encoder_buffer(&encoder);
+  state->bytes = pb_buffer_size(buffer);
+
+  /* Read the identifier of every record */
+  uint64_t sum = 0;
+  bench_start(state);
+  for (size_t i = 0; i < state->iterations; i++) {
+    pb_journal_t journal = pb_journal_create_readonly(
+      pb_buffer_data(buffer), pb_buffer_size(buffer));
+    pb_message_t message = pb_message_create(&archive_descriptor, &journal);
+    pb_cursor_t  cursor  = pb_cursor_create(&message, 1);
+    do {
+      pb_message_t record = pb_message_create_from_cursor(&cursor);
+      uint32_t id;
+      bench_assert(!pb_message_get(&record, 1, &id));
+      sum += id;
+      pb_message_destroy(&record);
+    } while (pb_cursor_next(&cursor));
+    pb_cursor_destroy(&cursor);
+    pb_message_destroy(&message);
+    pb_journal_destroy(&journal);
+  }
+  bench_stop(state);
+  bench_assert(sum);
+  pb_encoder_destroy(&encoder);
+}
+
+/* ----------------------------------------------------------------------------
+ * Registry
+ * ------------------------------------------------------------------------- */
+
+/*! Benchmarks: message */
+const bench_t
+bench_message[] = {
+  { "message/put",          bench_message_put },
+  { "message/get",          bench_message_get },
+  { "journal/align",        bench_journal_align },
+  { "cursor/scan",          bench_cursor_scan },
+  { NULL }
+};
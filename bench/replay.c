@@ -0,0 +1,429 @@
+/*
+ * Copyright (c) 2013-2020 Martin Donath <martin.donath@squidfunk.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <protobluff.h>
+
+#include "bench/bench.h"
+#include "message/cursor.h"
+#include "message/journal.h"
+#include "message/message.h"
+
+/* ----------------------------------------------------------------------------
+ * Type definitions
+ * ------------------------------------------------------------------------- */
+
+typedef struct replay_report_t {
+  pb_stats_histogram_t latency;        /*!< Latencies in nanoseconds */
+  uint64_t max;                        /*!< Maximum latency */
+  pb_stats_t stats;                    /*!< Accumulated counters */
+} replay_report_t;
+
+typedef struct replay_t {
+  const pb_descriptor_t *descriptor;   /*!< Descriptor of root message */
+  pb_journal_t journal;                /*!< Journal */
+  size_t operation;                    /*!< Current operation */
+  replay_report_t report[PB_TRACE_OPERATIONS];
+} replay_t;
+
+/* ----------------------------------------------------------------------------
+ * Mappings
+ * ------------------------------------------------------------------------- */
+
+/*! Mapping: operation ==> name */
+static const char *
+operation_name[PB_TRACE_OPERATIONS] = {
+  [PB_TRACE_SNAPSHOT]       = "snapshot",
+  [PB_TRACE_MESSAGE_CREATE] = "message/create",
+  [PB_TRACE_MESSAGE_PUT]    = "message/put",
+  [PB_TRACE_MESSAGE_ERASE]  = "message/erase",
+  [PB_TRACE_MESSAGE_CLEAR]  = "message/clear",
+  [PB_TRACE_CURSOR_PUT]     = "cursor/put",
+  [PB_TRACE_CURSOR_ERASE]   = "cursor/erase"
+};
+
+/* ----------------------------------------------------------------------------
+ * Internal functions
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Resolve the message starting at the given offset within a message.
+ *
+ * Messages are identified by their start offset in a trace, which is unique,
+ * as every submessage starts after its own tag and length prefix. Only the
+ * submessages containing the offset are descended into.
+ *
+ * \param[in,out] message Message
+ * \param[in]     offset  Start offset
+ * \return                Message
+ */
+static pb_message_t
+resolve(pb_message_t *message, size_t offset) {
+  if (!pb_message_valid(message) || pb_message_align(message))
+    return pb_message_create_invalid();
+  if (pb_message_start(message) == offset)
+    return pb_message_copy(message);
+
+  /* Descend into the submessage containing the offset */
+  pb_message_t result = pb_message_create_invalid();
+  pb_descriptor_iter_t it =
+    pb_descriptor_iter_create(pb_message_descriptor(message));
+  if (pb_descriptor_iter_begin(&it)) {
+    do {
+      const pb_field_descriptor_t *descriptor =
+        pb_descriptor_iter_current(&it);
+      if (pb_field_descriptor_type(descriptor) != PB_TYPE_MESSAGE)
+        continue;
+
+      /* Check all occurrences of the submessage */
+      pb_cursor_t cursor = pb_cursor_create_unsafe(message,
+        pb_field_descriptor_tag(descriptor));
+      if (pb_cursor_valid(&cursor)) {
+        do {
+          const pb_offset_t *current = pb_cursor_offset(&cursor);
+          if (current->start <= offset && offset <= current->end) {
+            pb_message_t submessage = pb_message_create_from_cursor(&cursor);
+            result = resolve(&submessage, offset);
+            pb_message_destroy(&submessage);
+          }
+        } while (!pb_message_valid(&result) && pb_cursor_next(&cursor));
+      }
+      pb_cursor_destroy(&cursor);
+    } while (!pb_message_valid(&result) && pb_descriptor_iter_next(&it));
+  }
+  pb_descriptor_iter_destroy(&it);
+  return result;
+}
+
+/*!
+ * Create a cursor positioned on the field starting at the given offset.
+ *
+ * \param[in,out] message Message
+ * \param[in]     tag     Tag
+ * \param[in]     offset  Start offset of field
+ * \return                Cursor
+ */
+static pb_cursor_t
+seek(pb_message_t *message, pb_tag_t tag, size_t offset) {
+  pb_cursor_t cursor = pb_cursor_create_unsafe(message, tag);
+  if (pb_cursor_valid(&cursor)) {
+    do {
+      if (pb_cursor_offset(&cursor)->start == offset)
+        return cursor;
+    } while (pb_cursor_next(&cursor));
+  }
+  pb_cursor_destroy(&cursor);
+  return pb_cursor_create_invalid();
+}
+
+/*!
+ * Restore the contents of a journal from a snapshot.
+ *
+ * Padded journals can only be created empty, so a non-empty snapshot of a
+ * padded journal is restored into a regular journal.
+ *
+ * \param[in,out] replay Replay
+ * \param[in]     record Record
+ */
+static void
+restore(replay_t *replay, const pb_trace_record_t *record) {
+  pb_journal_destroy(&(replay->journal));
+  if (record->field & PB_TRACE_GAP_BUFFER) {
+    replay->journal = pb_journal_create_gap_buffer(
+      record->value.data, record->value.size);
+  } else if (!record->value.size) {
+    replay->journal = record->field & PB_TRACE_PADDED
+      ? pb_journal_create_padded()
+      : pb_journal_create_empty();
+  } else {
+    replay->journal = pb_journal_create(
+      record->value.data, record->value.size);
+  }
+  pb_journal_set_unordered(&(replay->journal),
+    !!(record->field & PB_TRACE_UNORDERED));
+}
+
+/*!
+ * Execute a recorded operation and account its latency and counters.
+ *
+ * Resolving the message and positioning the cursor is not accounted, as the
+ * application already holds both when executing the operation. If the part
+ * of the message was outdated when the operation was recorded, it is restored
+ * to the recorded version and offsets, so the operation replays the same
+ * journal entries for alignment.
+ *
+ * \param[in,out] replay Replay
+ * \param[in]     record Record
+ * \return                Error code
+ */
+static pb_error_t
+execute(replay_t *replay, const pb_trace_record_t *record) {
+  if (record->operation == PB_TRACE_SNAPSHOT) {
+    restore(replay, record);
+    return pb_journal_valid(&(replay->journal))
+      ? PB_ERROR_NONE
+      : PB_ERROR_ALLOC;
+  }
+  if (pb_journal_version(&(replay->journal)) != record->version ||
+      pb_journal_size(&(replay->journal)) != record->size.before)
+    return PB_ERROR_INVALID;
+
+  /* Resolve message and field of operation */
+  pb_message_t root = pb_message_create(replay->descriptor,
+    &(replay->journal));
+  pb_message_t message = resolve(&root, record->message);
+  pb_message_destroy(&root);
+  if (!pb_message_valid(&message))
+    return PB_ERROR_INVALID;
+  const pb_field_descriptor_t *descriptor = record->tag
+    ? pb_descriptor_field_by_tag(pb_message_descriptor(&message), record->tag)
+    : NULL;
+  if ((record->tag && !descriptor) ||
+      (record->operation == PB_TRACE_MESSAGE_CREATE &&
+       pb_field_descriptor_type(descriptor) != PB_TYPE_MESSAGE)) {
+    pb_message_destroy(&message);
+    return PB_ERROR_INVALID;
+  }
+
+  /* Position cursor on field of operation */
+  pb_cursor_t cursor = pb_cursor_create_invalid();
+  if (record->operation == PB_TRACE_CURSOR_PUT ||
+      record->operation == PB_TRACE_CURSOR_ERASE)
+    cursor = seek(&message, record->tag, record->field);
+
+  /* Restore outdated part of message, so the alignment is reproduced */
+  if (record->part.version != record->version) {
+    message.part.version = record->part.version;
+    message.part.offset  = record->part.offset;
+  }
+
+  /* Restore value of operation */
+  uint64_t     number[2]  = {};
+  pb_string_t  string     = pb_string_init_from_chars("");
+  pb_journal_t journal    = pb_journal_create_empty();
+  pb_message_t submessage = pb_message_create_invalid();
+  const void  *value      = NULL;
+  if (record->operation == PB_TRACE_MESSAGE_PUT ||
+      record->operation == PB_TRACE_CURSOR_PUT) {
+    switch (pb_field_descriptor_type(descriptor)) {
+      case PB_TYPE_MESSAGE:
+        if (record->value.size) {
+          pb_journal_destroy(&journal);
+          journal = pb_journal_create(record->value.data, record->value.size);
+        }
+        submessage = pb_message_create(
+          pb_field_descriptor_nested(descriptor), &journal);
+        value = &submessage;
+        break;
+      case PB_TYPE_STRING:
+      case PB_TYPE_BYTES:
+        string = pb_string_init((uint8_t *)record->value.data,
+          record->value.size);
+        value  = &string;
+        break;
+      default:
+        if (record->value.size <= sizeof(number)) {
+          memcpy(number, record->value.data, record->value.size);
+          value = number;
+        }
+        break;
+    }
+  }
+
+  /* Execute operation */
+  pb_stats_t stats = *pb_stats_local();
+  pb_error_t error = PB_ERROR_INVALID;
+  uint64_t   start = bench_now();
+  switch (record->operation) {
+    case PB_TRACE_MESSAGE_CREATE: {
+      pb_message_t created = pb_message_create_within(&message, record->tag);
+      error = pb_message_error(&created);
+      pb_message_destroy(&created);
+      break;
+    }
+    case PB_TRACE_MESSAGE_PUT:
+      if (value)
+        error = pb_message_put(&message, record->tag, value);
+      break;
+    case PB_TRACE_MESSAGE_ERASE:
+      error = pb_message_erase(&message, record->tag);
+      break;
+    case PB_TRACE_MESSAGE_CLEAR:
+      error = pb_message_clear(&message);
+      break;
+    case PB_TRACE_CURSOR_PUT:
+      if (value)
+        error = pb_cursor_put(&cursor, value);
+      break;
+    case PB_TRACE_CURSOR_ERASE:
+      error = pb_cursor_erase(&cursor);
+      break;
+    default:
+      break;
+  }
+  uint64_t elapsed = bench_now() - start;
+
+  /* Account latency and counters */
+  replay_report_t *report = &(replay->report[record->operation]);
+  report->latency.count++;
+  report->latency.sum += elapsed;
+  report->latency.bucket[pb_stats_bucket(elapsed)]++;
+  if (report->max < elapsed)
+    report->max = elapsed;
+  report->stats.adjustments += pb_stats_local()->adjustments -
+    stats.adjustments;
+  report->stats.moved       += pb_stats_local()->moved - stats.moved;
+  report->stats.replayed    += pb_stats_local()->replayed - stats.replayed;
+  report->stats.resizes     += pb_stats_local()->resizes - stats.resizes;
+
+  /* Free all allocated memory */
+  pb_message_destroy(&submessage);
+  pb_journal_destroy(&journal);
+  pb_cursor_destroy(&cursor);
+  pb_message_destroy(&message);
+
+  /* Ensure the replay didn't diverge from the trace */
+  return error == record->error &&
+         pb_journal_size(&(replay->journal)) == record->size.after
+    ? PB_ERROR_NONE
+    : PB_ERROR_INVALID;
+}
+
+/*!
+ * Print the report of all replayed operations.
+ *
+ * \param[in] replay     Replay
+ * \param[in] iterations Iterations
+ */
+static void
+report(const replay_t *replay, size_t iterations) {
+  printf("%-16s %10s %10s %10s %10s %10s %12s %10s %10s\n",
+    "operation", "count", "mean", "p50", "p99", "max",
+    "moved", "replays", "adjusts");
+
+  /* Report latencies and counters per operation */
+  pb_stats_t total = {};
+  for (size_t o = 1; o < PB_TRACE_OPERATIONS; o++) {
+    const replay_report_t *report = &(replay->report[o]);
+    if (!report->latency.count)
+      continue;
+    double count = (double)report->latency.count;
+    printf("%-16s %10zu %7.1f ns %7zu ns %7zu ns %7zu ns %10.1f B "
+      "%10.2f %10.2f\n", operation_name[o],
+        (size_t)(report->latency.count / iterations),
+        report->latency.sum / count,
+        (size_t)pb_stats_percentile(&(report->latency), 50),
+        (size_t)pb_stats_percentile(&(report->latency), 99),
+        (size_t)report->max,
+        report->stats.moved / count,
+        report->stats.replayed / count,
+        report->stats.adjustments / count);
+    total.moved       += report->stats.moved;
+    total.replayed    += report->stats.replayed;
+    total.adjustments += report->stats.adjustments;
+  }
+
+  /* Counters are only maintained if statistics are enabled */
+  if (!total.moved && !total.replayed && !total.adjustments)
+    printf("\nMoved bytes, replays and adjustments are only counted "
+      "with --enable-stats\n");
+}
+
+/* ----------------------------------------------------------------------------
+ * Program
+ * ------------------------------------------------------------------------- */
+
+/*
+ * Replay a trace of operations recorded on a journal, and report latency,
+ * bytes moved, journal entries replayed for alignment and recursive length
+ * prefix adjustments per operation. The descriptor of the root message is
+ * looked up by its full name in a serialized FileDescriptorSet, as generated
+ * with protoc --descriptor_set_out.
+ */
+int
+main(int argc, char *argv[]) {
+  size_t iterations = 1;
+  int    a          = 1;
+  if (argc > 2 && !strcmp(argv[a], "-n")) {
+    iterations = strtoul(argv[a + 1], NULL, 10);
+    a += 2;
+  }
+  if (argc - a != 3 || !iterations) {
+    fprintf(stderr, "usage: %s [-n iterations] "
+      "<descriptor set> <message> <trace>\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  /* Map descriptor set and trace into memory */
+  pb_buffer_t set_buffer   = pb_buffer_create_mmap(argv[a], 0);
+  pb_buffer_t trace_buffer =
+    pb_buffer_create_mmap(argv[a + 2], PB_MMAP_SEQUENTIAL);
+  bench_assert(pb_buffer_valid(&set_buffer));
+  bench_assert(pb_buffer_valid(&trace_buffer));
+
+  /* Look up descriptor of root message */
+  pb_descriptor_set_t set = pb_descriptor_set_create(&set_buffer);
+  bench_assert(pb_descriptor_set_valid(&set));
+  replay_t replay = {
+    .descriptor = pb_descriptor_set_message(&set, argv[a + 1]),
+    .journal    = pb_journal_create_empty()
+  };
+  bench_assert(replay.descriptor);
+
+  /* Replay trace for the given number of iterations */
+  const uint8_t *data = pb_buffer_data(&trace_buffer);
+  size_t         size = pb_buffer_size(&trace_buffer);
+  int result = EXIT_SUCCESS;
+  for (size_t i = 0; i < iterations && result == EXIT_SUCCESS; i++) {
+    pb_trace_record_t record;
+    pb_error_t error;
+    size_t offset = 0;
+    replay.operation = 0;
+    while (!(error = pb_trace_read(data, size, &offset, &record))) {
+      if (execute(&replay, &record)) {
+        fprintf(stderr, "%s: diverged at operation %zu (%s)\n",
+          argv[0], replay.operation, operation_name[record.operation]);
+        result = EXIT_FAILURE;
+        break;
+      }
+      replay.operation++;
+    }
+    if (error && error != PB_ERROR_EOM) {
+      fprintf(stderr, "%s: malformed trace at offset %zu\n",
+        argv[0], offset);
+      result = EXIT_FAILURE;
+    }
+  }
+  if (result == EXIT_SUCCESS)
+    report(&replay, iterations);
+
+  /* Free all allocated memory */
+  pb_journal_destroy(&(replay.journal));
+  pb_descriptor_set_destroy(&set);
+  pb_buffer_destroy(&trace_buffer);
+  pb_buffer_destroy(&set_buffer);
+  return result;
+}
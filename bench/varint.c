@@ -0,0 +1,351 @@
+/*
+ * Copyright (c) 2013-2020 Martin Donath <martin.donath@squidfunk.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include <protobluff.h>
+
+#include "bench/bench.h"
+#include "core/varint.h"
+
+/* ----------------------------------------------------------------------------
+ * Constants
+ * ------------------------------------------------------------------------- */
+
+/*! Number of values per corpus */
+#define BENCH_VARINT_SIZE 4096
+
+/*! Padding after encoded values, as the scanner may load 16 bytes at once */
+#define BENCH_VARINT_PADDING 16
+
+/* ----------------------------------------------------------------------------
+ * Type definitions
+ * ------------------------------------------------------------------------- */
+
+typedef struct bench_varint_type_t {
+  const char *name;                    /*!< Name */
+  pb_type_t type;                      /*!< Type */
+  size_t size;                         /*!< Size of native values */
+  pb_varint_size_f measure;            /*!< Size function */
+  pb_varint_pack_f pack;               /*!< Pack function */
+  pb_varint_unpack_f unpack;           /*!< Unpack function */
+} bench_varint_type_t;
+
+typedef struct bench_varint_distribution_t {
+  const char *name;                    /*!< Name */
+  const unsigned weights[10];          /*!< Weights of lengths 1 to 10 */
+} bench_varint_distribution_t;
+
+typedef struct bench_varint_corpus_t {
+  const bench_varint_type_t *type;     /*!< Type */
+  uint8_t values[                      /*!< Native values */
+    BENCH_VARINT_SIZE * sizeof(uint64_t)];
+  uint8_t data[                        /*!< Encoded values */
+    BENCH_VARINT_SIZE * 10 + BENCH_VARINT_PADDING];
+  size_t size;                         /*!< Encoded size */
+} bench_varint_corpus_t;
+
+/* ----------------------------------------------------------------------------
+ * Types and distributions
+ * ------------------------------------------------------------------------- */
+
+/*! Varint types */
+static const bench_varint_type_t
+types[] = {
+  { "bool",   PB_TYPE_BOOL,   sizeof(uint8_t),
+    pb_varint_size_uint8,  pb_varint_pack_uint8,  pb_varint_unpack_uint8 },
+  { "int32",  PB_TYPE_INT32,  sizeof(int32_t),
+    pb_varint_size_int32,  pb_varint_pack_int32,  pb_varint_unpack_int32 },
+  { "uint32", PB_TYPE_UINT32, sizeof(uint32_t),
+    pb_varint_size_uint32, pb_varint_pack_uint32, pb_varint_unpack_uint32 },
+  { "uint64", PB_TYPE_UINT64, sizeof(uint64_t),
+    pb_varint_size_uint64, pb_varint_pack_uint64, pb_varint_unpack_uint64 },
+  { "sint64", PB_TYPE_SINT64, sizeof(int64_t),
+    pb_varint_size_sint64, pb_varint_pack_sint64, pb_varint_unpack_sint64 }
+};
+
+/*!
+ * Value-length distributions.
+ *
+ * The skewed distribution halves the probability with every additional byte,
+ * which approximates field values seen in practice, where most integers are
+ * small counts, identifiers or enum values, and only few need more bytes.
+ */
+static const bench_varint_distribution_t
+distributions[] = {
+  { "short",   { 1 } },
+  { "uniform", { 1, 1, 1, 1, 1, 1, 1, 1, 1, 1 } },
+  { "skewed",  { 512, 256, 128, 64, 32, 16, 8, 4, 2, 2 } }
+};
+
+/*! Type count */
+#define TYPES (sizeof(types) / sizeof(*types))
+
+/*! Distribution count */
+#define DISTRIBUTIONS (sizeof(distributions) / sizeof(*distributions))
+
+/* ----------------------------------------------------------------------------
+ * Corpora
+ * ------------------------------------------------------------------------- */
+
+/*! Corpora by type and distribution */
+static bench_varint_corpus_t
+corpora[TYPES][DISTRIBUTIONS];
+
+/*!
+ * Draw a value length from a distribution.
+ *
+ * \param[in]     distribution Distribution
+ * \param[in,out] seed         Seed
+ * \return                     Value length
+ */
+static size_t
+draw(const bench_varint_distribution_t *distribution, uint64_t *seed) {
+  unsigned total = 0;
+  for (size_t l = 0; l < 10; l++)
+    total += distribution->weights[l];
+  unsigned point = bench_random(seed) % total;
+  for (size_t l = 0; l < 10; l++) {
+    if (point < distribution->weights[l])
+      return l + 1;
+    point -= distribution->weights[l];
+  }
+  return 10;
+}
+
+/*!
+ * Generate a wire value which is encoded with exactly the given length.
+ *
+ * \param[in]     length Value length
+ * \param[in,out] seed   Seed
+ * \return               Wire value
+ */
+static uint64_t
+generate(size_t length, uint64_t *seed) {
+  uint64_t value = (uint64_t)bench_random(seed) << 32 | bench_random(seed);
+  if (length == 1)
+    return value & 0x7F;
+  uint64_t lower = 1ULL << (7 * (length - 1));
+  return length < 10
+    ? lower | (value & ((1ULL << (7 * length)) - 1))
+    : lower | value;
+}
+
+/*!
+ * Create the native values of a corpus, clamping the value length where a
+ * type is not able to represent it.
+ *
+ * Values of type int32 that would need more than 5 bytes are substituted by
+ * negative values, which are always sign-extended to 10 bytes on the wire.
+ *
+ * \param[out]    corpus       Corpus
+ * \param[in]     distribution Distribution
+ * \param[in,out] seed         Seed
+ */
+static void
+create(
+    bench_varint_corpus_t *corpus,
+    const bench_varint_distribution_t *distribution, uint64_t *seed) {
+  for (size_t v = 0; v < BENCH_VARINT_SIZE; v++) {
+    size_t length = draw(distribution, seed);
+    void *value = &(corpus->values[v * corpus->type->size]);
+    switch (corpus->type->type) {
+      case PB_TYPE_BOOL:
+        *(uint8_t *)value = bench_random(seed) & 1;
+        break;
+      case PB_TYPE_INT32:
+        *(int32_t *)value = length <= 5
+          ? (int32_t)(generate(length, seed) & 0x7FFFFFFF)
+          : -(int32_t)(bench_random(seed) & 0x7FFFFFFF) - 1;
+        break;
+      case PB_TYPE_UINT32:
+        *(uint32_t *)value = (uint32_t)generate(length > 5 ? 5 : length, seed);
+        break;
+      case PB_TYPE_UINT64:
+        *(uint64_t *)value = generate(length, seed);
+        break;
+      case PB_TYPE_SINT64: {
+        uint64_t wire = generate(length, seed);
+        *(int64_t *)value = (int64_t)(wire >> 1) ^ -(int64_t)(wire & 1);
+        break;
+      }
+      default:
+        break;
+    }
+  }
+
+  /* Encode values */
+  corpus->size = 0;
+  for (size_t v = 0; v < BENCH_VARINT_SIZE; v++)
+    corpus->size += corpus->type->pack(&(corpus->data[corpus->size]),
+      &(corpus->values[v * corpus->type->size]));
+}
+
+/* ----------------------------------------------------------------------------
+ * Benchmarks
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Benchmark computing the encoded size of all values of a corpus.
+ *
+ * \param[in,out] state State
+ */
+static void
+bench_varint_size(bench_state_t *state) {
+  const bench_varint_corpus_t *corpus = state->user;
+  const bench_varint_type_t *type = corpus->type;
+  state->bytes = corpus->size;
+
+  /* Sum up sizes */
+  size_t size = 0;
+  bench_start(state);
+  for (size_t i = 0; i < state->iterations; i++)
+    for (size_t v = 0; v < BENCH_VARINT_SIZE; v++)
+      size += type->measure(&(corpus->values[v * type->size]));
+  bench_stop(state);
+  bench_assert(size == corpus->size * state->iterations);
+}
+
+/*!
+ * Benchmark packing all values of a corpus.
+ *
+ * \param[in,out] state State
+ */
+static void
+bench_varint_pack(bench_state_t *state) {
+  const bench_varint_corpus_t *corpus = state->user;
+  const bench_varint_type_t *type = corpus->type;
+  static uint8_t data[BENCH_VARINT_SIZE * 10];
+  state->bytes = corpus->size;
+
+  /* Pack values */
+  bench_start(state);
+  for (size_t i = 0; i < state->iterations; i++) {
+    size_t offset = 0;
+    for (size_t v = 0; v < BENCH_VARINT_SIZE; v++)
+      offset += type->pack(&(data[offset]),
+        &(corpus->values[v * type->size]));
+    bench_assert(offset == corpus->size);
+  }
+  bench_stop(state);
+}
+
+/*!
+ * Benchmark unpacking all values of a corpus.
+ *
+ * \param[in,out] state State
+ */
+static void
+bench_varint_unpack(bench_state_t *state) {
+  const bench_varint_corpus_t *corpus = state->user;
+  const bench_varint_type_t *type = corpus->type;
+  uint64_t value;
+  state->bytes = corpus->size;
+
+  /* Unpack values */
+  bench_start(state);
+  for (size_t i = 0; i < state->iterations; i++) {
+    size_t offset = 0;
+    for (size_t v = 0; v < BENCH_VARINT_SIZE; v++)
+      offset += type->unpack(&(corpus->data[offset]),
+        corpus->size - offset, &value);
+    bench_assert(offset == corpus->size);
+  }
+  bench_stop(state);
+}
+
+/*!
+ * Benchmark scanning over all values of a corpus.
+ *
+ * \param[in,out] state State
+ */
+static void
+bench_varint_scan(bench_state_t *state) {
+  const bench_varint_corpus_t *corpus = state->user;
+  state->bytes = corpus->size;
+
+  /* Scan values */
+  bench_start(state);
+  for (size_t i = 0; i < state->iterations; i++) {
+    size_t offset = 0;
+    for (size_t v = 0; v < BENCH_VARINT_SIZE; v++)
+      offset += pb_varint_scan(&(corpus->data[offset]),
+        corpus->size - offset);
+    bench_assert(offset == corpus->size);
+  }
+  bench_stop(state);
+}
+
+/* ----------------------------------------------------------------------------
+ * Program
+ * ------------------------------------------------------------------------- */
+
+/*! Operations */
+static const bench_t
+operations[] = {
+  { "size",   bench_varint_size },
+  { "pack",   bench_varint_pack },
+  { "unpack", bench_varint_unpack },
+  { "scan",   bench_varint_scan }
+};
+
+/*! Operation count */
+#define OPERATIONS (sizeof(operations) / sizeof(*operations))
+
+/*
+ * Run all varint benchmarks matching the given arguments, for every
+ * combination of operation, type and value-length distribution.
+ */
+int
+main(int argc, char *argv[]) {
+  static char names[OPERATIONS][TYPES][DISTRIBUTIONS][32];
+  static bench_t benchmarks[OPERATIONS * TYPES * DISTRIBUTIONS + 1];
+
+  /* Create corpora from fixed seeds */
+  uint64_t seed = 1;
+  for (size_t t = 0; t < TYPES; t++) {
+    for (size_t d = 0; d < DISTRIBUTIONS; d++) {
+      corpora[t][d].type = &(types[t]);
+      create(&(corpora[t][d]), &(distributions[d]), &seed);
+    }
+  }
+
+  /* Create benchmarks, e.g. varint/unpack/int32/skewed */
+  size_t size = 0;
+  for (size_t o = 0; o < OPERATIONS; o++) {
+    for (size_t t = 0; t < TYPES; t++) {
+      for (size_t d = 0; d < DISTRIBUTIONS; d++) {
+        snprintf(names[o][t][d], sizeof(names[o][t][d]), "varint/%s/%s/%s",
+          operations[o].name, types[t].name, distributions[d].name);
+        benchmarks[size++] = (bench_t){
+          .name = names[o][t][d],
+          .run  = operations[o].run,
+          .user = &(corpora[t][d])
+        };
+      }
+    }
+  }
+  const bench_t *groups[] = { benchmarks };
+  return bench_main(argc, argv, groups, 1);
+}
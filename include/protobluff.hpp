@@ -0,0 +1,196 @@
+/*
+ * Copyright (c) 2013-2020 Martin Donath <martin.donath@squidfunk.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef PB_INCLUDE_HPP
+#define PB_INCLUDE_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+#include <protobluff.h>
+
+/* ----------------------------------------------------------------------------
+ * Type traits
+ * ------------------------------------------------------------------------- */
+
+namespace protobluff {
+
+  /*!
+   * Native value type of a field type.
+   */
+  template <pb_type_t Type>
+  struct value;
+
+  template <> struct value<PB_TYPE_INT32>    { typedef int32_t      type; };
+  template <> struct value<PB_TYPE_INT64>    { typedef int64_t      type; };
+  template <> struct value<PB_TYPE_UINT32>   { typedef uint32_t     type; };
+  template <> struct value<PB_TYPE_UINT64>   { typedef uint64_t     type; };
+  template <> struct value<PB_TYPE_SINT32>   { typedef int32_t      type; };
+  template <> struct value<PB_TYPE_SINT64>   { typedef int64_t      type; };
+  template <> struct value<PB_TYPE_FIXED32>  { typedef uint32_t     type; };
+  template <> struct value<PB_TYPE_FIXED64>  { typedef uint64_t     type; };
+  template <> struct value<PB_TYPE_SFIXED32> { typedef int32_t      type; };
+  template <> struct value<PB_TYPE_SFIXED64> { typedef int64_t      type; };
+  template <> struct value<PB_TYPE_BOOL>     { typedef uint8_t      type; };
+  template <> struct value<PB_TYPE_ENUM>     { typedef pb_enum_t    type; };
+  template <> struct value<PB_TYPE_FLOAT>    { typedef float        type; };
+  template <> struct value<PB_TYPE_DOUBLE>   { typedef double       type; };
+  template <> struct value<PB_TYPE_STRING>   { typedef pb_string_t  type; };
+  template <> struct value<PB_TYPE_BYTES>    { typedef pb_string_t  type; };
+  template <> struct value<PB_TYPE_MESSAGE>  { typedef pb_encoder_t type; };
+
+  /*!
+   * Compile-time field descriptor.
+   *
+   * Generated wrappers define one such type per field, so the tag, type, label
+   * and wiretype are known to the compiler and the value type is checked.
+   */
+  template <pb_tag_t Tag, pb_type_t Type, pb_label_t Label>
+  struct field {
+    static constexpr pb_tag_t   tag   = Tag;
+    static constexpr pb_type_t  type  = Type;
+    static constexpr pb_label_t label = Label;
+    static constexpr pb_wiretype_t wiretype =
+      Type == PB_TYPE_FIXED64 || Type == PB_TYPE_SFIXED64 ||
+      Type == PB_TYPE_DOUBLE
+        ? PB_WIRETYPE_64BIT
+        : Type == PB_TYPE_FIXED32 || Type == PB_TYPE_SFIXED32 ||
+          Type == PB_TYPE_FLOAT
+          ? PB_WIRETYPE_32BIT
+          : Type >= PB_TYPE_STRING
+            ? PB_WIRETYPE_LENGTH
+            : PB_WIRETYPE_VARINT;
+    typedef typename value<Type>::type value_type;
+  };
+
+/* ----------------------------------------------------------------------------
+ * Interface
+ * ------------------------------------------------------------------------- */
+
+  /*!
+   * Read the value of a field from a message.
+   *
+   * \param[in,out] message Message
+   * \param[out]    value   Value
+   * \return                Error code
+   */
+  template <typename Field>
+  PB_WARN_UNUSED_RESULT inline pb_error_t
+  get(pb_message_t &message, typename Field::value_type &value) {
+    static_assert(Field::type != PB_TYPE_MESSAGE,
+      "Nested messages must be accessed through nested()");
+    static_assert(Field::label != PB_LABEL_REPEATED,
+      "Repeated fields must be accessed through get_repeated()");
+    return pb_message_get(&message, Field::tag, &value);
+  }
+
+  /*!
+   * Read all values of a repeated field from a message.
+   *
+   * \param[in,out] message Message
+   * \param[out]    values  Values
+   * \param[in,out] size    Value count
+   * \return                Error code
+   */
+  template <typename Field>
+  PB_WARN_UNUSED_RESULT inline pb_error_t
+  get_repeated(
+      pb_message_t &message, typename Field::value_type values[],
+      size_t &size) {
+    static_assert(Field::type != PB_TYPE_MESSAGE,
+      "Nested messages must be accessed through nested()");
+    static_assert(Field::label == PB_LABEL_REPEATED,
+      "Non-repeated fields must be accessed through get()");
+    return pb_message_get_repeated(&message, Field::tag, values, &size);
+  }
+
+  /*!
+   * Write the value of a field to a message.
+   *
+   * \param[in,out] message Message
+   * \param[in]     value   Value
+   * \return                Error code
+   */
+  template <typename Field>
+  PB_WARN_UNUSED_RESULT inline pb_error_t
+  put(pb_message_t &message, const typename Field::value_type &value) {
+    static_assert(Field::type != PB_TYPE_MESSAGE,
+      "Nested messages must be accessed through nested()");
+    return pb_message_put(&message, Field::tag, &value);
+  }
+
+  /*!
+   * Test whether a message contains a field.
+   *
+   * \param[in,out] message Message
+   * \return                Test result
+   */
+  template <typename Field>
+  inline bool
+  has(pb_message_t &message) {
+    return pb_message_has(&message, Field::tag);
+  }
+
+  /*!
+   * Erase a field from a message.
+   *
+   * \param[in,out] message Message
+   * \return                Error code
+   */
+  template <typename Field>
+  PB_WARN_UNUSED_RESULT inline pb_error_t
+  erase(pb_message_t &message) {
+    return pb_message_erase(&message, Field::tag);
+  }
+
+  /*!
+   * Create a nested message within a message.
+   *
+   * \param[in,out] message Message
+   * \return                Nested message
+   */
+  template <typename Field>
+  PB_WARN_UNUSED_RESULT inline pb_message_t
+  nested(pb_message_t &message) {
+    static_assert(Field::type == PB_TYPE_MESSAGE,
+      "Only message fields can be nested");
+    return pb_message_create_within(&message, Field::tag);
+  }
+
+  /*!
+   * Encode one or more values of a field.
+   *
+   * \param[in,out] encoder Encoder
+   * \param[in]     values  Values
+   * \param[in]     size    Value count
+   * \return                Error code
+   */
+  template <typename Field>
+  PB_WARN_UNUSED_RESULT inline pb_error_t
+  encode(
+      pb_encoder_t &encoder, const typename Field::value_type values[],
+      size_t size = 1) {
+    return pb_encoder_encode(&encoder, Field::tag, values, size);
+  }
+}
+
+#endif /* PB_INCLUDE_HPP */
@@ -24,11 +24,23 @@
 #define PB_INCLUDE_CORE_H
 
 #include <protobluff/core/allocator.h>
+#include <protobluff/core/batch.h>
 #include <protobluff/core/buffer.h>
+#include <protobluff/core/columnar.h>
 #include <protobluff/core/common.h>
 #include <protobluff/core/decoder.h>
+#include <protobluff/core/delimited.h>
 #include <protobluff/core/descriptor.h>
 #include <protobluff/core/encoder.h>
+#include <protobluff/core/fragment.h>
+#include <protobluff/core/intern.h>
+#include <protobluff/core/layout.h>
+#include <protobluff/core/ring.h>
+#include <protobluff/core/scan.h>
+#include <protobluff/core/stats.h>
+#include <protobluff/core/stream.h>
 #include <protobluff/core/string.h>
+#include <protobluff/core/utf8.h>
+#include <protobluff/core/varint.h>
 
 #endif /* PB_INCLUDE_CORE_H */
@@ -27,6 +27,14 @@
 #include <stddef.h>
 
 #include <protobluff/core/common.h>
+#include <protobluff/core/stats.h>
+
+/* ----------------------------------------------------------------------------
+ * Constants
+ * ------------------------------------------------------------------------- */
+
+/*! Maximum number of registered trim hooks */
+#define PB_ALLOCATOR_TRIM_HOOKS 16
 
 /* ----------------------------------------------------------------------------
  * Type definitions
@@ -48,6 +56,9 @@ typedef void
   void *data,                          /*!< Internal allocator data */
   void *block);                        /*!< Memory block to be freed */
 
+typedef void
+(*pb_allocator_trim_f)(void);          /*!< Release cached memory */
+
 /* ------------------------------------------------------------------------- */
 
 typedef struct pb_allocator_t {
@@ -59,6 +70,18 @@ typedef struct pb_allocator_t {
   void *data;                          /*!< Internal allocator data */
 } pb_allocator_t;
 
+/* ----------------------------------------------------------------------------
+ * Interface
+ * ------------------------------------------------------------------------- */
+
+PB_EXPORT PB_WARN_UNUSED_RESULT
+pb_error_t
+pb_allocator_trim_register(
+  pb_allocator_trim_f hook);           /* Trim hook */
+
+PB_EXPORT void
+pb_allocator_trim(void);
+
 /* ----------------------------------------------------------------------------
  * Inline functions
  * ------------------------------------------------------------------------- */
@@ -89,6 +112,12 @@ PB_INLINE PB_WARN_UNUSED_RESULT
 void *
 pb_allocator_resize(pb_allocator_t *allocator, void *block, size_t size) {
   assert(allocator && size);
+#ifdef PB_STATS
+  pb_stats_t *stats = pb_stats_local();
+  __atomic_store_n(&(stats->resizes),
+    __atomic_load_n(&(stats->resizes), __ATOMIC_RELAXED) + 1,
+    __ATOMIC_RELAXED);
+#endif /* PB_STATS */
   return allocator->proc.resize(allocator->data, block, size);
 }
 
@@ -0,0 +1,92 @@
+/*
+ * Copyright (c) 2013-2020 Martin Donath <martin.donath@squidfunk.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef PB_INCLUDE_CORE_BATCH_H
+#define PB_INCLUDE_CORE_BATCH_H
+
+#include <stddef.h>
+
+#include <protobluff/core/buffer.h>
+#include <protobluff/core/common.h>
+#include <protobluff/core/decoder.h>
+#include <protobluff/core/descriptor.h>
+#include <protobluff/core/encoder.h>
+
+/* ----------------------------------------------------------------------------
+ * Type definitions
+ * ------------------------------------------------------------------------- */
+
+typedef pb_error_t
+(*pb_decoder_element_f)(
+  size_t index,                        /*!< Element index */
+  const pb_decoder_t *decoder,         /*!< Decoder of element */
+  void *user);                         /*!< User data */
+
+typedef pb_error_t
+(*pb_encoder_element_f)(
+  size_t index,                        /*!< Element index */
+  pb_encoder_t *encoder,               /*!< Encoder of element */
+  void *user);                         /*!< User data */
+
+/* ----------------------------------------------------------------------------
+ * Interface
+ * ------------------------------------------------------------------------- */
+
+PB_EXPORT PB_WARN_UNUSED_RESULT
+pb_error_t
+pb_decoder_decode_batch(
+  const pb_descriptor_t
+    *descriptor,                       /* Descriptor */
+  const pb_buffer_t buffers[],         /* Buffers */
+  size_t size,                         /* Buffer count */
+  pb_decoder_handler_f handler,        /* Handler */
+  void *user[],                        /* User data per thread */
+  size_t threads);                     /* Thread count */
+
+PB_EXPORT PB_WARN_UNUSED_RESULT
+pb_error_t
+pb_decoder_split(
+  const pb_decoder_t *decoder,         /* Decoder */
+  pb_tag_t tag,                        /* Tag of repeated field */
+  pb_buffer_t elements[],              /* Elements */
+  size_t *size);                       /* Element capacity, then count */
+
+PB_EXPORT PB_WARN_UNUSED_RESULT
+pb_error_t
+pb_decoder_decode_split(
+  const pb_decoder_t *decoder,         /* Decoder */
+  pb_tag_t tag,                        /* Tag of repeated field */
+  pb_decoder_element_f handler,        /* Element handler */
+  void *user[],                        /* User data per thread */
+  size_t threads);                     /* Thread count */
+
+PB_EXPORT PB_WARN_UNUSED_RESULT
+pb_error_t
+pb_encoder_encode_batch(
+  pb_encoder_t *encoder,               /* Encoder */
+  pb_tag_t tag,                        /* Tag of repeated field */
+  size_t size,                         /* Nested message count */
+  pb_encoder_element_f handler,        /* Element handler */
+  void *user[],                        /* User data per thread */
+  size_t threads);                     /* Thread count */
+
+#endif /* PB_INCLUDE_CORE_BATCH_H */
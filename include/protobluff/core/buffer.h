@@ -38,6 +38,7 @@ typedef struct pb_buffer_t {
   pb_allocator_t *allocator;           /*!< Allocator */
   uint8_t *data;                       /*!< Raw data */
   size_t size;                         /*!< Raw data size */
+  size_t capacity;                     /*!< Allocated size */
 } pb_buffer_t;
 
 /* ----------------------------------------------------------------------------
@@ -72,10 +73,27 @@ pb_buffer_create_zero_copy(
   uint8_t data[],                      /* Raw data */
   size_t size);                        /* Raw data size */
 
+PB_EXPORT PB_WARN_UNUSED_RESULT
+pb_buffer_t
+pb_buffer_create_fixed(
+  uint8_t data[],                      /* Raw data */
+  size_t capacity);                    /* Raw data capacity */
+
 PB_EXPORT void
 pb_buffer_destroy(
   pb_buffer_t *buffer);                /* Buffer */
 
+PB_EXPORT PB_WARN_UNUSED_RESULT
+pb_error_t
+pb_buffer_reserve(
+  pb_buffer_t *buffer,                 /* Buffer */
+  size_t size);                        /* Total size */
+
+PB_EXPORT PB_WARN_UNUSED_RESULT
+pb_error_t
+pb_buffer_shrink_to_fit(
+  pb_buffer_t *buffer);                /* Buffer */
+
 /* ----------------------------------------------------------------------------
  * Inline functions
  * ------------------------------------------------------------------------- */
@@ -116,6 +134,18 @@ pb_buffer_size(const pb_buffer_t *buffer) {
   return buffer->size;
 }
 
+/*!
+ * Retrieve the capacity of a buffer.
+ *
+ * \param[in] buffer Buffer
+ * \return           Allocated size
+ */
+PB_INLINE size_t
+pb_buffer_capacity(const pb_buffer_t *buffer) {
+  assert(buffer);
+  return buffer->capacity;
+}
+
 /*!
  * Test whether a buffer is empty.
  *
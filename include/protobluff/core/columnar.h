@@ -0,0 +1,202 @@
+/*
+ * Copyright (c) 2013-2020 Martin Donath <martin.donath@squidfunk.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef PB_INCLUDE_CORE_COLUMNAR_H
+#define PB_INCLUDE_CORE_COLUMNAR_H
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <protobluff/core/buffer.h>
+#include <protobluff/core/common.h>
+#include <protobluff/core/descriptor.h>
+
+/* ----------------------------------------------------------------------------
+ * Type definitions
+ * ------------------------------------------------------------------------- */
+
+typedef struct pb_column_t {
+  const pb_field_descriptor_t
+    *descriptor;                       /*!< Field descriptor */
+  pb_buffer_t values;                  /*!< Values or string data */
+  pb_buffer_t offsets;                 /*!< String offsets */
+  pb_buffer_t presence;                /*!< Presence bitmap */
+} pb_column_t;
+
+typedef struct pb_columnar_t {
+  const pb_descriptor_t *descriptor;   /*!< Descriptor */
+  struct {
+    pb_column_t *data;                 /*!< Columns */
+    size_t size;                       /*!< Column count */
+  } column;
+  struct {
+    uint8_t *data;                     /*!< Bitset of projected tags */
+    size_t size;                       /*!< Bitset size */
+  } mask;
+  size_t size;                         /*!< Row count */
+} pb_columnar_t;
+
+/* ----------------------------------------------------------------------------
+ * Interface
+ * ------------------------------------------------------------------------- */
+
+PB_EXPORT PB_WARN_UNUSED_RESULT
+pb_columnar_t
+pb_columnar_create(
+  const pb_descriptor_t *descriptor,   /* Descriptor */
+  const pb_tag_t tags[],               /* Projected tags */
+  size_t size);                        /* Projected tag count */
+
+PB_EXPORT void
+pb_columnar_destroy(
+  pb_columnar_t *columnar);            /* Columnar decoder */
+
+PB_EXPORT PB_WARN_UNUSED_RESULT
+pb_error_t
+pb_columnar_decode(
+  pb_columnar_t *columnar,             /* Columnar decoder */
+  const pb_buffer_t buffers[],         /* Buffers */
+  size_t size);                        /* Buffer count */
+
+PB_EXPORT void
+pb_columnar_clear(
+  pb_columnar_t *columnar);            /* Columnar decoder */
+
+/* ----------------------------------------------------------------------------
+ * Inline functions
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Retrieve the internal error state of a columnar decoder.
+ *
+ * \param[in] columnar Columnar decoder
+ * \return             Error code
+ */
+PB_INLINE pb_error_t
+pb_columnar_error(const pb_columnar_t *columnar) {
+  assert(columnar);
+  return columnar->column.data
+    ? PB_ERROR_NONE
+    : PB_ERROR_INVALID;
+}
+
+/*!
+ * Test whether a columnar decoder is valid.
+ *
+ * \param[in] columnar Columnar decoder
+ * \return             Test result
+ */
+PB_INLINE int
+pb_columnar_valid(const pb_columnar_t *columnar) {
+  assert(columnar);
+  return !pb_columnar_error(columnar);
+}
+
+/*!
+ * Retrieve the number of rows of a columnar decoder.
+ *
+ * \param[in] columnar Columnar decoder
+ * \return             Row count
+ */
+PB_INLINE size_t
+pb_columnar_size(const pb_columnar_t *columnar) {
+  assert(columnar);
+  return columnar->size;
+}
+
+/*!
+ * Retrieve a column of a columnar decoder in order of projection.
+ *
+ * \param[in] columnar Columnar decoder
+ * \param[in] index    Column index
+ * \return             Column
+ */
+PB_INLINE const pb_column_t *
+pb_columnar_column(const pb_columnar_t *columnar, size_t index) {
+  assert(columnar && index < columnar->column.size);
+  return &(columnar->column.data[index]);
+}
+
+/* ------------------------------------------------------------------------- */
+
+/*!
+ * Retrieve the values of a column.
+ *
+ * For scalar fields, this is an array of native values with one value per row,
+ * which is zero for rows where the field is absent. For strings and bytes, it
+ * is the concatenated data of all rows, which is split using the offsets.
+ *
+ * \param[in] column Column
+ * \return           Values
+ */
+PB_INLINE const void *
+pb_column_values(const pb_column_t *column) {
+  assert(column);
+  return pb_buffer_data(&(column->values));
+}
+
+/*!
+ * Retrieve the offsets of a string or bytes column.
+ *
+ * The data of row n spans from offset n to offset n + 1, so there is one more
+ * offset than there are rows. For scalar fields, NULL is returned.
+ *
+ * \param[in] column Column
+ * \return           Offsets
+ */
+PB_INLINE const uint32_t *
+pb_column_offsets(const pb_column_t *column) {
+  assert(column);
+  return (const uint32_t *)pb_buffer_data(&(column->offsets));
+}
+
+/*!
+ * Retrieve the presence bitmap of a column.
+ *
+ * Bit n of the bitmap, counted from the least significant bit of every byte,
+ * is set if the field is present in row n.
+ *
+ * \param[in] column Column
+ * \return           Presence bitmap
+ */
+PB_INLINE const uint8_t *
+pb_column_presence(const pb_column_t *column) {
+  assert(column);
+  return pb_buffer_data(&(column->presence));
+}
+
+/*!
+ * Test whether the field of a column is present in a row.
+ *
+ * \param[in] column Column
+ * \param[in] row    Row
+ * \return           Test result
+ */
+PB_INLINE int
+pb_column_present(const pb_column_t *column, size_t row) {
+  assert(column);
+  assert((row >> 3) < pb_buffer_size(&(column->presence)));
+  return (pb_column_presence(column)[row >> 3] >> (row & 7)) & 1;
+}
+
+#endif /* PB_INCLUDE_CORE_COLUMNAR_H */
@@ -24,10 +24,24 @@
 #define PB_INCLUDE_CORE_DECODER_H
 
 #include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
 
+#include <protobluff/core/allocator.h>
 #include <protobluff/core/buffer.h>
 #include <protobluff/core/common.h>
 #include <protobluff/core/descriptor.h>
+#include <protobluff/core/intern.h>
+#include <protobluff/core/layout.h>
+#include <protobluff/core/stream.h>
+#include <protobluff/core/string.h>
+
+/* ----------------------------------------------------------------------------
+ * Constants
+ * ------------------------------------------------------------------------- */
+
+#define PB_DECODER_FLAG_UTF8   1       /*!< Flag: validate all strings */
+#define PB_DECODER_FLAG_INTERN 2       /*!< Flag: intern all strings */
 
 /* ----------------------------------------------------------------------------
  * Type definitions
@@ -40,13 +54,94 @@ typedef pb_error_t
   const void *value,                   /*!< Pointer holding value */
   void *user);                         /*!< User data */
 
+typedef pb_error_t
+(*pb_decoder_packed_handler_f)(
+  const pb_field_descriptor_t
+    *descriptor,                       /*!< Field descriptor */
+  const void *values,                  /*!< Pointer holding values */
+  size_t size,                         /*!< Value count */
+  void *user);                         /*!< User data */
+
+typedef pb_error_t
+(*pb_decoder_unknown_handler_f)(
+  const pb_string_t *range,            /*!< Raw unknown fields */
+  void *user);                         /*!< User data */
+
 /* ------------------------------------------------------------------------- */
 
+typedef struct pb_decoder_budget_t {
+  size_t depth;                        /*!< Maximum nesting depth */
+  size_t size;                         /*!< Maximum message size */
+  size_t fields;                       /*!< Maximum field count */
+  size_t length;                       /*!< Maximum string length */
+  size_t count;                        /*!< Fields decoded so far */
+} pb_decoder_budget_t;
+
+typedef struct pb_decoder_index_entry_t {
+  size_t first;                        /*!< Offset of first occurrence */
+  size_t last;                         /*!< Offset of last occurrence */
+  size_t count;                        /*!< Occurrence count */
+} pb_decoder_index_entry_t;
+
+typedef struct pb_decoder_index_t {
+  pb_allocator_t *allocator;           /*!< Allocator */
+  const pb_descriptor_t *descriptor;   /*!< Descriptor of indexed message */
+  struct {
+    pb_decoder_index_entry_t *data;    /*!< Entries by field position */
+    size_t capacity;                   /*!< Entry capacity */
+  } entry;
+  size_t size;                         /*!< Size of indexed message */
+  int complete;                        /*!< Completion flag */
+} pb_decoder_index_t;
+
 typedef struct pb_decoder_t {
   const pb_descriptor_t *descriptor;   /*!< Descriptor */
   const pb_buffer_t *buffer;           /*!< Buffer */
+  uint8_t flags;                       /*!< Flags */
+  pb_decoder_budget_t *budget;         /*!< Budget */
+  pb_intern_t *intern;                 /*!< Interning table */
+  pb_decoder_index_t *index;           /*!< Index of field offsets */
+  pb_decoder_unknown_handler_f
+    unknown;                           /*!< Unknown field handler */
+  size_t depth;                        /*!< Nesting depth */
 } pb_decoder_t;
 
+typedef struct pb_decoder_mask_t {
+  const uint8_t *data;                 /*!< Bitset of wanted tags */
+  size_t size;                         /*!< Bitset size */
+} pb_decoder_mask_t;
+
+typedef pb_error_t
+(*pb_decoder_nested_handler_f)(
+  pb_decoder_t *decoder,               /*!< Decoder of nested message */
+  void *user);                         /*!< User data */
+
+/* ------------------------------------------------------------------------- */
+
+typedef struct pb_decoder_frame_t {
+  const pb_descriptor_t *descriptor;   /*!< Descriptor */
+  const pb_field_descriptor_t
+    *packed;                           /*!< Packed field descriptor */
+  size_t end;                          /*!< End offset */
+} pb_decoder_frame_t;
+
+typedef struct pb_decoder_feed_t {
+  const pb_descriptor_t *descriptor;   /*!< Descriptor */
+  pb_decoder_handler_f handler;        /*!< Handler */
+  void *user;                          /*!< User data */
+  pb_buffer_t buffer;                  /*!< Buffer for incomplete fields */
+  struct {
+    pb_decoder_frame_t *data;          /*!< Frames */
+    size_t size;                       /*!< Frame count */
+    size_t capacity;                   /*!< Frame capacity */
+  } frame;
+  size_t depth;                        /*!< Nesting depth */
+  size_t offset;                       /*!< Current offset */
+  size_t skip;                         /*!< Bytes left to skip */
+  pb_decoder_budget_t *budget;         /*!< Budget */
+  pb_error_t error;                    /*!< Error code */
+} pb_decoder_feed_t;
+
 /* ----------------------------------------------------------------------------
  * Interface
  * ------------------------------------------------------------------------- */
@@ -58,6 +153,14 @@ pb_decoder_create(
     *descriptor,                       /* Descriptor */
   const pb_buffer_t *buffer);          /* Buffer */
 
+PB_EXPORT PB_WARN_UNUSED_RESULT
+pb_decoder_t
+pb_decoder_create_with_flags(
+  const pb_descriptor_t
+    *descriptor,                       /* Descriptor */
+  const pb_buffer_t *buffer,           /* Buffer */
+  uint8_t flags);                      /* Flags */
+
 PB_EXPORT void
 pb_decoder_destroy(
   pb_decoder_t *decoder);              /* Decoder */
@@ -69,6 +172,132 @@ pb_decoder_decode(
   pb_decoder_handler_f handler,        /* Handler */
   void *user);                         /* User data */
 
+PB_EXPORT PB_WARN_UNUSED_RESULT
+pb_error_t
+pb_decoder_decode_checked(
+  const pb_decoder_t *decoder,         /* Decoder */
+  pb_decoder_handler_f handler,        /* Handler */
+  void *user);                         /* User data */
+
+PB_EXPORT PB_WARN_UNUSED_RESULT
+pb_error_t
+pb_decoder_decode_packed(
+  const pb_decoder_t *decoder,         /* Decoder */
+  pb_decoder_handler_f handler,        /* Handler */
+  pb_decoder_packed_handler_f packed,  /* Packed handler */
+  void *user);                         /* User data */
+
+PB_EXPORT PB_WARN_UNUSED_RESULT
+pb_error_t
+pb_decoder_decode_masked(
+  const pb_decoder_t *decoder,         /* Decoder */
+  const pb_decoder_mask_t *mask,       /* Mask */
+  pb_decoder_handler_f handler,        /* Handler */
+  void *user);                         /* User data */
+
+PB_EXPORT PB_WARN_UNUSED_RESULT
+pb_error_t
+pb_decoder_decode_into(
+  const pb_decoder_t *decoder,         /* Decoder */
+  const pb_layout_t *layout,           /* Layout */
+  void *value);                        /* Pointer holding struct */
+
+PB_EXPORT PB_WARN_UNUSED_RESULT
+pb_error_t
+pb_decoder_decode_field_into(
+  pb_stream_t *stream,                 /* Stream */
+  const pb_layout_t *layout,           /* Layout */
+  void *value,                         /* Pointer holding struct */
+  uint32_t key);                       /* Tag and wiretype */
+
+PB_EXPORT PB_WARN_UNUSED_RESULT
+pb_error_t
+pb_decoder_skip_field(
+  pb_stream_t *stream,                 /* Stream */
+  uint32_t key);                       /* Tag and wiretype */
+
+PB_EXPORT PB_WARN_UNUSED_RESULT
+pb_error_t
+pb_decoder_decode_nested(
+  const pb_decoder_t *decoder,         /* Decoder */
+  const pb_descriptor_t
+    *descriptor,                       /* Descriptor of nested message */
+  const pb_string_t *value,            /* Raw nested message */
+  pb_decoder_nested_handler_f handler, /* Nested handler */
+  void *user);                         /* User data */
+
+/* ------------------------------------------------------------------------- */
+
+PB_EXPORT PB_WARN_UNUSED_RESULT
+pb_decoder_index_t
+pb_decoder_index_create(void);
+
+PB_EXPORT PB_WARN_UNUSED_RESULT
+pb_decoder_index_t
+pb_decoder_index_create_with_allocator(
+  pb_allocator_t *allocator);          /* Allocator */
+
+PB_EXPORT void
+pb_decoder_index_destroy(
+  pb_decoder_index_t *index);          /* Index */
+
+PB_EXPORT PB_WARN_UNUSED_RESULT
+const pb_decoder_index_entry_t *
+pb_decoder_index_find(
+  const pb_decoder_index_t *index,     /* Index */
+  pb_tag_t tag);                       /* Tag */
+
+/* ------------------------------------------------------------------------- */
+
+PB_EXPORT PB_WARN_UNUSED_RESULT
+pb_decoder_feed_t
+pb_decoder_feed_create(
+  const pb_descriptor_t
+    *descriptor,                       /* Descriptor */
+  pb_decoder_handler_f handler,        /* Handler */
+  void *user);                         /* User data */
+
+PB_EXPORT PB_WARN_UNUSED_RESULT
+pb_decoder_feed_t
+pb_decoder_feed_create_with_allocator(
+  pb_allocator_t *allocator,           /* Allocator */
+  const pb_descriptor_t
+    *descriptor,                       /* Descriptor */
+  pb_decoder_handler_f handler,        /* Handler */
+  void *user);                         /* User data */
+
+PB_EXPORT void
+pb_decoder_feed_destroy(
+  pb_decoder_feed_t *feed);            /* Feed decoder */
+
+PB_EXPORT PB_WARN_UNUSED_RESULT
+pb_error_t
+pb_decoder_feed(
+  pb_decoder_feed_t *feed,             /* Feed decoder */
+  const uint8_t chunk[],               /* Chunk */
+  size_t size);                        /* Chunk size */
+
+PB_EXPORT PB_WARN_UNUSED_RESULT
+pb_error_t
+pb_decoder_feed_segments(
+  pb_decoder_feed_t *feed,             /* Feed decoder */
+  const pb_string_t segments[],        /* Segments */
+  size_t size);                        /* Segment count */
+
+PB_EXPORT PB_WARN_UNUSED_RESULT
+pb_error_t
+pb_decoder_feed_slice(
+  pb_decoder_feed_t *feed,             /* Feed decoder */
+  const uint8_t data[],                /* Message */
+  size_t size,                         /* Message size */
+  size_t bytes,                        /* Bytes per slice or zero */
+  size_t fields);                      /* Fields per slice or zero */
+
+PB_EXPORT PB_WARN_UNUSED_RESULT
+pb_error_t
+pb_decoder_feed_finish(
+  pb_decoder_feed_t *feed);            /* Feed decoder */
+
 /* ----------------------------------------------------------------------------
  * Inline functions
  * ------------------------------------------------------------------------- */
@@ -109,6 +338,119 @@ pb_decoder_error(const pb_decoder_t *decoder) {
   return pb_buffer_error(decoder->buffer);
 }
 
+/*!
+ * Attach a budget to a decoder.
+ *
+ * The budget limits the nesting depth, the size of the message, the number of
+ * fields and the length of strings and bytes, where a limit of zero means no
+ * limit. Decoders for nested messages share the budget of their parent, so
+ * the field count spans the whole message.
+ *
+ * \warning A decoder does not take ownership of the provided budget, so the
+ * caller must ensure that the budget is not freed during operations.
+ *
+ * \param[in,out] decoder Decoder
+ * \param[in,out] budget  Budget
+ */
+PB_INLINE void
+pb_decoder_set_budget(pb_decoder_t *decoder, pb_decoder_budget_t *budget) {
+  assert(decoder);
+  decoder->budget = budget;
+}
+
+/*!
+ * Attach an interning table to a decoder.
+ *
+ * Values of string and bytes fields flagged for interning, or all of them if
+ * the decoder was created with PB_DECODER_FLAG_INTERN, are interned before
+ * the handler is invoked, so it receives stable copies that can be compared
+ * by pointer and identified via pb_intern_id(). Decoders for nested messages
+ * share the interning table of their parent.
+ *
+ * \warning A decoder does not take ownership of the provided interning table,
+ * so the caller must ensure that it is not freed during operations.
+ *
+ * \param[in,out] decoder Decoder
+ * \param[in,out] intern  Interning table
+ */
+PB_INLINE void
+pb_decoder_set_intern(pb_decoder_t *decoder, pb_intern_t *intern) {
+  assert(decoder);
+  decoder->intern = intern;
+}
+
+/*!
+ * Attach an index of field offsets to a decoder.
+ *
+ * While decoding, the offsets of the first and last occurrence of every field
+ * of the message, as well as the number of occurrences, are recorded in the
+ * index as a by-product of the single pass. Fields excluded by a mask are
+ * recorded as well. The index is only complete if decoding succeeded, and
+ * can be handed to a journal over the same data with pb_journal_set_index(),
+ * so cursors look up fields instead of scanning the message. Decoders for
+ * nested messages do not inherit the index.
+ *
+ * \warning A decoder does not take ownership of the provided index, so the
+ * caller must ensure that the index is not freed during operations.
+ *
+ * \param[in,out] decoder Decoder
+ * \param[in,out] index   Index
+ */
+PB_INLINE void
+pb_decoder_set_index(pb_decoder_t *decoder, pb_decoder_index_t *index) {
+  assert(decoder);
+  decoder->index = index;
+}
+
+/*!
+ * Attach a handler for unknown fields to a decoder.
+ *
+ * Instead of being thrown away, unknown fields are reported to the handler
+ * as ranges of raw bytes pointing into the buffer of the decoder, including
+ * their tags, so they can be appended verbatim to another message with
+ * pb_encoder_encode_raw(). Adjacent unknown fields are merged into a single
+ * range, which is why ranges are only reported once a known field or the end
+ * of the message is reached. Fields excluded by a mask are not reported, and
+ * decoders for nested messages do not inherit the handler.
+ *
+ * \param[in,out] decoder Decoder
+ * \param[in]     unknown Unknown field handler
+ */
+PB_INLINE void
+pb_decoder_set_unknown(
+    pb_decoder_t *decoder, pb_decoder_unknown_handler_f unknown) {
+  assert(decoder);
+  decoder->unknown = unknown;
+}
+
+/*!
+ * Mark a tag as wanted in the bitset of a mask.
+ *
+ * \warning The caller has to ensure that the bitset is appropriately sized,
+ * i.e. that it holds at least (tag >> 3) + 1 bytes.
+ *
+ * \param[in,out] data[] Bitset
+ * \param[in]     tag    Tag
+ */
+PB_INLINE void
+pb_decoder_mask_set(uint8_t data[], pb_tag_t tag) {
+  assert(data && tag);
+  data[tag >> 3] |= 1 << (tag & 7);
+}
+
+/*!
+ * Test whether a tag is wanted according to a mask.
+ *
+ * \param[in] mask Mask
+ * \param[in] tag  Tag
+ * \return         Test result
+ */
+PB_INLINE int
+pb_decoder_mask_has(const pb_decoder_mask_t *mask, pb_tag_t tag) {
+  assert(mask);
+  return (tag >> 3) < mask->size && (mask->data[tag >> 3] >> (tag & 7)) & 1;
+}
+
 /*!
  * Test whether a decoder is valid.
  *
@@ -121,4 +463,102 @@ pb_decoder_valid(const pb_decoder_t *decoder) {
   return !pb_decoder_error(decoder);
 }
 
+/* ------------------------------------------------------------------------- */
+
+/*!
+ * Test whether an index of field offsets is complete.
+ *
+ * \param[in] index Index
+ * \return          Test result
+ */
+PB_INLINE int
+pb_decoder_index_complete(const pb_decoder_index_t *index) {
+  assert(index);
+  return index->complete;
+}
+
+/* ------------------------------------------------------------------------- */
+
+/*!
+ * Retrieve the descriptor of a feed decoder.
+ *
+ * \param[in] feed Feed decoder
+ * \return         Descriptor
+ */
+PB_INLINE const pb_descriptor_t *
+pb_decoder_feed_descriptor(const pb_decoder_feed_t *feed) {
+  assert(feed);
+  return feed->descriptor;
+}
+
+/*!
+ * Retrieve the current nesting depth of a feed decoder.
+ *
+ * The depth is zero on the top level and is increased when a nested message
+ * is entered, i.e. right before the handler gets invoked for it.
+ *
+ * \param[in] feed Feed decoder
+ * \return         Nesting depth
+ */
+PB_INLINE size_t
+pb_decoder_feed_depth(const pb_decoder_feed_t *feed) {
+  assert(feed);
+  return feed->depth;
+}
+
+/*!
+ * Retrieve the number of bytes a feed decoder consumed so far.
+ *
+ * \param[in] feed Feed decoder
+ * \return         Consumed bytes
+ */
+PB_INLINE size_t
+pb_decoder_feed_offset(const pb_decoder_feed_t *feed) {
+  assert(feed);
+  return feed->offset;
+}
+
+/*!
+ * Attach a budget to a feed decoder.
+ *
+ * Limits are checked as the chunks arrive, so a message that exceeds them is
+ * rejected right after the offending bytes, without retaining them.
+ *
+ * \warning A feed decoder does not take ownership of the provided budget, so
+ * the caller must ensure that the budget is not freed during operations.
+ *
+ * \param[in,out] feed   Feed decoder
+ * \param[in,out] budget Budget
+ */
+PB_INLINE void
+pb_decoder_feed_set_budget(
+    pb_decoder_feed_t *feed, pb_decoder_budget_t *budget) {
+  assert(feed);
+  feed->budget = budget;
+}
+
+/*!
+ * Retrieve the internal error state of a feed decoder.
+ *
+ * \param[in] feed Feed decoder
+ * \return         Error code
+ */
+PB_INLINE pb_error_t
+pb_decoder_feed_error(const pb_decoder_feed_t *feed) {
+  assert(feed);
+  return feed->error;
+}
+
+/*!
+ * Test whether a feed decoder is valid.
+ *
+ * \param[in] feed Feed decoder
+ * \return         Test result
+ */
+PB_INLINE int
+pb_decoder_feed_valid(const pb_decoder_feed_t *feed) {
+  assert(feed);
+  return !pb_decoder_feed_error(feed);
+}
+
 #endif /* PB_INCLUDE_CORE_DECODER_H */
@@ -0,0 +1,141 @@
+/*
+ * Copyright (c) 2013-2020 Martin Donath <martin.donath@squidfunk.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef PB_INCLUDE_CORE_DELIMITED_H
+#define PB_INCLUDE_CORE_DELIMITED_H
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/uio.h>
+
+#include <protobluff/core/buffer.h>
+#include <protobluff/core/common.h>
+
+/* ----------------------------------------------------------------------------
+ * Constants
+ * ------------------------------------------------------------------------- */
+
+/*! Number of messages written in a single batch */
+#define PB_DELIMITED_WRITER_BATCH 32
+
+/* ----------------------------------------------------------------------------
+ * Type definitions
+ * ------------------------------------------------------------------------- */
+
+typedef struct pb_delimited_reader_t {
+  pb_buffer_t buffer;                  /*!< Buffer */
+  size_t offset;                       /*!< Offset of next message */
+  int fd;                              /*!< File descriptor, -1 if none */
+} pb_delimited_reader_t;
+
+typedef struct pb_delimited_writer_t {
+  int fd;                              /*!< File descriptor */
+  struct iovec iov[
+    PB_DELIMITED_WRITER_BATCH * 2];    /*!< Pending I/O vectors */
+  uint8_t prefix[
+    PB_DELIMITED_WRITER_BATCH][5];     /*!< Length prefixes */
+  size_t size;                         /*!< Pending message count */
+} pb_delimited_writer_t;
+
+/* ----------------------------------------------------------------------------
+ * Interface
+ * ------------------------------------------------------------------------- */
+
+PB_EXPORT PB_WARN_UNUSED_RESULT
+pb_delimited_reader_t
+pb_delimited_reader_create(
+  const pb_buffer_t *buffer);          /* Buffer */
+
+PB_EXPORT PB_WARN_UNUSED_RESULT
+pb_delimited_reader_t
+pb_delimited_reader_create_from_fd(
+  int fd,                              /* File descriptor */
+  size_t capacity);                    /* Read-ahead capacity */
+
+PB_EXPORT void
+pb_delimited_reader_destroy(
+  pb_delimited_reader_t *reader);      /* Reader */
+
+PB_EXPORT PB_WARN_UNUSED_RESULT
+pb_error_t
+pb_delimited_reader_next(
+  pb_delimited_reader_t *reader,       /* Reader */
+  pb_buffer_t *message);               /* Buffer receiving message */
+
+PB_EXPORT PB_WARN_UNUSED_RESULT
+pb_delimited_writer_t
+pb_delimited_writer_create(
+  int fd);                             /* File descriptor */
+
+PB_EXPORT PB_WARN_UNUSED_RESULT
+pb_error_t
+pb_delimited_writer_write(
+  pb_delimited_writer_t *writer,       /* Writer */
+  const pb_buffer_t *message);         /* Message */
+
+PB_EXPORT PB_WARN_UNUSED_RESULT
+pb_error_t
+pb_delimited_writer_flush(
+  pb_delimited_writer_t *writer);      /* Writer */
+
+/* ----------------------------------------------------------------------------
+ * Inline functions
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Retrieve the internal error state of a delimited reader.
+ *
+ * \param[in] reader Reader
+ * \return           Error code
+ */
+PB_INLINE pb_error_t
+pb_delimited_reader_error(const pb_delimited_reader_t *reader) {
+  assert(reader);
+  return pb_buffer_error(&(reader->buffer));
+}
+
+/*!
+ * Test whether a delimited reader is valid.
+ *
+ * \param[in] reader Reader
+ * \return           Test result
+ */
+PB_INLINE int
+pb_delimited_reader_valid(const pb_delimited_reader_t *reader) {
+  assert(reader);
+  return !pb_delimited_reader_error(reader);
+}
+
+/*!
+ * Retrieve the number of messages pending in a delimited writer.
+ *
+ * \param[in] writer Writer
+ * \return           Pending message count
+ */
+PB_INLINE size_t
+pb_delimited_writer_pending(const pb_delimited_writer_t *writer) {
+  assert(writer);
+  return writer->size;
+}
+
+#endif /* PB_INCLUDE_CORE_DELIMITED_H */
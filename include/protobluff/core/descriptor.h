@@ -41,10 +41,16 @@ typedef struct pb_field_descriptor_t {
   const void *const refer;             /*!< Message or enum descriptor */
   const void *const value;             /*!< Default or oneof descriptor */
   const uint8_t flags;                 /*!< Flags */
+  struct {
+    const uint8_t data[5];             /*!< Encoded tag and wiretype */
+    const uint8_t size;                /*!< Encoded tag size */
+  } key;
 } pb_field_descriptor_t;
 
 /* ------------------------------------------------------------------------- */
 
+struct pb_descriptor_extensions_t;
+
 typedef struct pb_descriptor_t {
   struct {
     const pb_field_descriptor_t
@@ -53,6 +59,28 @@ typedef struct pb_descriptor_t {
   } field;
   struct pb_descriptor_t
     *extension;                        /*!< Descriptor extension */
+  struct {
+    const uint16_t *const data;        /*!< Field positions + 1 by tag */
+    const pb_tag_t offset;             /*!< Tag of first position */
+    const size_t size;                 /*!< Position count */
+  } index;
+  struct {
+    const uint64_t *const data;        /*!< Bitset of required positions */
+    const size_t size;                 /*!< Bitset word count */
+  } required;
+  struct {
+    const uint16_t *const data;        /*!< Field positions sorted by name */
+    const size_t size;                 /*!< Position count */
+  } name;
+  struct {
+    const pb_tag_t *const data;        /*!< Field tags in ascending order */
+  } tag;
+  struct {
+    const struct pb_descriptor_extensions_t
+      *table;                          /*!< Extension fields sorted by tag */
+    struct pb_descriptor_extensions_t
+      *tables;                         /*!< All tables ever built */
+  } extensions;
 } pb_descriptor_t;
 
 typedef struct pb_descriptor_iter_t {
@@ -74,6 +102,15 @@ typedef struct pb_enum_descriptor_t {
       *const data;                     /*!< Enum value descriptors */
     const size_t size;                 /*!< Enum value descriptor count */
   } value;
+  struct {
+    const uint16_t *const data;        /*!< Value positions + 1 by number */
+    const pb_enum_t offset;            /*!< Number of first position */
+    const size_t size;                 /*!< Position count */
+  } index;
+  struct {
+    const uint16_t *const data;        /*!< Value positions sorted by name */
+    const size_t size;                 /*!< Position count */
+  } name;
 } pb_enum_descriptor_t;
 
 typedef struct pb_enum_descriptor_iter_t {
@@ -138,6 +175,9 @@ pb_field_descriptor_wiretype_map[];
  * ------------------------------------------------------------------------- */
 
 #define PB_FLAG_PACKED 1               /*!< Flag: packed field */
+#define PB_FLAG_UTF8   2               /*!< Flag: UTF-8 validated string */
+#define PB_FLAG_PADDED 4               /*!< Flag: padded varint field */
+#define PB_FLAG_INTERN 8               /*!< Flag: interned string */
 
 /* ----------------------------------------------------------------------------
  * Inline functions
@@ -259,6 +299,42 @@ pb_field_descriptor_packed(const pb_field_descriptor_t *descriptor) {
   return descriptor->flags & PB_FLAG_PACKED;
 }
 
+/*!
+ * Test whether a field descriptor requires UTF-8 validation.
+ *
+ * \param[in] descriptor Field descriptor
+ * \return               Test result
+ */
+PB_INLINE int
+pb_field_descriptor_utf8(const pb_field_descriptor_t *descriptor) {
+  assert(descriptor);
+  return descriptor->flags & PB_FLAG_UTF8;
+}
+
+/*!
+ * Test whether a field descriptor specifies padded variable-sized integers.
+ *
+ * \param[in] descriptor Field descriptor
+ * \return               Test result
+ */
+PB_INLINE int
+pb_field_descriptor_padded(const pb_field_descriptor_t *descriptor) {
+  assert(descriptor);
+  return descriptor->flags & PB_FLAG_PADDED;
+}
+
+/*!
+ * Test whether a field descriptor specifies an interned string or bytes.
+ *
+ * \param[in] descriptor Field descriptor
+ * \return               Test result
+ */
+PB_INLINE int
+pb_field_descriptor_intern(const pb_field_descriptor_t *descriptor) {
+  assert(descriptor);
+  return descriptor->flags & PB_FLAG_INTERN;
+}
+
 /*!
  * Retrieve the native type size of a field descriptor.
  *
@@ -312,13 +388,16 @@ pb_descriptor_empty(const pb_descriptor_t *descriptor) {
 /*!
  * Retrieve the (first) extension of a descriptor.
  *
+ * Extensions may be registered by other threads at any time, so the chain of
+ * extensions is read with acquire semantics.
+ *
  * \param[in] descriptor Descriptor
  * \return               Descriptor extension
  */
 PB_INLINE pb_descriptor_t *
 pb_descriptor_extension(const pb_descriptor_t *descriptor) {
   assert(descriptor);
-  return descriptor->extension;
+  return __atomic_load_n(&(descriptor->extension), __ATOMIC_ACQUIRE);
 }
 
 /* ------------------------------------------------------------------------- */
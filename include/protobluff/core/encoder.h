@@ -26,21 +26,70 @@
 #include <assert.h>
 #include <stddef.h>
 #include <stdint.h>
+#include <sys/uio.h>
 
 #include <protobluff/core/allocator.h>
 #include <protobluff/core/buffer.h>
 #include <protobluff/core/common.h>
 #include <protobluff/core/descriptor.h>
+#include <protobluff/core/layout.h>
+#include <protobluff/core/string.h>
+
+/* ----------------------------------------------------------------------------
+ * Forward declarations
+ * ------------------------------------------------------------------------- */
+
+struct pb_fragment_t;
 
 /* ----------------------------------------------------------------------------
  * Type definitions
  * ------------------------------------------------------------------------- */
 
+typedef pb_error_t
+(*pb_encoder_sink_f)(
+  void *context,                       /*!< Sink context */
+  const uint8_t data[],                /*!< Raw data */
+  size_t size);                        /*!< Raw data size */
+
+/* ------------------------------------------------------------------------- */
+
+typedef struct pb_encoder_segment_t {
+  size_t offset;                       /*!< Offset in buffer */
+  const uint8_t *data;                 /*!< Referenced data */
+  size_t size;                         /*!< Referenced data size */
+} pb_encoder_segment_t;
+
+typedef struct pb_encoder_frame_t {
+  const pb_descriptor_t *descriptor;   /*!< Descriptor of parent */
+  size_t offset;                       /*!< Offset of length prefix */
+  size_t end;                          /*!< End offset, if length is known */
+  struct pb_encoder_frame_t *parent;   /*!< Frame of parent */
+} pb_encoder_frame_t;
+
 typedef struct pb_encoder_t {
   const pb_descriptor_t *descriptor;   /*!< Descriptor */
   pb_buffer_t buffer;                  /*!< Buffer */
+  pb_encoder_frame_t *frame;           /*!< Frame of nested message */
+  struct {
+    pb_encoder_segment_t *data;        /*!< Referenced segments */
+    size_t size;                       /*!< Referenced segment count */
+    size_t capacity;                   /*!< Referenced segment capacity */
+  } segment;
+  size_t threshold;                    /*!< Threshold for references */
+  struct {
+    pb_encoder_sink_f write;           /*!< Sink callback */
+    void *context;                     /*!< Sink context */
+    size_t limit;                      /*!< Threshold for flushes */
+    size_t written;                    /*!< Bytes written to sink */
+  } sink;
 } pb_encoder_t;
 
+typedef struct pb_encoder_field_t {
+  pb_tag_t tag;                        /*!< Tag */
+  const void *values;                  /*!< Pointer holding value(s) */
+  size_t size;                         /*!< Value count */
+} pb_encoder_field_t;
+
 /* ----------------------------------------------------------------------------
  * Interface
  * ------------------------------------------------------------------------- */
@@ -56,10 +105,43 @@ pb_encoder_create_with_allocator(
   pb_allocator_t *allocator,           /* Allocator */
   const pb_descriptor_t *descriptor);  /* Descriptor */
 
+PB_EXPORT PB_WARN_UNUSED_RESULT
+pb_encoder_t
+pb_encoder_create_fixed(
+  const pb_descriptor_t *descriptor,   /* Descriptor */
+  uint8_t data[],                      /* Raw data */
+  size_t capacity);                    /* Raw data capacity */
+
 PB_EXPORT void
 pb_encoder_destroy(
   pb_encoder_t *encoder);              /* Encoder */
 
+PB_EXPORT void
+pb_encoder_reset(
+  pb_encoder_t *encoder);              /* Encoder */
+
+PB_EXPORT PB_WARN_UNUSED_RESULT
+pb_error_t
+pb_encoder_trim(
+  pb_encoder_t *encoder);              /* Encoder */
+
+PB_EXPORT void
+pb_encoder_scatter(
+  pb_encoder_t *encoder,               /* Encoder */
+  size_t threshold);                   /* Threshold */
+
+PB_EXPORT void
+pb_encoder_stream(
+  pb_encoder_t *encoder,               /* Encoder */
+  pb_encoder_sink_f sink,              /* Sink callback */
+  void *context,                       /* Sink context */
+  size_t limit);                       /* Threshold for flushes */
+
+PB_EXPORT PB_WARN_UNUSED_RESULT
+pb_error_t
+pb_encoder_flush(
+  pb_encoder_t *encoder);              /* Encoder */
+
 PB_EXPORT PB_WARN_UNUSED_RESULT
 pb_error_t
 pb_encoder_encode(
@@ -68,6 +150,74 @@ pb_encoder_encode(
   const void *values,                  /* Pointer holding value(s) */
   size_t size);                        /* Value count */
 
+PB_EXPORT PB_WARN_UNUSED_RESULT
+pb_error_t
+pb_encoder_encode_raw(
+  pb_encoder_t *encoder,               /* Encoder */
+  const pb_string_t *raw);             /* Raw encoded fields */
+
+PB_EXPORT PB_WARN_UNUSED_RESULT
+pb_error_t
+pb_encoder_encode_fragment(
+  pb_encoder_t *encoder,               /* Encoder */
+  const struct pb_fragment_t
+    *fragment);                        /* Fragment */
+
+PB_EXPORT PB_WARN_UNUSED_RESULT
+pb_error_t
+pb_encoder_begin_nested(
+  pb_encoder_t *encoder,               /* Encoder */
+  pb_tag_t tag,                        /* Tag */
+  pb_encoder_frame_t *frame);          /* Frame */
+
+PB_EXPORT PB_WARN_UNUSED_RESULT
+pb_error_t
+pb_encoder_begin_nested_sized(
+  pb_encoder_t *encoder,               /* Encoder */
+  pb_tag_t tag,                        /* Tag */
+  pb_encoder_frame_t *frame,           /* Frame */
+  size_t length);                      /* Length of nested message */
+
+PB_EXPORT void
+pb_encoder_end_nested(
+  pb_encoder_t *encoder);              /* Encoder */
+
+PB_EXPORT PB_WARN_UNUSED_RESULT
+pb_error_t
+pb_encoder_encode_fields(
+  pb_encoder_t *encoder,               /* Encoder */
+  const pb_encoder_field_t fields[],   /* Fields */
+  size_t size);                        /* Field count */
+
+PB_EXPORT PB_WARN_UNUSED_RESULT
+pb_error_t
+pb_encoder_encode_struct(
+  pb_encoder_t *encoder,               /* Encoder */
+  const pb_layout_t *layout,           /* Layout */
+  const void *value);                  /* Pointer holding struct */
+
+PB_EXPORT size_t
+pb_encoder_length(
+  const pb_encoder_t *encoder);        /* Encoder */
+
+PB_EXPORT size_t
+pb_encoder_iovec(
+  const pb_encoder_t *encoder,         /* Encoder */
+  struct iovec *iov,                   /* I/O vectors */
+  size_t size);                        /* I/O vector count */
+
+PB_EXPORT size_t
+pb_encoder_size(
+  const pb_encoder_t *encoder,         /* Encoder */
+  pb_tag_t tag,                        /* Tag */
+  const void *values,                  /* Pointer holding value(s) */
+  size_t size);                        /* Value count */
+
+PB_EXPORT size_t
+pb_encoder_size_struct(
+  const pb_layout_t *layout,           /* Layout */
+  const void *value);                  /* Pointer holding struct */
+
 /* ----------------------------------------------------------------------------
  * Inline functions
  * ------------------------------------------------------------------------- */
@@ -96,6 +246,19 @@ pb_encoder_buffer(const pb_encoder_t *encoder) {
   return &(encoder->buffer);
 }
 
+/*!
+ * Retrieve the number of bytes that can be encoded without growing.
+ *
+ * \param[in] encoder Encoder
+ * \return            Bytes available
+ */
+PB_INLINE size_t
+pb_encoder_available(const pb_encoder_t *encoder) {
+  assert(encoder);
+  return pb_buffer_capacity(&(encoder->buffer)) -
+    pb_buffer_size(&(encoder->buffer));
+}
+
 /*!
  * Retrieve the internal error state of an encoder.
  *
@@ -0,0 +1,126 @@
+/*
+ * Copyright (c) 2013-2020 Martin Donath <martin.donath@squidfunk.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef PB_INCLUDE_CORE_FRAGMENT_H
+#define PB_INCLUDE_CORE_FRAGMENT_H
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <protobluff/core/allocator.h>
+#include <protobluff/core/common.h>
+#include <protobluff/core/encoder.h>
+#include <protobluff/core/string.h>
+
+/* ----------------------------------------------------------------------------
+ * Type definitions
+ * ------------------------------------------------------------------------- */
+
+typedef struct pb_fragment_t {
+  pb_allocator_t *allocator;           /*!< Allocator */
+  size_t references;                   /*!< Reference count */
+  pb_tag_t tag;                        /*!< Tag */
+  size_t offset;                       /*!< Size of key and length prefix */
+  size_t size;                         /*!< Raw data size */
+  uint8_t data[];                      /*!< Raw data */
+} pb_fragment_t;
+
+/* ----------------------------------------------------------------------------
+ * Interface
+ * ------------------------------------------------------------------------- */
+
+PB_EXPORT PB_WARN_UNUSED_RESULT
+pb_fragment_t *
+pb_fragment_create(
+  pb_tag_t tag,                        /* Tag */
+  const pb_encoder_t *encoder);        /* Encoder of submessage */
+
+PB_EXPORT PB_WARN_UNUSED_RESULT
+pb_fragment_t *
+pb_fragment_create_with_allocator(
+  pb_allocator_t *allocator,           /* Allocator */
+  pb_tag_t tag,                        /* Tag */
+  const pb_encoder_t *encoder);        /* Encoder of submessage */
+
+PB_EXPORT pb_fragment_t *
+pb_fragment_retain(
+  pb_fragment_t *fragment);            /* Fragment */
+
+PB_EXPORT void
+pb_fragment_release(
+  pb_fragment_t *fragment);            /* Fragment */
+
+/* ----------------------------------------------------------------------------
+ * Inline functions
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Retrieve the tag of a fragment.
+ *
+ * \param[in] fragment Fragment
+ * \return             Tag
+ */
+PB_INLINE pb_tag_t
+pb_fragment_tag(const pb_fragment_t *fragment) {
+  assert(fragment);
+  return fragment->tag;
+}
+
+/*!
+ * Retrieve the raw data of a fragment, including key and length prefix.
+ *
+ * \param[in] fragment Fragment
+ * \return             Raw data
+ */
+PB_INLINE const uint8_t *
+pb_fragment_data(const pb_fragment_t *fragment) {
+  assert(fragment);
+  return fragment->data;
+}
+
+/*!
+ * Retrieve the raw data size of a fragment, including key and length prefix.
+ *
+ * \param[in] fragment Fragment
+ * \return             Raw data size
+ */
+PB_INLINE size_t
+pb_fragment_size(const pb_fragment_t *fragment) {
+  assert(fragment);
+  return fragment->size;
+}
+
+/*!
+ * Retrieve the encoded submessage of a fragment, without key and length.
+ *
+ * \param[in] fragment Fragment
+ * \return             Encoded submessage
+ */
+PB_INLINE pb_string_t
+pb_fragment_value(const pb_fragment_t *fragment) {
+  assert(fragment);
+  return pb_string_init((uint8_t *)&(fragment->data[fragment->offset]),
+    fragment->size - fragment->offset);
+}
+
+#endif /* PB_INCLUDE_CORE_FRAGMENT_H */
@@ -0,0 +1,133 @@
+/*
+ * Copyright (c) 2013-2020 Martin Donath <martin.donath@squidfunk.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef PB_INCLUDE_CORE_INTERN_H
+#define PB_INCLUDE_CORE_INTERN_H
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <protobluff/core/allocator.h>
+#include <protobluff/core/common.h>
+#include <protobluff/core/string.h>
+
+/* ----------------------------------------------------------------------------
+ * Type definitions
+ * ------------------------------------------------------------------------- */
+
+typedef struct pb_intern_entry_t {
+  pb_string_t string;                  /*!< Interned string */
+  uint64_t hash;                       /*!< Hash */
+  size_t id;                           /*!< Identifier */
+} pb_intern_entry_t;
+
+typedef struct pb_intern_t {
+  pb_allocator_t *allocator;           /*!< Allocator */
+  struct {
+    pb_intern_entry_t **data;          /*!< Entries by identifier */
+    size_t size;                       /*!< Entry count */
+    size_t capacity;                   /*!< Entry capacity */
+  } entry;
+  struct {
+    pb_intern_entry_t **data;          /*!< Entries by hash */
+    size_t size;                       /*!< Slot count */
+  } slot;
+} pb_intern_t;
+
+/* ----------------------------------------------------------------------------
+ * Interface
+ * ------------------------------------------------------------------------- */
+
+PB_EXPORT PB_WARN_UNUSED_RESULT
+pb_intern_t
+pb_intern_create(void);
+
+PB_EXPORT PB_WARN_UNUSED_RESULT
+pb_intern_t
+pb_intern_create_with_allocator(
+  pb_allocator_t *allocator);          /* Allocator */
+
+PB_EXPORT void
+pb_intern_destroy(
+  pb_intern_t *intern);                /* Interning table */
+
+PB_EXPORT PB_WARN_UNUSED_RESULT
+const pb_string_t *
+pb_intern_insert(
+  pb_intern_t *intern,                 /* Interning table */
+  const pb_string_t *string);          /* String */
+
+PB_EXPORT PB_WARN_UNUSED_RESULT
+const pb_string_t *
+pb_intern_find(
+  const pb_intern_t *intern,           /* Interning table */
+  const pb_string_t *string);          /* String */
+
+/* ----------------------------------------------------------------------------
+ * Inline functions
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Retrieve the number of strings of an interning table.
+ *
+ * \param[in] intern Interning table
+ * \return           String count
+ */
+PB_INLINE size_t
+pb_intern_size(const pb_intern_t *intern) {
+  assert(intern);
+  return intern->entry.size;
+}
+
+/*!
+ * Retrieve an interned string by its identifier.
+ *
+ * \param[in] intern Interning table
+ * \param[in] id     Identifier
+ * \return           Interned string
+ */
+PB_INLINE const pb_string_t *
+pb_intern_string(const pb_intern_t *intern, size_t id) {
+  assert(intern && id < intern->entry.size);
+  return &(intern->entry.data[id]->string);
+}
+
+/*!
+ * Retrieve the identifier of an interned string.
+ *
+ * Identifiers are assigned in order of insertion, starting at zero, so they
+ * can be used to index arrays of per-string data.
+ *
+ * \warning The string must have been returned by an interning table, i.e.
+ * pb_intern_insert() or pb_intern_find(), or the behavior is undefined.
+ *
+ * \param[in] string Interned string
+ * \return           Identifier
+ */
+PB_INLINE size_t
+pb_intern_id(const pb_string_t *string) {
+  assert(string);
+  return ((const pb_intern_entry_t *)string)->id;
+}
+
+#endif /* PB_INCLUDE_CORE_INTERN_H */
@@ -0,0 +1,148 @@
+/*
+ * Copyright (c) 2013-2020 Martin Donath <martin.donath@squidfunk.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef PB_INCLUDE_CORE_LAYOUT_H
+#define PB_INCLUDE_CORE_LAYOUT_H
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <protobluff/core/common.h>
+#include <protobluff/core/descriptor.h>
+
+/* ----------------------------------------------------------------------------
+ * Type definitions
+ * ------------------------------------------------------------------------- */
+
+typedef struct pb_layout_field_t {
+  const size_t offset;                 /*!< Offset of member */
+  const struct pb_layout_t
+    *const nested;                     /*!< Layout of nested message */
+} pb_layout_field_t;
+
+typedef struct pb_layout_t {
+  const pb_descriptor_t
+    *const descriptor;                 /*!< Descriptor */
+  struct {
+    const pb_layout_field_t
+      *const data;                     /*!< Field layouts */
+    const size_t size;                 /*!< Field layout count */
+  } field;
+  const size_t has;                    /*!< Offset of presence bits */
+  const size_t size;                   /*!< Struct size */
+} pb_layout_t;
+
+/* ------------------------------------------------------------------------- */
+
+typedef struct pb_repeated_t {
+  void *data;                          /*!< Values */
+  size_t size;                         /*!< Value count */
+  size_t capacity;                     /*!< Value capacity */
+} pb_repeated_t;
+
+/* ----------------------------------------------------------------------------
+ * Interface
+ * ------------------------------------------------------------------------- */
+
+PB_EXPORT void
+pb_layout_init(
+  const pb_layout_t *layout,           /* Layout */
+  void *value);                        /* Pointer holding struct */
+
+PB_EXPORT void
+pb_layout_clear(
+  const pb_layout_t *layout,           /* Layout */
+  void *value);                        /* Pointer holding struct */
+
+/* ----------------------------------------------------------------------------
+ * Inline functions
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Retrieve the descriptor of a layout.
+ *
+ * \param[in] layout Layout
+ * \return           Descriptor
+ */
+PB_INLINE const pb_descriptor_t *
+pb_layout_descriptor(const pb_layout_t *layout) {
+  assert(layout);
+  return layout->descriptor;
+}
+
+/*!
+ * Retrieve the size of the struct described by a layout.
+ *
+ * \param[in] layout Layout
+ * \return           Struct size
+ */
+PB_INLINE size_t
+pb_layout_size(const pb_layout_t *layout) {
+  assert(layout);
+  return layout->size;
+}
+
+/*!
+ * Test whether a field at the given position of a layout is present.
+ *
+ * \param[in] layout Layout
+ * \param[in] value  Pointer holding struct
+ * \param[in] pos    Field position
+ * \return           Test result
+ */
+PB_INLINE int
+pb_layout_has(const pb_layout_t *layout, const void *value, size_t pos) {
+  assert(layout && value && pos < layout->field.size);
+  const uint8_t *has = (const uint8_t *)value + layout->has;
+  return (has[pos >> 3] >> (pos & 7)) & 1;
+}
+
+/*!
+ * Mark the field at the given position of a struct as present.
+ *
+ * \param[in]     layout Layout
+ * \param[in,out] value  Pointer holding struct
+ * \param[in]     pos    Field position
+ */
+PB_INLINE void
+pb_layout_set(const pb_layout_t *layout, void *value, size_t pos) {
+  assert(layout && value && pos < layout->field.size);
+  uint8_t *has = (uint8_t *)value + layout->has;
+  has[pos >> 3] |= 1 << (pos & 7);
+}
+
+/*!
+ * Mark the field at the given position of a struct as absent.
+ *
+ * \param[in]     layout Layout
+ * \param[in,out] value  Pointer holding struct
+ * \param[in]     pos    Field position
+ */
+PB_INLINE void
+pb_layout_unset(const pb_layout_t *layout, void *value, size_t pos) {
+  assert(layout && value && pos < layout->field.size);
+  uint8_t *has = (uint8_t *)value + layout->has;
+  has[pos >> 3] &= ~(1 << (pos & 7));
+}
+
+#endif /* PB_INCLUDE_CORE_LAYOUT_H */
@@ -0,0 +1,110 @@
+/*
+ * Copyright (c) 2013-2020 Martin Donath <martin.donath@squidfunk.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef PB_INCLUDE_CORE_RING_H
+#define PB_INCLUDE_CORE_RING_H
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <protobluff/core/common.h>
+#include <protobluff/core/descriptor.h>
+#include <protobluff/core/encoder.h>
+
+/* ----------------------------------------------------------------------------
+ * Type definitions
+ * ------------------------------------------------------------------------- */
+
+typedef struct pb_ring_t {
+  uint8_t *data;                       /*!< Raw data */
+  size_t capacity;                     /*!< Raw data capacity */
+  struct {
+    size_t start;                      /*!< Start offset */
+    size_t end;                        /*!< End offset */
+  } used;
+  size_t wrap;                         /*!< End offset of wrapped region */
+} pb_ring_t;
+
+/* ----------------------------------------------------------------------------
+ * Interface
+ * ------------------------------------------------------------------------- */
+
+PB_EXPORT PB_WARN_UNUSED_RESULT
+pb_ring_t
+pb_ring_create(
+  uint8_t data[],                      /* Raw data */
+  size_t capacity);                    /* Raw data capacity */
+
+PB_EXPORT size_t
+pb_ring_available(
+  const pb_ring_t *ring);              /* Ring buffer */
+
+PB_EXPORT PB_WARN_UNUSED_RESULT
+pb_encoder_t
+pb_ring_encoder(
+  pb_ring_t *ring,                     /* Ring buffer */
+  const pb_descriptor_t *descriptor,   /* Descriptor */
+  size_t size);                        /* Minimum size */
+
+PB_EXPORT PB_WARN_UNUSED_RESULT
+pb_error_t
+pb_ring_commit(
+  pb_ring_t *ring,                     /* Ring buffer */
+  const pb_encoder_t *encoder);        /* Encoder */
+
+PB_EXPORT void
+pb_ring_release(
+  pb_ring_t *ring,                     /* Ring buffer */
+  size_t size);                        /* Bytes to release */
+
+/* ----------------------------------------------------------------------------
+ * Inline functions
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Retrieve the oldest contiguous region of committed data of a ring buffer.
+ *
+ * \param[in]  ring Ring buffer
+ * \param[out] size Pointer receiving size
+ * \return          Raw data
+ */
+PB_INLINE const uint8_t *
+pb_ring_peek(const pb_ring_t *ring, size_t *size) {
+  assert(ring && size);
+  *size = ring->used.end - ring->used.start;
+  return &(ring->data[ring->used.start]);
+}
+
+/*!
+ * Test whether a ring buffer is empty.
+ *
+ * \param[in] ring Ring buffer
+ * \return         Test result
+ */
+PB_INLINE int
+pb_ring_empty(const pb_ring_t *ring) {
+  assert(ring);
+  return ring->used.start == ring->used.end;
+}
+
+#endif /* PB_INCLUDE_CORE_RING_H */
@@ -0,0 +1,144 @@
+/*
+ * Copyright (c) 2013-2020 Martin Donath <martin.donath@squidfunk.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef PB_INCLUDE_CORE_STATS_H
+#define PB_INCLUDE_CORE_STATS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <protobluff/core/common.h>
+
+/* ----------------------------------------------------------------------------
+ * Constants
+ * ------------------------------------------------------------------------- */
+
+/*! Number of latency histogram buckets, covering up to 2^33 nanoseconds */
+#define PB_STATS_BUCKETS 128
+
+/* ----------------------------------------------------------------------------
+ * Forward declarations
+ * ------------------------------------------------------------------------- */
+
+struct pb_descriptor_t;
+
+/* ----------------------------------------------------------------------------
+ * Type definitions
+ * ------------------------------------------------------------------------- */
+
+typedef enum pb_stats_operation_t {
+  PB_STATS_MESSAGE_GET,                /*!< pb_message_get() */
+  PB_STATS_MESSAGE_PUT,                /*!< pb_message_put() */
+  PB_STATS_MESSAGE_ERASE,              /*!< pb_message_erase() */
+  PB_STATS_CURSOR_NEXT,                /*!< pb_cursor_next() */
+  PB_STATS_ENCODER_ENCODE,             /*!< pb_encoder_encode() */
+  PB_STATS_OPERATIONS                  /*!< Operation count */
+} pb_stats_operation_t;
+
+/* ------------------------------------------------------------------------- */
+
+typedef struct pb_stats_t {
+  size_t adjustments;                  /*!< Recursive part adjustments */
+  size_t moved;                        /*!< Bytes moved within buffers */
+  size_t replayed;                     /*!< Journal entries replayed */
+  size_t resizes;                      /*!< Allocator resizes */
+} pb_stats_t;
+
+typedef struct pb_stats_histogram_t {
+  uint64_t count;                      /*!< Sampled operations */
+  uint64_t sum;                        /*!< Sum of latencies in nanoseconds */
+  uint64_t bucket[PB_STATS_BUCKETS];   /*!< Operations by latency bucket */
+} pb_stats_histogram_t;
+
+/* ----------------------------------------------------------------------------
+ * Interface
+ * ------------------------------------------------------------------------- */
+
+PB_EXPORT pb_stats_t
+pb_stats_get(void);
+
+PB_EXPORT void
+pb_stats_reset(void);
+
+PB_EXPORT pb_stats_t *
+pb_stats_local(void);
+
+PB_EXPORT void
+pb_stats_sampling(
+  size_t rate);                        /* Sample every n-th operation */
+
+PB_EXPORT pb_stats_histogram_t
+pb_stats_histogram(
+  pb_stats_operation_t operation,      /* Operation */
+  const struct pb_descriptor_t
+    *descriptor);                      /* Descriptor or NULL for all */
+
+PB_EXPORT uint64_t
+pb_stats_fields(
+  const struct pb_descriptor_t
+    *descriptor,                       /* Descriptor */
+  uint64_t count[]);                   /* Occurrences by field position */
+
+PB_EXPORT uint64_t
+pb_stats_percentile(
+  const pb_stats_histogram_t
+    *histogram,                        /* Histogram */
+  double percentile);                  /* Percentile */
+
+/* ----------------------------------------------------------------------------
+ * Inline functions
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Retrieve the latency bucket of a value.
+ *
+ * Buckets are log-linear, as in HDR histograms: each power of two is divided
+ * into four buckets of equal width, bounding the relative error by 25%.
+ *
+ * \param[in] value Latency in nanoseconds
+ * \return          Bucket
+ */
+PB_INLINE size_t
+pb_stats_bucket(uint64_t value) {
+  if (value < 4)
+    return value;
+  size_t msb    = 63 - __builtin_clzll(value),
+         bucket = ((msb - 1) << 2) | ((value >> (msb - 2)) & 3);
+  return bucket < PB_STATS_BUCKETS
+    ? bucket
+    : PB_STATS_BUCKETS - 1;
+}
+
+/*!
+ * Retrieve the lower bound of a latency bucket.
+ *
+ * \param[in] bucket Bucket
+ * \return           Latency in nanoseconds
+ */
+PB_INLINE uint64_t
+pb_stats_bucket_value(size_t bucket) {
+  if (bucket < 4)
+    return bucket;
+  return (uint64_t)(4 | (bucket & 3)) << ((bucket >> 2) - 1);
+}
+
+#endif /* PB_INCLUDE_CORE_STATS_H */
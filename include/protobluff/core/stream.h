@@ -0,0 +1,237 @@
+/*
+ * Copyright (c) 2013-2020 Martin Donath <martin.donath@squidfunk.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef PB_INCLUDE_CORE_STREAM_H
+#define PB_INCLUDE_CORE_STREAM_H
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <protobluff/core/buffer.h>
+#include <protobluff/core/common.h>
+#include <protobluff/core/string.h>
+#include <protobluff/core/varint.h>
+
+/* ----------------------------------------------------------------------------
+ * Type definitions
+ * ------------------------------------------------------------------------- */
+
+typedef struct pb_stream_t {
+  const pb_buffer_t *const buffer;     /*!< Buffer */
+  size_t offset;                       /*!< Current offset */
+} pb_stream_t;
+
+/* ----------------------------------------------------------------------------
+ * Inline functions
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Create a stream over a buffer.
+ *
+ * \warning A stream does not take ownership of the provided buffer, so the
+ * caller must ensure that the buffer is not freed during operations.
+ *
+ * \param[in] buffer Buffer
+ * \return           Stream
+ */
+PB_INLINE PB_WARN_UNUSED_RESULT
+pb_stream_t
+pb_stream_create(const pb_buffer_t *buffer) {
+  assert(buffer);
+  assert(pb_buffer_valid(buffer));
+  pb_stream_t stream = {
+    .buffer = buffer,
+    .offset = 0
+  };
+  return stream;
+}
+
+/*!
+ * Destroy a stream.
+ *
+ * \param[in,out] stream Stream
+ */
+PB_INLINE void
+pb_stream_destroy(pb_stream_t *stream) {
+  assert(stream); /* Nothing to be done */
+}
+
+/*!
+ * Retrieve the current offset of a stream.
+ *
+ * \param[in] stream Stream
+ * \return           Current offset
+ */
+PB_INLINE size_t
+pb_stream_offset(const pb_stream_t *stream) {
+  assert(stream);
+  return stream->offset;
+}
+
+/*!
+ * Retrieve the number of bytes left in a stream.
+ *
+ * \param[in] stream Stream
+ * \return           Bytes left
+ */
+PB_INLINE size_t
+pb_stream_left(const pb_stream_t *stream) {
+  assert(stream);
+  return pb_buffer_size(stream->buffer) - stream->offset;
+}
+
+/*!
+ * Read a fixed-sized value of given size.
+ *
+ * \param[in,out] stream Stream
+ * \param[in]     size   Size of value
+ * \param[out]    value  Pointer receiving value
+ * \return               Error code
+ */
+PB_INLINE PB_WARN_UNUSED_RESULT
+pb_error_t
+pb_stream_read_fixed(pb_stream_t *stream, size_t size, void *value) {
+  assert(stream && value);
+  if (pb_stream_left(stream) < size)
+    return PB_ERROR_OFFSET;
+  memcpy(value, pb_buffer_data(stream->buffer) + stream->offset, size);
+  stream->offset += size;
+  return PB_ERROR_NONE;
+}
+
+/*!
+ * Read a length-prefixed value.
+ *
+ * \param[in,out] stream Stream
+ * \param[out]    value  Pointer receiving value
+ * \return               Error code
+ */
+PB_INLINE PB_WARN_UNUSED_RESULT
+pb_error_t
+pb_stream_read_length(pb_stream_t *stream, pb_string_t *value) {
+  assert(stream && value);
+  uint8_t *data = (uint8_t *)pb_buffer_data(stream->buffer) + stream->offset;
+  size_t left = pb_stream_left(stream), size = 0;
+  uint32_t length = 0;
+  if (!left)
+    return PB_ERROR_OFFSET;
+  if (!(size = pb_varint_unpack_uint32(data, left, &length)))
+    return PB_ERROR_VARINT;
+  if (left - size < length)
+    return PB_ERROR_OFFSET;
+  *value = pb_string_init(data + size, length);
+  stream->offset += size + length;
+  return PB_ERROR_NONE;
+}
+
+/*!
+ * Read an unsigned 32-bit variable-sized integer, e.g. a tag or length.
+ *
+ * \param[in,out] stream Stream
+ * \param[out]    value  Pointer receiving value
+ * \return               Error code
+ */
+PB_INLINE PB_WARN_UNUSED_RESULT
+pb_error_t
+pb_stream_read_uint32(pb_stream_t *stream, uint32_t *value) {
+  assert(stream && value);
+  const uint8_t *data = pb_buffer_data(stream->buffer) + stream->offset;
+  size_t left = pb_stream_left(stream), size = 1;
+  if (!left)
+    return PB_ERROR_OFFSET;
+  if (!(data[0] & 0x80)) {
+    *value = data[0];
+  } else if (!(size = pb_varint_unpack_uint32(data, left, value))) {
+    return PB_ERROR_VARINT;
+  }
+  stream->offset += size;
+  return PB_ERROR_NONE;
+}
+
+/*!
+ * Read a value of given type without dispatching through jump tables.
+ *
+ * This is a type-specialized variant of pb_stream_read(), which switches on
+ * the type and calls the respective unpack function directly, so decode loops
+ * can be inlined and scheduled by the compiler - in particular when the type
+ * is known at compile time, the switch is folded into a single read.
+ *
+ * \param[in,out] stream Stream
+ * \param[in]     type   Type
+ * \param[out]    value  Pointer receiving value
+ * \return               Error code
+ */
+PB_INLINE PB_WARN_UNUSED_RESULT
+pb_error_t
+pb_stream_read_typed(pb_stream_t *stream, pb_type_t type, void *value) {
+  assert(stream && value);
+  const uint8_t *data = pb_buffer_data(stream->buffer) + stream->offset;
+  size_t left = pb_stream_left(stream), size = 0;
+  if (!left)
+    return PB_ERROR_OFFSET;
+  switch (type) {
+    case PB_TYPE_INT32:
+    case PB_TYPE_ENUM:
+      size = pb_varint_unpack_int32(data, left, value);
+      break;
+    case PB_TYPE_INT64:
+      size = pb_varint_unpack_int64(data, left, value);
+      break;
+    case PB_TYPE_UINT32:
+      return pb_stream_read_uint32(stream, (uint32_t *)value);
+    case PB_TYPE_UINT64:
+      size = pb_varint_unpack_uint64(data, left, value);
+      break;
+    case PB_TYPE_SINT32:
+      size = pb_varint_unpack_sint32(data, left, value);
+      break;
+    case PB_TYPE_SINT64:
+      size = pb_varint_unpack_sint64(data, left, value);
+      break;
+    case PB_TYPE_BOOL:
+      size = pb_varint_unpack_uint8(data, left, value);
+      break;
+    case PB_TYPE_FIXED32:
+    case PB_TYPE_SFIXED32:
+    case PB_TYPE_FLOAT:
+      return pb_stream_read_fixed(stream, 4, value);
+    case PB_TYPE_FIXED64:
+    case PB_TYPE_SFIXED64:
+    case PB_TYPE_DOUBLE:
+      return pb_stream_read_fixed(stream, 8, value);
+    case PB_TYPE_STRING:
+    case PB_TYPE_BYTES:
+    case PB_TYPE_MESSAGE:
+      return pb_stream_read_length(stream, (pb_string_t *)value);
+    default:
+      assert(0);
+      return PB_ERROR_INVALID;
+  }
+  if (!size)
+    return PB_ERROR_VARINT;
+  stream->offset += size;
+  return PB_ERROR_NONE;
+}
+
+#endif /* PB_INCLUDE_CORE_STREAM_H */
@@ -0,0 +1,84 @@
+/*
+ * Copyright (c) 2013-2020 Martin Donath <martin.donath@squidfunk.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef PB_INCLUDE_CORE_VARINT_H
+#define PB_INCLUDE_CORE_VARINT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <protobluff/core/common.h>
+
+/* ----------------------------------------------------------------------------
+ * Interface
+ * ------------------------------------------------------------------------- */
+
+PB_EXPORT PB_WARN_UNUSED_RESULT
+size_t
+pb_varint_unpack_int32(
+  const uint8_t data[],                /* Source buffer */
+  size_t left,                         /* Remaining bytes */
+  void *value);                        /* Pointer receiving value */
+
+PB_EXPORT PB_WARN_UNUSED_RESULT
+size_t
+pb_varint_unpack_int64(
+  const uint8_t data[],                /* Source buffer */
+  size_t left,                         /* Remaining bytes */
+  void *value);                        /* Pointer receiving value */
+
+PB_EXPORT PB_WARN_UNUSED_RESULT
+size_t
+pb_varint_unpack_uint8(
+  const uint8_t data[],                /* Source buffer */
+  size_t left,                         /* Remaining bytes */
+  void *value);                        /* Pointer receiving value */
+
+PB_EXPORT PB_WARN_UNUSED_RESULT
+size_t
+pb_varint_unpack_uint32(
+  const uint8_t data[],                /* Source buffer */
+  size_t left,                         /* Remaining bytes */
+  void *value);                        /* Pointer receiving value */
+
+PB_EXPORT PB_WARN_UNUSED_RESULT
+size_t
+pb_varint_unpack_uint64(
+  const uint8_t data[],                /* Source buffer */
+  size_t left,                         /* Remaining bytes */
+  void *value);                        /* Pointer receiving value */
+
+PB_EXPORT PB_WARN_UNUSED_RESULT
+size_t
+pb_varint_unpack_sint32(
+  const uint8_t data[],                /* Source buffer */
+  size_t left,                         /* Remaining bytes */
+  void *value);                        /* Pointer receiving value */
+
+PB_EXPORT PB_WARN_UNUSED_RESULT
+size_t
+pb_varint_unpack_sint64(
+  const uint8_t data[],                /* Source buffer */
+  size_t left,                         /* Remaining bytes */
+  void *value);                        /* Pointer receiving value */
+
+#endif /* PB_INCLUDE_CORE_VARINT_H */
@@ -59,5 +59,8 @@
 /* ------------------------------------------------------------------------- */
 
 #define PACKED     PB_FLAG_PACKED      /*!< Flag: packed field */
+#define UTF8       PB_FLAG_UTF8        /*!< Flag: UTF-8 validated string */
+#define PADDED     PB_FLAG_PADDED      /*!< Flag: padded varint field */
+#define INTERN     PB_FLAG_INTERN      /*!< Flag: interned string */
 
 #endif /* PB_INCLUDE_DESCRIPTOR_H */
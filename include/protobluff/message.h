@@ -23,14 +23,18 @@
 #ifndef PB_INCLUDE_MESSAGE_H
 #define PB_INCLUDE_MESSAGE_H
 
+#include <protobluff/message/appender.h>
 #include <protobluff/message/buffer.h>
 #include <protobluff/message/common.h>
 #include <protobluff/message/cursor.h>
 #include <protobluff/message/field.h>
+#include <protobluff/message/handle_pool.h>
 #include <protobluff/message/journal.h>
 #include <protobluff/message/message.h>
 #include <protobluff/message/nested.h>
 #include <protobluff/message/oneof.h>
 #include <protobluff/message/part.h>
+#include <protobluff/message/publisher.h>
+#include <protobluff/message/trace.h>
 
 #endif /* PB_INCLUDE_MESSAGE_H */
@@ -0,0 +1,102 @@
+/*
+ * Copyright (c) 2013-2020 Martin Donath <martin.donath@squidfunk.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#ifndef PB_INCLUDE_MESSAGE_APPENDER_H
+#define PB_INCLUDE_MESSAGE_APPENDER_H
+
+#include <assert.h>
+
+#include <protobluff/core/descriptor.h>
+#include <protobluff/message/common.h>
+#include <protobluff/message/message.h>
+#include <protobluff/message/part.h>
+
+/* ----------------------------------------------------------------------------
+ * Type definitions
+ * ------------------------------------------------------------------------- */
+
+typedef struct pb_appender_t {
+  pb_message_t message;                /*!< Message */
+  pb_tag_t tag;                        /*!< Tag to append to */
+  pb_part_t part;                      /*!< Part of last element */
+} pb_appender_t;
+
+/* ----------------------------------------------------------------------------
+ * Interface
+ * ------------------------------------------------------------------------- */
+
+PB_EXPORT PB_WARN_UNUSED_RESULT
+pb_appender_t
+pb_appender_create(
+  pb_message_t *message,               /* Message */
+  pb_tag_t tag);                       /* Tag */
+
+PB_EXPORT void
+pb_appender_destroy(
+  pb_appender_t *appender);            /* Appender */
+
+PB_EXPORT PB_WARN_UNUSED_RESULT
+pb_error_t
+pb_appender_put(
+  pb_appender_t *appender,             /* Appender */
+  const void *value);                  /* Pointer holding value */
+
+/* ----------------------------------------------------------------------------
+ * Inline functions
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Retrieve the underlying message of an appender.
+ *
+ * \param[in] appender Appender
+ * \return             Message
+ */
+PB_INLINE pb_message_t *
+pb_appender_message(pb_appender_t *appender) {
+  assert(appender);
+  return &(appender->message);
+}
+
+/*!
+ * Retrieve the tag of an appender.
+ *
+ * \param[in] appender Appender
+ * \return             Tag
+ */
+PB_INLINE pb_tag_t
+pb_appender_tag(const pb_appender_t *appender) {
+  assert(appender);
+  return appender->tag;
+}
+
+/*!
+ * Test whether an appender is valid.
+ *
+ * \param[in] appender Appender
+ * \return             Test result
+ */
+PB_INLINE int
+pb_appender_valid(const pb_appender_t *appender) {
+  assert(appender);
+  return pb_message_valid(&(appender->message));
+}
+
+#endif /* PB_INCLUDE_MESSAGE_APPENDER_H */
@@ -24,24 +24,53 @@
 #define PB_INCLUDE_MESSAGE_COMMON_H
 
 #include <stddef.h>
+#include <stdint.h>
 
 #include <protobluff/core/common.h>
 
+/* ----------------------------------------------------------------------------
+ * Constants
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Maximum size of a journal, as relative offsets must be representable.
+ *
+ * When compiled with PB_COMPACT, offsets and versions are stored as 32-bit
+ * integers, which nearly halves the size of messages, cursors and journal
+ * entries, but limits journals to 2 GB. As this alters the layout of public
+ * structures, applications must be compiled with the same setting.
+ */
+#ifdef PB_COMPACT
+  #define PB_OFFSET_MAX  INT32_MAX
+  #define PB_VERSION_MAX UINT32_MAX
+#else
+  #define PB_OFFSET_MAX  PTRDIFF_MAX
+  #define PB_VERSION_MAX SIZE_MAX
+#endif /* PB_COMPACT */
+
 /* ----------------------------------------------------------------------------
  * Type definitions
  * ------------------------------------------------------------------------- */
 
-typedef size_t pb_version_t;           /*!< Version */
+#ifdef PB_COMPACT
+typedef uint32_t pb_version_t;         /*!< Version */
+typedef uint32_t pb_position_t;        /*!< Absolute offset */
+typedef int32_t  pb_distance_t;        /*!< Relative offset */
+#else
+typedef size_t    pb_version_t;        /*!< Version */
+typedef size_t    pb_position_t;       /*!< Absolute offset */
+typedef ptrdiff_t pb_distance_t;       /*!< Relative offset */
+#endif /* PB_COMPACT */
 
 /* ------------------------------------------------------------------------- */
 
 typedef struct pb_offset_t {
-  size_t start;                        /*!< Start offset */
-  size_t end;                          /*!< End offset */
+  pb_position_t start;                 /*!< Start offset */
+  pb_position_t end;                   /*!< End offset */
   struct {
-    ptrdiff_t origin;                  /*!< Relative offset to origin */
-    ptrdiff_t tag;                     /*!< Relative offset to tag */
-    ptrdiff_t length;                  /*!< Relative offset to length */
+    pb_distance_t origin;              /*!< Relative offset to origin */
+    pb_distance_t tag;                 /*!< Relative offset to tag */
+    pb_distance_t length;              /*!< Relative offset to length */
   } diff;
 } pb_offset_t;
 
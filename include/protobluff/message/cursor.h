@@ -44,9 +44,15 @@ typedef struct pb_cursor_t {
     pb_offset_t packed;                /*!< Current packed context */
   } current;
   size_t pos;                          /*!< Current position */
+  size_t end;                          /*!< End offset of partition */
   pb_error_t error;                    /*!< Error code */
 } pb_cursor_t;
 
+typedef int
+(*pb_cursor_predicate_f)(
+  pb_cursor_t *cursor,                 /*!< Cursor */
+  void *user);                         /*!< User data */
+
 /* ----------------------------------------------------------------------------
  * Interface
  * ------------------------------------------------------------------------- */
@@ -96,6 +102,20 @@ pb_cursor_get(
   pb_cursor_t *cursor,                 /* Cursor */
   void *value);                        /* Pointer receiving value */
 
+PB_EXPORT PB_WARN_UNUSED_RESULT
+pb_error_t
+pb_cursor_get_all(
+  pb_cursor_t *cursor,                 /* Cursor */
+  void *values,                        /* Pointer receiving values */
+  size_t *size);                       /* Value count */
+
+PB_EXPORT PB_WARN_UNUSED_RESULT
+pb_error_t
+pb_cursor_partition(
+  pb_cursor_t *cursor,                 /* Cursor */
+  pb_cursor_t cursors[],               /* Partitions */
+  size_t *size);                       /* Partition count */
+
 PB_EXPORT PB_WARN_UNUSED_RESULT
 pb_error_t
 pb_cursor_put(
@@ -107,6 +127,13 @@ pb_error_t
 pb_cursor_erase(
   pb_cursor_t *cursor);                /* Cursor */
 
+PB_EXPORT PB_WARN_UNUSED_RESULT
+pb_error_t
+pb_cursor_erase_if(
+  pb_cursor_t *cursor,                 /* Cursor */
+  pb_cursor_predicate_f predicate,     /* Predicate */
+  void *user);                         /* User data */
+
 /* ----------------------------------------------------------------------------
  * Macros
  * ------------------------------------------------------------------------- */
@@ -135,6 +162,21 @@ pb_cursor_descriptor(const pb_cursor_t *cursor) {
   return cursor->current.descriptor;
 }
 
+/*!
+ * Retrieve the current position of a cursor.
+ *
+ * The position counts the occurrences the cursor halted on, starting at zero,
+ * so it is the index of the current value within a repeated field.
+ *
+ * \param[in] cursor Cursor
+ * \return           Position
+ */
+PB_INLINE size_t
+pb_cursor_pos(const pb_cursor_t *cursor) {
+  assert(cursor);
+  return cursor->pos;
+}
+
 /*!
  * Retrieve the internal error state of a cursor.
  *
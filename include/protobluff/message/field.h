@@ -45,6 +45,8 @@ typedef struct pb_field_t {
   const pb_field_descriptor_t
     *descriptor;                       /*!< Field descriptor */
   pb_part_t part;                      /*!< Part */
+  const pb_descriptor_t
+    *parent;                           /*!< Descriptor, if not yet written */
 } pb_field_t;
 
 /* ----------------------------------------------------------------------------
@@ -57,6 +59,12 @@ pb_field_create(
   struct pb_message_t *message,        /* Message */
   pb_tag_t tag);                       /* Tag */
 
+PB_EXPORT PB_WARN_UNUSED_RESULT
+pb_field_t
+pb_field_create_virtual(
+  struct pb_message_t *message,        /* Message */
+  pb_tag_t tag);                       /* Tag */
+
 PB_EXPORT PB_WARN_UNUSED_RESULT
 pb_field_t
 pb_field_create_nested(
@@ -0,0 +1,127 @@
+/*
+ * Copyright (c) 2013-2020 Martin Donath <martin.donath@squidfunk.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#ifndef PB_INCLUDE_MESSAGE_HANDLE_POOL_H
+#define PB_INCLUDE_MESSAGE_HANDLE_POOL_H
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <protobluff/core/descriptor.h>
+#include <protobluff/message/common.h>
+#include <protobluff/message/journal.h>
+#include <protobluff/message/message.h>
+#include <protobluff/message/part.h>
+
+/* ----------------------------------------------------------------------------
+ * Type definitions
+ * ------------------------------------------------------------------------- */
+
+typedef size_t pb_handle_t;
+
+typedef struct pb_handle_pool_t {
+  pb_journal_t *journal;               /*!< Journal */
+  pb_version_t version;                /*!< Version of all slots */
+  struct {
+    const pb_descriptor_t **descriptor; /*!< Descriptors */
+    pb_offset_t *offset;               /*!< Offsets */
+    uint8_t *invalid;                  /*!< Invalidation flags */
+    size_t size;                       /*!< Slot count */
+    size_t capacity;                   /*!< Slot capacity */
+  } slot;
+  struct {
+    size_t *data;                      /*!< Free slots */
+    size_t size;                       /*!< Free slot count */
+  } free;
+} pb_handle_pool_t;
+
+/* ----------------------------------------------------------------------------
+ * Interface
+ * ------------------------------------------------------------------------- */
+
+PB_EXPORT PB_WARN_UNUSED_RESULT
+pb_handle_pool_t
+pb_handle_pool_create(
+  pb_journal_t *journal);              /* Journal */
+
+PB_EXPORT void
+pb_handle_pool_destroy(
+  pb_handle_pool_t *pool);             /* Handle pool */
+
+PB_EXPORT PB_WARN_UNUSED_RESULT
+pb_handle_t
+pb_handle_pool_insert(
+  pb_handle_pool_t *pool,              /* Handle pool */
+  pb_message_t *message);              /* Message */
+
+PB_EXPORT PB_WARN_UNUSED_RESULT
+pb_handle_t
+pb_handle_pool_insert_within(
+  pb_handle_pool_t *pool,              /* Handle pool */
+  pb_handle_t handle,                  /* Handle */
+  pb_tag_t tag);                       /* Tag */
+
+PB_EXPORT void
+pb_handle_pool_remove(
+  pb_handle_pool_t *pool,              /* Handle pool */
+  pb_handle_t handle);                 /* Handle */
+
+PB_EXPORT PB_WARN_UNUSED_RESULT
+pb_message_t
+pb_handle_pool_message(
+  pb_handle_pool_t *pool,              /* Handle pool */
+  pb_handle_t handle);                 /* Handle */
+
+PB_EXPORT PB_WARN_UNUSED_RESULT
+pb_error_t
+pb_handle_pool_align(
+  pb_handle_pool_t *pool);             /* Handle pool */
+
+/* ----------------------------------------------------------------------------
+ * Inline functions
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Retrieve the underlying journal of a handle pool.
+ *
+ * \param[in] pool Handle pool
+ * \return         Journal
+ */
+PB_INLINE pb_journal_t *
+pb_handle_pool_journal(pb_handle_pool_t *pool) {
+  assert(pool);
+  return pool->journal;
+}
+
+/*!
+ * Retrieve the number of live handles of a handle pool.
+ *
+ * \param[in] pool Handle pool
+ * \return         Handle count
+ */
+PB_INLINE size_t
+pb_handle_pool_size(const pb_handle_pool_t *pool) {
+  assert(pool);
+  return pool->slot.size - pool->free.size;
+}
+
+#endif /* PB_INCLUDE_MESSAGE_HANDLE_POOL_H */
@@ -26,8 +26,13 @@
 #include <assert.h>
 #include <stddef.h>
 #include <stdint.h>
+#include <sys/uio.h>
 
 #include <protobluff/core/allocator.h>
+#include <protobluff/core/decoder.h>
+#include <protobluff/core/descriptor.h>
+#include <protobluff/core/encoder.h>
+#include <protobluff/core/fragment.h>
 #include <protobluff/message/buffer.h>
 #include <protobluff/message/common.h>
 
@@ -35,18 +40,67 @@
  * Forward declarations
  * ------------------------------------------------------------------------- */
 
+struct pb_journal_edit_t;
 struct pb_journal_entry_t;
+struct pb_journal_external_t;
+struct pb_journal_snapshot_t;
+struct pb_trace_t;
 
 /* ----------------------------------------------------------------------------
  * Type definitions
  * ------------------------------------------------------------------------- */
 
+typedef void
+(*pb_journal_release_f)(
+  void *data);                         /*!< Release callback data */
+
+/* ------------------------------------------------------------------------- */
+
 typedef struct pb_journal_t {
   pb_buffer_t buffer;                  /*!< Buffer */
   struct {
     struct pb_journal_entry_t *data;   /*!< Journal entries */
     size_t size;                       /*!< Journal entry count */
+    size_t capacity;                   /*!< Journal entry capacity */
+    pb_version_t base;                 /*!< Version of first entry */
   } entry;
+  struct {
+    size_t *data;                      /*!< Minimum origins of entries */
+    size_t size;                       /*!< Leaf count */
+  } index;
+  struct {
+    int enabled;                       /*!< Gap buffer flag */
+    size_t offset;                     /*!< Gap offset */
+    size_t size;                       /*!< Gap size */
+  } gap;
+  struct {
+    int active;                        /*!< Batch flag */
+    pb_version_t version;              /*!< Version of container */
+    pb_offset_t offset;                /*!< Offsets of container */
+    ptrdiff_t delta;                   /*!< Pending delta of container */
+  } batch;
+  int padded;                          /*!< Padded length prefix flag */
+  int unordered;                       /*!< Unordered append flag */
+  size_t revision;                     /*!< Write count */
+  struct {
+    struct pb_journal_edit_t *data;    /*!< Recorded edits */
+    size_t size;                       /*!< Recorded edit count */
+    size_t capacity;                   /*!< Recorded edit capacity */
+    size_t base;                       /*!< Revision of first edit */
+    int enabled;                       /*!< Recording flag */
+  } edit;
+  int frozen;                          /*!< Read-only flag */
+  pb_allocator_t *shared;              /*!< Copy-on-write allocator */
+  struct pb_journal_snapshot_t
+    *snapshot;                         /*!< Shared data of snapshots */
+  struct {
+    struct pb_journal_external_t
+      **data;                          /*!< External segments */
+    size_t size;                       /*!< External segment count */
+    size_t capacity;                   /*!< External segment capacity */
+  } external;
+  pb_decoder_index_t fields;           /*!< Index of field offsets */
+  struct pb_trace_t *trace;            /*!< Recorder of operations */
 } pb_journal_t;
 
 /* ----------------------------------------------------------------------------
@@ -75,16 +129,174 @@ pb_journal_t
 pb_journal_create_empty_with_allocator(
   pb_allocator_t *allocator);          /* Allocator */
 
+PB_EXPORT PB_WARN_UNUSED_RESULT
+pb_journal_t
+pb_journal_create_padded(void);
+
+PB_EXPORT PB_WARN_UNUSED_RESULT
+pb_journal_t
+pb_journal_create_padded_with_allocator(
+  pb_allocator_t *allocator);          /* Allocator */
+
+PB_EXPORT PB_WARN_UNUSED_RESULT
+pb_journal_t
+pb_journal_create_gap_buffer(
+  const uint8_t data[],                /* Raw data */
+  size_t size);                        /* Raw data size */
+
+PB_EXPORT PB_WARN_UNUSED_RESULT
+pb_journal_t
+pb_journal_create_gap_buffer_with_allocator(
+  pb_allocator_t *allocator,           /* Allocator */
+  const uint8_t data[],                /* Raw data */
+  size_t size);                        /* Raw data size */
+
 PB_EXPORT PB_WARN_UNUSED_RESULT
 pb_journal_t
 pb_journal_create_zero_copy(
   uint8_t data[],                      /* Raw data */
   size_t size);                        /* Raw data size */
 
+PB_EXPORT PB_WARN_UNUSED_RESULT
+pb_journal_t
+pb_journal_create_copy_on_write(
+  const pb_buffer_t *buffer);          /* Buffer */
+
+PB_EXPORT PB_WARN_UNUSED_RESULT
+pb_journal_t
+pb_journal_snapshot(
+  pb_journal_t *journal);              /* Journal */
+
+PB_EXPORT PB_WARN_UNUSED_RESULT
+pb_journal_t
+pb_journal_create_from_buffer(
+  pb_buffer_t *buffer);                /* Buffer */
+
+PB_EXPORT PB_WARN_UNUSED_RESULT
+pb_journal_t
+pb_journal_create_from_encoder(
+  pb_encoder_t *encoder);              /* Encoder */
+
+PB_EXPORT PB_WARN_UNUSED_RESULT
+pb_journal_t
+pb_journal_create_readonly(
+  const uint8_t data[],                /* Raw data */
+  size_t size);                        /* Raw data size */
+
 PB_EXPORT void
 pb_journal_destroy(
   pb_journal_t *journal);              /* Journal */
 
+PB_EXPORT PB_WARN_UNUSED_RESULT
+pb_error_t
+pb_journal_compact(
+  pb_journal_t *journal,               /* Journal */
+  pb_version_t version);               /* Version */
+
+PB_EXPORT PB_WARN_UNUSED_RESULT
+pb_error_t
+pb_journal_checkpoint(
+  pb_journal_t *journal);              /* Journal */
+
+PB_EXPORT PB_WARN_UNUSED_RESULT
+pb_error_t
+pb_journal_trim(
+  pb_journal_t *journal);              /* Journal */
+
+PB_EXPORT PB_WARN_UNUSED_RESULT
+pb_error_t
+pb_journal_attach(
+  pb_journal_t *journal,               /* Journal */
+  pb_tag_t tag,                        /* Tag */
+  const pb_string_t *value,            /* Caller-owned value */
+  pb_journal_release_f release,        /* Release callback */
+  void *data);                         /* Release callback data */
+
+PB_EXPORT PB_WARN_UNUSED_RESULT
+pb_error_t
+pb_journal_attach_fragment(
+  pb_journal_t *journal,               /* Journal */
+  pb_fragment_t *fragment);            /* Fragment */
+
+PB_EXPORT void
+pb_journal_detach(
+  pb_journal_t *journal);              /* Journal */
+
+PB_EXPORT size_t
+pb_journal_length(
+  const pb_journal_t *journal);        /* Journal */
+
+PB_EXPORT size_t
+pb_journal_iovec(
+  const pb_journal_t *journal,         /* Journal */
+  struct iovec *iov,                   /* I/O vectors */
+  size_t size);                        /* I/O vector count */
+
+PB_EXPORT PB_WARN_UNUSED_RESULT
+pb_error_t
+pb_journal_set_index(
+  pb_journal_t *journal,               /* Journal */
+  pb_decoder_index_t *index);          /* Index */
+
+PB_EXPORT PB_WARN_UNUSED_RESULT
+pb_error_t
+pb_journal_set_trace(
+  pb_journal_t *journal,               /* Journal */
+  struct pb_trace_t *trace);           /* Trace or NULL */
+
+PB_EXPORT PB_WARN_UNUSED_RESULT
+pb_error_t
+pb_journal_pack(
+  pb_journal_t *journal,               /* Journal */
+  const pb_descriptor_t *descriptor);  /* Descriptor */
+
+PB_EXPORT void
+pb_journal_begin_batch(
+  pb_journal_t *journal);              /* Journal */
+
+PB_EXPORT PB_WARN_UNUSED_RESULT
+pb_error_t
+pb_journal_commit(
+  pb_journal_t *journal);              /* Journal */
+
+PB_EXPORT void
+pb_journal_flatten(
+  pb_journal_t *journal);              /* Journal */
+
+PB_EXPORT PB_WARN_UNUSED_RESULT
+pb_error_t
+pb_journal_freeze(
+  pb_journal_t *journal);              /* Journal */
+
+PB_EXPORT void
+pb_journal_set_unordered(
+  pb_journal_t *journal,               /* Journal */
+  int unordered);                      /* Unordered append flag */
+
+PB_EXPORT PB_WARN_UNUSED_RESULT
+pb_error_t
+pb_journal_reserve(
+  pb_journal_t *journal,               /* Journal */
+  size_t size);                        /* Total size */
+
+PB_EXPORT PB_WARN_UNUSED_RESULT
+pb_error_t
+pb_journal_record(
+  pb_journal_t *journal);              /* Journal */
+
+PB_EXPORT PB_WARN_UNUSED_RESULT
+pb_error_t
+pb_journal_diff(
+  pb_journal_t *journal,               /* Journal */
+  size_t revision,                     /* Revision */
+  pb_buffer_t *patch);                 /* Patch */
+
+PB_EXPORT PB_WARN_UNUSED_RESULT
+pb_error_t
+pb_journal_apply_patch(
+  pb_journal_t *journal,               /* Journal */
+  const pb_buffer_t *patch);           /* Patch */
+
 /* ----------------------------------------------------------------------------
  * Macros
  * ------------------------------------------------------------------------- */
@@ -92,12 +304,17 @@ pb_journal_destroy(
 /*!
  * Retrieve the underlying buffer of a journal.
  *
- * \param[in] journal Journal
- * \return            Buffer
+ * If the journal is backed by a gap buffer, the journal is flattened first,
+ * so the buffer's raw data is always contiguous.
+ *
+ * \param[in,out] journal Journal
+ * \return                Buffer
  */
 PB_INLINE pb_buffer_t *
 pb_journal_buffer(pb_journal_t *journal) {
   assert(journal);
+  if (journal->gap.size)
+    pb_journal_flatten(journal);
   return &(journal->buffer);
 }
 
@@ -111,19 +328,23 @@ pb_journal_buffer(pb_journal_t *journal) {
 PB_INLINE void
 pb_journal_dump(const pb_journal_t *journal) {
   assert(journal);
-  pb_buffer_dump(&(journal->buffer));
+  pb_buffer_dump(pb_journal_buffer((pb_journal_t *)journal));
 }
 
 /*!
  * Retrieve the raw data of a journal.
  *
+ * If the journal is backed by a gap buffer, it is lazily flattened. This does
+ * not alter the contents of the journal, only their physical layout, which is
+ * why this function may be called on a constant journal.
+ *
  * \param[in] journal Journal
  * \return            Raw data
  */
 PB_INLINE const uint8_t *
 pb_journal_data(const pb_journal_t *journal) {
   assert(journal);
-  return pb_buffer_data(&(journal->buffer));
+  return pb_buffer_data(pb_journal_buffer((pb_journal_t *)journal));
 }
 
 /*!
@@ -162,6 +383,45 @@ pb_journal_error(const pb_journal_t *journal) {
   return pb_buffer_error(&(journal->buffer));
 }
 
+/*!
+ * Retrieve the revision of a journal.
+ *
+ * In contrast to the version, which only changes when the size of the data
+ * changes, the revision is incremented on every write.
+ *
+ * \param[in] journal Journal
+ * \return            Revision
+ */
+PB_INLINE size_t
+pb_journal_revision(const pb_journal_t *journal) {
+  assert(journal);
+  return journal->revision;
+}
+
+/*!
+ * Test whether a journal is frozen, i.e. read-only.
+ *
+ * \param[in] journal Journal
+ * \return            Test result
+ */
+PB_INLINE int
+pb_journal_frozen(const pb_journal_t *journal) {
+  assert(journal);
+  return journal->frozen;
+}
+
+/*!
+ * Test whether new fields are appended to the end of their messages.
+ *
+ * \param[in] journal Journal
+ * \return            Test result
+ */
+PB_INLINE int
+pb_journal_unordered(const pb_journal_t *journal) {
+  assert(journal);
+  return journal->unordered;
+}
+
 /*!
  * Test whether a buffer is valid.
  *
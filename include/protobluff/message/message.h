@@ -25,8 +25,10 @@
 
 #include <assert.h>
 #include <stddef.h>
+#include <stdint.h>
 
 #include <protobluff/core/descriptor.h>
+#include <protobluff/core/layout.h>
 #include <protobluff/message/common.h>
 #include <protobluff/message/journal.h>
 #include <protobluff/message/part.h>
@@ -37,6 +39,8 @@
 
 struct pb_cursor_t;
 struct pb_field_t;
+struct pb_message_index_t;
+struct pb_message_map_t;
 
 /* ----------------------------------------------------------------------------
  * Type definitions
@@ -45,6 +49,8 @@ struct pb_field_t;
 typedef struct pb_message_t {
   const pb_descriptor_t *descriptor;   /*!< Descriptor */
   pb_part_t part;                      /*!< Part */
+  struct pb_message_index_t *index;    /*!< Field offset index */
+  struct pb_message_map_t *map;        /*!< Key indexes */
 } pb_message_t;
 
 /* ----------------------------------------------------------------------------
@@ -81,10 +87,23 @@ pb_message_create_from_field(
   const pb_descriptor_t *descriptor,   /* Descriptor */
   struct pb_field_t *field);           /* Bytes field */
 
+PB_EXPORT PB_WARN_UNUSED_RESULT
+pb_message_t
+pb_message_create_from_key(
+  pb_message_t *message,               /* Message */
+  pb_tag_t tag,                        /* Tag */
+  pb_tag_t key,                        /* Tag of key field */
+  const void *value);                  /* Pointer holding key value */
+
 PB_EXPORT void
 pb_message_destroy(
   pb_message_t *message);              /* Message */
 
+PB_EXPORT PB_WARN_UNUSED_RESULT
+pb_error_t
+pb_message_index(
+  pb_message_t *message);              /* Message */
+
 PB_EXPORT pb_error_t
 pb_message_check(
   const pb_message_t *message);        /* Message */
@@ -107,6 +126,29 @@ pb_message_get(
   pb_tag_t tag,                        /* Tag */
   void *value);                        /* Pointer receiving value */
 
+PB_EXPORT PB_WARN_UNUSED_RESULT
+pb_error_t
+pb_message_get_many(
+  pb_message_t *message,               /* Message */
+  const pb_tag_t tags[],               /* Tags */
+  void *values[],                      /* Pointers receiving values */
+  size_t size);                        /* Tag count */
+
+PB_EXPORT PB_WARN_UNUSED_RESULT
+pb_error_t
+pb_message_get_fields(
+  pb_message_t *message,               /* Message */
+  const pb_layout_t *layout,           /* Layout */
+  void *value);                        /* Pointer receiving struct */
+
+PB_EXPORT PB_WARN_UNUSED_RESULT
+pb_error_t
+pb_message_get_repeated(
+  pb_message_t *message,               /* Message */
+  pb_tag_t tag,                        /* Tag */
+  void *values,                        /* Pointer receiving values */
+  size_t *size);                       /* Value count */
+
 PB_EXPORT PB_WARN_UNUSED_RESULT
 pb_error_t
 pb_message_put(
@@ -114,17 +156,80 @@ pb_message_put(
   pb_tag_t tag,                        /* Tag */
   const void *value);                  /* Pointer holding value */
 
+PB_EXPORT PB_WARN_UNUSED_RESULT
+pb_error_t
+pb_message_put_many(
+  pb_message_t *message,               /* Message */
+  const pb_tag_t tags[],               /* Tags */
+  const void *const values[],          /* Pointers holding values */
+  size_t size);                        /* Tag count */
+
+PB_EXPORT PB_WARN_UNUSED_RESULT
+pb_error_t
+pb_message_put_packed(
+  pb_message_t *message,               /* Message */
+  pb_tag_t tag,                        /* Tag */
+  const void *values,                  /* Pointer holding values */
+  size_t size);                        /* Value count */
+
+PB_EXPORT PB_WARN_UNUSED_RESULT
+pb_error_t
+pb_message_put_repeated(
+  pb_message_t *message,               /* Message */
+  pb_tag_t tag,                        /* Tag */
+  const void *values,                  /* Pointer holding values */
+  size_t size);                        /* Value count */
+
+PB_EXPORT PB_WARN_UNUSED_RESULT
+pb_error_t
+pb_message_merge(
+  pb_message_t *message,               /* Message */
+  const pb_buffer_t *buffer);          /* Buffer */
+
 PB_EXPORT PB_WARN_UNUSED_RESULT
 pb_error_t
 pb_message_erase(
   pb_message_t *message,               /* Message */
   pb_tag_t tag);                       /* Tag */
 
+PB_EXPORT PB_WARN_UNUSED_RESULT
+pb_error_t
+pb_message_erase_many(
+  pb_message_t *message,               /* Message */
+  const pb_tag_t tags[],               /* Tags */
+  size_t size);                        /* Tag count */
+
+PB_EXPORT PB_WARN_UNUSED_RESULT
+pb_error_t
+pb_message_canonicalize(
+  pb_message_t *message);              /* Message */
+
 PB_EXPORT PB_WARN_UNUSED_RESULT
 pb_error_t
 pb_message_clear(
   pb_message_t *message);              /* Message */
 
+PB_EXPORT PB_WARN_UNUSED_RESULT
+pb_buffer_t
+pb_message_view(
+  pb_message_t *message);              /* Message */
+
+PB_EXPORT PB_WARN_UNUSED_RESULT
+pb_journal_t
+pb_message_detach(
+  pb_message_t *message);              /* Message */
+
+PB_EXPORT PB_WARN_UNUSED_RESULT
+pb_error_t
+pb_message_hash(
+  pb_message_t *message,               /* Message */
+  uint64_t *hash);                     /* Pointer receiving hash */
+
+PB_EXPORT int
+pb_message_equals(
+  pb_message_t *x,                     /* Message */
+  pb_message_t *y);                    /* Message */
+
 /* ----------------------------------------------------------------------------
  * Inline functions
  * ------------------------------------------------------------------------- */
@@ -25,8 +25,25 @@
 
 #include <stddef.h>
 
+#include <protobluff/core/descriptor.h>
 #include <protobluff/message/common.h>
 #include <protobluff/message/message.h>
+#include <protobluff/message/part.h>
+
+/* ----------------------------------------------------------------------------
+ * Type definitions
+ * ------------------------------------------------------------------------- */
+
+typedef struct pb_path_t {
+  const pb_descriptor_t *descriptor;   /*!< Descriptor of root message */
+  const pb_descriptor_t *nested;       /*!< Descriptor of submessage */
+  const pb_tag_t *tags;                /*!< Tags */
+  size_t size;                         /*!< Tag count */
+  struct {
+    pb_part_t root;                    /*!< Part of root message */
+    pb_part_t part;                    /*!< Part of submessage */
+  } cache;
+} pb_path_t;
 
 /* ----------------------------------------------------------------------------
  * Interface
@@ -68,4 +85,46 @@ pb_message_nested_erase(
   const pb_tag_t tags[],               /* Tags */
   size_t size);                        /* Tag count */
 
+PB_EXPORT PB_WARN_UNUSED_RESULT
+pb_path_t
+pb_path_create(
+  const pb_descriptor_t *descriptor,   /* Descriptor */
+  const pb_tag_t tags[],               /* Tags */
+  size_t size);                        /* Tag count */
+
+PB_EXPORT void
+pb_path_destroy(
+  pb_path_t *path);                    /* Path */
+
+PB_EXPORT int
+pb_message_path_has(
+  pb_message_t *message,               /* Message */
+  pb_path_t *path);                    /* Path */
+
+PB_EXPORT int
+pb_message_path_match(
+  pb_message_t *message,               /* Message */
+  pb_path_t *path,                     /* Path */
+  const void *value);                  /* Pointer holding value */
+
+PB_EXPORT PB_WARN_UNUSED_RESULT
+pb_error_t
+pb_message_path_get(
+  pb_message_t *message,               /* Message */
+  pb_path_t *path,                     /* Path */
+  void *value);                        /* Pointer receiving value */
+
+PB_EXPORT PB_WARN_UNUSED_RESULT
+pb_error_t
+pb_message_path_put(
+  pb_message_t *message,               /* Message */
+  pb_path_t *path,                     /* Path */
+  const void *value);                  /* Pointer holding value */
+
+PB_EXPORT PB_WARN_UNUSED_RESULT
+pb_error_t
+pb_message_path_erase(
+  pb_message_t *message,               /* Message */
+  pb_path_t *path);                    /* Path */
+
 #endif /* PB_INCLUDE_MESSAGE_NESTED_H */
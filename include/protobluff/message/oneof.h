@@ -42,9 +42,15 @@ struct pb_message_t;
 typedef struct pb_oneof_t {
   const pb_oneof_descriptor_t
     *descriptor;                       /*!< Oneof descriptor */
+  struct pb_message_t *message;        /*!< Message */
   pb_cursor_t cursor;                  /*!< Cursor */
 } pb_oneof_t;
 
+typedef pb_error_t
+(*pb_oneof_handler_f)(
+  pb_cursor_t *cursor,                 /*!< Cursor */
+  void *user);                         /*!< User data */
+
 /* ----------------------------------------------------------------------------
  * Interface
  * ------------------------------------------------------------------------- */
@@ -64,6 +70,12 @@ PB_EXPORT pb_tag_t
 pb_oneof_case(
   pb_oneof_t *oneof);                  /* Oneof */
 
+PB_EXPORT pb_error_t
+pb_oneof_dispatch(
+  pb_oneof_t *oneof,                   /* Oneof */
+  const pb_oneof_handler_f handlers[], /* Handlers by position */
+  void *user);                         /* User data */
+
 PB_EXPORT PB_WARN_UNUSED_RESULT
 pb_error_t
 pb_oneof_clear(
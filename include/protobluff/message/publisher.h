@@ -0,0 +1,80 @@
+/*
+ * Copyright (c) 2013-2020 Martin Donath <martin.donath@squidfunk.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#ifndef PB_INCLUDE_MESSAGE_PUBLISHER_H
+#define PB_INCLUDE_MESSAGE_PUBLISHER_H
+
+#include <assert.h>
+#include <stddef.h>
+
+#include <protobluff/message/common.h>
+#include <protobluff/message/journal.h>
+
+/* ----------------------------------------------------------------------------
+ * Type definitions
+ * ------------------------------------------------------------------------- */
+
+typedef struct pb_publisher_t {
+  pb_journal_t current;                /*!< Current generation */
+  size_t generation;                   /*!< Generation counter */
+  unsigned char lock;                  /*!< Spin lock */
+} pb_publisher_t;
+
+/* ----------------------------------------------------------------------------
+ * Interface
+ * ------------------------------------------------------------------------- */
+
+PB_EXPORT PB_WARN_UNUSED_RESULT
+pb_publisher_t
+pb_publisher_create(void);
+
+PB_EXPORT void
+pb_publisher_destroy(
+  pb_publisher_t *publisher);          /* Publisher */
+
+PB_EXPORT PB_WARN_UNUSED_RESULT
+pb_error_t
+pb_publisher_publish(
+  pb_publisher_t *publisher,           /* Publisher */
+  pb_journal_t *journal);              /* Journal */
+
+PB_EXPORT PB_WARN_UNUSED_RESULT
+pb_journal_t
+pb_publisher_acquire(
+  pb_publisher_t *publisher);          /* Publisher */
+
+/* ----------------------------------------------------------------------------
+ * Inline functions
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Retrieve the number of generations published by a publisher.
+ *
+ * \param[in] publisher Publisher
+ * \return              Generation
+ */
+PB_INLINE size_t
+pb_publisher_generation(const pb_publisher_t *publisher) {
+  assert(publisher);
+  return __atomic_load_n(&(publisher->generation), __ATOMIC_ACQUIRE);
+}
+
+#endif /* PB_INCLUDE_MESSAGE_PUBLISHER_H */
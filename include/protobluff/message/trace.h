@@ -0,0 +1,166 @@
+/*
+ * Copyright (c) 2013-2020 Martin Donath <martin.donath@squidfunk.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef PB_INCLUDE_MESSAGE_TRACE_H
+#define PB_INCLUDE_MESSAGE_TRACE_H
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <protobluff/core/allocator.h>
+#include <protobluff/core/buffer.h>
+#include <protobluff/core/common.h>
+#include <protobluff/message/common.h>
+
+/* ----------------------------------------------------------------------------
+ * Type definitions
+ * ------------------------------------------------------------------------- */
+
+typedef enum pb_trace_operation_t {
+  PB_TRACE_SNAPSHOT,                   /*!< Contents of journal */
+  PB_TRACE_MESSAGE_CREATE,             /*!< pb_message_create_within() */
+  PB_TRACE_MESSAGE_PUT,                /*!< pb_message_put() */
+  PB_TRACE_MESSAGE_ERASE,              /*!< pb_message_erase() */
+  PB_TRACE_MESSAGE_CLEAR,              /*!< pb_message_clear() */
+  PB_TRACE_CURSOR_PUT,                 /*!< pb_cursor_put() */
+  PB_TRACE_CURSOR_ERASE,               /*!< pb_cursor_erase() */
+  PB_TRACE_OPERATIONS                  /*!< Operation count */
+} pb_trace_operation_t;
+
+typedef enum pb_trace_flag_t {
+  PB_TRACE_PADDED     = 1,             /*!< Padded length prefixes */
+  PB_TRACE_UNORDERED  = 2,             /*!< Unordered appends */
+  PB_TRACE_GAP_BUFFER = 4              /*!< Gap buffer */
+} pb_trace_flag_t;
+
+/* ------------------------------------------------------------------------- */
+
+typedef struct pb_trace_record_t {
+  pb_trace_operation_t operation;      /*!< Operation */
+  size_t message;                      /*!< Start offset of message */
+  pb_tag_t tag;                        /*!< Tag */
+  size_t field;                        /*!< Start offset of field or flags */
+  struct {
+    const uint8_t *data;               /*!< Raw data */
+    size_t size;                       /*!< Raw data size */
+  } value;
+  pb_version_t version;                /*!< Journal version before operation */
+  struct {
+    pb_version_t version;              /*!< Version of message */
+    pb_offset_t offset;                /*!< Offsets of message, if outdated */
+  } part;
+  pb_error_t error;                    /*!< Error code of operation */
+  struct {
+    size_t before;                     /*!< Journal size before operation */
+    size_t after;                      /*!< Journal size after operation */
+  } size;
+} pb_trace_record_t;
+
+typedef struct pb_trace_t {
+  pb_buffer_t buffer;                  /*!< Recorded operations */
+  pb_version_t version;                /*!< Journal version of snapshot */
+  size_t size;                         /*!< Recorded operation count */
+  int active;                          /*!< Recording flag */
+  pb_error_t error;                    /*!< Error code */
+} pb_trace_t;
+
+/* ----------------------------------------------------------------------------
+ * Interface
+ * ------------------------------------------------------------------------- */
+
+PB_EXPORT PB_WARN_UNUSED_RESULT
+pb_trace_t
+pb_trace_create(void);
+
+PB_EXPORT PB_WARN_UNUSED_RESULT
+pb_trace_t
+pb_trace_create_with_allocator(
+  pb_allocator_t *allocator);          /* Allocator */
+
+PB_EXPORT void
+pb_trace_destroy(
+  pb_trace_t *trace);                  /* Trace */
+
+PB_EXPORT PB_WARN_UNUSED_RESULT
+pb_error_t
+pb_trace_read(
+  const uint8_t data[],                /* Raw data */
+  size_t size,                         /* Raw data size */
+  size_t *offset,                      /* Offset of next record */
+  pb_trace_record_t *record);          /* Record */
+
+/* ----------------------------------------------------------------------------
+ * Inline functions
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Retrieve the underlying buffer of a trace.
+ *
+ * \param[in] trace Trace
+ * \return          Buffer
+ */
+PB_INLINE const pb_buffer_t *
+pb_trace_buffer(const pb_trace_t *trace) {
+  assert(trace);
+  return &(trace->buffer);
+}
+
+/*!
+ * Retrieve the number of recorded operations of a trace.
+ *
+ * Snapshots of journals are not counted as operations.
+ *
+ * \param[in] trace Trace
+ * \return          Operation count
+ */
+PB_INLINE size_t
+pb_trace_size(const pb_trace_t *trace) {
+  assert(trace);
+  return trace->size;
+}
+
+/*!
+ * Retrieve the internal error state of a trace.
+ *
+ * \param[in] trace Trace
+ * \return          Error code
+ */
+PB_INLINE pb_error_t
+pb_trace_error(const pb_trace_t *trace) {
+  assert(trace);
+  return trace->error;
+}
+
+/*!
+ * Test whether a trace is valid.
+ *
+ * \param[in] trace Trace
+ * \return          Test result
+ */
+PB_INLINE int
+pb_trace_valid(const pb_trace_t *trace) {
+  assert(trace);
+  return !pb_trace_error(trace);
+}
+
+#endif /* PB_INCLUDE_MESSAGE_TRACE_H */
@@ -23,8 +23,18 @@
 #ifndef PB_INCLUDE_UTIL_H
 #define PB_INCLUDE_UTIL_H
 
+#include <protobluff/util/arena_allocator.h>
 #include <protobluff/util/chunk_allocator.h>
+#include <protobluff/util/delimited_block.h>
+#include <protobluff/util/delimited_index.h>
 #include <protobluff/util/descriptor.h>
+#include <protobluff/util/descriptor_set.h>
+#include <protobluff/util/hugepage_allocator.h>
+#include <protobluff/util/json.h>
+#include <protobluff/util/mmap.h>
+#include <protobluff/util/pool_allocator.h>
+#include <protobluff/util/tracing_allocator.h>
+#include <protobluff/util/uring_reader.h>
 #include <protobluff/util/validator.h>
 
 #endif /* PB_INCLUDE_UTIL_H */
@@ -28,6 +28,17 @@
 #include <protobluff/core/allocator.h>
 #include <protobluff/core/common.h>
 
+/* ----------------------------------------------------------------------------
+ * Type definitions
+ * ------------------------------------------------------------------------- */
+
+typedef struct pb_chunk_allocator_stats_t {
+  size_t chunks;                       /*!< Allocated chunks */
+  size_t bytes;                        /*!< Capacity of allocated chunks */
+  size_t cached;                       /*!< Chunks kept in free lists */
+  size_t allocations;                  /*!< Total number of allocations */
+} pb_chunk_allocator_stats_t;
+
 /* ----------------------------------------------------------------------------
  * Interface
  * ------------------------------------------------------------------------- */
@@ -45,4 +56,9 @@ PB_EXPORT void
 pb_chunk_allocator_destroy(
   pb_allocator_t *allocator);          /* Allocator */
 
+PB_EXPORT PB_WARN_UNUSED_RESULT
+pb_chunk_allocator_stats_t
+pb_chunk_allocator_stats(
+  const pb_allocator_t *allocator);    /* Allocator */
+
 #endif /* PB_INCLUDE_UTIL_CHUNK_ALLOCATOR_H */
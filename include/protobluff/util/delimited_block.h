@@ -0,0 +1,217 @@
+/*
+ * Copyright (c) 2013-2020 Martin Donath <martin.donath@squidfunk.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef PB_INCLUDE_UTIL_DELIMITED_BLOCK_H
+#define PB_INCLUDE_UTIL_DELIMITED_BLOCK_H
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <protobluff/core/buffer.h>
+#include <protobluff/core/common.h>
+#include <protobluff/core/delimited.h>
+
+/* ----------------------------------------------------------------------------
+ * Type definitions
+ * ------------------------------------------------------------------------- */
+
+typedef size_t
+(*pb_delimited_block_compress_f)(
+  void *data,                          /*!< Internal codec data */
+  const uint8_t source[],              /*!< Raw data */
+  size_t size,                         /*!< Raw data size */
+  uint8_t target[],                    /*!< Target buffer */
+  size_t capacity);                    /*!< Target buffer capacity */
+
+typedef size_t
+(*pb_delimited_block_decompress_f)(
+  void *data,                          /*!< Internal codec data */
+  const uint8_t source[],              /*!< Compressed data */
+  size_t size,                         /*!< Compressed data size */
+  uint8_t target[],                    /*!< Target buffer */
+  size_t capacity);                    /*!< Target buffer capacity */
+
+/* ------------------------------------------------------------------------- */
+
+typedef struct pb_delimited_block_codec_t {
+  struct {
+    pb_delimited_block_compress_f
+      compress;                        /*!< Compress a block */
+    pb_delimited_block_decompress_f
+      decompress;                      /*!< Decompress a block */
+  } proc;
+  void *data;                          /*!< Internal codec data */
+} pb_delimited_block_codec_t;
+
+typedef struct pb_delimited_block_writer_t {
+  int fd;                              /*!< File descriptor */
+  const pb_delimited_block_codec_t
+    *codec;                            /*!< Codec, NULL if none */
+  size_t threshold;                    /*!< Raw block size threshold */
+  pb_buffer_t block;                   /*!< Raw data of current block */
+  pb_buffer_t target;                  /*!< Compressed data */
+  pb_buffer_t index;                   /*!< Block index */
+  uint64_t offset;                     /*!< Offset of current block */
+  uint64_t first;                      /*!< First record of current block */
+  uint64_t records;                    /*!< Record count */
+} pb_delimited_block_writer_t;
+
+typedef struct pb_delimited_block_reader_t {
+  pb_buffer_t buffer;                  /*!< Buffer */
+  const pb_delimited_block_codec_t
+    *codec;                            /*!< Codec, NULL if none */
+  size_t index;                        /*!< Offset of block index */
+  size_t size;                         /*!< Block count */
+  size_t records;                      /*!< Record count */
+} pb_delimited_block_reader_t;
+
+/* ----------------------------------------------------------------------------
+ * Interface
+ * ------------------------------------------------------------------------- */
+
+PB_EXPORT PB_WARN_UNUSED_RESULT
+pb_delimited_block_writer_t
+pb_delimited_block_writer_create(
+  int fd,                              /* File descriptor */
+  const pb_delimited_block_codec_t
+    *codec,                            /* Codec, NULL if none */
+  size_t threshold);                   /* Raw block size threshold */
+
+PB_EXPORT void
+pb_delimited_block_writer_destroy(
+  pb_delimited_block_writer_t *writer);
+                                       /* Writer */
+
+PB_EXPORT PB_WARN_UNUSED_RESULT
+pb_error_t
+pb_delimited_block_writer_write(
+  pb_delimited_block_writer_t *writer, /* Writer */
+  const pb_buffer_t *message);         /* Message */
+
+PB_EXPORT PB_WARN_UNUSED_RESULT
+pb_error_t
+pb_delimited_block_writer_flush(
+  pb_delimited_block_writer_t *writer);
+                                       /* Writer */
+
+PB_EXPORT PB_WARN_UNUSED_RESULT
+pb_error_t
+pb_delimited_block_writer_finish(
+  pb_delimited_block_writer_t *writer);
+                                       /* Writer */
+
+PB_EXPORT PB_WARN_UNUSED_RESULT
+pb_delimited_block_reader_t
+pb_delimited_block_reader_create(
+  const pb_buffer_t *buffer,           /* Buffer */
+  const pb_delimited_block_codec_t
+    *codec);                           /* Codec, NULL if none */
+
+PB_EXPORT void
+pb_delimited_block_reader_destroy(
+  pb_delimited_block_reader_t *reader);
+                                       /* Reader */
+
+PB_EXPORT size_t
+pb_delimited_block_reader_first(
+  const pb_delimited_block_reader_t *reader,
+                                       /* Reader */
+  size_t block);                       /* Block number */
+
+PB_EXPORT size_t
+pb_delimited_block_reader_find(
+  const pb_delimited_block_reader_t *reader,
+                                       /* Reader */
+  size_t position);                    /* Message number */
+
+PB_EXPORT PB_WARN_UNUSED_RESULT
+pb_error_t
+pb_delimited_block_reader_read(
+  const pb_delimited_block_reader_t *reader,
+                                       /* Reader */
+  size_t block,                        /* Block number */
+  pb_buffer_t *buffer,                 /* Buffer for decompression */
+  pb_buffer_t *data);                  /* Buffer receiving block */
+
+PB_EXPORT PB_WARN_UNUSED_RESULT
+pb_error_t
+pb_delimited_block_reader_seek(
+  const pb_delimited_block_reader_t *reader,
+                                       /* Reader */
+  size_t position,                     /* Message number */
+  pb_buffer_t *buffer,                 /* Buffer for decompression */
+  pb_delimited_reader_t *delimited);   /* Delimited reader */
+
+/* ----------------------------------------------------------------------------
+ * Inline functions
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Retrieve the internal error state of a block reader.
+ *
+ * \param[in] reader Reader
+ * \return           Error code
+ */
+PB_INLINE pb_error_t
+pb_delimited_block_reader_error(const pb_delimited_block_reader_t *reader) {
+  assert(reader);
+  return pb_buffer_error(&(reader->buffer));
+}
+
+/*!
+ * Test whether a block reader is valid.
+ *
+ * \param[in] reader Reader
+ * \return           Test result
+ */
+PB_INLINE int
+pb_delimited_block_reader_valid(const pb_delimited_block_reader_t *reader) {
+  assert(reader);
+  return !pb_delimited_block_reader_error(reader);
+}
+
+/*!
+ * Retrieve the number of blocks of a block reader.
+ *
+ * \param[in] reader Reader
+ * \return           Block count
+ */
+PB_INLINE size_t
+pb_delimited_block_reader_size(const pb_delimited_block_reader_t *reader) {
+  assert(reader);
+  return reader->size;
+}
+
+/*!
+ * Retrieve the number of messages of a block reader.
+ *
+ * \param[in] reader Reader
+ * \return           Message count
+ */
+PB_INLINE size_t
+pb_delimited_block_reader_records(const pb_delimited_block_reader_t *reader) {
+  assert(reader);
+  return reader->records;
+}
+
+#endif /* PB_INCLUDE_UTIL_DELIMITED_BLOCK_H */
@@ -0,0 +1,115 @@
+/*
+ * Copyright (c) 2013-2020 Martin Donath <martin.donath@squidfunk.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef PB_INCLUDE_UTIL_DELIMITED_INDEX_H
+#define PB_INCLUDE_UTIL_DELIMITED_INDEX_H
+
+#include <assert.h>
+#include <stddef.h>
+
+#include <protobluff/core/buffer.h>
+#include <protobluff/core/common.h>
+#include <protobluff/core/delimited.h>
+
+/* ----------------------------------------------------------------------------
+ * Type definitions
+ * ------------------------------------------------------------------------- */
+
+typedef struct pb_delimited_index_t {
+  pb_buffer_t buffer;                  /*!< Buffer */
+  size_t interval;                     /*!< Sampling interval */
+  size_t size;                         /*!< Message count */
+} pb_delimited_index_t;
+
+/* ----------------------------------------------------------------------------
+ * Interface
+ * ------------------------------------------------------------------------- */
+
+PB_EXPORT PB_WARN_UNUSED_RESULT
+pb_delimited_index_t
+pb_delimited_index_create(
+  const pb_buffer_t *buffer,           /* Buffer */
+  size_t interval);                    /* Sampling interval */
+
+PB_EXPORT PB_WARN_UNUSED_RESULT
+pb_delimited_index_t
+pb_delimited_index_create_mmap(
+  const char path[]);                  /* Path */
+
+PB_EXPORT void
+pb_delimited_index_destroy(
+  pb_delimited_index_t *index);        /* Index */
+
+PB_EXPORT PB_WARN_UNUSED_RESULT
+pb_error_t
+pb_delimited_index_write(
+  const pb_delimited_index_t *index,   /* Index */
+  const char path[]);                  /* Path */
+
+PB_EXPORT PB_WARN_UNUSED_RESULT
+pb_error_t
+pb_delimited_index_seek(
+  const pb_delimited_index_t *index,   /* Index */
+  pb_delimited_reader_t *reader,       /* Reader */
+  size_t position);                    /* Message number */
+
+/* ----------------------------------------------------------------------------
+ * Inline functions
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Retrieve the internal error state of a delimited index.
+ *
+ * \param[in] index Index
+ * \return          Error code
+ */
+PB_INLINE pb_error_t
+pb_delimited_index_error(const pb_delimited_index_t *index) {
+  assert(index);
+  return pb_buffer_error(&(index->buffer));
+}
+
+/*!
+ * Test whether a delimited index is valid.
+ *
+ * \param[in] index Index
+ * \return          Test result
+ */
+PB_INLINE int
+pb_delimited_index_valid(const pb_delimited_index_t *index) {
+  assert(index);
+  return !pb_delimited_index_error(index);
+}
+
+/*!
+ * Retrieve the number of messages of a delimited index.
+ *
+ * \param[in] index Index
+ * \return          Message count
+ */
+PB_INLINE size_t
+pb_delimited_index_size(const pb_delimited_index_t *index) {
+  assert(index);
+  return index->size;
+}
+
+#endif /* PB_INCLUDE_UTIL_DELIMITED_INDEX_H */
@@ -0,0 +1,118 @@
+/*
+ * Copyright (c) 2013-2020 Martin Donath <martin.donath@squidfunk.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef PB_INCLUDE_UTIL_DESCRIPTOR_SET_H
+#define PB_INCLUDE_UTIL_DESCRIPTOR_SET_H
+
+#include <assert.h>
+#include <stddef.h>
+
+#include <protobluff/core/allocator.h>
+#include <protobluff/core/buffer.h>
+#include <protobluff/core/common.h>
+#include <protobluff/core/descriptor.h>
+
+/* ----------------------------------------------------------------------------
+ * Type definitions
+ * ------------------------------------------------------------------------- */
+
+typedef struct pb_descriptor_set_entry_t {
+  const char *name;                    /*!< Full name */
+  pb_type_t type;                      /*!< Message or enum type */
+  const void *descriptor;              /*!< Message or enum descriptor */
+  const pb_enum_t *value;              /*!< First declared enum value */
+} pb_descriptor_set_entry_t;
+
+typedef struct pb_descriptor_set_t {
+  pb_allocator_t allocator;            /*!< Arena allocator */
+  struct {
+    const pb_descriptor_set_entry_t
+      *data;                           /*!< Entries sorted by full name */
+    size_t size;                       /*!< Entry count */
+  } entry;
+  pb_error_t error;                    /*!< Error code */
+} pb_descriptor_set_t;
+
+/* ----------------------------------------------------------------------------
+ * Interface
+ * ------------------------------------------------------------------------- */
+
+PB_EXPORT PB_WARN_UNUSED_RESULT
+pb_descriptor_set_t
+pb_descriptor_set_create(
+  const pb_buffer_t *buffer);          /* Buffer */
+
+PB_EXPORT void
+pb_descriptor_set_destroy(
+  pb_descriptor_set_t *set);           /* Descriptor set */
+
+PB_EXPORT const pb_descriptor_t *
+pb_descriptor_set_message(
+  const pb_descriptor_set_t *set,      /* Descriptor set */
+  const char name[]);                  /* Full name */
+
+PB_EXPORT const pb_enum_descriptor_t *
+pb_descriptor_set_enum(
+  const pb_descriptor_set_t *set,      /* Descriptor set */
+  const char name[]);                  /* Full name */
+
+/* ----------------------------------------------------------------------------
+ * Inline functions
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Retrieve the internal error state of a descriptor set.
+ *
+ * \param[in] set Descriptor set
+ * \return        Error code
+ */
+PB_INLINE pb_error_t
+pb_descriptor_set_error(const pb_descriptor_set_t *set) {
+  assert(set);
+  return set->error;
+}
+
+/*!
+ * Test whether a descriptor set is valid.
+ *
+ * \param[in] set Descriptor set
+ * \return        Test result
+ */
+PB_INLINE int
+pb_descriptor_set_valid(const pb_descriptor_set_t *set) {
+  assert(set);
+  return !pb_descriptor_set_error(set);
+}
+
+/*!
+ * Retrieve the number of message and enum descriptors of a descriptor set.
+ *
+ * \param[in] set Descriptor set
+ * \return        Descriptor count
+ */
+PB_INLINE size_t
+pb_descriptor_set_size(const pb_descriptor_set_t *set) {
+  assert(set);
+  return set->entry.size;
+}
+
+#endif /* PB_INCLUDE_UTIL_DESCRIPTOR_SET_H */
@@ -0,0 +1,61 @@
+/*
+ * Copyright (c) 2013-2020 Martin Donath <martin.donath@squidfunk.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef PB_INCLUDE_UTIL_MMAP_H
+#define PB_INCLUDE_UTIL_MMAP_H
+
+#include <protobluff/core/buffer.h>
+#include <protobluff/core/common.h>
+#include <protobluff/message/journal.h>
+
+/* ----------------------------------------------------------------------------
+ * Constants
+ * ------------------------------------------------------------------------- */
+
+#define PB_MMAP_SEQUENTIAL 1           /*!< Flag: sequential access hint */
+#define PB_MMAP_RANDOM     2           /*!< Flag: random access hint */
+#define PB_MMAP_PRIVATE    4           /*!< Flag: private copy-on-write */
+#define PB_MMAP_PERSISTENT 8           /*!< Flag: persistent saves */
+
+/* ----------------------------------------------------------------------------
+ * Interface
+ * ------------------------------------------------------------------------- */
+
+PB_EXPORT PB_WARN_UNUSED_RESULT
+pb_buffer_t
+pb_buffer_create_mmap(
+  const char path[],                   /* Path */
+  int flags);                          /* Flags */
+
+PB_EXPORT PB_WARN_UNUSED_RESULT
+pb_journal_t
+pb_journal_create_mmap(
+  const char path[],                   /* Path */
+  int flags);                          /* Flags */
+
+PB_EXPORT PB_WARN_UNUSED_RESULT
+pb_error_t
+pb_journal_save_mmap(
+  pb_journal_t *journal,               /* Journal */
+  const char path[]);                  /* Path */
+
+#endif /* PB_INCLUDE_UTIL_MMAP_H */
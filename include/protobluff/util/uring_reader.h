@@ -0,0 +1,119 @@
+/*
+ * Copyright (c) 2013-2020 Martin Donath <martin.donath@squidfunk.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#ifndef PB_INCLUDE_UTIL_URING_READER_H
+#define PB_INCLUDE_UTIL_URING_READER_H
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#include <protobluff/core/buffer.h>
+#include <protobluff/core/common.h>
+
+/* ----------------------------------------------------------------------------
+ * Type definitions
+ * ------------------------------------------------------------------------- */
+
+typedef struct pb_uring_reader_t {
+  struct pb_uring_t *ring;             /*!< Ring, NULL if reads are blocking */
+  int fd;                              /*!< File descriptor */
+  off_t base;                          /*!< File offset of first region */
+  struct {
+    uint8_t *data;                     /*!< Regions */
+    size_t *size;                      /*!< Bytes read, SIZE_MAX if pending */
+    size_t capacity;                   /*!< Region capacity */
+    size_t count;                      /*!< Region count */
+  } region;
+  size_t chunk;                        /*!< Chunk at current position */
+  size_t offset;                       /*!< Offset within chunk */
+  size_t submitted;                    /*!< Chunks submitted */
+  size_t end;                          /*!< Chunk count, SIZE_MAX if unknown */
+  pb_buffer_t spill;                   /*!< Buffer for spanning messages */
+  pb_error_t error;                    /*!< Error code */
+} pb_uring_reader_t;
+
+/* ----------------------------------------------------------------------------
+ * Interface
+ * ------------------------------------------------------------------------- */
+
+PB_EXPORT PB_WARN_UNUSED_RESULT
+pb_uring_reader_t
+pb_uring_reader_create(
+  int fd,                              /* File descriptor */
+  size_t capacity,                     /* Region capacity */
+  size_t count);                       /* Region count */
+
+PB_EXPORT void
+pb_uring_reader_destroy(
+  pb_uring_reader_t *reader);          /* Reader */
+
+PB_EXPORT PB_WARN_UNUSED_RESULT
+pb_error_t
+pb_uring_reader_next(
+  pb_uring_reader_t *reader,           /* Reader */
+  pb_buffer_t *message);               /* Buffer receiving message */
+
+/* ----------------------------------------------------------------------------
+ * Inline functions
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Retrieve the internal error state of an io_uring reader.
+ *
+ * \param[in] reader Reader
+ * \return           Error code
+ */
+PB_INLINE pb_error_t
+pb_uring_reader_error(const pb_uring_reader_t *reader) {
+  assert(reader);
+  return reader->error;
+}
+
+/*!
+ * Test whether an io_uring reader is valid.
+ *
+ * \param[in] reader Reader
+ * \return           Test result
+ */
+PB_INLINE int
+pb_uring_reader_valid(const pb_uring_reader_t *reader) {
+  assert(reader);
+  return !pb_uring_reader_error(reader);
+}
+
+/*!
+ * Test whether an io_uring reader keeps reads in flight asynchronously.
+ *
+ * If io_uring is not supported by the platform or kernel, or the regions
+ * could not be registered, the reader falls back to blocking reads.
+ *
+ * \param[in] reader Reader
+ * \return           Test result
+ */
+PB_INLINE int
+pb_uring_reader_async(const pb_uring_reader_t *reader) {
+  assert(reader);
+  return reader->ring != NULL;
+}
+
+#endif /* PB_INCLUDE_UTIL_URING_READER_H */
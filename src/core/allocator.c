@@ -21,9 +21,36 @@
  */
 
 #include <assert.h>
+#include <pthread.h>
 #include <stdlib.h>
 
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif /* __GLIBC__ */
+
 #include "core/allocator.h"
+#include "core/common.h"
+
+/* ----------------------------------------------------------------------------
+ * Type definitions
+ * ------------------------------------------------------------------------- */
+
+typedef struct pb_allocator_trim_t {
+  pthread_mutex_t lock;                /*!< Lock */
+  pb_allocator_trim_f hook[            /*!< Registered hooks */
+    PB_ALLOCATOR_TRIM_HOOKS];
+  size_t size;                         /*!< Number of registered hooks */
+} pb_allocator_trim_t;
+
+/* ----------------------------------------------------------------------------
+ * Variables
+ * ------------------------------------------------------------------------- */
+
+/*! Registry of trim hooks */
+static pb_allocator_trim_t
+trim = {
+  .lock = PTHREAD_MUTEX_INITIALIZER
+};
 
 /* ----------------------------------------------------------------------------
  * System-default allocator callbacks
@@ -86,3 +113,61 @@ allocator_default = {
 /*! Zero-copy fake-allocator */
 pb_allocator_t
 allocator_zero_copy = {};
+
+/*! Fixed-capacity fake-allocator */
+pb_allocator_t
+allocator_fixed = {};
+
+/* ----------------------------------------------------------------------------
+ * Interface
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Register a hook that releases memory cached by a custom allocator.
+ *
+ * Hooks are invoked by pb_allocator_trim(), so allocators that keep freed
+ * blocks around for reuse, like the pool allocator, can hand them back when
+ * the process becomes idle. Registering a hook twice has no effect.
+ *
+ * \param[in] hook Trim hook
+ * \return         Error code
+ */
+extern pb_error_t
+pb_allocator_trim_register(pb_allocator_trim_f hook) {
+  assert(hook);
+  pb_error_t error = PB_ERROR_NONE;
+  pthread_mutex_lock(&(trim.lock));
+  size_t h = 0;
+  while (h < trim.size && trim.hook[h] != hook)
+    h++;
+
+  /* Append hook, if not already registered and space is left */
+  if (h == trim.size) {
+    if (unlikely_(trim.size == PB_ALLOCATOR_TRIM_HOOKS)) {
+      error = PB_ERROR_ALLOC;
+    } else {
+      trim.hook[trim.size++] = hook;
+    }
+  }
+  pthread_mutex_unlock(&(trim.lock));
+  return error;
+}
+
+/*!
+ * Release memory cached by allocators back to the operating system.
+ *
+ * All registered trim hooks are invoked in order of registration, after which
+ * the system allocator is asked to return free memory at the top of the heap
+ * and in its arenas, where supported. This is intended to be called when the
+ * process becomes idle, e.g. after trimming journals and encoders.
+ */
+extern void
+pb_allocator_trim(void) {
+  pthread_mutex_lock(&(trim.lock));
+  for (size_t h = 0; h < trim.size; h++)
+    trim.hook[h]();
+  pthread_mutex_unlock(&(trim.lock));
+#ifdef __GLIBC__
+  malloc_trim(0);
+#endif /* __GLIBC__ */
+}
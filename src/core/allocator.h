@@ -37,4 +37,8 @@ allocator_default;
 extern pb_allocator_t
 allocator_zero_copy;
 
+/*! Fixed-capacity fake-allocator */
+extern pb_allocator_t
+allocator_fixed;
+
 #endif /* PB_CORE_ALLOCATOR_H */
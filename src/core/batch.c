@@ -0,0 +1,408 @@
+/*
+ * Copyright (c) 2013-2020 Martin Donath <martin.donath@squidfunk.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <assert.h>
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "core/allocator.h"
+#include "core/batch.h"
+#include "core/buffer.h"
+#include "core/common.h"
+#include "core/decoder.h"
+#include "core/descriptor.h"
+#include "core/encoder.h"
+#include "core/stream.h"
+
+/* ----------------------------------------------------------------------------
+ * Constants
+ * ------------------------------------------------------------------------- */
+
+/*! Number of chunks per thread a batch is split into */
+#define PB_BATCH_CHUNKS 16
+
+/* ----------------------------------------------------------------------------
+ * Type definitions
+ * ------------------------------------------------------------------------- */
+
+typedef struct pb_batch_t {
+  const pb_descriptor_t *descriptor;   /*!< Descriptor */
+  const pb_buffer_t *buffers;          /*!< Buffers */
+  size_t size;                         /*!< Buffer count */
+  size_t chunk;                        /*!< Chunk size */
+  size_t next;                         /*!< Next unclaimed buffer */
+  uint8_t flags;                       /*!< Decoder flags */
+  pb_decoder_handler_f handler;        /*!< Handler */
+  pb_decoder_element_f element;        /*!< Element handler */
+  pb_encoder_t *encoders;              /*!< Encoders */
+  pb_encoder_element_f encode;         /*!< Encoder element handler */
+} pb_batch_t;
+
+typedef struct pb_batch_worker_t {
+  pb_batch_t *batch;                   /*!< Batch */
+  void *user;                          /*!< User data */
+  size_t position;                     /*!< Position of first failure */
+  pb_error_t error;                    /*!< Error code of first failure */
+  pthread_t thread;                    /*!< Thread */
+} pb_batch_worker_t;
+
+/* ----------------------------------------------------------------------------
+ * Internal functions
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Decode a single buffer of a batch.
+ *
+ * \param[in]     batch    Batch
+ * \param[in]     position Position
+ * \param[in,out] user     User data
+ * \return                 Error code
+ */
+static pb_error_t
+decode(const pb_batch_t *batch, size_t position, void *user) {
+  assert(batch);
+  pb_decoder_t decoder = pb_decoder_create_with_flags(
+    batch->descriptor, &(batch->buffers[position]), batch->flags);
+  pb_error_t error = batch->element
+    ? batch->element(position, &decoder, user)
+    : pb_decoder_decode(&decoder, batch->handler, user);
+  pb_decoder_destroy(&decoder);
+  return error;
+}
+
+/*!
+ * Process chunks of a batch until all chunks are claimed.
+ *
+ * Chunks are claimed with a single atomic increment, so threads which finish
+ * early take over the remaining work of slower ones without any locking. The
+ * first failure in batch order is recorded, but processing continues.
+ *
+ * \param[in,out] data Worker
+ * \return             Worker
+ */
+static void *
+work(void *data) {
+  assert(data);
+  pb_batch_worker_t *worker = data;
+  pb_batch_t *batch = worker->batch;
+  for (;;) {
+    size_t start = __atomic_fetch_add(
+      &(batch->next), batch->chunk, __ATOMIC_RELAXED);
+    if (start >= batch->size)
+      break;
+
+    /* Decode or encode all elements of the chunk */
+    size_t end = batch->size - start > batch->chunk
+      ? start + batch->chunk
+      : batch->size;
+    for (size_t b = start; b < end; b++) {
+      pb_error_t error = batch->encoders
+        ? batch->encode(b, &(batch->encoders[b]), worker->user)
+        : decode(batch, b, worker->user);
+      if (unlikely_(error && b < worker->position)) {
+        worker->position = b;
+        worker->error    = error;
+      }
+    }
+  }
+  return worker;
+}
+
+/*!
+ * Process all elements of a batch across the given number of threads.
+ *
+ * \param[in,out] batch   Batch
+ * \param[in,out] user[]  User data per thread
+ * \param[in]     threads Thread count
+ * \return                Error code
+ */
+static pb_error_t
+run(pb_batch_t *batch, void *user[], size_t threads) {
+  assert(batch && user && threads);
+  batch->chunk = batch->size / (threads * PB_BATCH_CHUNKS) + 1;
+  batch->next  = 0;
+
+  /* Don't spawn more threads than there are chunks */
+  size_t chunks = (batch->size + batch->chunk - 1) / batch->chunk;
+  if (threads > chunks)
+    threads = chunks ? chunks : 1;
+
+  /* Allocate workers */
+  pb_batch_worker_t *workers = pb_allocator_allocate(
+    &allocator_default, sizeof(pb_batch_worker_t) * threads);
+  if (unlikely_(!workers))
+    return PB_ERROR_ALLOC;                                 /* LCOV_EXCL_LINE */
+  for (size_t t = 0; t < threads; t++) {
+    pb_batch_worker_t worker = {
+      .batch    = batch,
+      .user     = user[t],
+      .position = SIZE_MAX,
+      .error    = PB_ERROR_NONE
+    };
+    workers[t] = worker;
+  }
+
+  /* Spawn threads, marking threads that failed to spawn */
+  for (size_t t = 1; t < threads; t++)
+    if (unlikely_(pthread_create(&(workers[t].thread), NULL,
+                                 work, &(workers[t]))))
+      workers[t].batch = NULL;                             /* LCOV_EXCL_LINE */
+
+  /* Work in calling thread and join all spawned threads */
+  work(&(workers[0]));
+  pb_batch_worker_t *first = &(workers[0]);
+  for (size_t t = 1; t < threads; t++) {
+    if (likely_(workers[t].batch != NULL))
+      pthread_join(workers[t].thread, NULL);
+    if (workers[t].position < first->position)
+      first = &(workers[t]);
+  }
+
+  /* Free workers and return error code of first failure */
+  pb_error_t error = first->error;
+  pb_allocator_free(&allocator_default, workers);
+  return error;
+}
+
+/* ----------------------------------------------------------------------------
+ * Interface
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Decode a batch of independent messages across the given number of threads.
+ *
+ * The calling thread takes part in decoding, so only one thread less is
+ * spawned. Each thread passes its own user data to the handler, which is why
+ * the handler may accumulate results without synchronization. Messages decoded
+ * by the same thread are decoded in batch order, but fields of messages of
+ * different threads are interleaved arbitrarily.
+ *
+ * Descriptors and decoders are never altered during decoding, so they may be
+ * shared between threads without locking. The only exception is registering
+ * an extension with pb_descriptor_extend(), which must not happen while the
+ * descriptor is in use.
+ *
+ * If spawning a thread fails, its share of work is taken over by the others,
+ * so the batch is always decoded entirely. The error code of the first failed
+ * message in batch order is returned.
+ *
+ * \param[in]     descriptor Descriptor
+ * \param[in]     buffers[]  Buffers
+ * \param[in]     size       Buffer count
+ * \param[in]     handler    Handler
+ * \param[in,out] user[]     User data per thread
+ * \param[in]     threads    Thread count
+ * \return                   Error code
+ */
+extern pb_error_t
+pb_decoder_decode_batch(
+    const pb_descriptor_t *descriptor, const pb_buffer_t buffers[],
+    size_t size, pb_decoder_handler_f handler, void *user[], size_t threads) {
+  assert(descriptor && (buffers || !size) && handler && user && threads);
+  pb_batch_t batch = {
+    .descriptor = descriptor,
+    .buffers    = buffers,
+    .size       = size,
+    .flags      = 0,
+    .handler    = handler
+  };
+  return run(&batch, user, threads);
+}
+
+/*!
+ * Split a message into the elements of a repeated nested message field.
+ *
+ * Only the top-level fields of the message are scanned, skipping all values
+ * without decoding them, so the scan is much faster than decoding. At most
+ * the given number of elements is written, but the number of elements found
+ * is always returned, so the caller can retry with sufficient space. All
+ * other fields are ignored. The elements are zero-copy buffers pointing into
+ * the buffer of the decoder.
+ *
+ * \param[in]     decoder    Decoder
+ * \param[in]     tag        Tag of repeated field
+ * \param[out]    elements[] Elements
+ * \param[in,out] size       Element capacity, then element count
+ * \return                   Error code
+ */
+extern pb_error_t
+pb_decoder_split(
+    const pb_decoder_t *decoder, pb_tag_t tag, pb_buffer_t elements[],
+    size_t *size) {
+  assert(decoder && (elements || !*size) && size);
+  if (unlikely_(!pb_decoder_valid(decoder)))
+    return PB_ERROR_INVALID;
+
+  /* Scan top-level fields and record elements */
+  size_t capacity = *size, count = 0;
+  pb_stream_t stream = pb_stream_create(decoder->buffer);
+  pb_error_t error = PB_ERROR_NONE;
+  while (!error && pb_stream_left(&stream)) {
+    uint32_t key;
+    if (unlikely_(error = pb_stream_read_uint32(&stream, &key)))
+      break;
+
+    /* Skip all other fields */
+    if ((key >> 3) != tag || (key & 7) != PB_WIRETYPE_LENGTH) {
+      error = pb_decoder_skip_field(&stream, key);
+      continue;
+    }
+
+    /* Record element, if there's space left */
+    pb_string_t value;
+    if (likely_(!(error = pb_stream_read_length(&stream, &value)))) {
+      if (count < capacity)
+        elements[count] = pb_buffer_create_zero_copy_internal(
+          (uint8_t *)pb_string_data(&value), pb_string_size(&value));
+      count++;
+    }
+  }
+  pb_stream_destroy(&stream);
+
+  /* Return element count */
+  *size = count;
+  return error;
+}
+
+/*!
+ * Decode the elements of a repeated nested message field across threads.
+ *
+ * This is a two-phase operation: the message is first split into its elements
+ * with pb_decoder_split(), which are then decoded like a batch, so a single
+ * huge message can be decoded on multiple cores. A decoder is created for
+ * each element, inheriting the flags of the given decoder, and is handed to
+ * the handler together with the index of the element, so results can be
+ * stored in order. See pb_decoder_decode_batch() for details on threading.
+ *
+ * \param[in]     decoder Decoder
+ * \param[in]     tag     Tag of repeated field
+ * \param[in]     handler Element handler
+ * \param[in,out] user[]  User data per thread
+ * \param[in]     threads Thread count
+ * \return                Error code
+ */
+extern pb_error_t
+pb_decoder_decode_split(
+    const pb_decoder_t *decoder, pb_tag_t tag, pb_decoder_element_f handler,
+    void *user[], size_t threads) {
+  assert(decoder && handler && user && threads);
+  if (unlikely_(!pb_decoder_valid(decoder)))
+    return PB_ERROR_INVALID;
+
+  /* Ensure that the field is a nested message */
+  const pb_field_descriptor_t *field =
+    pb_descriptor_field_by_tag(decoder->descriptor, tag);
+  if (unlikely_(!field || !pb_field_descriptor_nested(field)))
+    return PB_ERROR_INVALID;
+
+  /* Count elements, then allocate and record them */
+  size_t size = 0;
+  pb_error_t error = pb_decoder_split(decoder, tag, NULL, &size);
+  if (unlikely_(error || !size))
+    return error;
+  pb_buffer_t *elements = pb_allocator_allocate(
+    &allocator_default, sizeof(pb_buffer_t) * size);
+  if (unlikely_(!elements))
+    return PB_ERROR_ALLOC;                                 /* LCOV_EXCL_LINE */
+  error = pb_decoder_split(decoder, tag, elements, &size);
+  assert(!error);
+
+  /* Decode elements across threads */
+  pb_batch_t batch = {
+    .descriptor = pb_field_descriptor_nested(field),
+    .buffers    = elements,
+    .size       = size,
+    .flags      = decoder->flags,
+    .element    = handler
+  };
+  error = run(&batch, user, threads);
+  pb_allocator_free(&allocator_default, elements);
+  return error;
+}
+
+/*!
+ * Encode independent nested messages across threads and append them.
+ *
+ * The given number of encoders for the nested message type of the field is
+ * created, and every encoder is handed to the handler together with its index
+ * on one of the threads, so the nested messages are encoded in parallel. See
+ * pb_decoder_decode_batch() for details on threading. Afterwards, the exact
+ * size of all nested messages including tags and length prefixes is computed
+ * from their lengths, and they're appended to the encoder in order, growing
+ * its buffer only once. If the encoder references large payloads, the
+ * segments of the nested messages are taken over instead of copied.
+ *
+ * Nested messages are always encoded with the default allocator, as the
+ * allocator of the encoder may not be safe to use from multiple threads. If
+ * any handler fails, nothing is appended to the encoder.
+ *
+ * \param[in,out] encoder Encoder
+ * \param[in]     tag     Tag of repeated field
+ * \param[in]     size    Nested message count
+ * \param[in]     handler Element handler
+ * \param[in,out] user[]  User data per thread
+ * \param[in]     threads Thread count
+ * \return                Error code
+ */
+extern pb_error_t
+pb_encoder_encode_batch(
+    pb_encoder_t *encoder, pb_tag_t tag, size_t size,
+    pb_encoder_element_f handler, void *user[], size_t threads) {
+  assert(encoder && tag && handler && user && threads);
+  if (unlikely_(!pb_encoder_valid(encoder)))
+    return PB_ERROR_INVALID;
+
+  /* Ensure that the field is a repeated nested message */
+  const pb_field_descriptor_t *field =
+    pb_descriptor_field_by_tag(encoder->descriptor, tag);
+  if (unlikely_(!field || !pb_field_descriptor_nested(field) ||
+      (size > 1 && pb_field_descriptor_label(field) != PB_LABEL_REPEATED)))
+    return PB_ERROR_INVALID;
+  if (unlikely_(!size))
+    return PB_ERROR_NONE;
+
+  /* Create an encoder for every nested message */
+  const pb_descriptor_t *descriptor = pb_field_descriptor_nested(field);
+  pb_encoder_t *encoders = pb_allocator_allocate(
+    &allocator_default, sizeof(pb_encoder_t) * size);
+  if (unlikely_(!encoders))
+    return PB_ERROR_ALLOC;                                 /* LCOV_EXCL_LINE */
+  for (size_t e = 0; e < size; e++)
+    encoders[e] = pb_encoder_create(descriptor);
+
+  /* Encode nested messages across threads */
+  pb_batch_t batch = {
+    .size       = size,
+    .encoders   = encoders,
+    .encode     = handler
+  };
+  pb_error_t error = run(&batch, user, threads);
+
+  /* Append all nested messages at once */
+  if (likely_(!error))
+    error = pb_encoder_encode(encoder, tag, encoders, size);
+  for (size_t e = 0; e < size; e++)
+    pb_encoder_destroy(&(encoders[e]));
+  pb_allocator_free(&allocator_default, encoders);
+  return error;
+}
@@ -28,6 +28,7 @@
 #include "core/allocator.h"
 #include "core/buffer.h"
 #include "core/common.h"
+#include "core/probe.h"
 
 /* ----------------------------------------------------------------------------
  * Interface
@@ -65,7 +66,8 @@ pb_buffer_create_with_allocator(
     pb_buffer_t buffer = {
       .allocator = allocator,
       .data      = memcpy(copy, data, size),
-      .size      = size
+      .size      = size,
+      .capacity  = size
     };
     return buffer;
   }
@@ -97,7 +99,8 @@ pb_buffer_create_empty_with_allocator(pb_allocator_t *allocator) {
   pb_buffer_t buffer = {
     .allocator = allocator,
     .data      = NULL,
-    .size      = 0
+    .size      = 0,
+    .capacity  = 0
   };
   return buffer;
 }
@@ -121,6 +124,29 @@ pb_buffer_create_zero_copy(uint8_t data[], size_t size) {
   return pb_buffer_create_zero_copy_internal(data, size);
 }
 
+/*!
+ * Create an empty buffer on top of caller-provided memory.
+ *
+ * Fixed buffers are assigned a static internal structure, so they never call
+ * an allocator. They can grow up to the given capacity, beyond which growing
+ * them will fail. The caller retains ownership of the memory.
+ *
+ * \param[in,out] data[]   Raw data
+ * \param[in]     capacity Raw data capacity
+ * \return                 Buffer
+ */
+extern pb_buffer_t
+pb_buffer_create_fixed(uint8_t data[], size_t capacity) {
+  assert(data && capacity);
+  pb_buffer_t buffer = {
+    .allocator = &allocator_fixed,
+    .data      = data,
+    .size      = 0,
+    .capacity  = capacity
+  };
+  return buffer;
+}
+
 /*!
  * Destroy a buffer.
  *
@@ -130,16 +156,138 @@ extern void
 pb_buffer_destroy(pb_buffer_t *buffer) {
   assert(buffer);
   if (buffer->allocator &&
-      buffer->allocator != &allocator_zero_copy) {
+      buffer->allocator != &allocator_zero_copy &&
+      buffer->allocator != &allocator_fixed) {
     if (buffer->data) {
       pb_allocator_free(buffer->allocator, buffer->data);
-      buffer->data = NULL;
-      buffer->size = 0;
+      buffer->data     = NULL;
+      buffer->size     = 0;
+      buffer->capacity = 0;
     }
     buffer->allocator = NULL;
   }
 }
 
+/*!
+ * Reserve space for a buffer to hold the given total size.
+ *
+ * The buffer is resized to exactly the given size if its capacity is lower, so
+ * subsequent writes up to this size will not trigger any reallocation. If
+ * allocation fails, the buffer is not altered.
+ *
+ * \param[in,out] buffer Buffer
+ * \param[in]     size   Total size
+ * \return               Error code
+ */
+extern pb_error_t
+pb_buffer_reserve(pb_buffer_t *buffer, size_t size) {
+  assert(buffer);
+  if (unlikely_(!pb_buffer_valid(buffer)))
+    return PB_ERROR_INVALID;
+
+  /* Resize buffer only if capacity is insufficient */
+  if (size > buffer->capacity) {
+    if (unlikely_(buffer->allocator == &allocator_zero_copy ||
+                  buffer->allocator == &allocator_fixed))
+      return PB_ERROR_ALLOC;
+
+    /* Resize buffer and adjust capacity */
+    uint8_t *data = pb_allocator_resize(buffer->allocator,
+      buffer->data, size);
+    if (unlikely_(!data)) {
+      pb_probe2(alloc__fail, buffer->allocator, size);
+      return PB_ERROR_ALLOC;
+    }
+    buffer->data     = data;
+    buffer->capacity = size;
+  }
+  return PB_ERROR_NONE;
+}
+
+/*!
+ * Release excess capacity of a buffer.
+ *
+ * If the buffer is empty, the allocated space is freed entirely. If allocation
+ * fails, the buffer is not altered.
+ *
+ * \param[in,out] buffer Buffer
+ * \return               Error code
+ */
+extern pb_error_t
+pb_buffer_shrink_to_fit(pb_buffer_t *buffer) {
+  assert(buffer);
+  if (unlikely_(!pb_buffer_valid(buffer)))
+    return PB_ERROR_INVALID;
+
+  /* Zero-copy, fixed and buffers without excess capacity are left as is */
+  if (buffer->allocator == &allocator_zero_copy ||
+      buffer->allocator == &allocator_fixed ||
+      buffer->size == buffer->capacity)
+    return PB_ERROR_NONE;
+
+  /* Buffer is empty, so free space */
+  if (!buffer->size) {
+    pb_allocator_free(buffer->allocator, buffer->data);
+    buffer->data = NULL;
+
+  /* Otherwise shrink space to size */
+  } else {
+    uint8_t *data = pb_allocator_resize(buffer->allocator,
+      buffer->data, buffer->size);
+    if (unlikely_(!data)) {
+      pb_probe2(alloc__fail, buffer->allocator, buffer->size);
+      return PB_ERROR_ALLOC;
+    }
+    buffer->data = data;
+  }
+  buffer->capacity = buffer->size;
+  return PB_ERROR_NONE;
+}
+
+/*!
+ * Ensure that a buffer has sufficient capacity to hold the given total size.
+ *
+ * The capacity grows geometrically, so that a sequence of writes triggers only
+ * a logarithmic number of reallocations. If allocation of the geometrically
+ * grown space fails, allocation of exactly the given size is attempted. If
+ * that fails too, the buffer is not altered.
+ *
+ * \param[in,out] buffer Buffer
+ * \param[in]     size   Total size
+ * \return               Error code
+ */
+extern pb_error_t
+pb_buffer_ensure(pb_buffer_t *buffer, size_t size) {
+  assert(buffer);
+  assert(pb_buffer_valid(buffer));
+  if (likely_(size <= buffer->capacity))
+    return PB_ERROR_NONE;
+  if (unlikely_(buffer->allocator == &allocator_zero_copy ||
+                buffer->allocator == &allocator_fixed))
+    return PB_ERROR_ALLOC;
+
+  /* Double capacity, but at least to the given size */
+  size_t capacity = buffer->capacity * 2;
+  if (capacity < size)
+    capacity = size;
+
+  /* Resize buffer, falling back to the exact size */
+  uint8_t *data = pb_allocator_resize(buffer->allocator,
+    buffer->data, capacity);
+  if (unlikely_(!data && capacity > size))
+    data = pb_allocator_resize(buffer->allocator,
+      buffer->data, capacity = size);
+  if (unlikely_(!data)) {
+    pb_probe2(alloc__fail, buffer->allocator, size);
+    return PB_ERROR_ALLOC;
+  }
+
+  /* Update data and capacity */
+  buffer->data     = data;
+  buffer->capacity = capacity;
+  return PB_ERROR_NONE;
+}
+
 /*!
  * Grow a buffer and return a pointer to the newly allocated space.
  *
@@ -157,11 +305,8 @@ pb_buffer_grow(pb_buffer_t *buffer, size_t size) {
     if (unlikely_(buffer->allocator == &allocator_zero_copy))
       return NULL;
 
-    /* Grow buffer and adjust size */
-    uint8_t *data = pb_allocator_resize(buffer->allocator,
-      buffer->data, buffer->size + size);
-    if (data) {
-      buffer->data  = data;
+    /* Ensure capacity and adjust size */
+    if (likely_(!pb_buffer_ensure(buffer, buffer->size + size))) {
       buffer->size += size;
 
       /* Return reserved space */
@@ -36,6 +36,12 @@
  * Interface
  * ------------------------------------------------------------------------- */
 
+PB_WARN_UNUSED_RESULT
+extern pb_error_t
+pb_buffer_ensure(
+  pb_buffer_t *buffer,                 /* Buffer */
+  size_t size);                        /* Total size */
+
 PB_WARN_UNUSED_RESULT
 extern uint8_t *
 pb_buffer_grow(
@@ -62,7 +68,8 @@ pb_buffer_create_zero_copy_internal(uint8_t data[], size_t size) {
   pb_buffer_t buffer = {
     .allocator = &allocator_zero_copy,
     .data      = data,
-    .size      = size
+    .size      = size,
+    .capacity  = size
   };
   return buffer;
 }
@@ -0,0 +1,366 @@
+/*
+ * Copyright (c) 2013-2020 Martin Donath <martin.donath@squidfunk.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "core/allocator.h"
+#include "core/buffer.h"
+#include "core/columnar.h"
+#include "core/common.h"
+#include "core/decoder.h"
+#include "core/descriptor.h"
+
+/* ----------------------------------------------------------------------------
+ * Internal functions
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Test whether a column holds strings or bytes.
+ *
+ * \param[in] column Column
+ * \return           Test result
+ */
+static int
+column_string(const pb_column_t *column) {
+  assert(column);
+  return pb_field_descriptor_wiretype(column->descriptor) ==
+    PB_WIRETYPE_LENGTH;
+}
+
+/*!
+ * Retrieve the offset of the string data of a row in a column.
+ *
+ * \param[in] column Column
+ * \param[in] row    Row
+ * \return           Offset
+ */
+static uint32_t
+column_offset(const pb_column_t *column, size_t row) {
+  assert(column && column_string(column));
+  uint32_t offset;
+  memcpy(&offset, pb_buffer_data_from(
+    &(column->offsets), row * sizeof(uint32_t)), sizeof(uint32_t));
+  return offset;
+}
+
+/*!
+ * Truncate all columns of a columnar decoder to the given number of rows.
+ *
+ * This is used to discard a partially decoded row, as well as to clear all
+ * rows, retaining the capacity of all columns.
+ *
+ * \param[in,out] columnar Columnar decoder
+ * \param[in]     rows     Row count
+ */
+static void
+shrink(pb_columnar_t *columnar, size_t rows) {
+  assert(columnar);
+  for (size_t c = 0; c < columnar->column.size; c++) {
+    pb_column_t *column = &(columnar->column.data[c]);
+
+    /* Truncate presence bitmap and clear trailing bits */
+    if (column->presence.size > (rows + 7) >> 3)
+      column->presence.size = (rows + 7) >> 3;
+    if (rows & 7)
+      *pb_buffer_data_from(&(column->presence), rows >> 3) &=
+        (1 << (rows & 7)) - 1;
+
+    /* Truncate values and offsets */
+    if (column_string(column)) {
+      column->offsets.size = (rows + 1) * sizeof(uint32_t);
+      column->values.size  = column_offset(column, rows);
+    } else {
+      column->values.size  =
+        rows * pb_field_descriptor_type_size(column->descriptor);
+    }
+  }
+}
+
+/*!
+ * Append an empty row to all columns of a columnar decoder.
+ *
+ * \param[in,out] columnar Columnar decoder
+ * \return                 Error code
+ */
+static pb_error_t
+append(pb_columnar_t *columnar) {
+  assert(columnar);
+  size_t row = columnar->size;
+  for (size_t c = 0; c < columnar->column.size; c++) {
+    pb_column_t *column = &(columnar->column.data[c]);
+
+    /* Append byte to presence bitmap, if necessary */
+    if (!(row & 7)) {
+      uint8_t *data = pb_buffer_grow(&(column->presence), 1);
+      if (unlikely_(!data))
+        return PB_ERROR_ALLOC;
+      *data = 0;
+    }
+
+    /* Append zero value for scalar fields */
+    if (!column_string(column)) {
+      size_t size = pb_field_descriptor_type_size(column->descriptor);
+      uint8_t *data = pb_buffer_grow(&(column->values), size);
+      if (unlikely_(!data))
+        return PB_ERROR_ALLOC;
+      memset(data, 0, size);
+    }
+  }
+  return PB_ERROR_NONE;
+}
+
+/*!
+ * Finish the last row of all columns of a columnar decoder.
+ *
+ * \param[in,out] columnar Columnar decoder
+ * \return                 Error code
+ */
+static pb_error_t
+finish(pb_columnar_t *columnar) {
+  assert(columnar);
+  for (size_t c = 0; c < columnar->column.size; c++) {
+    pb_column_t *column = &(columnar->column.data[c]);
+    if (!column_string(column))
+      continue;
+
+    /* Append offset marking the end of the row */
+    size_t size = pb_buffer_size(&(column->values));
+    if (unlikely_(size > UINT32_MAX))
+      return PB_ERROR_ALLOC;
+    uint32_t offset = size;
+    uint8_t *data = pb_buffer_grow(&(column->offsets), sizeof(uint32_t));
+    if (unlikely_(!data))
+      return PB_ERROR_ALLOC;
+    memcpy(data, &offset, sizeof(uint32_t));
+  }
+  return PB_ERROR_NONE;
+}
+
+/*!
+ * Store a value in the last row of all matching columns.
+ *
+ * If a field occurs multiple times within a message, the last occurrence
+ * wins, which is in line with the semantics of non-repeated fields.
+ *
+ * \param[in]     descriptor Field descriptor
+ * \param[in]     value      Pointer holding value
+ * \param[in,out] user       Columnar decoder
+ * \return                   Error code
+ */
+static pb_error_t
+handler(
+    const pb_field_descriptor_t *descriptor, const void *value, void *user) {
+  assert(descriptor && value && user);
+  pb_columnar_t *columnar = user;
+  size_t row = columnar->size;
+  for (size_t c = 0; c < columnar->column.size; c++) {
+    pb_column_t *column = &(columnar->column.data[c]);
+    if (column->descriptor != descriptor)
+      continue;
+
+    /* Mark field as present */
+    *pb_buffer_data_from(&(column->presence), row >> 3) |= 1 << (row & 7);
+
+    /* Replace string data of any previous occurrence */
+    if (column_string(column)) {
+      column->values.size = column_offset(column, row);
+      const pb_string_t *string = value;
+      if (pb_string_size(string)) {
+        uint8_t *data = pb_buffer_grow(
+          &(column->values), pb_string_size(string));
+        if (unlikely_(!data))
+          return PB_ERROR_ALLOC;
+        memcpy(data, pb_string_data(string), pb_string_size(string));
+      }
+
+    /* Overwrite scalar value */
+    } else {
+      size_t size = pb_field_descriptor_type_size(descriptor);
+      memcpy(pb_buffer_data_from(&(column->values), row * size),
+        value, size);
+    }
+  }
+  return PB_ERROR_NONE;
+}
+
+/* ----------------------------------------------------------------------------
+ * Interface
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Create a columnar decoder for a projection of fields of a descriptor.
+ *
+ * A columnar decoder decodes batches of messages of the same type into one
+ * growable column per projected field, instead of one struct per message. The
+ * values of scalar fields are stored as native arrays, strings and bytes as
+ * concatenated data with offsets, and every column has a presence bitmap, so
+ * the columns can be handed to consumers expecting Arrow-style arrays.
+ *
+ * Only non-repeated fields which are not nested messages can be projected,
+ * otherwise an invalid columnar decoder is returned.
+ *
+ * \param[in] descriptor Descriptor
+ * \param[in] tags[]     Projected tags
+ * \param[in] size       Projected tag count
+ * \return               Columnar decoder
+ */
+extern pb_columnar_t
+pb_columnar_create(
+    const pb_descriptor_t *descriptor, const pb_tag_t tags[], size_t size) {
+  assert(descriptor && tags && size);
+  pb_columnar_t columnar = {
+    .descriptor = descriptor
+  };
+
+  /* Ensure that all projected fields can be stored in columns */
+  pb_tag_t max = 0;
+  for (size_t t = 0; t < size; t++) {
+    const pb_field_descriptor_t *field =
+      pb_descriptor_field_by_tag(descriptor, tags[t]);
+    if (unlikely_(!field ||
+        pb_field_descriptor_label(field) == PB_LABEL_REPEATED ||
+        pb_field_descriptor_type(field) == PB_TYPE_MESSAGE))
+      return columnar;
+    if (max < tags[t])
+      max = tags[t];
+  }
+
+  /* Allocate columns and mask */
+  columnar.column.data = pb_allocator_allocate(
+    &allocator_default, sizeof(pb_column_t) * size);
+  columnar.mask.size   = (max >> 3) + 1;
+  columnar.mask.data   = pb_allocator_allocate(
+    &allocator_default, columnar.mask.size);
+  if (unlikely_(!columnar.column.data || !columnar.mask.data)) {
+    pb_columnar_destroy(&columnar);                        /* LCOV_EXCL_LINE */
+    return columnar;                                       /* LCOV_EXCL_LINE */
+  }
+
+  /* Initialize columns and mask */
+  memset(columnar.mask.data, 0, columnar.mask.size);
+  for (size_t t = 0; t < size; t++) {
+    pb_column_t column = {
+      .descriptor = pb_descriptor_field_by_tag(descriptor, tags[t]),
+      .values     = pb_buffer_create_empty(),
+      .offsets    = pb_buffer_create_empty(),
+      .presence   = pb_buffer_create_empty()
+    };
+    columnar.column.data[columnar.column.size++] = column;
+    pb_decoder_mask_set(columnar.mask.data, tags[t]);
+
+    /* Initialize offsets of strings and bytes with the start of data */
+    if (column_string(&column)) {
+      uint8_t *data = pb_buffer_grow(
+        &(columnar.column.data[t].offsets), sizeof(uint32_t));
+      if (unlikely_(!data)) {
+        pb_columnar_destroy(&columnar);                    /* LCOV_EXCL_LINE */
+        return columnar;                                   /* LCOV_EXCL_LINE */
+      }
+      memset(data, 0, sizeof(uint32_t));
+    }
+  }
+  return columnar;
+}
+
+/*!
+ * Destroy a columnar decoder.
+ *
+ * \param[in,out] columnar Columnar decoder
+ */
+extern void
+pb_columnar_destroy(pb_columnar_t *columnar) {
+  assert(columnar);
+  if (columnar->column.data) {
+    for (size_t c = 0; c < columnar->column.size; c++) {
+      pb_buffer_destroy(&(columnar->column.data[c].values));
+      pb_buffer_destroy(&(columnar->column.data[c].offsets));
+      pb_buffer_destroy(&(columnar->column.data[c].presence));
+    }
+    pb_allocator_free(&allocator_default, columnar->column.data);
+    columnar->column.data = NULL;
+  }
+  if (columnar->mask.data) {
+    pb_allocator_free(&allocator_default, columnar->mask.data);
+    columnar->mask.data = NULL;
+  }
+  columnar->column.size = 0;
+  columnar->size = 0;
+}
+
+/*!
+ * Decode a batch of messages, appending one row per message to all columns.
+ *
+ * All fields that are not projected are skipped without being decoded. If a
+ * message fails to decode, its partially decoded row is discarded, and the
+ * error is returned, so the rows of all preceding messages are retained.
+ *
+ * \param[in,out] columnar  Columnar decoder
+ * \param[in]     buffers[] Buffers
+ * \param[in]     size      Buffer count
+ * \return                  Error code
+ */
+extern pb_error_t
+pb_columnar_decode(
+    pb_columnar_t *columnar, const pb_buffer_t buffers[], size_t size) {
+  assert(columnar && (buffers || !size));
+  if (unlikely_(!pb_columnar_valid(columnar)))
+    return PB_ERROR_INVALID;
+
+  /* Decode messages into rows */
+  pb_decoder_mask_t mask = { columnar->mask.data, columnar->mask.size };
+  for (size_t b = 0; b < size; b++) {
+    pb_error_t error = append(columnar);
+    if (likely_(!error)) {
+      pb_decoder_t decoder =
+        pb_decoder_create(columnar->descriptor, &(buffers[b]));
+      error = pb_decoder_decode_masked(&decoder, &mask, handler, columnar);
+      pb_decoder_destroy(&decoder);
+    }
+    if (likely_(!error))
+      error = finish(columnar);
+
+    /* Discard partially decoded row on error */
+    if (unlikely_(error)) {
+      shrink(columnar, columnar->size);
+      return error;
+    }
+    columnar->size++;
+  }
+  return PB_ERROR_NONE;
+}
+
+/*!
+ * Clear all rows of a columnar decoder, retaining the capacity of all columns.
+ *
+ * \param[in,out] columnar Columnar decoder
+ */
+extern void
+pb_columnar_clear(pb_columnar_t *columnar) {
+  assert(columnar);
+  if (likely_(pb_columnar_valid(columnar))) {
+    shrink(columnar, 0);
+    columnar->size = 0;
+  }
+}
@@ -36,4 +36,9 @@
 #define   likely_(condition) __builtin_expect((condition), 1)
 #define unlikely_(condition) __builtin_expect((condition), 0)
 
+/*
+ * Prefetching helper.
+ */
+#define prefetch_(address) __builtin_prefetch((address), 0, 3)
+
 #endif /* PB_CORE_COMMON_H */
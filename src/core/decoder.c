@@ -26,94 +26,459 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "core/allocator.h"
 #include "core/buffer.h"
 #include "core/common.h"
+#include "core/endian.h"
 #include "core/decoder.h"
 #include "core/descriptor.h"
+#include "core/intern.h"
+#include "core/layout.h"
+#include "core/probe.h"
+#include "core/stats.h"
 #include "core/stream.h"
+#include "core/utf8.h"
+#include "core/varint.h"
 
 /* ----------------------------------------------------------------------------
- * Interface
+ * Macros
  * ------------------------------------------------------------------------- */
 
 /*!
- * Create a decoder.
+ * Number of 64-bit slots of the stack-allocated batch for packed fields.
+ */
+#define PB_DECODER_BATCH 64
+
+/*!
+ * Number of 64-bit words of the stack-allocated bitset of seen fields.
+ */
+#define PB_DECODER_WORDS 4
+
+/* ----------------------------------------------------------------------------
+ * Forward declarations
+ * ------------------------------------------------------------------------- */
+
+static pb_error_t
+decode_struct(
+  const pb_buffer_t *buffer,           /* Buffer */
+  const pb_layout_t *layout,           /* Layout */
+  void *value,                         /* Pointer holding struct */
+  pb_decoder_budget_t *budget,         /* Budget */
+  size_t depth);                       /* Nesting depth */
+
+/* ----------------------------------------------------------------------------
+ * Internal functions
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Count a field against the field limit of a budget.
  *
- * \warning A decoder does not take ownership of the provided buffer, so the
- * caller must ensure that the buffer is not freed during operations.
+ * \param[in,out] budget Budget
+ * \return               Error code
+ */
+PB_INLINE pb_error_t
+budget_field(pb_decoder_budget_t *budget) {
+  assert(budget);
+  return ++budget->count > budget->fields && budget->fields
+    ? PB_ERROR_FIELDS
+    : PB_ERROR_NONE;
+}
+
+/*!
+ * Check the length of a string or bytes field against a budget.
  *
- * \param[in] descriptor Descriptor
- * \param[in] buffer     Buffer
- * \return               Decoder
+ * \param[in] budget Budget
+ * \param[in] type   Type
+ * \param[in] length Length
+ * \return           Error code
  */
-extern pb_decoder_t
-pb_decoder_create(
-    const pb_descriptor_t *descriptor, const pb_buffer_t *buffer) {
-  assert(descriptor && buffer);
-  pb_decoder_t decoder = {
-    .descriptor = descriptor,
-    .buffer     = buffer
-  };
-  return decoder;
+PB_INLINE pb_error_t
+budget_length(
+    const pb_decoder_budget_t *budget, pb_type_t type, size_t length) {
+  assert(budget);
+  return (type == PB_TYPE_STRING || type == PB_TYPE_BYTES) &&
+    length > budget->length && budget->length
+      ? PB_ERROR_LENGTH
+      : PB_ERROR_NONE;
 }
 
 /*!
- * Destroy a decoder.
+ * Check whether a nested message may be entered according to a budget.
  *
- * \param[in,out] decoder Decoder
+ * \param[in] budget Budget
+ * \param[in] depth  Nesting depth of nested message
+ * \return           Error code
  */
-extern void
-pb_decoder_destroy(pb_decoder_t *decoder) {
-  assert(decoder); /* Nothing to be done */
+PB_INLINE pb_error_t
+budget_depth(const pb_decoder_budget_t *budget, size_t depth) {
+  assert(budget);
+  return depth > budget->depth && budget->depth
+    ? PB_ERROR_DEPTH
+    : PB_ERROR_NONE;
 }
 
 /*!
- * Decode a buffer using a handler.
+ * Check the size of a message against a budget.
+ *
+ * \param[in] budget Budget
+ * \param[in] size   Size
+ * \return           Error code
+ */
+PB_INLINE pb_error_t
+budget_size(const pb_decoder_budget_t *budget, size_t size) {
+  assert(budget);
+  return size > budget->size && budget->size
+    ? PB_ERROR_SIZE
+    : PB_ERROR_NONE;
+}
+
+/*!
+ * Reset an index of field offsets for a message of the given descriptor.
+ *
+ * The entries are allocated for all fields of the descriptor, retaining the
+ * previous allocation if it is large enough, and are cleared.
+ *
+ * \param[in,out] index      Index
+ * \param[in]     descriptor Descriptor
+ * \param[in]     size       Message size
+ * \return                   Error code
+ */
+static pb_error_t
+index_reset(
+    pb_decoder_index_t *index, const pb_descriptor_t *descriptor,
+    size_t size) {
+  assert(index && descriptor);
+  size_t fields = pb_descriptor_size(descriptor);
+  if (fields > index->entry.capacity) {
+    pb_decoder_index_entry_t *data = pb_allocator_resize(index->allocator,
+      index->entry.data, sizeof(pb_decoder_index_entry_t) * fields);
+    if (unlikely_(!data))
+      return PB_ERROR_ALLOC;                               /* LCOV_EXCL_LINE */
+    index->entry.data     = data;
+    index->entry.capacity = fields;
+  }
+  if (fields)
+    memset(index->entry.data, 0, sizeof(pb_decoder_index_entry_t) * fields);
+  index->descriptor = descriptor;
+  index->size       = size;
+  index->complete   = 0;
+  return PB_ERROR_NONE;
+}
+
+/*!
+ * Record an occurrence of a field in an index of field offsets.
  *
- * The decoder
+ * \param[in,out] index  Index
+ * \param[in]     pos    Field position
+ * \param[in]     offset Offset of tag
+ */
+PB_INLINE void
+index_record(pb_decoder_index_t *index, size_t pos, size_t offset) {
+  assert(index && pos < pb_descriptor_size(index->descriptor));
+  pb_decoder_index_entry_t *entry = &(index->entry.data[pos]);
+  if (!entry->count++)
+    entry->first = offset;
+  entry->last = offset;
+}
+
+/*!
+ * Report a range of unknown fields to the unknown field handler of a decoder.
  *
  * \param[in]     decoder Decoder
+ * \param[in]     begin   Start offset
+ * \param[in]     end     End offset
+ * \param[in,out] user    User data
+ * \return                Error code
+ */
+static pb_error_t
+decode_unknown(
+    const pb_decoder_t *decoder, size_t begin, size_t end, void *user) {
+  assert(decoder && decoder->unknown && begin < end);
+  pb_string_t range = pb_string_init(
+    pb_buffer_data_from(decoder->buffer, begin), end - begin);
+  return decoder->unknown(&range, user);
+}
+
+/*!
+ * Decode the values of a packed field into a batch and invoke the handler.
+ *
+ * Values are decoded in one tight loop into a typed array on the stack, which
+ * is handed to the packed handler once it is full or the packed field ends.
+ * Fixed-sized values are copied as a whole, variable-sized integers are
+ * unpacked directly from the underlying buffer, bypassing the stream.
+ *
+ * On little-endian hosts, fixed-sized values are already laid out in memory
+ * exactly as on the wire, so if they are suitably aligned, the handler is
+ * invoked once with all values aliasing the underlying buffer.
+ *
+ * \param[in,out] stream     Stream
+ * \param[in]     descriptor Field descriptor
+ * \param[in]     length     Length of packed field
+ * \param[in]     handler    Packed handler
+ * \param[in,out] user       User data
+ * \return                   Error code
+ */
+static pb_error_t
+decode_packed(
+    pb_stream_t *stream, const pb_field_descriptor_t *descriptor,
+    size_t length, pb_decoder_packed_handler_f handler, void *user) {
+  assert(stream && descriptor && handler);
+  pb_error_t error = PB_ERROR_NONE;
+
+  /* Determine type and size of values */
+  pb_type_t type = pb_field_descriptor_type(descriptor);
+  size_t    item = pb_field_descriptor_type_size(descriptor);
+
+  /* Allocate batch for values and determine its capacity */
+  uint64_t batch[PB_DECODER_BATCH];
+  const size_t capacity = sizeof(batch) / item;
+
+  /* Retrieve raw data of packed field */
+  const uint8_t *data = pb_buffer_data_from(
+    pb_stream_buffer(stream), pb_stream_offset(stream));
+  if (unlikely_(error = pb_stream_advance(stream, length)))
+    return error;
+
+  /* Fixed-sized values can be copied as a whole */
+  if (pb_field_descriptor_wiretype(descriptor) != PB_WIRETYPE_VARINT) {
+    if (unlikely_(length % item))
+      return PB_ERROR_OFFSET;
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+
+    /* Alias values, if aligned */
+    if (length && !((uintptr_t)data & (item - 1)))
+      return handler(descriptor, data, length / item, user);
+
+#endif /* __BYTE_ORDER__ */
+
+    /* Otherwise copy values in batches */
+    for (size_t size; !error && length; length -= size * item) {
+      size = length / item > capacity ? capacity : length / item;
+      pb_endian_copy(batch, data, size, item);
+      data += size * item;
+      error = handler(descriptor, batch, size, user);
+    }
+
+  /* Variable-sized integers must be unpacked one by one */
+  } else {
+    size_t size = 0;
+    while (!error && length) {
+      size_t read = pb_varint_unpack(type, data, length,
+        (uint8_t *)batch + size * item);
+      if (unlikely_(!read))
+        return PB_ERROR_VARINT;
+      data += read, length -= read;
+
+      /* Invoke handler if batch is full or packed field ends */
+      if (++size == capacity || !length) {
+        error = handler(descriptor, batch, size, user);
+        size  = 0;
+      }
+    }
+  }
+  return error;
+}
+
+/*!
+ * Test whether a stream continues with the precomputed key of a field.
+ *
+ * The key is the encoded tag and wiretype of the field, which is generated
+ * alongside the field descriptor, so a raw comparison suffices to identify
+ * the field without decoding the tag and looking up its descriptor.
+ *
+ * \param[in] stream     Stream
+ * \param[in] descriptor Field descriptor
+ * \return               Test result
+ */
+PB_INLINE int
+decode_match(
+    const pb_stream_t *stream, const pb_field_descriptor_t *descriptor) {
+  assert(stream && descriptor);
+  size_t size = descriptor->key.size;
+  return size && pb_stream_left(stream) >= size && !memcmp(
+    pb_buffer_data_from(pb_stream_buffer(stream), pb_stream_offset(stream)),
+      descriptor->key.data, size);
+}
+
+/*!
+ * Check whether all required fields of a descriptor were seen.
+ *
+ * If the descriptor provides a bitset of required positions, which is the
+ * case for generated descriptors, a single mask comparison per word is
+ * sufficient. Otherwise, the labels of all fields are checked.
+ *
+ * \param[in] descriptor Descriptor
+ * \param[in] seen       Bitset of seen positions
+ * \param[in] words      Bitset word count
+ * \return               Error code
+ */
+static pb_error_t
+decode_required(
+    const pb_descriptor_t *descriptor, const uint64_t seen[], size_t words) {
+  assert(descriptor && seen);
+  const uint64_t *required = descriptor->required.data;
+  if (likely_(required && descriptor->required.size == words)) {
+    for (size_t w = 0; w < words; ++w)
+      if ((seen[w] & required[w]) != required[w])
+        return PB_ERROR_ABSENT;
+
+  /* Check labels, if the descriptor provides no bitset */
+  } else {
+    for (size_t f = 0; f < pb_descriptor_size(descriptor); ++f)
+      if (descriptor->field.data[f].label == PB_LABEL_REQUIRED &&
+          !(seen[f >> 6] & ((uint64_t)1 << (f & 63))))
+        return PB_ERROR_ABSENT;
+  }
+  return PB_ERROR_NONE;
+}
+
+/*!
+ * Decode a buffer using a handler, and optionally a packed handler.
+ *
+ * If required fields should be checked, occurrences are marked in a bitset
+ * indexed by field position, which is compared against the required fields
+ * of the descriptor after the last field was decoded.
+ *
+ * If the decoder has an index, the offsets of all fields are recorded in the
+ * same pass, and the index is marked complete if decoding succeeded.
+ *
+ * If the decoder has a budget, the size of the message is checked upfront,
+ * and every field and nested message is checked before its handler is called.
+ * The field count is reset when decoding starts on the top level.
+ *
+ * \param[in]     decoder Decoder
+ * \param[in]     mask    Mask
  * \param[in]     handler Handler
+ * \param[in]     packed  Packed handler
+ * \param[in]     checked Whether to check required fields
  * \param[in,out] user    User data
  * \return                Error code
  */
-extern pb_error_t
-pb_decoder_decode(
-    const pb_decoder_t *decoder, pb_decoder_handler_f handler, void *user) {
+static pb_error_t
+decode(
+    const pb_decoder_t *decoder, const pb_decoder_mask_t *mask,
+    pb_decoder_handler_f handler, pb_decoder_packed_handler_f packed,
+    int checked, void *user) {
   assert(decoder && handler);
   if (unlikely_(!pb_decoder_valid(decoder)))
     return PB_ERROR_INVALID;
   pb_error_t error = PB_ERROR_NONE;
+  pb_probe2(decode__start, decoder->descriptor,
+    pb_buffer_size(decoder->buffer));
+  pb_stats_profile(decoder->descriptor);
 
-  /* Iterate tag-value pairs */
+  /* Check size of message against budget, if any */
+  pb_decoder_budget_t *budget = decoder->budget;
+  if (unlikely_(budget != NULL)) {
+    if (!decoder->depth)
+      budget->count = 0;
+    if (unlikely_(error = budget_size(budget,
+        pb_buffer_size(decoder->buffer))))
+      return error;
+  }
+
+  /* Reset index of field offsets, if any */
+  pb_decoder_index_t *index = decoder->index;
+  if (unlikely_(index != NULL) && unlikely_(error = index_reset(index,
+      decoder->descriptor, pb_buffer_size(decoder->buffer))))
+    return error;                                          /* LCOV_EXCL_LINE */
+
+  /* Initialize bitset of seen positions, if required fields are checked */
+  const pb_field_descriptor_t *fields = decoder->descriptor->field.data;
+  size_t size  = pb_descriptor_size(decoder->descriptor),
+         words = checked ? (size + 63) >> 6 : 0;
+  uint64_t stack[PB_DECODER_WORDS] = { 0 }, *seen = stack;
+  if (unlikely_(words > PB_DECODER_WORDS)) {
+    if (!(seen = pb_allocator_allocate(&allocator_default,
+        sizeof(uint64_t) * words)))
+      return PB_ERROR_ALLOC;                               /* LCOV_EXCL_LINE */
+    memset(seen, 0, sizeof(uint64_t) * words);
+  }
+
+  /* Iterate tag-value pairs, tracking the range of unknown fields */
   pb_stream_t stream = pb_stream_create(decoder->buffer);
-  while (!error && pb_stream_left(&stream)) {
+  size_t begin = 0, end = 0;
+  for (size_t expect = 0; !error && pb_stream_left(&stream); ) {
+    const pb_field_descriptor_t *descriptor = NULL;
+    size_t start = pb_stream_offset(&stream);
+    pb_wiretype_t wiretype;
     pb_tag_t tag;
-    if (unlikely_(error = pb_stream_read(&stream, PB_TYPE_UINT32, &tag)))
+
+    /* Compare raw key of the field expected next, as fields are in order */
+    if (expect < size && decode_match(&stream, &(fields[expect]))) {
+      descriptor = &(fields[expect]);
+      wiretype   = pb_field_descriptor_wiretype(descriptor);
+      tag        = pb_field_descriptor_tag(descriptor);
+      if (unlikely_(error = pb_stream_advance(&stream,
+          descriptor->key.size)))
+        break;                                             /* LCOV_EXCL_LINE */
+
+    /* Otherwise read and extract wiretype and tag */
+    } else {
+      if (unlikely_(error = pb_stream_read_uint32(&stream, &tag)))
+        break;
+      wiretype = tag & 7;
+      tag >>= 3;
+    }
+
+    /* Count field against budget, if any */
+    if (unlikely_(budget != NULL) && unlikely_(error = budget_field(budget)))
       break;
 
-    /* Extract wiretype and tag */
-    pb_wiretype_t wiretype = tag & 7;
-    tag >>= 3;
+    /* Skip field if not wanted, before looking up its descriptor */
+    if (mask && !pb_decoder_mask_has(mask, tag)) {
+      if (unlikely_(index != NULL) && (descriptor =
+          pb_descriptor_field_by_tag(decoder->descriptor, tag)) &&
+          descriptor >= fields && descriptor < fields + size)
+        index_record(index, descriptor - fields, start);
+      error = pb_stream_skip(&stream, wiretype);
+      continue;
+    }
 
     /* Check descriptor and skip field if unknown */
-    const pb_field_descriptor_t *descriptor =
-      pb_descriptor_field_by_tag(decoder->descriptor, tag);
+    if (!descriptor)
+      descriptor = pb_descriptor_field_by_tag(decoder->descriptor, tag);
     if (unlikely_(!descriptor)) {
       error = pb_stream_skip(&stream, wiretype);
+
+      /* Extend range of unknown fields or report it, if not adjacent */
+      if (unlikely_(decoder->unknown != NULL) && !error) {
+        if (start != end) {
+          if (end)
+            error = decode_unknown(decoder, begin, end, user);
+          begin = start;
+        }
+        end = pb_stream_offset(&stream);
+      }
       continue;
     }
 
-    /* Allocate temporary space for type-agnostic decoding */
-    size_t item = pb_field_descriptor_type_size(descriptor);
-    void *value = alloca(item);
+    /* Mark occurrence and expect the next field, unless part of extension */
+    if (descriptor >= fields && descriptor < fields + size) {
+      size_t pos = descriptor - fields;
+      if (words)
+        seen[pos >> 6] |= (uint64_t)1 << (pos & 63);
+      if (unlikely_(index != NULL))
+        index_record(index, pos, start);
+      pb_stats_profile_field(pos);
+      expect = pos + (pb_field_descriptor_label(descriptor) !=
+        PB_LABEL_REPEATED);
+    }
+
+    /* Reserve temporary space large enough for values of any type */
+    union {
+      uint64_t    number;
+      pb_string_t string;
+    } slot;
+    void *value = &slot;
 
     /* Non-packed fields may also be encoded in packed encoding */
     pb_type_t type = pb_field_descriptor_type(descriptor);
     if (wiretype != pb_field_descriptor_wiretype(descriptor) &&
         wiretype == PB_WIRETYPE_LENGTH) {
       uint32_t length;
-      if (unlikely_(error = pb_stream_read(&stream, PB_TYPE_UINT32, &length)))
+      if (unlikely_(error = pb_stream_read_uint32(&stream, &length)))
         break;
 
       /* Ensure we're within the stream's boundaries */
@@ -121,14 +486,32 @@ pb_decoder_decode(
       if (pb_stream_offset(&stream) + length > pb_buffer_size(decoder->buffer))
         error = PB_ERROR_OFFSET;
 
+      /* Decode values of packed field in batches, if requested */
+      if (!error && packed) {
+        error = decode_packed(&stream, descriptor, length, packed, user);
+        continue;
+      }
+
       /* Iterate values of packed field */
       while (!error && pb_stream_offset(&stream) < offset + length)
-        if (likely_(!(error = pb_stream_read(&stream, type, value))))
+        if (likely_(!(error = pb_stream_read_typed(&stream, type, value))))
           error = handler(descriptor, value, user);
 
     /* Read value of given type from stream */
     } else {
-      if (unlikely_(error = pb_stream_read(&stream, type, value)))
+      if (unlikely_(error = pb_stream_read_typed(&stream, type, value)))
+        break;
+
+      /* Prefetch next field, as the handler may take a while */
+      if (wiretype == PB_WIRETYPE_LENGTH)
+        pb_stream_prefetch(&stream, 0);
+
+      /* Check length of strings and depth of nested messages, if any */
+      if (unlikely_(budget != NULL) &&
+          pb_field_descriptor_wiretype(descriptor) == PB_WIRETYPE_LENGTH &&
+          unlikely_(error = type == PB_TYPE_MESSAGE
+            ? budget_depth(budget, decoder->depth + 1)
+            : budget_length(budget, type, pb_string_size(value))))
         break;
 
       /* Invoke handler */
@@ -137,18 +520,1204 @@ pb_decoder_decode(
           pb_string_data(value), pb_string_size(value));
 
         /* Create decoder for nested message and invoke handler */
-        pb_decoder_t subdecoder = pb_decoder_create(
-          pb_field_descriptor_nested(descriptor), &buffer);
+        pb_decoder_t subdecoder = pb_decoder_create_with_flags(
+          pb_field_descriptor_nested(descriptor), &buffer, decoder->flags);
+        subdecoder.budget = budget;
+        subdecoder.intern = decoder->intern;
+        subdecoder.depth  = decoder->depth + 1;
         error = handler(descriptor, &subdecoder, user);
 
         /* Free all allocated memory */
         pb_decoder_destroy(&subdecoder);
         pb_buffer_destroy(&buffer);
+
+      /* Validate strings in the same pass, if requested */
+      } else if (type == PB_TYPE_STRING && (decoder->flags &
+          PB_DECODER_FLAG_UTF8 || pb_field_descriptor_utf8(descriptor)) &&
+          !pb_utf8_valid(pb_string_data(value), pb_string_size(value))) {
+        error = PB_ERROR_INVALID;
+
+      /* Intern strings and bytes, if requested */
+      } else if (unlikely_(decoder->intern != NULL) &&
+          (type == PB_TYPE_STRING || type == PB_TYPE_BYTES) &&
+          (decoder->flags & PB_DECODER_FLAG_INTERN ||
+            pb_field_descriptor_intern(descriptor))) {
+        const pb_string_t *string = pb_intern_insert(decoder->intern, value);
+        error = likely_(string != NULL)
+          ? handler(descriptor, string, user)
+          : PB_ERROR_ALLOC;
       } else {
         error = handler(descriptor, value, user);
       }
     }
   }
   pb_stream_destroy(&stream);
+
+  /* Report last range of unknown fields, if any */
+  if (!error && end)
+    error = decode_unknown(decoder, begin, end, user);
+
+  /* Check for absent required fields and free bitset, if allocated */
+  if (!error && words)
+    error = decode_required(decoder->descriptor, seen, words);
+  if (unlikely_(seen != stack))
+    pb_allocator_free(&allocator_default, seen);
+
+  /* Mark index as complete, if decoding succeeded */
+  if (unlikely_(index != NULL))
+    index->complete = !error;
+  pb_probe3(decode__end, decoder->descriptor,
+    pb_buffer_size(decoder->buffer), error);
+  return error;
+}
+
+/*!
+ * Decode a single field into a struct according to a layout.
+ *
+ * The position of the field descriptor is looked up and the value is written
+ * straight into the respective member of the struct. Values of repeated fields
+ * are appended to their members and nested messages are decoded recursively.
+ * Unknown fields and extensions are skipped.
+ *
+ * \param[in,out] stream   Stream
+ * \param[in]     layout   Layout
+ * \param[in,out] value    Pointer holding struct
+ * \param[in]     tag      Tag
+ * \param[in]     wiretype Wiretype
+ * \param[in,out] budget   Budget
+ * \param[in]     depth    Nesting depth
+ * \return                 Error code
+ */
+static pb_error_t
+decode_struct_field(
+    pb_stream_t *stream, const pb_layout_t *layout, void *value,
+    pb_tag_t tag, pb_wiretype_t wiretype, pb_decoder_budget_t *budget,
+    size_t depth) {
+  assert(stream && layout && value);
+  const pb_descriptor_t *descriptor = pb_layout_descriptor(layout);
+  pb_error_t error = PB_ERROR_NONE;
+
+  /* Count field against budget, if any */
+  if (unlikely_(budget != NULL) && unlikely_(error = budget_field(budget)))
+    return error;
+
+  /* Check descriptor and skip field if unknown or an extension */
+  const pb_field_descriptor_t *field =
+    pb_descriptor_field_by_tag(descriptor, tag);
+  if (unlikely_(!field || field < descriptor->field.data ||
+      field >= descriptor->field.data + layout->field.size))
+    return pb_stream_skip(stream, wiretype);
+
+  /* Resolve member of field */
+  size_t pos = field - descriptor->field.data;
+  void *member = pb_layout_member(layout, value, pos);
+  int repeated = pb_field_descriptor_label(field) == PB_LABEL_REPEATED;
+
+  /* Determine type and size of values */
+  pb_type_t type = pb_field_descriptor_type(field);
+  size_t    item = pb_field_descriptor_type_size(field);
+
+  /* Non-packed fields may also be encoded in packed encoding */
+  if (wiretype != pb_field_descriptor_wiretype(field) &&
+      wiretype == PB_WIRETYPE_LENGTH) {
+    uint32_t length;
+    if (unlikely_(error = pb_stream_read_uint32(stream, &length)))
+      return error;
+
+    /* Ensure we're within the stream's boundaries */
+    size_t end = pb_stream_offset(stream) + length;
+    if (end > pb_stream_size(stream))
+      return PB_ERROR_OFFSET;
+
+    /* Read values of packed field into member */
+    while (!error && pb_stream_offset(stream) < end) {
+      void *slot = repeated ? pb_layout_push(member, item) : member;
+      if (unlikely_(!slot)) {
+        error = PB_ERROR_ALLOC;
+      } else if (unlikely_(
+          error = pb_stream_read_typed(stream, type, slot))) {
+        if (repeated)
+          ((pb_repeated_t *)member)->size--;
+      }
+    }
+
+  /* Decode nested message into nested struct */
+  } else if (type == PB_TYPE_MESSAGE) {
+    const pb_layout_t *nested = pb_layout_nested(layout, pos);
+    assert(nested);
+    pb_string_t string;
+    if (unlikely_(error = pb_stream_read_typed(stream, type, &string)))
+      return error;
+    if (unlikely_(budget != NULL) &&
+        unlikely_(error = budget_depth(budget, depth + 1)))
+      return error;
+
+    /* Append element of repeated field or reuse existing message */
+    void *target = repeated
+      ? pb_layout_push(member, pb_layout_size(nested))
+      : *(void **)member;
+    if (!repeated && !target) {
+      target = pb_allocator_allocate(&allocator_default,
+        pb_layout_size(nested));
+      *(void **)member = target;
+    }
+    if (unlikely_(!target))
+      return PB_ERROR_ALLOC;
+    if (repeated || !pb_layout_has(layout, value, pos))
+      pb_layout_init(nested, target);
+
+    /* Decode nested message */
+    pb_buffer_t subbuffer = pb_buffer_create_zero_copy_internal(
+      pb_string_data(&string), pb_string_size(&string));
+    error = decode_struct(&subbuffer, nested, target, budget, depth + 1);
+    pb_buffer_destroy(&subbuffer);
+
+  /* Read value of given type into member */
+  } else {
+    void *slot = repeated ? pb_layout_push(member, item) : member;
+    if (unlikely_(!slot)) {
+      error = PB_ERROR_ALLOC;
+    } else if (unlikely_(
+        error = pb_stream_read_typed(stream, type, slot))) {
+      if (repeated)
+        ((pb_repeated_t *)member)->size--;
+
+    /* Check length of strings against budget, if any */
+    } else if (unlikely_(budget != NULL) &&
+        pb_field_descriptor_wiretype(field) == PB_WIRETYPE_LENGTH &&
+        unlikely_(error = budget_length(budget, type,
+          pb_string_size(slot)))) {
+      if (repeated)
+        ((pb_repeated_t *)member)->size--;
+
+    /* Validate strings, if flagged */
+    } else if (type == PB_TYPE_STRING && pb_field_descriptor_utf8(field) &&
+        !pb_utf8_valid(pb_string_data(slot), pb_string_size(slot))) {
+      error = PB_ERROR_INVALID;
+      if (repeated)
+        ((pb_repeated_t *)member)->size--;
+    }
+  }
+
+  /* Mark field as present */
+  if (!error)
+    pb_layout_set(layout, value, pos);
+  return error;
+}
+
+/*!
+ * Decode a buffer into a struct according to a layout.
+ *
+ * All fields are decoded in a single loop, which writes the values straight
+ * into the respective members of the struct, so no handler is invoked.
+ *
+ * \param[in]     buffer Buffer
+ * \param[in]     layout Layout
+ * \param[in,out] value  Pointer holding struct
+ * \param[in,out] budget Budget
+ * \param[in]     depth  Nesting depth
+ * \return               Error code
+ */
+static pb_error_t
+decode_struct(
+    const pb_buffer_t *buffer, const pb_layout_t *layout, void *value,
+    pb_decoder_budget_t *budget, size_t depth) {
+  assert(buffer && layout && value);
+  pb_error_t error = PB_ERROR_NONE;
+
+  /* Iterate tag-value pairs */
+  pb_stream_t stream = pb_stream_create(buffer);
+  while (!error && pb_stream_left(&stream)) {
+    pb_tag_t tag;
+    if (unlikely_(error = pb_stream_read_uint32(&stream, &tag)))
+      break;
+
+    /* Decode field into struct */
+    error = decode_struct_field(&stream, layout, value, tag >> 3, tag & 7,
+      budget, depth);
+  }
+  pb_stream_destroy(&stream);
+  return error;
+}
+
+/* ------------------------------------------------------------------------- */
+
+/*!
+ * Scan a chunk for a complete variable-sized integer.
+ *
+ * Chunks are provided by the caller and may end anywhere, which is fine, as
+ * pb_varint_scan() never reads beyond the given number of bytes.
+ *
+ * \param[in] data[] Source buffer
+ * \param[in] left   Remaining bytes
+ * \return           Bytes of integer or zero if incomplete
+ */
+PB_INLINE size_t
+feed_scan(const uint8_t data[], size_t left) {
+  assert(data);
+  return left ? pb_varint_scan(data, left) : 0;
+}
+
+/*!
+ * Determine the error for a field that exceeds the available bytes.
+ *
+ * If the field is truncated by the end of the enclosing message or packed
+ * field, or it exceeds the maximum size, no more data can complete it, so the
+ * respective error is returned. Otherwise the decoder must wait for more data.
+ *
+ * \param[in] available Available bytes
+ * \param[in] limit     Bytes left in enclosing message or packed field
+ * \param[in] error     Error code to return if field cannot be completed
+ * \return              Error code
+ */
+PB_INLINE pb_error_t
+feed_incomplete(size_t available, size_t limit, pb_error_t error) {
+  return available >= limit ? error : PB_ERROR_NONE;
+}
+
+/*!
+ * Push a frame onto the stack of a feed decoder.
+ *
+ * \param[in,out] feed       Feed decoder
+ * \param[in]     descriptor Descriptor
+ * \param[in]     packed     Packed field descriptor
+ * \param[in]     end        End offset
+ * \return                   Error code
+ */
+static pb_error_t
+feed_push(
+    pb_decoder_feed_t *feed, const pb_descriptor_t *descriptor,
+    const pb_field_descriptor_t *packed, size_t end) {
+  assert(feed && descriptor);
+  if (feed->frame.size == feed->frame.capacity) {
+    size_t capacity = feed->frame.capacity ? feed->frame.capacity << 1 : 8;
+    pb_decoder_frame_t *data = pb_allocator_resize(
+      pb_buffer_allocator(&(feed->buffer)), feed->frame.data,
+        sizeof(pb_decoder_frame_t) * capacity);
+    if (unlikely_(!data))
+      return PB_ERROR_ALLOC;
+    feed->frame.data     = data;
+    feed->frame.capacity = capacity;
+  }
+  pb_decoder_frame_t frame = {
+    .descriptor = descriptor,
+    .packed     = packed,
+    .end        = end
+  };
+  if (!packed && unlikely_(feed->budget != NULL)) {
+    pb_error_t error = budget_depth(feed->budget, feed->depth + 1);
+    if (unlikely_(error))
+      return error;
+  }
+  feed->frame.data[feed->frame.size++] = frame;
+  if (!packed)
+    feed->depth++;
+  return PB_ERROR_NONE;
+}
+
+/*!
+ * Decode the next value of a packed field from a chunk.
+ *
+ * \param[in,out] feed   Feed decoder
+ * \param[in]     data[] Source buffer
+ * \param[in]     left   Remaining bytes
+ * \param[out]    size   Bytes read
+ * \return               Error code
+ */
+static pb_error_t
+feed_step_packed(
+    pb_decoder_feed_t *feed, const uint8_t data[], size_t left,
+    size_t *size) {
+  assert(feed && data && size);
+  const pb_decoder_frame_t *frame = &(feed->frame.data[feed->frame.size - 1]);
+  const pb_field_descriptor_t *descriptor = frame->packed;
+  size_t limit = frame->end - feed->offset;
+  if (left > limit)
+    left = limit;
+
+  /* Allocate temporary space for type-agnostic decoding */
+  void *value = alloca(pb_field_descriptor_type_size(descriptor));
+  pb_type_t type = pb_field_descriptor_type(descriptor);
+
+  /* Read variable-sized or fixed-sized value */
+  if (pb_field_descriptor_wiretype(descriptor) == PB_WIRETYPE_VARINT) {
+    if (!(*size = feed_scan(data, left)))
+      return feed_incomplete(left, limit < 10 ? limit : 10, PB_ERROR_VARINT);
+    if (unlikely_(!pb_varint_unpack(type, data, *size, value)))
+      return PB_ERROR_VARINT;
+  } else {
+    if ((*size = pb_field_descriptor_type_size(descriptor)) > left) {
+      *size = 0;
+      return feed_incomplete(left, limit, PB_ERROR_OFFSET);
+    }
+    pb_endian_copy(value, data, 1, *size);
+  }
+  return feed->handler(descriptor, value, feed->user);
+}
+
+/*!
+ * Decode the next field from a chunk.
+ *
+ * If the field is incomplete, no bytes are consumed and the size is set to
+ * zero, so the caller must retain the bytes until more data is available.
+ *
+ * \param[in,out] feed   Feed decoder
+ * \param[in]     data[] Source buffer
+ * \param[in]     left   Remaining bytes
+ * \param[out]    size   Bytes read
+ * \return               Error code
+ */
+static pb_error_t
+feed_step(
+    pb_decoder_feed_t *feed, const uint8_t data[], size_t left,
+    size_t *size) {
+  assert(feed && data && left && size);
+  *size = 0;
+
+  /* Decode values of packed fields, if inside a packed field */
+  const pb_descriptor_t *parent = feed->descriptor;
+  size_t limit = SIZE_MAX;
+  if (feed->frame.size) {
+    const pb_decoder_frame_t *frame =
+      &(feed->frame.data[feed->frame.size - 1]);
+    if (frame->packed)
+      return feed_step_packed(feed, data, left, size);
+    parent = frame->descriptor;
+    limit  = frame->end - feed->offset;
+  }
+  if (left > limit)
+    left = limit;
+
+  /* Read tag */
+  pb_tag_t tag; size_t read = feed_scan(data, left);
+  if (!read)
+    return feed_incomplete(left, limit < 5 ? limit : 5, PB_ERROR_VARINT);
+  if (unlikely_(!pb_varint_unpack_uint32(data, read, &tag)))
+    return PB_ERROR_VARINT;
+
+  /* Extract wiretype and tag */
+  pb_wiretype_t wiretype = tag & 7;
+  tag >>= 3;
+  if (unlikely_(!tag))
+    return PB_ERROR_INVALID;
+
+  /* Count field against budget, if any */
+  pb_error_t error = PB_ERROR_NONE;
+  if (unlikely_(feed->budget != NULL) &&
+      unlikely_(error = budget_field(feed->budget)))
+    return error;
+
+  /* Read length prefix for length-prefixed fields */
+  uint32_t length = 0; size_t prefix = 0;
+  if (wiretype == PB_WIRETYPE_LENGTH) {
+    if (!(prefix = feed_scan(&(data[read]), left - read)))
+      return feed_incomplete(left - read,
+        limit - read < 5 ? limit - read : 5, PB_ERROR_VARINT);
+    if (unlikely_(!pb_varint_unpack_uint32(&(data[read]), prefix, &length)))
+      return PB_ERROR_VARINT;
+    if (unlikely_(length > limit - read - prefix))
+      return PB_ERROR_OFFSET;
+  }
+
+  /* Check descriptor and skip field if unknown */
+  const pb_field_descriptor_t *descriptor =
+    pb_descriptor_field_by_tag(parent, tag);
+  if (unlikely_(!descriptor)) {
+    if (unlikely_((wiretype == PB_WIRETYPE_64BIT && limit - read < 8) ||
+                  (wiretype == PB_WIRETYPE_32BIT && limit - read < 4)))
+      return PB_ERROR_OFFSET;
+    switch (wiretype) {
+      case PB_WIRETYPE_VARINT: {
+        size_t skip = feed_scan(&(data[read]), left - read);
+        if (!skip)
+          return feed_incomplete(left - read,
+            limit - read < 10 ? limit - read : 10, PB_ERROR_VARINT);
+        *size = read + skip;
+        break;
+      }
+      case PB_WIRETYPE_64BIT:
+        feed->skip = 8;
+        *size = read;
+        break;
+      case PB_WIRETYPE_LENGTH:
+        feed->skip = length;
+        *size = read + prefix;
+        break;
+      case PB_WIRETYPE_32BIT:
+        feed->skip = 4;
+        *size = read;
+        break;
+      default:
+        return PB_ERROR_INVALID;
+    }
+    return PB_ERROR_NONE;
+  }
+
+  /* Check length of strings against budget before retaining them, if any */
+  pb_type_t type = pb_field_descriptor_type(descriptor);
+  if (unlikely_(feed->budget != NULL) && wiretype == PB_WIRETYPE_LENGTH &&
+      unlikely_(error = budget_length(feed->budget, type, length)))
+    return error;
+
+  /* Non-packed fields may also be encoded in packed encoding */
+  if (wiretype != pb_field_descriptor_wiretype(descriptor) &&
+      wiretype == PB_WIRETYPE_LENGTH) {
+    if (!length || !(error = feed_push(feed, parent, descriptor,
+        feed->offset + read + prefix + length)))
+      *size = read + prefix;
+
+  /* Enter nested message and invoke handler */
+  } else if (type == PB_TYPE_MESSAGE) {
+    if (unlikely_(wiretype != PB_WIRETYPE_LENGTH))
+      return PB_ERROR_INVALID;
+    if (!(error = feed_push(feed, pb_field_descriptor_nested(descriptor),
+        NULL, feed->offset + read + prefix + length))) {
+      *size = read + prefix;
+      error = feed->handler(descriptor, &length, feed->user);
+    }
+
+  /* Read length-prefixed value, which must be complete */
+  } else if (wiretype == PB_WIRETYPE_LENGTH) {
+    if (read + prefix + length > left)
+      return PB_ERROR_NONE;
+    pb_string_t value = pb_string_init(
+      (uint8_t *)&(data[read + prefix]), length);
+    *size = read + prefix + length;
+    if (type == PB_TYPE_STRING && pb_field_descriptor_utf8(descriptor) &&
+        !pb_utf8_valid(pb_string_data(&value), pb_string_size(&value)))
+      return PB_ERROR_INVALID;
+    error = feed->handler(descriptor, &value, feed->user);
+
+  /* Reject values not encoded with the wiretype of their field */
+  } else if (unlikely_(wiretype != pb_field_descriptor_wiretype(descriptor))) {
+    return PB_ERROR_INVALID;
+
+  /* Read variable-sized or fixed-sized value */
+  } else {
+    void *value = alloca(pb_field_descriptor_type_size(descriptor));
+    if (wiretype == PB_WIRETYPE_VARINT) {
+      size_t bytes = feed_scan(&(data[read]), left - read);
+      if (!bytes)
+        return feed_incomplete(left - read,
+          limit - read < 10 ? limit - read : 10, PB_ERROR_VARINT);
+      if (unlikely_(!pb_varint_unpack(type, &(data[read]), bytes, value)))
+        return PB_ERROR_VARINT;
+      *size = read + bytes;
+    } else {
+      size_t bytes = pb_field_descriptor_type_size(descriptor);
+      if (read + bytes > left)
+        return feed_incomplete(left, limit, PB_ERROR_OFFSET);
+      pb_endian_copy(value, &(data[read]), 1, bytes);
+      *size = read + bytes;
+    }
+    error = feed->handler(descriptor, value, feed->user);
+  }
   return error;
 }
+
+/*!
+ * Decode as many fields as possible from a chunk.
+ *
+ * If a slice is given, decoding stops at the first field boundary after the
+ * given number of bytes was read or the given number of fields and values of
+ * packed fields was decoded, the latter of which is decremented accordingly.
+ *
+ * \param[in,out] feed   Feed decoder
+ * \param[in]     data[] Source buffer
+ * \param[in]     left   Remaining bytes
+ * \param[in]     bytes  Bytes of slice
+ * \param[in,out] fields Fields of slice or NULL
+ * \param[out]    size   Bytes read
+ * \return               Error code
+ */
+static pb_error_t
+feed_decode(
+    pb_decoder_feed_t *feed, const uint8_t data[], size_t left,
+    size_t bytes, size_t *fields, size_t *size) {
+  assert(feed && (data || !left) && size);
+  pb_error_t error = PB_ERROR_NONE;
+  for (*size = 0; !error; ) {
+
+    /* Skip remaining bytes of unknown field */
+    if (feed->skip) {
+      size_t skip = feed->skip < left - *size ? feed->skip : left - *size;
+      feed->skip   -= skip;
+      feed->offset += skip;
+      *size        += skip;
+      if (feed->skip)
+        break;
+    }
+
+    /* Leave all nested messages and packed fields that end here */
+    while (feed->frame.size &&
+        feed->frame.data[feed->frame.size - 1].end == feed->offset)
+      if (!feed->frame.data[--feed->frame.size].packed)
+        feed->depth--;
+
+    /* Decode next field, if bytes are left and the slice isn't exhausted */
+    size_t read = 0, count = feed->budget ? feed->budget->count : 0;
+    if (*size == left || *size >= bytes || (fields && !*fields))
+      break;
+    if (!(error = feed_step(feed, &(data[*size]), left - *size, &read))) {
+
+      /* Restore field count, as incomplete fields are decoded again */
+      if (!read) {
+        if (feed->budget)
+          feed->budget->count = count;
+        break;
+      }
+      feed->offset += read;
+      *size        += read;
+      if (fields)
+        (*fields)--;
+    }
+  }
+  return error;
+}
+
+/* ----------------------------------------------------------------------------
+ * Interface
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Create a decoder.
+ *
+ * \warning A decoder does not take ownership of the provided buffer, so the
+ * caller must ensure that the buffer is not freed during operations.
+ *
+ * \param[in] descriptor Descriptor
+ * \param[in] buffer     Buffer
+ * \return               Decoder
+ */
+extern pb_decoder_t
+pb_decoder_create(
+    const pb_descriptor_t *descriptor, const pb_buffer_t *buffer) {
+  assert(descriptor && buffer);
+  return pb_decoder_create_with_flags(descriptor, buffer, 0);
+}
+
+/*!
+ * Create a decoder with flags.
+ *
+ * If the PB_DECODER_FLAG_UTF8 flag is set, all string fields are validated
+ * to contain UTF-8, not only those which are flagged in their descriptors.
+ * Decoders for nested messages inherit the flags.
+ *
+ * \param[in] descriptor Descriptor
+ * \param[in] buffer     Buffer
+ * \param[in] flags      Flags
+ * \return               Decoder
+ */
+extern pb_decoder_t
+pb_decoder_create_with_flags(
+    const pb_descriptor_t *descriptor, const pb_buffer_t *buffer,
+    uint8_t flags) {
+  assert(descriptor && buffer);
+  pb_decoder_t decoder = {
+    .descriptor = descriptor,
+    .buffer     = buffer,
+    .flags      = flags,
+    .budget     = NULL,
+    .intern     = NULL,
+    .index      = NULL,
+    .unknown    = NULL,
+    .depth      = 0
+  };
+  return decoder;
+}
+
+/*!
+ * Destroy a decoder.
+ *
+ * \param[in,out] decoder Decoder
+ */
+extern void
+pb_decoder_destroy(pb_decoder_t *decoder) {
+  assert(decoder); /* Nothing to be done */
+}
+
+/*!
+ * Decode a buffer using a handler.
+ *
+ * \param[in]     decoder Decoder
+ * \param[in]     handler Handler
+ * \param[in,out] user    User data
+ * \return                Error code
+ */
+extern pb_error_t
+pb_decoder_decode(
+    const pb_decoder_t *decoder, pb_decoder_handler_f handler, void *user) {
+  assert(decoder && handler);
+  return decode(decoder, NULL, handler, NULL, 0, user);
+}
+
+/*!
+ * Decode a buffer using a handler, checking for absent required fields.
+ *
+ * Fields are delivered to the handler as with pb_decoder_decode(), while the
+ * occurrences of required fields are tracked in the same pass. If a required
+ * field is absent after the last field was decoded, PB_ERROR_ABSENT is
+ * returned. Nested messages are only checked if the handler decodes them with
+ * this function as well, so the buffer must not be validated beforehand.
+ *
+ * \param[in]     decoder Decoder
+ * \param[in]     handler Handler
+ * \param[in,out] user    User data
+ * \return                Error code
+ */
+extern pb_error_t
+pb_decoder_decode_checked(
+    const pb_decoder_t *decoder, pb_decoder_handler_f handler, void *user) {
+  assert(decoder && handler);
+  return decode(decoder, NULL, handler, NULL, 1, user);
+}
+
+/*!
+ * Decode a buffer using a handler and a packed handler.
+ *
+ * Packed fields are not passed to the handler value by value, but are decoded
+ * into a typed array which is passed to the packed handler together with the
+ * number of values it contains. Packed fields with many values are delivered
+ * through consecutive invocations of the packed handler, as the array has a
+ * fixed capacity of 512 bytes, i.e. 64 values of 64-bit types. Non-packed
+ * fields are delivered to the handler as usual.
+ *
+ * \warning The array passed to the packed handler is only valid during the
+ * invocation, so the values must be copied if they should be retained.
+ *
+ * \param[in]     decoder Decoder
+ * \param[in]     handler Handler
+ * \param[in]     packed  Packed handler
+ * \param[in,out] user    User data
+ * \return                Error code
+ */
+extern pb_error_t
+pb_decoder_decode_packed(
+    const pb_decoder_t *decoder, pb_decoder_handler_f handler,
+    pb_decoder_packed_handler_f packed, void *user) {
+  assert(decoder && handler && packed);
+  return decode(decoder, NULL, handler, packed, 0, user);
+}
+
+/*!
+ * Decode a buffer using a handler, only delivering fields selected by a mask.
+ *
+ * The mask is a bitset of wanted tags, which is checked right after the tag
+ * of a field is read. All other fields are skipped without looking up their
+ * descriptors, reading their values or creating decoders for nested messages,
+ * so length-prefixed fields are jumped over in constant time.
+ *
+ * \param[in]     decoder Decoder
+ * \param[in]     mask    Mask
+ * \param[in]     handler Handler
+ * \param[in,out] user    User data
+ * \return                Error code
+ */
+extern pb_error_t
+pb_decoder_decode_masked(
+    const pb_decoder_t *decoder, const pb_decoder_mask_t *mask,
+    pb_decoder_handler_f handler, void *user) {
+  assert(decoder && mask && handler);
+  return decode(decoder, mask, handler, NULL, 0, user);
+}
+
+/*!
+ * Decode a buffer into a struct according to a layout.
+ *
+ * In contrast to pb_decoder_decode(), no handler is invoked, but all values
+ * are written into the members of the struct. The struct is initialized with
+ * the default values of the descriptor first. Strings and bytes are not copied
+ * but refer to the underlying buffer, so the buffer must outlive the struct.
+ *
+ * \warning Nested messages and repeated fields are allocated, so the struct
+ * must be cleared with pb_layout_clear() when it is no longer needed. If an
+ * error occurs, the struct is cleared before returning.
+ *
+ * \param[in]  decoder Decoder
+ * \param[in]  layout  Layout
+ * \param[out] value   Pointer holding struct
+ * \return             Error code
+ */
+extern pb_error_t
+pb_decoder_decode_into(
+    const pb_decoder_t *decoder, const pb_layout_t *layout, void *value) {
+  assert(decoder && layout && value);
+  assert(pb_layout_descriptor(layout) == decoder->descriptor);
+  if (unlikely_(!pb_decoder_valid(decoder)))
+    return PB_ERROR_INVALID;
+
+  /* Check size of message against budget, if any */
+  pb_error_t error = PB_ERROR_NONE;
+  if (unlikely_(decoder->budget != NULL)) {
+    if (!decoder->depth)
+      decoder->budget->count = 0;
+    if (unlikely_(error = budget_size(decoder->budget,
+        pb_buffer_size(decoder->buffer))))
+      return error;
+  }
+
+  /* Initialize struct and decode buffer into it */
+  pb_layout_init(layout, value);
+  error = decode_struct(decoder->buffer, layout, value,
+    decoder->budget, decoder->depth);
+  if (unlikely_(error))
+    pb_layout_clear(layout, value);
+  return error;
+}
+
+/*!
+ * Decode a single field from a stream into a struct according to a layout.
+ *
+ * The key, which combines the tag and wiretype of the field, must already be
+ * read from the stream, which is advanced past the value. This is the generic
+ * path for generated decoders, which handle frequent fields themselves and
+ * delegate all other fields, e.g. repeated fields or nested messages.
+ *
+ * \warning The struct is not initialized or cleared, so the caller must take
+ * care of both, as pb_decoder_decode_into() does.
+ *
+ * \param[in,out] stream Stream
+ * \param[in]     layout Layout
+ * \param[in,out] value  Pointer holding struct
+ * \param[in]     key    Tag and wiretype
+ * \return               Error code
+ */
+extern pb_error_t
+pb_decoder_decode_field_into(
+    pb_stream_t *stream, const pb_layout_t *layout, void *value,
+    uint32_t key) {
+  assert(stream && layout && value);
+  return decode_struct_field(stream, layout, value, key >> 3, key & 7,
+    NULL, 0);
+}
+
+/*!
+ * Skip a single field of a stream.
+ *
+ * The key, which combines the tag and wiretype of the field, must already be
+ * read from the stream, which is advanced past the value. This is used by
+ * generated visitors to skip unknown fields and fields without callback.
+ *
+ * \param[in,out] stream Stream
+ * \param[in]     key    Tag and wiretype
+ * \return               Error code
+ */
+extern pb_error_t
+pb_decoder_skip_field(pb_stream_t *stream, uint32_t key) {
+  assert(stream);
+  pb_wiretype_t wiretype = key & 7;
+  if (unlikely_(wiretype != PB_WIRETYPE_VARINT &&
+      wiretype != PB_WIRETYPE_64BIT && wiretype != PB_WIRETYPE_LENGTH &&
+      wiretype != PB_WIRETYPE_32BIT))
+    return PB_ERROR_INVALID;
+  return pb_stream_skip(stream, wiretype);
+}
+
+/*!
+ * Decode a nested message using a handler for its decoder.
+ *
+ * A zero-copy buffer and a decoder inheriting the flags and budget of the
+ * parent decoder are created on top of the raw nested message, and handed to
+ * the handler. This is used by generated visitors to descend into nested
+ * messages.
+ *
+ * \param[in]     decoder    Decoder
+ * \param[in]     descriptor Descriptor of nested message
+ * \param[in]     value      Raw nested message
+ * \param[in]     handler    Nested handler
+ * \param[in,out] user       User data
+ * \return                   Error code
+ */
+extern pb_error_t
+pb_decoder_decode_nested(
+    const pb_decoder_t *decoder, const pb_descriptor_t *descriptor,
+    const pb_string_t *value, pb_decoder_nested_handler_f handler,
+    void *user) {
+  assert(decoder && descriptor && value && handler);
+  pb_error_t error = PB_ERROR_NONE;
+  if (unlikely_(decoder->budget != NULL) &&
+      unlikely_(error = budget_depth(decoder->budget, decoder->depth + 1)))
+    return error;
+  pb_buffer_t buffer = pb_buffer_create_zero_copy_internal(
+    (uint8_t *)pb_string_data(value), pb_string_size(value));
+
+  /* Create decoder for nested message and invoke handler */
+  pb_decoder_t subdecoder = pb_decoder_create_with_flags(
+    descriptor, &buffer, decoder->flags);
+  subdecoder.budget = decoder->budget;
+  subdecoder.intern = decoder->intern;
+  subdecoder.depth  = decoder->depth + 1;
+  error = handler(&subdecoder, user);
+
+  /* Free all allocated memory */
+  pb_decoder_destroy(&subdecoder);
+  pb_buffer_destroy(&buffer);
+  return error;
+}
+
+/* ------------------------------------------------------------------------- */
+
+/*!
+ * Create an index of field offsets.
+ *
+ * \return Index
+ */
+extern pb_decoder_index_t
+pb_decoder_index_create(void) {
+  return pb_decoder_index_create_with_allocator(&allocator_default);
+}
+
+/*!
+ * Create an index of field offsets using a custom allocator.
+ *
+ * An index is filled by a decoder it is attached to with
+ * pb_decoder_set_index(), and can be reused for decoding further messages,
+ * retaining its memory. Entries are only allocated upon the first decoding.
+ *
+ * \warning An index does not take ownership of the provided allocator, so the
+ * caller must ensure that the allocator is not freed during operations.
+ *
+ * \param[in,out] allocator Allocator
+ * \return                  Index
+ */
+extern pb_decoder_index_t
+pb_decoder_index_create_with_allocator(pb_allocator_t *allocator) {
+  assert(allocator);
+  pb_decoder_index_t index = {
+    .allocator    = allocator,
+    .descriptor   = NULL,
+    .entry        = {
+      .data       = NULL,
+      .capacity   = 0
+    },
+    .size         = 0,
+    .complete     = 0
+  };
+  return index;
+}
+
+/*!
+ * Destroy an index of field offsets.
+ *
+ * \param[in,out] index Index
+ */
+extern void
+pb_decoder_index_destroy(pb_decoder_index_t *index) {
+  assert(index);
+  if (index->entry.data) {
+    pb_allocator_free(index->allocator, index->entry.data);
+    index->entry.data     = NULL;
+    index->entry.capacity = 0;
+  }
+  index->descriptor = NULL;
+  index->complete   = 0;
+}
+
+/*!
+ * Retrieve the entry of a field from a complete index of field offsets.
+ *
+ * Offsets refer to the tag of the respective occurrence. If the field didn't
+ * occur, the entry holds a count of zero. If the index is incomplete or the
+ * tag is not a field of the indexed message, e.g. an extension, NULL is
+ * returned, as no statement can be made about it.
+ *
+ * \param[in] index Index
+ * \param[in] tag   Tag
+ * \return          Entry
+ */
+extern const pb_decoder_index_entry_t *
+pb_decoder_index_find(const pb_decoder_index_t *index, pb_tag_t tag) {
+  assert(index && tag);
+  if (!pb_decoder_index_complete(index))
+    return NULL;
+  const pb_field_descriptor_t
+    *descriptor = pb_descriptor_field_by_tag(index->descriptor, tag),
+    *fields     = index->descriptor->field.data;
+  return descriptor && descriptor >= fields &&
+      descriptor < fields + pb_descriptor_size(index->descriptor)
+    ? &(index->entry.data[descriptor - fields])
+    : NULL;
+}
+
+/* ------------------------------------------------------------------------- */
+
+/*!
+ * Create a feed decoder.
+ *
+ * \param[in]     descriptor Descriptor
+ * \param[in]     handler    Handler
+ * \param[in,out] user       User data
+ * \return                   Feed decoder
+ */
+extern pb_decoder_feed_t
+pb_decoder_feed_create(
+    const pb_descriptor_t *descriptor, pb_decoder_handler_f handler,
+    void *user) {
+  return pb_decoder_feed_create_with_allocator(
+    &allocator_default, descriptor, handler, user);
+}
+
+/*!
+ * Create a feed decoder using a custom allocator.
+ *
+ * A feed decoder decodes a message incrementally from chunks of arbitrary
+ * size, and invokes the handler as soon as a field is complete. Only the bytes
+ * of incomplete fields are retained between invocations, so the decoder never
+ * needs the whole message in one contiguous buffer.
+ *
+ * Nested messages are not handed to the handler as a decoder, as they may not
+ * be available as a whole. Instead, they are entered and tracked on an
+ * explicit stack: the handler is invoked with the field descriptor of the
+ * nested message and a pointer to its length as an unsigned 32-bit integer,
+ * followed by invocations for the fields of the nested message.
+ *
+ * \warning A feed decoder does not take ownership of the provided allocator,
+ * so the caller must ensure that the allocator is not freed during operations.
+ *
+ * \param[in,out] allocator  Allocator
+ * \param[in]     descriptor Descriptor
+ * \param[in]     handler    Handler
+ * \param[in,out] user       User data
+ * \return                   Feed decoder
+ */
+extern pb_decoder_feed_t
+pb_decoder_feed_create_with_allocator(
+    pb_allocator_t *allocator, const pb_descriptor_t *descriptor,
+    pb_decoder_handler_f handler, void *user) {
+  assert(allocator && descriptor && handler);
+  pb_decoder_feed_t feed = {
+    .descriptor = descriptor,
+    .handler    = handler,
+    .user       = user,
+    .buffer     = pb_buffer_create_empty_with_allocator(allocator),
+    .frame      = {
+      .data     = NULL,
+      .size     = 0,
+      .capacity = 0
+    },
+    .depth      = 0,
+    .offset     = 0,
+    .skip       = 0,
+    .budget     = NULL,
+    .error      = PB_ERROR_NONE
+  };
+  return feed;
+}
+
+/*!
+ * Destroy a feed decoder.
+ *
+ * \param[in,out] feed Feed decoder
+ */
+extern void
+pb_decoder_feed_destroy(pb_decoder_feed_t *feed) {
+  assert(feed);
+  if (feed->frame.data) {
+    pb_allocator_free(pb_buffer_allocator(&(feed->buffer)),
+      feed->frame.data);
+    feed->frame.data     = NULL;
+    feed->frame.size     = 0;
+    feed->frame.capacity = 0;
+  }
+  pb_buffer_destroy(&(feed->buffer));
+}
+
+/*!
+ * Feed a chunk to a feed decoder.
+ *
+ * All fields that are complete after appending the chunk are decoded, and the
+ * handler is invoked for each of them. If a chunk ends within a field, the
+ * bytes of the incomplete field are copied to an internal buffer and decoding
+ * is resumed upon the next invocation. Unknown fields are skipped across chunk
+ * boundaries without being retained.
+ *
+ * If bytes are retained, only as many bytes of the next chunk are appended as
+ * are necessary to complete the pending field, starting with a few bytes and
+ * doubling the amount, after which decoding continues directly from the chunk.
+ * Thus, only fields that span chunks are copied.
+ *
+ * \warning Values passed to the handler point into the chunk or the internal
+ * buffer, so they are only valid during the invocation of the handler.
+ *
+ * \param[in,out] feed    Feed decoder
+ * \param[in]     chunk[] Chunk
+ * \param[in]     size    Chunk size
+ * \return                Error code
+ */
+extern pb_error_t
+pb_decoder_feed(pb_decoder_feed_t *feed, const uint8_t chunk[], size_t size) {
+  assert(feed && (chunk || !size));
+  if (unlikely_(feed->error))
+    return feed->error;
+  if (unlikely_(!size))
+    return PB_ERROR_NONE;
+
+  /* Check size of message against budget before decoding the chunk, if any */
+  if (unlikely_(feed->budget != NULL)) {
+    size_t retained = pb_buffer_size(&(feed->buffer));
+    if (!feed->offset && !retained)
+      feed->budget->count = 0;
+    if (unlikely_(feed->error = budget_size(feed->budget,
+        feed->offset + retained + size)))
+      return feed->error;
+  }
+
+  /* Complete pending field by appending as few bytes as possible */
+  size_t read = 0, offset = 0;
+  for (size_t step = 16; !pb_buffer_empty(&(feed->buffer)); step <<= 1) {
+    size_t retained = pb_buffer_size(&(feed->buffer));
+    if (offset == size)
+      return PB_ERROR_NONE;
+
+    /* Append next bytes of chunk to retained bytes and decode */
+    size_t bytes = step < size - offset ? step : size - offset;
+    uint8_t *data = pb_buffer_grow(&(feed->buffer), bytes);
+    if (unlikely_(!data))
+      return feed->error = PB_ERROR_ALLOC;
+    memcpy(data, &(chunk[offset]), bytes);
+    offset += bytes;
+    if (unlikely_(feed->error = feed_decode(feed,
+        pb_buffer_data(&(feed->buffer)), pb_buffer_size(&(feed->buffer)),
+        SIZE_MAX, NULL, &read)))
+      return feed->error;
+
+    /* Continue from chunk if all retained bytes were consumed */
+    if (read >= retained) {
+      offset -= pb_buffer_size(&(feed->buffer)) - read;
+      feed->buffer.size = 0;
+    } else {
+      memmove(feed->buffer.data, &(feed->buffer.data[read]),
+        feed->buffer.size - read);
+      feed->buffer.size -= read;
+    }
+  }
+
+  /* Decode directly from chunk and retain incomplete field */
+  if (!(feed->error = feed_decode(feed,
+      &(chunk[offset]), size - offset, SIZE_MAX, NULL, &read)) &&
+      read < size - offset) {
+    uint8_t *data = pb_buffer_grow(&(feed->buffer), size - offset - read);
+    if (data) {
+      memcpy(data, &(chunk[offset + read]), size - offset - read);
+    } else {
+      feed->error = PB_ERROR_ALLOC;
+    }
+  }
+  return feed->error;
+}
+
+/*!
+ * Feed a chain of segments to a feed decoder.
+ *
+ * Network stacks often hand out a message as a chain of segments, which would
+ * otherwise need to be copied into a contiguous buffer before decoding. Every
+ * field that lies within a segment is decoded in place, and only the bytes of
+ * fields spanning segments are copied, as with pb_decoder_feed().
+ *
+ * \warning Values passed to the handler point into the segments or the
+ * internal buffer, so they are only valid during the invocation of the handler.
+ *
+ * \param[in,out] feed       Feed decoder
+ * \param[in]     segments[] Segments
+ * \param[in]     size       Segment count
+ * \return                   Error code
+ */
+extern pb_error_t
+pb_decoder_feed_segments(
+    pb_decoder_feed_t *feed, const pb_string_t segments[], size_t size) {
+  assert(feed && (segments || !size));
+  pb_error_t error = feed->error;
+  for (size_t s = 0; !error && s < size; s++)
+    error = pb_decoder_feed(feed,
+      pb_string_data(&(segments[s])), pb_string_size(&(segments[s])));
+  return error;
+}
+
+/*!
+ * Decode the next slice of a complete message with a feed decoder.
+ *
+ * A single large message may take long to decode, which would block an event
+ * loop or coroutine scheduler for the whole time. Instead, decoding stops at
+ * the first field boundary after the given number of bytes was read or the
+ * given number of fields and values of packed fields was decoded, where zero
+ * means no limit, but at least one field is always decoded. As the nesting
+ * stack is kept in the feed decoder, the next invocation with the same message
+ * resumes exactly where the last one stopped, with the same handler semantics
+ * as pb_decoder_feed(). The offset of the feed decoder is the continuation,
+ * i.e. the message is exhausted once it equals the size of the message:
+ *
+ * while (!(error = pb_decoder_feed_slice(&feed, data, size, 65536, 0)) &&
+ *     pb_decoder_feed_offset(&feed) < size)
+ *   yield();
+ *
+ * Since the message is complete, fields are always decoded in place and never
+ * copied, so slices must not be mixed with chunks fed to the same message.
+ *
+ * \warning Values passed to the handler point into the message, so the caller
+ * must ensure that the message is not altered or freed between slices.
+ *
+ * \param[in,out] feed   Feed decoder
+ * \param[in]     data[] Message
+ * \param[in]     size   Message size
+ * \param[in]     bytes  Bytes per slice or zero
+ * \param[in]     fields Fields per slice or zero
+ * \return               Error code
+ */
+extern pb_error_t
+pb_decoder_feed_slice(
+    pb_decoder_feed_t *feed, const uint8_t data[], size_t size,
+    size_t bytes, size_t fields) {
+  assert(feed && (data || !size));
+  if (unlikely_(feed->error))
+    return feed->error;
+  if (unlikely_(feed->offset > size || !pb_buffer_empty(&(feed->buffer))))
+    return feed->error = PB_ERROR_INVALID;
+
+  /* Check size of message against budget before the first slice, if any */
+  if (unlikely_(feed->budget != NULL) && !feed->offset) {
+    feed->budget->count = 0;
+    if (unlikely_(feed->error = budget_size(feed->budget, size)))
+      return feed->error;
+  }
+
+  /* Decode slice directly from message */
+  size_t left = size - feed->offset, read;
+  size_t limit = bytes ? bytes : SIZE_MAX, count = fields ? fields : SIZE_MAX;
+  if (unlikely_(feed->error = feed_decode(feed,
+      left ? &(data[feed->offset]) : NULL, left, limit, &count, &read)))
+    return feed->error;
+
+  /* Stopping before the end of the slice means that a field is truncated */
+  if (read < left && read < limit && count)
+    feed->error = PB_ERROR_OFFSET;
+  return feed->error;
+}
+
+/*!
+ * Finish decoding a message with a feed decoder.
+ *
+ * If the message is complete, i.e. all nested messages and fields have been
+ * decoded entirely, the feed decoder is reset, so it can be reused to decode
+ * the next message. Otherwise an error is returned.
+ *
+ * \param[in,out] feed Feed decoder
+ * \return             Error code
+ */
+extern pb_error_t
+pb_decoder_feed_finish(pb_decoder_feed_t *feed) {
+  assert(feed);
+  if (unlikely_(feed->error))
+    return feed->error;
+
+  /* Leave all nested messages and packed fields that end here */
+  size_t read;
+  if (unlikely_(feed->error = feed_decode(feed, NULL, 0, SIZE_MAX, NULL,
+      &read)))
+    return feed->error;
+
+  /* Ensure that no field or nested message is incomplete */
+  if (feed->frame.size || feed->skip || !pb_buffer_empty(&(feed->buffer)))
+    return PB_ERROR_OFFSET;
+  feed->offset = 0;
+  return PB_ERROR_NONE;
+}
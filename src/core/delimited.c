@@ -0,0 +1,293 @@
+/*
+ * Copyright (c) 2013-2020 Martin Donath <martin.donath@squidfunk.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <assert.h>
+#include <errno.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "core/buffer.h"
+#include "core/common.h"
+#include "core/delimited.h"
+#include "core/varint.h"
+
+/* ----------------------------------------------------------------------------
+ * Internal functions
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Refill the read-ahead buffer of a delimited reader from its file descriptor.
+ *
+ * Unread data is moved to the front of the buffer, which is grown to hold at
+ * least the given total size, and the remaining space is filled with as many
+ * bytes as the file descriptor yields in a single read.
+ *
+ * \param[in,out] reader Reader
+ * \param[in]     size   Minimum total size
+ * \return               Bytes read, 0 on end of file, -1 on error
+ */
+static ssize_t
+refill(pb_delimited_reader_t *reader, size_t size) {
+  assert(reader && reader->fd >= 0);
+  pb_buffer_t *buffer = &(reader->buffer);
+
+  /* Move unread data to the front of the buffer */
+  size_t left = buffer->size - reader->offset;
+  if (left && reader->offset)
+    memmove(buffer->data, buffer->data + reader->offset, left);
+  buffer->size   = left;
+  reader->offset = 0;
+
+  /* Ensure capacity for the given total size */
+  if (unlikely_(pb_buffer_ensure(buffer, size)))
+    return -1;
+
+  /* Read as many bytes as possible, retrying upon interruption */
+  ssize_t bytes;
+  do {
+    bytes = read(reader->fd, buffer->data + buffer->size,
+      buffer->capacity - buffer->size);
+  } while (unlikely_(bytes < 0 && errno == EINTR));
+  if (bytes > 0)
+    buffer->size += (size_t)bytes;
+  return bytes;
+}
+
+/* ----------------------------------------------------------------------------
+ * Interface
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Create a delimited reader over a buffer.
+ *
+ * The buffer is expected to contain a sequence of messages, each prefixed with
+ * its length as a variable-sized integer, as written by Java's writeDelimitedTo
+ * and similar functions of other implementations. Messages are returned as
+ * zero-copy buffers, so a memory-mapped file can be read without copying.
+ *
+ * \warning The reader does not take ownership of the provided buffer, so the
+ * caller must ensure that the buffer is not freed during operations.
+ *
+ * \param[in] buffer Buffer
+ * \return           Reader
+ */
+extern pb_delimited_reader_t
+pb_delimited_reader_create(const pb_buffer_t *buffer) {
+  assert(buffer);
+  pb_delimited_reader_t reader = {
+    .buffer = pb_buffer_valid(buffer)
+      ? pb_buffer_create_zero_copy_internal(
+          (uint8_t *)pb_buffer_data(buffer), pb_buffer_size(buffer))
+      : pb_buffer_create_invalid(),
+    .offset = 0,
+    .fd     = -1
+  };
+  return reader;
+}
+
+/*!
+ * Create a delimited reader over a file descriptor.
+ *
+ * Data is read ahead in chunks of the given capacity, so a stream of small
+ * messages only issues a system call every few messages. The read-ahead
+ * buffer grows if a single message exceeds its capacity.
+ *
+ * \warning The reader does not take ownership of the file descriptor, so the
+ * caller must close it after destroying the reader.
+ *
+ * \param[in] fd       File descriptor
+ * \param[in] capacity Read-ahead capacity
+ * \return             Reader
+ */
+extern pb_delimited_reader_t
+pb_delimited_reader_create_from_fd(int fd, size_t capacity) {
+  assert(fd >= 0 && capacity);
+  pb_delimited_reader_t reader = {
+    .buffer = pb_buffer_create_empty(),
+    .offset = 0,
+    .fd     = fd
+  };
+  if (unlikely_(pb_buffer_reserve(&(reader.buffer), capacity))) {
+    pb_buffer_destroy(&(reader.buffer));
+    reader.buffer = pb_buffer_create_invalid();
+  }
+  return reader;
+}
+
+/*!
+ * Destroy a delimited reader.
+ *
+ * \param[in,out] reader Reader
+ */
+extern void
+pb_delimited_reader_destroy(pb_delimited_reader_t *reader) {
+  assert(reader);
+  pb_buffer_destroy(&(reader->buffer));
+}
+
+/*!
+ * Read the next message from a delimited reader.
+ *
+ * The returned message is a zero-copy buffer pointing into the reader, which
+ * is only valid until the next invocation of this function or destruction of
+ * the reader. A decoder can be created on top of it to process the message.
+ *
+ * \param[in,out] reader  Reader
+ * \param[out]    message Buffer receiving message
+ * \return                Error code
+ */
+extern pb_error_t
+pb_delimited_reader_next(
+    pb_delimited_reader_t *reader, pb_buffer_t *message) {
+  assert(reader && message);
+  if (unlikely_(!pb_delimited_reader_valid(reader)))
+    return PB_ERROR_INVALID;
+
+  /* Read length prefix and message, refilling the buffer if necessary */
+  pb_buffer_t *buffer = &(reader->buffer);
+  for (;;) {
+    size_t left = buffer->size - reader->offset, size = 0;
+    uint32_t length = 0;
+    if (left) {
+      size = pb_varint_unpack_uint32(
+        pb_buffer_data_from(buffer, reader->offset), left, &length);
+
+      /* Return message, if contained entirely in the buffer */
+      if (likely_(size && left - size >= length)) {
+        *message = pb_buffer_create_zero_copy_internal(
+          pb_buffer_data_from(buffer, reader->offset + size), length);
+        reader->offset += size + length;
+        return PB_ERROR_NONE;
+      }
+
+      /* Length prefixes span at most 5 bytes */
+      if (unlikely_(!size && left >= 5))
+        return PB_ERROR_VARINT;
+    }
+
+    /* Fail on truncated data, as no more data can be read */
+    if (reader->fd < 0)
+      return left ? PB_ERROR_OFFSET : PB_ERROR_EOM;
+
+    /* Read more data, growing the buffer to hold the entire message */
+    ssize_t bytes = refill(reader, size ? size + length : left + 5);
+    if (unlikely_(bytes < 0))
+      return PB_ERROR_INVALID;
+    if (!bytes)
+      return left ? PB_ERROR_OFFSET : PB_ERROR_EOM;
+  }
+}
+
+/*!
+ * Create a delimited writer over a file descriptor.
+ *
+ * Messages are not copied, but referenced until they are flushed, and written
+ * together with their length prefixes in batches using a single system call.
+ *
+ * \warning The writer does not take ownership of the file descriptor, so the
+ * caller must close it after flushing the writer.
+ *
+ * \param[in] fd File descriptor
+ * \return       Writer
+ */
+extern pb_delimited_writer_t
+pb_delimited_writer_create(int fd) {
+  assert(fd >= 0);
+  pb_delimited_writer_t writer = {
+    .fd   = fd,
+    .size = 0
+  };
+  return writer;
+}
+
+/*!
+ * Write a message to a delimited writer.
+ *
+ * The writer is flushed automatically once the batch is full. Otherwise, the
+ * message must not be altered or freed until the writer is flushed.
+ *
+ * \param[in,out] writer  Writer
+ * \param[in]     message Message
+ * \return                Error code
+ */
+extern pb_error_t
+pb_delimited_writer_write(
+    pb_delimited_writer_t *writer, const pb_buffer_t *message) {
+  assert(writer && message);
+  if (unlikely_(!pb_buffer_valid(message) ||
+                pb_buffer_size(message) > UINT32_MAX))
+    return PB_ERROR_INVALID;
+
+  /* Flush writer, if the batch is full */
+  pb_error_t error = PB_ERROR_NONE;
+  if (writer->size == PB_DELIMITED_WRITER_BATCH &&
+      (error = pb_delimited_writer_flush(writer)))
+    return error;
+
+  /* Pack length prefix and reference message */
+  uint32_t length = (uint32_t)pb_buffer_size(message);
+  struct iovec *iov = &(writer->iov[writer->size * 2]);
+  iov[0].iov_base = writer->prefix[writer->size];
+  iov[0].iov_len  = pb_varint_pack_uint32(writer->prefix[writer->size],
+    &length);
+  iov[1].iov_base = (uint8_t *)pb_buffer_data(message);
+  iov[1].iov_len  = length;
+  writer->size++;
+  return PB_ERROR_NONE;
+}
+
+/*!
+ * Flush all pending messages of a delimited writer.
+ *
+ * Partial writes are resumed until all data is written. If an error occurs,
+ * all pending messages are discarded.
+ *
+ * \param[in,out] writer Writer
+ * \return               Error code
+ */
+extern pb_error_t
+pb_delimited_writer_flush(pb_delimited_writer_t *writer) {
+  assert(writer);
+  struct iovec *iov = writer->iov;
+  int count = (int)writer->size * 2;
+  writer->size = 0;
+
+  /* Write vectors, skipping those already written */
+  while (count) {
+    ssize_t bytes = writev(writer->fd, iov, count);
+    if (unlikely_(bytes < 0)) {
+      if (errno == EINTR)
+        continue;
+      return PB_ERROR_INVALID;
+    }
+    for (; count && (size_t)bytes >= iov->iov_len; iov++, count--)
+      bytes -= iov->iov_len;
+    if (count) {
+      iov->iov_base  = (uint8_t *)iov->iov_base + bytes;
+      iov->iov_len  -= (size_t)bytes;
+    }
+  }
+  return PB_ERROR_NONE;
+}
@@ -24,6 +24,7 @@
 #include <stdint.h>
 #include <stdlib.h>
 
+#include "core/allocator.h"
 #include "core/common.h"
 #include "core/descriptor.h"
 
@@ -41,6 +42,13 @@
 #define min(x, y) \
   ((x) < (y) ? (x) : (y))
 
+/* ----------------------------------------------------------------------------
+ * Variables
+ * ------------------------------------------------------------------------- */
+
+/*! Spin lock serializing the registration of extensions */
+static unsigned char lock = 0;
+
 /* ----------------------------------------------------------------------------
  * Mappings
  * ------------------------------------------------------------------------- */
@@ -89,6 +97,74 @@ pb_field_descriptor_wiretype_map[] = {
   [PB_TYPE_MESSAGE]  = PB_WIRETYPE_LENGTH
 };
 
+/* ----------------------------------------------------------------------------
+ * Internal functions
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Compare two field descriptors by tag.
+ *
+ * \param[in] x Pointer to field descriptor
+ * \param[in] y Pointer to field descriptor
+ * \return      Comparison result
+ */
+static int
+compare_by_tag(const void *x, const void *y) {
+  assert(x && y);
+  pb_tag_t a = pb_field_descriptor_tag(
+    *(const pb_field_descriptor_t *const *)x);
+  pb_tag_t b = pb_field_descriptor_tag(
+    *(const pb_field_descriptor_t *const *)y);
+  return (a > b) - (a < b);
+}
+
+/*!
+ * Merge the fields of all extensions of a descriptor into a sorted table.
+ *
+ * Concurrent lookups may still read the current table, so a new table is
+ * built and published atomically. Replaced tables are kept until the
+ * descriptor is reset, as there's no way of knowing when the last lookup is
+ * done with them. If the table cannot be allocated, the current table is
+ * withdrawn and lookups fall back to walking the chain of extensions, so the
+ * descriptor stays fully usable.
+ *
+ * \warning The caller has to hold the lock serializing registrations.
+ *
+ * \param[in,out] descriptor Descriptor
+ */
+static void
+merge(pb_descriptor_t *descriptor) {
+  assert(descriptor);
+  size_t size = 0;
+  for (const pb_descriptor_t *extension = descriptor->extension;
+      extension; extension = extension->extension)
+    size += extension->field.size;
+  if (!size)
+    return;
+
+  /* Allocate table to hold all extension fields */
+  pb_descriptor_extensions_t *table = pb_allocator_allocate(&allocator_default,
+    sizeof(pb_descriptor_extensions_t) + sizeof(*table->data) * size);
+  if (unlikely_(!table)) {
+    __atomic_store_n(&(descriptor->extensions.table), NULL, __ATOMIC_RELEASE);
+    return;
+  }
+
+  /* Collect and sort extension fields */
+  size_t f = 0;
+  for (const pb_descriptor_t *extension = descriptor->extension;
+      extension; extension = extension->extension)
+    for (size_t e = 0; e < extension->field.size; e++)
+      table->data[f++] = &(extension->field.data[e]);
+  qsort(table->data, size, sizeof(*table->data), compare_by_tag);
+  table->size = size;
+
+  /* Publish table and keep track of it */
+  table->previous = descriptor->extensions.tables;
+  descriptor->extensions.tables = table;
+  __atomic_store_n(&(descriptor->extensions.table), table, __ATOMIC_RELEASE);
+}
+
 /* ----------------------------------------------------------------------------
  * Interface
  * ------------------------------------------------------------------------- */
@@ -96,9 +172,22 @@ pb_field_descriptor_wiretype_map[] = {
 /*!
  * Retrieve the field descriptor for a given tag from a descriptor.
  *
- * We can leverage the fact that the fields are always in ascending order, as
- * the generator will generate it in this exact way, so using the tag number as
- * an array index, there are two scenarios:
+ * If the descriptor contains an index, which is emitted by the generator for
+ * all messages with reasonably dense tags, the field descriptor is looked up
+ * in constant time. The index maps every tag within its range to the position
+ * of the corresponding field descriptor plus one, so zero denotes an absent
+ * tag. The tags covered by the index start at the given offset, in order to
+ * support messages which exclusively use large tags.
+ *
+ * For messages with sparse tags, the generator emits a packed table of all
+ * tags in ascending order instead. Field descriptors are considerably larger
+ * than their tags, so searching the table with a binary search touches only a
+ * few cache lines, even for messages with hundreds of fields. Only the field
+ * descriptor that is eventually returned is accessed.
+ *
+ * Otherwise, we can leverage the fact that the fields are always in ascending
+ * order, as the generator will generate it in this exact way, so using the tag
+ * number as an array index, there are two scenarios:
  *
  * -# The tag number is smaller than the number of fields, so we can limit the
  *    fields we have to check to those left to the tag number array index. The
@@ -118,15 +207,56 @@ extern const pb_field_descriptor_t *
 pb_descriptor_field_by_tag(
     const pb_descriptor_t *descriptor, pb_tag_t tag) {
   assert(descriptor && tag);
-  for (size_t f = min(tag, descriptor->field.size); f > 0; ) {
-    if (pb_field_descriptor_tag(
-        &(descriptor->field.data[--f])) == tag) {
-      return &(descriptor->field.data[f]);
-    } else if (pb_field_descriptor_tag(
-        &(descriptor->field.data[f])) < tag) {
-      break;
+  if (descriptor->index.data) {
+    if (tag >= descriptor->index.offset &&
+        tag -  descriptor->index.offset < descriptor->index.size) {
+      size_t f = descriptor->index.data[tag - descriptor->index.offset];
+      if (likely_(f))
+        return &(descriptor->field.data[f - 1]);
+    }
+  } else if (descriptor->tag.data) {
+    size_t l = 0, r = descriptor->field.size;
+    while (l < r) {
+      size_t m = l + (r - l) / 2;
+      pb_tag_t current = descriptor->tag.data[m];
+      if (current == tag)
+        return &(descriptor->field.data[m]);
+      if (current < tag) {
+        l = m + 1;
+      } else {
+        r = m;
+      }
+    }
+  } else {
+    for (size_t f = min(tag, descriptor->field.size); f > 0; ) {
+      if (pb_field_descriptor_tag(
+          &(descriptor->field.data[--f])) == tag) {
+        return &(descriptor->field.data[f]);
+      } else if (pb_field_descriptor_tag(
+          &(descriptor->field.data[f])) < tag) {
+        break;
+      }
     }
   }
+
+  /* Search merged extension fields, if available */
+  const pb_descriptor_extensions_t *table =
+    __atomic_load_n(&(descriptor->extensions.table), __ATOMIC_ACQUIRE);
+  if (table) {
+    size_t l = 0, r = table->size;
+    while (l < r) {
+      size_t m = l + (r - l) / 2;
+      pb_tag_t current = pb_field_descriptor_tag(table->data[m]);
+      if (current == tag)
+        return table->data[m];
+      if (current < tag) {
+        l = m + 1;
+      } else {
+        r = m;
+      }
+    }
+    return NULL;
+  }
   return pb_descriptor_extension(descriptor) ?
     pb_descriptor_field_by_tag(
       pb_descriptor_extension(descriptor), tag) : NULL;
@@ -140,6 +270,17 @@ pb_descriptor_field_by_tag(
  * Before registering an extension, it is checked that the extension is not
  * already registered.
  *
+ * Additionally, the fields of all extensions are merged into a table sorted
+ * by tag, so looking up extension fields doesn't depend on the number of
+ * registered extensions. As extensions are registered rarely, the table is
+ * rebuilt on every registration.
+ *
+ * Extensions may be registered while other threads look up fields of the
+ * descriptor. Registrations are serialized, but lookups never block, as the
+ * extension and the rebuilt table are published with release semantics, so
+ * lookups either see the previous or the new state, but nothing in between.
+ * The extension must not be altered after it was registered.
+ *
  * \param[in,out] descriptor Descriptor
  * \param[in,out] extension  Descriptor extension
  */
@@ -147,12 +288,18 @@ extern void
 pb_descriptor_extend(
     pb_descriptor_t *descriptor, pb_descriptor_t *extension) {
   assert(descriptor && extension);
-  while (descriptor->extension) {
-    if (descriptor->extension == extension)
+  while (__atomic_test_and_set(&lock, __ATOMIC_ACQUIRE));
+  pb_descriptor_t *last = descriptor;
+  while (last->extension) {
+    if (last->extension == extension) {
+      __atomic_clear(&lock, __ATOMIC_RELEASE);
       return;
-    descriptor = descriptor->extension;
+    }
+    last = last->extension;
   }
-  descriptor->extension = extension;
+  __atomic_store_n(&(last->extension), extension, __ATOMIC_RELEASE);
+  merge(descriptor);
+  __atomic_clear(&lock, __ATOMIC_RELEASE);
 }
 
 /* ------------------------------------------------------------------------- */
@@ -160,8 +307,14 @@ pb_descriptor_extend(
 /*!
  * Retrieve the value descriptor for a given number from an enum descriptor.
  *
- * \warning To find the matching enum value descriptor quickly if any, the same
- * approach like in pb_descriptor_field_by_tag() is used.
+ * If the enum descriptor contains an index, which is emitted by the generator
+ * for all enums with reasonably dense numbers, the value descriptor is looked
+ * up in constant time, like in pb_descriptor_field_by_tag(). Otherwise, the
+ * value descriptors are searched with a binary search, so sparse enums and
+ * negative numbers are handled in logarithmic time.
+ *
+ * \warning The values need to be in ascending order of their numbers, as the
+ * generator will generate them in this exact way.
  *
  * \param[in] descriptor Enum descriptor
  * \param[in] number     Number
@@ -171,17 +324,27 @@ extern const struct pb_enum_value_descriptor_t *
 pb_enum_descriptor_value_by_number(
     const pb_enum_descriptor_t *descriptor, pb_enum_t number) {
   assert(descriptor);
-  if (descriptor->value.size) {
-    size_t v = min(number, descriptor->value.size - 1);
-    do {
-      if (pb_enum_value_descriptor_number(
-          &(descriptor->value.data[v])) == number) {
-        return &(descriptor->value.data[v]);
-      } else if (pb_enum_value_descriptor_number(
-          &(descriptor->value.data[v])) < number) {
-        break;
+  if (descriptor->index.data) {
+    if (number >= descriptor->index.offset && (size_t)
+        ((int64_t)number - descriptor->index.offset) < descriptor->index.size) {
+      size_t v = descriptor->index.data[number - descriptor->index.offset];
+      if (likely_(v))
+        return &(descriptor->value.data[v - 1]);
+    }
+  } else {
+    size_t l = 0, r = descriptor->value.size;
+    while (l < r) {
+      size_t m = l + (r - l) / 2;
+      pb_enum_t current = pb_enum_value_descriptor_number(
+        &(descriptor->value.data[m]));
+      if (current == number)
+        return &(descriptor->value.data[m]);
+      if (current < number) {
+        l = m + 1;
+      } else {
+        r = m;
       }
-    } while (v--);
+    }
   }
   return NULL;
 }
@@ -24,10 +24,26 @@
 #define PB_CORE_DESCRIPTOR_H
 
 #include <assert.h>
+#include <stdint.h>
+#include <string.h>
 
 #include <protobluff/core/descriptor.h>
 
+#include "core/allocator.h"
 #include "core/common.h"
+#include "core/varint.h"
+
+/* ----------------------------------------------------------------------------
+ * Type definitions
+ * ------------------------------------------------------------------------- */
+
+typedef struct pb_descriptor_extensions_t {
+  struct pb_descriptor_extensions_t
+    *previous;                         /*!< Previously built table */
+  size_t size;                         /*!< Extension field count */
+  const pb_field_descriptor_t
+    *data[];                           /*!< Extension fields sorted by tag */
+} pb_descriptor_extensions_t;
 
 /* ----------------------------------------------------------------------------
  * Interface
@@ -44,7 +60,58 @@
 PB_INLINE void
 pb_descriptor_reset(pb_descriptor_t *descriptor) {
   assert(descriptor);
-  descriptor->extension = NULL;
+  while (descriptor->extensions.tables) {
+    pb_descriptor_extensions_t *table = descriptor->extensions.tables;
+    descriptor->extensions.tables = table->previous;
+    pb_allocator_free(&allocator_default, table);
+  }
+  descriptor->extension        = NULL;
+  descriptor->extensions.table = NULL;
+}
+
+/* ----------------------------------------------------------------------------
+ * Inline functions
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Retrieve the size of the encoded tag and wiretype of a field descriptor.
+ *
+ * \param[in] descriptor Field descriptor
+ * \return               Encoded size
+ */
+PB_INLINE size_t
+pb_field_descriptor_key_size(const pb_field_descriptor_t *descriptor) {
+  assert(descriptor);
+  if (likely_(descriptor->key.size))
+    return descriptor->key.size;
+  uint32_t key = pb_field_descriptor_tag(descriptor) << 3;
+  return pb_varint_size_uint32(&key);
+}
+
+/*!
+ * Pack the tag of a field descriptor together with the given wiretype.
+ *
+ * If the generator precomputed the encoded tag, it is copied verbatim. As the
+ * wiretype occupies the lowest three bits of the first byte, the precomputed
+ * tag can be reused for any wiretype, e.g. for packed fields.
+ *
+ * \param[out] data[]     Target buffer
+ * \param[in]  descriptor Field descriptor
+ * \param[in]  wiretype   Wiretype
+ * \return                Bytes written
+ */
+PB_INLINE size_t
+pb_field_descriptor_key_pack(
+    uint8_t data[], const pb_field_descriptor_t *descriptor,
+    pb_wiretype_t wiretype) {
+  assert(data && descriptor);
+  if (likely_(descriptor->key.size)) {
+    memcpy(data, descriptor->key.data, descriptor->key.size);
+    data[0] = (data[0] & ~7) | wiretype;
+    return descriptor->key.size;
+  }
+  uint32_t key = (pb_field_descriptor_tag(descriptor) << 3) | wiretype;
+  return pb_varint_pack_uint32(data, &key);
 }
 
 #endif /* PB_CORE_DESCRIPTOR_H */
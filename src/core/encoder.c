@@ -24,43 +24,116 @@
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/uio.h>
 
 #include "core/allocator.h"
 #include "core/buffer.h"
 #include "core/common.h"
+#include "core/endian.h"
 #include "core/descriptor.h"
 #include "core/encoder.h"
+#include "core/fragment.h"
+#include "core/layout.h"
+#include "core/probe.h"
+#include "core/stats.h"
 #include "core/varint.h"
 
 /* ----------------------------------------------------------------------------
  * Type definitions
  * ------------------------------------------------------------------------- */
 
-typedef pb_error_t
-(*pb_encoder_encode_f)(
-  pb_buffer_t *buffer,                 /*!< Buffer */
+typedef size_t
+(*pb_encoder_size_f)(
+  const pb_field_descriptor_t
+    *descriptor,                       /*!< Field descriptor */
+  const void *value);                  /*!< Pointer holding value */
+
+typedef size_t
+(*pb_encoder_pack_f)(
+  uint8_t data[],                      /*!< Target buffer */
   const pb_field_descriptor_t
     *descriptor,                       /*!< Field descriptor */
   const void *value);                  /*!< Pointer holding value */
 
 /* ----------------------------------------------------------------------------
- * Encoder callbacks
+ * Size callbacks
  * ------------------------------------------------------------------------- */
 
 /*!
- * Encode a variable-sized integer.
+ * Retrieve the encoded size of a variable-sized integer.
  *
- * \param[in,out] buffer     Buffer
- * \param[in]     descriptor Field descriptor
- * \param[in]     value      Pointer holding value
- * \return                   Error code
+ * \param[in] descriptor Field descriptor
+ * \param[in] value      Pointer holding value
+ * \return               Encoded size
  */
-static pb_error_t
-encode_varint(
-    pb_buffer_t *buffer, const pb_field_descriptor_t *descriptor,
+static size_t
+size_varint(const pb_field_descriptor_t *descriptor, const void *value) {
+  assert(descriptor && value);
+  pb_type_t type = pb_field_descriptor_type(descriptor);
+  return pb_field_descriptor_padded(descriptor)
+    ? pb_varint_size_padded(type, value)
+    : pb_varint_size(type, value);
+}
+
+/*!
+ * Retrieve the encoded size of a fixed-sized 64-bit value.
+ *
+ * \param[in] descriptor Field descriptor
+ * \param[in] value      Pointer holding value
+ * \return               Encoded size
+ */
+static size_t
+size_64bit(const pb_field_descriptor_t *descriptor, const void *value) {
+  assert(descriptor && value);
+  return 8;
+}
+
+/*!
+ * Retrieve the encoded size of a length-prefixed value.
+ *
+ * \param[in] descriptor Field descriptor
+ * \param[in] value      Pointer holding value
+ * \return               Encoded size
+ */
+static size_t
+size_length(const pb_field_descriptor_t *descriptor, const void *value) {
+  assert(descriptor && value);
+  uint32_t length = pb_field_descriptor_type(descriptor) == PB_TYPE_MESSAGE
+    ? pb_encoder_length(value)
+    : pb_string_size(value);
+  return pb_varint_size_uint32(&length) + length;
+}
+
+/*!
+ * Retrieve the encoded size of a fixed-sized 32-bit value.
+ *
+ * \param[in] descriptor Field descriptor
+ * \param[in] value      Pointer holding value
+ * \return               Encoded size
+ */
+static size_t
+size_32bit(const pb_field_descriptor_t *descriptor, const void *value) {
+  assert(descriptor && value);
+  return 4;
+}
+
+/* ----------------------------------------------------------------------------
+ * Pack callbacks
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Pack a variable-sized integer.
+ *
+ * \param[out] data[]     Target buffer
+ * \param[in]  descriptor Field descriptor
+ * \param[in]  value      Pointer holding value
+ * \return                Bytes written
+ */
+static size_t
+pack_varint(
+    uint8_t data[], const pb_field_descriptor_t *descriptor,
     const void *value) {
-  assert(buffer && descriptor && value);
-  assert(pb_buffer_valid(buffer));
+  assert(data && descriptor && value);
   pb_type_t type = pb_field_descriptor_type(descriptor);
 
 #ifndef NDEBUG
@@ -73,106 +146,133 @@ encode_varint(
 
 #endif /* NDEBUG */
 
-  /* Encode variable-sized integer according to type */
-  uint8_t *data = pb_buffer_grow(
-    buffer, pb_varint_size(type, value));
-  return likely_(data && pb_varint_pack(type, data, value))
-    ? PB_ERROR_NONE
-    : PB_ERROR_ALLOC;
+  /* Pack variable-sized integer according to type, padded if demanded */
+  return pb_field_descriptor_padded(descriptor)
+    ? pb_varint_pack_padded(type, data, value)
+    : pb_varint_pack(type, data, value);
 }
 
 /*!
- * Encode a fixed-sized 64-bit value.
+ * Pack a fixed-sized 64-bit value.
  *
- * \param[in,out] buffer     Buffer
- * \param[in]     descriptor Field descriptor
- * \param[in]     value      Pointer holding value
- * \return                   Error code
+ * \param[out] data[]     Target buffer
+ * \param[in]  descriptor Field descriptor
+ * \param[in]  value      Pointer holding value
+ * \return                Bytes written
  */
-static pb_error_t
-encode_64bit(
-    pb_buffer_t *buffer, const pb_field_descriptor_t *descriptor,
+static size_t
+pack_64bit(
+    uint8_t data[], const pb_field_descriptor_t *descriptor,
     const void *value) {
-  assert(buffer && descriptor && value);
-  assert(pb_buffer_valid(buffer));
-  uint8_t *data = pb_buffer_grow(buffer, 8);
-  return likely_(data && memcpy(data, value, 8))
-    ? PB_ERROR_NONE
-    : PB_ERROR_ALLOC;
+  assert(data && descriptor && value);
+  pb_endian_copy(data, value, 1, 8);
+  return 8;
 }
 
 /*!
- * Encode a length-prefixed value.
+ * Pack the buffer of an encoder interleaved with all referenced segments.
  *
- * \warning The lines excluded from code coverage cannot be triggered within
- * the tests, as they are masked through pb_encoder_encode().
+ * \param[out] data[]  Target buffer
+ * \param[in]  encoder Encoder
+ * \return             Bytes written
+ */
+static size_t
+pack_flattened(uint8_t data[], const pb_encoder_t *encoder) {
+  assert(data && encoder);
+  const uint8_t *owned = pb_buffer_data(pb_encoder_buffer(encoder));
+  size_t offset = 0, total = 0;
+  for (size_t s = 0; s < encoder->segment.size; s++) {
+    const pb_encoder_segment_t *segment = &(encoder->segment.data[s]);
+    if (segment->offset > offset) {
+      memcpy(&(data[total]), &(owned[offset]), segment->offset - offset);
+      total += segment->offset - offset;
+      offset = segment->offset;
+    }
+    memcpy(&(data[total]), segment->data, segment->size);
+    total += segment->size;
+  }
+
+  /* Pack remaining part of buffer */
+  size_t size = pb_buffer_size(pb_encoder_buffer(encoder));
+  if (size > offset)
+    memcpy(&(data[total]), &(owned[offset]), size - offset);
+  return total + size - offset;
+}
+
+/*!
+ * Pack a length-prefixed value.
  *
- * \param[in,out] buffer     Buffer
- * \param[in]     descriptor Field descriptor
- * \param[in]     value      Pointer holding value
- * \return                   Error code
+ * \param[out] data[]     Target buffer
+ * \param[in]  descriptor Field descriptor
+ * \param[in]  value      Pointer holding value
+ * \return                Bytes written
  */
-static pb_error_t
-encode_length(
-    pb_buffer_t *buffer, const pb_field_descriptor_t *descriptor,
+static size_t
+pack_length(
+    uint8_t data[], const pb_field_descriptor_t *descriptor,
     const void *value) {
-  assert(buffer && descriptor && value);
-  assert(pb_buffer_valid(buffer));
+  assert(data && descriptor && value);
 
   /* Extract data and size according to type */
   const uint8_t *string; uint32_t length;
   if (pb_field_descriptor_type(descriptor) == PB_TYPE_MESSAGE) {
-    string = pb_buffer_data(pb_encoder_buffer(value));
-    length = pb_buffer_size(pb_encoder_buffer(value));
+    const pb_encoder_t *encoder = value;
+    if (encoder->segment.size) {
+      length = pb_encoder_length(encoder);
+      size_t size = pb_varint_pack_uint32(data, &length);
+      return size + pack_flattened(&(data[size]), encoder);
+    }
+    string = pb_buffer_data(pb_encoder_buffer(encoder));
+    length = pb_buffer_size(pb_encoder_buffer(encoder));
   } else {
     string = pb_string_data(value);
     length = pb_string_size(value);
   }
 
-  /* Encode length prefix */
-  uint8_t *data = pb_buffer_grow(buffer,
-    pb_varint_size_uint32(&length) + length);
-  if (data) {
-    data += pb_varint_pack_uint32(data, &length);
-
-    /* Encode message or string */
-    memcpy(data, string, length);
-    return PB_ERROR_NONE;
-  }
-  return PB_ERROR_ALLOC;                                   /* LCOV_EXCL_LINE */
+  /* Pack length prefix and message or string */
+  size_t size = pb_varint_pack_uint32(data, &length);
+  if (length)
+    memcpy(&(data[size]), string, length);
+  return size + length;
 }
 
 /*!
- * Encode a fixed-sized 32-bit value.
+ * Pack a fixed-sized 32-bit value.
  *
- * \param[in,out] buffer     Buffer
- * \param[in]     descriptor Field descriptor
- * \param[in]     value      Pointer holding value
- * \return                   Error code
+ * \param[out] data[]     Target buffer
+ * \param[in]  descriptor Field descriptor
+ * \param[in]  value      Pointer holding value
+ * \return                Bytes written
  */
-static pb_error_t
-encode_32bit(
-    pb_buffer_t *buffer, const pb_field_descriptor_t *descriptor,
+static size_t
+pack_32bit(
+    uint8_t data[], const pb_field_descriptor_t *descriptor,
     const void *value) {
-  assert(buffer && descriptor && value);
-  assert(pb_buffer_valid(buffer));
-  uint8_t *data = pb_buffer_grow(buffer, 4);
-  return likely_(data && memcpy(data, value, 4))
-    ? PB_ERROR_NONE
-    : PB_ERROR_ALLOC;
+  assert(data && descriptor && value);
+  pb_endian_copy(data, value, 1, 4);
+  return 4;
 }
 
 /* ----------------------------------------------------------------------------
  * Jump tables
  * ------------------------------------------------------------------------- */
 
-/*! Jump table: wiretype ==> encode method */
-static const pb_encoder_encode_f
-encode_jump[] = {
-  [PB_WIRETYPE_VARINT] = encode_varint,
-  [PB_WIRETYPE_64BIT]  = encode_64bit,
-  [PB_WIRETYPE_LENGTH] = encode_length,
-  [PB_WIRETYPE_32BIT]  = encode_32bit
+/*! Jump table: wiretype ==> size method */
+static const pb_encoder_size_f
+size_jump[] = {
+  [PB_WIRETYPE_VARINT] = size_varint,
+  [PB_WIRETYPE_64BIT]  = size_64bit,
+  [PB_WIRETYPE_LENGTH] = size_length,
+  [PB_WIRETYPE_32BIT]  = size_32bit
+};
+
+/*! Jump table: wiretype ==> pack method */
+static const pb_encoder_pack_f
+pack_jump[] = {
+  [PB_WIRETYPE_VARINT] = pack_varint,
+  [PB_WIRETYPE_64BIT]  = pack_64bit,
+  [PB_WIRETYPE_LENGTH] = pack_length,
+  [PB_WIRETYPE_32BIT]  = pack_32bit
 };
 
 /* ----------------------------------------------------------------------------
@@ -180,110 +280,619 @@ encode_jump[] = {
  * ------------------------------------------------------------------------- */
 
 /*!
- * Encode values in packed encoding.
+ * Retrieve the length of the values of a packed field.
  *
- * \param[in,out] buffer     Buffer
- * \param[in]     descriptor Field descriptor
- * \param[in]     values     Pointer holding values
- * \param[in]     size       Value count
- * \return                   Error code
+ * \param[in] descriptor Field descriptor
+ * \param[in] values     Pointer holding values
+ * \param[in] size       Value count
+ * \return               Length
  */
-static pb_error_t
-encode_packed(
-    pb_buffer_t *buffer, const pb_field_descriptor_t *descriptor,
-    const void *values, size_t size) {
-  assert(buffer && descriptor && values && size > 1);
-  assert(pb_buffer_valid(buffer));
-
-  /* Assert repeated and non-length-prefixed, packed field */
-  assert(
-    pb_field_descriptor_label(descriptor)    == PB_LABEL_REPEATED &&
-    pb_field_descriptor_wiretype(descriptor) != PB_WIRETYPE_LENGTH &&
-    pb_field_descriptor_packed(descriptor));
-  pb_type_t type = pb_field_descriptor_type(descriptor);
-  size_t    item = pb_field_descriptor_type_size(descriptor);
+static uint32_t
+length_packed(
+    const pb_field_descriptor_t *descriptor, const void *values,
+    size_t size) {
+  assert(descriptor && values && size);
+  size_t item = pb_field_descriptor_type_size(descriptor);
 
   /* Calculate length of packed field */
   size_t length = 0;
   if (pb_field_descriptor_wiretype(descriptor) != PB_WIRETYPE_VARINT) {
     length = size * item;
+  } else if (!pb_field_descriptor_padded(descriptor)) {
+    length = pb_varint_size_all(
+      pb_field_descriptor_type(descriptor), values, size);
   } else {
     const uint8_t *temp = values;
     for (size_t v = 0; v < size; v++) {
-      length += pb_varint_size(type, temp);
+      length += size_varint(descriptor, temp);
       temp   += item;
     }
   }
+  return length;
+}
 
-  /* Pack wiretype into tag */
-  pb_tag_t tag =
-    (pb_field_descriptor_tag(descriptor) << 3) | PB_WIRETYPE_LENGTH;
-
-  /* Encode tag, length prefix and values */
-  uint8_t *data = pb_buffer_grow(
-    buffer, pb_varint_size_uint32(&tag) +
-      pb_varint_size_uint32(&length) + length);
-  if (data) {
-    data += pb_varint_pack_uint32(data, &tag);
-    data += pb_varint_pack_uint32(data, &length);
-
-    /* Encode values */
-    if (pb_field_descriptor_wiretype(descriptor) != PB_WIRETYPE_VARINT) {
-      memcpy(data, values, length);
-    } else {
-      const uint8_t *temp = values;
-      for (size_t v = 0; v < size; v++) {
+/*!
+ * Retrieve the encoded size of values in packed encoding.
+ *
+ * \param[in] descriptor Field descriptor
+ * \param[in] values     Pointer holding values
+ * \param[in] size       Value count
+ * \return               Encoded size
+ */
+static size_t
+size_packed(
+    const pb_field_descriptor_t *descriptor, const void *values,
+    size_t size) {
+  assert(descriptor && values && size > 1);
+
+  /* Calculate size of tag, length prefix and values */
+  uint32_t length = length_packed(descriptor, values, size);
+  return pb_field_descriptor_key_size(descriptor) +
+    pb_varint_size_uint32(&length) + length;
+}
+
+/*!
+ * Pack values in packed encoding.
+ *
+ * \warning The caller has to ensure that the buffer is appropriately sized,
+ * which can be done through size_packed().
+ *
+ * \param[out] data[]     Target buffer
+ * \param[in]  descriptor Field descriptor
+ * \param[in]  values     Pointer holding values
+ * \param[in]  size       Value count
+ * \return                Bytes written
+ */
+static size_t
+pack_packed(
+    uint8_t data[], const pb_field_descriptor_t *descriptor,
+    const void *values, size_t size) {
+  assert(data && descriptor && values && size > 1);
+
+  /* Assert repeated and non-length-prefixed, packed field */
+  assert(
+    pb_field_descriptor_label(descriptor)    == PB_LABEL_REPEATED &&
+    pb_field_descriptor_wiretype(descriptor) != PB_WIRETYPE_LENGTH &&
+    pb_field_descriptor_packed(descriptor));
+
+  /* Pack tag and length prefix */
+  uint32_t length = length_packed(descriptor, values, size);
+  uint8_t *temp = data;
+  temp += pb_field_descriptor_key_pack(temp, descriptor, PB_WIRETYPE_LENGTH);
+  temp += pb_varint_pack_uint32(temp, &length);
+
+  /* Pack values */
+  if (pb_field_descriptor_wiretype(descriptor) != PB_WIRETYPE_VARINT) {
+    pb_endian_copy(temp, values, size,
+      pb_field_descriptor_type_size(descriptor));
+    temp += length;
+  } else if (!pb_field_descriptor_padded(descriptor)) {
+    pb_type_t type = pb_field_descriptor_type(descriptor);
 
 #ifndef NDEBUG
 
-        /* Assert valid value for enum field */
-        if (type == PB_TYPE_ENUM)
-          assert(pb_enum_descriptor_value_by_number(
-            pb_field_descriptor_enum(descriptor),
-              *(const pb_enum_t *)temp));
+    /* Assert valid values for enum field */
+    if (type == PB_TYPE_ENUM)
+      for (size_t v = 0; v < size; v++)
+        assert(pb_enum_descriptor_value_by_number(
+          pb_field_descriptor_enum(descriptor),
+            ((const pb_enum_t *)values)[v]));
 
 #endif /* NDEBUG */
 
-        /* Encode variable-sized integer according to type */
-        data += pb_varint_pack(type, data, temp);
-        temp += pb_field_descriptor_type_size(descriptor);
-      }
+    temp += pb_varint_pack_all(type, temp, values, size);
+  } else {
+    const uint8_t *value = values;
+    for (size_t v = 0; v < size; v++) {
+      temp  += pack_varint(temp, descriptor, value);
+      value += pb_field_descriptor_type_size(descriptor);
     }
-    return PB_ERROR_NONE;
   }
-  return PB_ERROR_ALLOC;
+  return temp - data;
+}
+
+/*!
+ * Retrieve the encoded size of a value.
+ *
+ * \param[in] descriptor Field descriptor
+ * \param[in] value      Pointer holding value
+ * \return               Encoded size
+ */
+static size_t
+size_value(const pb_field_descriptor_t *descriptor, const void *value) {
+  assert(descriptor && value);
+
+  /* Calculate size of tag and value */
+  pb_wiretype_t wiretype = pb_field_descriptor_wiretype(descriptor);
+  assert(size_jump[wiretype]);
+  return pb_field_descriptor_key_size(descriptor) +
+    size_jump[wiretype](descriptor, value);
+}
+
+/*!
+ * Pack a value.
+ *
+ * \warning The caller has to ensure that the buffer is appropriately sized,
+ * which can be done through size_value().
+ *
+ * \param[out] data[]     Target buffer
+ * \param[in]  descriptor Field descriptor
+ * \param[in]  value      Pointer holding value
+ * \return                Bytes written
+ */
+static size_t
+pack_value(
+    uint8_t data[], const pb_field_descriptor_t *descriptor,
+    const void *value) {
+  assert(data && descriptor && value);
+
+  /* Pack tag and value */
+  pb_wiretype_t wiretype = pb_field_descriptor_wiretype(descriptor);
+  size_t size = pb_field_descriptor_key_pack(data, descriptor, wiretype);
+  assert(pack_jump[wiretype]);
+  return size + pack_jump[wiretype](&(data[size]), descriptor, value);
+}
+
+/*!
+ * Retrieve the native size of a value of a field.
+ *
+ * \param[in] descriptor Field descriptor
+ * \return               Native size
+ */
+PB_INLINE size_t
+native_size(const pb_field_descriptor_t *descriptor) {
+  assert(descriptor);
+  return pb_field_descriptor_type(descriptor) != PB_TYPE_MESSAGE
+    ? pb_field_descriptor_type_size(descriptor)
+    : sizeof(pb_encoder_t);
+}
+
+/*!
+ * Retrieve the encoded size of a value or set of values.
+ *
+ * \param[in] descriptor Field descriptor
+ * \param[in] values     Pointer holding value(s)
+ * \param[in] size       Value count
+ * \return               Encoded size
+ */
+static size_t
+size_values(
+    const pb_field_descriptor_t *descriptor, const void *values,
+    size_t size) {
+  assert(descriptor && values && size);
+  if (size > 1 && pb_field_descriptor_packed(descriptor))
+    return size_packed(descriptor, values, size);
+
+  /* Calculate size of values one-by-one */
+  size_t total = 0;
+  const uint8_t *temp = values;
+  for (size_t v = 0; v < size; v++) {
+    total += size_value(descriptor, temp);
+    temp  += native_size(descriptor);
+  }
+  return total;
+}
+
+/*!
+ * Pack a value or set of values.
+ *
+ * \warning The caller has to ensure that the buffer is appropriately sized,
+ * which can be done through size_values().
+ *
+ * \param[out] data[]     Target buffer
+ * \param[in]  descriptor Field descriptor
+ * \param[in]  values     Pointer holding value(s)
+ * \param[in]  size       Value count
+ * \return                Bytes written
+ */
+static size_t
+pack_values(
+    uint8_t data[], const pb_field_descriptor_t *descriptor,
+    const void *values, size_t size) {
+  assert(data && descriptor && values && size);
+  if (size > 1 && pb_field_descriptor_packed(descriptor))
+    return pack_packed(data, descriptor, values, size);
+
+  /* Pack values one-by-one */
+  size_t total = 0;
+  const uint8_t *temp = values;
+  for (size_t v = 0; v < size; v++) {
+    total += pack_value(&(data[total]), descriptor, temp);
+    temp  += native_size(descriptor);
+  }
+  return total;
 }
 
 /*!
- * Encode a value.
+ * Retrieve and assert the field descriptor for a tag of an encoder.
  *
- * \param[in,out] buffer     Buffer
+ * \param[in] encoder Encoder
+ * \param[in] tag     Tag
+ * \param[in] size    Value count
+ * \return            Field descriptor
+ */
+PB_INLINE const pb_field_descriptor_t *
+field_descriptor(const pb_encoder_t *encoder, pb_tag_t tag, size_t size) {
+  assert(encoder && tag && size);
+
+  /* Assert descriptor and correct label */
+  const pb_field_descriptor_t *descriptor =
+    pb_descriptor_field_by_tag(encoder->descriptor, tag);
+  assert(descriptor && (
+    size == 1 || pb_field_descriptor_label(descriptor) == PB_LABEL_REPEATED));
+  return descriptor;
+}
+
+/* ------------------------------------------------------------------------- */
+
+/*!
+ * Ensure capacity for the given number of additional segments of an encoder.
+ *
+ * The capacity is doubled whenever it is exhausted.
+ *
+ * \param[in,out] encoder Encoder
+ * \param[in]     count   Segment count
+ * \return                Error code
+ */
+static pb_error_t
+segment_reserve(pb_encoder_t *encoder, size_t count) {
+  assert(encoder);
+  if (encoder->segment.size + count > encoder->segment.capacity) {
+    size_t capacity = encoder->segment.capacity * 2;
+    if (capacity < encoder->segment.size + count)
+      capacity = encoder->segment.size + count;
+    pb_encoder_segment_t *data = pb_allocator_resize(
+      pb_buffer_allocator(&(encoder->buffer)), encoder->segment.data,
+        sizeof(pb_encoder_segment_t) * capacity);
+    if (unlikely_(!data)) {
+      pb_probe2(alloc__fail, pb_buffer_allocator(&(encoder->buffer)),
+        sizeof(pb_encoder_segment_t) * capacity);
+      return PB_ERROR_ALLOC;
+    }
+    encoder->segment.data     = data;
+    encoder->segment.capacity = capacity;
+  }
+  return PB_ERROR_NONE;
+}
+
+/*!
+ * Retrieve the number of segments a value adds to a scattering encoder.
+ *
+ * Strings and bytes reaching the threshold of the encoder are referenced as
+ * a single segment, nested messages take over the segments of their encoder.
+ *
+ * \param[in] encoder    Encoder
+ * \param[in] descriptor Field descriptor
+ * \param[in] value      Pointer holding value
+ * \return               Segment count
+ */
+static size_t
+scatter_count(
+    const pb_encoder_t *encoder, const pb_field_descriptor_t *descriptor,
+    const void *value) {
+  assert(encoder && descriptor && value);
+  if (pb_field_descriptor_type(descriptor) == PB_TYPE_MESSAGE)
+    return ((const pb_encoder_t *)value)->segment.size;
+  return pb_string_size(value) >= encoder->threshold;
+}
+
+/*!
+ * Retrieve the size of the tag and length prefix of a length-prefixed value.
+ *
+ * \param[in] descriptor Field descriptor
+ * \param[in] length     Length
+ * \return               Encoded size
+ */
+static size_t
+scatter_header(const pb_field_descriptor_t *descriptor, uint32_t length) {
+  assert(descriptor);
+  return pb_field_descriptor_key_size(descriptor) +
+    pb_varint_size_uint32(&length);
+}
+
+/*!
+ * Encode a set of length-prefixed values, referencing large payloads.
+ *
+ * Only tags, length prefixes and values below the threshold are written to
+ * the buffer of the encoder. Strings and bytes reaching the threshold are
+ * recorded as segments pointing to the memory of the caller, and segments of
+ * nested messages are taken over with their offsets adjusted. Both the list
+ * of segments and the buffer are grown only once.
+ *
+ * \param[in,out] encoder    Encoder
  * \param[in]     descriptor Field descriptor
- * \param[in]     value      Pointer holding value
+ * \param[in]     values     Pointer holding value(s)
+ * \param[in]     size       Value count
  * \return                   Error code
  */
 static pb_error_t
-encode(
-    pb_buffer_t *buffer, const pb_field_descriptor_t *descriptor,
+encode_scattered(
+    pb_encoder_t *encoder, const pb_field_descriptor_t *descriptor,
+    const void *values, size_t size) {
+  assert(encoder && descriptor && values && size);
+  const int message =
+    pb_field_descriptor_type(descriptor) == PB_TYPE_MESSAGE;
+
+  /* Calculate size of owned data and number of segments */
+  size_t total = 0, count = 0;
+  const uint8_t *temp = values;
+  for (size_t v = 0; v < size; v++, temp += native_size(descriptor)) {
+    size_t segments = scatter_count(encoder, descriptor, temp);
+    if (!segments) {
+      total += size_value(descriptor, temp);
+    } else if (message) {
+      const pb_encoder_t *nested = (const pb_encoder_t *)temp;
+      total += scatter_header(descriptor, pb_encoder_length(nested)) +
+        pb_buffer_size(pb_encoder_buffer(nested));
+    } else {
+      const pb_string_t *string = (const pb_string_t *)temp;
+      total += scatter_header(descriptor, pb_string_size(string));
+    }
+    count += segments;
+  }
+
+  /* Ensure capacity for segments */
+  pb_error_t error = segment_reserve(encoder, count);
+  if (unlikely_(error))
+    return error;
+
+  /* Grow buffer once */
+  size_t offset = pb_buffer_size(&(encoder->buffer));
+  uint8_t *data = pb_buffer_grow(&(encoder->buffer), total);
+  if (unlikely_(!data))
+    return PB_ERROR_ALLOC;
+
+  /* Pack values and record segments */
+  for (temp = values; size--; temp += native_size(descriptor)) {
+    if (!scatter_count(encoder, descriptor, temp)) {
+      size_t written = pack_value(data, descriptor, temp);
+      data += written, offset += written;
+      continue;
+    }
+
+    /* Pack tag and length prefix */
+    const pb_encoder_t *nested = (const pb_encoder_t *)temp;
+    const pb_string_t  *string = (const pb_string_t *)temp;
+    uint32_t length = message
+      ? pb_encoder_length(nested)
+      : pb_string_size(string);
+    size_t written =
+      pb_field_descriptor_key_pack(data, descriptor, PB_WIRETYPE_LENGTH);
+    written += pb_varint_pack_uint32(&(data[written]), &length);
+    data += written, offset += written;
+
+    /* Reference string or bytes */
+    pb_encoder_segment_t *segment =
+      &(encoder->segment.data[encoder->segment.size]);
+    if (!message) {
+      segment->offset = offset;
+      segment->data   = pb_string_data(string);
+      segment->size   = pb_string_size(string);
+      encoder->segment.size++;
+
+    /* Copy buffer and take over segments of nested message */
+    } else {
+      size_t owned = pb_buffer_size(pb_encoder_buffer(nested));
+      if (owned)
+        memcpy(data, pb_buffer_data(pb_encoder_buffer(nested)), owned);
+      for (size_t s = 0; s < nested->segment.size; s++) {
+        segment[s] = nested->segment.data[s];
+        segment[s].offset += offset;
+      }
+      encoder->segment.size += nested->segment.size;
+      data += owned, offset += owned;
+    }
+  }
+  return PB_ERROR_NONE;
+}
+
+/* ------------------------------------------------------------------------- */
+
+/*!
+ * Write the buffer of an encoder to its sink and empty it.
+ *
+ * If the sink fails, the buffer is retained, so the flush can be retried.
+ *
+ * \param[in,out] encoder Encoder
+ * \return                Error code
+ */
+static pb_error_t
+flush(pb_encoder_t *encoder) {
+  assert(encoder && encoder->sink.write);
+  size_t size = pb_buffer_size(&(encoder->buffer));
+  if (size) {
+    pb_error_t error = encoder->sink.write(encoder->sink.context,
+      pb_buffer_data(&(encoder->buffer)), size);
+    if (unlikely_(error))
+      return error;
+    encoder->sink.written += size;
+    encoder->buffer.size   = 0;
+  }
+  return PB_ERROR_NONE;
+}
+
+/*!
+ * Flush the buffer of an encoder, if it reached the threshold of the sink.
+ *
+ * Nested messages encoded in place patch their length prefix when they are
+ * ended, so the buffer is retained while any of them is open.
+ *
+ * \param[in,out] encoder Encoder
+ * \return                Error code
+ */
+static pb_error_t
+drain(pb_encoder_t *encoder) {
+  assert(encoder);
+  if (likely_(!encoder->sink.write ||
+      pb_buffer_size(&(encoder->buffer)) < encoder->sink.limit))
+    return PB_ERROR_NONE;
+  for (const pb_encoder_frame_t *frame = encoder->frame;
+      frame; frame = frame->parent)
+    if (!frame->end)
+      return PB_ERROR_NONE;
+  return flush(encoder);
+}
+
+/* ------------------------------------------------------------------------- */
+
+/*!
+ * Retrieve the encoded size of a struct according to a layout.
+ *
+ * \param[in] layout Layout
+ * \param[in] value  Pointer holding struct
+ * \return           Encoded size
+ */
+static size_t
+size_struct(const pb_layout_t *layout, const void *value);
+
+/*!
+ * Retrieve the encoded size of a nested struct including tag and length.
+ *
+ * \param[in] descriptor Field descriptor
+ * \param[in] nested     Nested layout
+ * \param[in] value      Pointer holding nested struct
+ * \return               Encoded size
+ */
+static size_t
+size_nested(
+    const pb_field_descriptor_t *descriptor, const pb_layout_t *nested,
     const void *value) {
-  assert(buffer && descriptor && value);
-  assert(pb_buffer_valid(buffer));
+  assert(descriptor && nested && value);
+  uint32_t length = size_struct(nested, value);
+  return pb_field_descriptor_key_size(descriptor) +
+    pb_varint_size_uint32(&length) + length;
+}
 
-  /* Pack wiretype into tag */
-  pb_wiretype_t wiretype = pb_field_descriptor_wiretype(descriptor);
-  pb_tag_t tag = (pb_field_descriptor_tag(descriptor) << 3) | wiretype;
+/*!
+ * Retrieve the encoded size of a struct according to a layout.
+ *
+ * Singular fields are only encoded if they are marked as present, repeated
+ * fields if they contain values and nested messages if they are allocated.
+ *
+ * \param[in] layout Layout
+ * \param[in] value  Pointer holding struct
+ * \return           Encoded size
+ */
+static size_t
+size_struct(const pb_layout_t *layout, const void *value) {
+  assert(layout && value);
+  const pb_descriptor_t *descriptor = pb_layout_descriptor(layout);
+  size_t total = 0;
+  for (size_t f = 0; f < layout->field.size; f++) {
+    const pb_field_descriptor_t *field = &(descriptor->field.data[f]);
+    const pb_layout_t *nested = pb_layout_nested(layout, f);
+    const void *member = pb_layout_member(layout, (void *)value, f);
+
+    /* Calculate size of values of repeated field */
+    if (pb_field_descriptor_label(field) == PB_LABEL_REPEATED) {
+      const pb_repeated_t *repeated = member;
+      if (!repeated->size)
+        continue;
+      if (nested) {
+        for (size_t v = 0; v < repeated->size; v++)
+          total += size_nested(field, nested,
+            (const uint8_t *)repeated->data + v * pb_layout_size(nested));
+      } else {
+        total += size_values(field, repeated->data, repeated->size);
+      }
+
+    /* Calculate size of nested message */
+    } else if (nested) {
+      if (*(void *const *)member)
+        total += size_nested(field, nested, *(void *const *)member);
+
+    /* Calculate size of present value */
+    } else if (pb_layout_has(layout, value, f)) {
+      total += size_value(field, member);
+    }
+  }
+  return total;
+}
 
-  /* Encode tag and value */
-  uint8_t *data = pb_buffer_grow(
-    buffer, pb_varint_size_uint32(&tag));
-  if (data) {
-    pb_varint_pack_uint32(data, &tag);
+/*!
+ * Pack a struct according to a layout.
+ *
+ * \warning The caller has to ensure that the buffer is appropriately sized,
+ * which can be done through size_struct().
+ *
+ * \param[out] data[] Target buffer
+ * \param[in]  layout Layout
+ * \param[in]  value  Pointer holding struct
+ * \return            Bytes written
+ */
+static size_t
+pack_struct(uint8_t data[], const pb_layout_t *layout, const void *value);
 
-    /* Encode value */
-    assert(encode_jump[wiretype]);
-    return encode_jump[wiretype](buffer, descriptor, value);
+/*!
+ * Pack a nested struct including tag and length.
+ *
+ * \param[out] data[]     Target buffer
+ * \param[in]  descriptor Field descriptor
+ * \param[in]  nested     Nested layout
+ * \param[in]  value      Pointer holding nested struct
+ * \return                Bytes written
+ */
+static size_t
+pack_nested(
+    uint8_t data[], const pb_field_descriptor_t *descriptor,
+    const pb_layout_t *nested, const void *value) {
+  assert(data && descriptor && nested && value);
+  uint32_t length = size_struct(nested, value);
+
+  /* Pack tag, length prefix and nested struct */
+  size_t size =
+    pb_field_descriptor_key_pack(data, descriptor, PB_WIRETYPE_LENGTH);
+  size += pb_varint_pack_uint32(&(data[size]), &length);
+  return size + pack_struct(&(data[size]), nested, value);
+}
+
+/*!
+ * Pack a struct according to a layout.
+ *
+ * \warning The caller has to ensure that the buffer is appropriately sized,
+ * which can be done through size_struct().
+ *
+ * \param[out] data[] Target buffer
+ * \param[in]  layout Layout
+ * \param[in]  value  Pointer holding struct
+ * \return            Bytes written
+ */
+static size_t
+pack_struct(uint8_t data[], const pb_layout_t *layout, const void *value) {
+  assert(data && layout && value);
+  const pb_descriptor_t *descriptor = pb_layout_descriptor(layout);
+  size_t total = 0;
+  for (size_t f = 0; f < layout->field.size; f++) {
+    const pb_field_descriptor_t *field = &(descriptor->field.data[f]);
+    const pb_layout_t *nested = pb_layout_nested(layout, f);
+    const void *member = pb_layout_member(layout, (void *)value, f);
+
+    /* Pack values of repeated field */
+    if (pb_field_descriptor_label(field) == PB_LABEL_REPEATED) {
+      const pb_repeated_t *repeated = member;
+      if (!repeated->size)
+        continue;
+      if (nested) {
+        for (size_t v = 0; v < repeated->size; v++)
+          total += pack_nested(&(data[total]), field, nested,
+            (const uint8_t *)repeated->data + v * pb_layout_size(nested));
+      } else {
+        total += pack_values(&(data[total]), field,
+          repeated->data, repeated->size);
+      }
+
+    /* Pack nested message */
+    } else if (nested) {
+      if (*(void *const *)member)
+        total += pack_nested(&(data[total]), field, nested,
+          *(void *const *)member);
+
+    /* Pack present value */
+    } else if (pb_layout_has(layout, value, f)) {
+      total += pack_value(&(data[total]), field, member);
+    }
   }
-  return PB_ERROR_ALLOC;
+  return total;
 }
 
 /* ----------------------------------------------------------------------------
@@ -322,6 +931,33 @@ pb_encoder_create_with_allocator(
   return encoder;
 }
 
+/*!
+ * Create an encoder writing into caller-provided memory.
+ *
+ * The encoder never calls an allocator, so encoding fails with an allocation
+ * error once a value does not fit into the remaining capacity, leaving the
+ * encoder unaltered. The number of bytes needed to encode a value can be
+ * determined upfront with pb_encoder_size() and compared with the number of
+ * bytes available as returned by pb_encoder_available().
+ *
+ * \warning The caller must ensure that the memory outlives the encoder.
+ *
+ * \param[in]     descriptor Descriptor
+ * \param[in,out] data[]     Raw data
+ * \param[in]     capacity   Raw data capacity
+ * \return                   Encoder
+ */
+extern pb_encoder_t
+pb_encoder_create_fixed(
+    const pb_descriptor_t *descriptor, uint8_t data[], size_t capacity) {
+  assert(descriptor && data && capacity);
+  pb_encoder_t encoder = {
+    .descriptor = descriptor,
+    .buffer     = pb_buffer_create_fixed(data, capacity)
+  };
+  return encoder;
+}
+
 /*!
  * Destroy an encoder.
  *
@@ -330,8 +966,153 @@ pb_encoder_create_with_allocator(
 extern void
 pb_encoder_destroy(pb_encoder_t *encoder) {
   assert(encoder);
-  if (pb_encoder_valid(encoder))
+  if (pb_encoder_valid(encoder)) {
+    if (encoder->segment.data)
+      pb_allocator_free(pb_buffer_allocator(&(encoder->buffer)),
+        encoder->segment.data);
     pb_buffer_destroy(&(encoder->buffer));
+  }
+}
+
+/*!
+ * Reset an encoder to encode another message.
+ *
+ * All encoded data is discarded, but the capacity of the buffer and the list
+ * of referenced segments is retained, so an encoder that is reused for many
+ * messages of similar size does not allocate in steady state. Fixed encoders
+ * start over at the beginning of the provided memory.
+ *
+ * \param[in,out] encoder Encoder
+ */
+extern void
+pb_encoder_reset(pb_encoder_t *encoder) {
+  assert(encoder);
+  if (pb_encoder_valid(encoder)) {
+    encoder->buffer.size  = 0;
+    encoder->segment.size = 0;
+    encoder->sink.written = 0;
+
+    /* Close all nested messages */
+    for (; encoder->frame; encoder->frame = encoder->frame->parent)
+      encoder->descriptor = encoder->frame->descriptor;
+  }
+}
+
+/*!
+ * Release the excess capacity of an encoder.
+ *
+ * The counterpart of resetting for encoders that become idle: the buffer and
+ * the list of referenced segments are shrunk to their size, or freed if the
+ * encoder was reset, so a long-lived encoder doesn't pin the capacity of the
+ * largest message it ever encoded. Fixed encoders are left as they are.
+ *
+ * \param[in,out] encoder Encoder
+ * \return                Error code
+ */
+extern pb_error_t
+pb_encoder_trim(pb_encoder_t *encoder) {
+  assert(encoder);
+  if (unlikely_(!pb_encoder_valid(encoder)))
+    return PB_ERROR_INVALID;
+
+  /* Shrink list of referenced segments, or free it if empty */
+  if (encoder->segment.size != encoder->segment.capacity) {
+    pb_allocator_t *allocator = pb_buffer_allocator(&(encoder->buffer));
+    if (!encoder->segment.size) {
+      pb_allocator_free(allocator, encoder->segment.data);
+      encoder->segment.data     = NULL;
+      encoder->segment.capacity = 0;
+    } else {
+      pb_encoder_segment_t *data = pb_allocator_resize(allocator,
+        encoder->segment.data,
+          sizeof(pb_encoder_segment_t) * encoder->segment.size);
+      if (unlikely_(!data))
+        return PB_ERROR_ALLOC;                             /* LCOV_EXCL_LINE */
+      encoder->segment.data     = data;
+      encoder->segment.capacity = encoder->segment.size;
+    }
+  }
+  return pb_buffer_shrink_to_fit(&(encoder->buffer));
+}
+
+/*!
+ * Reference strings and bytes of an encoder instead of copying them.
+ *
+ * Strings and bytes with a size of at least the given threshold are not
+ * copied into the buffer of the encoder, but recorded as segments pointing to
+ * the memory of the caller, which must therefore outlive the encoder. Nested
+ * messages encoded with such an encoder take over its segments. The encoded
+ * message can be retrieved with pb_encoder_iovec(), so the buffer of the
+ * encoder alone is in general not a valid message anymore.
+ *
+ * \warning The threshold must be set before anything is encoded.
+ *
+ * \param[in,out] encoder   Encoder
+ * \param[in]     threshold Threshold
+ */
+extern void
+pb_encoder_scatter(pb_encoder_t *encoder, size_t threshold) {
+  assert(encoder && threshold);
+  assert(pb_buffer_empty(&(encoder->buffer)));
+  assert(pb_buffer_allocator(&(encoder->buffer)) != &allocator_fixed);
+  assert(!encoder->sink.write);
+  encoder->threshold = threshold;
+}
+
+/*!
+ * Stream the encoded message of an encoder to a sink.
+ *
+ * Before a value is encoded, the buffer of the encoder is handed to the sink
+ * and emptied if it holds at least the given number of bytes, so the buffer
+ * never grows much beyond this limit, regardless of the size of the message.
+ * The remainder must be written with pb_encoder_flush() when done. The sink
+ * must consume all bytes or return an error, which is passed to the caller
+ * without encoding the value, so encoding can be retried.
+ *
+ * Nested messages encoded in place are only written once they are ended, as
+ * their length prefix is not known before. Nested messages that are begun
+ * with pb_encoder_begin_nested_sized() are streamed right away.
+ *
+ * \warning The sink must be set before anything is encoded, and cannot be
+ * combined with references to large payloads.
+ *
+ * \param[in,out] encoder Encoder
+ * \param[in]     sink    Sink callback
+ * \param[in]     context Sink context
+ * \param[in]     limit   Threshold for flushes
+ */
+extern void
+pb_encoder_stream(
+    pb_encoder_t *encoder, pb_encoder_sink_f sink, void *context,
+    size_t limit) {
+  assert(encoder && sink && limit);
+  assert(pb_buffer_empty(&(encoder->buffer)));
+  assert(!encoder->threshold);
+  encoder->sink.write   = sink;
+  encoder->sink.context = context;
+  encoder->sink.limit   = limit;
+  encoder->sink.written = 0;
+}
+
+/*!
+ * Write all pending data of an encoder to its sink.
+ *
+ * \warning Nested messages encoded in place must be ended before.
+ *
+ * \param[in,out] encoder Encoder
+ * \return                Error code
+ */
+extern pb_error_t
+pb_encoder_flush(pb_encoder_t *encoder) {
+  assert(encoder && encoder->sink.write);
+  if (unlikely_(!pb_encoder_valid(encoder)))
+    return PB_ERROR_INVALID;
+#ifndef NDEBUG
+  for (const pb_encoder_frame_t *frame = encoder->frame;
+      frame; frame = frame->parent)
+    assert(frame->end);
+#endif /* NDEBUG */
+  return flush(encoder);
 }
 
 /*!
@@ -362,31 +1143,432 @@ extern pb_error_t
 pb_encoder_encode(
     pb_encoder_t *encoder, pb_tag_t tag, const void *values, size_t size) {
   assert(encoder && tag && values && size);
+  pb_stats_measure(PB_STATS_ENCODER_ENCODE, encoder->descriptor);
   if (unlikely_(!pb_encoder_valid(encoder)))
     return PB_ERROR_INVALID;
-  pb_error_t error = PB_ERROR_NONE;
+  pb_error_t error = drain(encoder);
+  if (unlikely_(error))
+    return error;
 
-  /* Assert descriptor and correct label */
+  /* Calculate encoded size to grow buffer only once */
   const pb_field_descriptor_t *descriptor =
-    pb_descriptor_field_by_tag(encoder->descriptor, tag);
-  assert(descriptor && (
-    size == 1 || pb_field_descriptor_label(descriptor) == PB_LABEL_REPEATED));
+    field_descriptor(encoder, tag, size);
+  assert(encoder != values);
+  if (encoder->threshold &&
+      pb_field_descriptor_wiretype(descriptor) == PB_WIRETYPE_LENGTH)
+    return encode_scattered(encoder, descriptor, values, size);
+  uint8_t *data = pb_buffer_grow(&(encoder->buffer),
+    size_values(descriptor, values, size));
+  if (unlikely_(!data))
+    return PB_ERROR_ALLOC;
 
-  /* Encode values based on potential packed flag */
-  if (size > 1 && pb_field_descriptor_packed(descriptor)) {
-    error = encode_packed(&(encoder->buffer), descriptor, values, size);
-  } else {
-    size_t type_size = pb_field_descriptor_type(descriptor) != PB_TYPE_MESSAGE
-      ? pb_field_descriptor_type_size(descriptor)
-      : sizeof(pb_encoder_t);
+  /* Pack values into reserved space */
+  pack_values(data, descriptor, values, size);
+  return PB_ERROR_NONE;
+}
 
-    /* Encode values one-by-one */
-    const uint8_t *temp = values;
-    for (size_t v = 0; v < size; v++) {
-      assert(encoder != (void *)temp);
-      error = encode(&(encoder->buffer), descriptor, temp);
-      temp += type_size;
+/*!
+ * Append already encoded fields verbatim.
+ *
+ * This is the counterpart to the unknown field handler of the decoder, which
+ * reports unknown fields as ranges of raw bytes, so a message can be rebuilt
+ * from modified known fields and untouched unknown fields without decoding
+ * and encoding the latter. The raw bytes are not validated in any way.
+ *
+ * \param[in,out] encoder Encoder
+ * \param[in]     raw     Raw encoded fields
+ * \return                Error code
+ */
+extern pb_error_t
+pb_encoder_encode_raw(pb_encoder_t *encoder, const pb_string_t *raw) {
+  assert(encoder && raw);
+  if (unlikely_(!pb_encoder_valid(encoder)))
+    return PB_ERROR_INVALID;
+  pb_error_t error = drain(encoder);
+  if (unlikely_(error) || !pb_string_size(raw))
+    return error;
+
+  /* Grow buffer and copy raw bytes */
+  uint8_t *data = pb_buffer_grow(&(encoder->buffer), pb_string_size(raw));
+  if (unlikely_(!data))
+    return PB_ERROR_ALLOC;
+  memcpy(data, pb_string_data(raw), pb_string_size(raw));
+  return PB_ERROR_NONE;
+}
+
+/*!
+ * Encode a fragment holding a pre-encoded submessage.
+ *
+ * The key and length prefix of the fragment are precomputed, so the fragment
+ * is appended with a single copy. If the encoder references large payloads
+ * and the fragment reaches the threshold, it is referenced as a segment
+ * instead, unless a nested message is encoded in place.
+ *
+ * \warning If the fragment is referenced, the caller must retain it until the
+ * encoded message was written.
+ *
+ * \param[in,out] encoder  Encoder
+ * \param[in]     fragment Fragment
+ * \return                 Error code
+ */
+extern pb_error_t
+pb_encoder_encode_fragment(
+    pb_encoder_t *encoder, const pb_fragment_t *fragment) {
+  assert(encoder && fragment);
+  if (unlikely_(!pb_encoder_valid(encoder)))
+    return PB_ERROR_INVALID;
+  assert(pb_field_descriptor_type(field_descriptor(
+    encoder, pb_fragment_tag(fragment), 1)) == PB_TYPE_MESSAGE);
+  pb_error_t error = drain(encoder);
+  if (unlikely_(error))
+    return error;
+
+  /* Reference fragment, if it reaches the threshold */
+  size_t size = pb_fragment_size(fragment);
+  if (encoder->threshold && size >= encoder->threshold && !encoder->frame) {
+    if (unlikely_(error = segment_reserve(encoder, 1)))
+      return error;
+    encoder->segment.data[encoder->segment.size++] = (pb_encoder_segment_t){
+      .offset = pb_buffer_size(&(encoder->buffer)),
+      .data   = pb_fragment_data(fragment),
+      .size   = size
+    };
+    return PB_ERROR_NONE;
+  }
+
+  /* Grow buffer and copy fragment */
+  uint8_t *data = pb_buffer_grow(&(encoder->buffer), size);
+  if (unlikely_(!data))
+    return PB_ERROR_ALLOC;
+  memcpy(data, pb_fragment_data(fragment), size);
+  return PB_ERROR_NONE;
+}
+
+/*!
+ * Begin a nested message, encoding its fields in place.
+ *
+ * The tag and a length prefix of maximum size are reserved in the buffer of
+ * the encoder, which then encodes the fields of the nested message until the
+ * nested message is ended with pb_encoder_end_nested(). Thus, no separate
+ * encoder must be created and copied for the nested message. Nested messages
+ * may be nested arbitrarily deep, as the frames are provided by the caller.
+ *
+ * \warning The frame must outlive the nested message.
+ *
+ * \param[in,out] encoder Encoder
+ * \param[in]     tag     Tag
+ * \param[out]    frame   Frame
+ * \return                Error code
+ */
+extern pb_error_t
+pb_encoder_begin_nested(
+    pb_encoder_t *encoder, pb_tag_t tag, pb_encoder_frame_t *frame) {
+  assert(encoder && tag && frame);
+  if (unlikely_(!pb_encoder_valid(encoder)))
+    return PB_ERROR_INVALID;
+  pb_error_t error = drain(encoder);
+  if (unlikely_(error))
+    return error;
+
+  /* Reserve space for tag and length prefix of maximum size */
+  const pb_field_descriptor_t *descriptor =
+    field_descriptor(encoder, tag, 1);
+  assert(pb_field_descriptor_type(descriptor) == PB_TYPE_MESSAGE);
+  size_t size = pb_field_descriptor_key_size(descriptor);
+  uint8_t *data = pb_buffer_grow(&(encoder->buffer), size + 5);
+  if (unlikely_(!data))
+    return PB_ERROR_ALLOC;
+  pb_field_descriptor_key_pack(data, descriptor, PB_WIRETYPE_LENGTH);
+
+  /* Push frame and switch to nested descriptor */
+  frame->descriptor = encoder->descriptor;
+  frame->offset     = pb_buffer_size(&(encoder->buffer)) - 5;
+  frame->end        = 0;
+  frame->parent     = encoder->frame;
+  encoder->frame      = frame;
+  encoder->descriptor = pb_field_descriptor_nested(descriptor);
+  return PB_ERROR_NONE;
+}
+
+/*!
+ * Begin a nested message of known length, encoding its fields in place.
+ *
+ * The tag and length prefix are written right away, so nothing needs to be
+ * patched or moved when the nested message is ended with
+ * pb_encoder_end_nested(), and a streaming encoder may flush its buffer in
+ * the meantime. The length can be calculated upfront with pb_encoder_size()
+ * for every field of the nested message or with pb_encoder_size_struct().
+ *
+ * \warning The fields encoded must add up to exactly the given length, or the
+ * encoded message is corrupted. This is only checked with assertions.
+ *
+ * \param[in,out] encoder Encoder
+ * \param[in]     tag     Tag
+ * \param[out]    frame   Frame
+ * \param[in]     length  Length of nested message
+ * \return                Error code
+ */
+extern pb_error_t
+pb_encoder_begin_nested_sized(
+    pb_encoder_t *encoder, pb_tag_t tag, pb_encoder_frame_t *frame,
+    size_t length) {
+  assert(encoder && tag && frame);
+  assert(length <= UINT32_MAX);
+  if (unlikely_(!pb_encoder_valid(encoder)))
+    return PB_ERROR_INVALID;
+  pb_error_t error = drain(encoder);
+  if (unlikely_(error))
+    return error;
+
+  /* Write tag and length prefix */
+  const pb_field_descriptor_t *descriptor =
+    field_descriptor(encoder, tag, 1);
+  assert(pb_field_descriptor_type(descriptor) == PB_TYPE_MESSAGE);
+  uint32_t prefix = length;
+  size_t size = pb_field_descriptor_key_size(descriptor);
+  uint8_t *data = pb_buffer_grow(&(encoder->buffer),
+    size + pb_varint_size_uint32(&prefix));
+  if (unlikely_(!data))
+    return PB_ERROR_ALLOC;
+  pb_field_descriptor_key_pack(data, descriptor, PB_WIRETYPE_LENGTH);
+  pb_varint_pack_uint32(&(data[size]), &prefix);
+
+  /* Push frame and switch to nested descriptor */
+  frame->descriptor = encoder->descriptor;
+  frame->offset     = pb_buffer_size(&(encoder->buffer));
+  frame->end        = encoder->sink.written + pb_encoder_length(encoder) +
+    length;
+  frame->parent     = encoder->frame;
+  encoder->frame      = frame;
+  encoder->descriptor = pb_field_descriptor_nested(descriptor);
+  return PB_ERROR_NONE;
+}
+
+/*!
+ * End the nested message that was begun last.
+ *
+ * The length prefix is backfilled in its minimal size. If it takes less than
+ * the reserved space, the fields of the nested message are moved within the
+ * buffer of the encoder, which never allocates or fails. Nested messages of
+ * known length are just closed, as their length prefix was already written.
+ *
+ * \param[in,out] encoder Encoder
+ */
+extern void
+pb_encoder_end_nested(pb_encoder_t *encoder) {
+  assert(encoder && encoder->frame);
+  pb_encoder_frame_t *frame = encoder->frame;
+
+  /* Length prefix was written upfront, if length is known */
+  if (frame->end) {
+    assert(frame->end >= encoder->sink.written + pb_encoder_length(encoder));
+    encoder->descriptor = frame->descriptor;
+    encoder->frame      = frame->parent;
+    return;
+  }
+  uint8_t *data = &(encoder->buffer.data[frame->offset]);
+
+  /* Determine segments referenced by the nested message */
+  size_t owned = pb_buffer_size(&(encoder->buffer)) - frame->offset - 5,
+         first = encoder->segment.size;
+  uint32_t length = owned;
+  while (first && encoder->segment.data[first - 1].offset >= frame->offset + 5)
+    length += encoder->segment.data[--first].size;
+
+  /* Move fields, if length prefix takes less than the reserved space */
+  size_t delta = 5 - pb_varint_size_uint32(&length);
+  if (delta) {
+    memmove(&(data[5 - delta]), &(data[5]), owned);
+    encoder->buffer.size -= delta;
+    for (size_t s = first; s < encoder->segment.size; s++)
+      encoder->segment.data[s].offset -= delta;
+  }
+  pb_varint_pack_uint32(data, &length);
+
+  /* Pop frame and restore descriptor of parent */
+  encoder->descriptor = frame->descriptor;
+  encoder->frame      = frame->parent;
+}
+
+/*!
+ * Encode a set of fields at once.
+ *
+ * The encoded size of all fields is calculated upfront, so the buffer of the
+ * encoder is grown exactly once to its final size before the fields are
+ * written. The same limitations as for pb_encoder_encode() apply.
+ *
+ * \param[in,out] encoder  Encoder
+ * \param[in]     fields[] Fields
+ * \param[in]     size     Field count
+ * \return                 Error code
+ */
+extern pb_error_t
+pb_encoder_encode_fields(
+    pb_encoder_t *encoder, const pb_encoder_field_t fields[], size_t size) {
+  assert(encoder && fields && size);
+  if (unlikely_(!pb_encoder_valid(encoder)))
+    return PB_ERROR_INVALID;
+  pb_error_t error = drain(encoder);
+  if (unlikely_(error))
+    return error;
+
+  /* Encode fields one-by-one if payloads are referenced */
+  if (encoder->threshold) {
+    for (size_t f = 0; !error && f < size; f++)
+      error = pb_encoder_encode(encoder,
+        fields[f].tag, fields[f].values, fields[f].size);
+    return error;
+  }
+
+  /* Calculate encoded size of all fields */
+  size_t total = 0;
+  for (size_t f = 0; f < size; f++)
+    total += pb_encoder_size(encoder,
+      fields[f].tag, fields[f].values, fields[f].size);
+
+  /* Grow buffer once and pack fields into reserved space */
+  uint8_t *data = pb_buffer_grow(&(encoder->buffer), total);
+  if (unlikely_(!data))
+    return PB_ERROR_ALLOC;
+  for (size_t f = 0; f < size; f++)
+    data += pack_values(data,
+      field_descriptor(encoder, fields[f].tag, fields[f].size),
+        fields[f].values, fields[f].size);
+  return PB_ERROR_NONE;
+}
+
+/*!
+ * Encode a struct according to a layout.
+ *
+ * The fields of the layout are walked in the order of the descriptor, which
+ * is the order of tags for generated descriptors. The encoded size of the
+ * whole struct is calculated upfront, so the buffer of the encoder is grown
+ * exactly once and no field descriptor is looked up by tag. The size of a
+ * nested message is calculated again when its length prefix is written.
+ *
+ * \param[in,out] encoder Encoder
+ * \param[in]     layout  Layout
+ * \param[in]     value   Pointer holding struct
+ * \return                Error code
+ */
+extern pb_error_t
+pb_encoder_encode_struct(
+    pb_encoder_t *encoder, const pb_layout_t *layout, const void *value) {
+  assert(encoder && layout && value);
+  if (unlikely_(!pb_encoder_valid(encoder)))
+    return PB_ERROR_INVALID;
+  assert(pb_layout_descriptor(layout) == encoder->descriptor);
+  pb_error_t error = drain(encoder);
+  if (unlikely_(error))
+    return error;
+
+  /* Calculate encoded size of struct */
+  size_t size = size_struct(layout, value);
+  if (!size)
+    return PB_ERROR_NONE;
+
+  /* Grow buffer once and pack struct into reserved space */
+  uint8_t *data = pb_buffer_grow(&(encoder->buffer), size);
+  if (unlikely_(!data))
+    return PB_ERROR_ALLOC;
+  pack_struct(data, layout, value);
+  return PB_ERROR_NONE;
+}
+
+/*!
+ * Retrieve the length of the message encoded by an encoder.
+ *
+ * This includes the buffer of the encoder and all referenced segments.
+ *
+ * \param[in] encoder Encoder
+ * \return            Length
+ */
+extern size_t
+pb_encoder_length(const pb_encoder_t *encoder) {
+  assert(encoder);
+  size_t length = pb_buffer_size(&(encoder->buffer));
+  for (size_t s = 0; s < encoder->segment.size; s++)
+    length += encoder->segment.data[s].size;
+  return length;
+}
+
+/*!
+ * Retrieve the encoded message of an encoder as a list of I/O vectors.
+ *
+ * The vectors alternate between parts of the buffer of the encoder and the
+ * referenced segments, so they can directly be passed to writev() or used
+ * with sendmsg() without copying large payloads. At most the given number of
+ * vectors is written, but the number of vectors required is always returned.
+ *
+ * \param[in]  encoder Encoder
+ * \param[out] iov[]   I/O vectors
+ * \param[in]  size    I/O vector count
+ * \return             I/O vectors required
+ */
+extern size_t
+pb_encoder_iovec(
+    const pb_encoder_t *encoder, struct iovec *iov, size_t size) {
+  assert(encoder && (iov || !size));
+  const uint8_t *owned = pb_buffer_data(&(encoder->buffer));
+  size_t offset = 0, count = 0;
+  for (size_t s = 0; s < encoder->segment.size; s++) {
+    const pb_encoder_segment_t *segment = &(encoder->segment.data[s]);
+    if (segment->offset > offset) {
+      if (count < size)
+        iov[count] = (struct iovec){
+          (void *)&(owned[offset]), segment->offset - offset };
+      offset = segment->offset, count++;
     }
+    if (count < size)
+      iov[count] = (struct iovec){ (void *)segment->data, segment->size };
+    count++;
+  }
+
+  /* Add remaining part of buffer */
+  if (pb_buffer_size(&(encoder->buffer)) > offset) {
+    if (count < size)
+      iov[count] = (struct iovec){ (void *)&(owned[offset]),
+        pb_buffer_size(&(encoder->buffer)) - offset };
+    count++;
   }
-  return error;
+  return count;
+}
+
+/*!
+ * Retrieve the encoded size of a value or set of values.
+ *
+ * This function returns the exact number of bytes that pb_encoder_encode()
+ * would append to the buffer of the encoder for the same arguments, which can
+ * be used to preallocate buffers of the appropriate size.
+ *
+ * \param[in] encoder Encoder
+ * \param[in] tag     Tag
+ * \param[in] values  Pointer holding value(s)
+ * \param[in] size    Value count
+ * \return            Encoded size
+ */
+extern size_t
+pb_encoder_size(
+    const pb_encoder_t *encoder, pb_tag_t tag, const void *values,
+    size_t size) {
+  assert(encoder && tag && values && size);
+  return size_values(field_descriptor(encoder, tag, size), values, size);
+}
+
+/*!
+ * Retrieve the encoded size of a struct according to a layout.
+ *
+ * This function returns the exact number of bytes that
+ * pb_encoder_encode_struct() would append to the buffer of an encoder for the
+ * same arguments, which is the length of a nested message encoded from the
+ * struct, e.g. for pb_encoder_begin_nested_sized().
+ *
+ * \param[in] layout Layout
+ * \param[in] value  Pointer holding struct
+ * \return           Encoded size
+ */
+extern size_t
+pb_encoder_size_struct(const pb_layout_t *layout, const void *value) {
+  assert(layout && value);
+  return size_struct(layout, value);
 }
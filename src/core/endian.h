@@ -0,0 +1,95 @@
+/*
+ * Copyright (c) 2013-2020 Martin Donath <martin.donath@squidfunk.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef PB_CORE_ENDIAN_H
+#define PB_CORE_ENDIAN_H
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "core/common.h"
+
+/* ----------------------------------------------------------------------------
+ * Constants
+ * ------------------------------------------------------------------------- */
+
+/*! Whether fixed-sized values must be byte-swapped, i.e. on big-endian hosts */
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#define PB_ENDIAN_SWAP 1
+#else
+#define PB_ENDIAN_SWAP 0
+#endif /* __BYTE_ORDER__ */
+
+/* ----------------------------------------------------------------------------
+ * Inline functions
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Copy fixed-sized values between wire and host byte order.
+ *
+ * Fixed-sized values are encoded in little-endian byte order, so on little-
+ * endian hosts, this is a plain copy. On big-endian hosts, every value is
+ * byte-swapped while being copied. The loop is branchless and operates on
+ * values of a single size, so compilers turn it into vector permutes, which
+ * swap a whole run of packed values at once. As byte-swapping is symmetric,
+ * this function is used for decoding and encoding alike.
+ *
+ * \warning The caller has to ensure that both buffers are appropriately sized
+ * and don't overlap.
+ *
+ * \param[out] target Target buffer
+ * \param[in]  source Source buffer
+ * \param[in]  size   Value count
+ * \param[in]  item   Value size, i.e. 4 or 8
+ */
+PB_INLINE void
+pb_endian_copy(void *target, const void *source, size_t size, size_t item) {
+  assert(target && source && (item == 4 || item == 8));
+
+#if PB_ENDIAN_SWAP
+
+  uint8_t *data = target; const uint8_t *temp = source;
+  if (item == 4) {
+    for (size_t v = 0; v < size; v++) {
+      uint32_t value; memcpy(&value, &(temp[v << 2]), 4);
+      value = __builtin_bswap32(value);
+      memcpy(&(data[v << 2]), &value, 4);
+    }
+  } else {
+    for (size_t v = 0; v < size; v++) {
+      uint64_t value; memcpy(&value, &(temp[v << 3]), 8);
+      value = __builtin_bswap64(value);
+      memcpy(&(data[v << 3]), &value, 8);
+    }
+  }
+
+#else
+
+  memcpy(target, source, size * item);
+
+#endif /* PB_ENDIAN_SWAP */
+
+}
+
+#endif /* PB_CORE_ENDIAN_H */
@@ -0,0 +1,138 @@
+/*
+ * Copyright (c) 2013-2020 Martin Donath <martin.donath@squidfunk.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "core/allocator.h"
+#include "core/buffer.h"
+#include "core/common.h"
+#include "core/encoder.h"
+#include "core/fragment.h"
+#include "core/varint.h"
+
+/* ----------------------------------------------------------------------------
+ * Interface
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Freeze the encoded submessage of an encoder into a fragment.
+ *
+ * \param[in] tag     Tag
+ * \param[in] encoder Encoder of submessage
+ * \return            Fragment
+ */
+extern pb_fragment_t *
+pb_fragment_create(pb_tag_t tag, const pb_encoder_t *encoder) {
+  return pb_fragment_create_with_allocator(&allocator_default, tag, encoder);
+}
+
+/*!
+ * Freeze the encoded submessage of an encoder into a fragment using a custom
+ * allocator.
+ *
+ * A fragment is an immutable copy of an encoded submessage, prefixed with the
+ * key of the given tag and the length of the submessage, all within a single
+ * allocation. Submessages shared by many outbound messages, e.g. static
+ * headers, are thus encoded once and appended verbatim with a single copy via
+ * pb_encoder_encode_fragment(), or attached to journals without any copy via
+ * pb_journal_attach_fragment(). The encoder can be destroyed afterwards.
+ *
+ * Fragments are reference-counted, starting with one reference held by the
+ * caller, and are freed when the last reference is released. As fragments
+ * are never altered, they can be shared between threads, as long as every
+ * thread retains its own reference.
+ *
+ * If the encoder is invalid, references segments or is in the middle of a
+ * nested message or streaming to a sink, or allocation fails, NULL is
+ * returned.
+ *
+ * \warning A fragment does not take ownership of the provided allocator, so
+ * the caller must ensure that the allocator is not freed during operations.
+ * If the fragment is shared between threads, the allocator must be
+ * thread-safe, as the fragment may be freed by any of them.
+ *
+ * \param[in,out] allocator Allocator
+ * \param[in]     tag       Tag
+ * \param[in]     encoder   Encoder of submessage
+ * \return                  Fragment
+ */
+extern pb_fragment_t *
+pb_fragment_create_with_allocator(
+    pb_allocator_t *allocator, pb_tag_t tag, const pb_encoder_t *encoder) {
+  assert(allocator && tag && encoder);
+  if (unlikely_(!pb_encoder_valid(encoder) || tag >> 29 || encoder->frame ||
+                encoder->segment.size || encoder->sink.written))
+    return NULL;
+
+  /* Allocate fragment for key, length prefix and submessage */
+  const pb_buffer_t *buffer = pb_encoder_buffer(encoder);
+  uint32_t key    = tag << 3 | PB_WIRETYPE_LENGTH,
+           length = pb_buffer_size(buffer);
+  size_t   offset = pb_varint_size_uint32(&key) +
+    pb_varint_size_uint32(&length);
+  pb_fragment_t *fragment = pb_allocator_allocate(allocator,
+    sizeof(pb_fragment_t) + offset + length);
+  if (unlikely_(!fragment))
+    return NULL;
+
+  /* Initialize fragment and copy submessage */
+  *fragment = (pb_fragment_t){
+    .allocator  = allocator,
+    .references = 1,
+    .tag        = tag,
+    .offset     = offset,
+    .size       = offset + length
+  };
+  size_t written = pb_varint_pack_uint32(fragment->data, &key);
+  pb_varint_pack_uint32(&(fragment->data[written]), &length);
+  if (length)
+    memcpy(&(fragment->data[offset]), pb_buffer_data(buffer), length);
+  return fragment;
+}
+
+/*!
+ * Retain a reference to a fragment.
+ *
+ * \param[in,out] fragment Fragment
+ * \return                 Fragment
+ */
+extern pb_fragment_t *
+pb_fragment_retain(pb_fragment_t *fragment) {
+  assert(fragment);
+  __atomic_add_fetch(&(fragment->references), 1, __ATOMIC_RELAXED);
+  return fragment;
+}
+
+/*!
+ * Release a reference to a fragment, freeing it with the last reference.
+ *
+ * \param[in,out] fragment Fragment
+ */
+extern void
+pb_fragment_release(pb_fragment_t *fragment) {
+  assert(fragment);
+  if (!__atomic_sub_fetch(&(fragment->references), 1, __ATOMIC_ACQ_REL))
+    pb_allocator_free(fragment->allocator, fragment);
+}
@@ -0,0 +1,270 @@
+/*
+ * Copyright (c) 2013-2020 Martin Donath <martin.donath@squidfunk.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "core/allocator.h"
+#include "core/common.h"
+#include "core/intern.h"
+
+/* ----------------------------------------------------------------------------
+ * Internal functions
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Compute the hash of a string.
+ *
+ * Interned strings are mostly short, e.g. host or service names, so the
+ * string is consumed a word at a time, each of which is mixed into the hash
+ * with a multiplication, followed by a final avalanche. Words are read in
+ * host byte order, as hashes never leave the process.
+ *
+ * \param[in] data[] Raw data
+ * \param[in] size   Raw data size
+ * \return           Hash
+ */
+static uint64_t
+hash(const uint8_t data[], size_t size) {
+  assert(data || !size);
+  uint64_t hash = 0x9E3779B97F4A7C15ULL ^ size, word;
+  for (; size >= 8; data += 8, size -= 8) {
+    memcpy(&word, data, 8);
+    hash  = (hash ^ word) * 0xFF51AFD7ED558CCDULL;
+    hash ^= hash >> 32;
+  }
+  if (size) {
+    word = 0;
+    memcpy(&word, data, size);
+    hash  = (hash ^ word) * 0xFF51AFD7ED558CCDULL;
+    hash ^= hash >> 32;
+  }
+  hash  = (hash ^ (hash >> 29)) * 0xC4CEB9FE1A85EC53ULL;
+  return hash ^ (hash >> 32);
+}
+
+/*!
+ * Look up the slot of a string in an interning table.
+ *
+ * Slots are probed linearly, starting at the position given by the hash,
+ * until either the string or an empty slot is found.
+ *
+ * \param[in] intern Interning table
+ * \param[in] string String
+ * \param[in] value  Hash of string
+ * \return           Slot
+ */
+static pb_intern_entry_t **
+lookup(const pb_intern_t *intern, const pb_string_t *string, uint64_t value) {
+  assert(intern && string && intern->slot.size);
+  size_t mask = intern->slot.size - 1;
+  for (size_t s = value & mask;; s = (s + 1) & mask) {
+    pb_intern_entry_t **slot = &(intern->slot.data[s]);
+    if (!*slot)
+      return slot;
+
+    /* Compare sizes first, as strings may be prefixes of each other */
+    const pb_string_t *other = &((*slot)->string);
+    if ((*slot)->hash == value &&
+        pb_string_size(other) == pb_string_size(string) &&
+        (!pb_string_size(string) || !memcmp(pb_string_data(other),
+          pb_string_data(string), pb_string_size(string))))
+      return slot;
+  }
+}
+
+/*!
+ * Ensure that an interning table can take another string.
+ *
+ * Slots are kept at most half full, so probe sequences remain short. If the
+ * slots must be grown, all entries are re-inserted by their stored hashes.
+ *
+ * \param[in,out] intern Interning table
+ * \return               Error code
+ */
+static pb_error_t
+reserve(pb_intern_t *intern) {
+  assert(intern);
+  size_t size = intern->entry.size + 1;
+
+  /* Grow entries, if necessary */
+  if (size > intern->entry.capacity) {
+    size_t capacity = intern->entry.capacity ? intern->entry.capacity << 1 : 16;
+    pb_intern_entry_t **data = pb_allocator_resize(intern->allocator,
+      intern->entry.data, sizeof(pb_intern_entry_t *) * capacity);
+    if (unlikely_(!data))
+      return PB_ERROR_ALLOC;
+    intern->entry.data     = data;
+    intern->entry.capacity = capacity;
+  }
+
+  /* Grow slots and re-insert entries, if necessary */
+  if (size << 1 > intern->slot.size) {
+    size_t slots = intern->slot.size ? intern->slot.size << 1 : 32;
+    pb_intern_entry_t **data = pb_allocator_allocate(intern->allocator,
+      sizeof(pb_intern_entry_t *) * slots);
+    if (unlikely_(!data))
+      return PB_ERROR_ALLOC;
+    memset(data, 0, sizeof(pb_intern_entry_t *) * slots);
+    for (size_t e = 0; e < intern->entry.size; e++) {
+      size_t s = intern->entry.data[e]->hash & (slots - 1);
+      while (data[s])
+        s = (s + 1) & (slots - 1);
+      data[s] = intern->entry.data[e];
+    }
+    if (intern->slot.data)
+      pb_allocator_free(intern->allocator, intern->slot.data);
+    intern->slot.data = data;
+    intern->slot.size = slots;
+  }
+  return PB_ERROR_NONE;
+}
+
+/* ----------------------------------------------------------------------------
+ * Interface
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Create an interning table.
+ *
+ * \return Interning table
+ */
+extern pb_intern_t
+pb_intern_create(void) {
+  return pb_intern_create_with_allocator(&allocator_default);
+}
+
+/*!
+ * Create an interning table using a custom allocator.
+ *
+ * An interning table maps strings to unique copies, which are allocated once
+ * and never move, so interned strings can be compared by pointer and outlive
+ * the buffers they were decoded from. Every interned string is furthermore
+ * assigned an identifier in order of insertion.
+ *
+ * \warning An interning table does not take ownership of the provided
+ * allocator, so the caller must ensure that the allocator is not freed during
+ * operations.
+ *
+ * \param[in,out] allocator Allocator
+ * \return                  Interning table
+ */
+extern pb_intern_t
+pb_intern_create_with_allocator(pb_allocator_t *allocator) {
+  assert(allocator);
+  pb_intern_t intern = {
+    .allocator    = allocator,
+    .entry        = {
+      .data       = NULL,
+      .size       = 0,
+      .capacity   = 0
+    },
+    .slot         = {
+      .data       = NULL,
+      .size       = 0
+    }
+  };
+  return intern;
+}
+
+/*!
+ * Destroy an interning table.
+ *
+ * \warning All interned strings are freed, so they must not be used anymore.
+ *
+ * \param[in,out] intern Interning table
+ */
+extern void
+pb_intern_destroy(pb_intern_t *intern) {
+  assert(intern);
+  for (size_t e = 0; e < intern->entry.size; e++)
+    pb_allocator_free(intern->allocator, intern->entry.data[e]);
+  if (intern->entry.data)
+    pb_allocator_free(intern->allocator, intern->entry.data);
+  if (intern->slot.data)
+    pb_allocator_free(intern->allocator, intern->slot.data);
+  intern->entry.data     = NULL;
+  intern->entry.size     = 0;
+  intern->entry.capacity = 0;
+  intern->slot.data      = NULL;
+  intern->slot.size      = 0;
+}
+
+/*!
+ * Intern a string.
+ *
+ * If the string was interned before, the existing copy is returned. Otherwise
+ * the string is copied into the table and assigned the next identifier.
+ *
+ * \param[in,out] intern Interning table
+ * \param[in]     string String
+ * \return               Interned string or NULL on allocation failure
+ */
+extern const pb_string_t *
+pb_intern_insert(pb_intern_t *intern, const pb_string_t *string) {
+  assert(intern && string);
+  if (unlikely_(reserve(intern)))
+    return NULL;
+
+  /* Return existing copy, if any */
+  uint64_t value = hash(pb_string_data(string), pb_string_size(string));
+  pb_intern_entry_t **slot = lookup(intern, string, value);
+  if (*slot)
+    return &((*slot)->string);
+
+  /* Allocate entry together with a copy of the string */
+  size_t size = pb_string_size(string);
+  pb_intern_entry_t *entry = pb_allocator_allocate(intern->allocator,
+    sizeof(pb_intern_entry_t) + size);
+  if (unlikely_(!entry))
+    return NULL;
+  uint8_t *data = (uint8_t *)(entry + 1);
+  if (size)
+    memcpy(data, pb_string_data(string), size);
+
+  /* Initialize entry and insert it */
+  entry->string = pb_string_init(data, size);
+  entry->hash   = value;
+  entry->id     = intern->entry.size;
+  intern->entry.data[intern->entry.size++] = entry;
+  *slot = entry;
+  return &(entry->string);
+}
+
+/*!
+ * Look up a string in an interning table without interning it.
+ *
+ * \param[in] intern Interning table
+ * \param[in] string String
+ * \return           Interned string or NULL if not interned
+ */
+extern const pb_string_t *
+pb_intern_find(const pb_intern_t *intern, const pb_string_t *string) {
+  assert(intern && string);
+  if (unlikely_(!intern->slot.size))
+    return NULL;
+  pb_intern_entry_t **slot = lookup(intern, string,
+    hash(pb_string_data(string), pb_string_size(string)));
+  return *slot ? &((*slot)->string) : NULL;
+}
@@ -0,0 +1,123 @@
+/*
+ * Copyright (c) 2013-2020 Martin Donath <martin.donath@squidfunk.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "core/allocator.h"
+#include "core/common.h"
+#include "core/descriptor.h"
+#include "core/layout.h"
+
+/* ----------------------------------------------------------------------------
+ * Interface
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Initialize a struct according to a layout.
+ *
+ * All members are zeroed and all presence bits are cleared, after which the
+ * default values of all singular fields are copied into their members.
+ *
+ * \param[in]  layout Layout
+ * \param[out] value  Pointer holding struct
+ */
+extern void
+pb_layout_init(const pb_layout_t *layout, void *value) {
+  assert(layout && value);
+  memset(value, 0, layout->size);
+  const pb_descriptor_t *descriptor = layout->descriptor;
+  for (size_t f = 0; f < layout->field.size; f++) {
+    const pb_field_descriptor_t *field = &(descriptor->field.data[f]);
+    if (pb_field_descriptor_label(field) != PB_LABEL_REPEATED &&
+        pb_field_descriptor_type(field)  != PB_TYPE_MESSAGE &&
+        pb_field_descriptor_default(field))
+      memcpy(pb_layout_member(layout, value, f),
+        pb_field_descriptor_default(field),
+          pb_field_descriptor_type_size(field));
+  }
+}
+
+/*!
+ * Release all memory held by the members of a struct and reinitialize it.
+ *
+ * Nested messages and the values of repeated fields are allocated while
+ * decoding into a struct, so this function must be called to free them. The
+ * struct itself is not freed, as it is provided by the caller.
+ *
+ * \param[in]     layout Layout
+ * \param[in,out] value  Pointer holding struct
+ */
+extern void
+pb_layout_clear(const pb_layout_t *layout, void *value) {
+  assert(layout && value);
+  const pb_descriptor_t *descriptor = layout->descriptor;
+  for (size_t f = 0; f < layout->field.size; f++) {
+    const pb_field_descriptor_t *field = &(descriptor->field.data[f]);
+    const pb_layout_t *nested = pb_layout_nested(layout, f);
+    void *member = pb_layout_member(layout, value, f);
+
+    /* Free values of repeated field */
+    if (pb_field_descriptor_label(field) == PB_LABEL_REPEATED) {
+      pb_repeated_t *repeated = member;
+      if (nested)
+        for (size_t v = 0; v < repeated->size; v++)
+          pb_layout_clear(nested,
+            (uint8_t *)repeated->data + v * nested->size);
+      if (repeated->data)
+        pb_allocator_free(&allocator_default, repeated->data);
+
+    /* Free nested message */
+    } else if (nested && *(void **)member) {
+      pb_layout_clear(nested, *(void **)member);
+      pb_allocator_free(&allocator_default, *(void **)member);
+    }
+  }
+  pb_layout_init(layout, value);
+}
+
+/*!
+ * Append an uninitialized value to a repeated member of a struct.
+ *
+ * The capacity of the repeated member is doubled whenever it is exhausted, so
+ * appending values is amortized constant.
+ *
+ * \param[in,out] repeated Repeated member
+ * \param[in]     size     Value size
+ * \return                 Pointer holding value
+ */
+extern void *
+pb_layout_push(pb_repeated_t *repeated, size_t size) {
+  assert(repeated && size);
+  if (repeated->size == repeated->capacity) {
+    size_t capacity = repeated->capacity ? repeated->capacity << 1 : 8;
+    void *data = pb_allocator_resize(&allocator_default,
+      repeated->data, capacity * size);
+    if (unlikely_(!data))
+      return NULL;
+    repeated->data     = data;
+    repeated->capacity = capacity;
+  }
+  return (uint8_t *)repeated->data + repeated->size++ * size;
+}
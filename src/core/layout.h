@@ -0,0 +1,75 @@
+/*
+ * Copyright (c) 2013-2020 Martin Donath <martin.donath@squidfunk.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef PB_CORE_LAYOUT_H
+#define PB_CORE_LAYOUT_H
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <protobluff/core/layout.h>
+
+#include "core/common.h"
+
+/* ----------------------------------------------------------------------------
+ * Interface
+ * ------------------------------------------------------------------------- */
+
+PB_WARN_UNUSED_RESULT
+extern void *
+pb_layout_push(
+  pb_repeated_t *repeated,             /* Repeated member */
+  size_t size);                        /* Value size */
+
+/* ----------------------------------------------------------------------------
+ * Inline functions
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Retrieve the member of a struct for the field at the given position.
+ *
+ * \param[in]     layout Layout
+ * \param[in,out] value  Pointer holding struct
+ * \param[in]     pos    Field position
+ * \return               Pointer holding member
+ */
+PB_INLINE void *
+pb_layout_member(const pb_layout_t *layout, void *value, size_t pos) {
+  assert(layout && value && pos < layout->field.size);
+  return (uint8_t *)value + layout->field.data[pos].offset;
+}
+
+/*!
+ * Retrieve the nested layout for the field at the given position.
+ *
+ * \param[in] layout Layout
+ * \param[in] pos    Field position
+ * \return           Nested layout
+ */
+PB_INLINE const pb_layout_t *
+pb_layout_nested(const pb_layout_t *layout, size_t pos) {
+  assert(layout && pos < layout->field.size);
+  return layout->field.data[pos].nested;
+}
+
+#endif /* PB_CORE_LAYOUT_H */
@@ -0,0 +1,94 @@
+/*
+ * Copyright (c) 2013-2020 Martin Donath <martin.donath@squidfunk.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef PB_CORE_PROBE_H
+#define PB_CORE_PROBE_H
+
+#ifdef PB_PROBES
+#include <sys/sdt.h>
+#endif /* PB_PROBES */
+
+#include "core/common.h"
+
+/* ----------------------------------------------------------------------------
+ * Macros
+ * ------------------------------------------------------------------------- */
+
+#ifdef PB_PROBES
+
+/*!
+ * Fire a static probe of the protobluff provider with two arguments.
+ *
+ * Probes are compiled to a single no-op instruction and a note section that
+ * tracers like bpftrace or perf use to attach to them at runtime, e.g.:
+ *
+ * \code{.sh}
+ *   bpftrace -e 'usdt:libprotobluff.so:protobluff:decode__end
+ *     { @[arg0] = hist(arg1); }'
+ * \endcode
+ *
+ * \param[in] name Probe name
+ * \param[in] a    First argument
+ * \param[in] b    Second argument
+ */
+#define pb_probe2(name, a, b) \
+  STAP_PROBE2(protobluff, name, a, b)
+
+/*!
+ * Fire a static probe of the protobluff provider with three arguments.
+ *
+ * \param[in] name Probe name
+ * \param[in] a    First argument
+ * \param[in] b    Second argument
+ * \param[in] c    Third argument
+ */
+#define pb_probe3(name, a, b, c) \
+  STAP_PROBE3(protobluff, name, a, b, c)
+
+/*!
+ * Fire a static probe of the protobluff provider with four arguments.
+ *
+ * \param[in] name Probe name
+ * \param[in] a    First argument
+ * \param[in] b    Second argument
+ * \param[in] c    Third argument
+ * \param[in] d    Fourth argument
+ */
+#define pb_probe4(name, a, b, c, d) \
+  STAP_PROBE4(protobluff, name, a, b, c, d)
+
+#else
+
+/*
+ * Ignore probes if static probes are not available. The arguments are only
+ * referenced to silence warnings about variables set solely for probes.
+ */
+#define pb_probe2(name, a, b) \
+  ((void)(a), (void)(b))
+#define pb_probe3(name, a, b, c) \
+  ((void)(a), (void)(b), (void)(c))
+#define pb_probe4(name, a, b, c, d) \
+  ((void)(a), (void)(b), (void)(c), (void)(d))
+
+#endif /* PB_PROBES */
+
+#endif /* PB_CORE_PROBE_H */
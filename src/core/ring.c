@@ -0,0 +1,185 @@
+/*
+ * Copyright (c) 2013-2020 Martin Donath <martin.donath@squidfunk.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "core/common.h"
+#include "core/descriptor.h"
+#include "core/encoder.h"
+#include "core/ring.h"
+
+/* ----------------------------------------------------------------------------
+ * Internal functions
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Determine the contiguous free region of a ring buffer to encode into.
+ *
+ * While no data wrapped around, the region behind the committed data is used
+ * if it is large enough, otherwise the region in front of it, so encoding
+ * wraps around to the start of the ring buffer. Messages are thus always
+ * contiguous. If no minimum size is given, the larger region is returned.
+ *
+ * \param[in]  ring   Ring buffer
+ * \param[in]  size   Minimum size
+ * \param[out] offset Pointer receiving offset
+ * \return            Region size
+ */
+static size_t
+region(const pb_ring_t *ring, size_t size, size_t *offset) {
+  assert(ring && offset);
+  if (ring->wrap) {
+    *offset = ring->wrap;
+    return ring->used.start - ring->wrap;
+  }
+
+  /* Choose between region behind and in front of committed data */
+  size_t behind = ring->capacity - ring->used.end,
+         before = ring->used.start;
+  if (size ? behind >= size : behind >= before) {
+    *offset = ring->used.end;
+    return behind;
+  }
+  *offset = 0;
+  return before;
+}
+
+/* ----------------------------------------------------------------------------
+ * Interface
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Create a ring buffer on top of caller-provided memory.
+ *
+ * A ring buffer hands out encoders writing directly into its memory, so
+ * messages can be serialized without any allocation. Encoded messages are
+ * committed in order and released by the consumer once written out.
+ *
+ * \warning The caller must ensure that the memory outlives the ring buffer.
+ *
+ * \param[in,out] data[]   Raw data
+ * \param[in]     capacity Raw data capacity
+ * \return                 Ring buffer
+ */
+extern pb_ring_t
+pb_ring_create(uint8_t data[], size_t capacity) {
+  assert(data && capacity);
+  pb_ring_t ring = {
+    .data     = data,
+    .capacity = capacity,
+    .used     = { 0, 0 },
+    .wrap     = 0
+  };
+  return ring;
+}
+
+/*!
+ * Retrieve the size of the largest message that fits into a ring buffer.
+ *
+ * \param[in] ring Ring buffer
+ * \return         Bytes available
+ */
+extern size_t
+pb_ring_available(const pb_ring_t *ring) {
+  assert(ring);
+  size_t offset;
+  return region(ring, 0, &offset);
+}
+
+/*!
+ * Create an encoder writing into the free space of a ring buffer.
+ *
+ * The encoder is bounded by the contiguous free region, wrapping around to
+ * the start of the ring buffer if the region behind the committed data is
+ * smaller than the given minimum size. If no region of the minimum size is
+ * available, the returned encoder is invalid. The encoded message becomes
+ * visible to the consumer through pb_ring_commit(). Only a single encoder
+ * may be outstanding at any time.
+ *
+ * \param[in,out] ring       Ring buffer
+ * \param[in]     descriptor Descriptor
+ * \param[in]     size       Minimum size
+ * \return                   Encoder
+ */
+extern pb_encoder_t
+pb_ring_encoder(
+    pb_ring_t *ring, const pb_descriptor_t *descriptor, size_t size) {
+  assert(ring && descriptor);
+  size_t offset, available = region(ring, size, &offset);
+  if (unlikely_(!available || available < size))
+    return pb_encoder_create_invalid();
+  return pb_encoder_create_fixed(descriptor,
+    &(ring->data[offset]), available);
+}
+
+/*!
+ * Commit the message encoded by an encoder created from a ring buffer.
+ *
+ * \param[in,out] ring    Ring buffer
+ * \param[in]     encoder Encoder
+ * \return                Error code
+ */
+extern pb_error_t
+pb_ring_commit(pb_ring_t *ring, const pb_encoder_t *encoder) {
+  assert(ring && encoder);
+  if (unlikely_(!pb_encoder_valid(encoder)))
+    return PB_ERROR_INVALID;
+
+  /* Determine region the encoder was created for */
+  const pb_buffer_t *buffer = pb_encoder_buffer(encoder);
+  size_t offset = pb_buffer_data(buffer) - ring->data;
+  if (unlikely_(pb_buffer_data(buffer) < ring->data ||
+                offset > ring->capacity))
+    return PB_ERROR_INVALID;
+
+  /* Append to committed data or wrapped region */
+  if (!ring->wrap && offset == ring->used.end) {
+    ring->used.end += pb_buffer_size(buffer);
+  } else if (ring->wrap ? offset == ring->wrap : !offset) {
+    ring->wrap = offset + pb_buffer_size(buffer);
+  } else {
+    return PB_ERROR_INVALID;
+  }
+  return PB_ERROR_NONE;
+}
+
+/*!
+ * Release committed data of a ring buffer after it was consumed.
+ *
+ * Once all data in front of the wrapped region is released, the wrapped
+ * region becomes the committed data returned by pb_ring_peek().
+ *
+ * \param[in,out] ring Ring buffer
+ * \param[in]     size Bytes to release
+ */
+extern void
+pb_ring_release(pb_ring_t *ring, size_t size) {
+  assert(ring && size <= ring->used.end - ring->used.start);
+  ring->used.start += size;
+  if (ring->used.start == ring->used.end) {
+    ring->used.start = 0;
+    ring->used.end   = ring->wrap;
+    ring->wrap       = 0;
+  }
+}
@@ -0,0 +1,178 @@
+/*
+ * Copyright (c) 2013-2020 Martin Donath <martin.donath@squidfunk.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "core/buffer.h"
+#include "core/common.h"
+#include "core/decoder.h"
+#include "core/descriptor.h"
+#include "core/scan.h"
+#include "core/stream.h"
+
+/* ----------------------------------------------------------------------------
+ * Internal functions
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Scan the fields of a message along a path of field descriptors.
+ *
+ * All occurrences of the first field of the path are considered, as multiple
+ * occurrences of a nested message are merged by other implementations, so
+ * the last occurrence of the leaf field in wire order wins.
+ *
+ * \param[in]     buffer        Buffer
+ * \param[in]     descriptors[] Field descriptors
+ * \param[in]     depth         Field descriptor count
+ * \param[in,out] value         Raw value
+ * \return                      Error code
+ */
+static pb_error_t
+scan(
+    const pb_buffer_t *buffer, const pb_field_descriptor_t *descriptors[],
+    size_t depth, pb_string_t *value) {
+  assert(buffer && descriptors && depth && value);
+  pb_tag_t      tag      = pb_field_descriptor_tag(descriptors[0]);
+  pb_wiretype_t wiretype = pb_field_descriptor_wiretype(descriptors[0]);
+
+  /* Walk fields, skipping all fields not on the path */
+  pb_stream_t stream = pb_stream_create(buffer);
+  pb_error_t error = PB_ERROR_NONE;
+  while (!error && pb_stream_left(&stream)) {
+    uint32_t key;
+    if (unlikely_(error = pb_stream_read_uint32(&stream, &key)))
+      break;
+    if ((key >> 3) != tag || (key & 7) != wiretype) {
+      error = pb_decoder_skip_field(&stream, key);
+      continue;
+    }
+
+    /* Extract raw value of length-prefixed field and descend, if nested */
+    size_t offset = pb_stream_offset(&stream);
+    if (wiretype == PB_WIRETYPE_LENGTH) {
+      pb_string_t string;
+      if (unlikely_(error = pb_stream_read_length(&stream, &string)))
+        break;
+      if (depth > 1) {
+        pb_buffer_t nested = pb_buffer_create_zero_copy_internal(
+          pb_string_data(&string), pb_string_size(&string));
+        error = scan(&nested, &(descriptors[1]), depth - 1, value);
+      } else {
+        *value = string;
+      }
+
+    /* Extract raw bytes of any other value */
+    } else if (likely_(!(error = pb_stream_skip(&stream, wiretype)))) {
+      *value = pb_string_init(
+        pb_buffer_data_from(buffer, offset),
+        pb_stream_offset(&stream) - offset);
+    }
+  }
+  pb_stream_destroy(&stream);
+  return error;
+}
+
+/* ----------------------------------------------------------------------------
+ * Interface
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Retrieve the raw value of a field along a path of nested messages.
+ *
+ * The message is scanned on the wire level by only reading tags and length
+ * prefixes, descending only into the nested messages along the path, while
+ * all other fields are skipped. Neither values are decoded, nor handlers are
+ * invoked, nor decoders are created, which makes this much cheaper than
+ * decoding the message, e.g. when filtering messages by a single value.
+ *
+ * The value points into the buffer. For strings, bytes and nested messages,
+ * it's the raw data without the length prefix, for all other types the raw
+ * bytes of the value as encoded, i.e. the variable-sized integer or the
+ * little-endian fixed-sized value. If the field is absent, PB_ERROR_ABSENT
+ * is returned.
+ *
+ * \warning Variable-sized integers may have multiple encodings, so comparing
+ * their raw bytes is only reliable if the writer encodes them canonically,
+ * which holds for all common implementations.
+ *
+ * \param[in]  descriptor Descriptor
+ * \param[in]  buffer     Buffer
+ * \param[in]  tags[]     Tags
+ * \param[in]  depth      Tag count
+ * \param[out] value      Raw value
+ * \return                Error code
+ */
+extern pb_error_t
+pb_scan_path(
+    const pb_descriptor_t *descriptor, const pb_buffer_t *buffer,
+    const pb_tag_t tags[], size_t depth, pb_string_t *value) {
+  assert(descriptor && buffer && tags && depth && value);
+  if (unlikely_(!pb_buffer_valid(buffer)))
+    return PB_ERROR_INVALID;
+
+  /* Resolve field descriptors, all but the last must be nested messages */
+  const pb_field_descriptor_t *descriptors[depth];
+  for (size_t d = 0; d < depth; d++) {
+    if (unlikely_(!descriptor ||
+        !(descriptors[d] = pb_descriptor_field_by_tag(descriptor, tags[d]))))
+      return PB_ERROR_INVALID;
+    descriptor = pb_field_descriptor_nested(descriptors[d]);
+  }
+
+  /* Scan message along path */
+  pb_string_t temp = { NULL, 0 };
+  pb_error_t error = scan(buffer, descriptors, depth, &temp);
+  if (likely_(!error)) {
+    if (!pb_string_data(&temp))
+      return PB_ERROR_ABSENT;
+    *value = temp;
+  }
+  return error;
+}
+
+/*!
+ * Test whether the raw value of a field along a path matches a value.
+ *
+ * See pb_scan_path() for details. If the field is absent or the message is
+ * malformed, the value doesn't match.
+ *
+ * \param[in] descriptor Descriptor
+ * \param[in] buffer     Buffer
+ * \param[in] tags[]     Tags
+ * \param[in] depth      Tag count
+ * \param[in] value      Raw value
+ * \return               Test result
+ */
+extern int
+pb_scan_path_matches(
+    const pb_descriptor_t *descriptor, const pb_buffer_t *buffer,
+    const pb_tag_t tags[], size_t depth, const pb_string_t *value) {
+  assert(descriptor && buffer && tags && depth && value);
+  pb_string_t temp;
+  return !pb_scan_path(descriptor, buffer, tags, depth, &temp) &&
+    pb_string_size(&temp) == pb_string_size(value) &&
+    !memcmp(pb_string_data(&temp), pb_string_data(value),
+      pb_string_size(value));
+}
@@ -0,0 +1,575 @@
+/*
+ * Copyright (c) 2013-2020 Martin Donath <martin.donath@squidfunk.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <assert.h>
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#include "core/allocator.h"
+#include "core/common.h"
+#include "core/descriptor.h"
+#include "core/stats.h"
+
+/* ----------------------------------------------------------------------------
+ * Constants
+ * ------------------------------------------------------------------------- */
+
+/*! Number of descriptors tracked per thread, must be a power of two */
+#define PB_STATS_DESCRIPTORS 64
+
+/* ----------------------------------------------------------------------------
+ * Type definitions
+ * ------------------------------------------------------------------------- */
+
+typedef struct pb_stats_entry_t {
+  const pb_descriptor_t *descriptor;   /*!< Descriptor */
+  pb_stats_histogram_t operation[      /*!< Histograms by operation */
+    PB_STATS_OPERATIONS];
+  uint64_t messages;                   /*!< Sampled decoded messages */
+  uint64_t field[];                    /*!< Occurrences by field position */
+} pb_stats_entry_t;
+
+typedef struct pb_stats_slot_t {
+  pb_stats_t stats;                    /*!< Counters of thread */
+  pb_stats_entry_t *entry[             /*!< Histograms by descriptor */
+    PB_STATS_DESCRIPTORS];
+  size_t epoch;                        /*!< Epoch of histograms */
+  size_t countdown;                    /*!< Operations until next sample */
+  size_t profile;                      /*!< Messages until next profile */
+  struct pb_stats_slot_t *next;        /*!< Next slot */
+  int registered;                      /*!< Whether the slot is registered */
+} pb_stats_slot_t;
+
+typedef struct pb_stats_registry_t {
+  pthread_mutex_t lock;                /*!< Lock */
+  pb_stats_slot_t *head;               /*!< Slots of live threads */
+  pb_stats_t retired;                  /*!< Counters of exited threads */
+  pb_stats_entry_t *entry[             /*!< Histograms of exited threads */
+    PB_STATS_DESCRIPTORS];
+  pb_stats_t base;                     /*!< Counters at last reset */
+  size_t epoch;                        /*!< Epoch of histograms */
+  size_t sampling;                     /*!< Sample every n-th operation */
+} pb_stats_registry_t;
+
+/* ----------------------------------------------------------------------------
+ * Variables
+ * ------------------------------------------------------------------------- */
+
+/*! Process-wide registry */
+static pb_stats_registry_t registry = {
+  .lock = PTHREAD_MUTEX_INITIALIZER
+};
+
+/*! Thread-local slot */
+static __thread pb_stats_slot_t slot;
+
+/*! Key to retire the thread-local slot on thread exit */
+static pthread_key_t key;
+
+/*! Key initialization guard */
+static pthread_once_t once = PTHREAD_ONCE_INIT;
+
+/* ----------------------------------------------------------------------------
+ * Macros
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Add a value to a counter that is only written by the calling thread.
+ *
+ * \param[in,out] counter Counter
+ * \param[in]     value   Value
+ */
+#define increment(counter, value) \
+  __atomic_store_n((counter), \
+    __atomic_load_n((counter), __ATOMIC_RELAXED) + (value), \
+    __ATOMIC_RELAXED)
+
+/* ----------------------------------------------------------------------------
+ * Internal functions
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Retrieve the current time of a monotonic clock in nanoseconds.
+ *
+ * \return Nanoseconds
+ */
+static uint64_t
+now(void) {
+  struct timespec time;
+  clock_gettime(CLOCK_MONOTONIC, &time);
+  return (uint64_t)time.tv_sec * 1000000000ULL + time.tv_nsec;
+}
+
+/*!
+ * Add the counters of a thread to a total.
+ *
+ * \param[in,out] total Total
+ * \param[in]     stats Counters
+ */
+static void
+add(pb_stats_t *total, pb_stats_t *stats) {
+  assert(total && stats);
+  size_t *target = (size_t *)total, *source = (size_t *)stats;
+  for (size_t c = 0; c < sizeof(pb_stats_t) / sizeof(size_t); c++)
+    target[c] += __atomic_load_n(&(source[c]), __ATOMIC_RELAXED);
+}
+
+/*!
+ * Add a histogram of a thread to a total.
+ *
+ * \param[in,out] total     Total
+ * \param[in]     histogram Histogram
+ */
+static void
+add_histogram(pb_stats_histogram_t *total, pb_stats_histogram_t *histogram) {
+  assert(total && histogram);
+  uint64_t *target = (uint64_t *)total, *source = (uint64_t *)histogram;
+  for (size_t c = 0; c < sizeof(pb_stats_histogram_t) / sizeof(uint64_t); c++)
+    target[c] += __atomic_load_n(&(source[c]), __ATOMIC_RELAXED);
+}
+
+/*!
+ * Add the field occurrences of an entry of a thread to a total.
+ *
+ * \param[in,out] total Total
+ * \param[in]     entry Entry
+ */
+static void
+add_fields(pb_stats_entry_t *total, pb_stats_entry_t *entry) {
+  assert(total && entry);
+  total->messages += __atomic_load_n(&(entry->messages), __ATOMIC_RELAXED);
+  for (size_t f = 0; f < pb_descriptor_size(entry->descriptor); f++)
+    total->field[f] += __atomic_load_n(&(entry->field[f]), __ATOMIC_RELAXED);
+}
+
+/*!
+ * Retrieve the histograms of a descriptor from a table, creating them if
+ * requested and the table is not full.
+ *
+ * Tables are indexed by the address of the descriptor using open addressing
+ * with linear probing. Every entry carries an occurrence counter for each
+ * field of the descriptor, so it's sized according to the descriptor. Entries
+ * are published with release semantics, so they can be read by other threads
+ * without holding a lock.
+ *
+ * \param[in,out] table[]    Table
+ * \param[in]     descriptor Descriptor
+ * \param[in]     create     Whether to create missing entries
+ * \return                   Entry or NULL
+ */
+static pb_stats_entry_t *
+lookup(
+    pb_stats_entry_t *table[], const pb_descriptor_t *descriptor,
+    int create) {
+  size_t hash = (size_t)(((uintptr_t)descriptor >> 4) * 0x9E3779B97F4A7C15ULL);
+  for (size_t p = 0; p < PB_STATS_DESCRIPTORS; p++) {
+    pb_stats_entry_t **entry =
+      &(table[(hash + p) & (PB_STATS_DESCRIPTORS - 1)]);
+    if (*entry && (*entry)->descriptor == descriptor)
+      return *entry;
+
+    /* Create entry in first free position */
+    if (!*entry) {
+      if (!create)
+        return NULL;
+      size_t size = sizeof(pb_stats_entry_t) +
+        sizeof(uint64_t) * pb_descriptor_size(descriptor);
+      pb_stats_entry_t *temp = pb_allocator_allocate(
+        &allocator_default, size);
+      if (unlikely_(!temp))
+        return NULL;                                       /* LCOV_EXCL_LINE */
+      memset(temp, 0, size);
+      temp->descriptor = descriptor;
+      __atomic_store_n(entry, temp, __ATOMIC_RELEASE);
+      return temp;
+    }
+  }
+  return NULL;
+}
+
+/*!
+ * Merge the histograms of an operation of a table into a total.
+ *
+ * \param[in,out] total      Total
+ * \param[in]     table[]    Table
+ * \param[in]     operation  Operation
+ * \param[in]     descriptor Descriptor or NULL for all
+ */
+static void
+merge(
+    pb_stats_histogram_t *total, pb_stats_entry_t *table[],
+    pb_stats_operation_t operation, const pb_descriptor_t *descriptor) {
+  assert(total && table);
+  for (size_t e = 0; e < PB_STATS_DESCRIPTORS; e++) {
+    pb_stats_entry_t *entry = __atomic_load_n(&(table[e]), __ATOMIC_ACQUIRE);
+    if (entry && (!descriptor || entry->descriptor == descriptor))
+      add_histogram(total, &(entry->operation[operation]));
+  }
+}
+
+/*!
+ * Merge the field occurrences of a descriptor of a table into a total.
+ *
+ * \param[in,out] count[]    Occurrences by field position
+ * \param[in]     table[]    Table
+ * \param[in]     descriptor Descriptor
+ * \return                   Sampled messages
+ */
+static uint64_t
+merge_fields(
+    uint64_t count[], pb_stats_entry_t *table[],
+    const pb_descriptor_t *descriptor) {
+  assert(count && table && descriptor);
+  for (size_t e = 0; e < PB_STATS_DESCRIPTORS; e++) {
+    pb_stats_entry_t *entry = __atomic_load_n(&(table[e]), __ATOMIC_ACQUIRE);
+    if (entry && entry->descriptor == descriptor) {
+      for (size_t f = 0; f < pb_descriptor_size(descriptor); f++)
+        count[f] += __atomic_load_n(&(entry->field[f]), __ATOMIC_RELAXED);
+      return __atomic_load_n(&(entry->messages), __ATOMIC_RELAXED);
+    }
+  }
+  return 0;
+}
+
+/*!
+ * Free all histograms of a table.
+ *
+ * \param[in,out] table[] Table
+ */
+static void
+clear(pb_stats_entry_t *table[]) {
+  for (size_t e = 0; e < PB_STATS_DESCRIPTORS; e++) {
+    if (table[e]) {
+      pb_allocator_free(&allocator_default, table[e]);
+      __atomic_store_n(&(table[e]), NULL, __ATOMIC_RELAXED);
+    }
+  }
+}
+
+/*!
+ * Aggregate the counters of all exited and live threads.
+ *
+ * \warning The caller has to hold the lock of the registry.
+ *
+ * \return Counters
+ */
+static pb_stats_t
+aggregate(void) {
+  pb_stats_t total = registry.retired;
+  for (pb_stats_slot_t *s = registry.head; s; s = s->next)
+    add(&total, &(s->stats));
+  return total;
+}
+
+/*!
+ * Retire the thread-local slot into the registry on thread exit.
+ *
+ * \param[in,out] data Thread-local slot
+ */
+static void
+slot_destroy(void *data) {
+  pb_stats_slot_t *local = data;
+  pthread_mutex_lock(&(registry.lock));
+  add(&(registry.retired), &(local->stats));
+  for (pb_stats_slot_t **s = &(registry.head); *s; s = &((*s)->next)) {
+    if (*s == local) {
+      *s = local->next;
+      break;
+    }
+  }
+
+  /* Merge histograms, unless they were reset in the meantime */
+  for (size_t e = 0; e < PB_STATS_DESCRIPTORS; e++) {
+    pb_stats_entry_t *entry = local->entry[e], *target;
+    if (entry && local->epoch == registry.epoch &&
+        (target = lookup(registry.entry, entry->descriptor, 1))) {
+      for (size_t o = 0; o < PB_STATS_OPERATIONS; o++)
+        add_histogram(&(target->operation[o]), &(entry->operation[o]));
+      add_fields(target, entry);
+    }
+  }
+  pthread_mutex_unlock(&(registry.lock));
+  clear(local->entry);
+  local->stats      = (pb_stats_t){ 0 };
+  local->registered = 0;
+}
+
+/*!
+ * Create the key to retire thread-local slots on thread exit.
+ */
+static void
+slot_key_create(void) {
+  pthread_key_create(&key, slot_destroy);
+}
+
+/*!
+ * Retrieve the entry of a descriptor of the calling thread, creating it if
+ * necessary and discarding all entries of a previous epoch.
+ *
+ * \param[in] descriptor Descriptor
+ * \return               Entry or NULL
+ */
+static pb_stats_entry_t *
+slot_entry(const pb_descriptor_t *descriptor) {
+  pb_stats_local();
+
+  /* Discard histograms of previous epoch */
+  size_t epoch = __atomic_load_n(&(registry.epoch), __ATOMIC_ACQUIRE);
+  if (unlikely_(slot.epoch != epoch)) {
+    pthread_mutex_lock(&(registry.lock));
+    clear(slot.entry);
+    __atomic_store_n(&(slot.epoch), registry.epoch, __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&(registry.lock));
+  }
+  return lookup(slot.entry, descriptor, 1);
+}
+
+/* ----------------------------------------------------------------------------
+ * Interface
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Retrieve the counters aggregated over all threads since the last reset.
+ *
+ * Counters are only incremented if protobluff was built with statistics
+ * enabled, which is done by passing --enable-stats to configure. Otherwise,
+ * all counters remain zero, so there's no overhead on the hot paths.
+ *
+ * \return Counters
+ */
+extern pb_stats_t
+pb_stats_get(void) {
+  pthread_mutex_lock(&(registry.lock));
+  pb_stats_t total = aggregate();
+  size_t *target = (size_t *)&total, *base = (size_t *)&(registry.base);
+  for (size_t c = 0; c < sizeof(pb_stats_t) / sizeof(size_t); c++)
+    target[c] -= base[c];
+  pthread_mutex_unlock(&(registry.lock));
+  return total;
+}
+
+/*!
+ * Reset the counters and histograms of all threads.
+ *
+ * Counters are owned by their threads and never written by others, so the
+ * current totals are recorded as the base for all subsequent reads. Likewise,
+ * histograms are tagged with an epoch, which is advanced, so every thread
+ * discards its histograms when it takes the next sample.
+ */
+extern void
+pb_stats_reset(void) {
+  pthread_mutex_lock(&(registry.lock));
+  registry.base = aggregate();
+  __atomic_store_n(&(registry.epoch), registry.epoch + 1, __ATOMIC_RELEASE);
+  clear(registry.entry);
+  pthread_mutex_unlock(&(registry.lock));
+}
+
+/*!
+ * Retrieve the counters of the calling thread.
+ *
+ * The slot of the calling thread is registered upon first use, and retired
+ * upon thread exit, so its counters are retained in the aggregate.
+ *
+ * \return Counters
+ */
+extern pb_stats_t *
+pb_stats_local(void) {
+  if (unlikely_(!slot.registered)) {
+    pthread_once(&once, slot_key_create);
+    pthread_mutex_lock(&(registry.lock));
+    slot.next     = registry.head;
+    slot.epoch    = registry.epoch;
+    registry.head = &slot;
+    pthread_mutex_unlock(&(registry.lock));
+    pthread_setspecific(key, &slot);
+    slot.registered = 1;
+  }
+  return &(slot.stats);
+}
+
+/*!
+ * Set the sampling rate of latency histograms and field profiles.
+ *
+ * Only every n-th operation of each thread is timed, which bounds the cost of
+ * reading the clock, and only every n-th decoded message is profiled. A rate
+ * of zero, which is the default, disables sampling.
+ *
+ * \param[in] rate Sample every n-th operation
+ */
+extern void
+pb_stats_sampling(size_t rate) {
+  __atomic_store_n(&(registry.sampling), rate, __ATOMIC_RELAXED);
+}
+
+/*!
+ * Retrieve the latency histogram of an operation aggregated over all threads.
+ *
+ * Histograms are recorded per descriptor, of which a limited number is
+ * tracked per thread. If the descriptor is NULL, the histograms of all
+ * descriptors are merged.
+ *
+ * \param[in] operation  Operation
+ * \param[in] descriptor Descriptor or NULL for all
+ * \return               Histogram
+ */
+extern pb_stats_histogram_t
+pb_stats_histogram(
+    pb_stats_operation_t operation, const pb_descriptor_t *descriptor) {
+  assert(operation < PB_STATS_OPERATIONS);
+  pb_stats_histogram_t total = { 0 };
+  pthread_mutex_lock(&(registry.lock));
+
+  /* Merge histograms of exited threads and live threads of current epoch */
+  merge(&total, registry.entry, operation, descriptor);
+  for (pb_stats_slot_t *s = registry.head; s; s = s->next)
+    if (__atomic_load_n(&(s->epoch), __ATOMIC_ACQUIRE) == registry.epoch)
+      merge(&total, s->entry, operation, descriptor);
+  pthread_mutex_unlock(&(registry.lock));
+  return total;
+}
+
+/*!
+ * Retrieve the field occurrences of a descriptor aggregated over all threads.
+ *
+ * Fields are profiled for every n-th decoded message, as configured through
+ * pb_stats_sampling(), counting every occurrence of a field, so repeated
+ * fields may occur more often than messages were sampled. The array must be
+ * large enough to hold a counter for every field of the descriptor.
+ *
+ * \param[in]  descriptor Descriptor
+ * \param[out] count[]    Occurrences by field position
+ * \return                Sampled messages
+ */
+extern uint64_t
+pb_stats_fields(const pb_descriptor_t *descriptor, uint64_t count[]) {
+  assert(descriptor && count);
+  memset(count, 0, sizeof(uint64_t) * pb_descriptor_size(descriptor));
+  uint64_t messages = 0;
+  pthread_mutex_lock(&(registry.lock));
+
+  /* Merge occurrences of exited threads and live threads of current epoch */
+  messages += merge_fields(count, registry.entry, descriptor);
+  for (pb_stats_slot_t *s = registry.head; s; s = s->next)
+    if (__atomic_load_n(&(s->epoch), __ATOMIC_ACQUIRE) == registry.epoch)
+      messages += merge_fields(count, s->entry, descriptor);
+  pthread_mutex_unlock(&(registry.lock));
+  return messages;
+}
+
+/*!
+ * Retrieve a percentile of a latency histogram.
+ *
+ * The lower bound of the bucket that contains the percentile is returned, so
+ * the result underestimates the actual latency by at most 25%.
+ *
+ * \param[in] histogram  Histogram
+ * \param[in] percentile Percentile between 0 and 100
+ * \return               Latency in nanoseconds
+ */
+extern uint64_t
+pb_stats_percentile(
+    const pb_stats_histogram_t *histogram, double percentile) {
+  assert(histogram && percentile >= 0 && percentile <= 100);
+  uint64_t rank = (uint64_t)(histogram->count * percentile / 100), seen = 0;
+  for (size_t b = 0; b < PB_STATS_BUCKETS; b++)
+    if ((seen += histogram->bucket[b]) > rank ||
+        (seen && seen == histogram->count))
+      return pb_stats_bucket_value(b);
+  return 0;
+}
+
+/*!
+ * Start timing an operation, if it is sampled.
+ *
+ * \param[in] operation  Operation
+ * \param[in] descriptor Descriptor
+ * \return               Timer
+ */
+extern pb_stats_timer_t
+pb_stats_timer_start(
+    pb_stats_operation_t operation, const pb_descriptor_t *descriptor) {
+  pb_stats_timer_t timer = {
+    .operation  = operation,
+    .descriptor = descriptor
+  };
+  size_t rate = __atomic_load_n(&(registry.sampling), __ATOMIC_RELAXED);
+  if (unlikely_(rate && (!slot.countdown || !--slot.countdown))) {
+    slot.countdown = rate;
+    timer.start = now();
+  }
+  return timer;
+}
+
+/*!
+ * Stop timing an operation and record its latency, if it is sampled.
+ *
+ * \param[in,out] timer Timer
+ */
+extern void
+pb_stats_timer_stop(pb_stats_timer_t *timer) {
+  assert(timer);
+  if (likely_(!timer->start))
+    return;
+  uint64_t latency = now() - timer->start;
+
+  /* Record latency in histogram of descriptor */
+  pb_stats_entry_t *entry = slot_entry(timer->descriptor);
+  if (likely_(entry != NULL)) {
+    pb_stats_histogram_t *histogram = &(entry->operation[timer->operation]);
+    increment(&(histogram->count), 1);
+    increment(&(histogram->sum), latency);
+    increment(&(histogram->bucket[pb_stats_bucket(latency)]), 1);
+  }
+}
+
+/*!
+ * Start profiling the fields of a decoded message, if it is sampled.
+ *
+ * Only every n-th decoded message of each thread is profiled, as configured
+ * through pb_stats_sampling(). If the message is sampled, the occurrence
+ * counters of the fields of the descriptor are returned, which must only be
+ * incremented by the calling thread.
+ *
+ * \param[in] descriptor Descriptor
+ * \return               Occurrences by field position or NULL
+ */
+extern uint64_t *
+pb_stats_profile_start(const pb_descriptor_t *descriptor) {
+  assert(descriptor);
+  size_t rate = __atomic_load_n(&(registry.sampling), __ATOMIC_RELAXED);
+  if (likely_(!rate || (slot.profile && --slot.profile)))
+    return NULL;
+  slot.profile = rate;
+
+  /* Count sampled message and hand out counters */
+  pb_stats_entry_t *entry = slot_entry(descriptor);
+  if (unlikely_(!entry))
+    return NULL;                                           /* LCOV_EXCL_LINE */
+  increment(&(entry->messages), 1);
+  return entry->field;
+}
@@ -0,0 +1,160 @@
+/*
+ * Copyright (c) 2013-2020 Martin Donath <martin.donath@squidfunk.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef PB_CORE_STATS_H
+#define PB_CORE_STATS_H
+
+#include <protobluff/core/stats.h>
+
+#include "core/common.h"
+
+/* ----------------------------------------------------------------------------
+ * Type definitions
+ * ------------------------------------------------------------------------- */
+
+typedef struct pb_stats_timer_t {
+  uint64_t start;                      /*!< Start or zero, if not sampled */
+  pb_stats_operation_t operation;      /*!< Operation */
+  const struct pb_descriptor_t
+    *descriptor;                       /*!< Descriptor */
+} pb_stats_timer_t;
+
+/* ----------------------------------------------------------------------------
+ * Interface
+ * ------------------------------------------------------------------------- */
+
+extern pb_stats_timer_t
+pb_stats_timer_start(
+  pb_stats_operation_t operation,      /* Operation */
+  const struct pb_descriptor_t
+    *descriptor);                      /* Descriptor */
+
+extern void
+pb_stats_timer_stop(
+  pb_stats_timer_t *timer);            /* Timer */
+
+extern uint64_t *
+pb_stats_profile_start(
+  const struct pb_descriptor_t
+    *descriptor);                      /* Descriptor */
+
+/* ----------------------------------------------------------------------------
+ * Macros
+ * ------------------------------------------------------------------------- */
+
+#ifdef PB_STATS
+
+/*!
+ * Add a value to a counter of the calling thread.
+ *
+ * Counters are only written by the owning thread, so a relaxed load and store
+ * is sufficient and avoids a locked instruction, while readers on other
+ * threads are guaranteed to observe untorn values.
+ *
+ * \param[in] counter Counter
+ * \param[in] value   Value
+ */
+#define pb_stats_add(counter, value) \
+  do { \
+    size_t *counter_ = &(pb_stats_local()->counter); \
+    __atomic_store_n(counter_, \
+      __atomic_load_n(counter_, __ATOMIC_RELAXED) + (value), \
+      __ATOMIC_RELAXED); \
+  } while (0)
+
+/*!
+ * Measure the latency of an operation until the end of the enclosing scope.
+ *
+ * The timer is stopped through a cleanup handler, so that functions with
+ * multiple exit points don't need to be restructured. Only every n-th
+ * operation is timed, as configured through pb_stats_sampling().
+ *
+ * \param[in] operation  Operation
+ * \param[in] descriptor Descriptor
+ */
+#define pb_stats_measure(operation, descriptor) \
+  pb_stats_timer_t pb_stats_timer_ \
+    __attribute__((cleanup(pb_stats_timer_stop))) = \
+      pb_stats_timer_start((operation), (descriptor))
+
+/*!
+ * Profile the fields of a decoded message until the end of the enclosing
+ * scope, if it is sampled, as configured through pb_stats_sampling().
+ *
+ * \param[in] descriptor Descriptor
+ */
+#define pb_stats_profile(descriptor) \
+  uint64_t *pb_stats_profile_ = pb_stats_profile_start(descriptor)
+
+/*!
+ * Count an occurrence of a field of the profiled message, if any.
+ *
+ * \param[in] pos Field position
+ */
+#define pb_stats_profile_field(pos) \
+  do { \
+    if (unlikely_(pb_stats_profile_ != NULL)) { \
+      uint64_t *count_ = &(pb_stats_profile_[pos]); \
+      __atomic_store_n(count_, \
+        __atomic_load_n(count_, __ATOMIC_RELAXED) + 1, __ATOMIC_RELAXED); \
+    } \
+  } while (0)
+
+#else
+
+/*!
+ * Ignore counters if statistics are not enabled.
+ *
+ * \param[in] counter Counter
+ * \param[in] value   Value
+ */
+#define pb_stats_add(counter, value) \
+  ((void)0)
+
+/*!
+ * Ignore latencies if statistics are not enabled.
+ *
+ * \param[in] operation  Operation
+ * \param[in] descriptor Descriptor
+ */
+#define pb_stats_measure(operation, descriptor) \
+  ((void)0)
+
+/*!
+ * Ignore field profiles if statistics are not enabled.
+ *
+ * \param[in] descriptor Descriptor
+ */
+#define pb_stats_profile(descriptor) \
+  ((void)0)
+
+/*!
+ * Ignore field occurrences if statistics are not enabled.
+ *
+ * \param[in] pos Field position
+ */
+#define pb_stats_profile_field(pos) \
+  ((void)0)
+
+#endif /* PB_STATS */
+
+#endif /* PB_CORE_STATS_H */
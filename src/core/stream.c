@@ -27,6 +27,7 @@
 
 #include "core/buffer.h"
 #include "core/common.h"
+#include "core/endian.h"
 #include "core/stream.h"
 #include "core/varint.h"
 
@@ -66,8 +67,8 @@ read_64bit(pb_stream_t *stream, pb_type_t type, void *value) {
   assert(stream && value);
   if (unlikely_(pb_stream_advance(stream, 8)))
     return PB_ERROR_OFFSET;
-  memcpy(value, pb_buffer_data_from(
-    stream->buffer, stream->offset - 8), 8);
+  pb_endian_copy(value, pb_buffer_data_from(
+    stream->buffer, stream->offset - 8), 1, 8);
   return PB_ERROR_NONE;
 }
 
@@ -108,8 +109,94 @@ read_32bit(pb_stream_t *stream, pb_type_t type, void *value) {
   assert(stream && value);
   if (unlikely_(pb_stream_advance(stream, 4)))
     return PB_ERROR_OFFSET;
-  memcpy(value, pb_buffer_data_from(
-    stream->buffer, stream->offset - 4), 4);
+  pb_endian_copy(value, pb_buffer_data_from(
+    stream->buffer, stream->offset - 4), 1, 4);
+  return PB_ERROR_NONE;
+}
+
+/* ----------------------------------------------------------------------------
+ * Unchecked stream read callbacks
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Read a variable-sized integer without bounds checks.
+ *
+ * \param[in,out] stream Stream
+ * \param[in]     type   Type
+ * \param[out]    value  Pointer receiving value
+ * \return               Error code
+ */
+static pb_error_t
+read_varint_unchecked(pb_stream_t *stream, pb_type_t type, void *value) {
+  assert(stream && value);
+  assert(pb_stream_left(stream) >= PB_STREAM_SLOP);
+  size_t size = pb_varint_unpack(type,
+    pb_buffer_data_from(stream->buffer, stream->offset),
+    PB_STREAM_SLOP, value);
+  if (unlikely_(!size))
+    return PB_ERROR_VARINT;
+  stream->offset += size;
+  return PB_ERROR_NONE;
+}
+
+/*!
+ * Read a fixed-sized 64-bit value without bounds checks.
+ *
+ * \param[in,out] stream Stream
+ * \param[in]     type   Type
+ * \param[out]    value  Pointer receiving value
+ * \return               Error code
+ */
+static pb_error_t
+read_64bit_unchecked(pb_stream_t *stream, pb_type_t type, void *value) {
+  assert(stream && value);
+  assert(pb_stream_left(stream) >= PB_STREAM_SLOP);
+  pb_endian_copy(value,
+    pb_buffer_data_from(stream->buffer, stream->offset), 1, 8);
+  stream->offset += 8;
+  return PB_ERROR_NONE;
+}
+
+/*!
+ * Read a length-prefixed value, checking only the bounds of the payload.
+ *
+ * \param[in,out] stream Stream
+ * \param[in]     type   Type
+ * \param[out]    value  Pointer receiving value
+ * \return               Error code
+ */
+static pb_error_t
+read_length_unchecked(pb_stream_t *stream, pb_type_t type, void *value) {
+  assert(stream && value);
+  assert(pb_stream_left(stream) >= PB_STREAM_SLOP);
+  uint32_t length = 0;
+  size_t size = pb_varint_unpack_uint32(
+    pb_buffer_data_from(stream->buffer, stream->offset),
+    PB_STREAM_SLOP, &length);
+  if (likely_(size != 0)) {
+    *(pb_string_t *)value = pb_string_init(
+      pb_buffer_data_from(stream->buffer,
+        stream->offset + size), length);
+    return pb_stream_advance(stream, size + length);
+  }
+  return PB_ERROR_VARINT;
+}
+
+/*!
+ * Read a fixed-sized 32-bit value without bounds checks.
+ *
+ * \param[in,out] stream Stream
+ * \param[in]     type   Type
+ * \param[out]    value  Pointer receiving value
+ * \return               Error code
+ */
+static pb_error_t
+read_32bit_unchecked(pb_stream_t *stream, pb_type_t type, void *value) {
+  assert(stream && value);
+  assert(pb_stream_left(stream) >= PB_STREAM_SLOP);
+  pb_endian_copy(value,
+    pb_buffer_data_from(stream->buffer, stream->offset), 1, 4);
+  stream->offset += 4;
   return PB_ERROR_NONE;
 }
 
@@ -202,6 +289,28 @@ pb_stream_read_jump[] = {
   [PB_TYPE_MESSAGE]  = read_length
 };
 
+/*! Jump table: type ==> unchecked read method */
+const pb_stream_read_f
+pb_stream_read_unchecked_jump[] = {
+  [PB_TYPE_INT32]    = read_varint_unchecked,
+  [PB_TYPE_INT64]    = read_varint_unchecked,
+  [PB_TYPE_UINT32]   = read_varint_unchecked,
+  [PB_TYPE_UINT64]   = read_varint_unchecked,
+  [PB_TYPE_SINT32]   = read_varint_unchecked,
+  [PB_TYPE_SINT64]   = read_varint_unchecked,
+  [PB_TYPE_FIXED32]  = read_32bit_unchecked,
+  [PB_TYPE_FIXED64]  = read_64bit_unchecked,
+  [PB_TYPE_SFIXED32] = read_32bit_unchecked,
+  [PB_TYPE_SFIXED64] = read_64bit_unchecked,
+  [PB_TYPE_BOOL]     = read_varint_unchecked,
+  [PB_TYPE_ENUM]     = read_varint_unchecked,
+  [PB_TYPE_FLOAT]    = read_32bit_unchecked,
+  [PB_TYPE_DOUBLE]   = read_64bit_unchecked,
+  [PB_TYPE_STRING]   = read_length_unchecked,
+  [PB_TYPE_BYTES]    = read_length_unchecked,
+  [PB_TYPE_MESSAGE]  = read_length_unchecked
+};
+
 /*! Jump table: wiretype ==> skip method */
 const pb_stream_skip_f
 pb_stream_skip_jump[7] = {
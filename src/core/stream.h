@@ -24,21 +24,29 @@
 #define PB_CORE_STREAM_H
 
 #include <assert.h>
+#include <stdint.h>
 #include <stdlib.h>
 
+#include <protobluff/core/stream.h>
+
 #include "core/buffer.h"
 #include "core/common.h"
 
 /* ----------------------------------------------------------------------------
- * Type definitions
+ * Constants
  * ------------------------------------------------------------------------- */
 
-typedef struct pb_stream_t {
-  const pb_buffer_t *const buffer;     /*!< Buffer */
-  size_t offset;                       /*!< Current offset */
-} pb_stream_t;
+/*! Bytes that must be left for reads to skip bounds checks (max. varint) */
+#define PB_STREAM_SLOP 10
 
-/* ------------------------------------------------------------------------- */
+/*! Bytes past the next field to prefetch after a length-prefixed field */
+#ifndef PB_STREAM_PREFETCH_DISTANCE
+#define PB_STREAM_PREFETCH_DISTANCE 0
+#endif /* PB_STREAM_PREFETCH_DISTANCE */
+
+/* ----------------------------------------------------------------------------
+ * Type definitions
+ * ------------------------------------------------------------------------- */
 
 typedef pb_error_t
 (*pb_stream_read_f)(
@@ -67,6 +75,10 @@ pb_stream_advance(
 extern const pb_stream_read_f
 pb_stream_read_jump[];
 
+/*! Jump table: type ==> unchecked read method */
+extern const pb_stream_read_f
+pb_stream_read_unchecked_jump[];
+
 /*! Jump table: wiretype ==> skip method */
 extern const pb_stream_skip_f
 pb_stream_skip_jump[];
@@ -75,27 +87,6 @@ pb_stream_skip_jump[];
  * Inline functions
  * ------------------------------------------------------------------------- */
 
-/*!
- * Create a stream over a buffer.
- *
- * \warning A stream does not take ownership of the provided buffer, so the
- * caller must ensure that the buffer is not freed during operations.
- *
- * \param[in] buffer Buffer
- * \return           Stream
- */
-PB_INLINE PB_WARN_UNUSED_RESULT
-pb_stream_t
-pb_stream_create(const pb_buffer_t *buffer) {
-  assert(buffer);
-  assert(pb_buffer_valid(buffer));
-  pb_stream_t stream = {
-    .buffer = buffer,
-    .offset = 0
-  };
-  return stream;
-}
-
 /*!
  * Create a stream over a buffer at a given offset.
  *
@@ -116,16 +107,6 @@ pb_stream_create_at(const pb_buffer_t *buffer, size_t offset) {
   return stream;
 }
 
-/*!
- * Destroy a stream.
- *
- * \param[in,out] stream Stream
- */
-PB_INLINE void
-pb_stream_destroy(pb_stream_t *stream) {
-  assert(stream); /* Nothing to be done */
-}
-
 /*!
  * Retrieve the buffer of a stream.
  *
@@ -138,30 +119,6 @@ pb_stream_buffer(const pb_stream_t *stream) {
   return stream->buffer;
 }
 
-/*!
- * Retrieve the current offset of a stream.
- *
- * \param[in] stream Stream
- * \return           Current offset
- */
-PB_INLINE size_t
-pb_stream_offset(const pb_stream_t *stream) {
-  assert(stream);
-  return stream->offset;
-}
-
-/*!
- * Retrieve the number of bytes left in a stream.
- *
- * \param[in] stream Stream
- * \return           Bytes left
- */
-PB_INLINE size_t
-pb_stream_left(const pb_stream_t *stream) {
-  assert(stream);
-  return pb_buffer_size(stream->buffer) - stream->offset;
-}
-
 /*!
  * Retrieve the size of a stream.
  *
@@ -189,6 +146,12 @@ pb_stream_empty(const pb_stream_t *stream) {
 /*!
  * Read a value of given type.
  *
+ * As long as at least PB_STREAM_SLOP bytes are left, neither varints nor
+ * fixed-sized values can run past the end of the buffer, so the per-byte
+ * bounds checks are skipped. Single-byte unsigned 32-bit integers, which
+ * include most tags and length prefixes, are decoded inline. Only near the
+ * end of the buffer the checked read methods are used.
+ *
  * \param[in,out] stream Stream
  * \param[in]     type   Type
  * \param[out]    value  Pointer receiving value
@@ -198,9 +161,38 @@ PB_INLINE PB_WARN_UNUSED_RESULT
 pb_error_t
 pb_stream_read(pb_stream_t *stream, pb_type_t type, void *value) {
   assert(pb_stream_read_jump[type]);
+  if (likely_(pb_stream_left(stream) >= PB_STREAM_SLOP)) {
+    const uint8_t *data =
+      pb_buffer_data_from(stream->buffer, stream->offset);
+    if (type == PB_TYPE_UINT32 && !(data[0] & 0x80)) {
+      *(uint32_t *)value = data[0];
+      stream->offset++;
+      return PB_ERROR_NONE;
+    }
+    return pb_stream_read_unchecked_jump[type](stream, type, value);
+  }
   return pb_stream_read_jump[type](stream, type, value);
 }
 
+/*!
+ * Prefetch the data at a given distance from the offset of a stream.
+ *
+ * Once the length prefix of a field was read, the offset of the next field is
+ * known, which may lie far ahead in cold memory. Issuing a hint lets the load
+ * overlap with the processing of the current field. The distance is given in
+ * bytes past the offset and can be tuned with PB_STREAM_PREFETCH_DISTANCE.
+ *
+ * \param[in] stream Stream
+ * \param[in] offset Offset relative to the current offset
+ */
+PB_INLINE void
+pb_stream_prefetch(const pb_stream_t *stream, size_t offset) {
+  assert(stream);
+  offset += stream->offset + PB_STREAM_PREFETCH_DISTANCE;
+  if (likely_(offset < pb_stream_size(stream)))
+    prefetch_(pb_buffer_data_from(stream->buffer, offset));
+}
+
 /*!
  * Skip a value of given wiretype.
  *
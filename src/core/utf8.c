@@ -0,0 +1,103 @@
+/*
+ * Copyright (c) 2013-2020 Martin Donath <martin.donath@squidfunk.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "core/common.h"
+#include "core/utf8.h"
+
+/* ----------------------------------------------------------------------------
+ * Constants
+ * ------------------------------------------------------------------------- */
+
+/*! Mask of the high bits of all bytes in a word */
+#define PB_UTF8_HIGH 0x8080808080808080ULL
+
+/* ----------------------------------------------------------------------------
+ * Interface
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Check whether a sequence of bytes is valid UTF-8.
+ *
+ * Runs of ASCII characters, which make up the majority of most strings, are
+ * checked eight bytes at a time by testing the high bits of a whole word at
+ * once. All other characters are checked strictly according to table 3-7 of
+ * the Unicode standard, so overlong encodings, surrogates and code points
+ * beyond U+10FFFF are rejected.
+ *
+ * \param[in] data Source buffer
+ * \param[in] size Bytes to be checked
+ * \return         Test result
+ */
+extern int
+pb_utf8_valid(const uint8_t data[], size_t size) {
+  assert(data || !size);
+  size_t pos = 0;
+  while (pos < size) {
+
+    /* Skip runs of ASCII characters word by word */
+    if (data[pos] < 0x80) {
+      uint64_t word;
+      while (pos + sizeof(word) <= size) {
+        memcpy(&word, &(data[pos]), sizeof(word));
+        if (word & PB_UTF8_HIGH)
+          break;
+        pos += sizeof(word);
+      }
+      while (pos < size && data[pos] < 0x80)
+        pos++;
+      continue;
+    }
+
+    /* Determine length and range of second byte from leading byte */
+    uint8_t byte = data[pos], lo = 0x80, hi = 0xBF;
+    size_t length;
+    if (byte >= 0xC2 && byte <= 0xDF) {
+      length = 2;
+    } else if (byte >= 0xE0 && byte <= 0xEF) {
+      length = 3;
+      lo = byte == 0xE0 ? 0xA0 : lo;
+      hi = byte == 0xED ? 0x9F : hi;
+    } else if (byte >= 0xF0 && byte <= 0xF4) {
+      length = 4;
+      lo = byte == 0xF0 ? 0x90 : lo;
+      hi = byte == 0xF4 ? 0x8F : hi;
+    } else {
+      return 0;
+    }
+
+    /* Check continuation bytes */
+    if (unlikely_(size - pos < length))
+      return 0;
+    if (data[pos + 1] < lo || data[pos + 1] > hi)
+      return 0;
+    for (size_t b = 2; b < length; b++)
+      if ((data[pos + b] & 0xC0) != 0x80)
+        return 0;
+    pos += length;
+  }
+  return 1;
+}
@@ -23,11 +23,16 @@
 #include <assert.h>
 #include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 
 #ifdef __SSE2__
 #include <emmintrin.h>
 #endif /* __SSE2__ */
 
+#ifdef __BMI2__
+#include <immintrin.h>
+#endif /* __BMI2__ */
+
 #include "core/common.h"
 #include "core/varint.h"
 
@@ -144,6 +149,189 @@ size_map[] = {
   9, 9, 9, 9, 9, 9, 9, 10
 };
 
+/* ----------------------------------------------------------------------------
+ * Internal functions
+ * ------------------------------------------------------------------------- */
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+
+/*!
+ * Unpack a variable-sized integer of up to 8 bytes with a single 64-bit load.
+ *
+ * The first clear high-bit marks the last byte of the integer, so the length
+ * can be determined by counting the trailing zeroes of the inverted high-bits.
+ * All bytes following the integer are masked out, and the remaining 7-bit
+ * groups are compacted into place, either through a single parallel bit
+ * extract if the compiler targets BMI2, or through three shift-and-mask steps
+ * that merge adjacent groups of 7, 14 and 28 bits. The function is branchless
+ * except for the check whether the integer fits into the loaded word.
+ *
+ * \warning The caller has to ensure that at least 8 bytes can be read from the
+ * buffer. Integers longer than 8 bytes are not handled and must be unpacked
+ * using the byte-wise versions, in which case zero is returned.
+ *
+ * \param[in]  data[] Source buffer
+ * \param[out] value  Value
+ * \return            Bytes read
+ */
+PB_INLINE size_t
+unpack_word(const uint8_t data[], uint64_t *value) {
+  assert(data && value);
+  uint64_t word; memcpy(&word, data, sizeof(word));
+
+  /* Determine the position of the first byte with a clear high-bit */
+  uint64_t stop = ~word & 0x8080808080808080ULL;
+  if (unlikely_(!stop))
+    return 0;
+
+  /* Mask out all bytes following the integer and compact 7-bit groups */
+  word &= (stop ^ (stop - 1));
+
+#ifdef __BMI2__
+
+  *value = _pext_u64(word, 0x7F7F7F7F7F7F7F7FULL);
+
+#else
+
+  word &= 0x7F7F7F7F7F7F7F7FULL;
+  word  = ((word & 0x7F007F007F007F00ULL) >> 1)
+        |  (word & 0x007F007F007F007FULL);
+  word  = ((word & 0x3FFF00003FFF0000ULL) >> 2)
+        |  (word & 0x00003FFF00003FFFULL);
+  word  = ((word & 0x0FFFFFFF00000000ULL) >> 4)
+        |  (word & 0x000000000FFFFFFFULL);
+  *value = word;
+
+#endif /* __BMI2__ */
+
+  return (__builtin_ctzll(stop) >> 3) + 1;
+}
+
+/*!
+ * Scan a variable-sized integer of up to 8 bytes with a single 64-bit load.
+ *
+ * \warning The caller has to ensure that at least 8 bytes can be read from the
+ * buffer. Integers longer than 8 bytes are not handled, in which case zero is
+ * returned and the remaining bytes must be scanned byte-wise.
+ *
+ * \param[in] data[] Source buffer
+ * \return           Bytes of integer
+ */
+PB_INLINE size_t
+scan_word(const uint8_t data[]) {
+  assert(data);
+  uint64_t word; memcpy(&word, data, sizeof(word));
+  uint64_t stop = ~word & 0x8080808080808080ULL;
+  return likely_(stop != 0)
+    ? (__builtin_ctzll(stop) >> 3) + 1
+    : 0;
+}
+
+#endif /* __BYTE_ORDER__ */
+
+/*!
+ * Retrieve the packed size of a variable-sized integer without branches.
+ *
+ * The index of the most-significant bit is scaled by 9/64, which matches the
+ * division by 7 for all widths up to 64 bits, so no lookup is necessary and
+ * compilers can vectorize it over arrays, e.g. with lzcnt on AVX-512.
+ *
+ * \param[in] value Value
+ * \return          Packed size
+ */
+PB_INLINE size_t
+size_word(uint64_t value) {
+  return ((63 - __builtin_clzll(value | 1)) * 9 + 73) >> 6;
+}
+
+/*!
+ * Retrieve a value of an array as it is encoded on the wire.
+ *
+ * Negative 32-bit integers are sign-extended to 64 bits and signed integers
+ * are transformed to zig-zag encoding, so all values can be packed alike.
+ *
+ * \param[in] type   Type
+ * \param[in] values Pointer holding values
+ * \param[in] v      Value index
+ * \return           Wire value
+ */
+PB_INLINE uint64_t
+value_at(pb_type_t type, const void *values, size_t v) {
+  assert(values);
+  switch (type) {
+    case PB_TYPE_INT32:
+    case PB_TYPE_ENUM:
+      return (uint64_t)(int64_t)((const int32_t *)values)[v];
+    case PB_TYPE_UINT32:
+      return ((const uint32_t *)values)[v];
+    case PB_TYPE_SINT32: {
+      int32_t temp = ((const int32_t *)values)[v];
+      return ((uint32_t)temp << 1) ^ (uint32_t)(temp >> 31);
+    }
+    case PB_TYPE_SINT64: {
+      int64_t temp = ((const int64_t *)values)[v];
+      return ((uint64_t)temp << 1) ^ (uint64_t)(temp >> 63);
+    }
+    case PB_TYPE_BOOL:
+      return ((const uint8_t *)values)[v];
+    default:
+      return ((const uint64_t *)values)[v];
+  }
+}
+
+/*!
+ * Pack a wire value, storing up to 8 bytes with a single 64-bit write.
+ *
+ * This is the inverse of unpack_word(): the 7-bit groups of the value are
+ * spread to bytes, either through a single parallel bit deposit if the
+ * compiler targets BMI2, or through three shift-and-mask steps, and the
+ * continuation bits of all but the last byte are set at once. Longer values
+ * and values close to the end of the buffer are packed byte-wise.
+ *
+ * \warning The caller has to ensure that the buffer holds all remaining values
+ * of the array, so at least 8 bytes can be written if 8 values are left.
+ *
+ * \param[out] data[] Target buffer
+ * \param[in]  value  Wire value
+ * \param[in]  left   Remaining values, including this one
+ * \return            Packed size
+ */
+PB_INLINE size_t
+pack_value(uint8_t data[], uint64_t value, size_t left) {
+  assert(data && left);
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+
+  size_t size = size_word(value);
+  if (likely_(size <= 8 && left >= 8)) {
+
+#ifdef __BMI2__
+
+    uint64_t word = _pdep_u64(value, 0x7F7F7F7F7F7F7F7FULL);
+
+#else
+
+    uint64_t word;
+    word = ((value & 0x00FFFFFFF0000000ULL) << 4)
+         |  (value & 0x000000000FFFFFFFULL);
+    word = ((word  & 0x0FFFC0000FFFC000ULL) << 2)
+         |  (word  & 0x00003FFF00003FFFULL);
+    word = ((word  & 0x3F803F803F803F80ULL) << 1)
+         |  (word  & 0x007F007F007F007FULL);
+
+#endif /* __BMI2__ */
+
+    /* Set continuation bits of all but the last byte */
+    word |= 0x8080808080808080ULL & ((1ULL << ((size - 1) << 3)) - 1);
+    memcpy(data, &word, sizeof(word));
+    return size;
+  }
+
+#endif /* __BYTE_ORDER__ */
+
+  return pb_varint_pack_uint64(data, &value);
+}
+
 /* ----------------------------------------------------------------------------
  * Interface
  * ------------------------------------------------------------------------- */
@@ -452,27 +640,157 @@ pb_varint_pack_sint64(uint8_t data[], const void *value) {
 
 /* ------------------------------------------------------------------------- */
 
+/*!
+ * Retrieve the packed size of an array of variable-sized integers.
+ *
+ * This is equivalent to summing up the sizes of all values, but avoids the
+ * indirect call per value. If the compiler supports SSE2, the sizes of four
+ * 32-bit values are determined at once by comparing them against the bounds
+ * of all packed sizes. All other values are sized without branches through
+ * counting leading zeroes, including the zig-zag transform of signed types.
+ *
+ * \param[in] type   Type
+ * \param[in] values Pointer holding values
+ * \param[in] size   Value count
+ * \return           Packed size
+ */
+extern size_t
+pb_varint_size_all(pb_type_t type, const void *values, size_t size) {
+  assert(pb_varint_size_jump[type] && (values || !size));
+  size_t total = size, v = 0;
+
+#ifdef __SSE2__
+
+  /* Compare four 32-bit values at once, with bias for unsigned comparison */
+  if (type == PB_TYPE_INT32  || type == PB_TYPE_UINT32 ||
+      type == PB_TYPE_SINT32 || type == PB_TYPE_ENUM) {
+    const __m128i bias = _mm_set1_epi32(INT32_MIN),
+                  five = _mm_set1_epi32(5),
+                  b1   = _mm_xor_si128(_mm_set1_epi32(0x0000007F), bias),
+                  b2   = _mm_xor_si128(_mm_set1_epi32(0x00003FFF), bias),
+                  b3   = _mm_xor_si128(_mm_set1_epi32(0x001FFFFF), bias),
+                  b4   = _mm_xor_si128(_mm_set1_epi32(0x0FFFFFFF), bias);
+    const uint32_t *data = values;
+    while (size - v >= 4) {
+
+      /* Limit blocks, so the counts of the lanes cannot overflow */
+      size_t block = (size - v) / 4;
+      if (block > (size_t)1 << 24)
+        block = (size_t)1 << 24;
+      __m128i count = _mm_setzero_si128();
+      for (size_t b = 0; b < block; b++, v += 4) {
+        __m128i x = _mm_loadu_si128((const __m128i *)&(data[v]));
+        if (type == PB_TYPE_SINT32)
+          x = _mm_xor_si128(_mm_slli_epi32(x, 1), _mm_srai_epi32(x, 31));
+        __m128i y = _mm_xor_si128(x, bias);
+        count = _mm_sub_epi32(count, _mm_cmpgt_epi32(y, b1));
+        count = _mm_sub_epi32(count, _mm_cmpgt_epi32(y, b2));
+        count = _mm_sub_epi32(count, _mm_cmpgt_epi32(y, b3));
+        count = _mm_sub_epi32(count, _mm_cmpgt_epi32(y, b4));
+
+        /* Negative 32-bit integers are sign-extended to ten bytes */
+        if (type != PB_TYPE_SINT32 && type != PB_TYPE_UINT32)
+          count = _mm_add_epi32(count,
+            _mm_and_si128(_mm_srai_epi32(x, 31), five));
+      }
+
+      /* Sum up counts of all lanes */
+      uint32_t lanes[4];
+      _mm_storeu_si128((__m128i *)lanes, count);
+      total += (size_t)lanes[0] + lanes[1] + lanes[2] + lanes[3];
+    }
+  }
+
+#endif /* __SSE2__ */
+
+  /* Size remaining values */
+  for (; v < size; v++)
+    total += size_word(value_at(type, values, v)) - 1;
+  return total;
+}
+
+/*!
+ * Pack an array of variable-sized integers.
+ *
+ * This is equivalent to packing all values one after another, but avoids the
+ * indirect call per value and stores every value of up to 8 bytes with a
+ * single write. If the compiler supports SSE2, blocks of eight 32-bit values
+ * that all fit into a single byte, which is common for small deltas and
+ * enums, are narrowed and stored at once.
+ *
+ * \warning The caller has to ensure that the buffer is appropriately sized,
+ * which can be done through pb_varint_size_all().
+ *
+ * \param[in]  type   Type
+ * \param[out] data[] Target buffer
+ * \param[in]  values Pointer holding values
+ * \param[in]  size   Value count
+ * \return            Packed size
+ */
+extern size_t
+pb_varint_pack_all(
+    pb_type_t type, uint8_t data[], const void *values, size_t size) {
+  assert(pb_varint_pack_jump[type] && data && (values || !size));
+  uint8_t *temp = data;
+  size_t v = 0;
+
+#ifdef __SSE2__
+
+  /* Narrow eight single-byte 32-bit values at once */
+  if (type == PB_TYPE_INT32  || type == PB_TYPE_UINT32 ||
+      type == PB_TYPE_SINT32 || type == PB_TYPE_ENUM) {
+    const __m128i high = _mm_set1_epi32(~0x7F),
+                  zero = _mm_setzero_si128();
+    const uint32_t *source = values;
+    for (; size - v >= 8; v += 8) {
+      __m128i x = _mm_loadu_si128((const __m128i *)&(source[v])),
+              y = _mm_loadu_si128((const __m128i *)&(source[v + 4]));
+      if (type == PB_TYPE_SINT32) {
+        x = _mm_xor_si128(_mm_slli_epi32(x, 1), _mm_srai_epi32(x, 31));
+        y = _mm_xor_si128(_mm_slli_epi32(y, 1), _mm_srai_epi32(y, 31));
+      }
+      __m128i mask = _mm_cmpeq_epi32(
+        _mm_and_si128(_mm_or_si128(x, y), high), zero);
+      if (likely_(_mm_movemask_epi8(mask) == 0xFFFF)) {
+        _mm_storel_epi64((__m128i *)temp,
+          _mm_packus_epi16(_mm_packs_epi32(x, y), zero));
+        temp += 8;
+
+      /* Otherwise pack values one by one */
+      } else {
+        for (size_t b = 0; b < 8; b++)
+          temp += pack_value(temp,
+            value_at(type, values, v + b), size - v - b);
+      }
+    }
+  }
+
+#endif /* __SSE2__ */
+
+  /* Pack remaining values */
+  for (; v < size; v++)
+    temp += pack_value(temp, value_at(type, values, v), size - v);
+  return temp - data;
+}
+
+/* ------------------------------------------------------------------------- */
+
 /*!
  * Scan a buffer for a valid variable-sized integer.
  *
  * This function checks if an underrun might happen reading a variable-sized
  * integer from a buffer. Only underruns can be checked using this method,
  * overflows may still happen, but are properly reported by the unpack
- * functions. SSE2 intrinsics are used if the compiler supports it.
- *
- * The SSE2 version works in constant time and independent of input length.
+ * functions.
  *
- * \warning The SSE2 version is implemented for up to 10 bytes of length, so if
- * an encoded integer with more than 10 high-bits is encountered, an underrun
- * is falsely reported. This could be omitted by introducing a further branch
- * checking if the buffer is larger than 10 bytes and falling back to the
- * non-SSE version, but as it's an entirely internal case that is properly
- * handled by all invoking functions there is no necessity.
- *
- * \warning Using valgrind for tracking down invalid memory accesses, memcheck
- * will complain when it sees loads on data that extend to uninitialized memory
- * regions. This, however, is a false-positive, as uninitialized values are
- * singled out using the mapped bitmask.
+ * Instead of inspecting the continuation bit of every byte, the terminating
+ * byte is found with a single load: if at least 16 bytes are left and the
+ * compiler supports SSE2, the high-bits of all bytes are extracted with a
+ * movemask, otherwise, if at least 8 bytes are left on little-endian hosts,
+ * the inverted high-bits of a 64-bit word are used. In both cases, counting
+ * the trailing zeroes yields the position of the terminating byte. Only the
+ * tail of a buffer and integers longer than 8 bytes without SSE2 are scanned
+ * byte-wise. No bytes beyond the given number of bytes are ever read.
  *
  * \param[in] data[] Source buffer
  * \param[in] left   Remaining bytes
@@ -481,39 +799,37 @@ pb_varint_pack_sint64(uint8_t data[], const void *value) {
 extern size_t
 pb_varint_scan(const uint8_t data[], size_t left) {
   assert(data && left);
-  left = left > 10 ? 10 : left;
 
 #ifdef __SSE2__
 
-  /* Mapping: remaining bytes ==> bitmask */
-  static const int mask_map[] = {
-    0x0000, 0x0001, 0x0003, 0x0007,
-    0x000F, 0x001F, 0x003F, 0x007F,
-    0x00FF, 0x01FF, 0x03FF
-  };
-
-  /* Load buffer into 128-bit integer and create high-bit mask */
-  __m128i temp = _mm_loadu_si128((const __m128i *)data);
-  __m128i high = _mm_set1_epi8(0x80);
+  /* Fast path: scan up to 10 bytes with a single 128-bit load */
+  if (likely_(left >= 16)) {
+    __m128i temp = _mm_loadu_si128((const __m128i *)data);
+    int mask = ~_mm_movemask_epi8(temp) & 0x03FF;
+    return mask ? __builtin_ctz(mask) + 1 : 0;
+  }
 
-  /* Intersect and extract mask with high-bits set */
-  int mask = _mm_movemask_epi8(_mm_and_si128(temp, high));
-  mask = (mask & mask_map[left]) ^ mask_map[left];
+#endif /* __SSE2__ */
 
-  /* Count trailing zeroes */
-  return mask ? __builtin_ctz(mask) + 1 : 0;
+  left = left > 10 ? 10 : left;
+  size_t size = 0;
 
-#else
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
 
-  /* Linear scan */
-  size_t size = 0;
-  while (data[size++] & 0x80)
-    if (!--left)
-      return 0;
-  return size;
+  /* Fast path: scan up to 8 bytes with a single 64-bit load */
+  if (likely_(left >= 8)) {
+    if (likely_((size = scan_word(data)) != 0))
+      return size;
+    size = 8;
+  }
 
-#endif /* __SSE2__ */
+#endif /* __BYTE_ORDER__ */
 
+  /* Slow path: scan byte-wise */
+  while (size < left)
+    if (!(data[size++] & 0x80))
+      return size;
+  return 0;
 }
 
 /* ------------------------------------------------------------------------- */
@@ -582,6 +898,10 @@ pb_varint_unpack_uint8(const uint8_t data[], size_t left, void *value) {
 /*!
  * Unpack an unsigned 32-bit variable-sized integer.
  *
+ * If at least 8 bytes are remaining, the integer is unpacked word-at-a-time
+ * on little-endian platforms, falling back to the byte-wise version for
+ * overlong or invalid integers, so the result is identical in all cases.
+ *
  * \warning The caller has to ensure that the buffer may not underrun and the
  * space pointed to by the value pointer is appropriately sized.
  *
@@ -593,6 +913,21 @@ pb_varint_unpack_uint8(const uint8_t data[], size_t left, void *value) {
 extern size_t
 pb_varint_unpack_uint32(const uint8_t data[], size_t left, void *value) {
   assert(data && left && value);
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+
+  /* Fast path: unpack integers of up to 5 bytes with a single load */
+  if (likely_(left >= 8)) {
+    uint64_t word; size_t size = unpack_word(data, &word);
+    if (likely_(size && size <= 5)) {
+      *(uint32_t *)value = (uint32_t)word;
+      return size;
+    }
+  }
+
+#endif /* __BYTE_ORDER__ */
+
+  /* Slow path: unpack byte-wise */
   size_t size = 0; uint32_t temp = (uint32_t)(data[size] & 0x7F);
   if (data[size++] & 0x80 && --left) {
     temp |= (uint32_t)(data[size] & 0x7F) << 7;
@@ -613,6 +948,10 @@ pb_varint_unpack_uint32(const uint8_t data[], size_t left, void *value) {
 /*!
  * Unpack an unsigned 64-bit variable-sized integer.
  *
+ * If at least 8 bytes are remaining, integers of up to 8 bytes are unpacked
+ * word-at-a-time on little-endian platforms, which covers all values below
+ * 2^56. Longer integers are handled by the byte-wise version.
+ *
  * \warning The caller has to ensure that the buffer may not underrun and the
  * space pointed to by the value pointer is appropriately sized.
  *
@@ -624,6 +963,19 @@ pb_varint_unpack_uint32(const uint8_t data[], size_t left, void *value) {
 extern size_t
 pb_varint_unpack_uint64(const uint8_t data[], size_t left, void *value) {
   assert(data && left && value);
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+
+  /* Fast path: unpack integers of up to 8 bytes with a single load */
+  if (likely_(left >= 8)) {
+    size_t size = unpack_word(data, (uint64_t *)value);
+    if (likely_(size))
+      return size;
+  }
+
+#endif /* __BYTE_ORDER__ */
+
+  /* Slow path: unpack byte-wise */
   size_t size = 0; uint64_t temp = (uint64_t)(data[size] & 0x7F);
   if (data[size++] & 0x80 && --left) {
     temp |= (uint64_t)(data[size] & 0x7F) << 7;
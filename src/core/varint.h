@@ -27,6 +27,8 @@
 #include <stdint.h>
 #include <stdlib.h>
 
+#include <protobluff/core/varint.h>
+
 #include "core/common.h"
 
 /* ----------------------------------------------------------------------------
@@ -120,60 +122,24 @@ pb_varint_pack_sint64(
 /* ------------------------------------------------------------------------- */
 
 extern size_t
-pb_varint_scan(
-  const uint8_t data[],                /* Source buffer */
-  size_t left);                        /* Remaining bytes */
-
-/* ------------------------------------------------------------------------- */
-
-PB_WARN_UNUSED_RESULT
-extern size_t
-pb_varint_unpack_int32(
-  const uint8_t data[],                /* Source buffer */
-  size_t left,                         /* Remaining bytes */
-  void *value);                        /* Pointer receiving value */
-
-PB_WARN_UNUSED_RESULT
-extern size_t
-pb_varint_unpack_int64(
-  const uint8_t data[],                /* Source buffer */
-  size_t left,                         /* Remaining bytes */
-  void *value);                        /* Pointer receiving value */
+pb_varint_size_all(
+  pb_type_t type,                      /* Type */
+  const void *values,                  /* Pointer holding values */
+  size_t size);                        /* Value count */
 
-PB_WARN_UNUSED_RESULT
 extern size_t
-pb_varint_unpack_uint8(
-  const uint8_t data[],                /* Source buffer */
-  size_t left,                         /* Remaining bytes */
-  void *value);                        /* Pointer receiving value */
-
-PB_WARN_UNUSED_RESULT
-extern size_t
-pb_varint_unpack_uint32(
-  const uint8_t data[],                /* Source buffer */
-  size_t left,                         /* Remaining bytes */
-  void *value);                        /* Pointer receiving value */
-
-PB_WARN_UNUSED_RESULT
-extern size_t
-pb_varint_unpack_uint64(
-  const uint8_t data[],                /* Source buffer */
-  size_t left,                         /* Remaining bytes */
-  void *value);                        /* Pointer receiving value */
+pb_varint_pack_all(
+  pb_type_t type,                      /* Type */
+  uint8_t data[],                      /* Target buffer */
+  const void *values,                  /* Pointer holding values */
+  size_t size);                        /* Value count */
 
-PB_WARN_UNUSED_RESULT
-extern size_t
-pb_varint_unpack_sint32(
-  const uint8_t data[],                /* Source buffer */
-  size_t left,                         /* Remaining bytes */
-  void *value);                        /* Pointer receiving value */
+/* ------------------------------------------------------------------------- */
 
-PB_WARN_UNUSED_RESULT
 extern size_t
-pb_varint_unpack_sint64(
+pb_varint_scan(
   const uint8_t data[],                /* Source buffer */
-  size_t left,                         /* Remaining bytes */
-  void *value);                        /* Pointer receiving value */
+  size_t left);                        /* Remaining bytes */
 
 /* ----------------------------------------------------------------------------
  * Jump tables
@@ -222,6 +188,58 @@ pb_varint_pack(pb_type_t type, uint8_t data[], const void *value) {
   return pb_varint_pack_jump[type](data, value);
 }
 
+/*!
+ * Retrieve the padded size of a variable-sized integer of given type.
+ *
+ * Values are padded to the maximum packed size of their type, so any other
+ * value of the same type can be written in place. Negative 32-bit integers
+ * are always packed as ten bytes, so only non-negative values are padded to
+ * five bytes, as integers longer than that are not valid 32-bit integers.
+ *
+ * \param[in] type  Type
+ * \param[in] value Pointer holding value
+ * \return          Padded size
+ */
+PB_INLINE size_t
+pb_varint_size_padded(pb_type_t type, const void *value) {
+  size_t size = pb_varint_size(type, value);
+  switch (type) {
+    case PB_TYPE_BOOL:
+      return size;
+    case PB_TYPE_INT32:
+    case PB_TYPE_UINT32:
+    case PB_TYPE_SINT32:
+    case PB_TYPE_ENUM:
+      return size > 5 ? size : 5;
+    default:
+      return 10;
+  }
+}
+
+/*!
+ * Pack a variable-sized integer of given type, padded to its maximum size.
+ *
+ * The value is packed minimally, and continuation bits are set on all but
+ * the last byte, followed by zero-valued bytes, which is a valid encoding.
+ *
+ * \param[in]  type   Type
+ * \param[out] data[] Target buffer
+ * \param[in]  value  Pointer holding value
+ * \return            Packed size
+ */
+PB_INLINE size_t
+pb_varint_pack_padded(pb_type_t type, uint8_t data[], const void *value) {
+  size_t size  = pb_varint_pack(type, data, value),
+         width = pb_varint_size_padded(type, value);
+  if (size < width) {
+    data[size - 1] |= 0x80;
+    while (size < width - 1)
+      data[size++] = 0x80;
+    data[size++] = 0x00;
+  }
+  return size;
+}
+
 /*!
  * Unpack a variable-sized integer of given type.
  *
@@ -38,6 +38,7 @@
 
 namespace protobluff {
 
+  using ::std::max;
   using ::std::sort;
   using ::std::unique_ptr;
   using ::std::vector;
@@ -140,7 +141,68 @@ namespace protobluff {
       for (size_t i = 0; i < 2; i++)
         printer->Outdent();
 
-      /* Generate descriptor footer */
+      /* Collect numbers in ascending order to determine index range */
+      vector<int64_t> numbers;
+      for (size_t v = 0; v < descriptor_->value_count(); v++)
+        numbers.push_back(descriptor_->value(v)->number());
+      sort(numbers.begin(), numbers.end());
+      size_t range = numbers.back() - numbers.front() + 1;
+
+      /* Generate descriptor footer with index, if numbers are dense enough */
+      if (range <= max<size_t>(4 * numbers.size(), 64)) {
+        printer->Print(
+          "\n"
+          "  }, `values` }, {\n"
+          "  (const uint16_t []){\n"
+          "    ", "values", SimpleItoa(descriptor_->value_count()));
+
+        /* Generate positions of the first value descriptor by number */
+        for (size_t n = 0, v = 0; n < range; n++) {
+          while ((size_t)(numbers[v] - numbers.front()) < n)
+            v++;
+          if ((size_t)(numbers[v] - numbers.front()) == n) {
+            printer->Print(SimpleItoa(v + 1).c_str());
+          } else {
+            printer->Print("0");
+          }
+          if (n < range - 1)
+            printer->Print(n % 16 < 15 ? ", " : ",\n    ");
+        }
+
+        /* Generate index footer */
+        printer->Print(
+          "\n"
+          "  }, `offset`, `size` }, {\n"
+          "  (const uint16_t []){\n"
+          "    ",
+          "offset", SimpleItoa((long long)numbers.front()),
+          "size",   SimpleItoa(range));
+
+      /* Generate descriptor footer without index */
+      } else {
+        printer->Print(
+          "\n"
+          "  }, `values` }, { NULL, 0, 0 }, {\n"
+          "  (const uint16_t []){\n"
+          "    ", "values", SimpleItoa(descriptor_->value_count()));
+      }
+
+      /* Sort value positions by name for binary search */
+      vector<size_t> names;
+      for (size_t v = 0; v < descriptor_->value_count(); v++)
+        names.push_back(v);
+      sort(names.begin(), names.end(), [this](size_t x, size_t y) {
+        return EnumValueNameComparator(values_[x].get(), values_[y].get());
+      });
+
+      /* Generate value positions sorted by name */
+      for (size_t n = 0; n < names.size(); n++) {
+        printer->Print(SimpleItoa(names[n]).c_str());
+        if (n < names.size() - 1)
+          printer->Print(n % 16 < 15 ? ", " : ",\n    ");
+      }
+
+      /* Generate name footer */
       printer->Print(
         "\n"
         "  }, `values` } };\n"
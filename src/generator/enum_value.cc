@@ -101,4 +101,16 @@ namespace protobluff {
   EnumValueComparator(const EnumValue *x, const EnumValue *y) {
     return x->descriptor_->number() < y->descriptor_->number();
   }
+
+  /*!
+   * Comparator for enum value generators by name.
+   *
+   * \param[in] x Enum value generator
+   * \param[in] y Enum value generator
+   * \return      Test result
+   */
+  bool
+  EnumValueNameComparator(const EnumValue *x, const EnumValue *y) {
+    return x->descriptor_->name() < y->descriptor_->name();
+  }
 }
@@ -66,6 +66,11 @@ namespace protobluff {
       const EnumValue *x,              /* Enum value generator */
       const EnumValue *y);             /* Enum value generator */
 
+    friend bool
+    EnumValueNameComparator(
+      const EnumValue *x,              /* Enum value generator */
+      const EnumValue *y);             /* Enum value generator */
+
   private:
     const EnumValueDescriptor
       *descriptor_;                    /* Enum value descriptor */
@@ -76,6 +81,11 @@ namespace protobluff {
   EnumValueComparator(
     const EnumValue *x,                /* Enum value generator */
     const EnumValue *y);               /* Enum value generator */
+
+  bool
+  EnumValueNameComparator(
+    const EnumValue *x,                /* Enum value generator */
+    const EnumValue *y);               /* Enum value generator */
 }
 
 #endif /* PB_GENERATOR_ENUM_VALUE_HH */
@@ -53,6 +53,7 @@ namespace protobluff {
   using ::google::protobuf::EnumDescriptor;
   using ::google::protobuf::EnumValueDescriptor;
   using ::google::protobuf::FieldDescriptor;
+  using ::google::protobuf::FileDescriptor;
   using ::google::protobuf::io::Printer;
 
   using ::google::protobuf::HasPrefixString;
@@ -345,10 +346,234 @@ namespace protobluff {
       printer->Print(",\n"
         "  .flags = PACKED");
 
+    /* Add flag for strings which must be valid UTF-8 (proto3 semantics) */
+    else if (descriptor_->type() == FieldDescriptor::TYPE_STRING &&
+        descriptor_->file()->syntax() == FileDescriptor::SYNTAX_PROTO3)
+      printer->Print(",\n"
+        "  .flags = UTF8");
+
+    /* Generate encoded tag and wiretype */
+    uint32_t key = Key();
+    size_t size = 0;
+    string data;
+    do {
+      uint8_t byte = (key & 0x7F) | (key > 0x7F ? 0x80 : 0);
+      data += (size++ ? ", " : "") + SimpleItoa(byte);
+      key >>= 7;
+    } while (key);
+    printer->Print(",\n"
+      "  .key   = { { `data` }, `size` }",
+      "data", data, "size", SimpleItoa(size));
+
     /* Terminate initializer */
     printer->Print(" }");
   }
 
+  /*!
+   * Generate struct member.
+   *
+   * Repeated fields are stored as a counted array, nested messages as a
+   * pointer to their struct, which is allocated when decoding.
+   *
+   * \param[in,out] printer Printer
+   */
+  void Field::
+  GenerateMember(Printer *printer) const {
+    assert(printer);
+    if (descriptor_->is_repeated()) {
+      printer->Print(variables_,
+        "pb_repeated_t `field`;\n");
+    } else if (descriptor_->message_type()) {
+      printer->Print(variables_,
+        "struct `nested`_t *`field`;\n");
+    } else {
+      printer->Print(variables_,
+        "`cpp_type` `field`;\n");
+    }
+  }
+
+  /*!
+   * Generate layout.
+   *
+   * \param[in,out] printer Printer
+   */
+  void Field::
+  GenerateLayout(Printer *printer) const {
+    assert(printer);
+    printer->Print(variables_,
+      "{ offsetof(`message`_t, `field`)");
+
+    /* Generate nested message layout reference */
+    if (descriptor_->message_type())
+      printer->Print(variables_,
+        ", &`nested`_layout");
+
+    /* Terminate initializer */
+    printer->Print(" }");
+  }
+
+  /*!
+   * Generate case of specialized struct decoder.
+   *
+   * Only singular non-message fields are decoded inline with a typed read, as
+   * the switch of the case label on the precomputed key, i.e. the tag and the
+   * wiretype, guarantees that the value is encoded as expected. All other
+   * fields are left to the generic path.
+   *
+   * \param[in,out] printer Printer
+   * \param[in]     pos     Field position
+   */
+  void Field::
+  GenerateStructDecoder(Printer *printer, size_t pos) const {
+    assert(printer);
+    if (descriptor_->is_repeated() || descriptor_->message_type())
+      return;
+
+    /* Prepare key and position */
+    map<string, string> variables (variables_);
+    variables["key"] = SimpleItoa(Key());
+    variables["pos"] = SimpleItoa(pos);
+
+    /* Generate case */
+    printer->Print(variables,
+      "\n"
+      "/* `label` `type` `name` = `tag` */\n"
+      "case `key`:\n"
+      "  error = pb_stream_read_typed(&stream,\n"
+      "    PB_TYPE_`TYPE`, &(value->`field`));\n"
+      "  if (!error)\n"
+      "    pb_layout_set(&`message`_layout, value, `pos`);\n"
+      "  break;\n");
+  }
+
+  /*!
+   * Generate visitor member.
+   *
+   * Scalar values are passed by value, strings and bytes by reference, and
+   * nested messages as a decoder, which can be handed to the nested visitor.
+   *
+   * \param[in,out] printer Printer
+   */
+  void Field::
+  GenerateVisitorMember(Printer *printer) const {
+    assert(printer);
+    if (descriptor_->message_type()) {
+      printer->Print(variables_,
+        "pb_error_t (*on_`field`)(pb_decoder_t *decoder, void *user);\n");
+    } else if (descriptor_->cpp_type() == FieldDescriptor::CPPTYPE_STRING) {
+      printer->Print(variables_,
+        "pb_error_t (*on_`field`)(const pb_string_t *value, void *user);\n");
+    } else {
+      printer->Print(variables_,
+        "pb_error_t (*on_`field`)(`cpp_type` value, void *user);\n");
+    }
+  }
+
+  /*!
+   * Generate case of visitor decoder.
+   *
+   * Values are always read, so the stream advances, but the callback is only
+   * invoked if set. Repeated scalar fields are additionally matched in packed
+   * encoding, invoking the callback for every value.
+   *
+   * \param[in,out] printer Printer
+   */
+  void Field::
+  GenerateVisitorCase(Printer *printer) const {
+    assert(printer);
+
+    /* Prepare key */
+    map<string, string> variables (variables_);
+    variables["key"] = SimpleItoa(Key());
+
+    /* Generate case for nested message */
+    if (descriptor_->message_type()) {
+      printer->Print(variables,
+        "\n"
+        "/* `label` `type` `name` = `tag` */\n"
+        "case `key`: {\n"
+        "  pb_string_t temp;\n"
+        "  if (!(error = pb_stream_read_typed(&stream,\n"
+        "      PB_TYPE_MESSAGE, &temp)) && visitor->on_`field`)\n"
+        "    error = pb_decoder_decode_nested(decoder, &`nested`_descriptor,\n"
+        "      &temp, visitor->on_`field`, user);\n"
+        "  break;\n"
+        "}\n");
+
+    /* Generate case for string or bytes, validating UTF-8 if necessary */
+    } else if (descriptor_->cpp_type() == FieldDescriptor::CPPTYPE_STRING) {
+      printer->Print(variables,
+        "\n"
+        "/* `label` `type` `name` = `tag` */\n"
+        "case `key`: {\n"
+        "  pb_string_t temp;\n"
+        "  if ((error = pb_stream_read_typed(&stream,\n"
+        "      PB_TYPE_`TYPE`, &temp)))\n"
+        "    break;\n");
+      if (descriptor_->type() == FieldDescriptor::TYPE_STRING) {
+        if (descriptor_->file()->syntax() == FileDescriptor::SYNTAX_PROTO3)
+          printer->Print(
+            "  if (!pb_utf8_valid(\n");
+        else
+          printer->Print(
+            "  if ((decoder->flags & PB_DECODER_FLAG_UTF8) && "
+              "!pb_utf8_valid(\n");
+        printer->Print(variables,
+          "      pb_string_data(&temp), pb_string_size(&temp)))\n"
+          "    error = PB_ERROR_INVALID;\n"
+          "  else if (visitor->on_`field`)\n"
+          "    error = visitor->on_`field`(&temp, user);\n");
+      } else {
+        printer->Print(variables,
+          "  if (visitor->on_`field`)\n"
+          "    error = visitor->on_`field`(&temp, user);\n");
+      }
+      printer->Print(
+        "  break;\n"
+        "}\n");
+
+    /* Generate case for scalar value */
+    } else {
+      printer->Print(variables,
+        "\n"
+        "/* `label` `type` `name` = `tag` */\n"
+        "case `key`: {\n"
+        "  `cpp_type` temp;\n"
+        "  if (!(error = pb_stream_read_typed(&stream,\n"
+        "      PB_TYPE_`TYPE`, &temp)) && visitor->on_`field`)\n"
+        "    error = visitor->on_`field`(temp, user);\n"
+        "  break;\n"
+        "}\n");
+
+      /* Generate case for repeated scalar values in packed encoding */
+      if (descriptor_->is_repeated()) {
+        variables["key"] = SimpleItoa((Key() & ~7U) | 2);
+        printer->Print(variables,
+          "\n"
+          "/* `label` `type` `name` = `tag` (packed) */\n"
+          "case `key`: {\n"
+          "  uint32_t length;\n"
+          "  if ((error = pb_stream_read_uint32(&stream, &length)))\n"
+          "    break;\n"
+          "  if (length > pb_stream_left(&stream)) {\n"
+          "    error = PB_ERROR_OFFSET;\n"
+          "    break;\n"
+          "  }\n"
+          "  size_t end = pb_stream_offset(&stream) + length;\n"
+          "  while (!error && pb_stream_offset(&stream) < end) {\n"
+          "    `cpp_type` temp;\n"
+          "    if (!(error = pb_stream_read_typed(&stream,\n"
+          "        PB_TYPE_`TYPE`, &temp)) && visitor->on_`field`)\n"
+          "      error = visitor->on_`field`(temp, user);\n"
+          "  }\n"
+          "  if (!error && pb_stream_offset(&stream) != end)\n"
+          "    error = PB_ERROR_OFFSET;\n"
+          "  break;\n"
+          "}\n");
+      }
+    }
+  }
+
   /*!
    * Generate encoder.
    *
@@ -386,6 +611,21 @@ namespace protobluff {
         "}\n"
         "\n");
 
+    /* Generate in-place encoder for message fields */
+    if (descriptor_->message_type())
+      printer->Print(variables_,
+        "/* `signature` : encode begin */\n"
+        "`deprecated`"
+        "PB_WARN_UNUSED_RESULT\n"
+        "PB_INLINE pb_error_t\n"
+        "`message`_encode_begin_`field`(\n"
+        "    pb_encoder_t *encoder, pb_encoder_frame_t *frame) {\n"
+        "  assert(pb_encoder_descriptor(encoder) == \n"
+        "    &`message`_descriptor);\n"
+        "  return pb_encoder_begin_nested(encoder, `tag`, frame);\n"
+        "}\n"
+        "\n");
+
     /* Generate encoder for enum fields */
     if (descriptor_->enum_type()) {
       const EnumDescriptor *descriptor = descriptor_->enum_type();
@@ -429,6 +669,41 @@ namespace protobluff {
     }
   }
 
+  /*!
+   * Generate C++ field descriptor.
+   *
+   * The name of the field descriptor is derived from the field name in camel
+   * case, prefixed with a "k", e.g. phone_number becomes kPhoneNumber.
+   *
+   * \param[in,out] printer Printer
+   */
+  void Field::
+  GenerateWrapper(Printer *printer) const {
+    assert(printer);
+
+    /* Convert field name to camel case */
+    string name ("k");
+    bool upper = true;
+    for (size_t c = 0; c < descriptor_->name().size(); c++) {
+      char value = descriptor_->name()[c];
+      if (value == '_') {
+        upper = true;
+      } else {
+        name += upper && 'a' <= value && value <= 'z'
+          ? static_cast<char>(value - 'a' + 'A') : value;
+        upper = false;
+      }
+    }
+
+    /* Generate field descriptor */
+    map<string, string> variables (variables_);
+    variables["field"] = name;
+    printer->Print(variables,
+      "typedef ::protobluff::field<\n"
+      "  `constant`_T, PB_TYPE_`TYPE`, PB_LABEL_`LABEL`\n"
+      "> `field`;\n");
+  }
+
   /*!
    * Generate accessors.
    *
@@ -482,6 +757,29 @@ namespace protobluff {
           "}\n"
           "\n");
 
+      /* Generate accessors for map fields */
+      if (descriptor_->is_map()) {
+        map<string, string> variables (variables_);
+        Field key (descriptor_->message_type()->field(0));
+
+        /* Extract tag and native type of key */
+        variables["key.tag"]      = key.variables_["tag"];
+        variables["key.cpp_type"] = key.variables_["cpp_type"];
+        printer->Print(variables,
+          "/* `signature` : find */\n"
+          "`deprecated`"
+          "PB_WARN_UNUSED_RESULT\n"
+          "PB_INLINE pb_message_t\n"
+          "`message`_find_`field`(\n"
+          "    pb_message_t *message, const `key.cpp_type` *key) {\n"
+          "  assert(pb_message_descriptor(message) == \n"
+          "    &`message`_descriptor);\n"
+          "  return pb_message_create_from_key(message, `tag`,\n"
+          "    `key.tag`, key);\n"
+          "}\n"
+          "\n");
+      }
+
       /* Create a trace to generate accessors for nested messages */
       if (ShouldTrace()) {
         vector<const FieldDescriptor *> trace;
@@ -507,6 +805,21 @@ namespace protobluff {
           "  return pb_message_get(message, `tag`, value);\n"
           "}\n"
           "\n");
+
+      /* Generate accessors for repeated primitive fields */
+      if (descriptor_->is_repeated())
+        printer->Print(variables_,
+          "/* `signature` : get_all */\n"
+          "`deprecated`"
+          "PB_WARN_UNUSED_RESULT\n"
+          "PB_INLINE pb_error_t\n"
+          "`message`_get_`field`_all(\n"
+          "    pb_message_t *message, `cpp_type` *values, size_t *size) {\n"
+          "  assert(pb_message_descriptor(message) == \n"
+          "    &`message`_descriptor);\n"
+          "  return pb_message_get_repeated(message, `tag`, values, size);\n"
+          "}\n"
+          "\n");
       printer->Print(variables_,
         "/* `signature` : put */\n"
         "`deprecated`"
@@ -520,6 +833,22 @@ namespace protobluff {
         "}\n"
         "\n");
 
+      /* Generate bulk put accessor for repeated primitive fields */
+      if (descriptor_->is_repeated())
+        printer->Print(variables_,
+          "/* `signature` : put_all */\n"
+          "`deprecated`"
+          "PB_WARN_UNUSED_RESULT\n"
+          "PB_INLINE pb_error_t\n"
+          "`message`_put_`field`_all(\n"
+          "    pb_message_t *message, const `cpp_type` *values, "
+            "size_t size) {\n"
+          "  assert(pb_message_descriptor(message) == \n"
+          "    &`message`_descriptor);\n"
+          "  return pb_message_put_repeated(message, `tag`, values, size);\n"
+          "}\n"
+          "\n");
+
       /* Generate accessors for enum fields */
       if (descriptor_->enum_type()) {
         const EnumDescriptor *descriptor = descriptor_->enum_type();
@@ -824,6 +1153,36 @@ namespace protobluff {
       descriptor_->containing_type()->full_name());
   }
 
+  /*!
+   * Retrieve the key of a field, i.e. the tag and wiretype as encoded.
+   *
+   * \return Key
+   */
+  uint32_t Field::
+  Key() const {
+    unsigned int wiretype = 0;
+    switch (descriptor_->type()) {
+      case FieldDescriptor::TYPE_FIXED64:
+      case FieldDescriptor::TYPE_SFIXED64:
+      case FieldDescriptor::TYPE_DOUBLE:
+        wiretype = 1;
+        break;
+      case FieldDescriptor::TYPE_STRING:
+      case FieldDescriptor::TYPE_BYTES:
+      case FieldDescriptor::TYPE_MESSAGE:
+        wiretype = 2;
+        break;
+      case FieldDescriptor::TYPE_FIXED32:
+      case FieldDescriptor::TYPE_SFIXED32:
+      case FieldDescriptor::TYPE_FLOAT:
+        wiretype = 5;
+        break;
+      default:
+        break;
+    }
+    return (static_cast<uint32_t>(descriptor_->number()) << 3) | wiretype;
+  }
+
   /*!
    * Check whether a field defines a default value.
    *
@@ -66,11 +66,42 @@ namespace protobluff {
       Printer *printer)                /* Printer */
     const;
 
+    void
+    GenerateMember(
+      Printer *printer)                /* Printer */
+    const;
+
+    void
+    GenerateLayout(
+      Printer *printer)                /* Printer */
+    const;
+
+    void
+    GenerateStructDecoder(
+      Printer *printer,                /* Printer */
+      size_t pos)                      /* Field position */
+    const;
+
+    void
+    GenerateVisitorMember(
+      Printer *printer)                /* Printer */
+    const;
+
+    void
+    GenerateVisitorCase(
+      Printer *printer)                /* Printer */
+    const;
+
     void
     GenerateEncoder(
       Printer *printer)                /* Printer */
     const;
 
+    void
+    GenerateWrapper(
+      Printer *printer)                /* Printer */
+    const;
+
     void
     GenerateAccessors(
       Printer *printer)                /* Printer */
@@ -88,6 +119,10 @@ namespace protobluff {
     HasDefault()
     const;
 
+    uint32_t
+    Key()
+    const;
+
     friend bool
     FieldComparator(
       const Field *x,                  /* Field generator */
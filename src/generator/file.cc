@@ -55,6 +55,7 @@ namespace protobluff {
   using ::google::protobuf::io::Printer;
 
   using ::google::protobuf::SimpleItoa;
+  using ::google::protobuf::SplitStringUsing;
   using ::google::protobuf::StringReplace;
   using ::google::protobuf::StripSuffixString;
   using ::google::protobuf::UpperString;
@@ -63,13 +64,20 @@ namespace protobluff {
    * Create a file generator.
    *
    * \param[in] descriptor File descriptor
+   * \param[in] structs    Generate structs
+   * \param[in] visitors   Generate visitors
+   * \param[in] profile    Field-frequency profile
    */
   File::
-  File(const FileDescriptor *descriptor) :
+  File(
+      const FileDescriptor *descriptor, bool structs, bool visitors,
+      const Profile *profile) :
       descriptor_(descriptor),
       mode_(descriptor_->options().has_optimize_for()
         ? descriptor_->options().optimize_for()
         : FileOptions::SPEED),
+      structs_(structs),
+      visitors_(visitors),
       enums_(new unique_ptr<Enum>[descriptor_->enum_type_count()]),
       messages_(new unique_ptr<Message>[descriptor_->message_type_count()]) {
 
@@ -79,7 +87,7 @@ namespace protobluff {
 
     /* Initialize message generators */
     for (size_t m = 0; m < descriptor_->message_type_count(); m++)
-      messages_[m].reset(new Message(descriptor_->message_type(m)));
+      messages_[m].reset(new Message(descriptor_->message_type(m), profile));
 
     /* Build set of unique extended descriptors */
     set<const Descriptor *> unique;
@@ -232,6 +240,25 @@ namespace protobluff {
       /* Generate encoders for messages and nested messages */
       for (size_t m = 0; m < descriptor_->message_type_count(); m++)
         messages_[m]->GenerateEncoder(printer);
+
+      /* Generate visitors for messages, if requested */
+      if (visitors_) {
+        PrintBanner(printer, "Visitors");
+
+        /* Generate visitors for messages and nested messages */
+        for (size_t m = 0; m < descriptor_->message_type_count(); m++)
+          messages_[m]->GenerateVisitor(printer);
+      }
+
+      /* Generate structs for messages, if requested */
+      if (structs_) {
+        PrintBanner(printer, "Structs");
+
+        /* Generate structs for messages and nested messages */
+        for (size_t m = 0; m < descriptor_->message_type_count(); m++)
+          messages_[m]->GenerateStruct(printer,
+            mode_ == FileOptions::SPEED);
+      }
     }
 
     /* Don't generate accessor code for lite runtime */
@@ -243,7 +270,7 @@ namespace protobluff {
 
         /* Generate accessors for messages and nested messages */
         for (size_t m = 0; m < descriptor_->message_type_count(); m++)
-          messages_[m]->GenerateAccessors(printer);
+          messages_[m]->GenerateAccessors(printer, structs_);
       }
 
       /* Generate accessors for oneofs */
@@ -359,6 +386,24 @@ namespace protobluff {
       /* Generate descriptors for messages and nested messages */
       for (size_t m = 0; m < descriptor_->message_type_count(); m++)
         messages_[m]->GenerateDescriptor(printer);
+
+      /* Generate layouts for messages, if requested */
+      if (structs_) {
+        PrintBanner(printer, "Layouts");
+
+        /* Generate layouts for messages and nested messages */
+        for (size_t m = 0; m < descriptor_->message_type_count(); m++)
+          messages_[m]->GenerateLayout(printer);
+      }
+
+      /* Generate specialized struct decoders, if optimizing for speed */
+      if (structs_ && mode_ == FileOptions::SPEED) {
+        PrintBanner(printer, "Struct decoders");
+
+        /* Generate struct decoders for messages and nested messages */
+        for (size_t m = 0; m < descriptor_->message_type_count(); m++)
+          messages_[m]->GenerateStructDecoder(printer);
+      }
     }
 
     /* Generate descriptors and initializers for extensions */
@@ -394,6 +439,65 @@ namespace protobluff {
     }
   }
 
+  /*!
+   * Generate C++ wrapper header file.
+   *
+   * The wrapper header includes the header file of the C interface, which
+   * remains the underlying implementation, and defines a struct for every
+   * message within a namespace derived from the package.
+   *
+   * \param[in,out] printer Printer
+   */
+  void File::
+  GenerateWrapper(Printer *printer) const {
+    assert(printer);
+
+    /* Generate disclaimer */
+    PrintDisclaimer(printer);
+
+    /* Generate guard header, library and header includes */
+    printer->Print(variables_,
+      "#ifndef `guard`_PB_HPP\n"
+      "#define `guard`_PB_HPP\n"
+      "\n"
+      "#include <protobluff.hpp>\n"
+      "\n"
+      "#include \"`include`.pb.h\"\n"
+      "\n");
+
+    /* Generate wrappers for messages */
+    if (descriptor_->message_type_count()) {
+      PrintBanner(printer, "Wrappers");
+
+      /* Split package into namespaces */
+      vector<string> namespaces;
+      if (descriptor_->package().size())
+        SplitStringUsing(descriptor_->package(), ".", &namespaces);
+
+      /* Generate namespace header */
+      for (size_t n = 0; n < namespaces.size(); n++)
+        printer->Print("namespace `namespace` {\n",
+          "namespace", namespaces[n]);
+      if (namespaces.size())
+        printer->Print("\n");
+
+      /* Generate wrappers for messages and nested messages */
+      for (size_t m = 0; m < descriptor_->message_type_count(); m++)
+        messages_[m]->GenerateWrapper(printer);
+
+      /* Generate namespace footer */
+      for (size_t n = namespaces.size(); n > 0; n--)
+        printer->Print("} /* namespace `namespace` */\n",
+          "namespace", namespaces[n - 1]);
+      if (namespaces.size())
+        printer->Print("\n");
+    }
+
+    /* Generate guard footer */
+    printer->Print(variables_,
+      "#endif /* `guard`_PB_HPP */");
+  }
+
   /*!
    * Check whether a file's messages define default values.
    *
@@ -35,6 +35,7 @@
 #include "generator/enum.hh"
 #include "generator/extension.hh"
 #include "generator/message.hh"
+#include "generator/profile.hh"
 
 /* ----------------------------------------------------------------------------
  * Interface
@@ -57,7 +58,10 @@ namespace protobluff {
     explicit
     File(
       const FileDescriptor
-        *descriptor);                  /* File descriptor */
+        *descriptor,                   /* File descriptor */
+      bool structs,                    /* Generate structs */
+      bool visitors,                   /* Generate visitors */
+      const Profile *profile = NULL);  /* Field-frequency profile */
 
     void
     GenerateHeader(
@@ -69,6 +73,11 @@ namespace protobluff {
       Printer *printer)                /* Printer */
     const;
 
+    void
+    GenerateWrapper(
+      Printer *printer)                /* Printer */
+    const;
+
     bool
     HasDefaults()
     const;
@@ -89,6 +98,8 @@ namespace protobluff {
     const FileDescriptor *descriptor_; /* File descriptor */
     const FileOptions::OptimizeMode
       mode_;                           /* Optimization mode */
+    const bool structs_;               /* Generate structs */
+    const bool visitors_;              /* Generate visitors */
     unique_ptr<
       unique_ptr<Enum>[]
     > enums_;                          /* Enum generators */
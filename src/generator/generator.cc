@@ -22,6 +22,8 @@
 
 #include <cassert>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include <google/protobuf/compiler/code_generator.h>
 #include <google/protobuf/descriptor.h>
@@ -31,6 +33,7 @@
 
 #include "generator/file.hh"
 #include "generator/generator.hh"
+#include "generator/profile.hh"
 #include "generator/strutil.hh"
 
 /* ----------------------------------------------------------------------------
@@ -39,11 +42,14 @@
 
 namespace protobluff {
 
+  using ::std::pair;
   using ::std::string;
   using ::std::unique_ptr;
+  using ::std::vector;
 
   using ::google::protobuf::compiler::CodeGenerator;
   using ::google::protobuf::compiler::OutputDirectory;
+  using ::google::protobuf::compiler::ParseGeneratorParameter;
   using ::google::protobuf::FileDescriptor;
   using ::google::protobuf::io::Printer;
   using ::google::protobuf::io::ZeroCopyOutputStream;
@@ -67,8 +73,29 @@ namespace protobluff {
     /* Construct basename for source and header files */
     string basename = StripSuffixString(descriptor->name(), ".proto") + ".pb";
 
+    /* Parse command-line parameters */
+    vector<pair<string, string> > options;
+    ParseGeneratorParameter(parameter, &options);
+    bool structs = false, visitors = false, wrappers = false;
+    Profile profile;
+    for (size_t o = 0; o < options.size(); o++) {
+      if (options[o].first == "structs") {
+        structs = true;
+      } else if (options[o].first == "visitors") {
+        visitors = true;
+      } else if (options[o].first == "cpp") {
+        wrappers = true;
+      } else if (options[o].first == "profile") {
+        if (!profile.Load(options[o].second, error))
+          return false;
+      } else {
+        *error = "Unknown parameter: " + options[o].first;
+        return false;
+      }
+    }
+
     /* Create file generator from descriptor */
-    File file (descriptor);
+    File file (descriptor, structs, visitors, &profile);
 
     /* Generate header file */
     {
@@ -85,6 +112,14 @@ namespace protobluff {
       Printer printer (output.get(), '`');
       file.GenerateSource(&printer);
     }
+
+    /* Generate C++ wrapper header file, if requested */
+    if (wrappers) {
+      unique_ptr<ZeroCopyOutputStream> output(
+        directory->Open(basename + ".hpp"));
+      Printer printer (output.get(), '`');
+      file.GenerateWrapper(&printer);
+    }
     return true;
   }
 }
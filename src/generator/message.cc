@@ -23,6 +23,7 @@
 #include <algorithm>
 #include <cassert>
 #include <set>
+#include <utility>
 #include <vector>
 
 #include <google/protobuf/descriptor.h>
@@ -34,6 +35,7 @@
 #include "generator/field.hh"
 #include "generator/message.hh"
 #include "generator/oneof.hh"
+#include "generator/profile.hh"
 #include "generator/strutil.hh"
 
 /* ----------------------------------------------------------------------------
@@ -42,6 +44,11 @@
 
 namespace protobluff {
 
+  using ::std::find;
+  using ::std::make_pair;
+  using ::std::max;
+  using ::std::min;
+  using ::std::pair;
   using ::std::set;
   using ::std::sort;
   using ::std::unique_ptr;
@@ -54,14 +61,21 @@ namespace protobluff {
   using ::google::protobuf::LowerString;
   using ::google::protobuf::SimpleItoa;
   using ::google::protobuf::StringReplace;
+  using ::google::protobuf::UpperString;
 
   /*!
    * Create a message generator.
    *
+   * If a field-frequency profile is given, the cases of the generated decoders
+   * are ordered by the number of occurrences of their fields, so the common
+   * fields are matched first. The descriptor itself is not affected, as field
+   * lookups rely on fields being ordered by tag.
+   *
    * \param[in] descriptor Descriptor
+   * \param[in] profile    Field-frequency profile
    */
   Message::
-  Message(const Descriptor *descriptor) :
+  Message(const Descriptor *descriptor, const Profile *profile) :
       descriptor_(descriptor),
       fields_(new unique_ptr<Field>[descriptor_->field_count()]),
       enums_(new unique_ptr<Enum>[descriptor_->enum_type_count()]),
@@ -78,6 +92,29 @@ namespace protobluff {
     for (size_t f = 0; f < descriptor_->field_count(); f++)
       fields_[f].reset(sorted[f]);
 
+    /* Rank positions by complemented occurrences, so hottest come first */
+    vector<pair<uint64_t, size_t> > ranked;
+    uint64_t total = 0;
+    for (size_t f = 0; f < descriptor_->field_count(); f++) {
+      uint64_t count = profile ? profile->Count(
+        descriptor_->FindFieldByNumber(fields_[f]->Key() >> 3)) : 0;
+      ranked.push_back(make_pair(~count, f));
+      total += count;
+    }
+    sort(ranked.begin(), ranked.end());
+    for (size_t f = 0; f < ranked.size(); f++)
+      order_.push_back(ranked[f].second);
+
+    /* Hint the key of the hottest field, if it accounts for half or more */
+    variables_["dispatch"] = "key";
+    if (total && ~ranked[0].first >= total / 2 + total % 2) {
+      uint32_t key = fields_[order_[0]]->Key();
+      if (descriptor_->FindFieldByNumber(key >> 3)->is_packed())
+        key = (key & ~7U) | 2;
+      variables_["dispatch"] =
+        "__builtin_expect(key, " + SimpleItoa(key) + ")";
+    }
+
     /* Initialize enum generators */
     for (size_t e = 0; e < descriptor_->enum_type_count(); e++)
     enums_[e].reset(new Enum(descriptor_->enum_type(e)));
@@ -88,7 +125,7 @@ namespace protobluff {
 
     /* Initialize nested message generators */
     for (size_t n = 0; n < descriptor_->nested_type_count(); n++)
-      nested_[n].reset(new Message(descriptor_->nested_type(n)));
+      nested_[n].reset(new Message(descriptor_->nested_type(n), profile));
 
     /* Build set of unique extended descriptors */
     set<const Descriptor *> unique;
@@ -135,6 +172,33 @@ namespace protobluff {
       fields_[f]->GenerateTag(printer);
     printer->Print("\n");
 
+    /* Determine size of projection mask from the highest tag */
+    int tag = 0;
+    for (size_t f = 0; f < descriptor_->field_count(); f++)
+      if (descriptor_->field(f)->number() > tag)
+        tag = descriptor_->field(f)->number();
+
+    /* Generate size of projection mask */
+    map<string, string> variables (variables_);
+    variables["constant"] = variables_.at("message");
+    UpperString(&(variables["constant"]));
+    variables["size"] = SimpleItoa((tag >> 3) + 1);
+    printer->Print(variables,
+      "/* `signature` : mask */\n"
+      "#define `constant`_MASK_SIZE `size`\n"
+      "\n");
+
+    /* Generate maximum encoded size, if bounded */
+    size_t size;
+    vector<const Descriptor *> trace;
+    if (MaxSize(descriptor_, trace, &size)) {
+      variables["size"] = SimpleItoa(size);
+      printer->Print(variables,
+        "/* `signature` : max size */\n"
+        "#define `constant`_MAX_SIZE `size`\n"
+        "\n");
+    }
+
     /* Generate tags for nested messages */
     for (size_t n = 0; n < descriptor_->nested_type_count(); n++)
       nested_[n]->GenerateTags(printer);
@@ -207,11 +271,108 @@ namespace protobluff {
       for (size_t i = 0; i < 2; i++)
         printer->Outdent();
 
-      /* Generate descriptor footer */
+      /* Collect tags in ascending order to determine index range */
+      vector<int> tags;
+      for (size_t f = 0; f < descriptor_->field_count(); f++)
+        tags.push_back(descriptor_->field(f)->number());
+      sort(tags.begin(), tags.end());
+      size_t range = tags.back() - tags.front() + 1;
+
+      /* Generate descriptor footer with index, if tags are dense enough */
+      bool indexed = range <= max<size_t>(4 * tags.size(), 64);
+      if (indexed) {
+        printer->Print(
+          "\n"
+          "  }, `fields` }, NULL, {\n"
+          "  (const uint16_t []){\n"
+          "    ", "fields", SimpleItoa(descriptor_->field_count()));
+
+        /* Generate positions of field descriptors by tag */
+        for (size_t t = 0, f = 0; t < range; t++) {
+          if ((size_t)(tags[f] - tags.front()) == t) {
+            printer->Print(SimpleItoa(++f).c_str());
+          } else {
+            printer->Print("0");
+          }
+          if (t < range - 1)
+            printer->Print(t % 16 < 15 ? ", " : ",\n    ");
+        }
+
+        /* Generate index footer */
+        printer->Print(
+          "\n"
+          "  }, `offset`, `size` }, {\n",
+          "offset", SimpleItoa(tags.front()),
+          "size",   SimpleItoa(range));
+
+      /* Generate descriptor footer without index */
+      } else {
+        printer->Print(
+          "\n"
+          "  }, `fields` }, NULL, { NULL, 0, 0 }, {\n",
+          "fields", SimpleItoa(descriptor_->field_count()));
+      }
+
+      /* Generate bitset of required field positions */
+      size_t words = (descriptor_->field_count() + 63) / 64;
+      printer->Print("  (const uint64_t []){\n");
+      for (size_t w = 0; w < words; w++) {
+        uint64_t bits = 0;
+        for (size_t f = w * 64; f < min<size_t>(
+            (w + 1) * 64, descriptor_->field_count()); f++)
+          if (descriptor_->field(f)->is_required())
+            bits |= (uint64_t)1 << (f % 64);
+        printer->Print("    `bits`ULL`comma`\n",
+          "bits",  SimpleItoa((unsigned long long)bits),
+          "comma", w < words - 1 ? "," : "");
+      }
+
+      /* Generate required footer */
+      printer->Print(
+        "  }, `words` }, {\n"
+        "  (const uint16_t []){\n"
+        "    ", "words", SimpleItoa(words));
+
+      /* Sort field positions by name for binary search */
+      vector<size_t> names;
+      for (size_t f = 0; f < descriptor_->field_count(); f++)
+        names.push_back(f);
+      sort(names.begin(), names.end(), [this](size_t x, size_t y) {
+        return descriptor_->field(x)->name() < descriptor_->field(y)->name();
+      });
+
+      /* Generate field positions sorted by name */
+      for (size_t n = 0; n < names.size(); n++) {
+        printer->Print(SimpleItoa(names[n]).c_str());
+        if (n < names.size() - 1)
+          printer->Print(n % 16 < 15 ? ", " : ",\n    ");
+      }
+
+      /* Generate name footer */
       printer->Print(
         "\n"
-        "  }, `fields` } };\n"
-        "\n", "fields", SimpleItoa(descriptor_->field_count()));
+        "  }, `fields` }", "fields", SimpleItoa(descriptor_->field_count()));
+
+      /* Generate packed tags for binary search, if there's no index */
+      if (!indexed) {
+        printer->Print(
+          ", {\n"
+          "  (const pb_tag_t []){\n"
+          "    ");
+        for (size_t t = 0; t < tags.size(); t++) {
+          printer->Print(SimpleItoa(tags[t]).c_str());
+          if (t < tags.size() - 1)
+            printer->Print(t % 16 < 15 ? ", " : ",\n    ");
+        }
+        printer->Print(
+          "\n"
+          "  } }");
+      }
+
+      /* Generate descriptor footer */
+      printer->Print(
+        " };\n"
+        "\n");
 
     /* Print empty descriptor, if message contains no fields */
     } else {
@@ -263,6 +424,35 @@ namespace protobluff {
       "}\n"
       "\n");
 
+    /* Generate checking decoder */
+    printer->Print(variables_,
+      "/* `signature` : decode checked */\n"
+      "`deprecated`"
+      "PB_WARN_UNUSED_RESULT\n"
+      "PB_INLINE pb_error_t\n"
+      "`message`_decode_checked(\n"
+      "    pb_decoder_t *decoder, pb_decoder_handler_f handler, void *user) {\n"
+      "  assert(pb_decoder_descriptor(decoder) == \n"
+      "    &`message`_descriptor);\n"
+      "  return pb_decoder_decode_checked(decoder, handler, user);\n"
+      "}\n"
+      "\n");
+
+    /* Generate projecting decoder */
+    printer->Print(variables_,
+      "/* `signature` : decode masked */\n"
+      "`deprecated`"
+      "PB_WARN_UNUSED_RESULT\n"
+      "PB_INLINE pb_error_t\n"
+      "`message`_decode_masked(\n"
+      "    pb_decoder_t *decoder, const pb_decoder_mask_t *mask,\n"
+      "    pb_decoder_handler_f handler, void *user) {\n"
+      "  assert(pb_decoder_descriptor(decoder) == \n"
+      "    &`message`_descriptor);\n"
+      "  return pb_decoder_decode_masked(decoder, mask, handler, user);\n"
+      "}\n"
+      "\n");
+
     /* Generate destructor */
     printer->Print(variables_,
       "/* `signature` : destroy */\n"
@@ -315,6 +505,26 @@ namespace protobluff {
       "}\n"
       "\n");
 
+    /* Generate constructor for stack memory, if size is bounded */
+    size_t size;
+    vector<const Descriptor *> trace;
+    if (MaxSize(descriptor_, trace, &size) && size) {
+      map<string, string> variables (variables_);
+      variables["constant"] = variables_.at("message");
+      UpperString(&(variables["constant"]));
+      printer->Print(variables,
+        "/* `signature` : create fixed */\n"
+        "`deprecated`"
+        "PB_WARN_UNUSED_RESULT\n"
+        "PB_INLINE pb_encoder_t\n"
+        "`message`_encoder_create_fixed(\n"
+        "    uint8_t data[`constant`_MAX_SIZE]) {\n"
+        "  return pb_encoder_create_fixed(\n"
+        "    &`message`_descriptor, data, `constant`_MAX_SIZE);\n"
+        "}\n"
+        "\n");
+    }
+
     /* Generate destructor */
     printer->Print(variables_,
       "/* `signature` : destroy */\n"
@@ -328,6 +538,19 @@ namespace protobluff {
       "}\n"
       "\n");
 
+    /* Generate encoder reset */
+    printer->Print(variables_,
+      "/* `signature` : reset */\n"
+      "`deprecated`"
+      "PB_INLINE void\n"
+      "`message`_encoder_reset(\n"
+      "    pb_encoder_t *encoder) {\n"
+      "  assert(pb_encoder_descriptor(encoder) == \n"
+      "    &`message`_descriptor);\n"
+      "  return pb_encoder_reset(encoder);\n"
+      "}\n"
+      "\n");
+
     /* Generate encoders for fields */
     for (size_t f = 0; f < descriptor_->field_count(); f++)
       fields_[f]->GenerateEncoder(printer);
@@ -337,13 +560,365 @@ namespace protobluff {
       nested_[n]->GenerateEncoder(printer);
   }
 
+  /*!
+   * Generate visitor.
+   *
+   * The visitor holds one typed callback per field, which is invoked with the
+   * decoded value, so handlers don't need to dispatch on the tag and type of
+   * a field at runtime. Callbacks may be left empty to skip fields. As the
+   * decoder is generated inline, it can be specialized by the compiler if the
+   * visitor is constant.
+   *
+   * \param[in,out] printer Printer
+   */
+  void Message::
+  GenerateVisitor(Printer *printer) const {
+    assert(printer);
+    if (descriptor_->field_count()) {
+
+      /* Generate visitor header */
+      printer->Print(variables_,
+        "/* `signature` : visitor */\n"
+        "typedef struct `message`_visitor_t {\n");
+
+      /* Generate visitor members */
+      printer->Indent();
+      for (size_t f = 0; f < descriptor_->field_count(); f++)
+        fields_[f]->GenerateVisitorMember(printer);
+      printer->Outdent();
+
+      /* Generate visitor footer */
+      printer->Print(variables_,
+        "} `message`_visitor_t;\n"
+        "\n");
+
+      /* Generate decoder header */
+      printer->Print(variables_,
+        "/* `signature` : decode visitor */\n"
+        "`deprecated`"
+        "PB_WARN_UNUSED_RESULT\n"
+        "PB_INLINE pb_error_t\n"
+        "`message`_decode_visitor(\n"
+        "    pb_decoder_t *decoder, const `message`_visitor_t *visitor,\n"
+        "    void *user) {\n"
+        "  assert(pb_decoder_descriptor(decoder) == \n"
+        "    &`message`_descriptor);\n"
+        "  if (!pb_decoder_valid(decoder))\n"
+        "    return PB_ERROR_INVALID;\n"
+        "  pb_error_t error = PB_ERROR_NONE;\n"
+        "\n"
+        "  /* Iterate tag-value pairs */\n"
+        "  pb_stream_t stream = pb_stream_create(pb_decoder_buffer(decoder));\n"
+        "  while (!error && pb_stream_left(&stream)) {\n"
+        "    uint32_t key;\n"
+        "    if ((error = pb_stream_read_uint32(&stream, &key)))\n"
+        "      break;\n"
+        "\n"
+        "    /* Invoke callback according to key */\n"
+        "    switch (`dispatch`) {\n");
+
+      /* Generate cases for fields, hottest first */
+      for (size_t i = 0; i < 3; i++)
+        printer->Indent();
+      for (size_t f = 0; f < descriptor_->field_count(); f++)
+        fields_[order_[f]]->GenerateVisitorCase(printer);
+      for (size_t i = 0; i < 3; i++)
+        printer->Outdent();
+
+      /* Generate decoder footer */
+      printer->Print(variables_,
+        "\n"
+        "      /* Skip unknown fields */\n"
+        "      default:\n"
+        "        error = pb_decoder_skip_field(&stream, key);\n"
+        "    }\n"
+        "  }\n"
+        "  pb_stream_destroy(&stream);\n"
+        "  return error;\n"
+        "}\n"
+        "\n");
+    }
+
+    /* Generate visitors for nested messages */
+    for (size_t n = 0; n < descriptor_->nested_type_count(); n++)
+      nested_[n]->GenerateVisitor(printer);
+  }
+
+  /*!
+   * Generate C++ wrapper.
+   *
+   * The wrapper is a struct named after the message, which references the
+   * descriptor and defines a compile-time field descriptor for every field,
+   * e.g. Person::kName, to be used with the templates in protobluff.hpp.
+   *
+   * \param[in,out] printer Printer
+   */
+  void Message::
+  GenerateWrapper(Printer *printer) const {
+    assert(printer);
+
+    /* Generate wrapper header */
+    map<string, string> variables (variables_);
+    variables["struct"] = descriptor_->name();
+    printer->Print(variables,
+      "/* `signature` : wrapper */\n"
+      "struct `struct` {\n"
+      "\n"
+      "  /* `signature` : descriptor */\n"
+      "  static const pb_descriptor_t *\n"
+      "  descriptor() {\n"
+      "    return &`message`_descriptor;\n"
+      "  }\n");
+
+    /* Generate field descriptors */
+    printer->Indent();
+    if (descriptor_->field_count()) {
+      printer->Print("\n");
+      for (size_t f = 0; f < descriptor_->field_count(); f++)
+        fields_[f]->GenerateWrapper(printer);
+    }
+
+    /* Generate wrappers for nested messages */
+    if (descriptor_->nested_type_count()) {
+      printer->Print("\n");
+      for (size_t n = 0; n < descriptor_->nested_type_count(); n++)
+        nested_[n]->GenerateWrapper(printer);
+    }
+    printer->Outdent();
+
+    /* Generate wrapper footer */
+    printer->Print(variables,
+      "};\n"
+      "\n");
+  }
+
+  /*!
+   * Generate struct.
+   *
+   * The struct holds one member per field in the order of the descriptor,
+   * followed by the presence bits, and is described by the layout. If a
+   * specialized decoder is requested, the struct decoder is only declared, as
+   * it is generated into the source file.
+   *
+   * \param[in,out] printer     Printer
+   * \param[in]     specialized Specialized decoder
+   */
+  void Message::
+  GenerateStruct(Printer *printer, bool specialized) const {
+    assert(printer);
+
+    /* Generate struct header */
+    printer->Print(variables_,
+      "/* `signature` : struct */\n"
+      "typedef struct `message`_t {\n");
+
+    /* Generate struct members */
+    printer->Indent();
+    for (size_t f = 0; f < descriptor_->field_count(); f++)
+      fields_[f]->GenerateMember(printer);
+    printer->Outdent();
+
+    /* Generate struct footer with presence bits */
+    printer->Print(
+      "  uint8_t pb_has[`size`];\n", "size",
+      SimpleItoa(descriptor_->field_count() / 8 + 1));
+    printer->Print(variables_,
+      "} `message`_t;\n"
+      "\n");
+
+    /* Generate forward declaration for layout */
+    printer->Print(variables_,
+      "/* `signature` : layout */\n"
+      "extern const pb_layout_t\n"
+      "`message`_layout;\n"
+      "\n");
+
+    /* Generate declaration of specialized struct decoder */
+    if (specialized) {
+      printer->Print(variables_,
+        "/* `signature` : decode into */\n"
+        "`deprecated`"
+        "PB_WARN_UNUSED_RESULT\n"
+        "extern pb_error_t\n"
+        "`message`_decode_into(\n"
+        "    pb_decoder_t *decoder, `message`_t *value);\n"
+        "\n");
+
+    /* Generate struct decoder */
+    } else {
+      printer->Print(variables_,
+        "/* `signature` : decode into */\n"
+        "`deprecated`"
+        "PB_WARN_UNUSED_RESULT\n"
+        "PB_INLINE pb_error_t\n"
+        "`message`_decode_into(\n"
+        "    pb_decoder_t *decoder, `message`_t *value) {\n"
+        "  assert(pb_decoder_descriptor(decoder) == \n"
+        "    &`message`_descriptor);\n"
+        "  return pb_decoder_decode_into(decoder, &`message`_layout, value);\n"
+        "}\n"
+        "\n");
+    }
+
+    /* Generate struct encoder */
+    printer->Print(variables_,
+      "/* `signature` : encode struct */\n"
+      "`deprecated`"
+      "PB_WARN_UNUSED_RESULT\n"
+      "PB_INLINE pb_error_t\n"
+      "`message`_encode_struct(\n"
+      "    pb_encoder_t *encoder, const `message`_t *value) {\n"
+      "  assert(pb_encoder_descriptor(encoder) == \n"
+      "    &`message`_descriptor);\n"
+      "  return pb_encoder_encode_struct(encoder, &`message`_layout, value);\n"
+      "}\n"
+      "\n");
+
+    /* Generate struct destructor */
+    printer->Print(variables_,
+      "/* `signature` : struct clear */\n"
+      "`deprecated`"
+      "PB_INLINE void\n"
+      "`message`_struct_clear(\n"
+      "    `message`_t *value) {\n"
+      "  pb_layout_clear(&`message`_layout, value);\n"
+      "}\n"
+      "\n");
+
+    /* Generate structs for nested messages */
+    for (size_t n = 0; n < descriptor_->nested_type_count(); n++)
+      nested_[n]->GenerateStruct(printer, specialized);
+  }
+
+  /*!
+   * Generate specialized struct decoder.
+   *
+   * The decoder switches on the key of each field, i.e. the tag combined with
+   * the wiretype, and reads singular non-message fields inline with typed
+   * reads, avoiding descriptor lookups and jump tables. All other fields are
+   * delegated to the generic path of the runtime.
+   *
+   * \param[in,out] printer Printer
+   */
+  void Message::
+  GenerateStructDecoder(Printer *printer) const {
+    assert(printer);
+
+    /* Generate decoder header */
+    printer->Print(variables_,
+      "/* `signature` : decode into */\n"
+      "extern pb_error_t\n"
+      "`message`_decode_into(\n"
+      "    pb_decoder_t *decoder, `message`_t *value) {\n"
+      "  assert(pb_decoder_descriptor(decoder) == \n"
+      "    &`message`_descriptor);\n"
+      "  if (!pb_decoder_valid(decoder))\n"
+      "    return PB_ERROR_INVALID;\n"
+      "  pb_error_t error = PB_ERROR_NONE;\n"
+      "\n"
+      "  /* Initialize struct and iterate tag-value pairs */\n"
+      "  pb_layout_init(&`message`_layout, value);\n"
+      "  pb_stream_t stream = pb_stream_create(pb_decoder_buffer(decoder));\n"
+      "  while (!error && pb_stream_left(&stream)) {\n"
+      "    uint32_t key;\n"
+      "    if ((error = pb_stream_read_uint32(&stream, &key)))\n"
+      "      break;\n"
+      "\n"
+      "    /* Decode field according to key */\n"
+      "    switch (`dispatch`) {\n");
+
+    /* Generate cases for fields, hottest first */
+    for (size_t i = 0; i < 3; i++)
+      printer->Indent();
+    for (size_t f = 0; f < descriptor_->field_count(); f++)
+      fields_[order_[f]]->GenerateStructDecoder(printer, order_[f]);
+    for (size_t i = 0; i < 3; i++)
+      printer->Outdent();
+
+    /* Generate decoder footer */
+    printer->Print(variables_,
+      "\n"
+      "      /* Delegate all other fields to generic path */\n"
+      "      default:\n"
+      "        error = pb_decoder_decode_field_into(\n"
+      "          &stream, &`message`_layout, value, key);\n"
+      "    }\n"
+      "  }\n"
+      "  pb_stream_destroy(&stream);\n"
+      "\n"
+      "  /* Clear struct on error */\n"
+      "  if (error)\n"
+      "    pb_layout_clear(&`message`_layout, value);\n"
+      "  return error;\n"
+      "}\n"
+      "\n");
+
+    /* Generate decoders for nested messages */
+    for (size_t n = 0; n < descriptor_->nested_type_count(); n++)
+      nested_[n]->GenerateStructDecoder(printer);
+  }
+
+  /*!
+   * Generate layout.
+   *
+   * \param[in,out] printer Printer
+   */
+  void Message::
+  GenerateLayout(Printer *printer) const {
+    assert(printer);
+
+    /* Generate layout header */
+    printer->Print(variables_,
+      "/* `signature` : layout */\n"
+      "const pb_layout_t\n"
+      "`message`_layout = { &`message`_descriptor, {\n");
+
+    /* Generate field layouts */
+    if (descriptor_->field_count()) {
+      printer->Print(
+        "  (const pb_layout_field_t []){\n");
+      for (size_t i = 0; i < 2; i++)
+        printer->Indent();
+      for (size_t f = 0; f < descriptor_->field_count(); f++) {
+        fields_[f]->GenerateLayout(printer);
+        if (f < descriptor_->field_count() - 1)
+          printer->Print(",");
+        printer->Print("\n");
+      }
+      for (size_t i = 0; i < 2; i++)
+        printer->Outdent();
+      printer->Print(
+        "  }, `fields` }, ", "fields",
+        SimpleItoa(descriptor_->field_count()));
+
+    /* Generate empty field layouts, if message contains no fields */
+    } else {
+      printer->Print(
+        "  NULL, 0 }, ");
+    }
+
+    /* Generate layout footer */
+    printer->Print(variables_,
+      "offsetof(`message`_t, pb_has),\n"
+      "  sizeof(`message`_t) };\n"
+      "\n");
+
+    /* Generate layouts for nested messages */
+    for (size_t n = 0; n < descriptor_->nested_type_count(); n++)
+      nested_[n]->GenerateLayout(printer);
+  }
+
   /*!
    * Generate accessors.
    *
+   * If structs are requested, an accessor reading all singular fields into a
+   * struct in a single pass is generated as well.
+   *
    * \param[in,out] printer Printer
+   * \param[in]     structs Structs
    */
   void Message::
-  GenerateAccessors(Printer *printer) const {
+  GenerateAccessors(Printer *printer, bool structs) const {
     assert(printer);
 
     /* Generate constructor */
@@ -372,13 +947,28 @@ namespace protobluff {
       "}\n"
       "\n");
 
+    /* Generate struct accessor, if requested */
+    if (structs)
+      printer->Print(variables_,
+        "/* `signature` : get fields */\n"
+        "`deprecated`"
+        "PB_WARN_UNUSED_RESULT\n"
+        "PB_INLINE pb_error_t\n"
+        "`message`_get_fields(\n"
+        "    pb_message_t *message, `message`_t *value) {\n"
+        "  assert(pb_message_descriptor(message) == \n"
+        "    &`message`_descriptor);\n"
+        "  return pb_message_get_fields(message, &`message`_layout, value);\n"
+        "}\n"
+        "\n");
+
     /* Generate accessors for fields */
     for (size_t f = 0; f < descriptor_->field_count(); f++)
       fields_[f]->GenerateAccessors(printer);
 
     /* Generate accessors for nested messages */
     for (size_t n = 0; n < descriptor_->nested_type_count(); n++)
-      nested_[n]->GenerateAccessors(printer);
+      nested_[n]->GenerateAccessors(printer, structs);
   }
 
   /*!
@@ -531,4 +1121,106 @@ namespace protobluff {
     }
     return extensions;
   }
+
+  /*!
+   * Determine the maximum encoded size of a message, if bounded.
+   *
+   * The size is bounded if the message and all nested messages contain only
+   * singular scalar fields, i.e. no repeated fields, strings or bytes, and
+   * neither define extensions, nor refer to themselves. Of the fields of a
+   * oneof, only the largest is accounted for.
+   *
+   * \param[in]     descriptor Descriptor
+   * \param[in,out] trace      Trace
+   * \param[out]    size       Maximum encoded size
+   * \return                   Test result
+   */
+  bool Message::
+  MaxSize(
+      const Descriptor *descriptor, vector<const Descriptor *> &trace,
+      size_t *size) {
+    assert(descriptor && size);
+    if (descriptor->extension_range_count() ||
+        find(trace.begin(), trace.end(), descriptor) != trace.end())
+      return false;
+
+    /* Accumulate maximum sizes of fields, and of oneofs separately */
+    trace.push_back(descriptor);
+    vector<size_t> oneofs (descriptor->oneof_decl_count(), 0);
+    size_t total = 0;
+    bool bounded = true;
+    for (size_t f = 0; bounded && f < descriptor->field_count(); f++) {
+      const FieldDescriptor *field = descriptor->field(f);
+      if (field->is_repeated()) {
+        bounded = false;
+        break;
+      }
+
+      /* Determine maximum size of value */
+      size_t value = 0;
+      switch (field->type()) {
+        case FieldDescriptor::TYPE_BOOL:
+          value = 1;
+          break;
+        case FieldDescriptor::TYPE_FIXED32:
+        case FieldDescriptor::TYPE_SFIXED32:
+        case FieldDescriptor::TYPE_FLOAT:
+          value = 4;
+          break;
+        case FieldDescriptor::TYPE_UINT32:
+        case FieldDescriptor::TYPE_SINT32:
+          value = 5;
+          break;
+        case FieldDescriptor::TYPE_FIXED64:
+        case FieldDescriptor::TYPE_SFIXED64:
+        case FieldDescriptor::TYPE_DOUBLE:
+          value = 8;
+          break;
+        case FieldDescriptor::TYPE_INT32:
+        case FieldDescriptor::TYPE_INT64:
+        case FieldDescriptor::TYPE_UINT64:
+        case FieldDescriptor::TYPE_SINT64:
+        case FieldDescriptor::TYPE_ENUM:
+          value = 10;
+          break;
+        case FieldDescriptor::TYPE_MESSAGE:
+          bounded = MaxSize(field->message_type(), trace, &value);
+          value  += VarintSize(value);
+          break;
+        default:
+          bounded = false;
+          break;
+      }
+
+      /* Add size of tag and account for largest field of oneof only */
+      value += VarintSize(static_cast<uint64_t>(field->number()) << 3);
+      if (field->containing_oneof()) {
+        size_t &oneof = oneofs[field->containing_oneof()->index()];
+        oneof = max(oneof, value);
+      } else {
+        total += value;
+      }
+    }
+    trace.pop_back();
+
+    /* Add maximum sizes of oneofs */
+    for (size_t o = 0; o < oneofs.size(); o++)
+      total += oneofs[o];
+    *size = total;
+    return bounded;
+  }
+
+  /*!
+   * Determine the size of a value encoded as a variable-sized integer.
+   *
+   * \param[in] value Value
+   * \return          Encoded size
+   */
+  size_t Message::
+  VarintSize(uint64_t value) {
+    size_t size = 1;
+    while (value >>= 7)
+      size++;
+    return size;
+  }
 }
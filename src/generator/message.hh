@@ -35,6 +35,7 @@
 #include "generator/extension.hh"
 #include "generator/field.hh"
 #include "generator/oneof.hh"
+#include "generator/profile.hh"
 
 /* ----------------------------------------------------------------------------
  * Interface
@@ -56,7 +57,8 @@ namespace protobluff {
   public:
     explicit
     Message(
-      const Descriptor *descriptor);   /* Descriptor */
+      const Descriptor *descriptor,    /* Descriptor */
+      const Profile *profile = NULL);  /* Field-frequency profile */
 
     void
     GenerateTags(
@@ -89,10 +91,37 @@ namespace protobluff {
     const;
 
     void
-    GenerateAccessors(
+    GenerateVisitor(
+      Printer *printer)                /* Printer */
+    const;
+
+    void
+    GenerateWrapper(
+      Printer *printer)                /* Printer */
+    const;
+
+    void
+    GenerateStruct(
+      Printer *printer,                /* Printer */
+      bool specialized)                /* Specialized decoder */
+    const;
+
+    void
+    GenerateStructDecoder(
       Printer *printer)                /* Printer */
     const;
 
+    void
+    GenerateLayout(
+      Printer *printer)                /* Printer */
+    const;
+
+    void
+    GenerateAccessors(
+      Printer *printer,                /* Printer */
+      bool structs)                    /* Structs */
+    const;
+
     void
     GenerateAccessors(
       Printer *printer,                /* Printer */
@@ -144,7 +173,20 @@ namespace protobluff {
       unique_ptr<Message>[]
     > nested_;                         /* Nested message generators */
     vector<Extension *> extensions_;   /* Extension generators */
+    vector<size_t> order_;             /* Field positions by frequency */
     map<string, string> variables_;    /* Variables */
+
+    static bool
+    MaxSize(
+      const Descriptor *descriptor,    /* Descriptor */
+      vector<
+        const Descriptor *
+      > &trace,                        /* Trace */
+      size_t *size);                   /* Maximum encoded size */
+
+    static size_t
+    VarintSize(
+      uint64_t value);                 /* Value */
   };
 }
 
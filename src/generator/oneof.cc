@@ -169,11 +169,28 @@ namespace protobluff {
       "  assert(pb_message_descriptor(message) == \n"
       "    &`message`_descriptor);\n"
       "  pb_oneof_t oneof = pb_oneof_create(\n"
-      "    &`message`_descriptor, message);\n"
+      "    &`oneof`_descriptor, message);\n"
       "  pb_tag_t tag = pb_oneof_case(&oneof);\n"
       "  pb_oneof_destroy(&oneof);\n"
       "  return tag;\n"
       "}\n"
       "\n");
+
+    /* Generate dispatch to handlers by member position */
+    printer->Print(variables_,
+      "/* `signature` : dispatch */\n"
+      "PB_INLINE pb_error_t\n"
+      "`message`_dispatch_`name`(\n"
+      "    pb_message_t *message, const pb_oneof_handler_f handlers[],\n"
+      "    void *user) {\n"
+      "  assert(pb_message_descriptor(message) == \n"
+      "    &`message`_descriptor);\n"
+      "  pb_oneof_t oneof = pb_oneof_create(\n"
+      "    &`oneof`_descriptor, message);\n"
+      "  pb_error_t error = pb_oneof_dispatch(&oneof, handlers, user);\n"
+      "  pb_oneof_destroy(&oneof);\n"
+      "  return error;\n"
+      "}\n"
+      "\n");
   }
 }
@@ -0,0 +1,127 @@
+/*
+ * Copyright (c) 2013-2020 Martin Donath <martin.donath@squidfunk.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <cassert>
+#include <cstdint>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+
+#include <google/protobuf/descriptor.h>
+#include <google/protobuf/stubs/common.h>
+
+#include "generator/profile.hh"
+#include "generator/strutil.hh"
+
+/* ----------------------------------------------------------------------------
+ * Interface
+ * ------------------------------------------------------------------------- */
+
+namespace protobluff {
+
+  using ::std::ifstream;
+  using ::std::istringstream;
+  using ::std::map;
+  using ::std::string;
+
+  using ::google::protobuf::Descriptor;
+  using ::google::protobuf::FieldDescriptor;
+
+  using ::google::protobuf::SimpleItoa;
+
+  /*!
+   * Load a field-frequency profile from a file.
+   *
+   * Every line of a profile lists the fully qualified name of a message, the
+   * tag of a field and the number of occurrences of the field, separated by
+   * whitespace, as collected through pb_stats_fields(). Empty lines and lines
+   * starting with a hash are ignored, and occurrences of the same field are
+   * summed up, so profiles of multiple processes can just be concatenated.
+   *
+   * \param[in]  path  Path
+   * \param[out] error Error pointer
+   * \return           Whether the profile was loaded
+   */
+  bool Profile::
+  Load(const string &path, string *error) {
+    assert(error);
+    ifstream file (path.c_str());
+    if (!file) {
+      *error = "Unable to open profile: " + path;
+      return false;
+    }
+
+    /* Parse lines of message name, tag and occurrences */
+    string line;
+    for (size_t l = 1; getline(file, line); l++) {
+      istringstream stream (line);
+      string name, rest;
+      int tag;
+      uint64_t count;
+      if (!(stream >> name) || name[0] == '#')
+        continue;
+      if (!(stream >> tag >> count) || tag <= 0 || stream >> rest) {
+        *error = "Invalid profile: " + path + ":" + SimpleItoa(l);
+        return false;
+      }
+
+      /* Strip leading dot of fully qualified name */
+      if (name[0] == '.')
+        name.erase(0, 1);
+      count_[name][tag] += count;
+    }
+    return true;
+  }
+
+  /*!
+   * Check whether a profile contains a message.
+   *
+   * \param[in] descriptor Descriptor
+   * \return               Test result
+   */
+  bool Profile::
+  Has(const Descriptor *descriptor) const {
+    assert(descriptor);
+    return count_.find(descriptor->full_name()) != count_.end();
+  }
+
+  /*!
+   * Retrieve the number of occurrences of a field.
+   *
+   * \param[in] descriptor Field descriptor
+   * \return               Occurrences
+   */
+  uint64_t Profile::
+  Count(const FieldDescriptor *descriptor) const {
+    assert(descriptor);
+    map<string, map<int, uint64_t> >::const_iterator message =
+      count_.find(descriptor->containing_type()->full_name());
+    if (message == count_.end())
+      return 0;
+
+    /* Look up occurrences by tag */
+    map<int, uint64_t>::const_iterator field =
+      message->second.find(descriptor->number());
+    return field != message->second.end() ? field->second : 0;
+  }
+}
@@ -0,0 +1,160 @@
+/*
+ * Copyright (c) 2013-2020 Martin Donath <martin.donath@squidfunk.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#include <assert.h>
+#include <stdlib.h>
+
+#include "core/descriptor.h"
+#include "message/appender.h"
+#include "message/common.h"
+#include "message/field.h"
+#include "message/journal.h"
+#include "message/message.h"
+#include "message/part.h"
+
+/* ----------------------------------------------------------------------------
+ * Interface
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Create an appender for a repeated tag of a message.
+ *
+ * Creating a repeated field or submessage within a message needs to scan the
+ * message for the insertion point, which makes appending many elements one
+ * after another quadratic. An appender remembers the part of the element it
+ * appended last, so the next element is directly created after it. Values of
+ * packed fields are appended to the packed field of the last element.
+ *
+ * \warning Elements appended through other means while using an appender may
+ * end up behind elements appended later through the appender, as the order of
+ * elements is not checked.
+ *
+ * \param[in,out] message Message
+ * \param[in]     tag     Tag
+ * \return                Appender
+ */
+extern pb_appender_t
+pb_appender_create(pb_message_t *message, pb_tag_t tag) {
+  assert(message && tag);
+  pb_appender_t appender = {
+    .message = pb_message_create_invalid(),
+    .tag     = tag,
+    .part    = pb_part_create_invalid()
+  };
+  if (pb_message_valid(message)) {
+
+#ifndef NDEBUG
+
+    /* Assert repeated descriptor */
+    const pb_field_descriptor_t *descriptor =
+      pb_descriptor_field_by_tag(pb_message_descriptor(message), tag);
+    assert(descriptor &&
+      pb_field_descriptor_label(descriptor) == PB_LABEL_REPEATED);
+
+#endif /* NDEBUG */
+
+    /* Reference message */
+    appender.message = pb_message_copy(message);
+  }
+  return appender;
+}
+
+/*!
+ * Destroy an appender.
+ *
+ * \param[in,out] appender Appender
+ */
+extern void
+pb_appender_destroy(pb_appender_t *appender) {
+  assert(appender);
+  pb_part_destroy(&(appender->part));
+  pb_message_destroy(&(appender->message));
+}
+
+/*!
+ * Append a value or submessage to the repeated tag of an appender.
+ *
+ * The first element is created by scanning the message, just like writing
+ * a repeated field with pb_message_put(). All subsequent elements are created
+ * directly after the last one, unless it was erased in the meantime.
+ *
+ * \warning In order to avoid any side-effects when appending a submessage,
+ * both messages are not allowed to share a common journal.
+ *
+ * \warning The caller has to ensure that the space pointed to by the value
+ * pointer is appropriately sized for the type of field.
+ *
+ * \param[in,out] appender Appender
+ * \param[in]     value    Pointer holding value
+ * \return                 Error code
+ */
+extern pb_error_t
+pb_appender_put(pb_appender_t *appender, const void *value) {
+  assert(appender && value);
+  if (unlikely_(!pb_appender_valid(appender)))
+    return PB_ERROR_INVALID;
+  pb_message_t *message = &(appender->message);
+  pb_error_t error = PB_ERROR_NONE;
+
+  /* Create part after last element or scan message for insertion point */
+  pb_part_t part = pb_part_create_invalid();
+  if (pb_part_valid(&(appender->part)))
+    part = pb_part_create_after(message, appender->tag, &(appender->part));
+  if (!pb_part_valid(&part))
+    part = pb_part_create(message, appender->tag);
+  if (unlikely_(!pb_part_valid(&part)))
+    return PB_ERROR_INVALID;
+
+  /* Write value to part */
+  const pb_field_descriptor_t *descriptor =
+    pb_descriptor_field_by_tag(pb_message_descriptor(message), appender->tag);
+  if (pb_field_descriptor_type(descriptor) != PB_TYPE_MESSAGE) {
+    pb_field_t field = {
+      .descriptor = descriptor,
+      .part       = part
+    };
+    error = pb_field_put(&field, value);
+    part  = field.part;
+
+  /* Write submessage to part */
+  } else {
+    pb_message_t submessage = pb_message_copy(value);
+    assert(pb_message_journal(message) != pb_message_journal(&submessage));
+    if (unlikely_(!pb_message_valid(&submessage) ||
+                   pb_message_align(&submessage))) {
+      error = PB_ERROR_INVALID;
+
+    /* Write raw data, if any */
+    } else if (!pb_message_empty(&submessage)) {
+      error = pb_part_write(&part, pb_journal_data_from(
+        pb_message_journal(&submessage), pb_message_start(&submessage)),
+          pb_message_size(&submessage));
+    }
+    pb_message_destroy(&submessage);
+  }
+
+  /* Remember part of last element */
+  pb_part_destroy(&(appender->part));
+  appender->part = part;
+  if (unlikely_(error))
+    pb_part_destroy(&(appender->part));
+  return error;
+}
@@ -27,6 +27,7 @@
 #include <string.h>
 
 #include "core/allocator.h"
+#include "core/stats.h"
 #include "message/buffer.h"
 #include "message/common.h"
 
@@ -38,9 +39,9 @@
  * Write data to a buffer.
  *
  * The buffer's internal state is fully recoverable. If allocation fails upon
- * growing the buffer, the buffer is not altered. In case of a shrinking buffer,
- * a failure will be silently tolerated, since excess memory is not critical.
- * Thus, shrinking a buffer will always work.
+ * growing the buffer, the buffer is not altered. The capacity of the buffer
+ * grows geometrically and is retained when the buffer shrinks, so excess
+ * memory must be released explicitly through pb_buffer_shrink_to_fit().
  *
  * \param[in,out] buffer Buffer
  * \param[in]     start  Start offset
@@ -67,28 +68,15 @@ pb_buffer_write(
     if (unlikely_(buffer->allocator == &allocator_zero_copy))
       return PB_ERROR_ALLOC;
 
-    /* Buffer grows, so grow space and then move data */
-    if (delta > 0) {
-      uint8_t *new_data = pb_allocator_resize(buffer->allocator,
-        buffer->data, buffer->size + delta);
-      if (new_data) {
-        buffer->data = new_data;
-        if (end < buffer->size)
-          memmove(&(buffer->data[end + delta]), &(buffer->data[end]),
-            buffer->size - end);
-      } else {
-        return PB_ERROR_ALLOC;
-      }
+    /* Buffer grows, so ensure capacity and then move data */
+    if (delta > 0 && unlikely_(pb_buffer_ensure(buffer, buffer->size + delta)))
+      return PB_ERROR_ALLOC;
 
-    /* Buffer shrinks, so move data and then shrink space */
-    } else {
-      if (end < buffer->size)
-        memmove(&(buffer->data[end + delta]), &(buffer->data[end]),
-          buffer->size - end);
-      uint8_t *new_data = pb_allocator_resize(buffer->allocator,
-        buffer->data, buffer->size + delta);
-      if (new_data)
-        buffer->data = new_data;
+    /* Move data, retaining capacity if the buffer shrinks */
+    if (end < buffer->size) {
+      memmove(&(buffer->data[end + delta]), &(buffer->data[end]),
+        buffer->size - end);
+      pb_stats_add(moved, buffer->size - end);
     }
 
     /* Update buffer size */
@@ -127,20 +115,19 @@ pb_buffer_clear(pb_buffer_t *buffer, size_t start, size_t end) {
     if (unlikely_(buffer->allocator == &allocator_zero_copy))
       return PB_ERROR_ALLOC;
 
-    /* Buffer shrinks, so move data and then shrink space */
+    /* Buffer shrinks, so move data and retain capacity */
     if (buffer->size + delta) {
-      if (end < buffer->size)
+      if (end < buffer->size) {
         memmove(&(buffer->data[end + delta]), &(buffer->data[end]),
           buffer->size - end);
-      uint8_t *new_data = pb_allocator_resize(buffer->allocator,
-        buffer->data, buffer->size + delta);
-      if (new_data)
-        buffer->data = new_data;
+        pb_stats_add(moved, buffer->size - end);
+      }
 
-    /* Buffer is cleared completely, so free space */
-    } else {
+    /* Buffer is cleared completely, so free space unless fixed */
+    } else if (buffer->allocator != &allocator_fixed) {
       pb_allocator_free(buffer->allocator, buffer->data);
-      buffer->data = NULL;
+      buffer->data     = NULL;
+      buffer->capacity = 0;
     }
 
     /* Update buffer size */
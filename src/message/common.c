@@ -35,7 +35,11 @@ error_map[] = {
   [PB_ERROR_VARINT]     = "Invalid varint",
   [PB_ERROR_OFFSET]     = "Invalid offset",
   [PB_ERROR_ABSENT]     = "Absent field or value",
-  [PB_ERROR_EOM]        = "Cursor reached end of message"
+  [PB_ERROR_EOM]        = "Cursor reached end of message",
+  [PB_ERROR_DEPTH]      = "Nesting depth exceeded",
+  [PB_ERROR_SIZE]       = "Message size exceeded",
+  [PB_ERROR_FIELDS]     = "Field count exceeded",
+  [PB_ERROR_LENGTH]     = "String length exceeded"
 };
 
 /* ----------------------------------------------------------------------------
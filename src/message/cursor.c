@@ -23,9 +23,13 @@
 #include <assert.h>
 #include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "core/descriptor.h"
+#include "core/stats.h"
 #include "core/stream.h"
+#include "core/utf8.h"
+#include "core/varint.h"
 #include "message/buffer.h"
 #include "message/common.h"
 #include "message/cursor.h"
@@ -33,6 +37,7 @@
 #include "message/journal.h"
 #include "message/message.h"
 #include "message/part.h"
+#include "message/trace.h"
 
 /* ----------------------------------------------------------------------------
  * Internal functions
@@ -85,6 +90,47 @@ next_packed(pb_cursor_t *cursor) {
   return packed->end = 0;
 }
 
+/*!
+ * Skip a field, if its raw tag doesn't match the given encoded tag.
+ *
+ * Tags are compared without decoding, ignoring the wiretype bits. As a tag
+ * may be encoded with padding, only minimally encoded tags are skipped,
+ * which is the common case. Malformed fields are left to the caller.
+ *
+ * \param[in,out] stream   Stream
+ * \param[in]     key[]    Encoded tag
+ * \param[in]     key_size Encoded tag size
+ * \return                 Error code
+ */
+static pb_error_t
+skip(pb_stream_t *stream, const uint8_t key[], size_t key_size) {
+  assert(stream && key && key_size);
+  const uint8_t *data = pb_buffer_data_from(
+    pb_stream_buffer(stream), pb_stream_offset(stream));
+  size_t size = pb_varint_scan(data, pb_stream_left(stream));
+  if (unlikely_(!size) || (size > 1 && !data[size - 1]))
+    return PB_ERROR_VARINT;
+
+  /* Compare raw tags */
+  if (size == key_size && (data[0] & ~7) == key[0] &&
+      !memcmp(&(data[1]), &(key[1]), size - 1))
+    return PB_ERROR_INVALID;
+
+  /* Skip tag and field contents, if the wiretype is valid */
+  pb_wiretype_t wiretype = data[0] & 7;
+  if (wiretype != PB_WIRETYPE_VARINT && wiretype != PB_WIRETYPE_64BIT &&
+      wiretype != PB_WIRETYPE_LENGTH && wiretype != PB_WIRETYPE_32BIT)
+    return PB_ERROR_INVALID;
+  pb_stream_t temp = pb_stream_create_at(
+    pb_stream_buffer(stream), pb_stream_offset(stream) + size);
+  pb_error_t error = pb_stream_skip(&temp, wiretype);
+  if (likely_(!error))
+    error = pb_stream_advance(stream,
+      pb_stream_offset(&temp) - pb_stream_offset(stream));
+  pb_stream_destroy(&temp);
+  return error;
+}
+
 /*!
  * Move a cursor to the next field.
  *
@@ -97,15 +143,29 @@ next(pb_cursor_t *cursor) {
   pb_offset_t *offset = &(cursor->current.offset),
               *packed = &(cursor->current.packed);
 
-  /* Create temporary buffer to read the next value */
+  /* Create temporary buffer to read the next value up to the partition end */
   pb_buffer_t buffer = pb_buffer_create_zero_copy_internal(
-    pb_journal_data_from(pb_cursor_journal(cursor), 0),
-      pb_message_end(&(cursor->message)));
+    pb_journal_data_from(pb_cursor_journal(cursor), 0), cursor->end
+      ? cursor->end
+      : pb_message_end(&(cursor->message)));
+
+  /* Encode tag to look for, if given, to compare raw tags */
+  uint8_t key[5]; size_t key_size = 0;
+  if (cursor->tag) {
+    uint32_t value = cursor->tag << 3;
+    key_size = pb_varint_pack_uint32(key, &value);
+  }
 
   /* Create stream over temporary buffer */
   pb_stream_t stream = pb_stream_create_at(&buffer, offset->end);
   while (pb_stream_left(&stream)) {
 
+    /* Fast-skip fields with minimally encoded tags that don't match */
+    if (key_size && !skip(&stream, key, key_size)) {
+      offset->start = offset->end = pb_stream_offset(&stream);
+      continue;
+    }
+
     /* Adjust offsets */
     offset->start       = offset->end;
     offset->diff.origin = pb_message_start(&(cursor->message));
@@ -125,6 +185,7 @@ next(pb_cursor_t *cursor) {
     if (wiretype == PB_WIRETYPE_LENGTH) {
       if ((cursor->error = pb_stream_read(&stream, PB_TYPE_UINT32, &length)))
         break;
+      pb_stream_prefetch(&stream, length);
       offset->start = pb_stream_offset(&stream);
       if ((cursor->error = pb_stream_advance(&stream, length)))
         break;
@@ -145,8 +206,8 @@ next(pb_cursor_t *cursor) {
       continue;
 
     /* Otherwise try to load descriptor for current tag */
-    } else if (!cursor->current.descriptor ||
-        pb_field_descriptor_tag(cursor->current.descriptor) != tag) {
+    } else if (!cursor->current.descriptor || (!cursor->tag &&
+        pb_field_descriptor_tag(cursor->current.descriptor) != tag)) {
       if (!(cursor->current.descriptor = pb_descriptor_field_by_tag(
           pb_message_descriptor(&(cursor->message)), tag)))
         continue;
@@ -179,6 +240,116 @@ next(pb_cursor_t *cursor) {
   return 0;
 }
 
+/*!
+ * Look up a field in the index of field offsets of the underlying journal.
+ *
+ * The index only covers the root message, and only as long as the journal
+ * was not written to, so NULL is returned for all other messages.
+ *
+ * \param[in,out] message Message
+ * \param[in]     tag     Tag
+ * \return                Entry
+ */
+static const pb_decoder_index_entry_t *
+lookup(pb_message_t *message, pb_tag_t tag) {
+  assert(message && tag);
+  const pb_decoder_index_t *index =
+    pb_journal_index(pb_message_journal(message));
+  return index && index->descriptor == pb_message_descriptor(message) &&
+      !pb_message_start(message) && pb_message_end(message) == index->size
+    ? pb_decoder_index_find(index, tag)
+    : NULL;
+}
+
+/*!
+ * Check whether another member of a oneof occurs after the given field.
+ *
+ * \param[in,out] message    Message
+ * \param[in]     descriptor Field descriptor
+ * \param[in]     entry      Entry of field
+ * \return                   Test result
+ */
+static int
+superseded(
+    pb_message_t *message, const pb_field_descriptor_t *descriptor,
+    const pb_decoder_index_entry_t *entry) {
+  assert(message && descriptor && entry);
+  const pb_descriptor_t *parent = pb_message_descriptor(message);
+  for (size_t f = 0; f < pb_descriptor_size(parent); f++) {
+    const pb_field_descriptor_t *member = &(parent->field.data[f]);
+    if (member != descriptor && pb_field_descriptor_oneof(member) ==
+        pb_field_descriptor_oneof(descriptor)) {
+      const pb_decoder_index_entry_t *other =
+        lookup(message, pb_field_descriptor_tag(member));
+      if (other && other->count && other->last > entry->last)
+        return 1;
+    }
+  }
+  return 0;
+}
+
+/*!
+ * Create a cursor over a message, starting at an indexed occurrence.
+ *
+ * If the underlying journal holds an index of field offsets covering the
+ * message, the cursor starts right at the first occurrence of the field, or
+ * at the last one if requested and the field is non-repeated, without
+ * scanning the fields in front of it. The entry is returned, or NULL if the
+ * field is not indexed.
+ *
+ * \param[in,out] message Message
+ * \param[in]     tag     Tag
+ * \param[in]     last    Whether to start at the last occurrence
+ * \param[out]    entry   Entry of field
+ * \return                Cursor
+ */
+static pb_cursor_t
+create(
+    pb_message_t *message, pb_tag_t tag, int last,
+    const pb_decoder_index_entry_t **entry) {
+  assert(message && entry);
+  *entry = NULL;
+  if (pb_message_valid(message) && !pb_part_focus(&(message->part)) &&
+      !pb_message_align(message)) {
+    const pb_field_descriptor_t *descriptor = tag
+      ? pb_descriptor_field_by_tag(pb_message_descriptor(message), tag)
+      : NULL;
+
+    /* Start at the indexed occurrence, or at the end if there is none */
+    size_t offset = pb_message_start(message);
+    if (descriptor && (*entry = lookup(message, tag))) {
+      last = last && pb_field_descriptor_label(descriptor) != PB_LABEL_REPEATED;
+      offset = (*entry)->count
+        ? last ? (*entry)->last : (*entry)->first
+        : pb_message_end(message);
+    }
+    pb_cursor_t cursor = {
+      .message = pb_message_copy(message),
+      .tag     = tag,
+      .current = {
+        .descriptor = descriptor,
+        .offset     = {
+          .start = offset,
+          .end   = offset,
+          .diff  = {
+            .origin = 0,
+            .tag    = 0,
+            .length = 0
+          }
+        }
+      },
+      .pos   = SIZE_MAX, /* = uninitialized */
+      .error = PB_ERROR_NONE
+    };
+    if (!pb_cursor_next(&cursor))
+      cursor.pos = 0;
+    else if (*entry && last)
+      cursor.pos = (*entry)->count - 1;
+    return cursor;
+  }
+  return pb_cursor_create_invalid();
+}
+
 /* ----------------------------------------------------------------------------
  * Interface
  * ------------------------------------------------------------------------- */
@@ -204,12 +375,15 @@ next(pb_cursor_t *cursor) {
 extern pb_cursor_t
 pb_cursor_create(pb_message_t *message, pb_tag_t tag) {
   assert(message && tag);
-  pb_cursor_t cursor = pb_cursor_create_unsafe(message, tag);
+  const pb_decoder_index_entry_t *entry;
+  pb_cursor_t cursor = create(message, tag, 1, &entry);
   if (pb_cursor_valid(&cursor)) {
     const pb_field_descriptor_t *descriptor = cursor.current.descriptor;
 
-    /* If the field is non-repeated, move the cursor to the last occurrence */
-    if (pb_field_descriptor_label(descriptor) != PB_LABEL_REPEATED) {
+    /* If the field is non-repeated, move the cursor to the last occurrence,
+       unless it was looked up, or the last occurrence is packed */
+    if (pb_field_descriptor_label(descriptor) != PB_LABEL_REPEATED &&
+        (!entry || cursor.current.packed.end)) {
       pb_cursor_t temp = pb_cursor_copy(&cursor);
       while (pb_cursor_next(&temp)) {
         if (tag == pb_cursor_tag(&temp)) {
@@ -218,9 +392,14 @@ pb_cursor_create(pb_message_t *message, pb_tag_t tag) {
         }
       }
       pb_cursor_destroy(&temp);
+    }
 
-      /* If the tag is part of a oneof ensure it is the active tag */
-      if (pb_field_descriptor_label(descriptor) == PB_LABEL_ONEOF) {
+    /* If the tag is part of a oneof ensure it is the active tag */
+    if (pb_field_descriptor_label(descriptor) == PB_LABEL_ONEOF) {
+      if (entry) {
+        if (superseded(message, descriptor, entry))
+          cursor.error = PB_ERROR_EOM;
+      } else {
         pb_cursor_t temp = pb_cursor_copy(&cursor); temp.tag = 0;
         while (pb_cursor_next(&temp)) {
           int member = pb_field_descriptor_oneof(descriptor) ==
@@ -250,33 +429,8 @@ pb_cursor_create(pb_message_t *message, pb_tag_t tag) {
 extern pb_cursor_t
 pb_cursor_create_unsafe(pb_message_t *message, pb_tag_t tag) {
   assert(message);
-  if (pb_message_valid(message) && !pb_message_align(message)) {
-    const pb_field_descriptor_t *descriptor = tag
-      ? pb_descriptor_field_by_tag(pb_message_descriptor(message), tag)
-      : NULL;
-    pb_cursor_t cursor = {
-      .message = pb_message_copy(message),
-      .tag     = tag,
-      .current = {
-        .descriptor = descriptor,
-        .offset     = {
-          .start = pb_message_start(message),
-          .end   = pb_message_start(message),
-          .diff  = {
-            .origin = 0,
-            .tag    = 0,
-            .length = 0
-          }
-        }
-      },
-      .pos   = SIZE_MAX, /* = uninitialized */
-      .error = PB_ERROR_NONE
-    };
-    if (!pb_cursor_next(&cursor))
-      cursor.pos = 0;
-    return cursor;
-  }
-  return pb_cursor_create_invalid();
+  const pb_decoder_index_entry_t *entry;
+  return create(message, tag, 0, &entry);
 }
 
 /*!
@@ -325,8 +479,13 @@ pb_cursor_destroy(pb_cursor_t *cursor) {
 extern int
 pb_cursor_next(pb_cursor_t *cursor) {
   assert(cursor);
+  pb_stats_measure(PB_STATS_CURSOR_NEXT, cursor->message.descriptor);
   int result = 0;
   if (pb_cursor_valid(cursor)) {
+
+    /* Resolve pending updates of batch, if the cursor switched messages */
+    if (unlikely_((cursor->error = pb_part_focus(&(cursor->message.part)))))
+      return 0;                                            /* LCOV_EXCL_LINE */
     pb_cursor_align(cursor);
     do {
       result = cursor->current.packed.end
@@ -436,11 +595,158 @@ pb_cursor_get(pb_cursor_t *cursor, void *value) {
       pb_field_t field = pb_field_create_from_cursor(cursor);
       error = pb_field_get(&field, value);
       pb_field_destroy(&field);
+
+      /* Validate strings, if flagged */
+      if (!error && pb_field_descriptor_type(descriptor) == PB_TYPE_STRING &&
+          pb_field_descriptor_utf8(descriptor) && !pb_utf8_valid(
+            pb_string_data(value), pb_string_size(value)))
+        error = PB_ERROR_INVALID;
     }
   }
   return error;
 }
 
+/*!
+ * Read all values from the current field of a cursor onwards.
+ *
+ * The values are copied to the given array in a single pass without moving
+ * the cursor, regardless of whether the field is packed or not. On input,
+ * the size denotes the capacity of the array, on output the number of values.
+ * If the array is NULL, only the number of values is determined, so the
+ * caller can allocate an appropriately sized array. If the capacity does not
+ * suffice, the array is filled up to its capacity and an error is returned.
+ *
+ * \warning The caller has to ensure that the space pointed to by the values
+ * pointer is appropriately sized for the type of field.
+ *
+ * \param[in,out] cursor Cursor
+ * \param[out]    values Pointer receiving values
+ * \param[in,out] size   Value count
+ * \return               Error code
+ */
+extern pb_error_t
+pb_cursor_get_all(pb_cursor_t *cursor, void *values, size_t *size) {
+  assert(cursor && size);
+  size_t capacity = values ? *size : 0, count = 0;
+  *size = 0;
+  if (unlikely_(!pb_cursor_valid(cursor)))
+    return pb_cursor_error(cursor);
+
+  /* Values can only be read for a specific non-message field */
+  const pb_field_descriptor_t *descriptor = cursor->current.descriptor;
+  if (unlikely_(!cursor->tag ||
+      pb_field_descriptor_type(descriptor) == PB_TYPE_MESSAGE))
+    return PB_ERROR_INVALID;
+  pb_type_t type = pb_field_descriptor_type(descriptor);
+  size_t type_size = pb_field_descriptor_type_size(descriptor);
+
+  /* Iterate a copy of the cursor and read values straight from the buffer */
+  pb_cursor_t temp = pb_cursor_copy(cursor);
+  pb_error_t error = pb_cursor_align(&temp);
+  if (likely_(!error)) {
+    do {
+      if (count < capacity) {
+        const pb_offset_t *offset = pb_cursor_offset(&temp);
+        pb_stream_t stream = pb_stream_create_at(
+          pb_journal_buffer(pb_cursor_journal(&temp)),
+          offset->start + offset->diff.length);
+        error = pb_stream_read(&stream, type,
+          (uint8_t *)values + count * type_size);
+        pb_stream_destroy(&stream);
+        if (unlikely_(error))
+          break;
+      }
+      count++;
+    } while (pb_cursor_next(&temp));
+    if (!error && pb_cursor_error(&temp) != PB_ERROR_EOM)
+      error = pb_cursor_error(&temp);
+  }
+  pb_cursor_destroy(&temp);
+
+  /* Return number of values and check capacity */
+  *size = count;
+  if (!error && values && count > capacity)
+    error = PB_ERROR_OFFSET;
+  return error;
+}
+
+/*!
+ * Split the occurrences of a repeated field into partitions.
+ *
+ * The range from the current field of a cursor to the end of the message is
+ * split into partitions of roughly equal size in bytes at field boundaries,
+ * so every partition can be iterated by its own cursor on another thread.
+ * The boundaries are determined in a single pass of the cursor, which skips
+ * over fields without decoding them. Packed fields are never split. On input,
+ * the size denotes the capacity of the array, on output the number of
+ * partitions, which is lower if there are fewer fields than partitions.
+ *
+ * Partitions stop at the first field of the next one, and keep the position
+ * of their first field within the whole field. As cursors share no mutable
+ * state, partitions can only be created on frozen journals, which never
+ * need to be aligned. Every partition must be destroyed by the caller. The
+ * cursor itself is not moved. Rewinding a partition moves it to the first
+ * field of the message, but it still stops at the end of the partition.
+ *
+ * \param[in,out] cursor    Cursor
+ * \param[out]    cursors[] Partitions
+ * \param[in,out] size      Partition count
+ * \return                  Error code
+ */
+extern pb_error_t
+pb_cursor_partition(pb_cursor_t *cursor, pb_cursor_t cursors[], size_t *size) {
+  assert(cursor && cursors && size);
+  size_t capacity = *size, count = 0;
+  *size = 0;
+  if (pb_cursor_error(cursor) == PB_ERROR_EOM)
+    return PB_ERROR_NONE;
+  if (unlikely_(!pb_cursor_valid(cursor) || !cursor->tag || !capacity ||
+      !pb_journal_frozen(pb_cursor_journal(cursor)) ||
+      pb_field_descriptor_label(cursor->current.descriptor) !=
+        PB_LABEL_REPEATED))
+    return PB_ERROR_INVALID;
+
+  /* Determine range of all remaining fields */
+  pb_cursor_t temp = pb_cursor_copy(cursor);
+  pb_error_t error = pb_cursor_align(&temp);
+  const pb_offset_t *field = temp.current.packed.end
+    ? &(temp.current.packed)
+    : &(temp.current.offset);
+  size_t start = field->start + field->diff.tag, previous = start,
+         end   = temp.end ? temp.end : pb_message_end(&(temp.message));
+
+  /* Start a new partition at the first field beyond every boundary */
+  cursors[count++] = pb_cursor_copy(&temp);
+  while (!error && count < capacity && pb_cursor_next(&temp)) {
+    field = temp.current.packed.end
+      ? &(temp.current.packed)
+      : &(temp.current.offset);
+    size_t offset = field->start + field->diff.tag;
+    if (offset == previous)
+      continue;
+    previous = offset;
+
+    /* Close the last partition and start the next one, if beyond boundary */
+    if (offset - start >= (end - start) / capacity * count) {
+      cursors[count - 1].end = offset;
+      cursors[count++] = pb_cursor_copy(&temp);
+    }
+  }
+  if (!error && !pb_cursor_valid(&temp) &&
+      pb_cursor_error(&temp) != PB_ERROR_EOM)
+    error = pb_cursor_error(&temp);
+  pb_cursor_destroy(&temp);
+
+  /* Destroy partitions on error */
+  if (unlikely_(error)) {
+    while (count)
+      pb_cursor_destroy(&(cursors[--count]));
+    return error;
+  }
+  *size = count;
+  return PB_ERROR_NONE;
+}
+
 /*!
  * Write a value or submessage to the current field of a cursor.
  *
@@ -461,6 +767,13 @@ pb_cursor_put(pb_cursor_t *cursor, const void *value) {
   if (pb_cursor_valid(cursor)) {
     const pb_field_descriptor_t *descriptor = cursor->current.descriptor;
 
+    /* Record operation, if a trace is attached */
+    pb_journal_t *journal = pb_cursor_journal(cursor);
+    pb_trace_t   *trace   = pb_trace_from(journal);
+    if (unlikely_(trace != NULL))
+      trace = pb_trace_begin_cursor(trace, PB_TRACE_CURSOR_PUT, cursor,
+        value);
+
     /* Create field and write value */
     if (pb_field_descriptor_type(descriptor) != PB_TYPE_MESSAGE) {
       pb_field_t field = pb_field_create_from_cursor(cursor);
@@ -471,20 +784,20 @@ pb_cursor_put(pb_cursor_t *cursor, const void *value) {
     } else {
       pb_message_t submessage = pb_message_copy(value);
       assert(pb_cursor_journal(cursor) != pb_message_journal(&submessage));
-      if (unlikely_(!pb_message_valid(&submessage) ||
-                     pb_message_align(&submessage)))
-        return PB_ERROR_INVALID;
-
-      /* Write raw data */
-      pb_part_t part = pb_part_create_from_cursor(cursor);
-      error = pb_part_write(&part, pb_journal_data_from(
-        pb_message_journal(&submessage), pb_message_start(&submessage)),
-          pb_message_size(&submessage));
-
-      /* Cleanup before exit */
-      pb_part_destroy(&part);
+      if (likely_(pb_message_valid(&submessage) &&
+                 !pb_message_align(&submessage))) {
+
+        /* Write raw data */
+        pb_part_t part = pb_part_create_from_cursor(cursor);
+        error = pb_part_write(&part, pb_journal_data_from(
+          pb_message_journal(&submessage), pb_message_start(&submessage)),
+            pb_message_size(&submessage));
+        pb_part_destroy(&part);
+      }
       pb_message_destroy(&submessage);
     }
+    if (unlikely_(trace != NULL))
+      pb_trace_end(trace, journal, error);
   }
   return error;
 }
@@ -512,6 +825,13 @@ pb_cursor_erase(pb_cursor_t *cursor) {
   if (pb_cursor_valid(cursor)) {
     const pb_field_descriptor_t *descriptor = cursor->current.descriptor;
 
+    /* Record operation, if a trace is attached */
+    pb_journal_t *journal = pb_cursor_journal(cursor);
+    pb_trace_t   *trace   = pb_trace_from(journal);
+    if (unlikely_(trace != NULL))
+      trace = pb_trace_begin_cursor(trace, PB_TRACE_CURSOR_ERASE, cursor,
+        NULL);
+
     /* Clear field */
     if (pb_field_descriptor_type(descriptor) != PB_TYPE_MESSAGE) {
       pb_field_t field = pb_field_create_from_cursor(cursor);
@@ -524,7 +844,90 @@ pb_cursor_erase(pb_cursor_t *cursor) {
       error = pb_message_clear(&submessage);
       pb_message_destroy(&submessage);
     }
+    if (unlikely_(trace != NULL))
+      pb_trace_end(trace, journal, error);
+  }
+  return error;
+}
+
+/*!
+ * Erase all fields or submessages from a cursor matching a predicate.
+ *
+ * Starting at the current position, the predicate is evaluated for every
+ * occurrence the cursor halts on, and the matching ones are erased from the
+ * underlying message at once, moving the data and updating the length
+ * prefixes of parent messages only once. Afterwards, the cursor is at the end
+ * of the message. Values of packed fields are erased one by one, as the
+ * length prefix of the packed field must be updated for every value.
+ *
+ * \warning The predicate must not alter the underlying message, but it may
+ * read the current value or create a submessage from the cursor.
+ *
+ * \param[in,out] cursor    Cursor
+ * \param[in]     predicate Predicate
+ * \param[in,out] user      User data
+ * \return                  Error code
+ */
+extern pb_error_t
+pb_cursor_erase_if(
+    pb_cursor_t *cursor, pb_cursor_predicate_f predicate, void *user) {
+  assert(cursor && predicate);
+  if (!pb_cursor_valid(cursor))
+    return PB_ERROR_INVALID;
+  pb_error_t error = PB_ERROR_NONE;
+
+  /* Erase values of packed fields one by one */
+  if (pb_field_descriptor_packed(cursor->current.descriptor)) {
+    do {
+      if (predicate(cursor, user))
+        error = pb_cursor_erase(cursor);
+    } while (!error && pb_cursor_next(cursor));
+
+  /* Collect ranges of matching fields, merging adjacent ones */
+  } else {
+    pb_allocator_t *allocator =
+      pb_journal_allocator(pb_cursor_journal(cursor));
+    size_t *ranges = NULL, size = 0, capacity = 0;
+    do {
+      if (!predicate(cursor, user))
+        continue;
+      const pb_offset_t *offset = &(cursor->current.offset);
+      size_t start = offset->start + offset->diff.tag;
+      if (size && ranges[2 * size - 1] == start) {
+        ranges[2 * size - 1] = offset->end;
+        continue;
+      }
+
+      /* Grow ranges, if necessary */
+      if (size == capacity) {
+        capacity = capacity ? capacity << 1 : 8;
+        size_t *temp = ranges
+          ? pb_allocator_resize(allocator, ranges,
+              sizeof(*ranges) * 2 * capacity)
+          : pb_allocator_allocate(allocator,
+              sizeof(*ranges) * 2 * capacity);
+        if (unlikely_(!temp)) {
+          error = PB_ERROR_ALLOC;
+          break;
+        }
+        ranges = temp;
+      }
+      ranges[2 * size]     = start;
+      ranges[2 * size + 1] = offset->end;
+      size++;
+    } while (pb_cursor_next(cursor));
+
+    /* Erase matching fields at once, unless the cursor ran into an error */
+    if (!error && size && (pb_cursor_error(cursor) == PB_ERROR_EOM))
+      error = pb_message_erase_ranges(&(cursor->message), ranges, size);
+    if (ranges)
+      pb_allocator_free(allocator, ranges);
   }
+
+  /* Intercept errors of cursor at end of message */
+  if (!error && (error = pb_cursor_error(cursor)))
+    if (error == PB_ERROR_INVALID || error == PB_ERROR_EOM)
+      error = PB_ERROR_NONE;
   return error;
 }
 
@@ -549,7 +952,7 @@ pb_cursor_align(pb_cursor_t *cursor) {
 
     /* Align current packed context offset, if given */
     const pb_field_descriptor_t *descriptor = cursor->current.descriptor;
-    if (pb_field_descriptor_packed(descriptor)) {
+    if (descriptor && pb_field_descriptor_packed(descriptor)) {
       pb_version_t version = pb_cursor_version(cursor);
       error = pb_journal_align(pb_cursor_journal(cursor),
         &version, &(cursor->current.packed));
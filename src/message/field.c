@@ -78,6 +78,47 @@ default_map[] = {
   [PB_TYPE_MESSAGE]  = NULL
 };
 
+/* ----------------------------------------------------------------------------
+ * Internal functions
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Retrieve the explicit or implicit default value of a field.
+ *
+ * \param[in] descriptor Field descriptor
+ * \return               Default value
+ */
+static const void *
+field_default(const pb_field_descriptor_t *descriptor) {
+  assert(descriptor);
+  return pb_field_descriptor_default(descriptor)
+    ? pb_field_descriptor_default(descriptor)
+    : default_map[pb_field_descriptor_type(descriptor)];
+}
+
+/*!
+ * Write the header of a virtual field, so a value can be written to it.
+ *
+ * Until then, the part of a virtual field refers to the enclosing message,
+ * so the field is created within the message in its current state.
+ *
+ * \param[in,out] field Field
+ * \return              Error code
+ */
+static pb_error_t
+field_materialize(pb_field_t *field) {
+  assert(field && field->parent);
+  pb_message_t message = {
+    .descriptor = field->parent,
+    .part       = field->part
+  };
+  field->part   = pb_part_create(&message,
+    pb_field_descriptor_tag(field->descriptor));
+  field->parent = NULL;
+  pb_message_destroy(&message);
+  return pb_field_error(field);
+}
+
 /* ----------------------------------------------------------------------------
  * Interface
  * ------------------------------------------------------------------------- */
@@ -100,9 +141,7 @@ pb_field_create(pb_message_t *message, pb_tag_t tag) {
       pb_descriptor_field_by_tag(pb_message_descriptor(message), tag);
 
     /* Write explicit or implicit default value to field */
-    const void *value = pb_field_descriptor_default(descriptor)
-      ? pb_field_descriptor_default(descriptor)
-      : default_map[pb_field_descriptor_type(descriptor)];
+    const void *value = field_default(descriptor);
     if (value && pb_field_put(&field, value)) {
       pb_field_destroy(&field);                            /* LCOV_EXCL_LINE */
       return pb_field_create_invalid();                    /* LCOV_EXCL_LINE */
@@ -111,6 +150,48 @@ pb_field_create(pb_message_t *message, pb_tag_t tag) {
   return field;
 };
 
+/*!
+ * Create a field within a message for a specific tag without altering it.
+ *
+ * If the field is present, this is equivalent to pb_field_create(). Otherwise,
+ * a virtual field is returned, which yields the explicit or implicit default
+ * value when read, while the message is left untouched. The field is only
+ * written to the message upon the first call to pb_field_put(), so reading
+ * fields of a message doesn't grow it, and neither allocates memory nor adds
+ * journal entries. Packed fields are always created right away.
+ *
+ * \warning Until a value is written, the offsets of a virtual field are those
+ * of the enclosing message.
+ *
+ * \param[in,out] message Message
+ * \param[in]     tag     Tag
+ * \return                Field
+ */
+extern pb_field_t
+pb_field_create_virtual(pb_message_t *message, pb_tag_t tag) {
+  assert(message && tag);
+  if (unlikely_(!pb_message_valid(message)))
+    return pb_field_create_invalid();
+  const pb_field_descriptor_t *descriptor =
+    pb_descriptor_field_by_tag(pb_message_descriptor(message), tag);
+  assert(descriptor &&
+    pb_field_descriptor_type(descriptor) != PB_TYPE_MESSAGE);
+
+  /* Create present or packed fields right away */
+  if (pb_field_descriptor_packed(descriptor) ||
+      (pb_field_descriptor_label(descriptor) != PB_LABEL_REPEATED &&
+       pb_message_has(message, tag)))
+    return pb_field_create(message, tag);
+
+  /* Otherwise refer to the message until the first write */
+  pb_field_t field = {
+    .descriptor = descriptor,
+    .part       = message->part,
+    .parent     = pb_message_descriptor(message)
+  };
+  return field;
+}
+
 /*!
  * Create a field within a message for a specific tag without setting defaults.
  *
@@ -247,10 +328,21 @@ pb_field_get(pb_field_t *field, void *value) {
   if (unlikely_(!pb_field_valid(field) || pb_field_align(field)))
     return PB_ERROR_INVALID;
 
+  /* Read default value of virtual field */
+  pb_type_t type = pb_field_descriptor_type(field->descriptor);
+  if (field->parent) {
+    const void *data = field_default(field->descriptor);
+    if (data) {
+      memcpy(value, data, pb_field_descriptor_type_size(field->descriptor));
+    } else {
+      *(pb_string_t *)value = pb_string_init_empty();
+    }
+    return PB_ERROR_NONE;
+  }
+
   /* Create a stream to read the field's value */
   pb_stream_t stream =
     pb_stream_create_from_part(&(field->part));
-  pb_type_t  type  = pb_field_descriptor_type(field->descriptor);
   pb_error_t error = pb_stream_read(&stream, type, value);
   pb_stream_destroy(&stream);
   return error;
@@ -273,6 +365,10 @@ pb_field_put(pb_field_t *field, const void *value) {
     return PB_ERROR_INVALID;
   pb_error_t error = PB_ERROR_NONE;
 
+  /* Write header of virtual field first */
+  if (field->parent && (error = field_materialize(field)))
+    return error;
+
   /* Write new value according to wiretype */
   pb_type_t type = pb_field_descriptor_type(field->descriptor);
   switch (pb_field_descriptor_wiretype(field->descriptor)) {
@@ -290,10 +386,12 @@ pb_field_put(pb_field_t *field, const void *value) {
 
 #endif /* NDEBUG */
 
-      /* Pack variable-sized integer */
+      /* Pack variable-sized integer, padded if demanded */
       uint8_t data[10];
       error = pb_part_write(&(field->part), data,
-        pb_varint_pack(type, data, value));
+        pb_field_descriptor_padded(field->descriptor)
+          ? pb_varint_pack_padded(type, data, value)
+          : pb_varint_pack(type, data, value));
       break;
     }
 
@@ -335,5 +433,9 @@ pb_field_put(pb_field_t *field, const void *value) {
 extern pb_error_t
 pb_field_clear(pb_field_t *field) {
   assert(field);
+  if (field->parent) {
+    pb_field_destroy(field);
+    return PB_ERROR_NONE;
+  }
   return pb_part_clear(&(field->part));
 }
@@ -0,0 +1,298 @@
+/*
+ * Copyright (c) 2013-2020 Martin Donath <martin.donath@squidfunk.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "core/allocator.h"
+#include "core/descriptor.h"
+#include "message/common.h"
+#include "message/handle_pool.h"
+#include "message/journal.h"
+#include "message/message.h"
+#include "message/part.h"
+
+/* ----------------------------------------------------------------------------
+ * Internal functions
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Retrieve the slot of a live handle.
+ *
+ * \param[in] pool   Handle pool
+ * \param[in] handle Handle
+ * \return           Slot or SIZE_MAX
+ */
+PB_INLINE size_t
+slot(const pb_handle_pool_t *pool, pb_handle_t handle) {
+  assert(pool);
+  return handle && handle <= pool->slot.size &&
+         pool->slot.descriptor[handle - 1]
+    ? handle - 1
+    : SIZE_MAX;
+}
+
+/*!
+ * Grow the slot arrays of a handle pool.
+ *
+ * All arrays are resized one after another, and the capacity is only updated
+ * after all of them could be resized, so the pool is left intact on failure.
+ *
+ * \param[in,out] pool Handle pool
+ * \return             Error code
+ */
+static pb_error_t
+grow(pb_handle_pool_t *pool) {
+  assert(pool);
+  pb_allocator_t *allocator = pb_journal_allocator(pool->journal);
+  size_t capacity = pool->slot.capacity ? pool->slot.capacity << 1 : 8;
+
+  /* Resize descriptors */
+  const pb_descriptor_t **descriptor = pb_allocator_resize(allocator,
+    pool->slot.descriptor, sizeof(*descriptor) * capacity);
+  if (unlikely_(!descriptor))
+    return PB_ERROR_ALLOC;
+  pool->slot.descriptor = descriptor;
+
+  /* Resize offsets */
+  pb_offset_t *offset = pb_allocator_resize(allocator,
+    pool->slot.offset, sizeof(*offset) * capacity);
+  if (unlikely_(!offset))
+    return PB_ERROR_ALLOC;
+  pool->slot.offset = offset;
+
+  /* Resize invalidation flags */
+  uint8_t *invalid = pb_allocator_resize(allocator,
+    pool->slot.invalid, sizeof(*invalid) * capacity);
+  if (unlikely_(!invalid))
+    return PB_ERROR_ALLOC;
+  pool->slot.invalid = invalid;
+
+  /* Resize free slots */
+  size_t *free = pb_allocator_resize(allocator,
+    pool->free.data, sizeof(*free) * capacity);
+  if (unlikely_(!free))
+    return PB_ERROR_ALLOC;
+  pool->free.data = free;
+
+  /* Update capacity */
+  pool->slot.capacity = capacity;
+  return PB_ERROR_NONE;
+}
+
+/* ----------------------------------------------------------------------------
+ * Interface
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Create a handle pool for a journal.
+ *
+ * A handle pool keeps the state of many messages of the same journal in a few
+ * contiguous arrays and hands out small integer handles instead. Messages are
+ * re-created from their handles when needed, which is cheap, as all handles
+ * are aligned together in a single pass over the journal entries written
+ * since the last access, instead of every message replaying them on its own.
+ *
+ * No memory is allocated before the first handle is inserted, and the pool
+ * uses the allocator of the journal, so it must not outlive the journal.
+ *
+ * \param[in,out] journal Journal
+ * \return                Handle pool
+ */
+extern pb_handle_pool_t
+pb_handle_pool_create(pb_journal_t *journal) {
+  assert(journal);
+  pb_handle_pool_t pool = {
+    .journal = journal,
+    .version = pb_journal_version(journal),
+    .slot    = {
+      .descriptor = NULL,
+      .offset     = NULL,
+      .invalid    = NULL,
+      .size       = 0,
+      .capacity   = 0
+    },
+    .free    = {
+      .data = NULL,
+      .size = 0
+    }
+  };
+  return pool;
+}
+
+/*!
+ * Destroy a handle pool.
+ *
+ * All handles of the pool are released, but messages that were retrieved
+ * from the pool stay valid, as they don't depend on it.
+ *
+ * \param[in,out] pool Handle pool
+ */
+extern void
+pb_handle_pool_destroy(pb_handle_pool_t *pool) {
+  assert(pool);
+  if (pool->slot.capacity) {
+    pb_allocator_t *allocator = pb_journal_allocator(pool->journal);
+    pb_allocator_free(allocator, pool->slot.descriptor);
+    pb_allocator_free(allocator, pool->slot.offset);
+    pb_allocator_free(allocator, pool->slot.invalid);
+    pb_allocator_free(allocator, pool->free.data);
+  }
+}
+
+/*!
+ * Insert a message into a handle pool.
+ *
+ * Only the descriptor and the part of the message are kept, so the message
+ * itself may be destroyed after insertion. Slots of removed handles are
+ * reused before the pool grows.
+ *
+ * \param[in,out] pool    Handle pool
+ * \param[in,out] message Message
+ * \return                Handle or 0
+ */
+extern pb_handle_t
+pb_handle_pool_insert(pb_handle_pool_t *pool, pb_message_t *message) {
+  assert(pool && message);
+  if (!pb_message_valid(message) || pb_message_journal(message) !=
+      pool->journal)
+    return 0;
+
+  /* Align message and pool to the current version */
+  if (pb_message_align(message) || pb_handle_pool_align(pool))
+    return 0;
+
+  /* Reuse a free slot or append a new one */
+  size_t s;
+  if (pool->free.size) {
+    s = pool->free.data[--pool->free.size];
+  } else {
+    if (pool->slot.size == pool->slot.capacity && grow(pool))
+      return 0;
+    s = pool->slot.size++;
+  }
+
+  /* Copy descriptor and offsets */
+  pool->slot.descriptor[s] = pb_message_descriptor(message);
+  pool->slot.offset[s]     = message->part.offset;
+  pool->slot.invalid[s]    = 0;
+  return s + 1;
+}
+
+/*!
+ * Insert a submessage of a pooled message into a handle pool.
+ *
+ * \param[in,out] pool   Handle pool
+ * \param[in]     handle Handle
+ * \param[in]     tag    Tag
+ * \return               Handle or 0
+ */
+extern pb_handle_t
+pb_handle_pool_insert_within(
+    pb_handle_pool_t *pool, pb_handle_t handle, pb_tag_t tag) {
+  assert(pool && tag);
+  pb_message_t message = pb_handle_pool_message(pool, handle);
+  pb_message_t submessage = pb_message_create_within(&message, tag);
+  return pb_handle_pool_insert(pool, &submessage);
+}
+
+/*!
+ * Remove a handle from a handle pool.
+ *
+ * The slot of the handle is reused by subsequent insertions, so the handle
+ * must not be used anymore after removal.
+ *
+ * \param[in,out] pool   Handle pool
+ * \param[in]     handle Handle
+ */
+extern void
+pb_handle_pool_remove(pb_handle_pool_t *pool, pb_handle_t handle) {
+  assert(pool);
+  size_t s = slot(pool, handle);
+  if (s != SIZE_MAX) {
+    pb_offset_t offset = { .start = 0 };
+    pool->slot.descriptor[s] = NULL;
+    pool->slot.offset[s]     = offset;
+    pool->slot.invalid[s]    = 1;
+    pool->free.data[pool->free.size++] = s;
+  }
+}
+
+/*!
+ * Retrieve the message of a handle.
+ *
+ * The returned message is aligned to the current version of the journal. If
+ * the handle was removed or its message was cleared, an invalid message is
+ * returned.
+ *
+ * \param[in,out] pool   Handle pool
+ * \param[in]     handle Handle
+ * \return               Message
+ */
+extern pb_message_t
+pb_handle_pool_message(pb_handle_pool_t *pool, pb_handle_t handle) {
+  assert(pool);
+  size_t s = slot(pool, handle);
+  if (s == SIZE_MAX || pb_handle_pool_align(pool) || pool->slot.invalid[s])
+    return pb_message_create_invalid();
+
+  /* Re-create message from slot */
+  pb_message_t message = {
+    .descriptor = pool->slot.descriptor[s],
+    .part       = {
+      .journal = pool->journal,
+      .version = pool->version,
+      .offset  = pool->slot.offset[s]
+    },
+    .index      = NULL,
+    .map        = NULL
+  };
+  return message;
+}
+
+/*!
+ * Align all handles of a handle pool to the current version of the journal.
+ *
+ * Every journal entry written since the last alignment is replayed on all
+ * slots at once. Handles whose messages were cleared are invalidated. This
+ * is done implicitly when handles are inserted or messages are retrieved.
+ *
+ * \param[in,out] pool Handle pool
+ * \return             Error code
+ */
+extern pb_error_t
+pb_handle_pool_align(pb_handle_pool_t *pool) {
+  assert(pool);
+  if (pool->version == pb_journal_version(pool->journal))
+    return PB_ERROR_NONE;
+
+  /* Replay journal entries on all slots */
+  pb_error_t error = pool->slot.size
+    ? pb_journal_align_many(pool->journal, pool->version,
+        pool->slot.offset, pool->slot.invalid, pool->slot.size)
+    : PB_ERROR_NONE;
+  if (likely_(!error))
+    pool->version = pb_journal_version(pool->journal);
+  return error;
+}
@@ -23,184 +23,1991 @@
 #include <assert.h>
 #include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "core/allocator.h"
+#include "core/descriptor.h"
+#include "core/encoder.h"
+#include "core/fragment.h"
+#include "core/probe.h"
+#include "core/stats.h"
+#include "core/stream.h"
+#include "core/varint.h"
 #include "message/buffer.h"
 #include "message/common.h"
 #include "message/journal.h"
+#include "message/message.h"
+#include "message/part.h"
+#include "message/trace.h"
+
+/* ----------------------------------------------------------------------------
+ * Macros
+ * ------------------------------------------------------------------------- */
+
+/*! Initial capacity of the journal entry log */
+#ifndef PB_JOURNAL_ENTRY_CAPACITY
+#define PB_JOURNAL_ENTRY_CAPACITY 16
+#endif /* PB_JOURNAL_ENTRY_CAPACITY */
+
+/* ----------------------------------------------------------------------------
+ * Type definitions
+ * ------------------------------------------------------------------------- */
+
+typedef struct pb_journal_range_t {
+  size_t start;                        /*!< Start offset */
+  size_t end;                          /*!< End offset */
+  size_t size;                         /*!< Size of replaced data */
+} pb_journal_range_t;
 
 /* ----------------------------------------------------------------------------
  * Internal functions
  * ------------------------------------------------------------------------- */
 
 /*!
- * Add an entry to a journal.
+ * Retrieve the allocator of the entry log and index of a journal.
+ *
+ * While a journal refers to shared data, its buffer is a zero-copy buffer,
+ * so entries are managed with the allocator used for copying the data.
+ *
+ * \param[in] journal Journal
+ * \return            Allocator
+ */
+PB_INLINE pb_allocator_t *
+entry_allocator(const pb_journal_t *journal) {
+  assert(journal);
+  return journal->shared
+    ? journal->shared
+    : pb_buffer_allocator(&(journal->buffer));
+}
+
+/*!
+ * Retrieve the allocator owning the data of a journal.
+ *
+ * Zero-copy and fixed buffers can't allocate, so the system-default allocator
+ * is used instead. This is the allocator that copy-on-write journals use for
+ * copying shared data, which is why it remains stable across snapshots.
+ *
+ * \param[in] journal Journal
+ * \return            Allocator
+ */
+PB_INLINE pb_allocator_t *
+owner_allocator(const pb_journal_t *journal) {
+  assert(journal);
+  pb_allocator_t *allocator = entry_allocator(journal);
+  return allocator == &allocator_zero_copy || allocator == &allocator_fixed
+    ? &allocator_default
+    : allocator;
+}
+
+/*!
+ * Release a reference to an external segment.
+ *
+ * When the last reference is released, the release callback is invoked, so
+ * the caller can free the value, and the segment itself is freed.
+ *
+ * \param[in,out] external External segment
+ */
+static void
+external_release(pb_journal_external_t *external) {
+  assert(external);
+  if (!__atomic_sub_fetch(&(external->references), 1, __ATOMIC_ACQ_REL)) {
+    if (external->release)
+      external->release(external->data);
+    pb_allocator_free(external->allocator, external);
+  }
+}
+
+/*!
+ * Release a fragment attached to a journal.
+ *
+ * \param[in,out] data Fragment
+ */
+static void
+fragment_release(void *data) {
+  assert(data);
+  pb_fragment_release(data);
+}
+
+/*!
+ * Share the external segments of a journal with a snapshot.
+ *
+ * If allocation fails, the snapshot is destroyed and an invalid journal is
+ * returned, so the caller can pass the result on directly.
+ *
+ * \param[in]     journal  Journal
+ * \param[in,out] snapshot Snapshot
+ * \return                 Snapshot
+ */
+static pb_journal_t
+external_share(const pb_journal_t *journal, pb_journal_t *snapshot) {
+  assert(journal && snapshot);
+  if (!journal->external.size || !pb_journal_valid(snapshot))
+    return *snapshot;
+
+  /* Copy references to external segments */
+  size_t size = journal->external.size;
+  pb_journal_external_t **data = pb_allocator_allocate(
+    owner_allocator(snapshot), sizeof(pb_journal_external_t *) * size);
+  if (unlikely_(!data)) {
+    pb_journal_destroy(snapshot);                          /* LCOV_EXCL_LINE */
+    return pb_journal_create_invalid();                    /* LCOV_EXCL_LINE */
+  }
+  for (size_t e = 0; e < size; e++) {
+    data[e] = journal->external.data[e];
+    __atomic_add_fetch(&(data[e]->references), 1, __ATOMIC_RELAXED);
+  }
+  snapshot->external.data     = data;
+  snapshot->external.size     = size;
+  snapshot->external.capacity = size;
+  return *snapshot;
+}
+
+/*!
+ * Attach a caller-owned value to a journal as an external segment.
+ *
+ * If the value is framed, it already starts with its key and length prefix,
+ * so it is referenced as a whole and takes a single vector.
+ *
+ * \param[in,out] journal Journal
+ * \param[in]     tag     Tag
+ * \param[in]     value   Caller-owned value
+ * \param[in]     framed  Whether the value includes key and length prefix
+ * \param[in]     release Release callback
+ * \param[in,out] data    Release callback data
+ * \return                Error code
+ */
+static pb_error_t
+attach(
+    pb_journal_t *journal, pb_tag_t tag, const pb_string_t *value,
+    int framed, pb_journal_release_f release, void *data) {
+  assert(journal && value);
+  pb_error_t error = PB_ERROR_NONE;
+  if (unlikely_(!pb_journal_valid(journal) || journal->frozen ||
+      !tag || tag >> 29)) {
+    error = PB_ERROR_INVALID;
+
+  /* Ensure capacity for segments, doubling it whenever it is exhausted */
+  } else {
+    pb_allocator_t *allocator = owner_allocator(journal);
+    if (journal->external.size == journal->external.capacity) {
+      size_t capacity = journal->external.capacity
+        ? journal->external.capacity * 2
+        : 4;
+      pb_journal_external_t **temp = pb_allocator_resize(allocator,
+        journal->external.data, sizeof(pb_journal_external_t *) * capacity);
+      if (unlikely_(!temp)) {
+        error = PB_ERROR_ALLOC;                            /* LCOV_EXCL_LINE */
+      } else {
+        journal->external.data     = temp;
+        journal->external.capacity = capacity;
+      }
+    }
+
+    /* Allocate segment and encode key and length prefix */
+    pb_journal_external_t *external = !error
+      ? pb_allocator_allocate(allocator, sizeof(pb_journal_external_t))
+      : NULL;
+    if (likely_(external != NULL)) {
+      uint32_t key    = (uint32_t)tag << 3 | PB_WIRETYPE_LENGTH;
+      uint64_t length = pb_string_size(value);
+      *external = (pb_journal_external_t){
+        .value      = *value,
+        .release    = release,
+        .data       = data,
+        .allocator  = allocator,
+        .references = 1
+      };
+      if (!framed) {
+        external->size  = pb_varint_pack_uint32(external->prefix, &key);
+        external->size += pb_varint_pack_uint64(
+          &(external->prefix[external->size]), &length);
+      }
+      journal->external.data[journal->external.size++] = external;
+      return PB_ERROR_NONE;
+    } else if (!error) {
+      error = PB_ERROR_ALLOC;                              /* LCOV_EXCL_LINE */
+    }
+  }
+
+  /* Release value, as it was not attached */
+  if (release)
+    release(data);
+  return error;
+}
+
+/*!
+ * Free the entry index of a journal.
+ *
+ * \param[in,out] journal Journal
+ */
+static void
+index_free(pb_journal_t *journal) {
+  assert(journal);
+  if (journal->index.data) {
+    pb_allocator_free(entry_allocator(journal), journal->index.data);
+    journal->index.data = NULL;
+    journal->index.size = 0;
+  }
+}
+
+/*!
+ * Build the entry index of a journal for its current entry capacity.
+ *
+ * The index is a segment tree holding the minimum origin of all entries it
+ * spans, with unused leaves set to SIZE_MAX. It is optional, so if allocation
+ * fails, the index is dropped and alignment falls back to a linear scan.
+ *
+ * \param[in,out] journal Journal
+ */
+static void
+index_build(pb_journal_t *journal) {
+  assert(journal);
+  if (!journal->entry.capacity) {
+    index_free(journal);
+    return;
+  }
+
+  /* Determine leaf count as the next power of two of the capacity */
+  size_t size = 1;
+  while (size < journal->entry.capacity)
+    size <<= 1;
+
+  /* Resize index, or drop it if allocation fails */
+  size_t *data = pb_allocator_resize(entry_allocator(journal),
+    journal->index.data, sizeof(size_t) * size * 2);
+  if (unlikely_(!data)) {
+    index_free(journal);                                   /* LCOV_EXCL_LINE */
+    return;                                                /* LCOV_EXCL_LINE */
+  }
+
+  /* Initialize leaves and compute the minimum of all inner nodes */
+  for (size_t e = 0; e < size; e++)
+    data[size + e] = e < journal->entry.size
+      ? journal->entry.data[e].origin
+      : SIZE_MAX;
+  for (size_t n = size - 1; n > 0; n--)
+    data[n] = data[2 * n] < data[2 * n + 1]
+      ? data[2 * n]
+      : data[2 * n + 1];
+
+  /* Update index */
+  journal->index.data = data;
+  journal->index.size = size;
+}
+
+/*!
+ * Update the entry index of a journal for the entry at the given position.
+ *
+ * \param[in,out] journal Journal
+ * \param[in]     e       Entry position
+ * \param[in]     origin  Origin or SIZE_MAX for removal
+ */
+static void
+index_update(pb_journal_t *journal, size_t e, size_t origin) {
+  assert(journal && journal->index.data && e < journal->index.size);
+  size_t *data = journal->index.data;
+  size_t  n    = journal->index.size + e;
+  for (data[n] = origin, n >>= 1; n > 0; n >>= 1)
+    data[n] = data[2 * n] < data[2 * n + 1]
+      ? data[2 * n]
+      : data[2 * n + 1];
+}
+
+/*!
+ * Find the first entry from the given position with an origin within limit.
+ *
+ * \param[in] journal Journal
+ * \param[in] e       Entry position
+ * \param[in] limit   Maximum origin
+ * \return            Entry position or entry count
+ */
+static size_t
+index_next(const pb_journal_t *journal, size_t e, size_t limit) {
+  assert(journal && journal->index.data && e < journal->entry.size);
+  const size_t *data = journal->index.data;
+  size_t size = journal->index.size, n = size + e;
+
+  /* Ascend until a node spanning an entry within limit is found */
+  while (data[n] > limit) {
+    while (n & 1)
+      n >>= 1;
+    if (!n)
+      return journal->entry.size;
+    n++;
+  }
+
+  /* Descend to the leftmost entry within limit */
+  while (n < size)
+    n = data[2 * n] <= limit
+      ? 2 * n
+      : 2 * n + 1;
+  return n - size;
+}
+
+/*!
+ * Add an entry to a journal.
+ *
+ * The capacity of the journal entry log grows geometrically, starting from
+ * PB_JOURNAL_ENTRY_CAPACITY entries, so building a message from N writes only
+ * triggers a logarithmic number of reallocations. If allocation fails, the
+ * journal's internal state is fully recoverable.
+ *
+ * \param[in,out] journal Journal
+ * \param[in]     origin  Origin
+ * \param[in]     offset  Offset
+ * \param[in]     delta   Delta
+ * \return                Error code
+ */
+static pb_error_t
+push(
+    pb_journal_t *journal, size_t origin, size_t offset, ptrdiff_t delta) {
+  assert(journal && origin <= offset && delta);
+  assert(pb_journal_valid(journal));
+  pb_allocator_t *allocator = entry_allocator(journal);
+  if (unlikely_(allocator == &allocator_zero_copy ||
+                allocator == &allocator_fixed))
+    return PB_ERROR_ALLOC;
+
+  /* Grow journal entry log if capacity is exhausted */
+  if (journal->entry.size == journal->entry.capacity) {
+    size_t capacity = journal->entry.capacity
+      ? journal->entry.capacity * 2
+      : PB_JOURNAL_ENTRY_CAPACITY;
+
+    /* Resize journal entry log, falling back to a single entry */
+    pb_journal_entry_t *data = pb_allocator_resize(allocator,
+      journal->entry.data, sizeof(pb_journal_entry_t) * capacity);
+    if (unlikely_(!data))
+      data = pb_allocator_resize(allocator, journal->entry.data,
+        sizeof(pb_journal_entry_t) * (capacity = journal->entry.size + 1));
+    if (unlikely_(!data)) {
+      pb_probe2(alloc__fail, allocator, sizeof(pb_journal_entry_t) * capacity);
+      return PB_ERROR_ALLOC;
+    }
+
+    /* Update journal entries and capacity */
+    journal->entry.data     = data;
+    journal->entry.capacity = capacity;
+  }
+
+  /* Append entry */
+  journal->entry.data[journal->entry.size++] = (pb_journal_entry_t){
+    .origin = origin,
+    .offset = offset,
+    .delta  = delta
+  };
+
+  /* Update or rebuild index */
+  if (journal->index.size >= journal->entry.size) {
+    index_update(journal, journal->entry.size - 1, origin);
+  } else {
+    index_build(journal);
+  }
+  return PB_ERROR_NONE;
+}
+
+/* LCOV_EXCL_START >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>> */
+
+/*!
+ * Remove the latest entry from the journal.
+ *
+ * \param[in,out] journal Journal
+ */
+static void
+pop(pb_journal_t *journal) {
+  assert(journal);
+  assert(pb_journal_valid(journal));
+  if (journal->entry.size) {
+    --journal->entry.size;
+    if (journal->index.data)
+      index_update(journal, journal->entry.size, SIZE_MAX);
+  }
+}
+
+/* LCOV_EXCL_STOP <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<< */
+
+/*!
+ * Move the gap of a journal to the given offset.
+ *
+ * Only the data between the current and the new offset of the gap is moved,
+ * so localized edits are proportional to the distance between them.
+ *
+ * \param[in,out] journal Journal
+ * \param[in]     offset  Offset
+ */
+static void
+gap_move(pb_journal_t *journal, size_t offset) {
+  assert(journal && journal->gap.enabled);
+  assert(offset <= journal->buffer.size);
+  uint8_t *data = journal->buffer.data;
+  size_t   size = journal->gap.size;
+
+  /* Gap moves backward, so move data in front of the gap behind it */
+  if (offset < journal->gap.offset) {
+    if (size)
+      memmove(&(data[offset + size]), &(data[offset]),
+        journal->gap.offset - offset);
+
+  /* Gap moves forward, so move data behind the gap in front of it */
+  } else if (offset > journal->gap.offset) {
+    if (size)
+      memmove(&(data[journal->gap.offset]),
+        &(data[journal->gap.offset + size]), offset - journal->gap.offset);
+  }
+  journal->gap.offset = offset;
+}
+
+/*!
+ * Grow the gap of a journal to hold at least the given size.
+ *
+ * The capacity of the underlying buffer grows geometrically, and all space
+ * that is gained is assigned to the gap. If allocation fails, the journal is
+ * not altered.
+ *
+ * \param[in,out] journal Journal
+ * \param[in]     size    Minimum gap size
+ * \return                Error code
+ */
+static pb_error_t
+gap_grow(pb_journal_t *journal, size_t size) {
+  assert(journal && journal->gap.enabled && size);
+  pb_buffer_t *buffer = &(journal->buffer);
+  size_t tail = journal->gap.offset + journal->gap.size;
+  size_t rest = buffer->size - journal->gap.offset;
+
+  /* Ensure capacity for data and gap */
+  if (unlikely_(pb_buffer_ensure(buffer, buffer->size + size)))
+    return PB_ERROR_ALLOC;
+
+  /* Move data behind the gap to the end of the buffer */
+  size_t gap = buffer->capacity - buffer->size;
+  if (rest)
+    memmove(&(buffer->data[journal->gap.offset + gap]),
+      &(buffer->data[tail]), rest);
+  journal->gap.size = gap;
+  return PB_ERROR_NONE;
+}
+
+/*!
+ * Replace a range of a journal that is backed by a gap buffer.
+ *
+ * The gap is moved to the end of the range, so the range can be replaced
+ * in-place by adjusting the offset and size of the gap. If allocation fails,
+ * the contents of the journal are not altered.
+ *
+ * \param[in,out] journal Journal
+ * \param[in]     start   Start offset
+ * \param[in]     end     End offset
+ * \param[in]     data[]  Raw data
+ * \param[in]     size    Raw data size
+ * \return                Error code
+ */
+static pb_error_t
+gap_write(
+    pb_journal_t *journal, size_t start, size_t end,
+    const uint8_t data[], size_t size) {
+  assert(journal && journal->gap.enabled);
+  assert(pb_journal_valid(journal));
+  pb_buffer_t *buffer = &(journal->buffer);
+
+  /* Check valid range */
+  if (unlikely_(start > end || end > buffer->size))
+    return PB_ERROR_OFFSET;
+
+  /* Move gap to the end of the range and grow it if necessary */
+  ptrdiff_t delta = size - (end - start);
+  gap_move(journal, end);
+  if (delta > 0 && (size_t)delta > journal->gap.size)
+    if (unlikely_(gap_grow(journal, delta)))
+      return PB_ERROR_ALLOC;
+
+  /* Copy data, then adjust gap and size */
+  if (size)
+    memcpy(&(buffer->data[start]), data, size);
+  journal->gap.offset  = start + size;
+  journal->gap.size   -= delta;
+  buffer->size        += delta;
+  return PB_ERROR_NONE;
+}
+
+/*!
+ * Release the reference of a journal to the shared data of its snapshots.
+ *
+ * The shared data is freed together with the last reference.
+ *
+ * \param[in,out] journal Journal
+ */
+static void
+release(pb_journal_t *journal) {
+  assert(journal && journal->shared);
+  pb_journal_snapshot_t *snapshot = journal->snapshot;
+  if (snapshot) {
+    if (!__atomic_sub_fetch(&(snapshot->references), 1, __ATOMIC_ACQ_REL)) {
+      pb_buffer_destroy(&(snapshot->buffer));
+      pb_allocator_free(journal->shared, snapshot);
+    }
+    journal->snapshot = NULL;
+  }
+}
+
+/*!
+ * Copy the shared data of a copy-on-write journal.
+ *
+ * If allocation fails, the journal is not altered and still refers to the
+ * shared data. Otherwise, the journal owns its data from now on.
+ *
+ * \param[in,out] journal Journal
+ * \return                Error code
+ */
+PB_INLINE pb_error_t
+unshare(pb_journal_t *journal) {
+  assert(journal);
+  if (likely_(!journal->shared))
+    return PB_ERROR_NONE;
+
+  /* Copy shared data using the allocator of the original buffer */
+  pb_buffer_t buffer = pb_buffer_create_with_allocator(journal->shared,
+    pb_buffer_data(&(journal->buffer)), pb_buffer_size(&(journal->buffer)));
+  if (unlikely_(!pb_buffer_valid(&buffer)))
+    return PB_ERROR_ALLOC;
+
+  /* Replace shared data with copy */
+  release(journal);
+  journal->buffer = buffer;
+  journal->shared = NULL;
+  return PB_ERROR_NONE;
+}
+
+/*!
+ * Move the data of a journal into a reference-counted block for snapshots.
+ *
+ * The journal refers to the data without owning it afterwards, so it copies
+ * the data upon its next write, like all of its snapshots. A gap buffer is
+ * flattened, so the shared data is contiguous.
+ *
+ * \param[in,out] journal Journal
+ * \return                Error code
+ */
+static pb_error_t
+share(pb_journal_t *journal) {
+  assert(journal && pb_journal_size(journal));
+  if (journal->snapshot)
+    return PB_ERROR_NONE;
+
+  /* Determine allocator for copying the data upon the first write */
+  pb_allocator_t *allocator = owner_allocator(journal);
+
+  /* Allocate block for shared data */
+  pb_journal_snapshot_t *snapshot =
+    pb_allocator_allocate(allocator, sizeof(pb_journal_snapshot_t));
+  if (unlikely_(!snapshot))
+    return PB_ERROR_ALLOC;
+
+  /* Move data into block and refer to it */
+  pb_journal_flatten(journal);
+  snapshot->buffer     = journal->buffer;
+  snapshot->references = 1;
+  journal->buffer      = pb_buffer_create_zero_copy_internal(
+    (uint8_t *)pb_buffer_data(&(snapshot->buffer)),
+    pb_buffer_size(&(snapshot->buffer)));
+  journal->shared      = allocator;
+  journal->snapshot    = snapshot;
+  return PB_ERROR_NONE;
+}
+
+/*!
+ * Shrink the capacity of an entry or edit log of a journal to its size.
+ *
+ * If the log is empty, it is freed entirely. If allocation fails, the log is
+ * not altered, which is silently tolerated.
+ *
+ * \param[in,out] journal  Journal
+ * \param[in,out] data     Log
+ * \param[in]     size     Log size
+ * \param[in,out] capacity Log capacity
+ * \param[in]     item     Size of an item
+ */
+static void
+trim(
+    pb_journal_t *journal, void **data, size_t size, size_t *capacity,
+    size_t item) {
+  assert(journal && data && capacity && item);
+  if (!*data || size == *capacity)
+    return;
+
+  /* Log is empty, so free space */
+  pb_allocator_t *allocator = entry_allocator(journal);
+  if (!size) {
+    pb_allocator_free(allocator, *data);
+    *data     = NULL;
+    *capacity = 0;
+
+  /* Otherwise shrink space to size */
+  } else {
+    void *temp = pb_allocator_resize(allocator, *data, item * size);
+    if (likely_(temp != NULL)) {
+      *data     = temp;
+      *capacity = size;
+    }
+  }
+}
+
+/*!
+ * Record an edit of a journal, if recording is enabled.
+ *
+ * The edit log grows like the journal entry log. Every write increments the
+ * revision and adds exactly one edit, so the edit of a revision is found at
+ * a fixed position.
+ *
+ * \param[in,out] journal Journal
+ * \param[in]     start   Start offset
+ * \param[in]     end     End offset
+ * \param[in]     size    Size of replacement
+ * \return                Error code
+ */
+static pb_error_t
+record(pb_journal_t *journal, size_t start, size_t end, size_t size) {
+  assert(journal && start <= end);
+  if (likely_(!journal->edit.enabled))
+    return PB_ERROR_NONE;
+
+  /* Grow edit log if capacity is exhausted */
+  if (journal->edit.size == journal->edit.capacity) {
+    size_t capacity = journal->edit.capacity
+      ? journal->edit.capacity * 2
+      : PB_JOURNAL_ENTRY_CAPACITY;
+    pb_journal_edit_t *data = pb_allocator_resize(entry_allocator(journal),
+      journal->edit.data, sizeof(pb_journal_edit_t) * capacity);
+    if (unlikely_(!data))
+      return PB_ERROR_ALLOC;
+    journal->edit.data     = data;
+    journal->edit.capacity = capacity;
+  }
+
+  /* Append edit */
+  journal->edit.data[journal->edit.size++] = (pb_journal_edit_t){
+    .start = start,
+    .end   = end,
+    .size  = size
+  };
+  return PB_ERROR_NONE;
+}
+
+/*!
+ * Write data to the backing store of a journal.
+ *
+ * \param[in,out] journal Journal
+ * \param[in]     start   Start offset
+ * \param[in]     end     End offset
+ * \param[in]     data[]  Raw data
+ * \param[in]     size    Raw data size
+ * \return                Error code
+ */
+PB_INLINE pb_error_t
+store_write(
+    pb_journal_t *journal, size_t start, size_t end,
+    const uint8_t data[], size_t size) {
+  assert(journal && data && size);
+  pb_error_t error = record(journal, start, end, size);
+  if (unlikely_(error))
+    return error;
+  journal->revision++;
+  return journal->gap.enabled
+    ? gap_write(journal, start, end, data, size)
+    : pb_buffer_write(&(journal->buffer), start, end, data, size);
+}
+
+/*!
+ * Clear data from the backing store of a journal.
+ *
+ * \param[in,out] journal Journal
+ * \param[in]     start   Start offset
+ * \param[in]     end     End offset
+ * \return                Error code
+ */
+PB_INLINE pb_error_t
+store_clear(pb_journal_t *journal, size_t start, size_t end) {
+  assert(journal);
+  pb_error_t error = record(journal, start, end, 0);
+  if (unlikely_(error))
+    return error;
+  journal->revision++;
+  return journal->gap.enabled
+    ? gap_write(journal, start, end, NULL, 0)
+    : pb_buffer_clear(&(journal->buffer), start, end);
+}
+
+/*!
+ * Pack a message with minimal length prefixes, or determine its packed size.
+ *
+ * Length prefixes of all length-prefixed fields are re-encoded as minimal
+ * varints, recursing into submessages. All other data is copied verbatim.
+ * If no output is given, only the packed size is determined.
+ *
+ * \param[in]  buffer     Buffer
+ * \param[in]  start      Start offset
+ * \param[in]  end        End offset
+ * \param[in]  descriptor Descriptor
+ * \param[out] data[]     Packed data
+ * \param[out] size       Packed size
+ * \return                Error code
+ */
+static pb_error_t
+pack(
+    const pb_buffer_t *buffer, size_t start, size_t end,
+    const pb_descriptor_t *descriptor, uint8_t data[], size_t *size) {
+  assert(buffer && descriptor && size);
+  pb_error_t error = PB_ERROR_NONE;
+  *size = 0;
+
+  /* Read fields from the stream until the end of the message */
+  pb_stream_t stream = pb_stream_create_at(buffer, start);
+  while (!error && pb_stream_offset(&stream) < end) {
+    size_t offset = pb_stream_offset(&stream);
+    uint32_t tag;
+    if ((error = pb_stream_read(&stream, PB_TYPE_UINT32, &tag)))
+      break;
+
+    /* Copy non-length-prefixed fields verbatim */
+    pb_wiretype_t wiretype = tag & 7;
+    if (wiretype != PB_WIRETYPE_LENGTH) {
+      if (wiretype != PB_WIRETYPE_VARINT &&
+          wiretype != PB_WIRETYPE_64BIT  &&
+          wiretype != PB_WIRETYPE_32BIT) {
+        error = PB_ERROR_INVALID;
+      } else if (!(error = pb_stream_skip(&stream, wiretype))) {
+        if (unlikely_(pb_stream_offset(&stream) > end)) {
+          error = PB_ERROR_OFFSET;
+          break;
+        }
+        size_t length = pb_stream_offset(&stream) - offset;
+        if (data)
+          memcpy(&(data[*size]), pb_buffer_data_from(buffer, offset), length);
+        *size += length;
+      }
+      continue;
+    }
+
+    /* Copy tag verbatim and read length of length-prefixed field */
+    size_t header = pb_stream_offset(&stream) - offset;
+    if (data)
+      memcpy(&(data[*size]), pb_buffer_data_from(buffer, offset), header);
+    *size += header;
+    uint32_t length;
+    if ((error = pb_stream_read(&stream, PB_TYPE_UINT32, &length)))
+      break;
+
+    /* Ensure that the field does not exceed the message */
+    size_t content = pb_stream_offset(&stream);
+    if (unlikely_(content + length > end)) {
+      error = PB_ERROR_OFFSET;
+      break;
+    }
+
+    /* Recurse into submessages to determine their packed length */
+    const pb_field_descriptor_t *field = tag >> 3
+      ? pb_descriptor_field_by_tag(descriptor, tag >> 3)
+      : NULL;
+    const pb_descriptor_t *nested =
+      field && pb_field_descriptor_type(field) == PB_TYPE_MESSAGE
+        ? pb_field_descriptor_nested(field)
+        : NULL;
+    size_t temp = length;
+    if (nested && (error = pack(buffer, content, content + length,
+        nested, NULL, &temp)))
+      break;
+
+    /* Write minimal length prefix */
+    uint32_t packed = temp;
+    *size += data
+      ? pb_varint_pack_uint32(&(data[*size]), &packed)
+      : pb_varint_size_uint32(&packed);
+
+    /* Write contents of submessage or copy contents verbatim */
+    if (data) {
+      if (nested) {
+        error = pack(buffer, content, content + length,
+          nested, &(data[*size]), &temp);
+      } else {
+        memcpy(&(data[*size]), pb_buffer_data_from(buffer, content), length);
+      }
+    }
+    *size += temp;
+    if (!error)
+      error = pb_stream_advance(&stream, length);
+  }
+  pb_stream_destroy(&stream);
+  return error;
+}
+
+/* ----------------------------------------------------------------------------
+ * Interface
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Create a journal.
+ *
+ * A journal is basically just a wrapper around a buffer which keeps track
+ * of all changes, so structures that refer to the buffer can sync up.
+ *
+ * \param[in] data[] Raw data
+ * \param[in] size   Raw data size
+ * \return           Journal
+ */
+extern pb_journal_t
+pb_journal_create(const uint8_t data[], size_t size) {
+  return pb_journal_create_with_allocator(&allocator_default, data, size);
+}
+
+/*!
+ * Create a journal using a custom allocator.
+ *
+ * \warning A journal does not take ownership of the provided allocator, so the
+ * caller must ensure that the allocator is not freed during operations.
+ *
+ * \param[in,out] allocator Allocator
+ * \param[in]     data[]    Raw data
+ * \param[in]     size      Raw data size
+ * \return                  Journal
+ */
+extern pb_journal_t
+pb_journal_create_with_allocator(
+    pb_allocator_t *allocator, const uint8_t data[], size_t size) {
+  assert(allocator && data && size);
+  pb_journal_t journal = {
+    .buffer = pb_buffer_create_with_allocator(allocator, data, size),
+    .entry  = {
+      .data     = NULL,
+      .size     = 0,
+      .capacity = 0,
+      .base     = 0
+    }
+  };
+  return journal;
+}
+
+/*!
+ * Create an empty journal.
+ *
+ * \return Journal
+ */
+extern pb_journal_t
+pb_journal_create_empty(void) {
+  return pb_journal_create_empty_with_allocator(&allocator_default);
+}
+
+/*!
+ * Create an empty journal using a custom allocator.
+ *
+ * \warning A journal does not take ownership of the provided allocator, so the
+ * caller must ensure that the allocator is not freed during operations.
+ *
+ * \param[in,out] allocator Allocator
+ * \return                  Journal
+ */
+extern pb_journal_t
+pb_journal_create_empty_with_allocator(pb_allocator_t *allocator) {
+  assert(allocator);
+  pb_journal_t journal = {
+    .buffer = pb_buffer_create_empty_with_allocator(allocator),
+    .entry  = {
+      .data     = NULL,
+      .size     = 0,
+      .capacity = 0,
+      .base     = 0
+    }
+  };
+  return journal;
+}
+
+/*!
+ * Create an empty journal that writes padded length prefixes.
+ *
+ * Length prefixes are always written as non-minimal varints of 5 bytes, which
+ * is still valid wire format, so a growing submessage never changes the width
+ * of its length prefix and the tail of the buffer is not moved again for every
+ * parent message. Prefixes can be re-minimized with pb_journal_pack().
+ *
+ * \return Journal
+ */
+extern pb_journal_t
+pb_journal_create_padded(void) {
+  return pb_journal_create_padded_with_allocator(&allocator_default);
+}
+
+/*!
+ * Create an empty journal that writes padded length prefixes using a custom
+ * allocator.
+ *
+ * \warning A journal does not take ownership of the provided allocator, so the
+ * caller must ensure that the allocator is not freed during operations.
+ *
+ * \param[in,out] allocator Allocator
+ * \return                  Journal
+ */
+extern pb_journal_t
+pb_journal_create_padded_with_allocator(pb_allocator_t *allocator) {
+  assert(allocator);
+  pb_journal_t journal = {
+    .buffer = pb_buffer_create_empty_with_allocator(allocator),
+    .entry  = {
+      .data     = NULL,
+      .size     = 0,
+      .capacity = 0,
+      .base     = 0
+    },
+    .padded = 1
+  };
+  return journal;
+}
+
+/*!
+ * Create a journal that is backed by a gap buffer.
+ *
+ * A gap buffer keeps a region of unused space at the position of the latest
+ * edit, so subsequent edits close to it only move the data in between, rather
+ * than the whole tail of the buffer. The gap is lazily removed when the raw
+ * data of the journal is requested. The raw data may be empty.
+ *
+ * \param[in] data[] Raw data
+ * \param[in] size   Raw data size
+ * \return           Journal
+ */
+extern pb_journal_t
+pb_journal_create_gap_buffer(const uint8_t data[], size_t size) {
+  return pb_journal_create_gap_buffer_with_allocator(
+    &allocator_default, data, size);
+}
+
+/*!
+ * Create a journal that is backed by a gap buffer using a custom allocator.
+ *
+ * \warning A journal does not take ownership of the provided allocator, so the
+ * caller must ensure that the allocator is not freed during operations.
+ *
+ * \param[in,out] allocator Allocator
+ * \param[in]     data[]    Raw data
+ * \param[in]     size      Raw data size
+ * \return                  Journal
+ */
+extern pb_journal_t
+pb_journal_create_gap_buffer_with_allocator(
+    pb_allocator_t *allocator, const uint8_t data[], size_t size) {
+  assert(allocator && (data || !size));
+  pb_journal_t journal = {
+    .buffer = size
+      ? pb_buffer_create_with_allocator(allocator, data, size)
+      : pb_buffer_create_empty_with_allocator(allocator),
+    .entry  = {
+      .data     = NULL,
+      .size     = 0,
+      .capacity = 0,
+      .base     = 0
+    },
+    .gap    = {
+      .enabled = 1,
+      .offset  = size,
+      .size    = 0
+    }
+  };
+  return journal;
+}
+
+/*!
+ * Create a zero-copy journal.
+ *
+ * \param[in,out] data[] Raw data
+ * \param[in]     size   Raw data size
+ * \return               Journal
+ */
+extern pb_journal_t
+pb_journal_create_zero_copy(uint8_t data[], size_t size) {
+  assert(data && size);
+  pb_journal_t journal = {
+    .buffer = pb_buffer_create_zero_copy(data, size),
+    .entry  = {
+      .data     = NULL,
+      .size     = 0,
+      .capacity = 0,
+      .base     = 0
+    }
+  };
+  return journal;
+}
+
+/*!
+ * Create a copy-on-write journal on top of a buffer.
+ *
+ * The journal refers to the raw data of the buffer without copying it, so a
+ * buffer that was decoded with the lite runtime can be handed over to the full
+ * runtime for free. The data is copied upon the first write, clear or pack,
+ * using the allocator of the buffer, or the default allocator if the buffer
+ * doesn't own its data. Until then, the buffer must outlive the journal.
+ *
+ * \param[in] buffer Buffer
+ * \return           Journal
+ */
+extern pb_journal_t
+pb_journal_create_copy_on_write(const pb_buffer_t *buffer) {
+  assert(buffer);
+  if (unlikely_(!pb_buffer_valid(buffer) || !pb_buffer_size(buffer)))
+    return pb_journal_create_invalid();
+
+  /* Determine allocator for copying the data upon the first write */
+  pb_allocator_t *allocator = pb_buffer_allocator(buffer);
+  if (allocator == &allocator_zero_copy ||
+      allocator == &allocator_fixed)
+    allocator = &allocator_default;
+
+  /* Refer to the raw data of the buffer */
+  pb_journal_t journal = {
+    .buffer = pb_buffer_create_zero_copy_internal(
+      (uint8_t *)pb_buffer_data(buffer), pb_buffer_size(buffer)),
+    .entry  = {
+      .data     = NULL,
+      .size     = 0,
+      .capacity = 0,
+      .base     = 0
+    },
+    .shared = allocator
+  };
+  return journal;
+}
+
+/*!
+ * Create a snapshot of a journal.
+ *
+ * The snapshot shares the raw data with the journal and all of its other
+ * snapshots without copying it, so handing a message to several consumers is
+ * cheap if most of them only read. The shared data is reference-counted and
+ * freed with the last journal referring to it. Any journal sharing the data,
+ * including the original one, copies it upon its first write, clear or pack,
+ * so the others are not affected. Journal entries are not shared, so handles
+ * must be created on the snapshot. Snapshots may be used from other threads.
+ * External segments are shared as well, retaining a reference to each.
+ *
+ * \warning The data is always copied as a whole, as the raw data of journals
+ * must be contiguous.
+ *
+ * \param[in,out] journal Journal
+ * \return                Journal
+ */
+extern pb_journal_t
+pb_journal_snapshot(pb_journal_t *journal) {
+  assert(journal);
+  if (unlikely_(!pb_journal_valid(journal) || journal->batch.active))
+    return pb_journal_create_invalid();
+
+  /* Nothing to share for empty journals */
+  if (!pb_journal_size(journal)) {
+    pb_journal_t snapshot =
+      pb_journal_create_empty_with_allocator(entry_allocator(journal));
+    snapshot.padded    = journal->padded;
+    snapshot.unordered = journal->unordered;
+    return external_share(journal, &snapshot);
+  }
+
+  /* Share data of journal */
+  if (unlikely_(share(journal)))
+    return pb_journal_create_invalid();
+  __atomic_add_fetch(&(journal->snapshot->references), 1, __ATOMIC_RELAXED);
+
+  /* Refer to the shared data */
+  pb_journal_t snapshot = {
+    .buffer    = pb_buffer_create_zero_copy_internal(
+      (uint8_t *)pb_journal_data(journal), pb_journal_size(journal)),
+    .entry     = {
+      .data     = NULL,
+      .size     = 0,
+      .capacity = 0,
+      .base     = 0
+    },
+    .gap       = {
+      .enabled = journal->gap.enabled,
+      .offset  = pb_journal_size(journal),
+      .size    = 0
+    },
+    .padded    = journal->padded,
+    .unordered = journal->unordered,
+    .shared    = journal->shared,
+    .snapshot  = journal->snapshot
+  };
+  return external_share(journal, &snapshot);
+}
+
+/*!
+ * Create a journal by taking ownership of a buffer.
+ *
+ * The raw data, capacity and allocator of the buffer are moved into the
+ * journal without copying, and the buffer is invalidated, so destroying it
+ * afterwards is a no-op. If the buffer doesn't own its data, i.e. it's a
+ * zero-copy or fixed buffer, a copy-on-write journal is created instead, see
+ * pb_journal_create_copy_on_write() for details.
+ *
+ * \param[in,out] buffer Buffer
+ * \return               Journal
+ */
+extern pb_journal_t
+pb_journal_create_from_buffer(pb_buffer_t *buffer) {
+  assert(buffer);
+  if (unlikely_(!pb_buffer_valid(buffer)))
+    return pb_journal_create_invalid();
+  pb_journal_t journal;
+
+  /* Buffer doesn't own its data, so refer to it until the first write */
+  pb_allocator_t *allocator = pb_buffer_allocator(buffer);
+  if (allocator == &allocator_zero_copy ||
+      allocator == &allocator_fixed) {
+    journal = pb_buffer_size(buffer)
+      ? pb_journal_create_copy_on_write(buffer)
+      : pb_journal_create_empty();
+
+  /* Otherwise move buffer into journal */
+  } else {
+    journal = (pb_journal_t){
+      .buffer = *buffer,
+      .entry  = {
+        .data     = NULL,
+        .size     = 0,
+        .capacity = 0,
+        .base     = 0
+      }
+    };
+  }
+  *buffer = pb_buffer_create_invalid();
+  return journal;
+}
+
+/*!
+ * Create a journal by taking ownership of the buffer of an encoder.
+ *
+ * The encoded message is moved into the journal without copying, so it can
+ * be altered through the message interface afterwards, and the encoder is
+ * invalidated. See pb_journal_create_from_buffer() for details.
+ *
+ * \warning The encoder may neither reference any segments nor be in the middle
+ * of a nested message, as its buffer doesn't hold the whole message then.
+ *
+ * \param[in,out] encoder Encoder
+ * \return                Journal
+ */
+extern pb_journal_t
+pb_journal_create_from_encoder(pb_encoder_t *encoder) {
+  assert(encoder);
+  if (unlikely_(!pb_encoder_valid(encoder) ||
+                encoder->frame || encoder->segment.size))
+    return pb_journal_create_invalid();
+
+  /* Release list of referenced segments retained for reuse */
+  if (encoder->segment.data) {
+    pb_allocator_free(pb_buffer_allocator(&(encoder->buffer)),
+      encoder->segment.data);
+    encoder->segment.data     = NULL;
+    encoder->segment.capacity = 0;
+  }
+  return pb_journal_create_from_buffer(&(encoder->buffer));
+}
+
+/*!
+ * Create a read-only journal.
+ *
+ * The journal refers to the raw data without copying it and is frozen from
+ * the start, so all writes fail. See pb_journal_freeze() for details.
+ *
+ * \param[in] data[] Raw data
+ * \param[in] size   Raw data size
+ * \return           Journal
+ */
+extern pb_journal_t
+pb_journal_create_readonly(const uint8_t data[], size_t size) {
+  assert(data && size);
+  pb_journal_t journal = {
+    .buffer = pb_buffer_create_zero_copy((uint8_t *)data, size),
+    .entry  = {
+      .data     = NULL,
+      .size     = 0,
+      .capacity = 0,
+      .base     = 0
+    },
+    .frozen = 1
+  };
+  return journal;
+}
+
+/*!
+ * Destroy a journal.
+ *
+ * \param[in,out] journal Journal
+ */
+extern void
+pb_journal_destroy(pb_journal_t *journal) {
+  assert(journal);
+  if (pb_journal_valid(journal)) {
+    if (journal->entry.data) {
+      pb_allocator_t *allocator = entry_allocator(journal);
+      pb_allocator_free(allocator, journal->entry.data);
+
+      /* Clear entries */
+      journal->entry.data     = NULL;
+      journal->entry.size     = 0;
+      journal->entry.capacity = 0;
+      journal->entry.base     = 0;
+    }
+    if (journal->edit.data) {
+      pb_allocator_free(entry_allocator(journal), journal->edit.data);
+      journal->edit.data = NULL;
+    }
+    index_free(journal);
+    pb_journal_detach(journal);
+    pb_decoder_index_destroy(&(journal->fields));
+    pb_buffer_destroy(&(journal->buffer));
+    if (journal->snapshot)
+      release(journal);
+  }
+}
+
+/*!
+ * Compact a journal by discarding all entries preceding the given version.
+ *
+ * Journal entries are only needed to align parts that were created or last
+ * aligned at an older version, so the caller must ensure that no live handle
+ * refers to a version preceding the given one. Otherwise, aligning such a
+ * handle will invalidate it. Versions remain monotonic across compactions.
+ *
+ * If the entry log is considerably larger than the remaining entries, excess
+ * capacity is released. Failure to do so is silently tolerated.
+ *
+ * \param[in,out] journal Journal
+ * \param[in]     version Version
+ * \return                Error code
+ */
+extern pb_error_t
+pb_journal_compact(pb_journal_t *journal, pb_version_t version) {
+  assert(journal);
+  if (unlikely_(!pb_journal_valid(journal)))
+    return PB_ERROR_INVALID;
+
+  /* Check valid version */
+  if (unlikely_(version > pb_journal_version(journal)))
+    return PB_ERROR_OFFSET;
+  if (version <= journal->entry.base)
+    return PB_ERROR_NONE;
+
+  /* Resolve pending updates of the current batch before compacting */
+  pb_error_t error = pb_part_flush(journal);
+  if (unlikely_(error))
+    return error;                                          /* LCOV_EXCL_LINE */
+
+  /* Discard entries preceding version */
+  size_t count = version - journal->entry.base;
+  journal->entry.size -= count;
+  journal->entry.base  = version;
+  if (journal->entry.size)
+    memmove(journal->entry.data, &(journal->entry.data[count]),
+      sizeof(pb_journal_entry_t) * journal->entry.size);
+
+  /* Release excess capacity of the journal entry log */
+  pb_allocator_t *allocator = entry_allocator(journal);
+  if (!journal->entry.size) {
+    pb_allocator_free(allocator, journal->entry.data);
+    journal->entry.data     = NULL;
+    journal->entry.capacity = 0;
+  } else if (journal->entry.capacity > PB_JOURNAL_ENTRY_CAPACITY &&
+             journal->entry.capacity > journal->entry.size * 4) {
+    size_t capacity = journal->entry.size * 2;
+    pb_journal_entry_t *data = pb_allocator_resize(allocator,
+      journal->entry.data, sizeof(pb_journal_entry_t) * capacity);
+    if (data) {
+      journal->entry.data     = data;
+      journal->entry.capacity = capacity;
+    }
+  }
+
+  /* Rebuild index for remaining entries */
+  index_build(journal);
+  return PB_ERROR_NONE;
+}
+
+/*!
+ * Create a checkpoint by discarding the entire history of a journal.
+ *
+ * This bounds both the memory of long-lived journals and the alignment cost
+ * of handles. All live handles must be aligned before creating a checkpoint,
+ * see pb_journal_compact() for details.
+ *
+ * \param[in,out] journal Journal
+ * \return                Error code
+ */
+extern pb_error_t
+pb_journal_checkpoint(pb_journal_t *journal) {
+  assert(journal);
+  return pb_journal_compact(journal, pb_journal_version(journal));
+}
+
+/*!
+ * Release all excess memory of a journal.
+ *
+ * Journals retain the capacity of their buffer and their entry and edit logs
+ * after messages are cleared or fields are erased, so they don't need to be
+ * grown again when being reused. For long-lived journals that become idle,
+ * e.g. upon memory pressure, trimming releases the unused capacity of the
+ * buffer, including the gap of a gap buffer, and shrinks the logs and the
+ * entry index to their actual size. The history of the journal is retained,
+ * so all live handles remain valid. Combined with a checkpoint, all memory
+ * except for the raw data is released.
+ *
+ * Like any write, trimming may move the raw data of the journal. If the
+ * journal refers to shared data, only its logs are trimmed.
+ *
+ * \param[in,out] journal Journal
+ * \return                Error code
+ */
+extern pb_error_t
+pb_journal_trim(pb_journal_t *journal) {
+  assert(journal);
+  if (unlikely_(!pb_journal_valid(journal)))
+    return PB_ERROR_INVALID;
+
+  /* Shrink entry log and rebuild index for its new capacity */
+  size_t capacity = journal->entry.capacity;
+  trim(journal, (void **)&(journal->entry.data), journal->entry.size,
+    &(journal->entry.capacity), sizeof(pb_journal_entry_t));
+  if (journal->entry.capacity != capacity)
+    index_build(journal);
+
+  /* Shrink edit log */
+  trim(journal, (void **)&(journal->edit.data), journal->edit.size,
+    &(journal->edit.capacity), sizeof(pb_journal_edit_t));
+
+  /* Release index of field offsets, if outdated */
+  if (!pb_journal_index(journal))
+    pb_decoder_index_destroy(&(journal->fields));
+
+  /* Release gap and excess capacity of buffer */
+  pb_journal_flatten(journal);
+  return pb_buffer_shrink_to_fit(&(journal->buffer));
+}
+
+/*!
+ * Attach a caller-owned value to a journal as an external segment.
+ *
+ * Large strings and bytes written into a journal are copied into its buffer,
+ * and every later write in front of them moves them again. Instead, a value
+ * can be attached as a field of the root message that is kept out-of-line,
+ * so writes never touch it. The journal takes over the reference the caller
+ * holds, and invokes the release callback when the last journal referring to
+ * the value, including snapshots, drops it.
+ *
+ * External segments are stitched in only upon serialization, as they follow
+ * the raw data of the journal in the vectors returned by pb_journal_iovec().
+ * As concatenated messages are merged, this is equivalent to appending the
+ * field to the root message. However, external segments are invisible to
+ * messages, cursors and the raw data of the journal, and are not recorded
+ * as edits. If the journal is frozen, attaching values is not allowed.
+ *
+ * If attaching fails, the release callback is invoked right away.
+ *
+ * \param[in,out] journal Journal
+ * \param[in]     tag     Tag
+ * \param[in]     value   Caller-owned value
+ * \param[in]     release Release callback
+ * \param[in,out] data    Release callback data
+ * \return                Error code
+ */
+extern pb_error_t
+pb_journal_attach(
+    pb_journal_t *journal, pb_tag_t tag, const pb_string_t *value,
+    pb_journal_release_f release, void *data) {
+  assert(journal && value);
+  return attach(journal, tag, value, 0, release, data);
+}
+
+/*!
+ * Attach a fragment to a journal as an external segment.
+ *
+ * The fragment is retained by the journal and released when the last journal
+ * referring to it, including snapshots, drops it. As the key and length
+ * prefix are part of the fragment, it takes a single vector when serialized
+ * with pb_journal_iovec(). See pb_journal_attach() for details.
+ *
+ * \param[in,out] journal  Journal
+ * \param[in,out] fragment Fragment
+ * \return                 Error code
+ */
+extern pb_error_t
+pb_journal_attach_fragment(pb_journal_t *journal, pb_fragment_t *fragment) {
+  assert(journal && fragment);
+  pb_string_t value = pb_string_init(
+    (uint8_t *)pb_fragment_data(fragment), pb_fragment_size(fragment));
+  return attach(journal, pb_fragment_tag(fragment), &value, 1,
+    fragment_release, pb_fragment_retain(fragment));
+}
+
+/*!
+ * Detach all external segments from a journal.
+ *
+ * \param[in,out] journal Journal
+ */
+extern void
+pb_journal_detach(pb_journal_t *journal) {
+  assert(journal);
+  if (journal->external.data) {
+    for (size_t e = 0; e < journal->external.size; e++)
+      external_release(journal->external.data[e]);
+    pb_allocator_free(owner_allocator(journal), journal->external.data);
+    journal->external.data     = NULL;
+    journal->external.size     = 0;
+    journal->external.capacity = 0;
+  }
+}
+
+/*!
+ * Retrieve the serialized length of a journal.
+ *
+ * This includes the raw data of the journal and all external segments.
+ *
+ * \param[in] journal Journal
+ * \return            Serialized length
+ */
+extern size_t
+pb_journal_length(const pb_journal_t *journal) {
+  assert(journal);
+  size_t length = pb_journal_size(journal);
+  for (size_t e = 0; e < journal->external.size; e++) {
+    const pb_journal_external_t *external = journal->external.data[e];
+    length += external->size + pb_string_size(&(external->value));
+  }
+  return length;
+}
+
+/*!
+ * Retrieve the serialized message of a journal as a list of I/O vectors.
+ *
+ * The first vector refers to the raw data of the journal, followed by the key
+ * and length prefix and the value of every external segment, so they can
+ * directly be passed to writev() without copying attached values. At most
+ * the given number of vectors is written, but the number of vectors required
+ * is always returned. Empty values and an empty journal take no vector, and
+ * neither do the key and length prefix of fragments, which are part of them.
+ *
+ * \param[in]  journal Journal
+ * \param[out] iov[]   I/O vectors
+ * \param[in]  size    I/O vector count
+ * \return             I/O vectors required
+ */
+extern size_t
+pb_journal_iovec(const pb_journal_t *journal, struct iovec *iov, size_t size) {
+  assert(journal && (iov || !size));
+  size_t count = 0;
+  if (!pb_journal_empty(journal)) {
+    if (count < size)
+      iov[count] = (struct iovec){
+        (void *)pb_journal_data(journal), pb_journal_size(journal) };
+    count++;
+  }
+
+  /* Add key and length prefix and value of external segments */
+  for (size_t e = 0; e < journal->external.size; e++) {
+    pb_journal_external_t *external = journal->external.data[e];
+    if (external->size) {
+      if (count < size)
+        iov[count] = (struct iovec){ external->prefix, external->size };
+      count++;
+    }
+    if (pb_string_size(&(external->value))) {
+      if (count < size)
+        iov[count] = (struct iovec){
+          pb_string_data(&(external->value)),
+          pb_string_size(&(external->value)) };
+      count++;
+    }
+  }
+  return count;
+}
+
+/*!
+ * Hand an index of field offsets over to a journal.
+ *
+ * If a message was decoded with an index attached to the decoder before it
+ * is opened with the full runtime, the index can be handed over to the
+ * journal, so cursors over the root message, and thus all accessors, look up
+ * the offsets of fields instead of scanning the message. The journal takes
+ * ownership of the entries of the index, and the index is reset, so it can be
+ * reused for decoding the next message. The index is used until the first
+ * write, clear or pack, after which cursors fall back to scanning.
  *
- * If allocation fails, the journal's internal state is fully recoverable.
+ * \warning The index must have been created from the exact raw data of the
+ * journal, which is only checked by comparing sizes.
  *
  * \param[in,out] journal Journal
- * \param[in]     origin  Origin
- * \param[in]     offset  Offset
- * \param[in]     delta   Delta
+ * \param[in,out] index   Index
  * \return                Error code
  */
-static pb_error_t
-push(
-    pb_journal_t *journal, size_t origin, size_t offset, ptrdiff_t delta) {
-  assert(journal && origin <= offset && delta);
-  assert(pb_journal_valid(journal));
-  pb_allocator_t *allocator = pb_buffer_allocator(&(journal->buffer));
-  if (unlikely_(allocator == &allocator_zero_copy))
-    return PB_ERROR_ALLOC;
+extern pb_error_t
+pb_journal_set_index(pb_journal_t *journal, pb_decoder_index_t *index) {
+  assert(journal && index);
+  if (unlikely_(!pb_journal_valid(journal) || journal->revision ||
+                !pb_decoder_index_complete(index) ||
+                index->size != pb_journal_size(journal)))
+    return PB_ERROR_INVALID;
 
-  /* Grow journal and append entry */
-  pb_journal_entry_t *data = pb_allocator_resize(allocator,
-    journal->entry.data, sizeof(pb_journal_entry_t)
-      * (journal->entry.size + 1));
-  if (data) {
-    journal->entry.data = data;
-    journal->entry.data[journal->entry.size++] = (pb_journal_entry_t){
-      .origin = origin,
-      .offset = offset,
-      .delta  = delta
-    };
-    return PB_ERROR_NONE;
+  /* Move entries of index into journal */
+  pb_decoder_index_destroy(&(journal->fields));
+  journal->fields = *index;
+  *index = pb_decoder_index_create_with_allocator(index->allocator);
+  return PB_ERROR_NONE;
+}
+
+/*!
+ * Attach a trace to a journal to record all subsequent operations.
+ *
+ * The current contents of the journal are recorded as a snapshot, followed
+ * by every operation of the full runtime that alters messages of the journal
+ * through its public interface, i.e. pb_message_create_within(), put, erase
+ * and clear of messages, as well as put and erase of cursors. Operations that
+ * are invoked from within another operation are not recorded. The trace is
+ * owned by the caller and must outlive the attachment. Passing NULL detaches
+ * the current trace.
+ *
+ * \param[in,out] journal Journal
+ * \param[in,out] trace   Trace or NULL
+ * \return                Error code
+ */
+extern pb_error_t
+pb_journal_set_trace(pb_journal_t *journal, pb_trace_t *trace) {
+  assert(journal);
+  pb_error_t error = PB_ERROR_NONE;
+  if (trace) {
+    if (unlikely_(!pb_journal_valid(journal) || !pb_trace_valid(trace) ||
+                  trace->active))
+      return PB_ERROR_INVALID;
+    error = pb_trace_snapshot(trace, journal);
   }
-  return PB_ERROR_ALLOC;
+  if (likely_(!error))
+    journal->trace = trace;
+  return error;
 }
 
-/* LCOV_EXCL_START >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>> */
+/*!
+ * Pack a journal by re-encoding all length prefixes as minimal varints.
+ *
+ * This is mainly meant to be called after building a message in a journal
+ * with padded length prefixes and before sending it. The journal is rewritten
+ * as a whole, so all parts referring to it are invalidated. Subsequent writes
+ * will not pad length prefixes anymore. If the journal cannot be packed, its
+ * contents are not altered.
+ *
+ * \param[in,out] journal    Journal
+ * \param[in]     descriptor Descriptor
+ * \return                   Error code
+ */
+extern pb_error_t
+pb_journal_pack(pb_journal_t *journal, const pb_descriptor_t *descriptor) {
+  assert(journal && descriptor);
+  if (unlikely_(!pb_journal_valid(journal) || journal->frozen))
+    return PB_ERROR_INVALID;
+
+  /* Resolve pending updates of the current batch */
+  pb_error_t error = pb_part_flush(journal);
+  if (unlikely_(error))
+    return error;                                          /* LCOV_EXCL_LINE */
+
+  /* Copy shared data, as packing writes in place */
+  if (unlikely_(error = unshare(journal)))
+    return error;
+
+  /* Determine packed size */
+  const pb_buffer_t *buffer = pb_journal_buffer(journal);
+  size_t size;
+  if ((error = pack(buffer, 0, pb_buffer_size(buffer), descriptor,
+      NULL, &size)))
+    return error;
+
+  /* Record packing as a rewrite of the whole journal */
+  if (unlikely_(error = record(journal, 0, pb_buffer_size(buffer), size)))
+    return error;
+  journal->revision++;
+
+  /* Pack into temporary memory and copy back, as packing never grows */
+  if (size) {
+    pb_allocator_t *allocator = pb_buffer_allocator(buffer);
+    uint8_t *data = pb_allocator_allocate(allocator, size);
+    if (unlikely_(!data))
+      return PB_ERROR_ALLOC;
+    if (!(error = pack(buffer, 0, pb_buffer_size(buffer), descriptor,
+        data, &size)))
+      memcpy(journal->buffer.data, data, size);
+    pb_allocator_free(allocator, data);
+    if (unlikely_(error))
+      return error;                                        /* LCOV_EXCL_LINE */
+  }
+  journal->buffer.size = size;
+  if (journal->gap.enabled)
+    journal->gap.offset = size;
+
+  /* Invalidate all parts by advancing the version behind all entries */
+  journal->entry.base    = pb_journal_version(journal) + 1;
+  journal->entry.size    = 0;
+  journal->batch.version = PB_VERSION_MAX;
+  journal->padded        = 0;
+  index_build(journal);
+  return PB_ERROR_NONE;
+}
 
 /*!
- * Remove the latest entry from the journal.
+ * Begin a batch of writes on a journal.
+ *
+ * Within a batch, the length prefix updates of all messages containing the
+ * message that is currently written to are deferred, so that filling a nested
+ * message with many fields only updates the length prefixes of its ancestors
+ * once. Pending updates are resolved as soon as another message is accessed
+ * through a cursor, a part is cleared, or the batch is committed.
+ *
+ * \warning Until the batch is committed, the raw data of the journal may not
+ * be consistent, so it must not be read or passed to a decoder.
  *
  * \param[in,out] journal Journal
  */
-static void
-pop(pb_journal_t *journal) {
+extern void
+pb_journal_begin_batch(pb_journal_t *journal) {
   assert(journal);
-  assert(pb_journal_valid(journal));
-  if (journal->entry.size)
-    --journal->entry.size;
+  journal->batch.active  = 1;
+  journal->batch.version = PB_VERSION_MAX;
+  journal->batch.delta   = 0;
 }
 
-/* LCOV_EXCL_STOP <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<< */
+/*!
+ * Commit a batch of writes on a journal and resolve all pending updates.
+ *
+ * \param[in,out] journal Journal
+ * \return                Error code
+ */
+extern pb_error_t
+pb_journal_commit(pb_journal_t *journal) {
+  assert(journal);
+  if (unlikely_(!pb_journal_valid(journal)))
+    return PB_ERROR_INVALID;
+  pb_error_t error = journal->batch.active
+    ? pb_part_flush(journal)
+    : PB_ERROR_NONE;
+  journal->batch.active = 0;
+  return error;
+}
 
-/* ----------------------------------------------------------------------------
- * Interface
- * ------------------------------------------------------------------------- */
+/*!
+ * Flatten a journal that is backed by a gap buffer.
+ *
+ * The gap is moved to the end of the buffer, where it is equivalent to unused
+ * capacity, so the raw data of the journal is contiguous.
+ *
+ * \param[in,out] journal Journal
+ */
+extern void
+pb_journal_flatten(pb_journal_t *journal) {
+  assert(journal);
+  if (journal->gap.size) {
+    gap_move(journal, journal->buffer.size);
+    journal->gap.size = 0;
+  }
+}
 
 /*!
- * Create a journal.
+ * Freeze a journal, so it becomes read-only.
  *
- * A journal is basically just a wrapper around a buffer which keeps track
- * of all changes, so structures that refer to the buffer can sync up.
+ * All subsequent writes, clears and packs fail with an invalid error. As the
+ * version of a frozen journal is pinned, handles only need to be aligned once
+ * and every later alignment check succeeds right away, without walking any
+ * journal entries. A gap buffer is flattened, so the raw data is contiguous.
+ * If a batch is active, its pending updates are resolved and it is committed.
  *
- * \param[in] data[] Raw data
- * \param[in] size   Raw data size
- * \return           Journal
+ * \param[in,out] journal Journal
+ * \return                Error code
  */
-extern pb_journal_t
-pb_journal_create(const uint8_t data[], size_t size) {
-  return pb_journal_create_with_allocator(&allocator_default, data, size);
+extern pb_error_t
+pb_journal_freeze(pb_journal_t *journal) {
+  assert(journal);
+
+  /* Resolve pending updates of the current batch before freezing */
+  pb_error_t error = pb_part_flush(journal);
+  if (unlikely_(error))
+    return error;                                          /* LCOV_EXCL_LINE */
+  journal->batch.active = 0;
+
+  /* Flatten gap buffer and pin version */
+  pb_journal_flatten(journal);
+  journal->frozen = 1;
+  return PB_ERROR_NONE;
 }
 
 /*!
- * Create a journal using a custom allocator.
+ * Set whether new fields are appended to the end of their messages.
  *
- * \warning A journal does not take ownership of the provided allocator, so the
- * caller must ensure that the allocator is not freed during operations.
+ * By default, new fields are inserted in tag order, which requires scanning
+ * the message for the insertion point. The wire format doesn't demand any
+ * order, so if the journal is unordered, new fields are appended to the end
+ * of their message. Occurrences of repeated fields are appended without any
+ * scan at all, except for packed fields, whose last packed field is still
+ * looked up. The order can be restored with pb_message_canonicalize().
  *
- * \param[in,out] allocator Allocator
- * \param[in]     data[]    Raw data
- * \param[in]     size      Raw data size
- * \return                  Journal
+ * \param[in,out] journal   Journal
+ * \param[in]     unordered Unordered append flag
  */
-extern pb_journal_t
-pb_journal_create_with_allocator(
-    pb_allocator_t *allocator, const uint8_t data[], size_t size) {
-  assert(allocator && data && size);
-  pb_journal_t journal = {
-    .buffer = pb_buffer_create_with_allocator(allocator, data, size),
-    .entry  = {
-      .data = NULL,
-      .size = 0
-    }
-  };
-  return journal;
+extern void
+pb_journal_set_unordered(pb_journal_t *journal, int unordered) {
+  assert(journal);
+  journal->unordered = !!unordered;
 }
 
 /*!
- * Create an empty journal.
+ * Reserve space for the buffer of a journal to hold the given total size.
  *
- * \return Journal
+ * Reserving space does not change the size of the journal, so no entry is
+ * added and parts referring to the journal need not be aligned.
+ *
+ * \param[in,out] journal Journal
+ * \param[in]     size    Total size
+ * \return                Error code
  */
-extern pb_journal_t
-pb_journal_create_empty(void) {
-  return pb_journal_create_empty_with_allocator(&allocator_default);
+extern pb_error_t
+pb_journal_reserve(pb_journal_t *journal, size_t size) {
+  assert(journal);
+  pb_error_t error = unshare(journal);
+  if (unlikely_(error))
+    return error;
+  return pb_buffer_reserve(pb_journal_buffer(journal), size);
 }
 
 /*!
- * Create an empty journal using a custom allocator.
+ * Start recording the edits of a journal, so patches can be exported.
  *
- * \warning A journal does not take ownership of the provided allocator, so the
- * caller must ensure that the allocator is not freed during operations.
+ * Every write to the journal is recorded with its offsets and the size of
+ * the replacement, but not its data, which is read from the journal when a
+ * patch is exported with pb_journal_diff(). Previously recorded edits are
+ * discarded, so patches can be exported from the current revision onwards.
  *
- * \param[in,out] allocator Allocator
- * \return                  Journal
+ * \param[in,out] journal Journal
+ * \return                Error code
  */
-extern pb_journal_t
-pb_journal_create_empty_with_allocator(pb_allocator_t *allocator) {
-  assert(allocator);
-  pb_journal_t journal = {
-    .buffer = pb_buffer_create_empty_with_allocator(allocator),
-    .entry  = {
-      .data = NULL,
-      .size = 0
-    }
-  };
-  return journal;
+extern pb_error_t
+pb_journal_record(pb_journal_t *journal) {
+  assert(journal);
+  if (unlikely_(!pb_journal_valid(journal)))
+    return PB_ERROR_INVALID;
+  pb_allocator_t *allocator = entry_allocator(journal);
+  if (unlikely_(allocator == &allocator_zero_copy ||
+                allocator == &allocator_fixed))
+    return PB_ERROR_ALLOC;
+  journal->edit.size    = 0;
+  journal->edit.base    = journal->revision;
+  journal->edit.enabled = 1;
+  return PB_ERROR_NONE;
 }
 
 /*!
- * Create a zero-copy journal.
+ * Export the edits of a journal since the given revision as a patch.
  *
- * \param[in,out] data[] Raw data
- * \param[in]     size   Raw data size
- * \return               Journal
+ * The recorded edits are merged into a sorted list of disjoint ranges of the
+ * journal at the given revision together with their replacement data, which
+ * includes all updated length prefixes, so a replica of the journal at that
+ * revision can be brought up to date with pb_journal_apply_patch(). The patch
+ * is appended to the given buffer and encoded as follows, all integers being
+ * variable-sized:
+ *
+ * -# The size of the journal at the given revision.
+ *
+ * -# For each range, the distance from the end of the previous range, the
+ *    size of the replaced data, the size of the replacement and the
+ *    replacement itself.
+ *
+ * Merging is quadratic in the number of disjoint ranges in the worst case,
+ * so patches should be exported regularly.
+ *
+ * \param[in,out] journal  Journal
+ * \param[in]     revision Revision
+ * \param[in,out] patch    Patch
+ * \return                 Error code
  */
-extern pb_journal_t
-pb_journal_create_zero_copy(uint8_t data[], size_t size) {
-  assert(data && size);
-  pb_journal_t journal = {
-    .buffer = pb_buffer_create_zero_copy(data, size),
-    .entry  = {
-      .data = NULL,
-      .size = 0
+extern pb_error_t
+pb_journal_diff(pb_journal_t *journal, size_t revision, pb_buffer_t *patch) {
+  assert(journal && patch);
+  if (unlikely_(!pb_journal_valid(journal) || !pb_buffer_valid(patch) ||
+                !journal->edit.enabled))
+    return PB_ERROR_INVALID;
+  if (unlikely_(revision < journal->edit.base ||
+                revision > journal->revision))
+    return PB_ERROR_OFFSET;
+
+  /* Resolve pending updates of the current batch */
+  pb_error_t error = pb_part_flush(journal);
+  if (unlikely_(error))
+    return error;                                          /* LCOV_EXCL_LINE */
+
+  /* Allocate temporary space for ranges */
+  size_t count = journal->revision - revision, used = 0;
+  pb_allocator_t *allocator = entry_allocator(journal);
+  pb_journal_range_t *range = NULL;
+  if (count && unlikely_(!(range = pb_allocator_allocate(allocator,
+      sizeof(pb_journal_range_t) * count))))
+    return PB_ERROR_ALLOC;
+
+  /* Merge edits into sorted, disjoint ranges of current offsets */
+  for (size_t e = revision - journal->edit.base;
+      e < journal->edit.size; e++) {
+    const pb_journal_edit_t *edit = &(journal->edit.data[e]);
+    ptrdiff_t delta = edit->size - (edit->end - edit->start);
+
+    /* Find first range touching the edit */
+    size_t lo = 0, hi = used;
+    while (lo < hi) {
+      size_t mid = lo + (hi - lo) / 2;
+      if (range[mid].end < edit->start) {
+        lo = mid + 1;
+      } else {
+        hi = mid;
+      }
     }
-  };
-  return journal;
+
+    /* Merge all ranges touching the edit */
+    pb_journal_range_t merged = {
+      .start = edit->start,
+      .end   = edit->end,
+      .size  = edit->end - edit->start
+    };
+    size_t r = lo;
+    for (; r < used && range[r].start <= edit->end; r++) {
+      if (range[r].start < merged.start) {
+        merged.size += merged.start - range[r].start;
+        merged.start = range[r].start;
+      }
+      if (range[r].end > merged.end) {
+        merged.size += range[r].end - merged.end;
+        merged.end   = range[r].end;
+      }
+      merged.size -= (range[r].end - range[r].start) - range[r].size;
+    }
+    merged.end += delta;
+
+    /* Replace merged ranges and move subsequent ranges */
+    if (r - lo != 1)
+      memmove(&(range[lo + 1]), &(range[r]),
+        sizeof(pb_journal_range_t) * (used - r));
+    used = used - (r - lo) + 1;
+    range[lo] = merged;
+    for (r = lo + 1; r < used; r++) {
+      range[r].start += delta;
+      range[r].end   += delta;
+    }
+  }
+
+  /* Determine size of journal at revision and size of patch */
+  uint64_t base = pb_journal_size(journal), offset = 0;
+  for (size_t r = 0; r < used; r++)
+    base -= (range[r].end - range[r].start) - range[r].size;
+  size_t size = pb_varint_size_uint64(&base);
+  for (size_t r = 0, shift = 0; r < used; r++) {
+    uint64_t start = range[r].start - shift, values[3] = {
+      start - offset,
+      range[r].size,
+      range[r].end - range[r].start
+    };
+    for (size_t v = 0; v < 3; v++)
+      size += pb_varint_size_uint64(&(values[v]));
+    size  += values[2];
+    offset = start + range[r].size;
+    shift += (range[r].end - range[r].start) - range[r].size;
+  }
+
+  /* Grow patch once and write ranges in offsets of the revision */
+  uint8_t *data = pb_buffer_grow(patch, size);
+  if (unlikely_(!data)) {
+    error = PB_ERROR_ALLOC;
+  } else {
+    data  += pb_varint_pack_uint64(data, &base);
+    offset = 0;
+    for (size_t r = 0, shift = 0; r < used; r++) {
+      uint64_t start = range[r].start - shift, values[3] = {
+        start - offset,
+        range[r].size,
+        range[r].end - range[r].start
+      };
+      for (size_t v = 0; v < 3; v++)
+        data += pb_varint_pack_uint64(data, &(values[v]));
+      uint64_t value = values[2];
+      if (value)
+        memcpy(data, pb_journal_data_from(journal, range[r].start), value);
+      data  += value;
+      offset = start + range[r].size;
+      shift += (range[r].end - range[r].start) - range[r].size;
+    }
+  }
+  if (range)
+    pb_allocator_free(allocator, range);
+  return error;
 }
 
 /*!
- * Destroy a journal.
+ * Apply a patch to a journal.
+ *
+ * The journal must be a replica of the journal the patch was exported from
+ * at the revision given to pb_journal_diff(). The patch is checked as a whole
+ * before it is applied, so an invalid patch or a patch for a journal of a
+ * different size leaves the journal unaltered. Ranges are written one by one,
+ * so parts referring to the journal are aligned as for any other write.
+ *
+ * \warning If a write fails due to an allocation error, the patch is only
+ * partially applied, and the replica should be discarded.
  *
  * \param[in,out] journal Journal
+ * \param[in]     patch   Patch
+ * \return                Error code
  */
-extern void
-pb_journal_destroy(pb_journal_t *journal) {
-  assert(journal);
-  if (pb_journal_valid(journal)) {
-    if (journal->entry.data) {
-      pb_allocator_t *allocator = pb_buffer_allocator(&(journal->buffer));
-      pb_allocator_free(allocator, journal->entry.data);
+extern pb_error_t
+pb_journal_apply_patch(pb_journal_t *journal, const pb_buffer_t *patch) {
+  assert(journal && patch);
+  if (unlikely_(!pb_journal_valid(journal) || !pb_buffer_valid(patch)))
+    return PB_ERROR_INVALID;
+  pb_error_t error = PB_ERROR_NONE;
 
-      /* Clear entries */
-      journal->entry.data = NULL;
-      journal->entry.size = 0;
+  /* Check patch, then apply it */
+  for (int apply = 0; !error && apply < 2; apply++) {
+    pb_stream_t stream = pb_stream_create(patch);
+    uint64_t base, offset = 0;
+    ptrdiff_t shift = 0;
+    if (!(error = pb_stream_read(&stream, PB_TYPE_UINT64, &base)) &&
+        base != pb_journal_size(journal))
+      error = PB_ERROR_INVALID;
+
+    /* Read ranges */
+    while (!error && pb_stream_left(&stream)) {
+      uint64_t distance, replaced, size;
+      if ((error = pb_stream_read(&stream, PB_TYPE_UINT64, &distance)) ||
+          (error = pb_stream_read(&stream, PB_TYPE_UINT64, &replaced)) ||
+          (error = pb_stream_read(&stream, PB_TYPE_UINT64, &size)))
+        break;
+      if (unlikely_(distance > base - offset ||
+                    replaced > base - offset - distance ||
+                    size > pb_stream_left(&stream))) {
+        error = PB_ERROR_INVALID;
+        break;
+      }
+      const uint8_t *data = pb_buffer_data_from(patch,
+        pb_stream_offset(&stream));
+      error = pb_stream_advance(&stream, size);
+
+      /* Write replacement */
+      size_t start = offset + distance + shift;
+      if (!error && apply) {
+        error = size
+          ? pb_journal_write(journal, start, start, start + replaced,
+              data, size)
+          : pb_journal_clear(journal, start, start, start + replaced);
+      }
+      offset += distance + replaced;
+      shift  += size - replaced;
     }
-    pb_buffer_destroy(&(journal->buffer));
+    pb_stream_destroy(&stream);
   }
+  return error;
 }
 
 /*!
@@ -222,22 +2029,28 @@ pb_journal_write(
     pb_journal_t *journal, size_t origin, size_t start, size_t end,
     const uint8_t data[], size_t size) {
   assert(journal && data && size);
-  if (unlikely_(!pb_journal_valid(journal)))
+  if (unlikely_(!pb_journal_valid(journal) || journal->frozen))
     return PB_ERROR_INVALID;
-  pb_error_t error = PB_ERROR_NONE;
+  pb_error_t error = unshare(journal);
+  if (unlikely_(error))
+    return error;
 
-  /* Perform journaled write if size changed */
+  /* Perform journaled write if size changed, unless offsets would overflow */
   ptrdiff_t delta = size - (end - start);
+  pb_probe4(journal__write, journal, start, size, delta);
+  if (unlikely_(delta > 0 &&
+      pb_journal_size(journal) + delta > PB_OFFSET_MAX))
+    return PB_ERROR_OFFSET;
   if (delta) {
     if (likely_(!(error = push(journal, origin, end, delta)))) {
-      error = pb_buffer_write(&(journal->buffer), start, end, data, size);
+      error = store_write(journal, start, end, data, size);
       if (unlikely_(error))
         pop(journal);                                      /* LCOV_EXCL_LINE */
     }
 
   /* Otherwise perform immediate write */
   } else {
-    error = pb_buffer_write(&(journal->buffer), start, end, data, size);
+    error = store_write(journal, start, end, data, size);
   }
   return error;
 }
@@ -258,26 +2071,100 @@ extern pb_error_t
 pb_journal_clear(
     pb_journal_t *journal, size_t origin, size_t start, size_t end) {
   assert(journal);
-  if (unlikely_(!pb_journal_valid(journal)))
+  if (unlikely_(!pb_journal_valid(journal) || journal->frozen))
     return PB_ERROR_INVALID;
-  pb_error_t error = PB_ERROR_NONE;
+  pb_error_t error = unshare(journal);
+  if (unlikely_(error))
+    return error;
 
   /* Perform journaled clear if size changed */
   ptrdiff_t delta = start - end;
+  pb_probe3(journal__clear, journal, start, delta);
   if (delta) {
     if (likely_(!(error = push(journal, origin, end, delta)))) {
-      error = pb_buffer_clear(&(journal->buffer), start, end);
+      error = store_clear(journal, start, end);
       if (unlikely_(error))
         pop(journal);                                      /* LCOV_EXCL_LINE */
     }
 
   /* Otherwise perform immediate clear */
   } else {
-    error = pb_buffer_clear(&(journal->buffer), start, end);
+    error = store_clear(journal, start, end);
   }
   return error;
 }
 
+/*!
+ * Replay a journal entry on an offset.
+ *
+ * See pb_journal_align() for the scenarios that must be handled.
+ *
+ * \param[in]     entry  Journal entry
+ * \param[in,out] offset Offset
+ * \return               Whether the offset must be invalidated
+ */
+PB_INLINE int
+replay(const pb_journal_entry_t *entry, pb_offset_t *offset) {
+  assert(entry && offset);
+  int invalid = 0;
+
+  /* Change happened before current part: move */
+  if (entry->origin < offset->start &&
+      entry->offset < offset->end) {
+    offset->start += entry->delta;
+    offset->end   += entry->delta;
+
+    /* Apply potential update on relative offsets */
+    pb_distance_t *diff[3] = {
+      &(offset->diff.origin),
+      &(offset->diff.tag),
+      &(offset->diff.length)
+    };
+    for (size_t d = 0; d < 3; ++d)
+      if (entry->offset > offset->start + *(diff[d]) - entry->delta)
+        *(diff[d]) -= entry->delta;
+
+  /* Change happened within current part: resize or clear */
+  } else if (entry->origin >= offset->start + offset->diff.origin &&
+             entry->offset <= offset->end) {
+
+    /* Change happened inside current part: resize */
+    if (entry->origin >= offset->start) {
+      offset->end += entry->delta;
+
+      /* Current part is a packed field: invalidate */
+      if (offset->diff.origin && !offset->diff.tag &&
+          offset->start == offset->end)
+        invalid = 1;
+
+    /* Current part was cleared: clear */
+    } else if (offset->start + offset->diff.tag >=
+               offset->end   + entry->delta) {
+      offset->start      += offset->diff.tag;
+      offset->end        += entry->delta;
+      offset->diff.origin = 0;
+      offset->diff.tag    = 0;
+      offset->diff.length = 0;
+
+      /* Invalidate after alignment */
+      invalid = 1;
+    }
+
+  /* Change happened outside current part: clear */
+  } else if (entry->origin <= offset->start + offset->diff.origin &&
+             entry->origin == entry->offset + entry->delta) {
+    offset->start       = entry->origin;
+    offset->end         = entry->origin;
+    offset->diff.origin = 0;
+    offset->diff.tag    = 0;
+    offset->diff.length = 0;
+
+    /* Invalidate after alignment */
+    invalid = 1;
+  }
+  return invalid;
+}
+
 /*!
  * Align an offset of a specific version according to a journal.
  *
@@ -342,72 +2229,78 @@ pb_journal_align(
   if (unlikely_(!pb_journal_valid(journal)))
     return PB_ERROR_INVALID;
 
+  /* Entries of the given version were compacted: invalidate */
+  if (unlikely_(*version < journal->entry.base))
+    *version = PB_VERSION_MAX;
+
   /* Iterate journal entries until we're up-to-date */
   uint8_t invalid = 0;
-  while (*version < journal->entry.size) {
-    const pb_journal_entry_t *entry = &journal->entry.data[*version];
-
-    /* Change happened before current part: move */
-    if (entry->origin < offset->start &&
-        entry->offset < offset->end) {
-      offset->start += entry->delta;
-      offset->end   += entry->delta;
-
-      /* Apply potential update on relative offsets */
-      ptrdiff_t *diff[3] = {
-        &(offset->diff.origin),
-        &(offset->diff.tag),
-        &(offset->diff.length)
-      };
-      for (size_t d = 0; d < 3; ++d)
-        if (entry->offset > offset->start + *(diff[d]) - entry->delta)
-          *(diff[d]) -= entry->delta;
-
-    /* Change happened within current part: resize or clear */
-    } else if (entry->origin >= offset->start + offset->diff.origin &&
-               entry->offset <= offset->end) {
-
-      /* Change happened inside current part: resize */
-      if (entry->origin >= offset->start) {
-        offset->end += entry->delta;
-
-        /* Current part is a packed field: invalidate */
-        if (offset->diff.origin && !offset->diff.tag &&
-            offset->start == offset->end)
-          invalid = 1;
-
-      /* Current part was cleared: clear */
-      } else if (offset->start + offset->diff.tag >=
-                 offset->end   + entry->delta) {
-        offset->start      += offset->diff.tag;
-        offset->end        += entry->delta;
-        offset->diff.origin = 0;
-        offset->diff.tag    = 0;
-        offset->diff.length = 0;
-
-        /* Invalidate after alignment */
-        invalid = 1;
-      }
-
-    /* Change happened outside current part: clear */
-    } else if (entry->origin <= offset->start + offset->diff.origin &&
-               entry->origin == entry->offset + entry->delta) {
-      offset->start       = entry->origin;
-      offset->end         = entry->origin;
-      offset->diff.origin = 0;
-      offset->diff.tag    = 0;
-      offset->diff.length = 0;
+  size_t replayed = 0;
+  while (*version < pb_journal_version(journal)) {
+    const pb_journal_entry_t *entry =
+      &journal->entry.data[*version - journal->entry.base];
 
-      /* Invalidate after alignment */
-      invalid = 1;
+    /* Skip changes that happened behind the current part using the index */
+    size_t limit = offset->start + offset->diff.origin > offset->end
+      ? offset->start + offset->diff.origin
+      : offset->end;
+    if (entry->origin > limit && journal->index.data) {
+      *version = journal->entry.base + index_next(journal,
+        *version - journal->entry.base, limit);
+      if (*version == pb_journal_version(journal))
+        break;
+      entry = &journal->entry.data[*version - journal->entry.base];
     }
+    replayed++;
+    invalid |= replay(entry, offset);
     (*version)++;
   }
+  pb_stats_add(replayed, replayed);
+  pb_probe2(journal__align, journal, replayed);
 
   /* Invalidate part */
   if (invalid)
-    *version = SIZE_MAX;
-  return *version == SIZE_MAX
+    *version = PB_VERSION_MAX;
+  return *version == PB_VERSION_MAX
     ? PB_ERROR_INVALID
     : PB_ERROR_NONE;
 }
+
+/*!
+ * Align many offsets of the same version according to a journal at once.
+ *
+ * Instead of replaying all journal entries for each offset, every entry is
+ * replayed on all offsets before moving on to the next one, so each entry is
+ * loaded only once and the offsets are traversed sequentially. Offsets that
+ * are invalidated are flagged, but are otherwise aligned like all others.
+ *
+ * \param[in]     journal   Journal
+ * \param[in]     version   Version
+ * \param[in,out] offset[]  Offsets
+ * \param[in,out] invalid[] Invalidation flags
+ * \param[in]     size      Offset count
+ * \return                  Error code
+ */
+extern pb_error_t
+pb_journal_align_many(
+    const pb_journal_t *journal, pb_version_t version,
+    pb_offset_t offset[], uint8_t invalid[], size_t size) {
+  assert(journal && offset && invalid);
+  if (unlikely_(!pb_journal_valid(journal)))
+    return PB_ERROR_INVALID;
+
+  /* Entries of the given version were compacted: invalidate all */
+  if (unlikely_(version < journal->entry.base)) {
+    memset(invalid, 1, size);
+    return PB_ERROR_NONE;
+  }
+
+  /* Replay each entry on all offsets until we're up-to-date */
+  for (; version < pb_journal_version(journal); version++) {
+    const pb_journal_entry_t *entry =
+      &journal->entry.data[version - journal->entry.base];
+    for (size_t o = 0; o < size; o++)
+      invalid[o] |= replay(entry, &(offset[o]));
+  }
+  return PB_ERROR_NONE;
+}
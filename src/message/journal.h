@@ -29,6 +29,7 @@
 
 #include <protobluff/message/journal.h>
 
+#include "core/varint.h"
 #include "message/buffer.h"
 #include "message/common.h"
 
@@ -37,11 +38,32 @@
  * ------------------------------------------------------------------------- */
 
 typedef struct pb_journal_entry_t {
-  size_t origin;                       /*!< Origin */
-  size_t offset;                       /*!< Offset */
-  ptrdiff_t delta;                     /*!< Delta */
+  pb_position_t origin;                /*!< Origin */
+  pb_position_t offset;                /*!< Offset */
+  pb_distance_t delta;                 /*!< Delta */
 } pb_journal_entry_t;
 
+typedef struct pb_journal_edit_t {
+  size_t start;                        /*!< Start offset */
+  size_t end;                          /*!< End offset */
+  size_t size;                         /*!< Size of replacement */
+} pb_journal_edit_t;
+
+typedef struct pb_journal_snapshot_t {
+  pb_buffer_t buffer;                  /*!< Shared buffer */
+  size_t references;                   /*!< Reference count */
+} pb_journal_snapshot_t;
+
+typedef struct pb_journal_external_t {
+  pb_string_t value;                   /*!< Caller-owned value */
+  pb_journal_release_f release;        /*!< Release callback */
+  void *data;                          /*!< Release callback data */
+  pb_allocator_t *allocator;           /*!< Allocator */
+  size_t references;                   /*!< Reference count */
+  size_t size;                         /*!< Size of key and length prefix */
+  uint8_t prefix[15];                  /*!< Key and length prefix */
+} pb_journal_external_t;
+
 /* ----------------------------------------------------------------------------
  * Interface
  * ------------------------------------------------------------------------- */
@@ -71,6 +93,15 @@ pb_journal_align(
   pb_version_t *version,               /* Version */
   pb_offset_t *offset);                /* Offset */
 
+PB_WARN_UNUSED_RESULT
+extern pb_error_t
+pb_journal_align_many(
+  const pb_journal_t *journal,         /* Journal */
+  pb_version_t version,                /* Version */
+  pb_offset_t offset[],                /* Offsets */
+  uint8_t invalid[],                   /* Invalidation flags */
+  size_t size);                        /* Offset count */
+
 /* ----------------------------------------------------------------------------
  * Inline functions
  * ------------------------------------------------------------------------- */
@@ -96,7 +127,63 @@ pb_journal_create_invalid(void) {
 PB_INLINE pb_version_t
 pb_journal_version(const pb_journal_t *journal) {
   assert(journal);
-  return journal->entry.size;
+  return journal->entry.base + journal->entry.size;
+}
+
+/*!
+ * Retrieve the allocator of a journal.
+ *
+ * A copy-on-write journal refers to shared data until the first write, so the
+ * allocator that will own the copy is returned, which stays the same.
+ *
+ * \param[in] journal Journal
+ * \return            Allocator
+ */
+PB_INLINE pb_allocator_t *
+pb_journal_allocator(const pb_journal_t *journal) {
+  assert(journal);
+  return journal->shared
+    ? journal->shared
+    : pb_buffer_allocator(&(journal->buffer));
+}
+
+/*!
+ * Write a length prefix, padded to 5 bytes if the journal demands it.
+ *
+ * \param[in]  journal Journal
+ * \param[out] data[]  Raw data
+ * \param[in]  length  Length
+ * \return             Bytes written
+ */
+PB_INLINE size_t
+pb_journal_pack_length(
+    const pb_journal_t *journal, uint8_t data[], uint32_t length) {
+  assert(journal && data);
+  if (likely_(!journal->padded))
+    return pb_varint_pack_uint32(data, &length);
+
+  /* Write non-minimal varint with continuation bits */
+  for (size_t b = 0; b < 4; b++, length >>= 7)
+    data[b] = (length & 0x7F) | 0x80;
+  data[4] = length;
+  return 5;
+}
+
+/*!
+ * Retrieve the index of field offsets of a journal, if it is still valid.
+ *
+ * The index refers to the raw data the journal was created with, so it is
+ * only valid as long as the journal was not written to.
+ *
+ * \param[in] journal Journal
+ * \return            Index
+ */
+PB_INLINE const pb_decoder_index_t *
+pb_journal_index(const pb_journal_t *journal) {
+  assert(journal);
+  return pb_decoder_index_complete(&(journal->fields)) && !journal->revision
+    ? &(journal->fields)
+    : NULL;
 }
 
 /*!
@@ -108,7 +195,8 @@ pb_journal_version(const pb_journal_t *journal) {
  */
 PB_INLINE uint8_t *
 pb_journal_data_from(const pb_journal_t *journal, size_t offset) {
-  return pb_buffer_data_from(&(journal->buffer), offset);
+  return pb_buffer_data_from(
+    pb_journal_buffer((pb_journal_t *)journal), offset);
 }
 
 /*!
@@ -120,7 +208,8 @@ pb_journal_data_from(const pb_journal_t *journal, size_t offset) {
  */
 PB_INLINE uint8_t
 pb_journal_data_at(const pb_journal_t *journal, size_t offset) {
-  return pb_buffer_data_at(&(journal->buffer), offset);
+  return pb_buffer_data_at(
+    pb_journal_buffer((pb_journal_t *)journal), offset);
 }
 
 #endif /* PB_MESSAGE_JOURNAL_H */
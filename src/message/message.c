@@ -20,12 +20,20 @@
  * IN THE SOFTWARE.
  */
 
+#include <alloca.h>
 #include <assert.h>
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 
+#include "core/allocator.h"
+#include "core/buffer.h"
 #include "core/descriptor.h"
+#include "core/endian.h"
+#include "core/layout.h"
+#include "core/stats.h"
+#include "core/stream.h"
+#include "core/varint.h"
 #include "message/common.h"
 #include "message/cursor.h"
 #include "message/field.h"
@@ -33,6 +41,1226 @@
 #include "message/message.h"
 #include "message/oneof.h"
 #include "message/part.h"
+#include "message/trace.h"
+
+/* ----------------------------------------------------------------------------
+ * Internal functions
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Retrieve the position of a non-repeated field within the field offset index
+ * of a message, or SIZE_MAX if the field cannot be looked up via the index.
+ *
+ * Repeated fields and extensions are not indexed, as looking them up involves
+ * more than their last occurrence. Oneof members are indexed, and the active
+ * member is determined from the offsets of their last occurrences.
+ *
+ * \param[in] message    Message
+ * \param[in] descriptor Field descriptor
+ * \return               Position
+ */
+static size_t
+index_position(
+    const pb_message_t *message, const pb_field_descriptor_t *descriptor) {
+  assert(message && descriptor);
+  const pb_descriptor_t *parent = pb_message_descriptor(message);
+  if (descriptor <  parent->field.data ||
+      descriptor >= parent->field.data + parent->field.size ||
+      pb_field_descriptor_label(descriptor) == PB_LABEL_REPEATED)
+    return SIZE_MAX;
+  return descriptor - parent->field.data;
+}
+
+/*!
+ * Rebuild the field offset index of a message, if the message was altered.
+ *
+ * The index is rebuilt with a single pass over the message, recording the
+ * last occurrence of every indexed field. An absent field is denoted by a tag
+ * offset of zero, as every field that is not part of a packed field is
+ * preceded by its tag.
+ *
+ * \param[in,out] message Message
+ * \return                Error code
+ */
+static pb_error_t
+index_build(pb_message_t *message) {
+  assert(message && message->index);
+  pb_message_index_t *index = message->index;
+  if (unlikely_(pb_message_align(message)))
+    return PB_ERROR_INVALID;
+  if (index->version == pb_message_version(message))
+    return PB_ERROR_NONE;
+
+  /* Reset offsets of all fields */
+  const pb_descriptor_t *parent = pb_message_descriptor(message);
+  for (size_t f = 0; f < parent->field.size; f++)
+    index->offset[f].diff.tag = 0;
+
+  /* Record offsets of last occurrences */
+  pb_cursor_t cursor = pb_cursor_create_without_tag(message);
+  if (pb_cursor_valid(&cursor)) {
+    do {
+      size_t f = index_position(message, pb_cursor_descriptor(&cursor));
+      if (f != SIZE_MAX && pb_cursor_offset(&cursor)->diff.tag)
+        index->offset[f] = *pb_cursor_offset(&cursor);
+    } while (pb_cursor_next(&cursor));
+  }
+  pb_error_t error = pb_cursor_error(&cursor);
+  index->version = pb_cursor_version(&cursor);
+  pb_cursor_destroy(&cursor);
+  if (unlikely_(error != PB_ERROR_EOM)) {
+    index->version = PB_VERSION_MAX;
+    return error;
+  }
+  return PB_ERROR_NONE;
+}
+
+/*!
+ * Retrieve the position of the active member of a oneof within the field
+ * offset index of a message, or SIZE_MAX if no member is present.
+ *
+ * The active member is the one that occurred last, so only the offsets of
+ * the members need to be compared, regardless of the size of the message.
+ *
+ * \param[in] message    Message
+ * \param[in] descriptor Oneof descriptor
+ * \return               Position
+ */
+static size_t
+index_case(
+    const pb_message_t *message, const pb_oneof_descriptor_t *descriptor) {
+  assert(message && message->index && descriptor);
+  assert(descriptor->descriptor == pb_message_descriptor(message));
+  const pb_message_index_t *index = message->index;
+  size_t active = SIZE_MAX;
+  for (size_t i = 0; i < descriptor->index.size; i++) {
+    size_t f = descriptor->index.data[i];
+    if (index->offset[f].diff.tag && (active == SIZE_MAX ||
+        index->offset[f].start > index->offset[active].start))
+      active = f;
+  }
+  return active;
+}
+
+/*!
+ * Look up the offsets of a field using the field offset index of a message.
+ *
+ * The index is lazily (re-)built if it is out of date. Members of a oneof are
+ * only returned if they are active.
+ *
+ * \param[in,out] message    Message
+ * \param[in]     descriptor Field descriptor
+ * \param[out]    part       Part
+ * \return                   Error code
+ */
+static pb_error_t
+index_lookup(
+    pb_message_t *message, const pb_field_descriptor_t *descriptor,
+    pb_part_t *part) {
+  assert(message && message->index && descriptor && part);
+  pb_error_t error = index_build(message);
+  if (unlikely_(error))
+    return error;
+
+  /* Return part for field, unless it is absent or an inactive member */
+  const pb_message_index_t *index = message->index;
+  size_t f = index_position(message, descriptor);
+  if (!index->offset[f].diff.tag)
+    return PB_ERROR_EOM;
+  if (pb_field_descriptor_label(descriptor) == PB_LABEL_ONEOF &&
+      index_case(message, pb_field_descriptor_oneof(descriptor)) != f)
+    return PB_ERROR_EOM;
+  *part = (pb_part_t){
+    .journal = pb_message_journal(message),
+    .version = index->version,
+    .offset  = index->offset[f]
+  };
+  return PB_ERROR_NONE;
+}
+
+/*!
+ * Compute the hash of a key value.
+ *
+ * Length-prefixed values are hashed by their contents using FNV-1a, all other
+ * values by their native representation, so that equal values yield equal
+ * hashes regardless of their encoding.
+ *
+ * \param[in] descriptor Field descriptor of key
+ * \param[in] value      Pointer holding key value
+ * \return               Hash
+ */
+static size_t
+map_hash(const pb_field_descriptor_t *descriptor, const void *value) {
+  assert(descriptor && value);
+  const uint8_t *data = value;
+  size_t size = pb_field_descriptor_type_size(descriptor);
+  if (pb_field_descriptor_wiretype(descriptor) == PB_WIRETYPE_LENGTH) {
+    data = pb_string_data(value);
+    size = pb_string_size(value);
+  }
+  size_t hash = 2166136261U;
+  for (size_t b = 0; b < size; b++)
+    hash = (hash ^ data[b]) * 16777619U;
+  return hash;
+}
+
+/*!
+ * Find the slot of the element with the given key value in a key index.
+ *
+ * Elements with an equal hash are compared against the key value in order to
+ * resolve collisions. If no element matches, the free slot at which the key
+ * value would be inserted is returned.
+ *
+ * \param[in,out] message Message
+ * \param[in]     map     Key index
+ * \param[in]     hash    Hash of key value
+ * \param[in]     value   Pointer holding key value
+ * \return                Slot
+ */
+static pb_message_map_slot_t *
+map_find(
+    pb_message_t *message, const pb_message_map_t *map, size_t hash,
+    const void *value) {
+  assert(message && map && map->size && value);
+  const pb_field_descriptor_t *descriptor =
+    pb_descriptor_field_by_tag(message->descriptor, map->tag);
+  for (size_t s = hash & (map->size - 1);; s = (s + 1) & (map->size - 1)) {
+    pb_message_map_slot_t *slot = &(map->slot[s]);
+    if (!slot->offset.diff.tag)
+      return slot;
+
+    /* Compare key value of element with equal hash */
+    if (slot->hash == hash) {
+      pb_message_t element = {
+        .descriptor = pb_field_descriptor_nested(descriptor),
+        .part       = {
+          .journal = pb_message_journal(message),
+          .version = map->version,
+          .offset  = slot->offset
+        }
+      };
+      int result = pb_message_match(&element, map->key, value);
+      pb_message_destroy(&element);
+      if (result)
+        return slot;
+    }
+  }
+}
+
+/*!
+ * Insert an element into a key index, replacing an element with an equal key.
+ *
+ * The number of slots is doubled whenever more than half of them are used,
+ * which keeps probe sequences short.
+ *
+ * \param[in,out] message Message
+ * \param[in,out] map     Key index
+ * \param[in]     offset  Offsets of element
+ * \param[in]     value   Pointer holding key value
+ * \return                Error code
+ */
+static pb_error_t
+map_insert(
+    pb_message_t *message, pb_message_map_t *map, const pb_offset_t *offset,
+    const void *value) {
+  assert(message && map && offset && value);
+  const pb_field_descriptor_t *descriptor = pb_descriptor_field_by_tag(
+    pb_field_descriptor_nested(pb_descriptor_field_by_tag(
+      message->descriptor, map->tag)), map->key);
+
+  /* Grow slots and re-insert elements, if necessary */
+  if ((map->used + 1) * 2 > map->size) {
+    pb_allocator_t *allocator =
+      pb_journal_allocator(pb_message_journal(message));
+    size_t size = map->size ? map->size * 2 : 16;
+    pb_message_map_slot_t *slot = pb_allocator_allocate(allocator,
+      sizeof(pb_message_map_slot_t) * size);
+    if (unlikely_(!slot))
+      return PB_ERROR_ALLOC;
+    for (size_t s = 0; s < size; s++)
+      slot[s].offset.diff.tag = 0;
+
+    /* Elements are unique, so hashes suffice to re-insert them */
+    for (size_t s = 0; s < map->size; s++) {
+      if (map->slot[s].offset.diff.tag) {
+        size_t t = map->slot[s].hash & (size - 1);
+        while (slot[t].offset.diff.tag)
+          t = (t + 1) & (size - 1);
+        slot[t] = map->slot[s];
+      }
+    }
+    if (map->slot)
+      pb_allocator_free(allocator, map->slot);
+    map->slot = slot;
+    map->size = size;
+  }
+
+  /* Insert element or replace element with equal key value */
+  size_t hash = map_hash(descriptor, value);
+  pb_message_map_slot_t *slot = map_find(message, map, hash, value);
+  if (!slot->offset.diff.tag)
+    map->used++;
+  *slot = (pb_message_map_slot_t){
+    .hash   = hash,
+    .offset = *offset
+  };
+  return PB_ERROR_NONE;
+}
+
+/*!
+ * Rebuild a key index with a single pass over the elements of a message.
+ *
+ * Elements without a key are not indexed. If an element with an equal key
+ * occurs more than once, the last occurrence takes precedence, as specified
+ * for map fields.
+ *
+ * \param[in,out] message Message
+ * \param[in,out] map     Key index
+ * \return                Error code
+ */
+static pb_error_t
+map_build(pb_message_t *message, pb_message_map_t *map) {
+  assert(message && map);
+  const pb_field_descriptor_t *descriptor = pb_descriptor_field_by_tag(
+    pb_field_descriptor_nested(pb_descriptor_field_by_tag(
+      message->descriptor, map->tag)), map->key);
+  for (size_t s = 0; s < map->size; s++)
+    map->slot[s].offset.diff.tag = 0;
+  map->used     = 0;
+  map->version  = pb_message_version(message);
+  map->revision = pb_journal_revision(pb_message_journal(message));
+
+  /* Allocate temporary space for type-agnostic key values */
+  void *value = alloca(pb_field_descriptor_type_size(descriptor));
+  pb_error_t error = PB_ERROR_NONE;
+
+  /* Record offsets of all elements with key values */
+  pb_cursor_t cursor = pb_cursor_create(message, map->tag);
+  if (pb_cursor_valid(&cursor)) {
+    do {
+      pb_message_t element = pb_message_create_from_cursor(&cursor);
+      pb_error_t result = pb_message_get(&element, map->key, value);
+      if (!result) {
+        error = map_insert(message, map, pb_cursor_offset(&cursor), value);
+      } else if (result != PB_ERROR_ABSENT) {
+        error = result;
+      }
+      pb_message_destroy(&element);
+    } while (!error && pb_cursor_next(&cursor));
+  }
+  if (!error && pb_cursor_error(&cursor) != PB_ERROR_EOM)
+    error = pb_cursor_error(&cursor);
+  pb_cursor_destroy(&cursor);
+
+  /* Mark index as out of date on errors */
+  if (unlikely_(error))
+    map->version = PB_VERSION_MAX;
+  return error;
+}
+
+/*!
+ * Pack a value of a field without its tag, or determine its packed size.
+ *
+ * \param[in]  journal    Journal
+ * \param[in]  descriptor Field descriptor
+ * \param[out] data[]     Raw data
+ * \param[in]  value      Pointer holding value
+ * \return                Bytes written
+ */
+static size_t
+run_pack(
+    const pb_journal_t *journal, const pb_field_descriptor_t *descriptor,
+    uint8_t data[], const void *value) {
+  assert(journal && descriptor && value);
+  pb_type_t type = pb_field_descriptor_type(descriptor);
+  switch (pb_field_descriptor_wiretype(descriptor)) {
+
+    /* Pack a variable-sized integer, padded if demanded */
+    case PB_WIRETYPE_VARINT:
+      if (pb_field_descriptor_padded(descriptor))
+        return data
+          ? pb_varint_pack_padded(type, data, value)
+          : pb_varint_size_padded(type, value);
+      return data
+        ? pb_varint_pack(type, data, value)
+        : pb_varint_size(type, value);
+
+    /* Pack a fixed-sized 64-bit value */
+    case PB_WIRETYPE_64BIT:
+      if (data)
+        pb_endian_copy(data, value, 1, 8);
+      return 8;
+
+    /* Pack a length-prefixed value */
+    case PB_WIRETYPE_LENGTH: {
+      uint8_t prefix[5];
+      size_t size = pb_journal_pack_length(journal,
+        data ? data : prefix, pb_string_size(value));
+      if (data)
+        memcpy(&(data[size]), pb_string_data(value), pb_string_size(value));
+      return size + pb_string_size(value);
+    }
+
+    /* Pack a fixed-sized 32-bit value */
+    case PB_WIRETYPE_32BIT:
+      if (data)
+        pb_endian_copy(data, value, 1, 4);
+      return 4;
+  }
+  return 0;                                                /* LCOV_EXCL_LINE */
+}
+
+/*!
+ * Write a run of values for a repeated field to a message at once.
+ *
+ * The run is packed into temporary memory and written with a single journal
+ * write, so the length prefixes of the packed field and all parent messages
+ * are only updated once. The first element is created as usual, so the tag
+ * of a non-packed field is already written and omitted from the run, and its
+ * part is widened to include the length prefix, if any.
+ *
+ * \param[in,out] message    Message
+ * \param[in]     descriptor Field descriptor
+ * \param[in]     values     Pointer holding values
+ * \param[in]     size       Value count
+ * \return                   Error code
+ */
+static pb_error_t
+run_write(
+    pb_message_t *message, const pb_field_descriptor_t *descriptor,
+    const void *values, size_t size) {
+  assert(message && descriptor && values && size);
+  pb_journal_t *journal = pb_message_journal(message);
+  size_t item = pb_field_descriptor_type_size(descriptor);
+  int packed  = pb_field_descriptor_packed(descriptor);
+
+  /* Determine size of run */
+  size_t total = 0;
+  for (size_t v = 0; v < size; v++) {
+    if (v && !packed)
+      total += pb_field_descriptor_key_size(descriptor);
+    total += run_pack(journal, descriptor, NULL,
+      (const uint8_t *)values + v * item);
+  }
+
+  /* Allocate temporary memory and pack run */
+  pb_allocator_t *allocator = pb_journal_allocator(journal);
+  uint8_t *data = pb_allocator_allocate(allocator, total);
+  if (unlikely_(!data))
+    return PB_ERROR_ALLOC;
+  for (size_t v = 0, offset = 0; v < size; v++) {
+    if (v && !packed)
+      offset += pb_field_descriptor_key_pack(&(data[offset]), descriptor,
+        pb_field_descriptor_wiretype(descriptor));
+    offset += run_pack(journal, descriptor, &(data[offset]),
+      (const uint8_t *)values + v * item);
+  }
+
+  /* Create part for first element and widen it to its length prefix */
+  pb_error_t error = PB_ERROR_INVALID;
+  pb_part_t part = pb_part_create(message, pb_field_descriptor_tag(descriptor));
+  if (pb_part_valid(&part)) {
+    ptrdiff_t length = part.offset.diff.length;
+    part.offset.start       += length;
+    part.offset.diff.origin -= length;
+    part.offset.diff.tag    -= length;
+    part.offset.diff.length  = 0;
+
+    /* Write run to part */
+    error = pb_part_write(&part, data, total);
+  }
+  pb_part_destroy(&part);
+  pb_allocator_free(allocator, data);
+  return error;
+}
+
+/* ------------------------------------------------------------------------- */
+
+/*!
+ * Test whether an existing field is superseded by a set of writes.
+ *
+ * A non-repeated field is superseded by a write for the same tag, a member
+ * of a oneof by a write for any member of the same oneof. Unknown fields and
+ * repeated fields are never superseded, as writes are appended to the latter.
+ *
+ * \param[in] descriptor  Field descriptor, may be NULL
+ * \param[in] descriptors Field descriptors of writes
+ * \param[in] size        Write count
+ * \return                Test result
+ */
+static int
+put_superseded(
+    const pb_field_descriptor_t *descriptor,
+    const pb_field_descriptor_t *const descriptors[], size_t size) {
+  assert(descriptors);
+  if (!descriptor ||
+      pb_field_descriptor_label(descriptor) == PB_LABEL_REPEATED)
+    return 0;
+  const pb_oneof_descriptor_t *oneof = pb_field_descriptor_oneof(descriptor);
+  for (size_t w = 0; w < size; w++)
+    if (descriptors[w] == descriptor ||
+        (oneof && oneof == pb_field_descriptor_oneof(descriptors[w])))
+      return 1;
+  return 0;
+}
+
+/*!
+ * Pack the sorted writes up to a given tag, or determine their packed size.
+ *
+ * Consecutive writes for a packed field are packed into a single run, and of
+ * consecutive writes for a non-repeated field, only the last one is packed.
+ *
+ * \param[in]     journal     Journal
+ * \param[in]     descriptors Field descriptors of writes
+ * \param[in]     values      Pointers holding values of writes
+ * \param[in]     order       Positions of writes sorted by tag
+ * \param[in]     size        Write count
+ * \param[in,out] w           Position of next write in order
+ * \param[in]     limit       Tag limit (exclusive) or zero for none
+ * \param[out]    data[]      Raw data, may be NULL
+ * \return                    Bytes written
+ */
+static size_t
+put_pack(
+    const pb_journal_t *journal,
+    const pb_field_descriptor_t *const descriptors[],
+    const void *const values[], const size_t order[], size_t size,
+    size_t *w, pb_tag_t limit, uint8_t data[]) {
+  assert(journal && descriptors && values && order && w);
+  size_t total = 0;
+  while (*w < size) {
+    const pb_field_descriptor_t *descriptor = descriptors[order[*w]];
+    if (limit && pb_field_descriptor_tag(descriptor) >= limit)
+      break;
+
+    /* Determine run of consecutive writes for the same field */
+    size_t end = *w + 1;
+    while (end < size && descriptors[order[end]] == descriptor)
+      end++;
+
+    /* Pack values of packed field with a single tag and length prefix */
+    if (pb_field_descriptor_packed(descriptor)) {
+      uint32_t length = 0;
+      for (size_t v = *w; v < end; v++)
+        length += run_pack(journal, descriptor, NULL, values[order[v]]);
+      uint8_t prefix[5];
+      total += data
+        ? pb_field_descriptor_key_pack(&(data[total]), descriptor,
+            PB_WIRETYPE_LENGTH)
+        : pb_field_descriptor_key_size(descriptor);
+      total += pb_journal_pack_length(journal,
+        data ? &(data[total]) : prefix, length);
+      for (size_t v = *w; v < end; v++)
+        total += run_pack(journal, descriptor,
+          data ? &(data[total]) : NULL, values[order[v]]);
+
+    /* Pack each value of repeated field, or only the last of other fields */
+    } else {
+      size_t v = pb_field_descriptor_label(descriptor) == PB_LABEL_REPEATED
+        ? *w
+        : end - 1;
+      for (; v < end; v++) {
+        total += data
+          ? pb_field_descriptor_key_pack(&(data[total]), descriptor,
+              pb_field_descriptor_wiretype(descriptor))
+          : pb_field_descriptor_key_size(descriptor);
+        total += run_pack(journal, descriptor,
+          data ? &(data[total]) : NULL, values[order[v]]);
+      }
+    }
+    *w = end;
+  }
+  return total;
+}
+
+/*!
+ * Merge sorted writes with the fields of a message, or determine the size.
+ *
+ * The fields of the message are walked once. Before every field, all pending
+ * writes for smaller tags are packed, so writes end up where pb_part_create()
+ * would insert them, i.e. after all fields with the same or smaller tags. A
+ * field is only copied, if it is not superseded by any of the writes.
+ *
+ * \param[in]     message     Message
+ * \param[in]     descriptors Field descriptors of writes
+ * \param[in]     values      Pointers holding values of writes
+ * \param[in]     order       Positions of writes sorted by tag
+ * \param[in]     size        Write count
+ * \param[out]    data[]      Raw data, may be NULL
+ * \param[out]    total       Bytes written
+ * \return                    Error code
+ */
+static pb_error_t
+put_merge(
+    const pb_message_t *message,
+    const pb_field_descriptor_t *const descriptors[],
+    const void *const values[], const size_t order[], size_t size,
+    uint8_t data[], size_t *total) {
+  assert(message && descriptors && values && order && total);
+  const pb_journal_t *journal = message->part.journal;
+  pb_buffer_t buffer = pb_buffer_create_zero_copy_internal(
+    (uint8_t *)pb_journal_data_from(journal, pb_message_start(message)),
+      pb_message_size(message));
+
+  /* Walk fields, packing pending writes before each of them */
+  pb_error_t error = PB_ERROR_NONE;
+  pb_stream_t stream = pb_stream_create(&buffer);
+  size_t w = 0;
+  *total = 0;
+  while (!error && pb_stream_left(&stream)) {
+    size_t start = pb_stream_offset(&stream);
+    uint32_t key;
+    if (unlikely_(error = pb_stream_read_uint32(&stream, &key)) ||
+        unlikely_(error = pb_stream_skip(&stream, key & 7)))
+      break;                                               /* LCOV_EXCL_LINE */
+
+    /* Pack pending writes, then copy field, unless superseded */
+    pb_tag_t tag = key >> 3;
+    *total += put_pack(journal, descriptors, values, order, size, &w, tag,
+      data ? &(data[*total]) : NULL);
+    if (!put_superseded(pb_descriptor_field_by_tag(message->descriptor, tag),
+        descriptors, size)) {
+      size_t length = pb_stream_offset(&stream) - start;
+      if (data)
+        memcpy(&(data[*total]), pb_buffer_data_from(&buffer, start), length);
+      *total += length;
+    }
+  }
+  pb_stream_destroy(&stream);
+  pb_buffer_destroy(&buffer);
+
+  /* Pack remaining writes */
+  *total += put_pack(journal, descriptors, values, order, size, &w, 0,
+    data ? &(data[*total]) : NULL);
+  return error;
+}
+
+/*!
+ * Test whether an existing field is dropped by a set of erased fields.
+ *
+ * All occurrences of an erased field are dropped, including the values of
+ * repeated fields, as well as all members of a oneof if any of its members is
+ * erased. Unknown fields are never dropped.
+ *
+ * \param[in] descriptor  Field descriptor, may be NULL
+ * \param[in] descriptors Field descriptors of erased fields
+ * \param[in] size        Erased field count
+ * \return                Test result
+ */
+static int
+erase_dropped(
+    const pb_field_descriptor_t *descriptor,
+    const pb_field_descriptor_t *const descriptors[], size_t size) {
+  assert(descriptors);
+  if (!descriptor)
+    return 0;
+  const pb_oneof_descriptor_t *oneof = pb_field_descriptor_oneof(descriptor);
+  for (size_t e = 0; e < size; e++)
+    if (descriptors[e] == descriptor ||
+        (oneof && oneof == pb_field_descriptor_oneof(descriptors[e])))
+      return 1;
+  return 0;
+}
+
+/*!
+ * Erase a set of fields from a message in a single pass.
+ *
+ * The fields of the message are walked once, and all fields which are not
+ * dropped are copied into temporary memory, which then replaces the contents
+ * of the message with a single journal write. If no field is dropped, the
+ * message is left untouched.
+ *
+ * \param[in,out] message     Message
+ * \param[in]     descriptors Field descriptors of erased fields
+ * \param[in]     size        Erased field count
+ * \return                    Error code
+ */
+static pb_error_t
+erase_compact(
+    pb_message_t *message,
+    const pb_field_descriptor_t *const descriptors[], size_t size) {
+  assert(message && descriptors && size);
+  assert(pb_message_valid(message) && pb_message_aligned(message));
+  if (pb_message_empty(message))
+    return PB_ERROR_NONE;
+
+  /* Allocate temporary memory for compacted message */
+  pb_journal_t   *journal   = pb_message_journal(message);
+  pb_allocator_t *allocator = pb_journal_allocator(journal);
+  uint8_t *data = pb_allocator_allocate(allocator, pb_message_size(message));
+  if (unlikely_(!data))
+    return PB_ERROR_ALLOC;
+  pb_buffer_t buffer = pb_buffer_create_zero_copy_internal(
+    (uint8_t *)pb_journal_data_from(journal, pb_message_start(message)),
+      pb_message_size(message));
+
+  /* Walk fields, copying all fields that are not dropped */
+  pb_error_t error = PB_ERROR_NONE;
+  pb_stream_t stream = pb_stream_create(&buffer);
+  size_t total = 0;
+  while (!error && pb_stream_left(&stream)) {
+    size_t start = pb_stream_offset(&stream);
+    uint32_t key;
+    if (unlikely_(error = pb_stream_read_uint32(&stream, &key)) ||
+        unlikely_(error = pb_stream_skip(&stream, key & 7)))
+      break;                                               /* LCOV_EXCL_LINE */
+    if (!erase_dropped(pb_descriptor_field_by_tag(message->descriptor,
+        key >> 3), descriptors, size)) {
+      size_t length = pb_stream_offset(&stream) - start;
+      memcpy(&(data[total]), pb_buffer_data_from(&buffer, start), length);
+      total += length;
+    }
+  }
+  pb_stream_destroy(&stream);
+  pb_buffer_destroy(&buffer);
+
+  /* Write compacted message at once, if any field was dropped */
+  if (!error && total != pb_message_size(message))
+    error = pb_part_write(&(message->part), data, total);
+  pb_allocator_free(allocator, data);
+  return error;
+}
+
+/* ------------------------------------------------------------------------- */
+
+/*!
+ * Compare two spans by tag, keeping the order of spans with the same tag.
+ *
+ * \param[in] x Pointer to span
+ * \param[in] y Pointer to span
+ * \return      Comparison result
+ */
+static int
+sort_compare(const void *x, const void *y) {
+  assert(x && y);
+  const pb_message_span_t *a = x, *b = y;
+  if (a->tag != b->tag)
+    return (a->tag > b->tag) - (a->tag < b->tag);
+  return (a->start > b->start) - (a->start < b->start);
+}
+
+/*!
+ * Record the spans of all fields within raw data, or count them.
+ *
+ * \param[in]  source[] Raw data
+ * \param[in]  size     Raw data size
+ * \param[out] spans[]  Spans, may be NULL
+ * \param[out] count    Span count
+ * \return              Error code
+ */
+static pb_error_t
+sort_spans(
+    const uint8_t source[], size_t size, pb_message_span_t spans[],
+    size_t *count) {
+  assert((source || !size) && count);
+  pb_buffer_t buffer =
+    pb_buffer_create_zero_copy_internal((uint8_t *)source, size);
+
+  /* Walk fields, recording tags and offsets of keys and contents */
+  pb_error_t error = PB_ERROR_NONE;
+  pb_stream_t stream = pb_stream_create(&buffer);
+  *count = 0;
+  while (!error && pb_stream_left(&stream)) {
+    pb_message_span_t span = { .start = pb_stream_offset(&stream) };
+    uint32_t key, length;
+    if (unlikely_(error = pb_stream_read_uint32(&stream, &key)))
+      break;
+    span.tag    = key >> 3;
+    span.length = pb_stream_offset(&stream);
+    if ((key & 7) == PB_WIRETYPE_LENGTH) {
+      if (!(error = pb_stream_read_uint32(&stream, &length))) {
+        span.header = pb_stream_offset(&stream);
+        error = pb_stream_advance(&stream, length);
+      }
+    } else {
+      span.header = span.length;
+      error = pb_stream_skip(&stream, key & 7);
+    }
+    span.end = pb_stream_offset(&stream);
+    if (!error && spans)
+      spans[*count] = span;
+    (*count)++;
+  }
+  pb_stream_destroy(&stream);
+  pb_buffer_destroy(&buffer);
+  return error;
+}
+
+/*!
+ * Drop all occurrences of oneof members that are superseded by another one.
+ *
+ * A member of a oneof is superseded, if any other member of the same oneof
+ * occurs after it. Thus, only the occurrences of the active member after the
+ * last switch are kept. Dropped spans are marked by setting their end offset
+ * to their start offset.
+ *
+ * \param[in]     descriptor Descriptor
+ * \param[in,out] spans[]    Spans
+ * \param[in]     count      Span count
+ * \param[out]    active[]   Temporary memory for active members
+ * \param[out]    since[]    Temporary memory for positions of switches
+ * \return                   Test result
+ */
+static int
+sort_drop(
+    const pb_descriptor_t *descriptor, pb_message_span_t spans[],
+    size_t count, const pb_field_descriptor_t *active[], size_t since[]) {
+  assert(descriptor && spans && active && since);
+  size_t size = 0;
+  int dropped = 0;
+
+  /* Determine the active member of every oneof and when it was switched to */
+  for (size_t s = 0; s < count; s++) {
+    const pb_field_descriptor_t *field =
+      pb_descriptor_field_by_tag(descriptor, spans[s].tag);
+    if (!field || pb_field_descriptor_label(field) != PB_LABEL_ONEOF)
+      continue;
+    size_t o = 0;
+    while (o < size && pb_field_descriptor_oneof(active[o]) !=
+                       pb_field_descriptor_oneof(field))
+      o++;
+    if (o == size || active[o] != field) {
+      active[o] = field;
+      since[o]  = s;
+      size += o == size;
+    }
+  }
+
+  /* Drop all occurrences of members before the last switch */
+  for (size_t s = 0; s < count && size; s++) {
+    const pb_field_descriptor_t *field =
+      pb_descriptor_field_by_tag(descriptor, spans[s].tag);
+    if (!field || pb_field_descriptor_label(field) != PB_LABEL_ONEOF)
+      continue;
+    size_t o = 0;
+    while (pb_field_descriptor_oneof(active[o]) !=
+           pb_field_descriptor_oneof(field))
+      o++;
+    if (s < since[o]) {
+      spans[s].end = spans[s].start;
+      dropped = 1;
+    }
+  }
+  return dropped;
+}
+
+/*!
+ * Copy the fields of a message in tag order, recursing into submessages.
+ *
+ * Occurrences of fields with the same tag keep their relative order, so the
+ * last occurrence of a non-repeated field stays the last one, and values of
+ * repeated fields keep their order. As superseded members of oneofs are
+ * dropped, the size of a submessage may shrink, in which case its length
+ * prefix is rewritten.
+ *
+ * \param[in]  descriptor Descriptor
+ * \param[in]  source[]   Raw data
+ * \param[in]  size       Raw data size
+ * \param[out] data[]     Raw data in tag order
+ * \param[out] total      Bytes written
+ * \param[out] moved      Whether any field was moved or dropped
+ * \param[in]  allocator  Allocator
+ * \return                Error code
+ */
+static pb_error_t
+sort_fields(
+    const pb_descriptor_t *descriptor, const uint8_t source[], size_t size,
+    uint8_t data[], size_t *total, int *moved, pb_allocator_t *allocator) {
+  assert(descriptor && total && moved && allocator);
+  size_t count;
+  pb_error_t error = sort_spans(source, size, NULL, &count);
+  *total = 0;
+  if (error || !count)
+    return error;
+
+  /* Allocate temporary memory for spans and active members of oneofs */
+  pb_message_span_t *spans = pb_allocator_allocate(allocator, count *
+    (sizeof(*spans) + sizeof(pb_field_descriptor_t *) + sizeof(size_t)));
+  if (unlikely_(!spans))
+    return PB_ERROR_ALLOC;
+  const pb_field_descriptor_t **active =
+    (const pb_field_descriptor_t **)&(spans[count]);
+  size_t *since = (size_t *)&(active[count]);
+
+  /* Record spans, drop superseded members of oneofs and sort by tag */
+  if (!(error = sort_spans(source, size, spans, &count))) {
+    if (sort_drop(descriptor, spans, count, active, since))
+      *moved = 1;
+    for (size_t s = 1; s < count; s++) {
+      if (spans[s].tag < spans[s - 1].tag) {
+        qsort(spans, count, sizeof(*spans), sort_compare);
+        *moved = 1;
+        break;
+      }
+    }
+  }
+
+  /* Copy fields in order, recursing into submessages */
+  for (size_t s = 0; !error && s < count; s++) {
+    const pb_message_span_t *span = &(spans[s]);
+    if (span->start == span->end)
+      continue;
+    const pb_field_descriptor_t *field =
+      pb_descriptor_field_by_tag(descriptor, span->tag);
+    if (field && pb_field_descriptor_type(field) == PB_TYPE_MESSAGE &&
+        span->header != span->length) {
+      size_t key    = span->length - span->start,
+             prefix = span->header - span->length, written;
+      uint8_t *contents = &(data[*total + key + prefix]);
+      if (!(error = sort_fields(pb_field_descriptor_nested(field),
+          &(source[span->header]), span->end - span->header, contents,
+            &written, moved, allocator))) {
+        memcpy(&(data[*total]), &(source[span->start]), key);
+
+        /* Rewrite length prefix, if the submessage shrunk */
+        if (written == span->end - span->header) {
+          memcpy(&(data[*total + key]), &(source[span->length]), prefix);
+        } else {
+          uint32_t length = written;
+          prefix = pb_varint_pack_uint32(&(data[*total + key]), &length);
+          memmove(&(data[*total + key + prefix]), contents, written);
+        }
+        *total += key + prefix + written;
+      }
+
+    /* Copy all other fields as they are */
+    } else {
+      memcpy(&(data[*total]), &(source[span->start]), span->end - span->start);
+      *total += span->end - span->start;
+    }
+  }
+  pb_allocator_free(allocator, spans);
+  return error;
+}
+
+/* ------------------------------------------------------------------------- */
+
+/*!
+ * Rotate a 64-bit value to the left.
+ *
+ * \param[in] value Value
+ * \param[in] bits  Bits
+ * \return          Rotated value
+ */
+PB_INLINE uint64_t
+hash_rotate(uint64_t value, unsigned int bits) {
+  return (value << bits) | (value >> (64 - bits));
+}
+
+/*!
+ * Mix a 64-bit word of input into an accumulator.
+ *
+ * \param[in] acc   Accumulator
+ * \param[in] input Input
+ * \return          Accumulator
+ */
+PB_INLINE uint64_t
+hash_round(uint64_t acc, uint64_t input) {
+  acc += input * 14029467366897019727ULL;
+  return hash_rotate(acc, 31) * 11400714785074694791ULL;
+}
+
+/*!
+ * Compute the hash of a sequence of bytes.
+ *
+ * This is XXH64, which processes 32 bytes per iteration with four independent
+ * accumulators, so long strings and bytes are hashed at memory speed. Words
+ * are read in host byte order, so hashes are only stable on a single platform.
+ *
+ * \param[in] data[] Raw data
+ * \param[in] size   Raw data size
+ * \param[in] seed   Seed
+ * \return           Hash
+ */
+static uint64_t
+hash_bytes(const void *data, size_t size, uint64_t seed) {
+  assert(data || !size);
+  const uint8_t *p = data, *end = p + size;
+  uint64_t hash, word;
+
+  /* Process stripes of 32 bytes with four accumulators */
+  if (size >= 32) {
+    uint64_t acc[4] = {
+      seed + 11400714785074694791ULL + 14029467366897019727ULL,
+      seed + 14029467366897019727ULL,
+      seed,
+      seed - 11400714785074694791ULL
+    };
+    do {
+      for (size_t a = 0; a < 4; a++, p += 8) {
+        memcpy(&word, p, 8);
+        acc[a] = hash_round(acc[a], word);
+      }
+    } while (end - p >= 32);
+    hash = hash_rotate(acc[0], 1)  + hash_rotate(acc[1], 7) +
+           hash_rotate(acc[2], 12) + hash_rotate(acc[3], 18);
+    for (size_t a = 0; a < 4; a++) {
+      hash ^= hash_round(0, acc[a]);
+      hash  = hash * 11400714785074694791ULL + 9650029242287828579ULL;
+    }
+  } else {
+    hash = seed + 2870177450012600261ULL;
+  }
+  hash += size;
+
+  /* Process remaining words, half-words and bytes */
+  for (; end - p >= 8; p += 8) {
+    memcpy(&word, p, 8);
+    hash ^= hash_round(0, word);
+    hash  = hash_rotate(hash, 27) * 11400714785074694791ULL +
+      9650029242287828579ULL;
+  }
+  if (end - p >= 4) {
+    uint32_t half; memcpy(&half, p, 4); p += 4;
+    hash ^= half * 11400714785074694791ULL;
+    hash  = hash_rotate(hash, 23) * 14029467366897019727ULL +
+      1609587929392839161ULL;
+  }
+  for (; p < end; p++) {
+    hash ^= *p * 2870177450012600261ULL;
+    hash  = hash_rotate(hash, 11) * 11400714785074694791ULL;
+  }
+
+  /* Avalanche bits */
+  hash ^= hash >> 33; hash *= 14029467366897019727ULL;
+  hash ^= hash >> 29; hash *= 1609587929392839161ULL;
+  return hash ^ (hash >> 32);
+}
+
+/*!
+ * Compute the hash of a value, chaining it to the given hash.
+ *
+ * Strings and bytes are hashed in place, nested messages by their canonical
+ * hash, and all other values by their native representation, so that equal
+ * values yield equal hashes regardless of their encoding.
+ *
+ * \param[in]     descriptor Field descriptor
+ * \param[in]     part       Part
+ * \param[in,out] hash       Hash
+ * \return                   Error code
+ */
+static pb_error_t
+hash_value(
+    const pb_field_descriptor_t *descriptor, const pb_part_t *part,
+    uint64_t *hash) {
+  assert(descriptor && part && hash);
+  pb_error_t error = PB_ERROR_NONE;
+  switch (pb_field_descriptor_type(descriptor)) {
+
+    /* Hash nested message */
+    case PB_TYPE_MESSAGE: {
+      pb_message_t submessage = {
+        .descriptor = pb_field_descriptor_nested(descriptor),
+        .part       = *part
+      };
+      uint64_t nested;
+      if (!(error = pb_message_hash(&submessage, &nested)))
+        *hash = hash_bytes(&nested, sizeof(nested), *hash);
+      break;
+    }
+
+    /* Hash strings and bytes without copying */
+    case PB_TYPE_STRING:
+    case PB_TYPE_BYTES: {
+      pb_field_t field = { .descriptor = descriptor, .part = *part };
+      pb_string_t value;
+      if (!(error = pb_field_get(&field, &value)))
+        *hash = hash_bytes(pb_string_data(&value),
+          pb_string_size(&value), *hash);
+      break;
+    }
+
+    /* Hash native representation */
+    default: {
+      pb_field_t field = { .descriptor = descriptor, .part = *part };
+      uint64_t value = 0;
+      if (!(error = pb_field_get(&field, &value)))
+        *hash = hash_bytes(&value,
+          pb_field_descriptor_type_size(descriptor), *hash);
+      break;
+    }
+  }
+  return error;
+}
+
+/*!
+ * Compare two values.
+ *
+ * \param[in] descriptor Field descriptor
+ * \param[in] x          Part
+ * \param[in] y          Part
+ * \return               Test result
+ */
+static int
+equals_value(
+    const pb_field_descriptor_t *descriptor, const pb_part_t *x,
+    const pb_part_t *y) {
+  assert(descriptor && x && y);
+  switch (pb_field_descriptor_type(descriptor)) {
+
+    /* Compare nested messages */
+    case PB_TYPE_MESSAGE: {
+      pb_message_t submessage[2] = {
+        { .descriptor = pb_field_descriptor_nested(descriptor), .part = *x },
+        { .descriptor = pb_field_descriptor_nested(descriptor), .part = *y }
+      };
+      return pb_message_equals(&(submessage[0]), &(submessage[1]));
+    }
+
+    /* Compare strings and bytes without copying */
+    case PB_TYPE_STRING:
+    case PB_TYPE_BYTES: {
+      pb_field_t field[2] = {
+        { .descriptor = descriptor, .part = *x },
+        { .descriptor = descriptor, .part = *y }
+      };
+      pb_string_t value[2];
+      return !pb_field_get(&(field[0]), &(value[0])) &&
+             !pb_field_get(&(field[1]), &(value[1])) &&
+             pb_string_equals(&(value[0]), &(value[1]));
+    }
+
+    /* Compare native representation */
+    default: {
+      pb_field_t field[2] = {
+        { .descriptor = descriptor, .part = *x },
+        { .descriptor = descriptor, .part = *y }
+      };
+      uint64_t value[2] = { 0, 0 };
+      return !pb_field_get(&(field[0]), &(value[0])) &&
+             !pb_field_get(&(field[1]), &(value[1])) &&
+             value[0] == value[1];
+    }
+  }
+}
+
+/*!
+ * Bring the fields of a message into canonical form with a single pass.
+ *
+ * For every field of the descriptor, the number of occurrences and the part
+ * of the last occurrence are recorded, and the values of repeated fields are
+ * hashed in order, regardless of whether they are packed. Members of a oneof
+ * are only retained if they occurred last. Unknown fields and extensions are
+ * ignored.
+ *
+ * \param[in,out] message   Message
+ * \param[out]    canonical Canonical form by field position
+ * \return                  Error code
+ */
+static pb_error_t
+canonicalize(pb_message_t *message, pb_message_canonical_t canonical[]) {
+  assert(message && canonical);
+  const pb_descriptor_t *descriptor = pb_message_descriptor(message);
+  memset(canonical, 0, sizeof(*canonical) * descriptor->field.size);
+  pb_error_t error = PB_ERROR_NONE;
+
+  /* Record occurrences of all fields */
+  pb_cursor_t cursor = pb_cursor_create_without_tag(message);
+  if (pb_cursor_valid(&cursor)) {
+    size_t pos = 0;
+    do {
+      const pb_field_descriptor_t *field = pb_cursor_descriptor(&cursor);
+      if (field <  descriptor->field.data ||
+          field >= descriptor->field.data + descriptor->field.size)
+        continue;
+
+      /* Update canonical form of field */
+      pb_message_canonical_t *current =
+        &(canonical[field - descriptor->field.data]);
+      current->pos = ++pos;
+      current->count++;
+      current->part = pb_part_create_from_cursor(&cursor);
+      if (pb_field_descriptor_label(field) == PB_LABEL_REPEATED)
+        error = hash_value(field, &(current->part), &(current->hash));
+    } while (!error && pb_cursor_next(&cursor));
+  }
+  if (!error && pb_cursor_error(&cursor) != PB_ERROR_EOM)
+    error = pb_cursor_error(&cursor);
+  pb_cursor_destroy(&cursor);
+
+  /* Retain only the member of a oneof that occurred last */
+  for (size_t f = 0; !error && f < descriptor->field.size; f++) {
+    const pb_field_descriptor_t *field = &(descriptor->field.data[f]);
+    if (canonical[f].count &&
+        pb_field_descriptor_label(field) == PB_LABEL_ONEOF) {
+      const pb_oneof_descriptor_t *oneof = pb_field_descriptor_oneof(field);
+      for (size_t i = 0; i < oneof->index.size; i++)
+        if (canonical[oneof->index.data[i]].pos > canonical[f].pos)
+          canonical[f].count = 0;
+    }
+  }
+  return error;
+}
+
+/* ------------------------------------------------------------------------- */
+
+/*!
+ * Read the values for up to 64 tags from a message in a single pass.
+ *
+ * The message is walked once with a cursor halting on every field, and the
+ * value of every occurrence of a requested field is read, so the last one
+ * wins. A requested member of a oneof is dropped again when another member
+ * of the same oneof occurs later. Absent fields fall back to their defaults.
+ *
+ * \param[in,out] message Message
+ * \param[in]     tags[]  Tags
+ * \param[out]    values  Pointers receiving values
+ * \param[in]     size    Tag count
+ * \return                Error code
+ */
+static pb_error_t
+get_many(
+    pb_message_t *message, const pb_tag_t tags[], void *values[],
+    size_t size) {
+  assert(message && tags && values && size && size <= 64);
+  const pb_field_descriptor_t *descriptors[64];
+  for (size_t t = 0; t < size; t++) {
+    descriptors[t] = pb_descriptor_field_by_tag(message->descriptor, tags[t]);
+    assert(descriptors[t] && values[t] &&
+      pb_field_descriptor_type(descriptors[t])  != PB_TYPE_MESSAGE &&
+      pb_field_descriptor_label(descriptors[t]) != PB_LABEL_REPEATED);
+  }
+
+  /* Walk fields and read values of requested tags */
+  uint64_t found = 0;
+  pb_cursor_t cursor = pb_cursor_create_without_tag(message);
+  pb_error_t  error  = pb_cursor_error(&cursor);
+  if (pb_cursor_valid(&cursor)) {
+    do {
+      const pb_field_descriptor_t *descriptor = pb_cursor_descriptor(&cursor);
+      const pb_oneof_descriptor_t *oneof =
+        pb_field_descriptor_oneof(descriptor);
+      for (size_t t = 0; !error && t < size; t++) {
+        if (descriptors[t] == descriptor) {
+          if (!(error = pb_cursor_get(&cursor, values[t])))
+            found |= (uint64_t)1 << t;
+        } else if (oneof && oneof == pb_field_descriptor_oneof(
+            descriptors[t])) {
+          found &= ~((uint64_t)1 << t);
+        }
+      }
+    } while (!error && pb_cursor_next(&cursor));
+    if (!error)
+      error = pb_cursor_error(&cursor);
+  }
+  pb_cursor_destroy(&cursor);
+  if (error != PB_ERROR_EOM)
+    return error;
+
+  /* Fall back to default values for absent fields */
+  error = PB_ERROR_NONE;
+  for (size_t t = 0; t < size; t++) {
+    if (found & ((uint64_t)1 << t))
+      continue;
+    if (unlikely_(!pb_field_descriptor_default(descriptors[t]))) {
+      error = PB_ERROR_ABSENT;
+    } else {
+      memcpy(values[t], pb_field_descriptor_default(descriptors[t]),
+        pb_field_descriptor_type_size(descriptors[t]));
+    }
+  }
+  return error;
+}
 
 /* ----------------------------------------------------------------------------
  * Interface
@@ -71,10 +1299,17 @@ pb_message_create_within(pb_message_t *message, pb_tag_t tag) {
     assert(descriptor &&
       pb_field_descriptor_type(descriptor) == PB_TYPE_MESSAGE &&
       pb_field_descriptor_nested(descriptor));
+    pb_trace_t *trace = pb_trace_from(pb_message_journal(message));
+    if (unlikely_(trace != NULL))
+      trace = pb_trace_begin(trace, PB_TRACE_MESSAGE_CREATE, message, tag,
+        NULL);
     pb_message_t submessage = {
       .descriptor = pb_field_descriptor_nested(descriptor),
       .part       = pb_part_create(message, tag)
     };
+    if (unlikely_(trace != NULL))
+      pb_trace_end(trace, pb_message_journal(message),
+        pb_message_error(&submessage));
     return submessage;
   }
   return pb_message_create_invalid();
@@ -166,6 +1401,92 @@ pb_message_create_from_field(
   return pb_message_create_invalid();
 }
 
+/*!
+ * Create a submessage within a message for the element of a repeated field
+ * with the given key value.
+ *
+ * Repeated submessages are often used as maps, e.g. with the encoding of map
+ * fields. Instead of comparing every element, a key index is built on first
+ * use, which maps the hashes of all key values to the offsets of the elements
+ * and is rebuilt whenever the message was altered. If an element with an equal
+ * key occurs more than once, the last occurrence is returned.
+ *
+ * \warning The key index is owned by the message and released when the message
+ * is destroyed. Copies created with pb_message_copy() don't share the index,
+ * so messages with a key index must not be copied by assignment.
+ *
+ * \warning The caller has to ensure that the space pointed to by the value
+ * pointer is appropriately sized for the type of the key field.
+ *
+ * \param[in,out] message Message
+ * \param[in]     tag     Tag
+ * \param[in]     key     Tag of key field
+ * \param[in]     value   Pointer holding key value
+ * \return                Submessage
+ */
+extern pb_message_t
+pb_message_create_from_key(
+    pb_message_t *message, pb_tag_t tag, pb_tag_t key, const void *value) {
+  assert(message && tag && key && value);
+  if (unlikely_(!pb_message_valid(message) || pb_message_align(message)))
+    return pb_message_create_invalid();
+
+  /* Assert repeated message field with non-message key field */
+  const pb_field_descriptor_t *descriptor =
+    pb_descriptor_field_by_tag(message->descriptor, tag);
+  assert(descriptor &&
+    pb_field_descriptor_type(descriptor)  == PB_TYPE_MESSAGE &&
+    pb_field_descriptor_label(descriptor) == PB_LABEL_REPEATED &&
+    pb_field_descriptor_nested(descriptor));
+  const pb_field_descriptor_t *field = pb_descriptor_field_by_tag(
+    pb_field_descriptor_nested(descriptor), key);
+  assert(field &&
+    pb_field_descriptor_type(field)  != PB_TYPE_MESSAGE &&
+    pb_field_descriptor_label(field) != PB_LABEL_REPEATED);
+
+  /* Look up key index or allocate a new one */
+  pb_message_map_t *map = message->map;
+  while (map && (map->tag != tag || map->key != key))
+    map = map->next;
+  if (!map) {
+    map = pb_allocator_allocate(pb_journal_allocator(
+      pb_message_journal(message)), sizeof(pb_message_map_t));
+    if (unlikely_(!map))
+      return pb_message_create_invalid();
+    *map = (pb_message_map_t){
+      .next    = message->map,
+      .tag     = tag,
+      .key     = key,
+      .version = PB_VERSION_MAX
+    };
+    message->map = map;
+  }
+
+  /* Rebuild key index, if the message was altered */
+  if ((map->version  != pb_message_version(message) ||
+       map->revision != pb_journal_revision(pb_message_journal(message))) &&
+      unlikely_(map_build(message, map)))
+    return pb_message_create_invalid();
+
+  /* Return submessage for matching element */
+  if (map->used) {
+    const pb_message_map_slot_t *slot =
+      map_find(message, map, map_hash(field, value), value);
+    if (slot->offset.diff.tag) {
+      pb_message_t submessage = {
+        .descriptor = pb_field_descriptor_nested(descriptor),
+        .part       = {
+          .journal = pb_message_journal(message),
+          .version = map->version,
+          .offset  = slot->offset
+        }
+      };
+      return submessage;
+    }
+  }
+  return pb_message_create_invalid();
+}
+
 /*!
  * Destroy a message.
  *
@@ -174,9 +1495,100 @@ pb_message_create_from_field(
 extern void
 pb_message_destroy(pb_message_t *message) {
   assert(message);
+  if (message->index) {
+    pb_allocator_free(pb_journal_allocator(
+      pb_message_journal(message)), message->index);
+    message->index = NULL;
+  }
+
+  /* Free all key indexes */
+  while (message->map) {
+    pb_allocator_t *allocator =
+      pb_journal_allocator(pb_message_journal(message));
+    pb_message_map_t *map = message->map;
+    message->map = map->next;
+    if (map->slot)
+      pb_allocator_free(allocator, map->slot);
+    pb_allocator_free(allocator, map);
+  }
   pb_part_destroy(&(message->part));
 }
 
+/*!
+ * Attach a field offset index to a message.
+ *
+ * The index maps the tags of all non-repeated fields that are not part of a
+ * oneof to the offsets of their last occurrence, so pb_message_has() and
+ * pb_message_get() don't need to scan the whole message for every field. The
+ * index is lazily built on first use and rebuilt whenever the message was
+ * altered, which makes it worthwhile for messages that are read repeatedly.
+ *
+ * \warning The index is owned by the message and released when the message
+ * is destroyed. Copies created with pb_message_copy() don't share the index,
+ * so messages with an index must not be copied by assignment.
+ *
+ * \param[in,out] message Message
+ * \return                Error code
+ */
+extern pb_error_t
+pb_message_index(pb_message_t *message) {
+  assert(message);
+  if (unlikely_(!pb_message_valid(message)))
+    return PB_ERROR_INVALID;
+  if (message->index)
+    return PB_ERROR_NONE;
+
+  /* Allocate index for all fields of the descriptor */
+  pb_allocator_t *allocator =
+    pb_journal_allocator(pb_message_journal(message));
+  size_t size = pb_message_descriptor(message)->field.size;
+  pb_message_index_t *index = pb_allocator_allocate(allocator,
+    sizeof(pb_message_index_t) + sizeof(pb_offset_t) * size);
+  if (unlikely_(!index))
+    return PB_ERROR_ALLOC;
+
+  /* Mark index as out of date, so it is built on first use */
+  index->version = PB_VERSION_MAX;
+  message->index = index;
+  return PB_ERROR_NONE;
+}
+
+/*!
+ * Look up the active member of a oneof using the field offset index.
+ *
+ * This is only meant for internal use, so oneofs and parts of oneof members
+ * can be resolved without scanning the message, if an index is attached.
+ *
+ * \param[in,out] message    Message
+ * \param[in]     descriptor Oneof descriptor
+ * \param[out]    tag        Tag of active member
+ * \param[out]    part       Part of active member
+ * \return                   Error code
+ */
+extern pb_error_t
+pb_message_index_case(
+    pb_message_t *message, const pb_oneof_descriptor_t *descriptor,
+    pb_tag_t *tag, pb_part_t *part) {
+  assert(message && descriptor && tag && part);
+  if (unlikely_(!message->index || !pb_message_valid(message)))
+    return PB_ERROR_INVALID;
+  pb_error_t error = index_build(message);
+  if (unlikely_(error))
+    return error;
+
+  /* Return tag and part of active member, if any */
+  size_t f = index_case(message, descriptor);
+  if (f == SIZE_MAX)
+    return PB_ERROR_EOM;
+  *tag  = pb_field_descriptor_tag(&(descriptor->descriptor->field.data[f]));
+  *part = (pb_part_t){
+    .journal = pb_message_journal(message),
+    .version = message->index->version,
+    .offset  = message->index->offset[f]
+  };
+  return PB_ERROR_NONE;
+}
+
 /*!
  * Test whether a message contains a given tag.
  *
@@ -190,6 +1602,18 @@ pb_message_destroy(pb_message_t *message) {
 extern int
 pb_message_has(pb_message_t *message, pb_tag_t tag) {
   assert(message && tag);
+
+  /* Use field offset index, if applicable */
+  if (message->index && pb_message_valid(message)) {
+    const pb_field_descriptor_t *descriptor =
+      pb_descriptor_field_by_tag(message->descriptor, tag);
+    if (descriptor && index_position(message, descriptor) != SIZE_MAX) {
+      pb_part_t part;
+      return !index_lookup(message, descriptor, &part);
+    }
+  }
+
+  /* Otherwise use cursor to seek for field */
   pb_cursor_t cursor = pb_cursor_create(message, tag);
   int result = pb_cursor_valid(&cursor);
   pb_cursor_destroy(&cursor);
@@ -252,6 +1676,7 @@ pb_message_match(pb_message_t *message, pb_tag_t tag, const void *value) {
 extern pb_error_t
 pb_message_get(pb_message_t *message, pb_tag_t tag, void *value) {
   assert(message && tag && value);
+  pb_stats_measure(PB_STATS_MESSAGE_GET, message->descriptor);
   if (unlikely_(!pb_message_valid(message)))
     return PB_ERROR_INVALID;
   pb_error_t error = PB_ERROR_NONE;
@@ -263,13 +1688,27 @@ pb_message_get(pb_message_t *message, pb_tag_t tag, void *value) {
     pb_field_descriptor_type(descriptor)  != PB_TYPE_MESSAGE &&
     pb_field_descriptor_label(descriptor) != PB_LABEL_REPEATED);
 
-  /* Use cursor to omit field creation */
-  pb_cursor_t cursor = pb_cursor_create(message, tag);
-  if (pb_cursor_valid(&cursor)) {
-    error = pb_cursor_get(&cursor, value);
+  /* Use field offset index, if applicable */
+  pb_cursor_t cursor = pb_cursor_create_invalid();
+  if (message->index && index_position(message, descriptor) != SIZE_MAX) {
+    pb_field_t field = {
+      .descriptor = descriptor
+    };
+    if (!(error = index_lookup(message, descriptor, &(field.part))))
+      error = pb_field_get(&field, value);
+    if (error != PB_ERROR_EOM)
+      return error;
+
+  /* Otherwise use cursor to omit field creation */
+  } else {
+    cursor = pb_cursor_create(message, tag);
+    error  = pb_cursor_valid(&cursor)
+      ? pb_cursor_get(&cursor, value)
+      : pb_cursor_error(&cursor);
+  }
 
-  /* Cursor didn't find field, try default value */
-  } else if ((error = pb_cursor_error(&cursor)) == PB_ERROR_EOM) {
+  /* Field was not found, try default value */
+  if (error == PB_ERROR_EOM) {
 
     /* Extract default value, if present */
     if (unlikely_(!pb_field_descriptor_default(descriptor))) {
@@ -284,6 +1723,151 @@ pb_message_get(pb_message_t *message, pb_tag_t tag, void *value) {
   return error;
 }
 
+/*!
+ * Read the values for a set of tags from a message in a single pass.
+ *
+ * This is equivalent to calling pb_message_get() for every tag, but walks the
+ * message only once per 64 tags instead of once per tag, which pays off when
+ * many fields of the same message are read. If a field is absent and has no
+ * default value, all other values are read anyway, and PB_ERROR_ABSENT is
+ * returned. In this case, the respective value is unspecified, as a member
+ * of a oneof may have been read before another member superseded it.
+ *
+ * \warning The caller has to ensure that the space pointed to by the value
+ * pointers is appropriately sized for the types of fields.
+ *
+ * \param[in,out] message Message
+ * \param[in]     tags[]  Tags
+ * \param[out]    values  Pointers receiving values
+ * \param[in]     size    Tag count
+ * \return                Error code
+ */
+extern pb_error_t
+pb_message_get_many(
+    pb_message_t *message, const pb_tag_t tags[], void *values[],
+    size_t size) {
+  assert(message && tags && values);
+  pb_stats_measure(PB_STATS_MESSAGE_GET, message->descriptor);
+  if (unlikely_(!pb_message_valid(message)))
+    return PB_ERROR_INVALID;
+  pb_error_t error = PB_ERROR_NONE;
+
+  /* Read values in chunks of 64 tags, remembering absent fields */
+  for (size_t t = 0; t < size; t += 64) {
+    pb_error_t result = get_many(message, &(tags[t]), &(values[t]),
+      size - t < 64 ? size - t : 64);
+    if (result == PB_ERROR_ABSENT)
+      error = result;
+    else if (unlikely_(result))
+      return result;
+  }
+  return error;
+}
+
+/*!
+ * Read all singular fields of a message into a struct in a single pass.
+ *
+ * The struct is initialized according to the layout, after which the message
+ * is walked once, copying the value of every occurrence of a singular scalar,
+ * string or bytes field into its member and marking it as present. Strings
+ * and bytes point into the journal, so they are valid until it is altered.
+ * Repeated fields and nested messages are not read, but can be read with
+ * pb_message_get_repeated() and cursors. The struct needs no clearing.
+ *
+ * \param[in,out] message Message
+ * \param[in]     layout  Layout
+ * \param[out]    value   Pointer receiving struct
+ * \return                Error code
+ */
+extern pb_error_t
+pb_message_get_fields(
+    pb_message_t *message, const pb_layout_t *layout, void *value) {
+  assert(message && layout && value);
+  pb_stats_measure(PB_STATS_MESSAGE_GET, message->descriptor);
+  if (unlikely_(!pb_message_valid(message)))
+    return PB_ERROR_INVALID;
+  assert(pb_layout_descriptor(layout) == message->descriptor);
+  pb_layout_init(layout, value);
+
+  /* Walk fields and read values of singular non-message fields */
+  const pb_field_descriptor_t *fields = message->descriptor->field.data;
+  pb_cursor_t cursor = pb_cursor_create_without_tag(message);
+  pb_error_t  error  = pb_cursor_error(&cursor);
+  if (pb_cursor_valid(&cursor)) {
+    do {
+      const pb_field_descriptor_t *descriptor = pb_cursor_descriptor(&cursor);
+      if (descriptor < fields || descriptor >= fields + layout->field.size ||
+          pb_field_descriptor_type(descriptor)  == PB_TYPE_MESSAGE ||
+          pb_field_descriptor_label(descriptor) == PB_LABEL_REPEATED)
+        continue;
+
+      /* Read value into member and mark it as present */
+      size_t pos = descriptor - fields;
+      if (unlikely_(error = pb_cursor_get(&cursor,
+          pb_layout_member(layout, value, pos))))
+        break;
+      pb_layout_set(layout, value, pos);
+
+      /* Mark all other members of the oneof as absent, if any */
+      const pb_oneof_descriptor_t *oneof =
+        pb_field_descriptor_oneof(descriptor);
+      for (size_t i = 0; oneof && i < oneof->index.size; i++)
+        if (oneof->index.data[i] != pos)
+          pb_layout_unset(layout, value, oneof->index.data[i]);
+    } while (pb_cursor_next(&cursor));
+    if (!error)
+      error = pb_cursor_error(&cursor);
+  }
+  pb_cursor_destroy(&cursor);
+  return error != PB_ERROR_EOM
+    ? error
+    : PB_ERROR_NONE;
+}
+
+/*!
+ * Read all values for a given repeated tag from a message.
+ *
+ * See pb_cursor_get_all() for details on sizing the array of values. If the
+ * message does not contain any values, the number of values is zero.
+ *
+ * \warning The caller has to ensure that the space pointed to by the values
+ * pointer is appropriately sized for the type of field.
+ *
+ * \param[in,out] message Message
+ * \param[in]     tag     Tag
+ * \param[out]    values  Pointer receiving values
+ * \param[in,out] size    Value count
+ * \return                Error code
+ */
+extern pb_error_t
+pb_message_get_repeated(
+    pb_message_t *message, pb_tag_t tag, void *values, size_t *size) {
+  assert(message && tag && size);
+  if (unlikely_(!pb_message_valid(message))) {
+    *size = 0;
+    return PB_ERROR_INVALID;
+  }
+
+#ifndef NDEBUG
+
+  /* Assert repeated non-message field */
+  const pb_field_descriptor_t *descriptor =
+    pb_descriptor_field_by_tag(message->descriptor, tag);
+  assert(descriptor &&
+    pb_field_descriptor_type(descriptor)  != PB_TYPE_MESSAGE &&
+    pb_field_descriptor_label(descriptor) == PB_LABEL_REPEATED);
+
+#endif /* NDEBUG */
+
+  /* Use cursor to read all values */
+  pb_cursor_t cursor = pb_cursor_create(message, tag);
+  pb_error_t  error  = pb_cursor_get_all(&cursor, values, size);
+  pb_cursor_destroy(&cursor);
+  return error != PB_ERROR_EOM
+    ? error
+    : PB_ERROR_NONE;
+}
+
 /*!
  * Write a value or submessage for a given tag to a message.
  *
@@ -305,10 +1889,16 @@ pb_message_get(pb_message_t *message, pb_tag_t tag, void *value) {
 extern pb_error_t
 pb_message_put(pb_message_t *message, pb_tag_t tag, const void *value) {
   assert(message && tag && value);
+  pb_stats_measure(PB_STATS_MESSAGE_PUT, message->descriptor);
   if (unlikely_(!pb_message_valid(message)))
     return PB_ERROR_INVALID;
   pb_error_t error = PB_ERROR_NONE;
 
+  /* Record operation, if a trace is attached */
+  pb_trace_t *trace = pb_trace_from(pb_message_journal(message));
+  if (unlikely_(trace != NULL))
+    trace = pb_trace_begin(trace, PB_TRACE_MESSAGE_PUT, message, tag, value);
+
   /* Assert descriptor */
   const pb_field_descriptor_t *descriptor =
     pb_descriptor_field_by_tag(message->descriptor, tag);
@@ -338,16 +1928,202 @@ pb_message_put(pb_message_t *message, pb_tag_t tag, const void *value) {
     }
     pb_message_destroy(&submessage);
   }
+  if (unlikely_(trace != NULL))
+    pb_trace_end(trace, pb_message_journal(message), error);
+  return error;
+}
+
+/*!
+ * Write the values for a set of tags to a message at once.
+ *
+ * The writes are sorted by tag and merged with the existing fields of the
+ * message in a single pass into temporary memory, which then replaces the
+ * contents of the message with a single journal write. Thus, the message is
+ * scanned and the length prefixes of all parent messages are updated only
+ * once, instead of once per value. The semantics are the same as for calling
+ * pb_message_put() for every tag in order, i.e. non-repeated fields are
+ * replaced, values of repeated fields are appended, and writing a member of
+ * a oneof removes all other members. Submessages cannot be written at once.
+ *
+ * \warning The caller has to ensure that the space pointed to by the value
+ * pointers is appropriately sized for the types of fields.
+ *
+ * \param[in,out] message Message
+ * \param[in]     tags[]  Tags
+ * \param[in]     values  Pointers holding values
+ * \param[in]     size    Tag count
+ * \return                Error code
+ */
+extern pb_error_t
+pb_message_put_many(
+    pb_message_t *message, const pb_tag_t tags[], const void *const values[],
+    size_t size) {
+  assert(message && tags && values);
+  pb_stats_measure(PB_STATS_MESSAGE_PUT, message->descriptor);
+  if (unlikely_(!pb_message_valid(message) ||
+      pb_part_focus(&(message->part)) || pb_message_align(message)))
+    return PB_ERROR_INVALID;
+  if (unlikely_(!size))
+    return PB_ERROR_NONE;
+
+  /* Allocate temporary memory for descriptors and order of writes */
+  pb_journal_t   *journal   = pb_message_journal(message);
+  pb_allocator_t *allocator = pb_journal_allocator(journal);
+  const pb_field_descriptor_t **descriptors = pb_allocator_allocate(
+    allocator, (sizeof(*descriptors) + sizeof(size_t)) * size);
+  if (unlikely_(!descriptors))
+    return PB_ERROR_ALLOC;
+  size_t *order = (size_t *)&(descriptors[size]);
+
+  /* Resolve descriptors and sort writes by tag, keeping their order */
+  for (size_t w = 0; w < size; w++) {
+    descriptors[w] = pb_descriptor_field_by_tag(message->descriptor, tags[w]);
+    assert(descriptors[w] && values[w] &&
+      pb_field_descriptor_type(descriptors[w]) != PB_TYPE_MESSAGE);
+    size_t v = w;
+    for (; v && tags[order[v - 1]] > tags[w]; v--)
+      order[v] = order[v - 1];
+    order[v] = w;
+  }
+
+  /* Determine size of merged message, pack it and write it at once */
+  size_t total;
+  uint8_t *data = NULL;
+  pb_error_t error = put_merge(message, descriptors, values, order, size,
+    NULL, &total);
+  if (likely_(!error)) {
+    if (unlikely_(!(data = pb_allocator_allocate(allocator, total)))) {
+      error = PB_ERROR_ALLOC;
+    } else if (!(error = put_merge(message, descriptors, values, order,
+        size, data, &total))) {
+      error = pb_part_write(&(message->part), data, total);
+
+      /* Fields may have moved even if the size didn't change */
+      if (message->index)
+        message->index->version = PB_VERSION_MAX;
+    }
+  }
+
+  /* Free temporary memory */
+  if (data)
+    pb_allocator_free(allocator, data);
+  pb_allocator_free(allocator, descriptors);
   return error;
 }
 
+/*!
+ * Write a run of values for a given packed tag to a message at once.
+ *
+ * The values are appended to the packed field (or a new one, if there is no
+ * packed field yet) with a single journal write, instead of updating the
+ * length prefixes of the packed field and all parent messages per value.
+ *
+ * \warning The caller has to ensure that the space pointed to by the values
+ * pointer is appropriately sized for the type of field.
+ *
+ * \param[in,out] message Message
+ * \param[in]     tag     Tag
+ * \param[in]     values  Pointer holding values
+ * \param[in]     size    Value count
+ * \return                Error code
+ */
+extern pb_error_t
+pb_message_put_packed(
+    pb_message_t *message, pb_tag_t tag, const void *values, size_t size) {
+  assert(message && tag && values);
+  if (unlikely_(!pb_message_valid(message)))
+    return PB_ERROR_INVALID;
+
+  /* Assert packed field */
+  const pb_field_descriptor_t *descriptor =
+    pb_descriptor_field_by_tag(message->descriptor, tag);
+  assert(descriptor &&
+    pb_field_descriptor_label(descriptor) == PB_LABEL_REPEATED &&
+    pb_field_descriptor_packed(descriptor));
+
+  /* Write run of values */
+  return size
+    ? run_write(message, descriptor, values, size)
+    : PB_ERROR_NONE;
+}
+
+/*!
+ * Write a run of values for a given repeated tag to a message at once.
+ *
+ * The values are appended after the last occurrence of the repeated field
+ * with a single journal write. For packed fields, this is equivalent to
+ * pb_message_put_packed().
+ *
+ * \warning The caller has to ensure that the space pointed to by the values
+ * pointer is appropriately sized for the type of field.
+ *
+ * \param[in,out] message Message
+ * \param[in]     tag     Tag
+ * \param[in]     values  Pointer holding values
+ * \param[in]     size    Value count
+ * \return                Error code
+ */
+extern pb_error_t
+pb_message_put_repeated(
+    pb_message_t *message, pb_tag_t tag, const void *values, size_t size) {
+  assert(message && tag && values);
+  if (unlikely_(!pb_message_valid(message)))
+    return PB_ERROR_INVALID;
+
+  /* Assert repeated non-message field */
+  const pb_field_descriptor_t *descriptor =
+    pb_descriptor_field_by_tag(message->descriptor, tag);
+  assert(descriptor &&
+    pb_field_descriptor_type(descriptor)  != PB_TYPE_MESSAGE &&
+    pb_field_descriptor_label(descriptor) == PB_LABEL_REPEATED);
+
+  /* Write run of values */
+  return size
+    ? run_write(message, descriptor, values, size)
+    : PB_ERROR_NONE;
+}
+
+/*!
+ * Merge an encoded message into a message.
+ *
+ * As merging is defined as concatenation on the wire, the raw data of the
+ * buffer is appended to the message with a single journal write, and the
+ * length prefixes of the message and all parent messages are only updated
+ * once. Non-repeated fields of the buffer thus take precedence over those of
+ * the message, repeated fields are appended, and nested messages are merged
+ * recursively when read. Superseded occurrences are retained.
+ *
+ * \warning The buffer is not validated against the descriptor of the message,
+ * so the caller must ensure that it contains a valid encoded message of the
+ * same type. The buffer must not be the buffer of the message's journal.
+ *
+ * \param[in,out] message Message
+ * \param[in]     buffer  Buffer
+ * \return                Error code
+ */
+extern pb_error_t
+pb_message_merge(pb_message_t *message, const pb_buffer_t *buffer) {
+  assert(message && buffer);
+  if (unlikely_(!pb_message_valid(message) || !pb_buffer_valid(buffer)))
+    return PB_ERROR_INVALID;
+  assert(buffer != pb_journal_buffer(pb_message_journal(message)));
+
+  /* Append raw data to message */
+  return pb_buffer_size(buffer)
+    ? pb_part_append(&(message->part),
+        pb_buffer_data(buffer), pb_buffer_size(buffer))
+    : PB_ERROR_NONE;
+}
+
 /*!
  * Erase a field or submessage for a given tag from a message.
  *
  * Erasing a field or submessage will always erase all occurrences. Therefore
  * an unsafe cursor needs to be used. This is necessary, because in case of a
  * merged message, not only the last occurrence needs to be erased, but all
- * occurrences, so former occurrence don't magically reappear.
+ * occurrences, so former occurrence don't magically reappear. All values of a
+ * repeated field or submessage are erased in a single pass, moving the data
+ * and updating the length prefixes of parent messages only once.
  *
  * The cursor may either be invalid or at an invalid offset after trying to
  * erase all instances of a field or submessage inside a message. These errors
@@ -364,6 +2140,7 @@ pb_message_put(pb_message_t *message, pb_tag_t tag, const void *value) {
 extern pb_error_t
 pb_message_erase(pb_message_t *message, pb_tag_t tag) {
   assert(message && tag);
+  pb_stats_measure(PB_STATS_MESSAGE_ERASE, message->descriptor);
   if (unlikely_(!pb_message_valid(message)))
     return PB_ERROR_INVALID;
   pb_error_t error = PB_ERROR_NONE;
@@ -373,8 +2150,20 @@ pb_message_erase(pb_message_t *message, pb_tag_t tag) {
     pb_descriptor_field_by_tag(message->descriptor, tag);
   assert(descriptor);
 
+  /* Record operation, if a trace is attached */
+  pb_trace_t *trace = pb_trace_from(pb_message_journal(message));
+  if (unlikely_(trace != NULL))
+    trace = pb_trace_begin(trace, PB_TRACE_MESSAGE_ERASE, message, tag, NULL);
+
+  /* Erase all values of repeated field or submessage in a single pass */
+  if (pb_field_descriptor_label(descriptor) == PB_LABEL_REPEATED) {
+    error = pb_part_focus(&(message->part)) || pb_message_align(message)
+      ? PB_ERROR_INVALID
+      : erase_compact(message, &descriptor, 1);
+
   /* Clear non-oneof field or submessage */
-  if (likely_(pb_field_descriptor_label(descriptor) != PB_LABEL_ONEOF)) {
+  } else if (likely_(pb_field_descriptor_label(descriptor) !=
+                     PB_LABEL_ONEOF)) {
 
     /* Use cursor to omit field/message creation */
     pb_cursor_t cursor = pb_cursor_create_unsafe(message, tag);
@@ -394,6 +2183,153 @@ pb_message_erase(pb_message_t *message, pb_tag_t tag) {
     error = pb_oneof_clear(&oneof);
     pb_oneof_destroy(&oneof);
   }
+  if (unlikely_(trace != NULL))
+    pb_trace_end(trace, pb_message_journal(message), error);
+  return error;
+}
+
+/*!
+ * Erase the fields or submessages for a set of tags from a message at once.
+ *
+ * The message is compacted in a single pass into temporary memory, which then
+ * replaces the contents of the message with a single journal write. Thus, the
+ * data is moved and the length prefixes of all parent messages are updated
+ * only once, instead of once per occurrence. The semantics are the same as
+ * for calling pb_message_erase() for every tag, i.e. all occurrences of a
+ * field or submessage are erased, and erasing a member of a oneof erases all
+ * other members.
+ *
+ * \warning Fields, submessages and cursors obtained from the message before
+ * erasing must be recreated, since the contents are replaced as a whole.
+ *
+ * \param[in,out] message Message
+ * \param[in]     tags[]  Tags
+ * \param[in]     size    Tag count
+ * \return                Error code
+ */
+extern pb_error_t
+pb_message_erase_many(
+    pb_message_t *message, const pb_tag_t tags[], size_t size) {
+  assert(message && tags);
+  pb_stats_measure(PB_STATS_MESSAGE_ERASE, message->descriptor);
+  if (unlikely_(!pb_message_valid(message) ||
+      pb_part_focus(&(message->part)) || pb_message_align(message)))
+    return PB_ERROR_INVALID;
+  if (unlikely_(!size))
+    return PB_ERROR_NONE;
+
+  /* Allocate temporary memory for descriptors */
+  pb_allocator_t *allocator =
+    pb_journal_allocator(pb_message_journal(message));
+  const pb_field_descriptor_t **descriptors =
+    pb_allocator_allocate(allocator, sizeof(*descriptors) * size);
+  if (unlikely_(!descriptors))
+    return PB_ERROR_ALLOC;
+
+  /* Resolve descriptors and erase fields at once */
+  for (size_t e = 0; e < size; e++) {
+    descriptors[e] = pb_descriptor_field_by_tag(message->descriptor, tags[e]);
+    assert(descriptors[e]);
+  }
+  pb_error_t error = erase_compact(message, descriptors, size);
+  pb_allocator_free(allocator, descriptors);
+  return error;
+}
+
+/*!
+ * Bring the fields of a message into tag order.
+ *
+ * Messages built with an unordered journal contain their fields in the order
+ * they were written. This function restores tag order for the message and all
+ * of its submessages in a single pass into temporary memory, which then
+ * replaces the contents of the message with a single journal write. The
+ * relative order of occurrences of the same field is kept, and members of
+ * oneofs superseded by another member are dropped, so the semantics of the
+ * message don't change. If the message is already in order, it is left
+ * untouched.
+ *
+ * \warning Fields, submessages and cursors obtained from the message before
+ * canonicalizing must be recreated, since the contents are replaced as a
+ * whole, even if the size of the message doesn't change.
+ *
+ * \param[in,out] message Message
+ * \return                Error code
+ */
+extern pb_error_t
+pb_message_canonicalize(pb_message_t *message) {
+  assert(message);
+  if (unlikely_(!pb_message_valid(message) ||
+      pb_part_focus(&(message->part)) || pb_message_align(message)))
+    return PB_ERROR_INVALID;
+  if (pb_message_empty(message))
+    return PB_ERROR_NONE;
+
+  /* Allocate temporary memory for message in tag order */
+  pb_journal_t   *journal   = pb_message_journal(message);
+  pb_allocator_t *allocator = pb_journal_allocator(journal);
+  uint8_t *data = pb_allocator_allocate(allocator, pb_message_size(message));
+  if (unlikely_(!data))
+    return PB_ERROR_ALLOC;
+
+  /* Sort fields and write message at once, if any field was moved */
+  size_t total; int moved = 0;
+  pb_error_t error = sort_fields(message->descriptor,
+    pb_journal_data_from(journal, pb_message_start(message)),
+      pb_message_size(message), data, &total, &moved, allocator);
+  if (!error && moved) {
+    error = pb_part_write(&(message->part), data, total);
+
+    /* Fields may have moved even if the size didn't change */
+    if (message->index)
+      message->index->version = PB_VERSION_MAX;
+  }
+  pb_allocator_free(allocator, data);
+  return error;
+}
+
+/*!
+ * Erase a set of raw ranges from a message at once.
+ *
+ * The ranges are given as pairs of absolute start and end offsets, sorted and
+ * non-overlapping, each covering one or more complete fields including their
+ * tags, as determined by a cursor on the current version of the message.
+ *
+ * \param[in,out] message  Message
+ * \param[in]     ranges[] Start and end offsets
+ * \param[in]     size     Range count
+ * \return                 Error code
+ */
+extern pb_error_t
+pb_message_erase_ranges(
+    pb_message_t *message, const size_t ranges[], size_t size) {
+  assert(message && ranges && size);
+  if (unlikely_(!pb_message_valid(message) ||
+      pb_part_focus(&(message->part)) || pb_message_align(message)))
+    return PB_ERROR_INVALID;
+
+  /* Allocate temporary memory for compacted message */
+  pb_journal_t   *journal   = pb_message_journal(message);
+  pb_allocator_t *allocator = pb_journal_allocator(journal);
+  uint8_t *data = pb_allocator_allocate(allocator, pb_message_size(message));
+  if (unlikely_(!data))
+    return PB_ERROR_ALLOC;
+
+  /* Copy the gaps between the ranges */
+  const uint8_t *source = pb_journal_data_from(journal, 0);
+  size_t offset = pb_message_start(message), total = 0;
+  for (size_t r = 0; r < size; r++) {
+    assert(ranges[2 * r] >= offset && ranges[2 * r] < ranges[2 * r + 1]);
+    memcpy(&(data[total]), &(source[offset]), ranges[2 * r] - offset);
+    total += ranges[2 * r] - offset;
+    offset = ranges[2 * r + 1];
+  }
+  assert(offset <= pb_message_end(message));
+  memcpy(&(data[total]), &(source[offset]), pb_message_end(message) - offset);
+  total += pb_message_end(message) - offset;
+
+  /* Write compacted message at once */
+  pb_error_t error = pb_part_write(&(message->part), data, total);
+  pb_allocator_free(allocator, data);
   return error;
 }
 
@@ -409,5 +2345,189 @@ pb_message_erase(pb_message_t *message, pb_tag_t tag) {
 extern pb_error_t
 pb_message_clear(pb_message_t *message) {
   assert(message);
-  return pb_part_clear(&(message->part));
+  pb_journal_t *journal = pb_message_journal(message);
+  pb_trace_t   *trace   = pb_message_valid(message)
+    ? pb_trace_from(journal)
+    : NULL;
+  if (unlikely_(trace != NULL))
+    trace = pb_trace_begin(trace, PB_TRACE_MESSAGE_CLEAR, message, 0, NULL);
+  pb_error_t error = pb_part_clear(&(message->part));
+  if (unlikely_(trace != NULL))
+    pb_trace_end(trace, journal, error);
+  return error;
+}
+
+/*!
+ * Create a zero-copy buffer over the raw data of a message.
+ *
+ * This is mostly useful for forwarding a submessage without decoding it. The
+ * buffer refers to the data of the underlying journal, so it is only valid as
+ * long as the revision of the journal doesn't change, i.e. it must not be
+ * used after any write to the journal, and must not be written to itself.
+ *
+ * \param[in,out] message Message
+ * \return                Buffer
+ */
+extern pb_buffer_t
+pb_message_view(pb_message_t *message) {
+  assert(message);
+  if (unlikely_(!pb_message_valid(message) || pb_message_align(message)))
+    return pb_buffer_create_invalid();
+
+  /* Refer to raw data of message */
+  pb_journal_t *journal = pb_message_journal(message);
+  return pb_buffer_create_zero_copy_internal(
+    (uint8_t *)pb_journal_data_from(journal, pb_message_start(message)),
+    pb_message_size(message));
+}
+
+/*!
+ * Detach a copy of a message into a new journal.
+ *
+ * The raw data of the message is copied with a single allocation, so the new
+ * journal holds the message at its root and can be altered independently. It
+ * uses the allocator of the journal of the message, unless the latter doesn't
+ * own its data, in which case the default allocator is used.
+ *
+ * \param[in,out] message Message
+ * \return                Journal
+ */
+extern pb_journal_t
+pb_message_detach(pb_message_t *message) {
+  assert(message);
+  pb_buffer_t view = pb_message_view(message);
+  if (unlikely_(!pb_buffer_valid(&view)))
+    return pb_journal_create_invalid();
+
+  /* Determine allocator of new journal */
+  pb_allocator_t *allocator =
+    pb_journal_allocator(pb_message_journal(message));
+  if (allocator == &allocator_zero_copy || allocator == &allocator_fixed)
+    allocator = &allocator_default;
+
+  /* Copy raw data of message */
+  return pb_buffer_size(&view)
+    ? pb_journal_create_with_allocator(allocator,
+        pb_buffer_data(&view), pb_buffer_size(&view))
+    : pb_journal_create_empty_with_allocator(allocator);
+}
+
+/*!
+ * Compute the hash of a message.
+ *
+ * The fields are walked in the order of the descriptor, which is the order
+ * of tags for generated descriptors, so the hash does not depend on the order
+ * in which fields are encoded, or whether repeated fields are packed. For
+ * non-repeated fields only the last occurrence is hashed, as it takes
+ * precedence. Strings, bytes and nested messages are hashed in place.
+ *
+ * Unknown fields and extensions are ignored. Hashes are not guaranteed to be
+ * stable across platforms and versions of protobluff, so they should not be
+ * persisted.
+ *
+ * \param[in,out] message Message
+ * \param[out]    hash    Pointer receiving hash
+ * \return                Error code
+ */
+extern pb_error_t
+pb_message_hash(pb_message_t *message, uint64_t *hash) {
+  assert(message && hash);
+  if (unlikely_(!pb_message_valid(message)))
+    return PB_ERROR_INVALID;
+
+  /* Bring fields into canonical form */
+  const pb_descriptor_t *descriptor = pb_message_descriptor(message);
+  pb_message_canonical_t *canonical =
+    alloca(sizeof(*canonical) * descriptor->field.size);
+  pb_error_t error = canonicalize(message, canonical);
+
+  /* Combine hashes of present fields */
+  *hash = 0;
+  for (size_t f = 0; !error && f < descriptor->field.size; f++) {
+    const pb_field_descriptor_t *field = &(descriptor->field.data[f]);
+    if (!canonical[f].count)
+      continue;
+    if (pb_field_descriptor_label(field) != PB_LABEL_REPEATED)
+      error = hash_value(field, &(canonical[f].part), &(canonical[f].hash));
+    uint64_t block[2] = { pb_field_descriptor_tag(field), canonical[f].hash };
+    *hash = hash_bytes(block, sizeof(block), *hash);
+  }
+  return error;
+}
+
+/*!
+ * Test whether two messages are equal.
+ *
+ * Messages are equal if they are encoded identically, or if all fields are
+ * equal according to the same rules as for pb_message_hash(), which is used
+ * to reject unequal messages quickly. Messages that cannot be read are never
+ * equal.
+ *
+ * \param[in,out] x Message
+ * \param[in,out] y Message
+ * \return          Test result
+ */
+extern int
+pb_message_equals(pb_message_t *x, pb_message_t *y) {
+  assert(x && y);
+  assert(pb_message_descriptor(x) == pb_message_descriptor(y));
+  if (unlikely_(!pb_message_valid(x) || pb_message_align(x) ||
+                !pb_message_valid(y) || pb_message_align(y)))
+    return 0;
+
+  /* Messages with identical encoding are equal */
+  if (pb_message_size(x) == pb_message_size(y) && (pb_message_empty(x) ||
+      !memcmp(
+        pb_journal_data_from(pb_message_journal(x), pb_message_start(x)),
+        pb_journal_data_from(pb_message_journal(y), pb_message_start(y)),
+        pb_message_size(x))))
+    return 1;
+
+  /* Bring fields of both messages into canonical form */
+  const pb_descriptor_t *descriptor = pb_message_descriptor(x);
+  pb_message_canonical_t
+    *canonical_x = alloca(sizeof(*canonical_x) * descriptor->field.size),
+    *canonical_y = alloca(sizeof(*canonical_y) * descriptor->field.size);
+  if (canonicalize(x, canonical_x) || canonicalize(y, canonical_y))
+    return 0;
+
+  /* Compare presence and hashes of repeated fields first */
+  for (size_t f = 0; f < descriptor->field.size; f++)
+    if (!canonical_x[f].count != !canonical_y[f].count ||
+        canonical_x[f].hash   != canonical_y[f].hash)
+      return 0;
+
+  /* Compare values of present fields */
+  int result = 1;
+  for (size_t f = 0; result && f < descriptor->field.size; f++) {
+    const pb_field_descriptor_t *field = &(descriptor->field.data[f]);
+    if (!canonical_x[f].count)
+      continue;
+
+    /* Compare last occurrence of non-repeated field */
+    if (pb_field_descriptor_label(field) != PB_LABEL_REPEATED) {
+      result = equals_value(field,
+        &(canonical_x[f].part), &(canonical_y[f].part));
+
+    /* Compare repeated fields element by element */
+    } else {
+      pb_tag_t tag = pb_field_descriptor_tag(field);
+      pb_cursor_t cursor_x = pb_cursor_create(x, tag),
+                  cursor_y = pb_cursor_create(y, tag);
+      while (result && pb_cursor_valid(&cursor_x) &&
+                       pb_cursor_valid(&cursor_y)) {
+        pb_part_t part_x = pb_part_create_from_cursor(&cursor_x),
+                  part_y = pb_part_create_from_cursor(&cursor_y);
+        result = equals_value(field, &part_x, &part_y);
+        pb_cursor_next(&cursor_x);
+        pb_cursor_next(&cursor_y);
+      }
+      result = result &&
+        pb_cursor_error(&cursor_x) == PB_ERROR_EOM &&
+        pb_cursor_error(&cursor_y) == PB_ERROR_EOM;
+      pb_cursor_destroy(&cursor_y);
+      pb_cursor_destroy(&cursor_x);
+    }
+  }
+  return result;
 }
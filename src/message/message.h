@@ -24,6 +24,7 @@
 #define PB_MESSAGE_MESSAGE_H
 
 #include <assert.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -33,6 +34,66 @@
 #include "message/journal.h"
 #include "message/part.h"
 
+/* ----------------------------------------------------------------------------
+ * Type definitions
+ * ------------------------------------------------------------------------- */
+
+typedef struct pb_message_index_t {
+  pb_version_t version;                /*!< Version of offsets */
+  pb_offset_t offset[];                /*!< Offsets by field position */
+} pb_message_index_t;
+
+typedef struct pb_message_map_slot_t {
+  size_t hash;                         /*!< Hash of key value */
+  pb_offset_t offset;                  /*!< Offsets of element */
+} pb_message_map_slot_t;
+
+typedef struct pb_message_map_t {
+  struct pb_message_map_t *next;       /*!< Next map index */
+  pb_tag_t tag;                        /*!< Tag of repeated submessage */
+  pb_tag_t key;                        /*!< Tag of key field */
+  pb_version_t version;                /*!< Version of offsets */
+  size_t revision;                     /*!< Revision of key values */
+  size_t size;                         /*!< Slot count */
+  size_t used;                         /*!< Used slot count */
+  pb_message_map_slot_t *slot;         /*!< Slots */
+} pb_message_map_t;
+
+typedef struct pb_message_canonical_t {
+  size_t pos;                          /*!< Position of last occurrence */
+  size_t count;                        /*!< Occurrence count */
+  uint64_t hash;                       /*!< Hash of values */
+  pb_part_t part;                      /*!< Part of last occurrence */
+} pb_message_canonical_t;
+
+typedef struct pb_message_span_t {
+  pb_tag_t tag;                        /*!< Tag */
+  size_t start;                        /*!< Start offset */
+  size_t length;                       /*!< Start offset of length prefix */
+  size_t header;                       /*!< Start offset of contents */
+  size_t end;                          /*!< End offset */
+} pb_message_span_t;
+
+/* ----------------------------------------------------------------------------
+ * Interface
+ * ------------------------------------------------------------------------- */
+
+PB_WARN_UNUSED_RESULT
+extern pb_error_t
+pb_message_index_case(
+  pb_message_t *message,               /* Message */
+  const pb_oneof_descriptor_t
+    *descriptor,                       /* Oneof descriptor */
+  pb_tag_t *tag,                       /* Tag of active member */
+  pb_part_t *part);                    /* Part of active member */
+
+PB_WARN_UNUSED_RESULT
+extern pb_error_t
+pb_message_erase_ranges(
+  pb_message_t *message,               /* Message */
+  const size_t ranges[],               /* Start and end offsets */
+  size_t size);                        /* Range count */
+
 /* ----------------------------------------------------------------------------
  * Inline functions
  * ------------------------------------------------------------------------- */
@@ -47,7 +108,9 @@ pb_message_t
 pb_message_create_invalid(void) {
   pb_message_t message = {
     .descriptor = NULL,
-    .part       = pb_part_create_invalid()
+    .part       = pb_part_create_invalid(),
+    .index      = NULL,
+    .map        = NULL
   };
   return message;
 }
@@ -55,6 +118,9 @@ pb_message_create_invalid(void) {
 /*!
  * Create a shallow copy of a message.
  *
+ * The field offset index and the key indexes are owned by the original
+ * message, so they are not shared with the copy.
+ *
  * \param[in] message Message
  * \return            Message copy
  */
@@ -62,7 +128,10 @@ PB_INLINE PB_WARN_UNUSED_RESULT
 pb_message_t
 pb_message_copy(const pb_message_t *message) {
   assert(message);
-  return *message;
+  pb_message_t copy = *message;
+  copy.index = NULL;
+  copy.map   = NULL;
+  return copy;
 }
 
 /*!
@@ -177,7 +246,7 @@ pb_message_empty(const pb_message_t *message) {
  * \return      Test result
  */
 PB_INLINE int
-pb_message_equals(const pb_message_t *x, const pb_message_t *y) {
+pb_message_same(const pb_message_t *x, const pb_message_t *y) {
   assert(x && y);
   return !memcmp(x, y, sizeof(pb_message_t));
 }
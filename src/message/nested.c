@@ -28,6 +28,7 @@
 #include "message/cursor.h"
 #include "message/message.h"
 #include "message/nested.h"
+#include "message/part.h"
 
 /* ----------------------------------------------------------------------------
  * Internal functions
@@ -82,6 +83,56 @@ resolve(pb_message_t *message, const pb_tag_t tags[], size_t size) {
   return cursor;
 }
 
+/*!
+ * Resolve the submessage of a path within a message, using the cached parts.
+ *
+ * The cached parts are revalidated by aligning them with the journal, which
+ * only needs to replay the changes since the last resolution. If the cached
+ * submessage was cleared, or the path is used with another message, the
+ * submessage is resolved again from scratch and the cache is updated.
+ *
+ * \param[in,out] message    Message
+ * \param[in,out] path       Path
+ * \param[out]    submessage Submessage
+ * \return                   Error code
+ */
+static pb_error_t
+resolve_path(
+    pb_message_t *message, pb_path_t *path, pb_message_t *submessage) {
+  assert(message && path && submessage);
+  if (unlikely_(!pb_message_valid(message) || pb_message_align(message)))
+    return PB_ERROR_INVALID;
+  assert(pb_message_descriptor(message) == path->descriptor);
+
+  /* Revalidate cached parts for the same journal and message */
+  pb_part_t *root = &(path->cache.root), *part = &(path->cache.part);
+  if (pb_part_valid(root) && pb_part_valid(part) &&
+      pb_part_journal(root) == pb_message_journal(message) &&
+      (pb_part_aligned(root) || !pb_part_align(root)) &&
+      (pb_part_aligned(part) || !pb_part_align(part)) &&
+      pb_part_start(root) == pb_message_start(message) &&
+      pb_part_end(root)   == pb_message_end(message)) {
+    *submessage = (pb_message_t){
+      .descriptor = path->nested,
+      .part       = pb_part_copy(part)
+    };
+    return PB_ERROR_NONE;
+  }
+
+  /* Otherwise resolve submessage and update cache */
+  pb_cursor_t cursor = resolve(message, path->tags, path->size - 1);
+  pb_error_t  error  = pb_cursor_error(&cursor);
+  if (likely_(!error)) {
+    *submessage = pb_message_create_from_cursor(&cursor);
+    if (likely_(!(error = pb_message_error(submessage)))) {
+      *root = pb_part_copy(pb_message_part(message));
+      *part = pb_part_copy(pb_message_part(submessage));
+    }
+  }
+  pb_cursor_destroy(&cursor);
+  return error;
+}
+
 /* ----------------------------------------------------------------------------
  * Interface
  * ------------------------------------------------------------------------- */
@@ -225,3 +276,189 @@ pb_message_nested_erase(
   pb_cursor_destroy(&cursor);
   return error;
 }
+
+/*!
+ * Create a path from a descriptor and a branch of tags.
+ *
+ * A path resolves the submessage containing the field of the last tag once
+ * and caches its offsets, so the nested messages are not scanned again for
+ * every access. All messages on the branch of tags except the leaf may not
+ * occur repeatedly, but must be defined as optional or required.
+ *
+ * \warning The path doesn't copy the tags, so the caller has to ensure that
+ * the tags outlive the path. Paths must not be shared between threads, as
+ * every access may update the cache.
+ *
+ * \param[in] descriptor Descriptor
+ * \param[in] tags[]     Tags
+ * \param[in] size       Tag count
+ * \return               Path
+ */
+extern pb_path_t
+pb_path_create(
+    const pb_descriptor_t *descriptor, const pb_tag_t tags[], size_t size) {
+  assert(descriptor && tags && size > 1);
+  pb_path_t path = {
+    .descriptor = descriptor,
+    .nested     = descriptor,
+    .tags       = tags,
+    .size       = size,
+    .cache      = {
+      .root = pb_part_create_invalid(),
+      .part = pb_part_create_invalid()
+    }
+  };
+
+  /* Resolve descriptor of submessage */
+  for (size_t t = 0; t < size - 1; ++t) {
+    const pb_field_descriptor_t *field =
+      pb_descriptor_field_by_tag(path.nested, tags[t]);
+    assert(field &&
+      pb_field_descriptor_type(field)  == PB_TYPE_MESSAGE &&
+      pb_field_descriptor_label(field) != PB_LABEL_REPEATED);
+    path.nested = pb_field_descriptor_nested(field);
+  }
+  assert(pb_descriptor_field_by_tag(path.nested, tags[size - 1]));
+  return path;
+}
+
+/*!
+ * Destroy a path.
+ *
+ * \param[in,out] path Path
+ */
+extern void
+pb_path_destroy(pb_path_t *path) {
+  assert(path);
+  pb_part_destroy(&(path->cache.root));
+  pb_part_destroy(&(path->cache.part));
+}
+
+/*!
+ * Test whether a nested message contains at least one field for a path.
+ *
+ * \param[in,out] message Message
+ * \param[in,out] path    Path
+ * \return                Test result
+ */
+extern int
+pb_message_path_has(pb_message_t *message, pb_path_t *path) {
+  assert(message && path);
+  int result = 0;
+
+  /* Resolve submessage using path */
+  pb_message_t submessage;
+  if (!resolve_path(message, path, &submessage)) {
+    result = pb_message_has(&submessage, path->tags[path->size - 1]);
+    pb_message_destroy(&submessage);
+  }
+  return result;
+}
+
+/*!
+ * Compare the value from a nested message for a path with the given value.
+ *
+ * \param[in,out] message Message
+ * \param[in,out] path    Path
+ * \param[in]     value   Pointer holding value
+ * \return                Test result
+ */
+extern int
+pb_message_path_match(
+    pb_message_t *message, pb_path_t *path, const void *value) {
+  assert(message && path && value);
+  int result = 0;
+
+  /* Resolve submessage using path */
+  pb_message_t submessage;
+  if (!resolve_path(message, path, &submessage)) {
+    result = pb_message_match(&submessage,
+      path->tags[path->size - 1], value);
+    pb_message_destroy(&submessage);
+  }
+  return result;
+}
+
+/*!
+ * Read the value from a nested message for a path.
+ *
+ * \param[in,out] message Message
+ * \param[in,out] path    Path
+ * \param[out]    value   Pointer receiving value
+ * \return                Error code
+ */
+extern pb_error_t
+pb_message_path_get(pb_message_t *message, pb_path_t *path, void *value) {
+  assert(message && path && value);
+
+  /* Resolve submessage using path */
+  pb_message_t submessage;
+  pb_error_t error = resolve_path(message, path, &submessage);
+  if (unlikely_(error)) {
+    if (error == PB_ERROR_EOM)
+      error = PB_ERROR_ABSENT;
+  } else {
+    error = pb_message_get(&submessage, path->tags[path->size - 1], value);
+    pb_message_destroy(&submessage);
+  }
+  return error;
+}
+
+/*!
+ * Write a value or submessage to a nested message for a path.
+ *
+ * If the submessage does not exist, it is created, as with the nested write.
+ *
+ * \param[in,out] message Message
+ * \param[in,out] path    Path
+ * \param[in]     value   Pointer holding value
+ * \return                Error code
+ */
+extern pb_error_t
+pb_message_path_put(
+    pb_message_t *message, pb_path_t *path, const void *value) {
+  assert(message && path && value);
+
+  /* Resolve submessage using path or create it */
+  pb_message_t submessage;
+  pb_error_t error = resolve_path(message, path, &submessage);
+  if (error == PB_ERROR_EOM) {
+    submessage = pb_message_create_nested(message,
+      path->tags, path->size - 1);
+    if (likely_(!(error = pb_message_error(&submessage)))) {
+      path->cache.root = pb_part_copy(pb_message_part(message));
+      path->cache.part = pb_part_copy(pb_message_part(&submessage));
+    } else {
+      pb_message_destroy(&submessage);
+    }
+  }
+
+  /* Write value to submessage */
+  if (likely_(!error)) {
+    error = pb_message_put(&submessage, path->tags[path->size - 1], value);
+    pb_message_destroy(&submessage);
+  }
+  return error;
+}
+
+/*!
+ * Erase a field or submessage from a nested message for a path.
+ *
+ * \param[in,out] message Message
+ * \param[in,out] path    Path
+ * \return                Error code
+ */
+extern pb_error_t
+pb_message_path_erase(pb_message_t *message, pb_path_t *path) {
+  assert(message && path);
+
+  pb_error_t error = PB_ERROR_INVALID;
+
+  /* Resolve submessage using path */
+  pb_message_t submessage;
+  if (!resolve_path(message, path, &submessage)) {
+    error = pb_message_erase(&submessage, path->tags[path->size - 1]);
+    pb_message_destroy(&submessage);
+  }
+  return error;
+}
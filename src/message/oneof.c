@@ -36,6 +36,9 @@
 /*!
  * Create a oneof from a descriptor and a message.
  *
+ * \warning A oneof does not take ownership of the provided message, so the
+ * caller must ensure that the message is not freed during operations.
+ *
  * \param[in]     descriptor Oneof descriptor
  * \param[in,out] message    Message
  * \return                   Oneof
@@ -46,6 +49,7 @@ pb_oneof_create(
   assert(descriptor && message);
   pb_oneof_t oneof = {
     .descriptor = descriptor,
+    .message    = message,
     .cursor     = pb_cursor_create_without_tag(message)
   };
   return oneof;
@@ -65,6 +69,10 @@ pb_oneof_destroy(pb_oneof_t *oneof) {
 /*!
  * Retrieve the active tag of a oneof.
  *
+ * If a field offset index is attached to the message, the active tag is
+ * determined by comparing the offsets of all members, and the index is only
+ * rebuilt when the message was altered. Otherwise the message is scanned.
+ *
  * \param[in,out] oneof Oneof
  * \return              Tag
  */
@@ -72,6 +80,17 @@ extern pb_tag_t
 pb_oneof_case(pb_oneof_t *oneof) {
   assert(oneof);
   pb_tag_t tag = 0;
+
+  /* Use field offset index of message, if attached */
+  if (oneof->message && oneof->message->index) {
+    pb_part_t part;
+    pb_error_t error = pb_message_index_case(
+      oneof->message, oneof->descriptor, &tag, &part);
+    if (error == PB_ERROR_NONE || error == PB_ERROR_EOM)
+      return error ? 0 : tag;
+  }
+
+  /* Otherwise scan message for last member */
   if (pb_cursor_rewind(&(oneof->cursor))) {
     do {
       const pb_field_descriptor_t *descriptor =
@@ -83,6 +102,61 @@ pb_oneof_case(pb_oneof_t *oneof) {
   return tag;
 }
 
+/*!
+ * Dispatch the active member of a oneof to the handler at its position.
+ *
+ * The message is scanned once for the last member of the oneof, and the
+ * handler at the position of the member within the oneof descriptor is
+ * invoked with a cursor pointing to it, so submessages can be created with
+ * pb_message_create_from_cursor() and values read with pb_cursor_get()
+ * without scanning the message again.
+ *
+ * \param[in,out] oneof      Oneof
+ * \param[in]     handlers[] Handlers by position
+ * \param[in,out] user       User data
+ * \return                   Error code
+ */
+extern pb_error_t
+pb_oneof_dispatch(
+    pb_oneof_t *oneof, const pb_oneof_handler_f handlers[], void *user) {
+  assert(oneof && handlers);
+  if (unlikely_(!pb_oneof_valid(oneof)))
+    return PB_ERROR_INVALID;
+
+  /* Scan message for last member */
+  pb_cursor_t active = pb_cursor_create_invalid();
+  if (pb_cursor_rewind(&(oneof->cursor))) {
+    do {
+      const pb_field_descriptor_t *descriptor =
+        pb_cursor_descriptor(&(oneof->cursor));
+      if (pb_field_descriptor_oneof(descriptor) == oneof->descriptor) {
+        pb_cursor_destroy(&active);
+        active = pb_cursor_copy(&(oneof->cursor));
+      }
+    } while (pb_cursor_next(&(oneof->cursor)));
+  }
+  if (unlikely_(!pb_oneof_valid(oneof))) {
+    pb_cursor_destroy(&active);
+    return pb_oneof_error(oneof);
+  }
+
+  /* Determine position of member and invoke handler */
+  pb_error_t error = PB_ERROR_ABSENT;
+  if (pb_cursor_valid(&active)) {
+    const pb_descriptor_t *descriptor = oneof->descriptor->descriptor;
+    size_t index = pb_cursor_descriptor(&active) - descriptor->field.data;
+    for (size_t p = 0; p < oneof->descriptor->index.size; p++) {
+      if (oneof->descriptor->index.data[p] == index) {
+        if (handlers[p])
+          error = handlers[p](&active, user);
+        break;
+      }
+    }
+  }
+  pb_cursor_destroy(&active);
+  return error;
+}
+
 /*!
  * Clear all members of a oneof.
  *
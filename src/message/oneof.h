@@ -42,6 +42,7 @@ pb_oneof_t
 pb_oneof_create_invalid(void) {
   pb_oneof_t oneof = {
     .descriptor = NULL,
+    .message    = NULL,
     .cursor     = pb_cursor_create_invalid()
   };
   return oneof;
@@ -27,6 +27,8 @@
 #include <string.h>
 
 #include "core/descriptor.h"
+#include "core/probe.h"
+#include "core/stats.h"
 #include "core/stream.h"
 #include "core/varint.h"
 #include "message/common.h"
@@ -53,8 +55,9 @@ adjust_prefix(pb_part_t *part, ptrdiff_t *delta) {
   assert(pb_part_valid(part) && pb_part_aligned(part));
 
   /* Write length prefix to buffer */
-  uint32_t length = pb_part_size(part);
-  uint8_t data[5]; size_t size = pb_varint_pack_uint32(data, &length);
+  uint8_t data[5];
+  size_t size =
+    pb_journal_pack_length(part->journal, data, pb_part_size(part));
 
   /* Write data to journal */
   pb_error_t error = pb_journal_write(part->journal,
@@ -112,13 +115,17 @@ adjust_prefix(pb_part_t *part, ptrdiff_t *delta) {
  * \param[in,out] part   Part
  * \param[in,out] stream Stream
  * \param[in,out] delta  Delta
+ * \param[in]     depth  Recursion depth
  * \return               Error code
  */
 static pb_error_t
-adjust_recursive(pb_part_t *part, pb_stream_t *stream, ptrdiff_t *delta) {
+adjust_recursive(
+    pb_part_t *part, pb_stream_t *stream, ptrdiff_t *delta, size_t depth) {
   assert(part && stream && delta && *delta);
   assert(pb_part_aligned(part));
   pb_error_t error = PB_ERROR_NONE;
+  pb_stats_add(adjustments, 1);
+  pb_probe3(part__adjust, part->journal, depth, *delta);
 
   /* Read from the stream until the end of the part */
   while (pb_stream_offset(stream) < part->offset.end) {
@@ -182,7 +189,7 @@ adjust_recursive(pb_part_t *part, pb_stream_t *stream, ptrdiff_t *delta) {
             temp.offset.end   != part->offset.end) {
           pb_stream_t substream = pb_stream_create_at(
             pb_stream_buffer(stream), temp.offset.start);
-          error = adjust_recursive(part, &substream, delta);
+          error = adjust_recursive(part, &substream, delta, depth + 1);
           pb_stream_destroy(&substream);
           if (unlikely_(error))
             break;                                         /* LCOV_EXCL_LINE */
@@ -229,13 +236,79 @@ adjust(pb_part_t *part, ptrdiff_t delta) {
   assert(part && delta);
   assert(pb_part_valid(part));
 
+  /* Fields of a top-level message are not contained in any length prefix */
+  if (part->offset.diff.tag &&
+      part->offset.start + part->offset.diff.origin == 0)
+    return PB_ERROR_NONE;
+
   /* Create stream and perform length prefix update */
   pb_stream_t stream = pb_stream_create(pb_journal_buffer(part->journal));
-  pb_error_t  error  = adjust_recursive(part, &stream, &delta);
+  pb_error_t  error  = adjust_recursive(part, &stream, &delta, 0);
   pb_stream_destroy(&stream);
   return error;
 }
 
+/*!
+ * Align the container message of the current batch of a journal.
+ *
+ * \param[in,out] journal Journal
+ * \param[out]    part    Container part
+ * \return                Error code
+ */
+static pb_error_t
+container(pb_journal_t *journal, pb_part_t *part) {
+  assert(journal && part);
+  pb_part_t temp = {
+    .journal = journal,
+    .version = journal->batch.version,
+    .offset  = journal->batch.offset
+  };
+  pb_error_t error = pb_journal_align(journal, &temp.version, &temp.offset);
+
+  /* Store aligned container */
+  journal->batch.version = temp.version;
+  journal->batch.offset  = temp.offset;
+  *part = temp;
+  return error;
+}
+
+/*!
+ * Prepare a write on a part with respect to the current batch.
+ *
+ * If the part is a field residing directly within the container message of
+ * the current batch, the length prefix update of the containing messages can
+ * be deferred. Otherwise, all pending updates are resolved to ensure correct
+ * offsets and length prefixes before writing, and the part is realigned.
+ *
+ * \param[in,out] part  Part
+ * \param[in]     field Part is a non-packed field
+ * \param[out]    defer Deferral flag
+ * \return              Error code
+ */
+static pb_error_t
+prepare(pb_part_t *part, int field, int *defer) {
+  assert(part && defer);
+  pb_journal_t *journal = part->journal;
+  *defer = 0;
+  if (likely_(!journal->batch.active))
+    return PB_ERROR_NONE;
+
+  /* Defer update, if the part is a field of the container */
+  pb_part_t temp;
+  if (field && !container(journal, &temp) &&
+      part->offset.start + part->offset.diff.origin == temp.offset.start) {
+    *defer = 1;
+    return PB_ERROR_NONE;
+  }
+
+  /* Otherwise resolve pending updates and realign part */
+  pb_error_t error = PB_ERROR_NONE;
+  if (journal->batch.delta && !(error = pb_part_flush(journal)))
+    if (!pb_part_aligned(part))
+      error = pb_part_align(part);
+  return error;
+}
+
 /*!
  * Initialize a part.
  *
@@ -252,6 +325,11 @@ init(pb_part_t *part, pb_wiretype_t wiretype, pb_tag_t tag) {
   assert(pb_part_aligned(part));
   do {
 
+    /* Check whether the update of parent messages can be deferred */
+    int defer;
+    if (unlikely_(prepare(part, 1, &defer)))
+      break;                                               /* LCOV_EXCL_LINE */
+
     /* Write tag to temporary buffer */
     uint32_t value = wiretype | (tag << 3);
     uint8_t data[10]; size_t size = pb_varint_pack_uint32(data, &value);
@@ -262,10 +340,8 @@ init(pb_part_t *part, pb_wiretype_t wiretype, pb_tag_t tag) {
                              + size;
 
     /* Write default length-prefix of zero for length-prefixed fields */
-    if (wiretype == PB_WIRETYPE_LENGTH) {
-      uint32_t length = 0;
-      size += pb_varint_pack_uint32(&(data[size]), &length);
-    }
+    if (wiretype == PB_WIRETYPE_LENGTH)
+      size += pb_journal_pack_length(part->journal, &(data[size]), 0);
 
     /* Write data to journal and update offsets */
     pb_error_t error = pb_journal_write(part->journal,
@@ -280,8 +356,12 @@ init(pb_part_t *part, pb_wiretype_t wiretype, pb_tag_t tag) {
       part->offset.diff.length -= part->offset.start;
 
       /* Recursive length prefix update of parent messages */
-      if (!adjust(part, size))
+      if (defer) {
+        part->journal->batch.delta += size;
+        return;
+      } else if (!adjust(part, size)) {
         return;
+      }
     }                                                      /* LCOV_EXCL_LINE */
   } while (0);                                             /* LCOV_EXCL_LINE */
 
@@ -321,6 +401,10 @@ init(pb_part_t *part, pb_wiretype_t wiretype, pb_tag_t tag) {
  * best matching offset, at which we would expect the part to reside. This is
  * just after the part with the previously smaller (or same) tag.
  *
+ * If the underlying journal is unordered, the best matching offset is always
+ * the end of the message, and occurrences of repeated fields that are not
+ * packed are appended right away without scanning the message at all.
+ *
  * There are a few possible scenarios to consider:
  *
  * -# The cursor is valid, the tag matches exactly and the message is not
@@ -352,7 +436,8 @@ extern pb_part_t
 pb_part_create(pb_message_t *message, pb_tag_t tag) {
   assert(message && tag);
   do {
-    if (!pb_message_valid(message) || pb_message_align(message))
+    if (!pb_message_valid(message) || pb_part_focus(&(message->part)) ||
+        pb_message_align(message))
       break;
 
     /* Assert descriptor */
@@ -360,12 +445,48 @@ pb_part_create(pb_message_t *message, pb_tag_t tag) {
       pb_descriptor_field_by_tag(pb_message_descriptor(message), tag);
     assert(descriptor);
 
+    /* Return active member of oneof from field offset index, if attached */
+    if (message->index &&
+        pb_field_descriptor_label(descriptor) == PB_LABEL_ONEOF) {
+      pb_tag_t active = 0;
+      pb_part_t part;
+      if (!pb_message_index_case(message,
+          pb_field_descriptor_oneof(descriptor), &active, &part) &&
+          active == tag)
+        return part;
+    }
+
+    /* Append occurrences of repeated fields right away, if unordered */
+    int unordered = pb_journal_unordered(pb_message_journal(message));
+    if (unordered &&
+        pb_field_descriptor_label(descriptor) == PB_LABEL_REPEATED &&
+        !pb_field_descriptor_packed(descriptor)) {
+      size_t end = pb_message_end(message);
+      pb_part_t part = {
+        .journal = pb_message_journal(message),
+        .version = pb_message_version(message),
+        .offset  = {
+          .start = end,
+          .end   = end,
+          .diff  = {
+            .origin = pb_message_start(message) - end,
+            .tag    = 0,
+            .length = 0
+          }
+        }
+      };
+      init(&part, pb_field_descriptor_wiretype(descriptor), tag);
+      return part;
+    }
+
     /* Determine exact or best matching field offset */
     pb_cursor_t cursor = pb_cursor_create_without_tag(message);
     pb_cursor_t temp   = pb_cursor_copy(&cursor);
     if (pb_cursor_valid(&temp)) {
       do {
-        if (pb_cursor_tag(&temp) <= tag) {
+        if (unordered
+            ? pb_cursor_tag(&temp) == tag
+            : pb_cursor_tag(&temp) <= tag) {
           pb_cursor_destroy(&cursor);
           cursor = pb_cursor_copy(&temp);
         }
@@ -408,8 +529,11 @@ pb_part_create(pb_message_t *message, pb_tag_t tag) {
 
         /* Otherwise correct insert vector in documented cases */
         const pb_offset_t *offset = pb_cursor_offset(&cursor);
-        if (pb_cursor_tag(&cursor) <= tag)
+        if (unordered && pb_cursor_tag(&cursor) != tag) {
+          start = pb_message_end(message);
+        } else if (pb_cursor_tag(&cursor) <= tag) {
           start = offset->end;
+        }
       }
 
       /* Create an empty part */
@@ -452,6 +576,58 @@ pb_part_create(pb_message_t *message, pb_tag_t tag) {
   return pb_part_create_invalid();
 }
 
+/*!
+ * Create a part for a repeated tag directly after another part.
+ *
+ * This resembles the creation of repeated parts in pb_part_create(), except
+ * that the insertion point is given by the part of the preceding element, so
+ * the message doesn't need to be scanned. For packed fields, the new part is
+ * created as a value within the packed field of the preceding element.
+ *
+ * \warning The caller must ensure that the given part is the last occurrence
+ * of the tag within the message, as the order of elements is not checked.
+ *
+ * \param[in,out] message Message
+ * \param[in]     tag     Tag
+ * \param[in,out] part    Part of preceding element
+ * \return                Part
+ */
+extern pb_part_t
+pb_part_create_after(pb_message_t *message, pb_tag_t tag, pb_part_t *part) {
+  assert(message && tag && part);
+  if (!pb_message_valid(message) || pb_part_focus(&(message->part)) ||
+      pb_message_align(message) || !pb_part_valid(part) ||
+      (!pb_part_aligned(part) && pb_part_align(part)))
+    return pb_part_create_invalid();
+
+  /* Assert repeated descriptor */
+  const pb_field_descriptor_t *descriptor =
+    pb_descriptor_field_by_tag(pb_message_descriptor(message), tag);
+  assert(descriptor &&
+    pb_field_descriptor_label(descriptor) == PB_LABEL_REPEATED);
+
+  /* Create an empty part after the preceding element */
+  size_t start = pb_part_end(part);
+  pb_part_t temp = {
+    .journal = pb_message_journal(message),
+    .version = pb_message_version(message),
+    .offset  = {
+      .start = start,
+      .end   = start,
+      .diff  = {
+        .origin = pb_message_start(message) - start,
+        .tag    = 0,
+        .length = 0
+      }
+    }
+  };
+
+  /* Values of packed fields don't need to be initialized */
+  if (!pb_field_descriptor_packed(descriptor))
+    init(&temp, pb_field_descriptor_wiretype(descriptor), tag);
+  return temp;
+}
+
 /*!
  * Create a part from a journal.
  *
@@ -464,7 +640,8 @@ pb_part_create(pb_message_t *message, pb_tag_t tag) {
 extern pb_part_t
 pb_part_create_from_journal(pb_journal_t *journal) {
   assert(journal);
-  if (pb_journal_valid(journal)) {
+  if (pb_journal_valid(journal) &&
+      pb_journal_size(journal) <= PB_OFFSET_MAX) {
     pb_part_t part = {
       .journal = journal,
       .version = pb_journal_version(journal),
@@ -532,6 +709,9 @@ pb_part_error(const pb_part_t *part) {
 /*!
  * Write data to a part.
  *
+ * Writing no data clears the contents of the part, but in contrast to
+ * pb_part_clear(), the part stays valid, i.e. tag and length prefix are kept.
+ *
  * \param[in,out] part   Part
  * \param[in]     data[] Raw data
  * \param[in]     size   Raw data size
@@ -539,15 +719,27 @@ pb_part_error(const pb_part_t *part) {
  */
 extern pb_error_t
 pb_part_write(pb_part_t *part, const uint8_t data[], size_t size) {
-  assert(part && data && size);
-  if (!pb_part_valid(part) || (!pb_part_aligned(part) && pb_part_align(part)))
+  assert(part && (data || !size));
+  if (!pb_part_valid(part) || pb_journal_frozen(part->journal))
+    return PB_ERROR_INVALID;
+  if (!pb_part_aligned(part) && pb_part_align(part))
     return PB_ERROR_INVALID;
 
+  /* Check whether the update of parent messages can be deferred */
+  int defer;
+  pb_error_t error = prepare(part, part->offset.diff.tag != 0, &defer);
+  if (unlikely_(error))
+    return error;                                          /* LCOV_EXCL_LINE */
+
   /* Write data to journal */
-  ptrdiff_t  delta = size - pb_part_size(part);
-  pb_error_t error = pb_journal_write(part->journal,
-    part->offset.start, part->offset.start,
-    part->offset.end, data, size);
+  ptrdiff_t delta = size - pb_part_size(part);
+  error = size
+    ? pb_journal_write(part->journal,
+        part->offset.start, part->offset.start,
+        part->offset.end, data, size)
+    : pb_journal_clear(part->journal,
+        part->offset.start, part->offset.start,
+        part->offset.end);
   if (likely_(!error)) {
 
     /* Update offsets if necessary */
@@ -558,8 +750,13 @@ pb_part_write(pb_part_t *part, const uint8_t data[], size_t size) {
       /* Recursive length prefix update of parent messages */
       if (part->offset.diff.length)
         error = adjust_prefix(part, &delta);
-      if (!error)
-        error = adjust(part, delta);
+      if (!error) {
+        if (defer) {
+          part->journal->batch.delta += delta;
+        } else {
+          error = adjust(part, delta);
+        }
+      }
 
       /* Ensure aligned part */
       if (!error && !pb_part_aligned(part))
@@ -569,6 +766,56 @@ pb_part_write(pb_part_t *part, const uint8_t data[], size_t size) {
   return error;
 }
 
+/*!
+ * Append data to the end of a part.
+ *
+ * In contrast to pb_part_write(), the current contents of the part are left
+ * untouched, so only the appended data is written to the journal. The part
+ * must either be length-prefixed, e.g. a message or packed field, or span
+ * the whole journal, as the data is placed within the part.
+ *
+ * \param[in,out] part   Part
+ * \param[in]     data[] Raw data
+ * \param[in]     size   Raw data size
+ * \return               Error code
+ */
+extern pb_error_t
+pb_part_append(pb_part_t *part, const uint8_t data[], size_t size) {
+  assert(part && data && size);
+  if (!pb_part_valid(part) || pb_journal_frozen(part->journal))
+    return PB_ERROR_INVALID;
+  if (!pb_part_aligned(part) && pb_part_align(part))
+    return PB_ERROR_INVALID;
+  assert(part->offset.diff.length ||
+    pb_part_size(part) == pb_journal_size(part->journal));
+
+  /* Resolve pending updates, as the part is not a field of the container */
+  int defer;
+  pb_error_t error = prepare(part, 0, &defer);
+  if (unlikely_(error))
+    return error;                                          /* LCOV_EXCL_LINE */
+
+  /* Write data to journal */
+  ptrdiff_t delta = size;
+  error = pb_journal_write(part->journal,
+    part->offset.start, part->offset.end,
+    part->offset.end, data, size);
+  if (likely_(!error)) {
+    part->version++;
+    part->offset.end += delta;
+
+    /* Recursive length prefix update of parent messages */
+    if (part->offset.diff.length &&
+        !(error = adjust_prefix(part, &delta)))
+      error = adjust(part, delta);
+
+    /* Ensure aligned part */
+    if (!error && !pb_part_aligned(part))
+      error = pb_part_align(part);
+  }
+  return error;
+}
+
 /*!
  * Clear data from a part and invalidate it.
  *
@@ -578,17 +825,25 @@ pb_part_write(pb_part_t *part, const uint8_t data[], size_t size) {
 extern pb_error_t
 pb_part_clear(pb_part_t *part) {
   assert(part);
-  if (!pb_part_valid(part) || (!pb_part_aligned(part) && pb_part_align(part)))
+  if (!pb_part_valid(part) || pb_journal_frozen(part->journal))
+    return PB_ERROR_INVALID;
+  if (!pb_part_aligned(part) && pb_part_align(part))
     return PB_ERROR_INVALID;
 
+  /* Resolve pending updates of the current batch */
+  int defer;
+  pb_error_t error = prepare(part, 0, &defer);
+  if (unlikely_(error))
+    return error;                                          /* LCOV_EXCL_LINE */
+
   /* Adjust origin for correct journaling of packed field */
   ptrdiff_t origin = part->offset.diff.tag
     ? part->offset.diff.origin
     : 0;
 
   /* Clear data from journal */
-  ptrdiff_t  delta = -(pb_part_size(part)) + part->offset.diff.tag;
-  pb_error_t error = pb_journal_clear(part->journal,
+  ptrdiff_t delta = -(pb_part_size(part)) + part->offset.diff.tag;
+  error = pb_journal_clear(part->journal,
     part->offset.start + origin,
     part->offset.start + part->offset.diff.tag,
     part->offset.end);
@@ -612,6 +867,70 @@ pb_part_clear(pb_part_t *part) {
   return error;
 }
 
+/*!
+ * Focus the current batch of a journal on the message underlying a part.
+ *
+ * Pending length prefix updates are resolved, if the message differs from the
+ * container message of the current batch. Thus, whenever a cursor switches
+ * messages, the length prefixes of all parent messages are consistent.
+ *
+ * \param[in] part Part
+ * \return         Error code
+ */
+extern pb_error_t
+pb_part_focus(const pb_part_t *part) {
+  assert(part);
+  if (!pb_part_valid(part) || likely_(!part->journal->batch.active))
+    return PB_ERROR_NONE;
+
+  /* Align a copy of the part to compare it with the container */
+  pb_journal_t *journal = part->journal;
+  pb_part_t temp = pb_part_copy(part), current;
+  int aligned = pb_part_aligned(&temp) || !pb_part_align(&temp);
+  pb_error_t error = PB_ERROR_NONE;
+  if (!aligned || container(journal, &current) ||
+      current.offset.start != temp.offset.start)
+    error = pb_part_flush(journal);
+
+  /* Set message as container of the current batch */
+  journal->batch.version = aligned ? temp.version : PB_VERSION_MAX;
+  journal->batch.offset  = temp.offset;
+  pb_part_destroy(&temp);
+  return error;
+}
+
+/*!
+ * Resolve the pending length prefix updates of the current batch.
+ *
+ * All updates that were deferred while writing to the container message of
+ * the current batch are applied at once, starting with the length prefix of
+ * the container message itself.
+ *
+ * \param[in,out] journal Journal
+ * \return                Error code
+ */
+extern pb_error_t
+pb_part_flush(pb_journal_t *journal) {
+  assert(journal);
+  pb_error_t error = PB_ERROR_NONE;
+  ptrdiff_t delta = journal->batch.delta;
+  if (delta) {
+    journal->batch.delta = 0;
+
+    /* Recursive length prefix update of container and parent messages */
+    pb_part_t part;
+    if (!(error = container(journal, &part)) && part.offset.diff.length) {
+      if (!(error = adjust_prefix(&part, &delta)) && delta)
+        error = adjust(&part, delta);
+
+      /* Store container after update */
+      journal->batch.version = part.version;
+      journal->batch.offset  = part.offset;
+    }
+  }
+  return error;
+}
+
 /* LCOV_EXCL_START >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>> */
 
 /*!
@@ -49,6 +49,13 @@ pb_part_create(
   pb_message_t *message,               /* Message */
   pb_tag_t tag);                       /* Tag */
 
+PB_WARN_UNUSED_RESULT
+extern pb_part_t
+pb_part_create_after(
+  pb_message_t *message,               /* Message */
+  pb_tag_t tag,                        /* Tag */
+  pb_part_t *part);                    /* Part of preceding element */
+
 PB_WARN_UNUSED_RESULT
 extern pb_part_t
 pb_part_create_from_journal(
@@ -70,16 +77,34 @@ pb_part_write(
   const uint8_t data[],                /* Raw data */
   size_t size);                        /* Raw data size */
 
+PB_WARN_UNUSED_RESULT
+extern pb_error_t
+pb_part_append(
+  pb_part_t *part,                     /* Part */
+  const uint8_t data[],                /* Raw data */
+  size_t size);                        /* Raw data size */
+
 PB_WARN_UNUSED_RESULT
 extern pb_error_t
 pb_part_clear(
   pb_part_t *part);                    /* Part */
 
+PB_WARN_UNUSED_RESULT
+extern pb_error_t
+pb_part_focus(
+  const pb_part_t *part);              /* Part */
+
+PB_WARN_UNUSED_RESULT
+extern pb_error_t
+pb_part_flush(
+  pb_journal_t *journal);              /* Journal */
+
 /* ----------------------------------------------------------------------------
  * Constants
  * ------------------------------------------------------------------------- */
 
-#define PB_PART_INVALID (1ULL << 63)   /*!< Invalidation marker */
+/*! Invalidation marker, the most significant bit of versions */
+#define PB_PART_INVALID (PB_VERSION_MAX ^ (PB_VERSION_MAX >> 1))
 
 /* ----------------------------------------------------------------------------
  * Inline functions
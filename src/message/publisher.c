@@ -0,0 +1,149 @@
+/*
+ * Copyright (c) 2013-2020 Martin Donath <martin.donath@squidfunk.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#include <assert.h>
+#include <stdlib.h>
+
+#include "message/common.h"
+#include "message/journal.h"
+#include "message/publisher.h"
+
+/* ----------------------------------------------------------------------------
+ * Internal functions
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Acquire the lock of a publisher.
+ *
+ * The lock is only held for swapping or referencing the current generation,
+ * so spinning is cheaper than sleeping.
+ *
+ * \param[in,out] publisher Publisher
+ */
+PB_INLINE void
+lock(pb_publisher_t *publisher) {
+  assert(publisher);
+  while (__atomic_test_and_set(&(publisher->lock), __ATOMIC_ACQUIRE));
+}
+
+/*!
+ * Release the lock of a publisher.
+ *
+ * \param[in,out] publisher Publisher
+ */
+PB_INLINE void
+unlock(pb_publisher_t *publisher) {
+  assert(publisher);
+  __atomic_clear(&(publisher->lock), __ATOMIC_RELEASE);
+}
+
+/* ----------------------------------------------------------------------------
+ * Interface
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Create a publisher.
+ *
+ * A publisher lets many threads read a journal while another thread writes to
+ * it. The writer publishes the state of the journal as a new generation after
+ * applying a set of updates, and readers acquire the current generation, which
+ * is an immutable snapshot that is not affected by subsequent writes. Readers
+ * must never access the journal of the writer itself.
+ *
+ * Publishing a generation does not copy the data, but the writer copies it
+ * upon its next write, so updates should be published in batches. Until the
+ * first generation is published, readers acquire an empty journal.
+ *
+ * \warning The publisher must not be moved while it is in use.
+ *
+ * \return Publisher
+ */
+extern pb_publisher_t
+pb_publisher_create(void) {
+  pb_publisher_t publisher = {
+    .current    = pb_journal_create_empty(),
+    .generation = 0,
+    .lock       = 0
+  };
+  return publisher;
+}
+
+/*!
+ * Destroy a publisher.
+ *
+ * Journals acquired from the publisher stay valid until they are destroyed.
+ *
+ * \param[in,out] publisher Publisher
+ */
+extern void
+pb_publisher_destroy(pb_publisher_t *publisher) {
+  assert(publisher);
+  pb_journal_destroy(&(publisher->current));
+}
+
+/*!
+ * Publish the state of a journal as the next generation.
+ *
+ * Readers that acquired the previous generation keep it until they destroy
+ * their journals, and the data of a generation is freed together with the
+ * last journal referring to it.
+ *
+ * \param[in,out] publisher Publisher
+ * \param[in,out] journal   Journal
+ * \return                  Error code
+ */
+extern pb_error_t
+pb_publisher_publish(pb_publisher_t *publisher, pb_journal_t *journal) {
+  assert(publisher && journal);
+  pb_journal_t snapshot = pb_journal_snapshot(journal);
+  if (unlikely_(!pb_journal_valid(&snapshot)))
+    return pb_journal_error(&snapshot);
+
+  /* Swap generations */
+  lock(publisher);
+  pb_journal_t previous = publisher->current;
+  publisher->current = snapshot;
+  __atomic_add_fetch(&(publisher->generation), 1, __ATOMIC_RELEASE);
+  unlock(publisher);
+
+  /* Release previous generation outside of lock */
+  pb_journal_destroy(&previous);
+  return PB_ERROR_NONE;
+}
+
+/*!
+ * Acquire the current generation of a publisher.
+ *
+ * The returned journal is a snapshot of the current generation and must be
+ * destroyed by the reader after use. It may be written to, in which case the
+ * reader copies the data, so other readers are not affected.
+ *
+ * \param[in,out] publisher Publisher
+ * \return                  Journal
+ */
+extern pb_journal_t
+pb_publisher_acquire(pb_publisher_t *publisher) {
+  assert(publisher);
+  lock(publisher);
+  pb_journal_t journal = pb_journal_snapshot(&(publisher->current));
+  unlock(publisher);
+  return journal;
+}
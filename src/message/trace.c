@@ -0,0 +1,494 @@
+/*
+ * Copyright (c) 2013-2020 Martin Donath <martin.donath@squidfunk.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "core/allocator.h"
+#include "core/buffer.h"
+#include "core/descriptor.h"
+#include "core/varint.h"
+#include "message/common.h"
+#include "message/cursor.h"
+#include "message/journal.h"
+#include "message/message.h"
+#include "message/part.h"
+#include "message/trace.h"
+
+/* ----------------------------------------------------------------------------
+ * Constants
+ * ------------------------------------------------------------------------- */
+
+/*! Maximum size of a record without value (15 varints of 10 bytes) */
+#define RECORD_SIZE 150
+
+/* ----------------------------------------------------------------------------
+ * Internal functions
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Append a variable-sized integer to a trace.
+ *
+ * \warning The caller has to ensure that enough space is reserved.
+ *
+ * \param[in,out] trace Trace
+ * \param[in]     value Value
+ */
+static void
+put(pb_trace_t *trace, uint64_t value) {
+  assert(trace);
+  uint8_t *data = pb_buffer_grow(&(trace->buffer),
+    pb_varint_size_uint64(&value));
+  assert(data);
+  pb_varint_pack_uint64(data, &value);
+}
+
+/*!
+ * Read a variable-sized integer from raw data.
+ *
+ * \param[in]     data[] Raw data
+ * \param[in]     size   Raw data size
+ * \param[in,out] offset Offset
+ * \param[out]    value  Value
+ * \return               Error code
+ */
+static pb_error_t
+get(const uint8_t data[], size_t size, size_t *offset, uint64_t *value) {
+  assert(data && offset && value);
+  size_t read = *offset < size
+    ? pb_varint_unpack_uint64(&(data[*offset]), size - *offset, value)
+    : 0;
+  if (unlikely_(!read))
+    return PB_ERROR_INVALID;
+  *offset += read;
+  return PB_ERROR_NONE;
+}
+
+/*!
+ * Read a zig-zag encoded relative offset from raw data.
+ *
+ * \param[in]     data[] Raw data
+ * \param[in]     size   Raw data size
+ * \param[in,out] offset Offset
+ * \param[out]    value  Relative offset
+ * \return               Error code
+ */
+static pb_error_t
+get_distance(
+    const uint8_t data[], size_t size, size_t *offset, pb_distance_t *value) {
+  assert(value);
+  uint64_t temp;
+  pb_error_t error = get(data, size, offset, &temp);
+  *value = (pb_distance_t)((int64_t)(temp >> 1) ^ -(int64_t)(temp & 1));
+  return error;
+}
+
+/*!
+ * Append a zig-zag encoded relative offset to a trace.
+ *
+ * \param[in,out] trace Trace
+ * \param[in]     value Relative offset
+ */
+static void
+put_distance(pb_trace_t *trace, pb_distance_t value) {
+  int64_t temp = value;
+  put(trace, (uint64_t)temp << 1 ^ (uint64_t)(temp < 0 ? -1 : 0));
+}
+
+/*!
+ * Start recording an operation, writing everything but its outcome.
+ *
+ * All space needed for the record, including its outcome, is reserved up
+ * front, so recording an operation either fails as a whole or not at all.
+ * Versions are recorded relative to the snapshot. If the part of the message
+ * is outdated, its version and offsets are recorded before alignment, so the
+ * replay can reproduce the alignment, unless the version predates the
+ * snapshot.
+ *
+ * \param[in,out] trace     Trace
+ * \param[in]     operation Operation
+ * \param[in]     journal   Journal
+ * \param[in]     message   Start offset of message
+ * \param[in]     tag       Tag
+ * \param[in]     field     Start offset of field or flags
+ * \param[in]     part      Part of message before alignment or NULL
+ * \param[in]     data[]    Raw data of value
+ * \param[in]     size      Raw data size
+ * \return                  Error code
+ */
+static pb_error_t
+begin(
+    pb_trace_t *trace, pb_trace_operation_t operation,
+    const pb_journal_t *journal, size_t message, pb_tag_t tag, size_t field,
+    const pb_part_t *part, const uint8_t data[], size_t size) {
+  assert(trace && !trace->active && journal);
+  if (unlikely_(pb_buffer_ensure(&(trace->buffer),
+      pb_buffer_size(&(trace->buffer)) + size + RECORD_SIZE)))
+    return trace->error = PB_ERROR_ALLOC;
+
+  /* Write operation, offsets and value */
+  put(trace, operation);
+  put(trace, message);
+  put(trace, tag);
+  put(trace, field);
+  put(trace, size);
+  if (size)
+    memcpy(pb_buffer_grow(&(trace->buffer), size), data, size);
+
+  /* Write journal version and lag of outdated part */
+  pb_version_t version = pb_journal_version(journal);
+  size_t lag = part && part->version >= trace->version &&
+               part->version < version
+    ? version - part->version
+    : 0;
+  put(trace, version - trace->version);
+  put(trace, lag);
+  if (lag) {
+    put(trace, part->offset.start);
+    put(trace, part->offset.end);
+    put_distance(trace, part->offset.diff.origin);
+    put_distance(trace, part->offset.diff.tag);
+    put_distance(trace, part->offset.diff.length);
+  }
+
+  /* Write journal size */
+  put(trace, pb_journal_size(journal));
+  trace->active = 1;
+  return PB_ERROR_NONE;
+}
+
+/*!
+ * Finish recording an operation, writing its outcome.
+ *
+ * \param[in,out] trace   Trace
+ * \param[in]     journal Journal
+ * \param[in]     error   Error code of operation
+ */
+static void
+end(pb_trace_t *trace, const pb_journal_t *journal, pb_error_t error) {
+  assert(trace && trace->active && journal);
+  put(trace, error);
+  put(trace, pb_journal_size(journal));
+  trace->active = 0;
+}
+
+/*!
+ * Start recording an operation with a value for a field.
+ *
+ * Values are recorded in their in-memory representation, except strings and
+ * bytes, which are recorded by their contents, and submessages, which are
+ * recorded by their raw data.
+ *
+ * \param[in,out] trace      Trace
+ * \param[in]     operation  Operation
+ * \param[in]     journal    Journal
+ * \param[in]     message    Start offset of message
+ * \param[in]     descriptor Field descriptor
+ * \param[in]     field      Start offset of field
+ * \param[in]     part       Part of message before alignment or NULL
+ * \param[in]     value      Pointer holding value or NULL
+ * \return                   Trace or NULL
+ */
+static pb_trace_t *
+begin_value(
+    pb_trace_t *trace, pb_trace_operation_t operation,
+    const pb_journal_t *journal, size_t message,
+    const pb_field_descriptor_t *descriptor, size_t field,
+    const pb_part_t *part, const void *value) {
+  assert(trace && journal && descriptor);
+  pb_error_t error = PB_ERROR_NONE;
+  pb_tag_t tag = pb_field_descriptor_tag(descriptor);
+  if (!value) {
+    error = begin(trace, operation, journal, message, tag, field, part,
+      NULL, 0);
+
+  /* Record contents of strings and bytes */
+  } else if (pb_field_descriptor_type(descriptor) == PB_TYPE_STRING ||
+             pb_field_descriptor_type(descriptor) == PB_TYPE_BYTES) {
+    error = begin(trace, operation, journal, message, tag, field, part,
+      pb_string_data(value), pb_string_size(value));
+
+  /* Record raw data of submessages */
+  } else if (pb_field_descriptor_type(descriptor) == PB_TYPE_MESSAGE) {
+    pb_message_t submessage = pb_message_copy(value);
+    if (pb_message_valid(&submessage) && !pb_message_align(&submessage)) {
+      error = begin(trace, operation, journal, message, tag, field, part,
+        pb_journal_data_from(pb_message_journal(&submessage),
+          pb_message_start(&submessage)), pb_message_size(&submessage));
+    } else {
+      error = begin(trace, operation, journal, message, tag, field, part,
+        NULL, 0);
+    }
+    pb_message_destroy(&submessage);
+
+  /* Record in-memory representation of all other values */
+  } else {
+    error = begin(trace, operation, journal, message, tag, field, part,
+      value, pb_field_descriptor_type_size(descriptor));
+  }
+  return !error ? trace : NULL;
+}
+
+/* ----------------------------------------------------------------------------
+ * Interface
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Create a trace.
+ *
+ * \return Trace
+ */
+extern pb_trace_t
+pb_trace_create(void) {
+  return pb_trace_create_with_allocator(&allocator_default);
+}
+
+/*!
+ * Create a trace using a custom allocator.
+ *
+ * A trace records the operations of the full runtime on a journal, so they
+ * can be replayed on a copy of the journal's original contents, e.g. to
+ * reproduce latencies outside of production. A trace is attached to a
+ * journal with pb_journal_set_trace(), and the recorded data can be written
+ * to a file as is.
+ *
+ * \warning A trace does not take ownership of the provided allocator, so the
+ * caller must ensure that the allocator is not freed during operations.
+ *
+ * \param[in,out] allocator Allocator
+ * \return                  Trace
+ */
+extern pb_trace_t
+pb_trace_create_with_allocator(pb_allocator_t *allocator) {
+  assert(allocator);
+  pb_trace_t trace = {
+    .buffer  = pb_buffer_create_empty_with_allocator(allocator),
+    .version = 0,
+    .size    = 0,
+    .active  = 0,
+    .error   = PB_ERROR_NONE
+  };
+  return trace;
+}
+
+/*!
+ * Destroy a trace.
+ *
+ * \warning The trace must be detached from all journals before.
+ *
+ * \param[in,out] trace Trace
+ */
+extern void
+pb_trace_destroy(pb_trace_t *trace) {
+  assert(trace);
+  pb_buffer_destroy(&(trace->buffer));
+}
+
+/*!
+ * Read the record at the given offset of the raw data of a trace.
+ *
+ * Every record consists of variable-sized integers for the operation, the
+ * start offset of the message, the tag, the start offset of the field or the
+ * flags of a snapshot, and the size of the value, which is followed by the
+ * raw data of the value, and variable-sized integers for the journal version
+ * before the operation and the number of versions the part of the message
+ * lagged behind. If it lagged behind, the outdated offsets of the part follow,
+ * relative offsets being zig-zag encoded. Finally, variable-sized integers for
+ * the journal size before the operation, the error code of the operation and
+ * the journal size after the operation conclude the record. Values of fields
+ * are recorded in the in-memory representation of the machine they were
+ * recorded on. If the part of the message did not lag behind, the version of
+ * the part equals the journal version.
+ *
+ * The offset is advanced to the next record. The value of the record points
+ * into the raw data, so it is only valid as long as the raw data is.
+ *
+ * \param[in]     data[] Raw data
+ * \param[in]     size   Raw data size
+ * \param[in,out] offset Offset of next record
+ * \param[out]    record Record
+ * \return               Error code
+ */
+extern pb_error_t
+pb_trace_read(
+    const uint8_t data[], size_t size, size_t *offset,
+    pb_trace_record_t *record) {
+  assert(offset && record);
+  if (unlikely_(*offset >= size))
+    return PB_ERROR_EOM;
+  assert(data);
+
+  /* Read operation, offsets and tag */
+  uint64_t value[10];
+  size_t   temp = *offset;
+  for (size_t v = 0; v < 5; ++v)
+    if (unlikely_(get(data, size, &temp, &(value[v]))))
+      return PB_ERROR_INVALID;
+  if (unlikely_(value[0] >= PB_TRACE_OPERATIONS ||
+                value[2] > UINT32_MAX || value[4] > size - temp))
+    return PB_ERROR_INVALID;
+
+  /* Skip value and read journal version and lag of outdated part */
+  const uint8_t *raw = &(data[temp]);
+  temp += value[4];
+  for (size_t v = 5; v < 7; ++v)
+    if (unlikely_(get(data, size, &temp, &(value[v]))))
+      return PB_ERROR_INVALID;
+  if (unlikely_(value[6] > value[5]))
+    return PB_ERROR_INVALID;
+
+  /* Read offsets of outdated part */
+  pb_offset_t part = {};
+  if (value[6]) {
+    uint64_t start, end;
+    if (unlikely_(get(data, size, &temp, &start) ||
+                  get(data, size, &temp, &end) ||
+                  get_distance(data, size, &temp, &(part.diff.origin)) ||
+                  get_distance(data, size, &temp, &(part.diff.tag)) ||
+                  get_distance(data, size, &temp, &(part.diff.length))))
+      return PB_ERROR_INVALID;
+    part.start = (pb_position_t)start;
+    part.end   = (pb_position_t)end;
+  }
+
+  /* Read outcome */
+  for (size_t v = 7; v < 10; ++v)
+    if (unlikely_(get(data, size, &temp, &(value[v]))))
+      return PB_ERROR_INVALID;
+
+  /* Fill record and advance offset */
+  record->operation    = (pb_trace_operation_t)value[0];
+  record->message      = value[1];
+  record->tag          = (pb_tag_t)value[2];
+  record->field        = value[3];
+  record->value.data   = raw;
+  record->value.size   = value[4];
+  record->version      = (pb_version_t)value[5];
+  record->part.version = (pb_version_t)(value[5] - value[6]);
+  record->part.offset  = part;
+  record->size.before  = value[7];
+  record->error        = (pb_error_t)value[8];
+  record->size.after   = value[9];
+  *offset = temp;
+  return PB_ERROR_NONE;
+}
+
+/* ------------------------------------------------------------------------- */
+
+/*!
+ * Record a snapshot of the contents of a journal.
+ *
+ * \param[in,out] trace   Trace
+ * \param[in,out] journal Journal
+ * \return                Error code
+ */
+extern pb_error_t
+pb_trace_snapshot(pb_trace_t *trace, pb_journal_t *journal) {
+  assert(trace && journal);
+  size_t flags = (journal->padded    ? PB_TRACE_PADDED     : 0) |
+                 (journal->unordered ? PB_TRACE_UNORDERED  : 0) |
+                 (journal->gap.enabled ? PB_TRACE_GAP_BUFFER : 0);
+  size_t size = pb_journal_size(journal);
+  trace->version = pb_journal_version(journal);
+  pb_error_t error = begin(trace, PB_TRACE_SNAPSHOT, journal, 0, 0, flags,
+    NULL, size ? pb_journal_data(journal) : NULL, size);
+  if (likely_(!error))
+    end(trace, journal, PB_ERROR_NONE);
+  return error;
+}
+
+/*!
+ * Start recording an operation on a message.
+ *
+ * The message is aligned first, as its start offset identifies it in the
+ * trace, but its part is recorded as it was before, so the alignment can be
+ * reproduced. If no tag is given, the operation is recorded without tag and
+ * value.
+ *
+ * \param[in,out] trace     Trace
+ * \param[in]     operation Operation
+ * \param[in,out] message   Message
+ * \param[in]     tag       Tag
+ * \param[in]     value     Pointer holding value or NULL
+ * \return                  Trace or NULL
+ */
+extern pb_trace_t *
+pb_trace_begin(
+    pb_trace_t *trace, pb_trace_operation_t operation,
+    pb_message_t *message, pb_tag_t tag, const void *value) {
+  assert(trace && message);
+  pb_part_t part = message->part;
+  if (unlikely_(!pb_message_valid(message) || pb_message_align(message)))
+    return NULL;
+
+  /* Record operation without tag, e.g. for clearing a message */
+  pb_journal_t *journal = pb_message_journal(message);
+  if (!tag)
+    return !begin(trace, operation, journal,
+      pb_message_start(message), 0, 0, &part, NULL, 0) ? trace : NULL;
+
+  /* Record operation with tag and value */
+  return begin_value(trace, operation, journal, pb_message_start(message),
+    pb_descriptor_field_by_tag(pb_message_descriptor(message), tag), 0,
+      &part, value);
+}
+
+/*!
+ * Start recording an operation on the current field of a cursor.
+ *
+ * The cursor is aligned first, as the start offsets of its message and its
+ * current field identify the field in the trace. The alignment of cursors is
+ * not reproduced.
+ *
+ * \param[in,out] trace     Trace
+ * \param[in]     operation Operation
+ * \param[in,out] cursor    Cursor
+ * \param[in]     value     Pointer holding value or NULL
+ * \return                  Trace or NULL
+ */
+extern pb_trace_t *
+pb_trace_begin_cursor(
+    pb_trace_t *trace, pb_trace_operation_t operation,
+    pb_cursor_t *cursor, const void *value) {
+  assert(trace && cursor);
+  if (unlikely_(!pb_cursor_valid(cursor) || pb_cursor_align(cursor)))
+    return NULL;
+  return begin_value(trace, operation, pb_cursor_journal(cursor),
+    pb_message_start(&(cursor->message)), pb_cursor_descriptor(cursor),
+      pb_cursor_offset(cursor)->start, NULL, value);
+}
+
+/*!
+ * Finish recording an operation, writing its outcome.
+ *
+ * \param[in,out] trace   Trace
+ * \param[in]     journal Journal
+ * \param[in]     error   Error code of operation
+ */
+extern void
+pb_trace_end(pb_trace_t *trace, const pb_journal_t *journal, pb_error_t error) {
+  assert(trace && journal);
+  end(trace, journal, error);
+  trace->size++;
+}
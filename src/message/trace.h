@@ -0,0 +1,90 @@
+/*
+ * Copyright (c) 2013-2020 Martin Donath <martin.donath@squidfunk.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef PB_MESSAGE_TRACE_H
+#define PB_MESSAGE_TRACE_H
+
+#include <assert.h>
+
+#include <protobluff/message/trace.h>
+
+#include "message/common.h"
+#include "message/cursor.h"
+#include "message/journal.h"
+#include "message/message.h"
+
+/* ----------------------------------------------------------------------------
+ * Interface
+ * ------------------------------------------------------------------------- */
+
+PB_WARN_UNUSED_RESULT
+extern pb_error_t
+pb_trace_snapshot(
+  pb_trace_t *trace,                   /* Trace */
+  pb_journal_t *journal);              /* Journal */
+
+PB_WARN_UNUSED_RESULT
+extern pb_trace_t *
+pb_trace_begin(
+  pb_trace_t *trace,                   /* Trace */
+  pb_trace_operation_t operation,      /* Operation */
+  pb_message_t *message,               /* Message */
+  pb_tag_t tag,                        /* Tag */
+  const void *value);                  /* Pointer holding value or NULL */
+
+PB_WARN_UNUSED_RESULT
+extern pb_trace_t *
+pb_trace_begin_cursor(
+  pb_trace_t *trace,                   /* Trace */
+  pb_trace_operation_t operation,      /* Operation */
+  pb_cursor_t *cursor,                 /* Cursor */
+  const void *value);                  /* Pointer holding value or NULL */
+
+extern void
+pb_trace_end(
+  pb_trace_t *trace,                   /* Trace */
+  const pb_journal_t *journal,         /* Journal */
+  pb_error_t error);                   /* Error code of operation */
+
+/* ----------------------------------------------------------------------------
+ * Inline functions
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Retrieve the trace of a journal, if an operation may be recorded.
+ *
+ * No trace is returned while another operation is being recorded, so only the
+ * outermost operation is recorded, or after recording failed.
+ *
+ * \param[in] journal Journal
+ * \return            Trace or NULL
+ */
+PB_INLINE pb_trace_t *
+pb_trace_from(const pb_journal_t *journal) {
+  assert(journal);
+  pb_trace_t *trace = journal->trace;
+  return trace && !trace->active && pb_trace_valid(trace)
+    ? trace
+    : NULL;
+}
+
+#endif /* PB_MESSAGE_TRACE_H */
@@ -0,0 +1,292 @@
+/*
+ * Copyright (c) 2013-2020 Martin Donath <martin.donath@squidfunk.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "core/allocator.h"
+#include "core/common.h"
+#include "util/arena_allocator.h"
+
+/* ----------------------------------------------------------------------------
+ * Constants
+ * ------------------------------------------------------------------------- */
+
+/*! Alignment of memory blocks */
+#define PB_ARENA_ALLOCATOR_ALIGNMENT 16
+
+/* ----------------------------------------------------------------------------
+ * Type definitions
+ * ------------------------------------------------------------------------- */
+
+typedef struct pb_arena_region_t {
+  struct pb_arena_region_t *next;      /*!< Next linked region */
+  size_t capacity;                     /*!< Capacity */
+  size_t used;                         /*!< Used bytes */
+} pb_arena_region_t;
+
+typedef struct pb_arena_header_t {
+  size_t size;                         /*!< Block size */
+} pb_arena_header_t;
+
+typedef struct pb_arena_allocator_t {
+  pb_arena_region_t *head;             /*!< Current region */
+  void *last;                          /*!< Most recently allocated block */
+  size_t capacity;                     /*!< Minimum region capacity */
+} pb_arena_allocator_t;
+
+/* ----------------------------------------------------------------------------
+ * Macros
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Round a size up to the alignment of memory blocks.
+ *
+ * \param[in] size Size
+ * \return         Aligned size
+ */
+#define align(size) \
+  (((size) + PB_ARENA_ALLOCATOR_ALIGNMENT - 1) & \
+    ~((size_t)PB_ARENA_ALLOCATOR_ALIGNMENT - 1))
+
+/*!
+ * Size of the (aligned) headers of regions and memory blocks.
+ */
+#define region_header align(sizeof(pb_arena_region_t))
+#define block_header  align(sizeof(pb_arena_header_t))
+
+/*!
+ * Retrieve the header of a memory block.
+ *
+ * \param[in] block Memory block
+ * \return          Header
+ */
+#define header_from_block(block) \
+  (assert(block), (pb_arena_header_t *)((uint8_t *)(block) - block_header))
+
+/* ----------------------------------------------------------------------------
+ * Internal functions
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Allocate a region of given capacity and link it as the current region.
+ *
+ * \param[in,out] base     Arena allocator
+ * \param[in]     capacity Capacity
+ * \return                 Region
+ */
+static pb_arena_region_t *
+region_create(pb_arena_allocator_t *base, size_t capacity) {
+  assert(base && capacity);
+  pb_arena_region_t *region = malloc(region_header + capacity);
+  if (unlikely_(!region))
+    return NULL;                                           /* LCOV_EXCL_LINE */
+  *region = (pb_arena_region_t){
+    .next     = base->head,
+    .capacity = capacity,
+    .used     = 0
+  };
+  base->head = region;
+  return region;
+}
+
+/* ----------------------------------------------------------------------------
+ * Allocator callbacks
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Allocate a memory block of given size.
+ *
+ * Memory blocks are carved out of the current region by bumping a pointer.
+ * If the current region is exhausted, a new region is allocated, which is at
+ * least as large as the minimum capacity. Every block is preceded by a small
+ * header holding its size, so it can be copied when resized.
+ *
+ * \param[in,out] data Internal allocator data
+ * \param[in]     size Bytes to be allocated
+ * \return             Memory block
+ */
+static void *
+allocator_allocate(void *data, size_t size) {
+  assert(size);
+  if (unlikely_(!data))
+    return NULL;
+
+  /* Allocate a new region, if the current one is exhausted */
+  pb_arena_allocator_t *base = data;
+  size_t need = block_header + align(size);
+  pb_arena_region_t *region = base->head;
+  if (unlikely_(!region || region->capacity - region->used < need))
+    if (!(region = region_create(base,
+        need > base->capacity ? need : base->capacity)))
+      return NULL;                                         /* LCOV_EXCL_LINE */
+
+  /* Bump pointer and initialize header */
+  uint8_t *block = (uint8_t *)region + region_header + region->used;
+  ((pb_arena_header_t *)block)->size = size;
+  region->used += need;
+
+  /* Return freshly allocated block */
+  return base->last = block + block_header;
+}
+
+/*!
+ * Change the size of a previously allocated memory block.
+ *
+ * If the block is the most recently allocated one and the current region has
+ * enough room left, the block is resized in place. Otherwise, a new block is
+ * allocated and the contents are copied, leaving the old block in the arena.
+ *
+ * \param[in,out] data  Internal allocator data
+ * \param[in,out] block Memory block to be resized
+ * \param[in]     size  Bytes to be allocated
+ * \return              Memory block
+ */
+static void *
+allocator_resize(void *data, void *block, size_t size) {
+  assert(size);
+  if (unlikely_(!data))
+    return NULL;
+  if (unlikely_(!block))
+    return allocator_allocate(data, size);
+
+  /* Resize most recently allocated block in place, if possible */
+  pb_arena_allocator_t *base   = data;
+  pb_arena_header_t    *header = header_from_block(block);
+  if (block == base->last) {
+    pb_arena_region_t *region = base->head;
+    size_t offset = (uint8_t *)block - ((uint8_t *)region + region_header);
+    if (offset + align(size) <= region->capacity) {
+      region->used = offset + align(size);
+      header->size = size;
+      return block;
+    }
+
+  /* Shrinking a block never needs to move it */
+  } else if (size <= header->size) {
+    return block;
+  }
+
+  /* Allocate a new block and copy contents */
+  size_t copy = header->size < size ? header->size : size;
+  void *target = allocator_allocate(data, size);
+  if (likely_(target != NULL))
+    memcpy(target, block, copy);
+  return target;
+}
+
+/*!
+ * Free an allocated memory block.
+ *
+ * Memory blocks are not freed individually, but reclaimed all at once when
+ * the arena is reset or destroyed, so this is a no-op.
+ *
+ * \param[in,out] data  Internal allocator data
+ * \param[in,out] block Memory block to be freed
+ */
+static void
+allocator_free(void *data, void *block) {
+  assert(block); /* Nothing to be done */
+}
+
+/* ----------------------------------------------------------------------------
+ * Interface
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Create an arena allocator with a minimum region capacity.
+ *
+ * \param[in] capacity Capacity
+ * \return             Arena allocator
+ */
+extern pb_allocator_t
+pb_arena_allocator_create(size_t capacity) {
+  assert(capacity);
+  pb_allocator_t allocator = {
+    .proc = {
+      .allocate = allocator_allocate,
+      .resize   = allocator_resize,
+      .free     = allocator_free
+    },
+    .data = NULL
+  };
+  pb_arena_allocator_t *base = malloc(sizeof(pb_arena_allocator_t));
+  if (base) {
+    *base = (pb_arena_allocator_t){
+      .head     = NULL,
+      .last     = NULL,
+      .capacity = align(capacity)
+    };
+    if (region_create(base, base->capacity)) {
+      allocator.data = base;
+    } else {
+      free(base);                                          /* LCOV_EXCL_LINE */
+    }
+  }
+  return allocator;
+}
+
+/*!
+ * Destroy an arena allocator.
+ *
+ * All memory blocks that are still allocated are freed upon destruction.
+ *
+ * \param[in,out] allocator Arena allocator
+ */
+extern void
+pb_arena_allocator_destroy(pb_allocator_t *allocator) {
+  assert(allocator);
+  pb_arena_allocator_t *base = allocator->data;
+  if (base) {
+    pb_arena_region_t *region;
+    while ((region = base->head)) {
+      base->head = region->next;
+      free(region);
+    }
+    free(base);
+  }
+}
+
+/*!
+ * Reset an arena allocator, reclaiming all memory blocks at once.
+ *
+ * The current region is kept for reuse, all other regions are freed. Memory
+ * blocks that were allocated before must not be used anymore.
+ *
+ * \param[in,out] allocator Arena allocator
+ */
+extern void
+pb_arena_allocator_reset(pb_allocator_t *allocator) {
+  assert(allocator);
+  pb_arena_allocator_t *base = allocator->data;
+  if (base) {
+    pb_arena_region_t *region;
+    while ((region = base->head->next)) {
+      base->head->next = region->next;
+      free(region);
+    }
+    base->head->used = 0;
+    base->last = NULL;
+  }
+}
@@ -28,13 +28,31 @@
 #include "core/common.h"
 #include "util/chunk_allocator.h"
 
+/* ----------------------------------------------------------------------------
+ * Constants
+ * ------------------------------------------------------------------------- */
+
+/*! Number of size classes for which freed chunks are kept for reuse */
+#ifndef PB_CHUNK_ALLOCATOR_CLASSES
+#define PB_CHUNK_ALLOCATOR_CLASSES 8
+#endif /* PB_CHUNK_ALLOCATOR_CLASSES */
+
 /* ----------------------------------------------------------------------------
  * Type definitions
  * ------------------------------------------------------------------------- */
 
-typedef struct pb_chunk_allocator_t {
-  struct pb_chunk_allocator_t *next;   /*!< Next linked chunk */
+typedef struct pb_chunk_t {
+  struct pb_chunk_t *prev;             /*!< Previous linked chunk */
+  struct pb_chunk_t *next;             /*!< Next linked chunk */
   size_t capacity;                     /*!< Capacity */
+} pb_chunk_t;
+
+typedef struct pb_chunk_allocator_t {
+  pb_chunk_t head;                     /*!< Sentinel of chunk list */
+  pb_chunk_t *free[                    /*!< Free lists by size class */
+    PB_CHUNK_ALLOCATOR_CLASSES];
+  size_t capacity;                     /*!< Minimum capacity */
+  pb_chunk_allocator_stats_t stats;    /*!< Statistics */
 } pb_chunk_allocator_t;
 
 /* ----------------------------------------------------------------------------
@@ -49,7 +67,7 @@ typedef struct pb_chunk_allocator_t {
  */
 #define block_from_chunk(chunk) \
   (assert(chunk), (void *)((uint8_t *)(chunk) + \
-    sizeof(pb_chunk_allocator_t)))
+    sizeof(pb_chunk_t)))
 
 /*!
  * Retrieve the allocated chunk for a memory block.
@@ -58,8 +76,44 @@ typedef struct pb_chunk_allocator_t {
  * \return          Allocated chunk
  */
 #define chunk_from_block(block) \
-  (assert(block), (void *)((uint8_t *)(block) - \
-    sizeof(pb_chunk_allocator_t)))
+  (assert(block), (pb_chunk_t *)((uint8_t *)(block) - \
+    sizeof(pb_chunk_t)))
+
+/* ----------------------------------------------------------------------------
+ * Internal functions
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Link a chunk at the end of the chunk list.
+ *
+ * \param[in,out] base  Chunk allocator
+ * \param[in,out] chunk Chunk
+ */
+static void
+chunk_link(pb_chunk_allocator_t *base, pb_chunk_t *chunk) {
+  assert(base && chunk);
+  chunk->prev = base->head.prev;
+  chunk->next = &(base->head);
+  base->head.prev->next = chunk;
+  base->head.prev       = chunk;
+  base->stats.chunks++;
+  base->stats.bytes += chunk->capacity;
+}
+
+/*!
+ * Unlink a chunk from the chunk list.
+ *
+ * \param[in,out] base  Chunk allocator
+ * \param[in,out] chunk Chunk
+ */
+static void
+chunk_unlink(pb_chunk_allocator_t *base, pb_chunk_t *chunk) {
+  assert(base && chunk);
+  chunk->prev->next = chunk->next;
+  chunk->next->prev = chunk->prev;
+  base->stats.chunks--;
+  base->stats.bytes -= chunk->capacity;
+}
 
 /* ----------------------------------------------------------------------------
  * Allocator callbacks
@@ -73,10 +127,10 @@ typedef struct pb_chunk_allocator_t {
  * the corresponding chunk's capacity, the same block is returned. Otherwise,
  * the chunk is doubled in size to make room for more growth.
  *
- * Chunks are managed through a linked list. New chunks are always appended to
- * the end of the list. If a chunk is freed, it is removed from the list and
- * its predecessor and successor are linked. The first chunk does not store
- * any data, it just holds the initial capacity and the head of the list.
+ * Chunks are managed through a circular doubly linked list with a sentinel,
+ * so chunks can be appended and unlinked in constant time. Capacities are
+ * multiples of the minimum capacity, and freed chunks of the smallest size
+ * classes are kept in free lists, from which they are reused.
  *
  * \warning The lines excluded from code coverage cannot be triggered within
  * the tests, as we're not going to mock malloc. Nope. No chance.
@@ -91,31 +145,30 @@ allocator_allocate(void *data, size_t size) {
   if (unlikely_(!data))
     return NULL;
 
-  /* Search to end of chunk list */
+  /* Calculate size class and necessary capacity */
   pb_chunk_allocator_t *base = data;
-  pb_chunk_allocator_t *head = data;
-  while (head->next)
-    head = head->next;
-
-  /* Calculate necessary capacity */
-  size_t capacity = base->capacity * (size / base->capacity + 1);
-
-  /* Allocate chunk and link in predecessor */
-  pb_chunk_allocator_t *chunk = malloc(
-    sizeof(pb_chunk_allocator_t) + capacity);
-  if (chunk) {
-    *chunk = (pb_chunk_allocator_t){
-      .next     = NULL,
-      .capacity = capacity
-    };
-    head->next = chunk;
-
-    /* Return freshly allocated block */
-    return block_from_chunk(head->next);
+  size_t class    = size / base->capacity;
+  size_t capacity = base->capacity * (class + 1);
+
+  /* Reuse chunk from free list of size class, if available */
+  pb_chunk_t *chunk = NULL;
+  if (class < PB_CHUNK_ALLOCATOR_CLASSES && base->free[class]) {
+    chunk = base->free[class];
+    base->free[class] = chunk->next;
+    base->stats.cached--;
+
+  /* Allocate chunk */
+  } else {
+    chunk = malloc(sizeof(pb_chunk_t) + capacity);
+    if (unlikely_(!chunk))
+      return NULL;                                         /* LCOV_EXCL_LINE */
+    chunk->capacity = capacity;
   }
 
-  /* It's not for you, mate */
-  return NULL;                                             /* LCOV_EXCL_LINE */
+  /* Link chunk and return block */
+  chunk_link(base, chunk);
+  base->stats.allocations++;
+  return block_from_chunk(chunk);
 }
 
 /*!
@@ -137,29 +190,30 @@ allocator_resize(void *data, void *block, size_t size) {
 
   /* Change size of given memory block */
   if (likely_(block != NULL)) {
-    pb_chunk_allocator_t *current = chunk_from_block(block);
+    pb_chunk_t *current = chunk_from_block(block);
 
     /* Check if chunk's capacity is exhausted */
     if (unlikely_(size > current->capacity)) {
       pb_chunk_allocator_t *base = data;
-      pb_chunk_allocator_t *head = data;
-      while (head->next && head->next != current)
-        head = head->next;
 
       /* Calculate new capacity */
       size_t capacity = base->capacity * (size / base->capacity + 1);
 
-      /* Grow chunk and link in predecessor */
-      pb_chunk_allocator_t *chunk = realloc(head->next,
-        sizeof(pb_chunk_allocator_t) + capacity);
+      /* Grow chunk and link it in place of the current chunk */
+      pb_chunk_t *prev = current->prev;
+      pb_chunk_t *chunk = realloc(current, sizeof(pb_chunk_t) + capacity);
       if (chunk) {
-        head->next = chunk;
-        head->next->capacity = capacity;
+        base->stats.bytes += capacity - chunk->capacity;
+        chunk->capacity = capacity;
+        chunk->prev = prev;
+        chunk->prev->next = chunk;
+        chunk->next->prev = chunk;
 
         /* Return resized block */
-        return block_from_chunk(head->next);
+        return block_from_chunk(chunk);
       }
-    }                                                      /* LCOV_EXCL_LINE */
+      return NULL;                                         /* LCOV_EXCL_LINE */
+    }
 
   /* Allocate new block */
   } else {
@@ -182,15 +236,20 @@ allocator_free(void *data, void *block) {
   if (unlikely_(!data))
     return;
 
-  /* Search current chunk in chunk list */
-  pb_chunk_allocator_t *head    = data;
-  pb_chunk_allocator_t *current = chunk_from_block(block);
-  while (head->next && head->next != current)
-    head = head->next;
+  /* Unlink current chunk */
+  pb_chunk_allocator_t *base    = data;
+  pb_chunk_t           *current = chunk_from_block(block);
+  chunk_unlink(base, current);
 
-  /* Link predecessor and successor and free current chunk */
-  head->next = current->next;
-  free(current);
+  /* Put chunk into free list of its size class or free it */
+  size_t class = current->capacity / base->capacity - 1;
+  if (class < PB_CHUNK_ALLOCATOR_CLASSES) {
+    current->next = base->free[class];
+    base->free[class] = current;
+    base->stats.cached++;
+  } else {
+    free(current);
+  }
 }
 
 /* ----------------------------------------------------------------------------
@@ -224,13 +283,12 @@ pb_chunk_allocator_create_with_capacity(size_t capacity) {
     },
     .data = NULL
   };
-  pb_chunk_allocator_t *base = malloc(sizeof(pb_chunk_allocator_t));
+  pb_chunk_allocator_t *base = calloc(1, sizeof(pb_chunk_allocator_t));
   if (base) {
-    *base = (pb_chunk_allocator_t){
-      .next     = NULL,
-      .capacity = capacity
-    };
-    allocator.data = base;
+    base->head.prev = &(base->head);
+    base->head.next = &(base->head);
+    base->capacity  = capacity;
+    allocator.data  = base;
   }
   return allocator;
 }
@@ -248,11 +306,32 @@ pb_chunk_allocator_destroy(pb_allocator_t *allocator) {
   assert(allocator);
   pb_chunk_allocator_t *base = allocator->data;
   if (base) {
-    pb_chunk_allocator_t *head;
-    while ((head = base->next) && base->next) {
-      base->next = base->next->next;
+    pb_chunk_t *head;
+    while ((head = base->head.next) != &(base->head)) {
+      base->head.next = head->next;
       free(head);
     }
+    for (size_t c = 0; c < PB_CHUNK_ALLOCATOR_CLASSES; c++) {
+      while ((head = base->free[c])) {
+        base->free[c] = head->next;
+        free(head);
+      }
+    }
     free(base);
   }
 }
+
+/*!
+ * Retrieve statistics of a chunk allocator.
+ *
+ * \param[in] allocator Chunk allocator
+ * \return              Statistics
+ */
+extern pb_chunk_allocator_stats_t
+pb_chunk_allocator_stats(const pb_allocator_t *allocator) {
+  assert(allocator);
+  const pb_chunk_allocator_t *base = allocator->data;
+  if (unlikely_(!base))
+    return (pb_chunk_allocator_stats_t){ 0 };
+  return base->stats;
+}
@@ -0,0 +1,520 @@
+/*
+ * Copyright (c) 2013-2020 Martin Donath <martin.donath@squidfunk.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <assert.h>
+#include <errno.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/uio.h>
+
+#include "core/buffer.h"
+#include "core/common.h"
+#include "core/delimited.h"
+#include "core/varint.h"
+#include "util/delimited_block.h"
+
+/* ----------------------------------------------------------------------------
+ * Constants
+ * ------------------------------------------------------------------------- */
+
+/*! Magic number identifying block-compressed files */
+#define PB_DELIMITED_BLOCK_MAGIC 0x31304B4C42425070ULL
+
+/*! Size of the header of a block */
+#define PB_DELIMITED_BLOCK_HEADER 17
+
+/*! Size of an entry of the block index */
+#define PB_DELIMITED_BLOCK_ENTRY 16
+
+/*! Size of the trailer of block-compressed files */
+#define PB_DELIMITED_BLOCK_TRAILER 32
+
+/*! Method of stored blocks */
+#define PB_DELIMITED_BLOCK_STORED 0
+
+/*! Method of compressed blocks */
+#define PB_DELIMITED_BLOCK_COMPRESSED 1
+
+/* ----------------------------------------------------------------------------
+ * Internal functions
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Pack a 64-bit integer in little-endian byte order.
+ *
+ * \param[out] data[] Target buffer
+ * \param[in]  value  Value
+ */
+static void
+pack(uint8_t data[], uint64_t value) {
+  assert(data);
+  for (size_t b = 0; b < 8; b++, value >>= 8)
+    data[b] = (uint8_t)value;
+}
+
+/*!
+ * Unpack a 64-bit integer in little-endian byte order.
+ *
+ * \param[in] data[] Source buffer
+ * \return           Value
+ */
+static uint64_t
+unpack(const uint8_t data[]) {
+  assert(data);
+  uint64_t value = 0;
+  for (size_t b = 8; b; b--)
+    value = value << 8 | data[b - 1];
+  return value;
+}
+
+/*!
+ * Write a set of vectors to a file descriptor entirely.
+ *
+ * \param[in]     fd    File descriptor
+ * \param[in,out] iov   Vectors
+ * \param[in]     count Vector count
+ * \return              Error code
+ */
+static pb_error_t
+output(int fd, struct iovec *iov, int count) {
+  assert(iov);
+  while (count) {
+    ssize_t bytes = writev(fd, iov, count);
+    if (unlikely_(bytes < 0)) {
+      if (errno == EINTR)
+        continue;
+      return PB_ERROR_INVALID;
+    }
+    for (; count && (size_t)bytes >= iov->iov_len; iov++, count--)
+      bytes -= iov->iov_len;
+    if (count) {
+      iov->iov_base  = (uint8_t *)iov->iov_base + bytes;
+      iov->iov_len  -= (size_t)bytes;
+    }
+  }
+  return PB_ERROR_NONE;
+}
+
+/*!
+ * Retrieve the data of an entry of the block index of a reader.
+ *
+ * \param[in] reader Reader
+ * \param[in] block  Block number
+ * \return           Entry data
+ */
+static const uint8_t *
+entry(const pb_delimited_block_reader_t *reader, size_t block) {
+  assert(reader && block < reader->size);
+  return pb_buffer_data(&(reader->buffer)) +
+    reader->index + block * PB_DELIMITED_BLOCK_ENTRY;
+}
+
+/* ----------------------------------------------------------------------------
+ * Interface
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Create a block writer for a file descriptor.
+ *
+ * Messages are collected in blocks of delimited messages, and every block is
+ * compressed independently once its raw size reaches the given threshold, so
+ * blocks can later be located through the block index and decompressed in
+ * parallel. If no codec is given, or a block does not shrink, the block is
+ * stored uncompressed, so it can be read without copying.
+ *
+ * \warning The writer does not take ownership of the file descriptor, and the
+ * file is only complete after pb_delimited_block_writer_finish() was called.
+ *
+ * \param[in] fd        File descriptor
+ * \param[in] codec     Codec, NULL if none
+ * \param[in] threshold Raw block size threshold
+ * \return              Writer
+ */
+extern pb_delimited_block_writer_t
+pb_delimited_block_writer_create(
+    int fd, const pb_delimited_block_codec_t *codec, size_t threshold) {
+  assert(fd >= 0 && threshold);
+  assert(!codec || (codec->proc.compress && codec->proc.decompress));
+  pb_delimited_block_writer_t writer = {
+    .fd        = fd,
+    .codec     = codec,
+    .threshold = threshold,
+    .block     = pb_buffer_create_empty(),
+    .target    = pb_buffer_create_empty(),
+    .index     = pb_buffer_create_empty(),
+    .offset    = 0,
+    .first     = 0,
+    .records   = 0
+  };
+  return writer;
+}
+
+/*!
+ * Destroy a block writer.
+ *
+ * Messages of the current block that were not flushed are discarded.
+ *
+ * \param[in,out] writer Writer
+ */
+extern void
+pb_delimited_block_writer_destroy(pb_delimited_block_writer_t *writer) {
+  assert(writer);
+  pb_buffer_destroy(&(writer->block));
+  pb_buffer_destroy(&(writer->target));
+  pb_buffer_destroy(&(writer->index));
+}
+
+/*!
+ * Write a message to a block writer.
+ *
+ * The message is copied into the current block together with its length
+ * prefix, and the block is flushed if it reached the threshold.
+ *
+ * \param[in,out] writer  Writer
+ * \param[in]     message Message
+ * \return                Error code
+ */
+extern pb_error_t
+pb_delimited_block_writer_write(
+    pb_delimited_block_writer_t *writer, const pb_buffer_t *message) {
+  assert(writer && message);
+  if (unlikely_(!pb_buffer_valid(message) ||
+                pb_buffer_size(message) > UINT32_MAX))
+    return PB_ERROR_INVALID;
+
+  /* Pack length prefix and copy message */
+  uint32_t length = (uint32_t)pb_buffer_size(message);
+  uint8_t *data = pb_buffer_grow(&(writer->block),
+    pb_varint_size_uint32(&length) + length);
+  if (unlikely_(!data))
+    return PB_ERROR_ALLOC;                                 /* LCOV_EXCL_LINE */
+  data += pb_varint_pack_uint32(data, &length);
+  if (length)
+    memcpy(data, pb_buffer_data(message), length);
+  writer->records++;
+
+  /* Flush block, if the threshold was reached */
+  return pb_buffer_size(&(writer->block)) >= writer->threshold
+    ? pb_delimited_block_writer_flush(writer)
+    : PB_ERROR_NONE;
+}
+
+/*!
+ * Flush the current block of a block writer.
+ *
+ * The block is compressed into a buffer of its raw size, so blocks that would
+ * not shrink are stored uncompressed. Each block is prefixed with a header of
+ * its method and its raw and stored size, and an entry containing its offset
+ * and the number of its first message is added to the block index. If an
+ * error occurs, the messages of the block are discarded.
+ *
+ * \param[in,out] writer Writer
+ * \return               Error code
+ */
+extern pb_error_t
+pb_delimited_block_writer_flush(pb_delimited_block_writer_t *writer) {
+  assert(writer);
+  size_t size = pb_buffer_size(&(writer->block));
+  if (!size)
+    return PB_ERROR_NONE;
+
+  /* Compress block, falling back to storing it */
+  uint8_t header[PB_DELIMITED_BLOCK_HEADER] = {
+    PB_DELIMITED_BLOCK_STORED
+  };
+  struct iovec iov[2] = {
+    { header, PB_DELIMITED_BLOCK_HEADER },
+    { writer->block.data, size }
+  };
+  if (writer->codec && !pb_buffer_ensure(&(writer->target), size)) {
+    size_t bytes = writer->codec->proc.compress(writer->codec->data,
+      writer->block.data, size, writer->target.data, size);
+    if (bytes && bytes < size) {
+      header[0] = PB_DELIMITED_BLOCK_COMPRESSED;
+      iov[1] = (struct iovec){ writer->target.data, bytes };
+    }
+  }
+  pack(&(header[1]), size);
+  pack(&(header[9]), iov[1].iov_len);
+
+  /* Reserve index entry and write block */
+  uint8_t *data = pb_buffer_grow(&(writer->index), PB_DELIMITED_BLOCK_ENTRY);
+  pb_error_t error = data
+    ? output(writer->fd, iov, 2)
+    : PB_ERROR_ALLOC;                                      /* LCOV_EXCL_LINE */
+  writer->block.size = 0;
+  if (unlikely_(error)) {
+    if (data)
+      writer->index.size -= PB_DELIMITED_BLOCK_ENTRY;
+    writer->records = writer->first;
+    return error;
+  }
+
+  /* Record offset and first message of block */
+  pack(&(data[0]), writer->offset);
+  pack(&(data[8]), writer->first);
+  writer->offset += PB_DELIMITED_BLOCK_HEADER + unpack(&(header[9]));
+  writer->first   = writer->records;
+  return PB_ERROR_NONE;
+}
+
+/*!
+ * Finish a block-compressed file.
+ *
+ * The current block is flushed, and the block index is written, followed by
+ * a trailer of four 64-bit integers containing the offset of the index, the
+ * block count, the message count and a magic number, all in little-endian
+ * byte order. No more messages may be written afterwards.
+ *
+ * \param[in,out] writer Writer
+ * \return               Error code
+ */
+extern pb_error_t
+pb_delimited_block_writer_finish(pb_delimited_block_writer_t *writer) {
+  assert(writer);
+  pb_error_t error = pb_delimited_block_writer_flush(writer);
+  if (unlikely_(error))
+    return error;
+
+  /* Pack trailer */
+  size_t size = pb_buffer_size(&(writer->index));
+  uint8_t trailer[PB_DELIMITED_BLOCK_TRAILER];
+  pack(&(trailer[0]),  writer->offset);
+  pack(&(trailer[8]),  size / PB_DELIMITED_BLOCK_ENTRY);
+  pack(&(trailer[16]), writer->records);
+  pack(&(trailer[24]), PB_DELIMITED_BLOCK_MAGIC);
+
+  /* Write index and trailer */
+  struct iovec iov[2] = {
+    { writer->index.data, size },
+    { trailer, PB_DELIMITED_BLOCK_TRAILER }
+  };
+  return size
+    ? output(writer->fd, iov, 2)
+    : output(writer->fd, &(iov[1]), 1);
+}
+
+/* ------------------------------------------------------------------------- */
+
+/*!
+ * Create a block reader over a buffer.
+ *
+ * The buffer is expected to contain an entire block-compressed file, which is
+ * best memory-mapped with pb_buffer_create_mmap(). If the trailer or the block
+ * index is not valid, an invalid reader is returned.
+ *
+ * \warning The reader does not take ownership of the provided buffer or codec,
+ * so the caller must ensure that both are not freed during operations.
+ *
+ * \param[in] buffer Buffer
+ * \param[in] codec  Codec, NULL if none
+ * \return           Reader
+ */
+extern pb_delimited_block_reader_t
+pb_delimited_block_reader_create(
+    const pb_buffer_t *buffer, const pb_delimited_block_codec_t *codec) {
+  assert(buffer);
+  assert(!codec || codec->proc.decompress);
+  pb_delimited_block_reader_t reader = {
+    .buffer  = pb_buffer_create_invalid(),
+    .codec   = codec,
+    .index   = 0,
+    .size    = 0,
+    .records = 0
+  };
+
+  /* Validate trailer and size of block index */
+  size_t size = pb_buffer_valid(buffer) ? pb_buffer_size(buffer) : 0;
+  if (size >= PB_DELIMITED_BLOCK_TRAILER) {
+    const uint8_t *data = pb_buffer_data(buffer) +
+      (size -= PB_DELIMITED_BLOCK_TRAILER);
+    uint64_t index = unpack(&(data[0])), count = unpack(&(data[8])),
+      records = unpack(&(data[16]));
+    if (unpack(&(data[24])) == PB_DELIMITED_BLOCK_MAGIC &&
+        index <= size && records <= SIZE_MAX &&
+        (size - index) / PB_DELIMITED_BLOCK_ENTRY == count &&
+        !((size - index) % PB_DELIMITED_BLOCK_ENTRY)) {
+      reader.buffer = pb_buffer_create_zero_copy_internal(
+        (uint8_t *)pb_buffer_data(buffer), pb_buffer_size(buffer));
+      reader.index   = index;
+      reader.size    = count;
+      reader.records = records;
+    }
+  }
+  return reader;
+}
+
+/*!
+ * Destroy a block reader.
+ *
+ * \param[in,out] reader Reader
+ */
+extern void
+pb_delimited_block_reader_destroy(pb_delimited_block_reader_t *reader) {
+  assert(reader);
+  pb_buffer_destroy(&(reader->buffer));
+}
+
+/*!
+ * Retrieve the number of the first message of a block.
+ *
+ * \param[in] reader Reader
+ * \param[in] block  Block number
+ * \return           Message number
+ */
+extern size_t
+pb_delimited_block_reader_first(
+    const pb_delimited_block_reader_t *reader, size_t block) {
+  assert(reader && block < reader->size);
+  return unpack(&(entry(reader, block)[8]));
+}
+
+/*!
+ * Find the block containing the message with the given number.
+ *
+ * The block index is binary-searched for the last block whose first message
+ * does not succeed the given message.
+ *
+ * \param[in] reader   Reader
+ * \param[in] position Message number
+ * \return             Block number, block count if out of range
+ */
+extern size_t
+pb_delimited_block_reader_find(
+    const pb_delimited_block_reader_t *reader, size_t position) {
+  assert(reader);
+  if (unlikely_(position >= reader->records || !reader->size))
+    return reader->size;
+  size_t l = 0, r = reader->size - 1;
+  while (l < r) {
+    size_t m = l + (r - l + 1) / 2;
+    if (pb_delimited_block_reader_first(reader, m) <= position) {
+      l = m;
+    } else {
+      r = m - 1;
+    }
+  }
+  return l;
+}
+
+/*!
+ * Read a block of a block reader.
+ *
+ * Stored blocks are returned as zero-copy buffers over the underlying buffer,
+ * and compressed blocks are decompressed into the given buffer and returned
+ * as zero-copy buffers over it, so the returned block is only valid until the
+ * given buffer is reused or destroyed. The returned block can be read with a
+ * delimited reader created through pb_delimited_reader_create().
+ *
+ * The reader itself is not modified, so blocks can be read from multiple
+ * threads in parallel, as long as every thread uses its own buffer.
+ *
+ * \param[in]     reader Reader
+ * \param[in]     block  Block number
+ * \param[in,out] buffer Buffer for decompression
+ * \param[out]    data   Buffer receiving block
+ * \return               Error code
+ */
+extern pb_error_t
+pb_delimited_block_reader_read(
+    const pb_delimited_block_reader_t *reader, size_t block,
+    pb_buffer_t *buffer, pb_buffer_t *data) {
+  assert(reader && buffer && data);
+  if (unlikely_(!pb_delimited_block_reader_valid(reader)))
+    return PB_ERROR_INVALID;
+  if (unlikely_(block >= reader->size))
+    return PB_ERROR_OFFSET;
+
+  /* Validate header of block */
+  uint64_t offset = unpack(&(entry(reader, block)[0]));
+  if (unlikely_(offset > reader->index ||
+                reader->index - offset < PB_DELIMITED_BLOCK_HEADER))
+    return PB_ERROR_INVALID;
+  const uint8_t *header = pb_buffer_data(&(reader->buffer)) + offset;
+  uint64_t raw = unpack(&(header[1])), size = unpack(&(header[9]));
+  if (unlikely_(!raw || raw > SIZE_MAX ||
+                size > reader->index - offset - PB_DELIMITED_BLOCK_HEADER))
+    return PB_ERROR_INVALID;
+
+  /* Return stored block without copying */
+  const uint8_t *source = &(header[PB_DELIMITED_BLOCK_HEADER]);
+  if (header[0] == PB_DELIMITED_BLOCK_STORED) {
+    if (unlikely_(raw != size))
+      return PB_ERROR_INVALID;
+    *data = pb_buffer_create_zero_copy_internal((uint8_t *)source, raw);
+    return PB_ERROR_NONE;
+  }
+
+  /* Decompress block into buffer */
+  if (unlikely_(header[0] != PB_DELIMITED_BLOCK_COMPRESSED || !reader->codec))
+    return PB_ERROR_INVALID;
+  if (unlikely_(!pb_buffer_valid(buffer) || pb_buffer_ensure(buffer, raw)))
+    return PB_ERROR_ALLOC;
+  buffer->size = 0;
+  if (unlikely_(reader->codec->proc.decompress(reader->codec->data,
+      source, size, buffer->data, raw) != raw))
+    return PB_ERROR_INVALID;
+  buffer->size = raw;
+  *data = pb_buffer_create_zero_copy_internal(buffer->data, raw);
+  return PB_ERROR_NONE;
+}
+
+/*!
+ * Position a delimited reader at the message with the given number.
+ *
+ * The block containing the message is read into the given buffer, and the
+ * delimited reader is created over the block and moved to the message by
+ * skipping the preceding messages of the block.
+ *
+ * \param[in]     reader    Reader
+ * \param[in]     position  Message number
+ * \param[in,out] buffer    Buffer for decompression
+ * \param[out]    delimited Delimited reader
+ * \return                  Error code
+ */
+extern pb_error_t
+pb_delimited_block_reader_seek(
+    const pb_delimited_block_reader_t *reader, size_t position,
+    pb_buffer_t *buffer, pb_delimited_reader_t *delimited) {
+  assert(reader && buffer && delimited);
+  if (unlikely_(!pb_delimited_block_reader_valid(reader)))
+    return PB_ERROR_INVALID;
+  size_t block = pb_delimited_block_reader_find(reader, position);
+  if (unlikely_(block == reader->size))
+    return PB_ERROR_OFFSET;
+
+  /* Read block and create delimited reader */
+  pb_buffer_t data;
+  pb_error_t error = pb_delimited_block_reader_read(reader, block,
+    buffer, &data);
+  if (unlikely_(error))
+    return error;
+  *delimited = pb_delimited_reader_create(&data);
+
+  /* Skip preceding messages of block */
+  pb_buffer_t message;
+  for (size_t skip = position - pb_delimited_block_reader_first(reader, block);
+      !error && skip; skip--)
+    error = pb_delimited_reader_next(delimited, &message);
+  return error == PB_ERROR_EOM ? PB_ERROR_INVALID : error;
+}
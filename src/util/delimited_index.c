@@ -0,0 +1,277 @@
+/*
+ * Copyright (c) 2013-2020 Martin Donath <martin.donath@squidfunk.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <unistd.h>
+
+#include "core/buffer.h"
+#include "core/common.h"
+#include "core/delimited.h"
+#include "util/delimited_index.h"
+#include "util/mmap.h"
+
+/* ----------------------------------------------------------------------------
+ * Constants
+ * ------------------------------------------------------------------------- */
+
+/*! Magic number identifying index files */
+#define PB_DELIMITED_INDEX_MAGIC 0x3130584449425070ULL
+
+/*! Size of the header of index files */
+#define PB_DELIMITED_INDEX_HEADER 24
+
+/* ----------------------------------------------------------------------------
+ * Internal functions
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Pack a 64-bit integer in little-endian byte order.
+ *
+ * \param[out] data[] Target buffer
+ * \param[in]  value  Value
+ */
+static void
+pack(uint8_t data[], uint64_t value) {
+  assert(data);
+  for (size_t b = 0; b < 8; b++, value >>= 8)
+    data[b] = (uint8_t)value;
+}
+
+/*!
+ * Unpack a 64-bit integer in little-endian byte order.
+ *
+ * \param[in] data[] Source buffer
+ * \return           Value
+ */
+static uint64_t
+unpack(const uint8_t data[]) {
+  assert(data);
+  uint64_t value = 0;
+  for (size_t b = 8; b; b--)
+    value = value << 8 | data[b - 1];
+  return value;
+}
+
+/*!
+ * Retrieve the offset of a sampled message from a delimited index.
+ *
+ * \param[in] index  Index
+ * \param[in] sample Sample
+ * \return           Offset
+ */
+static uint64_t
+offset(const pb_delimited_index_t *index, size_t sample) {
+  assert(index);
+  return unpack(pb_buffer_data(&(index->buffer)) +
+    PB_DELIMITED_INDEX_HEADER + sample * 8);
+}
+
+/* ----------------------------------------------------------------------------
+ * Interface
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Create a delimited index by scanning a buffer of delimited messages.
+ *
+ * The offset of every message whose number is a multiple of the sampling
+ * interval is recorded, so a larger interval trades a smaller index for more
+ * messages to be skipped upon seeking. Messages are not decoded, so building
+ * the index only needs to read the length prefixes.
+ *
+ * The index is kept in the same format in which it is written to a file:
+ * a header of three 64-bit integers containing a magic number, the sampling
+ * interval and the message count, followed by a 64-bit offset per sample, all
+ * in little-endian byte order.
+ *
+ * \param[in] buffer   Buffer
+ * \param[in] interval Sampling interval
+ * \return             Index
+ */
+extern pb_delimited_index_t
+pb_delimited_index_create(const pb_buffer_t *buffer, size_t interval) {
+  assert(buffer && interval);
+  pb_delimited_index_t index = {
+    .buffer   = pb_buffer_create_empty(),
+    .interval = interval,
+    .size     = 0
+  };
+
+  /* Reserve space for header */
+  pb_delimited_reader_t reader = pb_delimited_reader_create(buffer);
+  uint8_t *data = pb_delimited_reader_valid(&reader)
+    ? pb_buffer_grow(&(index.buffer), PB_DELIMITED_INDEX_HEADER)
+    : NULL;
+
+  /* Record offsets of sampled messages */
+  pb_error_t error = data ? PB_ERROR_NONE : PB_ERROR_ALLOC;
+  while (!error) {
+    size_t start = reader.offset;
+    pb_buffer_t message;
+    if ((error = pb_delimited_reader_next(&reader, &message)))
+      break;
+    if (!(index.size++ % interval)) {
+      if (unlikely_(!(data = pb_buffer_grow(&(index.buffer), 8))))
+        error = PB_ERROR_ALLOC;                            /* LCOV_EXCL_LINE */
+      else
+        pack(data, start);
+    }
+  }
+  pb_delimited_reader_destroy(&reader);
+
+  /* Write header, if the buffer was read entirely */
+  if (unlikely_(error != PB_ERROR_EOM)) {
+    pb_buffer_destroy(&(index.buffer));
+    index.buffer = pb_buffer_create_invalid();
+    index.size   = 0;
+  } else {
+    data = pb_buffer_data_from(&(index.buffer), 0);
+    pack(&(data[0]),  PB_DELIMITED_INDEX_MAGIC);
+    pack(&(data[8]),  interval);
+    pack(&(data[16]), index.size);
+  }
+  return index;
+}
+
+/*!
+ * Create a delimited index by mapping an index file into memory.
+ *
+ * If the file is not a valid index file, an invalid index is returned.
+ *
+ * \param[in] path Path
+ * \return         Index
+ */
+extern pb_delimited_index_t
+pb_delimited_index_create_mmap(const char path[]) {
+  assert(path);
+  pb_delimited_index_t index = {
+    .buffer   = pb_buffer_create_mmap(path, PB_MMAP_RANDOM),
+    .interval = 0,
+    .size     = 0
+  };
+
+  /* Validate header and size */
+  size_t size = pb_buffer_size(&(index.buffer));
+  if (pb_buffer_valid(&(index.buffer)) && size >= PB_DELIMITED_INDEX_HEADER) {
+    const uint8_t *data = pb_buffer_data(&(index.buffer));
+    uint64_t interval = unpack(&(data[8])), count = unpack(&(data[16]));
+    if (unpack(&(data[0])) == PB_DELIMITED_INDEX_MAGIC &&
+        interval && count <= SIZE_MAX &&
+        (size - PB_DELIMITED_INDEX_HEADER) / 8 ==
+          (count + interval - 1) / interval &&
+        !((size - PB_DELIMITED_INDEX_HEADER) % 8)) {
+      index.interval = interval;
+      index.size     = count;
+      return index;
+    }
+  }
+  pb_buffer_destroy(&(index.buffer));
+  index.buffer = pb_buffer_create_invalid();
+  return index;
+}
+
+/*!
+ * Destroy a delimited index.
+ *
+ * \param[in,out] index Index
+ */
+extern void
+pb_delimited_index_destroy(pb_delimited_index_t *index) {
+  assert(index);
+  pb_buffer_destroy(&(index->buffer));
+}
+
+/*!
+ * Write a delimited index to a file.
+ *
+ * The file is created or truncated and can be mapped into memory again with
+ * pb_delimited_index_create_mmap().
+ *
+ * \param[in] index Index
+ * \param[in] path  Path
+ * \return          Error code
+ */
+extern pb_error_t
+pb_delimited_index_write(const pb_delimited_index_t *index, const char path[]) {
+  assert(index && path);
+  if (unlikely_(!pb_delimited_index_valid(index)))
+    return PB_ERROR_INVALID;
+  int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (unlikely_(fd < 0))
+    return PB_ERROR_INVALID;
+
+  /* Write entire index, retrying upon interruption */
+  const uint8_t *data = pb_buffer_data(&(index->buffer));
+  size_t left = pb_buffer_size(&(index->buffer));
+  while (left) {
+    ssize_t bytes = write(fd, data, left);
+    if (unlikely_(bytes < 0)) {
+      if (errno == EINTR)
+        continue;
+      break;                                               /* LCOV_EXCL_LINE */
+    }
+    data += bytes;
+    left -= (size_t)bytes;
+  }
+  return close(fd) || left ? PB_ERROR_INVALID : PB_ERROR_NONE;
+}
+
+/*!
+ * Position a delimited reader at the message with the given number.
+ *
+ * The reader is moved to the closest preceding sampled message, and the
+ * remaining messages are skipped by reading their length prefixes. The reader
+ * must have been created over the buffer the index was built from, which is
+ * best memory-mapped with pb_buffer_create_mmap() for large files.
+ *
+ * \param[in]     index    Index
+ * \param[in,out] reader   Reader
+ * \param[in]     position Message number
+ * \return                 Error code
+ */
+extern pb_error_t
+pb_delimited_index_seek(
+    const pb_delimited_index_t *index, pb_delimited_reader_t *reader,
+    size_t position) {
+  assert(index && reader);
+  if (unlikely_(!pb_delimited_index_valid(index) ||
+                !pb_delimited_reader_valid(reader) || reader->fd >= 0))
+    return PB_ERROR_INVALID;
+  if (unlikely_(position >= index->size))
+    return PB_ERROR_OFFSET;
+
+  /* Move reader to closest preceding sample */
+  uint64_t start = offset(index, position / index->interval);
+  if (unlikely_(start > pb_buffer_size(&(reader->buffer))))
+    return PB_ERROR_OFFSET;
+  reader->offset = start;
+
+  /* Skip remaining messages */
+  pb_error_t error = PB_ERROR_NONE;
+  pb_buffer_t message;
+  for (size_t skip = position % index->interval; !error && skip; skip--)
+    error = pb_delimited_reader_next(reader, &message);
+  return error;
+}
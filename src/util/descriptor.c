@@ -27,6 +27,64 @@
 #include "core/common.h"
 #include "util/descriptor.h"
 
+/* ----------------------------------------------------------------------------
+ * Internal functions
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Retrieve the field descriptor for a given name using the name index.
+ *
+ * \param[in] descriptor Descriptor
+ * \param[in] name[]     Name
+ * \return               Field descriptor
+ */
+static const pb_field_descriptor_t *
+field_by_name(const pb_descriptor_t *descriptor, const char name[]) {
+  assert(descriptor && descriptor->name.data && name);
+  size_t l = 0, r = descriptor->name.size;
+  while (l < r) {
+    size_t m = l + (r - l) / 2;
+    const pb_field_descriptor_t *field =
+      &(descriptor->field.data[descriptor->name.data[m]]);
+    int compare = strcmp(pb_field_descriptor_name(field), name);
+    if (!compare)
+      return field;
+    if (compare < 0) {
+      l = m + 1;
+    } else {
+      r = m;
+    }
+  }
+  return NULL;
+}
+
+/*!
+ * Retrieve the value descriptor for a given name using the name index.
+ *
+ * \param[in] descriptor Enum descriptor
+ * \param[in] name[]     Name
+ * \return               Enum value descriptor
+ */
+static const pb_enum_value_descriptor_t *
+enum_value_by_name(const pb_enum_descriptor_t *descriptor, const char name[]) {
+  assert(descriptor && descriptor->name.data && name);
+  size_t l = 0, r = descriptor->name.size;
+  while (l < r) {
+    size_t m = l + (r - l) / 2;
+    const pb_enum_value_descriptor_t *value =
+      &(descriptor->value.data[descriptor->name.data[m]]);
+    int compare = strcmp(pb_enum_value_descriptor_name(value), name);
+    if (!compare)
+      return value;
+    if (compare < 0) {
+      l = m + 1;
+    } else {
+      r = m;
+    }
+  }
+  return NULL;
+}
+
 /* ----------------------------------------------------------------------------
  * Interface
  * ------------------------------------------------------------------------- */
@@ -34,8 +92,12 @@
 /*!
  * Retrieve the field descriptor for a given name from a descriptor.
  *
- * \warning Querying a descriptor by name is far less efficient than querying
- * by tag, as a lot more comparisons are involved.
+ * If the descriptor contains a name index, which is emitted by the generator,
+ * the field descriptor is retrieved through binary search, otherwise all
+ * field descriptors are compared one after another.
+ *
+ * \warning Querying a descriptor by name is less efficient than querying by
+ * tag, as more comparisons are involved.
  *
  * \param[in] descriptor Descriptor
  * \param[in] name[]     Name
@@ -45,10 +107,16 @@ extern const pb_field_descriptor_t *
 pb_descriptor_field_by_name(
     const pb_descriptor_t *descriptor, const char name[]) {
   assert(descriptor && name);
-  for (size_t f = 0; f < descriptor->field.size; ++f) {
-    if (strcmp(pb_field_descriptor_name(&(descriptor->field.data[f])), name))
-      continue;
-    return &(descriptor->field.data[f]);
+  if (descriptor->name.data) {
+    const pb_field_descriptor_t *field = field_by_name(descriptor, name);
+    if (field)
+      return field;
+  } else {
+    for (size_t f = 0; f < descriptor->field.size; ++f) {
+      if (strcmp(pb_field_descriptor_name(&(descriptor->field.data[f])), name))
+        continue;
+      return &(descriptor->field.data[f]);
+    }
   }
   return pb_descriptor_extension(descriptor) ?
     pb_descriptor_field_by_name(
@@ -60,8 +128,11 @@ pb_descriptor_field_by_name(
 /*!
  * Retrieve the value descriptor for a given name from an enum descriptor.
  *
- * \warning Querying an enum descriptor by name is far less efficient than
- * querying by number, as a lot more comparisons are involved.
+ * If the enum descriptor contains a name index, which is emitted by the
+ * generator, the value descriptor is retrieved through binary search.
+ *
+ * \warning Querying an enum descriptor by name is less efficient than
+ * querying by number, as more comparisons are involved.
  *
  * \param[in] descriptor Enum descriptor
  * \param[in] name       Name
@@ -71,6 +142,8 @@ extern const struct pb_enum_value_descriptor_t *
 pb_enum_descriptor_value_by_name(
     const pb_enum_descriptor_t *descriptor, const char name[]) {
   assert(descriptor && name);
+  if (descriptor->name.data)
+    return enum_value_by_name(descriptor, name);
   for (size_t v = 0; v < descriptor->value.size; ++v) {
     if (strcmp(pb_enum_value_descriptor_name(
         &(descriptor->value.data[v])), name))
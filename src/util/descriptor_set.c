@@ -0,0 +1,1392 @@
+/*
+ * Copyright (c) 2013-2020 Martin Donath <martin.donath@squidfunk.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <assert.h>
+#include <errno.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "core/allocator.h"
+#include "core/buffer.h"
+#include "core/common.h"
+#include "core/decoder.h"
+#include "core/descriptor.h"
+#include "core/stream.h"
+#include "core/varint.h"
+#include "util/arena_allocator.h"
+#include "util/descriptor.h"
+#include "util/descriptor_set.h"
+
+/* ----------------------------------------------------------------------------
+ * Constants
+ * ------------------------------------------------------------------------- */
+
+/*! Minimum region capacity of the arena */
+#define PB_DESCRIPTOR_SET_REGION 4096
+
+/*! Maximum nesting depth of message declarations */
+#define PB_DESCRIPTOR_SET_DEPTH 64
+
+/*! Maximum tag of a field */
+#define PB_DESCRIPTOR_SET_TAG_MAX 536870911
+
+/* ----------------------------------------------------------------------------
+ * Type definitions
+ * ------------------------------------------------------------------------- */
+
+typedef struct pb_descriptor_set_field_t {
+  pb_string_t name;                    /*!< Name */
+  pb_string_t refer;                   /*!< Type name, if any */
+  pb_string_t value;                   /*!< Default value, if any */
+  uint32_t tag;                        /*!< Tag */
+  uint32_t type;                       /*!< Type of descriptor.proto */
+  uint32_t label;                      /*!< Label of descriptor.proto */
+  int32_t oneof;                       /*!< Oneof position, -1 if none */
+  uint8_t packed;                      /*!< Packed option + 1, 0 if unset */
+  uint8_t optional;                    /*!< Proto3 optional field */
+  uint8_t defined;                     /*!< Default value given */
+} pb_descriptor_set_field_t;
+
+typedef struct pb_descriptor_set_value_t {
+  pb_string_t name;                    /*!< Name */
+  pb_enum_t number;                    /*!< Number */
+  size_t order;                        /*!< Position of declaration */
+} pb_descriptor_set_value_t;
+
+typedef struct pb_descriptor_set_loader_t {
+  pb_descriptor_set_t *set;            /*!< Descriptor set */
+  int resolve;                         /*!< Pass: register or resolve */
+  int proto3;                          /*!< Current file uses proto3 */
+  size_t depth;                        /*!< Nesting depth */
+  pb_buffer_t scope;                   /*!< Full name of current scope */
+  pb_buffer_t name;                    /*!< Candidate name for resolving */
+  pb_buffer_t entries;                 /*!< Registered entries */
+  pb_buffer_t fields;                  /*!< Fields of current message */
+  pb_buffer_t values;                  /*!< Values of current enum */
+  pb_buffer_t order;                   /*!< Descriptors sorted by name */
+} pb_descriptor_set_loader_t;
+
+/* ----------------------------------------------------------------------------
+ * Macros
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Compose the key of a field of descriptor.proto.
+ *
+ * \param[in] tag      Tag
+ * \param[in] wiretype Wiretype
+ * \return             Key
+ */
+#define key_(tag, wiretype) ((uint32_t)(tag) << 3 | (wiretype))
+
+/* ----------------------------------------------------------------------------
+ * Mappings
+ * ------------------------------------------------------------------------- */
+
+/*! Mapping: type of descriptor.proto ==> type */
+static const pb_type_t
+type_map[] = {
+  [1]  = PB_TYPE_DOUBLE,
+  [2]  = PB_TYPE_FLOAT,
+  [3]  = PB_TYPE_INT64,
+  [4]  = PB_TYPE_UINT64,
+  [5]  = PB_TYPE_INT32,
+  [6]  = PB_TYPE_FIXED64,
+  [7]  = PB_TYPE_FIXED32,
+  [8]  = PB_TYPE_BOOL,
+  [9]  = PB_TYPE_STRING,
+  [10] = PB_TYPE_UNDEFINED,
+  [11] = PB_TYPE_MESSAGE,
+  [12] = PB_TYPE_BYTES,
+  [13] = PB_TYPE_UINT32,
+  [14] = PB_TYPE_ENUM,
+  [15] = PB_TYPE_SFIXED32,
+  [16] = PB_TYPE_SFIXED64,
+  [17] = PB_TYPE_SINT32,
+  [18] = PB_TYPE_SINT64
+};
+
+/* ----------------------------------------------------------------------------
+ * Forward declarations
+ * ------------------------------------------------------------------------- */
+
+static pb_error_t
+message_load(
+  pb_descriptor_set_loader_t *loader,  /* Loader */
+  const pb_string_t *data);            /* Raw message declaration */
+
+/* ----------------------------------------------------------------------------
+ * Internal functions
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Allocate a zeroed memory block from the arena of a loader.
+ *
+ * \param[in,out] loader Loader
+ * \param[in]     size   Bytes to be allocated
+ * \return               Memory block
+ */
+static void *
+allocate(pb_descriptor_set_loader_t *loader, size_t size) {
+  assert(loader && size);
+  void *block = pb_allocator_allocate(&(loader->set->allocator), size);
+  if (likely_(block != NULL))
+    memset(block, 0, size);
+  return block;
+}
+
+/*!
+ * Copy a string into the arena of a loader, terminating it with nul.
+ *
+ * \param[in,out] loader Loader
+ * \param[in]     data[] Raw data
+ * \param[in]     size   Raw data size
+ * \return               Characters
+ */
+static char *
+copy(pb_descriptor_set_loader_t *loader, const uint8_t data[], size_t size) {
+  assert(loader);
+  char *chars = allocate(loader, size + 1);
+  if (likely_(chars != NULL) && size)
+    memcpy(chars, data, size);
+  return chars;
+}
+
+/*!
+ * Create a zero-copy buffer over a string.
+ *
+ * \param[in] string String
+ * \return           Buffer
+ */
+static pb_buffer_t
+buffer(const pb_string_t *string) {
+  assert(string && pb_string_data(string));
+  return pb_buffer_create_zero_copy_internal(
+    pb_string_data(string), pb_string_size(string));
+}
+
+/*!
+ * Compare a nul-terminated name to a name of given size.
+ *
+ * \param[in] x[] Nul-terminated name
+ * \param[in] y[] Name
+ * \param[in] size Size of name
+ * \return         Comparison result
+ */
+static int
+compare(const char x[], const char y[], size_t size) {
+  assert(x && y);
+  for (size_t c = 0; c < size; c++) {
+    if (!x[c])
+      return -1;
+    if (x[c] != y[c])
+      return (uint8_t)x[c] < (uint8_t)y[c] ? -1 : 1;
+  }
+  return x[size] ? 1 : 0;
+}
+
+/*!
+ * Compare two entries by full name.
+ *
+ * \param[in] x Entry
+ * \param[in] y Entry
+ * \return      Comparison result
+ */
+static int
+compare_entry(const void *x, const void *y) {
+  return strcmp(((const pb_descriptor_set_entry_t *)x)->name,
+                ((const pb_descriptor_set_entry_t *)y)->name);
+}
+
+/*!
+ * Compare two fields by tag.
+ *
+ * \param[in] x Field
+ * \param[in] y Field
+ * \return      Comparison result
+ */
+static int
+compare_field(const void *x, const void *y) {
+  uint32_t a = ((const pb_descriptor_set_field_t *)x)->tag,
+           b = ((const pb_descriptor_set_field_t *)y)->tag;
+  return (a > b) - (a < b);
+}
+
+/*!
+ * Compare two field descriptors by name.
+ *
+ * \param[in] x Pointer to field descriptor
+ * \param[in] y Pointer to field descriptor
+ * \return      Comparison result
+ */
+static int
+compare_field_name(const void *x, const void *y) {
+  return strcmp((*(const pb_field_descriptor_t *const *)x)->name,
+                (*(const pb_field_descriptor_t *const *)y)->name);
+}
+
+/*!
+ * Compare two enum values by number and position of declaration.
+ *
+ * \param[in] x Enum value
+ * \param[in] y Enum value
+ * \return      Comparison result
+ */
+static int
+compare_value(const void *x, const void *y) {
+  const pb_descriptor_set_value_t *a = x, *b = y;
+  if (a->number != b->number)
+    return a->number < b->number ? -1 : 1;
+  return (a->order > b->order) - (a->order < b->order);
+}
+
+/*!
+ * Compare two enum value descriptors by name.
+ *
+ * \param[in] x Pointer to enum value descriptor
+ * \param[in] y Pointer to enum value descriptor
+ * \return      Comparison result
+ */
+static int
+compare_value_name(const void *x, const void *y) {
+  return strcmp((*(const pb_enum_value_descriptor_t *const *)x)->name,
+                (*(const pb_enum_value_descriptor_t *const *)y)->name);
+}
+
+/*!
+ * Retrieve an entry of a descriptor set by full name.
+ *
+ * \param[in] set    Descriptor set
+ * \param[in] name[] Full name
+ * \param[in] size   Full name size
+ * \return           Entry, NULL if not found
+ */
+static const pb_descriptor_set_entry_t *
+lookup(const pb_descriptor_set_t *set, const char name[], size_t size) {
+  assert(set && name);
+  size_t l = 0, r = set->entry.size;
+  while (l < r) {
+    size_t m = l + (r - l) / 2;
+    int result = compare(set->entry.data[m].name, name, size);
+    if (!result)
+      return &(set->entry.data[m]);
+    if (result < 0) {
+      l = m + 1;
+    } else {
+      r = m;
+    }
+  }
+  return NULL;
+}
+
+/*!
+ * Enter the scope of a package, message or enum.
+ *
+ * \param[in,out] loader Loader
+ * \param[in]     name   Name
+ * \param[out]    size   Size of enclosing scope
+ * \return               Error code
+ */
+static pb_error_t
+scope_enter(
+    pb_descriptor_set_loader_t *loader, const pb_string_t *name,
+    size_t *size) {
+  assert(loader && name && size);
+  *size = pb_buffer_size(&(loader->scope));
+  if (unlikely_(!pb_string_size(name)))
+    return PB_ERROR_INVALID;
+
+  /* Append name to scope, separated by a dot */
+  uint8_t *data = pb_buffer_grow(&(loader->scope),
+    pb_string_size(name) + (*size ? 1 : 0));
+  if (unlikely_(!data))
+    return PB_ERROR_ALLOC;                                 /* LCOV_EXCL_LINE */
+  if (*size)
+    *data++ = '.';
+  memcpy(data, pb_string_data(name), pb_string_size(name));
+  return PB_ERROR_NONE;
+}
+
+/*!
+ * Register the message or enum descriptor of the current scope.
+ *
+ * \param[in,out] loader     Loader
+ * \param[in]     type       Message or enum type
+ * \param[in]     descriptor Message or enum descriptor
+ * \param[in]     value      First declared enum value, if any
+ * \return                   Error code
+ */
+static pb_error_t
+entry_register(
+    pb_descriptor_set_loader_t *loader, pb_type_t type,
+    const void *descriptor, const pb_enum_t *value) {
+  assert(loader && descriptor);
+  char *name = copy(loader, pb_buffer_data(&(loader->scope)),
+    pb_buffer_size(&(loader->scope)));
+  pb_descriptor_set_entry_t *entry = (pb_descriptor_set_entry_t *)
+    pb_buffer_grow(&(loader->entries), sizeof(pb_descriptor_set_entry_t));
+  if (unlikely_(!name || !entry))
+    return PB_ERROR_ALLOC;                                 /* LCOV_EXCL_LINE */
+  *entry = (pb_descriptor_set_entry_t){
+    .name       = name,
+    .type       = type,
+    .descriptor = descriptor,
+    .value      = value
+  };
+  return PB_ERROR_NONE;
+}
+
+/*!
+ * Resolve a type name from the current scope.
+ *
+ * Fully qualified names start with a dot. Relative names are searched in the
+ * current scope first, and then in every enclosing scope.
+ *
+ * \param[in,out] loader Loader
+ * \param[in]     name   Type name
+ * \return               Entry, NULL if not found
+ */
+static const pb_descriptor_set_entry_t *
+resolve(pb_descriptor_set_loader_t *loader, const pb_string_t *name) {
+  assert(loader && name);
+  const char *data = (const char *)pb_string_data(name);
+  size_t size = pb_string_size(name);
+  if (data[0] == '.')
+    return lookup(loader->set, data + 1, size - 1);
+
+  /* Try relative name in all enclosing scopes */
+  pb_buffer_t *candidate = &(loader->name);
+  for (size_t prefix = pb_buffer_size(&(loader->scope)); ; ) {
+    candidate->size = 0;
+    uint8_t *target = pb_buffer_grow(candidate, prefix + 1 + size);
+    if (unlikely_(!target))
+      return NULL;                                         /* LCOV_EXCL_LINE */
+    memcpy(target, pb_buffer_data(&(loader->scope)), prefix);
+    target[prefix] = '.';
+    memcpy(&(target[prefix + 1]), data, size);
+
+    /* Look up candidate, omitting the dot for the outermost scope */
+    const pb_descriptor_set_entry_t *entry = prefix
+      ? lookup(loader->set, (const char *)target, prefix + 1 + size)
+      : lookup(loader->set, data, size);
+    if (entry || !prefix)
+      return entry;
+
+    /* Strip innermost scope */
+    while (prefix && pb_buffer_data(&(loader->scope))[--prefix] != '.');
+  }
+}
+
+/*!
+ * Resolve escape sequences of a default value of a bytes field in place.
+ *
+ * \param[in,out] data[] Raw data
+ * \param[in]     size   Raw data size
+ * \return               Resolved size, SIZE_MAX if invalid
+ */
+static size_t
+unescape(uint8_t data[], size_t size) {
+  assert(data);
+  static const char escape[] = "abfnrtv";
+  static const uint8_t value[] = { 7, 8, 12, 10, 13, 9, 11 };
+  size_t length = 0;
+  for (size_t c = 0; c < size; c++) {
+    if (data[c] != '\\') {
+      data[length++] = data[c];
+      continue;
+    }
+    if (++c == size)
+      return SIZE_MAX;
+
+    /* Resolve escaped characters and named escape sequences */
+    const char *named = data[c] ? strchr(escape, data[c]) : NULL;
+    if (data[c] == '\\' || data[c] == '\'' ||
+        data[c] == '"'  || data[c] == '?') {
+      data[length++] = data[c];
+    } else if (named) {
+      data[length++] = value[named - escape];
+
+    /* Resolve hexadecimal escape sequences */
+    } else if (data[c] == 'x') {
+      unsigned int byte = 0, digits = 0;
+      for (; digits < 2 && c + 1 < size; digits++) {
+        uint8_t digit = data[c + 1];
+        if ('0' <= digit && digit <= '9') {
+          byte = byte << 4 | (digit - '0');
+        } else if ('a' <= (digit | 0x20) && (digit | 0x20) <= 'f') {
+          byte = byte << 4 | ((digit | 0x20) - 'a' + 10);
+        } else {
+          break;
+        }
+        c++;
+      }
+      if (!digits)
+        return SIZE_MAX;
+      data[length++] = (uint8_t)byte;
+
+    /* Resolve octal escape sequences */
+    } else if ('0' <= data[c] && data[c] <= '7') {
+      unsigned int byte = data[c] - '0';
+      for (size_t digits = 1; digits < 3 && c + 1 < size &&
+          '0' <= data[c + 1] && data[c + 1] <= '7'; digits++)
+        byte = byte << 3 | (data[++c] - '0');
+      if (byte > 255)
+        return SIZE_MAX;
+      data[length++] = (uint8_t)byte;
+    } else {
+      return SIZE_MAX;
+    }
+  }
+  return length;
+}
+
+/*!
+ * Create the default value of a field from its textual representation.
+ *
+ * \param[in,out] loader Loader
+ * \param[in]     field  Field
+ * \param[in]     type   Type
+ * \param[in]     entry  Entry of enum, if any
+ * \param[out]    value  Pointer receiving default value
+ * \return               Error code
+ */
+static pb_error_t
+value_create(
+    pb_descriptor_set_loader_t *loader, const pb_descriptor_set_field_t *field,
+    pb_type_t type, const pb_descriptor_set_entry_t *entry,
+    const void **value) {
+  assert(loader && field && value);
+  if (unlikely_(type == PB_TYPE_MESSAGE))
+    return PB_ERROR_INVALID;
+  size_t size = pb_string_size(&(field->value));
+  char *source = copy(loader, pb_string_data(&(field->value)), size);
+  void *target = allocate(loader, pb_field_descriptor_type_size_map[type]);
+  if (unlikely_(!source || !target))
+    return PB_ERROR_ALLOC;                                 /* LCOV_EXCL_LINE */
+
+  /* Parse value according to type */
+  char *end = &(source[size]);
+  errno = 0;
+  switch (type) {
+    case PB_TYPE_INT32:
+    case PB_TYPE_SINT32:
+    case PB_TYPE_SFIXED32: {
+      long long number = strtoll(source, &end, 10);
+      if (number < INT32_MIN || number > INT32_MAX)
+        return PB_ERROR_INVALID;
+      *(int32_t *)target = (int32_t)number;
+      break;
+    }
+    case PB_TYPE_INT64:
+    case PB_TYPE_SINT64:
+    case PB_TYPE_SFIXED64:
+      *(int64_t *)target = strtoll(source, &end, 10);
+      break;
+    case PB_TYPE_UINT32:
+    case PB_TYPE_FIXED32: {
+      unsigned long long number = strtoull(source, &end, 10);
+      if (source[0] == '-' || number > UINT32_MAX)
+        return PB_ERROR_INVALID;
+      *(uint32_t *)target = (uint32_t)number;
+      break;
+    }
+    case PB_TYPE_UINT64:
+    case PB_TYPE_FIXED64:
+      if (source[0] == '-')
+        return PB_ERROR_INVALID;
+      *(uint64_t *)target = strtoull(source, &end, 10);
+      break;
+    case PB_TYPE_FLOAT:
+      *(float *)target = strtof(source, &end);
+      break;
+    case PB_TYPE_DOUBLE:
+      *(double *)target = strtod(source, &end);
+      break;
+    case PB_TYPE_BOOL:
+      if (strcmp(source, "true") && strcmp(source, "false"))
+        return PB_ERROR_INVALID;
+      *(uint8_t *)target = source[0] == 't';
+      break;
+    case PB_TYPE_ENUM: {
+      const pb_enum_value_descriptor_t *descriptor =
+        pb_enum_descriptor_value_by_name(entry->descriptor, source);
+      if (unlikely_(!descriptor))
+        return PB_ERROR_INVALID;
+      *(pb_enum_t *)target = pb_enum_value_descriptor_number(descriptor);
+      break;
+    }
+    case PB_TYPE_STRING:
+      *(pb_string_t *)target = pb_string_init((uint8_t *)source, size);
+      break;
+    case PB_TYPE_BYTES:
+      if (unlikely_((size = unescape((uint8_t *)source, size)) == SIZE_MAX))
+        return PB_ERROR_INVALID;
+      *(pb_string_t *)target = pb_string_init((uint8_t *)source, size);
+      break;
+    default:
+      return PB_ERROR_INVALID;
+  }
+
+  /* Ensure that numbers were parsed entirely */
+  if (unlikely_(errno || end != &(source[pb_string_size(&(field->value))]) ||
+                (!size && type != PB_TYPE_STRING && type != PB_TYPE_BYTES)))
+    return PB_ERROR_INVALID;
+  *value = target;
+  return PB_ERROR_NONE;
+}
+
+/*!
+ * Load a field declaration.
+ *
+ * \param[in,out] loader Loader
+ * \param[in]     data   Raw field declaration
+ * \return               Error code
+ */
+static pb_error_t
+field_load(pb_descriptor_set_loader_t *loader, const pb_string_t *data) {
+  assert(loader && data);
+  pb_descriptor_set_field_t field = {
+    .oneof = -1
+  };
+
+  /* Iterate tag-value pairs */
+  pb_buffer_t declaration = buffer(data);
+  pb_stream_t stream = pb_stream_create(&declaration);
+  pb_error_t error = PB_ERROR_NONE;
+  while (!error && pb_stream_left(&stream)) {
+    uint32_t key, flag;
+    if ((error = pb_stream_read_uint32(&stream, &key)))
+      break;
+    switch (key) {
+      case key_(1, PB_WIRETYPE_LENGTH):
+        error = pb_stream_read_length(&stream, &(field.name));
+        break;
+      case key_(3, PB_WIRETYPE_VARINT):
+        error = pb_stream_read_uint32(&stream, &(field.tag));
+        break;
+      case key_(4, PB_WIRETYPE_VARINT):
+        error = pb_stream_read_uint32(&stream, &(field.label));
+        break;
+      case key_(5, PB_WIRETYPE_VARINT):
+        error = pb_stream_read_uint32(&stream, &(field.type));
+        break;
+      case key_(6, PB_WIRETYPE_LENGTH):
+        error = pb_stream_read_length(&stream, &(field.refer));
+        break;
+      case key_(7, PB_WIRETYPE_LENGTH):
+        error = pb_stream_read_length(&stream, &(field.value));
+        field.defined = 1;
+        break;
+      case key_(9, PB_WIRETYPE_VARINT):
+        error = pb_stream_read_typed(&stream, PB_TYPE_INT32, &(field.oneof));
+        break;
+      case key_(17, PB_WIRETYPE_VARINT):
+        if (!(error = pb_stream_read_uint32(&stream, &flag)))
+          field.optional = !!flag;
+        break;
+
+      /* Extract packed option */
+      case key_(8, PB_WIRETYPE_LENGTH): {
+        pb_string_t options;
+        if ((error = pb_stream_read_length(&stream, &options)))
+          break;
+        pb_buffer_t temp = buffer(&options);
+        pb_stream_t substream = pb_stream_create(&temp);
+        while (!error && pb_stream_left(&substream)) {
+          uint32_t subkey;
+          if ((error = pb_stream_read_uint32(&substream, &subkey)))
+            break;
+          if (subkey == key_(2, PB_WIRETYPE_VARINT)) {
+            if (!(error = pb_stream_read_uint32(&substream, &flag)))
+              field.packed = flag ? 2 : 1;
+          } else {
+            error = pb_decoder_skip_field(&substream, subkey);
+          }
+        }
+        pb_stream_destroy(&substream);
+        break;
+      }
+
+      /* Skip unknown fields */
+      default:
+        error = pb_decoder_skip_field(&stream, key);
+    }
+  }
+  pb_stream_destroy(&stream);
+  if (unlikely_(error))
+    return PB_ERROR_INVALID;
+  if (unlikely_(!pb_string_size(&(field.name))))
+    return PB_ERROR_INVALID;
+
+  /* Append field to fields of current message */
+  pb_descriptor_set_field_t *target = (pb_descriptor_set_field_t *)
+    pb_buffer_grow(&(loader->fields), sizeof(pb_descriptor_set_field_t));
+  if (unlikely_(!target))
+    return PB_ERROR_ALLOC;                                 /* LCOV_EXCL_LINE */
+  *target = field;
+  return PB_ERROR_NONE;
+}
+
+/*!
+ * Create a field descriptor from a field declaration.
+ *
+ * \param[in,out] loader     Loader
+ * \param[in]     field      Field
+ * \param[in]     oneof      Oneof descriptors of message
+ * \param[out]    descriptor Field descriptor
+ * \return                   Error code
+ */
+static pb_error_t
+field_create(
+    pb_descriptor_set_loader_t *loader, const pb_descriptor_set_field_t *field,
+    const pb_oneof_descriptor_t *oneof, pb_field_descriptor_t *descriptor) {
+  assert(loader && field && descriptor);
+  pb_type_t type = field->type < sizeof(type_map) / sizeof(*type_map)
+    ? type_map[field->type]
+    : PB_TYPE_UNDEFINED;
+
+  /* Resolve referenced message or enum, inferring the type if not given */
+  const pb_descriptor_set_entry_t *entry = NULL;
+  if (pb_string_size(&(field->refer))) {
+    if (unlikely_(!(entry = resolve(loader, &(field->refer)))))
+      return PB_ERROR_INVALID;
+    if (!field->type)
+      type = entry->type;
+    if (unlikely_(type != entry->type))
+      return PB_ERROR_INVALID;
+  } else if (unlikely_(type == PB_TYPE_UNDEFINED ||
+                       type == PB_TYPE_MESSAGE || type == PB_TYPE_ENUM)) {
+    return PB_ERROR_INVALID;
+  }
+
+  /* Map label, turning members of non-synthetic oneofs into oneof members */
+  pb_label_t label;
+  switch (field->label) {
+    case 1:
+      label = field->oneof >= 0 && !field->optional
+        ? PB_LABEL_ONEOF
+        : PB_LABEL_OPTIONAL;
+      break;
+    case 2:
+      label = PB_LABEL_REQUIRED;
+      break;
+    case 3:
+      label = PB_LABEL_REPEATED;
+      break;
+    default:
+      return PB_ERROR_INVALID;
+  }
+
+  /* Reference oneof or default value, implicitly for enums */
+  const void *value = NULL;
+  pb_error_t error = PB_ERROR_NONE;
+  if (label == PB_LABEL_ONEOF) {
+    value = &(oneof[field->oneof]);
+  } else if (field->defined) {
+    if (unlikely_(error = value_create(loader, field, type, entry, &value)))
+      return error;
+  } else if (type == PB_TYPE_ENUM && label == PB_LABEL_OPTIONAL) {
+    value = entry->value;
+  }
+
+  /* Determine flags, packing repeated scalars by default for proto3 */
+  uint8_t flags = 0;
+  if (label == PB_LABEL_REPEATED && type != PB_TYPE_STRING &&
+      type != PB_TYPE_BYTES && type != PB_TYPE_MESSAGE &&
+      (field->packed ? field->packed == 2 : loader->proto3)) {
+    flags = PB_FLAG_PACKED;
+  } else if (type == PB_TYPE_STRING && loader->proto3) {
+    flags = PB_FLAG_UTF8;
+  }
+
+  /* Encode tag and wiretype */
+  uint8_t data[5] = {};
+  uint32_t key = key_(field->tag, pb_field_descriptor_wiretype_map[type]);
+  size_t size = pb_varint_pack_uint32(data, &key);
+
+  /* Copy name and initialize field descriptor */
+  const char *name = copy(loader,
+    pb_string_data(&(field->name)), pb_string_size(&(field->name)));
+  if (unlikely_(!name))
+    return PB_ERROR_ALLOC;                                 /* LCOV_EXCL_LINE */
+  memcpy(descriptor, &(pb_field_descriptor_t){
+    .tag   = field->tag,
+    .name  = name,
+    .type  = type,
+    .label = label,
+    .refer = entry ? entry->descriptor : NULL,
+    .value = value,
+    .flags = flags,
+    .key   = { { data[0], data[1], data[2], data[3], data[4] },
+               (uint8_t)size }
+  }, sizeof(pb_field_descriptor_t));
+  return PB_ERROR_NONE;
+}
+
+/*!
+ * Create a message descriptor from the fields of the current message.
+ *
+ * Fields are ordered by tag, and the same lookup tables the generator emits
+ * are computed: an index of field positions by tag if tags are dense enough,
+ * or packed tags for binary search otherwise, a bitset of required fields and
+ * field positions sorted by name.
+ *
+ * \param[in,out] loader     Loader
+ * \param[out]    descriptor Descriptor
+ * \param[in]     oneofs     Oneof count
+ * \return                   Error code
+ */
+static pb_error_t
+message_create(
+    pb_descriptor_set_loader_t *loader, pb_descriptor_t *descriptor,
+    size_t oneofs) {
+  assert(loader && descriptor);
+  size_t size = pb_buffer_size(&(loader->fields)) /
+    sizeof(pb_descriptor_set_field_t);
+  if (!size)
+    return PB_ERROR_NONE;
+  if (unlikely_(size > UINT16_MAX))
+    return PB_ERROR_INVALID;
+
+  /* Sort fields by tag and ensure that tags are valid and unique */
+  pb_descriptor_set_field_t *fields =
+    (pb_descriptor_set_field_t *)loader->fields.data;
+  qsort(fields, size, sizeof(pb_descriptor_set_field_t), compare_field);
+  for (size_t f = 0; f < size; f++)
+    if (unlikely_(!fields[f].tag ||
+                  fields[f].tag > PB_DESCRIPTOR_SET_TAG_MAX ||
+                  (f && fields[f - 1].tag == fields[f].tag) ||
+                  fields[f].oneof < -1 ||
+                  (fields[f].oneof >= 0 && (size_t)fields[f].oneof >= oneofs)))
+      return PB_ERROR_INVALID;
+
+  /* Create oneof descriptors with positions of their members */
+  pb_oneof_descriptor_t *oneof = oneofs
+    ? allocate(loader, oneofs * sizeof(pb_oneof_descriptor_t))
+    : NULL;
+  if (unlikely_(oneofs && !oneof))
+    return PB_ERROR_ALLOC;                                 /* LCOV_EXCL_LINE */
+  for (size_t o = 0; o < oneofs; o++) {
+    size_t count = 0, *index = NULL;
+    for (size_t f = 0; f < size; f++)
+      count += fields[f].oneof == (int32_t)o;
+    if (count) {
+      if (unlikely_(!(index = allocate(loader, count * sizeof(size_t)))))
+        return PB_ERROR_ALLOC;                             /* LCOV_EXCL_LINE */
+      for (size_t f = 0, i = 0; f < size; f++)
+        if (fields[f].oneof == (int32_t)o)
+          index[i++] = f;
+    }
+    memcpy(&(oneof[o]), &(pb_oneof_descriptor_t){
+      descriptor, { index, count }
+    }, sizeof(pb_oneof_descriptor_t));
+  }
+
+  /* Create field descriptors */
+  pb_field_descriptor_t *data =
+    allocate(loader, size * sizeof(pb_field_descriptor_t));
+  if (unlikely_(!data))
+    return PB_ERROR_ALLOC;                                 /* LCOV_EXCL_LINE */
+  pb_error_t error = PB_ERROR_NONE;
+  for (size_t f = 0; !error && f < size; f++)
+    error = field_create(loader, &(fields[f]), oneof, &(data[f]));
+  if (unlikely_(error))
+    return error;
+
+  /* Create index of positions by tag, if tags are dense enough */
+  size_t words = (size + 63) / 64, range = fields[size - 1].tag -
+    fields[0].tag + 1;
+  uint16_t *index = NULL, *names = allocate(loader, size * sizeof(uint16_t));
+  uint64_t *required = allocate(loader, words * sizeof(uint64_t));
+  pb_tag_t *tags = NULL;
+  if (range <= (4 * size > 64 ? 4 * size : 64)) {
+    if (likely_((index = allocate(loader, range * sizeof(uint16_t))) != NULL))
+      for (size_t f = 0; f < size; f++)
+        index[fields[f].tag - fields[0].tag] = (uint16_t)(f + 1);
+
+  /* Create packed tags for binary search otherwise */
+  } else if ((tags = allocate(loader, size * sizeof(pb_tag_t)))) {
+    for (size_t f = 0; f < size; f++)
+      tags[f] = fields[f].tag;
+  }
+  if (unlikely_(!names || !required || (!index && !tags)))
+    return PB_ERROR_ALLOC;                                 /* LCOV_EXCL_LINE */
+
+  /* Create bitset of required positions */
+  for (size_t f = 0; f < size; f++)
+    if (data[f].label == PB_LABEL_REQUIRED)
+      required[f / 64] |= (uint64_t)1 << (f % 64);
+
+  /* Create positions sorted by name */
+  const pb_field_descriptor_t **order = (const pb_field_descriptor_t **)
+    pb_buffer_grow(&(loader->order), size * sizeof(*order));
+  if (unlikely_(!order))
+    return PB_ERROR_ALLOC;                                 /* LCOV_EXCL_LINE */
+  for (size_t f = 0; f < size; f++)
+    order[f] = &(data[f]);
+  qsort(order, size, sizeof(*order), compare_field_name);
+  for (size_t f = 0; f < size; f++)
+    names[f] = (uint16_t)(order[f] - data);
+  loader->order.size = 0;
+
+  /* Initialize descriptor */
+  memcpy(descriptor, &(pb_descriptor_t){
+    .field    = { data, size },
+    .index    = { index, index ? fields[0].tag : 0, index ? range : 0 },
+    .required = { required, words },
+    .name     = { names, size },
+    .tag      = { tags }
+  }, sizeof(pb_descriptor_t));
+  return PB_ERROR_NONE;
+}
+
+/*!
+ * Load an enum value declaration.
+ *
+ * \param[in,out] loader Loader
+ * \param[in]     data   Raw enum value declaration
+ * \param[in]     order  Position of declaration
+ * \return               Error code
+ */
+static pb_error_t
+value_load(
+    pb_descriptor_set_loader_t *loader, const pb_string_t *data,
+    size_t order) {
+  assert(loader && data);
+  pb_descriptor_set_value_t value = {
+    .order = order
+  };
+
+  /* Iterate tag-value pairs */
+  pb_buffer_t declaration = buffer(data);
+  pb_stream_t stream = pb_stream_create(&declaration);
+  pb_error_t error = PB_ERROR_NONE;
+  while (!error && pb_stream_left(&stream)) {
+    uint32_t key;
+    if ((error = pb_stream_read_uint32(&stream, &key)))
+      break;
+    switch (key) {
+      case key_(1, PB_WIRETYPE_LENGTH):
+        error = pb_stream_read_length(&stream, &(value.name));
+        break;
+      case key_(2, PB_WIRETYPE_VARINT):
+        error = pb_stream_read_typed(&stream, PB_TYPE_ENUM, &(value.number));
+        break;
+      default:
+        error = pb_decoder_skip_field(&stream, key);
+    }
+  }
+  pb_stream_destroy(&stream);
+  if (unlikely_(error || !pb_string_size(&(value.name))))
+    return PB_ERROR_INVALID;
+
+  /* Append value to values of current enum */
+  pb_descriptor_set_value_t *target = (pb_descriptor_set_value_t *)
+    pb_buffer_grow(&(loader->values), sizeof(pb_descriptor_set_value_t));
+  if (unlikely_(!target))
+    return PB_ERROR_ALLOC;                                 /* LCOV_EXCL_LINE */
+  *target = value;
+  return PB_ERROR_NONE;
+}
+
+/*!
+ * Create an enum descriptor from the values of the current enum.
+ *
+ * Values are ordered by number, and an index of value positions by number is
+ * computed if numbers are dense enough, as well as positions sorted by name.
+ *
+ * \param[in,out] loader     Loader
+ * \param[out]    descriptor Enum descriptor
+ * \param[out]    first      First declared value
+ * \return                   Error code
+ */
+static pb_error_t
+enum_create(
+    pb_descriptor_set_loader_t *loader, pb_enum_descriptor_t *descriptor,
+    pb_enum_t **first) {
+  assert(loader && descriptor && first);
+  size_t size = pb_buffer_size(&(loader->values)) /
+    sizeof(pb_descriptor_set_value_t);
+  if (!size)
+    return PB_ERROR_NONE;
+  if (unlikely_(size > UINT16_MAX))
+    return PB_ERROR_INVALID;
+
+  /* Remember first declared value and sort values by number */
+  pb_descriptor_set_value_t *values =
+    (pb_descriptor_set_value_t *)loader->values.data;
+  if (unlikely_(!(*first = allocate(loader, sizeof(pb_enum_t)))))
+    return PB_ERROR_ALLOC;                                 /* LCOV_EXCL_LINE */
+  **first = values[0].number;
+  qsort(values, size, sizeof(pb_descriptor_set_value_t), compare_value);
+
+  /* Create enum value descriptors */
+  pb_enum_value_descriptor_t *data =
+    allocate(loader, size * sizeof(pb_enum_value_descriptor_t));
+  if (unlikely_(!data))
+    return PB_ERROR_ALLOC;                                 /* LCOV_EXCL_LINE */
+  for (size_t v = 0; v < size; v++) {
+    const char *name = copy(loader,
+      pb_string_data(&(values[v].name)), pb_string_size(&(values[v].name)));
+    if (unlikely_(!name))
+      return PB_ERROR_ALLOC;                               /* LCOV_EXCL_LINE */
+    memcpy(&(data[v]), &(pb_enum_value_descriptor_t){
+      values[v].number, name
+    }, sizeof(pb_enum_value_descriptor_t));
+  }
+
+  /* Create index of first positions by number, if dense enough */
+  uint64_t range = (uint64_t)((int64_t)values[size - 1].number -
+    values[0].number) + 1;
+  uint16_t *index = NULL, *names = allocate(loader, size * sizeof(uint16_t));
+  if (range <= (4 * size > 64 ? 4 * size : 64)) {
+    if (likely_((index = allocate(loader, range * sizeof(uint16_t))) != NULL))
+      for (size_t v = size; v > 0; v--)
+        index[values[v - 1].number - values[0].number] = (uint16_t)v;
+    if (unlikely_(!index))
+      return PB_ERROR_ALLOC;                               /* LCOV_EXCL_LINE */
+  }
+  if (unlikely_(!names))
+    return PB_ERROR_ALLOC;                                 /* LCOV_EXCL_LINE */
+
+  /* Create positions sorted by name */
+  const pb_enum_value_descriptor_t **order =
+    (const pb_enum_value_descriptor_t **)
+      pb_buffer_grow(&(loader->order), size * sizeof(*order));
+  if (unlikely_(!order))
+    return PB_ERROR_ALLOC;                                 /* LCOV_EXCL_LINE */
+  for (size_t v = 0; v < size; v++)
+    order[v] = &(data[v]);
+  qsort(order, size, sizeof(*order), compare_value_name);
+  for (size_t v = 0; v < size; v++)
+    names[v] = (uint16_t)(order[v] - data);
+  loader->order.size = 0;
+
+  /* Initialize enum descriptor */
+  memcpy(descriptor, &(pb_enum_descriptor_t){
+    .value = { data, size },
+    .index = { index, index ? values[0].number : 0, index ? range : 0 },
+    .name  = { names, size }
+  }, sizeof(pb_enum_descriptor_t));
+  return PB_ERROR_NONE;
+}
+
+/*!
+ * Load an enum declaration.
+ *
+ * Enums don't reference other declarations, so they are created and
+ * registered at once.
+ *
+ * \param[in,out] loader Loader
+ * \param[in]     data   Raw enum declaration
+ * \return               Error code
+ */
+static pb_error_t
+enum_load(pb_descriptor_set_loader_t *loader, const pb_string_t *data) {
+  assert(loader && data);
+  pb_string_t name = {};
+  loader->values.size = 0;
+
+  /* Iterate tag-value pairs */
+  pb_buffer_t declaration = buffer(data);
+  pb_stream_t stream = pb_stream_create(&declaration);
+  pb_error_t error = PB_ERROR_NONE;
+  for (size_t order = 0; !error && pb_stream_left(&stream); ) {
+    uint32_t key;
+    pb_string_t value;
+    if ((error = pb_stream_read_uint32(&stream, &key)))
+      break;
+    switch (key) {
+      case key_(1, PB_WIRETYPE_LENGTH):
+        error = pb_stream_read_length(&stream, &name);
+        break;
+      case key_(2, PB_WIRETYPE_LENGTH):
+        if (!(error = pb_stream_read_length(&stream, &value)))
+          error = value_load(loader, &value, order++);
+        break;
+      default:
+        error = pb_decoder_skip_field(&stream, key);
+    }
+  }
+  pb_stream_destroy(&stream);
+  if (unlikely_(error))
+    return error == PB_ERROR_ALLOC ? error : PB_ERROR_INVALID;
+
+  /* Create and register enum descriptor */
+  size_t size;
+  if (unlikely_(error = scope_enter(loader, &name, &size)))
+    return error;
+  pb_enum_descriptor_t *descriptor =
+    allocate(loader, sizeof(pb_enum_descriptor_t));
+  pb_enum_t *first = NULL;
+  if (unlikely_(!descriptor))
+    error = PB_ERROR_ALLOC;                                /* LCOV_EXCL_LINE */
+  else if (!(error = enum_create(loader, descriptor, &first)))
+    error = entry_register(loader, PB_TYPE_ENUM, descriptor, first);
+  loader->scope.size = size;
+  return error;
+}
+
+/*!
+ * Load a message declaration.
+ *
+ * Upon registration, an empty descriptor is registered for every message and
+ * all enums are created. Upon resolution, fields are resolved against all
+ * registered descriptors and the descriptor is created, before descending
+ * into nested messages.
+ *
+ * \param[in,out] loader Loader
+ * \param[in]     data   Raw message declaration
+ * \return               Error code
+ */
+static pb_error_t
+message_load(pb_descriptor_set_loader_t *loader, const pb_string_t *data) {
+  assert(loader && data);
+  if (unlikely_(loader->depth == PB_DESCRIPTOR_SET_DEPTH))
+    return PB_ERROR_INVALID;
+  pb_string_t name = {};
+  size_t oneofs = 0;
+  loader->fields.size = 0;
+
+  /* Extract name, fields and oneof count */
+  pb_buffer_t declaration = buffer(data);
+  pb_stream_t stream = pb_stream_create(&declaration);
+  pb_error_t error = PB_ERROR_NONE;
+  while (!error && pb_stream_left(&stream)) {
+    uint32_t key;
+    pb_string_t value;
+    if ((error = pb_stream_read_uint32(&stream, &key)))
+      break;
+    switch (key) {
+      case key_(1, PB_WIRETYPE_LENGTH):
+        error = pb_stream_read_length(&stream, &name);
+        break;
+      case key_(2, PB_WIRETYPE_LENGTH):
+        if (!(error = pb_stream_read_length(&stream, &value)) &&
+            loader->resolve)
+          error = field_load(loader, &value);
+        break;
+      case key_(8, PB_WIRETYPE_LENGTH):
+        error = pb_stream_read_length(&stream, &value);
+        oneofs++;
+        break;
+      default:
+        error = pb_decoder_skip_field(&stream, key);
+    }
+  }
+  if (unlikely_(error)) {
+    pb_stream_destroy(&stream);
+    return error == PB_ERROR_ALLOC ? error : PB_ERROR_INVALID;
+  }
+
+  /* Register empty descriptor or create descriptor */
+  size_t size;
+  if (unlikely_(error = scope_enter(loader, &name, &size))) {
+    pb_stream_destroy(&stream);
+    return error;
+  }
+  if (!loader->resolve) {
+    pb_descriptor_t *descriptor = allocate(loader, sizeof(pb_descriptor_t));
+    error = descriptor
+      ? entry_register(loader, PB_TYPE_MESSAGE, descriptor, NULL)
+      : PB_ERROR_ALLOC;                                    /* LCOV_EXCL_LINE */
+  } else {
+    const pb_descriptor_set_entry_t *entry = lookup(loader->set,
+      (const char *)pb_buffer_data(&(loader->scope)),
+      pb_buffer_size(&(loader->scope)));
+    assert(entry && entry->type == PB_TYPE_MESSAGE);
+    error = message_create(loader,
+      (pb_descriptor_t *)entry->descriptor, oneofs);
+  }
+
+  /* Descend into nested messages and enums */
+  loader->depth++;
+  pb_stream_t nested = pb_stream_create(&declaration);
+  while (!error && pb_stream_left(&nested)) {
+    uint32_t key;
+    pb_string_t value;
+    if ((error = pb_stream_read_uint32(&nested, &key)))
+      break;
+    switch (key) {
+      case key_(3, PB_WIRETYPE_LENGTH):
+        if (!(error = pb_stream_read_length(&nested, &value)))
+          error = message_load(loader, &value);
+        break;
+      case key_(4, PB_WIRETYPE_LENGTH):
+        if (!(error = pb_stream_read_length(&nested, &value)) &&
+            !loader->resolve)
+          error = enum_load(loader, &value);
+        break;
+      default:
+        error = pb_decoder_skip_field(&nested, key);
+    }
+  }
+  pb_stream_destroy(&nested);
+  loader->depth--;
+  loader->scope.size = size;
+  return error;
+}
+
+/*!
+ * Load a file declaration.
+ *
+ * \param[in,out] loader Loader
+ * \param[in]     data   Raw file declaration
+ * \return               Error code
+ */
+static pb_error_t
+file_load(pb_descriptor_set_loader_t *loader, const pb_string_t *data) {
+  assert(loader && data);
+  pb_string_t package = {}, syntax = {};
+
+  /* Extract package and syntax, which follow all declarations */
+  pb_buffer_t declaration = buffer(data);
+  pb_stream_t stream = pb_stream_create(&declaration);
+  pb_error_t error = PB_ERROR_NONE;
+  while (!error && pb_stream_left(&stream)) {
+    uint32_t key;
+    if ((error = pb_stream_read_uint32(&stream, &key)))
+      break;
+    switch (key) {
+      case key_(2, PB_WIRETYPE_LENGTH):
+        error = pb_stream_read_length(&stream, &package);
+        break;
+      case key_(12, PB_WIRETYPE_LENGTH):
+        error = pb_stream_read_length(&stream, &syntax);
+        break;
+      default:
+        error = pb_decoder_skip_field(&stream, key);
+    }
+  }
+  pb_stream_destroy(&stream);
+  if (unlikely_(error))
+    return PB_ERROR_INVALID;
+  loader->proto3 = pb_string_size(&syntax) == 6 &&
+    !memcmp(pb_string_data(&syntax), "proto3", 6);
+
+  /* Enter package scope, if any */
+  size_t size = 0;
+  if (pb_string_size(&package) &&
+      unlikely_(error = scope_enter(loader, &package, &size)))
+    return error;
+
+  /* Load messages and enums */
+  pb_stream_t nested = pb_stream_create(&declaration);
+  while (!error && pb_stream_left(&nested)) {
+    uint32_t key;
+    pb_string_t value;
+    if ((error = pb_stream_read_uint32(&nested, &key)))
+      break;
+    switch (key) {
+      case key_(4, PB_WIRETYPE_LENGTH):
+        if (!(error = pb_stream_read_length(&nested, &value)))
+          error = message_load(loader, &value);
+        break;
+      case key_(5, PB_WIRETYPE_LENGTH):
+        if (!(error = pb_stream_read_length(&nested, &value)) &&
+            !loader->resolve)
+          error = enum_load(loader, &value);
+        break;
+      default:
+        error = pb_decoder_skip_field(&nested, key);
+    }
+  }
+  pb_stream_destroy(&nested);
+  loader->scope.size = size;
+  return error;
+}
+
+/*!
+ * Load all files of a descriptor set in one pass.
+ *
+ * \param[in,out] loader Loader
+ * \param[in]     buffer Buffer
+ * \return               Error code
+ */
+static pb_error_t
+set_load(pb_descriptor_set_loader_t *loader, const pb_buffer_t *buffer) {
+  assert(loader && buffer);
+  pb_stream_t stream = pb_stream_create(buffer);
+  pb_error_t error = PB_ERROR_NONE;
+  while (!error && pb_stream_left(&stream)) {
+    uint32_t key;
+    pb_string_t value;
+    if ((error = pb_stream_read_uint32(&stream, &key)))
+      break;
+    if (key == key_(1, PB_WIRETYPE_LENGTH)) {
+      if (!(error = pb_stream_read_length(&stream, &value)))
+        error = file_load(loader, &value);
+    } else {
+      error = pb_decoder_skip_field(&stream, key);
+    }
+  }
+  pb_stream_destroy(&stream);
+  if (unlikely_(error && error != PB_ERROR_ALLOC))
+    error = PB_ERROR_INVALID;
+  return error;
+}
+
+/* ----------------------------------------------------------------------------
+ * Interface
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Create a descriptor set from a serialized FileDescriptorSet.
+ *
+ * The descriptor set can be created with protoc's --descriptor_set_out
+ * option, including imports, so all referenced types can be resolved. All
+ * message and enum descriptors are allocated from a single arena and come
+ * with the same lookup tables the generator emits, so they are as fast as
+ * generated descriptors for encoding, decoding and lookups by tag or name.
+ *
+ * Files are loaded in two passes: the first creates all enums and registers
+ * an empty descriptor for every message, and the second resolves the fields
+ * of all messages. Extensions are skipped and groups are rejected.
+ *
+ * \param[in] buffer Buffer
+ * \return           Descriptor set
+ */
+extern pb_descriptor_set_t
+pb_descriptor_set_create(const pb_buffer_t *buffer) {
+  assert(buffer);
+  pb_descriptor_set_t set = {
+    .allocator = pb_arena_allocator_create(
+      PB_DESCRIPTOR_SET_REGION + 4 * pb_buffer_size(buffer)),
+    .entry     = { NULL, 0 },
+    .error     = PB_ERROR_NONE
+  };
+  if (unlikely_(!set.allocator.data)) {
+    set.error = PB_ERROR_ALLOC;                            /* LCOV_EXCL_LINE */
+    return set;                                            /* LCOV_EXCL_LINE */
+  }
+  if (unlikely_(!pb_buffer_valid(buffer))) {
+    set.error = PB_ERROR_INVALID;
+    return set;
+  }
+  pb_descriptor_set_loader_t loader = {
+    .set     = &set,
+    .resolve = 0,
+    .proto3  = 0,
+    .depth   = 0,
+    .scope   = pb_buffer_create_empty(),
+    .name    = pb_buffer_create_empty(),
+    .entries = pb_buffer_create_empty(),
+    .fields  = pb_buffer_create_empty(),
+    .values  = pb_buffer_create_empty(),
+    .order   = pb_buffer_create_empty()
+  };
+
+  /* Register all messages and enums */
+  pb_error_t error = set_load(&loader, buffer);
+  size_t size = pb_buffer_size(&(loader.entries)) /
+    sizeof(pb_descriptor_set_entry_t);
+  if (!error && size) {
+    pb_descriptor_set_entry_t *entries =
+      allocate(&loader, size * sizeof(pb_descriptor_set_entry_t));
+    if (likely_(entries != NULL)) {
+      memcpy(entries, loader.entries.data,
+        size * sizeof(pb_descriptor_set_entry_t));
+
+      /* Sort entries by full name and ensure that names are unique */
+      qsort(entries, size, sizeof(pb_descriptor_set_entry_t), compare_entry);
+      for (size_t e = 1; !error && e < size; e++)
+        if (unlikely_(!strcmp(entries[e - 1].name, entries[e].name)))
+          error = PB_ERROR_INVALID;
+      set.entry.data = entries;
+      set.entry.size = size;
+    } else {
+      error = PB_ERROR_ALLOC;                              /* LCOV_EXCL_LINE */
+    }
+  }
+
+  /* Resolve fields of all messages */
+  if (!error) {
+    loader.resolve = 1;
+    error = set_load(&loader, buffer);
+  }
+
+  /* Free all allocated memory */
+  pb_buffer_destroy(&(loader.order));
+  pb_buffer_destroy(&(loader.values));
+  pb_buffer_destroy(&(loader.fields));
+  pb_buffer_destroy(&(loader.entries));
+  pb_buffer_destroy(&(loader.name));
+  pb_buffer_destroy(&(loader.scope));
+  if (unlikely_(error)) {
+    set.entry.data = NULL;
+    set.entry.size = 0;
+    set.error      = error;
+  }
+  return set;
+}
+
+/*!
+ * Destroy a descriptor set.
+ *
+ * All descriptors of the descriptor set are freed at once, so they must not
+ * be used anymore.
+ *
+ * \param[in,out] set Descriptor set
+ */
+extern void
+pb_descriptor_set_destroy(pb_descriptor_set_t *set) {
+  assert(set);
+  pb_arena_allocator_destroy(&(set->allocator));
+}
+
+/*!
+ * Retrieve a message descriptor from a descriptor set by full name.
+ *
+ * \param[in] set    Descriptor set
+ * \param[in] name[] Full name, optionally with leading dot
+ * \return           Descriptor, NULL if not found
+ */
+extern const pb_descriptor_t *
+pb_descriptor_set_message(const pb_descriptor_set_t *set, const char name[]) {
+  assert(set && name);
+  if (name[0] == '.')
+    name++;
+  const pb_descriptor_set_entry_t *entry = lookup(set, name, strlen(name));
+  return entry && entry->type == PB_TYPE_MESSAGE
+    ? entry->descriptor
+    : NULL;
+}
+
+/*!
+ * Retrieve an enum descriptor from a descriptor set by full name.
+ *
+ * \param[in] set    Descriptor set
+ * \param[in] name[] Full name, optionally with leading dot
+ * \return           Enum descriptor, NULL if not found
+ */
+extern const pb_enum_descriptor_t *
+pb_descriptor_set_enum(const pb_descriptor_set_t *set, const char name[]) {
+  assert(set && name);
+  if (name[0] == '.')
+    name++;
+  const pb_descriptor_set_entry_t *entry = lookup(set, name, strlen(name));
+  return entry && entry->type == PB_TYPE_ENUM
+    ? entry->descriptor
+    : NULL;
+}
@@ -0,0 +1,349 @@
+/*
+ * Copyright (c) 2013-2020 Martin Donath <martin.donath@squidfunk.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#define _GNU_SOURCE
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "core/allocator.h"
+#include "core/common.h"
+#include "util/hugepage_allocator.h"
+
+/* ----------------------------------------------------------------------------
+ * Constants
+ * ------------------------------------------------------------------------- */
+
+/*! Alignment of memory blocks */
+#define PB_HUGEPAGE_ALLOCATOR_ALIGNMENT 16
+
+/*! Size of a huge page */
+#define PB_HUGEPAGE_ALLOCATOR_PAGE      (2 << 20)
+
+/*! Minimum size of memory blocks backed by huge pages */
+#define PB_HUGEPAGE_ALLOCATOR_THRESHOLD (1 << 20)
+
+/*! Maximum number of NUMA nodes */
+#define PB_HUGEPAGE_ALLOCATOR_NODES     1024
+
+/*! Memory policy preferring a single node, see <linux/mempolicy.h> */
+#define PB_HUGEPAGE_ALLOCATOR_PREFERRED 1
+
+/* ----------------------------------------------------------------------------
+ * Type definitions
+ * ------------------------------------------------------------------------- */
+
+typedef struct pb_hugepage_header_t {
+  size_t size;                         /*!< Mapping size, 0 if not mapped */
+  size_t capacity;                     /*!< Block capacity */
+} pb_hugepage_header_t;
+
+typedef struct pb_hugepage_allocator_t {
+  pb_allocator_t *inner;               /*!< Allocator for small blocks */
+  int node;                            /*!< NUMA node */
+} pb_hugepage_allocator_t;
+
+/* ----------------------------------------------------------------------------
+ * Macros
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Size of the (aligned) header of memory blocks.
+ */
+#define block_header \
+  ((sizeof(pb_hugepage_header_t) + PB_HUGEPAGE_ALLOCATOR_ALIGNMENT - 1) & \
+    ~((size_t)PB_HUGEPAGE_ALLOCATOR_ALIGNMENT - 1))
+
+/*!
+ * Retrieve the header of a memory block.
+ *
+ * \param[in] block Memory block
+ * \return          Header
+ */
+#define header_from_block(block) \
+  (assert(block), \
+    (pb_hugepage_header_t *)((uint8_t *)(block) - block_header))
+
+/*!
+ * Retrieve the memory block of a header.
+ *
+ * \param[in] header Header
+ * \return           Memory block
+ */
+#define block_from_header(header) \
+  (assert(header), (void *)((uint8_t *)(header) + block_header))
+
+/* ----------------------------------------------------------------------------
+ * Internal functions
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Bind a mapping to the NUMA node of a huge-page allocator.
+ *
+ * Binding is best effort: if the node is not available, or the system does
+ * not support NUMA, the mapping is left to the default memory policy.
+ *
+ * \param[in]     base   Huge-page allocator
+ * \param[in,out] addr   Mapping
+ * \param[in]     length Mapping size
+ */
+static void
+map_bind(const pb_hugepage_allocator_t *base, void *addr, size_t length) {
+  assert(base && addr && length);
+#if defined(SYS_mbind) && defined(SYS_getcpu)
+  int node = base->node;
+  if (node == PB_HUGEPAGE_ALLOCATOR_NODE_LOCAL) {
+    unsigned int cpu, local;
+    node = syscall(SYS_getcpu, &cpu, &local, NULL) ? -1 : (int)local;
+  }
+
+  /* Prefer the node for all pages of the mapping */
+  if (node >= 0 && node < PB_HUGEPAGE_ALLOCATOR_NODES) {
+    const size_t bits = 8 * sizeof(unsigned long);
+    unsigned long mask[
+      PB_HUGEPAGE_ALLOCATOR_NODES / (8 * sizeof(unsigned long))] = { 0 };
+    mask[node / bits] |= 1UL << (node % bits);
+    syscall(SYS_mbind, addr, length, PB_HUGEPAGE_ALLOCATOR_PREFERRED,
+      mask, PB_HUGEPAGE_ALLOCATOR_NODES + 1, 0);
+  }
+#endif
+}
+
+/*!
+ * Create a mapping backed by huge pages for a memory block of given size.
+ *
+ * Explicit huge pages are tried first, which are only available if they have
+ * been reserved by the system administrator. Otherwise, a regular mapping is
+ * created and marked as eligible for transparent huge pages.
+ *
+ * \param[in] base Huge-page allocator
+ * \param[in] size Bytes to be allocated
+ * \return         Header
+ */
+static pb_hugepage_header_t *
+map_create(const pb_hugepage_allocator_t *base, size_t size) {
+  assert(base && size);
+  size_t length = (block_header + size + PB_HUGEPAGE_ALLOCATOR_PAGE - 1) &
+    ~((size_t)PB_HUGEPAGE_ALLOCATOR_PAGE - 1);
+  void *addr = MAP_FAILED;
+#ifdef MAP_HUGETLB
+  addr = mmap(NULL, length, PROT_READ | PROT_WRITE,
+    MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+#endif
+  if (addr == MAP_FAILED) {
+    addr = mmap(NULL, length, PROT_READ | PROT_WRITE,
+      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (unlikely_(addr == MAP_FAILED))
+      return NULL;                                         /* LCOV_EXCL_LINE */
+#ifdef MADV_HUGEPAGE
+    madvise(addr, length, MADV_HUGEPAGE);
+#endif
+  }
+
+  /* Bind mapping before it is touched for the first time */
+  map_bind(base, addr, length);
+  pb_hugepage_header_t *header = addr;
+  *header = (pb_hugepage_header_t){
+    .size     = length,
+    .capacity = length - block_header
+  };
+  return header;
+}
+
+/*!
+ * Release a memory block into the mapping or allocator it was taken from.
+ *
+ * \param[in,out] base  Huge-page allocator
+ * \param[in,out] block Memory block
+ */
+static void
+block_release(pb_hugepage_allocator_t *base, void *block) {
+  assert(base && block);
+  pb_hugepage_header_t *header = header_from_block(block);
+  if (header->size) {
+    munmap(header, header->size);
+  } else {
+    pb_allocator_free(base->inner, header);
+  }
+}
+
+/* ----------------------------------------------------------------------------
+ * Allocator callbacks
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Allocate a memory block of given size.
+ *
+ * Large memory blocks are backed by a mapping of huge pages, small memory
+ * blocks are taken from the inner allocator.
+ *
+ * \param[in,out] data Internal allocator data
+ * \param[in]     size Bytes to be allocated
+ * \return             Memory block
+ */
+static void *
+allocator_allocate(void *data, size_t size) {
+  assert(size);
+  if (unlikely_(!data))
+    return NULL;
+
+  /* Back large blocks with huge pages */
+  pb_hugepage_allocator_t *base = data;
+  pb_hugepage_header_t *header;
+  if (size >= PB_HUGEPAGE_ALLOCATOR_THRESHOLD) {
+    header = map_create(base, size);
+
+  /* Take small blocks from the inner allocator */
+  } else if ((header = pb_allocator_allocate(base->inner,
+      block_header + size))) {
+    *header = (pb_hugepage_header_t){
+      .size     = 0,
+      .capacity = size
+    };
+  }
+  return header ? block_from_header(header) : NULL;
+}
+
+/*!
+ * Change the size of a previously allocated memory block.
+ *
+ * Small memory blocks are resized by the inner allocator as long as they
+ * stay below the threshold for huge pages. Otherwise, a new memory block is
+ * allocated and the contents are copied. Shrinking never moves a block.
+ *
+ * \param[in,out] data  Internal allocator data
+ * \param[in,out] block Memory block to be resized
+ * \param[in]     size  Bytes to be allocated
+ * \return              Memory block
+ */
+static void *
+allocator_resize(void *data, void *block, size_t size) {
+  assert(size);
+  if (unlikely_(!data))
+    return NULL;
+  if (unlikely_(!block))
+    return allocator_allocate(data, size);
+
+  /* Keep block, if large enough */
+  pb_hugepage_allocator_t *base   = data;
+  pb_hugepage_header_t    *header = header_from_block(block);
+  if (size <= header->capacity)
+    return block;
+
+  /* Resize small blocks with the inner allocator */
+  if (!header->size && size < PB_HUGEPAGE_ALLOCATOR_THRESHOLD) {
+    pb_hugepage_header_t *target =
+      pb_allocator_resize(base->inner, header, block_header + size);
+    if (unlikely_(!target))
+      return NULL;                                         /* LCOV_EXCL_LINE */
+    target->capacity = size;
+    return block_from_header(target);
+  }
+
+  /* Allocate a new block and copy contents */
+  void *target = allocator_allocate(data, size);
+  if (likely_(target != NULL)) {
+    memcpy(target, block, header->capacity);
+    block_release(base, block);
+  }
+  return target;
+}
+
+/*!
+ * Free an allocated memory block.
+ *
+ * \param[in,out] data  Internal allocator data
+ * \param[in,out] block Memory block to be freed
+ */
+static void
+allocator_free(void *data, void *block) {
+  assert(data && block);
+  block_release(data, block);
+}
+
+/* ----------------------------------------------------------------------------
+ * Interface
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Create a huge-page allocator bound to the node of the allocating thread.
+ *
+ * Every large memory block is bound to the NUMA node of the thread which
+ * allocates it, so pages touched by other threads don't end up elsewhere.
+ *
+ * \param[in,out] inner Allocator for small blocks
+ * \return              Huge-page allocator
+ */
+extern pb_allocator_t
+pb_hugepage_allocator_create(pb_allocator_t *inner) {
+  assert(inner);
+  return pb_hugepage_allocator_create_with_node(inner,
+    PB_HUGEPAGE_ALLOCATOR_NODE_LOCAL);
+}
+
+/*!
+ * Create a huge-page allocator bound to the given NUMA node.
+ *
+ * \param[in,out] inner Allocator for small blocks
+ * \param[in]     node  NUMA node
+ * \return              Huge-page allocator
+ */
+extern pb_allocator_t
+pb_hugepage_allocator_create_with_node(pb_allocator_t *inner, int node) {
+  assert(inner && node >= PB_HUGEPAGE_ALLOCATOR_NODE_LOCAL);
+  pb_allocator_t allocator = {
+    .proc = {
+      .allocate = allocator_allocate,
+      .resize   = allocator_resize,
+      .free     = allocator_free
+    },
+    .data = NULL
+  };
+  pb_hugepage_allocator_t *base = malloc(sizeof(pb_hugepage_allocator_t));
+  if (base) {
+    *base = (pb_hugepage_allocator_t){
+      .inner = inner,
+      .node  = node
+    };
+    allocator.data = base;
+  }
+  return allocator;
+}
+
+/*!
+ * Destroy a huge-page allocator.
+ *
+ * Memory blocks that are still allocated are not freed, so all blocks must
+ * be freed before the allocator is destroyed.
+ *
+ * \param[in,out] allocator Huge-page allocator
+ */
+extern void
+pb_hugepage_allocator_destroy(pb_allocator_t *allocator) {
+  assert(allocator);
+  free(allocator->data);
+}
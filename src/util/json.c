@@ -0,0 +1,1359 @@
+/*
+ * Copyright (c) 2013-2020 Martin Donath <martin.donath@squidfunk.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <assert.h>
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "core/buffer.h"
+#include "core/common.h"
+#include "core/decoder.h"
+#include "core/descriptor.h"
+#include "core/encoder.h"
+#include "util/descriptor.h"
+#include "util/json.h"
+
+/* ----------------------------------------------------------------------------
+ * Defines
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Maximum nesting depth of objects and arrays when reading JSON.
+ */
+#define PB_JSON_DEPTH 64
+
+/*!
+ * Maximum length of names of fields and enum values, including the
+ * terminating null byte, as they must be copied for lookup.
+ */
+#define PB_JSON_NAME 128
+
+/*!
+ * Maximum length of number tokens, including the terminating null byte.
+ */
+#define PB_JSON_TOKEN 64
+
+/*!
+ * Number of values of repeated scalar fields that are encoded at once, which
+ * results in a single packed field for packed fields of up to this size.
+ */
+#define PB_JSON_BATCH 64
+
+/* ----------------------------------------------------------------------------
+ * Type definitions
+ * ------------------------------------------------------------------------- */
+
+typedef struct pb_json_writer_t {
+  pb_buffer_t *buffer;                 /*!< Buffer */
+  const pb_field_descriptor_t *field;  /*!< Field descriptor of last member */
+  size_t size;                         /*!< Member count */
+} pb_json_writer_t;
+
+typedef struct pb_json_reader_t {
+  const uint8_t *data;                 /*!< Raw data */
+  size_t size;                         /*!< Raw data size */
+  size_t offset;                       /*!< Current offset */
+  pb_buffer_t scratch;                 /*!< Buffer for unescaped strings */
+  size_t depth;                        /*!< Nesting depth */
+} pb_json_reader_t;
+
+/* ----------------------------------------------------------------------------
+ * Mappings
+ * ------------------------------------------------------------------------- */
+
+/*! Mapping: number ==> pair of decimal digits */
+static const char
+digit_map[] =
+  "00010203040506070809"
+  "10111213141516171819"
+  "20212223242526272829"
+  "30313233343536373839"
+  "40414243444546474849"
+  "50515253545556575859"
+  "60616263646566676869"
+  "70717273747576777879"
+  "80818283848586878889"
+  "90919293949596979899";
+
+/*! Mapping: nibble ==> hexadecimal digit */
+static const char
+hex_map[] = "0123456789abcdef";
+
+/*! Mapping: byte ==> escape character, or zero if no escape is necessary */
+static const char
+escape_map[256] = {
+  [0x00] = 'u', [0x01] = 'u', [0x02] = 'u', [0x03] = 'u',
+  [0x04] = 'u', [0x05] = 'u', [0x06] = 'u', [0x07] = 'u',
+  [0x08] = 'b', [0x09] = 't', [0x0A] = 'n', [0x0B] = 'u',
+  [0x0C] = 'f', [0x0D] = 'r', [0x0E] = 'u', [0x0F] = 'u',
+  [0x10] = 'u', [0x11] = 'u', [0x12] = 'u', [0x13] = 'u',
+  [0x14] = 'u', [0x15] = 'u', [0x16] = 'u', [0x17] = 'u',
+  [0x18] = 'u', [0x19] = 'u', [0x1A] = 'u', [0x1B] = 'u',
+  [0x1C] = 'u', [0x1D] = 'u', [0x1E] = 'u', [0x1F] = 'u',
+  ['"']  = '"', ['\\'] = '\\'
+};
+
+/*! Mapping: 6-bit value ==> base64 character */
+static const char
+base64_map[] =
+  "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+/*! Mapping: base64 character ==> 6-bit value, including the URL alphabet */
+static const uint8_t
+base64_value_map[256] = {
+  255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+  255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+  255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+  255, 255, 255, 255, 255, 255, 255,  62, 255,  62, 255,  63,
+   52,  53,  54,  55,  56,  57,  58,  59,  60,  61, 255, 255,
+  255, 255, 255, 255, 255,   0,   1,   2,   3,   4,   5,   6,
+    7,   8,   9,  10,  11,  12,  13,  14,  15,  16,  17,  18,
+   19,  20,  21,  22,  23,  24,  25, 255, 255, 255, 255,  63,
+  255,  26,  27,  28,  29,  30,  31,  32,  33,  34,  35,  36,
+   37,  38,  39,  40,  41,  42,  43,  44,  45,  46,  47,  48,
+   49,  50,  51, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+  255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+  255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+  255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+  255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+  255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+  255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+  255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+  255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+  255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+  255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+  255, 255, 255, 255
+};
+
+/* ----------------------------------------------------------------------------
+ * Forward declarations
+ * ------------------------------------------------------------------------- */
+
+static pb_error_t
+write_object(
+  pb_buffer_t *buffer,                 /* Buffer */
+  const pb_decoder_t *decoder);        /* Decoder */
+
+static pb_error_t
+read_object(
+  pb_json_reader_t *reader,            /* Reader */
+  pb_encoder_t *encoder);              /* Encoder */
+
+/* ----------------------------------------------------------------------------
+ * Internal functions: writing
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Append raw data to a buffer.
+ *
+ * \param[in,out] buffer Buffer
+ * \param[in]     data[] Raw data
+ * \param[in]     size   Raw data size
+ * \return               Error code
+ */
+PB_INLINE pb_error_t
+write_raw(pb_buffer_t *buffer, const void *data, size_t size) {
+  assert(buffer && (data || !size));
+  if (unlikely_(!size))
+    return PB_ERROR_NONE;
+  uint8_t *target = pb_buffer_grow(buffer, size);
+  if (unlikely_(!target))
+    return PB_ERROR_ALLOC;
+  memcpy(target, data, size);
+  return PB_ERROR_NONE;
+}
+
+/*!
+ * Write an integer given as sign and magnitude.
+ *
+ * Digits are generated in pairs from the back, which halves the number of
+ * divisions compared to printf(). 64-bit integers are quoted, as JSON
+ * numbers are commonly read as doubles, which cannot represent them exactly.
+ *
+ * \param[in,out] buffer    Buffer
+ * \param[in]     magnitude Magnitude
+ * \param[in]     negative  Whether the integer is negative
+ * \param[in]     quoted    Whether to quote the integer
+ * \return                  Error code
+ */
+static pb_error_t
+write_integer(
+    pb_buffer_t *buffer, uint64_t magnitude, int negative, int quoted) {
+  assert(buffer);
+  char data[23];
+  size_t d = sizeof(data);
+  if (quoted)
+    data[--d] = '"';
+
+  /* Generate digits in pairs */
+  while (magnitude >= 100) {
+    size_t pair = (magnitude % 100) * 2;
+    magnitude /= 100;
+    data[--d] = digit_map[pair + 1];
+    data[--d] = digit_map[pair];
+  }
+  if (magnitude >= 10) {
+    data[--d] = digit_map[magnitude * 2 + 1];
+    data[--d] = digit_map[magnitude * 2];
+  } else {
+    data[--d] = (char)('0' + magnitude);
+  }
+
+  /* Prepend sign and quote */
+  if (negative)
+    data[--d] = '-';
+  if (quoted)
+    data[--d] = '"';
+  return write_raw(buffer, &(data[d]), sizeof(data) - d);
+}
+
+/*!
+ * Write a signed integer.
+ *
+ * \param[in,out] buffer Buffer
+ * \param[in]     value  Value
+ * \param[in]     quoted Whether to quote the integer
+ * \return               Error code
+ */
+PB_INLINE pb_error_t
+write_signed(pb_buffer_t *buffer, int64_t value, int quoted) {
+  assert(buffer);
+  return write_integer(buffer, value < 0
+    ? 0 - (uint64_t)value
+    : (uint64_t)value, value < 0, quoted);
+}
+
+/*!
+ * Write a floating point number.
+ *
+ * The shortest of the two precisions that reads back as the same value is
+ * chosen. Non-finite values are written as quoted strings, as JSON has no
+ * representation for them.
+ *
+ * \param[in,out] buffer Buffer
+ * \param[in]     value  Value
+ * \param[in]     single Whether the value is a single-precision float
+ * \return               Error code
+ */
+static pb_error_t
+write_float(pb_buffer_t *buffer, double value, int single) {
+  assert(buffer);
+  if (isnan(value))
+    return write_raw(buffer, "\"NaN\"", 5);
+  if (isinf(value))
+    return value > 0
+      ? write_raw(buffer, "\"Infinity\"", 10)
+      : write_raw(buffer, "\"-Infinity\"", 11);
+
+  /* Try short precision first, then fall back to round-trip precision */
+  char data[32];
+  int size = snprintf(data, sizeof(data), "%.*g", single ? 6 : 15, value);
+  if (single ? strtof(data, NULL) != (float)value
+             : strtod(data, NULL) != value)
+    size = snprintf(data, sizeof(data), "%.*g", single ? 9 : 17, value);
+  return write_raw(buffer, data, size);
+}
+
+/*!
+ * Write a string, escaping quotes, backslashes and control characters.
+ *
+ * Runs of characters that need no escaping are copied at once.
+ *
+ * \param[in,out] buffer Buffer
+ * \param[in]     data[] Raw data
+ * \param[in]     size   Raw data size
+ * \return               Error code
+ */
+static pb_error_t
+write_string(pb_buffer_t *buffer, const uint8_t data[], size_t size) {
+  assert(buffer && (data || !size));
+  pb_error_t error = write_raw(buffer, "\"", 1);
+  size_t start = 0;
+  for (size_t c = 0; !error && c < size; c++) {
+    char escape = escape_map[data[c]];
+    if (likely_(!escape))
+      continue;
+
+    /* Copy run of characters that need no escaping */
+    if (unlikely_(error = write_raw(buffer, &(data[start]), c - start)))
+      break;
+    start = c + 1;
+
+    /* Write escape sequence */
+    char sequence[6] = { '\\', escape, '0', '0',
+      hex_map[data[c] >> 4], hex_map[data[c] & 15] };
+    error = write_raw(buffer, sequence, escape == 'u' ? 6 : 2);
+  }
+  if (likely_(!error))
+    error = write_raw(buffer, &(data[start]), size - start);
+  return likely_(!error)
+    ? write_raw(buffer, "\"", 1)
+    : error;
+}
+
+/*!
+ * Write a byte array as a quoted base64 string.
+ *
+ * \param[in,out] buffer Buffer
+ * \param[in]     data[] Raw data
+ * \param[in]     size   Raw data size
+ * \return               Error code
+ */
+static pb_error_t
+write_bytes(pb_buffer_t *buffer, const uint8_t data[], size_t size) {
+  assert(buffer && (data || !size));
+  uint8_t *target = pb_buffer_grow(buffer, 4 * ((size + 2) / 3) + 2);
+  if (unlikely_(!target))
+    return PB_ERROR_ALLOC;
+
+  /* Encode groups of three bytes as four characters */
+  *target++ = '"';
+  for (; size >= 3; size -= 3, data += 3) {
+    uint32_t bits = (uint32_t)data[0] << 16 | data[1] << 8 | data[2];
+    *target++ = base64_map[bits >> 18];
+    *target++ = base64_map[bits >> 12 & 63];
+    *target++ = base64_map[bits >>  6 & 63];
+    *target++ = base64_map[bits       & 63];
+  }
+
+  /* Encode remaining bytes with padding */
+  if (size) {
+    uint32_t bits = (uint32_t)data[0] << 16 | (size > 1 ? data[1] << 8 : 0);
+    *target++ = base64_map[bits >> 18];
+    *target++ = base64_map[bits >> 12 & 63];
+    *target++ = size > 1 ? base64_map[bits >> 6 & 63] : '=';
+    *target++ = '=';
+  }
+  *target = '"';
+  return PB_ERROR_NONE;
+}
+
+/*!
+ * Write the name of a member, closing the array of the previous member.
+ *
+ * The separator, the name and the opening bracket of repeated fields are
+ * written with a single allocation.
+ *
+ * \param[in,out] writer     Writer
+ * \param[in]     descriptor Field descriptor
+ * \return                   Error code
+ */
+static pb_error_t
+write_name(pb_json_writer_t *writer, const pb_field_descriptor_t *descriptor) {
+  assert(writer && descriptor);
+  const char *name = pb_field_descriptor_name(descriptor);
+  size_t length = strlen(name);
+  int repeated = pb_field_descriptor_label(descriptor) == PB_LABEL_REPEATED,
+      closing  = writer->field && pb_field_descriptor_label(writer->field) ==
+        PB_LABEL_REPEATED;
+
+  /* Reserve space for brackets, separator, quotes and colon */
+  uint8_t *target = pb_buffer_grow(writer->buffer,
+    closing + !!writer->size + length + 3 + repeated);
+  if (unlikely_(!target))
+    return PB_ERROR_ALLOC;
+  if (closing)
+    *target++ = ']';
+  if (writer->size)
+    *target++ = ',';
+  *target++ = '"';
+  memcpy(target, name, length);
+  target += length;
+  *target++ = '"';
+  *target++ = ':';
+  if (repeated)
+    *target = '[';
+
+  /* Remember field to continue arrays */
+  writer->field = descriptor;
+  writer->size++;
+  return PB_ERROR_NONE;
+}
+
+/*!
+ * Write the value of a field.
+ *
+ * \param[in,out] buffer     Buffer
+ * \param[in]     descriptor Field descriptor
+ * \param[in]     value      Pointer holding value
+ * \return                   Error code
+ */
+static pb_error_t
+write_value(
+    pb_buffer_t *buffer, const pb_field_descriptor_t *descriptor,
+    const void *value) {
+  assert(buffer && descriptor && value);
+  switch (pb_field_descriptor_type(descriptor)) {
+    case PB_TYPE_INT32:
+    case PB_TYPE_SINT32:
+    case PB_TYPE_SFIXED32:
+      return write_signed(buffer, *(const int32_t *)value, 0);
+    case PB_TYPE_UINT32:
+    case PB_TYPE_FIXED32:
+      return write_integer(buffer, *(const uint32_t *)value, 0, 0);
+    case PB_TYPE_INT64:
+    case PB_TYPE_SINT64:
+    case PB_TYPE_SFIXED64:
+      return write_signed(buffer, *(const int64_t *)value, 1);
+    case PB_TYPE_UINT64:
+    case PB_TYPE_FIXED64:
+      return write_integer(buffer, *(const uint64_t *)value, 0, 1);
+    case PB_TYPE_BOOL:
+      return *(const uint8_t *)value
+        ? write_raw(buffer, "true", 4)
+        : write_raw(buffer, "false", 5);
+
+    /* Write name of enum value, or number if unknown */
+    case PB_TYPE_ENUM: {
+      const pb_enum_value_descriptor_t *enum_value =
+        pb_enum_descriptor_value_by_number(
+          pb_field_descriptor_enum(descriptor), *(const pb_enum_t *)value);
+      if (!enum_value)
+        return write_signed(buffer, *(const pb_enum_t *)value, 0);
+      const char *name = pb_enum_value_descriptor_name(enum_value);
+      return write_string(buffer, (const uint8_t *)name, strlen(name));
+    }
+
+    /* Write floating point numbers */
+    case PB_TYPE_FLOAT:
+      return write_float(buffer, *(const float *)value, 1);
+    case PB_TYPE_DOUBLE:
+      return write_float(buffer, *(const double *)value, 0);
+
+    /* Write strings and byte arrays */
+    case PB_TYPE_STRING:
+      return write_string(buffer,
+        pb_string_data(value), pb_string_size(value));
+    case PB_TYPE_BYTES:
+      return write_bytes(buffer,
+        pb_string_data(value), pb_string_size(value));
+
+    /* Write nested message */
+    case PB_TYPE_MESSAGE:
+      return write_object(buffer, value);
+    default:
+      return PB_ERROR_INVALID;
+  }
+}
+
+/*!
+ * Write a member of an object, invoked by the decoder for every field.
+ *
+ * Consecutive values of a repeated field are written to the same array,
+ * which is only closed when another field is encountered.
+ *
+ * \param[in]     descriptor Field descriptor
+ * \param[in]     value      Pointer holding value
+ * \param[in,out] user       Writer
+ * \return                   Error code
+ */
+static pb_error_t
+write_member(
+    const pb_field_descriptor_t *descriptor, const void *value, void *user) {
+  assert(descriptor && value && user);
+  pb_json_writer_t *writer = user;
+  pb_error_t error = writer->field == descriptor &&
+      pb_field_descriptor_label(descriptor) == PB_LABEL_REPEATED
+    ? write_raw(writer->buffer, ",", 1)
+    : write_name(writer, descriptor);
+  return likely_(!error)
+    ? write_value(writer->buffer, descriptor, value)
+    : error;
+}
+
+/*!
+ * Write a message as an object.
+ *
+ * \param[in,out] buffer  Buffer
+ * \param[in]     decoder Decoder
+ * \return                Error code
+ */
+static pb_error_t
+write_object(pb_buffer_t *buffer, const pb_decoder_t *decoder) {
+  assert(buffer && decoder);
+  pb_json_writer_t writer = {
+    .buffer = buffer,
+    .field  = NULL,
+    .size   = 0
+  };
+  pb_error_t error = write_raw(buffer, "{", 1);
+  if (likely_(!error))
+    error = pb_decoder_decode(decoder, write_member, &writer);
+
+  /* Close array of last member and object */
+  if (likely_(!error))
+    error = writer.field && pb_field_descriptor_label(writer.field) ==
+        PB_LABEL_REPEATED
+      ? write_raw(buffer, "]}", 2)
+      : write_raw(buffer, "}", 1);
+  return error;
+}
+
+/* ----------------------------------------------------------------------------
+ * Internal functions: reading
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Skip whitespace and peek at the next character.
+ *
+ * \param[in,out] reader Reader
+ * \return               Character or EOF
+ */
+PB_INLINE int
+peek(pb_json_reader_t *reader) {
+  assert(reader);
+  while (reader->offset < reader->size) {
+    uint8_t c = reader->data[reader->offset];
+    if (c != ' ' && c != '\n' && c != '\r' && c != '\t')
+      return c;
+    reader->offset++;
+  }
+  return EOF;
+}
+
+/*!
+ * Consume the next character, if it matches.
+ *
+ * \param[in,out] reader Reader
+ * \param[in]     c      Character
+ * \return               Test result
+ */
+PB_INLINE int
+accept(pb_json_reader_t *reader, int c) {
+  assert(reader);
+  if (peek(reader) != c)
+    return 0;
+  reader->offset++;
+  return 1;
+}
+
+/*!
+ * Consume a literal, if it matches.
+ *
+ * \param[in,out] reader    Reader
+ * \param[in]     literal[] Literal
+ * \param[in]     size      Literal size
+ * \return                  Test result
+ */
+PB_INLINE int
+accept_literal(pb_json_reader_t *reader, const char literal[], size_t size) {
+  assert(reader && literal);
+  if (peek(reader) == EOF || reader->size - reader->offset < size ||
+      memcmp(&(reader->data[reader->offset]), literal, size))
+    return 0;
+  reader->offset += size;
+  return 1;
+}
+
+/*!
+ * Test whether a character may be part of a number.
+ *
+ * \param[in] c Character
+ * \return      Test result
+ */
+PB_INLINE int
+numeric(int c) {
+  return (c >= '0' && c <= '9') ||
+    c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E';
+}
+
+/*!
+ * Retrieve the value of a hexadecimal digit.
+ *
+ * \param[in] c Character
+ * \return      Value or -1
+ */
+PB_INLINE int
+hex(int c) {
+  if (c >= '0' && c <= '9')
+    return c - '0';
+  if (c >= 'a' && c <= 'f')
+    return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F')
+    return c - 'A' + 10;
+  return -1;
+}
+
+/*!
+ * Read the four hexadecimal digits of a unicode escape sequence.
+ *
+ * \param[in,out] reader Reader
+ * \param[out]    code   Code unit
+ * \return               Error code
+ */
+static pb_error_t
+read_unicode(pb_json_reader_t *reader, uint32_t *code) {
+  assert(reader && code);
+  if (reader->size - reader->offset < 4)
+    return PB_ERROR_INVALID;
+  *code = 0;
+  for (size_t d = 0; d < 4; d++) {
+    int value = hex(reader->data[reader->offset++]);
+    if (unlikely_(value < 0))
+      return PB_ERROR_INVALID;
+    *code = *code << 4 | (uint32_t)value;
+  }
+  return PB_ERROR_NONE;
+}
+
+/*!
+ * Read an escape sequence and append the unescaped character to the buffer
+ * for unescaped strings.
+ *
+ * \param[in,out] reader Reader
+ * \return               Error code
+ */
+static pb_error_t
+read_escape(pb_json_reader_t *reader) {
+  assert(reader);
+  if (unlikely_(reader->offset == reader->size))
+    return PB_ERROR_INVALID;
+  uint8_t data[4];
+  switch (reader->data[reader->offset++]) {
+    case '"':  data[0] = '"';  break;
+    case '\\': data[0] = '\\'; break;
+    case '/':  data[0] = '/';  break;
+    case 'b':  data[0] = '\b'; break;
+    case 'f':  data[0] = '\f'; break;
+    case 'n':  data[0] = '\n'; break;
+    case 'r':  data[0] = '\r'; break;
+    case 't':  data[0] = '\t'; break;
+    case 'u':  break;
+    default:
+      return PB_ERROR_INVALID;
+  }
+  if (reader->data[reader->offset - 1] != 'u')
+    return write_raw(&(reader->scratch), data, 1);
+
+  /* Read code unit and combine surrogate pairs */
+  uint32_t code, low;
+  pb_error_t error = read_unicode(reader, &code);
+  if (unlikely_(error))
+    return error;
+  if (code >= 0xD800 && code <= 0xDBFF) {
+    if (!accept_literal(reader, "\\u", 2) ||
+        (error = read_unicode(reader, &low)) ||
+        low < 0xDC00 || low > 0xDFFF)
+      return error ? error : PB_ERROR_INVALID;
+    code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+  } else if (code >= 0xDC00 && code <= 0xDFFF) {
+    return PB_ERROR_INVALID;
+  }
+
+  /* Encode code point as UTF-8 */
+  size_t size;
+  if (code < 0x80) {
+    data[0] = (uint8_t)code;
+    size = 1;
+  } else if (code < 0x800) {
+    data[0] = (uint8_t)(0xC0 | code >> 6);
+    data[1] = (uint8_t)(0x80 | (code & 0x3F));
+    size = 2;
+  } else if (code < 0x10000) {
+    data[0] = (uint8_t)(0xE0 | code >> 12);
+    data[1] = (uint8_t)(0x80 | (code >> 6 & 0x3F));
+    data[2] = (uint8_t)(0x80 | (code & 0x3F));
+    size = 3;
+  } else {
+    data[0] = (uint8_t)(0xF0 | code >> 18);
+    data[1] = (uint8_t)(0x80 | (code >> 12 & 0x3F));
+    data[2] = (uint8_t)(0x80 | (code >> 6 & 0x3F));
+    data[3] = (uint8_t)(0x80 | (code & 0x3F));
+    size = 4;
+  }
+  return write_raw(&(reader->scratch), data, size);
+}
+
+/*!
+ * Read a string.
+ *
+ * Strings without escape sequences refer to the raw data directly, others
+ * are unescaped into the buffer of the reader, so the string is only valid
+ * until the next string is read.
+ *
+ * \param[in,out] reader Reader
+ * \param[out]    string String
+ * \return               Error code
+ */
+static pb_error_t
+read_string(pb_json_reader_t *reader, pb_string_t *string) {
+  assert(reader && string);
+  if (unlikely_(!accept(reader, '"')))
+    return PB_ERROR_INVALID;
+  reader->scratch.size = 0;
+  pb_error_t error = PB_ERROR_NONE;
+  for (int escaped = 0; !error; escaped = 1) {
+    const uint8_t *data = reader->data;
+
+    /* Scan run of characters up to closing quote or next escape sequence */
+    size_t start = reader->offset;
+    while (reader->offset < reader->size && data[reader->offset] != '"' &&
+           data[reader->offset] != '\\' && data[reader->offset] >= 0x20)
+      reader->offset++;
+    if (unlikely_(reader->offset == reader->size ||
+                  data[reader->offset] < 0x20))
+      return PB_ERROR_INVALID;
+
+    /* String contains no escape sequences: refer to raw data */
+    if (likely_(!escaped) && data[reader->offset] == '"') {
+      *string = pb_string_init((uint8_t *)&(data[start]),
+        reader->offset++ - start);
+      return PB_ERROR_NONE;
+    }
+
+    /* Copy run to buffer and unescape next escape sequence */
+    if (unlikely_(error = write_raw(&(reader->scratch),
+        &(data[start]), reader->offset - start)))
+      break;
+    if (data[reader->offset++] == '"')
+      break;
+    error = read_escape(reader);
+  }
+  if (likely_(!error))
+    *string = pb_string_init(reader->scratch.data, reader->scratch.size);
+  return error;
+}
+
+/*!
+ * Read the name of a member and look up its field descriptor.
+ *
+ * \param[in,out] reader     Reader
+ * \param[in]     descriptor Descriptor
+ * \param[out]    field      Field descriptor or NULL, if unknown
+ * \return                   Error code
+ */
+static pb_error_t
+read_name(
+    pb_json_reader_t *reader, const pb_descriptor_t *descriptor,
+    const pb_field_descriptor_t **field) {
+  assert(reader && descriptor && field);
+  pb_string_t string;
+  pb_error_t error = read_string(reader, &string);
+  if (unlikely_(error))
+    return error;
+
+  /* Copy name for lookup, as names are null-terminated */
+  size_t size = pb_string_size(&string);
+  *field = NULL;
+  if (size < PB_JSON_NAME && !memchr(pb_string_data(&string), 0, size)) {
+    char name[PB_JSON_NAME];
+    memcpy(name, pb_string_data(&string), size);
+    name[size] = '\0';
+    *field = pb_descriptor_field_by_name(descriptor, name);
+  }
+  return PB_ERROR_NONE;
+}
+
+/*!
+ * Read a number token, which may be quoted.
+ *
+ * \param[in,out] reader  Reader
+ * \param[out]    token[] Null-terminated token
+ * \return                Error code
+ */
+static pb_error_t
+read_token(pb_json_reader_t *reader, char token[]) {
+  assert(reader && token);
+  int quoted = accept(reader, '"');
+  if (!quoted && peek(reader) == EOF)
+    return PB_ERROR_INVALID;
+
+  /* Scan until closing quote or end of number */
+  size_t end = reader->offset;
+  while (end < reader->size && (quoted
+      ? reader->data[end] != '"'
+      : numeric(reader->data[end])))
+    end++;
+  size_t size = end - reader->offset;
+  if (unlikely_(!size || size >= PB_JSON_TOKEN ||
+      (quoted && end == reader->size)))
+    return PB_ERROR_INVALID;
+
+  /* Copy token and skip closing quote */
+  memcpy(token, &(reader->data[reader->offset]), size);
+  token[size] = '\0';
+  reader->offset = end + quoted;
+  return PB_ERROR_NONE;
+}
+
+/*!
+ * Parse an integer token into sign and magnitude.
+ *
+ * \param[in]  token[]   Null-terminated token
+ * \param[out] magnitude Magnitude
+ * \param[out] negative  Whether the integer is negative
+ * \return               Error code
+ */
+static pb_error_t
+parse_integer(const char token[], uint64_t *magnitude, int *negative) {
+  assert(token && magnitude && negative);
+  *negative  = *token == '-';
+  *magnitude = 0;
+  token += *negative;
+  if (unlikely_(!*token))
+    return PB_ERROR_INVALID;
+  for (; *token; token++) {
+    if (unlikely_(*token < '0' || *token > '9'))
+      return PB_ERROR_INVALID;
+    uint64_t digit = (uint64_t)(*token - '0');
+    if (unlikely_(*magnitude > (UINT64_MAX - digit) / 10))
+      return PB_ERROR_INVALID;
+    *magnitude = *magnitude * 10 + digit;
+  }
+  return PB_ERROR_NONE;
+}
+
+/*!
+ * Parse a signed integer token within the given bounds.
+ *
+ * \param[in]  token[] Null-terminated token
+ * \param[in]  max     Maximum value
+ * \param[out] value   Value
+ * \return             Error code
+ */
+static pb_error_t
+parse_signed(const char token[], int64_t max, int64_t *value) {
+  assert(token && value);
+  uint64_t magnitude; int negative;
+  pb_error_t error = parse_integer(token, &magnitude, &negative);
+  if (unlikely_(error))
+    return error;
+  if (unlikely_(magnitude > (uint64_t)max + negative))
+    return PB_ERROR_INVALID;
+  *value = negative
+    ? magnitude ? -(int64_t)(magnitude - 1) - 1 : 0
+    : (int64_t)magnitude;
+  return PB_ERROR_NONE;
+}
+
+/*!
+ * Parse an unsigned integer token within the given bounds.
+ *
+ * \param[in]  token[] Null-terminated token
+ * \param[in]  max     Maximum value
+ * \param[out] value   Value
+ * \return             Error code
+ */
+static pb_error_t
+parse_unsigned(const char token[], uint64_t max, uint64_t *value) {
+  assert(token && value);
+  int negative;
+  pb_error_t error = parse_integer(token, value, &negative);
+  if (unlikely_(error))
+    return error;
+  return unlikely_(*value > max || (negative && *value))
+    ? PB_ERROR_INVALID
+    : PB_ERROR_NONE;
+}
+
+/*!
+ * Parse a floating point token, including the names of non-finite values.
+ *
+ * \param[in]  token[] Null-terminated token
+ * \param[out] value   Value
+ * \return             Error code
+ */
+static pb_error_t
+parse_float(const char token[], double *value) {
+  assert(token && value);
+  if (!strcmp(token, "NaN")) {
+    *value = NAN;
+  } else if (!strcmp(token, "Infinity")) {
+    *value = INFINITY;
+  } else if (!strcmp(token, "-Infinity")) {
+    *value = -INFINITY;
+
+  /* Ensure token is a number, as strtod() accepts more */
+  } else {
+    for (const char *c = token; *c; c++)
+      if (unlikely_(!numeric(*c)))
+        return PB_ERROR_INVALID;
+    char *end;
+    *value = strtod(token, &end);
+    if (unlikely_(*end))
+      return PB_ERROR_INVALID;
+  }
+  return PB_ERROR_NONE;
+}
+
+/*!
+ * Read an enum value, given by name or number.
+ *
+ * \param[in,out] reader     Reader
+ * \param[in]     descriptor Enum descriptor
+ * \param[out]    value      Value
+ * \return                   Error code
+ */
+static pb_error_t
+read_enum(
+    pb_json_reader_t *reader, const pb_enum_descriptor_t *descriptor,
+    pb_enum_t *value) {
+  assert(reader && descriptor && value);
+  pb_error_t error;
+  if (peek(reader) != '"') {
+    char token[PB_JSON_TOKEN];
+    int64_t number;
+    if ((error = read_token(reader, token)) ||
+        (error = parse_signed(token, INT32_MAX, &number)))
+      return error;
+
+    /* Ensure enum value is known, as the encoder expects */
+    *value = (pb_enum_t)number;
+    return pb_enum_descriptor_value_by_number(descriptor, *value)
+      ? PB_ERROR_NONE
+      : PB_ERROR_INVALID;
+  }
+
+  /* Look up enum value by name */
+  pb_string_t string;
+  if (unlikely_(error = read_string(reader, &string)))
+    return error;
+  size_t size = pb_string_size(&string);
+  if (size < PB_JSON_NAME && !memchr(pb_string_data(&string), 0, size)) {
+    char name[PB_JSON_NAME];
+    memcpy(name, pb_string_data(&string), size);
+    name[size] = '\0';
+    const pb_enum_value_descriptor_t *enum_value =
+      pb_enum_descriptor_value_by_name(descriptor, name);
+    if (enum_value) {
+      *value = pb_enum_value_descriptor_number(enum_value);
+      return PB_ERROR_NONE;
+    }
+  }
+  return PB_ERROR_INVALID;
+}
+
+/*!
+ * Read a scalar value, i.e. any value except strings, bytes and messages.
+ *
+ * \param[in,out] reader     Reader
+ * \param[in]     descriptor Field descriptor
+ * \param[out]    value      Pointer receiving value
+ * \return                   Error code
+ */
+static pb_error_t
+read_scalar(
+    pb_json_reader_t *reader, const pb_field_descriptor_t *descriptor,
+    void *value) {
+  assert(reader && descriptor && value);
+  pb_type_t type = pb_field_descriptor_type(descriptor);
+  if (type == PB_TYPE_BOOL) {
+    if (accept_literal(reader, "true", 4)) {
+      *(uint8_t *)value = 1;
+    } else if (accept_literal(reader, "false", 5)) {
+      *(uint8_t *)value = 0;
+    } else {
+      return PB_ERROR_INVALID;
+    }
+    return PB_ERROR_NONE;
+  }
+  if (type == PB_TYPE_ENUM)
+    return read_enum(reader,
+      pb_field_descriptor_enum(descriptor), value);
+
+  /* Read number token, which may be quoted */
+  char token[PB_JSON_TOKEN];
+  pb_error_t error = read_token(reader, token);
+  if (unlikely_(error))
+    return error;
+
+  /* Parse number according to type */
+  union {
+    int64_t  s;
+    uint64_t u;
+    double   d;
+  } number;
+  switch (type) {
+    case PB_TYPE_INT32:
+    case PB_TYPE_SINT32:
+    case PB_TYPE_SFIXED32:
+      if (!(error = parse_signed(token, INT32_MAX, &number.s)))
+        *(int32_t *)value = (int32_t)number.s;
+      break;
+    case PB_TYPE_UINT32:
+    case PB_TYPE_FIXED32:
+      if (!(error = parse_unsigned(token, UINT32_MAX, &number.u)))
+        *(uint32_t *)value = (uint32_t)number.u;
+      break;
+    case PB_TYPE_INT64:
+    case PB_TYPE_SINT64:
+    case PB_TYPE_SFIXED64:
+      if (!(error = parse_signed(token, INT64_MAX, &number.s)))
+        *(int64_t *)value = number.s;
+      break;
+    case PB_TYPE_UINT64:
+    case PB_TYPE_FIXED64:
+      if (!(error = parse_unsigned(token, UINT64_MAX, &number.u)))
+        *(uint64_t *)value = number.u;
+      break;
+    case PB_TYPE_FLOAT:
+      if (!(error = parse_float(token, &number.d)))
+        *(float *)value = (float)number.d;
+      break;
+    case PB_TYPE_DOUBLE:
+      if (!(error = parse_float(token, &number.d)))
+        *(double *)value = number.d;
+      break;
+    default:
+      error = PB_ERROR_INVALID;
+  }
+  return error;
+}
+
+/*!
+ * Read a byte array from a base64 string.
+ *
+ * Both the standard and the URL-safe alphabet are accepted, and padding is
+ * optional. The data is decoded in place within the buffer of the reader.
+ *
+ * \param[in,out] reader Reader
+ * \param[out]    bytes  Byte array
+ * \return               Error code
+ */
+static pb_error_t
+read_bytes(pb_json_reader_t *reader, pb_string_t *bytes) {
+  assert(reader && bytes);
+  pb_string_t string;
+  pb_error_t error = read_string(reader, &string);
+  if (unlikely_(error))
+    return error;
+
+  /* Move string into buffer, if it refers to the raw data */
+  size_t size = pb_string_size(&string);
+  if (!size) {
+    *bytes = string;
+    return PB_ERROR_NONE;
+  } else if (pb_string_data(&string) != reader->scratch.data) {
+    reader->scratch.size = 0;
+    if (unlikely_(error = write_raw(&(reader->scratch),
+        pb_string_data(&string), size)))
+      return error;
+  }
+  uint8_t *data = reader->scratch.data;
+
+  /* Strip padding */
+  for (size_t p = 0; p < 2 && size && data[size - 1] == '='; p++)
+    size--;
+  if (unlikely_(size % 4 == 1))
+    return PB_ERROR_INVALID;
+
+  /* Decode groups of four characters in place */
+  size_t length = 0, count = 0;
+  uint32_t bits = 0;
+  for (size_t c = 0; c < size; c++) {
+    uint8_t value = base64_value_map[data[c]];
+    if (unlikely_(value > 63))
+      return PB_ERROR_INVALID;
+    bits = bits << 6 | value;
+    if (++count == 4) {
+      data[length++] = (uint8_t)(bits >> 16);
+      data[length++] = (uint8_t)(bits >> 8);
+      data[length++] = (uint8_t)(bits);
+      bits = count = 0;
+    }
+  }
+
+  /* Decode remaining characters */
+  if (count == 2) {
+    data[length++] = (uint8_t)(bits >> 4);
+  } else if (count == 3) {
+    data[length++] = (uint8_t)(bits >> 10);
+    data[length++] = (uint8_t)(bits >> 2);
+  }
+  *bytes = pb_string_init(data, length);
+  return PB_ERROR_NONE;
+}
+
+/*!
+ * Skip a value of any kind, e.g. for unknown fields.
+ *
+ * \param[in,out] reader Reader
+ * \return               Error code
+ */
+static pb_error_t
+skip_value(pb_json_reader_t *reader) {
+  assert(reader);
+  pb_error_t error = PB_ERROR_NONE;
+  int c = peek(reader);
+  if (c == '"') {
+    pb_string_t string;
+    return read_string(reader, &string);
+  }
+
+  /* Skip objects and arrays recursively */
+  if (c == '{' || c == '[') {
+    if (unlikely_(++reader->depth > PB_JSON_DEPTH))
+      return PB_ERROR_DEPTH;
+    reader->offset++;
+    int close = c == '{' ? '}' : ']';
+    if (!accept(reader, close)) {
+      do {
+        if (c == '{') {
+          pb_string_t string;
+          if (!(error = read_string(reader, &string)) && !accept(reader, ':'))
+            error = PB_ERROR_INVALID;
+        }
+        if (likely_(!error))
+          error = skip_value(reader);
+      } while (!error && accept(reader, ','));
+      if (!error && !accept(reader, close))
+        error = PB_ERROR_INVALID;
+    }
+    reader->depth--;
+    return error;
+  }
+
+  /* Skip literals and numbers */
+  if (accept_literal(reader, "true", 4) ||
+      accept_literal(reader, "false", 5) ||
+      accept_literal(reader, "null", 4))
+    return PB_ERROR_NONE;
+  char token[PB_JSON_TOKEN];
+  return read_token(reader, token);
+}
+
+/*!
+ * Read a single value of a field and encode it.
+ *
+ * \param[in,out] reader     Reader
+ * \param[in,out] encoder    Encoder
+ * \param[in]     descriptor Field descriptor
+ * \return                   Error code
+ */
+static pb_error_t
+read_value(
+    pb_json_reader_t *reader, pb_encoder_t *encoder,
+    const pb_field_descriptor_t *descriptor) {
+  assert(reader && encoder && descriptor);
+  pb_tag_t tag = pb_field_descriptor_tag(descriptor);
+  pb_error_t error;
+  switch (pb_field_descriptor_type(descriptor)) {
+
+    /* Encode nested message in place */
+    case PB_TYPE_MESSAGE: {
+      pb_encoder_frame_t frame;
+      if (unlikely_(error = pb_encoder_begin_nested(encoder, tag, &frame)))
+        return error;
+      error = read_object(reader, encoder);
+      pb_encoder_end_nested(encoder);
+      return error;
+    }
+
+    /* Encode string or byte array */
+    case PB_TYPE_STRING:
+    case PB_TYPE_BYTES: {
+      pb_string_t string;
+      error = pb_field_descriptor_type(descriptor) == PB_TYPE_STRING
+        ? read_string(reader, &string)
+        : read_bytes(reader, &string);
+      return likely_(!error)
+        ? pb_encoder_encode(encoder, tag, &string, 1)
+        : error;
+    }
+
+    /* Encode scalar value */
+    default: {
+      union {
+        uint64_t number;
+        double   value;
+      } slot;
+      error = read_scalar(reader, descriptor, &slot);
+      return likely_(!error)
+        ? pb_encoder_encode(encoder, tag, &slot, 1)
+        : error;
+    }
+  }
+}
+
+/*!
+ * Read the values of a repeated field and encode them.
+ *
+ * Scalar values are collected and encoded in batches, so packed fields are
+ * encoded as few packed fields instead of one per value.
+ *
+ * \param[in,out] reader     Reader
+ * \param[in,out] encoder    Encoder
+ * \param[in]     descriptor Field descriptor
+ * \return                   Error code
+ */
+static pb_error_t
+read_array(
+    pb_json_reader_t *reader, pb_encoder_t *encoder,
+    const pb_field_descriptor_t *descriptor) {
+  assert(reader && encoder && descriptor);
+  if (unlikely_(!accept(reader, '[')))
+    return PB_ERROR_INVALID;
+  if (unlikely_(++reader->depth > PB_JSON_DEPTH))
+    return PB_ERROR_DEPTH;
+  pb_error_t error = PB_ERROR_NONE;
+  if (!accept(reader, ']')) {
+    pb_type_t type = pb_field_descriptor_type(descriptor);
+
+    /* Read strings, byte arrays and messages one by one */
+    if (type == PB_TYPE_STRING || type == PB_TYPE_BYTES ||
+        type == PB_TYPE_MESSAGE) {
+      do {
+        error = read_value(reader, encoder, descriptor);
+      } while (!error && accept(reader, ','));
+
+    /* Read scalar values in batches */
+    } else {
+      uint64_t batch[PB_JSON_BATCH];
+      size_t size = pb_field_descriptor_type_size(descriptor), count = 0;
+      do {
+        if (unlikely_(error = read_scalar(reader, descriptor,
+            (uint8_t *)batch + count * size)))
+          break;
+        if (++count == PB_JSON_BATCH) {
+          error = pb_encoder_encode(encoder,
+            pb_field_descriptor_tag(descriptor), batch, count);
+          count = 0;
+        }
+      } while (!error && accept(reader, ','));
+      if (!error && count)
+        error = pb_encoder_encode(encoder,
+          pb_field_descriptor_tag(descriptor), batch, count);
+    }
+    if (!error && !accept(reader, ']'))
+      error = PB_ERROR_INVALID;
+  }
+  reader->depth--;
+  return error;
+}
+
+/*!
+ * Read an object and encode its members.
+ *
+ * Members of unknown fields and members set to null are skipped.
+ *
+ * \param[in,out] reader  Reader
+ * \param[in,out] encoder Encoder
+ * \return                Error code
+ */
+static pb_error_t
+read_object(pb_json_reader_t *reader, pb_encoder_t *encoder) {
+  assert(reader && encoder);
+  if (unlikely_(!accept(reader, '{')))
+    return PB_ERROR_INVALID;
+  if (unlikely_(++reader->depth > PB_JSON_DEPTH))
+    return PB_ERROR_DEPTH;
+  pb_error_t error = PB_ERROR_NONE;
+  if (!accept(reader, '}')) {
+    do {
+      const pb_field_descriptor_t *descriptor;
+      if (unlikely_(error = read_name(reader,
+          pb_encoder_descriptor(encoder), &descriptor)))
+        break;
+      if (unlikely_(!accept(reader, ':'))) {
+        error = PB_ERROR_INVALID;
+        break;
+      }
+
+      /* Skip unknown fields and null values, read arrays or values */
+      if (!descriptor) {
+        error = skip_value(reader);
+      } else if (!accept_literal(reader, "null", 4)) {
+        error = pb_field_descriptor_label(descriptor) == PB_LABEL_REPEATED
+          ? read_array(reader, encoder, descriptor)
+          : read_value(reader, encoder, descriptor);
+      }
+    } while (!error && accept(reader, ','));
+    if (!error && !accept(reader, '}'))
+      error = PB_ERROR_INVALID;
+  }
+  reader->depth--;
+  return error;
+}
+
+/* ----------------------------------------------------------------------------
+ * Interface
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Write the message of a decoder as JSON to a buffer.
+ *
+ * The fields are written straight to the buffer while being decoded, without
+ * building an intermediate representation. Field names are taken from the
+ * descriptor, enum values are written by name, 64-bit integers as quoted
+ * strings and byte arrays as base64 strings. Consecutive values of repeated
+ * fields are written as arrays.
+ *
+ * The JSON is appended to the buffer, so many messages can be written to the
+ * same buffer. If an error occurs, the buffer is reset to its original size.
+ *
+ * \param[in]     decoder Decoder
+ * \param[in,out] buffer  Buffer
+ * \return                Error code
+ */
+extern pb_error_t
+pb_json_write(const pb_decoder_t *decoder, pb_buffer_t *buffer) {
+  assert(decoder && buffer);
+  if (unlikely_(!pb_decoder_valid(decoder) || !pb_buffer_valid(buffer)))
+    return PB_ERROR_INVALID;
+  size_t size = pb_buffer_size(buffer);
+  pb_error_t error = write_object(buffer, decoder);
+  if (unlikely_(error))
+    buffer->size = size;
+  return error;
+}
+
+/*!
+ * Read a message from JSON and encode it using an encoder.
+ *
+ * The JSON is tokenized and its members are passed straight to the encoder,
+ * without building an intermediate representation. Field and enum value names
+ * are looked up through the name index of the descriptors, if present. The
+ * values of all integer and floating point fields may be given as numbers or
+ * quoted strings. Unknown members and null values are skipped.
+ *
+ * \warning If an error occurs, the encoder contains a partially encoded
+ * message and should be reset.
+ *
+ * \param[in,out] encoder Encoder
+ * \param[in]     data[]  Raw data
+ * \param[in]     size    Raw data size
+ * \return                Error code
+ */
+extern pb_error_t
+pb_json_read(pb_encoder_t *encoder, const uint8_t data[], size_t size) {
+  assert(encoder && (data || !size));
+  if (unlikely_(!pb_encoder_valid(encoder)))
+    return PB_ERROR_INVALID;
+  pb_json_reader_t reader = {
+    .data    = data,
+    .size    = size,
+    .offset  = 0,
+    .scratch = pb_buffer_create_empty(),
+    .depth   = 0
+  };
+  pb_error_t error = read_object(&reader, encoder);
+  if (!error && peek(&reader) != EOF)
+    error = PB_ERROR_INVALID;
+
+  /* Free all allocated memory */
+  pb_buffer_destroy(&reader.scratch);
+  return error;
+}
@@ -0,0 +1,696 @@
+/*
+ * Copyright (c) 2013-2020 Martin Donath <martin.donath@squidfunk.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#define _GNU_SOURCE
+
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "core/allocator.h"
+#include "core/buffer.h"
+#include "core/common.h"
+#include "core/stream.h"
+#include "core/varint.h"
+#include "message/journal.h"
+#include "util/mmap.h"
+
+/* ----------------------------------------------------------------------------
+ * Constants
+ * ------------------------------------------------------------------------- */
+
+/*! Alignment of memory blocks */
+#define PB_MMAP_ALIGNMENT 16
+
+/*! Suffix of write-ahead logs */
+#define PB_MMAP_LOG_SUFFIX ".wal"
+
+/*! Size of the checksum trailing a write-ahead log */
+#define PB_MMAP_LOG_CHECKSUM 8
+
+/* ----------------------------------------------------------------------------
+ * Type definitions
+ * ------------------------------------------------------------------------- */
+
+typedef struct pb_mmap_header_t {
+  void *addr;                          /*!< Mapping, NULL if not mapped */
+  size_t size;                         /*!< Mapping size */
+  size_t capacity;                     /*!< Block capacity */
+  int flags;                           /*!< Flags */
+} pb_mmap_header_t;
+
+/* ----------------------------------------------------------------------------
+ * Macros
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Size of the (aligned) header of memory blocks.
+ */
+#define block_header \
+  ((sizeof(pb_mmap_header_t) + PB_MMAP_ALIGNMENT - 1) & \
+    ~((size_t)PB_MMAP_ALIGNMENT - 1))
+
+/*!
+ * Retrieve the header of a memory block.
+ *
+ * \param[in] block Memory block
+ * \return          Header
+ */
+#define header_from_block(block) \
+  (assert(block), \
+    (pb_mmap_header_t *)((uint8_t *)(block) - block_header))
+
+/*!
+ * Retrieve the memory block of a header.
+ *
+ * \param[in] header Header
+ * \return           Memory block
+ */
+#define block_from_header(header) \
+  (assert(header), (void *)((uint8_t *)(header) + block_header))
+
+/* ----------------------------------------------------------------------------
+ * Internal functions
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Map a file, preceded by an anonymous page holding the header.
+ *
+ * The file is mapped at a page boundary right behind the anonymous page, and
+ * the header is placed at the end of the anonymous page, so a mapped block is
+ * laid out exactly like an allocated block.
+ *
+ * \param[in] fd    File descriptor
+ * \param[in] size  File size
+ * \param[in] flags Flags
+ * \return          Header
+ */
+static pb_mmap_header_t *
+map_create(int fd, size_t size, int flags) {
+  assert(fd >= 0 && size);
+  size_t page   = sysconf(_SC_PAGESIZE);
+  size_t length = page + ((size + page - 1) & ~(page - 1));
+
+  /* Reserve space for the header and the file */
+  uint8_t *addr = mmap(NULL, length, PROT_READ | PROT_WRITE,
+    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (unlikely_(addr == MAP_FAILED))
+    return NULL;                                           /* LCOV_EXCL_LINE */
+
+  /* Map file behind header, read-only unless private */
+  void *data = flags & PB_MMAP_PRIVATE
+    ? mmap(addr + page, size, PROT_READ | PROT_WRITE,
+        MAP_PRIVATE | MAP_FIXED, fd, 0)
+    : mmap(addr + page, size, PROT_READ,
+        MAP_SHARED  | MAP_FIXED, fd, 0);
+  if (unlikely_(data == MAP_FAILED)) {
+    munmap(addr, length);
+    return NULL;
+  }
+
+  /* Apply access pattern hints */
+#if defined(MADV_SEQUENTIAL) && defined(MADV_RANDOM)
+  if (flags & PB_MMAP_SEQUENTIAL)
+    madvise(data, size, MADV_SEQUENTIAL);
+  else if (flags & PB_MMAP_RANDOM)
+    madvise(data, size, MADV_RANDOM);
+#endif
+
+  /* Initialize header */
+  pb_mmap_header_t *header = header_from_block(data);
+  *header = (pb_mmap_header_t){
+    .addr     = addr,
+    .size     = length,
+    .capacity = size,
+    .flags    = flags
+  };
+  return header;
+}
+
+/*!
+ * Release a memory block by unmapping or freeing it.
+ *
+ * \param[in,out] block Memory block
+ */
+static void
+block_release(void *block) {
+  assert(block);
+  pb_mmap_header_t *header = header_from_block(block);
+  if (header->addr) {
+    munmap(header->addr, header->size);
+  } else {
+    free(header);
+  }
+}
+
+/* ------------------------------------------------------------------------- */
+
+/*!
+ * Determine the path of the write-ahead log of a file.
+ *
+ * \param[in] path Path
+ * \return         Path of write-ahead log
+ */
+static char *
+log_path(const char path[]) {
+  assert(path);
+  size_t size = strlen(path);
+  char *target = malloc(size + sizeof(PB_MMAP_LOG_SUFFIX));
+  if (likely_(target != NULL)) {
+    memcpy(target, path, size);
+    memcpy(&(target[size]), PB_MMAP_LOG_SUFFIX, sizeof(PB_MMAP_LOG_SUFFIX));
+  }
+  return target;
+}
+
+/*!
+ * Compute the checksum of a write-ahead log using FNV-1a.
+ *
+ * \param[in] data[] Raw data
+ * \param[in] size   Raw data size
+ * \return           Checksum
+ */
+static uint64_t
+log_checksum(const uint8_t data[], size_t size) {
+  uint64_t hash = 14695981039346656037ULL;
+  for (size_t b = 0; b < size; b++)
+    hash = (hash ^ data[b]) * 1099511628211ULL;
+  return hash;
+}
+
+/*!
+ * Write data to a file at the given offset, retrying upon interruption.
+ *
+ * \param[in] fd     File descriptor
+ * \param[in] offset Offset
+ * \param[in] data[] Raw data
+ * \param[in] size   Raw data size
+ * \return           Error code
+ */
+static pb_error_t
+file_write(int fd, size_t offset, const uint8_t data[], size_t size) {
+  assert(fd >= 0);
+  while (size) {
+    ssize_t bytes = pwrite(fd, data, size, offset);
+    if (unlikely_(bytes < 0)) {
+      if (errno == EINTR)
+        continue;
+      return PB_ERROR_INVALID;                             /* LCOV_EXCL_LINE */
+    }
+    data   += bytes;
+    size   -= (size_t)bytes;
+    offset += (size_t)bytes;
+  }
+  return PB_ERROR_NONE;
+}
+
+/*!
+ * Synchronize the directory containing a file, so its entry is persisted.
+ *
+ * \param[in] path Path
+ * \return         Error code
+ */
+static pb_error_t
+file_sync_directory(const char path[]) {
+  assert(path);
+  const char *slash = strrchr(path, '/');
+  char *directory = strndup(slash ? path : ".",
+    slash ? (size_t)(slash - path) + 1 : 1);
+  if (unlikely_(!directory))
+    return PB_ERROR_ALLOC;                                 /* LCOV_EXCL_LINE */
+  int fd = open(directory, O_RDONLY);
+  free(directory);
+  if (unlikely_(fd < 0))
+    return PB_ERROR_INVALID;                               /* LCOV_EXCL_LINE */
+  int failed = fsync(fd);
+  return close(fd) || failed ? PB_ERROR_INVALID : PB_ERROR_NONE;
+}
+
+/*!
+ * Check whether a write-ahead log is complete.
+ *
+ * The log is terminated by a checksum of all preceding bytes, so a log that
+ * was torn by a crash is detected.
+ *
+ * \param[in] log Write-ahead log
+ * \return        Test result
+ */
+static int
+log_complete(const pb_buffer_t *log) {
+  assert(log);
+  size_t size = pb_buffer_size(log);
+  if (unlikely_(size < PB_MMAP_LOG_CHECKSUM))
+    return 0;
+
+  /* Compare stored and computed checksum */
+  const uint8_t *data = pb_buffer_data(log);
+  uint64_t checksum = 0;
+  size -= PB_MMAP_LOG_CHECKSUM;
+  for (size_t b = PB_MMAP_LOG_CHECKSUM; b > 0; b--)
+    checksum = (checksum << 8) | data[size + b - 1];
+  return checksum == log_checksum(data, size);
+}
+
+/*!
+ * Replay a complete write-ahead log onto a file.
+ *
+ * The log starts with the size of the file after the update, followed by a
+ * sequence of regions, each consisting of an offset, a length and the data
+ * to be written at that offset, all integers being variable-sized. Regions
+ * hold the final contents of the file, so replaying a log is idempotent and
+ * may be repeated any number of times, e.g. after a crash during a replay.
+ *
+ * \param[in] path Path
+ * \param[in] log  Write-ahead log
+ * \return         Error code
+ */
+static pb_error_t
+log_replay(const char path[], const pb_buffer_t *log) {
+  assert(path && log && log_complete(log));
+
+  /* Open file to be updated */
+  int fd = open(path, O_WRONLY);
+  if (unlikely_(fd < 0))
+    return PB_ERROR_INVALID;
+
+  /* Write regions to file and truncate it to its final size */
+  pb_buffer_t buffer = pb_buffer_create_zero_copy_internal(
+    (uint8_t *)pb_buffer_data(log),
+    pb_buffer_size(log) - PB_MMAP_LOG_CHECKSUM);
+  pb_stream_t stream = pb_stream_create(&buffer);
+  uint64_t total;
+  pb_error_t error = pb_stream_read(&stream, PB_TYPE_UINT64, &total);
+  while (!error && pb_stream_left(&stream)) {
+    uint64_t offset, length;
+    if ((error = pb_stream_read(&stream, PB_TYPE_UINT64, &offset)) ||
+        (error = pb_stream_read(&stream, PB_TYPE_UINT64, &length)))
+      break;
+    if (unlikely_(offset > total || length > total - offset ||
+                  length > pb_stream_left(&stream))) {
+      error = PB_ERROR_INVALID;                            /* LCOV_EXCL_LINE */
+      break;                                               /* LCOV_EXCL_LINE */
+    }
+    if (!(error = file_write(fd, offset,
+        pb_buffer_data_from(&buffer, pb_stream_offset(&stream)), length)))
+      error = pb_stream_advance(&stream, length);
+  }
+  pb_stream_destroy(&stream);
+  pb_buffer_destroy(&buffer);
+  if (!error && (ftruncate(fd, total) || fsync(fd)))
+    error = PB_ERROR_INVALID;                              /* LCOV_EXCL_LINE */
+  if (close(fd) && !error)
+    error = PB_ERROR_INVALID;                              /* LCOV_EXCL_LINE */
+  return error;
+}
+
+/*!
+ * Recover a file from its write-ahead log, if any.
+ *
+ * A complete log means that the last save was interrupted while updating the
+ * file, so the log is replayed. An incomplete log means that the save was
+ * interrupted before the file was touched, so the log is discarded. In both
+ * cases, the log is truncated afterwards.
+ *
+ * \param[in] path Path
+ * \return         Error code
+ */
+static pb_error_t
+log_recover(const char path[]) {
+  assert(path);
+  char *target = log_path(path);
+  if (unlikely_(!target))
+    return PB_ERROR_ALLOC;                                 /* LCOV_EXCL_LINE */
+
+  /* Replay log, unless it's absent, empty or incomplete */
+  pb_error_t error = PB_ERROR_NONE;
+  pb_buffer_t log = pb_buffer_create_mmap(target, 0);
+  if (pb_buffer_valid(&log) && pb_buffer_size(&log)) {
+    if (log_complete(&log))
+      error = log_replay(path, &log);
+
+    /* Truncate log, unless replaying failed */
+    if (likely_(!error)) {
+      int fd = open(target, O_WRONLY | O_TRUNC);
+      if (unlikely_(fd < 0 || fsync(fd)))
+        error = PB_ERROR_INVALID;                          /* LCOV_EXCL_LINE */
+      if (fd >= 0)
+        close(fd);
+    }
+  }
+  pb_buffer_destroy(&log);
+  free(target);
+  return error;
+}
+
+/*!
+ * Append a region of a journal to a write-ahead log.
+ *
+ * \param[in,out] log     Write-ahead log
+ * \param[in]     journal Journal
+ * \param[in]     offset  Offset
+ * \param[in]     length  Length
+ * \return                Error code
+ */
+static pb_error_t
+log_append(
+    pb_buffer_t *log, const pb_journal_t *journal,
+    uint64_t offset, uint64_t length) {
+  assert(log && journal);
+  uint8_t *data = pb_buffer_grow(log, pb_varint_size_uint64(&offset) +
+    pb_varint_size_uint64(&length) + length);
+  if (unlikely_(!data))
+    return PB_ERROR_ALLOC;                                 /* LCOV_EXCL_LINE */
+  data += pb_varint_pack_uint64(data, &offset);
+  data += pb_varint_pack_uint64(data, &length);
+  if (length)
+    memcpy(data, pb_journal_data_from(journal, offset), length);
+  return PB_ERROR_NONE;
+}
+
+/* ----------------------------------------------------------------------------
+ * Allocator callbacks
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Allocate a memory block of given size.
+ *
+ * \param[in,out] data Internal allocator data
+ * \param[in]     size Bytes to be allocated
+ * \return             Memory block
+ */
+static void *
+allocator_allocate(void *data, size_t size) {
+  assert(!data && size);
+  pb_mmap_header_t *header = malloc(block_header + size);
+  if (unlikely_(!header))
+    return NULL;                                           /* LCOV_EXCL_LINE */
+  *header = (pb_mmap_header_t){
+    .capacity = size
+  };
+  return block_from_header(header);
+}
+
+/*!
+ * Change the size of a previously allocated memory block.
+ *
+ * A mapped file can never be resized in place. If the file was mapped
+ * privately, its contents are copied to an allocated memory block and the
+ * file is unmapped, so the file is never altered. Otherwise, it is read-only.
+ *
+ * \param[in,out] data  Internal allocator data
+ * \param[in,out] block Memory block to be resized
+ * \param[in]     size  Bytes to be allocated
+ * \return              Memory block
+ */
+static void *
+allocator_resize(void *data, void *block, size_t size) {
+  assert(!data && size);
+  if (unlikely_(!block))
+    return allocator_allocate(data, size);
+
+  /* Resize allocated blocks */
+  pb_mmap_header_t *header = header_from_block(block);
+  if (!header->addr) {
+    pb_mmap_header_t *target = realloc(header, block_header + size);
+    if (unlikely_(!target))
+      return NULL;                                         /* LCOV_EXCL_LINE */
+    target->capacity = size;
+    return block_from_header(target);
+  }
+
+  /* Mapped file is read-only */
+  if (unlikely_(!(header->flags & PB_MMAP_PRIVATE)))
+    return NULL;
+  if (size <= header->capacity)
+    return block;
+
+  /* Copy contents of mapped file to an allocated block */
+  void *target = allocator_allocate(data, size);
+  if (likely_(target != NULL)) {
+    memcpy(target, block, header->capacity);
+    block_release(block);
+  }
+  return target;
+}
+
+/*!
+ * Free an allocated memory block or unmap a mapped file.
+ *
+ * \param[in,out] data  Internal allocator data
+ * \param[in,out] block Memory block to be freed
+ */
+static void
+allocator_free(void *data, void *block) {
+  assert(!data && block);
+  block_release(block);
+}
+
+/* ----------------------------------------------------------------------------
+ * Allocator
+ * ------------------------------------------------------------------------- */
+
+/*! Allocator for mapped files */
+static pb_allocator_t
+allocator = {
+  .proc = {
+    .allocate = allocator_allocate,
+    .resize   = allocator_resize,
+    .free     = allocator_free
+  },
+  .data = NULL
+};
+
+/* ----------------------------------------------------------------------------
+ * Interface
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Create a buffer by mapping a file into memory.
+ *
+ * The file is mapped read-only, so all reads through decoders and cursors are
+ * served straight from the page cache without copying the file upfront, and
+ * the mapping is released when the buffer is destroyed. The buffer must not be
+ * altered, unless the file is mapped privately: writes then only affect the
+ * mapping, and the contents are copied to allocated memory once the buffer
+ * needs to grow. An empty file yields an empty buffer.
+ *
+ * \param[in] path  Path
+ * \param[in] flags Flags
+ * \return          Buffer
+ */
+extern pb_buffer_t
+pb_buffer_create_mmap(const char path[], int flags) {
+  assert(path);
+  int fd = open(path, O_RDONLY);
+  if (unlikely_(fd < 0))
+    return pb_buffer_create_invalid();
+
+  /* Determine file size */
+  struct stat info;
+  if (unlikely_(fstat(fd, &info) || !S_ISREG(info.st_mode) ||
+                (uint64_t)info.st_size > SIZE_MAX)) {
+    close(fd);
+    return pb_buffer_create_invalid();
+  }
+
+  /* Map file, unless it's empty */
+  pb_mmap_header_t *header = info.st_size
+    ? map_create(fd, info.st_size, flags)
+    : NULL;
+  close(fd);
+  if (unlikely_(info.st_size && !header))
+    return pb_buffer_create_invalid();                     /* LCOV_EXCL_LINE */
+
+  /* Create buffer on top of mapping */
+  pb_buffer_t buffer = {
+    .allocator = &allocator,
+    .data      = header ? block_from_header(header) : NULL,
+    .size      = info.st_size,
+    .capacity  = info.st_size
+  };
+  return buffer;
+}
+
+/*!
+ * Create a journal by mapping a file into memory.
+ *
+ * See pb_buffer_create_mmap() for details. Unless the file is mapped
+ * privately, the journal is frozen, so all writes fail.
+ *
+ * With PB_MMAP_PERSISTENT, the file is mapped privately and all edits are
+ * recorded, so they can be saved to the file with pb_journal_save_mmap().
+ * If a previous save was interrupted by a crash, the file is recovered from
+ * its write-ahead log before it is mapped.
+ *
+ * \param[in] path  Path
+ * \param[in] flags Flags
+ * \return          Journal
+ */
+extern pb_journal_t
+pb_journal_create_mmap(const char path[], int flags) {
+  assert(path);
+  if (flags & PB_MMAP_PERSISTENT) {
+    if (unlikely_(log_recover(path)))
+      return pb_journal_create_invalid();
+    flags |= PB_MMAP_PRIVATE;
+  }
+  pb_buffer_t  buffer  = pb_buffer_create_mmap(path, flags);
+  pb_journal_t journal = pb_journal_create_from_buffer(&buffer);
+  if (!(flags & PB_MMAP_PRIVATE) && pb_journal_freeze(&journal)) {
+    pb_journal_destroy(&journal);                          /* LCOV_EXCL_LINE */
+    return pb_journal_create_invalid();                    /* LCOV_EXCL_LINE */
+  }
+
+  /* Record edits of persistent journals */
+  if (flags & PB_MMAP_PERSISTENT && pb_journal_record(&journal)) {
+    pb_journal_destroy(&journal);
+    return pb_journal_create_invalid();
+  }
+  return journal;
+}
+
+/*!
+ * Save the edits of a persistent journal to the mapped file.
+ *
+ * Only the regions of the file that changed since the journal was created or
+ * last saved are written: ranges that were replaced with data of the same
+ * size are written as is, and once the size of a range changed, the rest of
+ * the file is written, as all subsequent data moved. The regions are first
+ * written to a write-ahead log next to the file, which is synchronized before
+ * the file is touched, so a crash during the update is recovered when the
+ * file is mapped again. Saving a single changed field thus costs a write of
+ * the field, and not of the whole file.
+ *
+ * \warning The journal must have been created with pb_journal_create_mmap()
+ * from the given path and with PB_MMAP_PERSISTENT, and the file may not be
+ * altered in the meantime.
+ *
+ * \param[in,out] journal Journal
+ * \param[in]     path    Path
+ * \return                Error code
+ */
+extern pb_error_t
+pb_journal_save_mmap(pb_journal_t *journal, const char path[]) {
+  assert(journal && path);
+  if (unlikely_(!pb_journal_valid(journal) || !journal->edit.enabled))
+    return PB_ERROR_INVALID;
+  if (journal->revision == journal->edit.base)
+    return PB_ERROR_NONE;
+
+  /* Export edits since the last save as a patch */
+  pb_buffer_t patch = pb_buffer_create_empty();
+  pb_error_t error = pb_journal_diff(journal, journal->edit.base, &patch);
+
+  /* Write size of file to write-ahead log */
+  pb_buffer_t log = pb_buffer_create_empty();
+  uint64_t total = pb_journal_size(journal);
+  uint8_t *data = error ? NULL
+    : pb_buffer_grow(&log, pb_varint_size_uint64(&total));
+  if (data)
+    pb_varint_pack_uint64(data, &total);
+  else if (!error)
+    error = PB_ERROR_ALLOC;                                /* LCOV_EXCL_LINE */
+
+  /* Write changed regions until the first change in size */
+  pb_stream_t stream = pb_stream_create(&patch);
+  uint64_t base, offset = 0;
+  if (!error)
+    error = pb_stream_read(&stream, PB_TYPE_UINT64, &base);
+  while (!error && pb_stream_left(&stream)) {
+    uint64_t distance, replaced, size;
+    if ((error = pb_stream_read(&stream, PB_TYPE_UINT64, &distance)) ||
+        (error = pb_stream_read(&stream, PB_TYPE_UINT64, &replaced)) ||
+        (error = pb_stream_read(&stream, PB_TYPE_UINT64, &size)))
+      break;
+    uint64_t start = offset + distance;
+    if (replaced != size) {
+      error = log_append(&log, journal, start, total - start);
+      break;
+    }
+    if (!(error = log_append(&log, journal, start, size)))
+      error = pb_stream_advance(&stream, size);
+    offset = start + replaced;
+  }
+  pb_stream_destroy(&stream);
+  pb_buffer_destroy(&patch);
+
+  /* Terminate write-ahead log with checksum */
+  if (!error) {
+    uint64_t checksum = log_checksum(pb_buffer_data(&log),
+      pb_buffer_size(&log));
+    if (likely_((data = pb_buffer_grow(&log, PB_MMAP_LOG_CHECKSUM)) != NULL)) {
+      for (size_t b = 0; b < PB_MMAP_LOG_CHECKSUM; b++, checksum >>= 8)
+        data[b] = (uint8_t)checksum;
+    } else {
+      error = PB_ERROR_ALLOC;                              /* LCOV_EXCL_LINE */
+    }
+  }
+
+  /* Open write-ahead log, creating it if necessary */
+  char *target = error ? NULL : log_path(path);
+  int fd = -1, created = 0;
+  if (target) {
+    if ((fd = open(target, O_WRONLY | O_TRUNC)) < 0 && errno == ENOENT) {
+      fd = open(target, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+      created = 1;
+    }
+    if (unlikely_(fd < 0))
+      error = PB_ERROR_INVALID;                            /* LCOV_EXCL_LINE */
+  } else if (!error) {
+    error = PB_ERROR_ALLOC;                                /* LCOV_EXCL_LINE */
+  }
+
+  /* Persist write-ahead log, update file and truncate write-ahead log */
+  if (!error && !(error = file_write(fd, 0,
+      pb_buffer_data(&log), pb_buffer_size(&log)))) {
+    if (unlikely_(fsync(fd)))
+      error = PB_ERROR_INVALID;                            /* LCOV_EXCL_LINE */
+    else if (created)
+      error = file_sync_directory(target);
+    if (!error && !(error = log_replay(path, &log)) &&
+        unlikely_(ftruncate(fd, 0) || fsync(fd)))
+      error = PB_ERROR_INVALID;                            /* LCOV_EXCL_LINE */
+  }
+  if (fd >= 0)
+    close(fd);
+  free(target);
+  pb_buffer_destroy(&log);
+  if (unlikely_(error))
+    return error;
+
+  /* Never grow a mapping beyond the end of the file, as it may have shrunk */
+  uint8_t *block = journal->buffer.data;
+  if (pb_buffer_allocator(&(journal->buffer)) == &allocator && block) {
+    pb_mmap_header_t *header = header_from_block(block);
+    if (header->addr && header->capacity > total)
+      header->capacity = journal->buffer.capacity = total;
+  }
+
+  /* Restart recording from the current revision */
+  return pb_journal_record(journal);
+}
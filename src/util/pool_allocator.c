@@ -0,0 +1,468 @@
+/*
+ * Copyright (c) 2013-2020 Martin Donath <martin.donath@squidfunk.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "core/allocator.h"
+#include "core/common.h"
+#include "util/pool_allocator.h"
+
+/* ----------------------------------------------------------------------------
+ * Constants
+ * ------------------------------------------------------------------------- */
+
+/*! Alignment of memory blocks */
+#define PB_POOL_ALLOCATOR_ALIGNMENT 16
+
+/*! Capacity of the smallest size class */
+#define PB_POOL_ALLOCATOR_MINIMUM   32
+
+/*! Number of size classes, larger blocks are not pooled */
+#define PB_POOL_ALLOCATOR_CLASSES   12
+
+/*! Maximum number of cached blocks per thread and size class */
+#define PB_POOL_ALLOCATOR_CACHE     16
+
+/*! Maximum number of blocks in the depot per size class */
+#define PB_POOL_ALLOCATOR_DEPOT     64
+
+/* ----------------------------------------------------------------------------
+ * Type definitions
+ * ------------------------------------------------------------------------- */
+
+typedef struct pb_pool_header_t {
+  size_t index;                        /*!< Size class */
+  size_t capacity;                     /*!< Block capacity */
+} pb_pool_header_t;
+
+typedef struct pb_pool_block_t {
+  struct pb_pool_block_t *next;        /*!< Next free block */
+} pb_pool_block_t;
+
+typedef struct pb_pool_list_t {
+  pb_pool_block_t *head;               /*!< First free block */
+  size_t size;                         /*!< Free blocks */
+} pb_pool_list_t;
+
+typedef struct pb_pool_cache_t {
+  pb_pool_list_t list[PB_POOL_ALLOCATOR_CLASSES];
+                                       /*!< Free blocks per size class */
+  int registered;                      /*!< Registered for thread exit */
+} pb_pool_cache_t;
+
+typedef struct pb_pool_allocator_t {
+  pthread_mutex_t lock;                /*!< Depot lock */
+  pb_pool_list_t depot[PB_POOL_ALLOCATOR_CLASSES];
+                                       /*!< Free blocks per size class */
+} pb_pool_allocator_t;
+
+/* ----------------------------------------------------------------------------
+ * Macros
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Size of the (aligned) header of memory blocks.
+ */
+#define block_header \
+  ((sizeof(pb_pool_header_t) + PB_POOL_ALLOCATOR_ALIGNMENT - 1) & \
+    ~((size_t)PB_POOL_ALLOCATOR_ALIGNMENT - 1))
+
+/*!
+ * Retrieve the header of a memory block.
+ *
+ * \param[in] block Memory block
+ * \return          Header
+ */
+#define header_from_block(block) \
+  (assert(block), (pb_pool_header_t *)((uint8_t *)(block) - block_header))
+
+/*!
+ * Retrieve the memory block of a header.
+ *
+ * \param[in] header Header
+ * \return           Memory block
+ */
+#define block_from_header(header) \
+  (assert(header), (void *)((uint8_t *)(header) + block_header))
+
+/* ----------------------------------------------------------------------------
+ * Variables
+ * ------------------------------------------------------------------------- */
+
+/*! Process-wide pool */
+static pb_pool_allocator_t pool = {
+  .lock = PTHREAD_MUTEX_INITIALIZER
+};
+
+/*! Thread-local cache */
+static __thread pb_pool_cache_t cache;
+
+/*! Key to release the thread-local cache on thread exit */
+static pthread_key_t key;
+
+/*! Key initialization guard */
+static pthread_once_t once = PTHREAD_ONCE_INIT;
+
+/*! Trim hook registration guard */
+static pthread_once_t once_trim = PTHREAD_ONCE_INIT;
+
+/* ----------------------------------------------------------------------------
+ * Internal functions
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Retrieve the size class for a memory block of given size.
+ *
+ * \param[in] size Bytes to be allocated
+ * \return         Size class
+ */
+static size_t
+class_from_size(size_t size) {
+  size_t index = 0, capacity = PB_POOL_ALLOCATOR_MINIMUM;
+  while (capacity < size && index < PB_POOL_ALLOCATOR_CLASSES) {
+    capacity <<= 1; index++;
+  }
+  return index;
+}
+
+/*!
+ * Push a free memory block onto a list.
+ *
+ * \param[in,out] list  List
+ * \param[in,out] block Memory block
+ */
+static void
+list_push(pb_pool_list_t *list, void *block) {
+  assert(list && block);
+  pb_pool_block_t *entry = block;
+  entry->next = list->head;
+  list->head = entry;
+  list->size++;
+}
+
+/*!
+ * Pop a free memory block from a list.
+ *
+ * \param[in,out] list List
+ * \return             Memory block
+ */
+static void *
+list_pop(pb_pool_list_t *list) {
+  assert(list && list->head);
+  pb_pool_block_t *entry = list->head;
+  list->head = entry->next;
+  list->size--;
+  return entry;
+}
+
+/*!
+ * Move free memory blocks from the depot into a list.
+ *
+ * Only a single lock acquisition is necessary to refill half of the cache of
+ * the calling thread, so the lock is taken at most once every few blocks.
+ *
+ * \param[in,out] base  Pool allocator
+ * \param[in,out] list  List
+ * \param[in]     index Size class
+ */
+static void
+depot_acquire(pb_pool_allocator_t *base, pb_pool_list_t *list, size_t index) {
+  assert(base && list && index < PB_POOL_ALLOCATOR_CLASSES);
+  pb_pool_list_t *depot = &(base->depot[index]);
+  pthread_mutex_lock(&(base->lock));
+  for (size_t b = 0; b < PB_POOL_ALLOCATOR_CACHE / 2 && depot->head; b++)
+    list_push(list, list_pop(depot));
+  pthread_mutex_unlock(&(base->lock));
+}
+
+/*!
+ * Move free memory blocks from a list into the depot.
+ *
+ * Blocks exceeding the bounds of the depot are returned to the system.
+ *
+ * \param[in,out] base  Pool allocator
+ * \param[in,out] list  List
+ * \param[in]     index Size class
+ * \param[in]     count Blocks to be moved
+ */
+static void
+depot_release(
+    pb_pool_allocator_t *base, pb_pool_list_t *list, size_t index,
+    size_t count) {
+  assert(base && list && index < PB_POOL_ALLOCATOR_CLASSES);
+  pb_pool_list_t *depot = &(base->depot[index]);
+  pthread_mutex_lock(&(base->lock));
+  for (size_t b = 0; b < count && list->head; b++) {
+    void *block = list_pop(list);
+    if (depot->size < PB_POOL_ALLOCATOR_DEPOT) {
+      list_push(depot, block);
+    } else {
+      free(header_from_block(block));
+    }
+  }
+  pthread_mutex_unlock(&(base->lock));
+}
+
+/*!
+ * Release the thread-local cache into the depot on thread exit.
+ *
+ * \param[in,out] data Thread-local cache
+ */
+static void
+cache_destroy(void *data) {
+  pb_pool_cache_t *local = data;
+  for (size_t c = 0; c < PB_POOL_ALLOCATOR_CLASSES; c++)
+    depot_release(&pool, &(local->list[c]), c, local->list[c].size);
+  local->registered = 0;
+}
+
+/*!
+ * Create the key to release thread-local caches on thread exit.
+ */
+static void
+cache_key_create(void) {
+  pthread_key_create(&key, cache_destroy);
+}
+
+/*!
+ * Register the pool allocator for process-wide trimming.
+ */
+static void
+trim_register(void) {
+
+  /* If all slots are taken, the pool can still be trimmed explicitly */
+  pb_error_t error = pb_allocator_trim_register(pb_pool_allocator_trim);
+  (void)error;
+}
+
+/*!
+ * Retrieve the thread-local cache of the calling thread.
+ *
+ * \return Thread-local cache
+ */
+static pb_pool_cache_t *
+cache_acquire(void) {
+  if (unlikely_(!cache.registered)) {
+    pthread_once(&once, cache_key_create);
+    cache.registered = !pthread_setspecific(key, &cache);
+  }
+  return &cache;
+}
+
+/*!
+ * Release a memory block into the cache of the calling thread.
+ *
+ * \param[in,out] base  Pool allocator
+ * \param[in,out] block Memory block
+ */
+static void
+block_release(pb_pool_allocator_t *base, void *block) {
+  assert(block);
+  pb_pool_header_t *header = header_from_block(block);
+  if (unlikely_(!base || header->index == PB_POOL_ALLOCATOR_CLASSES)) {
+    free(header);
+
+  /* Cache block and release half of the cache, if full */
+  } else {
+    pb_pool_list_t *list = &(cache_acquire()->list[header->index]);
+    if (unlikely_(list->size == PB_POOL_ALLOCATOR_CACHE))
+      depot_release(base, list, header->index, PB_POOL_ALLOCATOR_CACHE / 2);
+    list_push(list, block);
+  }
+}
+
+/* ----------------------------------------------------------------------------
+ * Allocator callbacks
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Allocate a memory block of given size.
+ *
+ * The size is rounded up to the next power of two and a free block of that
+ * size class is taken from the cache of the calling thread. If the cache is
+ * empty, it is refilled from the depot, and only if the depot is empty too, a
+ * new block is allocated. Blocks exceeding the largest size class are always
+ * allocated and freed directly.
+ *
+ * \param[in,out] data Internal allocator data
+ * \param[in]     size Bytes to be allocated
+ * \return             Memory block
+ */
+static void *
+allocator_allocate(void *data, size_t size) {
+  assert(size);
+  if (unlikely_(!data))
+    return NULL;
+
+  /* Allocate blocks exceeding the largest size class directly */
+  size_t index = class_from_size(size);
+  if (unlikely_(index == PB_POOL_ALLOCATOR_CLASSES)) {
+    pb_pool_header_t *header = malloc(block_header + size);
+    if (unlikely_(!header))
+      return NULL;                                         /* LCOV_EXCL_LINE */
+    *header = (pb_pool_header_t){
+      .index    = index,
+      .capacity = size
+    };
+    return block_from_header(header);
+  }
+
+  /* Reuse a cached block, refilling the cache from the depot if necessary */
+  pb_pool_list_t *list = &(cache_acquire()->list[index]);
+  if (!list->head)
+    depot_acquire(data, list, index);
+  if (list->head)
+    return list_pop(list);
+
+  /* Allocate a new block of the size class */
+  size_t capacity = (size_t)PB_POOL_ALLOCATOR_MINIMUM << index;
+  pb_pool_header_t *header = malloc(block_header + capacity);
+  if (unlikely_(!header))
+    return NULL;                                           /* LCOV_EXCL_LINE */
+  *header = (pb_pool_header_t){
+    .index    = index,
+    .capacity = capacity
+  };
+  return block_from_header(header);
+}
+
+/*!
+ * Change the size of a previously allocated memory block.
+ *
+ * If the memory block is large enough to hold the requested size, it is kept.
+ * Otherwise, a memory block of the matching size class is allocated and the
+ * contents are copied.
+ *
+ * \param[in,out] data  Internal allocator data
+ * \param[in,out] block Memory block to be resized
+ * \param[in]     size  Bytes to be allocated
+ * \return              Memory block
+ */
+static void *
+allocator_resize(void *data, void *block, size_t size) {
+  assert(size);
+  if (unlikely_(!data))
+    return NULL;
+  if (unlikely_(!block))
+    return allocator_allocate(data, size);
+
+  /* Keep block, if large enough */
+  pb_pool_header_t *header = header_from_block(block);
+  if (size <= header->capacity)
+    return block;
+
+  /* Resize blocks exceeding the largest size class directly */
+  if (header->index == PB_POOL_ALLOCATOR_CLASSES) {
+    pb_pool_header_t *target = realloc(header, block_header + size);
+    if (unlikely_(!target))
+      return NULL;                                         /* LCOV_EXCL_LINE */
+    target->capacity = size;
+    return block_from_header(target);
+  }
+
+  /* Allocate a new block and copy contents */
+  void *target = allocator_allocate(data, size);
+  if (likely_(target != NULL)) {
+    memcpy(target, block, header->capacity);
+    block_release(data, block);
+  }
+  return target;
+}
+
+/*!
+ * Free an allocated memory block.
+ *
+ * The memory block is put into the cache of the calling thread, regardless of
+ * which thread allocated it. If the cache is full, half of it is moved to the
+ * depot, so other threads can reuse the blocks.
+ *
+ * \param[in,out] data  Internal allocator data
+ * \param[in,out] block Memory block to be freed
+ */
+static void
+allocator_free(void *data, void *block) {
+  assert(block);
+  block_release(data, block);
+}
+
+/* ----------------------------------------------------------------------------
+ * Interface
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Create a pool allocator.
+ *
+ * All pool allocators share a single process-wide depot, and every thread
+ * caches free blocks locally, so a pool allocator can be safely used from
+ * many threads at once and never needs to be destroyed. Cached blocks are
+ * released into the depot when a thread exits. The pool is registered with
+ * pb_allocator_trim(), so it can be emptied when the process becomes idle.
+ *
+ * \return Pool allocator
+ */
+extern pb_allocator_t
+pb_pool_allocator_create(void) {
+  pthread_once(&once_trim, trim_register);
+  pb_allocator_t allocator = {
+    .proc = {
+      .allocate = allocator_allocate,
+      .resize   = allocator_resize,
+      .free     = allocator_free
+    },
+    .data = &pool
+  };
+  return allocator;
+}
+
+/*!
+ * Return all free memory blocks of the pool allocator to the system.
+ *
+ * The cache of the calling thread and the process-wide depot are emptied. The
+ * caches of other threads can't be touched safely, but are bounded in size
+ * and handed over to the depot on thread exit, so trimming periodically, or
+ * from every worker thread before it goes idle, releases all pooled memory.
+ */
+extern void
+pb_pool_allocator_trim(void) {
+  for (size_t c = 0; c < PB_POOL_ALLOCATOR_CLASSES; c++) {
+    pb_pool_list_t *list = &(cache.list[c]);
+    while (list->head) {
+      void *block = list_pop(list);
+      free(header_from_block(block));
+    }
+  }
+
+  /* Empty depot */
+  pthread_mutex_lock(&(pool.lock));
+  for (size_t c = 0; c < PB_POOL_ALLOCATOR_CLASSES; c++) {
+    pb_pool_list_t *depot = &(pool.depot[c]);
+    while (depot->head) {
+      void *block = list_pop(depot);
+      free(header_from_block(block));
+    }
+  }
+  pthread_mutex_unlock(&(pool.lock));
+}
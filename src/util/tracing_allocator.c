@@ -0,0 +1,306 @@
+/*
+ * Copyright (c) 2013-2020 Martin Donath <martin.donath@squidfunk.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "core/allocator.h"
+#include "core/common.h"
+#include "util/tracing_allocator.h"
+
+/* ----------------------------------------------------------------------------
+ * Constants
+ * ------------------------------------------------------------------------- */
+
+/*! Alignment of memory blocks */
+#define PB_TRACING_ALLOCATOR_ALIGNMENT 16
+
+/* ----------------------------------------------------------------------------
+ * Type definitions
+ * ------------------------------------------------------------------------- */
+
+typedef struct pb_tracing_header_t {
+  size_t size;                         /*!< Requested size */
+} pb_tracing_header_t;
+
+typedef struct pb_tracing_allocator_t {
+  pb_allocator_t *inner;               /*!< Inner allocator */
+  int histogram;                       /*!< Whether to record histogram */
+  pb_tracing_allocator_stats_t stats;  /*!< Statistics */
+} pb_tracing_allocator_t;
+
+/* ----------------------------------------------------------------------------
+ * Macros
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Size of the (aligned) header of memory blocks.
+ */
+#define block_header \
+  ((sizeof(pb_tracing_header_t) + PB_TRACING_ALLOCATOR_ALIGNMENT - 1) & \
+    ~((size_t)PB_TRACING_ALLOCATOR_ALIGNMENT - 1))
+
+/*!
+ * Retrieve the header of a memory block.
+ *
+ * \param[in] block Memory block
+ * \return          Header
+ */
+#define header_from_block(block) \
+  (assert(block), (pb_tracing_header_t *)((uint8_t *)(block) - block_header))
+
+/*!
+ * Retrieve the memory block of a header.
+ *
+ * \param[in] header Header
+ * \return           Memory block
+ */
+#define block_from_header(header) \
+  (assert(header), (void *)((uint8_t *)(header) + block_header))
+
+/* ----------------------------------------------------------------------------
+ * Internal functions
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Record a request of given size.
+ *
+ * Sizes are recorded in the histogram by their highest set bit, so the n-th
+ * bucket counts all requests of at least 2^n and less than 2^(n+1) bytes.
+ *
+ * \param[in,out] base Tracing allocator
+ * \param[in]     size Bytes requested
+ */
+static void
+record(pb_tracing_allocator_t *base, size_t size) {
+  assert(base && size);
+  base->stats.requested += size;
+  if (base->histogram) {
+    size_t bucket = 0;
+    while (size >>= 1)
+      bucket++;
+    if (bucket >= PB_TRACING_ALLOCATOR_BUCKETS)
+      bucket = PB_TRACING_ALLOCATOR_BUCKETS - 1;
+    base->stats.histogram[bucket]++;
+  }
+}
+
+/*!
+ * Adjust the live bytes by the given delta and track the peak.
+ *
+ * \param[in,out] base   Tracing allocator
+ * \param[in]     before Bytes before the operation
+ * \param[in]     after  Bytes after the operation
+ */
+static void
+adjust(pb_tracing_allocator_t *base, size_t before, size_t after) {
+  assert(base && base->stats.live >= before);
+  base->stats.live = base->stats.live - before + after;
+  if (base->stats.peak < base->stats.live)
+    base->stats.peak = base->stats.live;
+}
+
+/* ----------------------------------------------------------------------------
+ * Allocator callbacks
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Allocate a memory block of given size.
+ *
+ * \param[in,out] data Internal allocator data
+ * \param[in]     size Bytes to be allocated
+ * \return             Memory block
+ */
+static void *
+allocator_allocate(void *data, size_t size) {
+  assert(size);
+  if (unlikely_(!data))
+    return NULL;
+
+  /* Record request and forward to inner allocator */
+  pb_tracing_allocator_t *base = data;
+  base->stats.allocations++;
+  record(base, size);
+  pb_tracing_header_t *header =
+    pb_allocator_allocate(base->inner, block_header + size);
+  if (unlikely_(!header))
+    return NULL;
+
+  /* Initialize header and track live bytes */
+  header->size = size;
+  adjust(base, 0, size);
+  return block_from_header(header);
+}
+
+/*!
+ * Change the size of a previously allocated memory block.
+ *
+ * If the inner allocator moves the memory block, the bytes that must have
+ * been copied are recorded as moved.
+ *
+ * \param[in,out] data  Internal allocator data
+ * \param[in,out] block Memory block to be resized
+ * \param[in]     size  Bytes to be allocated
+ * \return              Memory block
+ */
+static void *
+allocator_resize(void *data, void *block, size_t size) {
+  assert(size);
+  if (unlikely_(!data))
+    return NULL;
+
+  /* Record request and forward to inner allocator */
+  pb_tracing_allocator_t *base = data;
+  base->stats.resizes++;
+  record(base, size);
+  pb_tracing_header_t *header = block ? header_from_block(block) : NULL,
+                      *target = pb_allocator_resize(base->inner, header,
+                        block_header + size);
+  if (unlikely_(!target))
+    return NULL;
+
+  /* Track moved and live bytes */
+  size_t before = header ? target->size : 0;
+  if (header && target != header)
+    base->stats.moved += before < size ? before : size;
+  target->size = size;
+  adjust(base, before, size);
+  return block_from_header(target);
+}
+
+/*!
+ * Free an allocated memory block.
+ *
+ * \param[in,out] data  Internal allocator data
+ * \param[in,out] block Memory block to be freed
+ */
+static void
+allocator_free(void *data, void *block) {
+  assert(data && block);
+  pb_tracing_allocator_t *base = data;
+  pb_tracing_header_t *header = header_from_block(block);
+
+  /* Track live bytes and forward to inner allocator */
+  base->stats.frees++;
+  adjust(base, header->size, 0);
+  pb_allocator_free(base->inner, header);
+}
+
+/* ----------------------------------------------------------------------------
+ * Interface
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Create a tracing allocator wrapping another allocator.
+ *
+ * \param[in,out] inner Inner allocator
+ * \return              Tracing allocator
+ */
+extern pb_allocator_t
+pb_tracing_allocator_create(pb_allocator_t *inner) {
+  assert(inner);
+  pb_allocator_t allocator = {
+    .proc = {
+      .allocate = allocator_allocate,
+      .resize   = allocator_resize,
+      .free     = allocator_free
+    },
+    .data = NULL
+  };
+  pb_tracing_allocator_t *base = malloc(sizeof(pb_tracing_allocator_t));
+  if (base) {
+    *base = (pb_tracing_allocator_t){
+      .inner     = inner,
+      .histogram = 0
+    };
+    allocator.data = base;
+  }
+  return allocator;
+}
+
+/*!
+ * Create a tracing allocator wrapping another allocator with a histogram.
+ *
+ * \param[in,out] inner Inner allocator
+ * \return              Tracing allocator
+ */
+extern pb_allocator_t
+pb_tracing_allocator_create_with_histogram(pb_allocator_t *inner) {
+  assert(inner);
+  pb_allocator_t allocator = pb_tracing_allocator_create(inner);
+  if (allocator.data) {
+    pb_tracing_allocator_t *base = allocator.data;
+    base->histogram = 1;
+  }
+  return allocator;
+}
+
+/*!
+ * Destroy a tracing allocator.
+ *
+ * Memory blocks that are still allocated are not freed, as they are owned by
+ * the inner allocator.
+ *
+ * \param[in,out] allocator Tracing allocator
+ */
+extern void
+pb_tracing_allocator_destroy(pb_allocator_t *allocator) {
+  assert(allocator);
+  free(allocator->data);
+}
+
+/*!
+ * Reset the statistics of a tracing allocator.
+ *
+ * All counters and the histogram are cleared, except for the live bytes,
+ * which also become the new peak.
+ *
+ * \param[in,out] allocator Tracing allocator
+ */
+extern void
+pb_tracing_allocator_reset(pb_allocator_t *allocator) {
+  assert(allocator);
+  pb_tracing_allocator_t *base = allocator->data;
+  if (base) {
+    size_t live = base->stats.live;
+    base->stats = (pb_tracing_allocator_stats_t){
+      .live = live,
+      .peak = live
+    };
+  }
+}
+
+/*!
+ * Retrieve statistics of a tracing allocator.
+ *
+ * \param[in] allocator Tracing allocator
+ * \return              Statistics
+ */
+extern pb_tracing_allocator_stats_t
+pb_tracing_allocator_stats(const pb_allocator_t *allocator) {
+  assert(allocator);
+  const pb_tracing_allocator_t *base = allocator->data;
+  if (unlikely_(!base))
+    return (pb_tracing_allocator_stats_t){ 0 };
+  return base->stats;
+}
@@ -0,0 +1,626 @@
+/*
+ * Copyright (c) 2013-2020 Martin Donath <martin.donath@squidfunk.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#define _GNU_SOURCE
+
+#include <assert.h>
+#include <errno.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#endif
+#endif
+
+#include "core/allocator.h"
+#include "core/buffer.h"
+#include "core/common.h"
+#include "core/varint.h"
+#include "util/uring_reader.h"
+
+/* ----------------------------------------------------------------------------
+ * Type definitions
+ * ------------------------------------------------------------------------- */
+
+#if defined(IORING_OFF_SQ_RING) && defined(SYS_io_uring_setup)
+
+typedef struct pb_uring_t {
+  int fd;                              /*!< Ring file descriptor */
+  struct {
+    uint8_t *data;                     /*!< Mapping */
+    size_t size;                       /*!< Mapping size */
+    uint32_t *tail;                    /*!< Tail */
+    uint32_t *mask;                    /*!< Mask */
+    uint32_t *array;                   /*!< Indices of entries */
+    struct io_uring_sqe *sqes;         /*!< Entries */
+    size_t sqes_size;                  /*!< Entries mapping size */
+  } sq;
+  struct {
+    uint8_t *data;                     /*!< Mapping, may be shared */
+    size_t size;                       /*!< Mapping size */
+    uint32_t *head;                    /*!< Head */
+    uint32_t *tail;                    /*!< Tail */
+    uint32_t *mask;                    /*!< Mask */
+    struct io_uring_cqe *cqes;         /*!< Entries */
+  } cq;
+  size_t queued;                       /*!< Entries queued for submission */
+  size_t pending;                      /*!< Reads in flight */
+} pb_uring_t;
+
+/* ----------------------------------------------------------------------------
+ * Ring functions
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Destroy a ring.
+ *
+ * \param[in,out] ring Ring
+ */
+static void
+ring_destroy(pb_uring_t *ring) {
+  assert(ring);
+  if (ring->sq.sqes)
+    munmap(ring->sq.sqes, ring->sq.sqes_size);
+  if (ring->cq.data && ring->cq.data != ring->sq.data)
+    munmap(ring->cq.data, ring->cq.size);
+  if (ring->sq.data)
+    munmap(ring->sq.data, ring->sq.size);
+  close(ring->fd);
+  pb_allocator_free(&allocator_default, ring);
+}
+
+/*!
+ * Create a ring and register the regions with it.
+ *
+ * Registering the regions upfront saves the kernel from mapping them upon
+ * every read. If any step fails, e.g. because io_uring is disabled or the
+ * locked memory limit is exceeded, no ring is created.
+ *
+ * \param[in]     entries Entry count
+ * \param[in,out] data    Regions
+ * \param[in]     size    Regions size
+ * \return                Ring
+ */
+static pb_uring_t *
+ring_create(size_t entries, uint8_t *data, size_t size) {
+  assert(entries && data && size);
+  struct io_uring_params params;
+  memset(&params, 0, sizeof(params));
+  long fd = syscall(SYS_io_uring_setup, (unsigned)entries, &params);
+  if (fd < 0)
+    return NULL;
+
+  /* Allocate ring */
+  pb_uring_t *ring =
+    pb_allocator_allocate(&allocator_default, sizeof(pb_uring_t));
+  if (unlikely_(!ring)) {
+    close(fd);                                             /* LCOV_EXCL_LINE */
+    return NULL;                                           /* LCOV_EXCL_LINE */
+  }
+  memset(ring, 0, sizeof(pb_uring_t));
+  ring->fd = (int)fd;
+
+  /* Map submission and completion queues, which may share a mapping */
+  ring->sq.size = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+  ring->cq.size = params.cq_off.cqes +
+    params.cq_entries * sizeof(struct io_uring_cqe);
+  int single = params.features & IORING_FEAT_SINGLE_MMAP;
+  if (single && ring->cq.size > ring->sq.size)
+    ring->sq.size = ring->cq.size;
+  void *sq = mmap(NULL, ring->sq.size, PROT_READ | PROT_WRITE,
+    MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQ_RING);
+  if (sq == MAP_FAILED) {
+    ring_destroy(ring);                                    /* LCOV_EXCL_LINE */
+    return NULL;                                           /* LCOV_EXCL_LINE */
+  }
+  ring->sq.data = sq;
+  void *cq = single ? sq : mmap(NULL, ring->cq.size, PROT_READ | PROT_WRITE,
+    MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_CQ_RING);
+  if (cq == MAP_FAILED) {
+    ring_destroy(ring);                                    /* LCOV_EXCL_LINE */
+    return NULL;                                           /* LCOV_EXCL_LINE */
+  }
+  ring->cq.data = cq;
+
+  /* Map submission queue entries */
+  ring->sq.sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+  void *sqes = mmap(NULL, ring->sq.sqes_size, PROT_READ | PROT_WRITE,
+    MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQES);
+  if (sqes == MAP_FAILED) {
+    ring_destroy(ring);                                    /* LCOV_EXCL_LINE */
+    return NULL;                                           /* LCOV_EXCL_LINE */
+  }
+  ring->sq.sqes = sqes;
+
+  /* Resolve queue pointers */
+  ring->sq.tail  = (uint32_t *)(ring->sq.data + params.sq_off.tail);
+  ring->sq.mask  = (uint32_t *)(ring->sq.data + params.sq_off.ring_mask);
+  ring->sq.array = (uint32_t *)(ring->sq.data + params.sq_off.array);
+  ring->cq.head  = (uint32_t *)(ring->cq.data + params.cq_off.head);
+  ring->cq.tail  = (uint32_t *)(ring->cq.data + params.cq_off.tail);
+  ring->cq.mask  = (uint32_t *)(ring->cq.data + params.cq_off.ring_mask);
+  ring->cq.cqes  =
+    (struct io_uring_cqe *)(ring->cq.data + params.cq_off.cqes);
+
+  /* Register regions */
+  struct iovec iov = { .iov_base = data, .iov_len = size };
+  if (syscall(SYS_io_uring_register,
+      ring->fd, IORING_REGISTER_BUFFERS, &iov, 1) < 0) {
+    ring_destroy(ring);
+    return NULL;
+  }
+  return ring;
+}
+
+/*!
+ * Queue a read of a region.
+ *
+ * \param[in,out] ring   Ring
+ * \param[in]     fd     File descriptor
+ * \param[in,out] data   Region
+ * \param[in]     size   Region capacity
+ * \param[in]     offset File offset
+ * \param[in]     chunk  Chunk
+ */
+static void
+ring_queue(
+    pb_uring_t *ring, int fd, uint8_t *data, size_t size, off_t offset,
+    size_t chunk) {
+  assert(ring && data && size);
+  uint32_t tail = *ring->sq.tail, index = tail & *ring->sq.mask;
+  struct io_uring_sqe *sqe = &(ring->sq.sqes[index]);
+  memset(sqe, 0, sizeof(*sqe));
+  sqe->opcode    = IORING_OP_READ_FIXED;
+  sqe->fd        = fd;
+  sqe->addr      = (uintptr_t)data;
+  sqe->len       = (uint32_t)size;
+  sqe->off       = (uint64_t)offset;
+  sqe->buf_index = 0;
+  sqe->user_data = chunk;
+  ring->sq.array[index] = index;
+  __atomic_store_n(ring->sq.tail, tail + 1, __ATOMIC_RELEASE);
+  ring->queued++;
+  ring->pending++;
+}
+
+/*!
+ * Submit all queued reads and optionally wait for a completion.
+ *
+ * \param[in,out] ring Ring
+ * \param[in]     min  Minimum number of completions
+ * \return             Error code
+ */
+static pb_error_t
+ring_enter(pb_uring_t *ring, unsigned min) {
+  assert(ring);
+  while (ring->queued || min) {
+    long submitted = syscall(SYS_io_uring_enter, ring->fd,
+      (unsigned)ring->queued, min, min ? IORING_ENTER_GETEVENTS : 0,
+      NULL, 0);
+    if (unlikely_(submitted < 0)) {
+      if (errno == EINTR)
+        continue;                                          /* LCOV_EXCL_LINE */
+      return PB_ERROR_INVALID;                             /* LCOV_EXCL_LINE */
+    }
+    ring->queued -= (size_t)submitted;
+    min = 0;
+  }
+  return PB_ERROR_NONE;
+}
+
+#else /* IORING_OFF_SQ_RING && SYS_io_uring_setup */
+
+typedef struct pb_uring_t pb_uring_t;
+
+#endif /* IORING_OFF_SQ_RING && SYS_io_uring_setup */
+
+/* ----------------------------------------------------------------------------
+ * Internal functions
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Retrieve a region of a reader by chunk.
+ *
+ * Chunk n of the file is always read into region n modulo the region count,
+ * so consecutive chunks are adjacent in memory until the regions wrap around.
+ *
+ * \param[in] reader Reader
+ * \param[in] chunk  Chunk
+ * \return           Region index
+ */
+PB_INLINE size_t
+region(const pb_uring_reader_t *reader, size_t chunk) {
+  assert(reader);
+  return chunk % reader->region.count;
+}
+
+/*!
+ * Record the result of a read.
+ *
+ * Reads of regular files only return less than requested at the end of the
+ * file, but as this is not guaranteed, the rest is read with blocking reads.
+ *
+ * \param[in,out] reader Reader
+ * \param[in]     chunk  Chunk
+ * \param[in]     bytes  Bytes read or negative error
+ * \return               Error code
+ */
+static pb_error_t
+complete(pb_uring_reader_t *reader, size_t chunk, ssize_t bytes) {
+  assert(reader);
+  size_t capacity = reader->region.capacity;
+  uint8_t *data = reader->region.data + region(reader, chunk) * capacity;
+  off_t offset = reader->base + (off_t)(chunk * capacity);
+  size_t size = 0;
+  while (bytes > 0 && (size += (size_t)bytes) < capacity) {
+    do {
+      bytes = pread(reader->fd, data + size, capacity - size,
+        offset + (off_t)size);
+    } while (unlikely_(bytes < 0 && errno == EINTR));
+  }
+  reader->region.size[region(reader, chunk)] = size;
+  if (unlikely_(bytes < 0))
+    return PB_ERROR_INVALID;
+
+  /* Remember end of file, as subsequent chunks are empty */
+  if (size < capacity && chunk + 1 < reader->end)
+    reader->end = chunk + 1;
+  return PB_ERROR_NONE;
+}
+
+/*!
+ * Submit reads for all regions that are no longer in use.
+ *
+ * \param[in,out] reader Reader
+ * \return               Error code
+ */
+static pb_error_t
+refill(pb_uring_reader_t *reader) {
+  assert(reader);
+  pb_error_t error = PB_ERROR_NONE;
+  while (!error && reader->submitted < reader->end &&
+      reader->submitted < reader->chunk + reader->region.count) {
+    size_t chunk = reader->submitted++;
+    size_t capacity = reader->region.capacity;
+    uint8_t *data = reader->region.data + region(reader, chunk) * capacity;
+    off_t offset = reader->base + (off_t)(chunk * capacity);
+    reader->region.size[region(reader, chunk)] = SIZE_MAX;
+
+#if defined(IORING_OFF_SQ_RING) && defined(SYS_io_uring_setup)
+
+    /* Queue read, if a ring is available */
+    if (reader->ring) {
+      ring_queue(reader->ring, reader->fd, data, capacity, offset, chunk);
+      continue;
+    }
+
+#endif /* IORING_OFF_SQ_RING && SYS_io_uring_setup */
+
+    /* Otherwise read region right away */
+    ssize_t bytes;
+    do {
+      bytes = pread(reader->fd, data, capacity, offset);
+    } while (unlikely_(bytes < 0 && errno == EINTR));
+    error = complete(reader, chunk, bytes);
+  }
+
+#if defined(IORING_OFF_SQ_RING) && defined(SYS_io_uring_setup)
+
+  /* Submit all queued reads at once */
+  if (!error && reader->ring)
+    error = ring_enter(reader->ring, 0);
+
+#endif /* IORING_OFF_SQ_RING && SYS_io_uring_setup */
+
+  return error;
+}
+
+/*!
+ * Wait until the read of a chunk is complete.
+ *
+ * \param[in,out] reader Reader
+ * \param[in]     chunk  Chunk
+ * \return               Error code
+ */
+static pb_error_t
+settle(pb_uring_reader_t *reader, size_t chunk) {
+  assert(reader && chunk < reader->submitted);
+  pb_error_t error = PB_ERROR_NONE;
+  while (!error && reader->region.size[region(reader, chunk)] == SIZE_MAX) {
+
+#if defined(IORING_OFF_SQ_RING) && defined(SYS_io_uring_setup)
+
+    /* Reap all completed reads, or wait for the next one */
+    pb_uring_t *ring = reader->ring;
+    assert(ring && ring->pending);
+    uint32_t head = *ring->cq.head;
+    uint32_t tail = __atomic_load_n(ring->cq.tail, __ATOMIC_ACQUIRE);
+    if (head == tail) {
+      error = ring_enter(ring, 1);
+      continue;
+    }
+    for (; !error && head != tail; head++, ring->pending--) {
+      struct io_uring_cqe *cqe = &(ring->cq.cqes[head & *ring->cq.mask]);
+      error = complete(reader, (size_t)cqe->user_data, cqe->res);
+    }
+    __atomic_store_n(ring->cq.head, head, __ATOMIC_RELEASE);
+
+#else /* IORING_OFF_SQ_RING && SYS_io_uring_setup */
+
+    assert(0);                                             /* LCOV_EXCL_LINE */
+
+#endif /* IORING_OFF_SQ_RING && SYS_io_uring_setup */
+
+  }
+  return error;
+}
+
+/*!
+ * Retrieve the number of bytes available in a chunk, waiting for its read.
+ *
+ * \param[in,out] reader Reader
+ * \param[in]     chunk  Chunk
+ * \param[out]    size   Bytes available
+ * \return               Error code
+ */
+static pb_error_t
+available(pb_uring_reader_t *reader, size_t chunk, size_t *size) {
+  assert(reader && size);
+  *size = 0;
+  if (chunk >= reader->end)
+    return PB_ERROR_NONE;
+  pb_error_t error = settle(reader, chunk);
+  if (likely_(!error))
+    *size = reader->region.size[region(reader, chunk)];
+  return error;
+}
+
+/*!
+ * Copy bytes from the current position of a reader.
+ *
+ * If the reader is advanced, regions are submitted for reading again as soon
+ * as all of their bytes are consumed, so arbitrarily large messages can be
+ * copied. Otherwise, at most the next chunk may be touched.
+ *
+ * \param[in,out] reader  Reader
+ * \param[out]    data[]  Target buffer
+ * \param[in]     size    Bytes to copy
+ * \param[in]     advance Whether to advance the reader
+ * \param[out]    copied  Bytes copied, less than requested at end of file
+ * \return                Error code
+ */
+static pb_error_t
+copy(
+    pb_uring_reader_t *reader, uint8_t data[], size_t size, int advance,
+    size_t *copied) {
+  assert(reader && (data || !size) && copied);
+  size_t chunk = reader->chunk, offset = reader->offset;
+  pb_error_t error = PB_ERROR_NONE;
+  for (*copied = 0; !error && *copied < size; ) {
+    size_t left;
+    if ((error = available(reader, chunk, &left)) || left <= offset)
+      break;
+
+    /* Copy bytes of current chunk */
+    size_t bytes = left - offset < size - *copied
+      ? left - offset : size - *copied;
+    memcpy(&(data[*copied]), reader->region.data +
+      region(reader, chunk) * reader->region.capacity + offset, bytes);
+    *copied += bytes;
+    if ((offset += bytes) == reader->region.capacity) {
+      chunk++;
+      offset = 0;
+
+      /* Release consumed region */
+      if (advance) {
+        reader->chunk  = chunk;
+        reader->offset = offset;
+        error = refill(reader);
+      }
+    }
+  }
+  if (advance) {
+    reader->chunk  = chunk;
+    reader->offset = offset;
+  }
+  return error;
+}
+
+/* ----------------------------------------------------------------------------
+ * Interface
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Create an io_uring reader over a file descriptor.
+ *
+ * The reader reads a file of length-prefixed messages, like a delimited
+ * reader, but keeps reads of the given number of regions in flight using
+ * io_uring, so replaying large archives isn't limited by system calls. The
+ * regions are allocated contiguously and registered with the kernel upfront.
+ *
+ * If io_uring is unavailable, the reader falls back to blocking reads, so it
+ * can be used on any platform, see pb_uring_reader_async().
+ *
+ * \warning The reader does not take ownership of the file descriptor, so the
+ * caller must close it after destroying the reader. Reading starts at the
+ * current file offset, which must be seekable, e.g. a regular file.
+ *
+ * \param[in] fd       File descriptor
+ * \param[in] capacity Region capacity
+ * \param[in] count    Region count
+ * \return             Reader
+ */
+extern pb_uring_reader_t
+pb_uring_reader_create(int fd, size_t capacity, size_t count) {
+  assert(fd >= 0 && capacity >= 16 && count >= 2);
+  pb_uring_reader_t reader = {
+    .ring      = NULL,
+    .fd        = fd,
+    .base      = lseek(fd, 0, SEEK_CUR),
+    .region    = {
+      .data     = NULL,
+      .size     = NULL,
+      .capacity = capacity,
+      .count    = count
+    },
+    .chunk     = 0,
+    .offset    = 0,
+    .submitted = 0,
+    .end       = SIZE_MAX,
+    .spill     = pb_buffer_create_empty(),
+    .error     = PB_ERROR_NONE
+  };
+  if (unlikely_(reader.base < 0 || capacity > SIZE_MAX / count)) {
+    reader.error = PB_ERROR_INVALID;
+    return reader;
+  }
+
+  /* Allocate regions and their sizes */
+  void *data = mmap(NULL, capacity * count, PROT_READ | PROT_WRITE,
+    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  reader.region.size =
+    pb_allocator_allocate(&allocator_default, sizeof(size_t) * count);
+  if (unlikely_(data == MAP_FAILED || !reader.region.size)) {
+    if (data != MAP_FAILED)
+      munmap(data, capacity * count);                     /* LCOV_EXCL_LINE */
+    if (reader.region.size)
+      pb_allocator_free(&allocator_default,                /* LCOV_EXCL_LINE */
+        reader.region.size);
+    reader.region.size = NULL;
+    reader.error = PB_ERROR_ALLOC;
+    return reader;
+  }
+  reader.region.data = data;
+
+#if defined(IORING_OFF_SQ_RING) && defined(SYS_io_uring_setup)
+
+  /* Create ring, or fall back to blocking reads */
+  reader.ring = ring_create(count, reader.region.data, capacity * count);
+
+#endif /* IORING_OFF_SQ_RING && SYS_io_uring_setup */
+
+  /* Start reading */
+  reader.error = refill(&reader);
+  return reader;
+}
+
+/*!
+ * Destroy an io_uring reader.
+ *
+ * Reads in flight are awaited, as the kernel may still write to the regions.
+ *
+ * \param[in,out] reader Reader
+ */
+extern void
+pb_uring_reader_destroy(pb_uring_reader_t *reader) {
+  assert(reader);
+
+#if defined(IORING_OFF_SQ_RING) && defined(SYS_io_uring_setup)
+
+  if (reader->ring) {
+    for (size_t c = reader->chunk; c < reader->submitted; c++)
+      if (settle(reader, c))
+        break;                                             /* LCOV_EXCL_LINE */
+    ring_destroy(reader->ring);
+    reader->ring = NULL;
+  }
+
+#endif /* IORING_OFF_SQ_RING && SYS_io_uring_setup */
+
+  if (reader->region.data)
+    munmap(reader->region.data,
+      reader->region.capacity * reader->region.count);
+  if (reader->region.size)
+    pb_allocator_free(&allocator_default, reader->region.size);
+  reader->region.data = NULL;
+  reader->region.size = NULL;
+  pb_buffer_destroy(&(reader->spill));
+}
+
+/*!
+ * Read the next message from an io_uring reader.
+ *
+ * If the message lies within adjacent regions, the returned message is a
+ * zero-copy buffer pointing into the regions. Only messages that wrap around
+ * the end of the regions or exceed their total size are copied. In either
+ * case, the message is only valid until the next invocation of this function
+ * or destruction of the reader.
+ *
+ * \param[in,out] reader  Reader
+ * \param[out]    message Buffer receiving message
+ * \return                Error code
+ */
+extern pb_error_t
+pb_uring_reader_next(pb_uring_reader_t *reader, pb_buffer_t *message) {
+  assert(reader && message);
+  if (unlikely_(!pb_uring_reader_valid(reader)))
+    return PB_ERROR_INVALID;
+
+  /* Release regions of previous message and read length prefix */
+  uint8_t prefix[5]; size_t copied, size = 0; uint32_t length = 0;
+  if (unlikely_((reader->error = refill(reader)) ||
+      (reader->error = copy(reader, prefix, 5, 0, &copied))))
+    return reader->error;
+  if (!copied)
+    return PB_ERROR_EOM;
+  if (unlikely_(!(size = pb_varint_unpack_uint32(prefix, copied, &length))))
+    return copied < 5 ? PB_ERROR_OFFSET : PB_ERROR_VARINT;
+
+  /* Return message without copying, if it doesn't wrap around */
+  size_t capacity = reader->region.capacity, offset = reader->offset;
+  size_t last = reader->chunk + (offset + size + length - 1) / capacity;
+  if (region(reader, reader->chunk) + last - reader->chunk <
+      reader->region.count) {
+    for (size_t c = reader->chunk; c <= last; c++) {
+      size_t left;
+      if (unlikely_(reader->error = available(reader, c, &left)))
+        return reader->error;
+      if (left < (c < last ? capacity
+          : offset + size + length - (last - reader->chunk) * capacity))
+        return PB_ERROR_OFFSET;
+    }
+    *message = pb_buffer_create_zero_copy_internal(reader->region.data +
+      region(reader, reader->chunk) * capacity + offset + size, length);
+    reader->chunk  += (offset + size + length) / capacity;
+    reader->offset  = (offset + size + length) % capacity;
+    return PB_ERROR_NONE;
+  }
+
+  /* Otherwise, copy message */
+  if (unlikely_(pb_buffer_ensure(&(reader->spill), length ? length : 1)))
+    return reader->error = PB_ERROR_ALLOC;
+  if (unlikely_((reader->error = copy(reader, prefix, size, 1, &copied)) ||
+      (reader->error = copy(reader,
+        reader->spill.data, length, 1, &copied))))
+    return reader->error;
+  if (copied < length)
+    return PB_ERROR_OFFSET;
+  *message = pb_buffer_create_zero_copy_internal(reader->spill.data, length);
+  return PB_ERROR_NONE;
+}
@@ -20,7 +20,6 @@
  * IN THE SOFTWARE.
  */
 
-#include <alloca.h>
 #include <assert.h>
 #include <stdint.h>
 #include <stdlib.h>
@@ -30,29 +29,12 @@
 #include "core/descriptor.h"
 #include "util/validator.h"
 
-/* ----------------------------------------------------------------------------
- * Forward declarations
- * ------------------------------------------------------------------------- */
-
-static pb_error_t
-check(
-  const pb_decoder_t *decoder);        /* Decoder */
-
-/* ----------------------------------------------------------------------------
- * Type definitions
- * ------------------------------------------------------------------------- */
-
-typedef struct pb_validator_tags_t {
-  pb_tag_t *data;                      /*!< Tags */
-  size_t size;                         /*!< Tag count */
-} pb_validator_tags_t;
-
 /* ----------------------------------------------------------------------------
  * Decoder callback
  * ------------------------------------------------------------------------- */
 
 /*!
- * Field handler that counts occurrences.
+ * Field handler that recurses into submessages.
  *
  * \param[in]     descriptor Field descriptor
  * \param[in]     value      Pointer holding value
@@ -61,71 +43,12 @@ typedef struct pb_validator_tags_t {
 static pb_error_t
 handler(
     const pb_field_descriptor_t *descriptor, const void *value, void *user) {
-  assert(descriptor && value && user);
-  pb_validator_tags_t *tags = user;
-
-  /* Count field occurrence */
-  int miss = 1;
-  for (size_t t = 0; miss && t < tags->size; ++t)
-    if (tags->data[t] == pb_field_descriptor_tag(descriptor))
-      miss = 0;
-  if (miss)
-    tags->data[tags->size++] = pb_field_descriptor_tag(descriptor);
-
-  /* In case of submessage, perform recursive check */
+  assert(descriptor && value);
   return pb_field_descriptor_type(descriptor) == PB_TYPE_MESSAGE
-    ? check(value)
+    ? pb_decoder_decode_checked(value, handler, user)
     : PB_ERROR_NONE;
 }
 
-/* ----------------------------------------------------------------------------
- * Internal functions
- * ------------------------------------------------------------------------- */
-
-/*!
- * Decode a buffer and count field occurrences.
- *
- * \param[in] decoder Decoder
- * \return            Error code
- */
-static pb_error_t
-check(const pb_decoder_t *decoder) {
-  assert(decoder);
-  assert(pb_decoder_valid(decoder));
-
-  /* Initialize occurrence counter */
-  pb_validator_tags_t tags = {
-    .data = alloca(sizeof(pb_tag_t)
-          * pb_descriptor_size(pb_decoder_descriptor(decoder))),
-    .size = 0
-  };
-
-  /* Count occurrences using the given decoder */
-  pb_error_t error = pb_decoder_decode(decoder, handler, &tags);
-
-  /* Check for absent required fields */
-  if (likely_(!error)) {
-    pb_descriptor_iter_t it =
-      pb_descriptor_iter_create(decoder->descriptor);
-    if (pb_descriptor_iter_begin(&it)) {
-      do {
-        const pb_field_descriptor_t *descriptor =
-          pb_descriptor_iter_current(&it);
-        if (pb_field_descriptor_label(descriptor) == PB_LABEL_REQUIRED) {
-          int miss = 1;
-          for (size_t t = 0; miss && t < tags.size; ++t)
-            if (tags.data[t] == pb_field_descriptor_tag(descriptor))
-              miss = 0;
-          if (miss)
-            error = PB_ERROR_ABSENT;
-        }
-      } while (!error && pb_descriptor_iter_next(&it));
-    }
-    pb_descriptor_iter_destroy(&it);
-  }
-  return error;
-}
-
 /* ----------------------------------------------------------------------------
  * Interface
  * ------------------------------------------------------------------------- */
@@ -147,7 +70,7 @@ pb_validator_check(
   if (unlikely_(!pb_buffer_valid(buffer)))
     return PB_ERROR_INVALID;
   pb_decoder_t decoder = pb_decoder_create(validator->descriptor, buffer);
-  pb_error_t   error   = check(&decoder);
+  pb_error_t   error   = pb_decoder_decode_checked(&decoder, handler, NULL);
   pb_decoder_destroy(&decoder);
   return error;
 }
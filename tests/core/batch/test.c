@@ -0,0 +1,368 @@
+/*
+ * Copyright (c) 2013-2020 Martin Donath <martin.donath@squidfunk.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <check.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <protobluff/descriptor.h>
+
+#include "core/batch.h"
+#include "core/buffer.h"
+#include "core/common.h"
+#include "core/decoder.h"
+#include "core/descriptor.h"
+#include "core/encoder.h"
+
+/* ----------------------------------------------------------------------------
+ * Descriptors
+ * ------------------------------------------------------------------------- */
+
+/* Descriptor */
+static pb_descriptor_t
+descriptor = { {
+  (const pb_field_descriptor_t []){
+    {  1, "F01", UINT32, OPTIONAL }
+  }, 1 } };
+
+/* Descriptor with repeated nested message */
+static pb_descriptor_t
+descriptor_envelope = { {
+  (const pb_field_descriptor_t []){
+    {  1, "F01", UINT32,  OPTIONAL },
+    {  2, "F02", MESSAGE, REPEATED, &descriptor }
+  }, 2 } };
+
+/* ----------------------------------------------------------------------------
+ * Helper functions
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Sum up all values, failing on the value 100.
+ *
+ * \param[in]     descriptor Field descriptor
+ * \param[in]     value      Pointer holding value
+ * \param[in,out] user       User data
+ * \return                   Error code
+ */
+static pb_error_t
+handler(
+    const pb_field_descriptor_t *descriptor, const void *value, void *user) {
+  uint32_t temp = *(const uint32_t *)value;
+  *(uint64_t *)user += temp;
+  return temp == 100 ? PB_ERROR_ABSENT : PB_ERROR_NONE;
+}
+
+/*!
+ * Store the value of an element at its index.
+ *
+ * \param[in]     index   Element index
+ * \param[in]     decoder Decoder of element
+ * \param[in,out] user    User data
+ * \return                Error code
+ */
+static pb_error_t
+handler_element(size_t index, const pb_decoder_t *decoder, void *user) {
+  uint64_t value = 0;
+  pb_error_t error = pb_decoder_decode(decoder, handler, &value);
+  ((uint32_t *)user)[index] = (uint32_t)value;
+  return error;
+}
+
+/*!
+ * Encode the index of an element, failing on the index 500.
+ *
+ * \param[in]     index   Element index
+ * \param[in,out] encoder Encoder of element
+ * \param[in,out] user    User data
+ * \return                Error code
+ */
+static pb_error_t
+handler_encode(size_t index, pb_encoder_t *encoder, void *user) {
+  uint32_t value = index % 100;
+  if (index == 500 && user)
+    return PB_ERROR_ABSENT;
+  return pb_encoder_encode(encoder, 1, &value, 1);
+}
+
+/* ----------------------------------------------------------------------------
+ * Tests
+ * ------------------------------------------------------------------------- */
+
+/*
+ * Decode a batch of messages across multiple threads.
+ */
+START_TEST(test_decode) {
+  uint8_t data[1000][2];
+  pb_buffer_t buffers[1000];
+  for (size_t b = 0; b < 1000; b++) {
+    data[b][0] = 8;
+    data[b][1] = b % 100 + 1 == 100 ? 0 : b % 100 + 1;
+    buffers[b] = pb_buffer_create_zero_copy(data[b], 2);
+  }
+
+  /* Decode batch with one context per thread */
+  uint64_t sums[4] = {};
+  void *user[4] = { &sums[0], &sums[1], &sums[2], &sums[3] };
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_decoder_decode_batch(&descriptor, buffers, 1000, handler, user, 4));
+
+  /* Assert sum of all values */
+  ck_assert_uint_eq(10 * (99 * 100 / 2),
+    sums[0] + sums[1] + sums[2] + sums[3]);
+} END_TEST
+
+/*
+ * Decode a batch of messages in the calling thread.
+ */
+START_TEST(test_decode_single) {
+  uint8_t data[] = { 8, 1 };
+  pb_buffer_t buffers[] = {
+    pb_buffer_create_zero_copy(data, 2),
+    pb_buffer_create_zero_copy(data, 2)
+  };
+
+  /* Decode batch */
+  uint64_t sum = 0;
+  void *user[] = { &sum };
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_decoder_decode_batch(&descriptor, buffers, 2, handler, user, 1));
+  ck_assert_uint_eq(2, sum);
+} END_TEST
+
+/*
+ * Decode an empty batch of messages.
+ */
+START_TEST(test_decode_empty) {
+  uint64_t sum = 0;
+  void *user[] = { &sum, &sum };
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_decoder_decode_batch(&descriptor, NULL, 0, handler, user, 2));
+  ck_assert_uint_eq(0, sum);
+} END_TEST
+
+/*
+ * Decode a batch of messages, some of which fail.
+ */
+START_TEST(test_decode_error) {
+  uint8_t data[1000][2];
+  pb_buffer_t buffers[1000];
+  for (size_t b = 0; b < 1000; b++) {
+    data[b][0] = 8;
+    data[b][1] = 1;
+    buffers[b] = pb_buffer_create_zero_copy(data[b], 2);
+  }
+
+  /* Fail in handler and upon decoding a truncated varint */
+  data[900][1] = 255;
+  data[100][1] = 100;
+
+  /* Decode batch and assert first failure in batch order */
+  uint64_t sums[3] = {};
+  void *user[3] = { &sums[0], &sums[1], &sums[2] };
+  ck_assert_uint_eq(PB_ERROR_ABSENT,
+    pb_decoder_decode_batch(&descriptor, buffers, 1000, handler, user, 3));
+
+  /* Assert that all other messages were decoded */
+  ck_assert_uint_eq(998 + 100, sums[0] + sums[1] + sums[2]);
+} END_TEST
+
+/*
+ * Split a message into the elements of a repeated field.
+ */
+START_TEST(test_split) {
+  const uint8_t data[] = { 18, 2, 8, 1, 8, 127, 18, 0, 18, 2, 8, 2 };
+  pb_buffer_t buffer = pb_buffer_create_zero_copy((uint8_t *)data, 12);
+  pb_decoder_t decoder = pb_decoder_create(&descriptor_envelope, &buffer);
+
+  /* Count elements */
+  size_t size = 0;
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_decoder_split(&decoder, 2, NULL, &size));
+  ck_assert_uint_eq(3, size);
+
+  /* Split message into elements */
+  pb_buffer_t elements[3];
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_decoder_split(&decoder, 2, elements, &size));
+  ck_assert_uint_eq(3, size);
+  ck_assert_uint_eq(2, pb_buffer_size(&elements[0]));
+  ck_assert_ptr_eq(&(data[2]), pb_buffer_data(&elements[0]));
+  fail_unless(pb_buffer_empty(&elements[1]));
+  ck_assert_ptr_eq(&(data[10]), pb_buffer_data(&elements[2]));
+} END_TEST
+
+/*
+ * Split a truncated message into the elements of a repeated field.
+ */
+START_TEST(test_split_truncated) {
+  const uint8_t data[] = { 18, 2, 8, 1, 18, 2, 8 };
+  pb_buffer_t buffer = pb_buffer_create_zero_copy((uint8_t *)data, 7);
+  pb_decoder_t decoder = pb_decoder_create(&descriptor_envelope, &buffer);
+
+  /* Split message into elements */
+  pb_buffer_t elements[2];
+  size_t size = 2;
+  ck_assert_uint_eq(PB_ERROR_OFFSET,
+    pb_decoder_split(&decoder, 2, elements, &size));
+  ck_assert_uint_eq(1, size);
+} END_TEST
+
+/*
+ * Decode the elements of a repeated field across multiple threads.
+ */
+START_TEST(test_decode_split) {
+  uint8_t data[1000][4];
+  for (size_t e = 0; e < 1000; e++) {
+    data[e][0] = 18;
+    data[e][1] = 2;
+    data[e][2] = 8;
+    data[e][3] = e % 100;
+  }
+  pb_buffer_t buffer = pb_buffer_create_zero_copy(data[0], sizeof(data));
+  pb_decoder_t decoder = pb_decoder_create(&descriptor_envelope, &buffer);
+
+  /* Decode elements, storing values by index */
+  uint32_t values[1000];
+  void *user[4] = { values, values, values, values };
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_decoder_decode_split(&decoder, 2, handler_element, user, 4));
+
+  /* Assert values in order */
+  for (size_t e = 0; e < 1000; e++)
+    ck_assert_uint_eq(e % 100, values[e]);
+} END_TEST
+
+/*
+ * Decode the elements of a field which is not a nested message.
+ */
+START_TEST(test_decode_split_invalid) {
+  const uint8_t data[] = { 8, 1 };
+  pb_buffer_t buffer = pb_buffer_create_zero_copy((uint8_t *)data, 2);
+  pb_decoder_t decoder = pb_decoder_create(&descriptor_envelope, &buffer);
+
+  /* Decode elements */
+  uint32_t values[1];
+  void *user[] = { values };
+  ck_assert_uint_eq(PB_ERROR_INVALID,
+    pb_decoder_decode_split(&decoder, 1, handler_element, user, 1));
+} END_TEST
+
+/*
+ * Encode nested messages across multiple threads and decode them again.
+ */
+START_TEST(test_encode) {
+  pb_encoder_t encoder = pb_encoder_create(&descriptor_envelope);
+
+  /* Encode nested messages */
+  void *user[4] = {};
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_encoder_encode_batch(&encoder, 2, 1000, handler_encode, user, 4));
+  ck_assert_uint_eq(1000 * 4,
+    pb_buffer_size(pb_encoder_buffer(&encoder)));
+
+  /* Decode nested messages, storing values by index */
+  pb_decoder_t decoder = pb_decoder_create(&descriptor_envelope,
+    pb_encoder_buffer(&encoder));
+  uint32_t values[1000];
+  void *users[2] = { values, values };
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_decoder_decode_split(&decoder, 2, handler_element, users, 2));
+
+  /* Assert values in order */
+  for (size_t e = 0; e < 1000; e++)
+    ck_assert_uint_eq(e % 100, values[e]);
+
+  /* Free all allocated memory */
+  pb_encoder_destroy(&encoder);
+} END_TEST
+
+/*
+ * Encode nested messages, one of which fails.
+ */
+START_TEST(test_encode_error) {
+  pb_encoder_t encoder = pb_encoder_create(&descriptor_envelope);
+
+  /* Encode nested messages */
+  int fail = 1;
+  void *user[3] = { &fail, &fail, &fail };
+  ck_assert_uint_eq(PB_ERROR_ABSENT,
+    pb_encoder_encode_batch(&encoder, 2, 1000, handler_encode, user, 3));
+  fail_unless(pb_buffer_empty(pb_encoder_buffer(&encoder)));
+
+  /* Encode non-message field */
+  ck_assert_uint_eq(PB_ERROR_INVALID,
+    pb_encoder_encode_batch(&encoder, 1, 1, handler_encode, user, 3));
+
+  /* Free all allocated memory */
+  pb_encoder_destroy(&encoder);
+} END_TEST
+
+/* ----------------------------------------------------------------------------
+ * Program
+ * ------------------------------------------------------------------------- */
+
+/*
+ * Create a test suite for all registered test cases and run it.
+ *
+ * Tests must be run sequentially (in no-fork mode) or code coverage
+ * cannot be determined properly.
+ */
+int
+main(void) {
+  void *suite = suite_create("protobluff/core/batch"),
+       *tcase = NULL;
+
+  /* Add tests to test case "decode" */
+  tcase = tcase_create("decode");
+  tcase_add_test(tcase, test_decode);
+  tcase_add_test(tcase, test_decode_single);
+  tcase_add_test(tcase, test_decode_empty);
+  tcase_add_test(tcase, test_decode_error);
+  suite_add_tcase(suite, tcase);
+
+  /* Add tests to test case "split" */
+  tcase = tcase_create("split");
+  tcase_add_test(tcase, test_split);
+  tcase_add_test(tcase, test_split_truncated);
+  tcase_add_test(tcase, test_decode_split);
+  tcase_add_test(tcase, test_decode_split_invalid);
+  suite_add_tcase(suite, tcase);
+
+  /* Add tests to test case "encode" */
+  tcase = tcase_create("encode");
+  tcase_add_test(tcase, test_encode);
+  tcase_add_test(tcase, test_encode_error);
+  suite_add_tcase(suite, tcase);
+
+  /* Create a test suite runner in no-fork mode */
+  void *runner = srunner_create(suite);
+  srunner_set_fork_status(runner, CK_NOFORK);
+
+  /* Execute test suite runner */
+  srunner_run_all(runner, CK_NORMAL);
+  int failed = srunner_ntests_failed(runner);
+  srunner_free(runner);
+
+  /* Exit with status code */
+  return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -139,6 +139,28 @@ START_TEST(test_create_zero_copy) {
   pb_buffer_destroy(&buffer);
 } END_TEST
 
+/*
+ * Create a fixed buffer.
+ */
+START_TEST(test_create_fixed) {
+  uint8_t data[16];
+
+  /* Create buffer */
+  pb_buffer_t buffer = pb_buffer_create_fixed(data, 16);
+
+  /* Assert buffer validity and error */
+  fail_unless(pb_buffer_valid(&buffer));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_buffer_error(&buffer));
+
+  /* Assert buffer size, capacity and location */
+  fail_unless(pb_buffer_empty(&buffer));
+  ck_assert_uint_eq(16, pb_buffer_capacity(&buffer));
+  ck_assert_ptr_eq(data, pb_buffer_data(&buffer));
+
+  /* Free all allocated memory */
+  pb_buffer_destroy(&buffer);
+} END_TEST
+
 /*
  * Create an invalid buffer.
  */
@@ -269,6 +291,32 @@ START_TEST(test_grow_zero_copy) {
   pb_buffer_destroy(&buffer);
 } END_TEST
 
+/*
+ * Grow a fixed buffer up to and beyond its capacity.
+ */
+START_TEST(test_grow_fixed) {
+  uint8_t data[16];
+
+  /* Create buffer */
+  pb_buffer_t buffer = pb_buffer_create_fixed(data, 16);
+
+  /* Grow buffer within capacity */
+  ck_assert_ptr_eq(data, pb_buffer_grow(&buffer, 10));
+  ck_assert_ptr_eq(&(data[10]), pb_buffer_grow(&buffer, 6));
+
+  /* Grow buffer beyond capacity */
+  ck_assert_ptr_eq(NULL, pb_buffer_grow(&buffer, 1));
+  ck_assert_uint_eq(PB_ERROR_ALLOC, pb_buffer_reserve(&buffer, 17));
+
+  /* Assert buffer validity, size and location */
+  fail_unless(pb_buffer_valid(&buffer));
+  ck_assert_uint_eq(16, pb_buffer_size(&buffer));
+  ck_assert_ptr_eq(data, pb_buffer_data(&buffer));
+
+  /* Free all allocated memory */
+  pb_buffer_destroy(&buffer);
+} END_TEST
+
 /*
  * Grow an invalid buffer and expect a NULL pointer.
  */
@@ -363,6 +411,190 @@ START_TEST(test_grow_invalid_resize) {
   pb_buffer_destroy(&buffer);
 } END_TEST
 
+/*
+ * Grow a buffer repeatedly and assert geometric growth of capacity.
+ */
+START_TEST(test_grow_capacity) {
+  pb_buffer_t buffer = pb_buffer_create_empty();
+
+  /* Assert buffer capacity */
+  ck_assert_uint_eq(0, pb_buffer_capacity(&buffer));
+
+  /* Grow buffer byte-wise */
+  for (size_t s = 1; s <= 16; s++) {
+    uint8_t *new_data = pb_buffer_grow(&buffer, 1);
+    ck_assert_ptr_ne(NULL, new_data);
+
+    /* Assert buffer size and capacity */
+    ck_assert_uint_eq(s, pb_buffer_size(&buffer));
+    fail_if(pb_buffer_capacity(&buffer) < s);
+  }
+
+  /* Assert buffer capacity */
+  ck_assert_uint_eq(16, pb_buffer_capacity(&buffer));
+
+  /* Free all allocated memory */
+  pb_buffer_destroy(&buffer);
+} END_TEST
+
+/*
+ * Reserve space for a buffer.
+ */
+START_TEST(test_reserve) {
+  const uint8_t data[] = "SOME DATA";
+  const size_t  size   = 9;
+
+  /* Create buffer */
+  pb_buffer_t buffer = pb_buffer_create(data, size);
+  ck_assert_uint_eq(9, pb_buffer_capacity(&buffer));
+
+  /* Reserve space */
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_buffer_reserve(&buffer, 64));
+  ck_assert_uint_eq(64, pb_buffer_capacity(&buffer));
+
+  /* Assert buffer size and contents */
+  ck_assert_uint_eq(9, pb_buffer_size(&buffer));
+  fail_if(memcmp(data, pb_buffer_data(&buffer), size));
+
+  /* Reserve less space than available */
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_buffer_reserve(&buffer, 16));
+  ck_assert_uint_eq(64, pb_buffer_capacity(&buffer));
+
+  /* Grow buffer within capacity */
+  const uint8_t *prev_data = pb_buffer_data(&buffer);
+  uint8_t *new_data = pb_buffer_grow(&buffer, 55);
+  ck_assert_ptr_ne(NULL, new_data);
+  ck_assert_ptr_eq(prev_data, pb_buffer_data(&buffer));
+  ck_assert_uint_eq(64, pb_buffer_size(&buffer));
+
+  /* Free all allocated memory */
+  pb_buffer_destroy(&buffer);
+} END_TEST
+
+/*
+ * Reserve space for a zero-copy buffer.
+ */
+START_TEST(test_reserve_zero_copy) {
+  uint8_t data[] = "SOME DATA";
+  size_t  size   = 9;
+
+  /* Create buffer */
+  pb_buffer_t buffer = pb_buffer_create_zero_copy(data, size);
+
+  /* Reserve space */
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_buffer_reserve(&buffer, 9));
+  ck_assert_uint_eq(PB_ERROR_ALLOC, pb_buffer_reserve(&buffer, 16));
+
+  /* Assert buffer size and capacity */
+  ck_assert_uint_eq(9, pb_buffer_size(&buffer));
+  ck_assert_uint_eq(9, pb_buffer_capacity(&buffer));
+
+  /* Free all allocated memory */
+  pb_buffer_destroy(&buffer);
+} END_TEST
+
+/*
+ * Reserve space for an invalid buffer.
+ */
+START_TEST(test_reserve_invalid) {
+  pb_buffer_t buffer = pb_buffer_create_invalid();
+
+  /* Reserve space */
+  ck_assert_uint_eq(PB_ERROR_INVALID, pb_buffer_reserve(&buffer, 16));
+
+  /* Assert buffer size and capacity */
+  ck_assert_uint_eq(0, pb_buffer_size(&buffer));
+  ck_assert_uint_eq(0, pb_buffer_capacity(&buffer));
+
+  /* Free all allocated memory */
+  pb_buffer_destroy(&buffer);
+} END_TEST
+
+/*
+ * Reserve space for a buffer for which reallocation fails.
+ */
+START_TEST(test_reserve_invalid_resize) {
+  const uint8_t data[] = "SOME DATA";
+  const size_t  size   = 9;
+
+  /* Patch allocator */
+  pb_allocator_t allocator = {
+    .proc = {
+      .allocate = allocator_default.proc.allocate,
+      .resize   = allocator_resize_fail,
+      .free     = allocator_default.proc.free
+    }
+  };
+
+  /* Create buffer */
+  pb_buffer_t buffer =
+    pb_buffer_create_with_allocator(&allocator, data, size);
+
+  /* Reserve space */
+  ck_assert_uint_eq(PB_ERROR_ALLOC, pb_buffer_reserve(&buffer, 16));
+
+  /* Assert buffer size and capacity */
+  ck_assert_uint_eq(9, pb_buffer_size(&buffer));
+  ck_assert_uint_eq(9, pb_buffer_capacity(&buffer));
+
+  /* Free all allocated memory */
+  pb_buffer_destroy(&buffer);
+} END_TEST
+
+/*
+ * Release excess capacity of a buffer.
+ */
+START_TEST(test_shrink_to_fit) {
+  const uint8_t data[] = "SOME DATA";
+  const size_t  size   = 9;
+
+  /* Create buffer and reserve space */
+  pb_buffer_t buffer = pb_buffer_create(data, size);
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_buffer_reserve(&buffer, 64));
+
+  /* Release excess capacity */
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_buffer_shrink_to_fit(&buffer));
+  ck_assert_uint_eq(9, pb_buffer_capacity(&buffer));
+
+  /* Assert buffer size and contents */
+  ck_assert_uint_eq(9, pb_buffer_size(&buffer));
+  fail_if(memcmp(data, pb_buffer_data(&buffer), size));
+
+  /* Free all allocated memory */
+  pb_buffer_destroy(&buffer);
+} END_TEST
+
+/*
+ * Release excess capacity of an empty buffer.
+ */
+START_TEST(test_shrink_to_fit_empty) {
+  pb_buffer_t buffer = pb_buffer_create_empty();
+
+  /* Reserve space and release excess capacity */
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_buffer_reserve(&buffer, 16));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_buffer_shrink_to_fit(&buffer));
+
+  /* Assert buffer data and capacity */
+  ck_assert_ptr_eq(NULL, pb_buffer_data(&buffer));
+  ck_assert_uint_eq(0, pb_buffer_capacity(&buffer));
+
+  /* Free all allocated memory */
+  pb_buffer_destroy(&buffer);
+} END_TEST
+
+/*
+ * Release excess capacity of an invalid buffer.
+ */
+START_TEST(test_shrink_to_fit_invalid) {
+  pb_buffer_t buffer = pb_buffer_create_invalid();
+
+  /* Release excess capacity */
+  ck_assert_uint_eq(PB_ERROR_INVALID, pb_buffer_shrink_to_fit(&buffer));
+
+  /* Free all allocated memory */
+  pb_buffer_destroy(&buffer);
+} END_TEST
+
 /*
  * Retrieve the raw data of a buffer.
  */
@@ -448,6 +680,7 @@ main(void) {
   tcase_add_test(tcase, test_create);
   tcase_add_test(tcase, test_create_empty);
   tcase_add_test(tcase, test_create_zero_copy);
+  tcase_add_test(tcase, test_create_fixed);
   tcase_add_test(tcase, test_create_invalid);
   tcase_add_test(tcase, test_create_invalid_allocate);
   suite_add_tcase(suite, tcase);
@@ -457,9 +690,22 @@ main(void) {
   tcase_add_test(tcase, test_grow);
   tcase_add_test(tcase, test_grow_empty);
   tcase_add_test(tcase, test_grow_zero_copy);
+  tcase_add_test(tcase, test_grow_fixed);
   tcase_add_test(tcase, test_grow_invalid);
   tcase_add_test(tcase, test_grow_invalid_allocate);
   tcase_add_test(tcase, test_grow_invalid_resize);
+  tcase_add_test(tcase, test_grow_capacity);
+  suite_add_tcase(suite, tcase);
+
+  /* Add tests to test case "reserve" */
+  tcase = tcase_create("reserve");
+  tcase_add_test(tcase, test_reserve);
+  tcase_add_test(tcase, test_reserve_zero_copy);
+  tcase_add_test(tcase, test_reserve_invalid);
+  tcase_add_test(tcase, test_reserve_invalid_resize);
+  tcase_add_test(tcase, test_shrink_to_fit);
+  tcase_add_test(tcase, test_shrink_to_fit_empty);
+  tcase_add_test(tcase, test_shrink_to_fit_invalid);
   suite_add_tcase(suite, tcase);
 
   /* Add tests to test case "data" */
@@ -0,0 +1,251 @@
+/*
+ * Copyright (c) 2013-2020 Martin Donath <martin.donath@squidfunk.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <check.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <protobluff/descriptor.h>
+
+#include "core/buffer.h"
+#include "core/columnar.h"
+#include "core/common.h"
+#include "core/descriptor.h"
+#include "core/encoder.h"
+
+/* ----------------------------------------------------------------------------
+ * Descriptors
+ * ------------------------------------------------------------------------- */
+
+/* Descriptor */
+static pb_descriptor_t
+descriptor = { {
+  (const pb_field_descriptor_t []){
+    {  1, "F01", INT64,   OPTIONAL },
+    {  2, "F02", STRING,  OPTIONAL },
+    {  3, "F03", BOOL,    OPTIONAL },
+    {  4, "F04", UINT32,  REPEATED },
+    {  5, "F05", MESSAGE, OPTIONAL, &descriptor }
+  }, 5 } };
+
+/* ----------------------------------------------------------------------------
+ * Helper functions
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Encode a message with the given values, omitting absent ones.
+ *
+ * \param[in] timestamp Timestamp or -1
+ * \param[in] name      Name or NULL
+ * \return              Buffer
+ */
+static pb_buffer_t
+message_create(int64_t timestamp, char *name) {
+  pb_encoder_t encoder = pb_encoder_create(&descriptor);
+  uint8_t flag = 1;
+  if (timestamp >= 0)
+    fail_if(pb_encoder_encode(&encoder, 1, &timestamp, 1));
+  if (name) {
+    pb_string_t value = pb_string_init_from_chars(name);
+    fail_if(pb_encoder_encode(&encoder, 2, &value, 1));
+  }
+  fail_if(pb_encoder_encode(&encoder, 3, &flag, 1));
+  const pb_buffer_t *buffer = pb_encoder_buffer(&encoder);
+  pb_buffer_t copy = pb_buffer_create(
+    pb_buffer_data(buffer), pb_buffer_size(buffer));
+  pb_encoder_destroy(&encoder);
+  return copy;
+}
+
+/* ----------------------------------------------------------------------------
+ * Tests
+ * ------------------------------------------------------------------------- */
+
+/*
+ * Create a columnar decoder.
+ */
+START_TEST(test_create) {
+  const pb_tag_t tags[] = { 2, 1 };
+  pb_columnar_t columnar = pb_columnar_create(&descriptor, tags, 2);
+
+  /* Assert columnar decoder validity and error */
+  fail_unless(pb_columnar_valid(&columnar));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_columnar_error(&columnar));
+  ck_assert_uint_eq(0, pb_columnar_size(&columnar));
+
+  /* Assert columns */
+  const pb_column_t *column = pb_columnar_column(&columnar, 1);
+  ck_assert_uint_eq(1, pb_field_descriptor_tag(column->descriptor));
+  ck_assert_ptr_eq(NULL, pb_column_offsets(column));
+  column = pb_columnar_column(&columnar, 0);
+  ck_assert_uint_eq(0, pb_column_offsets(column)[0]);
+
+  /* Free all allocated memory */
+  pb_columnar_destroy(&columnar);
+} END_TEST
+
+/*
+ * Create a columnar decoder for fields that cannot be stored in columns.
+ */
+START_TEST(test_create_invalid) {
+  const pb_tag_t tags[] = { 1, 4, 5, 6 };
+  for (size_t t = 1; t < 4; t++) {
+    pb_columnar_t columnar = pb_columnar_create(&descriptor, &(tags[t]), 1);
+
+    /* Assert columnar decoder validity and error */
+    fail_if(pb_columnar_valid(&columnar));
+    ck_assert_uint_eq(PB_ERROR_INVALID, pb_columnar_error(&columnar));
+
+    /* Decode messages */
+    ck_assert_uint_eq(PB_ERROR_INVALID,
+      pb_columnar_decode(&columnar, NULL, 0));
+
+    /* Free all allocated memory */
+    pb_columnar_destroy(&columnar);
+  }
+} END_TEST
+
+/*
+ * Decode a batch of messages into columns.
+ */
+START_TEST(test_decode) {
+  const pb_tag_t tags[] = { 1, 2 };
+  pb_columnar_t columnar = pb_columnar_create(&descriptor, tags, 2);
+
+  /* Create messages */
+  pb_buffer_t buffers[10];
+  for (size_t b = 0; b < 10; b++)
+    buffers[b] = message_create(b % 3 ? (int64_t)b * 1000 : -1,
+      b % 2 ? "SOME DATA" : NULL);
+
+  /* Decode messages */
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_columnar_decode(&columnar, buffers, 10));
+  ck_assert_uint_eq(10, pb_columnar_size(&columnar));
+
+  /* Assert scalar column */
+  const pb_column_t *column = pb_columnar_column(&columnar, 0);
+  const int64_t *values = pb_column_values(column);
+  for (size_t r = 0; r < 10; r++) {
+    ck_assert_uint_eq(!!(r % 3), pb_column_present(column, r));
+    ck_assert_int_eq(r % 3 ? r * 1000 : 0, values[r]);
+  }
+
+  /* Assert string column */
+  column = pb_columnar_column(&columnar, 1);
+  const uint32_t *offsets = pb_column_offsets(column);
+  for (size_t r = 0; r < 10; r++) {
+    ck_assert_uint_eq(r % 2, pb_column_present(column, r));
+    ck_assert_uint_eq(r % 2 ? 9 : 0, offsets[r + 1] - offsets[r]);
+  }
+  fail_if(memcmp("SOME DATA",
+    (const uint8_t *)pb_column_values(column) + offsets[3], 9));
+
+  /* Clear and decode again */
+  pb_columnar_clear(&columnar);
+  ck_assert_uint_eq(0, pb_columnar_size(&columnar));
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_columnar_decode(&columnar, &(buffers[1]), 1));
+  ck_assert_uint_eq(1, pb_columnar_size(&columnar));
+  ck_assert_int_eq(1000,
+    ((const int64_t *)pb_column_values(pb_columnar_column(&columnar, 0)))[0]);
+
+  /* Free all allocated memory */
+  for (size_t b = 0; b < 10; b++)
+    pb_buffer_destroy(&(buffers[b]));
+  pb_columnar_destroy(&columnar);
+} END_TEST
+
+/*
+ * Decode a batch of messages with an invalid message.
+ */
+START_TEST(test_decode_invalid) {
+  const pb_tag_t tags[] = { 2, 3 };
+  pb_columnar_t columnar = pb_columnar_create(&descriptor, tags, 2);
+
+  /* Create messages, the last of which is truncated */
+  const uint8_t data[] = { 18, 1, 'A', 24, 1, 18, 2, 'B' };
+  pb_buffer_t buffers[] = {
+    pb_buffer_create(data, 5),
+    pb_buffer_create(data, 8)
+  };
+
+  /* Decode messages */
+  ck_assert_uint_eq(PB_ERROR_OFFSET,
+    pb_columnar_decode(&columnar, buffers, 2));
+  ck_assert_uint_eq(1, pb_columnar_size(&columnar));
+
+  /* Assert that the partially decoded row was discarded */
+  const pb_column_t *column = pb_columnar_column(&columnar, 0);
+  ck_assert_uint_eq(1, pb_buffer_size(&(column->values)));
+  ck_assert_uint_eq(2 * sizeof(uint32_t), pb_buffer_size(&(column->offsets)));
+  ck_assert_uint_eq(1, pb_column_presence(column)[0]);
+  column = pb_columnar_column(&columnar, 1);
+  ck_assert_uint_eq(1, pb_buffer_size(&(column->values)));
+  ck_assert_uint_eq(1, ((const uint8_t *)pb_column_values(column))[0]);
+
+  /* Free all allocated memory */
+  pb_buffer_destroy(&(buffers[0]));
+  pb_buffer_destroy(&(buffers[1]));
+  pb_columnar_destroy(&columnar);
+} END_TEST
+
+/* ----------------------------------------------------------------------------
+ * Program
+ * ------------------------------------------------------------------------- */
+
+/*
+ * Create a test suite for all registered test cases and run it.
+ *
+ * Tests must be run sequentially (in no-fork mode) or code coverage
+ * cannot be determined properly.
+ */
+int
+main(void) {
+  void *suite = suite_create("protobluff/core/columnar"),
+       *tcase = NULL;
+
+  /* Add tests to test case "create" */
+  tcase = tcase_create("create");
+  tcase_add_test(tcase, test_create);
+  tcase_add_test(tcase, test_create_invalid);
+  suite_add_tcase(suite, tcase);
+
+  /* Add tests to test case "decode" */
+  tcase = tcase_create("decode");
+  tcase_add_test(tcase, test_decode);
+  tcase_add_test(tcase, test_decode_invalid);
+  suite_add_tcase(suite, tcase);
+
+  /* Create a test suite runner in no-fork mode */
+  void *runner = srunner_create(suite);
+  srunner_set_fork_status(runner, CK_NOFORK);
+
+  /* Execute test suite runner */
+  srunner_run_all(runner, CK_NORMAL);
+  int failed = srunner_ntests_failed(runner);
+  srunner_free(runner);
+
+  /* Exit with status code */
+  return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
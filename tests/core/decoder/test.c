@@ -32,6 +32,9 @@
 #include "core/common.h"
 #include "core/decoder.h"
 #include "core/descriptor.h"
+#include "core/intern.h"
+#include "core/layout.h"
+#include "core/stream.h"
 
 /* ----------------------------------------------------------------------------
  * Decoder callback
@@ -53,6 +56,108 @@ handler(
   return PB_ERROR_NONE;
 }
 
+/*!
+ * Field handler that counts occurrences and checks submessages.
+ *
+ * \param[in]     descriptor Field descriptor
+ * \param[in]     value      Pointer holding value
+ * \param[in,out] user       User data
+ */
+static pb_error_t
+handler_checked(
+    const pb_field_descriptor_t *descriptor, const void *value, void *user) {
+  assert(descriptor && value && user);
+  pb_tag_t *tags = user;
+  tags[pb_field_descriptor_tag(descriptor) - 1]++;
+  return pb_field_descriptor_type(descriptor) == PB_TYPE_MESSAGE
+    ? pb_decoder_decode_checked(value, handler_checked, user)
+    : PB_ERROR_NONE;
+}
+
+/*!
+ * Nested handler that records flags and counts occurrences.
+ *
+ * \param[in]     decoder Decoder of nested message
+ * \param[in,out] user    User data
+ */
+static pb_error_t
+handler_nested(pb_decoder_t *decoder, void *user) {
+  assert(decoder && user);
+  pb_tag_t *tags = user;
+  tags[11] = decoder->flags;
+  return pb_decoder_decode(decoder, handler, user);
+}
+
+/*!
+ * Packed field handler that counts occurrences and invocations.
+ *
+ * \param[in]     descriptor Field descriptor
+ * \param[in]     values     Pointer holding values
+ * \param[in]     size       Value count
+ * \param[in,out] user       User data
+ */
+static pb_error_t
+handler_packed(
+    const pb_field_descriptor_t *descriptor, const void *values,
+    size_t size, void *user) {
+  assert(descriptor && values && size && user);
+  pb_tag_t *tags = user;
+  tags[pb_field_descriptor_tag(descriptor) - 1] += size;
+  tags[12]++;
+  return PB_ERROR_NONE;
+}
+
+/*!
+ * Packed field handler that sums up unsigned 32-bit values.
+ *
+ * \param[in]     descriptor Field descriptor
+ * \param[in]     values     Pointer holding values
+ * \param[in]     size       Value count
+ * \param[in,out] user       User data
+ */
+static pb_error_t
+handler_packed_sum(
+    const pb_field_descriptor_t *descriptor, const void *values,
+    size_t size, void *user) {
+  assert(descriptor && values && size && user);
+  for (size_t v = 0; v < size; v++)
+    *(uint32_t *)user += ((const uint32_t *)values)[v];
+  return PB_ERROR_NONE;
+}
+
+/*!
+ * Field handler that records the pointers of string values.
+ *
+ * \param[in]     descriptor Field descriptor
+ * \param[in]     value      Pointer holding value
+ * \param[in,out] user       User data
+ */
+static pb_error_t
+handler_intern(
+    const pb_field_descriptor_t *descriptor, const void *value, void *user) {
+  assert(descriptor && value && user);
+  const void **values = user;
+  while (*values)
+    values++;
+  *values = value;
+  return PB_ERROR_NONE;
+}
+
+/*!
+ * Unknown field handler that counts ranges and their bytes.
+ *
+ * \param[in]     range Raw unknown fields
+ * \param[in,out] user  User data
+ */
+static pb_error_t
+handler_unknown(const pb_string_t *range, void *user) {
+  assert(range && pb_string_size(range) && user);
+  pb_tag_t *tags = user;
+  tags[12]++;
+  tags[13] += pb_string_size(range);
+  return PB_ERROR_NONE;
+}
+
 /* ----------------------------------------------------------------------------
  * Descriptors
  * ------------------------------------------------------------------------- */
@@ -84,6 +189,82 @@ descriptor = { {
     { 12, "F12", MESSAGE, REPEATED, &descriptor }
   }, 12 } };
 
+/* Descriptor with required fields */
+static pb_descriptor_t
+descriptor_required = { {
+  (const pb_field_descriptor_t []){
+    {  1, "F01", UINT32,  REQUIRED },
+    {  2, "F02", MESSAGE, OPTIONAL, &descriptor_required }
+  }, 2 } };
+
+/* Descriptor with UTF-8 string fields */
+static pb_descriptor_t
+descriptor_utf8 = { {
+  (const pb_field_descriptor_t []){
+    {  1, "F01", STRING,  OPTIONAL, NULL, NULL, UTF8 },
+    {  2, "F02", STRING,  OPTIONAL }
+  }, 2 } };
+
+/* Descriptor with interned string fields */
+static pb_descriptor_t
+descriptor_intern = { {
+  (const pb_field_descriptor_t []){
+    {  1, "F01", STRING,  REPEATED, NULL, NULL, INTERN },
+    {  2, "F02", STRING,  REPEATED }
+  }, 2 } };
+
+/* Descriptor with precomputed keys */
+static pb_descriptor_t
+descriptor_keyed = { {
+  (const pb_field_descriptor_t []){
+    {  1, "F01", UINT32,  OPTIONAL, NULL, NULL, 0, { {  8 }, 1 } },
+    {  2, "F02", UINT32,  REPEATED, NULL, NULL, 0, { { 16 }, 1 } },
+    {  3, "F03", STRING,  OPTIONAL, NULL, NULL, 0, { { 26 }, 1 } }
+  }, 3 } };
+
+/* ----------------------------------------------------------------------------
+ * Layouts
+ * ------------------------------------------------------------------------- */
+
+/* Struct */
+typedef struct value_t {
+  uint32_t f01;                        /*!< F01 */
+  uint64_t f02;                        /*!< F02 */
+  int32_t f03;                         /*!< F03 */
+  int64_t f04;                         /*!< F04 */
+  uint8_t f05;                         /*!< F05 */
+  pb_repeated_t f06;                   /*!< F06 */
+  double f07;                          /*!< F07 */
+  pb_string_t f08;                     /*!< F08 */
+  pb_string_t f09;                     /*!< F09 */
+  pb_enum_t f10;                       /*!< F10 */
+  struct value_t *f11;                 /*!< F11 */
+  pb_repeated_t f12;                   /*!< F12 */
+  uint8_t has[2];                      /*!< Presence bits */
+} value_t;
+
+/* Layout (forward declaration) */
+static const pb_layout_t
+layout;
+
+/* Layout */
+static const pb_layout_t
+layout = { &descriptor, {
+  (const pb_layout_field_t []){
+    { offsetof(value_t, f01) },
+    { offsetof(value_t, f02) },
+    { offsetof(value_t, f03) },
+    { offsetof(value_t, f04) },
+    { offsetof(value_t, f05) },
+    { offsetof(value_t, f06) },
+    { offsetof(value_t, f07) },
+    { offsetof(value_t, f08) },
+    { offsetof(value_t, f09) },
+    { offsetof(value_t, f10) },
+    { offsetof(value_t, f11), &layout },
+    { offsetof(value_t, f12), &layout }
+  }, 12 }, offsetof(value_t, has), sizeof(value_t) };
+
 /* ----------------------------------------------------------------------------
  * Tests
  * ------------------------------------------------------------------------- */
@@ -161,6 +342,77 @@ START_TEST(test_decode_message) {
   pb_buffer_destroy(&buffer);
 } END_TEST
 
+/*
+ * Decode a buffer using a handler, checking for required fields.
+ */
+START_TEST(test_decode_checked) {
+  const uint8_t data[] = { 8, 127, 18, 2, 8, 127 };
+  const size_t  size   = 6;
+
+  /* Create buffer and decoder */
+  pb_buffer_t  buffer  = pb_buffer_create(data, size);
+  pb_decoder_t decoder = pb_decoder_create(&descriptor_required, &buffer);
+
+  /* Decode using the handler */
+  pb_tag_t tags[2] = {};
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_decoder_decode_checked(&decoder, handler_checked, tags));
+
+  /* Assert expected occurences */
+  ck_assert_uint_eq(2, tags[0]);
+  ck_assert_uint_eq(1, tags[1]);
+
+  /* Free all allocated memory */
+  pb_decoder_destroy(&decoder);
+  pb_buffer_destroy(&buffer);
+} END_TEST
+
+/*
+ * Decode a buffer with an absent required field.
+ */
+START_TEST(test_decode_checked_absent) {
+  const uint8_t data[] = { 18, 2, 8, 127 };
+  const size_t  size   = 4;
+
+  /* Create buffer and decoder */
+  pb_buffer_t  buffer  = pb_buffer_create(data, size);
+  pb_decoder_t decoder = pb_decoder_create(&descriptor_required, &buffer);
+
+  /* Decode using the handler */
+  pb_tag_t tags[2] = {};
+  ck_assert_uint_eq(PB_ERROR_ABSENT,
+    pb_decoder_decode_checked(&decoder, handler_checked, tags));
+
+  /* Assert all fields were delivered in a single pass */
+  ck_assert_uint_eq(1, tags[0]);
+  ck_assert_uint_eq(1, tags[1]);
+
+  /* Free all allocated memory */
+  pb_decoder_destroy(&decoder);
+  pb_buffer_destroy(&buffer);
+} END_TEST
+
+/*
+ * Decode a buffer with an absent required field in a submessage.
+ */
+START_TEST(test_decode_checked_absent_message) {
+  const uint8_t data[] = { 8, 127, 18, 0 };
+  const size_t  size   = 4;
+
+  /* Create buffer and decoder */
+  pb_buffer_t  buffer  = pb_buffer_create(data, size);
+  pb_decoder_t decoder = pb_decoder_create(&descriptor_required, &buffer);
+
+  /* Decode using the handler */
+  pb_tag_t tags[2] = {};
+  ck_assert_uint_eq(PB_ERROR_ABSENT,
+    pb_decoder_decode_checked(&decoder, handler_checked, tags));
+
+  /* Free all allocated memory */
+  pb_decoder_destroy(&decoder);
+  pb_buffer_destroy(&buffer);
+} END_TEST
+
 /*
  * Decode a buffer with an unknown tag using a handler.
  */
@@ -191,27 +443,29 @@ START_TEST(test_decode_skip) {
 } END_TEST
 
 /*
- * Decode a buffer with a packed field using a handler.
+ * Decode a buffer using a handler, matching precomputed keys.
  */
-START_TEST(test_decode_packed) {
-  const uint8_t data[] = { 50, 8, 0, 202, 154, 59, 0, 202, 154, 59 };
-  const size_t  size   = 10;
+START_TEST(test_decode_keyed) {
+  const uint8_t data[] = { 8, 127, 16, 1, 16, 2, 26, 0, 8, 1, 18, 1, 3 };
+  const size_t  size   = 13;
 
   /* Create buffer and decoder */
   pb_buffer_t  buffer  = pb_buffer_create(data, size);
-  pb_decoder_t decoder = pb_decoder_create(&descriptor, &buffer);
+  pb_decoder_t decoder = pb_decoder_create(&descriptor_keyed, &buffer);
 
   /* Assert decoder validity and error */
   fail_unless(pb_decoder_valid(&decoder));
   ck_assert_uint_eq(PB_ERROR_NONE, pb_decoder_error(&decoder));
 
   /* Decode using the handler */
-  pb_tag_t tags[12] = {};
+  pb_tag_t tags[3] = {};
   ck_assert_uint_eq(PB_ERROR_NONE,
     pb_decoder_decode(&decoder, handler, tags));
 
   /* Assert expected occurences */
-  ck_assert_uint_eq(2, tags[5]);
+  ck_assert_uint_eq(2, tags[0]);
+  ck_assert_uint_eq(3, tags[1]);
+  ck_assert_uint_eq(1, tags[2]);
 
   /* Free all allocated memory */
   pb_decoder_destroy(&decoder);
@@ -219,19 +473,27 @@ START_TEST(test_decode_packed) {
 } END_TEST
 
 /*
- * Decode an invalid buffer using a handler.
+ * Decode a buffer with unknown fields using a handler.
  */
-START_TEST(test_decode_invalid) {
-  pb_buffer_t  buffer  = pb_buffer_create_invalid();
-  pb_decoder_t decoder = pb_decoder_create(&descriptor, &buffer);
+START_TEST(test_decode_unknown) {
+  const uint8_t data[] = { 8, 1, 120, 2, 128, 1, 5, 16, 3, 120, 4 };
+  const size_t  size   = 11;
 
-  /* Assert decoder validity and error */
-  fail_if(pb_decoder_valid(&decoder));
-  ck_assert_uint_eq(PB_ERROR_ALLOC, pb_decoder_error(&decoder));
+  /* Create buffer and decoder */
+  pb_buffer_t  buffer  = pb_buffer_create(data, size);
+  pb_decoder_t decoder = pb_decoder_create(&descriptor, &buffer);
+  pb_decoder_set_unknown(&decoder, handler_unknown);
 
   /* Decode using the handler */
-  ck_assert_uint_eq(PB_ERROR_INVALID,
-    pb_decoder_decode(&decoder, handler, NULL));
+  pb_tag_t tags[14] = {};
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_decoder_decode(&decoder, handler, tags));
+
+  /* Assert occurrences and merged ranges of unknown fields */
+  ck_assert_uint_eq(1, tags[0]);
+  ck_assert_uint_eq(1, tags[1]);
+  ck_assert_uint_eq(2, tags[12]);
+  ck_assert_uint_eq(7, tags[13]);
 
   /* Free all allocated memory */
   pb_decoder_destroy(&decoder);
@@ -239,23 +501,33 @@ START_TEST(test_decode_invalid) {
 } END_TEST
 
 /*
- * Decode a buffer with an invalid tag using a handler.
+ * Decode a buffer using a handler and a mask.
  */
-START_TEST(test_decode_invalid_tag) {
-  const uint8_t data[] = { 255 };
-  const size_t  size   = 1;
+START_TEST(test_decode_masked) {
+  const uint8_t data[] = { 98, 2, 8, 127, 8, 127, 16, 127 };
+  const size_t  size   = 8;
 
   /* Create buffer and decoder */
   pb_buffer_t  buffer  = pb_buffer_create(data, size);
   pb_decoder_t decoder = pb_decoder_create(&descriptor, &buffer);
 
-  /* Assert decoder validity and error */
-  fail_unless(pb_decoder_valid(&decoder));
-  ck_assert_uint_eq(PB_ERROR_NONE, pb_decoder_error(&decoder));
+  /* Create mask */
+  uint8_t bits[2] = {};
+  pb_decoder_mask_set(bits, 1);
+  pb_decoder_mask_t mask = { bits, 2 };
+  fail_unless(pb_decoder_mask_has(&mask, 1));
+  fail_if(pb_decoder_mask_has(&mask, 12));
+  fail_if(pb_decoder_mask_has(&mask, 100));
 
-  /* Decode using the handler */
-  ck_assert_uint_eq(PB_ERROR_VARINT,
-    pb_decoder_decode(&decoder, handler, NULL));
+  /* Decode using the handler and the mask */
+  pb_tag_t tags[12] = {};
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_decoder_decode_masked(&decoder, &mask, handler, tags));
+
+  /* Assert expected occurences */
+  ck_assert_uint_eq(1, tags[0]);
+  ck_assert_uint_eq(0, tags[1]);
+  ck_assert_uint_eq(0, tags[11]);
 
   /* Free all allocated memory */
   pb_decoder_destroy(&decoder);
@@ -263,35 +535,128 @@ START_TEST(test_decode_invalid_tag) {
 } END_TEST
 
 /*
- * Decode a buffer with invalid length using a handler.
+ * Decode a buffer using a handler and a mask skipping a message.
  */
-START_TEST(test_decode_invalid_length) {
-  const uint8_t data[] = { 26, 5 };
-  const size_t  size   = 2;
+START_TEST(test_decode_masked_message) {
+  const uint8_t data[] = { 98, 1, 255, 16, 127 };
+  const size_t  size   = 5;
 
   /* Create buffer and decoder */
   pb_buffer_t  buffer  = pb_buffer_create(data, size);
   pb_decoder_t decoder = pb_decoder_create(&descriptor, &buffer);
 
-  /* Assert decoder validity and error */
-  fail_unless(pb_decoder_valid(&decoder));
-  ck_assert_uint_eq(PB_ERROR_NONE, pb_decoder_error(&decoder));
+  /* Create mask */
+  uint8_t bits[1] = {};
+  pb_decoder_mask_set(bits, 2);
+  pb_decoder_mask_t mask = { bits, 1 };
+
+  /* Decode using the handler and the mask */
+  pb_tag_t tags[12] = {};
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_decoder_decode_masked(&decoder, &mask, handler, tags));
+
+  /* Assert expected occurences */
+  ck_assert_uint_eq(1, tags[1]);
+  ck_assert_uint_eq(0, tags[11]);
+
+  /* Free all allocated memory */
+  pb_decoder_destroy(&decoder);
+  pb_buffer_destroy(&buffer);
+} END_TEST
+
+/*
+ * Decode a buffer using a handler, recording an index of field offsets.
+ */
+START_TEST(test_decode_index) {
+  const uint8_t data[] = { 8, 127, 98, 2, 8, 1, 8, 3, 16, 127 };
+  const size_t  size   = 10;
+
+  /* Create buffer, decoder and index */
+  pb_buffer_t        buffer  = pb_buffer_create(data, size);
+  pb_decoder_t       decoder = pb_decoder_create(&descriptor, &buffer);
+  pb_decoder_index_t index   = pb_decoder_index_create();
+  pb_decoder_set_index(&decoder, &index);
+  fail_if(pb_decoder_index_complete(&index));
+  ck_assert_ptr_eq(NULL, pb_decoder_index_find(&index, 1));
 
   /* Decode using the handler */
-  ck_assert_uint_eq(PB_ERROR_OFFSET,
-    pb_decoder_decode(&decoder, handler, NULL));
+  pb_tag_t tags[12] = {};
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_decoder_decode(&decoder, handler, tags));
+  fail_unless(pb_decoder_index_complete(&index));
+  ck_assert_uint_eq(size, index.size);
+
+  /* Assert offsets of repeated occurrences */
+  const pb_decoder_index_entry_t *entry = pb_decoder_index_find(&index, 1);
+  ck_assert_ptr_ne(NULL, entry);
+  ck_assert_uint_eq(2, entry->count);
+  ck_assert_uint_eq(0, entry->first);
+  ck_assert_uint_eq(6, entry->last);
+
+  /* Assert offsets of single occurrences */
+  ck_assert_uint_eq(2, pb_decoder_index_find(&index, 12)->first);
+  ck_assert_uint_eq(8, pb_decoder_index_find(&index, 2)->last);
+
+  /* Assert absent and unknown fields */
+  ck_assert_uint_eq(0, pb_decoder_index_find(&index, 3)->count);
+  ck_assert_ptr_eq(NULL, pb_decoder_index_find(&index, 100));
 
   /* Free all allocated memory */
+  pb_decoder_index_destroy(&index);
   pb_decoder_destroy(&decoder);
   pb_buffer_destroy(&buffer);
 } END_TEST
 
 /*
- * Decode a buffer with an invalid length prefix using a handler.
+ * Decode a buffer using a handler and a mask, recording all field offsets.
  */
-START_TEST(test_decode_invalid_length_data) {
-  const uint8_t data[] = { 26, 130, 131, 132, 133, 134, 135, 136 };
-  const size_t  size   = 7;
+START_TEST(test_decode_index_masked) {
+  const uint8_t data[] = { 98, 2, 8, 127, 8, 127, 16, 127 };
+  const size_t  size   = 8;
+
+  /* Create buffer, decoder and index */
+  pb_buffer_t        buffer  = pb_buffer_create(data, size);
+  pb_decoder_t       decoder = pb_decoder_create(&descriptor, &buffer);
+  pb_decoder_index_t index   = pb_decoder_index_create();
+  pb_decoder_set_index(&decoder, &index);
+
+  /* Create mask */
+  uint8_t bits[1] = {};
+  pb_decoder_mask_set(bits, 1);
+  pb_decoder_mask_t mask = { bits, 1 };
+
+  /* Decode using the handler and the mask */
+  pb_tag_t tags[12] = {};
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_decoder_decode_masked(&decoder, &mask, handler, tags));
+  ck_assert_uint_eq(0, tags[11]);
+
+  /* Assert offsets of masked fields */
+  ck_assert_uint_eq(1, pb_decoder_index_find(&index, 12)->count);
+  ck_assert_uint_eq(6, pb_decoder_index_find(&index, 2)->first);
+
+  /* Decode truncated message, reusing the index */
+  pb_buffer_t truncated = pb_buffer_create(data, 7);
+  pb_decoder_t decoder_truncated = pb_decoder_create(&descriptor, &truncated);
+  pb_decoder_set_index(&decoder_truncated, &index);
+  fail_unless(pb_decoder_decode(&decoder_truncated, handler, tags));
+  fail_if(pb_decoder_index_complete(&index));
+  ck_assert_ptr_eq(NULL, pb_decoder_index_find(&index, 12));
+
+  /* Free all allocated memory */
+  pb_decoder_index_destroy(&index);
+  pb_decoder_destroy(&decoder_truncated);
+  pb_decoder_destroy(&decoder);
+  pb_buffer_destroy(&truncated);
+  pb_buffer_destroy(&buffer);
+} END_TEST
+
+/*
+ * Decode a buffer with a packed field using a handler.
+ */
+START_TEST(test_decode_packed) {
+  const uint8_t data[] = { 50, 8, 0, 202, 154, 59, 0, 202, 154, 59 };
+  const size_t  size   = 10;
 
   /* Create buffer and decoder */
   pb_buffer_t  buffer  = pb_buffer_create(data, size);
@@ -302,8 +667,12 @@ START_TEST(test_decode_invalid_length_data) {
   ck_assert_uint_eq(PB_ERROR_NONE, pb_decoder_error(&decoder));
 
   /* Decode using the handler */
-  ck_assert_uint_eq(PB_ERROR_VARINT,
-    pb_decoder_decode(&decoder, handler, NULL));
+  pb_tag_t tags[12] = {};
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_decoder_decode(&decoder, handler, tags));
+
+  /* Assert expected occurences */
+  ck_assert_uint_eq(2, tags[5]);
 
   /* Free all allocated memory */
   pb_decoder_destroy(&decoder);
@@ -311,23 +680,24 @@ START_TEST(test_decode_invalid_length_data) {
 } END_TEST
 
 /*
- * Decode a buffer with an invalid value using a handler.
+ * Decode a buffer with a packed field using a packed handler.
  */
-START_TEST(test_decode_invalid_value) {
-  const uint8_t data[] = { 8, 255 };
-  const size_t  size   = 2;
+START_TEST(test_decode_packed_batch) {
+  const uint8_t data[] = { 50, 8, 0, 202, 154, 59, 0, 202, 154, 59 };
+  const size_t  size   = 10;
 
   /* Create buffer and decoder */
   pb_buffer_t  buffer  = pb_buffer_create(data, size);
   pb_decoder_t decoder = pb_decoder_create(&descriptor, &buffer);
 
-  /* Assert decoder validity and error */
-  fail_unless(pb_decoder_valid(&decoder));
-  ck_assert_uint_eq(PB_ERROR_NONE, pb_decoder_error(&decoder));
+  /* Decode using the handler and packed handler */
+  pb_tag_t tags[13] = {};
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_decoder_decode_packed(&decoder, handler, handler_packed, tags));
 
-  /* Decode using the handler */
-  ck_assert_uint_eq(PB_ERROR_VARINT,
-    pb_decoder_decode(&decoder, handler, NULL));
+  /* Assert expected occurences and invocations */
+  ck_assert_uint_eq(2, tags[5]);
+  ck_assert_uint_eq(1, tags[12]);
 
   /* Free all allocated memory */
   pb_decoder_destroy(&decoder);
@@ -335,36 +705,1274 @@ START_TEST(test_decode_invalid_value) {
 } END_TEST
 
 /*
- * Decode a buffer with an invalid packed field using a handler.
+ * Decode a buffer with a packed variable-sized field using a packed handler.
  */
-START_TEST(test_decode_invalid_packed) {
-  const uint8_t data[] = { 50, 255 };
-  const size_t  size   = 2;
+START_TEST(test_decode_packed_batch_varint) {
+  const uint8_t data[] = { 10, 6, 1, 2, 3, 127, 128, 1 };
+  const size_t  size   = 8;
 
   /* Create buffer and decoder */
   pb_buffer_t  buffer  = pb_buffer_create(data, size);
   pb_decoder_t decoder = pb_decoder_create(&descriptor, &buffer);
 
-  /* Assert decoder validity and error */
-  fail_unless(pb_decoder_valid(&decoder));
-  ck_assert_uint_eq(PB_ERROR_NONE, pb_decoder_error(&decoder));
+  /* Decode using the handler and packed handler */
+  uint32_t sum = 0;
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_decoder_decode_packed(&decoder, handler, handler_packed_sum, &sum));
 
-  /* Decode using the handler */
-  ck_assert_uint_eq(PB_ERROR_VARINT,
-    pb_decoder_decode(&decoder, handler, NULL));
+  /* Assert expected sum */
+  ck_assert_uint_eq(261, sum);
 
   /* Free all allocated memory */
   pb_decoder_destroy(&decoder);
   pb_buffer_destroy(&buffer);
 } END_TEST
 
-/* ----------------------------------------------------------------------------
- * Program
- * ------------------------------------------------------------------------- */
-
 /*
- * Create a test suite for all registered test cases and run it.
- *
+ * Decode a buffer with a large packed field using a packed handler.
+ */
+START_TEST(test_decode_packed_batch_large) {
+  uint8_t data[2 + 100];
+  data[0] = 18; data[1] = 100;
+  memset(&(data[2]), 1, 100);
+
+  /* Create buffer and decoder */
+  pb_buffer_t  buffer  = pb_buffer_create(data, sizeof(data));
+  pb_decoder_t decoder = pb_decoder_create(&descriptor, &buffer);
+
+  /* Decode using the handler and packed handler */
+  pb_tag_t tags[13] = {};
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_decoder_decode_packed(&decoder, handler, handler_packed, tags));
+
+  /* Assert expected occurences and invocations */
+  ck_assert_uint_eq(100, tags[1]);
+  ck_assert_uint_eq(2, tags[12]);
+
+  /* Free all allocated memory */
+  pb_decoder_destroy(&decoder);
+  pb_buffer_destroy(&buffer);
+} END_TEST
+
+/*
+ * Decode a buffer with an aligned packed fixed-sized field.
+ */
+START_TEST(test_decode_packed_batch_aligned) {
+  uint8_t data[8 + 800] = { 8, 128, 128, 128, 1, 50, 160, 6 };
+  for (size_t v = 0; v < 200; v++)
+    memcpy(&(data[8 + v * 4]), &(float){ v }, 4);
+
+  /* Create buffer and decoder */
+  pb_buffer_t  buffer  = pb_buffer_create(data, sizeof(data));
+  pb_decoder_t decoder = pb_decoder_create(&descriptor, &buffer);
+
+  /* Decode using the handler and packed handler */
+  pb_tag_t tags[13] = {};
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_decoder_decode_packed(&decoder, handler, handler_packed, tags));
+
+  /* Assert expected occurences and invocations */
+  ck_assert_uint_eq(1, tags[0]);
+  ck_assert_uint_eq(200, tags[5]);
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+  ck_assert_uint_eq(1, tags[12]);
+#endif /* __BYTE_ORDER__ */
+
+  /* Free all allocated memory */
+  pb_decoder_destroy(&decoder);
+  pb_buffer_destroy(&buffer);
+} END_TEST
+
+/*
+ * Decode a buffer with a misaligned packed fixed-sized field.
+ */
+START_TEST(test_decode_packed_batch_misaligned) {
+  uint8_t data[7 + 800] = { 8, 128, 128, 1, 50, 160, 6 };
+  for (size_t v = 0; v < 200; v++)
+    memcpy(&(data[7 + v * 4]), &(float){ v }, 4);
+
+  /* Create buffer and decoder */
+  pb_buffer_t  buffer  = pb_buffer_create(data, sizeof(data));
+  pb_decoder_t decoder = pb_decoder_create(&descriptor, &buffer);
+
+  /* Decode using the handler and packed handler */
+  pb_tag_t tags[13] = {};
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_decoder_decode_packed(&decoder, handler, handler_packed, tags));
+
+  /* Assert expected occurences and invocations */
+  ck_assert_uint_eq(1, tags[0]);
+  ck_assert_uint_eq(200, tags[5]);
+  ck_assert_uint_eq(2, tags[12]);
+
+  /* Free all allocated memory */
+  pb_decoder_destroy(&decoder);
+  pb_buffer_destroy(&buffer);
+} END_TEST
+
+/*
+ * Decode an invalid buffer using a handler.
+ */
+START_TEST(test_decode_invalid) {
+  pb_buffer_t  buffer  = pb_buffer_create_invalid();
+  pb_decoder_t decoder = pb_decoder_create(&descriptor, &buffer);
+
+  /* Assert decoder validity and error */
+  fail_if(pb_decoder_valid(&decoder));
+  ck_assert_uint_eq(PB_ERROR_ALLOC, pb_decoder_error(&decoder));
+
+  /* Decode using the handler */
+  ck_assert_uint_eq(PB_ERROR_INVALID,
+    pb_decoder_decode(&decoder, handler, NULL));
+
+  /* Free all allocated memory */
+  pb_decoder_destroy(&decoder);
+  pb_buffer_destroy(&buffer);
+} END_TEST
+
+/*
+ * Decode a buffer with an invalid tag using a handler.
+ */
+START_TEST(test_decode_invalid_tag) {
+  const uint8_t data[] = { 255 };
+  const size_t  size   = 1;
+
+  /* Create buffer and decoder */
+  pb_buffer_t  buffer  = pb_buffer_create(data, size);
+  pb_decoder_t decoder = pb_decoder_create(&descriptor, &buffer);
+
+  /* Assert decoder validity and error */
+  fail_unless(pb_decoder_valid(&decoder));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_decoder_error(&decoder));
+
+  /* Decode using the handler */
+  ck_assert_uint_eq(PB_ERROR_VARINT,
+    pb_decoder_decode(&decoder, handler, NULL));
+
+  /* Free all allocated memory */
+  pb_decoder_destroy(&decoder);
+  pb_buffer_destroy(&buffer);
+} END_TEST
+
+/*
+ * Decode a buffer with invalid length using a handler.
+ */
+START_TEST(test_decode_invalid_length) {
+  const uint8_t data[] = { 26, 5 };
+  const size_t  size   = 2;
+
+  /* Create buffer and decoder */
+  pb_buffer_t  buffer  = pb_buffer_create(data, size);
+  pb_decoder_t decoder = pb_decoder_create(&descriptor, &buffer);
+
+  /* Assert decoder validity and error */
+  fail_unless(pb_decoder_valid(&decoder));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_decoder_error(&decoder));
+
+  /* Decode using the handler */
+  ck_assert_uint_eq(PB_ERROR_OFFSET,
+    pb_decoder_decode(&decoder, handler, NULL));
+
+  /* Free all allocated memory */
+  pb_decoder_destroy(&decoder);
+  pb_buffer_destroy(&buffer);
+} END_TEST
+
+/*
+ * Decode a buffer with an invalid length prefix using a handler.
+ */
+START_TEST(test_decode_invalid_length_data) {
+  const uint8_t data[] = { 26, 130, 131, 132, 133, 134, 135, 136 };
+  const size_t  size   = 7;
+
+  /* Create buffer and decoder */
+  pb_buffer_t  buffer  = pb_buffer_create(data, size);
+  pb_decoder_t decoder = pb_decoder_create(&descriptor, &buffer);
+
+  /* Assert decoder validity and error */
+  fail_unless(pb_decoder_valid(&decoder));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_decoder_error(&decoder));
+
+  /* Decode using the handler */
+  ck_assert_uint_eq(PB_ERROR_VARINT,
+    pb_decoder_decode(&decoder, handler, NULL));
+
+  /* Free all allocated memory */
+  pb_decoder_destroy(&decoder);
+  pb_buffer_destroy(&buffer);
+} END_TEST
+
+/*
+ * Decode a buffer with an invalid value using a handler.
+ */
+START_TEST(test_decode_invalid_value) {
+  const uint8_t data[] = { 8, 255 };
+  const size_t  size   = 2;
+
+  /* Create buffer and decoder */
+  pb_buffer_t  buffer  = pb_buffer_create(data, size);
+  pb_decoder_t decoder = pb_decoder_create(&descriptor, &buffer);
+
+  /* Assert decoder validity and error */
+  fail_unless(pb_decoder_valid(&decoder));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_decoder_error(&decoder));
+
+  /* Decode using the handler */
+  ck_assert_uint_eq(PB_ERROR_VARINT,
+    pb_decoder_decode(&decoder, handler, NULL));
+
+  /* Free all allocated memory */
+  pb_decoder_destroy(&decoder);
+  pb_buffer_destroy(&buffer);
+} END_TEST
+
+/*
+ * Decode a buffer with invalid UTF-8 in a flagged string field.
+ */
+START_TEST(test_decode_invalid_utf8) {
+  const uint8_t data[] = { 18, 2, 192, 128, 10, 3, 226, 130, 172,
+                           10, 2, 192, 128 };
+  const size_t  size   = 13;
+
+  /* Create buffer and decoder */
+  pb_buffer_t  buffer  = pb_buffer_create(data, size);
+  pb_decoder_t decoder = pb_decoder_create(&descriptor_utf8, &buffer);
+
+  /* Assert decoder validity and error */
+  fail_unless(pb_decoder_valid(&decoder));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_decoder_error(&decoder));
+
+  /* Decode using the handler */
+  pb_tag_t tags[2] = {};
+  ck_assert_uint_eq(PB_ERROR_INVALID,
+    pb_decoder_decode(&decoder, handler, tags));
+
+  /* Assert number of occurrences */
+  ck_assert_uint_eq(1, tags[0]);
+  ck_assert_uint_eq(1, tags[1]);
+
+  /* Free all allocated memory */
+  pb_decoder_destroy(&decoder);
+  pb_buffer_destroy(&buffer);
+} END_TEST
+
+/*
+ * Decode a buffer with invalid UTF-8 in a nested message using flags.
+ */
+START_TEST(test_decode_invalid_utf8_flags) {
+  const uint8_t data[] = { 90, 4, 66, 2, 192, 128 };
+  const size_t  size   = 6;
+
+  /* Create buffer and decoders */
+  pb_buffer_t  buffer  = pb_buffer_create(data, size);
+  pb_decoder_t decoder = pb_decoder_create(&descriptor, &buffer);
+  pb_decoder_t checked = pb_decoder_create_with_flags(
+    &descriptor, &buffer, PB_DECODER_FLAG_UTF8);
+
+  /* Assert decoder validity and error */
+  fail_unless(pb_decoder_valid(&checked));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_decoder_error(&checked));
+
+  /* Decode using the handler */
+  pb_tag_t tags[12] = {};
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_decoder_decode(&decoder, handler_checked, tags));
+  ck_assert_uint_eq(PB_ERROR_INVALID,
+    pb_decoder_decode(&checked, handler_checked, tags));
+
+  /* Free all allocated memory */
+  pb_decoder_destroy(&checked);
+  pb_decoder_destroy(&decoder);
+  pb_buffer_destroy(&buffer);
+} END_TEST
+
+/*
+ * Decode a buffer with a flagged string field using an interning table.
+ */
+START_TEST(test_decode_intern) {
+  const uint8_t data[] = { 10, 3, 65, 66, 67, 10, 3, 65, 66, 67,
+                           18, 3, 65, 66, 67 };
+  const size_t  size   = 15;
+
+  /* Create buffer, decoder and interning table */
+  pb_buffer_t  buffer  = pb_buffer_create(data, size);
+  pb_decoder_t decoder = pb_decoder_create(&descriptor_intern, &buffer);
+  pb_intern_t  intern  = pb_intern_create();
+  pb_decoder_set_intern(&decoder, &intern);
+
+  /* Decode using the handler */
+  const void *values[4] = {};
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_decoder_decode(&decoder, handler_intern, values));
+
+  /* Assert only flagged strings were interned */
+  ck_assert_uint_eq(1, pb_intern_size(&intern));
+  ck_assert_ptr_eq(pb_intern_string(&intern, 0), values[0]);
+  ck_assert_ptr_eq(values[0], values[1]);
+  fail_if(values[1] == values[2]);
+  fail_unless(pb_string_equals(values[1], values[2]));
+
+  /* Free all allocated memory */
+  pb_intern_destroy(&intern);
+  pb_decoder_destroy(&decoder);
+  pb_buffer_destroy(&buffer);
+} END_TEST
+
+/*
+ * Decode a buffer with string fields using flags and an interning table.
+ */
+START_TEST(test_decode_intern_flags) {
+  const uint8_t data[] = { 10, 3, 65, 66, 67, 10, 3, 65, 66, 67,
+                           18, 3, 65, 66, 67 };
+  const size_t  size   = 15;
+
+  /* Create buffer, decoder and interning table */
+  pb_buffer_t  buffer  = pb_buffer_create(data, size);
+  pb_decoder_t decoder = pb_decoder_create_with_flags(
+    &descriptor_intern, &buffer, PB_DECODER_FLAG_INTERN);
+  pb_intern_t  intern  = pb_intern_create();
+  pb_decoder_set_intern(&decoder, &intern);
+
+  /* Decode using the handler */
+  const void *values[4] = {};
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_decoder_decode(&decoder, handler_intern, values));
+
+  /* Assert all strings were interned */
+  ck_assert_uint_eq(1, pb_intern_size(&intern));
+  ck_assert_ptr_eq(values[0], values[1]);
+  ck_assert_ptr_eq(values[1], values[2]);
+
+  /* Free all allocated memory */
+  pb_intern_destroy(&intern);
+  pb_decoder_destroy(&decoder);
+  pb_buffer_destroy(&buffer);
+} END_TEST
+
+/*
+ * Decode a buffer with an invalid packed field using a handler.
+ */
+START_TEST(test_decode_invalid_packed) {
+  const uint8_t data[] = { 50, 255 };
+  const size_t  size   = 2;
+
+  /* Create buffer and decoder */
+  pb_buffer_t  buffer  = pb_buffer_create(data, size);
+  pb_decoder_t decoder = pb_decoder_create(&descriptor, &buffer);
+
+  /* Assert decoder validity and error */
+  fail_unless(pb_decoder_valid(&decoder));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_decoder_error(&decoder));
+
+  /* Decode using the handler */
+  ck_assert_uint_eq(PB_ERROR_VARINT,
+    pb_decoder_decode(&decoder, handler, NULL));
+
+  /* Free all allocated memory */
+  pb_decoder_destroy(&decoder);
+  pb_buffer_destroy(&buffer);
+} END_TEST
+
+/*
+ * Decode a buffer with an invalid packed field using a packed handler.
+ */
+START_TEST(test_decode_invalid_packed_batch) {
+  const uint8_t data[] = { 10, 2, 1, 255 };
+  const size_t  size   = 4;
+
+  /* Create buffer and decoder */
+  pb_buffer_t  buffer  = pb_buffer_create(data, size);
+  pb_decoder_t decoder = pb_decoder_create(&descriptor, &buffer);
+
+  /* Decode using the handler and packed handler */
+  pb_tag_t tags[13] = {};
+  ck_assert_uint_eq(PB_ERROR_VARINT,
+    pb_decoder_decode_packed(&decoder, handler, handler_packed, tags));
+
+  /* Free all allocated memory */
+  pb_decoder_destroy(&decoder);
+  pb_buffer_destroy(&buffer);
+} END_TEST
+
+/*
+ * Decode a buffer with a misaligned packed field using a packed handler.
+ */
+START_TEST(test_decode_invalid_packed_batch_fixed) {
+  const uint8_t data[] = { 50, 5, 0, 202, 154, 59, 0 };
+  const size_t  size   = 7;
+
+  /* Create buffer and decoder */
+  pb_buffer_t  buffer  = pb_buffer_create(data, size);
+  pb_decoder_t decoder = pb_decoder_create(&descriptor, &buffer);
+
+  /* Decode using the handler and packed handler */
+  pb_tag_t tags[13] = {};
+  ck_assert_uint_eq(PB_ERROR_OFFSET,
+    pb_decoder_decode_packed(&decoder, handler, handler_packed, tags));
+
+  /* Free all allocated memory */
+  pb_decoder_destroy(&decoder);
+  pb_buffer_destroy(&buffer);
+} END_TEST
+
+/*
+ * Decode a buffer into a struct.
+ */
+START_TEST(test_decode_into) {
+  const uint8_t data[] = { 8, 127, 50, 8, 0, 0, 128, 63, 0, 0, 0, 64,
+                           66, 2, 65, 66, 90, 2, 8, 5, 98, 2, 8, 1,
+                           98, 2, 8, 2, 90, 2, 16, 6 };
+  const size_t  size   = 32;
+
+  /* Create buffer and decoder */
+  pb_buffer_t  buffer  = pb_buffer_create(data, size);
+  pb_decoder_t decoder = pb_decoder_create(&descriptor, &buffer);
+
+  /* Decode into struct */
+  value_t value;
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_decoder_decode_into(&decoder, &layout, &value));
+
+  /* Assert presence of fields */
+  fail_unless(pb_layout_has(&layout, &value, 0));
+  fail_if(pb_layout_has(&layout, &value, 1));
+  fail_unless(pb_layout_has(&layout, &value, 5));
+  fail_unless(pb_layout_has(&layout, &value, 7));
+  fail_unless(pb_layout_has(&layout, &value, 10));
+  fail_unless(pb_layout_has(&layout, &value, 11));
+
+  /* Assert singular values */
+  ck_assert_uint_eq(127, value.f01);
+  ck_assert_uint_eq(0, value.f02);
+  ck_assert_uint_eq(2, pb_string_size(&(value.f08)));
+  fail_if(memcmp("AB", pb_string_data(&(value.f08)), 2));
+
+  /* Assert values of packed field */
+  ck_assert_uint_eq(2, value.f06.size);
+  fail_unless(((float *)value.f06.data)[0] == 1.0f);
+  fail_unless(((float *)value.f06.data)[1] == 2.0f);
+
+  /* Assert merged nested message */
+  ck_assert_ptr_ne(NULL, value.f11);
+  ck_assert_uint_eq(5, value.f11->f01);
+  ck_assert_uint_eq(6, value.f11->f02);
+  fail_unless(pb_layout_has(&layout, value.f11, 0));
+  fail_unless(pb_layout_has(&layout, value.f11, 1));
+
+  /* Assert repeated nested messages */
+  ck_assert_uint_eq(2, value.f12.size);
+  ck_assert_uint_eq(1, ((value_t *)value.f12.data)[0].f01);
+  ck_assert_uint_eq(2, ((value_t *)value.f12.data)[1].f01);
+
+  /* Clear struct and assert absence of fields */
+  pb_layout_clear(&layout, &value);
+  fail_if(pb_layout_has(&layout, &value, 0));
+  ck_assert_ptr_eq(NULL, value.f11);
+  ck_assert_uint_eq(0, value.f12.size);
+
+  /* Free all allocated memory */
+  pb_decoder_destroy(&decoder);
+  pb_buffer_destroy(&buffer);
+} END_TEST
+
+/*
+ * Decode single fields into a struct.
+ */
+START_TEST(test_decode_field_into) {
+  const uint8_t data[] = { 8, 127, 104, 1, 98, 2, 8, 1 };
+  const size_t  size   = 8;
+
+  /* Create buffer and stream, and initialize struct */
+  pb_buffer_t buffer = pb_buffer_create(data, size);
+  pb_stream_t stream = pb_stream_create(&buffer);
+  value_t value;
+  pb_layout_init(&layout, &value);
+
+  /* Decode fields into struct */
+  while (pb_stream_left(&stream)) {
+    uint32_t key;
+    ck_assert_uint_eq(PB_ERROR_NONE,
+      pb_stream_read_uint32(&stream, &key));
+    ck_assert_uint_eq(PB_ERROR_NONE,
+      pb_decoder_decode_field_into(&stream, &layout, &value, key));
+  }
+
+  /* Assert values */
+  fail_unless(pb_layout_has(&layout, &value, 0));
+  fail_unless(pb_layout_has(&layout, &value, 11));
+  ck_assert_uint_eq(127, value.f01);
+  ck_assert_uint_eq(1, value.f12.size);
+  ck_assert_uint_eq(1, ((value_t *)value.f12.data)[0].f01);
+
+  /* Free all allocated memory */
+  pb_layout_clear(&layout, &value);
+  pb_stream_destroy(&stream);
+  pb_buffer_destroy(&buffer);
+} END_TEST
+
+/*
+ * Decode a buffer with an unknown tag into a struct.
+ */
+START_TEST(test_decode_into_skip) {
+  const uint8_t data[] = { 104, 1, 8, 127, 16, 127 };
+  const size_t  size   = 6;
+
+  /* Create buffer and decoder */
+  pb_buffer_t  buffer  = pb_buffer_create(data, size);
+  pb_decoder_t decoder = pb_decoder_create(&descriptor, &buffer);
+
+  /* Decode into struct */
+  value_t value;
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_decoder_decode_into(&decoder, &layout, &value));
+
+  /* Assert values */
+  ck_assert_uint_eq(127, value.f01);
+  ck_assert_uint_eq(127, value.f02);
+
+  /* Free all allocated memory */
+  pb_layout_clear(&layout, &value);
+  pb_decoder_destroy(&decoder);
+  pb_buffer_destroy(&buffer);
+} END_TEST
+
+/*
+ * Decode an invalid buffer into a struct.
+ */
+START_TEST(test_decode_into_invalid) {
+  pb_buffer_t  buffer  = pb_buffer_create_invalid();
+  pb_decoder_t decoder = pb_decoder_create(&descriptor, &buffer);
+
+  /* Decode into struct */
+  value_t value;
+  ck_assert_uint_eq(PB_ERROR_INVALID,
+    pb_decoder_decode_into(&decoder, &layout, &value));
+
+  /* Free all allocated memory */
+  pb_decoder_destroy(&decoder);
+  pb_buffer_destroy(&buffer);
+} END_TEST
+
+/*
+ * Decode a buffer with an invalid nested message into a struct.
+ */
+START_TEST(test_decode_into_invalid_message) {
+  const uint8_t data[] = { 98, 2, 8, 1, 98, 4, 8, 2, 8 };
+  const size_t  size   = 9;
+
+  /* Create buffer and decoder */
+  pb_buffer_t  buffer  = pb_buffer_create(data, size);
+  pb_decoder_t decoder = pb_decoder_create(&descriptor, &buffer);
+
+  /* Decode into struct */
+  value_t value;
+  ck_assert_uint_eq(PB_ERROR_OFFSET,
+    pb_decoder_decode_into(&decoder, &layout, &value));
+
+  /* Assert cleared struct */
+  ck_assert_uint_eq(0, value.f12.size);
+  ck_assert_ptr_eq(NULL, value.f12.data);
+
+  /* Free all allocated memory */
+  pb_decoder_destroy(&decoder);
+  pb_buffer_destroy(&buffer);
+} END_TEST
+
+/*
+ * Skip single fields of a stream.
+ */
+START_TEST(test_skip_field) {
+  const uint8_t data[] = { 8, 127, 98, 2, 8, 1, 57, 0, 0, 0, 0, 0, 0, 0, 0 };
+  const size_t  size   = 15;
+
+  /* Create buffer and stream */
+  pb_buffer_t buffer = pb_buffer_create(data, size);
+  pb_stream_t stream = pb_stream_create(&buffer);
+
+  /* Skip fields */
+  while (pb_stream_left(&stream)) {
+    uint32_t key;
+    ck_assert_uint_eq(PB_ERROR_NONE,
+      pb_stream_read_uint32(&stream, &key));
+    ck_assert_uint_eq(PB_ERROR_NONE,
+      pb_decoder_skip_field(&stream, key));
+  }
+
+  /* Free all allocated memory */
+  pb_stream_destroy(&stream);
+  pb_buffer_destroy(&buffer);
+} END_TEST
+
+/*
+ * Skip a field with an invalid wiretype.
+ */
+START_TEST(test_skip_field_invalid) {
+  const uint8_t data[] = { 11, 127 };
+  const size_t  size   = 2;
+
+  /* Create buffer and stream */
+  pb_buffer_t buffer = pb_buffer_create(data, size);
+  pb_stream_t stream = pb_stream_create(&buffer);
+
+  /* Skip field */
+  uint32_t key;
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_stream_read_uint32(&stream, &key));
+  ck_assert_uint_eq(PB_ERROR_INVALID,
+    pb_decoder_skip_field(&stream, key));
+
+  /* Free all allocated memory */
+  pb_stream_destroy(&stream);
+  pb_buffer_destroy(&buffer);
+} END_TEST
+
+/*
+ * Decode a nested message using a handler for its decoder.
+ */
+START_TEST(test_decode_nested) {
+  uint8_t      data[] = { 8, 127, 16, 1 };
+  const size_t size   = 4;
+
+  /* Create buffer and decoder */
+  pb_buffer_t  buffer  = pb_buffer_create_empty();
+  pb_decoder_t decoder = pb_decoder_create_with_flags(
+    &descriptor, &buffer, PB_DECODER_FLAG_UTF8);
+
+  /* Decode nested message using the handler */
+  pb_tag_t tags[12] = { 0 };
+  pb_string_t value = pb_string_init(data, size);
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_decoder_decode_nested(&decoder, &descriptor, &value,
+      handler_nested, tags));
+
+  /* Assert expected occurences and inherited flags */
+  ck_assert_uint_eq(1, tags[0]);
+  ck_assert_uint_eq(1, tags[1]);
+  ck_assert_uint_eq(PB_DECODER_FLAG_UTF8, tags[11]);
+
+  /* Free all allocated memory */
+  pb_decoder_destroy(&decoder);
+  pb_buffer_destroy(&buffer);
+} END_TEST
+
+/*
+ * Create a feed decoder.
+ */
+START_TEST(test_feed_create) {
+  pb_tag_t tags[13] = {};
+  pb_decoder_feed_t feed = pb_decoder_feed_create(&descriptor, handler, tags);
+
+  /* Assert feed decoder validity and error */
+  fail_unless(pb_decoder_feed_valid(&feed));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_decoder_feed_error(&feed));
+  ck_assert_ptr_eq(&descriptor, pb_decoder_feed_descriptor(&feed));
+  ck_assert_uint_eq(0, pb_decoder_feed_depth(&feed));
+  ck_assert_uint_eq(0, pb_decoder_feed_offset(&feed));
+
+  /* Free all allocated memory */
+  pb_decoder_feed_destroy(&feed);
+} END_TEST
+
+/*
+ * Feed a message in chunks of all possible sizes to a feed decoder.
+ */
+START_TEST(test_feed) {
+  const uint8_t data[] = { 8, 127, 66, 3, 97, 98, 99, 50, 8, 0, 0, 128, 63,
+    0, 0, 0, 64, 90, 4, 8, 1, 16, 2, 106, 3, 1, 2, 3, 8, 1 };
+  const size_t  size   = 30;
+
+  /* Feed message using chunks of different sizes */
+  for (size_t chunk = 1; chunk <= size; chunk++) {
+    pb_tag_t tags[13] = {};
+    pb_decoder_feed_t feed =
+      pb_decoder_feed_create(&descriptor, handler, tags);
+    for (size_t offset = 0; offset < size; offset += chunk)
+      ck_assert_uint_eq(PB_ERROR_NONE, pb_decoder_feed(&feed,
+        &(data[offset]), offset + chunk > size ? size - offset : chunk));
+
+    /* Finish message and assert offset */
+    ck_assert_uint_eq(size, pb_decoder_feed_offset(&feed));
+    ck_assert_uint_eq(PB_ERROR_NONE, pb_decoder_feed_finish(&feed));
+    ck_assert_uint_eq(0, pb_decoder_feed_offset(&feed));
+
+    /* Assert expected occurences */
+    ck_assert_uint_eq(3, tags[0]);
+    ck_assert_uint_eq(1, tags[1]);
+    ck_assert_uint_eq(2, tags[5]);
+    ck_assert_uint_eq(1, tags[7]);
+    ck_assert_uint_eq(1, tags[10]);
+
+    /* Free all allocated memory */
+    pb_decoder_feed_destroy(&feed);
+  }
+} END_TEST
+
+/*
+ * Feed a message split into segments at all possible positions.
+ */
+START_TEST(test_feed_segments) {
+  uint8_t data[] = { 8, 127, 66, 3, 97, 98, 99, 50, 8, 0, 0, 128, 63,
+    0, 0, 0, 64, 90, 4, 8, 1, 16, 2, 106, 3, 1, 2, 3, 8, 1 };
+  const size_t size = 30;
+
+  /* Feed message using three segments */
+  for (size_t a = 0; a <= size; a++) {
+    for (size_t b = a; b <= size; b++) {
+      pb_tag_t tags[13] = {};
+      pb_decoder_feed_t feed =
+        pb_decoder_feed_create(&descriptor, handler, tags);
+      const pb_string_t segments[] = {
+        { data,          a        },
+        { &(data[a]),    b - a    },
+        { &(data[b]),    size - b }
+      };
+      ck_assert_uint_eq(PB_ERROR_NONE,
+        pb_decoder_feed_segments(&feed, segments, 3));
+
+      /* Finish message and assert offset */
+      ck_assert_uint_eq(size, pb_decoder_feed_offset(&feed));
+      ck_assert_uint_eq(PB_ERROR_NONE, pb_decoder_feed_finish(&feed));
+
+      /* Assert expected occurences */
+      ck_assert_uint_eq(3, tags[0]);
+      ck_assert_uint_eq(1, tags[1]);
+      ck_assert_uint_eq(2, tags[5]);
+      ck_assert_uint_eq(1, tags[7]);
+      ck_assert_uint_eq(1, tags[10]);
+
+      /* Free all allocated memory */
+      pb_decoder_feed_destroy(&feed);
+    }
+  }
+} END_TEST
+
+/*
+ * Feed a message with a string spanning a segment to a feed decoder.
+ */
+START_TEST(test_feed_segments_spanning) {
+  uint8_t data[72] = { 66, 64 };
+  memset(&(data[2]), 'a', 64);
+  data[66] = 8; data[67] = 1;
+  data[68] = 8; data[69] = 2;
+  data[70] = 8; data[71] = 3;
+
+  /* Create feed decoder */
+  pb_tag_t tags[13] = {};
+  pb_decoder_feed_t feed = pb_decoder_feed_create(&descriptor, handler, tags);
+  const pb_string_t segments[] = {
+    { data,          4  },
+    { &(data[4]),    68 }
+  };
+
+  /* Assert that only the string is retained */
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_decoder_feed_segments(&feed, segments, 1));
+  ck_assert_uint_eq(4, pb_buffer_size(&(feed.buffer)));
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_decoder_feed_segments(&feed, &(segments[1]), 1));
+  ck_assert_uint_eq(0, pb_buffer_size(&(feed.buffer)));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_decoder_feed_finish(&feed));
+
+  /* Assert expected occurences */
+  ck_assert_uint_eq(3, tags[0]);
+  ck_assert_uint_eq(1, tags[7]);
+
+  /* Free all allocated memory */
+  pb_decoder_feed_destroy(&feed);
+} END_TEST
+
+/*
+ * Feed a message with a nested message to a feed decoder.
+ */
+START_TEST(test_feed_message) {
+  const uint8_t data[] = { 90, 4, 90, 2, 8, 1, 8, 1 };
+
+  /* Create feed decoder */
+  pb_tag_t tags[13] = {};
+  pb_decoder_feed_t feed = pb_decoder_feed_create(&descriptor, handler, tags);
+
+  /* Feed nested messages and assert depth */
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_decoder_feed(&feed, data, 4));
+  ck_assert_uint_eq(2, pb_decoder_feed_depth(&feed));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_decoder_feed(&feed, &(data[4]), 2));
+  ck_assert_uint_eq(0, pb_decoder_feed_depth(&feed));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_decoder_feed(&feed, &(data[6]), 2));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_decoder_feed_finish(&feed));
+
+  /* Assert expected occurences */
+  ck_assert_uint_eq(2, tags[0]);
+  ck_assert_uint_eq(2, tags[10]);
+
+  /* Free all allocated memory */
+  pb_decoder_feed_destroy(&feed);
+} END_TEST
+
+/*
+ * Feed an incomplete message to a feed decoder.
+ */
+START_TEST(test_feed_incomplete) {
+  const uint8_t data[] = { 8, 127, 66, 3, 97 };
+  const size_t  size   = 5;
+
+  /* Create feed decoder */
+  pb_tag_t tags[13] = {};
+  pb_decoder_feed_t feed = pb_decoder_feed_create(&descriptor, handler, tags);
+
+  /* Feed message and finish */
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_decoder_feed(&feed, data, size));
+  ck_assert_uint_eq(PB_ERROR_OFFSET, pb_decoder_feed_finish(&feed));
+
+  /* Assert expected occurences */
+  ck_assert_uint_eq(1, tags[0]);
+  ck_assert_uint_eq(0, tags[7]);
+
+  /* Free all allocated memory */
+  pb_decoder_feed_destroy(&feed);
+} END_TEST
+
+/*
+ * Feed a message with an invalid value to a feed decoder.
+ */
+START_TEST(test_feed_invalid_value) {
+  const uint8_t data[] = {
+    8, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255 };
+
+  /* Create feed decoder */
+  pb_tag_t tags[13] = {};
+  pb_decoder_feed_t feed = pb_decoder_feed_create(&descriptor, handler, tags);
+
+  /* Feed message and assert error */
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_decoder_feed(&feed, data, 5));
+  ck_assert_uint_eq(PB_ERROR_VARINT, pb_decoder_feed(&feed, &(data[5]), 6));
+  fail_if(pb_decoder_feed_valid(&feed));
+  ck_assert_uint_eq(PB_ERROR_VARINT, pb_decoder_feed(&feed, data, 1));
+
+  /* Free all allocated memory */
+  pb_decoder_feed_destroy(&feed);
+} END_TEST
+
+/*
+ * Feed messages with values not matching the wiretype of their fields.
+ */
+START_TEST(test_feed_invalid_wiretype) {
+  const uint8_t data[][17] = {
+    { 64, 1 },
+    { 65, 239, 190, 173, 222, 239, 190, 173, 222 },
+    { 69, 239, 190, 173, 222 },
+    { 72, 1 },
+    { 73, 239, 190, 173, 222, 239, 190, 173, 222,
+      16, 0, 0, 0, 0, 0, 0, 0 },
+    { 77, 239, 190, 173, 222 },
+    { 13, 1, 0, 0, 0 },
+    { 61, 0, 0, 128, 63 }
+  };
+  const size_t size[] = { 2, 9, 5, 2, 17, 5, 5, 5 };
+
+  /* Feed each message and assert error */
+  for (size_t d = 0; d < 8; d++) {
+    pb_tag_t tags[13] = { 0 };
+    pb_decoder_feed_t feed =
+      pb_decoder_feed_create(&descriptor, handler, tags);
+    ck_assert_uint_eq(PB_ERROR_INVALID,
+      pb_decoder_feed(&feed, data[d], size[d]));
+    fail_if(pb_decoder_feed_valid(&feed));
+    for (size_t t = 0; t < 13; t++)
+      ck_assert_uint_eq(0, tags[t]);
+
+    /* Free all allocated memory */
+    pb_decoder_feed_destroy(&feed);
+  }
+} END_TEST
+
+/*
+ * Feed a message with a nested message exceeding its parent to a feed decoder.
+ */
+START_TEST(test_feed_invalid_message) {
+  const uint8_t data[] = { 90, 2, 90, 2, 8, 1 };
+  const size_t  size   = 6;
+
+  /* Create feed decoder */
+  pb_tag_t tags[13] = {};
+  pb_decoder_feed_t feed = pb_decoder_feed_create(&descriptor, handler, tags);
+
+  /* Feed message and assert error */
+  ck_assert_uint_eq(PB_ERROR_OFFSET, pb_decoder_feed(&feed, data, size));
+
+  /* Free all allocated memory */
+  pb_decoder_feed_destroy(&feed);
+} END_TEST
+
+/*
+ * Feed a message with an invalid packed field to a feed decoder.
+ */
+START_TEST(test_feed_invalid_packed) {
+  const uint8_t data[] = { 50, 3, 0, 0, 128 };
+  const size_t  size   = 5;
+
+  /* Create feed decoder */
+  pb_tag_t tags[13] = {};
+  pb_decoder_feed_t feed = pb_decoder_feed_create(&descriptor, handler, tags);
+
+  /* Feed message and assert error */
+  ck_assert_uint_eq(PB_ERROR_OFFSET, pb_decoder_feed(&feed, data, size));
+
+  /* Free all allocated memory */
+  pb_decoder_feed_destroy(&feed);
+} END_TEST
+
+/*
+ * Decode a message in slices of all possible sizes with a feed decoder.
+ */
+START_TEST(test_feed_slice) {
+  const uint8_t data[] = { 8, 127, 66, 3, 97, 98, 99, 50, 8, 0, 0, 128, 63,
+    0, 0, 0, 64, 90, 4, 8, 1, 16, 2, 106, 3, 1, 2, 3, 8, 1 };
+  const size_t  size   = 30;
+
+  /* Decode message using slices limited by bytes and by fields */
+  for (size_t limit = 1; limit <= size; limit++) {
+    for (size_t mode = 0; mode < 2; mode++) {
+      pb_tag_t tags[13] = {};
+      pb_decoder_feed_t feed =
+        pb_decoder_feed_create(&descriptor, handler, tags);
+      size_t slices = 0, offset = 0;
+      do {
+        ck_assert_uint_eq(PB_ERROR_NONE, pb_decoder_feed_slice(&feed,
+          data, size, mode ? 0 : limit, mode ? limit : 0));
+        fail_unless(pb_decoder_feed_offset(&feed) > offset);
+        offset = pb_decoder_feed_offset(&feed);
+        slices++;
+      } while (offset < size);
+
+      /* Assert number of slices */
+      if (limit == 1)
+        ck_assert_uint_eq(10, slices);
+      if (limit == size)
+        ck_assert_uint_eq(1, slices);
+
+      /* Finish message and assert offset */
+      ck_assert_uint_eq(PB_ERROR_NONE, pb_decoder_feed_finish(&feed));
+      ck_assert_uint_eq(0, pb_decoder_feed_offset(&feed));
+
+      /* Assert expected occurences */
+      ck_assert_uint_eq(3, tags[0]);
+      ck_assert_uint_eq(1, tags[1]);
+      ck_assert_uint_eq(2, tags[5]);
+      ck_assert_uint_eq(1, tags[7]);
+      ck_assert_uint_eq(1, tags[10]);
+
+      /* Free all allocated memory */
+      pb_decoder_feed_destroy(&feed);
+    }
+  }
+} END_TEST
+
+/*
+ * Decode a message with a nested message in slices with a feed decoder.
+ */
+START_TEST(test_feed_slice_message) {
+  const uint8_t data[] = { 90, 4, 90, 2, 8, 1, 8, 1 };
+  const size_t  size   = 8;
+
+  /* Create feed decoder */
+  pb_tag_t tags[13] = {};
+  pb_decoder_feed_t feed = pb_decoder_feed_create(&descriptor, handler, tags);
+
+  /* Decode nested messages field by field and assert depth */
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_decoder_feed_slice(&feed, data, size, 0, 2));
+  ck_assert_uint_eq(2, pb_decoder_feed_depth(&feed));
+  ck_assert_uint_eq(4, pb_decoder_feed_offset(&feed));
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_decoder_feed_slice(&feed, data, size, 0, 1));
+  ck_assert_uint_eq(0, pb_decoder_feed_depth(&feed));
+  ck_assert_uint_eq(6, pb_decoder_feed_offset(&feed));
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_decoder_feed_slice(&feed, data, size, 0, 1));
+  ck_assert_uint_eq(size, pb_decoder_feed_offset(&feed));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_decoder_feed_finish(&feed));
+
+  /* Assert expected occurences */
+  ck_assert_uint_eq(2, tags[0]);
+  ck_assert_uint_eq(2, tags[10]);
+
+  /* Free all allocated memory */
+  pb_decoder_feed_destroy(&feed);
+} END_TEST
+
+/*
+ * Decode a truncated message in slices with a feed decoder.
+ */
+START_TEST(test_feed_slice_incomplete) {
+  const uint8_t data[] = { 8, 127, 66, 3, 97 };
+  const size_t  size   = 5;
+
+  /* Create feed decoder */
+  pb_tag_t tags[13] = {};
+  pb_decoder_feed_t feed = pb_decoder_feed_create(&descriptor, handler, tags);
+
+  /* Decode message and assert error */
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_decoder_feed_slice(&feed, data, size, 1, 0));
+  ck_assert_uint_eq(PB_ERROR_OFFSET,
+    pb_decoder_feed_slice(&feed, data, size, 1, 0));
+  fail_if(pb_decoder_feed_valid(&feed));
+
+  /* Assert expected occurences */
+  ck_assert_uint_eq(1, tags[0]);
+  ck_assert_uint_eq(0, tags[7]);
+
+  /* Free all allocated memory */
+  pb_decoder_feed_destroy(&feed);
+} END_TEST
+
+/*
+ * Decode a message in slices after feeding a chunk to a feed decoder.
+ */
+START_TEST(test_feed_slice_invalid) {
+  const uint8_t data[] = { 8, 127, 66, 3, 97 };
+  const size_t  size   = 5;
+
+  /* Create feed decoder */
+  pb_tag_t tags[13] = {};
+  pb_decoder_feed_t feed = pb_decoder_feed_create(&descriptor, handler, tags);
+
+  /* Feed incomplete chunk and assert error */
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_decoder_feed(&feed, data, size));
+  ck_assert_uint_eq(PB_ERROR_INVALID,
+    pb_decoder_feed_slice(&feed, data, size, 0, 0));
+
+  /* Free all allocated memory */
+  pb_decoder_feed_destroy(&feed);
+} END_TEST
+
+/*
+ * Decode a buffer with nested messages using a handler and a budget.
+ */
+START_TEST(test_budget_depth) {
+  const uint8_t data[] = { 90, 4, 90, 2, 8, 1 };
+  const size_t  size   = 6;
+
+  /* Create buffer and decoder with budget */
+  pb_buffer_t  buffer  = pb_buffer_create(data, size);
+  pb_decoder_t decoder = pb_decoder_create(&descriptor, &buffer);
+  pb_decoder_budget_t budget = { .depth = 1 };
+  pb_decoder_set_budget(&decoder, &budget);
+
+  /* Decode using the handler */
+  pb_tag_t tags[12] = {};
+  ck_assert_uint_eq(PB_ERROR_DEPTH,
+    pb_decoder_decode(&decoder, handler_checked, tags));
+
+  /* Assert expected occurences */
+  ck_assert_uint_eq(0, tags[0]);
+  ck_assert_uint_eq(1, tags[10]);
+
+  /* Decode again with a sufficient depth */
+  memset(tags, 0, sizeof(tags));
+  budget.depth = 2;
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_decoder_decode(&decoder, handler_checked, tags));
+
+  /* Assert expected occurences */
+  ck_assert_uint_eq(1, tags[0]);
+  ck_assert_uint_eq(2, tags[10]);
+  ck_assert_uint_eq(3, budget.count);
+
+  /* Free all allocated memory */
+  pb_decoder_destroy(&decoder);
+  pb_buffer_destroy(&buffer);
+} END_TEST
+
+/*
+ * Decode a buffer exceeding the size of a budget.
+ */
+START_TEST(test_budget_size) {
+  const uint8_t data[] = { 8, 127, 8, 127 };
+  const size_t  size   = 4;
+
+  /* Create buffer and decoder with budget */
+  pb_buffer_t  buffer  = pb_buffer_create(data, size);
+  pb_decoder_t decoder = pb_decoder_create(&descriptor, &buffer);
+  pb_decoder_budget_t budget = { .size = 3 };
+  pb_decoder_set_budget(&decoder, &budget);
+
+  /* Decode using the handler */
+  pb_tag_t tags[12] = {};
+  ck_assert_uint_eq(PB_ERROR_SIZE,
+    pb_decoder_decode(&decoder, handler, tags));
+
+  /* Assert expected occurences */
+  ck_assert_uint_eq(0, tags[0]);
+
+  /* Free all allocated memory */
+  pb_decoder_destroy(&decoder);
+  pb_buffer_destroy(&buffer);
+} END_TEST
+
+/*
+ * Decode a buffer exceeding the field count of a budget in a nested message.
+ */
+START_TEST(test_budget_fields) {
+  const uint8_t data[] = { 90, 4, 8, 1, 8, 1, 8, 1 };
+  const size_t  size   = 8;
+
+  /* Create buffer and decoder with budget */
+  pb_buffer_t  buffer  = pb_buffer_create(data, size);
+  pb_decoder_t decoder = pb_decoder_create(&descriptor, &buffer);
+  pb_decoder_budget_t budget = { .fields = 2 };
+  pb_decoder_set_budget(&decoder, &budget);
+
+  /* Decode using the handler */
+  pb_tag_t tags[12] = {};
+  ck_assert_uint_eq(PB_ERROR_FIELDS,
+    pb_decoder_decode(&decoder, handler_checked, tags));
+
+  /* Assert expected occurences */
+  ck_assert_uint_eq(1, tags[0]);
+  ck_assert_uint_eq(1, tags[10]);
+
+  /* Free all allocated memory */
+  pb_decoder_destroy(&decoder);
+  pb_buffer_destroy(&buffer);
+} END_TEST
+
+/*
+ * Decode a buffer exceeding the string length of a budget.
+ */
+START_TEST(test_budget_length) {
+  const uint8_t data[] = { 8, 127, 66, 3, 97, 98, 99 };
+  const size_t  size   = 7;
+
+  /* Create buffer and decoder with budget */
+  pb_buffer_t  buffer  = pb_buffer_create(data, size);
+  pb_decoder_t decoder = pb_decoder_create(&descriptor, &buffer);
+  pb_decoder_budget_t budget = { .length = 2 };
+  pb_decoder_set_budget(&decoder, &budget);
+
+  /* Decode using the handler */
+  pb_tag_t tags[12] = {};
+  ck_assert_uint_eq(PB_ERROR_LENGTH,
+    pb_decoder_decode(&decoder, handler, tags));
+
+  /* Assert expected occurences */
+  ck_assert_uint_eq(1, tags[0]);
+  ck_assert_uint_eq(0, tags[7]);
+
+  /* Free all allocated memory */
+  pb_decoder_destroy(&decoder);
+  pb_buffer_destroy(&buffer);
+} END_TEST
+
+/*
+ * Decode a buffer into a struct exceeding the depth of a budget.
+ */
+START_TEST(test_budget_into) {
+  const uint8_t data[] = { 90, 4, 90, 2, 8, 1 };
+  const size_t  size   = 6;
+
+  /* Create buffer and decoder with budget */
+  pb_buffer_t  buffer  = pb_buffer_create(data, size);
+  pb_decoder_t decoder = pb_decoder_create(&descriptor, &buffer);
+  pb_decoder_budget_t budget = { .depth = 1 };
+  pb_decoder_set_budget(&decoder, &budget);
+
+  /* Decode buffer into struct */
+  value_t value;
+  ck_assert_uint_eq(PB_ERROR_DEPTH,
+    pb_decoder_decode_into(&decoder, &layout, &value));
+
+  /* Decode again with a sufficient depth */
+  budget.depth = 2;
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_decoder_decode_into(&decoder, &layout, &value));
+  ck_assert_uint_eq(1, value.f11->f11->f01);
+  ck_assert_uint_eq(3, budget.count);
+
+  /* Free all allocated memory */
+  pb_layout_clear(&layout, &value);
+  pb_decoder_destroy(&decoder);
+  pb_buffer_destroy(&buffer);
+} END_TEST
+
+/*
+ * Feed a message exceeding the depth of a budget to a feed decoder.
+ */
+START_TEST(test_budget_feed_depth) {
+  const uint8_t data[] = { 90, 4, 90, 2, 8, 1 };
+  const size_t  size   = 6;
+
+  /* Create feed decoder with budget */
+  pb_tag_t tags[13] = {};
+  pb_decoder_feed_t feed = pb_decoder_feed_create(&descriptor, handler, tags);
+  pb_decoder_budget_t budget = { .depth = 1 };
+  pb_decoder_feed_set_budget(&feed, &budget);
+
+  /* Feed message and assert error */
+  ck_assert_uint_eq(PB_ERROR_DEPTH, pb_decoder_feed(&feed, data, size));
+  ck_assert_uint_eq(PB_ERROR_DEPTH, pb_decoder_feed_error(&feed));
+  ck_assert_uint_eq(1, pb_decoder_feed_depth(&feed));
+  ck_assert_uint_eq(1, tags[10]);
+
+  /* Free all allocated memory */
+  pb_decoder_feed_destroy(&feed);
+} END_TEST
+
+/*
+ * Feed a message exceeding the size of a budget to a feed decoder.
+ */
+START_TEST(test_budget_feed_size) {
+  const uint8_t data[] = { 8, 1, 8, 1, 8, 1 };
+
+  /* Create feed decoder with budget */
+  pb_tag_t tags[13] = {};
+  pb_decoder_feed_t feed = pb_decoder_feed_create(&descriptor, handler, tags);
+  pb_decoder_budget_t budget = { .size = 4, .fields = 2 };
+  pb_decoder_feed_set_budget(&feed, &budget);
+
+  /* Feed message and reuse feed decoder for the next one */
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_decoder_feed(&feed, data, 3));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_decoder_feed(&feed, &(data[3]), 1));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_decoder_feed_finish(&feed));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_decoder_feed(&feed, data, 4));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_decoder_feed_finish(&feed));
+
+  /* Feed message exceeding the size before decoding it */
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_decoder_feed(&feed, data, 4));
+  ck_assert_uint_eq(PB_ERROR_SIZE, pb_decoder_feed(&feed, &(data[4]), 2));
+  ck_assert_uint_eq(6, tags[0]);
+
+  /* Free all allocated memory */
+  pb_decoder_feed_destroy(&feed);
+} END_TEST
+
+/*
+ * Feed a string exceeding the length of a budget to a feed decoder.
+ */
+START_TEST(test_budget_feed_length) {
+  const uint8_t data[] = { 66, 127 };
+  const size_t  size   = 2;
+
+  /* Create feed decoder with budget */
+  pb_tag_t tags[13] = {};
+  pb_decoder_feed_t feed = pb_decoder_feed_create(&descriptor, handler, tags);
+  pb_decoder_budget_t budget = { .length = 16 };
+  pb_decoder_feed_set_budget(&feed, &budget);
+
+  /* Feed length prefix and assert error */
+  ck_assert_uint_eq(PB_ERROR_LENGTH, pb_decoder_feed(&feed, data, size));
+  ck_assert_uint_eq(0, tags[7]);
+
+  /* Free all allocated memory */
+  pb_decoder_feed_destroy(&feed);
+} END_TEST
+
+/* ----------------------------------------------------------------------------
+ * Program
+ * ------------------------------------------------------------------------- */
+
+/*
+ * Create a test suite for all registered test cases and run it.
+ *
  * Tests must be run sequentially (in no-fork mode) or code coverage
  * cannot be determined properly.
  */
@@ -383,13 +1991,79 @@ main(void) {
   tcase_add_test(tcase, test_decode);
   tcase_add_test(tcase, test_decode_message);
   tcase_add_test(tcase, test_decode_skip);
+  tcase_add_test(tcase, test_decode_unknown);
+  tcase_add_test(tcase, test_decode_keyed);
+  tcase_add_test(tcase, test_decode_checked);
+  tcase_add_test(tcase, test_decode_checked_absent);
+  tcase_add_test(tcase, test_decode_checked_absent_message);
+  tcase_add_test(tcase, test_decode_masked);
+  tcase_add_test(tcase, test_decode_masked_message);
+  tcase_add_test(tcase, test_decode_index);
+  tcase_add_test(tcase, test_decode_index_masked);
   tcase_add_test(tcase, test_decode_packed);
+  tcase_add_test(tcase, test_decode_packed_batch);
+  tcase_add_test(tcase, test_decode_packed_batch_varint);
+  tcase_add_test(tcase, test_decode_packed_batch_large);
+  tcase_add_test(tcase, test_decode_packed_batch_aligned);
+  tcase_add_test(tcase, test_decode_packed_batch_misaligned);
   tcase_add_test(tcase, test_decode_invalid);
   tcase_add_test(tcase, test_decode_invalid_tag);
   tcase_add_test(tcase, test_decode_invalid_length);
   tcase_add_test(tcase, test_decode_invalid_length_data);
   tcase_add_test(tcase, test_decode_invalid_value);
+  tcase_add_test(tcase, test_decode_invalid_utf8);
+  tcase_add_test(tcase, test_decode_invalid_utf8_flags);
+  tcase_add_test(tcase, test_decode_intern);
+  tcase_add_test(tcase, test_decode_intern_flags);
   tcase_add_test(tcase, test_decode_invalid_packed);
+  tcase_add_test(tcase, test_decode_invalid_packed_batch);
+  tcase_add_test(tcase, test_decode_invalid_packed_batch_fixed);
+  suite_add_tcase(suite, tcase);
+
+  /* Add tests to test case "decode_into" */
+  tcase = tcase_create("decode_into");
+  tcase_add_test(tcase, test_decode_into);
+  tcase_add_test(tcase, test_decode_into_skip);
+  tcase_add_test(tcase, test_decode_field_into);
+  tcase_add_test(tcase, test_decode_into_invalid);
+  tcase_add_test(tcase, test_decode_into_invalid_message);
+  suite_add_tcase(suite, tcase);
+
+  /* Add tests to test case "decode_nested" */
+  tcase = tcase_create("decode_nested");
+  tcase_add_test(tcase, test_skip_field);
+  tcase_add_test(tcase, test_skip_field_invalid);
+  tcase_add_test(tcase, test_decode_nested);
+  suite_add_tcase(suite, tcase);
+
+  /* Add tests to test case "feed" */
+  tcase = tcase_create("feed");
+  tcase_add_test(tcase, test_feed_create);
+  tcase_add_test(tcase, test_feed);
+  tcase_add_test(tcase, test_feed_segments);
+  tcase_add_test(tcase, test_feed_segments_spanning);
+  tcase_add_test(tcase, test_feed_message);
+  tcase_add_test(tcase, test_feed_incomplete);
+  tcase_add_test(tcase, test_feed_invalid_value);
+  tcase_add_test(tcase, test_feed_invalid_wiretype);
+  tcase_add_test(tcase, test_feed_invalid_message);
+  tcase_add_test(tcase, test_feed_invalid_packed);
+  tcase_add_test(tcase, test_feed_slice);
+  tcase_add_test(tcase, test_feed_slice_message);
+  tcase_add_test(tcase, test_feed_slice_incomplete);
+  tcase_add_test(tcase, test_feed_slice_invalid);
+  suite_add_tcase(suite, tcase);
+
+  /* Add tests to test case "budget" */
+  tcase = tcase_create("budget");
+  tcase_add_test(tcase, test_budget_depth);
+  tcase_add_test(tcase, test_budget_size);
+  tcase_add_test(tcase, test_budget_fields);
+  tcase_add_test(tcase, test_budget_length);
+  tcase_add_test(tcase, test_budget_into);
+  tcase_add_test(tcase, test_budget_feed_depth);
+  tcase_add_test(tcase, test_budget_feed_size);
+  tcase_add_test(tcase, test_budget_feed_length);
   suite_add_tcase(suite, tcase);
 
   /* Create a test suite runner in no-fork mode */
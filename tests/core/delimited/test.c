@@ -0,0 +1,251 @@
+/*
+ * Copyright (c) 2013-2020 Martin Donath <martin.donath@squidfunk.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <check.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "core/buffer.h"
+#include "core/common.h"
+#include "core/delimited.h"
+
+/* ----------------------------------------------------------------------------
+ * Tests
+ * ------------------------------------------------------------------------- */
+
+/*
+ * Read delimited messages from a buffer.
+ */
+START_TEST(test_reader) {
+  const uint8_t data[] = { 3, 1, 2, 3, 0, 1, 4 };
+  pb_buffer_t buffer = pb_buffer_create(data, 7);
+
+  /* Create reader */
+  pb_delimited_reader_t reader = pb_delimited_reader_create(&buffer);
+  fail_unless(pb_delimited_reader_valid(&reader));
+
+  /* Read first message */
+  pb_buffer_t message;
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_delimited_reader_next(&reader, &message));
+  ck_assert_uint_eq(3, pb_buffer_size(&message));
+  fail_if(memcmp(&(data[1]), pb_buffer_data(&message), 3));
+
+  /* Read empty message */
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_delimited_reader_next(&reader, &message));
+  fail_unless(pb_buffer_empty(&message));
+
+  /* Read last message */
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_delimited_reader_next(&reader, &message));
+  ck_assert_uint_eq(1, pb_buffer_size(&message));
+  ck_assert_uint_eq(4, pb_buffer_data(&message)[0]);
+
+  /* Assert end of stream */
+  ck_assert_uint_eq(PB_ERROR_EOM,
+    pb_delimited_reader_next(&reader, &message));
+
+  /* Free all allocated memory */
+  pb_delimited_reader_destroy(&reader);
+  pb_buffer_destroy(&buffer);
+} END_TEST
+
+/*
+ * Read delimited messages from a truncated buffer.
+ */
+START_TEST(test_reader_truncated) {
+  const uint8_t data[] = { 1, 1, 3, 1 };
+  pb_buffer_t buffer = pb_buffer_create(data, 4);
+
+  /* Create reader */
+  pb_delimited_reader_t reader = pb_delimited_reader_create(&buffer);
+  fail_unless(pb_delimited_reader_valid(&reader));
+
+  /* Read messages */
+  pb_buffer_t message;
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_delimited_reader_next(&reader, &message));
+  ck_assert_uint_eq(PB_ERROR_OFFSET,
+    pb_delimited_reader_next(&reader, &message));
+
+  /* Free all allocated memory */
+  pb_delimited_reader_destroy(&reader);
+  pb_buffer_destroy(&buffer);
+} END_TEST
+
+/*
+ * Read delimited messages with an invalid length prefix.
+ */
+START_TEST(test_reader_varint) {
+  const uint8_t data[] = { 255, 255, 255, 255, 255, 1 };
+  pb_buffer_t buffer = pb_buffer_create(data, 6);
+
+  /* Create reader */
+  pb_delimited_reader_t reader = pb_delimited_reader_create(&buffer);
+  fail_unless(pb_delimited_reader_valid(&reader));
+
+  /* Read message */
+  pb_buffer_t message;
+  ck_assert_uint_eq(PB_ERROR_VARINT,
+    pb_delimited_reader_next(&reader, &message));
+
+  /* Free all allocated memory */
+  pb_delimited_reader_destroy(&reader);
+  pb_buffer_destroy(&buffer);
+} END_TEST
+
+/*
+ * Create a delimited reader over an invalid buffer.
+ */
+START_TEST(test_reader_invalid) {
+  pb_buffer_t buffer = pb_buffer_create_invalid();
+
+  /* Create reader */
+  pb_delimited_reader_t reader = pb_delimited_reader_create(&buffer);
+  fail_if(pb_delimited_reader_valid(&reader));
+  ck_assert_uint_eq(PB_ERROR_ALLOC, pb_delimited_reader_error(&reader));
+
+  /* Read message */
+  pb_buffer_t message;
+  ck_assert_uint_eq(PB_ERROR_INVALID,
+    pb_delimited_reader_next(&reader, &message));
+
+  /* Free all allocated memory */
+  pb_delimited_reader_destroy(&reader);
+} END_TEST
+
+/*
+ * Write delimited messages and read them back from a file descriptor.
+ */
+START_TEST(test_writer) {
+  int fd[2];
+  fail_if(pipe(fd));
+
+  /* Create writer and write more messages than fit into a batch */
+  pb_delimited_writer_t writer = pb_delimited_writer_create(fd[1]);
+  uint8_t data[200];
+  for (size_t m = 0; m < 200; m++)
+    data[m] = (uint8_t)m;
+  for (size_t m = 0; m < 40; m++) {
+    pb_buffer_t buffer = pb_buffer_create_zero_copy(data, m ? m * 5 : 1);
+    ck_assert_uint_eq(PB_ERROR_NONE,
+      pb_delimited_writer_write(&writer, &buffer));
+  }
+  ck_assert_uint_eq(40 - PB_DELIMITED_WRITER_BATCH,
+    pb_delimited_writer_pending(&writer));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_delimited_writer_flush(&writer));
+  ck_assert_uint_eq(0, pb_delimited_writer_pending(&writer));
+  close(fd[1]);
+
+  /* Create reader with a read-ahead buffer smaller than some messages */
+  pb_delimited_reader_t reader = pb_delimited_reader_create_from_fd(fd[0], 16);
+  fail_unless(pb_delimited_reader_valid(&reader));
+
+  /* Read messages */
+  pb_buffer_t message;
+  for (size_t m = 0; m < 40; m++) {
+    ck_assert_uint_eq(PB_ERROR_NONE,
+      pb_delimited_reader_next(&reader, &message));
+    ck_assert_uint_eq(m ? m * 5 : 1, pb_buffer_size(&message));
+    fail_if(memcmp(data, pb_buffer_data(&message), pb_buffer_size(&message)));
+  }
+  ck_assert_uint_eq(PB_ERROR_EOM,
+    pb_delimited_reader_next(&reader, &message));
+
+  /* Free all allocated memory */
+  pb_delimited_reader_destroy(&reader);
+  close(fd[0]);
+} END_TEST
+
+/*
+ * Read delimited messages from a truncated file descriptor.
+ */
+START_TEST(test_reader_fd_truncated) {
+  int fd[2];
+  fail_if(pipe(fd));
+
+  /* Write truncated message */
+  const uint8_t data[] = { 2, 1, 5, 3, 1 };
+  ck_assert_uint_eq(5, write(fd[1], data, 5));
+  close(fd[1]);
+
+  /* Create reader */
+  pb_delimited_reader_t reader = pb_delimited_reader_create_from_fd(fd[0], 4);
+  fail_unless(pb_delimited_reader_valid(&reader));
+
+  /* Read messages */
+  pb_buffer_t message;
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_delimited_reader_next(&reader, &message));
+  ck_assert_uint_eq(2, pb_buffer_size(&message));
+  ck_assert_uint_eq(PB_ERROR_OFFSET,
+    pb_delimited_reader_next(&reader, &message));
+
+  /* Free all allocated memory */
+  pb_delimited_reader_destroy(&reader);
+  close(fd[0]);
+} END_TEST
+
+/* ----------------------------------------------------------------------------
+ * Program
+ * ------------------------------------------------------------------------- */
+
+/*
+ * Create a test suite for all registered test cases and run it.
+ *
+ * Tests must be run sequentially (in no-fork mode) or code coverage
+ * cannot be determined properly.
+ */
+int
+main(void) {
+  void *suite = suite_create("protobluff/core/delimited"),
+       *tcase = NULL;
+
+  /* Add tests to test case "reader" */
+  tcase = tcase_create("reader");
+  tcase_add_test(tcase, test_reader);
+  tcase_add_test(tcase, test_reader_truncated);
+  tcase_add_test(tcase, test_reader_varint);
+  tcase_add_test(tcase, test_reader_invalid);
+  tcase_add_test(tcase, test_reader_fd_truncated);
+  suite_add_tcase(suite, tcase);
+
+  /* Add tests to test case "writer" */
+  tcase = tcase_create("writer");
+  tcase_add_test(tcase, test_writer);
+  suite_add_tcase(suite, tcase);
+
+  /* Create a test suite runner in no-fork mode */
+  void *runner = srunner_create(suite);
+  srunner_set_fork_status(runner, CK_NOFORK);
+
+  /* Execute test suite runner */
+  srunner_run_all(runner, CK_NORMAL);
+  int failed = srunner_ntests_failed(runner);
+  srunner_free(runner);
+
+  /* Exit with status code */
+  return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -21,8 +21,10 @@
  */
 
 #include <check.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include <protobluff/descriptor.h>
 
@@ -75,6 +77,40 @@ descriptor_scattered = { {
     {  8, "F08", STRING,  OPTIONAL }
   }, 2 } };
 
+/* Indexed descriptor */
+static pb_descriptor_t
+descriptor_indexed = { {
+  (const pb_field_descriptor_t []){
+    { 1000, "F1000", UINT32,  OPTIONAL },
+    { 1001, "F1001", UINT64,  OPTIONAL },
+    { 1004, "F1004", STRING,  OPTIONAL }
+  }, 3 }, NULL, {
+  (const uint16_t []){
+    1, 2, 0, 0, 3
+  }, 1000, 5 } };
+
+/* Tagged descriptor */
+static pb_descriptor_t
+descriptor_tagged = { {
+  (const pb_field_descriptor_t []){
+    {     3, "F3",     UINT32,  OPTIONAL },
+    {   700, "F700",   UINT64,  OPTIONAL },
+    {  9000, "F9000",  STRING,  OPTIONAL },
+    { 50000, "F50000", BYTES,   OPTIONAL }
+  }, 4 }, NULL, { NULL, 0, 0 }, { NULL, 0 }, { NULL, 0 }, {
+  (const pb_tag_t []){
+    3, 700, 9000, 50000
+  } } };
+
+/* Keyed descriptor */
+static pb_descriptor_t
+descriptor_keyed = { {
+  (const pb_field_descriptor_t []){
+    { 1000, "F1000", UINT32,  OPTIONAL, NULL, NULL, 0, { { 192, 62 }, 2 } },
+    { 1001, "F1001", UINT64,  OPTIONAL, NULL, NULL, 0, { { 200, 62 }, 2 } },
+    { 1004, "F1004", STRING,  OPTIONAL, NULL, NULL, 0, { { 226, 62 }, 2 } }
+  }, 3 } };
+
 /* Extension descriptor */
 static pb_descriptor_t
 descriptor_extension = { {
@@ -113,6 +149,29 @@ enum_descriptor_scattered = { {
     {  8, "V08" }
   }, 2 } };
 
+/* Indexed enum descriptor */
+static pb_enum_descriptor_t
+enum_descriptor_indexed = { {
+  (const pb_enum_value_descriptor_t []){
+    { -2, "V-2" },
+    {  0, "V00" },
+    {  1, "V01" }
+  }, 3 }, {
+  (const uint16_t []){
+    1, 0, 2, 3
+  }, -2, 4 } };
+
+/* Sparse enum descriptor with negative numbers */
+static pb_enum_descriptor_t
+enum_descriptor_sparse = { {
+  (const pb_enum_value_descriptor_t []){
+    { -9000, "V-9000" },
+    {    -1, "V-1" },
+    {   200, "V200" },
+    {   404, "V404" },
+    {   503, "V503" }
+  }, 5 } };
+
 /* ----------------------------------------------------------------------------
  * Fixtures
  * ------------------------------------------------------------------------- */
@@ -130,6 +189,40 @@ static void
 teardown() {
   pb_descriptor_reset(&descriptor);
   pb_descriptor_reset(&descriptor_extension);
+  pb_descriptor_reset(&descriptor_extension_nested);
+  pb_descriptor_reset(&descriptor_indexed);
+  pb_descriptor_reset(&descriptor_tagged);
+  pb_descriptor_reset(&descriptor_scattered);
+}
+
+/* ----------------------------------------------------------------------------
+ * Helper functions
+ * ------------------------------------------------------------------------- */
+
+/*
+ * Look up extension fields until all extensions are registered.
+ */
+static void *
+lookup(void *data) {
+  pb_descriptor_t *target = data;
+  const pb_field_descriptor_t *descriptor;
+  int seen = 0;
+  do {
+    descriptor = pb_descriptor_field_by_tag(target, 20);
+    if (descriptor)
+      ck_assert_ptr_eq(&(descriptor_extension.field.data[0]), descriptor);
+
+    /* Assert that registered extensions never vanish */
+    fail_if(seen && !descriptor);
+    seen = !!descriptor;
+
+    /* Assert field of last extension */
+    descriptor = pb_descriptor_field_by_tag(target, 30);
+    if (descriptor)
+      ck_assert_ptr_eq(
+        &(descriptor_extension_nested.field.data[0]), descriptor);
+  } while (!descriptor);
+  return NULL;
 }
 
 /* ----------------------------------------------------------------------------
@@ -283,6 +376,111 @@ START_TEST(test_field_by_tag_extended) {
     pb_descriptor_field_by_tag(&descriptor, 30));
 } END_TEST
 
+/*
+ * Retrieve the field descriptor for a given tag from merged extensions.
+ */
+START_TEST(test_field_by_tag_extended_merged) {
+  pb_descriptor_extend(&descriptor_scattered, &descriptor_extension_nested);
+  pb_descriptor_extend(&descriptor_scattered, &descriptor_extension);
+  ck_assert_uint_eq(3, descriptor_scattered.extensions.table->size);
+
+  /* Assert field descriptors */
+  ck_assert_ptr_eq(&(descriptor_scattered.field.data[1]),
+    pb_descriptor_field_by_tag(&descriptor_scattered, 8));
+  ck_assert_ptr_eq(&(descriptor_extension.field.data[0]),
+    pb_descriptor_field_by_tag(&descriptor_scattered, 20));
+  ck_assert_ptr_eq(&(descriptor_extension.field.data[1]),
+    pb_descriptor_field_by_tag(&descriptor_scattered, 21));
+  ck_assert_ptr_eq(&(descriptor_extension_nested.field.data[0]),
+    pb_descriptor_field_by_tag(&descriptor_scattered, 30));
+
+  /* Assert absent field descriptors */
+  ck_assert_ptr_eq(NULL,
+    pb_descriptor_field_by_tag(&descriptor_scattered, 19));
+  ck_assert_ptr_eq(NULL,
+    pb_descriptor_field_by_tag(&descriptor_scattered, 22));
+  ck_assert_ptr_eq(NULL,
+    pb_descriptor_field_by_tag(&descriptor_scattered, 31));
+} END_TEST
+
+/*
+ * Retrieve the field descriptor for a given tag from an indexed descriptor.
+ */
+START_TEST(test_field_by_tag_indexed) {
+  ck_assert_ptr_eq(&(descriptor_indexed.field.data[0]),
+    pb_descriptor_field_by_tag(&descriptor_indexed, 1000));
+  ck_assert_ptr_eq(&(descriptor_indexed.field.data[1]),
+    pb_descriptor_field_by_tag(&descriptor_indexed, 1001));
+  ck_assert_ptr_eq(&(descriptor_indexed.field.data[2]),
+    pb_descriptor_field_by_tag(&descriptor_indexed, 1004));
+} END_TEST
+
+/*
+ * Retrieve the field descriptor for an absent tag from an indexed descriptor.
+ */
+START_TEST(test_field_by_tag_indexed_absent) {
+  ck_assert_ptr_eq(NULL,
+    pb_descriptor_field_by_tag(&descriptor_indexed, 1));
+  ck_assert_ptr_eq(NULL,
+    pb_descriptor_field_by_tag(&descriptor_indexed, 999));
+  ck_assert_ptr_eq(NULL,
+    pb_descriptor_field_by_tag(&descriptor_indexed, 1002));
+  ck_assert_ptr_eq(NULL,
+    pb_descriptor_field_by_tag(&descriptor_indexed, 1005));
+} END_TEST
+
+/*
+ * Retrieve the field descriptor for a given tag from an extended indexed
+ * descriptor.
+ */
+START_TEST(test_field_by_tag_indexed_extended) {
+  ck_assert_ptr_eq(NULL,
+    pb_descriptor_field_by_tag(&descriptor_indexed, 20));
+
+  /* Extend descriptor and retrieve field */
+  pb_descriptor_extend(&descriptor_indexed, &descriptor_extension);
+  ck_assert_ptr_eq(&(descriptor_extension.field.data[0]),
+    pb_descriptor_field_by_tag(&descriptor_indexed, 20));
+  ck_assert_ptr_eq(&(descriptor_indexed.field.data[2]),
+    pb_descriptor_field_by_tag(&descriptor_indexed, 1004));
+} END_TEST
+
+/*
+ * Retrieve the field descriptor for a given tag from a tagged descriptor.
+ */
+START_TEST(test_field_by_tag_tagged) {
+  const pb_tag_t tags[] = { 3, 700, 9000, 50000 };
+  for (size_t f = 0; f < 4; f++)
+    ck_assert_ptr_eq(&(descriptor_tagged.field.data[f]),
+      pb_descriptor_field_by_tag(&descriptor_tagged, tags[f]));
+} END_TEST
+
+/*
+ * Retrieve the field descriptor for an absent tag from a tagged descriptor.
+ */
+START_TEST(test_field_by_tag_tagged_absent) {
+  ck_assert_ptr_eq(NULL,
+    pb_descriptor_field_by_tag(&descriptor_tagged, 1));
+  ck_assert_ptr_eq(NULL,
+    pb_descriptor_field_by_tag(&descriptor_tagged, 4));
+  ck_assert_ptr_eq(NULL,
+    pb_descriptor_field_by_tag(&descriptor_tagged, 8999));
+  ck_assert_ptr_eq(NULL,
+    pb_descriptor_field_by_tag(&descriptor_tagged, 50001));
+} END_TEST
+
+/*
+ * Retrieve the field descriptor for a given tag from an extended tagged
+ * descriptor.
+ */
+START_TEST(test_field_by_tag_tagged_extended) {
+  pb_descriptor_extend(&descriptor_tagged, &descriptor_extension);
+  ck_assert_ptr_eq(&(descriptor_extension.field.data[1]),
+    pb_descriptor_field_by_tag(&descriptor_tagged, 21));
+  ck_assert_ptr_eq(&(descriptor_tagged.field.data[2]),
+    pb_descriptor_field_by_tag(&descriptor_tagged, 9000));
+} END_TEST
+
 /*
  * Register an extension for the given descriptor.
  */
@@ -313,6 +511,66 @@ START_TEST(test_extend) {
     pb_descriptor_extension(&descriptor_extension_nested));
 } END_TEST
 
+/*
+ * Register extensions while other threads look up fields.
+ */
+START_TEST(test_extend_concurrent) {
+  pthread_t threads[4];
+  for (size_t t = 0; t < 4; t++)
+    ck_assert_int_eq(0,
+      pthread_create(&(threads[t]), NULL, lookup, &descriptor_scattered));
+
+  /* Extend descriptor */
+  pb_descriptor_extend(&descriptor_scattered, &descriptor_extension);
+  pb_descriptor_extend(&descriptor_scattered, &descriptor_extension_nested);
+
+  /* Wait for lookups */
+  for (size_t t = 0; t < 4; t++)
+    pthread_join(threads[t], NULL);
+  ck_assert_uint_eq(3, descriptor_scattered.extensions.table->size);
+} END_TEST
+
+/* ------------------------------------------------------------------------- */
+
+/*
+ * Retrieve the size of the encoded tag of a field descriptor.
+ */
+START_TEST(test_key_size) {
+  for (size_t f = 0; f < 3; f++) {
+    ck_assert_uint_eq(2,
+      pb_field_descriptor_key_size(&(descriptor_keyed.field.data[f])));
+    ck_assert_uint_eq(2,
+      pb_field_descriptor_key_size(&(descriptor_indexed.field.data[f])));
+  }
+  ck_assert_uint_eq(1,
+    pb_field_descriptor_key_size(&(descriptor.field.data[0])));
+} END_TEST
+
+/*
+ * Pack the encoded tag of a field descriptor with a given wiretype.
+ */
+START_TEST(test_key_pack) {
+  for (size_t f = 0; f < 3; f++) {
+    const pb_field_descriptor_t
+      *keyed   = &(descriptor_keyed.field.data[f]),
+      *indexed = &(descriptor_indexed.field.data[f]);
+
+    /* Assert precomputed and computed keys are equal */
+    uint8_t x[5], y[5];
+    for (pb_wiretype_t w = PB_WIRETYPE_VARINT; w <= PB_WIRETYPE_32BIT; w++) {
+      ck_assert_uint_eq(2, pb_field_descriptor_key_pack(x, keyed, w));
+      ck_assert_uint_eq(2, pb_field_descriptor_key_pack(y, indexed, w));
+      ck_assert(!memcmp(x, y, 2));
+      ck_assert_uint_eq(w, x[0] & 7);
+    }
+
+    /* Assert precomputed key for the field's wiretype */
+    pb_field_descriptor_key_pack(x, keyed,
+      pb_field_descriptor_wiretype(keyed));
+    ck_assert(!memcmp(x, keyed->key.data, 2));
+  }
+} END_TEST
+
 /* ------------------------------------------------------------------------- */
 
 /*
@@ -443,6 +701,58 @@ START_TEST(test_enum_value_by_number_scattered_absent) {
     pb_enum_descriptor_value_by_number(&enum_descriptor_scattered, 9));
 } END_TEST
 
+/*
+ * Retrieve the value for a given number from an indexed enum descriptor.
+ */
+START_TEST(test_enum_value_by_number_indexed) {
+  ck_assert_ptr_eq(&(enum_descriptor_indexed.value.data[0]),
+    pb_enum_descriptor_value_by_number(&enum_descriptor_indexed, -2));
+  ck_assert_ptr_eq(&(enum_descriptor_indexed.value.data[1]),
+    pb_enum_descriptor_value_by_number(&enum_descriptor_indexed, 0));
+  ck_assert_ptr_eq(&(enum_descriptor_indexed.value.data[2]),
+    pb_enum_descriptor_value_by_number(&enum_descriptor_indexed, 1));
+} END_TEST
+
+/*
+ * Retrieve the value for an absent number from an indexed enum descriptor.
+ */
+START_TEST(test_enum_value_by_number_indexed_absent) {
+  ck_assert_ptr_eq(NULL,
+    pb_enum_descriptor_value_by_number(&enum_descriptor_indexed, -3));
+  ck_assert_ptr_eq(NULL,
+    pb_enum_descriptor_value_by_number(&enum_descriptor_indexed, -1));
+  ck_assert_ptr_eq(NULL,
+    pb_enum_descriptor_value_by_number(&enum_descriptor_indexed, 2));
+  ck_assert_ptr_eq(NULL,
+    pb_enum_descriptor_value_by_number(&enum_descriptor_indexed, INT32_MAX));
+  ck_assert_ptr_eq(NULL,
+    pb_enum_descriptor_value_by_number(&enum_descriptor_indexed, INT32_MIN));
+} END_TEST
+
+/*
+ * Retrieve the value for a given number from a sparse enum descriptor.
+ */
+START_TEST(test_enum_value_by_number_sparse) {
+  const pb_enum_t numbers[] = { -9000, -1, 200, 404, 503 };
+  for (size_t v = 0; v < 5; v++)
+    ck_assert_ptr_eq(&(enum_descriptor_sparse.value.data[v]),
+      pb_enum_descriptor_value_by_number(&enum_descriptor_sparse, numbers[v]));
+} END_TEST
+
+/*
+ * Retrieve the value for an absent number from a sparse enum descriptor.
+ */
+START_TEST(test_enum_value_by_number_sparse_absent) {
+  ck_assert_ptr_eq(NULL,
+    pb_enum_descriptor_value_by_number(&enum_descriptor_sparse, -9001));
+  ck_assert_ptr_eq(NULL,
+    pb_enum_descriptor_value_by_number(&enum_descriptor_sparse, 0));
+  ck_assert_ptr_eq(NULL,
+    pb_enum_descriptor_value_by_number(&enum_descriptor_sparse, 201));
+  ck_assert_ptr_eq(NULL,
+    pb_enum_descriptor_value_by_number(&enum_descriptor_sparse, 504));
+} END_TEST
+
 /*
  * Create a const-iterator over a oneof descriptor.
  */
@@ -532,12 +842,26 @@ main(void) {
   tcase_add_test(tcase, test_field_by_tag_scattered);
   tcase_add_test(tcase, test_field_by_tag_scattered_absent);
   tcase_add_test(tcase, test_field_by_tag_extended);
+  tcase_add_test(tcase, test_field_by_tag_extended_merged);
+  tcase_add_test(tcase, test_field_by_tag_indexed);
+  tcase_add_test(tcase, test_field_by_tag_indexed_absent);
+  tcase_add_test(tcase, test_field_by_tag_indexed_extended);
+  tcase_add_test(tcase, test_field_by_tag_tagged);
+  tcase_add_test(tcase, test_field_by_tag_tagged_absent);
+  tcase_add_test(tcase, test_field_by_tag_tagged_extended);
   suite_add_tcase(suite, tcase);
 
   /* Add tests to test case "extend" */
   tcase = tcase_create("extend");
   tcase_add_checked_fixture(tcase, setup, teardown);
   tcase_add_test(tcase, test_extend);
+  tcase_add_test(tcase, test_extend_concurrent);
+  suite_add_tcase(suite, tcase);
+
+  /* Add tests to test case "key" */
+  tcase = tcase_create("key");
+  tcase_add_test(tcase, test_key_size);
+  tcase_add_test(tcase, test_key_pack);
   suite_add_tcase(suite, tcase);
 
   /* Add tests to test case "enum_iterator" */
@@ -553,6 +877,10 @@ main(void) {
   tcase_add_test(tcase, test_enum_value_by_number_empty);
   tcase_add_test(tcase, test_enum_value_by_number_scattered);
   tcase_add_test(tcase, test_enum_value_by_number_scattered_absent);
+  tcase_add_test(tcase, test_enum_value_by_number_indexed);
+  tcase_add_test(tcase, test_enum_value_by_number_indexed_absent);
+  tcase_add_test(tcase, test_enum_value_by_number_sparse);
+  tcase_add_test(tcase, test_enum_value_by_number_sparse_absent);
   suite_add_tcase(suite, tcase);
 
   /* Add tests to test case "oneof_iterator" */
@@ -22,6 +22,7 @@
 
 #include <assert.h>
 #include <check.h>
+#include <stddef.h>
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
@@ -33,6 +34,7 @@
 #include "core/common.h"
 #include "core/descriptor.h"
 #include "core/encoder.h"
+#include "core/layout.h"
 
 /* ----------------------------------------------------------------------------
  * System-default allocator callback overrides
@@ -65,6 +67,42 @@ allocator_resize_fail(void *data, void *block, size_t size) {
   return NULL;
 }
 
+/* ----------------------------------------------------------------------------
+ * Sink callbacks
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Sink appending to a buffer.
+ *
+ * \param[in,out] context Buffer
+ * \param[in]     data[]  Raw data
+ * \param[in]     size    Raw data size
+ * \return                Error code
+ */
+static pb_error_t
+sink_append(void *context, const uint8_t data[], size_t size) {
+  assert(context && data && size);
+  uint8_t *target = pb_buffer_grow(context, size);
+  if (!target)
+    return PB_ERROR_ALLOC;
+  memcpy(target, data, size);
+  return PB_ERROR_NONE;
+}
+
+/*!
+ * Sink with failing writes.
+ *
+ * \param[in,out] context Context
+ * \param[in]     data[]  Raw data
+ * \param[in]     size    Raw data size
+ * \return                Error code
+ */
+static pb_error_t
+sink_fail(void *context, const uint8_t data[], size_t size) {
+  assert(!context && data && size);
+  return PB_ERROR_INVALID;
+}
+
 /* ----------------------------------------------------------------------------
  * Descriptors
  * ------------------------------------------------------------------------- */
@@ -106,6 +144,57 @@ descriptor_packed = { {
     {  4, "F04", DOUBLE,  REPEATED, NULL, NULL, PACKED }
   }, 4 } };
 
+/* Descriptor with padded fields */
+static pb_descriptor_t
+descriptor_padded = { {
+  (const pb_field_descriptor_t []){
+    {  1, "F01", UINT32,  OPTIONAL, NULL, NULL, PADDED },
+    {  2, "F02", UINT64,  REPEATED, NULL, NULL, PACKED | PADDED }
+  }, 2 } };
+
+/* ----------------------------------------------------------------------------
+ * Layouts
+ * ------------------------------------------------------------------------- */
+
+/* Struct */
+typedef struct value_t {
+  uint32_t f01;                        /*!< F01 */
+  uint64_t f02;                        /*!< F02 */
+  int32_t f03;                         /*!< F03 */
+  int64_t f04;                         /*!< F04 */
+  uint8_t f05;                         /*!< F05 */
+  float f06;                           /*!< F06 */
+  double f07;                          /*!< F07 */
+  pb_string_t f08;                     /*!< F08 */
+  pb_string_t f09;                     /*!< F09 */
+  pb_enum_t f10;                       /*!< F10 */
+  struct value_t *f11;                 /*!< F11 */
+  pb_repeated_t f12;                   /*!< F12 */
+  uint8_t has[2];                      /*!< Presence bits */
+} value_t;
+
+/* Layout (forward declaration) */
+static const pb_layout_t
+layout;
+
+/* Layout */
+static const pb_layout_t
+layout = { &descriptor, {
+  (const pb_layout_field_t []){
+    { offsetof(value_t, f01) },
+    { offsetof(value_t, f02) },
+    { offsetof(value_t, f03) },
+    { offsetof(value_t, f04) },
+    { offsetof(value_t, f05) },
+    { offsetof(value_t, f06) },
+    { offsetof(value_t, f07) },
+    { offsetof(value_t, f08) },
+    { offsetof(value_t, f09) },
+    { offsetof(value_t, f10) },
+    { offsetof(value_t, f11), &layout },
+    { offsetof(value_t, f12), &layout }
+  }, 12 }, offsetof(value_t, has), sizeof(value_t) };
+
 /* ----------------------------------------------------------------------------
  * Tests
  * ------------------------------------------------------------------------- */
@@ -373,6 +462,33 @@ START_TEST(test_encode_varint_packed_merged) {
   pb_encoder_destroy(&encoder);
 } END_TEST
 
+/*
+ * Encode variable-sized integers padded to their maximum size.
+ */
+START_TEST(test_encode_varint_padded) {
+  pb_encoder_t encoder = pb_encoder_create(&descriptor_padded);
+  const pb_buffer_t *buffer = pb_encoder_buffer(&encoder);
+
+  /* Encode values */
+  uint32_t value    = 1;
+  uint64_t values[] = { 10, 100, 1000 };
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_encoder_encode(&encoder, 1, &value, 1));
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_encoder_encode(&encoder, 2, values, 3));
+
+  /* Assert buffer validity and error */
+  fail_unless(pb_buffer_valid(buffer));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_buffer_error(buffer));
+
+  /* Assert buffer size */
+  fail_if(pb_buffer_empty(buffer));
+  ck_assert_uint_eq(6 + 32, pb_buffer_size(buffer));
+
+  /* Free all allocated memory */
+  pb_encoder_destroy(&encoder);
+} END_TEST
+
 /*
  * Encode a variable-sized integer with an invalid encoder.
  */
@@ -805,53 +921,1073 @@ START_TEST(test_encode_32bit_invalid_resize) {
   pb_encoder_destroy(&encoder);
 } END_TEST
 
-/* ----------------------------------------------------------------------------
- * Program
- * ------------------------------------------------------------------------- */
+/*
+ * Retrieve the encoded size of values.
+ */
+START_TEST(test_size) {
+  pb_encoder_t encoder1 = pb_encoder_create(&descriptor);
+  pb_encoder_t encoder2 = pb_encoder_create(&descriptor_packed);
+
+  /* Retrieve the encoded size of a value and a string */
+  uint32_t value1 = 1000000000;
+  pb_string_t value2 = pb_string_init_from_chars("SOME DATA");
+  ck_assert_uint_eq(6, pb_encoder_size(&encoder1, 1, &value1, 1));
+  ck_assert_uint_eq(11, pb_encoder_size(&encoder1, 8, &value2, 1));
+
+  /* Retrieve the encoded size of values in packed encoding */
+  uint64_t values[] = { 10, 100, 1000, 10000, 100000, 1000000 };
+  ck_assert_uint_eq(14, pb_encoder_size(&encoder2, 1, values, 6));
+
+  /* Assert encoded size against buffer size */
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_encoder_encode(&encoder2, 1, values, 6));
+  ck_assert_uint_eq(14, pb_buffer_size(pb_encoder_buffer(&encoder2)));
+
+  /* Free all allocated memory */
+  pb_encoder_destroy(&encoder2);
+  pb_encoder_destroy(&encoder1);
+} END_TEST
 
 /*
- * Create a test suite for all registered test cases and run it.
- *
- * Tests must be run sequentially (in no-fork mode) or code coverage
- * cannot be determined properly.
+ * Retrieve the encoded size of a message.
  */
-int
-main(void) {
-  void *suite = suite_create("protobluff/core/encoder"),
-       *tcase = NULL;
+START_TEST(test_size_message) {
+  pb_encoder_t encoder1 = pb_encoder_create(&descriptor);
+  pb_encoder_t encoder2 = pb_encoder_create(&descriptor);
 
-  /* Add tests to test case "create" */
-  tcase = tcase_create("create");
-  tcase_add_test(tcase, test_create);
-  tcase_add_test(tcase, test_create_invalid);
-  tcase_add_test(tcase, test_create_invalid_allocate);
-  suite_add_tcase(suite, tcase);
+  /* Retrieve the encoded size of an empty message */
+  ck_assert_uint_eq(2, pb_encoder_size(&encoder1, 11, &encoder2, 1));
 
-  /* Add tests to test case "encode" */
-  tcase = tcase_create("encode");
-  tcase_add_test(tcase, test_encode);
-  tcase_add_test(tcase, test_encode_packed);
-  tcase_add_test(tcase, test_encode_packed_invalid);
-  tcase_add_test(tcase, test_encode_packed_invalid_resize);
-  tcase_add_test(tcase, test_encode_varint);
-  tcase_add_test(tcase, test_encode_varint_packed);
-  tcase_add_test(tcase, test_encode_varint_packed_merged);
-  tcase_add_test(tcase, test_encode_varint_invalid);
-  tcase_add_test(tcase, test_encode_varint_invalid_resize);
-  tcase_add_test(tcase, test_encode_64bit);
-  tcase_add_test(tcase, test_encode_64bit_packed);
-  tcase_add_test(tcase, test_encode_64bit_packed_merged);
-  tcase_add_test(tcase, test_encode_64bit_invalid);
-  tcase_add_test(tcase, test_encode_64bit_invalid_resize);
-  tcase_add_test(tcase, test_encode_length);
-  tcase_add_test(tcase, test_encode_length_message);
-  tcase_add_test(tcase, test_encode_length_invalid);
-  tcase_add_test(tcase, test_encode_length_invalid_resize);
-  tcase_add_test(tcase, test_encode_32bit);
-  tcase_add_test(tcase, test_encode_32bit_packed);
-  tcase_add_test(tcase, test_encode_32bit_packed_merged);
-  tcase_add_test(tcase, test_encode_32bit_invalid);
-  tcase_add_test(tcase, test_encode_32bit_invalid_resize);
+  /* Retrieve the encoded size of a message */
+  double value = 0.00000001;
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_encoder_encode(&encoder2, 7, &value, 1));
+  ck_assert_uint_eq(11, pb_encoder_size(&encoder1, 11, &encoder2, 1));
+
+  /* Free all allocated memory */
+  pb_encoder_destroy(&encoder2);
+  pb_encoder_destroy(&encoder1);
+} END_TEST
+
+/*
+ * Encode a set of fields at once.
+ */
+START_TEST(test_encode_fields) {
+  pb_encoder_t encoder1 = pb_encoder_create(&descriptor);
+  pb_encoder_t encoder2 = pb_encoder_create(&descriptor);
+  const pb_buffer_t *buffer1 = pb_encoder_buffer(&encoder1),
+                    *buffer2 = pb_encoder_buffer(&encoder2);
+
+  /* Encode fields at once */
+  uint32_t value1 = 1000000000;
+  pb_string_t value2 = pb_string_init_from_chars("SOME DATA");
+  pb_enum_t value3 = 2;
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_encoder_encode_fields(&encoder1, (const pb_encoder_field_t []){
+      {  1, &value1, 1 },
+      {  8, &value2, 1 },
+      { 10, &value3, 1 }
+    }, 3));
+
+  /* Encode the same fields one-by-one */
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_encoder_encode(&encoder2, 1, &value1, 1));
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_encoder_encode(&encoder2, 8, &value2, 1));
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_encoder_encode(&encoder2, 10, &value3, 1));
+
+  /* Assert buffer size and contents */
+  ck_assert_uint_eq(19, pb_buffer_size(buffer1));
+  ck_assert_uint_eq(pb_buffer_size(buffer2), pb_buffer_size(buffer1));
+  fail_if(memcmp(pb_buffer_data(buffer1), pb_buffer_data(buffer2),
+    pb_buffer_size(buffer1)));
+
+  /* Free all allocated memory */
+  pb_encoder_destroy(&encoder2);
+  pb_encoder_destroy(&encoder1);
+} END_TEST
+
+/*
+ * Append already encoded fields verbatim.
+ */
+START_TEST(test_encode_raw) {
+  pb_encoder_t encoder = pb_encoder_create(&descriptor);
+  const pb_buffer_t *buffer = pb_encoder_buffer(&encoder);
+
+  /* Encode a value and append raw fields */
+  uint32_t value = 1;
+  uint8_t  data[] = { 120, 2, 128, 1, 5 };
+  pb_string_t raw = pb_string_init(data, 5);
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_encoder_encode(&encoder, 1, &value, 1));
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_encoder_encode_raw(&encoder, &raw));
+
+  /* Assert buffer size and contents */
+  const uint8_t check[] = { 8, 1, 120, 2, 128, 1, 5 };
+  ck_assert_uint_eq(7, pb_buffer_size(buffer));
+  fail_if(memcmp(check, pb_buffer_data(buffer), 7));
+
+  /* Free all allocated memory */
+  pb_encoder_destroy(&encoder);
+} END_TEST
+
+/*
+ * Append already encoded fields with an invalid encoder.
+ */
+START_TEST(test_encode_raw_invalid) {
+  pb_encoder_t encoder = pb_encoder_create_invalid();
+  const pb_buffer_t *buffer = pb_encoder_buffer(&encoder);
+
+  /* Append raw fields */
+  uint8_t data[] = { 120, 2 };
+  pb_string_t raw = pb_string_init(data, 2);
+  ck_assert_uint_eq(PB_ERROR_INVALID,
+    pb_encoder_encode_raw(&encoder, &raw));
+
+  /* Assert buffer size */
+  fail_unless(pb_buffer_empty(buffer));
+
+  /* Free all allocated memory */
+  pb_encoder_destroy(&encoder);
+} END_TEST
+
+/*
+ * Encode a set of fields at once with an invalid encoder.
+ */
+START_TEST(test_encode_fields_invalid) {
+  pb_encoder_t encoder = pb_encoder_create_invalid();
+  const pb_buffer_t *buffer = pb_encoder_buffer(&encoder);
+
+  /* Encode fields at once */
+  uint64_t values[] = { 10, 100, 1000 };
+  ck_assert_uint_eq(PB_ERROR_INVALID,
+    pb_encoder_encode_fields(&encoder, (const pb_encoder_field_t []){
+      { 1, values, 3 }
+    }, 1));
+
+  /* Assert buffer size */
+  fail_unless(pb_buffer_empty(buffer));
+  ck_assert_uint_eq(0, pb_buffer_size(buffer));
+
+  /* Free all allocated memory */
+  pb_encoder_destroy(&encoder);
+} END_TEST
+
+/*
+ * Encode a set of fields at once with an encoder for which reallocation fails.
+ */
+START_TEST(test_encode_fields_invalid_resize) {
+  pb_allocator_t allocator = {
+    .proc = {
+      .allocate = allocator_default.proc.allocate,
+      .resize   = allocator_resize_fail,
+      .free     = allocator_default.proc.free
+    }
+  };
+
+  /* Create encoder */
+  pb_encoder_t encoder =
+    pb_encoder_create_with_allocator(&allocator, &descriptor_packed);
+  const pb_buffer_t *buffer = pb_encoder_buffer(&encoder);
+
+  /* Encode fields at once */
+  uint64_t values1[] = { 10, 100, 1000 };
+  float    values2[] = { 0.1f, 0.2f };
+  ck_assert_uint_eq(PB_ERROR_ALLOC,
+    pb_encoder_encode_fields(&encoder, (const pb_encoder_field_t []){
+      { 1, values1, 3 },
+      { 3, values2, 2 }
+    }, 2));
+
+  /* Assert buffer validity and error */
+  fail_unless(pb_buffer_valid(buffer));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_buffer_error(buffer));
+
+  /* Assert buffer size */
+  fail_unless(pb_buffer_empty(buffer));
+  ck_assert_uint_eq(0, pb_buffer_size(buffer));
+
+  /* Free all allocated memory */
+  pb_encoder_destroy(&encoder);
+} END_TEST
+
+/*
+ * Encode nested messages in place.
+ */
+START_TEST(test_encode_nested) {
+  pb_encoder_t encoder1 = pb_encoder_create(&descriptor);
+  pb_encoder_t encoder2 = pb_encoder_create(&descriptor);
+  pb_encoder_t encoder3 = pb_encoder_create(&descriptor);
+  pb_encoder_t encoder4 = pb_encoder_create(&descriptor);
+  const pb_buffer_t *buffer1 = pb_encoder_buffer(&encoder1),
+                    *buffer2 = pb_encoder_buffer(&encoder2);
+
+  /* Encode nested messages in place */
+  uint32_t    value1 = 1000000000;
+  pb_string_t value2 = pb_string_init_from_chars("SOME DATA");
+  pb_encoder_frame_t frame[2];
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_encoder_begin_nested(&encoder1, 11, &(frame[0])));
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_encoder_encode(&encoder1, 1, &value1, 1));
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_encoder_begin_nested(&encoder1, 12, &(frame[1])));
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_encoder_encode(&encoder1, 8, &value2, 1));
+  pb_encoder_end_nested(&encoder1);
+  pb_encoder_end_nested(&encoder1);
+  ck_assert_ptr_eq(&descriptor, pb_encoder_descriptor(&encoder1));
+  ck_assert_ptr_eq(NULL, encoder1.frame);
+
+  /* Encode the same messages with separate encoders */
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_encoder_encode(&encoder4, 8, &value2, 1));
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_encoder_encode(&encoder3, 1, &value1, 1));
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_encoder_encode(&encoder3, 12, &encoder4, 1));
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_encoder_encode(&encoder2, 11, &encoder3, 1));
+
+  /* Assert buffer size and contents */
+  ck_assert_uint_eq(21, pb_buffer_size(buffer1));
+  ck_assert_uint_eq(pb_buffer_size(buffer2), pb_buffer_size(buffer1));
+  fail_if(memcmp(pb_buffer_data(buffer1), pb_buffer_data(buffer2),
+    pb_buffer_size(buffer1)));
+
+  /* Free all allocated memory */
+  pb_encoder_destroy(&encoder4);
+  pb_encoder_destroy(&encoder3);
+  pb_encoder_destroy(&encoder2);
+  pb_encoder_destroy(&encoder1);
+} END_TEST
+
+/*
+ * Encode a nested message in place with a multi-byte length prefix.
+ */
+START_TEST(test_encode_nested_length) {
+  pb_encoder_t encoder1 = pb_encoder_create(&descriptor);
+  pb_encoder_t encoder2 = pb_encoder_create(&descriptor);
+  pb_encoder_t encoder3 = pb_encoder_create(&descriptor);
+  const pb_buffer_t *buffer1 = pb_encoder_buffer(&encoder1),
+                    *buffer2 = pb_encoder_buffer(&encoder2);
+
+  /* Encode nested message in place */
+  uint8_t data[200];
+  memset(data, 'A', sizeof(data));
+  pb_string_t value = pb_string_init(data, sizeof(data));
+  pb_encoder_frame_t frame;
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_encoder_begin_nested(&encoder1, 11, &frame));
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_encoder_encode(&encoder1, 9, &value, 1));
+  pb_encoder_end_nested(&encoder1);
+
+  /* Encode the same message with a separate encoder */
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_encoder_encode(&encoder3, 9, &value, 1));
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_encoder_encode(&encoder2, 11, &encoder3, 1));
+
+  /* Assert buffer size and contents */
+  ck_assert_uint_eq(206, pb_buffer_size(buffer1));
+  ck_assert_uint_eq(pb_buffer_size(buffer2), pb_buffer_size(buffer1));
+  fail_if(memcmp(pb_buffer_data(buffer1), pb_buffer_data(buffer2),
+    pb_buffer_size(buffer1)));
+
+  /* Free all allocated memory */
+  pb_encoder_destroy(&encoder3);
+  pb_encoder_destroy(&encoder2);
+  pb_encoder_destroy(&encoder1);
+} END_TEST
+
+/*
+ * Encode a nested message in place referencing large strings and bytes.
+ */
+START_TEST(test_encode_nested_scattered) {
+  pb_encoder_t encoder = pb_encoder_create(&descriptor);
+  pb_encoder_scatter(&encoder, 8);
+
+  /* Encode nested message in place */
+  pb_string_t value = pb_string_init_from_chars("SOME DATA");
+  pb_encoder_frame_t frame;
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_encoder_begin_nested(&encoder, 11, &frame));
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_encoder_encode(&encoder, 8, &value, 1));
+  pb_encoder_end_nested(&encoder);
+
+  /* Assert I/O vectors */
+  struct iovec iov[2];
+  ck_assert_uint_eq(2, pb_encoder_iovec(&encoder, iov, 2));
+  ck_assert_uint_eq(4, iov[0].iov_len);
+  fail_if(memcmp(iov[0].iov_base, "\x5A\x0B\x42\x09", 4));
+  ck_assert_ptr_eq(pb_string_data(&value), iov[1].iov_base);
+  ck_assert_uint_eq(13, pb_encoder_length(&encoder));
+
+  /* Free all allocated memory */
+  pb_encoder_destroy(&encoder);
+} END_TEST
+
+/*
+ * Begin a nested message with an invalid encoder.
+ */
+START_TEST(test_encode_nested_invalid) {
+  pb_encoder_t encoder = pb_encoder_create_invalid();
+  pb_encoder_frame_t frame;
+
+  /* Begin nested message */
+  ck_assert_uint_eq(PB_ERROR_INVALID,
+    pb_encoder_begin_nested(&encoder, 11, &frame));
+  ck_assert_ptr_eq(NULL, encoder.frame);
+
+  /* Free all allocated memory */
+  pb_encoder_destroy(&encoder);
+} END_TEST
+
+/*
+ * Begin a nested message with an encoder for which reallocation fails.
+ */
+START_TEST(test_encode_nested_invalid_resize) {
+  pb_allocator_t allocator = {
+    .proc = {
+      .allocate = allocator_default.proc.allocate,
+      .resize   = allocator_resize_fail,
+      .free     = allocator_default.proc.free
+    }
+  };
+
+  /* Create encoder */
+  pb_encoder_t encoder =
+    pb_encoder_create_with_allocator(&allocator, &descriptor);
+  pb_encoder_frame_t frame;
+
+  /* Begin nested message */
+  ck_assert_uint_eq(PB_ERROR_ALLOC,
+    pb_encoder_begin_nested(&encoder, 11, &frame));
+  ck_assert_ptr_eq(&descriptor, pb_encoder_descriptor(&encoder));
+  ck_assert_ptr_eq(NULL, encoder.frame);
+
+  /* Free all allocated memory */
+  pb_encoder_destroy(&encoder);
+} END_TEST
+
+/*
+ * Reset an encoder and reuse its buffer.
+ */
+START_TEST(test_reset) {
+  pb_encoder_t encoder = pb_encoder_create(&descriptor);
+  const pb_buffer_t *buffer = pb_encoder_buffer(&encoder);
+
+  /* Encode a value */
+  pb_string_t value = pb_string_init_from_chars("SOME DATA");
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_encoder_encode(&encoder, 8, &value, 1));
+  const uint8_t *data = pb_buffer_data(buffer);
+  size_t capacity = pb_buffer_capacity(buffer);
+
+  /* Reset encoder */
+  pb_encoder_reset(&encoder);
+  fail_unless(pb_buffer_empty(buffer));
+  ck_assert_uint_eq(capacity, pb_buffer_capacity(buffer));
+
+  /* Encode the value again */
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_encoder_encode(&encoder, 8, &value, 1));
+  ck_assert_uint_eq(11, pb_buffer_size(buffer));
+  ck_assert_ptr_eq(data, pb_buffer_data(buffer));
+
+  /* Free all allocated memory */
+  pb_encoder_destroy(&encoder);
+} END_TEST
+
+/*
+ * Reset an encoder referencing large strings and bytes.
+ */
+START_TEST(test_reset_scattered) {
+  pb_encoder_t encoder = pb_encoder_create(&descriptor);
+  pb_encoder_scatter(&encoder, 8);
+
+  /* Encode a value, reset encoder and encode it again */
+  pb_string_t value = pb_string_init_from_chars("SOME DATA");
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_encoder_encode(&encoder, 8, &value, 1));
+  pb_encoder_reset(&encoder);
+  ck_assert_uint_eq(0, pb_encoder_length(&encoder));
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_encoder_encode(&encoder, 8, &value, 1));
+
+  /* Assert buffer size and I/O vectors */
+  ck_assert_uint_eq(11, pb_encoder_length(&encoder));
+  ck_assert_uint_eq(2, pb_encoder_iovec(&encoder, NULL, 0));
+
+  /* Free all allocated memory */
+  pb_encoder_destroy(&encoder);
+} END_TEST
+
+/*
+ * Reset an invalid encoder.
+ */
+START_TEST(test_reset_invalid) {
+  pb_encoder_t encoder = pb_encoder_create_invalid();
+
+  /* Reset encoder */
+  pb_encoder_reset(&encoder);
+  fail_if(pb_encoder_valid(&encoder));
+
+  /* Free all allocated memory */
+  pb_encoder_destroy(&encoder);
+} END_TEST
+
+/*
+ * Trim an encoder.
+ */
+START_TEST(test_trim) {
+  pb_encoder_t encoder = pb_encoder_create(&descriptor);
+  const pb_buffer_t *buffer = pb_encoder_buffer(&encoder);
+  pb_encoder_scatter(&encoder, 8);
+
+  /* Encode values */
+  pb_string_t value = pb_string_init_from_chars("SOME DATA");
+  for (size_t v = 0; v < 3; v++)
+    ck_assert_uint_eq(PB_ERROR_NONE,
+      pb_encoder_encode(&encoder, 8, &value, 1));
+  ck_assert_uint_eq(33, pb_encoder_length(&encoder));
+
+  /* Trim encoder */
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_encoder_trim(&encoder));
+  ck_assert_uint_eq(pb_buffer_size(buffer), pb_buffer_capacity(buffer));
+  ck_assert_uint_eq(3, encoder.segment.capacity);
+  ck_assert_uint_eq(33, pb_encoder_length(&encoder));
+  ck_assert_uint_eq(6, pb_encoder_iovec(&encoder, NULL, 0));
+
+  /* Reset and trim encoder, releasing all memory */
+  pb_encoder_reset(&encoder);
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_encoder_trim(&encoder));
+  ck_assert_uint_eq(0, pb_buffer_capacity(buffer));
+  ck_assert_uint_eq(0, encoder.segment.capacity);
+
+  /* Encode the value again */
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_encoder_encode(&encoder, 8, &value, 1));
+  ck_assert_uint_eq(11, pb_encoder_length(&encoder));
+
+  /* Free all allocated memory */
+  pb_encoder_destroy(&encoder);
+} END_TEST
+
+/*
+ * Trim an invalid encoder.
+ */
+START_TEST(test_trim_invalid) {
+  pb_encoder_t encoder = pb_encoder_create_invalid();
+
+  /* Trim encoder */
+  ck_assert_uint_eq(PB_ERROR_INVALID, pb_encoder_trim(&encoder));
+
+  /* Free all allocated memory */
+  pb_encoder_destroy(&encoder);
+} END_TEST
+
+/*
+ * Encode values into caller-provided memory.
+ */
+START_TEST(test_encode_fixed) {
+  uint8_t data[16];
+  pb_encoder_t encoder = pb_encoder_create_fixed(&descriptor, data, 16);
+  const pb_buffer_t *buffer = pb_encoder_buffer(&encoder);
+
+  /* Encode a value */
+  uint32_t value1 = 1000000000;
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_encoder_encode(&encoder, 1, &value1, 1));
+  ck_assert_ptr_eq(data, pb_buffer_data(buffer));
+  ck_assert_uint_eq(10, pb_encoder_available(&encoder));
+
+  /* Encode a value exceeding the capacity */
+  pb_string_t value2 = pb_string_init_from_chars("SOME DATA");
+  ck_assert_uint_eq(11, pb_encoder_size(&encoder, 8, &value2, 1));
+  ck_assert_uint_eq(PB_ERROR_ALLOC,
+    pb_encoder_encode(&encoder, 8, &value2, 1));
+
+  /* Assert buffer validity and size */
+  fail_unless(pb_buffer_valid(buffer));
+  ck_assert_uint_eq(6, pb_buffer_size(buffer));
+
+  /* Free all allocated memory */
+  pb_encoder_destroy(&encoder);
+} END_TEST
+
+/*
+ * Stream values to a sink.
+ */
+START_TEST(test_stream) {
+  pb_encoder_t encoder1 = pb_encoder_create(&descriptor);
+  pb_encoder_t encoder2 = pb_encoder_create(&descriptor);
+  pb_buffer_t  buffer   = pb_buffer_create_empty();
+  pb_encoder_stream(&encoder1, sink_append, &buffer, 16);
+
+  /* Encode values, which are flushed upon reaching the threshold */
+  for (uint64_t value = 0; value < 100; value++) {
+    ck_assert_uint_eq(PB_ERROR_NONE,
+      pb_encoder_encode(&encoder1, 2, &value, 1));
+    ck_assert_uint_eq(PB_ERROR_NONE,
+      pb_encoder_encode(&encoder2, 2, &value, 1));
+    fail_unless(pb_encoder_length(&encoder1) <= 18);
+  }
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_encoder_flush(&encoder1));
+  ck_assert_uint_eq(0, pb_encoder_length(&encoder1));
+
+  /* Assert buffer size and contents */
+  const pb_buffer_t *buffer2 = pb_encoder_buffer(&encoder2);
+  ck_assert_uint_eq(200, pb_buffer_size(&buffer));
+  ck_assert_uint_eq(pb_buffer_size(buffer2), pb_buffer_size(&buffer));
+  fail_if(memcmp(pb_buffer_data(buffer2), pb_buffer_data(&buffer),
+    pb_buffer_size(&buffer)));
+
+  /* Free all allocated memory */
+  pb_buffer_destroy(&buffer);
+  pb_encoder_destroy(&encoder2);
+  pb_encoder_destroy(&encoder1);
+} END_TEST
+
+/*
+ * Stream a nested message encoded in place to a sink.
+ */
+START_TEST(test_stream_nested) {
+  pb_encoder_t encoder1 = pb_encoder_create(&descriptor);
+  pb_encoder_t encoder2 = pb_encoder_create(&descriptor);
+  pb_buffer_t  buffer   = pb_buffer_create_empty();
+  pb_encoder_stream(&encoder1, sink_append, &buffer, 16);
+
+  /* Encode nested message, which is retained until it is ended */
+  pb_string_t value = pb_string_init_from_chars("SOME DATA");
+  pb_encoder_frame_t frame1, frame2;
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_encoder_begin_nested(&encoder1, 11, &frame1));
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_encoder_begin_nested(&encoder2, 11, &frame2));
+  for (size_t v = 0; v < 10; v++) {
+    ck_assert_uint_eq(PB_ERROR_NONE,
+      pb_encoder_encode(&encoder1, 8, &value, 1));
+    ck_assert_uint_eq(PB_ERROR_NONE,
+      pb_encoder_encode(&encoder2, 8, &value, 1));
+  }
+  pb_encoder_end_nested(&encoder1);
+  pb_encoder_end_nested(&encoder2);
+  ck_assert_uint_eq(0, pb_buffer_size(&buffer));
+
+  /* Encode value, which flushes the nested message */
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_encoder_encode(&encoder1, 8, &value, 1));
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_encoder_encode(&encoder2, 8, &value, 1));
+  ck_assert_uint_eq(112, pb_buffer_size(&buffer));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_encoder_flush(&encoder1));
+
+  /* Assert buffer size and contents */
+  const pb_buffer_t *buffer2 = pb_encoder_buffer(&encoder2);
+  ck_assert_uint_eq(pb_buffer_size(buffer2), pb_buffer_size(&buffer));
+  fail_if(memcmp(pb_buffer_data(buffer2), pb_buffer_data(&buffer),
+    pb_buffer_size(&buffer)));
+
+  /* Free all allocated memory */
+  pb_buffer_destroy(&buffer);
+  pb_encoder_destroy(&encoder2);
+  pb_encoder_destroy(&encoder1);
+} END_TEST
+
+/*
+ * Stream a nested message of known length to a sink.
+ */
+START_TEST(test_stream_nested_sized) {
+  pb_encoder_t encoder1 = pb_encoder_create(&descriptor);
+  pb_encoder_t encoder2 = pb_encoder_create(&descriptor);
+  pb_buffer_t  buffer   = pb_buffer_create_empty();
+  pb_encoder_stream(&encoder1, sink_append, &buffer, 16);
+
+  /* Calculate length of nested messages upfront */
+  pb_string_t value = pb_string_init_from_chars("SOME DATA");
+  size_t length = 10 * pb_encoder_size(&encoder1, 8, &value, 1);
+  ck_assert_uint_eq(110, length);
+
+  /* Encode nested messages, which are flushed while being encoded */
+  pb_encoder_frame_t frame1[2], frame2[2];
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_encoder_begin_nested_sized(&encoder1, 11, &(frame1[0]), length + 2));
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_encoder_begin_nested(&encoder2, 11, &(frame2[0])));
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_encoder_begin_nested_sized(&encoder1, 11, &(frame1[1]), length));
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_encoder_begin_nested(&encoder2, 11, &(frame2[1])));
+  for (size_t v = 0; v < 10; v++) {
+    ck_assert_uint_eq(PB_ERROR_NONE,
+      pb_encoder_encode(&encoder1, 8, &value, 1));
+    ck_assert_uint_eq(PB_ERROR_NONE,
+      pb_encoder_encode(&encoder2, 8, &value, 1));
+    fail_unless(pb_encoder_length(&encoder1) <= 27);
+  }
+  pb_encoder_end_nested(&encoder1);
+  pb_encoder_end_nested(&encoder1);
+  pb_encoder_end_nested(&encoder2);
+  pb_encoder_end_nested(&encoder2);
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_encoder_flush(&encoder1));
+
+  /* Assert buffer size and contents */
+  const pb_buffer_t *buffer2 = pb_encoder_buffer(&encoder2);
+  ck_assert_uint_eq(114, pb_buffer_size(&buffer));
+  ck_assert_uint_eq(pb_buffer_size(buffer2), pb_buffer_size(&buffer));
+  fail_if(memcmp(pb_buffer_data(buffer2), pb_buffer_data(&buffer),
+    pb_buffer_size(&buffer)));
+
+  /* Free all allocated memory */
+  pb_buffer_destroy(&buffer);
+  pb_encoder_destroy(&encoder2);
+  pb_encoder_destroy(&encoder1);
+} END_TEST
+
+/*
+ * Stream values to a failing sink.
+ */
+START_TEST(test_stream_invalid) {
+  pb_encoder_t encoder = pb_encoder_create(&descriptor);
+  pb_encoder_stream(&encoder, sink_fail, NULL, 16);
+
+  /* Encode values until the threshold is reached */
+  pb_string_t value = pb_string_init_from_chars("SOME DATA");
+  for (size_t v = 0; v < 2; v++)
+    ck_assert_uint_eq(PB_ERROR_NONE,
+      pb_encoder_encode(&encoder, 8, &value, 1));
+
+  /* Assert failing flushes leave the encoder as is */
+  ck_assert_uint_eq(PB_ERROR_INVALID,
+    pb_encoder_encode(&encoder, 8, &value, 1));
+  ck_assert_uint_eq(PB_ERROR_INVALID, pb_encoder_flush(&encoder));
+  ck_assert_uint_eq(22, pb_encoder_length(&encoder));
+
+  /* Free all allocated memory */
+  pb_encoder_destroy(&encoder);
+} END_TEST
+
+/*
+ * Encode values referencing large strings and bytes.
+ */
+START_TEST(test_encode_scattered) {
+  pb_encoder_t encoder1 = pb_encoder_create(&descriptor);
+  pb_encoder_t encoder2 = pb_encoder_create(&descriptor);
+  pb_encoder_scatter(&encoder1, 8);
+
+  /* Encode values */
+  uint32_t    value1 = 1000000000;
+  pb_string_t value2 = pb_string_init_from_chars("SOME DATA"),
+              value3 = pb_string_init_from_chars("DATA");
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_encoder_encode(&encoder1, 1, &value1, 1));
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_encoder_encode(&encoder1, 8, &value2, 1));
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_encoder_encode(&encoder1, 9, &value3, 1));
+
+  /* Encode the same values without references */
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_encoder_encode(&encoder2, 1, &value1, 1));
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_encoder_encode(&encoder2, 8, &value2, 1));
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_encoder_encode(&encoder2, 9, &value3, 1));
+
+  /* Assert buffer and encoded length */
+  ck_assert_uint_eq(14, pb_buffer_size(pb_encoder_buffer(&encoder1)));
+  ck_assert_uint_eq(23, pb_encoder_length(&encoder1));
+
+  /* Assert I/O vectors */
+  struct iovec iov[3];
+  ck_assert_uint_eq(3, pb_encoder_iovec(&encoder1, iov, 3));
+  ck_assert_uint_eq(8, iov[0].iov_len);
+  ck_assert_ptr_eq(pb_string_data(&value2), iov[1].iov_base);
+  ck_assert_uint_eq(9, iov[1].iov_len);
+  ck_assert_uint_eq(6, iov[2].iov_len);
+
+  /* Assert contents */
+  uint8_t data[23], *temp = data;
+  for (size_t v = 0; v < 3; temp += iov[v++].iov_len)
+    memcpy(temp, iov[v].iov_base, iov[v].iov_len);
+  ck_assert_uint_eq(23, pb_buffer_size(pb_encoder_buffer(&encoder2)));
+  fail_if(memcmp(data, pb_buffer_data(pb_encoder_buffer(&encoder2)), 23));
+
+  /* Free all allocated memory */
+  pb_encoder_destroy(&encoder2);
+  pb_encoder_destroy(&encoder1);
+} END_TEST
+
+/*
+ * Encode messages referencing large strings and bytes.
+ */
+START_TEST(test_encode_scattered_message) {
+  pb_encoder_t encoder1 = pb_encoder_create(&descriptor);
+  pb_encoder_t encoder2 = pb_encoder_create(&descriptor);
+  pb_encoder_t encoder3 = pb_encoder_create(&descriptor);
+  pb_encoder_scatter(&encoder1, 8);
+  pb_encoder_scatter(&encoder2, 8);
+
+  /* Encode a value and a message */
+  pb_string_t value = pb_string_init_from_chars("SOME DATA");
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_encoder_encode(&encoder2, 8, &value, 1));
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_encoder_encode(&encoder1, 11, &encoder2, 1));
+
+  /* Encode the same message without references */
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_encoder_encode(&encoder3, 11, &encoder2, 1));
+
+  /* Assert segments of message */
+  struct iovec iov[2];
+  ck_assert_uint_eq(2, pb_encoder_iovec(&encoder1, iov, 2));
+  ck_assert_uint_eq(4, iov[0].iov_len);
+  ck_assert_ptr_eq(pb_string_data(&value), iov[1].iov_base);
+  ck_assert_uint_eq(13, pb_encoder_length(&encoder1));
+
+  /* Assert contents */
+  const uint8_t *data = pb_buffer_data(pb_encoder_buffer(&encoder3));
+  ck_assert_uint_eq(13, pb_buffer_size(pb_encoder_buffer(&encoder3)));
+  fail_if(memcmp(data, iov[0].iov_base, 4));
+  fail_if(memcmp(&(data[4]), iov[1].iov_base, 9));
+
+  /* Free all allocated memory */
+  pb_encoder_destroy(&encoder3);
+  pb_encoder_destroy(&encoder2);
+  pb_encoder_destroy(&encoder1);
+} END_TEST
+
+/*
+ * Encode values referencing large strings with failing reallocation.
+ */
+START_TEST(test_encode_scattered_invalid_resize) {
+  pb_allocator_t allocator = {
+    .proc = {
+      .allocate = allocator_default.proc.allocate,
+      .resize   = allocator_resize_fail,
+      .free     = allocator_default.proc.free
+    }
+  };
+
+  /* Create encoder */
+  pb_encoder_t encoder =
+    pb_encoder_create_with_allocator(&allocator, &descriptor);
+  pb_encoder_scatter(&encoder, 8);
+
+  /* Encode value */
+  pb_string_t value = pb_string_init_from_chars("SOME DATA");
+  ck_assert_uint_eq(PB_ERROR_ALLOC,
+    pb_encoder_encode(&encoder, 8, &value, 1));
+
+  /* Assert buffer size and I/O vectors */
+  ck_assert_uint_eq(0, pb_encoder_length(&encoder));
+  ck_assert_uint_eq(0, pb_encoder_iovec(&encoder, NULL, 0));
+
+  /* Free all allocated memory */
+  pb_encoder_destroy(&encoder);
+} END_TEST
+
+/*
+ * Encode a struct according to a layout.
+ */
+START_TEST(test_encode_struct) {
+  pb_encoder_t encoder1 = pb_encoder_create(&descriptor);
+  pb_encoder_t encoder2 = pb_encoder_create(&descriptor);
+  const pb_buffer_t *buffer1 = pb_encoder_buffer(&encoder1),
+                    *buffer2 = pb_encoder_buffer(&encoder2);
+
+  /* Prepare nested structs */
+  value_t values[3] = {};
+  values[0].f07 = 0.00000001;
+  pb_layout_set(&layout, &(values[0]), 6);
+  values[1].f01 = 1;
+  pb_layout_set(&layout, &(values[1]), 0);
+  values[2].f01 = 2;
+  pb_layout_set(&layout, &(values[2]), 0);
+
+  /* Prepare struct */
+  value_t value = {
+    .f01 = 1000000000,
+    .f08 = pb_string_init_from_chars("SOME DATA"),
+    .f11 = &(values[0]),
+    .f12 = { &(values[1]), 2, 2 }
+  };
+  pb_layout_set(&layout, &value, 0);
+  pb_layout_set(&layout, &value, 7);
+
+  /* Encode struct */
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_encoder_encode_struct(&encoder1, &layout, &value));
+
+  /* Encode the same values field by field */
+  pb_encoder_t encoder3 = pb_encoder_create(&descriptor);
+  pb_encoder_t encoder4[2] = {
+    pb_encoder_create(&descriptor),
+    pb_encoder_create(&descriptor)
+  };
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_encoder_encode(&encoder3, 7, &(values[0].f07), 1));
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_encoder_encode(&(encoder4[0]), 1, &(values[1].f01), 1));
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_encoder_encode(&(encoder4[1]), 1, &(values[2].f01), 1));
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_encoder_encode(&encoder2, 1, &(value.f01), 1));
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_encoder_encode(&encoder2, 8, &(value.f08), 1));
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_encoder_encode(&encoder2, 11, &encoder3, 1));
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_encoder_encode(&encoder2, 12, encoder4, 2));
+
+  /* Assert buffer size and contents */
+  ck_assert_uint_eq(36, pb_buffer_size(buffer1));
+  ck_assert_uint_eq(pb_buffer_size(buffer2), pb_buffer_size(buffer1));
+  fail_if(memcmp(pb_buffer_data(buffer1), pb_buffer_data(buffer2),
+    pb_buffer_size(buffer1)));
+
+  /* Free all allocated memory */
+  pb_encoder_destroy(&(encoder4[1]));
+  pb_encoder_destroy(&(encoder4[0]));
+  pb_encoder_destroy(&encoder3);
+  pb_encoder_destroy(&encoder2);
+  pb_encoder_destroy(&encoder1);
+} END_TEST
+
+/*
+ * Encode a struct as a nested message of known length.
+ */
+START_TEST(test_encode_struct_sized) {
+  pb_encoder_t encoder1 = pb_encoder_create(&descriptor);
+  pb_encoder_t encoder2 = pb_encoder_create(&descriptor);
+  pb_encoder_t encoder3 = pb_encoder_create(&descriptor);
+  const pb_buffer_t *buffer1 = pb_encoder_buffer(&encoder1),
+                    *buffer2 = pb_encoder_buffer(&encoder2);
+
+  /* Prepare struct */
+  value_t value = {
+    .f01 = 1000000000,
+    .f08 = pb_string_init_from_chars("SOME DATA")
+  };
+  pb_layout_set(&layout, &value, 0);
+  pb_layout_set(&layout, &value, 7);
+
+  /* Encode struct as nested message */
+  size_t length = pb_encoder_size_struct(&layout, &value);
+  ck_assert_uint_eq(17, length);
+  pb_encoder_frame_t frame;
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_encoder_begin_nested_sized(&encoder1, 11, &frame, length));
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_encoder_encode_struct(&encoder1, &layout, &value));
+  pb_encoder_end_nested(&encoder1);
+
+  /* Encode the same struct with a separate encoder */
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_encoder_encode_struct(&encoder3, &layout, &value));
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_encoder_encode(&encoder2, 11, &encoder3, 1));
+
+  /* Assert buffer size and contents */
+  ck_assert_uint_eq(19, pb_buffer_size(buffer1));
+  ck_assert_uint_eq(pb_buffer_size(buffer2), pb_buffer_size(buffer1));
+  fail_if(memcmp(pb_buffer_data(buffer1), pb_buffer_data(buffer2),
+    pb_buffer_size(buffer1)));
+
+  /* Free all allocated memory */
+  pb_encoder_destroy(&encoder3);
+  pb_encoder_destroy(&encoder2);
+  pb_encoder_destroy(&encoder1);
+} END_TEST
+
+/*
+ * Encode a struct without present fields.
+ */
+START_TEST(test_encode_struct_empty) {
+  pb_encoder_t encoder = pb_encoder_create(&descriptor);
+  const pb_buffer_t *buffer = pb_encoder_buffer(&encoder);
+
+  /* Encode struct */
+  value_t value = { .f01 = 1000000000 };
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_encoder_encode_struct(&encoder, &layout, &value));
+
+  /* Assert buffer size */
+  fail_unless(pb_buffer_empty(buffer));
+  ck_assert_uint_eq(0, pb_buffer_size(buffer));
+
+  /* Free all allocated memory */
+  pb_encoder_destroy(&encoder);
+} END_TEST
+
+/*
+ * Encode a struct with an invalid encoder.
+ */
+START_TEST(test_encode_struct_invalid) {
+  pb_encoder_t encoder = pb_encoder_create_invalid();
+  const pb_buffer_t *buffer = pb_encoder_buffer(&encoder);
+
+  /* Encode struct */
+  value_t value = { .f01 = 1000000000 };
+  pb_layout_set(&layout, &value, 0);
+  ck_assert_uint_eq(PB_ERROR_INVALID,
+    pb_encoder_encode_struct(&encoder, &layout, &value));
+
+  /* Assert buffer size */
+  fail_unless(pb_buffer_empty(buffer));
+  ck_assert_uint_eq(0, pb_buffer_size(buffer));
+
+  /* Free all allocated memory */
+  pb_encoder_destroy(&encoder);
+} END_TEST
+
+/*
+ * Encode a struct with an encoder for which reallocation fails.
+ */
+START_TEST(test_encode_struct_invalid_resize) {
+  pb_allocator_t allocator = {
+    .proc = {
+      .allocate = allocator_default.proc.allocate,
+      .resize   = allocator_resize_fail,
+      .free     = allocator_default.proc.free
+    }
+  };
+
+  /* Create encoder */
+  pb_encoder_t encoder =
+    pb_encoder_create_with_allocator(&allocator, &descriptor);
+  const pb_buffer_t *buffer = pb_encoder_buffer(&encoder);
+
+  /* Encode struct */
+  value_t value = { .f01 = 1000000000 };
+  pb_layout_set(&layout, &value, 0);
+  ck_assert_uint_eq(PB_ERROR_ALLOC,
+    pb_encoder_encode_struct(&encoder, &layout, &value));
+
+  /* Assert buffer validity and error */
+  fail_unless(pb_buffer_valid(buffer));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_buffer_error(buffer));
+
+  /* Assert buffer size */
+  fail_unless(pb_buffer_empty(buffer));
+  ck_assert_uint_eq(0, pb_buffer_size(buffer));
+
+  /* Free all allocated memory */
+  pb_encoder_destroy(&encoder);
+} END_TEST
+
+/* ----------------------------------------------------------------------------
+ * Program
+ * ------------------------------------------------------------------------- */
+
+/*
+ * Create a test suite for all registered test cases and run it.
+ *
+ * Tests must be run sequentially (in no-fork mode) or code coverage
+ * cannot be determined properly.
+ */
+int
+main(void) {
+  void *suite = suite_create("protobluff/core/encoder"),
+       *tcase = NULL;
+
+  /* Add tests to test case "create" */
+  tcase = tcase_create("create");
+  tcase_add_test(tcase, test_create);
+  tcase_add_test(tcase, test_create_invalid);
+  tcase_add_test(tcase, test_create_invalid_allocate);
+  suite_add_tcase(suite, tcase);
+
+  /* Add tests to test case "encode" */
+  tcase = tcase_create("encode");
+  tcase_add_test(tcase, test_encode);
+  tcase_add_test(tcase, test_encode_packed);
+  tcase_add_test(tcase, test_encode_packed_invalid);
+  tcase_add_test(tcase, test_encode_packed_invalid_resize);
+  tcase_add_test(tcase, test_encode_varint);
+  tcase_add_test(tcase, test_encode_varint_packed);
+  tcase_add_test(tcase, test_encode_varint_packed_merged);
+  tcase_add_test(tcase, test_encode_varint_padded);
+  tcase_add_test(tcase, test_encode_varint_invalid);
+  tcase_add_test(tcase, test_encode_varint_invalid_resize);
+  tcase_add_test(tcase, test_encode_64bit);
+  tcase_add_test(tcase, test_encode_64bit_packed);
+  tcase_add_test(tcase, test_encode_64bit_packed_merged);
+  tcase_add_test(tcase, test_encode_64bit_invalid);
+  tcase_add_test(tcase, test_encode_64bit_invalid_resize);
+  tcase_add_test(tcase, test_encode_length);
+  tcase_add_test(tcase, test_encode_length_message);
+  tcase_add_test(tcase, test_encode_length_invalid);
+  tcase_add_test(tcase, test_encode_length_invalid_resize);
+  tcase_add_test(tcase, test_encode_32bit);
+  tcase_add_test(tcase, test_encode_32bit_packed);
+  tcase_add_test(tcase, test_encode_32bit_packed_merged);
+  tcase_add_test(tcase, test_encode_32bit_invalid);
+  tcase_add_test(tcase, test_encode_32bit_invalid_resize);
+  suite_add_tcase(suite, tcase);
+
+  /* Add tests to test case "fields" */
+  tcase = tcase_create("fields");
+  tcase_add_test(tcase, test_size);
+  tcase_add_test(tcase, test_size_message);
+  tcase_add_test(tcase, test_encode_fields);
+  tcase_add_test(tcase, test_encode_fields_invalid);
+  tcase_add_test(tcase, test_encode_fields_invalid_resize);
+  tcase_add_test(tcase, test_encode_raw);
+  tcase_add_test(tcase, test_encode_raw_invalid);
+  suite_add_tcase(suite, tcase);
+
+  /* Add tests to test case "nested" */
+  tcase = tcase_create("nested");
+  tcase_add_test(tcase, test_encode_nested);
+  tcase_add_test(tcase, test_encode_nested_length);
+  tcase_add_test(tcase, test_encode_nested_scattered);
+  tcase_add_test(tcase, test_encode_nested_invalid);
+  tcase_add_test(tcase, test_encode_nested_invalid_resize);
+  suite_add_tcase(suite, tcase);
+
+  /* Add tests to test case "reset" */
+  tcase = tcase_create("reset");
+  tcase_add_test(tcase, test_reset);
+  tcase_add_test(tcase, test_reset_scattered);
+  tcase_add_test(tcase, test_reset_invalid);
+  tcase_add_test(tcase, test_trim);
+  tcase_add_test(tcase, test_trim_invalid);
+  suite_add_tcase(suite, tcase);
+
+  /* Add tests to test case "fixed" */
+  tcase = tcase_create("fixed");
+  tcase_add_test(tcase, test_encode_fixed);
+  suite_add_tcase(suite, tcase);
+
+  /* Add tests to test case "stream" */
+  tcase = tcase_create("stream");
+  tcase_add_test(tcase, test_stream);
+  tcase_add_test(tcase, test_stream_nested);
+  tcase_add_test(tcase, test_stream_nested_sized);
+  tcase_add_test(tcase, test_stream_invalid);
+  suite_add_tcase(suite, tcase);
+
+  /* Add tests to test case "scatter" */
+  tcase = tcase_create("scatter");
+  tcase_add_test(tcase, test_encode_scattered);
+  tcase_add_test(tcase, test_encode_scattered_message);
+  tcase_add_test(tcase, test_encode_scattered_invalid_resize);
+  suite_add_tcase(suite, tcase);
+
+  /* Add tests to test case "struct" */
+  tcase = tcase_create("struct");
+  tcase_add_test(tcase, test_encode_struct);
+  tcase_add_test(tcase, test_encode_struct_sized);
+  tcase_add_test(tcase, test_encode_struct_empty);
+  tcase_add_test(tcase, test_encode_struct_invalid);
+  tcase_add_test(tcase, test_encode_struct_invalid_resize);
   suite_add_tcase(suite, tcase);
 
   /* Create a test suite runner in no-fork mode */
@@ -0,0 +1,273 @@
+/*
+ * Copyright (c) 2013-2020 Martin Donath <martin.donath@squidfunk.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <assert.h>
+#include <check.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/uio.h>
+
+#include <protobluff/descriptor.h>
+
+#include "core/common.h"
+#include "core/buffer.h"
+#include "core/encoder.h"
+#include "core/fragment.h"
+
+/* ----------------------------------------------------------------------------
+ * Descriptors
+ * ------------------------------------------------------------------------- */
+
+/* Descriptor */
+static pb_descriptor_t
+descriptor = { {
+  (const pb_field_descriptor_t []){
+    {  1, "F01", UINT32,  OPTIONAL },
+    {  8, "F08", STRING,  OPTIONAL },
+    { 11, "F11", MESSAGE, REPEATED, &descriptor }
+  }, 3 } };
+
+/* ----------------------------------------------------------------------------
+ * Tests
+ * ------------------------------------------------------------------------- */
+
+/*
+ * Freeze the encoded submessage of an encoder into a fragment.
+ */
+START_TEST(test_create) {
+  pb_encoder_t encoder = pb_encoder_create(&descriptor);
+  uint32_t value = 127;
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_encoder_encode(&encoder, 1, &value, 1));
+
+  /* Create fragment and destroy encoder */
+  pb_fragment_t *fragment = pb_fragment_create(11, &encoder);
+  pb_encoder_destroy(&encoder);
+
+  /* Assert fragment */
+  ck_assert_ptr_ne(NULL, fragment);
+  ck_assert_uint_eq(11, pb_fragment_tag(fragment));
+  ck_assert_uint_eq(4, pb_fragment_size(fragment));
+  fail_if(memcmp("\x5A\x02\x08\x7F", pb_fragment_data(fragment), 4));
+
+  /* Assert encoded submessage */
+  pb_string_t submessage = pb_fragment_value(fragment);
+  ck_assert_uint_eq(2, pb_string_size(&submessage));
+  fail_if(memcmp("\x08\x7F", pb_string_data(&submessage), 2));
+
+  /* Free all allocated memory */
+  pb_fragment_release(fragment);
+} END_TEST
+
+/*
+ * Freeze an empty submessage into a fragment.
+ */
+START_TEST(test_create_empty) {
+  pb_encoder_t encoder = pb_encoder_create(&descriptor);
+
+  /* Create fragment and assert key and length prefix */
+  pb_fragment_t *fragment = pb_fragment_create(11, &encoder);
+  ck_assert_ptr_ne(NULL, fragment);
+  ck_assert_uint_eq(2, pb_fragment_size(fragment));
+  fail_if(memcmp("\x5A\x00", pb_fragment_data(fragment), 2));
+
+  /* Free all allocated memory */
+  pb_fragment_release(fragment);
+  pb_encoder_destroy(&encoder);
+} END_TEST
+
+/*
+ * Freeze the submessage of an encoder that doesn't hold it as a whole.
+ */
+START_TEST(test_create_invalid) {
+  pb_encoder_t encoder1 = pb_encoder_create(&descriptor),
+               encoder2 = pb_encoder_create(&descriptor);
+
+  /* Reference a string and begin a nested message */
+  pb_encoder_scatter(&encoder1, 1);
+  pb_string_t value = pb_string_init_from_chars("SOME DATA");
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_encoder_encode(&encoder1, 8, &value, 1));
+  pb_encoder_frame_t frame;
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_encoder_begin_nested(&encoder2, 11, &frame));
+
+  /* Assert fragments are not created */
+  ck_assert_ptr_eq(NULL, pb_fragment_create(11, &encoder1));
+  ck_assert_ptr_eq(NULL, pb_fragment_create(11, &encoder2));
+  ck_assert_ptr_eq(NULL, pb_fragment_create(1 << 29, &encoder1));
+  pb_encoder_t encoder3 = pb_encoder_create_invalid();
+  ck_assert_ptr_eq(NULL, pb_fragment_create(11, &encoder3));
+
+  /* Free all allocated memory */
+  pb_encoder_destroy(&encoder2);
+  pb_encoder_destroy(&encoder1);
+} END_TEST
+
+/* ------------------------------------------------------------------------- */
+
+/*
+ * Retain and release references to a fragment.
+ */
+START_TEST(test_retain) {
+  pb_encoder_t encoder = pb_encoder_create(&descriptor);
+  pb_fragment_t *fragment = pb_fragment_create(11, &encoder);
+  pb_encoder_destroy(&encoder);
+
+  /* Retain and release fragment */
+  ck_assert_ptr_eq(fragment, pb_fragment_retain(fragment));
+  ck_assert_uint_eq(2, fragment->references);
+  pb_fragment_release(fragment);
+  ck_assert_uint_eq(1, fragment->references);
+
+  /* Free all allocated memory */
+  pb_fragment_release(fragment);
+} END_TEST
+
+/* ------------------------------------------------------------------------- */
+
+/*
+ * Encode fragments, yielding the same result as encoding the submessage.
+ */
+START_TEST(test_encode) {
+  pb_encoder_t nested = pb_encoder_create(&descriptor);
+  uint32_t value = 127;
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_encoder_encode(&nested, 1, &value, 1));
+  pb_fragment_t *fragment = pb_fragment_create(11, &nested);
+
+  /* Encode submessage twice and fragment twice */
+  pb_encoder_t encoder1 = pb_encoder_create(&descriptor),
+               encoder2 = pb_encoder_create(&descriptor);
+  for (size_t r = 0; r < 2; r++) {
+    ck_assert_uint_eq(PB_ERROR_NONE,
+      pb_encoder_encode(&encoder1, 11, &nested, 1));
+    ck_assert_uint_eq(PB_ERROR_NONE,
+      pb_encoder_encode_fragment(&encoder2, fragment));
+  }
+
+  /* Assert same encoded messages */
+  const pb_buffer_t *buffer1 = pb_encoder_buffer(&encoder1),
+                    *buffer2 = pb_encoder_buffer(&encoder2);
+  ck_assert_uint_eq(8, pb_buffer_size(buffer2));
+  ck_assert_uint_eq(pb_buffer_size(buffer1), pb_buffer_size(buffer2));
+  fail_if(memcmp(pb_buffer_data(buffer1), pb_buffer_data(buffer2), 8));
+
+  /* Free all allocated memory */
+  pb_encoder_destroy(&encoder2);
+  pb_encoder_destroy(&encoder1);
+  pb_fragment_release(fragment);
+  pb_encoder_destroy(&nested);
+} END_TEST
+
+/*
+ * Encode a fragment with an encoder referencing large payloads.
+ */
+START_TEST(test_encode_scattered) {
+  pb_encoder_t nested = pb_encoder_create(&descriptor);
+  uint32_t value = 127;
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_encoder_encode(&nested, 1, &value, 1));
+  pb_fragment_t *fragment = pb_fragment_create(11, &nested);
+  pb_encoder_destroy(&nested);
+
+  /* Encode value and fragment */
+  pb_encoder_t encoder = pb_encoder_create(&descriptor);
+  pb_encoder_scatter(&encoder, 4);
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_encoder_encode(&encoder, 1, &value, 1));
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_encoder_encode_fragment(&encoder, fragment));
+
+  /* Assert fragment is referenced */
+  struct iovec iov[2];
+  ck_assert_uint_eq(6, pb_encoder_length(&encoder));
+  ck_assert_uint_eq(2, pb_encoder_iovec(&encoder, iov, 2));
+  ck_assert_ptr_eq(pb_fragment_data(fragment), iov[1].iov_base);
+  ck_assert_uint_eq(4, iov[1].iov_len);
+
+  /* Free all allocated memory */
+  pb_encoder_destroy(&encoder);
+  pb_fragment_release(fragment);
+} END_TEST
+
+/*
+ * Encode a fragment with an invalid encoder.
+ */
+START_TEST(test_encode_invalid) {
+  pb_encoder_t nested  = pb_encoder_create(&descriptor),
+               encoder = pb_encoder_create_invalid();
+  pb_fragment_t *fragment = pb_fragment_create(11, &nested);
+  pb_encoder_destroy(&nested);
+
+  /* Encode fragment */
+  ck_assert_uint_eq(PB_ERROR_INVALID,
+    pb_encoder_encode_fragment(&encoder, fragment));
+  pb_encoder_destroy(&encoder);
+
+  /* Free all allocated memory */
+  pb_fragment_release(fragment);
+} END_TEST
+
+/* ----------------------------------------------------------------------------
+ * Program
+ * ------------------------------------------------------------------------- */
+
+/*
+ * Create a test suite for all registered test cases and run it.
+ *
+ * Tests must be run sequentially (in no-fork mode) or code coverage
+ * cannot be determined properly.
+ */
+int
+main(void) {
+  void *suite = suite_create("protobluff/core/fragment"),
+       *tcase = NULL;
+
+  /* Add tests to test case "create" */
+  tcase = tcase_create("create");
+  tcase_add_test(tcase, test_create);
+  tcase_add_test(tcase, test_create_empty);
+  tcase_add_test(tcase, test_create_invalid);
+  suite_add_tcase(suite, tcase);
+
+  /* Add tests to test case "retain" */
+  tcase = tcase_create("retain");
+  tcase_add_test(tcase, test_retain);
+  suite_add_tcase(suite, tcase);
+
+  /* Add tests to test case "encode" */
+  tcase = tcase_create("encode");
+  tcase_add_test(tcase, test_encode);
+  tcase_add_test(tcase, test_encode_scattered);
+  tcase_add_test(tcase, test_encode_invalid);
+  suite_add_tcase(suite, tcase);
+
+  /* Create a test suite runner in no-fork mode */
+  void *runner = srunner_create(suite);
+  srunner_set_fork_status(runner, CK_NOFORK);
+
+  /* Execute test suite runner */
+  srunner_run_all(runner, CK_NORMAL);
+  int failed = srunner_ntests_failed(runner);
+  srunner_free(runner);
+
+  /* Exit with status code */
+  return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
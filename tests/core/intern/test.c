@@ -0,0 +1,250 @@
+/*
+ * Copyright (c) 2013-2020 Martin Donath <martin.donath@squidfunk.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <assert.h>
+#include <check.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "core/allocator.h"
+#include "core/common.h"
+#include "core/intern.h"
+
+/* ----------------------------------------------------------------------------
+ * Allocator
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Allocator with failing allocation.
+ *
+ * \param[in,out] data Internal allocator data
+ * \param[in]     size Bytes to be allocated
+ * \return             Memory block
+ */
+static void *
+allocator_allocate_fail(void *data, size_t size) {
+  assert(!data && size);
+  return NULL;
+}
+
+/* ----------------------------------------------------------------------------
+ * Tests
+ * ------------------------------------------------------------------------- */
+
+/*
+ * Create an interning table.
+ */
+START_TEST(test_create) {
+  pb_intern_t intern = pb_intern_create();
+
+  /* Assert interning table size */
+  ck_assert_uint_eq(0, pb_intern_size(&intern));
+
+  /* Free all allocated memory */
+  pb_intern_destroy(&intern);
+} END_TEST
+
+/*
+ * Intern a string.
+ */
+START_TEST(test_insert) {
+  uint8_t data[] = "SOME DATA";
+  pb_string_t string = pb_string_init(data, 9);
+  pb_intern_t intern = pb_intern_create();
+
+  /* Intern string */
+  const pb_string_t *value = pb_intern_insert(&intern, &string);
+  fail_unless(value);
+  fail_unless(pb_string_equals(&string, value));
+  fail_if(pb_string_data(value) == pb_string_data(&string));
+
+  /* Assert identifier and lookup */
+  ck_assert_uint_eq(1, pb_intern_size(&intern));
+  ck_assert_uint_eq(0, pb_intern_id(value));
+  ck_assert_ptr_eq(value, pb_intern_string(&intern, 0));
+  ck_assert_ptr_eq(value, pb_intern_find(&intern, &string));
+
+  /* Free all allocated memory */
+  pb_intern_destroy(&intern);
+} END_TEST
+
+/*
+ * Intern a string twice.
+ */
+START_TEST(test_insert_duplicate) {
+  uint8_t x[] = "SOME DATA", y[] = "SOME DATA";
+  pb_string_t sx = pb_string_init(x, 9),
+              sy = pb_string_init(y, 9);
+  pb_intern_t intern = pb_intern_create();
+
+  /* Intern strings */
+  const pb_string_t *value = pb_intern_insert(&intern, &sx);
+  fail_unless(value);
+  ck_assert_ptr_eq(value, pb_intern_insert(&intern, &sy));
+
+  /* Assert interning table size */
+  ck_assert_uint_eq(1, pb_intern_size(&intern));
+
+  /* Free all allocated memory */
+  pb_intern_destroy(&intern);
+} END_TEST
+
+/*
+ * Intern an empty string.
+ */
+START_TEST(test_insert_empty) {
+  uint8_t data[] = "";
+  pb_string_t string = pb_string_init(data, 0);
+  pb_intern_t intern = pb_intern_create();
+
+  /* Intern string */
+  const pb_string_t *value = pb_intern_insert(&intern, &string);
+  fail_unless(value);
+  ck_assert_uint_eq(0, pb_string_size(value));
+  ck_assert_ptr_eq(value, pb_intern_insert(&intern, &string));
+
+  /* Free all allocated memory */
+  pb_intern_destroy(&intern);
+} END_TEST
+
+/*
+ * Intern many strings, so the interning table must grow.
+ */
+START_TEST(test_insert_grow) {
+  pb_intern_t intern = pb_intern_create();
+  const pb_string_t *values[1000];
+
+  /* Intern strings */
+  for (size_t v = 0; v < 1000; v++) {
+    uint8_t data[32];
+    size_t size = snprintf((char *)data, 32, "service-%zu", v);
+    pb_string_t string = pb_string_init(data, size);
+    fail_unless((values[v] = pb_intern_insert(&intern, &string)) != NULL);
+    ck_assert_uint_eq(v, pb_intern_id(values[v]));
+  }
+  ck_assert_uint_eq(1000, pb_intern_size(&intern));
+
+  /* Assert interned strings didn't move */
+  for (size_t v = 0; v < 1000; v++) {
+    uint8_t data[32];
+    size_t size = snprintf((char *)data, 32, "service-%zu", v);
+    pb_string_t string = pb_string_init(data, size);
+    ck_assert_ptr_eq(values[v], pb_intern_find(&intern, &string));
+    ck_assert_ptr_eq(values[v], pb_intern_string(&intern, v));
+  }
+
+  /* Free all allocated memory */
+  pb_intern_destroy(&intern);
+} END_TEST
+
+/*
+ * Intern a string for which allocation fails.
+ */
+START_TEST(test_insert_invalid_allocate) {
+  uint8_t data[] = "SOME DATA";
+  pb_string_t string = pb_string_init(data, 9);
+
+  /* Patch allocator */
+  pb_allocator_t allocator = {
+    .proc = {
+      .allocate = allocator_allocate_fail,
+      .resize   = allocator_default.proc.resize,
+      .free     = allocator_default.proc.free
+    }
+  };
+
+  /* Intern string */
+  pb_intern_t intern = pb_intern_create_with_allocator(&allocator);
+  fail_if(pb_intern_insert(&intern, &string));
+  ck_assert_uint_eq(0, pb_intern_size(&intern));
+
+  /* Free all allocated memory */
+  pb_intern_destroy(&intern);
+} END_TEST
+
+/*
+ * Look up a string that was not interned.
+ */
+START_TEST(test_find_absent) {
+  uint8_t x[] = "SOME DATA", y[] = "OTHER DATA";
+  pb_string_t sx = pb_string_init(x, 9),
+              sy = pb_string_init(y, 10);
+  pb_intern_t intern = pb_intern_create();
+
+  /* Look up string in empty interning table */
+  fail_if(pb_intern_find(&intern, &sx));
+
+  /* Intern string and look up other string */
+  fail_unless(pb_intern_insert(&intern, &sx));
+  fail_if(pb_intern_find(&intern, &sy));
+
+  /* Free all allocated memory */
+  pb_intern_destroy(&intern);
+} END_TEST
+
+/* ----------------------------------------------------------------------------
+ * Program
+ * ------------------------------------------------------------------------- */
+
+/*
+ * Create a test suite for all registered test cases and run it.
+ *
+ * Tests must be run sequentially (in no-fork mode) or code coverage
+ * cannot be determined properly.
+ */
+int
+main(void) {
+  void *suite = suite_create("protobluff/core/intern"),
+       *tcase = NULL;
+
+  /* Add tests to test case "create" */
+  tcase = tcase_create("create");
+  tcase_add_test(tcase, test_create);
+  suite_add_tcase(suite, tcase);
+
+  /* Add tests to test case "insert" */
+  tcase = tcase_create("insert");
+  tcase_add_test(tcase, test_insert);
+  tcase_add_test(tcase, test_insert_duplicate);
+  tcase_add_test(tcase, test_insert_empty);
+  tcase_add_test(tcase, test_insert_grow);
+  tcase_add_test(tcase, test_insert_invalid_allocate);
+  suite_add_tcase(suite, tcase);
+
+  /* Add tests to test case "find" */
+  tcase = tcase_create("find");
+  tcase_add_test(tcase, test_find_absent);
+  suite_add_tcase(suite, tcase);
+
+  /* Create a test suite runner in no-fork mode */
+  void *runner = srunner_create(suite);
+  srunner_set_fork_status(runner, CK_NOFORK);
+
+  /* Execute test suite runner */
+  srunner_run_all(runner, CK_NORMAL);
+  int failed = srunner_ntests_failed(runner);
+  srunner_free(runner);
+
+  /* Exit with status code */
+  return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,218 @@
+/*
+ * Copyright (c) 2013-2020 Martin Donath <martin.donath@squidfunk.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <check.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <protobluff/descriptor.h>
+
+#include "core/buffer.h"
+#include "core/common.h"
+#include "core/descriptor.h"
+#include "core/encoder.h"
+#include "core/ring.h"
+
+/* ----------------------------------------------------------------------------
+ * Descriptors
+ * ------------------------------------------------------------------------- */
+
+/* Descriptor */
+static pb_descriptor_t
+descriptor = { {
+  (const pb_field_descriptor_t []){
+    {  1, "F01", UINT32, OPTIONAL },
+    {  2, "F02", BYTES,  OPTIONAL }
+  }, 2 } };
+
+/* ----------------------------------------------------------------------------
+ * Tests
+ * ------------------------------------------------------------------------- */
+
+/*
+ * Create a ring buffer.
+ */
+START_TEST(test_create) {
+  uint8_t data[16];
+  pb_ring_t ring = pb_ring_create(data, 16);
+
+  /* Assert ring buffer size */
+  fail_unless(pb_ring_empty(&ring));
+  ck_assert_uint_eq(16, pb_ring_available(&ring));
+} END_TEST
+
+/*
+ * Encode a message into a ring buffer and release it.
+ */
+START_TEST(test_encoder) {
+  uint8_t data[16];
+  pb_ring_t ring = pb_ring_create(data, 16);
+
+  /* Create encoder and encode a value */
+  pb_encoder_t encoder = pb_ring_encoder(&ring, &descriptor, 0);
+  fail_unless(pb_encoder_valid(&encoder));
+  uint32_t value = 1000000000;
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_encoder_encode(&encoder, 1, &value, 1));
+
+  /* Commit message */
+  fail_unless(pb_ring_empty(&ring));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_ring_commit(&ring, &encoder));
+  fail_if(pb_ring_empty(&ring));
+  ck_assert_uint_eq(10, pb_ring_available(&ring));
+
+  /* Assert committed data */
+  size_t size;
+  ck_assert_ptr_eq(data, pb_ring_peek(&ring, &size));
+  ck_assert_uint_eq(6, size);
+
+  /* Release message */
+  pb_ring_release(&ring, size);
+  fail_unless(pb_ring_empty(&ring));
+  ck_assert_uint_eq(16, pb_ring_available(&ring));
+
+  /* Free all allocated memory */
+  pb_encoder_destroy(&encoder);
+} END_TEST
+
+/*
+ * Encode messages into a ring buffer wrapping around.
+ */
+START_TEST(test_encoder_wrap) {
+  uint8_t data[16];
+  pb_ring_t ring = pb_ring_create(data, 16);
+  uint32_t value = 1000000000;
+
+  /* Encode and commit two messages */
+  for (size_t m = 0; m < 2; m++) {
+    pb_encoder_t encoder = pb_ring_encoder(&ring, &descriptor, 6);
+    ck_assert_uint_eq(PB_ERROR_NONE,
+      pb_encoder_encode(&encoder, 1, &value, 1));
+    ck_assert_uint_eq(PB_ERROR_NONE, pb_ring_commit(&ring, &encoder));
+    pb_encoder_destroy(&encoder);
+  }
+
+  /* Release first message */
+  size_t size;
+  ck_assert_ptr_eq(data, pb_ring_peek(&ring, &size));
+  ck_assert_uint_eq(12, size);
+  pb_ring_release(&ring, 6);
+
+  /* Encode and commit message wrapping around */
+  pb_encoder_t encoder = pb_ring_encoder(&ring, &descriptor, 6);
+  ck_assert_ptr_eq(data, pb_buffer_data(pb_encoder_buffer(&encoder)));
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_encoder_encode(&encoder, 1, &value, 1));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_ring_commit(&ring, &encoder));
+  ck_assert_uint_eq(0, pb_ring_available(&ring));
+
+  /* Release second message and assert wrapped message */
+  ck_assert_ptr_eq(&(data[6]), pb_ring_peek(&ring, &size));
+  ck_assert_uint_eq(6, size);
+  pb_ring_release(&ring, 6);
+  ck_assert_ptr_eq(data, pb_ring_peek(&ring, &size));
+  ck_assert_uint_eq(6, size);
+
+  /* Free all allocated memory */
+  pb_encoder_destroy(&encoder);
+} END_TEST
+
+/*
+ * Create an encoder for a ring buffer without sufficient space.
+ */
+START_TEST(test_encoder_invalid) {
+  uint8_t data[16];
+  pb_ring_t ring = pb_ring_create(data, 16);
+
+  /* Create encoder */
+  pb_encoder_t encoder = pb_ring_encoder(&ring, &descriptor, 17);
+  fail_if(pb_encoder_valid(&encoder));
+
+  /* Commit message */
+  ck_assert_uint_eq(PB_ERROR_INVALID, pb_ring_commit(&ring, &encoder));
+  fail_unless(pb_ring_empty(&ring));
+
+  /* Free all allocated memory */
+  pb_encoder_destroy(&encoder);
+} END_TEST
+
+/*
+ * Encode a message exceeding the free space of a ring buffer.
+ */
+START_TEST(test_encoder_overflow) {
+  uint8_t data[8];
+  pb_ring_t ring = pb_ring_create(data, 8);
+
+  /* Create encoder and encode a value */
+  pb_encoder_t encoder = pb_ring_encoder(&ring, &descriptor, 0);
+  pb_string_t value = pb_string_init_from_chars("SOME DATA");
+  ck_assert_uint_eq(PB_ERROR_ALLOC,
+    pb_encoder_encode(&encoder, 2, &value, 1));
+
+  /* Commit message */
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_ring_commit(&ring, &encoder));
+  fail_unless(pb_ring_empty(&ring));
+
+  /* Free all allocated memory */
+  pb_encoder_destroy(&encoder);
+} END_TEST
+
+/* ----------------------------------------------------------------------------
+ * Program
+ * ------------------------------------------------------------------------- */
+
+/*
+ * Create a test suite for all registered test cases and run it.
+ *
+ * Tests must be run sequentially (in no-fork mode) or code coverage
+ * cannot be determined properly.
+ */
+int
+main(void) {
+  void *suite = suite_create("protobluff/core/ring"),
+       *tcase = NULL;
+
+  /* Add tests to test case "create" */
+  tcase = tcase_create("create");
+  tcase_add_test(tcase, test_create);
+  suite_add_tcase(suite, tcase);
+
+  /* Add tests to test case "encoder" */
+  tcase = tcase_create("encoder");
+  tcase_add_test(tcase, test_encoder);
+  tcase_add_test(tcase, test_encoder_wrap);
+  tcase_add_test(tcase, test_encoder_invalid);
+  tcase_add_test(tcase, test_encoder_overflow);
+  suite_add_tcase(suite, tcase);
+
+  /* Create a test suite runner in no-fork mode */
+  void *runner = srunner_create(suite);
+  srunner_set_fork_status(runner, CK_NOFORK);
+
+  /* Execute test suite runner */
+  srunner_run_all(runner, CK_NORMAL);
+  int failed = srunner_ntests_failed(runner);
+  srunner_free(runner);
+
+  /* Exit with status code */
+  return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
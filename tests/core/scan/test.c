@@ -0,0 +1,194 @@
+/*
+ * Copyright (c) 2013-2020 Martin Donath <martin.donath@squidfunk.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <check.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <protobluff/descriptor.h>
+
+#include "core/buffer.h"
+#include "core/common.h"
+#include "core/descriptor.h"
+#include "core/scan.h"
+
+/* ----------------------------------------------------------------------------
+ * Descriptors
+ * ------------------------------------------------------------------------- */
+
+/* Descriptor of nested message */
+static pb_descriptor_t
+descriptor_nested = { {
+  (const pb_field_descriptor_t []){
+    {  1, "F01", STRING,  OPTIONAL },
+    {  2, "F02", UINT32,  OPTIONAL }
+  }, 2 } };
+
+/* Descriptor */
+static pb_descriptor_t
+descriptor = { {
+  (const pb_field_descriptor_t []){
+    {  1, "F01", MESSAGE, OPTIONAL, &descriptor_nested },
+    {  2, "F02", FIXED32, OPTIONAL }
+  }, 2 } };
+
+/* ----------------------------------------------------------------------------
+ * Tests
+ * ------------------------------------------------------------------------- */
+
+/*
+ * Scan a message for the values of fields along paths.
+ */
+START_TEST(test_scan) {
+  const uint8_t data[] = {
+    21, 1, 2, 3, 4,
+    10, 6, 10, 4, 'h', 'o', 's', 't',
+    10, 3, 16, 172, 2
+  };
+  pb_buffer_t buffer = pb_buffer_create(data, sizeof(data));
+
+  /* Scan string in nested message */
+  pb_string_t value;
+  const pb_tag_t host[] = { 1, 1 };
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_scan_path(&descriptor, &buffer, host, 2, &value));
+  ck_assert_uint_eq(4, pb_string_size(&value));
+  ck_assert_ptr_eq(pb_buffer_data(&buffer) + 9, pb_string_data(&value));
+
+  /* Scan variable-sized integer in second occurrence of nested message */
+  const pb_tag_t port[] = { 1, 2 };
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_scan_path(&descriptor, &buffer, port, 2, &value));
+  ck_assert_uint_eq(2, pb_string_size(&value));
+  ck_assert_uint_eq(172, pb_string_data(&value)[0]);
+
+  /* Scan fixed-sized integer */
+  const pb_tag_t fixed[] = { 2 };
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_scan_path(&descriptor, &buffer, fixed, 1, &value));
+  ck_assert_uint_eq(4, pb_string_size(&value));
+  ck_assert_ptr_eq(pb_buffer_data(&buffer) + 1, pb_string_data(&value));
+
+  /* Scan nested message */
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_scan_path(&descriptor, &buffer, host, 1, &value));
+  ck_assert_uint_eq(3, pb_string_size(&value));
+
+  /* Free all allocated memory */
+  pb_buffer_destroy(&buffer);
+} END_TEST
+
+/*
+ * Scan a message for a value along an invalid path.
+ */
+START_TEST(test_scan_invalid) {
+  const uint8_t data[] = { 21, 1, 2, 3, 4 };
+  pb_buffer_t buffer = pb_buffer_create(data, sizeof(data));
+
+  /* Scan unknown field and field within a non-message field */
+  pb_string_t value;
+  const pb_tag_t tags[] = { 2, 1, 3 };
+  ck_assert_uint_eq(PB_ERROR_INVALID,
+    pb_scan_path(&descriptor, &buffer, &(tags[2]), 1, &value));
+  ck_assert_uint_eq(PB_ERROR_INVALID,
+    pb_scan_path(&descriptor, &buffer, tags, 2, &value));
+
+  /* Scan absent field */
+  ck_assert_uint_eq(PB_ERROR_ABSENT,
+    pb_scan_path(&descriptor, &buffer, &(tags[1]), 1, &value));
+
+  /* Free all allocated memory */
+  pb_buffer_destroy(&buffer);
+} END_TEST
+
+/*
+ * Scan a truncated message for a value.
+ */
+START_TEST(test_scan_truncated) {
+  const uint8_t data[] = { 10, 6, 10, 4, 'h', 'o' };
+  pb_buffer_t buffer = pb_buffer_create(data, sizeof(data));
+
+  /* Scan string in nested message */
+  pb_string_t value;
+  const pb_tag_t tags[] = { 1, 1 };
+  ck_assert_uint_eq(PB_ERROR_OFFSET,
+    pb_scan_path(&descriptor, &buffer, tags, 2, &value));
+
+  /* Free all allocated memory */
+  pb_buffer_destroy(&buffer);
+} END_TEST
+
+/*
+ * Test whether the value of a field along a path matches.
+ */
+START_TEST(test_matches) {
+  const uint8_t data[] = { 10, 6, 10, 4, 'h', 'o', 's', 't' };
+  pb_buffer_t buffer = pb_buffer_create(data, sizeof(data));
+
+  /* Match string in nested message */
+  const pb_tag_t tags[] = { 1, 1 };
+  pb_string_t host  = pb_string_init_from_chars("host"),
+              hosts = pb_string_init_from_chars("hosts"),
+              other = pb_string_init_from_chars("HOST");
+  fail_unless(pb_scan_path_matches(&descriptor, &buffer, tags, 2, &host));
+  fail_if(pb_scan_path_matches(&descriptor, &buffer, tags, 2, &hosts));
+  fail_if(pb_scan_path_matches(&descriptor, &buffer, tags, 2, &other));
+
+  /* Free all allocated memory */
+  pb_buffer_destroy(&buffer);
+} END_TEST
+
+/* ----------------------------------------------------------------------------
+ * Program
+ * ------------------------------------------------------------------------- */
+
+/*
+ * Create a test suite for all registered test cases and run it.
+ *
+ * Tests must be run sequentially (in no-fork mode) or code coverage
+ * cannot be determined properly.
+ */
+int
+main(void) {
+  void *suite = suite_create("protobluff/core/scan"),
+       *tcase = NULL;
+
+  /* Add tests to test case "scan" */
+  tcase = tcase_create("scan");
+  tcase_add_test(tcase, test_scan);
+  tcase_add_test(tcase, test_scan_invalid);
+  tcase_add_test(tcase, test_scan_truncated);
+  tcase_add_test(tcase, test_matches);
+  suite_add_tcase(suite, tcase);
+
+  /* Create a test suite runner in no-fork mode */
+  void *runner = srunner_create(suite);
+  srunner_set_fork_status(runner, CK_NOFORK);
+
+  /* Execute test suite runner */
+  srunner_run_all(runner, CK_NORMAL);
+  int failed = srunner_ntests_failed(runner);
+  srunner_free(runner);
+
+  /* Exit with status code */
+  return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,330 @@
+/*
+ * Copyright (c) 2013-2020 Martin Donath <martin.donath@squidfunk.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <check.h>
+#include <pthread.h>
+#include <stdlib.h>
+
+#include <protobluff/descriptor.h>
+
+#include "core/common.h"
+#include "core/descriptor.h"
+#include "core/stats.h"
+
+/* ----------------------------------------------------------------------------
+ * Descriptors
+ * ------------------------------------------------------------------------- */
+
+/* Descriptor */
+static pb_descriptor_t
+descriptor = { {
+  (const pb_field_descriptor_t []){
+    {  1, "F01", UINT32, OPTIONAL }
+  }, 1 } };
+
+/* Descriptor with multiple fields */
+static pb_descriptor_t
+descriptor_fields = { {
+  (const pb_field_descriptor_t []){
+    {  1, "F01", UINT32, OPTIONAL },
+    {  2, "F02", UINT32, REPEATED }
+  }, 2 } };
+
+/* Descriptor of other message */
+static pb_descriptor_t
+descriptor_other = { {
+  (const pb_field_descriptor_t []){
+    {  1, "F01", UINT64, OPTIONAL }
+  }, 1 } };
+
+/* ----------------------------------------------------------------------------
+ * Helper functions
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Count up the counters of the calling thread and exit.
+ *
+ * \param[in,out] data Thread data
+ * \return             Thread result
+ */
+static void *
+count(void *data) {
+  pb_stats_t *stats = pb_stats_local();
+  for (size_t i = 0; i < 1000; i++) {
+    stats->adjustments++;
+    stats->moved += 2;
+  }
+  return data;
+}
+
+/*!
+ * Time operations on the calling thread and exit.
+ *
+ * \param[in,out] data Thread data
+ * \return             Thread result
+ */
+static void *
+measure(void *data) {
+  for (size_t i = 0; i < 100; i++) {
+    pb_stats_timer_t timer =
+      pb_stats_timer_start(PB_STATS_CURSOR_NEXT, &descriptor);
+    pb_stats_timer_stop(&timer);
+  }
+  return data;
+}
+
+/* ----------------------------------------------------------------------------
+ * Tests
+ * ------------------------------------------------------------------------- */
+
+/*
+ * Retrieve the counters of the calling thread.
+ */
+START_TEST(test_get) {
+  pb_stats_reset();
+  pb_stats_t *stats = pb_stats_local();
+  ck_assert_ptr_eq(stats, pb_stats_local());
+  stats->replayed += 3;
+  stats->resizes  += 5;
+
+  /* Assert counters */
+  pb_stats_t total = pb_stats_get();
+  ck_assert_uint_eq(0, total.adjustments);
+  ck_assert_uint_eq(0, total.moved);
+  ck_assert_uint_eq(3, total.replayed);
+  ck_assert_uint_eq(5, total.resizes);
+} END_TEST
+
+/*
+ * Reset the counters of all threads.
+ */
+START_TEST(test_reset) {
+  pb_stats_local()->replayed += 3;
+  pb_stats_reset();
+  pb_stats_local()->replayed += 2;
+
+  /* Assert counters */
+  pb_stats_t total = pb_stats_get();
+  ck_assert_uint_eq(2, total.replayed);
+  pb_stats_reset();
+  total = pb_stats_get();
+  ck_assert_uint_eq(0, total.replayed);
+} END_TEST
+
+/*
+ * Aggregate the counters of exited threads.
+ */
+START_TEST(test_threads) {
+  pb_stats_reset();
+  pthread_t threads[4];
+  for (size_t t = 0; t < 4; t++)
+    ck_assert_uint_eq(0, pthread_create(&(threads[t]), NULL, count, NULL));
+  for (size_t t = 0; t < 4; t++)
+    ck_assert_uint_eq(0, pthread_join(threads[t], NULL));
+
+  /* Assert counters */
+  pb_stats_t total = pb_stats_get();
+  ck_assert_uint_eq(4000, total.adjustments);
+  ck_assert_uint_eq(8000, total.moved);
+
+  /* Assert counters after reset */
+  pb_stats_reset();
+  total = pb_stats_get();
+  ck_assert_uint_eq(0, total.adjustments);
+  ck_assert_uint_eq(0, total.moved);
+} END_TEST
+
+/*
+ * Map latencies to log-linear buckets.
+ */
+START_TEST(test_bucket) {
+  for (uint64_t value = 0; value < 4; value++)
+    ck_assert_uint_eq(value, pb_stats_bucket(value));
+  ck_assert_uint_eq(4,  pb_stats_bucket(4));
+  ck_assert_uint_eq(7,  pb_stats_bucket(7));
+  ck_assert_uint_eq(8,  pb_stats_bucket(8));
+  ck_assert_uint_eq(8,  pb_stats_bucket(9));
+  ck_assert_uint_eq(11, pb_stats_bucket(15));
+  ck_assert_uint_eq(PB_STATS_BUCKETS - 1, pb_stats_bucket(UINT64_MAX));
+
+  /* Assert lower bounds of buckets */
+  for (size_t bucket = 0; bucket < PB_STATS_BUCKETS; bucket++) {
+    uint64_t value = pb_stats_bucket_value(bucket);
+    ck_assert_uint_eq(bucket, pb_stats_bucket(value));
+    if (bucket)
+      ck_assert_uint_eq(bucket - 1, pb_stats_bucket(value - 1));
+  }
+} END_TEST
+
+/*
+ * Retrieve percentiles of a latency histogram.
+ */
+START_TEST(test_percentile) {
+  pb_stats_histogram_t histogram = { 0 };
+  ck_assert_uint_eq(0, pb_stats_percentile(&histogram, 50));
+  for (uint64_t value = 1; value <= 100; value++) {
+    histogram.bucket[pb_stats_bucket(value)]++;
+    histogram.count++;
+  }
+
+  /* Assert percentiles within relative error */
+  ck_assert_uint_eq(1,  pb_stats_percentile(&histogram, 0));
+  ck_assert_uint_eq(48, pb_stats_percentile(&histogram, 50));
+  ck_assert_uint_eq(96, pb_stats_percentile(&histogram, 99));
+  ck_assert_uint_eq(96, pb_stats_percentile(&histogram, 100));
+} END_TEST
+
+/*
+ * Record sampled latencies per operation and descriptor.
+ */
+START_TEST(test_histogram) {
+  pb_stats_reset();
+  pb_stats_sampling(2);
+  for (size_t i = 0; i < 10; i++) {
+    pb_stats_timer_t timer =
+      pb_stats_timer_start(PB_STATS_MESSAGE_GET, &descriptor);
+    pb_stats_timer_stop(&timer);
+  }
+  for (size_t i = 0; i < 4; i++) {
+    pb_stats_timer_t timer =
+      pb_stats_timer_start(PB_STATS_MESSAGE_GET, &descriptor_other);
+    pb_stats_timer_stop(&timer);
+  }
+  pb_stats_sampling(0);
+
+  /* Assert sampled operations */
+  pb_stats_histogram_t histogram =
+    pb_stats_histogram(PB_STATS_MESSAGE_GET, &descriptor);
+  ck_assert_uint_eq(5, histogram.count);
+  histogram = pb_stats_histogram(PB_STATS_MESSAGE_GET, &descriptor_other);
+  ck_assert_uint_eq(2, histogram.count);
+  histogram = pb_stats_histogram(PB_STATS_MESSAGE_GET, NULL);
+  ck_assert_uint_eq(7, histogram.count);
+  histogram = pb_stats_histogram(PB_STATS_MESSAGE_PUT, NULL);
+  ck_assert_uint_eq(0, histogram.count);
+
+  /* Assert histograms after reset */
+  pb_stats_reset();
+  histogram = pb_stats_histogram(PB_STATS_MESSAGE_GET, NULL);
+  ck_assert_uint_eq(0, histogram.count);
+} END_TEST
+
+/*
+ * Retain latency histograms of exited threads.
+ */
+START_TEST(test_histogram_threads) {
+  pb_stats_reset();
+  pb_stats_sampling(1);
+  pthread_t threads[4];
+  for (size_t t = 0; t < 4; t++)
+    ck_assert_uint_eq(0, pthread_create(&(threads[t]), NULL, measure, NULL));
+  for (size_t t = 0; t < 4; t++)
+    ck_assert_uint_eq(0, pthread_join(threads[t], NULL));
+  pb_stats_sampling(0);
+
+  /* Assert sampled operations */
+  pb_stats_histogram_t histogram =
+    pb_stats_histogram(PB_STATS_CURSOR_NEXT, &descriptor);
+  ck_assert_uint_eq(400, histogram.count);
+  pb_stats_reset();
+} END_TEST
+
+/*
+ * Profile the fields of sampled messages.
+ */
+START_TEST(test_fields) {
+  pb_stats_reset();
+  uint64_t count[2];
+  ck_assert_uint_eq(0, pb_stats_fields(&descriptor_fields, count));
+  ck_assert_ptr_eq(NULL, pb_stats_profile_start(&descriptor_fields));
+
+  /* Profile every second message */
+  pb_stats_sampling(2);
+  for (size_t i = 0; i < 10; i++) {
+    uint64_t *field = pb_stats_profile_start(&descriptor_fields);
+    if (field) {
+      field[0]++;
+      field[1] += 3;
+    }
+  }
+  pb_stats_sampling(0);
+
+  /* Assert occurrences */
+  ck_assert_uint_eq(5, pb_stats_fields(&descriptor_fields, count));
+  ck_assert_uint_eq(5,  count[0]);
+  ck_assert_uint_eq(15, count[1]);
+  ck_assert_uint_eq(0, pb_stats_fields(&descriptor, count));
+
+  /* Assert occurrences after reset */
+  pb_stats_reset();
+  ck_assert_uint_eq(0, pb_stats_fields(&descriptor_fields, count));
+  ck_assert_uint_eq(0, count[0]);
+  ck_assert_uint_eq(0, count[1]);
+} END_TEST
+
+/* ----------------------------------------------------------------------------
+ * Program
+ * ------------------------------------------------------------------------- */
+
+/*
+ * Create a test suite for all registered test cases and run it.
+ *
+ * Tests must be run sequentially (in no-fork mode) or code coverage
+ * cannot be determined properly.
+ */
+int
+main(void) {
+  void *suite = suite_create("protobluff/core/stats"),
+       *tcase = NULL;
+
+  /* Add tests to test case "stats" */
+  tcase = tcase_create("stats");
+  tcase_add_test(tcase, test_get);
+  tcase_add_test(tcase, test_reset);
+  tcase_add_test(tcase, test_threads);
+  suite_add_tcase(suite, tcase);
+
+  /* Add tests to test case "histogram" */
+  tcase = tcase_create("histogram");
+  tcase_add_test(tcase, test_bucket);
+  tcase_add_test(tcase, test_percentile);
+  tcase_add_test(tcase, test_histogram);
+  tcase_add_test(tcase, test_histogram_threads);
+  suite_add_tcase(suite, tcase);
+
+  /* Add tests to test case "profile" */
+  tcase = tcase_create("profile");
+  tcase_add_test(tcase, test_fields);
+  suite_add_tcase(suite, tcase);
+
+  /* Create a test suite runner in no-fork mode */
+  void *runner = srunner_create(suite);
+  srunner_set_fork_status(runner, CK_NOFORK);
+
+  /* Execute test suite runner */
+  srunner_run_all(runner, CK_NORMAL);
+  int failed = srunner_ntests_failed(runner);
+  srunner_free(runner);
+
+  /* Exit with status code */
+  return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
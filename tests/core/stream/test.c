@@ -23,6 +23,7 @@
 #include <check.h>
 #include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "core/buffer.h"
 #include "core/common.h"
@@ -637,6 +638,187 @@ START_TEST(test_read_32bit_underrun) {
   pb_buffer_destroy(&buffer);
 } END_TEST
 
+/*
+ * Read values of different types before and after the end of the slop area.
+ */
+START_TEST(test_read_slop) {
+  const uint8_t data[] = { 8, 172, 2, 1, 2, 3, 4, 3, 97, 98, 99,
+                           5, 6, 7, 8, 200, 1 };
+  const size_t  size   = 17;
+
+  /* Create buffer and stream */
+  pb_buffer_t buffer = pb_buffer_create(data, size);
+  pb_stream_t stream = pb_stream_create(&buffer);
+
+  /* Read a single-byte and a multi-byte variable-sized integer */
+  uint32_t value;
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_stream_read(&stream, PB_TYPE_UINT32, &value));
+  ck_assert_uint_eq(8, value);
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_stream_read(&stream, PB_TYPE_UINT32, &value));
+  ck_assert_uint_eq(300, value);
+
+  /* Read a fixed-sized 32-bit value and a length-prefixed value */
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_stream_read(&stream, PB_TYPE_FIXED32, &value));
+  ck_assert_uint_eq(0x04030201, value);
+  pb_string_t string;
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_stream_read(&stream, PB_TYPE_STRING, &string));
+  ck_assert_uint_eq(3, pb_string_size(&string));
+  fail_if(memcmp("abc", pb_string_data(&string), 3));
+
+  /* Read values near the end of the buffer */
+  ck_assert_uint_eq(6, pb_stream_left(&stream));
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_stream_read(&stream, PB_TYPE_FIXED32, &value));
+  ck_assert_uint_eq(0x08070605, value);
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_stream_read(&stream, PB_TYPE_UINT32, &value));
+  ck_assert_uint_eq(200, value);
+
+  /* Assert stream size and offset */
+  ck_assert_uint_eq(17, pb_stream_offset(&stream));
+  ck_assert_uint_eq(0, pb_stream_left(&stream));
+
+  /* Free all allocated memory */
+  pb_stream_destroy(&stream);
+  pb_buffer_destroy(&buffer);
+} END_TEST
+
+/*
+ * Read an invalid variable-sized integer within the slop area.
+ */
+START_TEST(test_read_slop_varint_invalid) {
+  const uint8_t data[] = { 255, 255, 255, 255, 255, 255, 255, 255,
+                           255, 255, 255, 1 };
+  const size_t  size   = 12;
+
+  /* Create buffer and stream */
+  pb_buffer_t buffer = pb_buffer_create(data, size);
+  pb_stream_t stream = pb_stream_create(&buffer);
+
+  /* Read a variable-sized integer */
+  uint64_t value;
+  ck_assert_uint_eq(PB_ERROR_VARINT,
+    pb_stream_read(&stream, PB_TYPE_UINT64, &value));
+
+  /* Assert stream size and offset */
+  ck_assert_uint_eq(0, pb_stream_offset(&stream));
+  ck_assert_uint_eq(12, pb_stream_left(&stream));
+
+  /* Free all allocated memory */
+  pb_stream_destroy(&stream);
+  pb_buffer_destroy(&buffer);
+} END_TEST
+
+/*
+ * Read a length-prefixed value exceeding the buffer within the slop area.
+ */
+START_TEST(test_read_slop_length_underrun) {
+  const uint8_t data[] = { 16, 97, 98, 99, 100, 101, 102, 103,
+                           104, 105, 106, 107 };
+  const size_t  size   = 12;
+
+  /* Create buffer and stream */
+  pb_buffer_t buffer = pb_buffer_create(data, size);
+  pb_stream_t stream = pb_stream_create(&buffer);
+
+  /* Read a length-prefixed value */
+  pb_string_t value;
+  ck_assert_uint_eq(PB_ERROR_OFFSET,
+    pb_stream_read(&stream, PB_TYPE_BYTES, &value));
+
+  /* Assert stream size and offset */
+  ck_assert_uint_eq(0, pb_stream_offset(&stream));
+  ck_assert_uint_eq(12, pb_stream_left(&stream));
+
+  /* Free all allocated memory */
+  pb_stream_destroy(&stream);
+  pb_buffer_destroy(&buffer);
+} END_TEST
+
+/*
+ * Read values of different types using type-specialized readers.
+ */
+START_TEST(test_read_typed) {
+  const uint8_t data[] = { 172, 2, 3, 1, 2, 3, 4, 5, 6, 7, 8, 3, 97, 98, 99 };
+  const size_t  size   = 15;
+
+  /* Create buffer and stream */
+  pb_buffer_t buffer = pb_buffer_create(data, size);
+  pb_stream_t stream = pb_stream_create(&buffer);
+
+  /* Destination fitting the widest reader, as the type is not always folded */
+  union {
+    uint32_t    uint32;
+    int32_t     int32;
+    uint64_t    uint64;
+    pb_string_t string;
+  } value;
+
+  /* Read variable-sized integers */
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_stream_read_typed(&stream, PB_TYPE_UINT32, &(value.uint32)));
+  ck_assert_uint_eq(300, value.uint32);
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_stream_read_typed(&stream, PB_TYPE_SINT32, &(value.int32)));
+  ck_assert_int_eq(-2, value.int32);
+
+  /* Read a fixed-sized 64-bit value */
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_stream_read_typed(&stream, PB_TYPE_FIXED64, &(value.uint64)));
+  ck_assert_uint_eq(0x0807060504030201ULL, value.uint64);
+
+  /* Read a length-prefixed value */
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_stream_read_typed(&stream, PB_TYPE_STRING, &(value.string)));
+  ck_assert_uint_eq(3, pb_string_size(&(value.string)));
+  fail_if(memcmp("abc", pb_string_data(&(value.string)), 3));
+
+  /* Assert stream size and offset */
+  ck_assert_uint_eq(15, pb_stream_offset(&stream));
+  ck_assert_uint_eq(0, pb_stream_left(&stream));
+
+  /* Free all allocated memory */
+  pb_stream_destroy(&stream);
+  pb_buffer_destroy(&buffer);
+} END_TEST
+
+/*
+ * Read values exceeding the buffer using type-specialized readers.
+ */
+START_TEST(test_read_typed_underrun) {
+  const uint8_t data[] = { 4, 97, 98, 128 };
+  const size_t  size   = 4;
+
+  /* Create buffer and stream */
+  pb_buffer_t buffer = pb_buffer_create(data, size);
+  pb_stream_t stream = pb_stream_create(&buffer);
+
+  /* Read a length-prefixed and a fixed-sized value */
+  pb_string_t string;
+  ck_assert_uint_eq(PB_ERROR_OFFSET,
+    pb_stream_read_typed(&stream, PB_TYPE_BYTES, &string));
+  uint64_t value;
+  ck_assert_uint_eq(PB_ERROR_OFFSET,
+    pb_stream_read_typed(&stream, PB_TYPE_DOUBLE, &value));
+
+  /* Read an incomplete variable-sized integer */
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_stream_advance(&stream, 3));
+  ck_assert_uint_eq(PB_ERROR_VARINT,
+    pb_stream_read_typed(&stream, PB_TYPE_UINT64, &value));
+
+  /* Assert stream size and offset */
+  ck_assert_uint_eq(3, pb_stream_offset(&stream));
+  ck_assert_uint_eq(1, pb_stream_left(&stream));
+
+  /* Free all allocated memory */
+  pb_stream_destroy(&stream);
+  pb_buffer_destroy(&buffer);
+} END_TEST
+
 /*
  * Skip a value of given wiretype.
  */
@@ -968,6 +1150,11 @@ main(void) {
   tcase_add_test(tcase, test_read_32bit);
   tcase_add_test(tcase, test_read_32bit_repeated);
   tcase_add_test(tcase, test_read_32bit_underrun);
+  tcase_add_test(tcase, test_read_slop);
+  tcase_add_test(tcase, test_read_slop_varint_invalid);
+  tcase_add_test(tcase, test_read_slop_length_underrun);
+  tcase_add_test(tcase, test_read_typed);
+  tcase_add_test(tcase, test_read_typed_underrun);
   suite_add_tcase(suite, tcase);
 
   /* Add tests to test case "skip" */
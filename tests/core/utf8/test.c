@@ -0,0 +1,150 @@
+/*
+ * Copyright (c) 2013-2020 Martin Donath <martin.donath@squidfunk.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <check.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "core/common.h"
+#include "core/utf8.h"
+
+/* ----------------------------------------------------------------------------
+ * Tests
+ * ------------------------------------------------------------------------- */
+
+/*
+ * Check a sequence of ASCII characters.
+ */
+START_TEST(test_valid_ascii) {
+  const char *data = "Lorem ipsum dolor sit amet, consectetur";
+  ck_assert(pb_utf8_valid((const uint8_t *)data, strlen(data)));
+
+  /* Assert empty sequence */
+  ck_assert(pb_utf8_valid(NULL, 0));
+} END_TEST
+
+/*
+ * Check a sequence of multi-byte characters.
+ */
+START_TEST(test_valid_multibyte) {
+  const uint8_t data[] = {
+    0xC2, 0x80, 0xDF, 0xBF,                                   /* 2 bytes */
+    0xE0, 0xA0, 0x80, 0xED, 0x9F, 0xBF, 0xEF, 0xBF, 0xBF,     /* 3 bytes */
+    0xF0, 0x90, 0x80, 0x80, 0xF4, 0x8F, 0xBF, 0xBF,           /* 4 bytes */
+    'L', 'o', 'r', 'e', 'm', ' ', 'i', 'p', 's', 'u', 'm'
+  };
+  ck_assert(pb_utf8_valid(data, sizeof(data)));
+} END_TEST
+
+/*
+ * Check a sequence of ASCII characters followed by a multi-byte character.
+ */
+START_TEST(test_valid_mixed) {
+  const uint8_t data[] = {
+    'L', 'o', 'r', 'e', 'm', ' ', 'i', 'p', 's', 'u', 'm', 0xC3, 0xA4
+  };
+  ck_assert(pb_utf8_valid(data, sizeof(data)));
+
+  /* Assert invalid continuation byte after ASCII characters */
+  const uint8_t invalid[] = {
+    'L', 'o', 'r', 'e', 'm', ' ', 'i', 'p', 's', 'u', 'm', 0xC3, 'a'
+  };
+  ck_assert(!pb_utf8_valid(invalid, sizeof(invalid)));
+} END_TEST
+
+/*
+ * Check sequences of invalid leading bytes.
+ */
+START_TEST(test_invalid_leading) {
+  const uint8_t data[][1] = { { 0x80 }, { 0xBF }, { 0xC0 }, { 0xC1 },
+                              { 0xF5 }, { 0xFF } };
+  for (size_t d = 0; d < sizeof(data) / sizeof(data[0]); d++)
+    ck_assert(!pb_utf8_valid(data[d], 1));
+} END_TEST
+
+/*
+ * Check sequences of overlong encodings, surrogates and large code points.
+ */
+START_TEST(test_invalid_range) {
+  const uint8_t data[][4] = {
+    { 0xE0, 0x9F, 0xBF },                                     /* Overlong */
+    { 0xF0, 0x8F, 0xBF, 0xBF },                               /* Overlong */
+    { 0xED, 0xA0, 0x80 },                                     /* Surrogate */
+    { 0xF4, 0x90, 0x80, 0x80 }                                /* > U+10FFFF */
+  };
+  ck_assert(!pb_utf8_valid(data[0], 3));
+  ck_assert(!pb_utf8_valid(data[1], 4));
+  ck_assert(!pb_utf8_valid(data[2], 3));
+  ck_assert(!pb_utf8_valid(data[3], 4));
+} END_TEST
+
+/*
+ * Check sequences of truncated multi-byte characters.
+ */
+START_TEST(test_invalid_truncated) {
+  const uint8_t data[] = { 0xF0, 0x90, 0x80, 0x80 };
+  for (size_t size = 1; size < sizeof(data); size++)
+    ck_assert(!pb_utf8_valid(data, size));
+
+  /* Assert invalid continuation bytes */
+  const uint8_t invalid[] = { 0xF0, 0x90, 0x80, 0x7F };
+  ck_assert(!pb_utf8_valid(invalid, sizeof(invalid)));
+} END_TEST
+
+/* ----------------------------------------------------------------------------
+ * Program
+ * ------------------------------------------------------------------------- */
+
+/*
+ * Create a test suite for all registered test cases and run it.
+ *
+ * Tests must be run sequentially (in no-fork mode) or code coverage
+ * cannot be determined properly.
+ */
+int
+main(void) {
+  void *suite = suite_create("protobluff/core/utf8"),
+       *tcase = NULL;
+
+  /* Add tests to test case "valid" */
+  tcase = tcase_create("valid");
+  tcase_add_test(tcase, test_valid_ascii);
+  tcase_add_test(tcase, test_valid_multibyte);
+  tcase_add_test(tcase, test_valid_mixed);
+  tcase_add_test(tcase, test_invalid_leading);
+  tcase_add_test(tcase, test_invalid_range);
+  tcase_add_test(tcase, test_invalid_truncated);
+  suite_add_tcase(suite, tcase);
+
+  /* Create a test suite runner in no-fork mode */
+  void *runner = srunner_create(suite);
+  srunner_set_fork_status(runner, CK_NOFORK);
+
+  /* Execute test suite runner */
+  srunner_run_all(runner, CK_NORMAL);
+  int failed = srunner_ntests_failed(runner);
+  srunner_free(runner);
+
+  /* Exit with status code */
+  return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -23,10 +23,51 @@
 #include <check.h>
 #include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "core/common.h"
 #include "core/varint.h"
 
+/* ----------------------------------------------------------------------------
+ * Helper functions
+ * ------------------------------------------------------------------------- */
+
+/*
+ * Fill arrays of all widths with values of all packed sizes, starting with
+ * values that fit into a single byte, and including negative values.
+ */
+static void
+values_fill(
+    uint64_t values64[], uint32_t values32[], uint8_t values8[],
+    size_t size) {
+  for (size_t v = 0; v < size; v++) {
+    uint64_t value = v < 24
+      ? v * 5
+      : (uint64_t)1 << (v * 7 % 64) | v;
+    if (v % 5 == 4)
+      value = -value;
+    values64[v] = value;
+    values32[v] = (uint32_t)(v % 7 == 3 ? value >> 32 : value);
+    values8[v]  = (uint8_t)value;
+  }
+}
+
+/*
+ * Assert that packing an array of variable-sized integers at once yields the
+ * same result as packing the values one after another.
+ */
+static void
+values_assert(pb_type_t type, const void *values, size_t item, size_t size) {
+  uint8_t check[1024], data[1024];
+  size_t length = 0;
+  for (size_t v = 0; v < size; v++)
+    length += pb_varint_pack(type, &(check[length]),
+      (const uint8_t *)values + v * item);
+  ck_assert_uint_eq(length, pb_varint_size_all(type, values, size));
+  ck_assert_uint_eq(length, pb_varint_pack_all(type, data, values, size));
+  fail_if(memcmp(check, data, length));
+}
+
 /* ----------------------------------------------------------------------------
  * Tests
  * ------------------------------------------------------------------------- */
@@ -439,6 +480,19 @@ START_TEST(test_size) {
   ck_assert_uint_eq(1, pb_varint_size(PB_TYPE_UINT32, &value));
 } END_TEST
 
+/*
+ * Retrieve the packed size of arrays of variable-sized integers.
+ */
+START_TEST(test_size_all) {
+  uint64_t values64[4] = { 0, 127, 128, UINT64_MAX };
+  uint32_t values32[5] = { 0, 127, 128, 1 << 28, UINT32_MAX };
+  ck_assert_uint_eq(0, pb_varint_size_all(PB_TYPE_UINT32, values32, 0));
+  ck_assert_uint_eq(14, pb_varint_size_all(PB_TYPE_UINT64, values64, 4));
+  ck_assert_uint_eq(14, pb_varint_size_all(PB_TYPE_UINT32, values32, 5));
+  ck_assert_uint_eq(19, pb_varint_size_all(PB_TYPE_INT32, values32, 5));
+  ck_assert_uint_eq(11, pb_varint_size_all(PB_TYPE_SINT32, values32, 5));
+} END_TEST
+
 /* ------------------------------------------------------------------------- */
 
 /*
@@ -875,6 +929,83 @@ START_TEST(test_pack) {
   ck_assert_uint_eq(1, pb_varint_pack(PB_TYPE_UINT32, data, &value));
 } END_TEST
 
+/*
+ * Pack arrays of variable-sized integers of all types.
+ */
+START_TEST(test_pack_all) {
+  uint64_t values64[83]; uint32_t values32[83]; uint8_t values8[83];
+  values_fill(values64, values32, values8, 83);
+  size_t sizes[] = { 0, 1, 7, 8, 9, 16, 17, 31, 64, 83 };
+  for (size_t z = 0; z < sizeof(sizes) / sizeof(*sizes); z++) {
+    size_t s = sizes[z];
+    values_assert(PB_TYPE_INT32,  values32, 4, s);
+    values_assert(PB_TYPE_INT64,  values64, 8, s);
+    values_assert(PB_TYPE_UINT32, values32, 4, s);
+    values_assert(PB_TYPE_UINT64, values64, 8, s);
+    values_assert(PB_TYPE_SINT32, values32, 4, s);
+    values_assert(PB_TYPE_SINT64, values64, 8, s);
+    values_assert(PB_TYPE_BOOL,   values8,  1, s);
+    values_assert(PB_TYPE_ENUM,   values32, 4, s);
+  }
+} END_TEST
+
+/*
+ * Pack unsigned 32-bit variable-sized integers padded to their maximum size.
+ */
+START_TEST(test_pack_padded_uint32) {
+  uint8_t data[5];
+  for (size_t s = 0; s < 32; s++) {
+    uint32_t value = (uint32_t)1 << s | s;
+
+    /* Pack value into buffer */
+    ck_assert_uint_eq(5, pb_varint_size_padded(PB_TYPE_UINT32, &value));
+    ck_assert_uint_eq(5, pb_varint_pack_padded(PB_TYPE_UINT32, data, &value));
+
+    /* Unpack value from buffer */
+    uint32_t check = 0;
+    ck_assert_uint_eq(5, pb_varint_unpack_uint32(data, 5, &check));
+    ck_assert_uint_eq(value, check);
+  }
+} END_TEST
+
+/*
+ * Pack an unsigned 64-bit variable-sized integer padded to its maximum size.
+ */
+START_TEST(test_pack_padded_uint64) {
+  const uint8_t check[] = { 255, 128, 128, 128, 128, 128, 128, 128, 128, 0 };
+  uint8_t data[10];
+
+  /* Pack value into buffer */
+  uint64_t value = 127;
+  ck_assert_uint_eq(10, pb_varint_size_padded(PB_TYPE_UINT64, &value));
+  ck_assert_uint_eq(10, pb_varint_pack_padded(PB_TYPE_UINT64, data, &value));
+  fail_if(memcmp(check, data, 10));
+} END_TEST
+
+/*
+ * Pack a negative signed 32-bit variable-sized integer, which is never padded.
+ */
+START_TEST(test_pack_padded_int32_negative) {
+  uint8_t data[10];
+
+  /* Pack value into buffer */
+  int32_t value = -1;
+  ck_assert_uint_eq(10, pb_varint_size_padded(PB_TYPE_INT32, &value));
+  ck_assert_uint_eq(10, pb_varint_pack_padded(PB_TYPE_INT32, data, &value));
+} END_TEST
+
+/*
+ * Pack a boolean variable-sized integer, which is never padded.
+ */
+START_TEST(test_pack_padded_bool) {
+  uint8_t data[1];
+
+  /* Pack value into buffer */
+  uint8_t value = 1;
+  ck_assert_uint_eq(1, pb_varint_size_padded(PB_TYPE_BOOL, &value));
+  ck_assert_uint_eq(1, pb_varint_pack_padded(PB_TYPE_BOOL, data, &value));
+} END_TEST
+
 /* ------------------------------------------------------------------------- */
 
 /*
@@ -888,6 +1019,37 @@ START_TEST(test_scan) {
   fail_unless(pb_varint_scan(data, size));
 } END_TEST
 
+/*
+ * Scan buffers of all sizes for variable-sized integers of all lengths.
+ */
+START_TEST(test_scan_lengths) {
+  uint8_t data[32];
+
+  /* Assert lengths of integers with and without enough bytes left */
+  for (size_t length = 1; length <= 10; length++) {
+    memset(data, 0x80, sizeof(data));
+    data[length - 1] = 1;
+    for (size_t size = 1; size <= sizeof(data); size++)
+      ck_assert_uint_eq(size >= length ? length : 0,
+        pb_varint_scan(data, size));
+  }
+} END_TEST
+
+/*
+ * Scan a buffer ending right after a variable-sized integer.
+ */
+START_TEST(test_scan_end) {
+  const uint8_t data[] = { 255, 255, 255, 127 };
+  const size_t  size   = 4;
+
+  /* Copy data into an exactly-sized allocation, so over-reads are caught */
+  uint8_t *temp = malloc(size);
+  memcpy(temp, data, size);
+  ck_assert_uint_eq(4, pb_varint_scan(temp, size));
+  ck_assert_uint_eq(0, pb_varint_scan(temp, size - 1));
+  free(temp);
+} END_TEST
+
 /*
  * Scan a buffer for an invalid variable-sized integer.
  */
@@ -1089,6 +1251,37 @@ START_TEST(test_unpack_uint32_invalid) {
   ck_assert_uint_eq(0, pb_varint_unpack_uint32(data, 5, &check));
 } END_TEST
 
+/*
+ * Unpack unsigned 32-bit variable-sized integers from a padded buffer.
+ */
+START_TEST(test_unpack_uint32_padded) {
+  uint8_t data[16];
+  for (size_t s = 0; s < 32; s++) {
+    uint32_t value = (uint32_t)1 << s | s;
+
+    /* Pack value into zeroed buffer */
+    memset(data, 0, sizeof(data));
+    size_t size = pb_varint_pack_uint32(data, &value);
+
+    /* Unpack value from buffer */
+    uint32_t check = 0;
+    ck_assert_uint_eq(size, pb_varint_unpack_uint32(data, 16, &check));
+    ck_assert_uint_eq(value, check);
+  }
+} END_TEST
+
+/*
+ * Unpack an invalid unsigned 32-bit variable-sized integer from a padded
+ * buffer, requiring a fallback from the word-at-a-time version.
+ */
+START_TEST(test_unpack_uint32_padded_invalid) {
+  const uint8_t data[] = { 255, 255, 255, 255, 255, 1, 0, 0 };
+
+  /* Unpack value from buffer */
+  uint32_t check = 0;
+  ck_assert_uint_eq(0, pb_varint_unpack_uint32(data, 8, &check));
+} END_TEST
+
 /*
  * Unpack an unsigned 64-bit variable-sized integer.
  */
@@ -1136,6 +1329,25 @@ START_TEST(test_unpack_uint64_invalid) {
   ck_assert_uint_eq(0, pb_varint_unpack_uint64(data, 10, &check));
 } END_TEST
 
+/*
+ * Unpack unsigned 64-bit variable-sized integers from a padded buffer.
+ */
+START_TEST(test_unpack_uint64_padded) {
+  uint8_t data[16];
+  for (size_t s = 0; s < 64; s++) {
+    uint64_t value = (uint64_t)1 << s | s;
+
+    /* Pack value into zeroed buffer */
+    memset(data, 0, sizeof(data));
+    size_t size = pb_varint_pack_uint64(data, &value);
+
+    /* Unpack value from buffer */
+    uint64_t check = 0;
+    ck_assert_uint_eq(size, pb_varint_unpack_uint64(data, 16, &check));
+    ck_assert_uint_eq(value, check);
+  }
+} END_TEST
+
 /*
  * Unpack a signed 32-bit variable-sized integer in zig-zag encoding.
  */
@@ -1263,6 +1475,7 @@ main(void) {
   tcase_add_test(tcase, test_size_sint32);
   tcase_add_test(tcase, test_size_sint64);
   tcase_add_test(tcase, test_size);
+  tcase_add_test(tcase, test_size_all);
   suite_add_tcase(suite, tcase);
 
   /* Add tests to test case "pack" */
@@ -1289,11 +1502,18 @@ main(void) {
   tcase_add_test(tcase, test_pack_sint64_min);
   tcase_add_test(tcase, test_pack_sint64_max);
   tcase_add_test(tcase, test_pack);
+  tcase_add_test(tcase, test_pack_all);
+  tcase_add_test(tcase, test_pack_padded_uint32);
+  tcase_add_test(tcase, test_pack_padded_uint64);
+  tcase_add_test(tcase, test_pack_padded_int32_negative);
+  tcase_add_test(tcase, test_pack_padded_bool);
   suite_add_tcase(suite, tcase);
 
   /* Add tests to test case "scan" */
   tcase = tcase_create("scan");
   tcase_add_test(tcase, test_scan);
+  tcase_add_test(tcase, test_scan_lengths);
+  tcase_add_test(tcase, test_scan_end);
   tcase_add_test(tcase, test_scan_invalid);
   suite_add_tcase(suite, tcase);
 
@@ -1315,10 +1535,13 @@ main(void) {
   tcase_add_test(tcase, test_unpack_uint32_min);
   tcase_add_test(tcase, test_unpack_uint32_max);
   tcase_add_test(tcase, test_unpack_uint32_invalid);
+  tcase_add_test(tcase, test_unpack_uint32_padded);
+  tcase_add_test(tcase, test_unpack_uint32_padded_invalid);
   tcase_add_test(tcase, test_unpack_uint64);
   tcase_add_test(tcase, test_unpack_uint64_min);
   tcase_add_test(tcase, test_unpack_uint64_max);
   tcase_add_test(tcase, test_unpack_uint64_invalid);
+  tcase_add_test(tcase, test_unpack_uint64_padded);
   tcase_add_test(tcase, test_unpack_sint32);
   tcase_add_test(tcase, test_unpack_sint32_min);
   tcase_add_test(tcase, test_unpack_sint32_max);
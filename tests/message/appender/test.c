@@ -0,0 +1,314 @@
+/*
+ * Copyright (c) 2013-2020 Martin Donath <martin.donath@squidfunk.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <check.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <protobluff/descriptor.h>
+
+#include "message/appender.h"
+#include "message/common.h"
+#include "message/cursor.h"
+#include "message/journal.h"
+#include "message/message.h"
+
+/* ----------------------------------------------------------------------------
+ * Descriptors
+ * ------------------------------------------------------------------------- */
+
+/* Descriptor */
+static pb_descriptor_t
+descriptor = { {
+  (const pb_field_descriptor_t []){
+    {  1, "F01", UINT32,  REPEATED },
+    {  2, "F02", UINT64,  OPTIONAL },
+    {  3, "F03", UINT32,  REPEATED, NULL, NULL, PACKED },
+    {  4, "F04", STRING,  REPEATED },
+    { 11, "F11", MESSAGE, OPTIONAL, &descriptor },
+    { 12, "F12", MESSAGE, REPEATED, &descriptor }
+  }, 6 } };
+
+/* ----------------------------------------------------------------------------
+ * Tests
+ * ------------------------------------------------------------------------- */
+
+/*
+ * Create an appender for a repeated tag of a message.
+ */
+START_TEST(test_create) {
+  pb_journal_t  journal  = pb_journal_create_empty();
+  pb_message_t  message  = pb_message_create(&descriptor, &journal);
+  pb_appender_t appender = pb_appender_create(&message, 1);
+
+  /* Assert appender validity and tag */
+  fail_unless(pb_appender_valid(&appender));
+  ck_assert_uint_eq(1, pb_appender_tag(&appender));
+
+  /* Assert same locations */
+  ck_assert_ptr_eq(&journal,
+    pb_message_journal(pb_appender_message(&appender)));
+
+  /* Free all allocated memory */
+  pb_appender_destroy(&appender);
+  pb_message_destroy(&message);
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Create an appender for a repeated tag of an invalid message.
+ */
+START_TEST(test_create_invalid) {
+  pb_message_t  message  = pb_message_create_invalid();
+  pb_appender_t appender = pb_appender_create(&message, 1);
+
+  /* Assert appender validity */
+  fail_if(pb_appender_valid(&appender));
+
+  /* Free all allocated memory */
+  pb_appender_destroy(&appender);
+  pb_message_destroy(&message);
+} END_TEST
+
+/*
+ * Append values to a repeated field.
+ */
+START_TEST(test_put) {
+  const uint8_t data[] = { 16, 127 };
+  const size_t  size   = 2;
+
+  /* Create journal, message and appender */
+  pb_journal_t  journal  = pb_journal_create(data, size);
+  pb_message_t  message  = pb_message_create(&descriptor, &journal);
+  pb_appender_t appender = pb_appender_create(&message, 1);
+
+  /* Append values to repeated field */
+  for (uint32_t value = 1; value < 101; value++)
+    ck_assert_uint_eq(PB_ERROR_NONE, pb_appender_put(&appender, &value));
+
+  /* Assert journal size */
+  ck_assert_uint_eq(202, pb_journal_size(&journal));
+
+  /* Assert values in order */
+  pb_cursor_t cursor = pb_cursor_create(&message, 1);
+  for (uint32_t v = 1; v < 101; v++, pb_cursor_next(&cursor)) {
+    uint32_t value;
+    ck_assert_uint_eq(PB_ERROR_NONE, pb_cursor_get(&cursor, &value));
+    ck_assert_uint_eq(v, value);
+  }
+  fail_if(pb_cursor_valid(&cursor));
+  pb_cursor_destroy(&cursor);
+
+  /* Assert elements in front of other fields */
+  ck_assert_uint_eq(8, pb_journal_data(&journal)[0]);
+  ck_assert_uint_eq(16, pb_journal_data(&journal)[200]);
+
+  /* Free all allocated memory */
+  pb_appender_destroy(&appender);
+  pb_message_destroy(&message);
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Append values to a packed field.
+ */
+START_TEST(test_put_packed) {
+  const uint8_t data[] = { 26, 1, 1, 34, 0 };
+  const size_t  size   = 5;
+
+  /* Create journal, message and appender */
+  pb_journal_t  journal  = pb_journal_create(data, size);
+  pb_message_t  message  = pb_message_create(&descriptor, &journal);
+  pb_appender_t appender = pb_appender_create(&message, 3);
+
+  /* Append values to packed field */
+  for (uint32_t value = 2; value < 5; value++)
+    ck_assert_uint_eq(PB_ERROR_NONE, pb_appender_put(&appender, &value));
+
+  /* Assert journal size and raw data */
+  ck_assert_uint_eq(8, pb_journal_size(&journal));
+  const uint8_t check[] = { 26, 4, 1, 2, 3, 4, 34, 0 };
+  for (size_t b = 0; b < 8; b++)
+    ck_assert_uint_eq(check[b], pb_journal_data(&journal)[b]);
+
+  /* Free all allocated memory */
+  pb_appender_destroy(&appender);
+  pb_message_destroy(&message);
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Append strings to a repeated field within a nested message.
+ */
+START_TEST(test_put_nested) {
+  pb_journal_t journal = pb_journal_create_empty();
+  pb_message_t message = pb_message_create(&descriptor, &journal);
+
+  /* Create submessage and appender */
+  pb_message_t  submessage = pb_message_create_within(&message, 11);
+  pb_appender_t appender   = pb_appender_create(&submessage, 4);
+
+  /* Append strings to repeated field */
+  pb_string_t value = pb_string_const("SOME DATA");
+  for (size_t s = 0; s < 10; s++)
+    ck_assert_uint_eq(PB_ERROR_NONE, pb_appender_put(&appender, &value));
+
+  /* Assert journal size and length prefix of submessage */
+  ck_assert_uint_eq(112, pb_journal_size(&journal));
+  ck_assert_uint_eq(110, pb_journal_data(&journal)[1]);
+
+  /* Assert submessage offsets */
+  fail_unless(pb_message_valid(&submessage));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_align(&submessage));
+  ck_assert_uint_eq(2, pb_message_start(&submessage));
+  ck_assert_uint_eq(112, pb_message_end(&submessage));
+
+  /* Free all allocated memory */
+  pb_appender_destroy(&appender);
+  pb_message_destroy(&submessage);
+  pb_message_destroy(&message);
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Append submessages to a repeated field.
+ */
+START_TEST(test_put_message) {
+  const uint8_t data[] = { 16, 127 };
+  const size_t  size   = 2;
+
+  /* Create journal, message and appender */
+  pb_journal_t  journal  = pb_journal_create_empty();
+  pb_message_t  message  = pb_message_create(&descriptor, &journal);
+  pb_appender_t appender = pb_appender_create(&message, 12);
+
+  /* Create submessage to append */
+  pb_journal_t  subjournal = pb_journal_create(data, size);
+  pb_message_t  submessage = pb_message_create(&descriptor, &subjournal);
+
+  /* Append submessages to repeated field */
+  for (size_t m = 0; m < 3; m++)
+    ck_assert_uint_eq(PB_ERROR_NONE,
+      pb_appender_put(&appender, &submessage));
+
+  /* Assert journal size and raw data */
+  ck_assert_uint_eq(12, pb_journal_size(&journal));
+  const uint8_t check[] = { 98, 2, 16, 127, 98, 2, 16, 127, 98, 2, 16, 127 };
+  for (size_t b = 0; b < 12; b++)
+    ck_assert_uint_eq(check[b], pb_journal_data(&journal)[b]);
+
+  /* Free all allocated memory */
+  pb_message_destroy(&submessage);
+  pb_journal_destroy(&subjournal);
+  pb_appender_destroy(&appender);
+  pb_message_destroy(&message);
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Append values to a repeated field after erasing it.
+ */
+START_TEST(test_put_erased) {
+  pb_journal_t  journal  = pb_journal_create_empty();
+  pb_message_t  message  = pb_message_create(&descriptor, &journal);
+  pb_appender_t appender = pb_appender_create(&message, 1);
+
+  /* Append values and erase repeated field */
+  for (uint32_t value = 1; value < 4; value++)
+    ck_assert_uint_eq(PB_ERROR_NONE, pb_appender_put(&appender, &value));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_erase(&message, 1));
+  ck_assert_uint_eq(0, pb_journal_size(&journal));
+
+  /* Append value to repeated field again */
+  uint32_t value = 4;
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_appender_put(&appender, &value));
+
+  /* Assert journal size and raw data */
+  ck_assert_uint_eq(2, pb_journal_size(&journal));
+  ck_assert_uint_eq(8, pb_journal_data(&journal)[0]);
+  ck_assert_uint_eq(4, pb_journal_data(&journal)[1]);
+
+  /* Free all allocated memory */
+  pb_appender_destroy(&appender);
+  pb_message_destroy(&message);
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Append a value through an invalid appender.
+ */
+START_TEST(test_put_invalid) {
+  pb_message_t  message  = pb_message_create_invalid();
+  pb_appender_t appender = pb_appender_create(&message, 1);
+
+  /* Append value to repeated field */
+  uint32_t value = 1;
+  ck_assert_uint_eq(PB_ERROR_INVALID, pb_appender_put(&appender, &value));
+
+  /* Free all allocated memory */
+  pb_appender_destroy(&appender);
+  pb_message_destroy(&message);
+} END_TEST
+
+/* ----------------------------------------------------------------------------
+ * Program
+ * ------------------------------------------------------------------------- */
+
+/*
+ * Create a test suite for all registered test cases and run it.
+ *
+ * Tests must be run sequentially (in no-fork mode) or code coverage
+ * cannot be determined properly.
+ */
+int
+main(void) {
+  void *suite = suite_create("protobluff/message/appender"),
+       *tcase = NULL;
+
+  /* Add tests to test case "create" */
+  tcase = tcase_create("create");
+  tcase_add_test(tcase, test_create);
+  tcase_add_test(tcase, test_create_invalid);
+  suite_add_tcase(suite, tcase);
+
+  /* Add tests to test case "put" */
+  tcase = tcase_create("put");
+  tcase_add_test(tcase, test_put);
+  tcase_add_test(tcase, test_put_packed);
+  tcase_add_test(tcase, test_put_nested);
+  tcase_add_test(tcase, test_put_message);
+  tcase_add_test(tcase, test_put_erased);
+  tcase_add_test(tcase, test_put_invalid);
+  suite_add_tcase(suite, tcase);
+
+  /* Create a test suite runner in no-fork mode */
+  void *runner = srunner_create(suite);
+  srunner_set_fork_status(runner, CK_NOFORK);
+
+  /* Execute test suite runner */
+  srunner_run_all(runner, CK_NORMAL);
+  int failed = srunner_ntests_failed(runner);
+  srunner_free(runner);
+
+  /* Exit with status code */
+  return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
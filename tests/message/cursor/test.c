@@ -20,6 +20,7 @@
  * IN THE SOFTWARE.
  */
 
+#include <assert.h>
 #include <check.h>
 #include <stdint.h>
 #include <stdlib.h>
@@ -27,6 +28,8 @@
 
 #include <protobluff/descriptor.h>
 
+#include "core/buffer.h"
+#include "core/decoder.h"
 #include "message/common.h"
 #include "message/cursor.h"
 #include "message/field.h"
@@ -41,6 +44,63 @@
 static const float
 default_float = 0.0001;
 
+/* ----------------------------------------------------------------------------
+ * Decoder callbacks
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Field handler that ignores all values.
+ *
+ * \param[in]     descriptor Field descriptor
+ * \param[in]     value      Pointer holding value
+ * \param[in,out] user       User data
+ */
+static pb_error_t
+handler(
+    const pb_field_descriptor_t *descriptor, const void *value, void *user) {
+  assert(descriptor && value && !user);
+  return PB_ERROR_NONE;
+}
+
+/* ----------------------------------------------------------------------------
+ * Cursor callbacks
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Predicate that matches odd values and counts invocations.
+ *
+ * \param[in,out] cursor Cursor
+ * \param[in,out] user   User data
+ * \return               Test result
+ */
+static int
+predicate_odd(pb_cursor_t *cursor, void *user) {
+  assert(cursor && user);
+  size_t *calls = user;
+  uint32_t value;
+  (*calls)++;
+  return !pb_cursor_get(cursor, &value) && value & 1;
+}
+
+/*!
+ * Predicate that matches submessages with an odd value for F02.
+ *
+ * \param[in,out] cursor Cursor
+ * \param[in,out] user   User data
+ * \return               Test result
+ */
+static int
+predicate_odd_message(pb_cursor_t *cursor, void *user) {
+  assert(cursor && user);
+  size_t *calls = user;
+  uint64_t value;
+  (*calls)++;
+  pb_message_t submessage = pb_message_create_from_cursor(cursor);
+  int result = !pb_message_get(&submessage, 2, &value) && value & 1;
+  pb_message_destroy(&submessage);
+  return result;
+}
+
 /* ----------------------------------------------------------------------------
  * Descriptors
  * ------------------------------------------------------------------------- */
@@ -76,6 +136,13 @@ descriptor = { {
     { 13, "F13", MESSAGE, ONEOF, &descriptor, &oneof_descriptor }
   }, 13 } };
 
+/* Descriptor with UTF-8 string fields */
+static pb_descriptor_t
+descriptor_utf8 = { {
+  (const pb_field_descriptor_t []){
+    {  1, "F01", STRING,  REPEATED, NULL, NULL, UTF8 }
+  }, 1 } };
+
 /* ----------------------------------------------------------------------------
  * Tests
  * ------------------------------------------------------------------------- */
@@ -100,7 +167,7 @@ START_TEST(test_create) {
   ck_assert_uint_eq(1, pb_cursor_tag(&cursor));
 
   /* Assert same contents but different location */
-  fail_unless(pb_message_equals(&message, pb_cursor_message(&cursor)));
+  fail_unless(pb_message_same(&message, pb_cursor_message(&cursor)));
   ck_assert_ptr_ne(&message, pb_cursor_message(&cursor));
 
   /* Free all allocated memory */
@@ -109,6 +176,109 @@ START_TEST(test_create) {
   pb_journal_destroy(&journal);
 } END_TEST
 
+/*
+ * Create cursors over a message from an index of field offsets.
+ */
+START_TEST(test_create_index) {
+  const uint8_t data[] = { 8, 1, 16, 5, 8, 2, 16, 7, 88, 3, 96, 4 };
+  const size_t  size   = 12;
+
+  /* Create buffer, decoder and index, and decode message */
+  pb_buffer_t        buffer  = pb_buffer_create(data, size);
+  pb_decoder_t       decoder = pb_decoder_create(&descriptor, &buffer);
+  pb_decoder_index_t index   = pb_decoder_index_create();
+  pb_decoder_set_index(&decoder, &index);
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_decoder_decode(&decoder, handler, NULL));
+
+  /* Create journal and hand over index */
+  pb_journal_t journal = pb_journal_create(data, size);
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_journal_set_index(&journal, &index));
+  fail_if(pb_decoder_index_complete(&index));
+
+  /* Assert repeated field starting at first occurrence */
+  pb_message_t message = pb_message_create(&descriptor, &journal);
+  pb_cursor_t  cursor  = pb_cursor_create(&message, 1);
+  fail_unless(pb_cursor_valid(&cursor));
+  ck_assert_uint_eq(0, pb_cursor_pos(&cursor));
+  uint32_t value;
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_cursor_get(&cursor, &value));
+  ck_assert_uint_eq(1, value);
+  fail_unless(pb_cursor_next(&cursor));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_cursor_get(&cursor, &value));
+  ck_assert_uint_eq(2, value);
+  fail_if(pb_cursor_next(&cursor));
+  pb_cursor_destroy(&cursor);
+
+  /* Assert optional field starting at last occurrence */
+  cursor = pb_cursor_create(&message, 2);
+  fail_unless(pb_cursor_valid(&cursor));
+  ck_assert_uint_eq(1, pb_cursor_pos(&cursor));
+  uint64_t number;
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_cursor_get(&cursor, &number));
+  ck_assert_uint_eq(7, number);
+  pb_cursor_destroy(&cursor);
+
+  /* Assert oneof members and absent field */
+  cursor = pb_cursor_create(&message, 11);
+  ck_assert_uint_eq(PB_ERROR_EOM, pb_cursor_error(&cursor));
+  pb_cursor_destroy(&cursor);
+  cursor = pb_cursor_create(&message, 12);
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_cursor_get(&cursor, &value));
+  ck_assert_uint_eq(4, value);
+  pb_cursor_destroy(&cursor);
+  cursor = pb_cursor_create(&message, 3);
+  ck_assert_uint_eq(PB_ERROR_EOM, pb_cursor_error(&cursor));
+  pb_cursor_destroy(&cursor);
+
+  /* Write to message and assert index is not used anymore */
+  number = 9;
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_put(&message, 2, &number));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_get(&message, 2, &number));
+  ck_assert_uint_eq(9, number);
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_get(&message, 12, &value));
+  ck_assert_uint_eq(4, value);
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_journal_trim(&journal));
+  ck_assert_ptr_eq(NULL, journal.fields.entry.data);
+
+  /* Free all allocated memory */
+  pb_message_destroy(&message);
+  pb_journal_destroy(&journal);
+  pb_decoder_index_destroy(&index);
+  pb_decoder_destroy(&decoder);
+  pb_buffer_destroy(&buffer);
+} END_TEST
+
+/*
+ * Hand an incomplete or mismatching index of field offsets to a journal.
+ */
+START_TEST(test_create_index_invalid) {
+  const uint8_t data[] = { 8, 1, 16 };
+  const size_t  size   = 3;
+
+  /* Create buffer, decoder and index, and decode truncated message */
+  pb_buffer_t        buffer  = pb_buffer_create(data, size);
+  pb_decoder_t       decoder = pb_decoder_create(&descriptor, &buffer);
+  pb_decoder_index_t index   = pb_decoder_index_create();
+  pb_decoder_set_index(&decoder, &index);
+  fail_unless(pb_decoder_decode(&decoder, handler, NULL));
+
+  /* Assert index is rejected */
+  pb_journal_t journal = pb_journal_create(data, size);
+  ck_assert_uint_eq(PB_ERROR_INVALID, pb_journal_set_index(&journal, &index));
+  pb_journal_destroy(&journal);
+
+  /* Assert index of different size is rejected */
+  journal = pb_journal_create(data, 2);
+  ck_assert_uint_eq(PB_ERROR_INVALID, pb_journal_set_index(&journal, &index));
+
+  /* Free all allocated memory */
+  pb_journal_destroy(&journal);
+  pb_decoder_index_destroy(&index);
+  pb_decoder_destroy(&decoder);
+  pb_buffer_destroy(&buffer);
+} END_TEST
+
 /*
  * Create a cursor over a message for an absent field.
  */
@@ -348,7 +518,7 @@ START_TEST(test_create_without_tag) {
   ck_assert_uint_eq(1, pb_cursor_tag(&cursor));
 
   /* Assert same contents but different location */
-  fail_unless(pb_message_equals(&message, pb_cursor_message(&cursor)));
+  fail_unless(pb_message_same(&message, pb_cursor_message(&cursor)));
   ck_assert_ptr_ne(&message, pb_cursor_message(&cursor));
 
   /* Free all allocated memory */
@@ -615,6 +785,43 @@ START_TEST(test_next) {
   pb_journal_destroy(&journal);
 } END_TEST
 
+/*
+ * Move a cursor to the next field, skipping fields with other tags.
+ */
+START_TEST(test_next_skip) {
+  const uint8_t data[] = { 8, 1, 16, 1, 57, 0, 0, 0, 0, 0, 0, 0, 0, 16, 2,
+    66, 2, 97, 98, 144, 0, 3, 136, 0, 1, 53, 0, 0, 0, 0, 16, 4 };
+  const size_t  size   = 32;
+
+  /* Create journal, message and cursor */
+  pb_journal_t journal = pb_journal_create(data, size);
+  pb_message_t message = pb_message_create(&descriptor, &journal);
+  pb_cursor_t  cursor  = pb_cursor_create_unsafe(&message, 2);
+
+  /* Assert cursor validity and error */
+  fail_unless(pb_cursor_valid(&cursor));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_cursor_error(&cursor));
+
+  /* Walk through message and read fields, including a padded tag */
+  uint64_t value;
+  for (size_t f = 1; f < 5; f++, pb_cursor_next(&cursor)) {
+    ck_assert_uint_eq(PB_ERROR_NONE, pb_cursor_get(&cursor, &value));
+    ck_assert_uint_eq(f, value);
+
+    /* Assert cursor tag */
+    ck_assert_uint_eq(2, pb_cursor_tag(&cursor));
+  }
+
+  /* Assert cursor validity and error */
+  fail_if(pb_cursor_valid(&cursor));
+  ck_assert_uint_eq(PB_ERROR_EOM, pb_cursor_error(&cursor));
+
+  /* Free all allocated memory */
+  pb_cursor_destroy(&cursor);
+  pb_message_destroy(&message);
+  pb_journal_destroy(&journal);
+} END_TEST
+
 /*
  * Move a cursor to the next packed field.
  */
@@ -2394,6 +2601,41 @@ START_TEST(test_get_string) {
   pb_journal_destroy(&journal);
 } END_TEST
 
+/*
+ * Read the value of the current field from a cursor with invalid UTF-8.
+ */
+START_TEST(test_get_string_invalid_utf8) {
+  const uint8_t data[] = { 10, 2, 65, 66, 10, 2, 192, 128 };
+  const size_t  size   = 8;
+
+  /* Create journal, message and cursor */
+  pb_journal_t journal = pb_journal_create(data, size);
+  pb_message_t message = pb_message_create(&descriptor_utf8, &journal);
+  pb_cursor_t  cursor  = pb_cursor_create(&message, 1);
+
+  /* Assert cursor validity and error */
+  fail_unless(pb_cursor_valid(&cursor));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_cursor_error(&cursor));
+
+  /* Read valid value from cursor */
+  pb_string_t value;
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_cursor_get(&cursor, &value));
+  ck_assert_uint_eq(2, pb_string_size(&value));
+
+  /* Read invalid value from cursor */
+  fail_unless(pb_cursor_next(&cursor));
+  ck_assert_uint_eq(PB_ERROR_INVALID, pb_cursor_get(&cursor, &value));
+
+  /* Assert cursor validity and error */
+  fail_unless(pb_cursor_valid(&cursor));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_cursor_error(&cursor));
+
+  /* Free all allocated memory */
+  pb_cursor_destroy(&cursor);
+  pb_message_destroy(&message);
+  pb_journal_destroy(&journal);
+} END_TEST
+
 /*
  * Read the value of the current field from an unaligned cursor.
  */
@@ -2517,6 +2759,248 @@ START_TEST(test_get_invalid_type) {
   pb_message_destroy(&message);
   pb_journal_destroy(&journal);
 } END_TEST
+/*
+ * Read all values of a repeated field from a cursor.
+ */
+START_TEST(test_get_all) {
+  const uint8_t data[] = { 8, 1, 8, 2, 16, 5, 8, 3 };
+  const size_t  size   = 8;
+
+  /* Create journal, message and cursor */
+  pb_journal_t journal = pb_journal_create(data, size);
+  pb_message_t message = pb_message_create(&descriptor, &journal);
+  pb_cursor_t  cursor  = pb_cursor_create(&message, 1);
+
+  /* Assert cursor validity and error */
+  fail_unless(pb_cursor_valid(&cursor));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_cursor_error(&cursor));
+
+  /* Determine number of values */
+  size_t count = 0;
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_cursor_get_all(&cursor, NULL, &count));
+  ck_assert_uint_eq(3, count);
+
+  /* Read values from cursor */
+  uint32_t values[3] = {};
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_cursor_get_all(&cursor, values, &count));
+  ck_assert_uint_eq(3, count);
+  for (size_t v = 0; v < 3; v++)
+    ck_assert_uint_eq(v + 1, values[v]);
+
+  /* Assert cursor validity, error and tag */
+  fail_unless(pb_cursor_valid(&cursor));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_cursor_error(&cursor));
+  ck_assert_uint_eq(1, pb_cursor_tag(&cursor));
+
+  /* Free all allocated memory */
+  pb_cursor_destroy(&cursor);
+  pb_message_destroy(&message);
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Read all values of a packed field from a cursor.
+ */
+START_TEST(test_get_all_packed) {
+  const uint8_t data[] = { 26, 2, 1, 2, 8, 1, 26, 2, 3, 4 };
+  const size_t  size   = 10;
+
+  /* Create journal, message and cursor */
+  pb_journal_t journal = pb_journal_create(data, size);
+  pb_message_t message = pb_message_create(&descriptor, &journal);
+  pb_cursor_t  cursor  = pb_cursor_create(&message, 3);
+
+  /* Read values from cursor */
+  uint32_t values[4] = {};
+  size_t count = 4;
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_cursor_get_all(&cursor, values, &count));
+  ck_assert_uint_eq(4, count);
+  for (size_t v = 0; v < 4; v++)
+    ck_assert_uint_eq(v + 1, values[v]);
+
+  /* Free all allocated memory */
+  pb_cursor_destroy(&cursor);
+  pb_message_destroy(&message);
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Read all values of a repeated field into an insufficiently sized array.
+ */
+START_TEST(test_get_all_capacity) {
+  const uint8_t data[] = { 8, 1, 8, 2, 8, 3 };
+  const size_t  size   = 6;
+
+  /* Create journal, message and cursor */
+  pb_journal_t journal = pb_journal_create(data, size);
+  pb_message_t message = pb_message_create(&descriptor, &journal);
+  pb_cursor_t  cursor  = pb_cursor_create(&message, 1);
+
+  /* Read values from cursor */
+  uint32_t values[2] = {};
+  size_t count = 2;
+  ck_assert_uint_eq(PB_ERROR_OFFSET,
+    pb_cursor_get_all(&cursor, values, &count));
+  ck_assert_uint_eq(3, count);
+  ck_assert_uint_eq(1, values[0]);
+  ck_assert_uint_eq(2, values[1]);
+
+  /* Free all allocated memory */
+  pb_cursor_destroy(&cursor);
+  pb_message_destroy(&message);
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Read all values from a cursor without a tag or for a message field.
+ */
+START_TEST(test_get_all_invalid) {
+  const uint8_t data[] = { 74, 0, 8, 1 };
+  const size_t  size   = 4;
+
+  /* Create journal and message */
+  pb_journal_t journal = pb_journal_create(data, size);
+  pb_message_t message = pb_message_create(&descriptor, &journal);
+
+  /* Read values from cursor without tag */
+  pb_cursor_t cursor = pb_cursor_create_without_tag(&message);
+  size_t count = 0;
+  ck_assert_uint_eq(PB_ERROR_INVALID,
+    pb_cursor_get_all(&cursor, NULL, &count));
+  pb_cursor_destroy(&cursor);
+
+  /* Read values from cursor for message field */
+  cursor = pb_cursor_create(&message, 9);
+  ck_assert_uint_eq(PB_ERROR_INVALID,
+    pb_cursor_get_all(&cursor, NULL, &count));
+  pb_cursor_destroy(&cursor);
+
+  /* Read values from cursor for absent field */
+  cursor = pb_cursor_create(&message, 3);
+  ck_assert_uint_eq(PB_ERROR_EOM, pb_cursor_get_all(&cursor, NULL, &count));
+  ck_assert_uint_eq(0, count);
+
+  /* Free all allocated memory */
+  pb_cursor_destroy(&cursor);
+  pb_message_destroy(&message);
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Split a repeated field into partitions.
+ */
+START_TEST(test_partition) {
+  const uint8_t data[] = { 8, 1, 8, 2, 8, 3, 8, 4, 8, 5, 8, 6, 16, 1,
+                           8, 7, 8, 8, 8, 9, 8, 10, 8, 11, 8, 12 };
+  const size_t  size   = 26;
+
+  /* Create journal, message and cursor */
+  pb_journal_t journal = pb_journal_create(data, size);
+  fail_if(pb_journal_freeze(&journal));
+  pb_message_t message = pb_message_create(&descriptor, &journal);
+  pb_cursor_t  cursor  = pb_cursor_create(&message, 1);
+
+  /* Split field into partitions */
+  pb_cursor_t cursors[4]; size_t count = 4;
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_cursor_partition(&cursor, cursors, &count));
+  ck_assert_uint_eq(4, count);
+
+  /* Iterate partitions and assert values and positions */
+  uint32_t value, expected = 1;
+  for (size_t c = 0; c < count; c++) {
+    ck_assert_uint_eq(expected - 1, pb_cursor_pos(&(cursors[c])));
+    do {
+      ck_assert_uint_eq(PB_ERROR_NONE, pb_cursor_get(&(cursors[c]), &value));
+      ck_assert_uint_eq(expected++, value);
+    } while (pb_cursor_next(&(cursors[c])));
+    ck_assert_uint_eq(PB_ERROR_EOM, pb_cursor_error(&(cursors[c])));
+    pb_cursor_destroy(&(cursors[c]));
+  }
+  ck_assert_uint_eq(13, expected);
+
+  /* Assert cursor was not moved */
+  ck_assert_uint_eq(0, pb_cursor_pos(&cursor));
+
+  /* Free all allocated memory */
+  pb_cursor_destroy(&cursor);
+  pb_message_destroy(&message);
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Split a packed field into partitions.
+ */
+START_TEST(test_partition_packed) {
+  const uint8_t data[] = { 26, 2, 1, 2, 26, 2, 3, 4 };
+  const size_t  size   = 8;
+
+  /* Create journal, message and cursor */
+  pb_journal_t journal = pb_journal_create(data, size);
+  fail_if(pb_journal_freeze(&journal));
+  pb_message_t message = pb_message_create(&descriptor, &journal);
+  pb_cursor_t  cursor  = pb_cursor_create(&message, 3);
+
+  /* Split field into partitions, never splitting packed fields */
+  pb_cursor_t cursors[4]; size_t count = 4;
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_cursor_partition(&cursor, cursors, &count));
+  ck_assert_uint_eq(2, count);
+
+  /* Iterate partitions and assert values */
+  uint32_t value, expected = 1;
+  for (size_t c = 0; c < count; c++) {
+    do {
+      ck_assert_uint_eq(PB_ERROR_NONE, pb_cursor_get(&(cursors[c]), &value));
+      ck_assert_uint_eq(expected++, value);
+    } while (pb_cursor_next(&(cursors[c])));
+    pb_cursor_destroy(&(cursors[c]));
+  }
+  ck_assert_uint_eq(5, expected);
+
+  /* Free all allocated memory */
+  pb_cursor_destroy(&cursor);
+  pb_message_destroy(&message);
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Split a field of a mutable journal or a non-repeated field.
+ */
+START_TEST(test_partition_invalid) {
+  const uint8_t data[] = { 8, 1, 16, 1 };
+  const size_t  size   = 4;
+
+  /* Create journal and message */
+  pb_journal_t journal = pb_journal_create(data, size);
+  pb_message_t message = pb_message_create(&descriptor, &journal);
+  pb_cursor_t cursors[2]; size_t count = 2;
+
+  /* Split field of mutable journal */
+  pb_cursor_t cursor = pb_cursor_create(&message, 1);
+  ck_assert_uint_eq(PB_ERROR_INVALID,
+    pb_cursor_partition(&cursor, cursors, &count));
+  ck_assert_uint_eq(0, count);
+  pb_cursor_destroy(&cursor);
+
+  /* Split non-repeated field */
+  fail_if(pb_journal_freeze(&journal));
+  cursor = pb_cursor_create(&message, 2); count = 2;
+  ck_assert_uint_eq(PB_ERROR_INVALID,
+    pb_cursor_partition(&cursor, cursors, &count));
+  pb_cursor_destroy(&cursor);
+
+  /* Split absent field */
+  cursor = pb_cursor_create(&message, 4); count = 2;
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_cursor_partition(&cursor, cursors, &count));
+  ck_assert_uint_eq(0, count);
+
+  /* Free all allocated memory */
+  pb_cursor_destroy(&cursor);
+  pb_message_destroy(&message);
+  pb_journal_destroy(&journal);
+} END_TEST
 
 /*
  * Write a value to the current field of a cursor.
@@ -3422,6 +3906,132 @@ START_TEST(test_erase_invalid_tag) {
   pb_journal_destroy(&journal);
 } END_TEST
 
+/*
+ * Erase all fields matching a predicate from a cursor.
+ */
+START_TEST(test_erase_if) {
+  const uint8_t data[] = { 8, 1, 8, 3, 8, 2, 16, 7, 8, 5, 8, 4 };
+  const size_t  size   = 12;
+  const uint8_t check[] = { 8, 2, 16, 7, 8, 4 };
+
+  /* Create journal, message and cursor */
+  pb_journal_t journal = pb_journal_create(data, size);
+  pb_message_t message = pb_message_create(&descriptor, &journal);
+  pb_cursor_t  cursor  = pb_cursor_create(&message, 1);
+
+  /* Erase odd values from cursor */
+  size_t calls = 0;
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_cursor_erase_if(&cursor, predicate_odd, &calls));
+  ck_assert_uint_eq(5, calls);
+
+  /* Assert cursor validity and error */
+  fail_if(pb_cursor_valid(&cursor));
+  ck_assert_uint_eq(PB_ERROR_EOM, pb_cursor_error(&cursor));
+
+  /* Assert journal contents and size */
+  ck_assert_uint_eq(6, pb_journal_size(&journal));
+  fail_if(memcmp(check, pb_journal_data(&journal), 6));
+
+  /* Align message to perform checks */
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_align(&message));
+
+  /* Assert message size and version */
+  ck_assert_uint_eq(6, pb_message_size(&message));
+  ck_assert_uint_eq(1, pb_message_version(&message));
+
+  /* Free all allocated memory */
+  pb_cursor_destroy(&cursor);
+  pb_message_destroy(&message);
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Erase all values of a packed field matching a predicate from a cursor.
+ */
+START_TEST(test_erase_if_packed) {
+  const uint8_t data[] = { 8, 1, 26, 4, 1, 2, 3, 4 };
+  const size_t  size   = 8;
+  const uint8_t check[] = { 8, 1, 26, 2, 2, 4 };
+
+  /* Create journal, message and cursor */
+  pb_journal_t journal = pb_journal_create(data, size);
+  pb_message_t message = pb_message_create(&descriptor, &journal);
+  pb_cursor_t  cursor  = pb_cursor_create(&message, 3);
+
+  /* Erase odd values from cursor */
+  size_t calls = 0;
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_cursor_erase_if(&cursor, predicate_odd, &calls));
+  ck_assert_uint_eq(4, calls);
+
+  /* Assert cursor validity and error */
+  fail_if(pb_cursor_valid(&cursor));
+  ck_assert_uint_eq(PB_ERROR_EOM, pb_cursor_error(&cursor));
+
+  /* Assert journal contents and size */
+  ck_assert_uint_eq(6, pb_journal_size(&journal));
+  fail_if(memcmp(check, pb_journal_data(&journal), 6));
+
+  /* Free all allocated memory */
+  pb_cursor_destroy(&cursor);
+  pb_message_destroy(&message);
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Erase all submessages matching a predicate from a nested cursor.
+ */
+START_TEST(test_erase_if_message) {
+  const uint8_t data[] = { 82, 12, 74, 2, 16, 1, 74, 2, 16, 2, 74, 2,
+                           16, 3 };
+  const size_t  size   = 14;
+  const uint8_t check[] = { 82, 4, 74, 2, 16, 2 };
+
+  /* Create journal, message and cursor */
+  pb_journal_t journal = pb_journal_create(data, size);
+  pb_message_t message = pb_message_create(&descriptor, &journal);
+  pb_cursor_t  cursor  = pb_cursor_create_nested(&message,
+    (const pb_tag_t []){ 10, 9 }, 2);
+
+  /* Erase submessages with odd values from cursor */
+  size_t calls = 0;
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_cursor_erase_if(&cursor, predicate_odd_message, &calls));
+  ck_assert_uint_eq(3, calls);
+
+  /* Assert journal contents and size */
+  ck_assert_uint_eq(6, pb_journal_size(&journal));
+  fail_if(memcmp(check, pb_journal_data(&journal), 6));
+
+  /* Align message to perform checks */
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_align(&message));
+
+  /* Assert message size */
+  ck_assert_uint_eq(6, pb_message_size(&message));
+
+  /* Free all allocated memory */
+  pb_cursor_destroy(&cursor);
+  pb_message_destroy(&message);
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Erase all fields matching a predicate from an invalid cursor.
+ */
+START_TEST(test_erase_if_invalid) {
+  pb_cursor_t cursor = pb_cursor_create_invalid();
+
+  /* Erase values from cursor */
+  size_t calls = 0;
+  ck_assert_uint_eq(PB_ERROR_INVALID,
+    pb_cursor_erase_if(&cursor, predicate_odd, &calls));
+  ck_assert_uint_eq(0, calls);
+
+  /* Free all allocated memory */
+  pb_cursor_destroy(&cursor);
+} END_TEST
+
 /*
  * Ensure that a cursor is properly aligned.
  */
@@ -3499,6 +4109,8 @@ main(void) {
   tcase = tcase_create("create");
   tcase_add_test(tcase, test_create);
   tcase_add_test(tcase, test_create_absent);
+  tcase_add_test(tcase, test_create_index);
+  tcase_add_test(tcase, test_create_index_invalid);
   tcase_add_test(tcase, test_create_packed);
   tcase_add_test(tcase, test_create_packed_merged);
   tcase_add_test(tcase, test_create_packed_nested);
@@ -3524,6 +4136,7 @@ main(void) {
   /* Add tests to test case "next" */
   tcase = tcase_create("next");
   tcase_add_test(tcase, test_next);
+  tcase_add_test(tcase, test_next_skip);
   tcase_add_test(tcase, test_next_packed);
   tcase_add_test(tcase, test_next_packed_merged);
   tcase_add_test(tcase, test_next_packed_nested);
@@ -3584,10 +4197,22 @@ main(void) {
   tcase_add_test(tcase, test_get_packed_nested);
   tcase_add_test(tcase, test_get_packed_invalid);
   tcase_add_test(tcase, test_get_string);
+  tcase_add_test(tcase, test_get_string_invalid_utf8);
   tcase_add_test(tcase, test_get_unaligned);
   tcase_add_test(tcase, test_get_invalid);
   tcase_add_test(tcase, test_get_invalid_tag);
   tcase_add_test(tcase, test_get_invalid_type);
+  tcase_add_test(tcase, test_get_all);
+  tcase_add_test(tcase, test_get_all_packed);
+  tcase_add_test(tcase, test_get_all_capacity);
+  tcase_add_test(tcase, test_get_all_invalid);
+  suite_add_tcase(suite, tcase);
+
+  /* Add tests to test case "partition" */
+  tcase = tcase_create("partition");
+  tcase_add_test(tcase, test_partition);
+  tcase_add_test(tcase, test_partition_packed);
+  tcase_add_test(tcase, test_partition_invalid);
   suite_add_tcase(suite, tcase);
 
   /* Add tests to test case "put" */
@@ -3618,6 +4243,10 @@ main(void) {
   tcase_add_test(tcase, test_erase_unaligned);
   tcase_add_test(tcase, test_erase_invalid);
   tcase_add_test(tcase, test_erase_invalid_tag);
+  tcase_add_test(tcase, test_erase_if);
+  tcase_add_test(tcase, test_erase_if_packed);
+  tcase_add_test(tcase, test_erase_if_message);
+  tcase_add_test(tcase, test_erase_if_invalid);
   suite_add_tcase(suite, tcase);
 
   /* Add tests to test case "align" */
@@ -103,7 +103,8 @@ descriptor = { {
     { 11, "F11", STRING,  REPEATED },
     { 12, "F12", MESSAGE, OPTIONAL, &descriptor },
     { 13, "F11", UINT64,  REPEATED, NULL, NULL, PACKED },
-  }, 13 } };
+    { 14, "F14", UINT32,  OPTIONAL, NULL, NULL, PADDED },
+  }, 14 } };
 
 /* ----------------------------------------------------------------------------
  * Tests
@@ -463,6 +464,127 @@ START_TEST(test_create_without_default_invalid) {
   pb_message_destroy(&message);
 } END_TEST
 
+/*
+ * Create a virtual field within a message for a specific tag.
+ */
+START_TEST(test_create_virtual) {
+  pb_journal_t journal = pb_journal_create_empty();
+  pb_message_t message = pb_message_create(&descriptor, &journal);
+  pb_field_t   field   = pb_field_create_virtual(&message, 1);
+
+  /* Assert field validity and error */
+  fail_unless(pb_field_valid(&field));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_field_error(&field));
+
+  /* Read default value from field and assert untouched journal */
+  uint32_t value = 0;
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_field_get(&field, &value));
+  ck_assert_uint_eq(default_uint32, value);
+  fail_unless(pb_field_match(&field, &default_uint32));
+  fail_unless(pb_journal_empty(&journal));
+  ck_assert_uint_eq(0, pb_journal_size(&journal));
+
+  /* Write value to field */
+  value = 127;
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_field_put(&field, &value));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_field_get(&field, &value));
+  ck_assert_uint_eq(127, value);
+
+  /* Assert field size and offsets */
+  ck_assert_uint_eq(1, pb_field_size(&field));
+  ck_assert_uint_eq(1, pb_field_start(&field));
+  ck_assert_uint_eq(2, pb_field_end(&field));
+
+  /* Assert journal size */
+  ck_assert_uint_eq(2, pb_journal_size(&journal));
+
+  /* Free all allocated memory */
+  pb_field_destroy(&field);
+  pb_message_destroy(&message);
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Create an existing virtual field within a message for a specific tag.
+ */
+START_TEST(test_create_virtual_existing) {
+  const uint8_t data[] = { 8, 127 };
+  const size_t  size   = 2;
+
+  /* Create journal, message and field */
+  pb_journal_t journal = pb_journal_create(data, size);
+  pb_message_t message = pb_message_create(&descriptor, &journal);
+  pb_field_t   field   = pb_field_create_virtual(&message, 1);
+
+  /* Read value from field */
+  uint32_t value = 0;
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_field_get(&field, &value));
+  ck_assert_uint_eq(127, value);
+
+  /* Assert field size and offsets */
+  ck_assert_uint_eq(1, pb_field_size(&field));
+  ck_assert_uint_eq(1, pb_field_start(&field));
+  ck_assert_uint_eq(2, pb_field_end(&field));
+
+  /* Free all allocated memory */
+  pb_field_destroy(&field);
+  pb_message_destroy(&message);
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Create a virtual field within a message and write other fields first.
+ */
+START_TEST(test_create_virtual_unaligned) {
+  pb_journal_t journal = pb_journal_create_empty();
+  pb_message_t message = pb_message_create(&descriptor, &journal);
+  pb_field_t   field   = pb_field_create_virtual(&message, 2);
+
+  /* Read default value from string field */
+  pb_field_t string = pb_field_create_virtual(&message, 8);
+  pb_string_t text;
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_field_get(&string, &text));
+  fail_unless(pb_string_equals(&text, &default_string));
+
+  /* Write values to message and field */
+  uint32_t value1 = 1;
+  uint64_t value2 = 2;
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_put(&message, 1, &value1));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_field_put(&field, &value2));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_put(&message, 3, &value1));
+
+  /* Assert journal contents */
+  const uint8_t data[] = { 8, 1, 16, 2, 24, 2 };
+  ck_assert_uint_eq(6, pb_journal_size(&journal));
+  fail_if(memcmp(data, pb_journal_data(&journal), 6));
+
+  /* Clear virtual string field */
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_field_clear(&string));
+  ck_assert_uint_eq(6, pb_journal_size(&journal));
+
+  /* Free all allocated memory */
+  pb_field_destroy(&string);
+  pb_field_destroy(&field);
+  pb_message_destroy(&message);
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Create a virtual field within an invalid message for a specific tag.
+ */
+START_TEST(test_create_virtual_invalid) {
+  pb_message_t message = pb_message_create_invalid();
+  pb_field_t   field   = pb_field_create_virtual(&message, 1);
+
+  /* Assert field validity and error */
+  fail_if(pb_field_valid(&field));
+  ck_assert_uint_eq(PB_ERROR_INVALID, pb_field_error(&field));
+
+  /* Free all allocated memory */
+  pb_field_destroy(&field);
+  pb_message_destroy(&message);
+} END_TEST
+
 /*
  * Create a field within a nested message for a branch of tags.
  */
@@ -2031,6 +2153,44 @@ START_TEST(test_put_string_incremental) {
   pb_journal_destroy(&journal);
 } END_TEST
 
+/*
+ * Write values to a padded field, which are always overwritten in place.
+ */
+START_TEST(test_put_padded) {
+  const uint8_t data[] = { 112, 128, 129, 128, 128, 0 };
+  const size_t  size   = 6;
+
+  /* Create journal, message and field */
+  pb_journal_t journal = pb_journal_create_empty();
+  pb_message_t message = pb_message_create(&descriptor, &journal);
+  pb_field_t   field   = pb_field_create(&message, 14);
+
+  /* Write value to field */
+  uint32_t value = 127;
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_field_put(&field, &value));
+  ck_assert_uint_eq(5, pb_field_size(&field));
+  pb_version_t version = pb_field_version(&field);
+
+  /* Write value crossing a length boundary to field */
+  value = 128;
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_field_put(&field, &value));
+  fail_if(memcmp(data, pb_journal_data(&journal), size));
+
+  /* Assert field size and version */
+  ck_assert_uint_eq(5, pb_field_size(&field));
+  ck_assert_uint_eq(version, pb_field_version(&field));
+
+  /* Assert field value */
+  uint32_t check = 0;
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_field_get(&field, &check));
+  ck_assert_uint_eq(128, check);
+
+  /* Free all allocated memory */
+  pb_field_destroy(&field);
+  pb_message_destroy(&message);
+  pb_journal_destroy(&journal);
+} END_TEST
+
 /*
  * Write a value to an unaligned field.
  */
@@ -2389,6 +2549,10 @@ main(void) {
   tcase_add_test(tcase, test_create_without_default);
   tcase_add_test(tcase, test_create_without_default_existing);
   tcase_add_test(tcase, test_create_without_default_invalid);
+  tcase_add_test(tcase, test_create_virtual);
+  tcase_add_test(tcase, test_create_virtual_existing);
+  tcase_add_test(tcase, test_create_virtual_unaligned);
+  tcase_add_test(tcase, test_create_virtual_invalid);
   tcase_add_test(tcase, test_create_nested);
   tcase_add_test(tcase, test_create_nested_invalid);
   tcase_add_test(tcase, test_create_from_cursor);
@@ -2460,6 +2624,7 @@ main(void) {
   tcase_add_test(tcase, test_put_string_existing);
   tcase_add_test(tcase, test_put_string_repeated);
   tcase_add_test(tcase, test_put_string_incremental);
+  tcase_add_test(tcase, test_put_padded);
   tcase_add_test(tcase, test_put_unaligned);
   tcase_add_test(tcase, test_put_unaligned_invalid);
   tcase_add_test(tcase, test_put_invalid);
@@ -0,0 +1,339 @@
+/*
+ * Copyright (c) 2013-2020 Martin Donath <martin.donath@squidfunk.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <check.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <protobluff/descriptor.h>
+
+#include "core/descriptor.h"
+#include "message/common.h"
+#include "message/handle_pool.h"
+#include "message/journal.h"
+#include "message/message.h"
+
+/* ----------------------------------------------------------------------------
+ * Descriptors
+ * ------------------------------------------------------------------------- */
+
+/* Descriptor */
+static pb_descriptor_t
+descriptor = { {
+  (const pb_field_descriptor_t []){
+    {  1, "F01", UINT32,  OPTIONAL },
+    {  2, "F02", MESSAGE, OPTIONAL, &descriptor }
+  }, 2 } };
+
+/* ----------------------------------------------------------------------------
+ * Tests
+ * ------------------------------------------------------------------------- */
+
+/*
+ * Create a handle pool for a journal.
+ */
+START_TEST(test_create) {
+  pb_journal_t     journal = pb_journal_create_empty();
+  pb_handle_pool_t pool    = pb_handle_pool_create(&journal);
+
+  /* Assert handle pool journal and size */
+  fail_unless(pb_handle_pool_journal(&pool) == &journal);
+  ck_assert_uint_eq(0, pb_handle_pool_size(&pool));
+
+  /* Assert invalid message for unknown handles */
+  pb_message_t message = pb_handle_pool_message(&pool, 1);
+  fail_if(pb_message_valid(&message));
+
+  /* Free all allocated memory */
+  pb_handle_pool_destroy(&pool);
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Insert a message into a handle pool.
+ */
+START_TEST(test_insert) {
+  const uint8_t data[] = { 8, 1, 18, 2, 8, 2 };
+  const size_t  size   = 6;
+
+  /* Create journal, handle pool and message */
+  pb_journal_t     journal = pb_journal_create(data, size);
+  pb_handle_pool_t pool    = pb_handle_pool_create(&journal);
+  pb_message_t     message = pb_message_create(&descriptor, &journal);
+
+  /* Insert message and destroy it */
+  pb_handle_t handle = pb_handle_pool_insert(&pool, &message);
+  fail_unless(handle);
+  ck_assert_uint_eq(1, pb_handle_pool_size(&pool));
+  pb_message_destroy(&message);
+
+  /* Re-create message from handle and read value */
+  uint32_t value;
+  message = pb_handle_pool_message(&pool, handle);
+  fail_unless(pb_message_valid(&message));
+  fail_unless(pb_message_descriptor(&message) == &descriptor);
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_get(&message, 1, &value));
+  ck_assert_uint_eq(1, value);
+
+  /* Free all allocated memory */
+  pb_message_destroy(&message);
+  pb_handle_pool_destroy(&pool);
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Insert many messages into a handle pool, growing it.
+ */
+START_TEST(test_insert_many) {
+  const uint8_t data[] = { 8, 1, 18, 2, 8, 2 };
+  const size_t  size   = 6;
+
+  /* Create journal, handle pool and message */
+  pb_journal_t     journal = pb_journal_create(data, size);
+  pb_handle_pool_t pool    = pb_handle_pool_create(&journal);
+  pb_message_t     message = pb_message_create(&descriptor, &journal);
+
+  /* Insert message many times and assert distinct handles */
+  for (size_t h = 1; h <= 100; h++)
+    ck_assert_uint_eq(h, pb_handle_pool_insert(&pool, &message));
+  ck_assert_uint_eq(100, pb_handle_pool_size(&pool));
+
+  /* Free all allocated memory */
+  pb_message_destroy(&message);
+  pb_handle_pool_destroy(&pool);
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Insert a submessage of a pooled message into a handle pool.
+ */
+START_TEST(test_insert_within) {
+  const uint8_t data[] = { 8, 1, 18, 2, 8, 2 };
+  const size_t  size   = 6;
+
+  /* Create journal, handle pool and message */
+  pb_journal_t     journal = pb_journal_create(data, size);
+  pb_handle_pool_t pool    = pb_handle_pool_create(&journal);
+  pb_message_t     message = pb_message_create(&descriptor, &journal);
+
+  /* Insert message and submessage */
+  pb_handle_t handle = pb_handle_pool_insert(&pool, &message);
+  pb_handle_t nested = pb_handle_pool_insert_within(&pool, handle, 2);
+  fail_unless(nested);
+
+  /* Read value from submessage */
+  uint32_t value;
+  pb_message_t submessage = pb_handle_pool_message(&pool, nested);
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_get(&submessage, 1, &value));
+  ck_assert_uint_eq(2, value);
+
+  /* Free all allocated memory */
+  pb_message_destroy(&submessage);
+  pb_message_destroy(&message);
+  pb_handle_pool_destroy(&pool);
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Insert a message of another journal into a handle pool.
+ */
+START_TEST(test_insert_invalid) {
+  pb_journal_t     journal = pb_journal_create_empty();
+  pb_journal_t     other   = pb_journal_create_empty();
+  pb_handle_pool_t pool    = pb_handle_pool_create(&journal);
+  pb_message_t     message = pb_message_create(&descriptor, &other);
+
+  /* Assert insertion failure */
+  ck_assert_uint_eq(0, pb_handle_pool_insert(&pool, &message));
+  ck_assert_uint_eq(0, pb_handle_pool_size(&pool));
+
+  /* Free all allocated memory */
+  pb_message_destroy(&message);
+  pb_handle_pool_destroy(&pool);
+  pb_journal_destroy(&other);
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Remove a handle from a handle pool and reuse its slot.
+ */
+START_TEST(test_remove) {
+  const uint8_t data[] = { 8, 1, 18, 2, 8, 2 };
+  const size_t  size   = 6;
+
+  /* Create journal, handle pool and message */
+  pb_journal_t     journal = pb_journal_create(data, size);
+  pb_handle_pool_t pool    = pb_handle_pool_create(&journal);
+  pb_message_t     message = pb_message_create(&descriptor, &journal);
+
+  /* Insert and remove handles */
+  pb_handle_t handle = pb_handle_pool_insert(&pool, &message);
+  pb_handle_t nested = pb_handle_pool_insert_within(&pool, handle, 2);
+  pb_handle_pool_remove(&pool, handle);
+  ck_assert_uint_eq(1, pb_handle_pool_size(&pool));
+
+  /* Assert invalid message for removed handle */
+  pb_message_t removed = pb_handle_pool_message(&pool, handle);
+  fail_if(pb_message_valid(&removed));
+
+  /* Assert reuse of slot */
+  ck_assert_uint_eq(handle, pb_handle_pool_insert(&pool, &message));
+  ck_assert_uint_eq(2, pb_handle_pool_size(&pool));
+  pb_handle_pool_remove(&pool, nested);
+  pb_handle_pool_remove(&pool, nested);
+  ck_assert_uint_eq(1, pb_handle_pool_size(&pool));
+
+  /* Free all allocated memory */
+  pb_message_destroy(&removed);
+  pb_message_destroy(&message);
+  pb_handle_pool_destroy(&pool);
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Align all handles of a handle pool after a write.
+ */
+START_TEST(test_align) {
+  const uint8_t data[] = { 8, 1, 18, 2, 8, 2 };
+  const size_t  size   = 6;
+
+  /* Create journal, handle pool and message */
+  pb_journal_t     journal = pb_journal_create(data, size);
+  pb_handle_pool_t pool    = pb_handle_pool_create(&journal);
+  pb_message_t     message = pb_message_create(&descriptor, &journal);
+
+  /* Insert message and submessage */
+  pb_handle_t handle = pb_handle_pool_insert(&pool, &message);
+  pb_handle_t nested = pb_handle_pool_insert_within(&pool, handle, 2);
+
+  /* Write a value that moves the submessage */
+  uint32_t value = 300;
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_put(&message, 1, &value));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_handle_pool_align(&pool));
+
+  /* Read value from submessage */
+  pb_message_t submessage = pb_handle_pool_message(&pool, nested);
+  fail_unless(pb_message_valid(&submessage));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_get(&submessage, 1, &value));
+  ck_assert_uint_eq(2, value);
+
+  /* Write a value through the submessage and read it from the message */
+  value = 1000;
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_put(&submessage, 1, &value));
+  pb_message_destroy(&message);
+  message = pb_handle_pool_message(&pool, handle);
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_get(&message, 1, &value));
+  ck_assert_uint_eq(300, value);
+  ck_assert_uint_eq(8, pb_journal_size(&journal));
+
+  /* Free all allocated memory */
+  pb_message_destroy(&submessage);
+  pb_message_destroy(&message);
+  pb_handle_pool_destroy(&pool);
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Align all handles of a handle pool after erasing a submessage.
+ */
+START_TEST(test_align_erased) {
+  const uint8_t data[] = { 8, 1, 18, 2, 8, 2 };
+  const size_t  size   = 6;
+
+  /* Create journal, handle pool and message */
+  pb_journal_t     journal = pb_journal_create(data, size);
+  pb_handle_pool_t pool    = pb_handle_pool_create(&journal);
+  pb_message_t     message = pb_message_create(&descriptor, &journal);
+
+  /* Insert message and submessage */
+  pb_handle_t handle = pb_handle_pool_insert(&pool, &message);
+  pb_handle_t nested = pb_handle_pool_insert_within(&pool, handle, 2);
+
+  /* Erase submessage and assert invalid handle */
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_erase(&message, 2));
+  pb_message_t submessage = pb_handle_pool_message(&pool, nested);
+  fail_if(pb_message_valid(&submessage));
+
+  /* Assert valid message */
+  pb_message_destroy(&message);
+  message = pb_handle_pool_message(&pool, handle);
+  fail_unless(pb_message_valid(&message));
+  ck_assert_uint_eq(2, pb_message_end(&message));
+
+  /* Free all allocated memory */
+  pb_message_destroy(&submessage);
+  pb_message_destroy(&message);
+  pb_handle_pool_destroy(&pool);
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/* ----------------------------------------------------------------------------
+ * Program
+ * ------------------------------------------------------------------------- */
+
+/*
+ * Create a test suite for all registered test cases and run it.
+ *
+ * Tests must be run sequentially (in no-fork mode) or code coverage
+ * cannot be determined properly.
+ */
+int
+main(void) {
+  void *suite = suite_create("protobluff/message/handle_pool"),
+       *tcase = NULL;
+
+  /* Add tests to test case "create" */
+  tcase = tcase_create("create");
+  tcase_add_test(tcase, test_create);
+  suite_add_tcase(suite, tcase);
+
+  /* Add tests to test case "insert" */
+  tcase = tcase_create("insert");
+  tcase_add_test(tcase, test_insert);
+  tcase_add_test(tcase, test_insert_many);
+  tcase_add_test(tcase, test_insert_within);
+  tcase_add_test(tcase, test_insert_invalid);
+  suite_add_tcase(suite, tcase);
+
+  /* Add tests to test case "remove" */
+  tcase = tcase_create("remove");
+  tcase_add_test(tcase, test_remove);
+  suite_add_tcase(suite, tcase);
+
+  /* Add tests to test case "align" */
+  tcase = tcase_create("align");
+  tcase_add_test(tcase, test_align);
+  tcase_add_test(tcase, test_align_erased);
+  suite_add_tcase(suite, tcase);
+
+  /* Create a test suite runner in no-fork mode */
+  void *runner = srunner_create(suite);
+  srunner_set_fork_status(runner, CK_NOFORK);
+
+  /* Execute test suite runner */
+  srunner_run_all(runner, CK_NORMAL);
+  int failed = srunner_ntests_failed(runner);
+  srunner_free(runner);
+
+  /* Exit with status code */
+  return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
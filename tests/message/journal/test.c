@@ -26,10 +26,26 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include <protobluff/descriptor.h>
+
 #include "core/allocator.h"
+#include "core/encoder.h"
+#include "core/fragment.h"
 #include "message/common.h"
 #include "message/journal.h"
 
+/* ----------------------------------------------------------------------------
+ * Defaults
+ * ------------------------------------------------------------------------- */
+
+/* Descriptor */
+static pb_descriptor_t
+descriptor = { {
+  (const pb_field_descriptor_t []){
+    {  1, "F01", UINT32, OPTIONAL },
+    {  2, "F02", STRING, OPTIONAL }
+  }, 2 } };
+
 /* ----------------------------------------------------------------------------
  * System-default allocator callback overrides
  * ------------------------------------------------------------------------- */
@@ -61,6 +77,18 @@ allocator_resize_fail(void *data, void *block, size_t size) {
   return NULL;
 }
 
+/* ----------------------------------------------------------------------------
+ * Helper functions
+ * ------------------------------------------------------------------------- */
+
+/*
+ * Count releases of an external segment.
+ */
+static void
+release_count(void *data) {
+  (*(size_t *)data)++;
+}
+
 /* ----------------------------------------------------------------------------
  * Tests
  * ------------------------------------------------------------------------- */
@@ -114,6 +142,24 @@ START_TEST(test_create_empty) {
   pb_journal_destroy(&journal);
 } END_TEST
 
+/*
+ * Create an empty journal that writes padded length prefixes.
+ */
+START_TEST(test_create_padded) {
+  pb_journal_t journal = pb_journal_create_padded();
+
+  /* Assert journal validity and error */
+  fail_unless(pb_journal_valid(&journal));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_journal_error(&journal));
+
+  /* Assert journal size and version */
+  fail_unless(pb_journal_empty(&journal));
+  ck_assert_uint_eq(0, pb_journal_size(&journal));
+  ck_assert_uint_eq(0, pb_journal_version(&journal));
+
+  /* Free all allocated memory */
+  pb_journal_destroy(&journal);
+} END_TEST
 
 /*
  * Create a zero-copy journal.
@@ -142,6 +188,289 @@ START_TEST(test_create_zero_copy) {
   pb_journal_destroy(&journal);
 } END_TEST
 
+/*
+ * Create a copy-on-write journal.
+ */
+START_TEST(test_create_copy_on_write) {
+  const uint8_t data[] = "SOME DATA";
+  const size_t  size   = 9;
+
+  /* Create buffer and journal */
+  pb_buffer_t  buffer  = pb_buffer_create(data, size);
+  pb_journal_t journal = pb_journal_create_copy_on_write(&buffer);
+
+  /* Assert journal validity and error */
+  fail_unless(pb_journal_valid(&journal));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_journal_error(&journal));
+
+  /* Assert journal size and version */
+  fail_if(pb_journal_empty(&journal));
+  ck_assert_uint_eq(size, pb_journal_size(&journal));
+  ck_assert_uint_eq(0, pb_journal_version(&journal));
+
+  /* Assert same contents and location */
+  fail_if(memcmp(data, pb_journal_data(&journal), size));
+  ck_assert_ptr_eq(pb_buffer_data(&buffer), pb_journal_data(&journal));
+
+  /* Free all allocated memory */
+  pb_journal_destroy(&journal);
+  pb_buffer_destroy(&buffer);
+} END_TEST
+
+/*
+ * Create a copy-on-write journal from an invalid buffer.
+ */
+START_TEST(test_create_copy_on_write_invalid) {
+  pb_buffer_t  buffer  = pb_buffer_create_invalid();
+  pb_journal_t journal = pb_journal_create_copy_on_write(&buffer);
+
+  /* Assert journal validity and error */
+  fail_if(pb_journal_valid(&journal));
+  ck_assert_uint_eq(PB_ERROR_ALLOC, pb_journal_error(&journal));
+
+  /* Free all allocated memory */
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Create a snapshot of a journal.
+ */
+START_TEST(test_create_snapshot) {
+  const uint8_t data[] = "SOME DATA";
+  const size_t  size   = 9;
+
+  /* Create journal and snapshot */
+  pb_journal_t journal  = pb_journal_create(data, size);
+  pb_journal_t snapshot = pb_journal_snapshot(&journal);
+
+  /* Assert snapshot validity and error */
+  fail_unless(pb_journal_valid(&snapshot));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_journal_error(&snapshot));
+
+  /* Assert snapshot size and version */
+  fail_if(pb_journal_empty(&snapshot));
+  ck_assert_uint_eq(size, pb_journal_size(&snapshot));
+  ck_assert_uint_eq(0, pb_journal_version(&snapshot));
+
+  /* Assert same contents and location */
+  fail_if(memcmp(data, pb_journal_data(&snapshot), size));
+  ck_assert_ptr_eq(pb_journal_data(&journal), pb_journal_data(&snapshot));
+
+  /* Assert unchanged journal */
+  ck_assert_uint_eq(size, pb_journal_size(&journal));
+  fail_if(memcmp(data, pb_journal_data(&journal), size));
+
+  /* Free all allocated memory */
+  pb_journal_destroy(&journal);
+  pb_journal_destroy(&snapshot);
+} END_TEST
+
+/*
+ * Create multiple snapshots of a journal and destroy them in any order.
+ */
+START_TEST(test_create_snapshot_multiple) {
+  const uint8_t data[] = "SOME DATA";
+  const size_t  size   = 9;
+
+  /* Create journal and snapshots */
+  pb_journal_t journal  = pb_journal_create(data, size);
+  pb_journal_t first    = pb_journal_snapshot(&journal);
+  pb_journal_t second   = pb_journal_snapshot(&first);
+
+  /* Assert snapshot validity */
+  fail_unless(pb_journal_valid(&first));
+  fail_unless(pb_journal_valid(&second));
+
+  /* Assert same location */
+  ck_assert_ptr_eq(pb_journal_data(&journal), pb_journal_data(&first));
+  ck_assert_ptr_eq(pb_journal_data(&journal), pb_journal_data(&second));
+
+  /* Destroy original journal and assert unchanged snapshots */
+  pb_journal_destroy(&journal);
+  fail_if(memcmp(data, pb_journal_data(&first), size));
+  fail_if(memcmp(data, pb_journal_data(&second), size));
+
+  /* Free all allocated memory */
+  pb_journal_destroy(&second);
+  pb_journal_destroy(&first);
+} END_TEST
+
+/*
+ * Create a snapshot of an empty journal.
+ */
+START_TEST(test_create_snapshot_empty) {
+  pb_journal_t journal  = pb_journal_create_empty();
+  pb_journal_t snapshot = pb_journal_snapshot(&journal);
+
+  /* Assert snapshot validity and error */
+  fail_unless(pb_journal_valid(&snapshot));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_journal_error(&snapshot));
+
+  /* Assert snapshot size and version */
+  fail_unless(pb_journal_empty(&snapshot));
+  ck_assert_uint_eq(0, pb_journal_size(&snapshot));
+  ck_assert_uint_eq(0, pb_journal_version(&snapshot));
+
+  /* Free all allocated memory */
+  pb_journal_destroy(&journal);
+  pb_journal_destroy(&snapshot);
+} END_TEST
+
+/*
+ * Create a snapshot of an invalid journal.
+ */
+START_TEST(test_create_snapshot_invalid) {
+  pb_journal_t journal  = pb_journal_create_invalid();
+  pb_journal_t snapshot = pb_journal_snapshot(&journal);
+
+  /* Assert snapshot validity and error */
+  fail_if(pb_journal_valid(&snapshot));
+  ck_assert_uint_eq(PB_ERROR_ALLOC, pb_journal_error(&snapshot));
+
+  /* Free all allocated memory */
+  pb_journal_destroy(&snapshot);
+} END_TEST
+
+/*
+ * Create a journal from a buffer.
+ */
+START_TEST(test_create_from_buffer) {
+  const uint8_t data[] = "SOME DATA";
+  const size_t  size   = 9;
+
+  /* Create buffer and move it into journal */
+  pb_buffer_t buffer = pb_buffer_create(data, size);
+  const uint8_t *location = pb_buffer_data(&buffer);
+  pb_journal_t journal = pb_journal_create_from_buffer(&buffer);
+
+  /* Assert journal validity and invalidated buffer */
+  fail_unless(pb_journal_valid(&journal));
+  fail_if(pb_buffer_valid(&buffer));
+
+  /* Assert same contents and location */
+  ck_assert_uint_eq(size, pb_journal_size(&journal));
+  fail_if(memcmp(data, pb_journal_data(&journal), size));
+  ck_assert_ptr_eq(location, pb_journal_data(&journal));
+
+  /* Update journal: "SOME DATA" => "SOME OTHER DATA" */
+  uint8_t new_data[] = "OTHER ";
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_journal_write(&journal, 5, 5, 5, new_data, 6));
+  fail_if(memcmp("SOME OTHER DATA", pb_journal_data(&journal), 15));
+
+  /* Free all allocated memory */
+  pb_journal_destroy(&journal);
+  pb_buffer_destroy(&buffer);
+} END_TEST
+
+/*
+ * Create a journal from a zero-copy buffer.
+ */
+START_TEST(test_create_from_buffer_zero_copy) {
+  uint8_t data[] = "SOME DATA";
+  size_t  size   = 9;
+
+  /* Create zero-copy buffer and move it into journal */
+  pb_buffer_t  buffer  = pb_buffer_create_zero_copy(data, size);
+  pb_journal_t journal = pb_journal_create_from_buffer(&buffer);
+
+  /* Assert journal validity and same location */
+  fail_unless(pb_journal_valid(&journal));
+  ck_assert_ptr_eq(data, pb_journal_data(&journal));
+
+  /* Update journal: "SOME DATA" => "SOME OTHER DATA" */
+  uint8_t new_data[] = "OTHER ";
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_journal_write(&journal, 5, 5, 5, new_data, 6));
+
+  /* Assert new contents in different location and unchanged data */
+  fail_if(memcmp("SOME OTHER DATA", pb_journal_data(&journal), 15));
+  ck_assert_ptr_ne(data, pb_journal_data(&journal));
+  fail_if(memcmp("SOME DATA", data, size));
+
+  /* Free all allocated memory */
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Create a journal from an encoder.
+ */
+START_TEST(test_create_from_encoder) {
+  pb_encoder_t encoder = pb_encoder_create(&descriptor);
+
+  /* Encode value */
+  uint32_t value = 127;
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_encoder_encode(&encoder, 1, &value, 1));
+  const uint8_t *location = pb_buffer_data(pb_encoder_buffer(&encoder));
+
+  /* Move buffer of encoder into journal */
+  pb_journal_t journal = pb_journal_create_from_encoder(&encoder);
+
+  /* Assert journal validity and invalidated encoder */
+  fail_unless(pb_journal_valid(&journal));
+  fail_if(pb_encoder_valid(&encoder));
+
+  /* Assert same contents and location */
+  ck_assert_uint_eq(2, pb_journal_size(&journal));
+  fail_if(memcmp("\x08\x7F", pb_journal_data(&journal), 2));
+  ck_assert_ptr_eq(location, pb_journal_data(&journal));
+
+  /* Free all allocated memory */
+  pb_journal_destroy(&journal);
+  pb_encoder_destroy(&encoder);
+} END_TEST
+
+/*
+ * Create a journal from an encoder referencing segments.
+ */
+START_TEST(test_create_from_encoder_scatter) {
+  pb_encoder_t encoder = pb_encoder_create(&descriptor);
+  pb_encoder_scatter(&encoder, 1);
+
+  /* Encode referenced value */
+  pb_string_t value = pb_string_init_from_chars("SOME DATA");
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_encoder_encode(&encoder, 2, &value, 1));
+
+  /* Assert invalid journal and untouched encoder */
+  pb_journal_t journal = pb_journal_create_from_encoder(&encoder);
+  fail_if(pb_journal_valid(&journal));
+  fail_unless(pb_encoder_valid(&encoder));
+
+  /* Free all allocated memory */
+  pb_journal_destroy(&journal);
+  pb_encoder_destroy(&encoder);
+} END_TEST
+
+/*
+ * Create a read-only journal.
+ */
+START_TEST(test_create_readonly) {
+  const uint8_t data[] = "SOME DATA";
+  const size_t  size   = 9;
+
+  /* Create journal */
+  pb_journal_t journal = pb_journal_create_readonly(data, size);
+
+  /* Assert journal validity and error */
+  fail_unless(pb_journal_valid(&journal));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_journal_error(&journal));
+
+  /* Assert journal size, version and read-only flag */
+  fail_if(pb_journal_empty(&journal));
+  ck_assert_uint_eq(size, pb_journal_size(&journal));
+  ck_assert_uint_eq(0, pb_journal_version(&journal));
+  fail_unless(pb_journal_frozen(&journal));
+
+  /* Assert same contents and location */
+  fail_if(memcmp(data, pb_journal_data(&journal), size));
+  ck_assert_ptr_eq(data, pb_journal_data(&journal));
+
+  /* Free all allocated memory */
+  pb_journal_destroy(&journal);
+} END_TEST
+
 /*
  * Create an invalid journal.
  */
@@ -200,6 +529,44 @@ START_TEST(test_create_invalid_allocate) {
   pb_journal_destroy(&journal);
 } END_TEST
 
+/*
+ * Reserve space for a journal.
+ */
+START_TEST(test_reserve) {
+  pb_journal_t journal = pb_journal_create_empty();
+
+  /* Reserve space */
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_journal_reserve(&journal, 38));
+  const uint8_t *data = pb_journal_data(&journal);
+  ck_assert_ptr_ne(NULL, data);
+
+  /* Write data within reserved space */
+  uint8_t new_data[] = "HELP I'M TRAPPED IN A UNIVERSE FACTORY";
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_journal_write(&journal, 0, 0, 0, new_data, 38));
+
+  /* Assert journal size, version and location */
+  ck_assert_uint_eq(38, pb_journal_size(&journal));
+  ck_assert_uint_eq(1, pb_journal_version(&journal));
+  ck_assert_ptr_eq(data, pb_journal_data(&journal));
+
+  /* Free all allocated memory */
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Reserve space for an invalid journal.
+ */
+START_TEST(test_reserve_invalid) {
+  pb_journal_t journal = pb_journal_create_invalid();
+
+  /* Reserve space */
+  ck_assert_uint_eq(PB_ERROR_INVALID, pb_journal_reserve(&journal, 38));
+
+  /* Free all allocated memory */
+  pb_journal_destroy(&journal);
+} END_TEST
+
 /*
  * Write data to a journal.
  */
@@ -245,6 +612,34 @@ START_TEST(test_write) {
   pb_journal_destroy(&journal);
 } END_TEST
 
+/*
+ * Write data to a journal and assert geometric growth of the entry log.
+ */
+START_TEST(test_write_entry_capacity) {
+  pb_journal_t journal = pb_journal_create_empty();
+
+  /* Assert journal entry capacity */
+  ck_assert_uint_eq(0, journal.entry.capacity);
+
+  /* Iteratively grow journal */
+  uint8_t data[] = "HELP I'M TRAPPED IN A UNIVERSE FACTORY";
+  for (size_t s = 1; s < 38; s++) {
+    ck_assert_uint_eq(PB_ERROR_NONE, pb_journal_write(&journal, 0, 0,
+      pb_journal_size(&journal), data, s));
+
+    /* Assert journal version and entry capacity */
+    ck_assert_uint_eq(s, pb_journal_version(&journal));
+    ck_assert_uint_eq(s <= 16 ? 16 : s <= 32 ? 32 : 64,
+      journal.entry.capacity);
+  }
+
+  /* Assert same contents */
+  fail_if(memcmp(data, pb_journal_data(&journal), 37));
+
+  /* Free all allocated memory */
+  pb_journal_destroy(&journal);
+} END_TEST
+
 /*
  * Write data of the same length to a zero-copy journal.
  */
@@ -278,6 +673,129 @@ START_TEST(test_write_zero_copy) {
   pb_journal_destroy(&journal);
 } END_TEST
 
+/*
+ * Write data to a copy-on-write journal.
+ */
+START_TEST(test_write_copy_on_write) {
+  const uint8_t data[] = "SOME DATA";
+  const size_t  size   = 9;
+
+  /* Create buffer and journal */
+  pb_buffer_t  buffer  = pb_buffer_create(data, size);
+  pb_journal_t journal = pb_journal_create_copy_on_write(&buffer);
+
+  /* Update journal: "SOME DATA" => "SOME OTHER DATA" */
+  uint8_t new_data[] = "OTHER ";
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_journal_write(&journal, 5, 5, 5, new_data, 6));
+
+  /* Assert journal size and version */
+  ck_assert_uint_eq(15, pb_journal_size(&journal));
+  ck_assert_uint_eq(1, pb_journal_version(&journal));
+
+  /* Assert new contents in different location */
+  fail_if(memcmp("SOME OTHER DATA", pb_journal_data(&journal), 15));
+  ck_assert_ptr_ne(pb_buffer_data(&buffer), pb_journal_data(&journal));
+
+  /* Assert unchanged buffer */
+  ck_assert_uint_eq(size, pb_buffer_size(&buffer));
+  fail_if(memcmp(data, pb_buffer_data(&buffer), size));
+
+  /* Free all allocated memory */
+  pb_journal_destroy(&journal);
+  pb_buffer_destroy(&buffer);
+} END_TEST
+
+/*
+ * Write data of the same length to a copy-on-write journal.
+ */
+START_TEST(test_write_copy_on_write_same_length) {
+  const uint8_t data[] = "SOME DATA";
+  const size_t  size   = 9;
+
+  /* Create zero-copy buffer and journal */
+  pb_buffer_t  buffer  = pb_buffer_create_zero_copy((uint8_t *)data, size);
+  pb_journal_t journal = pb_journal_create_copy_on_write(&buffer);
+
+  /* Update journal: "SOME DATA" => "NEW STUFF" */
+  uint8_t new_data[] = "NEW STUFF";
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_journal_write(&journal, 0, 0, size, new_data, size));
+
+  /* Assert new contents in different location */
+  fail_if(memcmp(new_data, pb_journal_data(&journal), size));
+  ck_assert_ptr_ne(data, pb_journal_data(&journal));
+  fail_if(memcmp("SOME DATA", data, size));
+
+  /* Free all allocated memory */
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Write data to a snapshot of a journal.
+ */
+START_TEST(test_write_snapshot) {
+  const uint8_t data[] = "SOME DATA";
+  const size_t  size   = 9;
+
+  /* Create journal and snapshot */
+  pb_journal_t journal  = pb_journal_create(data, size);
+  pb_journal_t snapshot = pb_journal_snapshot(&journal);
+
+  /* Update snapshot: "SOME DATA" => "SOME OTHER DATA" */
+  uint8_t new_data[] = "OTHER ";
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_journal_write(&snapshot, 5, 5, 5, new_data, 6));
+
+  /* Assert snapshot size and version */
+  ck_assert_uint_eq(15, pb_journal_size(&snapshot));
+  ck_assert_uint_eq(1, pb_journal_version(&snapshot));
+
+  /* Assert new contents in different location */
+  fail_if(memcmp("SOME OTHER DATA", pb_journal_data(&snapshot), 15));
+  ck_assert_ptr_ne(pb_journal_data(&journal), pb_journal_data(&snapshot));
+
+  /* Assert unchanged journal */
+  ck_assert_uint_eq(size, pb_journal_size(&journal));
+  ck_assert_uint_eq(0, pb_journal_version(&journal));
+  fail_if(memcmp(data, pb_journal_data(&journal), size));
+
+  /* Free all allocated memory */
+  pb_journal_destroy(&journal);
+  pb_journal_destroy(&snapshot);
+} END_TEST
+
+/*
+ * Write data to a journal that has a snapshot.
+ */
+START_TEST(test_write_snapshot_original) {
+  const uint8_t data[] = "SOME DATA";
+  const size_t  size   = 9;
+
+  /* Create journal and snapshot */
+  pb_journal_t journal  = pb_journal_create(data, size);
+  pb_journal_t snapshot = pb_journal_snapshot(&journal);
+
+  /* Update journal: "SOME DATA" => "SOME OTHER DATA" */
+  uint8_t new_data[] = "OTHER ";
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_journal_write(&journal, 5, 5, 5, new_data, 6));
+
+  /* Assert journal size and version */
+  ck_assert_uint_eq(15, pb_journal_size(&journal));
+  ck_assert_uint_eq(1, pb_journal_version(&journal));
+  fail_if(memcmp("SOME OTHER DATA", pb_journal_data(&journal), 15));
+
+  /* Assert unchanged snapshot */
+  ck_assert_uint_eq(size, pb_journal_size(&snapshot));
+  ck_assert_uint_eq(0, pb_journal_version(&snapshot));
+  fail_if(memcmp(data, pb_journal_data(&snapshot), size));
+
+  /* Free all allocated memory */
+  pb_journal_destroy(&journal);
+  pb_journal_destroy(&snapshot);
+} END_TEST
+
 /*
  * Write data to an invalid journal.
  */
@@ -499,6 +1017,35 @@ START_TEST(test_clear_zero_copy) {
   pb_journal_destroy(&journal);
 } END_TEST
 
+/*
+ * Clear data from a copy-on-write journal.
+ */
+START_TEST(test_clear_copy_on_write) {
+  const uint8_t data[] = "SOME DATA";
+  const size_t  size   = 9;
+
+  /* Create buffer and journal */
+  pb_buffer_t  buffer  = pb_buffer_create(data, size);
+  pb_journal_t journal = pb_journal_create_copy_on_write(&buffer);
+
+  /* Clear data from journal: "SOME DATA" => "SOME" */
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_journal_clear(&journal, 4, 4, 9));
+
+  /* Assert journal size and version */
+  ck_assert_uint_eq(4, pb_journal_size(&journal));
+  ck_assert_uint_eq(1, pb_journal_version(&journal));
+
+  /* Assert new contents and unchanged buffer */
+  fail_if(memcmp("SOME", pb_journal_data(&journal), 4));
+  ck_assert_uint_eq(size, pb_buffer_size(&buffer));
+  fail_if(memcmp(data, pb_buffer_data(&buffer), size));
+
+  /* Free all allocated memory */
+  pb_journal_destroy(&journal);
+  pb_buffer_destroy(&buffer);
+} END_TEST
+
 /*
  * Clear data from an invalid journal.
  */
@@ -561,22 +1108,129 @@ START_TEST(test_clear_invalid_allocate) {
   fail_if(pb_journal_valid(&journal));
   ck_assert_uint_eq(PB_ERROR_ALLOC, pb_journal_error(&journal));
 
-  /* Assert journal size and version */
-  fail_unless(pb_journal_empty(&journal));
-  ck_assert_uint_eq(0, pb_journal_size(&journal));
-  ck_assert_uint_eq(0, pb_journal_version(&journal));
+  /* Assert journal size and version */
+  fail_unless(pb_journal_empty(&journal));
+  ck_assert_uint_eq(0, pb_journal_size(&journal));
+  ck_assert_uint_eq(0, pb_journal_version(&journal));
+
+  /* Assert empty journal */
+  ck_assert_ptr_eq(NULL, pb_journal_data(&journal));
+
+  /* Free all allocated memory */
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Clear data from a journal for which reallocation fails.
+ */
+START_TEST(test_clear_invalid_resize) {
+  const uint8_t data[] = "SOME DATA";
+  const size_t  size   = 9;
+
+  /* Patch allocator */
+  pb_allocator_t allocator = {
+    .proc = {
+      .allocate = allocator_default.proc.allocate,
+      .resize   = allocator_resize_fail,
+      .free     = allocator_default.proc.free
+    }
+  };
+
+  /* Create journal */
+  pb_journal_t journal =
+    pb_journal_create_with_allocator(&allocator, data, size);
+
+  /* Assert journal validity and error */
+  fail_unless(pb_journal_valid(&journal));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_journal_error(&journal));
+
+  /* Try to clear data from journal */
+  ck_assert_uint_eq(PB_ERROR_ALLOC,
+    pb_journal_clear(&journal, 0, 0, size));
+
+  /* Assert journal validity and error again */
+  fail_unless(pb_journal_valid(&journal));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_journal_error(&journal));
+
+  /* Assert journal size and version */
+  fail_if(pb_journal_empty(&journal));
+  ck_assert_uint_eq(size, pb_journal_size(&journal));
+  ck_assert_uint_eq(0, pb_journal_version(&journal));
+
+  /* Free all allocated memory */
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Write data to a journal that is backed by a gap buffer.
+ */
+START_TEST(test_gap_buffer) {
+  pb_journal_t journal1 = pb_journal_create_gap_buffer(NULL, 0);
+  pb_journal_t journal2 = pb_journal_create_empty();
+
+  /* Assert journal validity and error */
+  fail_unless(pb_journal_valid(&journal1));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_journal_error(&journal1));
+
+  /* Prepend, insert and erase data in both journals */
+  uint8_t data[] = "HELP I'M TRAPPED IN A UNIVERSE FACTORY";
+  for (size_t s = 1; s < 38; s++) {
+    size_t start = pb_journal_size(&journal1) / s;
+    ck_assert_uint_eq(PB_ERROR_NONE,
+      pb_journal_write(&journal1, 0, start, start, &(data[s]), 38 - s));
+    ck_assert_uint_eq(PB_ERROR_NONE,
+      pb_journal_write(&journal2, 0, start, start, &(data[s]), 38 - s));
+    ck_assert_uint_eq(PB_ERROR_NONE,
+      pb_journal_clear(&journal1, 0, start / 2, start / 2 + s / 2));
+    ck_assert_uint_eq(PB_ERROR_NONE,
+      pb_journal_clear(&journal2, 0, start / 2, start / 2 + s / 2));
+
+    /* Assert journal size and version */
+    ck_assert_uint_eq(pb_journal_size(&journal2), pb_journal_size(&journal1));
+    ck_assert_uint_eq(
+      pb_journal_version(&journal2), pb_journal_version(&journal1));
+  }
+
+  /* Assert same contents after flattening */
+  fail_if(memcmp(pb_journal_data(&journal2), pb_journal_data(&journal1),
+    pb_journal_size(&journal1)));
+  ck_assert_uint_eq(0, journal1.gap.size);
+
+  /* Free all allocated memory */
+  pb_journal_destroy(&journal2);
+  pb_journal_destroy(&journal1);
+} END_TEST
+
+/*
+ * Write data of the same length to a journal that is backed by a gap buffer.
+ */
+START_TEST(test_gap_buffer_overwrite) {
+  const uint8_t data[] = "SOME DATA";
+  const size_t  size   = 9;
+
+  /* Create journal */
+  pb_journal_t journal = pb_journal_create_gap_buffer(data, size);
+
+  /* Insert data to create a gap, then overwrite data across the gap */
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_journal_write(&journal, 0, 4, 4, (uint8_t *)"!", 1));
+  fail_unless(journal.gap.size);
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_journal_write(&journal, 0, 2, 8, (uint8_t *)"MEWHAT", 6));
 
-  /* Assert empty journal */
-  ck_assert_ptr_eq(NULL, pb_journal_data(&journal));
+  /* Assert journal size, version and contents */
+  ck_assert_uint_eq(10, pb_journal_size(&journal));
+  ck_assert_uint_eq(1, pb_journal_version(&journal));
+  fail_if(memcmp("SOMEWHATTA", pb_journal_data(&journal), 10));
 
   /* Free all allocated memory */
   pb_journal_destroy(&journal);
 } END_TEST
 
 /*
- * Clear data from a journal for which reallocation fails.
+ * Write data to a journal backed by a gap buffer for which reallocation fails.
  */
-START_TEST(test_clear_invalid_resize) {
+START_TEST(test_gap_buffer_invalid_resize) {
   const uint8_t data[] = "SOME DATA";
   const size_t  size   = 9;
 
@@ -591,24 +1245,16 @@ START_TEST(test_clear_invalid_resize) {
 
   /* Create journal */
   pb_journal_t journal =
-    pb_journal_create_with_allocator(&allocator, data, size);
-
-  /* Assert journal validity and error */
-  fail_unless(pb_journal_valid(&journal));
-  ck_assert_uint_eq(PB_ERROR_NONE, pb_journal_error(&journal));
+    pb_journal_create_gap_buffer_with_allocator(&allocator, data, size);
 
-  /* Try to clear data from journal */
+  /* Try to grow journal */
   ck_assert_uint_eq(PB_ERROR_ALLOC,
-    pb_journal_clear(&journal, 0, 0, size));
-
-  /* Assert journal validity and error again */
-  fail_unless(pb_journal_valid(&journal));
-  ck_assert_uint_eq(PB_ERROR_NONE, pb_journal_error(&journal));
+    pb_journal_write(&journal, 0, 0, 0, (uint8_t *)"XX", 2));
 
-  /* Assert journal size and version */
-  fail_if(pb_journal_empty(&journal));
-  ck_assert_uint_eq(size, pb_journal_size(&journal));
+  /* Assert journal size, version and contents */
+  ck_assert_uint_eq(9, pb_journal_size(&journal));
   ck_assert_uint_eq(0, pb_journal_version(&journal));
+  fail_if(memcmp(data, pb_journal_data(&journal), 9));
 
   /* Free all allocated memory */
   pb_journal_destroy(&journal);
@@ -860,7 +1506,7 @@ START_TEST(test_align_clear) {
     pb_journal_align(&journal, &version, &offset));
 
   /* Assert version and offset */
-  ck_assert_uint_eq(SIZE_MAX, version);
+  ck_assert_uint_eq(PB_VERSION_MAX, version);
   ck_assert_uint_eq(0, offset.start);
   ck_assert_uint_eq(0, offset.end);
 
@@ -902,7 +1548,7 @@ START_TEST(test_align_clear_outside) {
     pb_journal_align(&journal, &version, &offset));
 
   /* Assert version and offset */
-  ck_assert_uint_eq(SIZE_MAX, version);
+  ck_assert_uint_eq(PB_VERSION_MAX, version);
   ck_assert_uint_eq(0, offset.start);
   ck_assert_uint_eq(0, offset.end);
 
@@ -989,7 +1635,7 @@ START_TEST(test_align_clear_multiple) {
     pb_journal_align(&journal, &version, &offset));
 
   /* Assert version and offset */
-  ck_assert_uint_eq(SIZE_MAX, version);
+  ck_assert_uint_eq(PB_VERSION_MAX, version);
   ck_assert_uint_eq(3, offset.start);
   ck_assert_uint_eq(3, offset.end);
 
@@ -1002,6 +1648,50 @@ START_TEST(test_align_clear_multiple) {
   pb_journal_destroy(&journal);
 } END_TEST
 
+/*
+ * Align offsets with and without the index of a journal.
+ */
+START_TEST(test_align_index) {
+  pb_journal_t journal = pb_journal_create_empty();
+
+  /* Grow journal at different positions */
+  uint8_t data[] = "HELP I'M TRAPPED IN A UNIVERSE FACTORY";
+  for (size_t s = 0; s < 400; s++) {
+    size_t start = (s * 7919) % (pb_journal_size(&journal) + 1);
+    ck_assert_uint_eq(PB_ERROR_NONE,
+      pb_journal_write(&journal, start, start, start, data, 1 + s % 3));
+  }
+  fail_unless(journal.index.data);
+
+  /* Create a shallow copy without index to force linear alignment */
+  pb_journal_t linear = journal;
+  linear.index.data = NULL;
+  linear.index.size = 0;
+
+  /* Align offsets at different positions */
+  for (size_t o = 0; o < pb_journal_size(&journal); o += 17) {
+    pb_version_t version1 = o % 100, version2 = o % 100;
+    pb_offset_t  offset1  = { o, o + 5 }, offset2 = { o, o + 5 };
+    ck_assert_uint_eq(
+      pb_journal_align(&linear,  &version2, &offset2),
+      pb_journal_align(&journal, &version1, &offset1));
+
+    /* Assert same version and offset */
+    ck_assert_uint_eq(version2, version1);
+    ck_assert_uint_eq(offset2.start, offset1.start);
+    ck_assert_uint_eq(offset2.end,   offset1.end);
+  }
+
+  /* Align offset in front of all changes */
+  pb_version_t version = 0; pb_offset_t offset = { 0, 0 };
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_journal_align(&journal, &version, &offset));
+  ck_assert_uint_eq(400, version);
+
+  /* Free all allocated memory */
+  pb_journal_destroy(&journal);
+} END_TEST
+
 /*
  * Align an offset of a specific version according to an invalid journal.
  */
@@ -1031,6 +1721,474 @@ START_TEST(test_align_invalid) {
   pb_journal_destroy(&journal);
 } END_TEST
 
+/*
+ * Freeze a journal and write data to it.
+ */
+START_TEST(test_freeze) {
+  pb_journal_t journal = pb_journal_create_gap_buffer(NULL, 0);
+
+  /* Write data to journal */
+  uint8_t data[] = "SOME DATA";
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_journal_write(&journal, 0, 0, 0, data, 9));
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_journal_write(&journal, 0, 0, 0, data, 5));
+
+  /* Freeze journal */
+  fail_if(pb_journal_frozen(&journal));
+  fail_if(pb_journal_freeze(&journal));
+  fail_unless(pb_journal_frozen(&journal));
+  ck_assert_uint_eq(0, journal.gap.size);
+
+  /* Assert failing writes and clears */
+  ck_assert_uint_eq(PB_ERROR_INVALID,
+    pb_journal_write(&journal, 0, 0, 0, data, 9));
+  ck_assert_uint_eq(PB_ERROR_INVALID,
+    pb_journal_write(&journal, 0, 0, 4, data, 4));
+  ck_assert_uint_eq(PB_ERROR_INVALID,
+    pb_journal_clear(&journal, 0, 0, 4));
+
+  /* Assert journal validity, size and version */
+  fail_unless(pb_journal_valid(&journal));
+  ck_assert_uint_eq(14, pb_journal_size(&journal));
+  ck_assert_uint_eq(2, pb_journal_version(&journal));
+
+  /* Assert unchanged contents */
+  fail_if(memcmp("SOME SOME DATA", pb_journal_data(&journal), 14));
+
+  /* Free all allocated memory */
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Create a checkpoint and align an offset according to a journal.
+ */
+START_TEST(test_checkpoint) {
+  pb_journal_t journal = pb_journal_create_empty();
+
+  /* Iteratively grow journal: "" => "HELP I'M TRAPPED ..." */
+  uint8_t data[] = "HELP I'M TRAPPED IN A UNIVERSE FACTORY";
+  for (size_t s = 1; s < 20; s++)
+    ck_assert_uint_eq(PB_ERROR_NONE,
+      pb_journal_write(&journal, 0, 0, pb_journal_size(&journal), data, s));
+
+  /* Align offset and create checkpoint */
+  pb_version_t version = 0; pb_offset_t offset = { 0, 0 };
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_journal_align(&journal, &version, &offset));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_journal_checkpoint(&journal));
+
+  /* Assert journal version and entries */
+  ck_assert_uint_eq(19, pb_journal_version(&journal));
+  ck_assert_uint_eq(0, journal.entry.size);
+  ck_assert_ptr_eq(NULL, journal.entry.data);
+
+  /* Grow journal: "HELP I'M ... UNIV" => "HELP I'M ... UNIVERSE" */
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_journal_write(&journal, 0, 0, pb_journal_size(&journal), data, 21));
+
+  /* Perform alignment */
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_journal_align(&journal, &version, &offset));
+
+  /* Assert version and offset */
+  ck_assert_uint_eq(20, version);
+  ck_assert_uint_eq(0,  offset.start);
+  ck_assert_uint_eq(21, offset.end);
+
+  /* Free all allocated memory */
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Compact a journal and align an offset referring to a discarded version.
+ */
+START_TEST(test_compact) {
+  pb_journal_t journal = pb_journal_create_empty();
+
+  /* Iteratively grow journal: "" => "HELP I'M TRAPPED ..." */
+  uint8_t data[] = "HELP I'M TRAPPED IN A UNIVERSE FACTORY";
+  for (size_t s = 1; s < 20; s++)
+    ck_assert_uint_eq(PB_ERROR_NONE,
+      pb_journal_write(&journal, 0, 0, pb_journal_size(&journal), data, s));
+
+  /* Compact journal */
+  ck_assert_uint_eq(PB_ERROR_OFFSET, pb_journal_compact(&journal, 20));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_journal_compact(&journal, 10));
+
+  /* Assert journal version and entries */
+  ck_assert_uint_eq(19, pb_journal_version(&journal));
+  ck_assert_uint_eq(9, journal.entry.size);
+
+  /* Perform alignment from retained version */
+  pb_version_t version1 = 10; pb_offset_t offset1 = { 0, 10 };
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_journal_align(&journal, &version1, &offset1));
+  ck_assert_uint_eq(19, version1);
+  ck_assert_uint_eq(19, offset1.end);
+
+  /* Perform alignment from discarded version */
+  pb_version_t version2 = 5; pb_offset_t offset2 = { 0, 5 };
+  ck_assert_uint_eq(PB_ERROR_INVALID,
+    pb_journal_align(&journal, &version2, &offset2));
+  ck_assert_uint_eq(PB_VERSION_MAX, version2);
+
+  /* Free all allocated memory */
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Compact an invalid journal.
+ */
+START_TEST(test_compact_invalid) {
+  pb_journal_t journal = pb_journal_create_invalid();
+
+  /* Compact journal */
+  ck_assert_uint_eq(PB_ERROR_INVALID, pb_journal_compact(&journal, 0));
+  ck_assert_uint_eq(PB_ERROR_INVALID, pb_journal_checkpoint(&journal));
+
+  /* Free all allocated memory */
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Trim a journal.
+ */
+START_TEST(test_trim) {
+  pb_journal_t journal1 = pb_journal_create_gap_buffer(NULL, 0);
+  pb_journal_t journal2 = pb_journal_create_empty();
+
+  /* Iteratively grow journals: "" => "HELP I'M TRAPPED ..." */
+  uint8_t data[] = "HELP I'M TRAPPED IN A UNIVERSE FACTORY";
+  for (size_t s = 1; s < 20; s++) {
+    ck_assert_uint_eq(PB_ERROR_NONE,
+      pb_journal_write(&journal1, 0, 0, pb_journal_size(&journal1), data, s));
+    ck_assert_uint_eq(PB_ERROR_NONE,
+      pb_journal_write(&journal2, 0, 0, pb_journal_size(&journal2), data, s));
+  }
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_journal_clear(&journal1, 0, 10, 19));
+
+  /* Trim journal */
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_journal_trim(&journal1));
+  ck_assert_uint_eq(10, pb_journal_size(&journal1));
+  ck_assert_uint_eq(10, pb_buffer_capacity(&(journal1.buffer)));
+  ck_assert_uint_eq(20, journal1.entry.size);
+  ck_assert_uint_eq(20, journal1.entry.capacity);
+  fail_if(memcmp(data, pb_journal_data(&journal1), 10));
+
+  /* Perform alignment from retained version */
+  pb_version_t version = 10; pb_offset_t offset = { 0, 10 };
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_journal_align(&journal1, &version, &offset));
+  ck_assert_uint_eq(20, version);
+  ck_assert_uint_eq(10, offset.end);
+
+  /* Checkpoint and trim journal, releasing the entry log */
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_journal_checkpoint(&journal2));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_journal_trim(&journal2));
+  ck_assert_uint_eq(19, pb_journal_size(&journal2));
+  ck_assert_uint_eq(19, pb_buffer_capacity(&(journal2.buffer)));
+  ck_assert_uint_eq(0, journal2.entry.capacity);
+  ck_assert_ptr_eq(NULL, journal2.entry.data);
+
+  /* Free all allocated memory */
+  pb_journal_destroy(&journal2);
+  pb_journal_destroy(&journal1);
+} END_TEST
+
+/*
+ * Trim an invalid journal.
+ */
+START_TEST(test_trim_invalid) {
+  pb_journal_t journal = pb_journal_create_invalid();
+
+  /* Trim journal */
+  ck_assert_uint_eq(PB_ERROR_INVALID, pb_journal_trim(&journal));
+
+  /* Free all allocated memory */
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Attach external segments to a journal.
+ */
+START_TEST(test_attach) {
+  uint8_t data[] = "\x08\x2A";
+  pb_journal_t journal = pb_journal_create(data, 2);
+
+  /* Attach values */
+  size_t released = 0;
+  pb_string_t value1 = pb_string_init_from_chars("SOME DATA"),
+              value2 = pb_string_init_from_chars("");
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_journal_attach(&journal, 2, &value1, release_count, &released));
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_journal_attach(&journal, 300, &value2, release_count, &released));
+
+  /* Write in front of external segments */
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_journal_write(&journal, 0, 1, 2, (uint8_t *)"\x96\x01", 2));
+  ck_assert_uint_eq(3, pb_journal_size(&journal));
+
+  /* Assert serialized length and I/O vectors */
+  struct iovec iov[4];
+  ck_assert_uint_eq(17, pb_journal_length(&journal));
+  ck_assert_uint_eq(4, pb_journal_iovec(&journal, NULL, 0));
+  ck_assert_uint_eq(4, pb_journal_iovec(&journal, iov, 4));
+  fail_if(memcmp("\x08\x96\x01", iov[0].iov_base, iov[0].iov_len));
+  fail_if(memcmp("\x12\x09", iov[1].iov_base, iov[1].iov_len));
+  ck_assert_ptr_eq(pb_string_data(&value1), iov[2].iov_base);
+  fail_if(memcmp("\xE2\x12\x00", iov[3].iov_base, iov[3].iov_len));
+
+  /* Share external segments with a snapshot */
+  pb_journal_t snapshot = pb_journal_snapshot(&journal);
+  ck_assert_uint_eq(17, pb_journal_length(&snapshot));
+  pb_journal_destroy(&journal);
+  ck_assert_uint_eq(0, released);
+
+  /* Free all allocated memory */
+  pb_journal_destroy(&snapshot);
+  ck_assert_uint_eq(2, released);
+} END_TEST
+
+/*
+ * Attach an external segment to an invalid or frozen journal.
+ */
+START_TEST(test_attach_invalid) {
+  pb_journal_t journal1 = pb_journal_create_invalid(),
+               journal2 = pb_journal_create_empty();
+  fail_if(pb_journal_freeze(&journal2));
+
+  /* Attach values */
+  size_t released = 0;
+  pb_string_t value = pb_string_init_from_chars("SOME DATA");
+  ck_assert_uint_eq(PB_ERROR_INVALID,
+    pb_journal_attach(&journal1, 1, &value, release_count, &released));
+  ck_assert_uint_eq(PB_ERROR_INVALID,
+    pb_journal_attach(&journal2, 1, &value, release_count, &released));
+  ck_assert_uint_eq(2, released);
+
+  /* Free all allocated memory */
+  pb_journal_destroy(&journal2);
+  pb_journal_destroy(&journal1);
+} END_TEST
+
+/*
+ * Attach fragments to a journal.
+ */
+START_TEST(test_attach_fragment) {
+  uint8_t data[] = "\x08\x2A";
+  pb_journal_t journal1 = pb_journal_create(data, 2),
+               journal2 = pb_journal_create_empty();
+  fail_if(pb_journal_freeze(&journal2));
+
+  /* Create fragment */
+  pb_encoder_t encoder = pb_encoder_create(&descriptor);
+  uint32_t value = 127;
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_encoder_encode(&encoder, 1, &value, 1));
+  pb_fragment_t *fragment = pb_fragment_create(3, &encoder);
+  pb_encoder_destroy(&encoder);
+
+  /* Attach fragment twice, and once to a frozen journal */
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_journal_attach_fragment(&journal1, fragment));
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_journal_attach_fragment(&journal1, fragment));
+  ck_assert_uint_eq(PB_ERROR_INVALID,
+    pb_journal_attach_fragment(&journal2, fragment));
+  ck_assert_uint_eq(3, fragment->references);
+
+  /* Assert serialized length and I/O vectors */
+  struct iovec iov[3];
+  ck_assert_uint_eq(10, pb_journal_length(&journal1));
+  ck_assert_uint_eq(3, pb_journal_iovec(&journal1, iov, 3));
+  ck_assert_ptr_eq(pb_fragment_data(fragment), iov[1].iov_base);
+  ck_assert_ptr_eq(pb_fragment_data(fragment), iov[2].iov_base);
+  ck_assert_uint_eq(4, iov[2].iov_len);
+
+  /* Release fragment with journal */
+  pb_journal_destroy(&journal1);
+  ck_assert_uint_eq(1, fragment->references);
+
+  /* Free all allocated memory */
+  pb_fragment_release(fragment);
+  pb_journal_destroy(&journal2);
+} END_TEST
+
+/*
+ * Record writes to a journal and export and apply them as a patch.
+ */
+START_TEST(test_diff) {
+  uint8_t data[] = "SOME DATA";
+  pb_journal_t journal = pb_journal_create(data, 9),
+               replica = pb_journal_create(data, 9);
+
+  /* Record writes */
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_journal_record(&journal));
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_journal_write(&journal, 0, 0, 4, (uint8_t *)"MORE", 4));
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_journal_write(&journal, 0, 9, 9, (uint8_t *)"!!", 2));
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_journal_write(&journal, 0, 5, 9, (uint8_t *)"FUN", 3));
+  fail_if(memcmp("MORE FUN!!", pb_journal_data(&journal), 10));
+
+  /* Export patch */
+  pb_buffer_t patch = pb_buffer_create_empty();
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_journal_diff(&journal, 0, &patch));
+  ck_assert_uint_eq(16, pb_buffer_size(&patch));
+  fail_if(memcmp("\x09" "\x00\x04\x04" "MORE" "\x01\x04\x05" "FUN!!",
+    pb_buffer_data(&patch), 16));
+
+  /* Apply patch */
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_journal_apply_patch(&replica, &patch));
+  ck_assert_uint_eq(10, pb_journal_size(&replica));
+  fail_if(memcmp("MORE FUN!!", pb_journal_data(&replica), 10));
+
+  /* Free all allocated memory */
+  pb_buffer_destroy(&patch);
+  pb_journal_destroy(&replica);
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Export patches of overlapping writes and clears since several revisions.
+ */
+START_TEST(test_diff_overlapping) {
+  pb_journal_t journal = pb_journal_create_gap_buffer(NULL, 0);
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_journal_record(&journal));
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_journal_write(&journal, 0, 0, 0, (uint8_t *)"0123456789", 10));
+
+  /* Apply a sequence of writes and clears, keeping replicas */
+  pb_journal_t replica[8];
+  for (size_t r = 0; r < 8; r++) {
+    replica[r] = pb_journal_create(pb_journal_data(&journal),
+      pb_journal_size(&journal));
+    size_t size  = pb_journal_size(&journal),
+           start = (r * 7) % size,
+           end   = start + (r * 3) % (size - start);
+    if (r % 3 == 2) {
+      ck_assert_uint_eq(PB_ERROR_NONE,
+        pb_journal_clear(&journal, 0, start, end));
+    } else {
+      ck_assert_uint_eq(PB_ERROR_NONE,
+        pb_journal_write(&journal, 0, start, end,
+          (uint8_t *)"ABCDEFGH", r + 1));
+    }
+  }
+
+  /* Export patches since every revision and apply them */
+  for (size_t r = 0; r < 8; r++) {
+    pb_buffer_t patch = pb_buffer_create_empty();
+    ck_assert_uint_eq(PB_ERROR_NONE,
+      pb_journal_diff(&journal, r + 1, &patch));
+    ck_assert_uint_eq(PB_ERROR_NONE,
+      pb_journal_apply_patch(&replica[r], &patch));
+    ck_assert_uint_eq(pb_journal_size(&journal),
+      pb_journal_size(&replica[r]));
+    fail_if(memcmp(pb_journal_data(&journal), pb_journal_data(&replica[r]),
+      pb_journal_size(&journal)));
+    pb_buffer_destroy(&patch);
+    pb_journal_destroy(&replica[r]);
+  }
+
+  /* Free all allocated memory */
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Export a patch of a journal without changes.
+ */
+START_TEST(test_diff_empty) {
+  uint8_t data[] = "SOME DATA";
+  pb_journal_t journal = pb_journal_create(data, 9);
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_journal_record(&journal));
+
+  /* Export and apply patch */
+  pb_buffer_t patch = pb_buffer_create_empty();
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_journal_diff(&journal, 0, &patch));
+  ck_assert_uint_eq(1, pb_buffer_size(&patch));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_journal_apply_patch(&journal, &patch));
+  ck_assert_uint_eq(0, pb_journal_version(&journal));
+
+  /* Free all allocated memory */
+  pb_buffer_destroy(&patch);
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Export a patch for an invalid revision.
+ */
+START_TEST(test_diff_invalid) {
+  uint8_t data[] = "SOME DATA";
+  pb_journal_t journal = pb_journal_create(data, 9);
+  pb_buffer_t patch = pb_buffer_create_empty();
+
+  /* Assert failing export without recording */
+  ck_assert_uint_eq(PB_ERROR_INVALID, pb_journal_diff(&journal, 0, &patch));
+
+  /* Assert failing export for revisions outside of recording */
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_journal_write(&journal, 0, 0, 4, (uint8_t *)"MORE", 4));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_journal_record(&journal));
+  ck_assert_uint_eq(PB_ERROR_OFFSET, pb_journal_diff(&journal, 0, &patch));
+  ck_assert_uint_eq(PB_ERROR_OFFSET, pb_journal_diff(&journal, 2, &patch));
+  ck_assert_uint_eq(0, pb_buffer_size(&patch));
+
+  /* Free all allocated memory */
+  pb_buffer_destroy(&patch);
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Record writes to a zero-copy or invalid journal.
+ */
+START_TEST(test_record_invalid) {
+  uint8_t data[] = "SOME DATA";
+  pb_journal_t journal = pb_journal_create_zero_copy(data, 9),
+               invalid = pb_journal_create_invalid();
+
+  /* Assert failing recording */
+  ck_assert_uint_eq(PB_ERROR_ALLOC, pb_journal_record(&journal));
+  ck_assert_uint_eq(PB_ERROR_INVALID, pb_journal_record(&invalid));
+
+  /* Free all allocated memory */
+  pb_journal_destroy(&invalid);
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Apply an invalid patch or a patch for a journal of a different size.
+ */
+START_TEST(test_apply_patch_invalid) {
+  uint8_t data[] = "SOME DATA";
+  pb_journal_t journal = pb_journal_create(data, 9);
+
+  /* Assert failing patches */
+  const char *patches[] = {
+    "\x08",                                /* Size mismatch */
+    "\x09\x0A\x00\x00",                    /* Range out of bounds */
+    "\x09\x05\x05\x00",                    /* Range out of bounds */
+    "\x09\x00\x04\x04MOR",                 /* Missing data */
+    "\x09\x00\x04\x04MORE\x80"             /* Truncated varint */
+  };
+  const size_t sizes[] = { 1, 4, 4, 7, 9 };
+  for (size_t p = 0; p < 5; p++) {
+    pb_buffer_t patch = pb_buffer_create_zero_copy(
+      (uint8_t *)patches[p], sizes[p]);
+    fail_if(PB_ERROR_NONE == pb_journal_apply_patch(&journal, &patch));
+    pb_buffer_destroy(&patch);
+  }
+
+  /* Assert unchanged journal */
+  ck_assert_uint_eq(0, pb_journal_version(&journal));
+  fail_if(memcmp("SOME DATA", pb_journal_data(&journal), 9));
+
+  /* Free all allocated memory */
+  pb_journal_destroy(&journal);
+} END_TEST
+
 /* ----------------------------------------------------------------------------
  * Program
  * ------------------------------------------------------------------------- */
@@ -1050,7 +2208,19 @@ main(void) {
   tcase = tcase_create("create");
   tcase_add_test(tcase, test_create);
   tcase_add_test(tcase, test_create_empty);
+  tcase_add_test(tcase, test_create_padded);
   tcase_add_test(tcase, test_create_zero_copy);
+  tcase_add_test(tcase, test_create_copy_on_write);
+  tcase_add_test(tcase, test_create_copy_on_write_invalid);
+  tcase_add_test(tcase, test_create_snapshot);
+  tcase_add_test(tcase, test_create_snapshot_multiple);
+  tcase_add_test(tcase, test_create_snapshot_empty);
+  tcase_add_test(tcase, test_create_snapshot_invalid);
+  tcase_add_test(tcase, test_create_from_buffer);
+  tcase_add_test(tcase, test_create_from_buffer_zero_copy);
+  tcase_add_test(tcase, test_create_from_encoder);
+  tcase_add_test(tcase, test_create_from_encoder_scatter);
+  tcase_add_test(tcase, test_create_readonly);
   tcase_add_test(tcase, test_create_invalid);
   tcase_add_test(tcase, test_create_invalid_allocate);
   suite_add_tcase(suite, tcase);
@@ -1058,17 +2228,67 @@ main(void) {
   /* Add tests to test case "write" */
   tcase = tcase_create("write");
   tcase_add_test(tcase, test_write);
+  tcase_add_test(tcase, test_write_entry_capacity);
   tcase_add_test(tcase, test_write_zero_copy);
+  tcase_add_test(tcase, test_write_copy_on_write);
+  tcase_add_test(tcase, test_write_copy_on_write_same_length);
+  tcase_add_test(tcase, test_write_snapshot);
+  tcase_add_test(tcase, test_write_snapshot_original);
   tcase_add_test(tcase, test_write_invalid);
   tcase_add_test(tcase, test_write_invalid_allocate);
   tcase_add_test(tcase, test_write_invalid_resize);
   tcase_add_test(tcase, test_write_invalid_zero_copy);
   suite_add_tcase(suite, tcase);
 
+  /* Add tests to test case "gap" */
+  tcase = tcase_create("gap");
+  tcase_add_test(tcase, test_gap_buffer);
+  tcase_add_test(tcase, test_gap_buffer_overwrite);
+  tcase_add_test(tcase, test_gap_buffer_invalid_resize);
+  suite_add_tcase(suite, tcase);
+
+  /* Add tests to test case "freeze" */
+  tcase = tcase_create("freeze");
+  tcase_add_test(tcase, test_freeze);
+  suite_add_tcase(suite, tcase);
+
+  /* Add tests to test case "compact" */
+  tcase = tcase_create("compact");
+  tcase_add_test(tcase, test_checkpoint);
+  tcase_add_test(tcase, test_compact);
+  tcase_add_test(tcase, test_compact_invalid);
+  tcase_add_test(tcase, test_trim);
+  tcase_add_test(tcase, test_trim_invalid);
+  suite_add_tcase(suite, tcase);
+
+  /* Add tests to test case "reserve" */
+  tcase = tcase_create("reserve");
+  tcase_add_test(tcase, test_reserve);
+  tcase_add_test(tcase, test_reserve_invalid);
+  suite_add_tcase(suite, tcase);
+
+  /* Add tests to test case "attach" */
+  tcase = tcase_create("attach");
+  tcase_add_test(tcase, test_attach);
+  tcase_add_test(tcase, test_attach_invalid);
+  tcase_add_test(tcase, test_attach_fragment);
+  suite_add_tcase(suite, tcase);
+
+  /* Add tests to test case "diff" */
+  tcase = tcase_create("diff");
+  tcase_add_test(tcase, test_diff);
+  tcase_add_test(tcase, test_diff_overlapping);
+  tcase_add_test(tcase, test_diff_empty);
+  tcase_add_test(tcase, test_diff_invalid);
+  tcase_add_test(tcase, test_record_invalid);
+  tcase_add_test(tcase, test_apply_patch_invalid);
+  suite_add_tcase(suite, tcase);
+
   /* Add tests to test case "clear" */
   tcase = tcase_create("clear");
   tcase_add_test(tcase, test_clear);
   tcase_add_test(tcase, test_clear_zero_copy);
+  tcase_add_test(tcase, test_clear_copy_on_write);
   tcase_add_test(tcase, test_clear_invalid);
   tcase_add_test(tcase, test_clear_invalid_allocate);
   tcase_add_test(tcase, test_clear_invalid_resize);
@@ -1085,6 +2305,7 @@ main(void) {
   tcase_add_test(tcase, test_align_clear_outside);
   tcase_add_test(tcase, test_align_clear_after);
   tcase_add_test(tcase, test_align_clear_multiple);
+  tcase_add_test(tcase, test_align_index);
   tcase_add_test(tcase, test_align_invalid);
   suite_add_tcase(suite, tcase);
 
@@ -21,6 +21,7 @@
  */
 
 #include <check.h>
+#include <stddef.h>
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
@@ -28,6 +29,7 @@
 #include <protobluff/descriptor.h>
 
 #include "core/descriptor.h"
+#include "core/layout.h"
 #include "core/varint.h"
 #include "message/common.h"
 #include "message/cursor.h"
@@ -108,6 +110,65 @@ descriptor = { {
     { 15, "F15", MESSAGE, ONEOF, &descriptor, &oneof_descriptor }
   }, 15 } };
 
+/* Struct */
+typedef struct value_t {
+  uint32_t f01;                        /*!< F01 */
+  uint64_t f02;                        /*!< F02 */
+  int32_t f03;                         /*!< F03 */
+  int64_t f04;                         /*!< F04 */
+  uint8_t f05;                         /*!< F05 */
+  float f06;                           /*!< F06 */
+  double f07;                          /*!< F07 */
+  pb_string_t f08;                     /*!< F08 */
+  pb_string_t f09;                     /*!< F09 */
+  uint32_t f10;                        /*!< F10 */
+  struct value_t *f11;                 /*!< F11 */
+  pb_repeated_t f12;                   /*!< F12 */
+  uint32_t f13;                        /*!< F13 */
+  uint32_t f14;                        /*!< F14 */
+  struct value_t *f15;                 /*!< F15 */
+  uint8_t has[2];                      /*!< Presence bits */
+} value_t;
+
+/* Layout (forward declaration) */
+static const pb_layout_t
+layout;
+
+/* Layout */
+static const pb_layout_t
+layout = { &descriptor, {
+  (const pb_layout_field_t []){
+    { offsetof(value_t, f01) },
+    { offsetof(value_t, f02) },
+    { offsetof(value_t, f03) },
+    { offsetof(value_t, f04) },
+    { offsetof(value_t, f05) },
+    { offsetof(value_t, f06) },
+    { offsetof(value_t, f07) },
+    { offsetof(value_t, f08) },
+    { offsetof(value_t, f09) },
+    { offsetof(value_t, f10) },
+    { offsetof(value_t, f11), &layout },
+    { offsetof(value_t, f12), &layout },
+    { offsetof(value_t, f13) },
+    { offsetof(value_t, f14) },
+    { offsetof(value_t, f15), &layout }
+  }, 15 }, offsetof(value_t, has), sizeof(value_t) };
+
+/* Repeated descriptor (forward declaration) */
+static pb_descriptor_t
+repeated_descriptor;
+
+/* Repeated descriptor */
+static pb_descriptor_t
+repeated_descriptor = { {
+  (const pb_field_descriptor_t []){
+    {  1, "F01", UINT32,  REPEATED },
+    {  2, "F02", UINT32,  REPEATED, NULL, NULL, PACKED },
+    {  3, "F03", STRING,  REPEATED },
+    {  4, "F04", MESSAGE, OPTIONAL, &repeated_descriptor }
+  }, 4 } };
+
 /* ----------------------------------------------------------------------------
  * Tests
  * ------------------------------------------------------------------------- */
@@ -669,7 +730,7 @@ START_TEST(test_create_nested) {
     /* Create same submessage from root message */
     pb_message_t submessage = pb_message_create_nested(
       &(messages[0]), tags, m);
-    fail_unless(pb_message_equals(&(messages[m]), &submessage));
+    fail_unless(pb_message_same(&(messages[m]), &submessage));
 
     /* Assert submessage validity and error */
     fail_unless(pb_message_valid(&(messages[m])));
@@ -1105,6 +1166,148 @@ START_TEST(test_create_from_field_invalid) {
   pb_field_destroy(&field);
 } END_TEST
 
+/*
+ * Create a submessage within a message for the element with a key value.
+ */
+START_TEST(test_create_from_key) {
+  const uint8_t data[] = { 98, 2, 8, 1, 98, 2, 8, 2, 98, 4, 8, 1, 16, 5 };
+  const size_t  size   = 14;
+
+  /* Create journal and message */
+  pb_journal_t journal = pb_journal_create(data, size);
+  pb_message_t message = pb_message_create(&descriptor, &journal);
+
+  /* Create submessage for key */
+  pb_message_t submessage = pb_message_create_from_key(&message, 12, 1,
+    (const uint32_t []){ 1 });
+
+  /* Assert submessage validity and error */
+  fail_unless(pb_message_valid(&submessage));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_error(&submessage));
+
+  /* Assert last occurrence for equal keys */
+  ck_assert_uint_eq(10, pb_message_start(&submessage));
+  ck_assert_uint_eq(14, pb_message_end(&submessage));
+
+  /* Read value from submessage */
+  uint64_t value;
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_get(&submessage, 2, &value));
+  ck_assert_uint_eq(5, value);
+  pb_message_destroy(&submessage);
+
+  /* Create submessage for other key */
+  submessage = pb_message_create_from_key(&message, 12, 1,
+    (const uint32_t []){ 2 });
+  fail_unless(pb_message_valid(&submessage));
+  ck_assert_uint_eq(6, pb_message_start(&submessage));
+  ck_assert_uint_eq(8, pb_message_end(&submessage));
+  pb_message_destroy(&submessage);
+
+  /* Create submessage for absent key */
+  submessage = pb_message_create_from_key(&message, 12, 1,
+    (const uint32_t []){ 3 });
+  fail_if(pb_message_valid(&submessage));
+  ck_assert_uint_eq(PB_ERROR_INVALID, pb_message_error(&submessage));
+
+  /* Free all allocated memory */
+  pb_message_destroy(&submessage);
+  pb_message_destroy(&message);
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Create a submessage within a message for the element with a string key.
+ */
+START_TEST(test_create_from_key_strings) {
+  const uint8_t data[] = { 98, 3, 66, 1, 65, 98, 3, 66, 1, 66 };
+  const size_t  size   = 10;
+
+  /* Create journal and message */
+  pb_journal_t journal = pb_journal_create(data, size);
+  pb_message_t message = pb_message_create(&descriptor, &journal);
+
+  /* Create submessage for key */
+  pb_string_t  key        = pb_string_const("B");
+  pb_message_t submessage = pb_message_create_from_key(&message, 12, 8, &key);
+
+  /* Assert submessage validity and error */
+  fail_unless(pb_message_valid(&submessage));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_error(&submessage));
+
+  /* Assert submessage offsets */
+  ck_assert_uint_eq(7, pb_message_start(&submessage));
+  ck_assert_uint_eq(10, pb_message_end(&submessage));
+
+  /* Free all allocated memory */
+  pb_message_destroy(&submessage);
+  pb_message_destroy(&message);
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Create submessages for many keys and after altering the message.
+ */
+START_TEST(test_create_from_key_altered) {
+  uint8_t data[160];
+  for (size_t e = 0; e < 40; e++)
+    memcpy(&(data[e * 4]), (const uint8_t []){ 98, 2, 8, e + 1 }, 4);
+  const size_t size = 160;
+
+  /* Create journal and message */
+  pb_journal_t journal = pb_journal_create(data, size);
+  pb_message_t message = pb_message_create(&descriptor, &journal);
+
+  /* Create submessages for all keys */
+  for (uint32_t k = 1; k <= 40; k++) {
+    pb_message_t submessage =
+      pb_message_create_from_key(&message, 12, 1, &k);
+    fail_unless(pb_message_valid(&submessage));
+    ck_assert_uint_eq(k * 4 - 2, pb_message_start(&submessage));
+    pb_message_destroy(&submessage);
+  }
+
+  /* Alter key of submessage */
+  pb_message_t submessage = pb_message_create_from_key(&message, 12, 1,
+    (const uint32_t []){ 20 });
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_put(&submessage, 1,
+    (const uint32_t []){ 50 }));
+  pb_message_destroy(&submessage);
+
+  /* Assert rebuilt key index */
+  submessage = pb_message_create_from_key(&message, 12, 1,
+    (const uint32_t []){ 20 });
+  fail_if(pb_message_valid(&submessage));
+  pb_message_destroy(&submessage);
+  submessage = pb_message_create_from_key(&message, 12, 1,
+    (const uint32_t []){ 50 });
+  fail_unless(pb_message_valid(&submessage));
+  ck_assert_uint_eq(78, pb_message_start(&submessage));
+
+  /* Free all allocated memory */
+  pb_message_destroy(&submessage);
+  pb_message_destroy(&message);
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Create a submessage within an invalid message for a key value.
+ */
+START_TEST(test_create_from_key_invalid) {
+  pb_message_t message = pb_message_create_invalid();
+
+  /* Create submessage for key */
+  pb_message_t submessage = pb_message_create_from_key(&message, 12, 1,
+    (const uint32_t []){ 1 });
+
+  /* Assert submessage validity and error */
+  fail_if(pb_message_valid(&submessage));
+  ck_assert_uint_eq(PB_ERROR_INVALID, pb_message_error(&submessage));
+
+  /* Free all allocated memory */
+  pb_message_destroy(&submessage);
+  pb_message_destroy(&message);
+} END_TEST
+
 /*
  * Create an invalid message.
  */
@@ -1136,7 +1339,7 @@ START_TEST(test_copy) {
   ck_assert_uint_eq(PB_ERROR_NONE, pb_message_error(&copy));
 
   /* Assert same contents */
-  fail_unless(pb_message_equals(&message, &copy));
+  fail_unless(pb_message_same(&message, &copy));
 
   /* Free all allocated memory */
   pb_message_destroy(&copy);
@@ -1847,6 +2050,128 @@ START_TEST(test_get_unaligned) {
   pb_journal_destroy(&journal);
 } END_TEST
 
+/*
+ * Read the values for a set of tags from a message.
+ */
+START_TEST(test_get_many) {
+  const uint8_t data[] = { 8, 127, 8, 100, 16, 5, 104, 127, 112, 127 };
+  const size_t  size   = 10;
+
+  /* Create journal and message */
+  pb_journal_t journal = pb_journal_create(data, size);
+  pb_message_t message = pb_message_create(&descriptor, &journal);
+
+  /* Read values from message */
+  uint32_t value1 = 0, value4, value5 = 0, value6 = 0;
+  uint64_t value2 = 0;
+  pb_string_t value3;
+  ck_assert_uint_eq(PB_ERROR_ABSENT,
+    pb_message_get_many(&message, (const pb_tag_t []){ 1, 2, 8, 13, 14, 10 },
+      (void *[]){ &value1, &value2, &value3, &value4, &value5, &value6 },
+        6));
+
+  /* Assert last occurrences, default values and absent fields */
+  ck_assert_uint_eq(100, value1);
+  ck_assert_uint_eq(5, value2);
+  fail_unless(pb_string_equals(&default_string, &value3));
+  ck_assert_uint_eq(127, value5);
+  ck_assert_uint_eq(0, value6);
+
+  /* Free all allocated memory */
+  pb_message_destroy(&message);
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Read the values for a set of tags from an empty message.
+ */
+START_TEST(test_get_many_empty) {
+  pb_journal_t journal = pb_journal_create_empty();
+  pb_message_t message = pb_message_create(&descriptor, &journal);
+
+  /* Read values from message */
+  uint32_t value1 = 0;
+  uint64_t value2 = 0;
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_message_get_many(&message, (const pb_tag_t []){ 1, 2 },
+      (void *[]){ &value1, &value2 }, 2));
+
+  /* Assert default values */
+  ck_assert_uint_eq(default_uint32, value1);
+  ck_assert_uint_eq(default_uint64, value2);
+
+  /* Free all allocated memory */
+  pb_message_destroy(&message);
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Read the values for a set of tags from an invalid message.
+ */
+START_TEST(test_get_many_invalid) {
+  pb_message_t message = pb_message_create_invalid();
+
+  /* Read values from message */
+  uint32_t value;
+  ck_assert_uint_eq(PB_ERROR_INVALID,
+    pb_message_get_many(&message, (const pb_tag_t []){ 1 },
+      (void *[]){ &value }, 1));
+
+  /* Free all allocated memory */
+  pb_message_destroy(&message);
+} END_TEST
+
+/*
+ * Read all singular fields of a message into a struct.
+ */
+START_TEST(test_get_fields) {
+  const uint8_t data[] = { 8, 127, 8, 100, 66, 3, 65, 66, 67, 90, 0,
+                           104, 127, 112, 127 };
+  const size_t  size   = 15;
+
+  /* Create journal and message */
+  pb_journal_t journal = pb_journal_create(data, size);
+  pb_message_t message = pb_message_create(&descriptor, &journal);
+
+  /* Read fields into struct */
+  value_t value;
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_message_get_fields(&message, &layout, &value));
+
+  /* Assert present fields and default values */
+  fail_unless(pb_layout_has(&layout, &value, 0));
+  ck_assert_uint_eq(100, value.f01);
+  fail_if(pb_layout_has(&layout, &value, 1));
+  ck_assert_uint_eq(default_uint64, value.f02);
+  fail_unless(pb_layout_has(&layout, &value, 7));
+  ck_assert_uint_eq(3, pb_string_size(&(value.f08)));
+
+  /* Assert active member of oneof and skipped repeated message */
+  fail_if(pb_layout_has(&layout, &value, 11));
+  fail_if(pb_layout_has(&layout, &value, 12));
+  fail_unless(pb_layout_has(&layout, &value, 13));
+  ck_assert_uint_eq(127, value.f14);
+
+  /* Free all allocated memory */
+  pb_message_destroy(&message);
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Read all singular fields of an invalid message into a struct.
+ */
+START_TEST(test_get_fields_invalid) {
+  pb_message_t message = pb_message_create_invalid();
+
+  /* Read fields into struct */
+  value_t value;
+  ck_assert_uint_eq(PB_ERROR_INVALID,
+    pb_message_get_fields(&message, &layout, &value));
+
+  /* Free all allocated memory */
+  pb_message_destroy(&message);
+} END_TEST
+
 /*
  * Read the value for a given tag from an invalid message.
  */
@@ -2408,7 +2733,7 @@ START_TEST(test_put_unaligned) {
   ck_assert_uint_eq(PB_ERROR_NONE, pb_message_error(&message1));
 
   /* Assert messages are unaligned */
-  fail_if(pb_message_equals(&message1, &message2));
+  fail_if(pb_message_same(&message1, &message2));
 
   /* Assert contents */
   ck_assert_uint_eq(PB_ERROR_NONE, pb_message_get(&message1, 1, &value1));
@@ -2439,27 +2764,31 @@ START_TEST(test_put_invalid) {
 } END_TEST
 
 /*
- * Erase a field for a given tag from a message.
+ * Read and write a value for a given tag from a message on a frozen journal.
  */
-START_TEST(test_erase) {
+START_TEST(test_put_frozen) {
   const uint8_t data[] = { 8, 127 };
   const size_t  size   = 2;
 
   /* Create journal and message */
-  pb_journal_t journal = pb_journal_create(data, size);
+  pb_journal_t journal = pb_journal_create_readonly(data, size);
   pb_message_t message = pb_message_create(&descriptor, &journal);
 
-  /* Clear field from message */
-  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_erase(&message, 1));
-  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_erase(&message, 1));
+  /* Read value from message */
+  uint32_t value = 0;
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_get(&message, 1, &value));
+  ck_assert_uint_eq(127, value);
 
-  /* Assert message validity and error */
-  fail_unless(pb_message_valid(&message));
-  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_error(&message));
+  /* Write value to message */
+  value = 1000000;
+  ck_assert_uint_eq(PB_ERROR_INVALID, pb_message_put(&message, 1, &value));
+  ck_assert_uint_eq(PB_ERROR_INVALID, pb_message_put(&message, 2, &value));
+  ck_assert_uint_eq(PB_ERROR_INVALID, pb_message_erase(&message, 1));
 
-  /* Assert journal size */
-  fail_unless(pb_journal_empty(&journal));
-  ck_assert_uint_eq(0, pb_journal_size(&journal));
+  /* Assert message validity and unchanged contents */
+  fail_unless(pb_message_valid(&message));
+  ck_assert_uint_eq(2, pb_journal_size(&journal));
+  fail_if(memcmp(data, pb_journal_data(&journal), size));
 
   /* Free all allocated memory */
   pb_message_destroy(&message);
@@ -2467,23 +2796,36 @@ START_TEST(test_erase) {
 } END_TEST
 
 /*
- * Erase a field for a given tag from an empty message.
+ * Write a run of values for a given repeated tag to a message.
  */
-START_TEST(test_erase_empty) {
+START_TEST(test_put_repeated) {
+  uint8_t data[] = { 8, 1, 8, 2, 8, 3 };
+  size_t  size   = 6;
+
+  /* Create journal and message */
   pb_journal_t journal = pb_journal_create_empty();
-  pb_message_t message = pb_message_create(&descriptor, &journal);
+  pb_message_t message = pb_message_create(&repeated_descriptor, &journal);
 
-  /* Clear field from message */
-  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_erase(&message, 1));
-  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_erase(&message, 1));
+  /* Write values to message */
+  uint32_t values[] = { 1, 2, 3 };
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_message_put_repeated(&message, 1, values, 3));
+  fail_if(memcmp(data, pb_journal_data(&journal), size));
+
+  /* Align message to perform checks */
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_align(&message));
 
   /* Assert message validity and error */
   fail_unless(pb_message_valid(&message));
   ck_assert_uint_eq(PB_ERROR_NONE, pb_message_error(&message));
 
+  /* Assert message size and offsets */
+  ck_assert_uint_eq(6, pb_message_size(&message));
+  ck_assert_uint_eq(0, pb_message_start(&message));
+  ck_assert_uint_eq(6, pb_message_end(&message));
+
   /* Assert journal size */
-  fail_unless(pb_journal_empty(&journal));
-  ck_assert_uint_eq(0, pb_journal_size(&journal));
+  ck_assert_uint_eq(6, pb_journal_size(&journal));
 
   /* Free all allocated memory */
   pb_message_destroy(&message);
@@ -2491,27 +2833,27 @@ START_TEST(test_erase_empty) {
 } END_TEST
 
 /*
- * Erase a field for a given tag from a merged message.
+ * Write a run of strings for a given repeated tag to a message.
  */
-START_TEST(test_erase_merged) {
-  const uint8_t data[] = { 8, 1, 8, 2, 8, 3, 8, 4 };
-  const size_t  size   = 8;
+START_TEST(test_put_repeated_strings) {
+  uint8_t data[] = { 26, 1, 'A', 26, 2, 'B', 'C' };
+  size_t  size   = 7;
 
   /* Create journal and message */
-  pb_journal_t journal = pb_journal_create(data, size);
-  pb_message_t message = pb_message_create(&descriptor, &journal);
-
-  /* Clear field from message */
-  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_erase(&message, 1));
-  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_erase(&message, 1));
-
-  /* Assert message validity and error */
-  fail_unless(pb_message_valid(&message));
-  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_error(&message));
+  pb_journal_t journal = pb_journal_create_empty();
+  pb_message_t message = pb_message_create(&repeated_descriptor, &journal);
+
+  /* Write values to message */
+  pb_string_t values[] = {
+    pb_string_init_from_chars("A"),
+    pb_string_init_from_chars("BC")
+  };
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_message_put_repeated(&message, 3, values, 2));
+  fail_if(memcmp(data, pb_journal_data(&journal), size));
 
   /* Assert journal size */
-  fail_unless(pb_journal_empty(&journal));
-  ck_assert_uint_eq(0, pb_journal_size(&journal));
+  ck_assert_uint_eq(7, pb_journal_size(&journal));
 
   /* Free all allocated memory */
   pb_message_destroy(&message);
@@ -2519,157 +2861,130 @@ START_TEST(test_erase_merged) {
 } END_TEST
 
 /*
- * Clear a submessage for a given tag from a message.
+ * Write an empty run of values for a given repeated tag to a message.
  */
-START_TEST(test_erase_message) {
+START_TEST(test_put_repeated_empty) {
   pb_journal_t journal = pb_journal_create_empty();
-  pb_message_t message = pb_message_create(&descriptor, &journal);
-  pb_message_t submessage = pb_message_create_within(&message, 11);
-
-  /* Align messages to perform checks */
-  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_align(&message));
-
-  /* Assert message size and version */
-  fail_if(pb_message_empty(&message));
-  ck_assert_uint_eq(2, pb_message_size(&message));
-  ck_assert_uint_eq(1, pb_message_version(&message));
-
-  /* Clear submessage and align message to perform checks */
-  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_erase(&message, 11));
-  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_erase(&message, 11));
-  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_align(&message));
-
-  /* Assert message validity and error */
-  fail_unless(pb_message_valid(&message));
-  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_error(&message));
-
-  /* Assert message size and version */
-  fail_unless(pb_message_empty(&message));
-  ck_assert_uint_eq(0, pb_message_size(&message));
-  ck_assert_uint_eq(2, pb_message_version(&message));
-
-  /* Assert message offsets */
-  ck_assert_uint_eq(0, pb_message_start(&message));
-  ck_assert_uint_eq(0, pb_message_end(&message));
-
-  /* Align submessage to perform checks */
-  ck_assert_uint_eq(PB_ERROR_INVALID, pb_message_align(&submessage));
+  pb_message_t message = pb_message_create(&repeated_descriptor, &journal);
 
-  /* Assert submessage validity and error */
-  fail_if(pb_message_valid(&submessage));
-  ck_assert_uint_eq(PB_ERROR_INVALID, pb_message_error(&submessage));
+  /* Write no values to message */
+  uint32_t values[] = { 1 };
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_message_put_repeated(&message, 1, values, 0));
 
   /* Assert journal size */
   fail_unless(pb_journal_empty(&journal));
-  ck_assert_uint_eq(0, pb_journal_size(&journal));
 
   /* Free all allocated memory */
-  pb_message_destroy(&submessage);
   pb_message_destroy(&message);
   pb_journal_destroy(&journal);
 } END_TEST
 
 /*
- * Clear an existing submessage for a given tag from a message.
+ * Write a run of values for a given repeated tag to an invalid message.
  */
-START_TEST(test_erase_message_existing) {
-  const uint8_t data[] = { 90, 0 };
-  const size_t  size   = 2;
-
-  /* Create journal, message and submessage */
-  pb_journal_t journal = pb_journal_create(data, size);
-  pb_message_t message = pb_message_create(&descriptor, &journal);
-  pb_message_t submessage = pb_message_create_within(&message, 11);
-
-  /* Clear submessage and align message to perform checks */
-  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_erase(&message, 11));
-  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_align(&message));
+START_TEST(test_put_repeated_invalid) {
+  pb_message_t message = pb_message_create_invalid();
 
   /* Assert message validity and error */
-  fail_unless(pb_message_valid(&message));
-  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_error(&message));
+  fail_if(pb_message_valid(&message));
+  ck_assert_uint_eq(PB_ERROR_INVALID, pb_message_error(&message));
 
-  /* Assert message size and version */
-  fail_unless(pb_message_empty(&message));
-  ck_assert_uint_eq(0, pb_message_size(&message));
-  ck_assert_uint_eq(1, pb_message_version(&message));
+  /* Write values to message */
+  uint32_t values[] = { 1, 2, 3 };
+  ck_assert_uint_eq(PB_ERROR_INVALID,
+    pb_message_put_repeated(&message, 1, values, 3));
 
-  /* Assert message offsets */
-  ck_assert_uint_eq(0, pb_message_start(&message));
-  ck_assert_uint_eq(0, pb_message_end(&message));
+  /* Free all allocated memory */
+  pb_message_destroy(&message);
+} END_TEST
 
-  /* Align submessage */
-  ck_assert_uint_eq(PB_ERROR_INVALID, pb_message_align(&submessage));
+/*
+ * Write a run of values for a given packed tag to a message.
+ */
+START_TEST(test_put_packed) {
+  const uint8_t data[] = { 18, 1, 5 };
+  const size_t  size   = 3;
+  const uint8_t check[] = { 18, 4, 5, 1, 172, 2 };
 
-  /* Assert submessage validity and error */
-  fail_if(pb_message_valid(&submessage));
-  ck_assert_uint_eq(PB_ERROR_INVALID, pb_message_error(&submessage));
+  /* Create journal and message */
+  pb_journal_t journal = pb_journal_create(data, size);
+  pb_message_t message = pb_message_create(&repeated_descriptor, &journal);
 
-  /* Assert journal size */
-  fail_unless(pb_journal_empty(&journal));
-  ck_assert_uint_eq(0, pb_journal_size(&journal));
+  /* Write values to message */
+  uint32_t values[] = { 1, 300 };
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_message_put_packed(&message, 2, values, 2));
+  fail_if(memcmp(check, pb_journal_data(&journal), 6));
+
+  /* Align message to perform checks */
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_align(&message));
+
+  /* Assert message size and offsets */
+  ck_assert_uint_eq(6, pb_message_size(&message));
+  ck_assert_uint_eq(0, pb_message_start(&message));
+  ck_assert_uint_eq(6, pb_message_end(&message));
 
   /* Free all allocated memory */
-  pb_message_destroy(&submessage);
   pb_message_destroy(&message);
   pb_journal_destroy(&journal);
 } END_TEST
 
 /*
- * Clear a repeated submessage for a given tag from a message.
+ * Write a run of values for a given packed tag to a nested message.
  */
-START_TEST(test_erase_message_repeated) {
-  pb_journal_t journal = pb_journal_create_empty();
-  pb_message_t message = pb_message_create(&descriptor, &journal);
-
-  /* Create a hundred submessage siblings and write values to them */
-  for (size_t m = 1; m < 101; m++) {
-    uint64_t value = m;
+START_TEST(test_put_packed_nested) {
+  const uint8_t data[] = { 34, 3, 18, 1, 5 };
+  const size_t  size   = 5;
+  const uint8_t check[] = { 34, 5, 18, 3, 5, 1, 2 };
 
-    /* Create submessage and write value */
-    pb_message_t submessage = pb_message_create_within(&message, 12);
-    ck_assert_uint_eq(PB_ERROR_NONE, pb_message_put(&submessage, 2, &value));
+  /* Create journal, message and submessage */
+  pb_journal_t journal = pb_journal_create(data, size);
+  pb_message_t message = pb_message_create(&repeated_descriptor, &journal);
+  pb_message_t submessage = pb_message_create_within(&message, 4);
 
-    /* Free all allocated memory */
-    pb_message_destroy(&submessage);
-  }
+  /* Write values to submessage */
+  uint32_t values[] = { 1, 2 };
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_message_put_packed(&submessage, 2, values, 2));
+  fail_if(memcmp(check, pb_journal_data(&journal), 7));
 
-  /* Align message to perform checks */
+  /* Align messages to perform checks */
   ck_assert_uint_eq(PB_ERROR_NONE, pb_message_align(&message));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_align(&submessage));
 
-  /* Assert message validity and error */
-  fail_unless(pb_message_valid(&message));
-  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_error(&message));
-
-  /* Assert message size and version */
-  fail_if(pb_message_empty(&message));
-  ck_assert_uint_eq(400, pb_message_size(&message));
-  ck_assert_uint_eq(300, pb_message_version(&message));
-
-  /* Assert message offsets */
-  ck_assert_uint_eq(0, pb_message_start(&message));
-  ck_assert_uint_eq(400, pb_message_end(&message));
+  /* Assert message and submessage size */
+  ck_assert_uint_eq(7, pb_message_size(&message));
+  ck_assert_uint_eq(5, pb_message_size(&submessage));
 
-  /* Clear submessage and align message to perform checks */
-  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_erase(&message, 12));
-  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_align(&message));
+  /* Free all allocated memory */
+  pb_message_destroy(&submessage);
+  pb_message_destroy(&message);
+  pb_journal_destroy(&journal);
+} END_TEST
 
-  /* Assert message validity and error */
-  fail_unless(pb_message_valid(&message));
-  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_error(&message));
+/*
+ * Write the values for a set of tags to an empty message at once.
+ */
+START_TEST(test_put_many) {
+  const uint8_t check[] = { 8, 1, 16, 2, 66, 3, 65, 66, 67 };
 
-  /* Assert message size and version again */
-  fail_unless(pb_message_empty(&message));
-  ck_assert_uint_eq(0, pb_message_size(&message));
-  ck_assert_uint_eq(400, pb_message_version(&message));
+  /* Create journal and message */
+  pb_journal_t journal = pb_journal_create_empty();
+  pb_message_t message = pb_message_create(&descriptor, &journal);
 
-  /* Assert message offsets again */
-  ck_assert_uint_eq(0, pb_message_start(&message));
-  ck_assert_uint_eq(0, pb_message_end(&message));
+  /* Write values to message in reverse order */
+  uint32_t value1 = 1;
+  uint64_t value2 = 2;
+  pb_string_t value3 = pb_string_init_from_chars("ABC");
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_message_put_many(&message, (const pb_tag_t []){ 8, 2, 1 },
+      (const void *[]){ &value3, &value2, &value1 }, 3));
+  fail_if(memcmp(check, pb_journal_data(&journal), 9));
 
-  /* Assert journal size */
-  fail_unless(pb_journal_empty(&journal));
-  ck_assert_uint_eq(0, pb_journal_size(&journal));
+  /* Assert message size and version */
+  ck_assert_uint_eq(9, pb_message_size(&message));
+  ck_assert_uint_eq(1, pb_message_version(&message));
 
   /* Free all allocated memory */
   pb_message_destroy(&message);
@@ -2677,98 +2992,119 @@ START_TEST(test_erase_message_repeated) {
 } END_TEST
 
 /*
- * Erase a field for a given tag from a submessage.
+ * Write the values for a set of tags to a message with existing fields.
  */
-START_TEST(test_erase_message_nested) {
-  pb_journal_t journal = pb_journal_create_empty();
+START_TEST(test_put_many_existing) {
+  const uint8_t data[] = { 8, 127, 80, 5, 104, 127 };
+  const size_t  size   = 6;
+  const uint8_t check[] = { 8, 50, 80, 5, 112, 100 };
+
+  /* Create journal and message */
+  pb_journal_t journal = pb_journal_create(data, size);
   pb_message_t message = pb_message_create(&descriptor, &journal);
-  pb_message_t submessage = pb_message_create_within(&message, 11);
 
-  /* Write value to submessage */
-  uint32_t value = 127;
-  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_put(&submessage, 1, &value));
+  /* Replace value and switch member of oneof */
+  uint32_t value1 = 50, value2 = 100;
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_message_put_many(&message, (const pb_tag_t []){ 14, 1 },
+      (const void *[]){ &value2, &value1 }, 2));
+  fail_if(memcmp(check, pb_journal_data(&journal), 6));
 
-  /* Clear field from submessage */
-  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_erase(&submessage, 1));
-  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_erase(&submessage, 1));
+  /* Assert message size */
+  ck_assert_uint_eq(6, pb_message_size(&message));
 
-  /* Assert submessage validity and error */
-  fail_unless(pb_message_valid(&submessage));
-  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_error(&submessage));
+  /* Free all allocated memory */
+  pb_message_destroy(&message);
+  pb_journal_destroy(&journal);
+} END_TEST
 
-  /* Assert submessage size and version */
-  fail_unless(pb_message_empty(&submessage));
-  ck_assert_uint_eq(0, pb_message_size(&submessage));
-  ck_assert_uint_eq(4, pb_message_version(&submessage));
+/*
+ * Write the values for a set of repeated tags to a message at once.
+ */
+START_TEST(test_put_many_repeated) {
+  const uint8_t data[] = { 8, 1, 18, 1, 2 };
+  const size_t  size   = 5;
+  const uint8_t check[] = { 8, 1, 8, 5, 18, 1, 2, 18, 2, 3, 4 };
 
-  /* Assert submessage offsets */
-  ck_assert_uint_eq(2, pb_message_start(&submessage));
-  ck_assert_uint_eq(2, pb_message_end(&submessage));
+  /* Create journal and message */
+  pb_journal_t journal = pb_journal_create(data, size);
+  pb_message_t message = pb_message_create(&repeated_descriptor, &journal);
 
-  /* Assert message validity and error */
-  fail_unless(pb_message_valid(&message));
-  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_error(&message));
+  /* Append values to repeated and packed fields */
+  uint32_t values[] = { 3, 4, 5 };
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_message_put_many(&message, (const pb_tag_t []){ 2, 2, 1 },
+      (const void *[]){ &values[0], &values[1], &values[2] }, 3));
+  fail_if(memcmp(check, pb_journal_data(&journal), 11));
 
-  /* Assert journal size */
-  fail_if(pb_journal_empty(&journal));
-  ck_assert_uint_eq(2, pb_journal_size(&journal));
+  /* Assert message size */
+  ck_assert_uint_eq(11, pb_message_size(&message));
 
   /* Free all allocated memory */
-  pb_message_destroy(&submessage);
   pb_message_destroy(&message);
   pb_journal_destroy(&journal);
 } END_TEST
 
 /*
- * Erase a field for a given tag that is part of a oneof from a message.
+ * Write the values for a set of tags to a submessage at once.
  */
-START_TEST(test_erase_oneof) {
-  const uint8_t data[] = { 112, 127 };
-  const size_t  size   = 2;
+START_TEST(test_put_many_nested) {
+  const uint8_t data[] = { 34, 2, 8, 1 };
+  const size_t  size   = 4;
+  const uint8_t check[] = { 34, 6, 8, 1, 8, 2, 26, 0 };
 
-  /* Create journal and message */
+  /* Create journal, message and submessage */
   pb_journal_t journal = pb_journal_create(data, size);
-  pb_message_t message = pb_message_create(&descriptor, &journal);
+  pb_message_t message = pb_message_create(&repeated_descriptor, &journal);
+  pb_message_t submessage = pb_message_create_within(&message, 4);
 
-  /* Clear field from message */
-  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_erase(&message, 14));
-  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_erase(&message, 14));
+  /* Write values to submessage */
+  uint32_t value = 2;
+  pb_string_t empty = pb_string_init_from_chars("");
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_message_put_many(&submessage, (const pb_tag_t []){ 3, 1 },
+      (const void *[]){ &empty, &value }, 2));
+  fail_if(memcmp(check, pb_journal_data(&journal), 8));
 
-  /* Assert message validity and error */
-  fail_unless(pb_message_valid(&message));
-  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_error(&message));
+  /* Align messages to perform checks */
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_align(&message));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_align(&submessage));
 
-  /* Assert journal size */
-  fail_unless(pb_journal_empty(&journal));
-  ck_assert_uint_eq(0, pb_journal_size(&journal));
+  /* Assert message and submessage size */
+  ck_assert_uint_eq(8, pb_message_size(&message));
+  ck_assert_uint_eq(6, pb_message_size(&submessage));
 
   /* Free all allocated memory */
+  pb_message_destroy(&submessage);
   pb_message_destroy(&message);
   pb_journal_destroy(&journal);
 } END_TEST
 
 /*
- * Erase a field for a given tag that is part of a oneof from a merged message.
+ * Write the values for a set of tags to a message with an index at once.
  */
-START_TEST(test_erase_oneof_merged) {
-  const uint8_t data[] = { 104, 1, 122, 0, 112, 3 };
-  const size_t  size   = 6;
+START_TEST(test_put_many_index) {
+  const uint8_t data[] = { 16, 2, 8, 1 };
+  const size_t  size   = 4;
+  const uint8_t check[] = { 8, 3, 16, 2 };
 
   /* Create journal and message */
   pb_journal_t journal = pb_journal_create(data, size);
   pb_message_t message = pb_message_create(&descriptor, &journal);
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_index(&message));
 
-  /* Clear field from message */
-  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_erase(&message, 14));
-  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_erase(&message, 14));
-
-  /* Assert message validity and error */
-  fail_unless(pb_message_valid(&message));
-  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_error(&message));
+  /* Build index and move fields without changing the size */
+  uint32_t value = 3;
+  fail_unless(pb_message_has(&message, 1));
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_message_put_many(&message, (const pb_tag_t []){ 1 },
+      (const void *[]){ &value }, 1));
+  fail_if(memcmp(check, pb_journal_data(&journal), 4));
 
-  /* Assert journal size */
-  fail_unless(pb_journal_empty(&journal));
-  ck_assert_uint_eq(0, pb_journal_size(&journal));
+  /* Assert rebuilt index */
+  value = 0;
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_get(&message, 1, &value));
+  ck_assert_uint_eq(3, value);
 
   /* Free all allocated memory */
   pb_message_destroy(&message);
@@ -2776,340 +3112,1811 @@ START_TEST(test_erase_oneof_merged) {
 } END_TEST
 
 /*
- * Erase a field for a given tag from an unaligned message.
+ * Write the values for a set of tags to an invalid message at once.
  */
-START_TEST(test_erase_unaligned) {
-  pb_journal_t  journal   = pb_journal_create_empty();
-  pb_message_t message1 = pb_message_create(&descriptor, &journal);
-  pb_message_t message2 = pb_message_create(&descriptor, &journal);
+START_TEST(test_put_many_invalid) {
+  pb_message_t message = pb_message_create_invalid();
 
-  /* Clear field from both messages */
-  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_erase(&message1, 1));
-  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_erase(&message1, 1));
-  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_erase(&message2, 1));
+  /* Write values to message */
+  uint32_t value = 1;
+  ck_assert_uint_eq(PB_ERROR_INVALID,
+    pb_message_put_many(&message, (const pb_tag_t []){ 1 },
+      (const void *[]){ &value }, 1));
 
-  /* Assert message validity and error */
-  fail_unless(pb_message_valid(&message1));
-  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_error(&message1));
+  /* Free all allocated memory */
+  pb_message_destroy(&message);
+} END_TEST
 
-  /* Assert journal size */
-  fail_unless(pb_journal_empty(&journal));
-  ck_assert_uint_eq(0, pb_journal_size(&journal));
+/*
+ * Merge an encoded message into a message.
+ */
+START_TEST(test_merge) {
+  const uint8_t data[] = { 8, 1, 16, 2 };
+  const size_t  size   = 4;
+  const uint8_t merge[] = { 8, 3, 80, 4 };
+  const uint8_t check[] = { 8, 1, 16, 2, 8, 3, 80, 4 };
+
+  /* Create journal, message and buffer */
+  pb_journal_t journal = pb_journal_create(data, size);
+  pb_message_t message = pb_message_create(&descriptor, &journal);
+  pb_buffer_t  buffer  = pb_buffer_create(merge, 4);
+
+  /* Merge buffer into message */
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_merge(&message, &buffer));
+  ck_assert_uint_eq(8, pb_journal_size(&journal));
+  fail_if(memcmp(check, pb_journal_data(&journal), 8));
+
+  /* Assert merged values */
+  uint32_t value1 = 0, value10 = 0; uint64_t value2 = 0;
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_get(&message, 1, &value1));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_get(&message, 2, &value2));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_get(&message, 10, &value10));
+  ck_assert_uint_eq(3, value1);
+  ck_assert_uint_eq(2, value2);
+  ck_assert_uint_eq(4, value10);
+
+  /* Assert message size */
+  ck_assert_uint_eq(8, pb_message_size(&message));
 
   /* Free all allocated memory */
-  pb_message_destroy(&message2);
-  pb_message_destroy(&message1);
+  pb_buffer_destroy(&buffer);
+  pb_message_destroy(&message);
   pb_journal_destroy(&journal);
 } END_TEST
 
 /*
- * Erase a field for a given tag from an invalid message.
+ * Merge an encoded message into a nested message.
  */
-START_TEST(test_erase_invalid) {
-  pb_message_t message = pb_message_create_invalid();
+START_TEST(test_merge_nested) {
+  const uint8_t data[] = { 90, 6, 90, 2, 8, 1, 104, 7 };
+  const size_t  size   = 8;
+  const uint8_t merge[] = { 8, 2, 16, 3 };
+  const uint8_t check[] = { 90, 10, 90, 6, 8, 1, 8, 2, 16, 3, 104, 7 };
 
-  /* Assert message validity and error */
-  fail_if(pb_message_valid(&message));
-  ck_assert_uint_eq(PB_ERROR_INVALID, pb_message_error(&message));
+  /* Create journal, messages and buffer */
+  pb_journal_t journal = pb_journal_create(data, size);
+  pb_message_t message = pb_message_create(&descriptor, &journal);
+  pb_message_t submessage1 = pb_message_create_within(&message, 11);
+  pb_message_t submessage2 = pb_message_create_within(&submessage1, 11);
+  pb_field_t   field       = pb_field_create(&submessage1, 13);
+  pb_buffer_t  buffer      = pb_buffer_create(merge, 4);
 
-  /* Clear field from message */
-  ck_assert_uint_eq(PB_ERROR_INVALID, pb_message_erase(&message, 1));
+  /* Merge buffer into innermost message */
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_merge(&submessage2, &buffer));
+  ck_assert_uint_eq(12, pb_journal_size(&journal));
+  fail_if(memcmp(check, pb_journal_data(&journal), 12));
+
+  /* Assert merged values */
+  uint32_t value = 0;
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_get(&submessage2, 1, &value));
+  ck_assert_uint_eq(2, value);
+
+  /* Assert aligned parent message and subsequent field */
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_align(&submessage1));
+  ck_assert_uint_eq(10, pb_message_size(&submessage1));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_field_get(&field, &value));
+  ck_assert_uint_eq(7, value);
 
   /* Free all allocated memory */
+  pb_buffer_destroy(&buffer);
+  pb_field_destroy(&field);
+  pb_message_destroy(&submessage2);
+  pb_message_destroy(&submessage1);
   pb_message_destroy(&message);
+  pb_journal_destroy(&journal);
 } END_TEST
 
 /*
- * Clear a message entirely.
+ * Merge an empty buffer into a message.
  */
-START_TEST(test_clear) {
-  const uint8_t data[] = { 8, 127 };
+START_TEST(test_merge_empty) {
+  const uint8_t data[] = { 8, 1 };
   const size_t  size   = 2;
 
-  /* Create journal and message */
+  /* Create journal, message and buffer */
   pb_journal_t journal = pb_journal_create(data, size);
   pb_message_t message = pb_message_create(&descriptor, &journal);
+  pb_buffer_t  buffer  = pb_buffer_create_empty();
 
-  /* Assert message validity and error */
-  fail_unless(pb_message_valid(&message));
-  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_error(&message));
+  /* Merge buffer into message */
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_merge(&message, &buffer));
+  ck_assert_uint_eq(0, pb_journal_version(&journal));
+  ck_assert_uint_eq(2, pb_journal_size(&journal));
 
-  /* Clear message entirely */
-  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_clear(&message));
-  ck_assert_uint_eq(PB_ERROR_INVALID, pb_message_clear(&message));
+  /* Free all allocated memory */
+  pb_buffer_destroy(&buffer);
+  pb_message_destroy(&message);
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Merge an encoded message into an invalid message.
+ */
+START_TEST(test_merge_invalid) {
+  const uint8_t merge[] = { 8, 1 };
+  pb_message_t message = pb_message_create_invalid();
+  pb_buffer_t  buffer  = pb_buffer_create(merge, 2);
 
   /* Assert message validity and error */
   fail_if(pb_message_valid(&message));
   ck_assert_uint_eq(PB_ERROR_INVALID, pb_message_error(&message));
 
-  /* Assert journal size */
-  fail_unless(pb_journal_empty(&journal));
-  ck_assert_uint_eq(0, pb_journal_size(&journal));
+  /* Merge buffer into message */
+  ck_assert_uint_eq(PB_ERROR_INVALID, pb_message_merge(&message, &buffer));
 
   /* Free all allocated memory */
+  pb_buffer_destroy(&buffer);
   pb_message_destroy(&message);
-  pb_journal_destroy(&journal);
 } END_TEST
 
 /*
- * Clear a message with a submessage entirely.
+ * Merge an encoded message into a message on a frozen journal.
  */
-START_TEST(test_clear_message) {
-  const uint8_t data[] = { 82, 0 };
+START_TEST(test_merge_frozen) {
+  const uint8_t data[] = { 8, 1 };
   const size_t  size   = 2;
 
-  /* Create journal, message and submessage */
+  /* Create journal, message and buffer */
   pb_journal_t journal = pb_journal_create(data, size);
   pb_message_t message = pb_message_create(&descriptor, &journal);
-  pb_message_t submessage = pb_message_create_within(&message, 11);
+  pb_buffer_t  buffer  = pb_buffer_create(data, size);
+  fail_if(pb_journal_freeze(&journal));
 
-  /* Assert message validity and error */
-  fail_unless(pb_message_valid(&message));
-  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_error(&message));
+  /* Merge buffer into message */
+  ck_assert_uint_eq(PB_ERROR_INVALID, pb_message_merge(&message, &buffer));
+  ck_assert_uint_eq(2, pb_journal_size(&journal));
 
-  /* Clear message entirely */
-  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_clear(&message));
-  ck_assert_uint_eq(PB_ERROR_INVALID, pb_message_clear(&message));
+  /* Free all allocated memory */
+  pb_buffer_destroy(&buffer);
+  pb_message_destroy(&message);
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Erase a field for a given tag from a message.
+ */
+START_TEST(test_erase) {
+  const uint8_t data[] = { 8, 127 };
+  const size_t  size   = 2;
+
+  /* Create journal and message */
+  pb_journal_t journal = pb_journal_create(data, size);
+  pb_message_t message = pb_message_create(&descriptor, &journal);
+
+  /* Clear field from message */
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_erase(&message, 1));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_erase(&message, 1));
 
   /* Assert message validity and error */
-  fail_if(pb_message_valid(&message));
-  ck_assert_uint_eq(PB_ERROR_INVALID, pb_message_error(&message));
+  fail_unless(pb_message_valid(&message));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_error(&message));
+
+  /* Assert journal size */
+  fail_unless(pb_journal_empty(&journal));
+  ck_assert_uint_eq(0, pb_journal_size(&journal));
+
+  /* Free all allocated memory */
+  pb_message_destroy(&message);
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Erase a field for a given tag from an empty message.
+ */
+START_TEST(test_erase_empty) {
+  pb_journal_t journal = pb_journal_create_empty();
+  pb_message_t message = pb_message_create(&descriptor, &journal);
+
+  /* Clear field from message */
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_erase(&message, 1));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_erase(&message, 1));
+
+  /* Assert message validity and error */
+  fail_unless(pb_message_valid(&message));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_error(&message));
+
+  /* Assert journal size */
+  fail_unless(pb_journal_empty(&journal));
+  ck_assert_uint_eq(0, pb_journal_size(&journal));
+
+  /* Free all allocated memory */
+  pb_message_destroy(&message);
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Erase a field for a given tag from a merged message.
+ */
+START_TEST(test_erase_merged) {
+  const uint8_t data[] = { 8, 1, 8, 2, 8, 3, 8, 4 };
+  const size_t  size   = 8;
+
+  /* Create journal and message */
+  pb_journal_t journal = pb_journal_create(data, size);
+  pb_message_t message = pb_message_create(&descriptor, &journal);
+
+  /* Clear field from message */
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_erase(&message, 1));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_erase(&message, 1));
+
+  /* Assert message validity and error */
+  fail_unless(pb_message_valid(&message));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_error(&message));
+
+  /* Assert journal size */
+  fail_unless(pb_journal_empty(&journal));
+  ck_assert_uint_eq(0, pb_journal_size(&journal));
+
+  /* Free all allocated memory */
+  pb_message_destroy(&message);
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Clear a submessage for a given tag from a message.
+ */
+START_TEST(test_erase_message) {
+  pb_journal_t journal = pb_journal_create_empty();
+  pb_message_t message = pb_message_create(&descriptor, &journal);
+  pb_message_t submessage = pb_message_create_within(&message, 11);
+
+  /* Align messages to perform checks */
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_align(&message));
+
+  /* Assert message size and version */
+  fail_if(pb_message_empty(&message));
+  ck_assert_uint_eq(2, pb_message_size(&message));
+  ck_assert_uint_eq(1, pb_message_version(&message));
+
+  /* Clear submessage and align message to perform checks */
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_erase(&message, 11));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_erase(&message, 11));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_align(&message));
+
+  /* Assert message validity and error */
+  fail_unless(pb_message_valid(&message));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_error(&message));
+
+  /* Assert message size and version */
+  fail_unless(pb_message_empty(&message));
+  ck_assert_uint_eq(0, pb_message_size(&message));
+  ck_assert_uint_eq(2, pb_message_version(&message));
+
+  /* Assert message offsets */
+  ck_assert_uint_eq(0, pb_message_start(&message));
+  ck_assert_uint_eq(0, pb_message_end(&message));
+
+  /* Align submessage to perform checks */
+  ck_assert_uint_eq(PB_ERROR_INVALID, pb_message_align(&submessage));
+
+  /* Assert submessage validity and error */
+  fail_if(pb_message_valid(&submessage));
+  ck_assert_uint_eq(PB_ERROR_INVALID, pb_message_error(&submessage));
 
   /* Assert journal size */
   fail_unless(pb_journal_empty(&journal));
   ck_assert_uint_eq(0, pb_journal_size(&journal));
 
   /* Free all allocated memory */
-  pb_message_destroy(&submessage);
+  pb_message_destroy(&submessage);
+  pb_message_destroy(&message);
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Clear an existing submessage for a given tag from a message.
+ */
+START_TEST(test_erase_message_existing) {
+  const uint8_t data[] = { 90, 0 };
+  const size_t  size   = 2;
+
+  /* Create journal, message and submessage */
+  pb_journal_t journal = pb_journal_create(data, size);
+  pb_message_t message = pb_message_create(&descriptor, &journal);
+  pb_message_t submessage = pb_message_create_within(&message, 11);
+
+  /* Clear submessage and align message to perform checks */
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_erase(&message, 11));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_align(&message));
+
+  /* Assert message validity and error */
+  fail_unless(pb_message_valid(&message));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_error(&message));
+
+  /* Assert message size and version */
+  fail_unless(pb_message_empty(&message));
+  ck_assert_uint_eq(0, pb_message_size(&message));
+  ck_assert_uint_eq(1, pb_message_version(&message));
+
+  /* Assert message offsets */
+  ck_assert_uint_eq(0, pb_message_start(&message));
+  ck_assert_uint_eq(0, pb_message_end(&message));
+
+  /* Align submessage */
+  ck_assert_uint_eq(PB_ERROR_INVALID, pb_message_align(&submessage));
+
+  /* Assert submessage validity and error */
+  fail_if(pb_message_valid(&submessage));
+  ck_assert_uint_eq(PB_ERROR_INVALID, pb_message_error(&submessage));
+
+  /* Assert journal size */
+  fail_unless(pb_journal_empty(&journal));
+  ck_assert_uint_eq(0, pb_journal_size(&journal));
+
+  /* Free all allocated memory */
+  pb_message_destroy(&submessage);
+  pb_message_destroy(&message);
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Clear a repeated submessage for a given tag from a message.
+ */
+START_TEST(test_erase_message_repeated) {
+  pb_journal_t journal = pb_journal_create_empty();
+  pb_message_t message = pb_message_create(&descriptor, &journal);
+
+  /* Create a hundred submessage siblings and write values to them */
+  for (size_t m = 1; m < 101; m++) {
+    uint64_t value = m;
+
+    /* Create submessage and write value */
+    pb_message_t submessage = pb_message_create_within(&message, 12);
+    ck_assert_uint_eq(PB_ERROR_NONE, pb_message_put(&submessage, 2, &value));
+
+    /* Free all allocated memory */
+    pb_message_destroy(&submessage);
+  }
+
+  /* Align message to perform checks */
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_align(&message));
+
+  /* Assert message validity and error */
+  fail_unless(pb_message_valid(&message));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_error(&message));
+
+  /* Assert message size and version */
+  fail_if(pb_message_empty(&message));
+  ck_assert_uint_eq(400, pb_message_size(&message));
+  ck_assert_uint_eq(300, pb_message_version(&message));
+
+  /* Assert message offsets */
+  ck_assert_uint_eq(0, pb_message_start(&message));
+  ck_assert_uint_eq(400, pb_message_end(&message));
+
+  /* Clear submessage and align message to perform checks */
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_erase(&message, 12));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_align(&message));
+
+  /* Assert message validity and error */
+  fail_unless(pb_message_valid(&message));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_error(&message));
+
+  /* Assert message size and version again */
+  fail_unless(pb_message_empty(&message));
+  ck_assert_uint_eq(0, pb_message_size(&message));
+  ck_assert_uint_eq(301, pb_message_version(&message));
+
+  /* Assert message offsets again */
+  ck_assert_uint_eq(0, pb_message_start(&message));
+  ck_assert_uint_eq(0, pb_message_end(&message));
+
+  /* Assert journal size */
+  fail_unless(pb_journal_empty(&journal));
+  ck_assert_uint_eq(0, pb_journal_size(&journal));
+
+  /* Free all allocated memory */
+  pb_message_destroy(&message);
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Erase a field for a given tag from a submessage.
+ */
+START_TEST(test_erase_message_nested) {
+  pb_journal_t journal = pb_journal_create_empty();
+  pb_message_t message = pb_message_create(&descriptor, &journal);
+  pb_message_t submessage = pb_message_create_within(&message, 11);
+
+  /* Write value to submessage */
+  uint32_t value = 127;
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_put(&submessage, 1, &value));
+
+  /* Clear field from submessage */
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_erase(&submessage, 1));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_erase(&submessage, 1));
+
+  /* Assert submessage validity and error */
+  fail_unless(pb_message_valid(&submessage));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_error(&submessage));
+
+  /* Assert submessage size and version */
+  fail_unless(pb_message_empty(&submessage));
+  ck_assert_uint_eq(0, pb_message_size(&submessage));
+  ck_assert_uint_eq(4, pb_message_version(&submessage));
+
+  /* Assert submessage offsets */
+  ck_assert_uint_eq(2, pb_message_start(&submessage));
+  ck_assert_uint_eq(2, pb_message_end(&submessage));
+
+  /* Assert message validity and error */
+  fail_unless(pb_message_valid(&message));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_error(&message));
+
+  /* Assert journal size */
+  fail_if(pb_journal_empty(&journal));
+  ck_assert_uint_eq(2, pb_journal_size(&journal));
+
+  /* Free all allocated memory */
+  pb_message_destroy(&submessage);
+  pb_message_destroy(&message);
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Erase a field for a given tag that is part of a oneof from a message.
+ */
+START_TEST(test_erase_oneof) {
+  const uint8_t data[] = { 112, 127 };
+  const size_t  size   = 2;
+
+  /* Create journal and message */
+  pb_journal_t journal = pb_journal_create(data, size);
+  pb_message_t message = pb_message_create(&descriptor, &journal);
+
+  /* Clear field from message */
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_erase(&message, 14));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_erase(&message, 14));
+
+  /* Assert message validity and error */
+  fail_unless(pb_message_valid(&message));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_error(&message));
+
+  /* Assert journal size */
+  fail_unless(pb_journal_empty(&journal));
+  ck_assert_uint_eq(0, pb_journal_size(&journal));
+
+  /* Free all allocated memory */
+  pb_message_destroy(&message);
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Erase a field for a given tag that is part of a oneof from a merged message.
+ */
+START_TEST(test_erase_oneof_merged) {
+  const uint8_t data[] = { 104, 1, 122, 0, 112, 3 };
+  const size_t  size   = 6;
+
+  /* Create journal and message */
+  pb_journal_t journal = pb_journal_create(data, size);
+  pb_message_t message = pb_message_create(&descriptor, &journal);
+
+  /* Clear field from message */
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_erase(&message, 14));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_erase(&message, 14));
+
+  /* Assert message validity and error */
+  fail_unless(pb_message_valid(&message));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_error(&message));
+
+  /* Assert journal size */
+  fail_unless(pb_journal_empty(&journal));
+  ck_assert_uint_eq(0, pb_journal_size(&journal));
+
+  /* Free all allocated memory */
+  pb_message_destroy(&message);
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Erase a field for a given tag from an unaligned message.
+ */
+START_TEST(test_erase_unaligned) {
+  pb_journal_t  journal   = pb_journal_create_empty();
+  pb_message_t message1 = pb_message_create(&descriptor, &journal);
+  pb_message_t message2 = pb_message_create(&descriptor, &journal);
+
+  /* Clear field from both messages */
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_erase(&message1, 1));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_erase(&message1, 1));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_erase(&message2, 1));
+
+  /* Assert message validity and error */
+  fail_unless(pb_message_valid(&message1));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_error(&message1));
+
+  /* Assert journal size */
+  fail_unless(pb_journal_empty(&journal));
+  ck_assert_uint_eq(0, pb_journal_size(&journal));
+
+  /* Free all allocated memory */
+  pb_message_destroy(&message2);
+  pb_message_destroy(&message1);
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Erase a field for a given tag from an invalid message.
+ */
+START_TEST(test_erase_invalid) {
+  pb_message_t message = pb_message_create_invalid();
+
+  /* Assert message validity and error */
+  fail_if(pb_message_valid(&message));
+  ck_assert_uint_eq(PB_ERROR_INVALID, pb_message_error(&message));
+
+  /* Clear field from message */
+  ck_assert_uint_eq(PB_ERROR_INVALID, pb_message_erase(&message, 1));
+
+  /* Free all allocated memory */
+  pb_message_destroy(&message);
+} END_TEST
+
+/*
+ * Erase the fields for a set of tags from a message at once.
+ */
+START_TEST(test_erase_many) {
+  const uint8_t data[] = { 8, 1, 8, 2, 18, 1, 3, 26, 1, 97, 8, 4, 34, 0 };
+  const size_t  size   = 14;
+  const uint8_t check[] = { 18, 1, 3, 34, 0 };
+
+  /* Create journal and message */
+  pb_journal_t journal = pb_journal_create(data, size);
+  pb_message_t message = pb_message_create(&repeated_descriptor, &journal);
+
+  /* Erase repeated fields from message */
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_message_erase_many(&message, (const pb_tag_t []){ 3, 1 }, 2));
+  fail_if(memcmp(check, pb_journal_data(&journal), 5));
+
+  /* Assert message size and version */
+  ck_assert_uint_eq(5, pb_message_size(&message));
+  ck_assert_uint_eq(1, pb_message_version(&message));
+
+  /* Erase absent field from message */
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_message_erase_many(&message, (const pb_tag_t []){ 1 }, 1));
+  ck_assert_uint_eq(1, pb_message_version(&message));
+
+  /* Free all allocated memory */
+  pb_message_destroy(&message);
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Erase the fields for a set of tags including a oneof from a message.
+ */
+START_TEST(test_erase_many_oneof) {
+  const uint8_t data[] = { 8, 1, 16, 2, 104, 1, 112, 2 };
+  const size_t  size   = 8;
+  const uint8_t check[] = { 8, 1 };
+
+  /* Create journal and message */
+  pb_journal_t journal = pb_journal_create(data, size);
+  pb_message_t message = pb_message_create(&descriptor, &journal);
+
+  /* Erase field and oneof from message */
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_message_erase_many(&message, (const pb_tag_t []){ 2, 13 }, 2));
+  fail_if(memcmp(check, pb_journal_data(&journal), 2));
+
+  /* Assert message size */
+  ck_assert_uint_eq(2, pb_message_size(&message));
+
+  /* Free all allocated memory */
+  pb_message_destroy(&message);
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Erase all fields of a submessage at once.
+ */
+START_TEST(test_erase_many_nested) {
+  const uint8_t data[] = { 34, 6, 8, 1, 8, 2, 8, 3 };
+  const size_t  size   = 8;
+  const uint8_t check[] = { 34, 0 };
+
+  /* Create journal, message and submessage */
+  pb_journal_t journal = pb_journal_create(data, size);
+  pb_message_t message = pb_message_create(&repeated_descriptor, &journal);
+  pb_message_t submessage = pb_message_create_within(&message, 4);
+
+  /* Erase repeated field from submessage */
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_message_erase_many(&submessage, (const pb_tag_t []){ 1 }, 1));
+  fail_if(memcmp(check, pb_journal_data(&journal), 2));
+
+  /* Align messages to perform checks */
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_align(&message));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_align(&submessage));
+
+  /* Assert submessage validity and error */
+  fail_unless(pb_message_valid(&submessage));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_error(&submessage));
+
+  /* Assert message and submessage size */
+  ck_assert_uint_eq(2, pb_message_size(&message));
+  fail_unless(pb_message_empty(&submessage));
+
+  /* Free all allocated memory */
+  pb_message_destroy(&submessage);
+  pb_message_destroy(&message);
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Erase the fields for a set of tags from an invalid message at once.
+ */
+START_TEST(test_erase_many_invalid) {
+  pb_message_t message = pb_message_create_invalid();
+
+  /* Erase fields from message */
+  ck_assert_uint_eq(PB_ERROR_INVALID,
+    pb_message_erase_many(&message, (const pb_tag_t []){ 1 }, 1));
+
+  /* Free all allocated memory */
+  pb_message_destroy(&message);
+} END_TEST
+
+/*
+ * Bring the fields of a message into tag order.
+ */
+START_TEST(test_canonicalize) {
+  const uint8_t data[] = { 26, 1, 97, 8, 2, 18, 1, 3, 8, 1, 26, 1, 98 };
+  const size_t  size   = 13;
+  const uint8_t check[] = { 8, 2, 8, 1, 18, 1, 3, 26, 1, 97, 26, 1, 98 };
+
+  /* Create journal and message */
+  pb_journal_t journal = pb_journal_create(data, size);
+  pb_message_t message = pb_message_create(&repeated_descriptor, &journal);
+
+  /* Bring fields into tag order */
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_canonicalize(&message));
+  fail_if(memcmp(check, pb_journal_data(&journal), 13));
+
+  /* Assert message size and version */
+  ck_assert_uint_eq(13, pb_message_size(&message));
+  ck_assert_uint_eq(0, pb_message_version(&message));
+
+  /* Free all allocated memory */
+  pb_message_destroy(&message);
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Bring the fields of a message and its submessages into tag order.
+ */
+START_TEST(test_canonicalize_nested) {
+  const uint8_t data[] = { 34, 4, 16, 1, 8, 2, 8, 3 };
+  const size_t  size   = 8;
+  const uint8_t check[] = { 8, 3, 34, 4, 8, 2, 16, 1 };
+
+  /* Create journal and message */
+  pb_journal_t journal = pb_journal_create(data, size);
+  pb_message_t message = pb_message_create(&repeated_descriptor, &journal);
+
+  /* Bring fields into tag order */
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_canonicalize(&message));
+  fail_if(memcmp(check, pb_journal_data(&journal), 8));
+
+  /* Free all allocated memory */
+  pb_message_destroy(&message);
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Bring the fields of a message with superseded oneof members into order.
+ */
+START_TEST(test_canonicalize_oneof) {
+  const uint8_t data[] = { 90, 4, 112, 1, 104, 2, 104, 3, 112, 4, 8, 1 };
+  const size_t  size   = 12;
+  const uint8_t check[] = { 8, 1, 90, 2, 104, 2, 112, 4 };
+
+  /* Create journal and message */
+  pb_journal_t journal = pb_journal_create(data, size);
+  pb_message_t message = pb_message_create(&descriptor, &journal);
+
+  /* Bring fields into tag order */
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_canonicalize(&message));
+  fail_if(memcmp(check, pb_journal_data(&journal), 8));
+
+  /* Assert message size and value of active member */
+  uint32_t value;
+  ck_assert_uint_eq(8, pb_message_size(&message));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_get(&message, 14, &value));
+  ck_assert_uint_eq(4, value);
+
+  /* Free all allocated memory */
+  pb_message_destroy(&message);
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Bring the fields of a message into tag order, which already are.
+ */
+START_TEST(test_canonicalize_sorted) {
+  const uint8_t data[] = { 8, 1, 34, 2, 8, 1 };
+  const size_t  size   = 6;
+
+  /* Create journal and message */
+  pb_journal_t journal = pb_journal_create(data, size);
+  pb_message_t message = pb_message_create(&repeated_descriptor, &journal);
+
+  /* Bring fields into tag order */
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_canonicalize(&message));
+  ck_assert_uint_eq(0, pb_journal_revision(&journal));
+
+  /* Free all allocated memory */
+  pb_message_destroy(&message);
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Bring the fields of an invalid message into tag order.
+ */
+START_TEST(test_canonicalize_invalid) {
+  pb_message_t message = pb_message_create_invalid();
+
+  /* Bring fields into tag order */
+  ck_assert_uint_eq(PB_ERROR_INVALID, pb_message_canonicalize(&message));
+
+  /* Free all allocated memory */
+  pb_message_destroy(&message);
+} END_TEST
+
+/*
+ * Clear a message entirely.
+ */
+START_TEST(test_clear) {
+  const uint8_t data[] = { 8, 127 };
+  const size_t  size   = 2;
+
+  /* Create journal and message */
+  pb_journal_t journal = pb_journal_create(data, size);
+  pb_message_t message = pb_message_create(&descriptor, &journal);
+
+  /* Assert message validity and error */
+  fail_unless(pb_message_valid(&message));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_error(&message));
+
+  /* Clear message entirely */
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_clear(&message));
+  ck_assert_uint_eq(PB_ERROR_INVALID, pb_message_clear(&message));
+
+  /* Assert message validity and error */
+  fail_if(pb_message_valid(&message));
+  ck_assert_uint_eq(PB_ERROR_INVALID, pb_message_error(&message));
+
+  /* Assert journal size */
+  fail_unless(pb_journal_empty(&journal));
+  ck_assert_uint_eq(0, pb_journal_size(&journal));
+
+  /* Free all allocated memory */
+  pb_message_destroy(&message);
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Clear a message with a submessage entirely.
+ */
+START_TEST(test_clear_message) {
+  const uint8_t data[] = { 82, 0 };
+  const size_t  size   = 2;
+
+  /* Create journal, message and submessage */
+  pb_journal_t journal = pb_journal_create(data, size);
+  pb_message_t message = pb_message_create(&descriptor, &journal);
+  pb_message_t submessage = pb_message_create_within(&message, 11);
+
+  /* Assert message validity and error */
+  fail_unless(pb_message_valid(&message));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_error(&message));
+
+  /* Clear message entirely */
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_clear(&message));
+  ck_assert_uint_eq(PB_ERROR_INVALID, pb_message_clear(&message));
+
+  /* Assert message validity and error */
+  fail_if(pb_message_valid(&message));
+  ck_assert_uint_eq(PB_ERROR_INVALID, pb_message_error(&message));
+
+  /* Assert journal size */
+  fail_unless(pb_journal_empty(&journal));
+  ck_assert_uint_eq(0, pb_journal_size(&journal));
+
+  /* Free all allocated memory */
+  pb_message_destroy(&submessage);
+  pb_message_destroy(&message);
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Clear a message with submessage siblings entirely.
+ */
+START_TEST(test_clear_message_siblings) {
+  pb_journal_t journal = pb_journal_create_empty();
+  pb_message_t messages[101] = { pb_message_create(&descriptor, &journal) };
+
+  /* Create a hundred submessage siblings */
+  for (size_t m = 1; m < 101; m++)
+    messages[m] = pb_message_create_within(&(messages[m - 1]), 12);
+
+  /* Assert message validity and error */
+  fail_unless(pb_message_valid(&(messages[0])));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_error(&(messages[0])));
+
+  /* Clear message entirely */
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_clear(&(messages[0])));
+  ck_assert_uint_eq(PB_ERROR_INVALID, pb_message_clear(&(messages[0])));
+
+  /* Align and destroy submessage siblings */
+  for (size_t m = 1; m < 101; m++) {
+    ck_assert_uint_eq(PB_ERROR_INVALID, pb_message_align(&(messages[m])));
+
+    /* Assert submessage validity and error */
+    fail_if(pb_message_valid(&(messages[m])));
+    ck_assert_uint_eq(PB_ERROR_INVALID, pb_message_error(&(messages[m])));
+
+    /* Free all allocated memory */
+    pb_message_destroy(&(messages[m]));
+  }
+
+  /* Assert message validity and error */
+  fail_if(pb_message_valid(&(messages[0])));
+  ck_assert_uint_eq(PB_ERROR_INVALID, pb_message_error(&(messages[0])));
+
+  /* Assert journal size */
+  fail_unless(pb_journal_empty(&journal));
+  ck_assert_uint_eq(0, pb_journal_size(&journal));
+
+  /* Free all allocated memory */
+  pb_message_destroy(&(messages[0]));
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Clear a message with nested submessages entirely.
+ */
+START_TEST(test_clear_message_nested) {
+  pb_journal_t journal = pb_journal_create_empty();
+  pb_message_t messages[101] = { pb_message_create(&descriptor, &journal) };
+
+  /* Create a hundred nested submessages and write values to them */
+  for (size_t m = 1; m < 101; m++)
+    messages[m] = pb_message_create_within(&(messages[m - 1]), 11);
+
+  /* Assert message validity and error */
+  fail_unless(pb_message_valid(&(messages[0])));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_error(&(messages[0])));
+
+  /* Clear message entirely */
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_clear(&(messages[0])));
+  ck_assert_uint_eq(PB_ERROR_INVALID, pb_message_clear(&(messages[0])));
+
+  /* Align and destroy nested submessages */
+  for (size_t m = 1; m < 101; m++) {
+    ck_assert_uint_eq(PB_ERROR_INVALID, pb_message_align(&(messages[m])));
+
+    /* Assert submessage validity and error */
+    fail_if(pb_message_valid(&(messages[m])));
+    ck_assert_uint_eq(PB_ERROR_INVALID, pb_message_error(&(messages[m])));
+
+    /* Free all allocated memory */
+    pb_message_destroy(&(messages[m]));
+  }
+
+  /* Assert message validity and error */
+  fail_if(pb_message_valid(&(messages[0])));
+  ck_assert_uint_eq(PB_ERROR_INVALID, pb_message_error(&(messages[0])));
+
+  /* Assert journal size */
+  fail_unless(pb_journal_empty(&journal));
+  ck_assert_uint_eq(0, pb_journal_size(&journal));
+
+  /* Free all allocated memory */
+  pb_message_destroy(&(messages[0]));
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Clear a message with nested submessages inside-out entirely.
+ */
+START_TEST(test_clear_message_nested_inside_out) {
+  pb_journal_t journal = pb_journal_create_empty();
+  pb_message_t messages[101] = { pb_message_create(&descriptor, &journal) };
+
+  /* Create a hundred nested submessages and write values to them */
+  for (size_t m = 1; m < 101; m++)
+    messages[m] = pb_message_create_within(&(messages[m - 1]), 11);
+
+  /* Assert message validity and error */
+  fail_unless(pb_message_valid(&(messages[0])));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_error(&(messages[0])));
+
+  /* Align and clear nested submessages */
+  for (size_t m = 100; m > 0; m--) {
+    ck_assert_uint_eq(PB_ERROR_NONE, pb_message_clear(&(messages[m])));
+    ck_assert_uint_eq(PB_ERROR_INVALID, pb_message_clear(&(messages[m])));
+
+    /* Assert submessage validity and error */
+    fail_if(pb_message_valid(&(messages[m])));
+    ck_assert_uint_eq(PB_ERROR_INVALID, pb_message_error(&(messages[m])));
+
+    /* Free all allocated memory */
+    pb_message_destroy(&(messages[m]));
+  }
+
+  /* Clear message entirely */
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_clear(&(messages[0])));
+  ck_assert_uint_eq(PB_ERROR_INVALID, pb_message_clear(&(messages[0])));
+
+  /* Assert message validity and error */
+  fail_if(pb_message_valid(&(messages[0])));
+  ck_assert_uint_eq(PB_ERROR_INVALID, pb_message_error(&(messages[0])));
+
+  /* Assert journal size */
+  fail_unless(pb_journal_empty(&journal));
+  ck_assert_uint_eq(0, pb_journal_size(&journal));
+
+  /* Free all allocated memory */
+  pb_message_destroy(&(messages[0]));
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Clear an unaligned message entirely.
+ */
+START_TEST(test_clear_unaligned) {
+  const uint8_t data[] = { 8, 127 };
+  const size_t  size   = 2;
+
+  /* Create journal and message */
+  pb_journal_t journal = pb_journal_create(data, size);
+  pb_message_t message = pb_message_create(&descriptor, &journal);
+
+  /* Write value to message */
+  uint32_t value = 127;
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_put(&message, 1, &value));
+
+  /* Assert message validity and error */
+  fail_unless(pb_message_valid(&message));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_error(&message));
+
+  /* Clear message entirely */
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_clear(&message));
+  ck_assert_uint_eq(PB_ERROR_INVALID, pb_message_clear(&message));
+
+  /* Assert message validity and error */
+  fail_if(pb_message_valid(&message));
+  ck_assert_uint_eq(PB_ERROR_INVALID, pb_message_error(&message));
+
+  /* Assert journal size */
+  fail_unless(pb_journal_empty(&journal));
+  ck_assert_uint_eq(0, pb_journal_size(&journal));
+
+  /* Free all allocated memory */
+  pb_message_destroy(&message);
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Clear an invalid message entirely.
+ */
+START_TEST(test_clear_invalid) {
+  pb_message_t message = pb_message_create_invalid();
+
+  /* Assert message validity and error */
+  fail_if(pb_message_valid(&message));
+  ck_assert_uint_eq(PB_ERROR_INVALID, pb_message_error(&message));
+
+  /* Clear message */
+  ck_assert_uint_eq(PB_ERROR_INVALID, pb_message_clear(&message));
+
+  /* Free all allocated memory */
+  pb_message_destroy(&message);
+} END_TEST
+
+/*
+ * Ensure that a message is properly aligned.
+ */
+START_TEST(test_align) {
+  pb_journal_t journal = pb_journal_create_empty();
+  pb_message_t message = pb_message_create(&descriptor, &journal);
+
+  /* Create submessages */
+  pb_message_t submessage1 = pb_message_create_within(&message, 11);
+  pb_message_t submessage2 = pb_message_create_within(&message, 11);
+
+  /* Write value to submessage */
+  pb_string_t value = pb_string_init_from_chars(
+    "Lorem ipsum dolor sit amet, consectetur adipiscing elit. Nam euismod "
+    "vehicula nibh, et egestas erat eleifend quis. Nam hendrerit egestas "
+    "quam nec egestas. Donec lacinia vestibulum erat, ac suscipit nisi "
+    "vehicula nec. Praesent ullamcorper vitae lorem vel euismod. Quisque "
+    "fringilla lobortis convallis. Aliquam accumsan lacus eu viverra dapibus. "
+    "Phasellus in adipiscing sem, in congue massa. Vestibulum ullamcorper "
+    "orci nec semper pretium.");
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_put(&submessage1, 8, &value));
+
+  /* Align submessage to perform checks */
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_align(&submessage1));
+
+  /* Assert submessage size and version */
+  fail_if(pb_message_empty(&submessage1));
+  ck_assert_uint_eq(440, pb_message_size(&submessage1));
+  ck_assert_uint_eq(5, pb_message_version(&submessage1));
+
+  /* Assert alignment */
+  ck_assert_uint_eq(1, pb_message_version(&submessage2));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_align(&submessage2));
+  fail_unless(pb_message_same(&submessage1, &submessage2));
+
+  /* Free all allocated memory */
+  pb_message_destroy(&submessage2);
+  pb_message_destroy(&submessage1);
+  pb_message_destroy(&message);
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Write values to nested messages within a batch.
+ */
+START_TEST(test_batch) {
+  pb_journal_t journal[2] = {
+    pb_journal_create_empty(),
+    pb_journal_create_empty()
+  };
+
+  /* Perform the same writes without and within a batch */
+  pb_string_t value = pb_string_init_from_chars(
+    "Lorem ipsum dolor sit amet, consectetur adipiscing elit. Nam euismod "
+    "vehicula nibh, et egestas erat eleifend quis. Nam hendrerit egestas "
+    "quam nec egestas. Donec lacinia vestibulum erat, ac suscipit nisi "
+    "vehicula nec. Praesent ullamcorper vitae lorem vel euismod. Quisque "
+    "fringilla lobortis convallis. Aliquam accumsan lacus eu viverra dapibus. "
+    "Phasellus in adipiscing sem, in congue massa. Vestibulum ullamcorper "
+    "orci nec semper pretium.");
+  for (size_t j = 0; j < 2; j++) {
+    if (j)
+      pb_journal_begin_batch(&(journal[j]));
+
+    /* Create message and submessages */
+    pb_message_t message    = pb_message_create(&descriptor, &(journal[j]));
+    pb_message_t submessage = pb_message_create_within(&message, 11);
+    pb_message_t subsubmessage = pb_message_create_within(&submessage, 11);
+
+    /* Write values to innermost submessage */
+    for (size_t f = 1; f <= 8; f++)
+      ck_assert_uint_eq(PB_ERROR_NONE, pb_message_put(&subsubmessage, f,
+        pb_field_descriptor_default(
+          pb_descriptor_field_by_tag(&descriptor, f))));
+    ck_assert_uint_eq(PB_ERROR_NONE,
+      pb_message_put(&subsubmessage, 9, &value));
+
+    /* Switch between messages */
+    uint32_t number = 127;
+    ck_assert_uint_eq(PB_ERROR_NONE,
+      pb_message_put(&submessage, 10, &number));
+    ck_assert_uint_eq(PB_ERROR_NONE,
+      pb_message_put(&subsubmessage, 10, &number));
+    ck_assert_uint_eq(PB_ERROR_NONE,
+      pb_message_put(&message, 10, &number));
+
+    /* Erase value from innermost submessage */
+    ck_assert_uint_eq(PB_ERROR_NONE, pb_message_erase(&subsubmessage, 2));
+    ck_assert_uint_eq(PB_ERROR_NONE,
+      pb_message_put(&subsubmessage, 9, &value));
+
+    /* Free all allocated memory */
+    pb_message_destroy(&subsubmessage);
+    pb_message_destroy(&submessage);
+    pb_message_destroy(&message);
+    ck_assert_uint_eq(PB_ERROR_NONE, pb_journal_commit(&(journal[j])));
+  }
+
+  /* Assert same raw data */
+  ck_assert_uint_eq(pb_journal_size(&(journal[0])),
+                    pb_journal_size(&(journal[1])));
+  fail_if(memcmp(pb_journal_data(&(journal[0])),
+    pb_journal_data(&(journal[1])), pb_journal_size(&(journal[0]))));
+
+  /* Assert readable values */
+  pb_message_t message    = pb_message_create(&descriptor, &(journal[1]));
+  pb_message_t submessage = pb_message_create_nested(&message,
+    (const pb_tag_t []){ 11, 11 }, 2);
+  uint32_t number = 0;
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_get(&submessage, 10, &number));
+  ck_assert_uint_eq(127, number);
+
+  /* Free all allocated memory */
+  pb_message_destroy(&submessage);
+  pb_message_destroy(&message);
+  pb_journal_destroy(&(journal[1]));
+  pb_journal_destroy(&(journal[0]));
+} END_TEST
+
+/*
+ * Write values to repeated submessages within a batch.
+ */
+START_TEST(test_batch_repeated) {
+  pb_journal_t journal[2] = {
+    pb_journal_create_empty(),
+    pb_journal_create_empty()
+  };
+
+  /* Perform the same writes without and within a batch */
+  for (size_t j = 0; j < 2; j++) {
+    if (j)
+      pb_journal_begin_batch(&(journal[j]));
+
+    /* Create message and write values to repeated submessages */
+    pb_message_t message = pb_message_create(&descriptor, &(journal[j]));
+    for (size_t m = 0; m < 16; m++) {
+      pb_message_t submessage = pb_message_create_within(&message, 12);
+      for (uint32_t f = 1; f <= 8; f++)
+        ck_assert_uint_eq(PB_ERROR_NONE, pb_message_put(&submessage, f,
+          pb_field_descriptor_default(
+            pb_descriptor_field_by_tag(&descriptor, f))));
+      pb_message_destroy(&submessage);
+    }
+
+    /* Free all allocated memory */
+    pb_message_destroy(&message);
+    ck_assert_uint_eq(PB_ERROR_NONE, pb_journal_commit(&(journal[j])));
+  }
+
+  /* Assert same raw data */
+  ck_assert_uint_eq(pb_journal_size(&(journal[0])),
+                    pb_journal_size(&(journal[1])));
+  fail_if(memcmp(pb_journal_data(&(journal[0])),
+    pb_journal_data(&(journal[1])), pb_journal_size(&(journal[0]))));
+
+  /* Free all allocated memory */
+  pb_journal_destroy(&(journal[1]));
+  pb_journal_destroy(&(journal[0]));
+} END_TEST
+
+/*
+ * Freeze a journal within a batch.
+ */
+START_TEST(test_batch_freeze) {
+  pb_journal_t journal = pb_journal_create_empty();
+  pb_journal_begin_batch(&journal);
+
+  /* Create message and write value to submessage */
+  pb_message_t message    = pb_message_create(&descriptor, &journal);
+  pb_message_t submessage = pb_message_create_within(&message, 11);
+  uint32_t number = 300;
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_put(&submessage, 1, &number));
+
+  /* Freeze journal and commit batch */
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_journal_freeze(&journal));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_journal_commit(&journal));
+
+  /* Assert resolved length prefix */
+  ck_assert_uint_eq(5, pb_journal_size(&journal));
+  fail_if(memcmp("\x5A\x03\x08\xAC\x02", pb_journal_data(&journal), 5));
+
+  /* Assert readable value */
+  number = 0;
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_get(&submessage, 1, &number));
+  ck_assert_uint_eq(300, number);
+
+  /* Free all allocated memory */
+  pb_message_destroy(&submessage);
+  pb_message_destroy(&message);
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Write values to nested messages with padded length prefixes.
+ */
+START_TEST(test_padded) {
+  pb_journal_t journal[2] = {
+    pb_journal_create_empty(),
+    pb_journal_create_padded()
+  };
+
+  /* Perform the same writes with minimal and padded length prefixes */
+  pb_string_t value = pb_string_init_from_chars(
+    "Lorem ipsum dolor sit amet, consectetur adipiscing elit. Nam euismod "
+    "vehicula nibh, et egestas erat eleifend quis. Nam hendrerit egestas "
+    "quam nec egestas. Donec lacinia vestibulum erat, ac suscipit nisi.");
+  for (size_t j = 0; j < 2; j++) {
+    pb_message_t message    = pb_message_create(&descriptor, &(journal[j]));
+    pb_message_t submessage = pb_message_create_within(&message, 11);
+    pb_message_t subsubmessage = pb_message_create_within(&submessage, 12);
+
+    /* Write values to submessages */
+    uint32_t number = 127;
+    ck_assert_uint_eq(PB_ERROR_NONE,
+      pb_message_put(&subsubmessage, 8, &value));
+    ck_assert_uint_eq(PB_ERROR_NONE,
+      pb_message_put(&subsubmessage, 10, &number));
+    ck_assert_uint_eq(PB_ERROR_NONE,
+      pb_message_put(&submessage, 10, &number));
+
+    /* Free all allocated memory */
+    pb_message_destroy(&subsubmessage);
+    pb_message_destroy(&submessage);
+    pb_message_destroy(&message);
+  }
+
+  /* Assert padded length prefixes */
+  ck_assert_uint_eq(pb_journal_size(&(journal[0])) + 3 * 3,
+                    pb_journal_size(&(journal[1])));
+
+  /* Assert readable values */
+  pb_message_t message    = pb_message_create(&descriptor, &(journal[1]));
+  pb_message_t submessage = pb_message_create_within(&message, 11);
+  uint32_t number = 0;
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_get(&submessage, 10, &number));
+  ck_assert_uint_eq(127, number);
+
+  /* Pack journal and assert invalidated message */
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_journal_pack(&(journal[1]), &descriptor));
+  ck_assert_uint_eq(PB_ERROR_INVALID, pb_message_align(&submessage));
+
+  /* Assert same raw data */
+  ck_assert_uint_eq(pb_journal_size(&(journal[0])),
+                    pb_journal_size(&(journal[1])));
+  fail_if(memcmp(pb_journal_data(&(journal[0])),
+    pb_journal_data(&(journal[1])), pb_journal_size(&(journal[0]))));
+
+  /* Free all allocated memory */
+  pb_message_destroy(&submessage);
+  pb_message_destroy(&message);
+  pb_journal_destroy(&(journal[1]));
+  pb_journal_destroy(&(journal[0]));
+} END_TEST
+
+/*
+ * Pack a journal holding invalid data.
+ */
+START_TEST(test_padded_pack_invalid) {
+  const uint8_t data[] = { 90, 10, 8 };
+  const size_t  size   = 3;
+
+  /* Create journal */
+  pb_journal_t journal = pb_journal_create(data, size);
+
+  /* Pack journal */
+  fail_if(pb_journal_pack(&journal, &descriptor) == PB_ERROR_NONE);
+  ck_assert_uint_eq(3, pb_journal_size(&journal));
+  fail_if(memcmp(data, pb_journal_data(&journal), size));
+
+  /* Free all allocated memory */
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Read values from a message using a field offset index.
+ */
+START_TEST(test_index) {
+  const uint8_t data[] = { 8, 1, 8, 2, 80, 127, 80, 126 };
+  const size_t  size   = 8;
+
+  /* Create journal and message */
+  pb_journal_t journal = pb_journal_create(data, size);
+  pb_message_t message = pb_message_create(&descriptor, &journal);
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_index(&message));
+
+  /* Assert last occurrences and fields */
+  uint32_t value = 0;
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_get(&message, 1, &value));
+  ck_assert_uint_eq(2, value);
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_get(&message, 10, &value));
+  ck_assert_uint_eq(126, value);
+  fail_unless(pb_message_has(&message, 1));
+  fail_unless(pb_message_has(&message, 10));
+  fail_if(pb_message_has(&message, 3));
+
+  /* Assert default value and absent field */
+  uint64_t number = 0;
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_get(&message, 2, &number));
+  ck_assert_uint_eq(default_uint64, number);
+  ck_assert_uint_eq(PB_ERROR_ABSENT, pb_message_get(&message, 9, &value));
+
+  /* Alter message and assert rebuilt index */
+  value = 1000;
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_put(&message, 1, &value));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_put(&message, 3, &value));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_erase(&message, 10));
+  fail_unless(pb_message_has(&message, 3));
+  fail_if(pb_message_has(&message, 10));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_get(&message, 1, &value));
+  ck_assert_uint_eq(1000, value);
+
+  /* Assert copy without index */
+  pb_message_t copy = pb_message_copy(&message);
+  ck_assert_ptr_eq(NULL, copy.index);
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_get(&copy, 1, &value));
+  ck_assert_uint_eq(1000, value);
+
+  /* Free all allocated memory */
+  pb_message_destroy(&copy);
+  pb_message_destroy(&message);
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Read values from a submessage using a field offset index.
+ */
+START_TEST(test_index_nested) {
+  pb_journal_t journal = pb_journal_create_empty();
+  pb_message_t message = pb_message_create(&descriptor, &journal);
+  pb_message_t submessage = pb_message_create_within(&message, 11);
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_index(&submessage));
+
+  /* Write values to message and submessage */
+  uint32_t value = 127;
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_put(&submessage, 10, &value));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_put(&message, 1, &value));
+
+  /* Assert values from submessage */
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_get(&submessage, 10, &value));
+  ck_assert_uint_eq(127, value);
+  fail_if(pb_message_has(&submessage, 1));
+
+  /* Free all allocated memory */
+  pb_message_destroy(&submessage);
+  pb_message_destroy(&message);
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Read and write oneof members using a field offset index.
+ */
+START_TEST(test_index_oneof) {
+  const uint8_t data[] = { 104, 1, 112, 2, 104, 3 };
+  const size_t  size   = 6;
+
+  /* Create journal and message */
+  pb_journal_t journal = pb_journal_create(data, size);
+  pb_message_t message = pb_message_create(&descriptor, &journal);
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_index(&message));
+
+  /* Assert active and inactive member */
+  uint32_t value = 0;
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_get(&message, 13, &value));
+  ck_assert_uint_eq(3, value);
+  ck_assert_uint_eq(PB_ERROR_ABSENT, pb_message_get(&message, 14, &value));
+  fail_unless(pb_message_has(&message, 13));
+  fail_if(pb_message_has(&message, 14));
+
+  /* Activate other member and assert rebuilt index */
+  value = 5;
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_put(&message, 14, &value));
+  ck_assert_uint_eq(PB_ERROR_ABSENT, pb_message_get(&message, 13, &value));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_get(&message, 14, &value));
+  ck_assert_uint_eq(5, value);
+
+  /* Overwrite active member in place */
+  size_t version = pb_journal_version(&journal);
+  value = 6;
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_put(&message, 14, &value));
+  ck_assert_uint_eq(version, pb_journal_version(&journal));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_get(&message, 14, &value));
+  ck_assert_uint_eq(6, value);
+
+  /* Free all allocated memory */
+  pb_message_destroy(&message);
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Attach a field offset index to an invalid message.
+ */
+START_TEST(test_index_invalid) {
+  pb_message_t message = pb_message_create_invalid();
+
+  /* Assert message validity and error */
+  fail_if(pb_message_valid(&message));
+  ck_assert_uint_eq(PB_ERROR_INVALID, pb_message_index(&message));
+
+  /* Free all allocated memory */
+  pb_message_destroy(&message);
+} END_TEST
+
+/*
+ * Create a zero-copy buffer over the raw data of a submessage.
+ */
+START_TEST(test_view) {
+  const uint8_t data[] = { 8, 1, 80, 4, 90, 4, 8, 2, 16, 3 };
+  const size_t  size   = 10;
+
+  /* Create journal, message and submessage */
+  pb_journal_t journal    = pb_journal_create(data, size);
+  pb_message_t message    = pb_message_create(&descriptor, &journal);
+  pb_message_t submessage = pb_message_create_within(&message, 11);
+
+  /* Create view */
+  pb_buffer_t buffer = pb_message_view(&submessage);
+  fail_unless(pb_buffer_valid(&buffer));
+  ck_assert_uint_eq(4, pb_buffer_size(&buffer));
+  ck_assert_ptr_eq(pb_journal_data(&journal) + 6, pb_buffer_data(&buffer));
+  fail_if(memcmp(&(data[6]), pb_buffer_data(&buffer), 4));
+
+  /* Free all allocated memory */
+  pb_buffer_destroy(&buffer);
+  pb_message_destroy(&submessage);
+  pb_message_destroy(&message);
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Create a zero-copy buffer over the raw data of an empty submessage.
+ */
+START_TEST(test_view_empty) {
+  const uint8_t data[] = { 90, 0 };
+  const size_t  size   = 2;
+
+  /* Create journal, message and submessage */
+  pb_journal_t journal    = pb_journal_create(data, size);
+  pb_message_t message    = pb_message_create(&descriptor, &journal);
+  pb_message_t submessage = pb_message_create_within(&message, 11);
+
+  /* Create view */
+  pb_buffer_t buffer = pb_message_view(&submessage);
+  fail_unless(pb_buffer_valid(&buffer));
+  fail_unless(pb_buffer_empty(&buffer));
+
+  /* Free all allocated memory */
+  pb_buffer_destroy(&buffer);
+  pb_message_destroy(&submessage);
+  pb_message_destroy(&message);
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Create a zero-copy buffer over the raw data of an invalid message.
+ */
+START_TEST(test_view_invalid) {
+  pb_message_t message = pb_message_create_invalid();
+
+  /* Create view */
+  pb_buffer_t buffer = pb_message_view(&message);
+  fail_if(pb_buffer_valid(&buffer));
+
+  /* Free all allocated memory */
+  pb_buffer_destroy(&buffer);
   pb_message_destroy(&message);
-  pb_journal_destroy(&journal);
 } END_TEST
 
 /*
- * Clear a message with submessage siblings entirely.
+ * Detach a copy of a submessage into a new journal.
  */
-START_TEST(test_clear_message_siblings) {
-  pb_journal_t journal = pb_journal_create_empty();
-  pb_message_t messages[101] = { pb_message_create(&descriptor, &journal) };
-
-  /* Create a hundred submessage siblings */
-  for (size_t m = 1; m < 101; m++)
-    messages[m] = pb_message_create_within(&(messages[m - 1]), 12);
-
-  /* Assert message validity and error */
-  fail_unless(pb_message_valid(&(messages[0])));
-  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_error(&(messages[0])));
-
-  /* Clear message entirely */
-  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_clear(&(messages[0])));
-  ck_assert_uint_eq(PB_ERROR_INVALID, pb_message_clear(&(messages[0])));
-
-  /* Align and destroy submessage siblings */
-  for (size_t m = 1; m < 101; m++) {
-    ck_assert_uint_eq(PB_ERROR_INVALID, pb_message_align(&(messages[m])));
+START_TEST(test_detach) {
+  const uint8_t data[] = { 8, 1, 80, 4, 90, 4, 8, 2, 16, 3 };
+  const size_t  size   = 10;
 
-    /* Assert submessage validity and error */
-    fail_if(pb_message_valid(&(messages[m])));
-    ck_assert_uint_eq(PB_ERROR_INVALID, pb_message_error(&(messages[m])));
+  /* Create journal, message and submessage */
+  pb_journal_t journal    = pb_journal_create(data, size);
+  pb_message_t message    = pb_message_create(&descriptor, &journal);
+  pb_message_t submessage = pb_message_create_within(&message, 11);
 
-    /* Free all allocated memory */
-    pb_message_destroy(&(messages[m]));
-  }
+  /* Detach submessage */
+  pb_journal_t detached = pb_message_detach(&submessage);
+  fail_unless(pb_journal_valid(&detached));
+  ck_assert_uint_eq(4, pb_journal_size(&detached));
+  fail_if(memcmp(&(data[6]), pb_journal_data(&detached), 4));
 
-  /* Assert message validity and error */
-  fail_if(pb_message_valid(&(messages[0])));
-  ck_assert_uint_eq(PB_ERROR_INVALID, pb_message_error(&(messages[0])));
+  /* Alter detached message */
+  pb_message_t copy = pb_message_create(&descriptor, &detached);
+  uint32_t value = 300;
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_put(&copy, 1, &value));
+  ck_assert_uint_eq(5, pb_journal_size(&detached));
 
-  /* Assert journal size */
-  fail_unless(pb_journal_empty(&journal));
-  ck_assert_uint_eq(0, pb_journal_size(&journal));
+  /* Assert unchanged original */
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_get(&submessage, 1, &value));
+  ck_assert_uint_eq(2, value);
+  fail_if(memcmp(data, pb_journal_data(&journal), size));
 
   /* Free all allocated memory */
-  pb_message_destroy(&(messages[0]));
+  pb_message_destroy(&copy);
+  pb_journal_destroy(&detached);
+  pb_message_destroy(&submessage);
+  pb_message_destroy(&message);
   pb_journal_destroy(&journal);
 } END_TEST
 
 /*
- * Clear a message with nested submessages entirely.
+ * Detach a copy of a submessage from a zero-copy journal.
  */
-START_TEST(test_clear_message_nested) {
-  pb_journal_t journal = pb_journal_create_empty();
-  pb_message_t messages[101] = { pb_message_create(&descriptor, &journal) };
-
-  /* Create a hundred nested submessages and write values to them */
-  for (size_t m = 1; m < 101; m++)
-    messages[m] = pb_message_create_within(&(messages[m - 1]), 11);
-
-  /* Assert message validity and error */
-  fail_unless(pb_message_valid(&(messages[0])));
-  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_error(&(messages[0])));
-
-  /* Clear message entirely */
-  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_clear(&(messages[0])));
-  ck_assert_uint_eq(PB_ERROR_INVALID, pb_message_clear(&(messages[0])));
+START_TEST(test_detach_zero_copy) {
+  uint8_t data[] = { 90, 2, 8, 2 };
+  size_t  size   = 4;
 
-  /* Align and destroy nested submessages */
-  for (size_t m = 1; m < 101; m++) {
-    ck_assert_uint_eq(PB_ERROR_INVALID, pb_message_align(&(messages[m])));
+  /* Create journal, message and submessage */
+  pb_journal_t journal    = pb_journal_create_zero_copy(data, size);
+  pb_message_t message    = pb_message_create(&descriptor, &journal);
+  pb_message_t submessage = pb_message_create_within(&message, 11);
 
-    /* Assert submessage validity and error */
-    fail_if(pb_message_valid(&(messages[m])));
-    ck_assert_uint_eq(PB_ERROR_INVALID, pb_message_error(&(messages[m])));
+  /* Detach submessage and grow it */
+  pb_journal_t detached = pb_message_detach(&submessage);
+  pb_message_t copy     = pb_message_create(&descriptor, &detached);
+  uint32_t value = 300;
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_put(&copy, 1, &value));
+  ck_assert_uint_eq(3, pb_journal_size(&detached));
 
-    /* Free all allocated memory */
-    pb_message_destroy(&(messages[m]));
-  }
+  /* Free all allocated memory */
+  pb_message_destroy(&copy);
+  pb_journal_destroy(&detached);
+  pb_message_destroy(&submessage);
+  pb_message_destroy(&message);
+  pb_journal_destroy(&journal);
+} END_TEST
 
-  /* Assert message validity and error */
-  fail_if(pb_message_valid(&(messages[0])));
-  ck_assert_uint_eq(PB_ERROR_INVALID, pb_message_error(&(messages[0])));
+/*
+ * Detach a copy of an invalid message.
+ */
+START_TEST(test_detach_invalid) {
+  pb_message_t message = pb_message_create_invalid();
 
-  /* Assert journal size */
-  fail_unless(pb_journal_empty(&journal));
-  ck_assert_uint_eq(0, pb_journal_size(&journal));
+  /* Detach message */
+  pb_journal_t journal = pb_message_detach(&message);
+  fail_if(pb_journal_valid(&journal));
 
   /* Free all allocated memory */
-  pb_message_destroy(&(messages[0]));
   pb_journal_destroy(&journal);
+  pb_message_destroy(&message);
 } END_TEST
 
 /*
- * Clear a message with nested submessages inside-out entirely.
+ * Compute the hash of a message.
  */
-START_TEST(test_clear_message_nested_inside_out) {
-  pb_journal_t journal = pb_journal_create_empty();
-  pb_message_t messages[101] = { pb_message_create(&descriptor, &journal) };
-
-  /* Create a hundred nested submessages and write values to them */
-  for (size_t m = 1; m < 101; m++)
-    messages[m] = pb_message_create_within(&(messages[m - 1]), 11);
+START_TEST(test_hash) {
+  const uint8_t data1[] = { 8, 1, 16, 2 },
+                data2[] = { 16, 2, 8, 5, 8, 1 },
+                data3[] = { 8, 2, 16, 2 };
 
-  /* Assert message validity and error */
-  fail_unless(pb_message_valid(&(messages[0])));
-  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_error(&(messages[0])));
+  /* Create journals and messages */
+  pb_journal_t journal1 = pb_journal_create(data1, sizeof(data1)),
+               journal2 = pb_journal_create(data2, sizeof(data2)),
+               journal3 = pb_journal_create(data3, sizeof(data3));
+  pb_message_t message1 = pb_message_create(&descriptor, &journal1),
+               message2 = pb_message_create(&descriptor, &journal2),
+               message3 = pb_message_create(&descriptor, &journal3);
+
+  /* Assert hashes regardless of order and overwritten values */
+  uint64_t hash1, hash2, hash3;
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_hash(&message1, &hash1));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_hash(&message2, &hash2));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_hash(&message3, &hash3));
+  fail_unless(hash1 == hash2);
+  fail_if(hash1 == hash3);
 
-  /* Align and clear nested submessages */
-  for (size_t m = 100; m > 0; m--) {
-    ck_assert_uint_eq(PB_ERROR_NONE, pb_message_clear(&(messages[m])));
-    ck_assert_uint_eq(PB_ERROR_INVALID, pb_message_clear(&(messages[m])));
+  /* Free all allocated memory */
+  pb_message_destroy(&message3);
+  pb_message_destroy(&message2);
+  pb_message_destroy(&message1);
+  pb_journal_destroy(&journal3);
+  pb_journal_destroy(&journal2);
+  pb_journal_destroy(&journal1);
+} END_TEST
 
-    /* Assert submessage validity and error */
-    fail_if(pb_message_valid(&(messages[m])));
-    ck_assert_uint_eq(PB_ERROR_INVALID, pb_message_error(&(messages[m])));
+/*
+ * Compute the hash of a message with packed and non-packed repeated fields.
+ */
+START_TEST(test_hash_repeated) {
+  const uint8_t data1[] = { 8, 1, 26, 1, 65, 8, 2 },
+                data2[] = { 10, 2, 1, 2, 26, 1, 65 },
+                data3[] = { 8, 2, 8, 1, 26, 1, 65 };
 
-    /* Free all allocated memory */
-    pb_message_destroy(&(messages[m]));
-  }
+  /* Create journals and messages */
+  pb_journal_t journal1 = pb_journal_create(data1, sizeof(data1)),
+               journal2 = pb_journal_create(data2, sizeof(data2)),
+               journal3 = pb_journal_create(data3, sizeof(data3));
+  pb_message_t message1 = pb_message_create(&repeated_descriptor, &journal1),
+               message2 = pb_message_create(&repeated_descriptor, &journal2),
+               message3 = pb_message_create(&repeated_descriptor, &journal3);
+
+  /* Assert hashes regardless of packing, but depending on order */
+  uint64_t hash1, hash2, hash3;
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_hash(&message1, &hash1));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_hash(&message2, &hash2));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_hash(&message3, &hash3));
+  fail_unless(hash1 == hash2);
+  fail_if(hash1 == hash3);
 
-  /* Clear message entirely */
-  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_clear(&(messages[0])));
-  ck_assert_uint_eq(PB_ERROR_INVALID, pb_message_clear(&(messages[0])));
+  /* Free all allocated memory */
+  pb_message_destroy(&message3);
+  pb_message_destroy(&message2);
+  pb_message_destroy(&message1);
+  pb_journal_destroy(&journal3);
+  pb_journal_destroy(&journal2);
+  pb_journal_destroy(&journal1);
+} END_TEST
 
-  /* Assert message validity and error */
-  fail_if(pb_message_valid(&(messages[0])));
-  ck_assert_uint_eq(PB_ERROR_INVALID, pb_message_error(&(messages[0])));
+/*
+ * Compute the hash of a message with submessages.
+ */
+START_TEST(test_hash_nested) {
+  const uint8_t data1[] = { 90, 4, 8, 1, 16, 2 },
+                data2[] = { 90, 2, 8, 9, 90, 4, 16, 2, 8, 1 },
+                data3[] = { 90, 2, 8, 1 };
 
-  /* Assert journal size */
-  fail_unless(pb_journal_empty(&journal));
-  ck_assert_uint_eq(0, pb_journal_size(&journal));
+  /* Create journals and messages */
+  pb_journal_t journal1 = pb_journal_create(data1, sizeof(data1)),
+               journal2 = pb_journal_create(data2, sizeof(data2)),
+               journal3 = pb_journal_create(data3, sizeof(data3));
+  pb_message_t message1 = pb_message_create(&descriptor, &journal1),
+               message2 = pb_message_create(&descriptor, &journal2),
+               message3 = pb_message_create(&descriptor, &journal3);
+
+  /* Assert hashes of last submessages */
+  uint64_t hash1, hash2, hash3;
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_hash(&message1, &hash1));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_hash(&message2, &hash2));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_hash(&message3, &hash3));
+  fail_unless(hash1 == hash2);
+  fail_if(hash1 == hash3);
 
   /* Free all allocated memory */
-  pb_message_destroy(&(messages[0]));
-  pb_journal_destroy(&journal);
+  pb_message_destroy(&message3);
+  pb_message_destroy(&message2);
+  pb_message_destroy(&message1);
+  pb_journal_destroy(&journal3);
+  pb_journal_destroy(&journal2);
+  pb_journal_destroy(&journal1);
 } END_TEST
 
 /*
- * Clear an unaligned message entirely.
+ * Compute the hash of a message with a oneof.
  */
-START_TEST(test_clear_unaligned) {
-  const uint8_t data[] = { 8, 127 };
-  const size_t  size   = 2;
-
-  /* Create journal and message */
-  pb_journal_t journal = pb_journal_create(data, size);
-  pb_message_t message = pb_message_create(&descriptor, &journal);
+START_TEST(test_hash_oneof) {
+  const uint8_t data1[] = { 104, 1, 112, 2 },
+                data2[] = { 112, 2 },
+                data3[] = { 112, 2, 104, 1 };
 
-  /* Write value to message */
-  uint32_t value = 127;
-  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_put(&message, 1, &value));
+  /* Create journals and messages */
+  pb_journal_t journal1 = pb_journal_create(data1, sizeof(data1)),
+               journal2 = pb_journal_create(data2, sizeof(data2)),
+               journal3 = pb_journal_create(data3, sizeof(data3));
+  pb_message_t message1 = pb_message_create(&descriptor, &journal1),
+               message2 = pb_message_create(&descriptor, &journal2),
+               message3 = pb_message_create(&descriptor, &journal3);
+
+  /* Assert hashes of active members */
+  uint64_t hash1, hash2, hash3;
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_hash(&message1, &hash1));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_hash(&message2, &hash2));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_hash(&message3, &hash3));
+  fail_unless(hash1 == hash2);
+  fail_if(hash1 == hash3);
 
-  /* Assert message validity and error */
-  fail_unless(pb_message_valid(&message));
-  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_error(&message));
+  /* Free all allocated memory */
+  pb_message_destroy(&message3);
+  pb_message_destroy(&message2);
+  pb_message_destroy(&message1);
+  pb_journal_destroy(&journal3);
+  pb_journal_destroy(&journal2);
+  pb_journal_destroy(&journal1);
+} END_TEST
 
-  /* Clear message entirely */
-  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_clear(&message));
-  ck_assert_uint_eq(PB_ERROR_INVALID, pb_message_clear(&message));
+/*
+ * Compute the hash of an invalid message.
+ */
+START_TEST(test_hash_invalid) {
+  pb_message_t message = pb_message_create_invalid();
 
   /* Assert message validity and error */
+  uint64_t hash;
   fail_if(pb_message_valid(&message));
-  ck_assert_uint_eq(PB_ERROR_INVALID, pb_message_error(&message));
-
-  /* Assert journal size */
-  fail_unless(pb_journal_empty(&journal));
-  ck_assert_uint_eq(0, pb_journal_size(&journal));
+  ck_assert_uint_eq(PB_ERROR_INVALID, pb_message_hash(&message, &hash));
 
   /* Free all allocated memory */
   pb_message_destroy(&message);
-  pb_journal_destroy(&journal);
 } END_TEST
 
 /*
- * Clear an invalid message entirely.
+ * Test whether two messages are equal.
  */
-START_TEST(test_clear_invalid) {
-  pb_message_t message = pb_message_create_invalid();
-
-  /* Assert message validity and error */
-  fail_if(pb_message_valid(&message));
-  ck_assert_uint_eq(PB_ERROR_INVALID, pb_message_error(&message));
+START_TEST(test_equals) {
+  const uint8_t data1[] = { 8, 1, 16, 2, 66, 1, 65 },
+                data2[] = { 66, 1, 65, 16, 2, 8, 5, 8, 1 },
+                data3[] = { 8, 1, 16, 2, 66, 1, 66 };
 
-  /* Clear message */
-  ck_assert_uint_eq(PB_ERROR_INVALID, pb_message_clear(&message));
+  /* Create journals and messages */
+  pb_journal_t journal1 = pb_journal_create(data1, sizeof(data1)),
+               journal2 = pb_journal_create(data2, sizeof(data2)),
+               journal3 = pb_journal_create(data3, sizeof(data3));
+  pb_message_t message1 = pb_message_create(&descriptor, &journal1),
+               message2 = pb_message_create(&descriptor, &journal2),
+               message3 = pb_message_create(&descriptor, &journal3);
+
+  /* Assert equality regardless of order and overwritten values */
+  fail_unless(pb_message_equals(&message1, &message1));
+  fail_unless(pb_message_equals(&message1, &message2));
+  fail_unless(pb_message_equals(&message2, &message1));
+  fail_if(pb_message_equals(&message1, &message3));
+  fail_if(pb_message_equals(&message2, &message3));
 
   /* Free all allocated memory */
-  pb_message_destroy(&message);
+  pb_message_destroy(&message3);
+  pb_message_destroy(&message2);
+  pb_message_destroy(&message1);
+  pb_journal_destroy(&journal3);
+  pb_journal_destroy(&journal2);
+  pb_journal_destroy(&journal1);
 } END_TEST
 
 /*
- * Ensure that a message is properly aligned.
+ * Test whether two messages with repeated fields are equal.
  */
-START_TEST(test_align) {
-  pb_journal_t journal = pb_journal_create_empty();
-  pb_message_t message = pb_message_create(&descriptor, &journal);
+START_TEST(test_equals_repeated) {
+  const uint8_t data1[] = { 8, 1, 26, 1, 65, 8, 2 },
+                data2[] = { 10, 2, 1, 2, 26, 1, 65 },
+                data3[] = { 8, 1, 26, 1, 65 };
 
-  /* Create submessages */
-  pb_message_t submessage1 = pb_message_create_within(&message, 11);
-  pb_message_t submessage2 = pb_message_create_within(&message, 11);
+  /* Create journals and messages */
+  pb_journal_t journal1 = pb_journal_create(data1, sizeof(data1)),
+               journal2 = pb_journal_create(data2, sizeof(data2)),
+               journal3 = pb_journal_create(data3, sizeof(data3));
+  pb_message_t message1 = pb_message_create(&repeated_descriptor, &journal1),
+               message2 = pb_message_create(&repeated_descriptor, &journal2),
+               message3 = pb_message_create(&repeated_descriptor, &journal3);
+
+  /* Assert equality regardless of packing */
+  fail_unless(pb_message_equals(&message1, &message2));
+  fail_if(pb_message_equals(&message1, &message3));
+  fail_if(pb_message_equals(&message2, &message3));
 
-  /* Write value to submessage */
-  pb_string_t value = pb_string_init_from_chars(
-    "Lorem ipsum dolor sit amet, consectetur adipiscing elit. Nam euismod "
-    "vehicula nibh, et egestas erat eleifend quis. Nam hendrerit egestas "
-    "quam nec egestas. Donec lacinia vestibulum erat, ac suscipit nisi "
-    "vehicula nec. Praesent ullamcorper vitae lorem vel euismod. Quisque "
-    "fringilla lobortis convallis. Aliquam accumsan lacus eu viverra dapibus. "
-    "Phasellus in adipiscing sem, in congue massa. Vestibulum ullamcorper "
-    "orci nec semper pretium.");
-  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_put(&submessage1, 8, &value));
+  /* Free all allocated memory */
+  pb_message_destroy(&message3);
+  pb_message_destroy(&message2);
+  pb_message_destroy(&message1);
+  pb_journal_destroy(&journal3);
+  pb_journal_destroy(&journal2);
+  pb_journal_destroy(&journal1);
+} END_TEST
 
-  /* Align submessage to perform checks */
-  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_align(&submessage1));
+/*
+ * Test whether two messages with submessages are equal.
+ */
+START_TEST(test_equals_nested) {
+  const uint8_t data1[] = { 98, 4, 8, 1, 16, 2, 98, 0 },
+                data2[] = { 98, 4, 16, 2, 8, 1, 98, 0 },
+                data3[] = { 98, 0, 98, 4, 16, 2, 8, 1 };
 
-  /* Assert submessage size and version */
-  fail_if(pb_message_empty(&submessage1));
-  ck_assert_uint_eq(440, pb_message_size(&submessage1));
-  ck_assert_uint_eq(5, pb_message_version(&submessage1));
+  /* Create journals and messages */
+  pb_journal_t journal1 = pb_journal_create(data1, sizeof(data1)),
+               journal2 = pb_journal_create(data2, sizeof(data2)),
+               journal3 = pb_journal_create(data3, sizeof(data3));
+  pb_message_t message1 = pb_message_create(&descriptor, &journal1),
+               message2 = pb_message_create(&descriptor, &journal2),
+               message3 = pb_message_create(&descriptor, &journal3);
 
-  /* Assert alignment */
-  ck_assert_uint_eq(1, pb_message_version(&submessage2));
-  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_align(&submessage2));
-  fail_unless(pb_message_equals(&submessage1, &submessage2));
+  /* Assert equality of submessages in order */
+  fail_unless(pb_message_equals(&message1, &message2));
+  fail_if(pb_message_equals(&message1, &message3));
 
   /* Free all allocated memory */
-  pb_message_destroy(&submessage2);
-  pb_message_destroy(&submessage1);
-  pb_message_destroy(&message);
+  pb_message_destroy(&message3);
+  pb_message_destroy(&message2);
+  pb_message_destroy(&message1);
+  pb_journal_destroy(&journal3);
+  pb_journal_destroy(&journal2);
+  pb_journal_destroy(&journal1);
+} END_TEST
+
+/*
+ * Test whether an invalid message equals another message.
+ */
+START_TEST(test_equals_invalid) {
+  pb_journal_t journal  = pb_journal_create_empty();
+  pb_message_t message1 = pb_message_create(&descriptor, &journal),
+               message2 = pb_message_create_invalid();
+  message2.descriptor = &descriptor;
+
+  /* Assert equality of valid messages only */
+  fail_unless(pb_message_equals(&message1, &message1));
+  fail_if(pb_message_equals(&message1, &message2));
+
+  /* Free all allocated memory */
+  pb_message_destroy(&message2);
+  pb_message_destroy(&message1);
   pb_journal_destroy(&journal);
 } END_TEST
 
@@ -3152,6 +4959,10 @@ main(void) {
   tcase_add_test(tcase, test_create_from_field);
   tcase_add_test(tcase, test_create_from_field_empty);
   tcase_add_test(tcase, test_create_from_field_invalid);
+  tcase_add_test(tcase, test_create_from_key);
+  tcase_add_test(tcase, test_create_from_key_strings);
+  tcase_add_test(tcase, test_create_from_key_altered);
+  tcase_add_test(tcase, test_create_from_key_invalid);
   tcase_add_test(tcase, test_create_invalid);
   suite_add_tcase(suite, tcase);
 
@@ -3200,6 +5011,11 @@ main(void) {
   tcase_add_test(tcase, test_get_oneof_merged);
   tcase_add_test(tcase, test_get_unaligned);
   tcase_add_test(tcase, test_get_invalid);
+  tcase_add_test(tcase, test_get_many);
+  tcase_add_test(tcase, test_get_many_empty);
+  tcase_add_test(tcase, test_get_many_invalid);
+  tcase_add_test(tcase, test_get_fields);
+  tcase_add_test(tcase, test_get_fields_invalid);
   suite_add_tcase(suite, tcase);
 
   /* Add tests to test case "put" */
@@ -3218,6 +5034,28 @@ main(void) {
   tcase_add_test(tcase, test_put_oneof_merged);
   tcase_add_test(tcase, test_put_unaligned);
   tcase_add_test(tcase, test_put_invalid);
+  tcase_add_test(tcase, test_put_frozen);
+  tcase_add_test(tcase, test_put_repeated);
+  tcase_add_test(tcase, test_put_repeated_strings);
+  tcase_add_test(tcase, test_put_repeated_empty);
+  tcase_add_test(tcase, test_put_repeated_invalid);
+  tcase_add_test(tcase, test_put_packed);
+  tcase_add_test(tcase, test_put_packed_nested);
+  tcase_add_test(tcase, test_put_many);
+  tcase_add_test(tcase, test_put_many_existing);
+  tcase_add_test(tcase, test_put_many_repeated);
+  tcase_add_test(tcase, test_put_many_nested);
+  tcase_add_test(tcase, test_put_many_index);
+  tcase_add_test(tcase, test_put_many_invalid);
+  suite_add_tcase(suite, tcase);
+
+  /* Add tests to test case "merge" */
+  tcase = tcase_create("merge");
+  tcase_add_test(tcase, test_merge);
+  tcase_add_test(tcase, test_merge_nested);
+  tcase_add_test(tcase, test_merge_empty);
+  tcase_add_test(tcase, test_merge_invalid);
+  tcase_add_test(tcase, test_merge_frozen);
   suite_add_tcase(suite, tcase);
 
   /* Add tests to test case "erase" */
@@ -3233,6 +5071,15 @@ main(void) {
   tcase_add_test(tcase, test_erase_oneof_merged);
   tcase_add_test(tcase, test_erase_unaligned);
   tcase_add_test(tcase, test_erase_invalid);
+  tcase_add_test(tcase, test_erase_many);
+  tcase_add_test(tcase, test_erase_many_oneof);
+  tcase_add_test(tcase, test_erase_many_nested);
+  tcase_add_test(tcase, test_erase_many_invalid);
+  tcase_add_test(tcase, test_canonicalize);
+  tcase_add_test(tcase, test_canonicalize_nested);
+  tcase_add_test(tcase, test_canonicalize_oneof);
+  tcase_add_test(tcase, test_canonicalize_sorted);
+  tcase_add_test(tcase, test_canonicalize_invalid);
   suite_add_tcase(suite, tcase);
 
   /* Add tests to test case "clear" */
@@ -3251,6 +5098,50 @@ main(void) {
   tcase_add_test(tcase, test_align);
   suite_add_tcase(suite, tcase);
 
+  /* Add tests to test case "batch" */
+  tcase = tcase_create("batch");
+  tcase_add_test(tcase, test_batch);
+  tcase_add_test(tcase, test_batch_repeated);
+  tcase_add_test(tcase, test_batch_freeze);
+  suite_add_tcase(suite, tcase);
+
+  /* Add tests to test case "padded" */
+  tcase = tcase_create("padded");
+  tcase_add_test(tcase, test_padded);
+  tcase_add_test(tcase, test_padded_pack_invalid);
+  suite_add_tcase(suite, tcase);
+
+  /* Add tests to test case "index" */
+  tcase = tcase_create("index");
+  tcase_add_test(tcase, test_index);
+  tcase_add_test(tcase, test_index_nested);
+  tcase_add_test(tcase, test_index_oneof);
+  tcase_add_test(tcase, test_index_invalid);
+  suite_add_tcase(suite, tcase);
+
+  /* Add tests to test case "view" */
+  tcase = tcase_create("view");
+  tcase_add_test(tcase, test_view);
+  tcase_add_test(tcase, test_view_empty);
+  tcase_add_test(tcase, test_view_invalid);
+  tcase_add_test(tcase, test_detach);
+  tcase_add_test(tcase, test_detach_zero_copy);
+  tcase_add_test(tcase, test_detach_invalid);
+  suite_add_tcase(suite, tcase);
+
+  /* Add tests to test case "hash" */
+  tcase = tcase_create("hash");
+  tcase_add_test(tcase, test_hash);
+  tcase_add_test(tcase, test_hash_repeated);
+  tcase_add_test(tcase, test_hash_nested);
+  tcase_add_test(tcase, test_hash_oneof);
+  tcase_add_test(tcase, test_hash_invalid);
+  tcase_add_test(tcase, test_equals);
+  tcase_add_test(tcase, test_equals_repeated);
+  tcase_add_test(tcase, test_equals_nested);
+  tcase_add_test(tcase, test_equals_invalid);
+  suite_add_tcase(suite, tcase);
+
   /* Create a test suite runner in no-fork mode */
   void *runner = srunner_create(suite);
   srunner_set_fork_status(runner, CK_NOFORK);
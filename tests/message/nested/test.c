@@ -1007,6 +1007,154 @@ START_TEST(test_erase_invalid) {
   /* Free all allocated memory */
   pb_message_destroy(&message);
 } END_TEST
+/*
+ * Read and write values of a nested message using a path.
+ */
+START_TEST(test_path) {
+  pb_journal_t journal = pb_journal_create_empty();
+  pb_message_t message = pb_message_create(&descriptor, &journal);
+  pb_path_t    path    = pb_path_create(&descriptor,
+    (const pb_tag_t []){ 11, 11, 2 }, 3);
+
+  /* Write value to nested submessage */
+  uint64_t value = 127;
+  fail_if(pb_message_path_has(&message, &path));
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_message_path_put(&message, &path, &value));
+
+  /* Assert journal size */
+  ck_assert_uint_eq(6, pb_journal_size(&journal));
+
+  /* Read value from nested submessage */
+  value = 0;
+  fail_unless(pb_message_path_has(&message, &path));
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_message_path_get(&message, &path, &value));
+  ck_assert_uint_eq(127, value);
+
+  /* Write value in front of nested submessage */
+  pb_string_t string = pb_string_const("SOME DATA");
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_put(&message, 8, &string));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_nested_put(&message,
+    (const pb_tag_t []){ 11, 1 }, 2, (const uint32_t []){ 1 }));
+
+  /* Read value from realigned nested submessage */
+  value = 0;
+  fail_unless(pb_message_path_match(&message, &path,
+    (const uint64_t []){ 127 }));
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_message_path_get(&message, &path, &value));
+  ck_assert_uint_eq(127, value);
+
+  /* Erase value from nested submessage */
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_message_path_erase(&message, &path));
+  fail_if(pb_message_path_has(&message, &path));
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_message_nested_get(&message,
+      (const pb_tag_t []){ 11, 11, 2 }, 3, &value));
+  ck_assert_uint_eq(default_uint64, value);
+
+  /* Free all allocated memory */
+  pb_path_destroy(&path);
+  pb_message_destroy(&message);
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Read and write values using a path after erasing the submessage.
+ */
+START_TEST(test_path_erased) {
+  pb_journal_t journal = pb_journal_create_empty();
+  pb_message_t message = pb_message_create(&descriptor, &journal);
+  pb_path_t    path    = pb_path_create(&descriptor,
+    (const pb_tag_t []){ 11, 11, 2 }, 3);
+
+  /* Write value to nested submessage */
+  uint64_t value = 127;
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_message_path_put(&message, &path, &value));
+
+  /* Erase submessage and read value */
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_erase(&message, 11));
+  ck_assert_uint_eq(PB_ERROR_ABSENT,
+    pb_message_path_get(&message, &path, &value));
+  ck_assert_uint_eq(PB_ERROR_INVALID,
+    pb_message_path_erase(&message, &path));
+
+  /* Write value to recreated nested submessage */
+  value = 255;
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_message_path_put(&message, &path, &value));
+  value = 0;
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_message_path_get(&message, &path, &value));
+  ck_assert_uint_eq(255, value);
+
+  /* Free all allocated memory */
+  pb_path_destroy(&path);
+  pb_message_destroy(&message);
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Read values using a path for different messages.
+ */
+START_TEST(test_path_repeated) {
+  pb_journal_t journal = pb_journal_create_empty();
+  pb_message_t message = pb_message_create(&descriptor, &journal);
+  pb_path_t    path    = pb_path_create(&descriptor,
+    (const pb_tag_t []){ 11, 2 }, 2);
+
+  /* Create repeated submessages and write values to them */
+  pb_message_t submessages[3];
+  for (size_t m = 0; m < 3; m++) {
+    uint64_t value = m;
+    submessages[m] = pb_message_create_within(&message, 12);
+    ck_assert_uint_eq(PB_ERROR_NONE,
+      pb_message_path_put(&(submessages[m]), &path, &value));
+  }
+
+  /* Read values from repeated submessages */
+  for (size_t m = 0; m < 3; m++) {
+    uint64_t value = 0;
+    ck_assert_uint_eq(PB_ERROR_NONE,
+      pb_message_path_get(&(submessages[m]), &path, &value));
+    ck_assert_uint_eq(m, value);
+  }
+
+  /* Free all allocated memory */
+  for (size_t m = 0; m < 3; m++)
+    pb_message_destroy(&(submessages[m]));
+  pb_path_destroy(&path);
+  pb_message_destroy(&message);
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Read and write values using a path for an invalid message.
+ */
+START_TEST(test_path_invalid) {
+  pb_message_t message = pb_message_create_invalid();
+  pb_path_t    path    = pb_path_create(&descriptor,
+    (const pb_tag_t []){ 11, 2 }, 2);
+
+  /* Assert message validity and error */
+  fail_if(pb_message_valid(&message));
+  ck_assert_uint_eq(PB_ERROR_INVALID, pb_message_error(&message));
+
+  /* Read and write value */
+  uint64_t value = 0;
+  fail_if(pb_message_path_has(&message, &path));
+  ck_assert_uint_eq(PB_ERROR_INVALID,
+    pb_message_path_get(&message, &path, &value));
+  ck_assert_uint_eq(PB_ERROR_INVALID,
+    pb_message_path_put(&message, &path, &value));
+
+  /* Free all allocated memory */
+  pb_path_destroy(&path);
+  pb_message_destroy(&message);
+} END_TEST
 
 /* ----------------------------------------------------------------------------
  * Program
@@ -1070,6 +1218,14 @@ main(void) {
   tcase_add_test(tcase, test_erase_invalid);
   suite_add_tcase(suite, tcase);
 
+  /* Add tests to test case "path" */
+  tcase = tcase_create("path");
+  tcase_add_test(tcase, test_path);
+  tcase_add_test(tcase, test_path_erased);
+  tcase_add_test(tcase, test_path_repeated);
+  tcase_add_test(tcase, test_path_invalid);
+  suite_add_tcase(suite, tcase);
+
   /* Create a test suite runner in no-fork mode */
   void *runner = srunner_create(suite);
   srunner_set_fork_status(runner, CK_NOFORK);
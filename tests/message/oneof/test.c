@@ -28,10 +28,42 @@
 
 #include "core/descriptor.h"
 #include "message/common.h"
+#include "message/cursor.h"
 #include "message/journal.h"
 #include "message/message.h"
 #include "message/oneof.h"
 
+/* ----------------------------------------------------------------------------
+ * Handlers
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Read the value of an active scalar member.
+ *
+ * \param[in,out] cursor Cursor
+ * \param[out]    user   User data
+ * \return                Error code
+ */
+static pb_error_t
+handler_value(pb_cursor_t *cursor, void *user) {
+  return pb_cursor_get(cursor, user);
+}
+
+/*!
+ * Read a value from an active submessage member.
+ *
+ * \param[in,out] cursor Cursor
+ * \param[out]    user   User data
+ * \return                Error code
+ */
+static pb_error_t
+handler_message(pb_cursor_t *cursor, void *user) {
+  pb_message_t submessage = pb_message_create_from_cursor(cursor);
+  pb_error_t error = pb_message_get(&submessage, 1, user);
+  pb_message_destroy(&submessage);
+  return error;
+}
+
 /* ----------------------------------------------------------------------------
  * Descriptors
  * ------------------------------------------------------------------------- */
@@ -225,6 +257,41 @@ START_TEST(test_case_message_merged) {
   pb_journal_destroy(&journal);
 } END_TEST
 
+/*
+ * Retrieve the active tag of a oneof using a field offset index.
+ */
+START_TEST(test_case_index) {
+  const uint8_t data[] = { 8, 127, 24, 127, 16, 127, 8, 126 };
+  const size_t  size   = 8;
+
+  /* Create journal, message and oneof */
+  pb_journal_t journal = pb_journal_create(data, size);
+  pb_message_t message = pb_message_create(&descriptor, &journal);
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_index(&message));
+  pb_oneof_t   oneof   = pb_oneof_create(&oneof_descriptor, &message);
+
+  /* Assert active tag */
+  ck_assert_uint_eq(2, pb_oneof_case(&oneof));
+  pb_oneof_destroy(&oneof);
+
+  /* Alter message and assert active tag */
+  uint32_t value = 127;
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_put(&message, 3, &value));
+  oneof = pb_oneof_create(&oneof_descriptor, &message);
+  ck_assert_uint_eq(3, pb_oneof_case(&oneof));
+  pb_oneof_destroy(&oneof);
+
+  /* Clear oneof and assert active tag */
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_erase(&message, 3));
+  oneof = pb_oneof_create(&oneof_descriptor, &message);
+  ck_assert_uint_eq(0, pb_oneof_case(&oneof));
+
+  /* Free all allocated memory */
+  pb_oneof_destroy(&oneof);
+  pb_message_destroy(&message);
+  pb_journal_destroy(&journal);
+} END_TEST
+
 /*
  * Retrieve the active tag of a oneof on an invalid message.
  */
@@ -261,6 +328,111 @@ START_TEST(test_case_invalid) {
   pb_oneof_destroy(&oneof);
 } END_TEST
 
+/*
+ * Dispatch the active member of a oneof.
+ */
+START_TEST(test_dispatch) {
+  const uint8_t data[] = { 8, 127, 16, 126, 24, 125 };
+  const size_t  size   = 6;
+
+  /* Create journal, message and oneof */
+  pb_journal_t journal = pb_journal_create(data, size);
+  pb_message_t message = pb_message_create(&descriptor, &journal);
+  pb_oneof_t   oneof   = pb_oneof_create(&oneof_descriptor, &message);
+
+  /* Dispatch active member */
+  const pb_oneof_handler_f handlers[] = {
+    handler_value, handler_value, handler_message
+  };
+  uint32_t value = 0;
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_oneof_dispatch(&oneof, handlers, &value));
+  ck_assert_uint_eq(125, value);
+
+  /* Free all allocated memory */
+  pb_oneof_destroy(&oneof);
+  pb_message_destroy(&message);
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Dispatch an active submessage member of a oneof.
+ */
+START_TEST(test_dispatch_message) {
+  const uint8_t data[] = { 16, 126, 34, 2, 8, 127, 8, 1 };
+  const size_t  size   = 8;
+
+  /* Create journal, message and oneof */
+  pb_journal_t journal = pb_journal_create(data, size);
+  pb_message_t message = pb_message_create(&descriptor, &journal);
+  pb_oneof_t   oneof   = pb_oneof_create(&oneof_descriptor, &message);
+
+  /* Dispatch active member */
+  const pb_oneof_handler_f handlers[] = {
+    handler_value, handler_value, handler_message
+  };
+  uint32_t value = 0;
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_oneof_dispatch(&oneof, handlers, &value));
+  ck_assert_uint_eq(127, value);
+
+  /* Assert absent handler */
+  const pb_oneof_handler_f partial[] = {
+    handler_value, handler_value, NULL
+  };
+  ck_assert_uint_eq(PB_ERROR_ABSENT,
+    pb_oneof_dispatch(&oneof, partial, &value));
+
+  /* Free all allocated memory */
+  pb_oneof_destroy(&oneof);
+  pb_message_destroy(&message);
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Dispatch a oneof without an active member.
+ */
+START_TEST(test_dispatch_message_empty) {
+  const uint8_t data[] = { 8, 127 };
+  const size_t  size   = 2;
+
+  /* Create journal, message and oneof */
+  pb_journal_t journal = pb_journal_create(data, size);
+  pb_message_t message = pb_message_create(&descriptor, &journal);
+  pb_oneof_t   oneof   = pb_oneof_create(&oneof_descriptor, &message);
+
+  /* Assert absent member */
+  const pb_oneof_handler_f handlers[] = {
+    handler_value, handler_value, handler_message
+  };
+  uint32_t value = 0;
+  ck_assert_uint_eq(PB_ERROR_ABSENT,
+    pb_oneof_dispatch(&oneof, handlers, &value));
+
+  /* Free all allocated memory */
+  pb_oneof_destroy(&oneof);
+  pb_message_destroy(&message);
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Dispatch an invalid oneof.
+ */
+START_TEST(test_dispatch_invalid) {
+  pb_oneof_t oneof = pb_oneof_create_invalid();
+
+  /* Assert failing dispatch */
+  const pb_oneof_handler_f handlers[] = {
+    handler_value, handler_value, handler_message
+  };
+  uint32_t value = 0;
+  ck_assert_uint_eq(PB_ERROR_INVALID,
+    pb_oneof_dispatch(&oneof, handlers, &value));
+
+  /* Free all allocated memory */
+  pb_oneof_destroy(&oneof);
+} END_TEST
+
 /*
  * Clear all members of a oneof.
  */
@@ -429,10 +601,19 @@ main(void) {
   tcase_add_test(tcase, test_case);
   tcase_add_test(tcase, test_case_message_empty);
   tcase_add_test(tcase, test_case_message_merged);
+  tcase_add_test(tcase, test_case_index);
   tcase_add_test(tcase, test_case_message_invalid);
   tcase_add_test(tcase, test_case_invalid);
   suite_add_tcase(suite, tcase);
 
+  /* Add tests to test case "dispatch" */
+  tcase = tcase_create("dispatch");
+  tcase_add_test(tcase, test_dispatch);
+  tcase_add_test(tcase, test_dispatch_message);
+  tcase_add_test(tcase, test_dispatch_message_empty);
+  tcase_add_test(tcase, test_dispatch_invalid);
+  suite_add_tcase(suite, tcase);
+
   /* Add tests to test case "clear" */
   tcase = tcase_create("clear");
   tcase_add_test(tcase, test_clear);
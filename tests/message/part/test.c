@@ -456,6 +456,131 @@ START_TEST(test_create_oneof_existing_after) {
   pb_journal_destroy(&journal);
 } END_TEST
 
+/*
+ * Create a part within an unordered message for a specific tag.
+ */
+START_TEST(test_create_unordered) {
+  const uint8_t data[] = { 16, 127, 80, 1 };
+  const size_t  size   = 4;
+
+  /* Create journal, message and part */
+  pb_journal_t journal = pb_journal_create(data, size);
+  pb_journal_set_unordered(&journal, 1);
+  pb_message_t message = pb_message_create(&descriptor, &journal);
+  pb_part_t    part    = pb_part_create(&message, 1);
+
+  /* Assert part validity and error */
+  fail_unless(pb_part_valid(&part));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_part_error(&part));
+
+  /* Assert part offsets */
+  ck_assert_uint_eq(5, pb_part_start(&part));
+  ck_assert_uint_eq(5, pb_part_end(&part));
+
+  /* Assert journal contents and size */
+  ck_assert_uint_eq(5, pb_journal_size(&journal));
+  ck_assert_uint_eq(8, pb_journal_data_at(&journal, 4));
+
+  /* Free all allocated memory */
+  pb_part_destroy(&part);
+  pb_message_destroy(&message);
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Create a part within an unordered message for an existing tag.
+ */
+START_TEST(test_create_unordered_existing) {
+  const uint8_t data[] = { 16, 127, 8, 1 };
+  const size_t  size   = 4;
+
+  /* Create journal, message and part */
+  pb_journal_t journal = pb_journal_create(data, size);
+  pb_journal_set_unordered(&journal, 1);
+  pb_message_t message = pb_message_create(&descriptor, &journal);
+  pb_part_t    part    = pb_part_create(&message, 2);
+
+  /* Assert part size and version */
+  ck_assert_uint_eq(1, pb_part_size(&part));
+  ck_assert_uint_eq(0, pb_part_version(&part));
+
+  /* Assert part offsets */
+  ck_assert_uint_eq(1, pb_part_start(&part));
+  ck_assert_uint_eq(2, pb_part_end(&part));
+
+  /* Free all allocated memory */
+  pb_part_destroy(&part);
+  pb_message_destroy(&message);
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Create parts for a repeated tag within an unordered message.
+ */
+START_TEST(test_create_unordered_repeated) {
+  const uint8_t data[] = { 80, 1, 88, 0 };
+  const size_t  size   = 4;
+  const uint8_t check[] = { 80, 1, 88, 0, 72, 1, 80, 2 };
+
+  /* Create journal and message */
+  pb_journal_t journal = pb_journal_create(data, size);
+  pb_journal_set_unordered(&journal, 1);
+  pb_message_t message = pb_message_create(&descriptor, &journal);
+
+  /* Create parts and write values to them */
+  for (size_t p = 1; p < 3; p++) {
+    pb_part_t part = pb_part_create(&message, 8 + p);
+    ck_assert_uint_eq(PB_ERROR_NONE,
+      pb_part_write(&part, (uint8_t *)&p, 1));
+
+    /* Assert part offsets */
+    ck_assert_uint_eq(size + p * 2 - 1, pb_part_start(&part));
+    ck_assert_uint_eq(size + p * 2, pb_part_end(&part));
+
+    /* Free all allocated memory */
+    pb_part_destroy(&part);
+  }
+
+  /* Assert journal contents */
+  fail_if(memcmp(check, pb_journal_data(&journal), 8));
+
+  /* Free all allocated memory */
+  pb_message_destroy(&message);
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Create a part within an unordered message for a member of a oneof.
+ */
+START_TEST(test_create_unordered_oneof) {
+  const uint8_t data[] = { 32, 127, 8, 1 };
+  const size_t  size   = 4;
+  const uint8_t check[] = { 8, 1, 24 };
+
+  /* Create journal, message and part */
+  pb_journal_t journal = pb_journal_create(data, size);
+  pb_journal_set_unordered(&journal, 1);
+  pb_message_t message = pb_message_create(&descriptor, &journal);
+  pb_part_t    part    = pb_part_create(&message, 3);
+
+  /* Assert part validity and error */
+  fail_unless(pb_part_valid(&part));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_part_error(&part));
+
+  /* Assert part offsets */
+  ck_assert_uint_eq(3, pb_part_start(&part));
+  ck_assert_uint_eq(3, pb_part_end(&part));
+
+  /* Assert journal contents */
+  ck_assert_uint_eq(3, pb_journal_size(&journal));
+  fail_if(memcmp(check, pb_journal_data(&journal), 3));
+
+  /* Free all allocated memory */
+  pb_part_destroy(&part);
+  pb_message_destroy(&message);
+  pb_journal_destroy(&journal);
+} END_TEST
+
 /*
  * Create a part within a journal.
  */
@@ -1081,6 +1206,10 @@ main(void) {
   tcase_add_test(tcase, test_create_oneof_existing);
   tcase_add_test(tcase, test_create_oneof_existing_before);
   tcase_add_test(tcase, test_create_oneof_existing_after);
+  tcase_add_test(tcase, test_create_unordered);
+  tcase_add_test(tcase, test_create_unordered_existing);
+  tcase_add_test(tcase, test_create_unordered_repeated);
+  tcase_add_test(tcase, test_create_unordered_oneof);
   tcase_add_test(tcase, test_create_from_journal);
   tcase_add_test(tcase, test_create_from_journal_invalid);
   tcase_add_test(tcase, test_create_from_cursor);
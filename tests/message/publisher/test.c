@@ -0,0 +1,245 @@
+/*
+ * Copyright (c) 2013-2020 Martin Donath <martin.donath@squidfunk.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <check.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "message/common.h"
+#include "message/journal.h"
+#include "message/publisher.h"
+
+/* ----------------------------------------------------------------------------
+ * Helper functions
+ * ------------------------------------------------------------------------- */
+
+/*
+ * Acquire generations and assert that each one is consistent.
+ */
+static void *
+reader(void *data) {
+  pb_publisher_t *publisher = data;
+  for (size_t r = 0; r < 10000; r++) {
+    pb_journal_t journal = pb_publisher_acquire(publisher);
+    fail_unless(pb_journal_valid(&journal));
+
+    /* Assert that all bytes belong to the same generation */
+    const uint8_t *value = pb_journal_data(&journal);
+    for (size_t v = 1; v < pb_journal_size(&journal); v++)
+      ck_assert_uint_eq(value[0], value[v]);
+
+    /* Free all allocated memory */
+    pb_journal_destroy(&journal);
+  }
+  return NULL;
+}
+
+/* ----------------------------------------------------------------------------
+ * Tests
+ * ------------------------------------------------------------------------- */
+
+/*
+ * Create a publisher.
+ */
+START_TEST(test_create) {
+  pb_publisher_t publisher = pb_publisher_create();
+
+  /* Assert publisher generation */
+  ck_assert_uint_eq(0, pb_publisher_generation(&publisher));
+
+  /* Acquire generation and assert empty journal */
+  pb_journal_t journal = pb_publisher_acquire(&publisher);
+  fail_unless(pb_journal_valid(&journal));
+  fail_unless(pb_journal_empty(&journal));
+
+  /* Free all allocated memory */
+  pb_journal_destroy(&journal);
+  pb_publisher_destroy(&publisher);
+} END_TEST
+
+/*
+ * Publish a journal and acquire the current generation.
+ */
+START_TEST(test_publish) {
+  const uint8_t data[] = "SOME DATA";
+  const size_t  size   = 9;
+
+  /* Create journal and publisher */
+  pb_journal_t   journal   = pb_journal_create(data, size);
+  pb_publisher_t publisher = pb_publisher_create();
+
+  /* Publish journal and assert generation */
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_publisher_publish(&publisher, &journal));
+  ck_assert_uint_eq(1, pb_publisher_generation(&publisher));
+
+  /* Acquire generation and assert same contents and location */
+  pb_journal_t current = pb_publisher_acquire(&publisher);
+  ck_assert_uint_eq(size, pb_journal_size(&current));
+  fail_if(memcmp(data, pb_journal_data(&current), size));
+  ck_assert_ptr_eq(pb_journal_data(&journal), pb_journal_data(&current));
+
+  /* Free all allocated memory */
+  pb_journal_destroy(&current);
+  pb_publisher_destroy(&publisher);
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Write to a journal after publishing it.
+ */
+START_TEST(test_publish_write) {
+  const uint8_t data[] = "SOME DATA";
+  const size_t  size   = 9;
+
+  /* Create journal and publisher */
+  pb_journal_t   journal   = pb_journal_create(data, size);
+  pb_publisher_t publisher = pb_publisher_create();
+
+  /* Publish journal and acquire generation */
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_publisher_publish(&publisher, &journal));
+  pb_journal_t previous = pb_publisher_acquire(&publisher);
+
+  /* Update journal: "SOME DATA" => "SOME OTHER DATA" */
+  uint8_t new_data[] = "OTHER ";
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_journal_write(&journal, 5, 5, 5, new_data, 6));
+
+  /* Assert unchanged generation */
+  ck_assert_uint_eq(size, pb_journal_size(&previous));
+  fail_if(memcmp(data, pb_journal_data(&previous), size));
+
+  /* Publish journal again and acquire generation */
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_publisher_publish(&publisher, &journal));
+  ck_assert_uint_eq(2, pb_publisher_generation(&publisher));
+  pb_journal_t current = pb_publisher_acquire(&publisher);
+
+  /* Assert new contents in current generation only */
+  ck_assert_uint_eq(15, pb_journal_size(&current));
+  fail_if(memcmp("SOME OTHER DATA", pb_journal_data(&current), 15));
+  fail_if(memcmp(data, pb_journal_data(&previous), size));
+
+  /* Free all allocated memory */
+  pb_publisher_destroy(&publisher);
+  pb_journal_destroy(&journal);
+  pb_journal_destroy(&previous);
+  pb_journal_destroy(&current);
+} END_TEST
+
+/*
+ * Publish a journal while readers acquire generations concurrently.
+ */
+START_TEST(test_publish_concurrent) {
+  uint8_t data[] = "AAAAAAAAAAAAAAAA";
+  const size_t size = 16;
+
+  /* Create journal and publisher */
+  pb_journal_t   journal   = pb_journal_create(data, size);
+  pb_publisher_t publisher = pb_publisher_create();
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_publisher_publish(&publisher, &journal));
+
+  /* Start readers */
+  pthread_t threads[4];
+  for (size_t t = 0; t < 4; t++)
+    ck_assert_int_eq(0,
+      pthread_create(&(threads[t]), NULL, reader, &publisher));
+
+  /* Update and publish journal repeatedly */
+  for (size_t g = 0; g < 1000; g++) {
+    memset(data, 'A' + g % 26, size);
+    ck_assert_uint_eq(PB_ERROR_NONE,
+      pb_journal_write(&journal, 0, 0, size, data, size));
+    ck_assert_uint_eq(PB_ERROR_NONE,
+      pb_publisher_publish(&publisher, &journal));
+  }
+
+  /* Wait for readers */
+  for (size_t t = 0; t < 4; t++)
+    pthread_join(threads[t], NULL);
+  ck_assert_uint_eq(1001, pb_publisher_generation(&publisher));
+
+  /* Free all allocated memory */
+  pb_publisher_destroy(&publisher);
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Publish an invalid journal.
+ */
+START_TEST(test_publish_invalid) {
+  pb_journal_t   journal   = pb_journal_create_invalid();
+  pb_publisher_t publisher = pb_publisher_create();
+
+  /* Assert publisher error and unchanged generation */
+  ck_assert_uint_eq(PB_ERROR_ALLOC,
+    pb_publisher_publish(&publisher, &journal));
+  ck_assert_uint_eq(0, pb_publisher_generation(&publisher));
+
+  /* Free all allocated memory */
+  pb_publisher_destroy(&publisher);
+} END_TEST
+
+/* ----------------------------------------------------------------------------
+ * Program
+ * ------------------------------------------------------------------------- */
+
+/*
+ * Create a test suite for all registered test cases and run it.
+ *
+ * Tests must be run sequentially (in no-fork mode) or code coverage
+ * cannot be determined properly.
+ */
+int
+main(void) {
+  void *suite = suite_create("protobluff/message/publisher"),
+       *tcase = NULL;
+
+  /* Add tests to test case "create" */
+  tcase = tcase_create("create");
+  tcase_add_test(tcase, test_create);
+  suite_add_tcase(suite, tcase);
+
+  /* Add tests to test case "publish" */
+  tcase = tcase_create("publish");
+  tcase_add_test(tcase, test_publish);
+  tcase_add_test(tcase, test_publish_write);
+  tcase_add_test(tcase, test_publish_concurrent);
+  tcase_add_test(tcase, test_publish_invalid);
+  suite_add_tcase(suite, tcase);
+
+  /* Create a test suite runner in no-fork mode */
+  void *runner = srunner_create(suite);
+  srunner_set_fork_status(runner, CK_NOFORK);
+
+  /* Execute test suite runner */
+  srunner_run_all(runner, CK_NORMAL);
+  int failed = srunner_ntests_failed(runner);
+  srunner_free(runner);
+
+  /* Exit with status code */
+  return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
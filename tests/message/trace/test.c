@@ -0,0 +1,471 @@
+/*
+ * Copyright (c) 2013-2020 Martin Donath <martin.donath@squidfunk.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <check.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <protobluff/descriptor.h>
+
+#include "core/descriptor.h"
+#include "message/common.h"
+#include "message/cursor.h"
+#include "message/journal.h"
+#include "message/message.h"
+#include "message/trace.h"
+
+/* ----------------------------------------------------------------------------
+ * Descriptors
+ * ------------------------------------------------------------------------- */
+
+/* Descriptor */
+static pb_descriptor_t
+descriptor = { {
+  (const pb_field_descriptor_t []){
+    {  1, "F01", UINT32,  OPTIONAL },
+    {  2, "F02", STRING,  OPTIONAL },
+    {  3, "F03", MESSAGE, OPTIONAL, &descriptor },
+    {  4, "F04", UINT32,  REPEATED }
+  }, 4 } };
+
+/* ----------------------------------------------------------------------------
+ * Helper functions
+ * ------------------------------------------------------------------------- */
+
+/*
+ * Read the next record of a trace and assert its operation and offsets.
+ */
+static pb_trace_record_t
+next(const pb_trace_t *trace, size_t *offset,
+    pb_trace_operation_t operation, size_t message, pb_tag_t tag) {
+  const pb_buffer_t *buffer = pb_trace_buffer(trace);
+  pb_trace_record_t record;
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_trace_read(pb_buffer_data(buffer),
+    pb_buffer_size(buffer), offset, &record));
+  ck_assert_uint_eq(operation, record.operation);
+  ck_assert_uint_eq(message, record.message);
+  ck_assert_uint_eq(tag, record.tag);
+  return record;
+}
+
+/*
+ * Assert that all records of a trace were read.
+ */
+static void
+done(const pb_trace_t *trace, size_t *offset) {
+  const pb_buffer_t *buffer = pb_trace_buffer(trace);
+  pb_trace_record_t record;
+  ck_assert_uint_eq(PB_ERROR_EOM, pb_trace_read(pb_buffer_data(buffer),
+    pb_buffer_size(buffer), offset, &record));
+}
+
+/* ----------------------------------------------------------------------------
+ * Tests
+ * ------------------------------------------------------------------------- */
+
+/*
+ * Create a trace.
+ */
+START_TEST(test_create) {
+  pb_trace_t trace = pb_trace_create();
+
+  /* Assert trace validity and size */
+  fail_unless(pb_trace_valid(&trace));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_trace_error(&trace));
+  ck_assert_uint_eq(0, pb_trace_size(&trace));
+  ck_assert_uint_eq(0, pb_buffer_size(pb_trace_buffer(&trace)));
+
+  /* Free all allocated memory */
+  pb_trace_destroy(&trace);
+} END_TEST
+
+/*
+ * Attach a trace to a journal, recording a snapshot.
+ */
+START_TEST(test_snapshot) {
+  const uint8_t data[] = { 8, 1, 18, 4, 68, 65, 84, 65 };
+  const size_t  size   = 8;
+
+  /* Create journal and trace */
+  pb_journal_t journal = pb_journal_create_gap_buffer(data, size);
+  pb_trace_t   trace   = pb_trace_create();
+  pb_journal_set_unordered(&journal, 1);
+
+  /* Attach trace to journal */
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_journal_set_trace(&journal, &trace));
+  ck_assert_uint_eq(0, pb_trace_size(&trace));
+
+  /* Assert snapshot */
+  size_t offset = 0;
+  pb_trace_record_t record =
+    next(&trace, &offset, PB_TRACE_SNAPSHOT, 0, 0);
+  ck_assert_uint_eq(PB_TRACE_UNORDERED | PB_TRACE_GAP_BUFFER, record.field);
+  ck_assert_uint_eq(size, record.value.size);
+  fail_if(memcmp(data, record.value.data, size));
+  ck_assert_uint_eq(PB_ERROR_NONE, record.error);
+  ck_assert_uint_eq(size, record.size.before);
+  ck_assert_uint_eq(size, record.size.after);
+  done(&trace, &offset);
+
+  /* Free all allocated memory */
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_journal_set_trace(&journal, NULL));
+  pb_trace_destroy(&trace);
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Attach a trace to an invalid journal.
+ */
+START_TEST(test_snapshot_invalid) {
+  pb_journal_t journal = pb_journal_create_invalid();
+  pb_trace_t   trace   = pb_trace_create();
+
+  /* Assert trace is not attached */
+  ck_assert_uint_eq(PB_ERROR_INVALID, pb_journal_set_trace(&journal, &trace));
+  ck_assert_uint_eq(0, pb_buffer_size(pb_trace_buffer(&trace)));
+
+  /* Free all allocated memory */
+  pb_trace_destroy(&trace);
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Record values written to a message.
+ */
+START_TEST(test_put) {
+  const uint8_t data[] = { 8, 1 };
+  const size_t  size   = 2;
+
+  /* Create journal, trace and message */
+  pb_journal_t journal = pb_journal_create(data, size);
+  pb_trace_t   trace   = pb_trace_create();
+  pb_message_t message = pb_message_create(&descriptor, &journal);
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_journal_set_trace(&journal, &trace));
+
+  /* Write values to message */
+  uint32_t    number = 127;
+  pb_string_t string = pb_string_init_from_chars("DATA");
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_put(&message, 1, &number));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_put(&message, 2, &string));
+  ck_assert_uint_eq(2, pb_trace_size(&trace));
+
+  /* Assert record of number */
+  size_t offset = 0;
+  pb_trace_record_t record =
+    next(&trace, &offset, PB_TRACE_SNAPSHOT, 0, 0);
+  record = next(&trace, &offset, PB_TRACE_MESSAGE_PUT, 0, 1);
+  ck_assert_uint_eq(sizeof(number), record.value.size);
+  fail_if(memcmp(&number, record.value.data, sizeof(number)));
+  ck_assert_uint_eq(PB_ERROR_NONE, record.error);
+  ck_assert_uint_eq(2, record.size.before);
+  ck_assert_uint_eq(2, record.size.after);
+
+  /* Assert record of string */
+  record = next(&trace, &offset, PB_TRACE_MESSAGE_PUT, 0, 2);
+  ck_assert_uint_eq(4, record.value.size);
+  fail_if(memcmp("DATA", record.value.data, 4));
+  ck_assert_uint_eq(2, record.size.before);
+  ck_assert_uint_eq(8, record.size.after);
+  done(&trace, &offset);
+
+  /* Free all allocated memory */
+  pb_message_destroy(&message);
+  pb_trace_destroy(&trace);
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Record operations on a submessage.
+ */
+START_TEST(test_put_nested) {
+  pb_journal_t journal = pb_journal_create_empty();
+  pb_trace_t   trace   = pb_trace_create();
+  pb_message_t message = pb_message_create(&descriptor, &journal);
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_journal_set_trace(&journal, &trace));
+
+  /* Create submessage, write and erase a value */
+  uint32_t     value      = 1;
+  pb_message_t submessage = pb_message_create_within(&message, 3);
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_put(&submessage, 1, &value));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_erase(&submessage, 1));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_clear(&submessage));
+  ck_assert_uint_eq(4, pb_trace_size(&trace));
+
+  /* Assert records, omitting operations invoked from within others */
+  size_t offset = 0;
+  pb_trace_record_t record =
+    next(&trace, &offset, PB_TRACE_SNAPSHOT, 0, 0);
+  record = next(&trace, &offset, PB_TRACE_MESSAGE_CREATE, 0, 3);
+  ck_assert_uint_eq(0, record.size.before);
+  ck_assert_uint_eq(2, record.size.after);
+  record = next(&trace, &offset, PB_TRACE_MESSAGE_PUT, 2, 1);
+  ck_assert_uint_eq(4, record.size.after);
+  record = next(&trace, &offset, PB_TRACE_MESSAGE_ERASE, 2, 1);
+  ck_assert_uint_eq(0, record.value.size);
+  ck_assert_uint_eq(2, record.size.after);
+  record = next(&trace, &offset, PB_TRACE_MESSAGE_CLEAR, 2, 0);
+  ck_assert_uint_eq(0, record.size.after);
+  done(&trace, &offset);
+
+  /* Free all allocated memory */
+  pb_message_destroy(&submessage);
+  pb_message_destroy(&message);
+  pb_trace_destroy(&trace);
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Record an operation on a submessage with an outdated part.
+ */
+START_TEST(test_put_outdated) {
+  const uint8_t data[] = { 26, 2, 8, 1 };
+  const size_t  size   = 4;
+
+  /* Create journal, trace, message and submessage */
+  pb_journal_t journal    = pb_journal_create(data, size);
+  pb_trace_t   trace      = pb_trace_create();
+  pb_message_t message    = pb_message_create(&descriptor, &journal);
+  pb_message_t submessage = pb_message_create_within(&message, 3);
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_journal_set_trace(&journal, &trace));
+
+  /* Write value to message, outdating the submessage */
+  uint32_t value = 1;
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_put(&message, 1, &value));
+  pb_version_t version = pb_journal_version(&journal);
+  pb_part_t    part    = submessage.part;
+  fail_unless(part.version < version);
+
+  /* Write value to submessage */
+  value = 127;
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_put(&submessage, 1, &value));
+  ck_assert_uint_eq(2, pb_trace_size(&trace));
+
+  /* Assert records */
+  size_t offset = 0;
+  pb_trace_record_t record =
+    next(&trace, &offset, PB_TRACE_SNAPSHOT, 0, 0);
+  record = next(&trace, &offset, PB_TRACE_MESSAGE_PUT, 0, 1);
+  ck_assert_uint_eq(record.version, record.part.version);
+  record = next(&trace, &offset, PB_TRACE_MESSAGE_PUT, 4, 1);
+  ck_assert_uint_eq(version, record.version);
+  ck_assert_uint_eq(part.version, record.part.version);
+  ck_assert_uint_eq(part.offset.start, record.part.offset.start);
+  ck_assert_uint_eq(part.offset.end, record.part.offset.end);
+  ck_assert_int_eq(part.offset.diff.origin, record.part.offset.diff.origin);
+  ck_assert_int_eq(part.offset.diff.tag, record.part.offset.diff.tag);
+  ck_assert_int_eq(part.offset.diff.length, record.part.offset.diff.length);
+  done(&trace, &offset);
+
+  /* Free all allocated memory */
+  pb_message_destroy(&submessage);
+  pb_message_destroy(&message);
+  pb_trace_destroy(&trace);
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Record a submessage written to a message.
+ */
+START_TEST(test_put_message) {
+  const uint8_t data[] = { 8, 1 };
+  const size_t  size   = 2;
+
+  /* Create journals, trace and messages */
+  pb_journal_t journal1 = pb_journal_create_empty();
+  pb_journal_t journal2 = pb_journal_create(data, size);
+  pb_trace_t   trace    = pb_trace_create();
+  pb_message_t message1 = pb_message_create(&descriptor, &journal1);
+  pb_message_t message2 = pb_message_create(&descriptor, &journal2);
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_journal_set_trace(&journal1, &trace));
+
+  /* Write submessage to message */
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_put(&message1, 3, &message2));
+  ck_assert_uint_eq(1, pb_trace_size(&trace));
+
+  /* Assert record of raw data of submessage */
+  size_t offset = 0;
+  pb_trace_record_t record =
+    next(&trace, &offset, PB_TRACE_SNAPSHOT, 0, 0);
+  record = next(&trace, &offset, PB_TRACE_MESSAGE_PUT, 0, 3);
+  ck_assert_uint_eq(size, record.value.size);
+  fail_if(memcmp(data, record.value.data, size));
+  ck_assert_uint_eq(4, record.size.after);
+  done(&trace, &offset);
+
+  /* Free all allocated memory */
+  pb_message_destroy(&message2);
+  pb_message_destroy(&message1);
+  pb_trace_destroy(&trace);
+  pb_journal_destroy(&journal2);
+  pb_journal_destroy(&journal1);
+} END_TEST
+
+/*
+ * Record operations on the current field of a cursor.
+ */
+START_TEST(test_cursor) {
+  const uint8_t data[] = { 32, 1, 32, 2, 32, 3 };
+  const size_t  size   = 6;
+
+  /* Create journal, trace, message and cursor */
+  pb_journal_t journal = pb_journal_create(data, size);
+  pb_trace_t   trace   = pb_trace_create();
+  pb_message_t message = pb_message_create(&descriptor, &journal);
+  pb_cursor_t  cursor  = pb_cursor_create(&message, 4);
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_journal_set_trace(&journal, &trace));
+
+  /* Write and erase second value */
+  uint32_t value = 127;
+  fail_unless(pb_cursor_next(&cursor));
+  size_t field = pb_cursor_offset(&cursor)->start;
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_cursor_put(&cursor, &value));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_cursor_erase(&cursor));
+  ck_assert_uint_eq(2, pb_trace_size(&trace));
+
+  /* Assert records */
+  size_t offset = 0;
+  pb_trace_record_t record =
+    next(&trace, &offset, PB_TRACE_SNAPSHOT, 0, 0);
+  record = next(&trace, &offset, PB_TRACE_CURSOR_PUT, 0, 4);
+  ck_assert_uint_eq(field, record.field);
+  ck_assert_uint_eq(sizeof(value), record.value.size);
+  fail_if(memcmp(&value, record.value.data, sizeof(value)));
+  record = next(&trace, &offset, PB_TRACE_CURSOR_ERASE, 0, 4);
+  ck_assert_uint_eq(field, record.field);
+  ck_assert_uint_eq(6, record.size.before);
+  ck_assert_uint_eq(4, record.size.after);
+  done(&trace, &offset);
+
+  /* Free all allocated memory */
+  pb_cursor_destroy(&cursor);
+  pb_message_destroy(&message);
+  pb_trace_destroy(&trace);
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Detach a trace from a journal.
+ */
+START_TEST(test_detach) {
+  pb_journal_t journal = pb_journal_create_empty();
+  pb_trace_t   trace   = pb_trace_create();
+  pb_message_t message = pb_message_create(&descriptor, &journal);
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_journal_set_trace(&journal, &trace));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_journal_set_trace(&journal, NULL));
+
+  /* Assert write is not recorded */
+  uint32_t value = 1;
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_message_put(&message, 1, &value));
+  ck_assert_uint_eq(0, pb_trace_size(&trace));
+
+  /* Free all allocated memory */
+  pb_message_destroy(&message);
+  pb_trace_destroy(&trace);
+  pb_journal_destroy(&journal);
+} END_TEST
+
+/*
+ * Read records from invalid raw data.
+ */
+START_TEST(test_read_invalid) {
+  const uint8_t data[] = { PB_TRACE_OPERATIONS, 0, 0, 0, 0, 0, 0, 0 };
+  const uint8_t trunc[] = { PB_TRACE_MESSAGE_PUT, 0, 1, 0, 4, 1, 2 };
+
+  /* Assert unknown operation and truncated records */
+  pb_trace_record_t record;
+  size_t offset = 0;
+  ck_assert_uint_eq(PB_ERROR_INVALID, pb_trace_read(data, 8,
+    &offset, &record));
+  ck_assert_uint_eq(PB_ERROR_INVALID, pb_trace_read(trunc, 7,
+    &offset, &record));
+  ck_assert_uint_eq(PB_ERROR_INVALID, pb_trace_read(trunc, 3,
+    &offset, &record));
+  ck_assert_uint_eq(0, offset);
+
+  /* Assert end of trace */
+  offset = 7;
+  ck_assert_uint_eq(PB_ERROR_EOM, pb_trace_read(trunc, 7,
+    &offset, &record));
+} END_TEST
+
+/* ----------------------------------------------------------------------------
+ * Program
+ * ------------------------------------------------------------------------- */
+
+/*
+ * Create a test suite for all registered test cases and run it.
+ *
+ * Tests must be run sequentially (in no-fork mode) or code coverage
+ * cannot be determined properly.
+ */
+int
+main(void) {
+  void *suite = suite_create("protobluff/message/trace"),
+       *tcase = NULL;
+
+  /* Add tests to test case "create" */
+  tcase = tcase_create("create");
+  tcase_add_test(tcase, test_create);
+  suite_add_tcase(suite, tcase);
+
+  /* Add tests to test case "snapshot" */
+  tcase = tcase_create("snapshot");
+  tcase_add_test(tcase, test_snapshot);
+  tcase_add_test(tcase, test_snapshot_invalid);
+  suite_add_tcase(suite, tcase);
+
+  /* Add tests to test case "put" */
+  tcase = tcase_create("put");
+  tcase_add_test(tcase, test_put);
+  tcase_add_test(tcase, test_put_nested);
+  tcase_add_test(tcase, test_put_outdated);
+  tcase_add_test(tcase, test_put_message);
+  suite_add_tcase(suite, tcase);
+
+  /* Add tests to test case "cursor" */
+  tcase = tcase_create("cursor");
+  tcase_add_test(tcase, test_cursor);
+  suite_add_tcase(suite, tcase);
+
+  /* Add tests to test case "detach" */
+  tcase = tcase_create("detach");
+  tcase_add_test(tcase, test_detach);
+  suite_add_tcase(suite, tcase);
+
+  /* Add tests to test case "read" */
+  tcase = tcase_create("read");
+  tcase_add_test(tcase, test_read_invalid);
+  suite_add_tcase(suite, tcase);
+
+  /* Create a test suite runner in no-fork mode */
+  void *runner = srunner_create(suite);
+  srunner_set_fork_status(runner, CK_NOFORK);
+
+  /* Execute test suite runner */
+  srunner_run_all(runner, CK_NORMAL);
+  int failed = srunner_ntests_failed(runner);
+  srunner_free(runner);
+
+  /* Exit with status code */
+  return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,269 @@
+/*
+ * Copyright (c) 2013-2020 Martin Donath <martin.donath@squidfunk.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <check.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "core/common.h"
+#include "util/arena_allocator.h"
+
+/* ----------------------------------------------------------------------------
+ * Tests
+ * ------------------------------------------------------------------------- */
+
+/*
+ * Create an arena allocator.
+ */
+START_TEST(test_create) {
+  pb_allocator_t allocator = pb_arena_allocator_create(1024);
+  ck_assert_ptr_ne(NULL, allocator.data);
+  pb_arena_allocator_destroy(&allocator);
+} END_TEST
+
+/*
+ * Allocate a memory block of given size.
+ */
+START_TEST(test_allocate) {
+  pb_allocator_t allocator = pb_arena_allocator_create(1024);
+
+  /* Allocate a block */
+  void *block1 = pb_allocator_allocate(&allocator, 10);
+  ck_assert_ptr_ne(NULL, block1);
+
+  /* Allocate another block */
+  void *block2 = pb_allocator_allocate(&allocator, 10);
+  ck_assert_ptr_ne(NULL, block2);
+
+  /* Assert different, subsequent and aligned blocks */
+  ck_assert_uint_eq(32, (uint8_t *)block2 - (uint8_t *)block1);
+  ck_assert_uint_eq(0, (uintptr_t)block1 % 16);
+  ck_assert_uint_eq(0, (uintptr_t)block2 % 16);
+
+  /* Free all allocated memory */
+  pb_arena_allocator_destroy(&allocator);
+} END_TEST
+
+/*
+ * Allocate memory blocks exceeding the capacity of a region.
+ */
+START_TEST(test_allocate_exceeding) {
+  pb_allocator_t allocator = pb_arena_allocator_create(64);
+
+  /* Allocate blocks exceeding the region */
+  void *block[8];
+  for (size_t b = 0; b < 8; b++) {
+    block[b] = pb_allocator_allocate(&allocator, 24);
+    ck_assert_ptr_ne(NULL, block[b]);
+    memset(block[b], (int)b, 24);
+  }
+
+  /* Allocate a block larger than a region */
+  void *large = pb_allocator_allocate(&allocator, 1024);
+  ck_assert_ptr_ne(NULL, large);
+  memset(large, 0xFF, 1024);
+
+  /* Assert blocks were not overwritten */
+  for (size_t b = 0; b < 8; b++)
+    ck_assert_uint_eq(b, ((uint8_t *)block[b])[23]);
+
+  /* Free all allocated memory */
+  pb_arena_allocator_destroy(&allocator);
+} END_TEST
+
+/*
+ * Allocate a memory block of given size for an invalid allocator.
+ */
+START_TEST(test_allocate_invalid) {
+  pb_allocator_t allocator = pb_arena_allocator_create(1024);
+  pb_allocator_t allocator_invalid = {
+    .proc = {
+      .allocate = allocator.proc.allocate,
+      .resize   = allocator.proc.resize,
+      .free     = allocator.proc.free
+    },
+    .data = NULL
+  };
+
+  /* Try to allocate blocks */
+  ck_assert_ptr_eq(NULL, pb_allocator_allocate(&allocator_invalid, 16));
+  ck_assert_ptr_eq(NULL, pb_allocator_resize(&allocator_invalid, NULL, 16));
+
+  /* Free all allocated memory */
+  pb_arena_allocator_destroy(&allocator);
+} END_TEST
+
+/*
+ * Resize the most recently allocated memory block in place.
+ */
+START_TEST(test_resize) {
+  pb_allocator_t allocator = pb_arena_allocator_create(1024);
+
+  /* Allocate a block */
+  void *block = pb_allocator_resize(&allocator, NULL, 16);
+  ck_assert_ptr_ne(NULL, block);
+
+  /* Resize the block */
+  ck_assert_ptr_eq(block, pb_allocator_resize(&allocator, block, 128));
+  ck_assert_ptr_eq(block, pb_allocator_resize(&allocator, block, 8));
+
+  /* Assert next block follows the resized block */
+  void *next = pb_allocator_allocate(&allocator, 16);
+  ck_assert_uint_eq(32, (uint8_t *)next - (uint8_t *)block);
+
+  /* Free all allocated memory */
+  pb_arena_allocator_destroy(&allocator);
+} END_TEST
+
+/*
+ * Resize a memory block which is not the most recently allocated one.
+ */
+START_TEST(test_resize_move) {
+  pb_allocator_t allocator = pb_arena_allocator_create(1024);
+
+  /* Allocate blocks */
+  uint8_t *block1 = pb_allocator_allocate(&allocator, 16);
+  uint8_t *block2 = pb_allocator_allocate(&allocator, 16);
+  ck_assert_ptr_ne(NULL, block1);
+  ck_assert_ptr_ne(NULL, block2);
+  memset(block1, 42, 16);
+
+  /* Shrink and grow the first block */
+  ck_assert_ptr_eq(block1, pb_allocator_resize(&allocator, block1, 8));
+  uint8_t *block3 = pb_allocator_resize(&allocator, block1, 2048);
+  ck_assert_ptr_ne(NULL, block3);
+  ck_assert_ptr_ne(block1, block3);
+
+  /* Assert copied contents */
+  ck_assert_uint_eq(42, block3[0]);
+  ck_assert_uint_eq(42, block3[7]);
+
+  /* Free all allocated memory */
+  pb_arena_allocator_destroy(&allocator);
+} END_TEST
+
+/*
+ * Free an allocated memory block.
+ */
+START_TEST(test_free) {
+  pb_allocator_t allocator = pb_arena_allocator_create(1024);
+
+  /* Allocate and free a block */
+  void *block = pb_allocator_allocate(&allocator, 16);
+  ck_assert_ptr_ne(NULL, block);
+  pb_allocator_free(&allocator, block);
+
+  /* Free all allocated memory */
+  pb_arena_allocator_destroy(&allocator);
+} END_TEST
+
+/*
+ * Reset an arena allocator.
+ */
+START_TEST(test_reset) {
+  pb_allocator_t allocator = pb_arena_allocator_create(64);
+
+  /* Allocate blocks spanning multiple regions */
+  void *block = pb_allocator_allocate(&allocator, 16);
+  ck_assert_ptr_ne(NULL, block);
+  for (size_t b = 0; b < 8; b++)
+    ck_assert_ptr_ne(NULL, pb_allocator_allocate(&allocator, 16));
+
+  /* Reset allocator and allocate again */
+  pb_arena_allocator_reset(&allocator);
+  void *first = pb_allocator_allocate(&allocator, 16);
+  ck_assert_ptr_ne(NULL, first);
+  pb_arena_allocator_reset(&allocator);
+  ck_assert_ptr_eq(first, pb_allocator_allocate(&allocator, 16));
+
+  /* Free all allocated memory */
+  pb_arena_allocator_destroy(&allocator);
+} END_TEST
+
+/*
+ * Reset an invalid arena allocator.
+ */
+START_TEST(test_reset_invalid) {
+  pb_allocator_t allocator = {
+    .data = NULL
+  };
+  pb_arena_allocator_reset(&allocator);
+  pb_arena_allocator_destroy(&allocator);
+} END_TEST
+
+/* ----------------------------------------------------------------------------
+ * Program
+ * ------------------------------------------------------------------------- */
+
+/*
+ * Create a test suite for all registered test cases and run it.
+ *
+ * Tests must be run sequentially (in no-fork mode) or code coverage
+ * cannot be determined properly.
+ */
+int
+main(void) {
+  void *suite = suite_create("protobluff/util/arena_allocator"),
+       *tcase = NULL;
+
+  /* Add tests to test case "create" */
+  tcase = tcase_create("create");
+  tcase_add_test(tcase, test_create);
+  suite_add_tcase(suite, tcase);
+
+  /* Add tests to test case "allocate" */
+  tcase = tcase_create("allocate");
+  tcase_add_test(tcase, test_allocate);
+  tcase_add_test(tcase, test_allocate_exceeding);
+  tcase_add_test(tcase, test_allocate_invalid);
+  suite_add_tcase(suite, tcase);
+
+  /* Add tests to test case "resize" */
+  tcase = tcase_create("resize");
+  tcase_add_test(tcase, test_resize);
+  tcase_add_test(tcase, test_resize_move);
+  suite_add_tcase(suite, tcase);
+
+  /* Add tests to test case "free" */
+  tcase = tcase_create("free");
+  tcase_add_test(tcase, test_free);
+  suite_add_tcase(suite, tcase);
+
+  /* Add tests to test case "reset" */
+  tcase = tcase_create("reset");
+  tcase_add_test(tcase, test_reset);
+  tcase_add_test(tcase, test_reset_invalid);
+  suite_add_tcase(suite, tcase);
+
+  /* Create a test suite runner in no-fork mode */
+  void *runner = srunner_create(suite);
+  srunner_set_fork_status(runner, CK_NOFORK);
+
+  /* Execute test suite runner */
+  srunner_run_all(runner, CK_NORMAL);
+  int failed = srunner_ntests_failed(runner);
+  srunner_free(runner);
+
+  /* Exit with status code */
+  return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -232,6 +232,73 @@ START_TEST(test_free_invalid) {
   pb_chunk_allocator_destroy(&allocator);
 } END_TEST
 
+/*
+ * Reuse a freed memory block of the same size class.
+ */
+START_TEST(test_free_reuse) {
+  pb_allocator_t allocator = pb_chunk_allocator_create_with_capacity(16);
+
+  /* Allocate and free a block */
+  void *block1 = pb_allocator_allocate(&allocator, 24);
+  ck_assert_ptr_ne(NULL, block1);
+  pb_allocator_free(&allocator, block1);
+
+  /* Allocate a block of the same size class */
+  void *block2 = pb_allocator_allocate(&allocator, 20);
+  ck_assert_ptr_eq(block1, block2);
+
+  /* Free all allocated memory */
+  pb_chunk_allocator_destroy(&allocator);
+} END_TEST
+
+/*
+ * Retrieve statistics of a chunk allocator.
+ */
+START_TEST(test_stats) {
+  pb_allocator_t allocator = pb_chunk_allocator_create_with_capacity(16);
+
+  /* Allocate blocks */
+  void *block1 = pb_allocator_allocate(&allocator, 8);
+  void *block2 = pb_allocator_allocate(&allocator, 8);
+  ck_assert_ptr_ne(NULL, block1);
+  ck_assert_ptr_ne(NULL, block2);
+
+  /* Resize the second block */
+  block2 = pb_allocator_resize(&allocator, block2, 40);
+  ck_assert_ptr_ne(NULL, block2);
+
+  /* Assert statistics */
+  pb_chunk_allocator_stats_t stats = pb_chunk_allocator_stats(&allocator);
+  ck_assert_uint_eq(2, stats.chunks);
+  ck_assert_uint_eq(64, stats.bytes);
+  ck_assert_uint_eq(0, stats.cached);
+  ck_assert_uint_eq(2, stats.allocations);
+
+  /* Free the first block and assert statistics */
+  pb_allocator_free(&allocator, block1);
+  stats = pb_chunk_allocator_stats(&allocator);
+  ck_assert_uint_eq(1, stats.chunks);
+  ck_assert_uint_eq(48, stats.bytes);
+  ck_assert_uint_eq(1, stats.cached);
+
+  /* Free all allocated memory */
+  pb_chunk_allocator_destroy(&allocator);
+} END_TEST
+
+/*
+ * Retrieve statistics of an invalid chunk allocator.
+ */
+START_TEST(test_stats_invalid) {
+  pb_allocator_t allocator = {
+    .data = NULL
+  };
+
+  /* Assert statistics */
+  pb_chunk_allocator_stats_t stats = pb_chunk_allocator_stats(&allocator);
+  ck_assert_uint_eq(0, stats.chunks);
+  ck_assert_uint_eq(0, stats.bytes);
+} END_TEST
+
 /* ----------------------------------------------------------------------------
  * Program
  * ------------------------------------------------------------------------- */
@@ -271,6 +338,13 @@ main(void) {
   tcase_add_test(tcase, test_free);
   tcase_add_test(tcase, test_free_unordered);
   tcase_add_test(tcase, test_free_invalid);
+  tcase_add_test(tcase, test_free_reuse);
+  suite_add_tcase(suite, tcase);
+
+  /* Add tests to test case "stats" */
+  tcase = tcase_create("stats");
+  tcase_add_test(tcase, test_stats);
+  tcase_add_test(tcase, test_stats_invalid);
   suite_add_tcase(suite, tcase);
 
   /* Create a test suite runner in no-fork mode */
@@ -0,0 +1,458 @@
+/*
+ * Copyright (c) 2013-2020 Martin Donath <martin.donath@squidfunk.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#define _GNU_SOURCE
+
+#include <check.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "core/buffer.h"
+#include "core/common.h"
+#include "core/delimited.h"
+#include "util/delimited_block.h"
+#include "util/mmap.h"
+
+/* ----------------------------------------------------------------------------
+ * Helper functions
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Compress data with run-length encoding.
+ *
+ * \param[in]  data     Internal codec data
+ * \param[in]  source[] Raw data
+ * \param[in]  size     Raw data size
+ * \param[out] target[] Target buffer
+ * \param[in]  capacity Target buffer capacity
+ * \return              Compressed size, 0 if it does not fit
+ */
+static size_t
+rle_compress(
+    void *data, const uint8_t source[], size_t size,
+    uint8_t target[], size_t capacity) {
+  size_t length = 0;
+  for (size_t s = 0; s < size; ) {
+    size_t run = 1;
+    while (s + run < size && run < 255 && source[s + run] == source[s])
+      run++;
+    if (length + 2 > capacity)
+      return 0;
+    target[length++] = (uint8_t)run;
+    target[length++] = source[s];
+    s += run;
+  }
+  return length;
+}
+
+/*!
+ * Decompress run-length encoded data.
+ *
+ * \param[in]  data     Internal codec data
+ * \param[in]  source[] Compressed data
+ * \param[in]  size     Compressed data size
+ * \param[out] target[] Target buffer
+ * \param[in]  capacity Target buffer capacity
+ * \return              Raw size
+ */
+static size_t
+rle_decompress(
+    void *data, const uint8_t source[], size_t size,
+    uint8_t target[], size_t capacity) {
+  size_t length = 0;
+  for (size_t s = 0; s + 1 < size; s += 2) {
+    if (length + source[s] > capacity)
+      return 0;
+    memset(&(target[length]), source[s + 1], source[s]);
+    length += source[s];
+  }
+  return length;
+}
+
+/*!
+ * Refuse to compress data.
+ *
+ * \param[in]  data     Internal codec data
+ * \param[in]  source[] Raw data
+ * \param[in]  size     Raw data size
+ * \param[out] target[] Target buffer
+ * \param[in]  capacity Target buffer capacity
+ * \return              Compressed size
+ */
+static size_t
+none_compress(
+    void *data, const uint8_t source[], size_t size,
+    uint8_t target[], size_t capacity) {
+  return 0;
+}
+
+/*! Run-length codec */
+static const pb_delimited_block_codec_t
+rle = {
+  .proc = {
+    .compress   = rle_compress,
+    .decompress = rle_decompress
+  }
+};
+
+/*! Codec that never compresses */
+static const pb_delimited_block_codec_t
+none = {
+  .proc = {
+    .compress   = none_compress,
+    .decompress = rle_decompress
+  }
+};
+
+/*!
+ * Create a block-compressed file of messages, each repeating its number.
+ *
+ * \param[out] path      Path
+ * \param[in]  codec     Codec, NULL if none
+ * \param[in]  count     Message count
+ * \param[in]  threshold Raw block size threshold
+ */
+static void
+file_create(
+    char path[], const pb_delimited_block_codec_t *codec,
+    size_t count, size_t threshold) {
+  strcpy(path, "/tmp/protobluff-XXXXXX");
+  int fd = mkstemp(path);
+  fail_if(fd < 0);
+
+  /* Write messages */
+  pb_delimited_block_writer_t writer =
+    pb_delimited_block_writer_create(fd, codec, threshold);
+  for (size_t m = 0; m < count; m++) {
+    uint8_t data[16];
+    memset(data, (uint8_t)m, sizeof(data));
+    pb_buffer_t message = pb_buffer_create(data, sizeof(data));
+    ck_assert_uint_eq(PB_ERROR_NONE,
+      pb_delimited_block_writer_write(&writer, &message));
+    pb_buffer_destroy(&message);
+  }
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_delimited_block_writer_finish(&writer));
+  pb_delimited_block_writer_destroy(&writer);
+  close(fd);
+}
+
+/*!
+ * Assert that a message repeats the given number.
+ *
+ * \param[in] message Message
+ * \param[in] number  Message number
+ */
+static void
+message_check(const pb_buffer_t *message, size_t number) {
+  ck_assert_uint_eq(16, pb_buffer_size(message));
+  for (size_t b = 0; b < 16; b++)
+    ck_assert_uint_eq((uint8_t)number, pb_buffer_data(message)[b]);
+}
+
+/* ----------------------------------------------------------------------------
+ * Tests
+ * ------------------------------------------------------------------------- */
+
+/*
+ * Write compressed blocks and read all of them.
+ */
+START_TEST(test_read) {
+  char path[32];
+  file_create(path, &rle, 100, 64);
+
+  /* Map file and create reader */
+  pb_buffer_t buffer = pb_buffer_create_mmap(path, PB_MMAP_RANDOM);
+  pb_delimited_block_reader_t reader =
+    pb_delimited_block_reader_create(&buffer, &rle);
+  fail_unless(pb_delimited_block_reader_valid(&reader));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_delimited_block_reader_error(&reader));
+  ck_assert_uint_eq(25, pb_delimited_block_reader_size(&reader));
+  ck_assert_uint_eq(100, pb_delimited_block_reader_records(&reader));
+
+  /* Compressed blocks must be smaller than raw ones */
+  fail_unless(pb_buffer_size(&buffer) < 100 * 17);
+
+  /* Read all blocks, each with its own buffer */
+  size_t number = 0;
+  for (size_t b = 0; b < pb_delimited_block_reader_size(&reader); b++) {
+    ck_assert_uint_eq(number, pb_delimited_block_reader_first(&reader, b));
+    pb_buffer_t scratch = pb_buffer_create_empty(), data;
+    ck_assert_uint_eq(PB_ERROR_NONE,
+      pb_delimited_block_reader_read(&reader, b, &scratch, &data));
+    ck_assert_ptr_eq(pb_buffer_data(&scratch), pb_buffer_data(&data));
+
+    /* Read messages of block */
+    pb_delimited_reader_t delimited = pb_delimited_reader_create(&data);
+    pb_buffer_t message;
+    while (!pb_delimited_reader_next(&delimited, &message))
+      message_check(&message, number++);
+    pb_delimited_reader_destroy(&delimited);
+    pb_buffer_destroy(&data);
+    pb_buffer_destroy(&scratch);
+  }
+  ck_assert_uint_eq(100, number);
+
+  /* Read beyond last block */
+  pb_buffer_t scratch = pb_buffer_create_empty(), data;
+  ck_assert_uint_eq(PB_ERROR_OFFSET,
+    pb_delimited_block_reader_read(&reader, 25, &scratch, &data));
+
+  /* Free all allocated memory */
+  pb_buffer_destroy(&scratch);
+  pb_delimited_block_reader_destroy(&reader);
+  pb_buffer_destroy(&buffer);
+  unlink(path);
+} END_TEST
+
+/*
+ * Read stored blocks without copying.
+ */
+START_TEST(test_read_stored) {
+  char path[32];
+  file_create(path, NULL, 10, 32);
+
+  /* Map file and create reader */
+  pb_buffer_t buffer = pb_buffer_create_mmap(path, PB_MMAP_RANDOM);
+  pb_delimited_block_reader_t reader =
+    pb_delimited_block_reader_create(&buffer, NULL);
+  fail_unless(pb_delimited_block_reader_valid(&reader));
+  ck_assert_uint_eq(5, pb_delimited_block_reader_size(&reader));
+
+  /* Read block from mapped file */
+  pb_buffer_t scratch = pb_buffer_create_empty(), data;
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_delimited_block_reader_read(&reader, 2, &scratch, &data));
+  fail_unless(pb_buffer_data(&data) > pb_buffer_data(&buffer));
+  fail_unless(pb_buffer_data(&data) < pb_buffer_data(&buffer) +
+    pb_buffer_size(&buffer));
+  ck_assert_uint_eq(2 * 17, pb_buffer_size(&data));
+  ck_assert_uint_eq(0, pb_buffer_size(&scratch));
+
+  /* Free all allocated memory */
+  pb_buffer_destroy(&data);
+  pb_buffer_destroy(&scratch);
+  pb_delimited_block_reader_destroy(&reader);
+  pb_buffer_destroy(&buffer);
+  unlink(path);
+} END_TEST
+
+/*
+ * Store blocks that do not shrink upon compression.
+ */
+START_TEST(test_read_incompressible) {
+  char path[32];
+  file_create(path, &none, 10, 32);
+
+  /* Map file and create reader without codec */
+  pb_buffer_t buffer = pb_buffer_create_mmap(path, PB_MMAP_RANDOM);
+  pb_delimited_block_reader_t reader =
+    pb_delimited_block_reader_create(&buffer, NULL);
+  fail_unless(pb_delimited_block_reader_valid(&reader));
+
+  /* Read messages of last block */
+  pb_buffer_t scratch = pb_buffer_create_empty(), data, message;
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_delimited_block_reader_read(&reader, 4, &scratch, &data));
+  pb_delimited_reader_t delimited = pb_delimited_reader_create(&data);
+  for (size_t m = 8; m < 10; m++) {
+    ck_assert_uint_eq(PB_ERROR_NONE,
+      pb_delimited_reader_next(&delimited, &message));
+    message_check(&message, m);
+  }
+  ck_assert_uint_eq(PB_ERROR_EOM,
+    pb_delimited_reader_next(&delimited, &message));
+
+  /* Free all allocated memory */
+  pb_delimited_reader_destroy(&delimited);
+  pb_buffer_destroy(&data);
+  pb_buffer_destroy(&scratch);
+  pb_delimited_block_reader_destroy(&reader);
+  pb_buffer_destroy(&buffer);
+  unlink(path);
+} END_TEST
+
+/*
+ * Read compressed blocks without codec.
+ */
+START_TEST(test_read_codec) {
+  char path[32];
+  file_create(path, &rle, 10, 32);
+
+  /* Map file and create reader without codec */
+  pb_buffer_t buffer = pb_buffer_create_mmap(path, PB_MMAP_RANDOM);
+  pb_delimited_block_reader_t reader =
+    pb_delimited_block_reader_create(&buffer, NULL);
+  fail_unless(pb_delimited_block_reader_valid(&reader));
+
+  /* Read block */
+  pb_buffer_t scratch = pb_buffer_create_empty(), data;
+  ck_assert_uint_eq(PB_ERROR_INVALID,
+    pb_delimited_block_reader_read(&reader, 0, &scratch, &data));
+
+  /* Free all allocated memory */
+  pb_buffer_destroy(&scratch);
+  pb_delimited_block_reader_destroy(&reader);
+  pb_buffer_destroy(&buffer);
+  unlink(path);
+} END_TEST
+
+/*
+ * Seek to every message in reverse order.
+ */
+START_TEST(test_seek) {
+  char path[32];
+  file_create(path, &rle, 50, 100);
+
+  /* Map file and create reader */
+  pb_buffer_t buffer = pb_buffer_create_mmap(path, PB_MMAP_RANDOM);
+  pb_delimited_block_reader_t reader =
+    pb_delimited_block_reader_create(&buffer, &rle);
+  fail_unless(pb_delimited_block_reader_valid(&reader));
+  ck_assert_uint_eq(9, pb_delimited_block_reader_size(&reader));
+
+  /* Seek to messages */
+  pb_buffer_t scratch = pb_buffer_create_empty(), message;
+  pb_delimited_reader_t delimited;
+  for (size_t m = 50; m; m--) {
+    ck_assert_uint_eq((m - 1) / 6,
+      pb_delimited_block_reader_find(&reader, m - 1));
+    ck_assert_uint_eq(PB_ERROR_NONE,
+      pb_delimited_block_reader_seek(&reader, m - 1, &scratch, &delimited));
+    ck_assert_uint_eq(PB_ERROR_NONE,
+      pb_delimited_reader_next(&delimited, &message));
+    message_check(&message, m - 1);
+    pb_delimited_reader_destroy(&delimited);
+  }
+
+  /* Seek beyond last message */
+  ck_assert_uint_eq(9, pb_delimited_block_reader_find(&reader, 50));
+  ck_assert_uint_eq(PB_ERROR_OFFSET,
+    pb_delimited_block_reader_seek(&reader, 50, &scratch, &delimited));
+
+  /* Free all allocated memory */
+  pb_buffer_destroy(&scratch);
+  pb_delimited_block_reader_destroy(&reader);
+  pb_buffer_destroy(&buffer);
+  unlink(path);
+} END_TEST
+
+/*
+ * Seek within an empty file.
+ */
+START_TEST(test_seek_empty) {
+  char path[32];
+  file_create(path, &rle, 0, 64);
+
+  /* Map file and create reader */
+  pb_buffer_t buffer = pb_buffer_create_mmap(path, PB_MMAP_RANDOM);
+  pb_delimited_block_reader_t reader =
+    pb_delimited_block_reader_create(&buffer, &rle);
+  fail_unless(pb_delimited_block_reader_valid(&reader));
+  ck_assert_uint_eq(0, pb_delimited_block_reader_size(&reader));
+  ck_assert_uint_eq(0, pb_delimited_block_reader_records(&reader));
+
+  /* Seek to message */
+  pb_buffer_t scratch = pb_buffer_create_empty();
+  pb_delimited_reader_t delimited;
+  ck_assert_uint_eq(PB_ERROR_OFFSET,
+    pb_delimited_block_reader_seek(&reader, 0, &scratch, &delimited));
+
+  /* Free all allocated memory */
+  pb_buffer_destroy(&scratch);
+  pb_delimited_block_reader_destroy(&reader);
+  pb_buffer_destroy(&buffer);
+  unlink(path);
+} END_TEST
+
+/*
+ * Create a reader over an invalid file.
+ */
+START_TEST(test_create_invalid) {
+  const uint8_t data[] = "SOME DATA THAT IS NOT A BLOCK-COMPRESSED FILE";
+  pb_buffer_t buffer = pb_buffer_create(data, sizeof(data));
+
+  /* Create reader */
+  pb_delimited_block_reader_t reader =
+    pb_delimited_block_reader_create(&buffer, &rle);
+  fail_if(pb_delimited_block_reader_valid(&reader));
+
+  /* Read block */
+  pb_buffer_t scratch = pb_buffer_create_empty(), message;
+  ck_assert_uint_eq(PB_ERROR_INVALID,
+    pb_delimited_block_reader_read(&reader, 0, &scratch, &message));
+
+  /* Free all allocated memory */
+  pb_buffer_destroy(&scratch);
+  pb_delimited_block_reader_destroy(&reader);
+  pb_buffer_destroy(&buffer);
+} END_TEST
+
+/* ----------------------------------------------------------------------------
+ * Program
+ * ------------------------------------------------------------------------- */
+
+/*
+ * Create a test suite for all registered test cases and run it.
+ *
+ * Tests must be run sequentially (in no-fork mode) or code coverage
+ * cannot be determined properly.
+ */
+int
+main(void) {
+  void *suite = suite_create("protobluff/util/delimited_block"),
+       *tcase = NULL;
+
+  /* Add tests to test case "create" */
+  tcase = tcase_create("create");
+  tcase_add_test(tcase, test_create_invalid);
+  suite_add_tcase(suite, tcase);
+
+  /* Add tests to test case "read" */
+  tcase = tcase_create("read");
+  tcase_add_test(tcase, test_read);
+  tcase_add_test(tcase, test_read_stored);
+  tcase_add_test(tcase, test_read_incompressible);
+  tcase_add_test(tcase, test_read_codec);
+  suite_add_tcase(suite, tcase);
+
+  /* Add tests to test case "seek" */
+  tcase = tcase_create("seek");
+  tcase_add_test(tcase, test_seek);
+  tcase_add_test(tcase, test_seek_empty);
+  suite_add_tcase(suite, tcase);
+
+  /* Create a test suite runner in no-fork mode */
+  void *runner = srunner_create(suite);
+  srunner_set_fork_status(runner, CK_NOFORK);
+
+  /* Execute test suite runner */
+  srunner_run_all(runner, CK_NORMAL);
+  int failed = srunner_ntests_failed(runner);
+  srunner_free(runner);
+
+  /* Exit with status code */
+  return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
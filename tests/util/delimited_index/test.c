@@ -0,0 +1,253 @@
+/*
+ * Copyright (c) 2013-2020 Martin Donath <martin.donath@squidfunk.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#define _GNU_SOURCE
+
+#include <check.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "core/buffer.h"
+#include "core/common.h"
+#include "core/delimited.h"
+#include "util/delimited_index.h"
+#include "util/mmap.h"
+
+/* ----------------------------------------------------------------------------
+ * Helper functions
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Create a temporary file with the given contents.
+ *
+ * \param[out] path   Path
+ * \param[in]  data[] Raw data
+ * \param[in]  size   Raw data size
+ */
+static void
+file_create(char path[], const uint8_t data[], size_t size) {
+  strcpy(path, "/tmp/protobluff-XXXXXX");
+  int fd = mkstemp(path);
+  fail_if(fd < 0);
+  ck_assert_int_eq(size, write(fd, data, size));
+  close(fd);
+}
+
+/*!
+ * Create a buffer of delimited messages, each containing its number.
+ *
+ * \param[in] count Message count
+ * \return          Buffer
+ */
+static pb_buffer_t
+messages_create(size_t count) {
+  pb_buffer_t buffer = pb_buffer_create_empty();
+  for (size_t m = 0; m < count; m++) {
+    uint8_t *data = pb_buffer_grow(&buffer, 2);
+    fail_unless(data);
+    data[0] = 1;
+    data[1] = (uint8_t)m;
+  }
+  return buffer;
+}
+
+/* ----------------------------------------------------------------------------
+ * Tests
+ * ------------------------------------------------------------------------- */
+
+/*
+ * Create a delimited index and seek to every message.
+ */
+START_TEST(test_create) {
+  pb_buffer_t buffer = messages_create(10);
+
+  /* Create index */
+  pb_delimited_index_t index = pb_delimited_index_create(&buffer, 3);
+  fail_unless(pb_delimited_index_valid(&index));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_delimited_index_error(&index));
+  ck_assert_uint_eq(10, pb_delimited_index_size(&index));
+
+  /* Seek to messages in reverse order */
+  pb_delimited_reader_t reader = pb_delimited_reader_create(&buffer);
+  pb_buffer_t message;
+  for (size_t m = 10; m; m--) {
+    ck_assert_uint_eq(PB_ERROR_NONE,
+      pb_delimited_index_seek(&index, &reader, m - 1));
+    ck_assert_uint_eq(PB_ERROR_NONE,
+      pb_delimited_reader_next(&reader, &message));
+    ck_assert_uint_eq(m - 1, pb_buffer_data(&message)[0]);
+  }
+
+  /* Seek beyond last message */
+  ck_assert_uint_eq(PB_ERROR_OFFSET,
+    pb_delimited_index_seek(&index, &reader, 10));
+
+  /* Free all allocated memory */
+  pb_delimited_reader_destroy(&reader);
+  pb_delimited_index_destroy(&index);
+  pb_buffer_destroy(&buffer);
+} END_TEST
+
+/*
+ * Create a delimited index from an empty buffer.
+ */
+START_TEST(test_create_empty) {
+  pb_buffer_t buffer = pb_buffer_create_empty();
+
+  /* Create index */
+  pb_delimited_index_t index = pb_delimited_index_create(&buffer, 1);
+  fail_unless(pb_delimited_index_valid(&index));
+  ck_assert_uint_eq(0, pb_delimited_index_size(&index));
+
+  /* Free all allocated memory */
+  pb_delimited_index_destroy(&index);
+  pb_buffer_destroy(&buffer);
+} END_TEST
+
+/*
+ * Create a delimited index from a truncated buffer.
+ */
+START_TEST(test_create_truncated) {
+  const uint8_t data[] = { 1, 1, 3, 1 };
+  pb_buffer_t buffer = pb_buffer_create(data, 4);
+
+  /* Create index */
+  pb_delimited_index_t index = pb_delimited_index_create(&buffer, 1);
+  fail_if(pb_delimited_index_valid(&index));
+  ck_assert_uint_eq(PB_ERROR_ALLOC, pb_delimited_index_error(&index));
+
+  /* Seek to message */
+  pb_delimited_reader_t reader = pb_delimited_reader_create(&buffer);
+  ck_assert_uint_eq(PB_ERROR_INVALID,
+    pb_delimited_index_seek(&index, &reader, 0));
+
+  /* Free all allocated memory */
+  pb_delimited_reader_destroy(&reader);
+  pb_delimited_index_destroy(&index);
+  pb_buffer_destroy(&buffer);
+} END_TEST
+
+/*
+ * Write a delimited index and map it together with its messages.
+ */
+START_TEST(test_mmap) {
+  pb_buffer_t buffer = messages_create(100);
+
+  /* Create files for messages and index */
+  char path[32], sidecar[32];
+  file_create(path, pb_buffer_data(&buffer), pb_buffer_size(&buffer));
+  file_create(sidecar, NULL, 0);
+
+  /* Create and write index */
+  pb_delimited_index_t index = pb_delimited_index_create(&buffer, 16);
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_delimited_index_write(&index, sidecar));
+  ck_assert_uint_eq(24 + 7 * 8, pb_buffer_size(&(index.buffer)));
+  pb_delimited_index_destroy(&index);
+  pb_buffer_destroy(&buffer);
+
+  /* Map messages and index */
+  buffer = pb_buffer_create_mmap(path, PB_MMAP_RANDOM);
+  index  = pb_delimited_index_create_mmap(sidecar);
+  fail_unless(pb_delimited_index_valid(&index));
+  ck_assert_uint_eq(100, pb_delimited_index_size(&index));
+
+  /* Seek to message */
+  pb_delimited_reader_t reader = pb_delimited_reader_create(&buffer);
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_delimited_index_seek(&index, &reader, 77));
+  pb_buffer_t message;
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_delimited_reader_next(&reader, &message));
+  ck_assert_uint_eq(77, pb_buffer_data(&message)[0]);
+
+  /* Free all allocated memory */
+  pb_delimited_reader_destroy(&reader);
+  pb_delimited_index_destroy(&index);
+  pb_buffer_destroy(&buffer);
+  unlink(sidecar);
+  unlink(path);
+} END_TEST
+
+/*
+ * Map an invalid index file.
+ */
+START_TEST(test_mmap_invalid) {
+  const uint8_t data[] = "SOME DATA THAT IS NOT AN INDEX";
+
+  /* Create file and index */
+  char path[32];
+  file_create(path, data, sizeof(data));
+  pb_delimited_index_t index = pb_delimited_index_create_mmap(path);
+  fail_if(pb_delimited_index_valid(&index));
+
+  /* Write index */
+  ck_assert_uint_eq(PB_ERROR_INVALID,
+    pb_delimited_index_write(&index, path));
+
+  /* Free all allocated memory */
+  pb_delimited_index_destroy(&index);
+  unlink(path);
+} END_TEST
+
+/* ----------------------------------------------------------------------------
+ * Program
+ * ------------------------------------------------------------------------- */
+
+/*
+ * Create a test suite for all registered test cases and run it.
+ *
+ * Tests must be run sequentially (in no-fork mode) or code coverage
+ * cannot be determined properly.
+ */
+int
+main(void) {
+  void *suite = suite_create("protobluff/util/delimited_index"),
+       *tcase = NULL;
+
+  /* Add tests to test case "create" */
+  tcase = tcase_create("create");
+  tcase_add_test(tcase, test_create);
+  tcase_add_test(tcase, test_create_empty);
+  tcase_add_test(tcase, test_create_truncated);
+  suite_add_tcase(suite, tcase);
+
+  /* Add tests to test case "mmap" */
+  tcase = tcase_create("mmap");
+  tcase_add_test(tcase, test_mmap);
+  tcase_add_test(tcase, test_mmap_invalid);
+  suite_add_tcase(suite, tcase);
+
+  /* Create a test suite runner in no-fork mode */
+  void *runner = srunner_create(suite);
+  srunner_set_fork_status(runner, CK_NOFORK);
+
+  /* Execute test suite runner */
+  srunner_run_all(runner, CK_NORMAL);
+  int failed = srunner_ntests_failed(runner);
+  srunner_free(runner);
+
+  /* Exit with status code */
+  return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -63,6 +63,18 @@ descriptor_scattered = { {
     {  8, "F08", STRING,  OPTIONAL }
   }, 2 } };
 
+/* Descriptor with name index */
+static pb_descriptor_t
+descriptor_named = { {
+  (const pb_field_descriptor_t []){
+    {  1, "F03", UINT32,  OPTIONAL },
+    {  2, "F01", UINT64,  OPTIONAL },
+    {  3, "F02", SINT32,  OPTIONAL }
+  }, 3 }, NULL, { NULL, 0, 0 }, { NULL, 0 }, {
+  (const uint16_t []){
+    1, 2, 0
+  }, 3 } };
+
 /* Extension descriptor */
 static pb_descriptor_t
 descriptor_extension = { {
@@ -101,6 +113,18 @@ enum_descriptor_scattered = { {
     {  8, "V08" }
   }, 2 } };
 
+/* Enum descriptor with name index */
+static pb_enum_descriptor_t
+enum_descriptor_named = { {
+  (const pb_enum_value_descriptor_t []){
+    {  0, "V02" },
+    {  1, "V00" },
+    {  2, "V01" }
+  }, 3 }, { NULL, 0, 0 }, {
+  (const uint16_t []){
+    1, 2, 0
+  }, 3 } };
+
 /* ----------------------------------------------------------------------------
  * Fixtures
  * ------------------------------------------------------------------------- */
@@ -178,6 +202,32 @@ START_TEST(test_field_by_name_scattered_absent) {
     pb_descriptor_field_by_name(&descriptor_scattered, "F09"));
 } END_TEST
 
+/*
+ * Retrieve the field descriptor for a given name using the name index.
+ */
+START_TEST(test_field_by_name_named) {
+  for (size_t f = 0; f < 3; f++) {
+    char name[5];
+    snprintf(name, 5, "F%02zd", (f + 2) % 3 + 1);
+
+    /* Assert field descriptor */
+    ck_assert_ptr_eq(&(descriptor_named.field.data[f]),
+      pb_descriptor_field_by_name(&descriptor_named, name));
+  }
+} END_TEST
+
+/*
+ * Retrieve the field descriptor for an absent name using the name index.
+ */
+START_TEST(test_field_by_name_named_absent) {
+  ck_assert_ptr_eq(NULL,
+    pb_descriptor_field_by_name(&descriptor_named, "F00"));
+  ck_assert_ptr_eq(NULL,
+    pb_descriptor_field_by_name(&descriptor_named, "F015"));
+  ck_assert_ptr_eq(NULL,
+    pb_descriptor_field_by_name(&descriptor_named, "F04"));
+} END_TEST
+
 /*
  * Retrieve the field descriptor for a given name from an extended descriptor.
  */
@@ -256,6 +306,32 @@ START_TEST(test_enum_value_by_name_scattered_absent) {
     pb_enum_descriptor_value_by_name(&enum_descriptor_scattered, "V09"));
 } END_TEST
 
+/*
+ * Retrieve the value for a given name using the name index.
+ */
+START_TEST(test_enum_value_by_name_named) {
+  for (size_t v = 0; v < 3; v++) {
+    char name[5];
+    snprintf(name, 5, "V%02zd", (v + 2) % 3);
+
+    /* Assert value descriptor */
+    ck_assert_ptr_eq(&(enum_descriptor_named.value.data[v]),
+      pb_enum_descriptor_value_by_name(&enum_descriptor_named, name));
+  }
+} END_TEST
+
+/*
+ * Retrieve the value for an absent name using the name index.
+ */
+START_TEST(test_enum_value_by_name_named_absent) {
+  ck_assert_ptr_eq(NULL,
+    pb_enum_descriptor_value_by_name(&enum_descriptor_named, "V"));
+  ck_assert_ptr_eq(NULL,
+    pb_enum_descriptor_value_by_name(&enum_descriptor_named, "V015"));
+  ck_assert_ptr_eq(NULL,
+    pb_enum_descriptor_value_by_name(&enum_descriptor_named, "V03"));
+} END_TEST
+
 /* ----------------------------------------------------------------------------
  * Program
  * ------------------------------------------------------------------------- */
@@ -279,6 +355,8 @@ main(void) {
   tcase_add_test(tcase, test_field_by_name_empty);
   tcase_add_test(tcase, test_field_by_name_scattered);
   tcase_add_test(tcase, test_field_by_name_scattered_absent);
+  tcase_add_test(tcase, test_field_by_name_named);
+  tcase_add_test(tcase, test_field_by_name_named_absent);
   tcase_add_test(tcase, test_field_by_name_extended);
   suite_add_tcase(suite, tcase);
 
@@ -289,6 +367,8 @@ main(void) {
   tcase_add_test(tcase, test_enum_value_by_name_empty);
   tcase_add_test(tcase, test_enum_value_by_name_scattered);
   tcase_add_test(tcase, test_enum_value_by_name_scattered_absent);
+  tcase_add_test(tcase, test_enum_value_by_name_named);
+  tcase_add_test(tcase, test_enum_value_by_name_named_absent);
   suite_add_tcase(suite, tcase);
 
   /* Create a test suite runner in no-fork mode */
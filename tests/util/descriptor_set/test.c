@@ -0,0 +1,523 @@
+/*
+ * Copyright (c) 2013-2020 Martin Donath <martin.donath@squidfunk.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <check.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "core/buffer.h"
+#include "core/common.h"
+#include "core/decoder.h"
+#include "core/descriptor.h"
+#include "core/encoder.h"
+#include "util/descriptor.h"
+#include "util/descriptor_set.h"
+
+/* ----------------------------------------------------------------------------
+ * Fixtures
+ * ------------------------------------------------------------------------- */
+
+/*
+ * Descriptor set created with protoc --include_imports from:
+ *
+ *   syntax = "proto2";
+ *   package test;
+ *   enum Color { GREEN = 2; RED = 1; BLUE = 4; }
+ *   message Sparse { optional int32 a = 1; optional int32 b = 1000; }
+ *   message Person {
+ *     required string name = 2;
+ *     required int32 id = 1;
+ *     optional string email = 3 [default = "none"];
+ *     optional Color color = 4;
+ *     optional Color other = 5 [default = BLUE];
+ *     optional bytes data = 6 [default = "a\001\"b"];
+ *     optional double score = 7 [default = -1.5];
+ *     optional bool flag = 8 [default = true];
+ *     optional uint64 big = 9 [default = 18446744073709551615];
+ *     repeated int32 plain = 10;
+ *     repeated int32 packed = 11 [packed = true];
+ *     message Address {
+ *       optional string street = 1;
+ *       optional Address next = 2;
+ *     }
+ *     repeated Address address = 12;
+ *     optional Sparse sparse = 13;
+ *     oneof choice { int32 number = 14; string text = 15; }
+ *     optional float ratio = 16 [default = inf];
+ *   }
+ *
+ *   syntax = "proto3";
+ *   package test3;
+ *   import "test.proto";
+ *   message Event {
+ *     enum Kind { KIND_UNKNOWN = 0; KIND_FAR = 100000; KIND_NEG = -5; }
+ *     repeated int32 values = 1;
+ *     repeated int32 unpacked = 2 [packed = false];
+ *     string name = 3;
+ *     optional int64 count = 4;
+ *     test.Person person = 5;
+ *     Kind kind = 6;
+ *   }
+ */
+static const uint8_t
+set_data[] = {
+  10, 157, 5, 10, 10, 116, 101, 115, 116, 46, 112, 114, 111, 116, 111, 18,
+  4, 116, 101, 115, 116, 34, 37, 10, 6, 83, 112, 97, 114, 115, 101, 18,
+  12, 10, 1, 97, 24, 1, 32, 1, 40, 5, 82, 1, 97, 18, 13, 10, 1, 98, 24,
+  232, 7, 32, 1, 40, 5, 82, 1, 98, 34, 186, 4, 10, 6, 80, 101, 114, 115,
+  111, 110, 18, 18, 10, 4, 110, 97, 109, 101, 24, 2, 32, 2, 40, 9, 82, 4,
+  110, 97, 109, 101, 18, 14, 10, 2, 105, 100, 24, 1, 32, 2, 40, 5, 82, 2,
+  105, 100, 18, 26, 10, 5, 101, 109, 97, 105, 108, 24, 3, 32, 1, 40, 9,
+  58, 4, 110, 111, 110, 101, 82, 5, 101, 109, 97, 105, 108, 18, 33, 10, 5,
+  99, 111, 108, 111, 114, 24, 4, 32, 1, 40, 14, 50, 11, 46, 116, 101, 115,
+  116, 46, 67, 111, 108, 111, 114, 82, 5, 99, 111, 108, 111, 114, 18, 39,
+  10, 5, 111, 116, 104, 101, 114, 24, 5, 32, 1, 40, 14, 50, 11, 46, 116,
+  101, 115, 116, 46, 67, 111, 108, 111, 114, 58, 4, 66, 76, 85, 69, 82, 5,
+  111, 116, 104, 101, 114, 18, 28, 10, 4, 100, 97, 116, 97, 24, 6, 32, 1,
+  40, 12, 58, 8, 97, 92, 48, 48, 49, 92, 34, 98, 82, 4, 100, 97, 116, 97,
+  18, 26, 10, 5, 115, 99, 111, 114, 101, 24, 7, 32, 1, 40, 1, 58, 4, 45,
+  49, 46, 53, 82, 5, 115, 99, 111, 114, 101, 18, 24, 10, 4, 102, 108, 97,
+  103, 24, 8, 32, 1, 40, 8, 58, 4, 116, 114, 117, 101, 82, 4, 102, 108,
+  97, 103, 18, 38, 10, 3, 98, 105, 103, 24, 9, 32, 1, 40, 4, 58, 20, 49,
+  56, 52, 52, 54, 55, 52, 52, 48, 55, 51, 55, 48, 57, 53, 53, 49, 54, 49,
+  53, 82, 3, 98, 105, 103, 18, 20, 10, 5, 112, 108, 97, 105, 110, 24, 10,
+  32, 3, 40, 5, 82, 5, 112, 108, 97, 105, 110, 18, 26, 10, 6, 112, 97, 99,
+  107, 101, 100, 24, 11, 32, 3, 40, 5, 66, 2, 16, 1, 82, 6, 112, 97, 99,
+  107, 101, 100, 18, 46, 10, 7, 97, 100, 100, 114, 101, 115, 115, 24, 12,
+  32, 3, 40, 11, 50, 20, 46, 116, 101, 115, 116, 46, 80, 101, 114, 115,
+  111, 110, 46, 65, 100, 100, 114, 101, 115, 115, 82, 7, 97, 100, 100,
+  114, 101, 115, 115, 18, 36, 10, 6, 115, 112, 97, 114, 115, 101, 24, 13,
+  32, 1, 40, 11, 50, 12, 46, 116, 101, 115, 116, 46, 83, 112, 97, 114,
+  115, 101, 82, 6, 115, 112, 97, 114, 115, 101, 18, 24, 10, 6, 110, 117,
+  109, 98, 101, 114, 24, 14, 32, 1, 40, 5, 72, 0, 82, 6, 110, 117, 109,
+  98, 101, 114, 18, 20, 10, 4, 116, 101, 120, 116, 24, 15, 32, 1, 40, 9,
+  72, 0, 82, 4, 116, 101, 120, 116, 18, 25, 10, 5, 114, 97, 116, 105, 111,
+  24, 16, 32, 1, 40, 2, 58, 3, 105, 110, 102, 82, 5, 114, 97, 116, 105,
+  111, 26, 75, 10, 7, 65, 100, 100, 114, 101, 115, 115, 18, 22, 10, 6,
+  115, 116, 114, 101, 101, 116, 24, 1, 32, 1, 40, 9, 82, 6, 115, 116, 114,
+  101, 101, 116, 18, 40, 10, 4, 110, 101, 120, 116, 24, 2, 32, 1, 40, 11,
+  50, 20, 46, 116, 101, 115, 116, 46, 80, 101, 114, 115, 111, 110, 46, 65,
+  100, 100, 114, 101, 115, 115, 82, 4, 110, 101, 120, 116, 66, 8, 10, 6,
+  99, 104, 111, 105, 99, 101, 42, 37, 10, 5, 67, 111, 108, 111, 114, 18,
+  9, 10, 5, 71, 82, 69, 69, 78, 16, 2, 18, 7, 10, 3, 82, 69, 68, 16, 1,
+  18, 8, 10, 4, 66, 76, 85, 69, 16, 4, 10, 177, 2, 10, 11, 116, 101, 115,
+  116, 51, 46, 112, 114, 111, 116, 111, 18, 5, 116, 101, 115, 116, 51, 26,
+  10, 116, 101, 115, 116, 46, 112, 114, 111, 116, 111, 34, 134, 2, 10, 5,
+  69, 118, 101, 110, 116, 18, 22, 10, 6, 118, 97, 108, 117, 101, 115, 24,
+  1, 32, 3, 40, 5, 82, 6, 118, 97, 108, 117, 101, 115, 18, 30, 10, 8, 117,
+  110, 112, 97, 99, 107, 101, 100, 24, 2, 32, 3, 40, 5, 66, 2, 16, 0, 82,
+  8, 117, 110, 112, 97, 99, 107, 101, 100, 18, 18, 10, 4, 110, 97, 109,
+  101, 24, 3, 32, 1, 40, 9, 82, 4, 110, 97, 109, 101, 18, 25, 10, 5, 99,
+  111, 117, 110, 116, 24, 4, 32, 1, 40, 3, 72, 0, 82, 5, 99, 111, 117,
+  110, 116, 136, 1, 1, 18, 36, 10, 6, 112, 101, 114, 115, 111, 110, 24, 5,
+  32, 1, 40, 11, 50, 12, 46, 116, 101, 115, 116, 46, 80, 101, 114, 115,
+  111, 110, 82, 6, 112, 101, 114, 115, 111, 110, 18, 37, 10, 4, 107, 105,
+  110, 100, 24, 6, 32, 1, 40, 14, 50, 17, 46, 116, 101, 115, 116, 51, 46,
+  69, 118, 101, 110, 116, 46, 75, 105, 110, 100, 82, 4, 107, 105, 110,
+  100, 34, 63, 10, 4, 75, 105, 110, 100, 18, 16, 10, 12, 75, 73, 78, 68,
+  95, 85, 78, 75, 78, 79, 87, 78, 16, 0, 18, 14, 10, 8, 75, 73, 78, 68,
+  95, 70, 65, 82, 16, 160, 141, 6, 18, 21, 10, 8, 75, 73, 78, 68, 95, 78,
+  69, 71, 16, 251, 255, 255, 255, 255, 255, 255, 255, 255, 1, 66, 8, 10,
+  6, 95, 99, 111, 117, 110, 116, 98, 6, 112, 114, 111, 116, 111, 51
+};
+
+/* ----------------------------------------------------------------------------
+ * Helper functions
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Create a descriptor set from raw data.
+ *
+ * \param[in] data[] Raw data
+ * \param[in] size   Raw data size
+ * \return           Descriptor set
+ */
+static pb_descriptor_set_t
+set_create(const uint8_t data[], size_t size) {
+  pb_buffer_t buffer = pb_buffer_create(data, size);
+  pb_descriptor_set_t set = pb_descriptor_set_create(&buffer);
+  pb_buffer_destroy(&buffer);
+  return set;
+}
+
+/*!
+ * Count the values of all fields of a message.
+ *
+ * \param[in]     descriptor Field descriptor
+ * \param[in]     value      Pointer holding value
+ * \param[in,out] user       User data
+ * \return                   Error code
+ */
+static pb_error_t
+handler(
+    const pb_field_descriptor_t *descriptor, const void *value, void *user) {
+  (*(size_t *)user)++;
+  return PB_ERROR_NONE;
+}
+
+/* ----------------------------------------------------------------------------
+ * Tests
+ * ------------------------------------------------------------------------- */
+
+/*
+ * Create a descriptor set and retrieve descriptors by full name.
+ */
+START_TEST(test_create) {
+  pb_descriptor_set_t set = set_create(set_data, sizeof(set_data));
+  fail_unless(pb_descriptor_set_valid(&set));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_descriptor_set_error(&set));
+  ck_assert_uint_eq(6, pb_descriptor_set_size(&set));
+
+  /* Retrieve descriptors */
+  const pb_descriptor_t *person =
+    pb_descriptor_set_message(&set, "test.Person");
+  fail_unless(person);
+  ck_assert_ptr_eq(person, pb_descriptor_set_message(&set, ".test.Person"));
+  fail_unless(pb_descriptor_set_message(&set, "test.Person.Address"));
+  fail_unless(pb_descriptor_set_message(&set, "test3.Event"));
+  fail_unless(pb_descriptor_set_enum(&set, "test3.Event.Kind"));
+  fail_if(pb_descriptor_set_message(&set, "test.Color"));
+  fail_if(pb_descriptor_set_message(&set, "test.Persons"));
+  fail_if(pb_descriptor_set_message(&set, "test"));
+
+  /* Assert fields are ordered by tag */
+  ck_assert_uint_eq(16, pb_descriptor_size(person));
+  for (size_t f = 0; f < 16; f++)
+    ck_assert_uint_eq(f + 1, pb_field_descriptor_tag(
+      &(person->field.data[f])));
+
+  /* Assert lookup tables */
+  fail_unless(person->index.data);
+  ck_assert_uint_eq(1, person->index.offset);
+  ck_assert_uint_eq(16, person->index.size);
+  ck_assert_uint_eq(1, person->required.size);
+  ck_assert_uint_eq(3, person->required.data[0]);
+  const pb_field_descriptor_t *name =
+    pb_descriptor_field_by_name(person, "name");
+  fail_unless(name);
+  ck_assert_ptr_eq(name, pb_descriptor_field_by_tag(person, 2));
+  ck_assert_uint_eq(PB_TYPE_STRING, pb_field_descriptor_type(name));
+  ck_assert_uint_eq(PB_LABEL_REQUIRED, pb_field_descriptor_label(name));
+  ck_assert_uint_eq(0, name->flags);
+  ck_assert_uint_eq(1, name->key.size);
+  ck_assert_uint_eq(18, name->key.data[0]);
+
+  /* Assert references to messages and enums */
+  const pb_field_descriptor_t *address =
+    pb_descriptor_field_by_tag(person, 12);
+  ck_assert_ptr_eq(pb_descriptor_set_message(&set, "test.Person.Address"),
+    pb_field_descriptor_nested(address));
+  ck_assert_uint_eq(PB_LABEL_REPEATED, pb_field_descriptor_label(address));
+  ck_assert_ptr_eq(pb_field_descriptor_nested(address),
+    pb_field_descriptor_nested(pb_descriptor_field_by_tag(
+      pb_field_descriptor_nested(address), 2)));
+  ck_assert_ptr_eq(pb_descriptor_set_enum(&set, "test.Color"),
+    pb_field_descriptor_enum(pb_descriptor_field_by_tag(person, 4)));
+
+  /* Assert packed fields */
+  ck_assert_uint_eq(0, pb_descriptor_field_by_tag(person, 10)->flags);
+  ck_assert_uint_eq(PB_FLAG_PACKED,
+    pb_descriptor_field_by_tag(person, 11)->flags);
+
+  /* Free all allocated memory */
+  pb_descriptor_set_destroy(&set);
+} END_TEST
+
+/*
+ * Create a descriptor set with sparse tags and enum numbers.
+ */
+START_TEST(test_create_sparse) {
+  pb_descriptor_set_t set = set_create(set_data, sizeof(set_data));
+  fail_unless(pb_descriptor_set_valid(&set));
+
+  /* Assert tags for binary search instead of index */
+  const pb_descriptor_t *sparse =
+    pb_descriptor_set_message(&set, "test.Sparse");
+  fail_unless(sparse);
+  fail_if(sparse->index.data);
+  fail_unless(sparse->tag.data);
+  ck_assert_uint_eq(1000, sparse->tag.data[1]);
+  ck_assert_ptr_eq(&(sparse->field.data[1]),
+    pb_descriptor_field_by_tag(sparse, 1000));
+  fail_if(pb_descriptor_field_by_tag(sparse, 999));
+  ck_assert_ptr_eq(&(sparse->field.data[1]),
+    pb_descriptor_field_by_name(sparse, "b"));
+
+  /* Assert enum values are ordered by number */
+  const pb_enum_descriptor_t *kind =
+    pb_descriptor_set_enum(&set, "test3.Event.Kind");
+  fail_unless(kind);
+  fail_if(kind->index.data);
+  ck_assert_uint_eq(3, pb_enum_descriptor_size(kind));
+  ck_assert_int_eq(-5, pb_enum_value_descriptor_number(
+    &(kind->value.data[0])));
+  fail_if(strcmp("KIND_FAR", pb_enum_value_descriptor_name(
+    pb_enum_descriptor_value_by_number(kind, 100000))));
+  ck_assert_int_eq(-5, pb_enum_value_descriptor_number(
+    pb_enum_descriptor_value_by_name(kind, "KIND_NEG")));
+
+  /* Assert dense enum values are indexed */
+  const pb_enum_descriptor_t *color =
+    pb_descriptor_set_enum(&set, "test.Color");
+  fail_unless(color && color->index.data);
+  ck_assert_int_eq(1, color->index.offset);
+  fail_if(strcmp("BLUE", pb_enum_value_descriptor_name(
+    pb_enum_descriptor_value_by_number(color, 4))));
+  fail_if(pb_enum_descriptor_value_by_number(color, 3));
+
+  /* Free all allocated memory */
+  pb_descriptor_set_destroy(&set);
+} END_TEST
+
+/*
+ * Create a descriptor set with default values.
+ */
+START_TEST(test_create_defaults) {
+  pb_descriptor_set_t set = set_create(set_data, sizeof(set_data));
+  const pb_descriptor_t *person =
+    pb_descriptor_set_message(&set, "test.Person");
+  fail_unless(person);
+
+  /* Assert default values */
+  const pb_string_t *email =
+    pb_field_descriptor_default(pb_descriptor_field_by_tag(person, 3));
+  ck_assert_uint_eq(4, pb_string_size(email));
+  fail_if(memcmp("none", pb_string_data(email), 4));
+  ck_assert_int_eq(2, *(const pb_enum_t *)
+    pb_field_descriptor_default(pb_descriptor_field_by_tag(person, 4)));
+  ck_assert_int_eq(4, *(const pb_enum_t *)
+    pb_field_descriptor_default(pb_descriptor_field_by_tag(person, 5)));
+  const pb_string_t *data =
+    pb_field_descriptor_default(pb_descriptor_field_by_tag(person, 6));
+  ck_assert_uint_eq(4, pb_string_size(data));
+  fail_if(memcmp("a\001\"b", pb_string_data(data), 4));
+  fail_unless(-1.5 == *(const double *)
+    pb_field_descriptor_default(pb_descriptor_field_by_tag(person, 7)));
+  ck_assert_uint_eq(1, *(const uint8_t *)
+    pb_field_descriptor_default(pb_descriptor_field_by_tag(person, 8)));
+  fail_unless(UINT64_MAX == *(const uint64_t *)
+    pb_field_descriptor_default(pb_descriptor_field_by_tag(person, 9)));
+  fail_unless(isinf(*(const float *)
+    pb_field_descriptor_default(pb_descriptor_field_by_tag(person, 16))));
+  fail_if(pb_field_descriptor_default(pb_descriptor_field_by_tag(person, 1)));
+
+  /* Assert oneof members */
+  const pb_field_descriptor_t *number =
+    pb_descriptor_field_by_tag(person, 14);
+  ck_assert_uint_eq(PB_LABEL_ONEOF, pb_field_descriptor_label(number));
+  const pb_oneof_descriptor_t *oneof = pb_field_descriptor_oneof(number);
+  fail_unless(oneof);
+  ck_assert_ptr_eq(person, oneof->descriptor);
+  ck_assert_uint_eq(2, oneof->index.size);
+  ck_assert_uint_eq(13, oneof->index.data[0]);
+  ck_assert_uint_eq(14, oneof->index.data[1]);
+  ck_assert_ptr_eq(oneof, pb_field_descriptor_oneof(
+    pb_descriptor_field_by_tag(person, 15)));
+
+  /* Free all allocated memory */
+  pb_descriptor_set_destroy(&set);
+} END_TEST
+
+/*
+ * Create a descriptor set with proto3 semantics.
+ */
+START_TEST(test_create_proto3) {
+  pb_descriptor_set_t set = set_create(set_data, sizeof(set_data));
+  const pb_descriptor_t *event =
+    pb_descriptor_set_message(&set, "test3.Event");
+  fail_unless(event);
+
+  /* Assert fields */
+  ck_assert_uint_eq(PB_FLAG_PACKED,
+    pb_descriptor_field_by_tag(event, 1)->flags);
+  ck_assert_uint_eq(0, pb_descriptor_field_by_tag(event, 2)->flags);
+  ck_assert_uint_eq(PB_FLAG_UTF8,
+    pb_descriptor_field_by_tag(event, 3)->flags);
+  ck_assert_uint_eq(PB_LABEL_OPTIONAL,
+    pb_field_descriptor_label(pb_descriptor_field_by_tag(event, 4)));
+  ck_assert_ptr_eq(pb_descriptor_set_message(&set, "test.Person"),
+    pb_field_descriptor_nested(pb_descriptor_field_by_tag(event, 5)));
+  ck_assert_int_eq(0, *(const pb_enum_t *)
+    pb_field_descriptor_default(pb_descriptor_field_by_tag(event, 6)));
+
+  /* Free all allocated memory */
+  pb_descriptor_set_destroy(&set);
+} END_TEST
+
+/*
+ * Encode and decode a message with a loaded descriptor.
+ */
+START_TEST(test_encode) {
+  pb_descriptor_set_t set = set_create(set_data, sizeof(set_data));
+  const pb_descriptor_t *event =
+    pb_descriptor_set_message(&set, "test3.Event");
+  fail_unless(event);
+
+  /* Encode packed and unpacked values */
+  const int32_t values[] = { 1, 2, 3 };
+  pb_encoder_t encoder = pb_encoder_create(event);
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_encoder_encode(&encoder, 1, values, 3));
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_encoder_encode(&encoder, 2, values, 2));
+
+  /* Assert raw data */
+  const uint8_t data[] = { 10, 3, 1, 2, 3, 16, 1, 16, 2 };
+  const pb_buffer_t *buffer = pb_encoder_buffer(&encoder);
+  ck_assert_uint_eq(sizeof(data), pb_buffer_size(buffer));
+  fail_if(memcmp(data, pb_buffer_data(buffer), sizeof(data)));
+
+  /* Decode values */
+  size_t count = 0;
+  pb_decoder_t decoder = pb_decoder_create(event, buffer);
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_decoder_decode(&decoder, handler, &count));
+  ck_assert_uint_eq(5, count);
+
+  /* Free all allocated memory */
+  pb_decoder_destroy(&decoder);
+  pb_encoder_destroy(&encoder);
+  pb_descriptor_set_destroy(&set);
+} END_TEST
+
+/*
+ * Create a descriptor set resolving relative type names.
+ */
+START_TEST(test_create_relative) {
+  const uint8_t data[] = {
+    10, 41, 18, 1, 112, 34, 17, 10, 1, 65, 18, 12, 10, 1, 98, 24, 1, 32, 1,
+    40, 0, 50, 1, 66, 34, 17, 10, 1, 66, 18, 12, 10, 1, 97, 24, 2, 32, 1,
+    40, 11, 50, 1, 65
+  };
+  pb_descriptor_set_t set = set_create(data, sizeof(data));
+  fail_unless(pb_descriptor_set_valid(&set));
+
+  /* Assert references, inferring the type if not given */
+  const pb_descriptor_t *a = pb_descriptor_set_message(&set, "p.A"),
+                        *b = pb_descriptor_set_message(&set, "p.B");
+  fail_unless(a && b);
+  ck_assert_uint_eq(PB_TYPE_MESSAGE,
+    pb_field_descriptor_type(pb_descriptor_field_by_tag(a, 1)));
+  ck_assert_ptr_eq(b,
+    pb_field_descriptor_nested(pb_descriptor_field_by_tag(a, 1)));
+  ck_assert_ptr_eq(a,
+    pb_field_descriptor_nested(pb_descriptor_field_by_tag(b, 2)));
+
+  /* Free all allocated memory */
+  pb_descriptor_set_destroy(&set);
+} END_TEST
+
+/*
+ * Create a descriptor set with an unresolvable type name.
+ */
+START_TEST(test_create_unresolved) {
+  const uint8_t data[] = {
+    10, 41, 18, 1, 112, 34, 17, 10, 1, 65, 18, 12, 10, 1, 98, 24, 1, 32, 1,
+    40, 11, 50, 1, 66, 34, 17, 10, 1, 66, 18, 12, 10, 1, 99, 24, 1, 32, 1,
+    40, 14, 50, 1, 69
+  };
+  pb_descriptor_set_t set = set_create(data, sizeof(data));
+  fail_if(pb_descriptor_set_valid(&set));
+  ck_assert_uint_eq(PB_ERROR_INVALID, pb_descriptor_set_error(&set));
+  ck_assert_uint_eq(0, pb_descriptor_set_size(&set));
+  fail_if(pb_descriptor_set_message(&set, "p.A"));
+
+  /* Free all allocated memory */
+  pb_descriptor_set_destroy(&set);
+} END_TEST
+
+/*
+ * Create a descriptor set with duplicate tags.
+ */
+START_TEST(test_create_duplicate) {
+  const uint8_t data[] = {
+    10, 30, 18, 1, 112, 34, 25, 10, 1, 65, 18, 9, 10, 1, 98, 24, 1, 32, 1,
+    40, 5, 18, 9, 10, 1, 99, 24, 1, 32, 1, 40, 5
+  };
+  pb_descriptor_set_t set = set_create(data, sizeof(data));
+  ck_assert_uint_eq(PB_ERROR_INVALID, pb_descriptor_set_error(&set));
+
+  /* Free all allocated memory */
+  pb_descriptor_set_destroy(&set);
+} END_TEST
+
+/*
+ * Create a descriptor set from invalid data.
+ */
+START_TEST(test_create_invalid) {
+  const uint8_t data[] = { 10, 10, 34, 8, 10, 1 };
+  pb_descriptor_set_t set = set_create(data, sizeof(data));
+  ck_assert_uint_eq(PB_ERROR_INVALID, pb_descriptor_set_error(&set));
+  pb_descriptor_set_destroy(&set);
+
+  /* Create descriptor set from truncated data */
+  set = set_create(set_data, sizeof(set_data) - 1);
+  ck_assert_uint_eq(PB_ERROR_INVALID, pb_descriptor_set_error(&set));
+  pb_descriptor_set_destroy(&set);
+} END_TEST
+
+/* ----------------------------------------------------------------------------
+ * Program
+ * ------------------------------------------------------------------------- */
+
+/*
+ * Create a test suite for all registered test cases and run it.
+ *
+ * Tests must be run sequentially (in no-fork mode) or code coverage
+ * cannot be determined properly.
+ */
+int
+main(void) {
+  void *suite = suite_create("protobluff/util/descriptor_set"),
+       *tcase = NULL;
+
+  /* Add tests to test case "create" */
+  tcase = tcase_create("create");
+  tcase_add_test(tcase, test_create);
+  tcase_add_test(tcase, test_create_sparse);
+  tcase_add_test(tcase, test_create_defaults);
+  tcase_add_test(tcase, test_create_proto3);
+  tcase_add_test(tcase, test_create_relative);
+  tcase_add_test(tcase, test_create_unresolved);
+  tcase_add_test(tcase, test_create_duplicate);
+  tcase_add_test(tcase, test_create_invalid);
+  suite_add_tcase(suite, tcase);
+
+  /* Add tests to test case "encode" */
+  tcase = tcase_create("encode");
+  tcase_add_test(tcase, test_encode);
+  suite_add_tcase(suite, tcase);
+
+  /* Create a test suite runner in no-fork mode */
+  void *runner = srunner_create(suite);
+  srunner_set_fork_status(runner, CK_NOFORK);
+
+  /* Execute test suite runner */
+  srunner_run_all(runner, CK_NORMAL);
+  int failed = srunner_ntests_failed(runner);
+  srunner_free(runner);
+
+  /* Exit with status code */
+  return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,222 @@
+/*
+ * Copyright (c) 2013-2020 Martin Donath <martin.donath@squidfunk.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <check.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "core/allocator.h"
+#include "core/common.h"
+#include "util/hugepage_allocator.h"
+#include "util/tracing_allocator.h"
+
+/* ----------------------------------------------------------------------------
+ * Tests
+ * ------------------------------------------------------------------------- */
+
+/*
+ * Create a huge-page allocator.
+ */
+START_TEST(test_create) {
+  pb_allocator_t allocator = pb_hugepage_allocator_create(&allocator_default);
+  ck_assert_ptr_ne(NULL, allocator.data);
+  pb_hugepage_allocator_destroy(&allocator);
+} END_TEST
+
+/*
+ * Create a huge-page allocator bound to a NUMA node.
+ */
+START_TEST(test_create_with_node) {
+  pb_allocator_t allocator =
+    pb_hugepage_allocator_create_with_node(&allocator_default, 0);
+  ck_assert_ptr_ne(NULL, allocator.data);
+  pb_hugepage_allocator_destroy(&allocator);
+} END_TEST
+
+/*
+ * Allocate a small memory block from the inner allocator.
+ */
+START_TEST(test_allocate) {
+  pb_allocator_t inner     = pb_tracing_allocator_create(&allocator_default),
+                 allocator = pb_hugepage_allocator_create(&inner);
+
+  /* Allocate a small block */
+  void *block = pb_allocator_allocate(&allocator, 100);
+  ck_assert_ptr_ne(NULL, block);
+  ck_assert_uint_eq(0, (uintptr_t)block % 16);
+
+  /* Assert allocation from inner allocator */
+  pb_tracing_allocator_stats_t stats = pb_tracing_allocator_stats(&inner);
+  ck_assert_uint_eq(1, stats.allocations);
+
+  /* Free all allocated memory */
+  pb_allocator_free(&allocator, block);
+  stats = pb_tracing_allocator_stats(&inner);
+  ck_assert_uint_eq(1, stats.frees);
+  pb_hugepage_allocator_destroy(&allocator);
+  pb_tracing_allocator_destroy(&inner);
+} END_TEST
+
+/*
+ * Allocate a large memory block backed by huge pages.
+ */
+START_TEST(test_allocate_large) {
+  pb_allocator_t inner     = pb_tracing_allocator_create(&allocator_default),
+                 allocator = pb_hugepage_allocator_create(&inner);
+
+  /* Allocate a large block */
+  uint8_t *block = pb_allocator_allocate(&allocator, 4 << 20);
+  ck_assert_ptr_ne(NULL, block);
+  ck_assert_uint_eq(0, (uintptr_t)block % 16);
+  memset(block, 42, 4 << 20);
+
+  /* Assert no allocation from inner allocator */
+  pb_tracing_allocator_stats_t stats = pb_tracing_allocator_stats(&inner);
+  ck_assert_uint_eq(0, stats.allocations);
+
+  /* Free all allocated memory */
+  pb_allocator_free(&allocator, block);
+  pb_hugepage_allocator_destroy(&allocator);
+  pb_tracing_allocator_destroy(&inner);
+} END_TEST
+
+/*
+ * Allocate large memory blocks bound to explicit NUMA nodes.
+ */
+START_TEST(test_allocate_large_with_node) {
+  pb_allocator_t allocator1 =
+    pb_hugepage_allocator_create_with_node(&allocator_default, 0);
+  pb_allocator_t allocator2 =
+    pb_hugepage_allocator_create_with_node(&allocator_default, 4096);
+
+  /* Allocate large blocks, ignoring unavailable nodes */
+  uint8_t *block1 = pb_allocator_allocate(&allocator1, 2 << 20);
+  uint8_t *block2 = pb_allocator_allocate(&allocator2, 2 << 20);
+  ck_assert_ptr_ne(NULL, block1);
+  ck_assert_ptr_ne(NULL, block2);
+  memset(block1, 42, 2 << 20);
+  memset(block2, 42, 2 << 20);
+
+  /* Free all allocated memory */
+  pb_allocator_free(&allocator1, block1);
+  pb_allocator_free(&allocator2, block2);
+  pb_hugepage_allocator_destroy(&allocator1);
+  pb_hugepage_allocator_destroy(&allocator2);
+} END_TEST
+
+/*
+ * Allocate a memory block from an invalid huge-page allocator.
+ */
+START_TEST(test_allocate_invalid) {
+  pb_allocator_t allocator = pb_hugepage_allocator_create(&allocator_default);
+  pb_hugepage_allocator_destroy(&allocator);
+  allocator.data = NULL;
+
+  /* Assert allocation failure */
+  ck_assert_ptr_eq(NULL, pb_allocator_allocate(&allocator, 10));
+  ck_assert_ptr_eq(NULL, pb_allocator_resize(&allocator, NULL, 10));
+} END_TEST
+
+/*
+ * Change the size of a previously allocated memory block.
+ */
+START_TEST(test_resize) {
+  pb_allocator_t inner     = pb_tracing_allocator_create(&allocator_default),
+                 allocator = pb_hugepage_allocator_create(&inner);
+
+  /* Allocate a small block and grow it */
+  uint8_t *block = pb_allocator_resize(&allocator, NULL, 100);
+  ck_assert_ptr_ne(NULL, block);
+  memset(block, 42, 100);
+  ck_assert_ptr_eq(block, pb_allocator_resize(&allocator, block, 50));
+  block = pb_allocator_resize(&allocator, block, 1000);
+  ck_assert_ptr_ne(NULL, block);
+
+  /* Grow block beyond the threshold for huge pages */
+  block = pb_allocator_resize(&allocator, block, 4 << 20);
+  ck_assert_ptr_ne(NULL, block);
+  memset(block + 100, 0, (4 << 20) - 100);
+
+  /* Assert copied contents and release to inner allocator */
+  ck_assert_uint_eq(42, block[0]);
+  ck_assert_uint_eq(42, block[99]);
+  pb_tracing_allocator_stats_t stats = pb_tracing_allocator_stats(&inner);
+  ck_assert_uint_eq(0, stats.live);
+
+  /* Grow large block */
+  block = pb_allocator_resize(&allocator, block, 8 << 20);
+  ck_assert_ptr_ne(NULL, block);
+  ck_assert_uint_eq(42, block[0]);
+
+  /* Free all allocated memory */
+  pb_allocator_free(&allocator, block);
+  pb_hugepage_allocator_destroy(&allocator);
+  pb_tracing_allocator_destroy(&inner);
+} END_TEST
+
+/* ----------------------------------------------------------------------------
+ * Program
+ * ------------------------------------------------------------------------- */
+
+/*
+ * Create a test suite for all registered test cases and run it.
+ *
+ * Tests must be run sequentially (in no-fork mode) or code coverage
+ * cannot be determined properly.
+ */
+int
+main(void) {
+  void *suite = suite_create("protobluff/util/hugepage_allocator"),
+       *tcase = NULL;
+
+  /* Add tests to test case "create" */
+  tcase = tcase_create("create");
+  tcase_add_test(tcase, test_create);
+  tcase_add_test(tcase, test_create_with_node);
+  suite_add_tcase(suite, tcase);
+
+  /* Add tests to test case "allocate" */
+  tcase = tcase_create("allocate");
+  tcase_add_test(tcase, test_allocate);
+  tcase_add_test(tcase, test_allocate_large);
+  tcase_add_test(tcase, test_allocate_large_with_node);
+  tcase_add_test(tcase, test_allocate_invalid);
+  suite_add_tcase(suite, tcase);
+
+  /* Add tests to test case "resize" */
+  tcase = tcase_create("resize");
+  tcase_add_test(tcase, test_resize);
+  suite_add_tcase(suite, tcase);
+
+  /* Create a test suite runner in no-fork mode */
+  void *runner = srunner_create(suite);
+  srunner_set_fork_status(runner, CK_NOFORK);
+
+  /* Execute test suite runner */
+  srunner_run_all(runner, CK_NORMAL);
+  int failed = srunner_ntests_failed(runner);
+  srunner_free(runner);
+
+  /* Exit with status code */
+  return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
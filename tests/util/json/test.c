@@ -0,0 +1,378 @@
+/*
+ * Copyright (c) 2013-2020 Martin Donath <martin.donath@squidfunk.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <check.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <protobluff/descriptor.h>
+
+#include "core/buffer.h"
+#include "core/common.h"
+#include "core/decoder.h"
+#include "core/descriptor.h"
+#include "core/encoder.h"
+#include "util/json.h"
+
+/* ----------------------------------------------------------------------------
+ * Helper functions
+ * ------------------------------------------------------------------------- */
+
+/*
+ * Encode a message containing fields of all types.
+ */
+static void
+encode(pb_encoder_t *encoder) {
+  int32_t     value1  = -1;
+  uint64_t    value2  = UINT64_MAX;
+  int32_t     value3  = -2;
+  uint8_t     value4  = 1;
+  float       value5[] = { 1.5, -0.25 };
+  double      value6  = 0.1;
+  pb_string_t value7  = pb_string_init_from_chars("a\"b\n\x01");
+  pb_string_t value8  = pb_string_init((uint8_t []){ 0, 1, 2, 3 }, 4);
+  pb_enum_t   value9  = 1;
+  uint32_t    value10 = 7;
+
+  /* Encode scalar fields */
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_encoder_encode(encoder, 1, &value1, 1));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_encoder_encode(encoder, 2, &value2, 1));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_encoder_encode(encoder, 3, &value3, 1));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_encoder_encode(encoder, 4, &value4, 1));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_encoder_encode(encoder, 5, value5, 2));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_encoder_encode(encoder, 6, &value6, 1));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_encoder_encode(encoder, 7, &value7, 1));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_encoder_encode(encoder, 8, &value8, 1));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_encoder_encode(encoder, 9, &value9, 1));
+
+  /* Encode nested messages */
+  pb_encoder_frame_t frame;
+  for (pb_tag_t tag = 10; tag <= 11; tag++) {
+    ck_assert_uint_eq(PB_ERROR_NONE,
+      pb_encoder_begin_nested(encoder, tag, &frame));
+    ck_assert_uint_eq(PB_ERROR_NONE,
+      pb_encoder_encode(encoder, 1, &value10, 1));
+    pb_encoder_end_nested(encoder);
+  }
+}
+
+/*
+ * Read JSON from a null-terminated string.
+ */
+static pb_error_t
+read_chars(pb_encoder_t *encoder, const char json[]) {
+  return pb_json_read(encoder, (const uint8_t *)json, strlen(json));
+}
+
+/* ----------------------------------------------------------------------------
+ * Descriptors
+ * ------------------------------------------------------------------------- */
+
+/* Enum descriptor */
+static pb_enum_descriptor_t
+enum_descriptor = { {
+  (const pb_enum_value_descriptor_t []){
+    {  0, "V00" },
+    {  1, "V01" },
+    {  2, "V02" }
+  }, 3 } };
+
+/* Descriptor */
+static pb_descriptor_t
+descriptor = { {
+  (const pb_field_descriptor_t []){
+    {  1, "F01", INT32,   OPTIONAL },
+    {  2, "F02", UINT64,  OPTIONAL },
+    {  3, "F03", SINT32,  OPTIONAL },
+    {  4, "F04", BOOL,    OPTIONAL },
+    {  5, "F05", FLOAT,   REPEATED, NULL, NULL, PACKED },
+    {  6, "F06", DOUBLE,  OPTIONAL },
+    {  7, "F07", STRING,  OPTIONAL },
+    {  8, "F08", BYTES,   OPTIONAL },
+    {  9, "F09", ENUM,    OPTIONAL, &enum_descriptor },
+    { 10, "F10", MESSAGE, OPTIONAL, &descriptor },
+    { 11, "F11", MESSAGE, REPEATED, &descriptor }
+  }, 11 } };
+
+/* ----------------------------------------------------------------------------
+ * Tests
+ * ------------------------------------------------------------------------- */
+
+/*
+ * Write a message as JSON.
+ */
+START_TEST(test_write) {
+  const char json[] =
+    "{\"F01\":-1,\"F02\":\"18446744073709551615\",\"F03\":-2,\"F04\":true,"
+    "\"F05\":[1.5,-0.25],\"F06\":0.1,\"F07\":\"a\\\"b\\n\\u0001\","
+    "\"F08\":\"AAECAw==\",\"F09\":\"V01\",\"F10\":{\"F01\":7},"
+    "\"F11\":[{\"F01\":7}]}";
+
+  /* Create encoder and encode message */
+  pb_encoder_t encoder = pb_encoder_create(&descriptor);
+  encode(&encoder);
+
+  /* Create decoder and write message as JSON */
+  pb_buffer_t  buffer  = pb_buffer_create_empty();
+  pb_decoder_t decoder = pb_decoder_create(&descriptor,
+    pb_encoder_buffer(&encoder));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_json_write(&decoder, &buffer));
+
+  /* Assert buffer size and contents */
+  ck_assert_uint_eq(sizeof(json) - 1, pb_buffer_size(&buffer));
+  fail_if(memcmp(json, pb_buffer_data(&buffer), sizeof(json) - 1));
+
+  /* Free all allocated memory */
+  pb_decoder_destroy(&decoder);
+  pb_buffer_destroy(&buffer);
+  pb_encoder_destroy(&encoder);
+} END_TEST
+
+/*
+ * Write an empty message and an unknown enum value as JSON.
+ */
+START_TEST(test_write_empty) {
+  pb_encoder_t encoder = pb_encoder_create(&descriptor);
+  pb_buffer_t  buffer  = pb_buffer_create_empty();
+  pb_decoder_t decoder = pb_decoder_create(&descriptor,
+    pb_encoder_buffer(&encoder));
+
+  /* Write empty message */
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_json_write(&decoder, &buffer));
+  ck_assert_uint_eq(2, pb_buffer_size(&buffer));
+  fail_if(memcmp("{}", pb_buffer_data(&buffer), 2));
+
+  /* Write unknown enum value, appending to buffer */
+  pb_buffer_t message = pb_buffer_create((uint8_t []){ 72, 5 }, 2);
+  decoder = pb_decoder_create(&descriptor, &message);
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_json_write(&decoder, &buffer));
+  ck_assert_uint_eq(11, pb_buffer_size(&buffer));
+  fail_if(memcmp("{}{\"F09\":5}", pb_buffer_data(&buffer), 11));
+
+  /* Free all allocated memory */
+  pb_decoder_destroy(&decoder);
+  pb_buffer_destroy(&message);
+  pb_buffer_destroy(&buffer);
+  pb_encoder_destroy(&encoder);
+} END_TEST
+
+/*
+ * Write an invalid message as JSON.
+ */
+START_TEST(test_write_invalid) {
+  const uint8_t data[] = { 82, 4, 8, 1, 8 };
+  const size_t  size   = 5;
+
+  /* Create buffer and decoder */
+  pb_buffer_t  buffer  = pb_buffer_create_empty();
+  pb_buffer_t  message = pb_buffer_create(data, size);
+  pb_decoder_t decoder = pb_decoder_create(&descriptor, &message);
+
+  /* Assert error and unchanged buffer */
+  fail_if(pb_json_write(&decoder, &buffer) == PB_ERROR_NONE);
+  ck_assert_uint_eq(0, pb_buffer_size(&buffer));
+
+  /* Free all allocated memory */
+  pb_decoder_destroy(&decoder);
+  pb_buffer_destroy(&message);
+  pb_buffer_destroy(&buffer);
+} END_TEST
+
+/*
+ * Read a message from JSON that was written from it.
+ */
+START_TEST(test_read) {
+  pb_encoder_t encoder1 = pb_encoder_create(&descriptor);
+  pb_encoder_t encoder2 = pb_encoder_create(&descriptor);
+  encode(&encoder1);
+
+  /* Write message as JSON */
+  pb_buffer_t  buffer  = pb_buffer_create_empty();
+  pb_decoder_t decoder = pb_decoder_create(&descriptor,
+    pb_encoder_buffer(&encoder1));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_json_write(&decoder, &buffer));
+
+  /* Read message from JSON */
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_json_read(&encoder2,
+    pb_buffer_data(&buffer), pb_buffer_size(&buffer)));
+
+  /* Assert encoder buffer size and contents */
+  const pb_buffer_t *buffer1 = pb_encoder_buffer(&encoder1),
+                    *buffer2 = pb_encoder_buffer(&encoder2);
+  ck_assert_uint_eq(pb_buffer_size(buffer1), pb_buffer_size(buffer2));
+  fail_if(memcmp(pb_buffer_data(buffer1), pb_buffer_data(buffer2),
+    pb_buffer_size(buffer1)));
+
+  /* Free all allocated memory */
+  pb_decoder_destroy(&decoder);
+  pb_buffer_destroy(&buffer);
+  pb_encoder_destroy(&encoder2);
+  pb_encoder_destroy(&encoder1);
+} END_TEST
+
+/*
+ * Read a message from JSON with whitespace, quoted numbers and escapes.
+ */
+START_TEST(test_read_lenient) {
+  const char json[] =
+    " {\n \"F01\" : \"-1\", \"F02\": 18446744073709551615,\n"
+    "  \"F05\": [\"Infinity\", 2e1], \"F07\": \"\\u00e4\\ud83d\\ude00\\/\",\n"
+    "  \"F08\": \"AAEC-_8\", \"F09\": 2, \"F10\": null, \"F11\": [] }\t";
+
+  /* Create encoder and read message from JSON */
+  pb_encoder_t encoder = pb_encoder_create(&descriptor);
+  ck_assert_uint_eq(PB_ERROR_NONE, read_chars(&encoder, json));
+
+  /* Assert encoder buffer size and contents */
+  const uint8_t data[] = {
+    8, 255, 255, 255, 255, 255, 255, 255, 255, 255, 1,
+    16, 255, 255, 255, 255, 255, 255, 255, 255, 255, 1,
+    42, 8, 0, 0, 128, 127, 0, 0, 160, 65,
+    58, 7, 195, 164, 240, 159, 152, 128, 47,
+    66, 5, 0, 1, 2, 251, 255,
+    72, 2
+  };
+  const pb_buffer_t *buffer = pb_encoder_buffer(&encoder);
+  ck_assert_uint_eq(sizeof(data), pb_buffer_size(buffer));
+  fail_if(memcmp(data, pb_buffer_data(buffer), sizeof(data)));
+
+  /* Free all allocated memory */
+  pb_encoder_destroy(&encoder);
+} END_TEST
+
+/*
+ * Read a message from JSON with unknown members.
+ */
+START_TEST(test_read_unknown) {
+  const char json[] =
+    "{\"F99\":{\"a\":[1,true,null,\"\\\"\",{}]},\"F01\":1,\"F00\":false}";
+
+  /* Create encoder and read message from JSON */
+  pb_encoder_t encoder = pb_encoder_create(&descriptor);
+  ck_assert_uint_eq(PB_ERROR_NONE, read_chars(&encoder, json));
+
+  /* Assert encoder buffer size and contents */
+  const pb_buffer_t *buffer = pb_encoder_buffer(&encoder);
+  ck_assert_uint_eq(2, pb_buffer_size(buffer));
+  fail_if(memcmp((uint8_t []){ 8, 1 }, pb_buffer_data(buffer), 2));
+
+  /* Free all allocated memory */
+  pb_encoder_destroy(&encoder);
+} END_TEST
+
+/*
+ * Read a message from invalid JSON.
+ */
+START_TEST(test_read_invalid) {
+  const char *json[] = {
+    "",
+    "[]",
+    "{\"F01\":}",
+    "{\"F01\":1",
+    "{\"F01\":1}x",
+    "{\"F01\":1,}",
+    "{\"F01\":1.5}",
+    "{\"F01\":2147483648}",
+    "{\"F02\":-1}",
+    "{\"F04\":1}",
+    "{\"F05\":1}",
+    "{\"F06\":\"0x1p3\"}",
+    "{\"F07\":\"\\x\"}",
+    "{\"F07\":\"\\udc00\"}",
+    "{\"F07\":\"\n\"}",
+    "{\"F08\":\"A\"}",
+    "{\"F09\":\"V99\"}",
+    "{\"F09\":99}",
+    "{\"F10\":[]}"
+  };
+
+  /* Assert error for every JSON */
+  for (size_t j = 0; j < sizeof(json) / sizeof(*json); j++) {
+    pb_encoder_t encoder = pb_encoder_create(&descriptor);
+    ck_assert_uint_eq(PB_ERROR_INVALID, read_chars(&encoder, json[j]));
+    pb_encoder_destroy(&encoder);
+  }
+} END_TEST
+
+/*
+ * Read a message from JSON exceeding the maximum nesting depth.
+ */
+START_TEST(test_read_depth) {
+  char json[1024] = "";
+  for (size_t d = 0; d < 100; d++)
+    strcat(json, "{\"F10\":");
+  strcat(json, "{}");
+  for (size_t d = 0; d < 100; d++)
+    strcat(json, "}");
+
+  /* Create encoder and assert error */
+  pb_encoder_t encoder = pb_encoder_create(&descriptor);
+  ck_assert_uint_eq(PB_ERROR_DEPTH, read_chars(&encoder, json));
+
+  /* Free all allocated memory */
+  pb_encoder_destroy(&encoder);
+} END_TEST
+
+/* ----------------------------------------------------------------------------
+ * Program
+ * ------------------------------------------------------------------------- */
+
+/*
+ * Create a test suite for all registered test cases and run it.
+ *
+ * Tests must be run sequentially (in no-fork mode) or code coverage
+ * cannot be determined properly.
+ */
+int
+main(void) {
+  void *suite = suite_create("protobluff/util/json"),
+       *tcase = NULL;
+
+  /* Add tests to test case "write" */
+  tcase = tcase_create("write");
+  tcase_add_test(tcase, test_write);
+  tcase_add_test(tcase, test_write_empty);
+  tcase_add_test(tcase, test_write_invalid);
+  suite_add_tcase(suite, tcase);
+
+  /* Add tests to test case "read" */
+  tcase = tcase_create("read");
+  tcase_add_test(tcase, test_read);
+  tcase_add_test(tcase, test_read_lenient);
+  tcase_add_test(tcase, test_read_unknown);
+  tcase_add_test(tcase, test_read_invalid);
+  tcase_add_test(tcase, test_read_depth);
+  suite_add_tcase(suite, tcase);
+
+  /* Create a test suite runner in no-fork mode */
+  void *runner = srunner_create(suite);
+  srunner_set_fork_status(runner, CK_NOFORK);
+
+  /* Execute test suite runner */
+  srunner_run_all(runner, CK_NORMAL);
+  int failed = srunner_ntests_failed(runner);
+  srunner_free(runner);
+
+  /* Exit with status code */
+  return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
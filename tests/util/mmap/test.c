@@ -0,0 +1,442 @@
+/*
+ * Copyright (c) 2013-2020 Martin Donath <martin.donath@squidfunk.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#define _GNU_SOURCE
+
+#include <check.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "core/buffer.h"
+#include "core/common.h"
+#include "message/journal.h"
+#include "util/mmap.h"
+
+/* ----------------------------------------------------------------------------
+ * Helper functions
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Create a temporary file with the given contents.
+ *
+ * \param[out] path   Path
+ * \param[in]  data[] Raw data
+ * \param[in]  size   Raw data size
+ */
+static void
+file_create(char path[], const uint8_t data[], size_t size) {
+  strcpy(path, "/tmp/protobluff-XXXXXX");
+  int fd = mkstemp(path);
+  fail_if(fd < 0);
+  ck_assert_int_eq(size, write(fd, data, size));
+  close(fd);
+}
+
+/*!
+ * Assert that a file has the given contents.
+ *
+ * \param[in] path   Path
+ * \param[in] data[] Raw data
+ * \param[in] size   Raw data size
+ */
+static void
+file_assert(const char path[], const uint8_t data[], size_t size) {
+  pb_buffer_t buffer = pb_buffer_create_mmap(path, 0);
+  fail_unless(pb_buffer_valid(&buffer));
+  ck_assert_uint_eq(size, pb_buffer_size(&buffer));
+  fail_if(size && memcmp(data, pb_buffer_data(&buffer), size));
+  pb_buffer_destroy(&buffer);
+}
+
+/*!
+ * Create the write-ahead log of a file with the given contents.
+ *
+ * \param[in] path   Path
+ * \param[in] data[] Raw data
+ * \param[in] size   Raw data size
+ * \param[in] valid  Whether to append a valid checksum
+ */
+static void
+log_create(const char path[], const uint8_t data[], size_t size, int valid) {
+  char target[40];
+  snprintf(target, sizeof(target), "%s.wal", path);
+  FILE *file = fopen(target, "wb");
+  fail_unless(file != NULL);
+  ck_assert_uint_eq(size, fwrite(data, 1, size, file));
+
+  /* Append FNV-1a checksum in little-endian byte order */
+  uint64_t hash = 14695981039346656037ULL;
+  for (size_t b = 0; b < size; b++)
+    hash = (hash ^ data[b]) * 1099511628211ULL;
+  if (!valid)
+    hash = ~hash;
+  for (size_t b = 0; b < 8; b++, hash >>= 8)
+    fputc((uint8_t)hash, file);
+  fclose(file);
+}
+
+/*!
+ * Remove a file together with its write-ahead log.
+ *
+ * \param[in] path Path
+ */
+static void
+file_remove(const char path[]) {
+  char target[40];
+  snprintf(target, sizeof(target), "%s.wal", path);
+  unlink(target);
+  unlink(path);
+}
+
+/* ----------------------------------------------------------------------------
+ * Tests
+ * ------------------------------------------------------------------------- */
+
+/*
+ * Create a buffer by mapping a file.
+ */
+START_TEST(test_buffer_create) {
+  const uint8_t data[] = "SOME DATA";
+  const size_t  size   = 9;
+
+  /* Create file and buffer */
+  char path[32];
+  file_create(path, data, size);
+  pb_buffer_t buffer = pb_buffer_create_mmap(path, PB_MMAP_SEQUENTIAL);
+
+  /* Assert buffer validity and error */
+  fail_unless(pb_buffer_valid(&buffer));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_buffer_error(&buffer));
+
+  /* Assert buffer size and contents */
+  ck_assert_uint_eq(size, pb_buffer_size(&buffer));
+  fail_if(memcmp(data, pb_buffer_data(&buffer), size));
+
+  /* Free all allocated memory */
+  pb_buffer_destroy(&buffer);
+  unlink(path);
+} END_TEST
+
+/*
+ * Create a buffer by mapping an empty file.
+ */
+START_TEST(test_buffer_create_empty) {
+  char path[32];
+  file_create(path, NULL, 0);
+  pb_buffer_t buffer = pb_buffer_create_mmap(path, PB_MMAP_RANDOM);
+
+  /* Assert buffer validity and size */
+  fail_unless(pb_buffer_valid(&buffer));
+  ck_assert_uint_eq(0, pb_buffer_size(&buffer));
+
+  /* Free all allocated memory */
+  pb_buffer_destroy(&buffer);
+  unlink(path);
+} END_TEST
+
+/*
+ * Create a buffer by mapping a file that doesn't exist.
+ */
+START_TEST(test_buffer_create_invalid) {
+  pb_buffer_t buffer = pb_buffer_create_mmap("/tmp/protobluff-missing", 0);
+
+  /* Assert buffer validity and error */
+  fail_if(pb_buffer_valid(&buffer));
+  ck_assert_uint_eq(PB_ERROR_ALLOC, pb_buffer_error(&buffer));
+
+  /* Free all allocated memory */
+  pb_buffer_destroy(&buffer);
+} END_TEST
+
+/*
+ * Create a read-only journal by mapping a file.
+ */
+START_TEST(test_journal_create) {
+  const uint8_t data[] = "SOME DATA";
+  const size_t  size   = 9;
+
+  /* Create file and journal */
+  char path[32];
+  file_create(path, data, size);
+  pb_journal_t journal = pb_journal_create_mmap(path, 0);
+
+  /* Assert journal validity and read-only flag */
+  fail_unless(pb_journal_valid(&journal));
+  fail_unless(pb_journal_frozen(&journal));
+
+  /* Assert journal size and contents */
+  ck_assert_uint_eq(size, pb_journal_size(&journal));
+  fail_if(memcmp(data, pb_journal_data(&journal), size));
+
+  /* Assert failing write */
+  uint8_t new_data[] = "NEW STUFF";
+  ck_assert_uint_eq(PB_ERROR_INVALID,
+    pb_journal_write(&journal, 0, 0, size, new_data, size));
+
+  /* Free all allocated memory */
+  pb_journal_destroy(&journal);
+  unlink(path);
+} END_TEST
+
+/*
+ * Create a private journal by mapping a file and write to it.
+ */
+START_TEST(test_journal_create_private) {
+  const uint8_t data[] = "SOME DATA";
+  const size_t  size   = 9;
+
+  /* Create file and journal */
+  char path[32];
+  file_create(path, data, size);
+  pb_journal_t journal = pb_journal_create_mmap(path, PB_MMAP_PRIVATE);
+
+  /* Assert journal validity and read-only flag */
+  fail_unless(pb_journal_valid(&journal));
+  fail_if(pb_journal_frozen(&journal));
+
+  /* Update journal in place: "SOME DATA" => "NEW STUFF" */
+  uint8_t new_data[] = "NEW STUFF";
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_journal_write(&journal, 0, 0, size, new_data, size));
+  fail_if(memcmp(new_data, pb_journal_data(&journal), size));
+
+  /* Update journal: "NEW STUFF" => "NEW OTHER STUFF" */
+  uint8_t other_data[] = "OTHER ";
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_journal_write(&journal, 4, 4, 4, other_data, 6));
+  ck_assert_uint_eq(15, pb_journal_size(&journal));
+  fail_if(memcmp("NEW OTHER STUFF", pb_journal_data(&journal), 15));
+
+  /* Assert unchanged file */
+  pb_buffer_t buffer = pb_buffer_create_mmap(path, 0);
+  ck_assert_uint_eq(size, pb_buffer_size(&buffer));
+  fail_if(memcmp(data, pb_buffer_data(&buffer), size));
+
+  /* Free all allocated memory */
+  pb_buffer_destroy(&buffer);
+  pb_journal_destroy(&journal);
+  unlink(path);
+} END_TEST
+
+/*
+ * Create a persistent journal by mapping a file and save edits to it.
+ */
+START_TEST(test_journal_create_persistent) {
+  const uint8_t data[] = "SOME DATA";
+  const size_t  size   = 9;
+
+  /* Create file and journal */
+  char path[32];
+  file_create(path, data, size);
+  pb_journal_t journal = pb_journal_create_mmap(path, PB_MMAP_PERSISTENT);
+
+  /* Assert journal validity and read-only flag */
+  fail_unless(pb_journal_valid(&journal));
+  fail_if(pb_journal_frozen(&journal));
+
+  /* Update journal in place and save: "SOME DATA" => "SOME TEXT" */
+  uint8_t new_data[] = "TEXT";
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_journal_write(&journal, 5, 5, 9, new_data, 4));
+  file_assert(path, data, size);
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_journal_save_mmap(&journal, path));
+  file_assert(path, (const uint8_t *)"SOME TEXT", 9);
+
+  /* Update journal and save: "SOME TEXT" => "SOME OTHER TEXT" */
+  uint8_t other_data[] = "OTHER ";
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_journal_write(&journal, 5, 5, 5, other_data, 6));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_journal_save_mmap(&journal, path));
+  file_assert(path, (const uint8_t *)"SOME OTHER TEXT", 15);
+
+  /* Assert empty write-ahead log */
+  char target[40];
+  snprintf(target, sizeof(target), "%s.wal", path);
+  file_assert(target, NULL, 0);
+
+  /* Save without edits */
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_journal_save_mmap(&journal, path));
+  file_assert(path, (const uint8_t *)"SOME OTHER TEXT", 15);
+
+  /* Free all allocated memory */
+  pb_journal_destroy(&journal);
+  file_remove(path);
+} END_TEST
+
+/*
+ * Save a persistent journal which shrinks and grows again.
+ */
+START_TEST(test_journal_create_persistent_shrink) {
+  const uint8_t data[] = "SOME DATA";
+  const size_t  size   = 9;
+
+  /* Create file and journal */
+  char path[32];
+  file_create(path, data, size);
+  pb_journal_t journal = pb_journal_create_mmap(path, PB_MMAP_PERSISTENT);
+
+  /* Shrink journal and save: "SOME DATA" => "SOME" */
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_journal_clear(&journal, 4, 4, 9));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_journal_save_mmap(&journal, path));
+  file_assert(path, (const uint8_t *)"SOME", 4);
+
+  /* Grow journal and save: "SOME" => "SOME MORE DATA" */
+  uint8_t new_data[] = " MORE DATA";
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_journal_write(&journal, 4, 4, 4, new_data, 10));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_journal_save_mmap(&journal, path));
+  file_assert(path, (const uint8_t *)"SOME MORE DATA", 14);
+
+  /* Reopen file and assert contents */
+  pb_journal_destroy(&journal);
+  journal = pb_journal_create_mmap(path, PB_MMAP_PERSISTENT);
+  ck_assert_uint_eq(14, pb_journal_size(&journal));
+  fail_if(memcmp("SOME MORE DATA", pb_journal_data(&journal), 14));
+
+  /* Free all allocated memory */
+  pb_journal_destroy(&journal);
+  file_remove(path);
+} END_TEST
+
+/*
+ * Create a persistent journal from a file with a complete write-ahead log.
+ */
+START_TEST(test_journal_create_persistent_recover) {
+  const uint8_t data[] = "SOME DATA";
+  const size_t  size   = 9;
+
+  /* Create file and write-ahead log of an interrupted save */
+  char path[32];
+  file_create(path, data, size);
+  const uint8_t log[] = { 11, 5, 6, 'O', 'T', 'H', 'E', 'R', ' ',
+                              11, 0 };
+  log_create(path, log, sizeof(log), 1);
+
+  /* Create journal and assert recovered contents */
+  pb_journal_t journal = pb_journal_create_mmap(path, PB_MMAP_PERSISTENT);
+  fail_unless(pb_journal_valid(&journal));
+  ck_assert_uint_eq(11, pb_journal_size(&journal));
+  fail_if(memcmp("SOME OTHER ", pb_journal_data(&journal), 11));
+
+  /* Assert empty write-ahead log */
+  char target[40];
+  snprintf(target, sizeof(target), "%s.wal", path);
+  file_assert(target, NULL, 0);
+
+  /* Free all allocated memory */
+  pb_journal_destroy(&journal);
+  file_remove(path);
+} END_TEST
+
+/*
+ * Create a persistent journal from a file with a torn write-ahead log.
+ */
+START_TEST(test_journal_create_persistent_recover_torn) {
+  const uint8_t data[] = "SOME DATA";
+  const size_t  size   = 9;
+
+  /* Create file and torn write-ahead log */
+  char path[32];
+  file_create(path, data, size);
+  const uint8_t log[] = { 11, 5, 6, 'O', 'T', 'H' };
+  log_create(path, log, sizeof(log), 0);
+
+  /* Create journal and assert unaltered contents */
+  pb_journal_t journal = pb_journal_create_mmap(path, PB_MMAP_PERSISTENT);
+  fail_unless(pb_journal_valid(&journal));
+  ck_assert_uint_eq(size, pb_journal_size(&journal));
+  fail_if(memcmp(data, pb_journal_data(&journal), size));
+
+  /* Free all allocated memory */
+  pb_journal_destroy(&journal);
+  file_remove(path);
+} END_TEST
+
+/*
+ * Save a journal which is not persistent.
+ */
+START_TEST(test_journal_save_invalid) {
+  const uint8_t data[] = "SOME DATA";
+  const size_t  size   = 9;
+
+  /* Create file and journal */
+  char path[32];
+  file_create(path, data, size);
+  pb_journal_t journal = pb_journal_create_mmap(path, PB_MMAP_PRIVATE);
+
+  /* Assert failing save */
+  ck_assert_uint_eq(PB_ERROR_INVALID, pb_journal_save_mmap(&journal, path));
+
+  /* Free all allocated memory */
+  pb_journal_destroy(&journal);
+  file_remove(path);
+} END_TEST
+
+/* ----------------------------------------------------------------------------
+ * Program
+ * ------------------------------------------------------------------------- */
+
+/*
+ * Create a test suite for all registered test cases and run it.
+ *
+ * Tests must be run sequentially (in no-fork mode) or code coverage
+ * cannot be determined properly.
+ */
+int
+main(void) {
+  void *suite = suite_create("protobluff/util/mmap"),
+       *tcase = NULL;
+
+  /* Add tests to test case "buffer" */
+  tcase = tcase_create("buffer");
+  tcase_add_test(tcase, test_buffer_create);
+  tcase_add_test(tcase, test_buffer_create_empty);
+  tcase_add_test(tcase, test_buffer_create_invalid);
+  suite_add_tcase(suite, tcase);
+
+  /* Add tests to test case "journal" */
+  tcase = tcase_create("journal");
+  tcase_add_test(tcase, test_journal_create);
+  tcase_add_test(tcase, test_journal_create_private);
+  tcase_add_test(tcase, test_journal_create_persistent);
+  tcase_add_test(tcase, test_journal_create_persistent_shrink);
+  tcase_add_test(tcase, test_journal_create_persistent_recover);
+  tcase_add_test(tcase, test_journal_create_persistent_recover_torn);
+  tcase_add_test(tcase, test_journal_save_invalid);
+  suite_add_tcase(suite, tcase);
+
+  /* Create a test suite runner in no-fork mode */
+  void *runner = srunner_create(suite);
+  srunner_set_fork_status(runner, CK_NOFORK);
+
+  /* Execute test suite runner */
+  srunner_run_all(runner, CK_NORMAL);
+  int failed = srunner_ntests_failed(runner);
+  srunner_free(runner);
+
+  /* Exit with status code */
+  return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
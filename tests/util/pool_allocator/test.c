@@ -0,0 +1,343 @@
+/*
+ * Copyright (c) 2013-2020 Martin Donath <martin.donath@squidfunk.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <check.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "core/common.h"
+#include "util/pool_allocator.h"
+
+/* ----------------------------------------------------------------------------
+ * Variables
+ * ------------------------------------------------------------------------- */
+
+/* Number of trim hook invocations */
+static size_t trimmed = 0;
+
+/* ----------------------------------------------------------------------------
+ * Helper functions
+ * ------------------------------------------------------------------------- */
+
+/*
+ * Count invocations of a trim hook.
+ */
+static void
+trim_count(void) {
+  trimmed++;
+}
+
+/*
+ * Allocate a memory block from another thread.
+ */
+static void *
+thread_allocate(void *data) {
+  return pb_allocator_allocate(data, 3000);
+}
+
+/*
+ * Allocate and free a memory block from another thread.
+ */
+static void *
+thread_allocate_free(void *data) {
+  void *block = pb_allocator_allocate(data, 8000);
+  pb_allocator_free(data, block);
+  return block;
+}
+
+/* ----------------------------------------------------------------------------
+ * Tests
+ * ------------------------------------------------------------------------- */
+
+/*
+ * Create a pool allocator.
+ */
+START_TEST(test_create) {
+  pb_allocator_t allocator1 = pb_pool_allocator_create();
+  ck_assert_ptr_ne(NULL, allocator1.data);
+
+  /* Assert shared pool */
+  pb_allocator_t allocator2 = pb_pool_allocator_create();
+  ck_assert_ptr_eq(allocator1.data, allocator2.data);
+} END_TEST
+
+/*
+ * Allocate a memory block of given size.
+ */
+START_TEST(test_allocate) {
+  pb_allocator_t allocator = pb_pool_allocator_create();
+
+  /* Allocate two blocks */
+  void *block1 = pb_allocator_allocate(&allocator, 10);
+  ck_assert_ptr_ne(NULL, block1);
+  void *block2 = pb_allocator_allocate(&allocator, 10);
+  ck_assert_ptr_ne(NULL, block2);
+
+  /* Assert different and aligned blocks */
+  ck_assert_ptr_ne(block1, block2);
+  ck_assert_uint_eq(0, (uintptr_t)block1 % 16);
+  ck_assert_uint_eq(0, (uintptr_t)block2 % 16);
+
+  /* Free all allocated memory */
+  pb_allocator_free(&allocator, block1);
+  pb_allocator_free(&allocator, block2);
+} END_TEST
+
+/*
+ * Allocate a memory block exceeding the largest size class.
+ */
+START_TEST(test_allocate_exceeding) {
+  pb_allocator_t allocator = pb_pool_allocator_create();
+
+  /* Allocate a large block */
+  uint8_t *block = pb_allocator_allocate(&allocator, 100000);
+  ck_assert_ptr_ne(NULL, block);
+  memset(block, 42, 100000);
+
+  /* Free all allocated memory */
+  pb_allocator_free(&allocator, block);
+} END_TEST
+
+/*
+ * Allocate a memory block from an invalid pool allocator.
+ */
+START_TEST(test_allocate_invalid) {
+  pb_allocator_t allocator = pb_pool_allocator_create();
+  allocator.data = NULL;
+
+  /* Assert allocation failure */
+  ck_assert_ptr_eq(NULL, pb_allocator_allocate(&allocator, 10));
+  ck_assert_ptr_eq(NULL, pb_allocator_resize(&allocator, NULL, 10));
+} END_TEST
+
+/*
+ * Change the size of a previously allocated memory block.
+ */
+START_TEST(test_resize) {
+  pb_allocator_t allocator = pb_pool_allocator_create();
+
+  /* Allocate a block */
+  uint8_t *block1 = pb_allocator_resize(&allocator, NULL, 40);
+  ck_assert_ptr_ne(NULL, block1);
+  memset(block1, 42, 40);
+
+  /* Resize block within its size class */
+  ck_assert_ptr_eq(block1, pb_allocator_resize(&allocator, block1, 64));
+  ck_assert_ptr_eq(block1, pb_allocator_resize(&allocator, block1, 8));
+
+  /* Resize block beyond its size class */
+  uint8_t *block2 = pb_allocator_resize(&allocator, block1, 400);
+  ck_assert_ptr_ne(NULL, block2);
+  ck_assert_ptr_ne(block1, block2);
+
+  /* Assert copied contents */
+  ck_assert_uint_eq(42, block2[0]);
+  ck_assert_uint_eq(42, block2[39]);
+
+  /* Free all allocated memory */
+  pb_allocator_free(&allocator, block2);
+} END_TEST
+
+/*
+ * Change the size of a memory block exceeding the largest size class.
+ */
+START_TEST(test_resize_exceeding) {
+  pb_allocator_t allocator = pb_pool_allocator_create();
+
+  /* Allocate a block and grow it beyond the largest size class */
+  uint8_t *block = pb_allocator_allocate(&allocator, 50000);
+  ck_assert_ptr_ne(NULL, block);
+  memset(block, 42, 50000);
+  block = pb_allocator_resize(&allocator, block, 100000);
+  ck_assert_ptr_ne(NULL, block);
+  block = pb_allocator_resize(&allocator, block, 200000);
+  ck_assert_ptr_ne(NULL, block);
+
+  /* Assert copied contents */
+  ck_assert_uint_eq(42, block[0]);
+  ck_assert_uint_eq(42, block[49999]);
+
+  /* Free all allocated memory */
+  pb_allocator_free(&allocator, block);
+} END_TEST
+
+/*
+ * Free an allocated memory block and reuse it.
+ */
+START_TEST(test_free) {
+  pb_allocator_t allocator = pb_pool_allocator_create();
+
+  /* Allocate and free a block */
+  void *block = pb_allocator_allocate(&allocator, 100);
+  ck_assert_ptr_ne(NULL, block);
+  pb_allocator_free(&allocator, block);
+
+  /* Assert reused block of the same size class */
+  ck_assert_ptr_eq(block, pb_allocator_allocate(&allocator, 120));
+  pb_allocator_free(&allocator, block);
+} END_TEST
+
+/*
+ * Free many allocated memory blocks, exceeding the thread-local cache.
+ */
+START_TEST(test_free_exceeding) {
+  pb_allocator_t allocator = pb_pool_allocator_create();
+
+  /* Allocate and free many blocks */
+  void *block[256];
+  for (size_t b = 0; b < 256; b++) {
+    block[b] = pb_allocator_allocate(&allocator, 200);
+    ck_assert_ptr_ne(NULL, block[b]);
+  }
+  for (size_t b = 0; b < 256; b++)
+    pb_allocator_free(&allocator, block[b]);
+
+  /* Assert reused block of the same size class */
+  ck_assert_ptr_eq(block[255], pb_allocator_allocate(&allocator, 200));
+  pb_allocator_free(&allocator, block[255]);
+} END_TEST
+
+/*
+ * Free a memory block allocated by another thread.
+ */
+START_TEST(test_free_thread) {
+  pb_allocator_t allocator = pb_pool_allocator_create();
+
+  /* Allocate a block from another thread */
+  pthread_t thread; void *block;
+  ck_assert_int_eq(0, pthread_create(&thread, NULL,
+    thread_allocate, &allocator));
+  ck_assert_int_eq(0, pthread_join(thread, &block));
+  ck_assert_ptr_ne(NULL, block);
+
+  /* Free block and assert reuse */
+  pb_allocator_free(&allocator, block);
+  ck_assert_ptr_eq(block, pb_allocator_allocate(&allocator, 3000));
+  pb_allocator_free(&allocator, block);
+} END_TEST
+
+/*
+ * Reuse a memory block released into the depot on thread exit.
+ */
+START_TEST(test_free_thread_exit) {
+  pb_allocator_t allocator = pb_pool_allocator_create();
+
+  /* Allocate and free a block from another thread */
+  pthread_t thread; void *block;
+  ck_assert_int_eq(0, pthread_create(&thread, NULL,
+    thread_allocate_free, &allocator));
+  ck_assert_int_eq(0, pthread_join(thread, &block));
+  ck_assert_ptr_ne(NULL, block);
+
+  /* Assert reused block from depot */
+  ck_assert_ptr_eq(block, pb_allocator_allocate(&allocator, 8000));
+  pb_allocator_free(&allocator, block);
+} END_TEST
+
+/*
+ * Return all free memory blocks to the system.
+ */
+START_TEST(test_trim) {
+  pb_allocator_t allocator = pb_pool_allocator_create();
+
+  /* Allocate and free many blocks, filling cache and depot */
+  void *block[256];
+  for (size_t b = 0; b < 256; b++) {
+    block[b] = pb_allocator_allocate(&allocator, 200);
+    ck_assert_ptr_ne(NULL, block[b]);
+  }
+  for (size_t b = 0; b < 256; b++)
+    pb_allocator_free(&allocator, block[b]);
+
+  /* Register hook twice and trim all allocators */
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_allocator_trim_register(trim_count));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_allocator_trim_register(trim_count));
+  pb_allocator_trim();
+  ck_assert_uint_eq(1, trimmed);
+
+  /* Assert pool is still usable */
+  void *temp = pb_allocator_allocate(&allocator, 200);
+  ck_assert_ptr_ne(NULL, temp);
+  pb_allocator_free(&allocator, temp);
+  pb_pool_allocator_trim();
+} END_TEST
+
+/* ----------------------------------------------------------------------------
+ * Program
+ * ------------------------------------------------------------------------- */
+
+/*
+ * Create a test suite for all registered test cases and run it.
+ *
+ * Tests must be run sequentially (in no-fork mode) or code coverage
+ * cannot be determined properly.
+ */
+int
+main(void) {
+  void *suite = suite_create("protobluff/util/pool_allocator"),
+       *tcase = NULL;
+
+  /* Add tests to test case "create" */
+  tcase = tcase_create("create");
+  tcase_add_test(tcase, test_create);
+  suite_add_tcase(suite, tcase);
+
+  /* Add tests to test case "allocate" */
+  tcase = tcase_create("allocate");
+  tcase_add_test(tcase, test_allocate);
+  tcase_add_test(tcase, test_allocate_exceeding);
+  tcase_add_test(tcase, test_allocate_invalid);
+  suite_add_tcase(suite, tcase);
+
+  /* Add tests to test case "resize" */
+  tcase = tcase_create("resize");
+  tcase_add_test(tcase, test_resize);
+  tcase_add_test(tcase, test_resize_exceeding);
+  suite_add_tcase(suite, tcase);
+
+  /* Add tests to test case "free" */
+  tcase = tcase_create("free");
+  tcase_add_test(tcase, test_free);
+  tcase_add_test(tcase, test_free_exceeding);
+  tcase_add_test(tcase, test_free_thread);
+  tcase_add_test(tcase, test_free_thread_exit);
+  suite_add_tcase(suite, tcase);
+
+  /* Add tests to test case "trim" */
+  tcase = tcase_create("trim");
+  tcase_add_test(tcase, test_trim);
+  suite_add_tcase(suite, tcase);
+
+  /* Create a test suite runner in no-fork mode */
+  void *runner = srunner_create(suite);
+  srunner_set_fork_status(runner, CK_NOFORK);
+
+  /* Execute test suite runner */
+  srunner_run_all(runner, CK_NORMAL);
+  int failed = srunner_ntests_failed(runner);
+  srunner_free(runner);
+
+  /* Exit with status code */
+  return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,319 @@
+/*
+ * Copyright (c) 2013-2020 Martin Donath <martin.donath@squidfunk.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <check.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "core/allocator.h"
+#include "core/common.h"
+#include "util/arena_allocator.h"
+#include "util/tracing_allocator.h"
+
+/* ----------------------------------------------------------------------------
+ * Tests
+ * ------------------------------------------------------------------------- */
+
+/*
+ * Create a tracing allocator.
+ */
+START_TEST(test_create) {
+  pb_allocator_t allocator = pb_tracing_allocator_create(&allocator_default);
+  ck_assert_ptr_ne(NULL, allocator.data);
+  pb_tracing_allocator_destroy(&allocator);
+} END_TEST
+
+/*
+ * Create a tracing allocator with a histogram.
+ */
+START_TEST(test_create_with_histogram) {
+  pb_allocator_t allocator =
+    pb_tracing_allocator_create_with_histogram(&allocator_default);
+  ck_assert_ptr_ne(NULL, allocator.data);
+  pb_tracing_allocator_destroy(&allocator);
+} END_TEST
+
+/*
+ * Allocate memory blocks of given size.
+ */
+START_TEST(test_allocate) {
+  pb_allocator_t allocator = pb_tracing_allocator_create(&allocator_default);
+
+  /* Allocate blocks */
+  void *block1 = pb_allocator_allocate(&allocator, 10);
+  void *block2 = pb_allocator_allocate(&allocator, 100);
+  ck_assert_ptr_ne(NULL, block1);
+  ck_assert_ptr_ne(NULL, block2);
+  ck_assert_uint_eq(0, (uintptr_t)block1 % 16);
+
+  /* Assert statistics */
+  pb_tracing_allocator_stats_t stats =
+    pb_tracing_allocator_stats(&allocator);
+  ck_assert_uint_eq(2, stats.allocations);
+  ck_assert_uint_eq(0, stats.resizes);
+  ck_assert_uint_eq(0, stats.frees);
+  ck_assert_uint_eq(110, stats.requested);
+  ck_assert_uint_eq(110, stats.live);
+  ck_assert_uint_eq(110, stats.peak);
+
+  /* Free all allocated memory */
+  pb_allocator_free(&allocator, block1);
+  pb_allocator_free(&allocator, block2);
+  pb_tracing_allocator_destroy(&allocator);
+} END_TEST
+
+/*
+ * Allocate a memory block from an invalid tracing allocator.
+ */
+START_TEST(test_allocate_invalid) {
+  pb_allocator_t allocator = pb_tracing_allocator_create(&allocator_default);
+  pb_tracing_allocator_destroy(&allocator);
+  allocator.data = NULL;
+
+  /* Assert allocation failure */
+  ck_assert_ptr_eq(NULL, pb_allocator_allocate(&allocator, 10));
+  ck_assert_ptr_eq(NULL, pb_allocator_resize(&allocator, NULL, 10));
+} END_TEST
+
+/*
+ * Change the size of previously allocated memory blocks.
+ */
+START_TEST(test_resize) {
+  pb_allocator_t inner     = pb_arena_allocator_create(1024),
+                 allocator = pb_tracing_allocator_create(&inner);
+
+  /* Allocate blocks */
+  void *block1 = pb_allocator_resize(&allocator, NULL, 10);
+  void *block2 = pb_allocator_allocate(&allocator, 10);
+  ck_assert_ptr_ne(NULL, block1);
+  ck_assert_ptr_ne(NULL, block2);
+
+  /* Resize the last block in place and the first block by moving it */
+  ck_assert_ptr_eq(block2, pb_allocator_resize(&allocator, block2, 20));
+  ck_assert_ptr_ne(block1, pb_allocator_resize(&allocator, block1, 30));
+
+  /* Assert statistics */
+  pb_tracing_allocator_stats_t stats =
+    pb_tracing_allocator_stats(&allocator);
+  ck_assert_uint_eq(1, stats.allocations);
+  ck_assert_uint_eq(3, stats.resizes);
+  ck_assert_uint_eq(70, stats.requested);
+  ck_assert_uint_eq(10, stats.moved);
+  ck_assert_uint_eq(50, stats.live);
+  ck_assert_uint_eq(50, stats.peak);
+
+  /* Free all allocated memory */
+  pb_tracing_allocator_destroy(&allocator);
+  pb_arena_allocator_destroy(&inner);
+} END_TEST
+
+/*
+ * Free an allocated memory block.
+ */
+START_TEST(test_free) {
+  pb_allocator_t allocator = pb_tracing_allocator_create(&allocator_default);
+
+  /* Allocate and free a block */
+  void *block = pb_allocator_allocate(&allocator, 100);
+  ck_assert_ptr_ne(NULL, block);
+  pb_allocator_free(&allocator, block);
+
+  /* Assert statistics */
+  pb_tracing_allocator_stats_t stats =
+    pb_tracing_allocator_stats(&allocator);
+  ck_assert_uint_eq(1, stats.frees);
+  ck_assert_uint_eq(0, stats.live);
+  ck_assert_uint_eq(100, stats.peak);
+
+  /* Free all allocated memory */
+  pb_tracing_allocator_destroy(&allocator);
+} END_TEST
+
+/*
+ * Reset the statistics of a tracing allocator.
+ */
+START_TEST(test_reset) {
+  pb_allocator_t allocator =
+    pb_tracing_allocator_create_with_histogram(&allocator_default);
+
+  /* Allocate blocks and free one of them */
+  void *block1 = pb_allocator_allocate(&allocator, 100);
+  void *block2 = pb_allocator_allocate(&allocator, 10);
+  ck_assert_ptr_ne(NULL, block1);
+  ck_assert_ptr_ne(NULL, block2);
+  pb_allocator_free(&allocator, block1);
+
+  /* Reset and assert statistics */
+  pb_tracing_allocator_reset(&allocator);
+  pb_tracing_allocator_stats_t stats =
+    pb_tracing_allocator_stats(&allocator);
+  ck_assert_uint_eq(0, stats.allocations);
+  ck_assert_uint_eq(0, stats.frees);
+  ck_assert_uint_eq(0, stats.requested);
+  ck_assert_uint_eq(0, stats.histogram[3]);
+  ck_assert_uint_eq(10, stats.live);
+  ck_assert_uint_eq(10, stats.peak);
+
+  /* Free all allocated memory */
+  pb_allocator_free(&allocator, block2);
+  pb_tracing_allocator_destroy(&allocator);
+} END_TEST
+
+/*
+ * Reset the statistics of an invalid tracing allocator.
+ */
+START_TEST(test_reset_invalid) {
+  pb_allocator_t allocator = {
+    .data = NULL
+  };
+  pb_tracing_allocator_reset(&allocator);
+  pb_tracing_allocator_destroy(&allocator);
+} END_TEST
+
+/*
+ * Retrieve the size histogram of a tracing allocator.
+ */
+START_TEST(test_stats_histogram) {
+  pb_allocator_t allocator =
+    pb_tracing_allocator_create_with_histogram(&allocator_default);
+
+  /* Allocate and resize blocks */
+  void *block1 = pb_allocator_allocate(&allocator, 1);
+  void *block2 = pb_allocator_allocate(&allocator, 3);
+  ck_assert_ptr_ne(NULL, block1);
+  ck_assert_ptr_ne(NULL, block2);
+  block1 = pb_allocator_resize(&allocator, block1, 2);
+  block2 = pb_allocator_resize(&allocator, block2, 1024);
+  ck_assert_ptr_ne(NULL, block1);
+  ck_assert_ptr_ne(NULL, block2);
+
+  /* Assert histogram */
+  pb_tracing_allocator_stats_t stats =
+    pb_tracing_allocator_stats(&allocator);
+  ck_assert_uint_eq(1, stats.histogram[0]);
+  ck_assert_uint_eq(2, stats.histogram[1]);
+  ck_assert_uint_eq(1, stats.histogram[10]);
+
+  /* Free all allocated memory */
+  pb_allocator_free(&allocator, block1);
+  pb_allocator_free(&allocator, block2);
+  pb_tracing_allocator_destroy(&allocator);
+} END_TEST
+
+/*
+ * Retrieve statistics of a tracing allocator without a histogram.
+ */
+START_TEST(test_stats_histogram_disabled) {
+  pb_allocator_t allocator = pb_tracing_allocator_create(&allocator_default);
+
+  /* Allocate a block */
+  void *block = pb_allocator_allocate(&allocator, 1);
+  ck_assert_ptr_ne(NULL, block);
+
+  /* Assert empty histogram */
+  pb_tracing_allocator_stats_t stats =
+    pb_tracing_allocator_stats(&allocator);
+  ck_assert_uint_eq(1, stats.allocations);
+  ck_assert_uint_eq(0, stats.histogram[0]);
+
+  /* Free all allocated memory */
+  pb_allocator_free(&allocator, block);
+  pb_tracing_allocator_destroy(&allocator);
+} END_TEST
+
+/*
+ * Retrieve statistics of an invalid tracing allocator.
+ */
+START_TEST(test_stats_invalid) {
+  pb_allocator_t allocator = {
+    .data = NULL
+  };
+
+  /* Assert statistics */
+  pb_tracing_allocator_stats_t stats =
+    pb_tracing_allocator_stats(&allocator);
+  ck_assert_uint_eq(0, stats.allocations);
+  ck_assert_uint_eq(0, stats.live);
+} END_TEST
+
+/* ----------------------------------------------------------------------------
+ * Program
+ * ------------------------------------------------------------------------- */
+
+/*
+ * Create a test suite for all registered test cases and run it.
+ *
+ * Tests must be run sequentially (in no-fork mode) or code coverage
+ * cannot be determined properly.
+ */
+int
+main(void) {
+  void *suite = suite_create("protobluff/util/tracing_allocator"),
+       *tcase = NULL;
+
+  /* Add tests to test case "create" */
+  tcase = tcase_create("create");
+  tcase_add_test(tcase, test_create);
+  tcase_add_test(tcase, test_create_with_histogram);
+  suite_add_tcase(suite, tcase);
+
+  /* Add tests to test case "allocate" */
+  tcase = tcase_create("allocate");
+  tcase_add_test(tcase, test_allocate);
+  tcase_add_test(tcase, test_allocate_invalid);
+  suite_add_tcase(suite, tcase);
+
+  /* Add tests to test case "resize" */
+  tcase = tcase_create("resize");
+  tcase_add_test(tcase, test_resize);
+  suite_add_tcase(suite, tcase);
+
+  /* Add tests to test case "free" */
+  tcase = tcase_create("free");
+  tcase_add_test(tcase, test_free);
+  suite_add_tcase(suite, tcase);
+
+  /* Add tests to test case "reset" */
+  tcase = tcase_create("reset");
+  tcase_add_test(tcase, test_reset);
+  tcase_add_test(tcase, test_reset_invalid);
+  suite_add_tcase(suite, tcase);
+
+  /* Add tests to test case "stats" */
+  tcase = tcase_create("stats");
+  tcase_add_test(tcase, test_stats_histogram);
+  tcase_add_test(tcase, test_stats_histogram_disabled);
+  tcase_add_test(tcase, test_stats_invalid);
+  suite_add_tcase(suite, tcase);
+
+  /* Create a test suite runner in no-fork mode */
+  void *runner = srunner_create(suite);
+  srunner_set_fork_status(runner, CK_NOFORK);
+
+  /* Execute test suite runner */
+  srunner_run_all(runner, CK_NORMAL);
+  int failed = srunner_ntests_failed(runner);
+  srunner_free(runner);
+
+  /* Exit with status code */
+  return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
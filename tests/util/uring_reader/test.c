@@ -0,0 +1,253 @@
+/*
+ * Copyright (c) 2013-2020 Martin Donath <martin.donath@squidfunk.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#define _GNU_SOURCE
+
+#include <check.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "core/buffer.h"
+#include "core/common.h"
+#include "core/varint.h"
+#include "util/uring_reader.h"
+
+/* ----------------------------------------------------------------------------
+ * Helper functions
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * Create a temporary file with messages of the given sizes and open it.
+ *
+ * Every byte of a message is set to the index of the message, so messages
+ * can be checked for consistency.
+ *
+ * \param[in] sizes[] Message sizes
+ * \param[in] count   Message count
+ * \return            File descriptor
+ */
+static int
+file_create(const size_t sizes[], size_t count) {
+  char path[32];
+  strcpy(path, "/tmp/protobluff-XXXXXX");
+  int fd = mkstemp(path);
+  fail_if(fd < 0);
+  unlink(path);
+
+  /* Write length-prefixed messages */
+  for (size_t m = 0; m < count; m++) {
+    uint8_t prefix[5], data[4096];
+    uint32_t length = (uint32_t)sizes[m];
+    size_t size = pb_varint_pack_uint32(prefix, &length);
+    memset(data, (int)m, sizes[m]);
+    ck_assert_uint_eq(size, write(fd, prefix, size));
+    ck_assert_uint_eq(sizes[m], write(fd, data, sizes[m]));
+  }
+  fail_if(lseek(fd, 0, SEEK_SET));
+  return fd;
+}
+
+/*!
+ * Read all messages of the given sizes and assert their contents.
+ *
+ * \param[in] sizes[]  Message sizes
+ * \param[in] count    Message count
+ * \param[in] capacity Region capacity
+ * \param[in] regions  Region count
+ */
+static void
+file_check(
+    const size_t sizes[], size_t count, size_t capacity, size_t regions) {
+  int fd = file_create(sizes, count);
+  pb_uring_reader_t reader = pb_uring_reader_create(fd, capacity, regions);
+  fail_unless(pb_uring_reader_valid(&reader));
+
+  /* Read and assert messages */
+  pb_buffer_t message;
+  for (size_t m = 0; m < count; m++) {
+    ck_assert_uint_eq(PB_ERROR_NONE,
+      pb_uring_reader_next(&reader, &message));
+    ck_assert_uint_eq(sizes[m], pb_buffer_size(&message));
+    for (size_t b = 0; b < sizes[m]; b++)
+      ck_assert_uint_eq((uint8_t)m, pb_buffer_data(&message)[b]);
+  }
+  ck_assert_uint_eq(PB_ERROR_EOM, pb_uring_reader_next(&reader, &message));
+
+  /* Free all allocated memory */
+  pb_uring_reader_destroy(&reader);
+  close(fd);
+}
+
+/* ----------------------------------------------------------------------------
+ * Tests
+ * ------------------------------------------------------------------------- */
+
+/*
+ * Create an io_uring reader over a file descriptor.
+ */
+START_TEST(test_create) {
+  const size_t sizes[] = { 1, 2, 3 };
+  int fd = file_create(sizes, 3);
+  pb_uring_reader_t reader = pb_uring_reader_create(fd, 64, 4);
+
+  /* Assert reader validity and error */
+  fail_unless(pb_uring_reader_valid(&reader));
+  ck_assert_uint_eq(PB_ERROR_NONE, pb_uring_reader_error(&reader));
+
+  /* Free all allocated memory */
+  pb_uring_reader_destroy(&reader);
+  close(fd);
+} END_TEST
+
+/*
+ * Create an io_uring reader over a file descriptor that can't seek.
+ */
+START_TEST(test_create_invalid) {
+  int fd[2];
+  fail_if(pipe(fd));
+  pb_uring_reader_t reader = pb_uring_reader_create(fd[0], 64, 4);
+
+  /* Assert reader validity and error */
+  fail_if(pb_uring_reader_valid(&reader));
+  ck_assert_uint_eq(PB_ERROR_INVALID, pb_uring_reader_error(&reader));
+
+  /* Free all allocated memory */
+  pb_uring_reader_destroy(&reader);
+  close(fd[0]);
+  close(fd[1]);
+} END_TEST
+
+/*
+ * Read messages contained in adjacent regions without copying.
+ */
+START_TEST(test_next) {
+  const size_t sizes[] = { 10, 20, 0, 30 };
+  int fd = file_create(sizes, 4);
+  pb_uring_reader_t reader = pb_uring_reader_create(fd, 64, 4);
+
+  /* Assert messages point into the regions */
+  pb_buffer_t message;
+  for (size_t m = 0; m < 4; m++) {
+    ck_assert_uint_eq(PB_ERROR_NONE,
+      pb_uring_reader_next(&reader, &message));
+    ck_assert_uint_eq(sizes[m], pb_buffer_size(&message));
+    fail_unless(pb_buffer_data(&message) >= reader.region.data &&
+      pb_buffer_data(&message) < reader.region.data + 256);
+  }
+  ck_assert_uint_eq(PB_ERROR_EOM, pb_uring_reader_next(&reader, &message));
+
+  /* Free all allocated memory */
+  pb_uring_reader_destroy(&reader);
+  close(fd);
+} END_TEST
+
+/*
+ * Read messages that wrap around the regions or exceed them.
+ */
+START_TEST(test_next_spanning) {
+  const size_t sizes[] = { 50, 100, 3, 1000, 0, 255, 256, 257, 7, 4000 };
+  file_check(sizes, 10, 64, 4);
+  file_check(sizes, 10, 16, 2);
+} END_TEST
+
+/*
+ * Read many messages of varying size.
+ */
+START_TEST(test_next_many) {
+  size_t sizes[1000];
+  for (size_t m = 0; m < 1000; m++)
+    sizes[m] = (m * 37) % 200;
+  file_check(sizes, 1000, 128, 8);
+  file_check(sizes, 1000, 4096, 16);
+} END_TEST
+
+/*
+ * Read from an empty file.
+ */
+START_TEST(test_next_empty) {
+  file_check(NULL, 0, 64, 4);
+} END_TEST
+
+/*
+ * Read a truncated message.
+ */
+START_TEST(test_next_truncated) {
+  const size_t sizes[] = { 100 };
+  int fd = file_create(sizes, 1);
+  fail_if(ftruncate(fd, 50));
+  pb_uring_reader_t reader = pb_uring_reader_create(fd, 64, 4);
+
+  /* Assert error */
+  pb_buffer_t message;
+  ck_assert_uint_eq(PB_ERROR_OFFSET, pb_uring_reader_next(&reader, &message));
+
+  /* Free all allocated memory */
+  pb_uring_reader_destroy(&reader);
+  close(fd);
+} END_TEST
+
+/* ----------------------------------------------------------------------------
+ * Program
+ * ------------------------------------------------------------------------- */
+
+/*
+ * Create a test suite for all registered test cases and run it.
+ *
+ * Tests must be run sequentially (in no-fork mode) or code coverage
+ * cannot be determined properly.
+ */
+int
+main(void) {
+  void *suite = suite_create("protobluff/util/uring_reader"),
+       *tcase = NULL;
+
+  /* Add tests to test case "create" */
+  tcase = tcase_create("create");
+  tcase_add_test(tcase, test_create);
+  tcase_add_test(tcase, test_create_invalid);
+  suite_add_tcase(suite, tcase);
+
+  /* Add tests to test case "next" */
+  tcase = tcase_create("next");
+  tcase_add_test(tcase, test_next);
+  tcase_add_test(tcase, test_next_spanning);
+  tcase_add_test(tcase, test_next_many);
+  tcase_add_test(tcase, test_next_empty);
+  tcase_add_test(tcase, test_next_truncated);
+  suite_add_tcase(suite, tcase);
+
+  /* Create a test suite runner in no-fork mode */
+  void *runner = srunner_create(suite);
+  srunner_set_fork_status(runner, CK_NOFORK);
+
+  /* Execute test suite runner */
+  srunner_run_all(runner, CK_NORMAL);
+  int failed = srunner_ntests_failed(runner);
+  srunner_free(runner);
+
+  /* Exit with status code */
+  return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -46,6 +46,18 @@ descriptor = { {
     {  4, "F04", MESSAGE, REPEATED, &descriptor }
   }, 4 } };
 
+/* Descriptor with bitset of required positions */
+static pb_descriptor_t
+descriptor_required = { {
+  (const pb_field_descriptor_t []){
+    {  1, "F01", UINT32,  OPTIONAL },
+    {  2, "F02", UINT64,  REQUIRED },
+    {  3, "F03", UINT32,  REQUIRED }
+  }, 3 }, NULL, { NULL, 0, 0 }, {
+  (const uint64_t []){
+    6
+  }, 1 } };
+
 /* Empty descriptor */
 static pb_descriptor_t
 descriptor_empty = {};
@@ -302,6 +314,30 @@ START_TEST(test_check_multiple_required) {
   pb_buffer_destroy(&buffer);
 } END_TEST
 
+/*
+ * Validate a buffer with a bitset of required positions.
+ */
+START_TEST(test_check_required) {
+  const uint8_t data[] = { 8, 127, 16, 127, 24, 127 };
+  const size_t  size   = 6;
+
+  /* Create validator and buffers */
+  pb_buffer_t    buffer1   = pb_buffer_create(data, size),
+                 buffer2   = pb_buffer_create(data, size - 2);
+  pb_validator_t validator = pb_validator_create(&descriptor_required);
+
+  /* Check buffers */
+  ck_assert_uint_eq(PB_ERROR_NONE,
+    pb_validator_check(&validator, &buffer1));
+  ck_assert_uint_eq(PB_ERROR_ABSENT,
+    pb_validator_check(&validator, &buffer2));
+
+  /* Free all allocated memory */
+  pb_validator_destroy(&validator);
+  pb_buffer_destroy(&buffer1);
+  pb_buffer_destroy(&buffer2);
+} END_TEST
+
 /*
  * Validate an invalid buffer.
  */
@@ -386,6 +422,7 @@ main(void) {
   tcase_add_test(tcase, test_check_extension_nested_empty);
   tcase_add_test(tcase, test_check_multiple_optional);
   tcase_add_test(tcase, test_check_multiple_required);
+  tcase_add_test(tcase, test_check_required);
   tcase_add_test(tcase, test_check_invalid);
   tcase_add_test(tcase, test_check_invalid_tag);
   tcase_add_test(tcase, test_check_invalid_length);